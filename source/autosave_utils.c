@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+# include <io.h>
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+
+#include <SDL.h>
+
+#include "autosave_utils.h"
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+
+typedef struct
+{
+    char path[MAX_PATHLEN];
+    u8 *data;
+    size_t size;
+    size_t capacity;
+} _autosave_file_t;
+
+// The pending file is filled by the emulation thread. When the writer thread
+// takes it, it's swapped with the one that it has just written, so no copies
+// are needed and the emulation thread never waits for the disk.
+static _autosave_file_t autosave_pending;
+static _autosave_file_t autosave_writing;
+
+// All of this is protected by autosave_mutex, and autosave_cond is signaled
+// when any of it changes.
+static int autosave_has_pending;
+static int autosave_busy; // 1 while a file is being written
+static int autosave_exit;
+
+static SDL_mutex *autosave_mutex;
+static SDL_cond *autosave_cond;
+static SDL_Thread *autosave_thread;
+
+//------------------------------------------------------------------------------
+
+int Autosave_FileWrite(const char *path, const void *data, size_t size)
+{
+    char temp_path[MAX_PATHLEN + 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    FILE *f = fopen(temp_path, "wb");
+    if (f == NULL)
+    {
+        Debug_LogMsgArg("Couldn't open file for saving: %s", temp_path);
+        return 1;
+    }
+
+    int error = 0;
+
+    if (fwrite(data, size, 1, f) != 1)
+        error = 1;
+
+    // The data has to be on the disk before the old file is replaced
+    if (fflush(f) != 0)
+        error = 1;
+#ifdef _WIN32
+    if (_commit(_fileno(f)) != 0)
+        error = 1;
+#else
+    if (fsync(fileno(f)) != 0)
+        error = 1;
+#endif
+
+    if (fclose(f) != 0)
+        error = 1;
+
+    if (error == 0)
+    {
+#ifdef _WIN32
+        if (MoveFileEx(temp_path, path, MOVEFILE_REPLACE_EXISTING) == 0)
+            error = 1;
+#else
+        if (rename(temp_path, path) != 0)
+            error = 1;
+#endif
+    }
+
+    if (error)
+    {
+        Debug_LogMsgArg("Couldn't save data to file: %s", path);
+        remove(temp_path);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int autosave_file_write(const _autosave_file_t *file)
+{
+    return Autosave_FileWrite(file->path, file->data, file->size);
+}
+
+static int autosave_thread_fn(unused__ void *data)
+{
+    SDL_LockMutex(autosave_mutex);
+
+    while (1)
+    {
+        while ((autosave_has_pending == 0) && (autosave_exit == 0))
+            SDL_CondWait(autosave_cond, autosave_mutex);
+
+        if (autosave_has_pending == 0)
+            break; // Exit requested and nothing left to write
+
+        _autosave_file_t temp = autosave_writing;
+        autosave_writing = autosave_pending;
+        autosave_pending = temp;
+
+        autosave_has_pending = 0;
+        autosave_busy = 1;
+
+        SDL_UnlockMutex(autosave_mutex);
+
+        autosave_file_write(&autosave_writing);
+
+        SDL_LockMutex(autosave_mutex);
+
+        autosave_busy = 0;
+        SDL_CondBroadcast(autosave_cond);
+    }
+
+    SDL_UnlockMutex(autosave_mutex);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void Autosave_Init(void)
+{
+    if (autosave_thread != NULL)
+        return;
+
+    autosave_mutex = SDL_CreateMutex();
+    autosave_cond = SDL_CreateCond();
+    if ((autosave_mutex == NULL) || (autosave_cond == NULL))
+    {
+        Debug_ErrorMsgArg("%s: %s", __func__, SDL_GetError());
+        return;
+    }
+
+    autosave_exit = 0;
+
+    autosave_thread = SDL_CreateThread(autosave_thread_fn, "Autosave", NULL);
+    if (autosave_thread == NULL)
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+}
+
+void Autosave_End(void)
+{
+    if (autosave_thread != NULL)
+    {
+        SDL_LockMutex(autosave_mutex);
+        autosave_exit = 1;
+        SDL_CondBroadcast(autosave_cond);
+        SDL_UnlockMutex(autosave_mutex);
+
+        SDL_WaitThread(autosave_thread, NULL);
+        autosave_thread = NULL;
+    }
+
+    if (autosave_cond != NULL)
+    {
+        SDL_DestroyCond(autosave_cond);
+        autosave_cond = NULL;
+    }
+    if (autosave_mutex != NULL)
+    {
+        SDL_DestroyMutex(autosave_mutex);
+        autosave_mutex = NULL;
+    }
+
+    free(autosave_pending.data);
+    free(autosave_writing.data);
+    memset(&autosave_pending, 0, sizeof(autosave_pending));
+    memset(&autosave_writing, 0, sizeof(autosave_writing));
+}
+
+void *Autosave_Begin(const char *path, size_t size)
+{
+    if ((size == 0) || (strlen(path) >= sizeof(autosave_pending.path)))
+    {
+        Debug_ErrorMsgArg("%s: Invalid arguments.", __func__);
+        return NULL;
+    }
+
+    if (autosave_thread != NULL)
+    {
+        SDL_LockMutex(autosave_mutex);
+
+        // A pending file can only be replaced by a newer version of itself
+        while (autosave_has_pending
+               && (strcmp(autosave_pending.path, path) != 0))
+        {
+            SDL_CondWait(autosave_cond, autosave_mutex);
+        }
+
+        // The mutex stays locked until Autosave_Commit()
+    }
+
+    if (size > autosave_pending.capacity)
+    {
+        u8 *data = realloc(autosave_pending.data, size);
+        if (data == NULL)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+            if (autosave_thread != NULL)
+                SDL_UnlockMutex(autosave_mutex);
+            return NULL;
+        }
+
+        autosave_pending.data = data;
+        autosave_pending.capacity = size;
+    }
+
+    s_strncpy(autosave_pending.path, path, sizeof(autosave_pending.path));
+    autosave_pending.size = size;
+
+    return autosave_pending.data;
+}
+
+void Autosave_Commit(void)
+{
+    if (autosave_thread == NULL)
+    {
+        autosave_file_write(&autosave_pending);
+        return;
+    }
+
+    autosave_has_pending = 1;
+    SDL_CondBroadcast(autosave_cond);
+
+    SDL_UnlockMutex(autosave_mutex);
+}
+
+void Autosave_Flush(void)
+{
+    if (autosave_thread == NULL)
+        return;
+
+    SDL_LockMutex(autosave_mutex);
+
+    while (autosave_has_pending || autosave_busy)
+        SDL_CondWait(autosave_cond, autosave_mutex);
+
+    SDL_UnlockMutex(autosave_mutex);
+}
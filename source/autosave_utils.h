@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef AUTOSAVE_UTILS__
+#define AUTOSAVE_UTILS__
+
+#include <stddef.h>
+
+// Battery saves are written by a background thread so that the emulation
+// doesn't have to wait for the disk. Each file is written to a temporary file
+// that replaces the old one once it is complete, so a crash never leaves a
+// save file half written.
+//
+// Only one file can be waiting to be written. If it hasn't been written when a
+// new version of the same file is queued, the new version replaces it. If the
+// thread isn't running, the files are written right away.
+
+void Autosave_Init(void);
+void Autosave_End(void); // Writes the pending file and stops the thread
+
+// Returns a buffer of "size" bytes (more than 0) that has to be filled with the
+// new contents of the file, or NULL on error. Autosave_Commit() has to be
+// called after filling it to queue it. Nothing else can be queued in between.
+void *Autosave_Begin(const char *path, size_t size);
+void Autosave_Commit(void);
+
+// Waits until the pending file has been written. It has to be called before
+// reading a file that may be waiting to be written.
+void Autosave_Flush(void);
+
+// Writes a file the same way as the thread, right away. It only logs errors, so
+// it can be used from other threads. Returns 0 on success.
+int Autosave_FileWrite(const char *path, const void *data, size_t size);
+
+#endif // AUTOSAVE_UTILS__
@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <zlib.h>
+
+#include "autosave_utils.h"
+#include "build_options.h"
+#include "checkpoint_utils.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "savestate_utils.h"
+
+#define CHECKPOINT_MAGIC    "GBCP"
+#define CHECKPOINT_VERSION  (1)
+
+typedef struct
+{
+    u8 magic[4];
+    u32 version;
+    u32 size;
+} _checkpoint_header_t;
+
+typedef struct
+{
+    char path[MAX_PATHLEN];
+    _savestate_t st;
+} _checkpoint_t;
+
+// The pending checkpoint is saved by the emulation thread. When the writer
+// thread takes it, it's swapped with the one that it has just written, so the
+// buffers of the states are reused and nothing is copied.
+static _checkpoint_t checkpoint_pending;
+static _checkpoint_t checkpoint_writing;
+
+// Only used by the writer thread (or by Checkpoint_Commit() if there is none)
+static u8 *checkpoint_file;
+static size_t checkpoint_file_capacity;
+
+// All of this is protected by checkpoint_mutex, and checkpoint_cond is
+// signaled when any of it changes.
+static int checkpoint_has_pending;
+static int checkpoint_busy; // 1 while a checkpoint is being written
+static int checkpoint_exit;
+
+static SDL_mutex *checkpoint_mutex;
+static SDL_cond *checkpoint_cond;
+static SDL_Thread *checkpoint_thread;
+
+//------------------------------------------------------------------------------
+
+// Only logs errors, it can be called from the writer thread
+static int checkpoint_write(const _checkpoint_t *cp)
+{
+    size_t capacity = sizeof(_checkpoint_header_t) + compressBound(cp->st.size);
+    if (capacity > checkpoint_file_capacity)
+    {
+        u8 *file = realloc(checkpoint_file, capacity);
+        if (file == NULL)
+        {
+            Debug_LogMsgArg("%s: Not enough memory.", __func__);
+            return 1;
+        }
+
+        checkpoint_file = file;
+        checkpoint_file_capacity = capacity;
+    }
+
+    _checkpoint_header_t header;
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.size = cp->st.size;
+    memcpy(checkpoint_file, &header, sizeof(header));
+
+    // The fastest level is enough, most of a state is zeroes or repeated data
+    uLongf size = capacity - sizeof(header);
+    if (compress2(&checkpoint_file[sizeof(header)], &size, cp->st.data,
+                  cp->st.size, Z_BEST_SPEED) != Z_OK)
+    {
+        Debug_LogMsgArg("%s: Can't compress the state.", __func__);
+        return 1;
+    }
+
+    return Autosave_FileWrite(cp->path, checkpoint_file,
+                              sizeof(header) + size);
+}
+
+static int checkpoint_thread_fn(unused__ void *data)
+{
+    SDL_LockMutex(checkpoint_mutex);
+
+    while (1)
+    {
+        while ((checkpoint_has_pending == 0) && (checkpoint_exit == 0))
+            SDL_CondWait(checkpoint_cond, checkpoint_mutex);
+
+        if (checkpoint_has_pending == 0)
+            break; // Exit requested and nothing left to write
+
+        _checkpoint_t temp = checkpoint_writing;
+        checkpoint_writing = checkpoint_pending;
+        checkpoint_pending = temp;
+
+        checkpoint_has_pending = 0;
+        checkpoint_busy = 1;
+
+        SDL_UnlockMutex(checkpoint_mutex);
+
+        checkpoint_write(&checkpoint_writing);
+
+        SDL_LockMutex(checkpoint_mutex);
+
+        checkpoint_busy = 0;
+        SDL_CondBroadcast(checkpoint_cond);
+    }
+
+    SDL_UnlockMutex(checkpoint_mutex);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void Checkpoint_Init(void)
+{
+    if (checkpoint_thread != NULL)
+        return;
+
+    checkpoint_mutex = SDL_CreateMutex();
+    checkpoint_cond = SDL_CreateCond();
+    if ((checkpoint_mutex == NULL) || (checkpoint_cond == NULL))
+    {
+        Debug_ErrorMsgArg("%s: %s", __func__, SDL_GetError());
+        return;
+    }
+
+    checkpoint_exit = 0;
+
+    checkpoint_thread = SDL_CreateThread(checkpoint_thread_fn, "Checkpoint",
+                                         NULL);
+    if (checkpoint_thread == NULL)
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+}
+
+void Checkpoint_End(void)
+{
+    if (checkpoint_thread != NULL)
+    {
+        SDL_LockMutex(checkpoint_mutex);
+        checkpoint_exit = 1;
+        SDL_CondBroadcast(checkpoint_cond);
+        SDL_UnlockMutex(checkpoint_mutex);
+
+        SDL_WaitThread(checkpoint_thread, NULL);
+        checkpoint_thread = NULL;
+    }
+
+    if (checkpoint_cond != NULL)
+    {
+        SDL_DestroyCond(checkpoint_cond);
+        checkpoint_cond = NULL;
+    }
+    if (checkpoint_mutex != NULL)
+    {
+        SDL_DestroyMutex(checkpoint_mutex);
+        checkpoint_mutex = NULL;
+    }
+
+    SaveState_Free(&checkpoint_pending.st);
+    SaveState_Free(&checkpoint_writing.st);
+
+    free(checkpoint_file);
+    checkpoint_file = NULL;
+    checkpoint_file_capacity = 0;
+}
+
+_savestate_t *Checkpoint_Begin(const char *path)
+{
+    // The mutex stays locked until Checkpoint_Commit(). The writer thread only
+    // needs it to take the pending checkpoint, so it never waits for long.
+    if (checkpoint_thread != NULL)
+        SDL_LockMutex(checkpoint_mutex);
+
+    s_strncpy(checkpoint_pending.path, path, sizeof(checkpoint_pending.path));
+
+    checkpoint_pending.st.error = 0;
+
+    return &checkpoint_pending.st;
+}
+
+void Checkpoint_Commit(void)
+{
+    int valid = (checkpoint_pending.st.error == 0)
+                && (checkpoint_pending.st.size > 0);
+
+    if (checkpoint_thread == NULL)
+    {
+        if (valid)
+            checkpoint_write(&checkpoint_pending);
+        return;
+    }
+
+    // If the state is wrong, the previous pending checkpoint isn't valid
+    // either, it has been overwritten.
+    checkpoint_has_pending = valid;
+    SDL_CondBroadcast(checkpoint_cond);
+
+    SDL_UnlockMutex(checkpoint_mutex);
+}
+
+void Checkpoint_Flush(void)
+{
+    if (checkpoint_thread == NULL)
+        return;
+
+    SDL_LockMutex(checkpoint_mutex);
+
+    while (checkpoint_has_pending || checkpoint_busy)
+        SDL_CondWait(checkpoint_cond, checkpoint_mutex);
+
+    SDL_UnlockMutex(checkpoint_mutex);
+}
+
+int Checkpoint_Load(_savestate_t *st, const char *path)
+{
+    Checkpoint_Flush();
+
+    void *buffer;
+    unsigned int size;
+
+    FileLoad_NoError(path, &buffer, &size);
+    if (buffer == NULL)
+        return 1;
+
+    _checkpoint_header_t header;
+    if (size < sizeof(header))
+    {
+        free(buffer);
+        return 1;
+    }
+
+    memcpy(&header, buffer, sizeof(header));
+
+    if ((memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0)
+        || (header.version != CHECKPOINT_VERSION) || (header.size == 0))
+    {
+        free(buffer);
+        return 1;
+    }
+
+    u8 *data = malloc(header.size);
+    uLongf data_size = header.size;
+
+    int ret = (data == NULL)
+              || (uncompress(data, &data_size, (u8 *)buffer + sizeof(header),
+                             size - sizeof(header)) != Z_OK)
+              || (data_size != header.size);
+
+    free(buffer);
+
+    if (ret)
+    {
+        free(data);
+        return 1;
+    }
+
+    free(st->data);
+    st->data = data;
+    st->size = header.size;
+    st->capacity = header.size;
+    st->error = 0;
+
+    return 0;
+}
+
+void Checkpoint_Remove(const char *path)
+{
+    if (checkpoint_thread != NULL)
+    {
+        SDL_LockMutex(checkpoint_mutex);
+
+        if (checkpoint_has_pending
+            && (strcmp(checkpoint_pending.path, path) == 0))
+        {
+            checkpoint_has_pending = 0;
+        }
+
+        while (checkpoint_busy)
+            SDL_CondWait(checkpoint_cond, checkpoint_mutex);
+
+        SDL_UnlockMutex(checkpoint_mutex);
+    }
+
+    remove(path);
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef CHECKPOINT_UTILS__
+#define CHECKPOINT_UTILS__
+
+#include "savestate_utils.h"
+
+// Periodic save states used to recover the emulation after a crash. Saving a
+// state is just a few memcpy() calls, so the emulation thread saves it directly
+// to one of two buffers that are swapped with the writer thread. The writer
+// compresses it and writes it to the disk while the emulation continues, so
+// the emulation thread never waits for the compression or the disk.
+//
+// If the writer hasn't taken the previous checkpoint when a new one is saved,
+// the new one replaces it. Files are replaced only once they are complete, the
+// same way as battery saves (see autosave_utils.h).
+//
+// The file is a header followed by the zlib compressed state:
+//
+//     u8  magic[4]     "GBCP"
+//     u32 version      CHECKPOINT_VERSION
+//     u32 size         Size of the state before compressing it
+
+void Checkpoint_Init(void);
+void Checkpoint_End(void); // Writes the pending checkpoint and stops the thread
+
+// Returns the state that the checkpoint has to be saved to, then
+// Checkpoint_Commit() has to be called. If the state has any error when it is
+// committed it is discarded. Nothing else can be done in between.
+_savestate_t *Checkpoint_Begin(const char *path);
+void Checkpoint_Commit(void);
+
+// Waits until the pending checkpoint has been written
+void Checkpoint_Flush(void);
+
+// Loads the state of a checkpoint file. Returns 0 on success.
+int Checkpoint_Load(_savestate_t *st, const char *path);
+// Deletes a checkpoint file, including one that is waiting to be written
+void Checkpoint_Remove(const char *path);
+
+#endif // CHECKPOINT_UTILS__
@@ -20,30 +20,6 @@
 
 #include "gba_core/sound.h"
 
-// Default values...
-t_config EmulatorConfig = {
-    0, // debug_msg_enable
-    2, // screen_size
-    0, // load_from_boot_rom
-    0, // frameskip
-    0, // oglfilter
-    0, // auto_close_debugger
-    0, // webcam_select
-    //---------
-    64,   // volume
-    0x3F, // chn_flags
-    0,    // snd_mute
-    //---------
-    -1,               // hardware_type
-    SERIAL_GBPRINTER, // serial_device
-    0,                // enableblur
-    0,                // realcolors
-    0x0200,           // gbcam_exposure_reference
-
-    // The GB palette is not stored here, it is stored in gb_main.c
-    // The input config not here, either... it's in input_utils.c
-};
-
 #define CFG_DB_MSG_ENABLE "debug_msg_enable"
 // "true" - "false"
 
@@ -53,9 +29,55 @@ t_config EmulatorConfig = {
 #define CFG_LOAD_BOOT_ROM "load_boot_rom"
 // "true" - "false"
 
+#define CFG_BOOT_STATE_CACHE "boot_state_cache"
+// "true" - "false"
+
 #define CFG_FRAMESKIP "frameskip"
 // "-1" - "4"
 
+#define CFG_REWIND_SECONDS "rewind_seconds"
+// unsigned integer ( "0" - "60" )
+
+#define CFG_RUN_AHEAD_FRAMES "run_ahead_frames"
+// unsigned integer ( "0" - "4" )
+
+#define CFG_INPUT_LATE_LATCH "input_late_latch"
+// "true" - "false"
+
+#define CFG_INPUT_LATENCY_REPORT "input_latency_report"
+// "true" - "false"
+
+#define CFG_AUTOSAVE_SECONDS "autosave_seconds"
+// unsigned integer ( "0" - "60" )
+
+#define CFG_CHECKPOINT_SECONDS "checkpoint_seconds"
+// unsigned integer ( "0" - "600" )
+
+#define CFG_FRAME_PACING "frame_pacing"
+static const char *framepacingmode[] = {
+    "timer", "vsync", "free"
+};
+
+#define CFG_SPEEDUP_SPEED "speedup_speed"
+// "max" or unsigned integer ( "2" - "10" )
+
+#define CFG_EMULATION_THREAD "emulation_thread"
+// "true" - "false"
+
+#define CFG_PNG_COMPRESSION "png_compression"
+// unsigned integer ( "0" - "9" )
+
+#define CFG_VIDEO_RECORD_FORMAT "video_record_format"
+static const char *videorecordformat[] = {
+    "gbv", "ffmpeg"
+};
+
+#define CFG_SHARED_OUTPUT "shared_output"
+// Path of the file, empty to disable it (for example "/dev/shm/giibii")
+
+#define CFG_STREAM_PORT "stream_port"
+// unsigned integer ( "0" - "65535" ), 0 to disable it
+
 #define CFG_OPENGL_FILTER "opengl_filter"
 static const char *oglfiltertype[] = {
     "nearest", "linear"
@@ -64,6 +86,9 @@ static const char *oglfiltertype[] = {
 #define CFG_AUTO_CLOSE_DEBUGGER "auto_close_debugger"
 // "true" - "false"
 
+#define CFG_PROFILE_OVERLAY "profile_overlay"
+// "true" - "false"
+
 #define CFG_WEBCAM_SELECT "webcam_select"
 // "0" - "9"
 
@@ -76,6 +101,25 @@ static const char *oglfiltertype[] = {
 #define CFG_SND_MUTE "sound_mute"
 // "true" - "false"
 
+#define CFG_SND_SAMPLE_RATE "sample_rate"
+// unsigned integer ( "8000" - "192000" )
+
+#define CFG_SND_BUFFER_SAMPLES "buffer_samples"
+// unsigned integer, power of two ( "64" - "8192" )
+
+#define CFG_SND_OUTPUT_MODE "output_mode"
+static const char *sndoutputmode[] = {
+    "callback", "queue"
+};
+
+#define CFG_SND_SYNC "audio_sync"
+// "true" - "false"
+
+#define CFG_SND_RECORD_FORMAT "record_format"
+static const char *sndrecordformat[] = {
+    "wav", "flac"
+};
+
 #define CFG_HW_TYPE "hardware_type"
 static const char *hwtype[] = {
     "Auto", "DMG", "MGB", "SGB", "SG2", "CGB", "AGB", "AGS"
@@ -83,12 +127,24 @@ static const char *hwtype[] = {
 
 #define CFG_SERIAL_DEVICE "serial_device"
 static const char *serialdevice[] = {
-    "None", "GBPrinter" //, "Gameboy"
+    "None", "GBPrinter", "GameBoy"
 };
 
+#define CFG_LINK_ADDRESS "link_address"
+// Host name or IP address, empty to wait for the connection
+
+#define CFG_LINK_PORT "link_port"
+// unsigned integer ( "1" - "65535" )
+
+#define CFG_LINK_LOCKSTEP "link_lockstep"
+// "true" - "false"
+
 #define CFG_ENABLE_BLUR "enable_blur"
 // "true" - "false"
 
+#define CFG_BLUR_STRENGTH "blur_strength"
+// integer ( "0" - "100" ), only used when the blending is done by the GPU
+
 #define CFG_REAL_GB_COLORS "real_colors"
 // "true" - "false"
 
@@ -98,6 +154,18 @@ static const char *serialdevice[] = {
 #define CFG_GB_PALETTE "gb_palette"
 // "#RRGGBB"
 
+#define CFG_GBA_LINK_CABLE "gba_link_cable"
+// "true" - "false"
+
+#define CFG_GBA_HLE_IRQ "gba_hle_irq"
+// "true" - "false"
+
+#define CFG_GBA_HUGE_PAGES "gba_huge_pages"
+// "true" - "false"
+
+#define CFG_GBA_SAVE_MMAP "gba_save_mmap"
+// "true" - "false"
+
 //---------------------------------------------------------------------
 
 void Config_Save(void)
@@ -124,11 +192,42 @@ void Config_Save(void)
     fprintf(ini_file, CFG_SCREEN_SIZE "=%d\n", EmulatorConfig.screen_size);
     fprintf(ini_file, CFG_LOAD_BOOT_ROM "=%s\n",
             EmulatorConfig.load_from_boot_rom ? "true" : "false");
+    fprintf(ini_file, CFG_BOOT_STATE_CACHE "=%s\n",
+            EmulatorConfig.boot_state_cache ? "true" : "false");
     fprintf(ini_file, CFG_FRAMESKIP "=%d\n", EmulatorConfig.frameskip);
+    fprintf(ini_file, CFG_REWIND_SECONDS "=%d\n",
+            EmulatorConfig.rewind_seconds);
+    fprintf(ini_file, CFG_RUN_AHEAD_FRAMES "=%d\n",
+            EmulatorConfig.run_ahead_frames);
+    fprintf(ini_file, CFG_INPUT_LATE_LATCH "=%s\n",
+            EmulatorConfig.input_late_latch ? "true" : "false");
+    fprintf(ini_file, CFG_INPUT_LATENCY_REPORT "=%s\n",
+            EmulatorConfig.input_latency_report ? "true" : "false");
+    fprintf(ini_file, CFG_AUTOSAVE_SECONDS "=%d\n",
+            EmulatorConfig.autosave_seconds);
+    fprintf(ini_file, CFG_CHECKPOINT_SECONDS "=%d\n",
+            EmulatorConfig.checkpoint_seconds);
+    fprintf(ini_file, CFG_FRAME_PACING "=%s\n",
+            framepacingmode[EmulatorConfig.frame_pacing]);
+    if (EmulatorConfig.speedup_speed == 0)
+        fprintf(ini_file, CFG_SPEEDUP_SPEED "=max\n");
+    else
+        fprintf(ini_file, CFG_SPEEDUP_SPEED "=%d\n",
+                EmulatorConfig.speedup_speed);
+    fprintf(ini_file, CFG_EMULATION_THREAD "=%s\n",
+            EmulatorConfig.emulation_thread ? "true" : "false");
+    fprintf(ini_file, CFG_PNG_COMPRESSION "=%d\n",
+            EmulatorConfig.png_compression);
+    fprintf(ini_file, CFG_VIDEO_RECORD_FORMAT "=%s\n",
+            videorecordformat[EmulatorConfig.video_record_format]);
+    fprintf(ini_file, CFG_SHARED_OUTPUT "=%s\n", EmulatorConfig.shared_output);
+    fprintf(ini_file, CFG_STREAM_PORT "=%d\n", EmulatorConfig.stream_port);
     fprintf(ini_file, CFG_OPENGL_FILTER "=%s\n",
             oglfiltertype[EmulatorConfig.oglfilter]);
     fprintf(ini_file, CFG_AUTO_CLOSE_DEBUGGER "=%s\n",
             EmulatorConfig.auto_close_debugger ? "true" : "false");
+    fprintf(ini_file, CFG_PROFILE_OVERLAY "=%s\n",
+            EmulatorConfig.profile_overlay ? "true" : "false");
     fprintf(ini_file, CFG_WEBCAM_SELECT "=%d\n", EmulatorConfig.webcam_select);
     fprintf(ini_file, "\n");
 
@@ -139,6 +238,16 @@ void Config_Save(void)
     fprintf(ini_file, CFG_SND_VOLUME "=#%02X\n", volume);
     fprintf(ini_file, CFG_SND_MUTE "=%s\n",
             EmulatorConfig.snd_mute ? "true" : "false");
+    fprintf(ini_file, CFG_SND_SAMPLE_RATE "=%d\n",
+            EmulatorConfig.snd_sample_rate);
+    fprintf(ini_file, CFG_SND_BUFFER_SAMPLES "=%d\n",
+            EmulatorConfig.snd_buffer_samples);
+    fprintf(ini_file, CFG_SND_OUTPUT_MODE "=%s\n",
+            sndoutputmode[EmulatorConfig.snd_queue_mode]);
+    fprintf(ini_file, CFG_SND_SYNC "=%s\n",
+            EmulatorConfig.snd_sync ? "true" : "false");
+    fprintf(ini_file, CFG_SND_RECORD_FORMAT "=%s\n",
+            sndrecordformat[EmulatorConfig.snd_record_format]);
     fprintf(ini_file, "\n");
 
     fprintf(ini_file, "[GameBoy]\n");
@@ -146,8 +255,13 @@ void Config_Save(void)
             hwtype[EmulatorConfig.hardware_type + 1]);
     fprintf(ini_file, CFG_SERIAL_DEVICE "=%s\n",
             serialdevice[EmulatorConfig.serial_device]);
+    fprintf(ini_file, CFG_LINK_ADDRESS "=%s\n", EmulatorConfig.link_address);
+    fprintf(ini_file, CFG_LINK_PORT "=%d\n", EmulatorConfig.link_port);
+    fprintf(ini_file, CFG_LINK_LOCKSTEP "=%s\n",
+            EmulatorConfig.link_lockstep ? "true" : "false");
     fprintf(ini_file, CFG_ENABLE_BLUR "=%s\n",
             EmulatorConfig.enableblur ? "true" : "false");
+    fprintf(ini_file, CFG_BLUR_STRENGTH "=%d\n", EmulatorConfig.blurstrength);
     fprintf(ini_file, CFG_REAL_GB_COLORS "=%s\n",
             EmulatorConfig.realcolors ? "true" : "false");
     fprintf(ini_file, CFG_GBCAM_EXPOSURE_REFERENCE "=#%04X\n",
@@ -158,6 +272,17 @@ void Config_Save(void)
     fprintf(ini_file, CFG_GB_PALETTE "=#%02X%02X%02X\n", r, g, b);
     fprintf(ini_file, "\n");
 
+    fprintf(ini_file, "[GameBoyAdvance]\n");
+    fprintf(ini_file, CFG_GBA_LINK_CABLE "=%s\n",
+            EmulatorConfig.gba_link_cable ? "true" : "false");
+    fprintf(ini_file, CFG_GBA_HLE_IRQ "=%s\n",
+            EmulatorConfig.gba_hle_irq ? "true" : "false");
+    fprintf(ini_file, CFG_GBA_HUGE_PAGES "=%s\n",
+            EmulatorConfig.gba_huge_pages ? "true" : "false");
+    fprintf(ini_file, CFG_GBA_SAVE_MMAP "=%s\n",
+            EmulatorConfig.gba_save_mmap ? "true" : "false");
+    fprintf(ini_file, "\n");
+
     fprintf(ini_file, "[Controls]\n");
 
     for (int player = 0; player < 4; player++)
@@ -289,6 +414,16 @@ void Config_Load(void)
             EmulatorConfig.load_from_boot_rom = 0;
     }
 
+    tmp = strstr(ini, CFG_BOOT_STATE_CACHE);
+    if (tmp)
+    {
+        tmp += strlen(CFG_BOOT_STATE_CACHE) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.boot_state_cache = 1;
+        else
+            EmulatorConfig.boot_state_cache = 0;
+    }
+
     EmulatorConfig.frameskip = 0;
     tmp = strstr(ini, CFG_FRAMESKIP);
     if (tmp)
@@ -303,6 +438,169 @@ void Config_Load(void)
             EmulatorConfig.frameskip = 4;
     }
 
+    tmp = strstr(ini, CFG_REWIND_SECONDS);
+    if (tmp)
+    {
+        tmp += strlen(CFG_REWIND_SECONDS) + 1;
+        EmulatorConfig.rewind_seconds = atoi(tmp);
+        if (EmulatorConfig.rewind_seconds > 60)
+            EmulatorConfig.rewind_seconds = 60;
+        else if (EmulatorConfig.rewind_seconds < 0)
+            EmulatorConfig.rewind_seconds = 0;
+    }
+
+    tmp = strstr(ini, CFG_RUN_AHEAD_FRAMES);
+    if (tmp)
+    {
+        tmp += strlen(CFG_RUN_AHEAD_FRAMES) + 1;
+        EmulatorConfig.run_ahead_frames = atoi(tmp);
+        if (EmulatorConfig.run_ahead_frames > 4)
+            EmulatorConfig.run_ahead_frames = 4;
+        else if (EmulatorConfig.run_ahead_frames < 0)
+            EmulatorConfig.run_ahead_frames = 0;
+    }
+
+    tmp = strstr(ini, CFG_INPUT_LATE_LATCH);
+    if (tmp)
+    {
+        tmp += strlen(CFG_INPUT_LATE_LATCH) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.input_late_latch = 1;
+        else
+            EmulatorConfig.input_late_latch = 0;
+    }
+
+    tmp = strstr(ini, CFG_INPUT_LATENCY_REPORT);
+    if (tmp)
+    {
+        tmp += strlen(CFG_INPUT_LATENCY_REPORT) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.input_latency_report = 1;
+        else
+            EmulatorConfig.input_latency_report = 0;
+    }
+
+    tmp = strstr(ini, CFG_AUTOSAVE_SECONDS);
+    if (tmp)
+    {
+        tmp += strlen(CFG_AUTOSAVE_SECONDS) + 1;
+        EmulatorConfig.autosave_seconds = atoi(tmp);
+        if (EmulatorConfig.autosave_seconds > 60)
+            EmulatorConfig.autosave_seconds = 60;
+        else if (EmulatorConfig.autosave_seconds < 0)
+            EmulatorConfig.autosave_seconds = 0;
+    }
+
+    tmp = strstr(ini, CFG_CHECKPOINT_SECONDS);
+    if (tmp)
+    {
+        tmp += strlen(CFG_CHECKPOINT_SECONDS) + 1;
+        EmulatorConfig.checkpoint_seconds = atoi(tmp);
+        if (EmulatorConfig.checkpoint_seconds > 600)
+            EmulatorConfig.checkpoint_seconds = 600;
+        else if (EmulatorConfig.checkpoint_seconds < 0)
+            EmulatorConfig.checkpoint_seconds = 0;
+    }
+
+    tmp = strstr(ini, CFG_FRAME_PACING);
+    if (tmp)
+    {
+        tmp += strlen(CFG_FRAME_PACING) + 1;
+
+        int result = 0;
+        for (int i = 0; i < ARRAY_NUM_ELEMENTS(framepacingmode); i++)
+        {
+            if (strncmp(tmp, framepacingmode[i],
+                        strlen(framepacingmode[i])) == 0)
+            {
+                result = i;
+            }
+        }
+
+        EmulatorConfig.frame_pacing = result;
+    }
+
+    tmp = strstr(ini, CFG_SPEEDUP_SPEED);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SPEEDUP_SPEED) + 1;
+        if (strncmp(tmp, "max", strlen("max")) == 0)
+        {
+            EmulatorConfig.speedup_speed = 0;
+        }
+        else
+        {
+            EmulatorConfig.speedup_speed = atoi(tmp);
+            if (EmulatorConfig.speedup_speed > 10)
+                EmulatorConfig.speedup_speed = 10;
+            else if (EmulatorConfig.speedup_speed < 2)
+                EmulatorConfig.speedup_speed = 2;
+        }
+    }
+
+    tmp = strstr(ini, CFG_EMULATION_THREAD);
+    if (tmp)
+    {
+        tmp += strlen(CFG_EMULATION_THREAD) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.emulation_thread = 1;
+        else
+            EmulatorConfig.emulation_thread = 0;
+    }
+
+    tmp = strstr(ini, CFG_PNG_COMPRESSION);
+    if (tmp)
+    {
+        tmp += strlen(CFG_PNG_COMPRESSION) + 1;
+        EmulatorConfig.png_compression = atoi(tmp);
+        if (EmulatorConfig.png_compression > 9)
+            EmulatorConfig.png_compression = 9;
+        else if (EmulatorConfig.png_compression < 0)
+            EmulatorConfig.png_compression = 0;
+    }
+
+    tmp = strstr(ini, CFG_VIDEO_RECORD_FORMAT);
+    if (tmp)
+    {
+        tmp += strlen(CFG_VIDEO_RECORD_FORMAT) + 1;
+
+        int result = 0;
+        for (int i = 0; i < ARRAY_NUM_ELEMENTS(videorecordformat); i++)
+        {
+            if (strncmp(tmp, videorecordformat[i],
+                        strlen(videorecordformat[i])) == 0)
+            {
+                result = i;
+            }
+        }
+
+        EmulatorConfig.video_record_format = result;
+    }
+
+    tmp = strstr(ini, CFG_SHARED_OUTPUT);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SHARED_OUTPUT) + 1;
+
+        size_t len = strcspn(tmp, "\r\n");
+        if (len >= sizeof(EmulatorConfig.shared_output))
+            len = sizeof(EmulatorConfig.shared_output) - 1;
+
+        memcpy(EmulatorConfig.shared_output, tmp, len);
+        EmulatorConfig.shared_output[len] = '\0';
+    }
+
+    tmp = strstr(ini, CFG_STREAM_PORT);
+    if (tmp)
+    {
+        tmp += strlen(CFG_STREAM_PORT) + 1;
+        EmulatorConfig.stream_port = atoi(tmp);
+        if (EmulatorConfig.stream_port > 65535)
+            EmulatorConfig.stream_port = 65535;
+        else if (EmulatorConfig.stream_port < 0)
+            EmulatorConfig.stream_port = 0;
+    }
+
     tmp = strstr(ini, CFG_OPENGL_FILTER);
     if (tmp)
     {
@@ -326,6 +624,16 @@ void Config_Load(void)
             EmulatorConfig.auto_close_debugger = 0;
     }
 
+    tmp = strstr(ini, CFG_PROFILE_OVERLAY);
+    if (tmp)
+    {
+        tmp += strlen(CFG_PROFILE_OVERLAY) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.profile_overlay = 1;
+        else
+            EmulatorConfig.profile_overlay = 0;
+    }
+
     tmp = strstr(ini, CFG_WEBCAM_SELECT);
     if (tmp)
     {
@@ -380,6 +688,72 @@ void Config_Load(void)
             EmulatorConfig.snd_mute = 0;
     }
 
+    tmp = strstr(ini, CFG_SND_SAMPLE_RATE);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SND_SAMPLE_RATE) + 1;
+        EmulatorConfig.snd_sample_rate = atoi(tmp);
+        if (EmulatorConfig.snd_sample_rate > 192000)
+            EmulatorConfig.snd_sample_rate = 192000;
+        else if (EmulatorConfig.snd_sample_rate < 8000)
+            EmulatorConfig.snd_sample_rate = 8000;
+    }
+
+    tmp = strstr(ini, CFG_SND_BUFFER_SAMPLES);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SND_BUFFER_SAMPLES) + 1;
+        int samples = atoi(tmp);
+
+        // Round down to a power of two
+        int result = 64;
+        while ((result < 8192) && ((result * 2) <= samples))
+            result *= 2;
+
+        EmulatorConfig.snd_buffer_samples = result;
+    }
+
+    tmp = strstr(ini, CFG_SND_OUTPUT_MODE);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SND_OUTPUT_MODE) + 1;
+
+        int result = 0;
+        for (int i = 0; i < ARRAY_NUM_ELEMENTS(sndoutputmode); i++)
+            if (strncmp(tmp, sndoutputmode[i], strlen(sndoutputmode[i])) == 0)
+                result = i;
+
+        EmulatorConfig.snd_queue_mode = result;
+    }
+
+    tmp = strstr(ini, CFG_SND_SYNC);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SND_SYNC) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.snd_sync = 1;
+        else
+            EmulatorConfig.snd_sync = 0;
+    }
+
+    tmp = strstr(ini, CFG_SND_RECORD_FORMAT);
+    if (tmp)
+    {
+        tmp += strlen(CFG_SND_RECORD_FORMAT) + 1;
+
+        int result = 0;
+        for (int i = 0; i < ARRAY_NUM_ELEMENTS(sndrecordformat); i++)
+        {
+            if (strncmp(tmp, sndrecordformat[i],
+                        strlen(sndrecordformat[i])) == 0)
+            {
+                result = i;
+            }
+        }
+
+        EmulatorConfig.snd_record_format = result;
+    }
+
     // GAMEBOY
     tmp = strstr(ini, CFG_HW_TYPE);
     if (tmp)
@@ -407,6 +781,40 @@ void Config_Load(void)
         EmulatorConfig.serial_device = result;
     }
 
+    tmp = strstr(ini, CFG_LINK_ADDRESS);
+    if (tmp)
+    {
+        tmp += strlen(CFG_LINK_ADDRESS) + 1;
+
+        size_t len = strcspn(tmp, "\r\n");
+        if (len >= sizeof(EmulatorConfig.link_address))
+            len = sizeof(EmulatorConfig.link_address) - 1;
+
+        memcpy(EmulatorConfig.link_address, tmp, len);
+        EmulatorConfig.link_address[len] = '\0';
+    }
+
+    tmp = strstr(ini, CFG_LINK_PORT);
+    if (tmp)
+    {
+        tmp += strlen(CFG_LINK_PORT) + 1;
+        EmulatorConfig.link_port = atoi(tmp);
+        if (EmulatorConfig.link_port > 65535)
+            EmulatorConfig.link_port = 65535;
+        else if (EmulatorConfig.link_port < 1)
+            EmulatorConfig.link_port = 1;
+    }
+
+    tmp = strstr(ini, CFG_LINK_LOCKSTEP);
+    if (tmp)
+    {
+        tmp += strlen(CFG_LINK_LOCKSTEP) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.link_lockstep = 1;
+        else
+            EmulatorConfig.link_lockstep = 0;
+    }
+
     tmp = strstr(ini, CFG_ENABLE_BLUR);
     if (tmp)
     {
@@ -419,6 +827,17 @@ void Config_Load(void)
         GB_EnableBlur(EmulatorConfig.enableblur);
     }
 
+    tmp = strstr(ini, CFG_BLUR_STRENGTH);
+    if (tmp)
+    {
+        tmp += strlen(CFG_BLUR_STRENGTH) + 1;
+        EmulatorConfig.blurstrength = atoi(tmp);
+        if (EmulatorConfig.blurstrength > 100)
+            EmulatorConfig.blurstrength = 100;
+        else if (EmulatorConfig.blurstrength < 0)
+            EmulatorConfig.blurstrength = 0;
+    }
+
     tmp = strstr(ini, CFG_REAL_GB_COLORS);
     if (tmp)
     {
@@ -481,6 +900,47 @@ void Config_Load(void)
         }
     }
 
+    // GAMEBOY ADVANCE
+    tmp = strstr(ini, CFG_GBA_LINK_CABLE);
+    if (tmp)
+    {
+        tmp += strlen(CFG_GBA_LINK_CABLE) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.gba_link_cable = 1;
+        else
+            EmulatorConfig.gba_link_cable = 0;
+    }
+
+    tmp = strstr(ini, CFG_GBA_HLE_IRQ);
+    if (tmp)
+    {
+        tmp += strlen(CFG_GBA_HLE_IRQ) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.gba_hle_irq = 1;
+        else
+            EmulatorConfig.gba_hle_irq = 0;
+    }
+
+    tmp = strstr(ini, CFG_GBA_HUGE_PAGES);
+    if (tmp)
+    {
+        tmp += strlen(CFG_GBA_HUGE_PAGES) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.gba_huge_pages = 1;
+        else
+            EmulatorConfig.gba_huge_pages = 0;
+    }
+
+    tmp = strstr(ini, CFG_GBA_SAVE_MMAP);
+    if (tmp)
+    {
+        tmp += strlen(CFG_GBA_SAVE_MMAP) + 1;
+        if (strncmp(tmp, "true", strlen("true")) == 0)
+            EmulatorConfig.gba_save_mmap = 1;
+        else
+            EmulatorConfig.gba_save_mmap = 0;
+    }
+
     for (int player = 0; player < 4; player++)
     {
         int player_enabled = 0;
@@ -13,9 +13,24 @@ typedef struct
     int screen_size;
     // GBA always tries to load the BIOS, this only skips the initial logo
     int load_from_boot_rom;
+    int boot_state_cache; // 1 = resets skip the boot ROM after the first boot
     int frameskip; // -1 = auto, 0-9 = fixed frameskip
+    int rewind_seconds; // Length of the rewind buffer, 0 = disabled
+    int run_ahead_frames; // Frames emulated ahead of the displayed one
+    int input_late_latch; // 1 = read the keys when the game reads them
+    int input_latency_report; // 1 = write the input latency to the log
+    int autosave_seconds; // Battery save write interval, 0 = only on unload
+    int checkpoint_seconds; // Crash recovery state interval, 0 = disabled
+    int frame_pacing; // _framepace_mode_e, used if audio sync is disabled
+    int speedup_speed; // Frames emulated per frame during speedup, 0 = max
+    int emulation_thread; // 1 = emulate in a thread separate from the GUI
+    int png_compression; // zlib level of screenshots, 0 (none) - 9 (best)
+    int video_record_format; // _videorecord_format_e
+    char shared_output[256]; // Shared memory output file, empty = disabled
+    int stream_port; // TCP port of the stream for remote players, 0 = disabled
     int oglfilter;
     int auto_close_debugger;
+    int profile_overlay; // 1 = show the time spent in each subsystem
     unsigned int webcam_select; // 0 = CV_CAP_ANY
 
     // Sound
@@ -23,21 +38,39 @@ typedef struct
     int volume;
     int chn_flags;
     int snd_mute;
+    int snd_sample_rate; // Requested output rate in Hz
+    int snd_buffer_samples; // Samples per output buffer, power of two
+    int snd_queue_mode; // 0 = SDL pulls samples, 1 = pushed with SDL_QueueAudio
+    int snd_sync; // 1 = pace the emulation with the audio output
+    int snd_record_format; // 0 = WAV, 1 = FLAC
 
     // GameBoy
     //-------
     int hardware_type;
     int serial_device;
+    char link_address[256]; // Empty = wait for the other emulator to connect
+    int link_port;
+    int link_lockstep; // 1 = wait for the other emulator in each transfer
     int enableblur;
+    int blurstrength; // 0 - 100, percentage of the previous frame on screen
     int realcolors;
     unsigned int gbcam_exposure_reference;
 
     // The GB palette is not stored here, it is stored in gb_main.c
 
+    // GameBoy Advance
+    //---------------
+    int gba_link_cable; // 1 = link the serial port, with the GB link settings
+    int gba_hle_irq;    // 1 = skip the IRQ code of the emulated BIOS
+    int gba_huge_pages; // 1 = try to keep the ROM in 2 MiB pages
+    int gba_save_mmap;  // 1 = write the battery save straight to its file
+
     // The input configuration is in input_utils.c
 
 } t_config;
 
+// Defined with the default values in config_data.c, which is part of the core
+// library. Config_Save() and Config_Load() belong to the frontend.
 extern t_config EmulatorConfig;
 
 void Config_Save(void);
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include "config.h"
+
+#include "gb_core/gameboy.h"
+
+// Default values...
+t_config EmulatorConfig = {
+    0, // debug_msg_enable
+    2, // screen_size
+    0, // load_from_boot_rom
+    0, // boot_state_cache
+    0, // frameskip
+    10, // rewind_seconds
+    0, // run_ahead_frames
+    0, // input_late_latch
+    0, // input_latency_report
+    5, // autosave_seconds
+    0, // checkpoint_seconds
+    0, // frame_pacing
+    0, // speedup_speed
+    0, // emulation_thread
+    6, // png_compression
+    0, // video_record_format
+    "", // shared_output
+    0, // stream_port
+    0, // oglfilter
+    0, // auto_close_debugger
+    0, // profile_overlay
+    0, // webcam_select
+    //---------
+    64,   // volume
+    0x3F, // chn_flags
+    0,    // snd_mute
+    48000, // snd_sample_rate
+    512,  // snd_buffer_samples
+    0,    // snd_queue_mode
+    0,    // snd_sync
+    0,    // snd_record_format
+    //---------
+    -1,               // hardware_type
+    SERIAL_GBPRINTER, // serial_device
+    "",               // link_address
+    8765,             // link_port
+    1,                // link_lockstep
+    0,                // enableblur
+    50,               // blurstrength
+    0,                // realcolors
+    0x0200,           // gbcam_exposure_reference
+    //---------
+    0, // gba_link_cable
+    1, // gba_hle_irq
+    0, // gba_huge_pages
+    0, // gba_save_mmap
+
+    // The GB palette is not stored here, it is stored in gb_main.c
+    // The input config not here, either... it's in input_utils.c
+};
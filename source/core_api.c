@@ -0,0 +1,672 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ENABLE_THREAD_LOCAL_CORES
+# include <SDL.h>
+#endif
+
+#include "core_api.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "resample_utils.h"
+#include "savestate_utils.h"
+
+#include "gb_core/cheats.h"
+#include "gb_core/gameboy.h"
+#include "gb_core/gb_main.h"
+#include "gb_core/general.h"
+#include "gb_core/sound.h"
+#include "gb_core/video.h"
+#include "gba_core/bios.h"
+#include "gba_core/cheats.h"
+#include "gba_core/gba.h"
+#include "gba_core/memory.h"
+#include "gba_core/save.h"
+#include "gba_core/sound.h"
+#include "gba_core/video.h"
+
+#define CORE_BIOS_SIZE          (16 * 1024)
+
+// Emulated time after which Core_PoolLoad() stops waiting for the boot
+#define CORE_BOOT_MAX_FRAMES    (10 * 60)
+
+// A frame generates around 370 stereo frames in both systems
+#define CORE_AUDIO_MAX_FRAMES   (4096)
+
+static core_local__ _core_system_e core_system = CORE_SYSTEM_NONE;
+
+static core_local__ s16 core_audio_buffer[CORE_AUDIO_MAX_FRAMES * 2];
+static core_local__ u32 core_audio_frames;
+
+static core_local__ _savestate_t core_state;
+
+// ROM file loaded by Core_LoadFile(), only used by GBA ROMs
+static core_local__ _file_map_t core_rom_map;
+
+extern core_local__ _GB_CONTEXT_ GameBoy;
+
+_core_system_e Core_SystemFromPath(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL)
+        return CORE_SYSTEM_NONE;
+
+    char extension[4];
+    int len = strlen(dot + 1);
+    if (len > 3)
+        return CORE_SYSTEM_NONE;
+
+    for (int i = 0; i <= len; i++)
+        extension[i] = toupper(dot[1 + i]);
+
+    if ((strcmp(extension, "GBA") == 0) || (strcmp(extension, "AGB") == 0)
+        || (strcmp(extension, "BIN") == 0))
+    {
+        return CORE_SYSTEM_GBA;
+    }
+
+    if ((strcmp(extension, "GB") == 0) || (strcmp(extension, "GBC") == 0)
+        || (strcmp(extension, "CGB") == 0) || (strcmp(extension, "SGB") == 0))
+    {
+        return CORE_SYSTEM_GB;
+    }
+
+    return CORE_SYSTEM_NONE;
+}
+
+// The cores write the samples to a resampler stream that is meant to be read
+// by an audio callback at the rate of the output device. The tap receives them
+// before they are resampled, so they are collected here instead.
+static void core_audio_tap(const s16 *samples, u32 frames, unused__ u32 rate)
+{
+    if (frames > CORE_AUDIO_MAX_FRAMES - core_audio_frames)
+        frames = CORE_AUDIO_MAX_FRAMES - core_audio_frames;
+
+    memcpy(&core_audio_buffer[core_audio_frames * 2], samples,
+           frames * 2 * sizeof(s16));
+    core_audio_frames += frames;
+}
+
+static int core_load_gba(const char *path, void *rom, size_t rom_size,
+                         const void *bios, size_t bios_size, int in_place)
+{
+    if ((bios != NULL) && (bios_size != CORE_BIOS_SIZE))
+    {
+        Debug_ErrorMsgArg("%s: The BIOS must be %d bytes long", __func__,
+                          CORE_BIOS_SIZE);
+        return 1;
+    }
+
+    GBA_BiosLoaded(bios != NULL);
+    GBA_SaveSetFilename((char *)path);
+    if (in_place)
+        GBA_InitRomInPlace((void *)bios, rom, rom_size);
+    else
+        GBA_InitRom((void *)bios, rom, rom_size);
+
+    core_system = CORE_SYSTEM_GBA;
+
+    return 0;
+}
+
+int Core_Load(_core_system_e system, const char *path,
+              const void *rom, size_t rom_size,
+              const void *bios, size_t bios_size)
+{
+    Core_Unload(1);
+
+    if ((rom == NULL) || (rom_size == 0))
+        return 1;
+
+    Resample_SetTap(core_audio_tap);
+    core_audio_frames = 0;
+
+    if (system == CORE_SYSTEM_GB)
+    {
+        // The buffer is owned by the core after this
+        void *buffer = malloc(rom_size);
+        if (buffer == NULL)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+            return 1;
+        }
+        memcpy(buffer, rom, rom_size);
+
+        if (GB_ROMLoadBuffer(path, buffer, rom_size) == 0)
+            return 1;
+    }
+    else if (system == CORE_SYSTEM_GBA)
+    {
+        return core_load_gba(path, (void *)rom, rom_size, bios, bios_size, 0);
+    }
+    else
+    {
+        return 1;
+    }
+
+    core_system = system;
+
+    return 0;
+}
+
+int Core_LoadFile(const char *path, const void *bios, size_t bios_size)
+{
+    _core_system_e system = Core_SystemFromPath(path);
+    if (system == CORE_SYSTEM_NONE)
+    {
+        Debug_ErrorMsgArg("%s: Unknown type of ROM: %s", __func__, path);
+        return 1;
+    }
+
+    if (system == CORE_SYSTEM_GB)
+    {
+        // GB ROMs are small and the core needs a copy it can own
+        _file_map_t map;
+        if (FileMap(path, GBA_ROM_BUFFER_SIZE, &map) != 0)
+            return 1;
+
+        int ret = Core_Load(system, path, map.data, map.size, bios, bios_size);
+        FileUnmap(&map);
+        return ret;
+    }
+
+    Core_Unload(1);
+
+    Resample_SetTap(core_audio_tap);
+    core_audio_frames = 0;
+
+    if (FileMap(path, GBA_ROM_BUFFER_SIZE, &core_rom_map) != 0)
+        return 1;
+
+    if (core_load_gba(path, core_rom_map.data, core_rom_map.size,
+                      bios, bios_size, 1) != 0)
+    {
+        FileUnmap(&core_rom_map);
+        return 1;
+    }
+
+    return 0;
+}
+
+void Core_Unload(int save)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        GB_End(save);
+    else if (core_system == CORE_SYSTEM_GBA)
+        GBA_EndRom(save);
+
+    // The core doesn't use the ROM after this
+    FileUnmap(&core_rom_map);
+
+    SaveState_Free(&core_state);
+
+    core_system = CORE_SYSTEM_NONE;
+}
+
+_core_system_e Core_GetSystem(void)
+{
+    return core_system;
+}
+
+void Core_Reset(void)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        GB_HardReset();
+    else if (core_system == CORE_SYSTEM_GBA)
+        GBA_Reset();
+}
+
+void Core_SetInput(u32 keys)
+{
+    int a = (keys & CORE_KEY_A) != 0;
+    int b = (keys & CORE_KEY_B) != 0;
+    int select = (keys & CORE_KEY_SELECT) != 0;
+    int start = (keys & CORE_KEY_START) != 0;
+    int right = (keys & CORE_KEY_RIGHT) != 0;
+    int left = (keys & CORE_KEY_LEFT) != 0;
+    int up = (keys & CORE_KEY_UP) != 0;
+    int down = (keys & CORE_KEY_DOWN) != 0;
+
+    if (core_system == CORE_SYSTEM_GB)
+    {
+        GB_InputSet(0, a, b, start, select, right, left, up, down);
+    }
+    else if (core_system == CORE_SYSTEM_GBA)
+    {
+        int r = (keys & CORE_KEY_R) != 0;
+        int l = (keys & CORE_KEY_L) != 0;
+
+        GBA_HandleInput(a, b, l, r, start, select, right, left, up, down);
+    }
+}
+
+void Core_RunFrame(void)
+{
+    core_audio_frames = 0;
+
+    if (core_system == CORE_SYSTEM_GB)
+        GB_RunForOneFrame();
+    else if (core_system == CORE_SYSTEM_GBA)
+        GBA_RunForOneFrame();
+}
+
+void Core_RunFrames(const u32 *keys, u32 frames, u32 flags)
+{
+    int no_video = (flags & CORE_RUN_NO_VIDEO) != 0;
+    int no_audio = (flags & CORE_RUN_NO_AUDIO) != 0;
+
+    if (core_system == CORE_SYSTEM_GB)
+        GB_SoundSetOutputSuspended(no_audio);
+    else if (core_system == CORE_SYSTEM_GBA)
+        GBA_SoundSetOutputSuspended(no_audio);
+
+    for (u32 i = 0; i < frames; i++)
+    {
+        int skip = no_video || (i < (frames - 1));
+
+        if (core_system == CORE_SYSTEM_GB)
+            GB_SkipFrame(skip);
+        else if (core_system == CORE_SYSTEM_GBA)
+            GBA_SkipFrame(skip);
+
+        if (keys != NULL)
+            Core_SetInput(keys[i]);
+
+        Core_RunFrame();
+    }
+
+    if (core_system == CORE_SYSTEM_GB)
+    {
+        GB_SkipFrame(0);
+        GB_SoundSetOutputSuspended(0);
+    }
+    else if (core_system == CORE_SYSTEM_GBA)
+    {
+        GBA_SkipFrame(0);
+        GBA_SoundSetOutputSuspended(0);
+    }
+}
+
+void Core_GetScreenSize(int *width, int *height)
+{
+    if (core_system == CORE_SYSTEM_GB)
+    {
+        GB_ScreenGetSize(width, height);
+    }
+    else
+    {
+        *width = 240;
+        *height = 160;
+    }
+}
+
+void Core_GetScreen(u32 *buffer)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        GB_Screen_WriteBuffer_32ARGB(buffer);
+    else if (core_system == CORE_SYSTEM_GBA)
+        GBA_ConvertScreenBufferTo32ARGB(buffer);
+}
+
+const s16 *Core_GetAudio(u32 *frames)
+{
+    *frames = core_audio_frames;
+    return core_audio_buffer;
+}
+
+u32 Core_GetAudioRate(void)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        return GB_SoundGetSampleRate();
+
+    return GBA_SoundGetSampleRate();
+}
+
+u32 Core_GetScreenHash(void)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        return GB_ScreenGetHash();
+    else if (core_system == CORE_SYSTEM_GBA)
+        return GBA_ScreenBufferGetHash();
+
+    return 0;
+}
+
+u32 Core_GetAudioHash(void)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        return GB_SoundGetFrameHash();
+    else if (core_system == CORE_SYSTEM_GBA)
+        return GBA_SoundGetFrameHash();
+
+    return 0;
+}
+
+void Core_CheatsReset(void)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        GB_CheatsReset();
+    else if (core_system == CORE_SYSTEM_GBA)
+        GBA_CheatsReset();
+}
+
+int Core_CheatAdd(const char *code)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        return GB_CheatAdd(code);
+    else if (core_system == CORE_SYSTEM_GBA)
+        return GBA_CheatAdd(code);
+
+    return 1;
+}
+
+void *Core_GetMemory(_core_memory_e region, size_t *size)
+{
+    if (core_system == CORE_SYSTEM_GB)
+    {
+        _GB_MEMORY_ *mem = &GameBoy.Memory;
+        int gbc = GameBoy.Emulator.CGBEnabled;
+
+        // The banks of WRAM are right after the first one
+        if (region == CORE_MEMORY_WRAM)
+        {
+            *size = gbc ? 8 * 0x1000 : 2 * 0x1000;
+            return mem->WorkRAM;
+        }
+        else if (region == CORE_MEMORY_IWRAM)
+        {
+            *size = sizeof(mem->HighRAM);
+            return mem->HighRAM;
+        }
+        else if (region == CORE_MEMORY_VRAM)
+        {
+            *size = gbc ? 0x4000 : 0x2000;
+            return mem->VideoRAM;
+        }
+    }
+    else if (core_system == CORE_SYSTEM_GBA)
+    {
+        if (region == CORE_MEMORY_WRAM)
+        {
+            *size = sizeof(Mem.ewram);
+            return Mem.ewram;
+        }
+        else if (region == CORE_MEMORY_IWRAM)
+        {
+            *size = sizeof(Mem.iwram);
+            return Mem.iwram;
+        }
+        else if (region == CORE_MEMORY_VRAM)
+        {
+            *size = 96 * 1024;
+            return Mem.vram;
+        }
+    }
+
+    *size = 0;
+    return NULL;
+}
+
+static int core_state_save(_savestate_t *st)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        return GB_StateSave(st);
+    else if (core_system == CORE_SYSTEM_GBA)
+        return GBA_StateSave(st);
+
+    return 1;
+}
+
+size_t Core_StateSize(void)
+{
+    if (core_state_save(&core_state) != 0)
+        return 0;
+
+    return core_state.size;
+}
+
+int Core_StateSave(void *data, size_t size)
+{
+    if (core_state_save(&core_state) != 0)
+        return 1;
+
+    if (core_state.size > size)
+        return 1;
+
+    memcpy(data, core_state.data, core_state.size);
+    return 0;
+}
+
+int Core_StateLoad(const void *data, size_t size)
+{
+    SaveState_SetData(&core_state, data, size);
+    if (core_state.error)
+        return 1;
+
+    if (core_system == CORE_SYSTEM_GB)
+        return GB_StateLoad(&core_state);
+    else if (core_system == CORE_SYSTEM_GBA)
+        return GBA_StateLoad(&core_state);
+
+    return 1;
+}
+
+#ifdef ENABLE_THREAD_LOCAL_CORES
+
+typedef struct
+{
+    _core_pool_t *pool;
+    u32 index;
+    SDL_Thread *thread;
+    SDL_sem *start; // Posted when there is a new job for this thread
+} _core_pool_thread_t;
+
+struct _core_pool_t
+{
+    u32 count;
+    _core_pool_thread_t *threads;
+    SDL_sem *done; // Posted by each thread when it finishes a job
+
+    // Current job, a NULL function makes the threads exit
+    core_pool_fn_ptr fn;
+    void *arg;
+};
+
+static int core_pool_thread_fn(void *data)
+{
+    _core_pool_thread_t *thread = data;
+    _core_pool_t *pool = thread->pool;
+
+    while (1)
+    {
+        SDL_SemWait(thread->start);
+
+        if (pool->fn == NULL)
+            break;
+
+        pool->fn(thread->index, pool->arg);
+
+        SDL_SemPost(pool->done);
+    }
+
+    Core_Unload(1);
+
+    return 0;
+}
+
+_core_pool_t *Core_PoolCreate(u32 count)
+{
+    _core_pool_t *pool = calloc(1, sizeof(_core_pool_t));
+    if (pool == NULL)
+        return NULL;
+
+    pool->threads = calloc(count, sizeof(_core_pool_thread_t));
+    pool->done = SDL_CreateSemaphore(0);
+    if ((pool->threads == NULL) || (pool->done == NULL))
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+        Core_PoolDestroy(pool);
+        return NULL;
+    }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        _core_pool_thread_t *thread = &pool->threads[i];
+
+        thread->pool = pool;
+        thread->index = i;
+        thread->start = SDL_CreateSemaphore(0);
+        if (thread->start == NULL)
+            break;
+
+        thread->thread = SDL_CreateThread(core_pool_thread_fn, "Core pool",
+                                          thread);
+        if (thread->thread == NULL)
+        {
+            SDL_DestroySemaphore(thread->start);
+            thread->start = NULL;
+            break;
+        }
+
+        pool->count++;
+    }
+
+    if (pool->count != count)
+    {
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        Core_PoolDestroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void Core_PoolDestroy(_core_pool_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pool->fn = NULL;
+
+    for (u32 i = 0; i < pool->count; i++)
+        SDL_SemPost(pool->threads[i].start);
+
+    for (u32 i = 0; i < pool->count; i++)
+    {
+        SDL_WaitThread(pool->threads[i].thread, NULL);
+        SDL_DestroySemaphore(pool->threads[i].start);
+    }
+
+    if (pool->done != NULL)
+        SDL_DestroySemaphore(pool->done);
+
+    free(pool->threads);
+    free(pool);
+}
+
+void Core_PoolRunOne(_core_pool_t *pool, u32 index, core_pool_fn_ptr fn,
+                     void *arg)
+{
+    if ((fn == NULL) || (index >= pool->count))
+        return;
+
+    pool->fn = fn;
+    pool->arg = arg;
+
+    // The other threads keep waiting, they don't look at the job
+    SDL_SemPost(pool->threads[index].start);
+    SDL_SemWait(pool->done);
+}
+
+void Core_PoolRun(_core_pool_t *pool, core_pool_fn_ptr fn, void *arg)
+{
+    if (fn == NULL)
+        return;
+
+    pool->fn = fn;
+    pool->arg = arg;
+
+    // The semaphores make the writes above visible to the threads
+    for (u32 i = 0; i < pool->count; i++)
+        SDL_SemPost(pool->threads[i].start);
+
+    for (u32 i = 0; i < pool->count; i++)
+        SDL_SemWait(pool->done);
+}
+
+typedef struct
+{
+    const u32 *keys;
+    u32 frames;
+    u32 flags;
+} _core_pool_frames_t;
+
+static void core_pool_run_frames_fn(u32 index, void *arg)
+{
+    _core_pool_frames_t *job = arg;
+
+    const u32 *keys = NULL;
+    if (job->keys != NULL)
+        keys = &job->keys[index * job->frames];
+
+    Core_RunFrames(keys, job->frames, job->flags);
+}
+
+void Core_PoolRunFrames(_core_pool_t *pool, const u32 *keys, u32 frames,
+                        u32 flags)
+{
+    _core_pool_frames_t job = { keys, frames, flags };
+
+    Core_PoolRun(pool, core_pool_run_frames_fn, &job);
+}
+
+typedef struct
+{
+    const char *path;
+    const void *bios;
+    size_t bios_size;
+    int ret;
+} _core_pool_load_t;
+
+// Same checks that the cores use to save their boot state
+static int core_is_booting(void)
+{
+    if (core_system == CORE_SYSTEM_GB)
+        return GameBoy.Emulator.enable_boot_rom != 0;
+    else if (core_system == CORE_SYSTEM_GBA)
+        return GBA_BiosIsLoaded() && (GBA_CPUGet()->R[R_PC] < 0x02000000);
+
+    return 0;
+}
+
+static void core_pool_load_fn(unused__ u32 index, void *arg)
+{
+    _core_pool_load_t *job = arg;
+
+    job->ret = Core_LoadFile(job->path, job->bios, job->bios_size);
+    if (job->ret != 0)
+        return;
+
+    for (u32 i = 0; (i < CORE_BOOT_MAX_FRAMES) && core_is_booting(); i++)
+        Core_RunFrames(NULL, 1, CORE_RUN_NO_VIDEO | CORE_RUN_NO_AUDIO);
+}
+
+int Core_PoolLoad(_core_pool_t *pool, u32 index, const char *path,
+                  const void *bios, size_t bios_size)
+{
+    _core_pool_load_t job = { path, bios, bios_size, 1 };
+
+    Core_PoolRunOne(pool, index, core_pool_load_fn, &job);
+
+    return job.ret;
+}
+
+#endif // ENABLE_THREAD_LOCAL_CORES
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef CORE_API__
+#define CORE_API__
+
+#include <stddef.h>
+
+#include "general_utils.h"
+
+// Minimal interface of the core library, meant to embed the emulator in other
+// programs. It doesn't create windows or open audio devices, the host is the
+// one that presents the video and audio of each frame. One console is emulated
+// at a time, or one per thread if the cores are built with
+// ENABLE_THREAD_LOCAL_CORES.
+//
+// The messages of the cores are printed to the standard error output unless a
+// handler is set with Debug_SetMessageHandler(). The configuration is the one
+// in EmulatorConfig, the host can change it before loading a ROM.
+
+typedef enum
+{
+    CORE_SYSTEM_NONE,
+    CORE_SYSTEM_GB, // GB, GBC and SGB
+    CORE_SYSTEM_GBA,
+} _core_system_e;
+
+// Returns the system of a ROM from the extension of its path
+_core_system_e Core_SystemFromPath(const char *path);
+
+// Loads a ROM from memory, it's copied by the core. The path is only used to
+// name the save files, which are written next to it. The GBA BIOS is optional,
+// it has to be 16 KiB long if it isn't NULL. Returns 0 on success.
+int Core_Load(_core_system_e system, const char *path,
+              const void *rom, size_t rom_size,
+              const void *bios, size_t bios_size);
+// Same as Core_Load(), but the ROM is loaded from a file and the system is
+// detected from its extension. GBA ROMs aren't copied, the file stays mapped
+// in memory until the ROM is unloaded. Only the pages that are used are read,
+// and they are shared by all the consoles that load the same file.
+int Core_LoadFile(const char *path, const void *bios, size_t bios_size);
+// Writes the battery save data if save is set
+void Core_Unload(int save);
+_core_system_e Core_GetSystem(void);
+void Core_Reset(void);
+
+// Same bits as the KEYINPUT register of the GBA. L and R are ignored in GB.
+#define CORE_KEY_A          BIT(0)
+#define CORE_KEY_B          BIT(1)
+#define CORE_KEY_SELECT     BIT(2)
+#define CORE_KEY_START      BIT(3)
+#define CORE_KEY_RIGHT      BIT(4)
+#define CORE_KEY_LEFT       BIT(5)
+#define CORE_KEY_UP         BIT(6)
+#define CORE_KEY_DOWN       BIT(7)
+#define CORE_KEY_R          BIT(8)
+#define CORE_KEY_L          BIT(9)
+
+// Pressed keys, used from the next frame on
+void Core_SetInput(u32 keys);
+
+void Core_RunFrame(void);
+
+// Flags of Core_RunFrames()
+#define CORE_RUN_NO_VIDEO   BIT(0) // Don't draw any frame
+#define CORE_RUN_NO_AUDIO   BIT(1) // Don't generate any sample
+
+// Emulates a number of frames in one call, with the keys of each frame taken
+// from the array (if it is NULL the keys of Core_SetInput() are used). Only the
+// last frame is drawn, so Core_GetScreen() returns it afterwards unless it is
+// skipped too. Core_GetAudio() returns the samples of the last frame.
+void Core_RunFrames(const u32 *keys, u32 frames, u32 flags);
+
+// The size of the screen depends on the system, it's 256x224 at most (SGB).
+#define CORE_SCREEN_MAX_WIDTH   (256)
+#define CORE_SCREEN_MAX_HEIGHT  (224)
+
+void Core_GetScreenSize(int *width, int *height);
+// Writes the last frame as ARGB8888 pixels, 0xAARRGGBB in native endianness,
+// without padding between rows.
+void Core_GetScreen(u32 *buffer);
+
+// Returns the stereo frames (left and right samples interleaved) generated
+// during the last call to Core_RunFrame(), at the rate of the emulated system.
+// They are valid until the next call to Core_RunFrame().
+const s16 *Core_GetAudio(u32 *frames);
+// Returns the sample rate of the emulated system in Hz
+u32 Core_GetAudioRate(void);
+
+// CRC32C of the native framebuffer of the last frame that was drawn, and of the
+// samples generated during the last call to Core_RunFrame(). They are updated
+// while the frame is emulated, so they are free to read, and they are meant to
+// compare frames without converting them. Note that they aren't hashes of the
+// output of Core_GetScreen() and Core_GetAudio().
+u32 Core_GetScreenHash(void);
+u32 Core_GetAudioHash(void);
+
+typedef enum
+{
+    CORE_MEMORY_WRAM,  // GB: C000-DFFF (all banks in GBC), GBA: EWRAM
+    CORE_MEMORY_IWRAM, // GB: HRAM, GBA: IWRAM
+    CORE_MEMORY_VRAM,
+} _core_memory_e;
+
+// Returns a pointer to the memory of the emulated console, or NULL if no ROM is
+// loaded. It can be read at any time between frames, and it's valid until the
+// ROM is unloaded. The size in bytes is written to size.
+void *Core_GetMemory(_core_memory_e region, size_t *size);
+
+// Cheat codes of the loaded ROM, see gb_core/cheats.h and gba_core/cheats.h for
+// the formats. They are kept until Core_CheatsReset() is called or the ROM is
+// unloaded. Core_CheatAdd() returns 0 on success, 1 if the code isn't valid.
+void Core_CheatsReset(void);
+int Core_CheatAdd(const char *code);
+
+// Save states are the same as the ones saved by the frontend. Core_StateSize()
+// returns the size of a state saved right now, or 0 on error. The others
+// return 0 on success.
+size_t Core_StateSize(void);
+int Core_StateSave(void *data, size_t size);
+int Core_StateLoad(const void *data, size_t size);
+
+#ifdef ENABLE_THREAD_LOCAL_CORES
+
+// Pool of threads that emulate one console each. The state of the cores lives
+// in the thread that uses them, so each console stays in its own thread, and
+// everything related to it has to be done from there with Core_PoolRun().
+typedef struct _core_pool_t _core_pool_t;
+
+typedef void (*core_pool_fn_ptr)(u32 index, void *arg);
+
+// Returns NULL on error
+_core_pool_t *Core_PoolCreate(u32 count);
+// The ROMs that are loaded are unloaded, and their battery saves written
+void Core_PoolDestroy(_core_pool_t *pool);
+
+// Calls fn in all the threads with the index of their console, and waits until
+// all of them have returned. ThreadPinToCPU() can be used from fn to keep each
+// console in a CPU.
+void Core_PoolRun(_core_pool_t *pool, core_pool_fn_ptr fn, void *arg);
+// Same as Core_PoolRun(), but fn is only called in the thread of one console.
+// The rest of them are left as they are.
+void Core_PoolRunOne(_core_pool_t *pool, u32 index, core_pool_fn_ptr fn,
+                     void *arg);
+// Core_RunFrames() in all the consoles. The keys of the console with index i
+// start at keys[i * frames], it can be NULL like in Core_RunFrames().
+void Core_PoolRunFrames(_core_pool_t *pool, const u32 *keys, u32 frames,
+                        u32 flags);
+
+// A pool can also keep a set of ROMs loaded and booted, one per console, so
+// that a host can switch between them without any loading: it only has to
+// run the frames of a different console with Core_PoolRunOne(). The consoles
+// that aren't run stay paused where they were left.
+//
+// Core_PoolLoad() loads a ROM file in one console with Core_LoadFile(), then
+// emulates it without video or audio until the boot ROM or the BIOS has passed
+// control to the game. If EmulatorConfig.boot_state_cache is set, the cores
+// save their state at that point, so Core_Reset() doesn't boot again either.
+// The ROM that was loaded in that console before is unloaded. It returns 0 on
+// success.
+int Core_PoolLoad(_core_pool_t *pool, u32 index, const char *path,
+                  const void *bios, size_t bios_size);
+
+#endif // ENABLE_THREAD_LOCAL_CORES
+
+#endif // CORE_API__
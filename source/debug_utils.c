@@ -10,22 +10,292 @@
 #include <string.h>
 
 #include <SDL.h>
-#include <SDL_opengl.h>
 
 #include "build_options.h"
 #include "config.h"
+#include "debug_utils.h"
 #include "file_utils.h"
 #include "general_utils.h"
 
-#include "gui/win_main.h"
-
 //------------------------------------------------------------------------------
 
+// Longer messages are truncated
+#define LOG_MESSAGE_SIZE        (1024)
+
+// Must be a power of two
+#define LOG_QUEUE_SLOTS         (128)
+
+// The writer thread wakes up at least this often (in ms)
+#define LOG_WAKEUP_PERIOD       (100)
+
+// Messages of each format string that a thread can log per period, the rest
+// are counted and reported when the format is used again after the period.
+#define LOG_RATE_PERIOD_MS      (1000)
+#define LOG_RATE_MESSAGES       (10)
+#define LOG_RATE_SLOTS          (64) // Must be a power of two
+
+// The file stops growing when it reaches this size
+#define LOG_FILE_MAX_SIZE       (16 * 1024 * 1024)
+
+// Bounded queue with many writers and one reader. The sequence number of each
+// slot says if it's free for the writer that has claimed the position "seq",
+// or if it holds the message of position "seq - 1" that the reader expects.
+typedef struct
+{
+    u32 seq;
+    char text[LOG_MESSAGE_SIZE];
+} _log_slot_t;
+
+static _log_slot_t log_queue[LOG_QUEUE_SLOTS];
+static u32 log_queue_write; // Next position to claim, free running
+static u32 log_queue_read;  // Only used by the writer thread
+static u32 log_queue_lost;  // Messages dropped because the queue was full
+
+static SDL_atomic_t log_exit;
+static SDL_sem *log_sem;
+static SDL_Thread *log_thread;
+
 static FILE *f_log;
 static int log_file_opened = 0;
+static size_t log_file_size;
+
+typedef struct
+{
+    const char *format;
+    u32 period;
+    u32 count;
+    u32 suppressed;
+} _log_rate_t;
+
+// Each thread has its own table, so it doesn't need any lock
+static _Thread_local _log_rate_t log_rate[LOG_RATE_SLOTS];
+
+// Without a handler, messages are printed to the standard error output
+static Debug_MessageHandlerPointer *debug_message_handler = NULL;
+
+void Debug_SetMessageHandler(Debug_MessageHandlerPointer *fn)
+{
+    debug_message_handler = fn;
+}
+
+static void Debug_ShowMessage(int type, const char *msg)
+{
+    if (debug_message_handler == NULL)
+    {
+        static const char *names[] = { "Error", "Debug", "Console" };
+        fprintf(stderr, "%s: %s\n", names[type], msg);
+        return;
+    }
+
+    debug_message_handler(type, msg);
+}
+
+//------------------------------------------------------------------------------
+
+// Only called by the writer thread, or by the thread that logs the message if
+// there is no writer thread.
+static void debug_log_file_write(const char *text)
+{
+    if (log_file_opened == 0)
+    {
+        char logpath[MAX_PATHLEN];
+        snprintf(logpath, sizeof(logpath), "%slog.txt", DirGetRunningPath());
+        f_log = fopen(logpath, "w");
+        if (f_log == NULL)
+            return;
+
+        log_file_opened = 1;
+        log_file_size = 0;
+    }
+
+    if (log_file_size >= LOG_FILE_MAX_SIZE)
+        return;
+
+    size_t size = strlen(text) + 1;
+    log_file_size += size;
+
+    if (log_file_size >= LOG_FILE_MAX_SIZE)
+        text = "Log: The size limit of the file has been reached.";
+
+    fputs(text, f_log);
+    fputc('\n', f_log);
+}
+
+// Writes all the messages that are in the queue in order
+static void debug_log_flush(void)
+{
+    int written = 0;
+
+    u32 lost = __atomic_exchange_n(&log_queue_lost, 0, __ATOMIC_RELAXED);
+    if (lost > 0)
+    {
+        char text[100];
+        snprintf(text, sizeof(text),
+                 "Log: %u messages lost, the queue was full.", lost);
+        debug_log_file_write(text);
+        written = 1;
+    }
+
+    while (1)
+    {
+        _log_slot_t *slot = &log_queue[log_queue_read & (LOG_QUEUE_SLOTS - 1)];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)
+            != (log_queue_read + 1))
+            break;
+
+        debug_log_file_write(slot->text);
+        written = 1;
+
+        __atomic_store_n(&slot->seq, log_queue_read + LOG_QUEUE_SLOTS,
+                         __ATOMIC_RELEASE);
+        log_queue_read++;
+    }
+
+    if (written && log_file_opened)
+        fflush(f_log);
+}
+
+static int debug_log_thread_fn(unused__ void *data)
+{
+    while (1)
+    {
+        SDL_SemWaitTimeout(log_sem, LOG_WAKEUP_PERIOD);
+
+        int exit = SDL_AtomicGet(&log_exit);
+
+        debug_log_flush();
+
+        if (exit)
+            break;
+    }
+
+    return 0;
+}
+
+// Returns the slot reserved for the message, or NULL if the queue is full. The
+// message is published with debug_log_queue_commit().
+static _log_slot_t *debug_log_queue_claim(u32 *position)
+{
+    u32 pos = __atomic_load_n(&log_queue_write, __ATOMIC_RELAXED);
+
+    while (1)
+    {
+        _log_slot_t *slot = &log_queue[pos & (LOG_QUEUE_SLOTS - 1)];
+        s32 diff = (s32)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0)
+        {
+            // If it fails, pos is updated with the current value
+            if (__atomic_compare_exchange_n(&log_queue_write, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+            {
+                *position = pos;
+                return slot;
+            }
+        }
+        else if (diff < 0)
+        {
+            __atomic_add_fetch(&log_queue_lost, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&log_queue_write, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void debug_log_queue_commit(_log_slot_t *slot, u32 position)
+{
+    __atomic_store_n(&slot->seq, position + 1, __ATOMIC_RELEASE);
+    SDL_SemPost(log_sem);
+}
+
+static void debug_log_printf(const char *category, const char *prefix,
+                             const char *msg, ...);
+
+// The format string is the category of the message. Returns 1 if the message
+// has to be dropped.
+static int debug_log_rate_limit(const char *format)
+{
+    u32 period = SDL_GetTicks() / LOG_RATE_PERIOD_MS;
+    uintptr_t hash = ((uintptr_t)format >> 3) ^ ((uintptr_t)format >> 9);
+    _log_rate_t *rate = &log_rate[hash & (LOG_RATE_SLOTS - 1)];
+
+    if ((rate->format != format) || (rate->period != period))
+    {
+        if ((rate->format == format) && (rate->suppressed > 0))
+        {
+            debug_log_printf(NULL, "Log: ", "%u messages suppressed: %s",
+                             rate->suppressed, format);
+        }
+
+        rate->format = format;
+        rate->period = period;
+        rate->count = 0;
+        rate->suppressed = 0;
+    }
+
+    if (rate->count >= LOG_RATE_MESSAGES)
+    {
+        rate->suppressed++;
+        return 1;
+    }
+
+    rate->count++;
+    return 0;
+}
+
+// Messages without category aren't limited
+static void debug_log_vprintf(const char *category, const char *prefix,
+                              const char *msg, va_list args)
+{
+    if ((category != NULL) && debug_log_rate_limit(category))
+        return;
+
+    if (log_thread == NULL)
+    {
+        char text[LOG_MESSAGE_SIZE];
+        size_t len = snprintf(text, sizeof(text), "%s", prefix);
+        vsnprintf(&text[len], sizeof(text) - len, msg, args);
+        debug_log_file_write(text);
+        return;
+    }
+
+    u32 position;
+    _log_slot_t *slot = debug_log_queue_claim(&position);
+    if (slot == NULL)
+        return;
+
+    size_t len = snprintf(slot->text, sizeof(slot->text), "%s", prefix);
+    vsnprintf(&slot->text[len], sizeof(slot->text) - len, msg, args);
+
+    debug_log_queue_commit(slot, position);
+}
+
+static void debug_log_printf(const char *category, const char *prefix,
+                             const char *msg, ...)
+{
+    va_list args;
+    va_start(args, msg);
+    debug_log_vprintf(category, prefix, msg, args);
+    va_end(args);
+}
+
+//------------------------------------------------------------------------------
 
 void Debug_End(void)
 {
+    if (log_thread != NULL)
+    {
+        SDL_AtomicSet(&log_exit, 1);
+        SDL_SemPost(log_sem);
+        SDL_WaitThread(log_thread, NULL);
+        log_thread = NULL;
+    }
+
     if (log_file_opened)
         fclose(f_log);
 
@@ -42,31 +312,36 @@ void Debug_Init(void)
     snprintf(logpath, sizeof(logpath), "%slog.txt", DirGetRunningPath());
     if (FileExists(logpath))
         remove(logpath);
+
+    for (u32 i = 0; i < LOG_QUEUE_SLOTS; i++)
+        log_queue[i].seq = i;
+    log_queue_write = 0;
+    log_queue_read = 0;
+    log_queue_lost = 0;
+
+    SDL_AtomicSet(&log_exit, 0);
+
+    if (log_sem == NULL)
+        log_sem = SDL_CreateSemaphore(0);
+
+    // If there is no thread, messages are written without it
+    if (log_sem != NULL)
+        log_thread = SDL_CreateThread(debug_log_thread_fn, "Log", NULL);
 }
 
-void Debug_LogMsgArg(const char *msg, ...)
+void (Debug_LogMsgArg)(const char *msg, ...)
 {
-    if (log_file_opened == 0)
-    {
-        char logpath[MAX_PATHLEN];
-        snprintf(logpath, sizeof(logpath), "%slog.txt", DirGetRunningPath());
-        f_log = fopen(logpath, "w");
-        if (f_log)
-            log_file_opened = 1;
-    }
-
-    if (log_file_opened)
-    {
-        va_list args;
-        va_start(args, msg);
-        vfprintf(f_log, msg, args);
-        va_end(args);
-        fputc('\n', f_log);
-    }
+    va_list args;
+    va_start(args, msg);
+    debug_log_vprintf(msg, "", msg, args);
+    va_end(args);
 }
 
 void Debug_DebugMsgArg(const char *msg, ...)
 {
+    if (EmulatorConfig.debug_msg_enable == 0)
+        return;
+
     char dest[2000];
 
     va_list args;
@@ -75,12 +350,13 @@ void Debug_DebugMsgArg(const char *msg, ...)
     va_end(args);
     dest[sizeof(dest) - 1] = '\0';
 
-    if (EmulatorConfig.debug_msg_enable == 0)
-        return;
+#if DEBUG_LOG_LEVEL >= DEBUG_LOG_LEVEL_DEBUG
+    debug_log_printf(msg, "Debug: ", "%s", dest);
+#endif
 
     //SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION,
     //                         "GiiBiiAdvance - Debug", dest, NULL);
-    Win_MainShowMessage(1, dest);
+    Debug_ShowMessage(DEBUG_MSG_DEBUG, dest);
 }
 
 void Debug_ErrorMsgArg(const char *msg, ...)
@@ -93,9 +369,13 @@ void Debug_ErrorMsgArg(const char *msg, ...)
     va_end(args);
     dest[sizeof(dest) - 1] = '\0';
 
+#if DEBUG_LOG_LEVEL >= DEBUG_LOG_LEVEL_ERROR
+    debug_log_printf(msg, "Error: ", "%s", dest);
+#endif
+
     //SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
     //                         "GiiBiiAdvance - Error", dest, NULL);
-    Win_MainShowMessage(0, dest);
+    Debug_ShowMessage(DEBUG_MSG_ERROR, dest);
 }
 
 void Debug_DebugMsg(const char *msg)
@@ -103,16 +383,24 @@ void Debug_DebugMsg(const char *msg)
     if (EmulatorConfig.debug_msg_enable == 0)
         return;
 
+#if DEBUG_LOG_LEVEL >= DEBUG_LOG_LEVEL_DEBUG
+    debug_log_printf(msg, "Debug: ", "%s", msg);
+#endif
+
     //SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION,
     //                         "GiiBiiAdvance - Debug", msg, NULL);
-    Win_MainShowMessage(1, msg);
+    Debug_ShowMessage(DEBUG_MSG_DEBUG, msg);
 }
 
 void Debug_ErrorMsg(const char *msg)
 {
+#if DEBUG_LOG_LEVEL >= DEBUG_LOG_LEVEL_ERROR
+    debug_log_printf(msg, "Error: ", "%s", msg);
+#endif
+
     //SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION,
     //                         "GiiBiiAdvance - Error", msg, NULL);
-    Win_MainShowMessage(0, msg);
+    Debug_ShowMessage(DEBUG_MSG_ERROR, msg);
 }
 
 //------------------------------------------------------------------------------
@@ -138,100 +426,7 @@ void ConsolePrint(const char *msg, ...)
 
 void ConsoleShow(void)
 {
-    Win_MainShowMessage(2, console_buffer);
+    Debug_ShowMessage(DEBUG_MSG_CONSOLE, console_buffer);
     //SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION,
     //                         "GiiBiiAdvance - Console", console_buffer, NULL);
 }
-
-//----------------------------------------------------------------------------------
-
-static char sys_info_buffer[10000];
-
-static void _sys_info_printf(const char *msg, ...)
-{
-    va_list args;
-    char buffer[1000];
-
-    va_start(args, msg);
-    vsnprintf(buffer, sizeof(buffer), msg, args);
-    va_end(args);
-
-    s_strncat(sys_info_buffer, buffer, sizeof(sys_info_buffer));
-}
-
-static void _sys_info_reset(void)
-{
-    memset(sys_info_buffer, 0, sizeof(sys_info_buffer));
-
-    _sys_info_printf("SDL information:\n"
-                     "----------------\n"
-                     "\n"
-                     "SDL_GetPlatform(): %s\n\n"
-                     "SDL_GetCPUCount(): %d (Number of logical CPU cores)\n"
-#if SDL_VERSION_ATLEAST(2, 0, 1)
-                     "SDL_GetSystemRAM(): %d MB\n"
-#endif
-                     "SDL_GetCPUCacheLineSize(): %d kB (Cache L1)\n\n",
-                     SDL_GetPlatform(), SDL_GetCPUCount(),
-#if SDL_VERSION_ATLEAST(2, 0, 1)
-                     SDL_GetSystemRAM(),
-#endif
-                     SDL_GetCPUCacheLineSize());
-
-    int total_secs, pct;
-    SDL_PowerState st = SDL_GetPowerInfo(&total_secs, &pct);
-    char *st_string;
-    switch (st)
-    {
-        default:
-        case SDL_POWERSTATE_UNKNOWN:
-            st_string = "SDL_POWERSTATE_UNKNOWN (cannot determine power status)";
-            break;
-        case SDL_POWERSTATE_ON_BATTERY:
-            st_string = "SDL_POWERSTATE_ON_BATTERY (not plugged in, running on battery)";
-            break;
-        case SDL_POWERSTATE_NO_BATTERY:
-            st_string = "SDL_POWERSTATE_NO_BATTERY (plugged in, no battery available)";
-            break;
-        case SDL_POWERSTATE_CHARGING:
-            st_string = "SDL_POWERSTATE_CHARGING (plugged in, charging battery)";
-            break;
-        case SDL_POWERSTATE_CHARGED:
-            st_string = "SDL_POWERSTATE_CHARGED (plugged in, battery charged)";
-            break;
-    }
-
-    unsigned int hours, min, secs;
-
-    hours = ((unsigned int)total_secs) / 3600;
-    min = (((unsigned int)total_secs) - (hours * 3600)) / 60;
-    secs = (((unsigned int)total_secs) - (hours * 3600) - (min * 60));
-
-    _sys_info_printf("SDL_GetPowerInfo():\n"
-                     "  %s\n"
-                     "  Time left: %d:%02d:%02d\n"
-                     "  Percentage: %3d%%\n"
-                     "\n",
-                     st_string, hours, min, secs, pct);
-#ifdef ENABLE_OPENGL
-    _sys_info_printf("OpenGL information:\n"
-                     "-------------------\n"
-                     "\n"
-                     "GL_RENDERER   = %s\n"
-                     "GL_VERSION    = %s\n"
-                     "GL_VENDOR     = %s\n"
-                     "GL_EXTENSIONS = ",
-                     (char *)glGetString(GL_RENDERER),
-                     (char *)glGetString(GL_VERSION),
-                     (char *)glGetString(GL_VENDOR));
-    _sys_info_printf("%s\n", (char *)glGetString(GL_EXTENSIONS));
-#endif
-    _sys_info_printf("\nEND LOG\n");
-}
-
-void SysInfoShow(void)
-{
-    _sys_info_reset();
-
-    Win_MainShowMessage(3, sys_info_buffer);
-}
@@ -7,9 +7,46 @@
 #ifndef DEBUG_UTILS__
 #define DEBUG_UTILS__
 
+typedef enum
+{
+    DEBUG_MSG_ERROR = 0,
+    DEBUG_MSG_DEBUG = 1,
+    DEBUG_MSG_CONSOLE = 2,
+} _debug_msg_type_e;
+
+// Messages of the log file. Debug_LogMsgArg() only writes to the log, the
+// error and debug messages are written there too. DEBUG_LOG_LEVEL can be
+// defined when building to remove the messages above a level at compile time.
+#define DEBUG_LOG_LEVEL_NONE    (0)
+#define DEBUG_LOG_LEVEL_ERROR   (1)
+#define DEBUG_LOG_LEVEL_DEBUG   (2)
+#define DEBUG_LOG_LEVEL_ALL     (3)
+
+#ifndef DEBUG_LOG_LEVEL
+#define DEBUG_LOG_LEVEL DEBUG_LOG_LEVEL_ALL
+#endif
+
+// Debug_Init() starts a thread that writes the log, so the threads that add
+// messages never wait for the disk. Messages are queued without locks and they
+// are dropped if the queue is full. Each thread can't log the same format
+// string more than a few times per second, and the size of the file is
+// limited, so noisy games can't fill the disk. Without the thread (before
+// Debug_Init() and after Debug_End()) messages are written right away.
 void Debug_Init(void);
-void Debug_End(void);
+void Debug_End(void); // Writes the pending messages and stops the thread
+
+// The handler shows the error and debug messages and the console. If there is
+// no handler they are printed to the standard error output.
+typedef void Debug_MessageHandlerPointer(int type, const char *msg);
+void Debug_SetMessageHandler(Debug_MessageHandlerPointer *fn);
+
 void Debug_LogMsgArg(const char *msg, ...);
+#if DEBUG_LOG_LEVEL < DEBUG_LOG_LEVEL_ALL
+// The arguments are still checked, but the call is removed
+# define Debug_LogMsgArg(...) \
+    do { if (0) (Debug_LogMsgArg)(__VA_ARGS__); } while (0)
+#endif
+
 void Debug_DebugMsgArg(const char *msg, ...);
 void Debug_ErrorMsgArg(const char *msg, ...);
 
@@ -20,6 +57,4 @@ void ConsoleReset(void);
 void ConsolePrint(const char *msg, ...);
 void ConsoleShow(void);
 
-void SysInfoShow(void);
-
 #endif // DEBUG_UTILS__
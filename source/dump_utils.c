@@ -0,0 +1,636 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "dump_utils.h"
+#include "font_utils.h"
+#include "general_utils.h"
+
+#include "gb_core/debug.h"
+#include "gba_core/disassembler.h"
+
+// Number of exports that can be waiting to be done
+#define DUMP_QUEUE_SIZE     (4)
+
+#define DUMP_MAX_THREADS    (16)
+// Chunks that can be converted or waiting to be written at the same time
+#define DUMP_SLOTS          (DUMP_MAX_THREADS * 2)
+// Bytes of memory converted at a time. In GB disassemblies the chunks are the
+// banks instead, so that no instruction crosses the end of a chunk.
+#define DUMP_CHUNK_SIZE     (16 * 1024)
+
+#define DUMP_WRITE_BUFFER   (1024 * 1024)
+
+// Longest line that can be written: address, bytes and instruction
+#define DUMP_LINE_MAX       (160)
+
+typedef struct
+{
+    char path[MAX_PATHLEN];
+    _dump_region_t region;
+    u8 *data;
+    u32 size;
+} _dump_job_t;
+
+typedef struct
+{
+    char *text;
+    size_t size;
+    size_t capacity;
+    int done;
+} _dump_slot_t;
+
+// All of this is protected by dump_mutex, and dump_cond is signaled when any of
+// it changes. The positions are free running.
+static _dump_job_t dump_queue[DUMP_QUEUE_SIZE];
+static unsigned int dump_queue_read;
+static unsigned int dump_queue_write;
+static int dump_exit;
+
+static SDL_mutex *dump_mutex;
+static SDL_cond *dump_cond;
+static SDL_Thread *dump_thread;
+
+// State of the export being done, protected by dump_work_mutex. The chunks
+// are converted in order, but they can finish in any order. Chunk n uses slot
+// n % DUMP_SLOTS, and it can't be started until chunk n - DUMP_SLOTS has been
+// written.
+static const _dump_job_t *dump_work_job;
+static u32 dump_work_chunk_size;
+static u32 dump_work_chunks;
+static u32 dump_work_next;
+static u32 dump_work_written;
+static int dump_work_error;
+static _dump_slot_t dump_slots[DUMP_SLOTS];
+
+static SDL_mutex *dump_work_mutex;
+static SDL_cond *dump_work_cond;
+
+//------------------------------------------------------------------------------
+
+// The text is generated without snprintf() where possible, most of it is
+// addresses and bytes in hexadecimal.
+static char *dump_hex(char *dst, u32 value, int digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        dst[i] = hex[value & 0xF];
+        value >>= 4;
+    }
+
+    return dst + digits;
+}
+
+static char *dump_address(char *dst, const _dump_region_t *region,
+                          u32 offset, u32 size)
+{
+    if (region->bank_size != 0)
+    {
+        u32 bank = offset / region->bank_size;
+        u32 base = (bank == 0) ? region->address : region->bank_address;
+        u32 address = base + (offset % region->bank_size);
+
+        dst = dump_hex(dst, bank, 3);
+        *dst++ = ':';
+        dst = dump_hex(dst, address, 4);
+    }
+    else
+    {
+        u32 last = region->address + size - 1;
+        dst = dump_hex(dst, region->address + offset,
+                       (last > 0xFFFF) ? 8 : 4);
+    }
+
+    return dst;
+}
+
+// The disassemblers use characters of the font of the GUI for the arrows of
+// the jumps, they are replaced by ASCII characters like in trace_utils.c.
+static char *dump_text(char *dst, const char *text)
+{
+    for ( ; *text != '\0'; text++)
+    {
+        if (*text == STR_SLIM_ARROW_UP[0])
+            *dst++ = '^';
+        else if (*text == STR_SLIM_ARROW_DOWN[0])
+            *dst++ = 'v';
+        else
+            *dst++ = *text;
+    }
+
+    return dst;
+}
+
+static int dump_slot_reserve(_dump_slot_t *slot, size_t size)
+{
+    if (slot->size + size <= slot->capacity)
+        return 0;
+
+    size_t capacity = (slot->capacity > 0) ? slot->capacity : 64 * 1024;
+    while (slot->size + size > capacity)
+        capacity *= 2;
+
+    char *text = realloc(slot->text, capacity);
+    if (text == NULL)
+        return 1;
+
+    slot->text = text;
+    slot->capacity = capacity;
+    return 0;
+}
+
+// Returns 0 on success, 1 if there isn't enough memory
+static int dump_convert_hex(_dump_slot_t *slot, const _dump_job_t *job,
+                            u32 start, u32 end)
+{
+    for (u32 offset = start; offset < end; offset += 16)
+    {
+        if (dump_slot_reserve(slot, DUMP_LINE_MAX))
+            return 1;
+
+        u32 count = end - offset;
+        if (count > 16)
+            count = 16;
+
+        const u8 *data = &job->data[offset];
+        char *dst = &slot->text[slot->size];
+
+        dst = dump_address(dst, &job->region, offset, job->size);
+        *dst++ = ' ';
+        *dst++ = ' ';
+
+        for (u32 i = 0; i < 16; i++)
+        {
+            if (i < count)
+            {
+                dst = dump_hex(dst, data[i], 2);
+            }
+            else
+            {
+                *dst++ = ' ';
+                *dst++ = ' ';
+            }
+            *dst++ = ' ';
+        }
+
+        *dst++ = ' ';
+
+        for (u32 i = 0; i < count; i++)
+        {
+            u8 c = data[i];
+            *dst++ = ((c >= ' ') && (c <= '~')) ? c : '.';
+        }
+
+        *dst++ = '\n';
+
+        slot->size = dst - slot->text;
+    }
+
+    return 0;
+}
+
+static int dump_convert_gba(_dump_slot_t *slot, const _dump_job_t *job,
+                            u32 start, u32 end)
+{
+    int thumb = (job->region.format == DUMP_FORMAT_GBA_THUMB);
+    u32 step = thumb ? 2 : 4;
+
+    for (u32 offset = start; offset + step <= end; offset += step)
+    {
+        if (dump_slot_reserve(slot, DUMP_LINE_MAX))
+            return 1;
+
+        const u8 *data = &job->data[offset];
+        u32 address = job->region.address + offset;
+        char text[128];
+        char *dst = &slot->text[slot->size];
+
+        dst = dump_address(dst, &job->region, offset, job->size);
+        *dst++ = ':';
+
+        if (thumb)
+        {
+            u16 opcode = data[0] | (data[1] << 8);
+            GBA_DisassembleTHUMB(opcode, address, text, sizeof(text));
+            dst = dump_hex(dst, opcode, 4);
+        }
+        else
+        {
+            u32 opcode = data[0] | (data[1] << 8) | (data[2] << 16)
+                         | ((u32)data[3] << 24);
+            GBA_DisassembleARM(opcode, address, text, sizeof(text));
+            dst = dump_hex(dst, opcode, 8);
+        }
+
+        *dst++ = ' ';
+        dst = dump_text(dst, text);
+        *dst++ = '\n';
+
+        slot->size = dst - slot->text;
+    }
+
+    return 0;
+}
+
+static int dump_convert_gb(_dump_slot_t *slot, const _dump_job_t *job,
+                           u32 start, u32 end)
+{
+    u32 offset = start;
+
+    while (offset < end)
+    {
+        if (dump_slot_reserve(slot, DUMP_LINE_MAX))
+            return 1;
+
+        u32 bank_offset = offset;
+        if (job->region.bank_size != 0)
+            bank_offset %= job->region.bank_size;
+        u32 base = ((job->region.bank_size != 0)
+                    && (offset >= job->region.bank_size)) ?
+                   job->region.bank_address : job->region.address;
+
+        // The instruction may need bytes after the end of the chunk
+        u8 bytes[3] = { 0 };
+        u32 left = end - offset;
+        memcpy(bytes, &job->data[offset], (left < 3) ? left : 3);
+
+        // The text has the bytes of the instruction before it
+        char text[128];
+        u32 size = GB_DisassembleBytes((base + bank_offset) & 0xFFFF, bytes,
+                                       text, sizeof(text));
+        if (size > left)
+        {
+            // Truncated at the end of the chunk
+            size = 1;
+            snprintf(text, sizeof(text), "%02X       .db #0x%02X", bytes[0],
+                     bytes[0]);
+        }
+
+        char *dst = &slot->text[slot->size];
+
+        dst = dump_address(dst, &job->region, offset, job->size);
+        *dst++ = ':';
+        dst = dump_text(dst, text);
+        *dst++ = '\n';
+
+        slot->size = dst - slot->text;
+
+        offset += size;
+    }
+
+    return 0;
+}
+
+static int dump_convert(_dump_slot_t *slot, const _dump_job_t *job, u32 chunk)
+{
+    u32 start = chunk * dump_work_chunk_size;
+    u32 end = start + dump_work_chunk_size;
+    if (end > job->size)
+        end = job->size;
+
+    slot->size = 0;
+
+    switch (job->region.format)
+    {
+        case DUMP_FORMAT_HEX:
+            return dump_convert_hex(slot, job, start, end);
+        case DUMP_FORMAT_GBA_ARM:
+        case DUMP_FORMAT_GBA_THUMB:
+            return dump_convert_gba(slot, job, start, end);
+        case DUMP_FORMAT_GB:
+            return dump_convert_gb(slot, job, start, end);
+        default:
+            return 1;
+    }
+}
+
+static int dump_worker_thread_fn(unused__ void *data)
+{
+    // The memory of the console isn't the one that is being disassembled. The
+    // setting only affects this thread.
+    GBA_DisassemblerSetOffline(1);
+
+    SDL_LockMutex(dump_work_mutex);
+
+    while (1)
+    {
+        while ((dump_work_next < dump_work_chunks) && (dump_work_error == 0)
+               && ((dump_work_next - dump_work_written) >= DUMP_SLOTS))
+            SDL_CondWait(dump_work_cond, dump_work_mutex);
+
+        if ((dump_work_next >= dump_work_chunks) || dump_work_error)
+            break;
+
+        u32 chunk = dump_work_next++;
+        _dump_slot_t *slot = &dump_slots[chunk % DUMP_SLOTS];
+
+        SDL_UnlockMutex(dump_work_mutex);
+
+        int error = dump_convert(slot, dump_work_job, chunk);
+
+        SDL_LockMutex(dump_work_mutex);
+
+        if (error)
+            dump_work_error = 1;
+        slot->done = 1;
+        SDL_CondBroadcast(dump_work_cond);
+    }
+
+    SDL_UnlockMutex(dump_work_mutex);
+
+    return 0;
+}
+
+// Converts the chunks with the pool of threads and writes them in order.
+// Returns 0 on success. If the threads can't be created, the chunks are
+// converted by this thread.
+static int dump_write_text(FILE *f, const _dump_job_t *job)
+{
+    dump_work_job = job;
+    dump_work_chunk_size = DUMP_CHUNK_SIZE;
+    if ((job->region.format == DUMP_FORMAT_GB) && (job->region.bank_size != 0))
+        dump_work_chunk_size = job->region.bank_size;
+    dump_work_chunks = (job->size + dump_work_chunk_size - 1)
+                       / dump_work_chunk_size;
+    dump_work_next = 0;
+    dump_work_written = 0;
+    dump_work_error = 0;
+
+    for (int i = 0; i < DUMP_SLOTS; i++)
+        dump_slots[i].done = 0;
+
+    // The workers need the mutex, they can't be used if it doesn't exist
+    int count = SDL_GetCPUCount();
+    if (count > DUMP_MAX_THREADS)
+        count = DUMP_MAX_THREADS;
+    if ((dump_work_mutex == NULL) || (dump_work_cond == NULL))
+        count = 0;
+
+    SDL_Thread *threads[DUMP_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < count; i++)
+    {
+        threads[started] = SDL_CreateThread(dump_worker_thread_fn,
+                                            "Dump worker", NULL);
+        if (threads[started] != NULL)
+            started++;
+    }
+
+    int ret = 0;
+
+    SDL_LockMutex(dump_work_mutex);
+
+    for (u32 chunk = 0; chunk < dump_work_chunks; chunk++)
+    {
+        _dump_slot_t *slot = &dump_slots[chunk % DUMP_SLOTS];
+
+        if (started == 0)
+        {
+            SDL_UnlockMutex(dump_work_mutex);
+            GBA_DisassemblerSetOffline(1);
+            dump_work_error = dump_convert(slot, job, chunk);
+            GBA_DisassemblerSetOffline(0);
+            SDL_LockMutex(dump_work_mutex);
+            dump_work_next++;
+            slot->done = 1;
+        }
+
+        while ((slot->done == 0) && (dump_work_error == 0))
+            SDL_CondWait(dump_work_cond, dump_work_mutex);
+
+        if (dump_work_error)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+            ret = 1;
+            break;
+        }
+
+        SDL_UnlockMutex(dump_work_mutex);
+
+        size_t written = fwrite(slot->text, 1, slot->size, f);
+
+        SDL_LockMutex(dump_work_mutex);
+
+        slot->done = 0;
+        dump_work_written++;
+
+        if (written != slot->size)
+        {
+            Debug_ErrorMsgArg("Couldn't write file: %s", job->path);
+            dump_work_error = 1;
+            ret = 1;
+        }
+
+        SDL_CondBroadcast(dump_work_cond);
+
+        if (ret)
+            break;
+    }
+
+    // Stop the threads if there has been an error
+    dump_work_error |= ret;
+    SDL_CondBroadcast(dump_work_cond);
+    SDL_UnlockMutex(dump_work_mutex);
+
+    for (int i = 0; i < started; i++)
+        SDL_WaitThread(threads[i], NULL);
+
+    for (int i = 0; i < DUMP_SLOTS; i++)
+    {
+        free(dump_slots[i].text);
+        memset(&dump_slots[i], 0, sizeof(dump_slots[i]));
+    }
+
+    return ret;
+}
+
+static void dump_job_do(const _dump_job_t *job)
+{
+    FILE *f = fopen(job->path, "wb");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create file: %s", job->path);
+        return;
+    }
+
+    setvbuf(f, NULL, _IOFBF, DUMP_WRITE_BUFFER);
+
+    int ret;
+
+    if (job->region.format == DUMP_FORMAT_RAW)
+    {
+        ret = fwrite(job->data, 1, job->size, f) != job->size;
+        if (ret)
+            Debug_ErrorMsgArg("Couldn't write file: %s", job->path);
+    }
+    else
+    {
+        ret = dump_write_text(f, job);
+    }
+
+    if (fclose(f) != 0)
+        ret = 1;
+
+    if (ret == 0)
+        Debug_LogMsgArg("Dump: Saved %s", job->path);
+}
+
+//------------------------------------------------------------------------------
+
+static int dump_thread_fn(unused__ void *data)
+{
+    SDL_LockMutex(dump_mutex);
+
+    while (1)
+    {
+        while ((dump_queue_read == dump_queue_write) && (dump_exit == 0))
+            SDL_CondWait(dump_cond, dump_mutex);
+
+        if (dump_queue_read == dump_queue_write)
+            break; // Exit requested and nothing left to write
+
+        _dump_job_t *job = &dump_queue[dump_queue_read % DUMP_QUEUE_SIZE];
+
+        SDL_UnlockMutex(dump_mutex);
+
+        dump_job_do(job);
+
+        free(job->data);
+        job->data = NULL;
+
+        SDL_LockMutex(dump_mutex);
+
+        dump_queue_read++;
+        SDL_CondBroadcast(dump_cond);
+    }
+
+    SDL_UnlockMutex(dump_mutex);
+
+    return 0;
+}
+
+void Dump_Init(void)
+{
+    if (dump_thread != NULL)
+        return;
+
+    dump_mutex = SDL_CreateMutex();
+    dump_cond = SDL_CreateCond();
+    dump_work_mutex = SDL_CreateMutex();
+    dump_work_cond = SDL_CreateCond();
+    if ((dump_mutex == NULL) || (dump_cond == NULL)
+        || (dump_work_mutex == NULL) || (dump_work_cond == NULL))
+    {
+        Debug_ErrorMsgArg("%s: %s", __func__, SDL_GetError());
+        return;
+    }
+
+    dump_queue_read = 0;
+    dump_queue_write = 0;
+    dump_exit = 0;
+
+    dump_thread = SDL_CreateThread(dump_thread_fn, "Dump writer", NULL);
+    if (dump_thread == NULL)
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+}
+
+void Dump_End(void)
+{
+    if (dump_thread != NULL)
+    {
+        SDL_LockMutex(dump_mutex);
+        dump_exit = 1;
+        SDL_CondBroadcast(dump_cond);
+        SDL_UnlockMutex(dump_mutex);
+
+        SDL_WaitThread(dump_thread, NULL);
+        dump_thread = NULL;
+    }
+
+    if (dump_cond != NULL)
+    {
+        SDL_DestroyCond(dump_cond);
+        dump_cond = NULL;
+    }
+    if (dump_mutex != NULL)
+    {
+        SDL_DestroyMutex(dump_mutex);
+        dump_mutex = NULL;
+    }
+    if (dump_work_cond != NULL)
+    {
+        SDL_DestroyCond(dump_work_cond);
+        dump_work_cond = NULL;
+    }
+    if (dump_work_mutex != NULL)
+    {
+        SDL_DestroyMutex(dump_work_mutex);
+        dump_work_mutex = NULL;
+    }
+}
+
+int Dump_Start(const char *path, const _dump_region_t *region,
+               const void *data, u32 size)
+{
+    if ((size == 0) || (strlen(path) >= MAX_PATHLEN))
+    {
+        Debug_ErrorMsgArg("%s: Invalid arguments.", __func__);
+        return 1;
+    }
+
+    u8 *copy = malloc(size);
+    if (copy == NULL)
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+        return 1;
+    }
+    memcpy(copy, data, size);
+
+    if (dump_thread == NULL)
+    {
+        _dump_job_t job;
+        s_strncpy(job.path, path, sizeof(job.path));
+        job.region = *region;
+        job.data = copy;
+        job.size = size;
+
+        dump_job_do(&job);
+        free(copy);
+        return 0;
+    }
+
+    SDL_LockMutex(dump_mutex);
+
+    if ((dump_queue_write - dump_queue_read) >= DUMP_QUEUE_SIZE)
+    {
+        SDL_UnlockMutex(dump_mutex);
+        Debug_ErrorMsgArg("Too many exports in progress, try again later.");
+        free(copy);
+        return 1;
+    }
+
+    _dump_job_t *job = &dump_queue[dump_queue_write % DUMP_QUEUE_SIZE];
+    s_strncpy(job->path, path, sizeof(job->path));
+    job->region = *region;
+    job->data = copy;
+    job->size = size;
+
+    dump_queue_write++;
+    SDL_CondBroadcast(dump_cond);
+
+    SDL_UnlockMutex(dump_mutex);
+
+    return 0;
+}
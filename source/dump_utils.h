@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef DUMP_UTILS__
+#define DUMP_UTILS__
+
+// Memory dumps and disassembly listings of whole regions of memory, like the
+// 32 MiB of a GBA ROM. They are written by a background thread so that the UI
+// doesn't have to wait for them. The memory is copied when the export is
+// queued, then a pool of threads converts chunks of it to text at the same
+// time, and the chunks are written to the file in order with large writes.
+//
+// Exports are done in the order they are queued. The result is printed to the
+// log. If the thread isn't running, they are done right away.
+
+#include "general_utils.h"
+
+typedef enum
+{
+    DUMP_FORMAT_RAW,        // The bytes as they are
+    DUMP_FORMAT_HEX,        // 16 bytes per line in hexadecimal and as text
+    DUMP_FORMAT_GBA_ARM,    // One instruction per line
+    DUMP_FORMAT_GBA_THUMB,
+    DUMP_FORMAT_GB,
+} _dump_format_e;
+
+typedef struct
+{
+    _dump_format_e format;
+    u32 address;        // Address of the first bank in the memory map
+    u32 bank_size;      // 0 if the region isn't banked
+    u32 bank_address;   // Address of the rest of banks
+} _dump_region_t;
+
+void Dump_Init(void);
+void Dump_End(void); // Finishes the queued exports and stops the thread
+
+// Copies "size" bytes from "data" and queues them to be exported to "path".
+// Returns 0 on success, 1 on error (if the queue is full it doesn't wait).
+int Dump_Start(const char *path, const _dump_region_t *region,
+               const void *data, u32 size);
+
+#endif // DUMP_UTILS__
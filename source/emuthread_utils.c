@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <SDL.h>
+
+#include "config.h"
+#include "debug_utils.h"
+#include "emuthread_utils.h"
+#include "general_utils.h"
+
+// Must be a power of two
+#define EMUTHREAD_INPUT_QUEUE_SIZE  (8)
+
+#define EMUTHREAD_MAX_CALLS         (8)
+
+// The main thread handles events at least this often (in ms) while it waits
+// for frames, even if the emulation isn't running.
+#define EMUTHREAD_WAIT_FRAME_MS     (17)
+
+static SDL_Thread *emuthread_thread;
+static SDL_threadID emuthread_id;
+static SDL_mutex *emuthread_mutex;
+static SDL_cond *emuthread_cond;
+static SDL_sem *emuthread_frame_sem; // Posted after each frame
+
+static void (*emuthread_frame_fn)(void);
+static void (*emuthread_wait_fn)(void);
+
+// All of this is protected by emuthread_mutex, and emuthread_cond is signaled
+// when any of it changes.
+static int emuthread_pause_count;
+static int emuthread_running;
+static int emuthread_busy; // 1 while frames are being emulated
+static int emuthread_exit;
+static void (*emuthread_calls[EMUTHREAD_MAX_CALLS])(void);
+static int emuthread_calls_count;
+
+// Only written by the main thread and read by the emulation thread
+static _input_state_t emuthread_input_queue[EMUTHREAD_INPUT_QUEUE_SIZE];
+static SDL_atomic_t emuthread_input_write_pos; // Free running
+static SDL_atomic_t emuthread_input_read_pos;
+
+// The emulation thread owns the back buffer and the main thread owns the front
+// buffer. The other one is exchanged with them to pass frames. Its index is
+// stored with a flag that is set while it holds a frame that the main thread
+// hasn't taken.
+#define EMUTHREAD_FRAME_NEW         (1 << 2)
+
+static u32 emuthread_frames[3][256 * 224];
+static int emuthread_frame_back = 0;
+static int emuthread_frame_front = 1;
+static SDL_atomic_t emuthread_frame_middle;
+
+//------------------------------------------------------------------------------
+
+static int emuthread_thread_fn(unused__ void *data)
+{
+    SDL_LockMutex(emuthread_mutex);
+
+    while (1)
+    {
+        while ((emuthread_exit == 0)
+               && ((emuthread_pause_count > 0) || (emuthread_running == 0)))
+        {
+            SDL_CondWait(emuthread_cond, emuthread_mutex);
+        }
+
+        if (emuthread_exit)
+            break;
+
+        emuthread_busy = 1;
+
+        SDL_UnlockMutex(emuthread_mutex);
+
+        emuthread_frame_fn();
+
+        SDL_LockMutex(emuthread_mutex);
+
+        emuthread_busy = 0;
+        SDL_CondBroadcast(emuthread_cond);
+
+        SDL_UnlockMutex(emuthread_mutex);
+
+        SDL_SemPost(emuthread_frame_sem);
+
+        emuthread_wait_fn();
+
+        SDL_LockMutex(emuthread_mutex);
+    }
+
+    SDL_UnlockMutex(emuthread_mutex);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void EmuThread_Init(void (*frame_fn)(void), void (*wait_fn)(void))
+{
+    if ((EmulatorConfig.emulation_thread == 0) || (emuthread_thread != NULL))
+        return;
+
+#ifdef ENABLE_THREAD_LOCAL_CORES
+    // The main thread would see its own copy of the consoles, not the one that
+    // is emulated, so everything runs in the main thread.
+    return;
+#endif
+
+    emuthread_frame_fn = frame_fn;
+    emuthread_wait_fn = wait_fn;
+
+    emuthread_mutex = SDL_CreateMutex();
+    emuthread_cond = SDL_CreateCond();
+    emuthread_frame_sem = SDL_CreateSemaphore(0);
+    if ((emuthread_mutex == NULL) || (emuthread_cond == NULL)
+        || (emuthread_frame_sem == NULL))
+    {
+        Debug_ErrorMsgArg("%s: %s", __func__, SDL_GetError());
+        EmuThread_End();
+        return;
+    }
+
+    emuthread_pause_count = 0;
+    emuthread_running = 0;
+    emuthread_busy = 0;
+    emuthread_exit = 0;
+    emuthread_calls_count = 0;
+
+    SDL_AtomicSet(&emuthread_input_write_pos, 0);
+    SDL_AtomicSet(&emuthread_input_read_pos, 0);
+    SDL_AtomicSet(&emuthread_frame_middle, 2);
+
+    emuthread_thread = SDL_CreateThread(emuthread_thread_fn, "Emulation",
+                                        NULL);
+    if (emuthread_thread == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        EmuThread_End();
+        return;
+    }
+
+    emuthread_id = SDL_GetThreadID(emuthread_thread);
+}
+
+void EmuThread_End(void)
+{
+    if (emuthread_thread != NULL)
+    {
+        SDL_LockMutex(emuthread_mutex);
+        emuthread_exit = 1;
+        SDL_CondBroadcast(emuthread_cond);
+        SDL_UnlockMutex(emuthread_mutex);
+
+        SDL_WaitThread(emuthread_thread, NULL);
+        emuthread_thread = NULL;
+    }
+
+    if (emuthread_frame_sem != NULL)
+    {
+        SDL_DestroySemaphore(emuthread_frame_sem);
+        emuthread_frame_sem = NULL;
+    }
+    if (emuthread_cond != NULL)
+    {
+        SDL_DestroyCond(emuthread_cond);
+        emuthread_cond = NULL;
+    }
+    if (emuthread_mutex != NULL)
+    {
+        SDL_DestroyMutex(emuthread_mutex);
+        emuthread_mutex = NULL;
+    }
+}
+
+int EmuThread_IsEnabled(void)
+{
+    return emuthread_thread != NULL;
+}
+
+int EmuThread_IsCurrentThread(void)
+{
+    if (emuthread_thread == NULL)
+        return 0;
+
+    return SDL_ThreadID() == emuthread_id;
+}
+
+void EmuThread_Pause(void)
+{
+    if (emuthread_thread == NULL)
+        return;
+
+    SDL_LockMutex(emuthread_mutex);
+
+    emuthread_pause_count++;
+
+    while (emuthread_busy)
+        SDL_CondWait(emuthread_cond, emuthread_mutex);
+
+    // The calls requested by the emulation thread can be done now
+    void (*calls[EMUTHREAD_MAX_CALLS])(void);
+    int count = emuthread_calls_count;
+
+    for (int i = 0; i < count; i++)
+        calls[i] = emuthread_calls[i];
+
+    emuthread_calls_count = 0;
+
+    SDL_UnlockMutex(emuthread_mutex);
+
+    for (int i = 0; i < count; i++)
+        calls[i]();
+}
+
+void EmuThread_Resume(void)
+{
+    if (emuthread_thread == NULL)
+        return;
+
+    SDL_LockMutex(emuthread_mutex);
+
+    if (emuthread_pause_count > 0)
+        emuthread_pause_count--;
+
+    SDL_CondBroadcast(emuthread_cond);
+
+    SDL_UnlockMutex(emuthread_mutex);
+}
+
+void EmuThread_SetRunning(int running)
+{
+    if (emuthread_thread == NULL)
+        return;
+
+    SDL_LockMutex(emuthread_mutex);
+
+    emuthread_running = running;
+    SDL_CondBroadcast(emuthread_cond);
+
+    SDL_UnlockMutex(emuthread_mutex);
+}
+
+void EmuThread_CallFromMainThread(void (*fn)(void))
+{
+    if (EmuThread_IsCurrentThread() == 0)
+    {
+        fn();
+        return;
+    }
+
+    SDL_LockMutex(emuthread_mutex);
+
+    int found = 0;
+    for (int i = 0; i < emuthread_calls_count; i++)
+    {
+        if (emuthread_calls[i] == fn)
+            found = 1;
+    }
+
+    if ((found == 0) && (emuthread_calls_count < EMUTHREAD_MAX_CALLS))
+        emuthread_calls[emuthread_calls_count++] = fn;
+    else if (found == 0)
+        Debug_LogMsgArg("%s: Too many calls queued", __func__);
+
+    emuthread_running = 0;
+
+    SDL_UnlockMutex(emuthread_mutex);
+}
+
+void EmuThread_WaitFrame(void)
+{
+    if (emuthread_thread == NULL)
+        return;
+
+    SDL_SemWaitTimeout(emuthread_frame_sem, EMUTHREAD_WAIT_FRAME_MS);
+
+    // If several frames have been emulated, it only has to wait for one
+    while (SDL_SemTryWait(emuthread_frame_sem) == 0)
+        ;
+}
+
+//------------------------------------------------------------------------------
+
+void EmuThread_InputPush(const _input_state_t *state)
+{
+    u32 write = SDL_AtomicGet(&emuthread_input_write_pos);
+    u32 read = SDL_AtomicGet(&emuthread_input_read_pos);
+
+    if ((write - read) >= EMUTHREAD_INPUT_QUEUE_SIZE)
+        return;
+
+    emuthread_input_queue[write & (EMUTHREAD_INPUT_QUEUE_SIZE - 1)] = *state;
+
+    SDL_AtomicSet(&emuthread_input_write_pos, write + 1);
+}
+
+void EmuThread_InputPop(_input_state_t *state)
+{
+    u32 read = SDL_AtomicGet(&emuthread_input_read_pos);
+    u32 write = SDL_AtomicGet(&emuthread_input_write_pos);
+
+    if (read == write)
+        return;
+
+    *state = emuthread_input_queue[read & (EMUTHREAD_INPUT_QUEUE_SIZE - 1)];
+    read++;
+
+    // All the fields are flags, so the rest can be merged byte by byte
+    while (read != write)
+    {
+        const u8 *src = (const u8 *)
+                &emuthread_input_queue[read & (EMUTHREAD_INPUT_QUEUE_SIZE - 1)];
+        u8 *dst = (u8 *)state;
+
+        for (size_t i = 0; i < sizeof(_input_state_t); i++)
+            dst[i] |= src[i];
+
+        read++;
+    }
+
+    SDL_AtomicSet(&emuthread_input_read_pos, read);
+}
+
+//------------------------------------------------------------------------------
+
+void *EmuThread_FrameBegin(void)
+{
+    return emuthread_frames[emuthread_frame_back];
+}
+
+void EmuThread_FrameEnd(void)
+{
+    int old = SDL_AtomicSet(&emuthread_frame_middle,
+                            emuthread_frame_back | EMUTHREAD_FRAME_NEW);
+
+    emuthread_frame_back = old & ~EMUTHREAD_FRAME_NEW;
+}
+
+const void *EmuThread_FrameGet(void)
+{
+    if ((SDL_AtomicGet(&emuthread_frame_middle) & EMUTHREAD_FRAME_NEW) == 0)
+        return NULL;
+
+    int old = SDL_AtomicSet(&emuthread_frame_middle, emuthread_frame_front);
+
+    emuthread_frame_front = old & ~EMUTHREAD_FRAME_NEW;
+
+    return emuthread_frames[emuthread_frame_front];
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef EMUTHREAD_UTILS__
+#define EMUTHREAD_UTILS__
+
+#include "input_utils.h"
+
+// If it's enabled in the configuration, the emulation runs in a thread of its
+// own, so that handling events, drawing the windows and waiting for the
+// vertical blank don't delay it.
+// It's never used if the cores are built with ENABLE_THREAD_LOCAL_CORES.
+//
+// The main thread pauses the emulation thread while it handles events and
+// anything else that may access the state of the emulated console, and resumes
+// it afterwards. It's only paused between frames.
+//
+// The rest of the communication doesn't need locks: The input is sent to the
+// emulation thread through a queue, and the emulated frames are sent back
+// through a triple buffer, so the newest one can always be displayed without
+// waiting for the emulation thread to finish writing the next one.
+
+// The frame function emulates one or more frames. The wait function is called
+// after it, while the thread can be paused, and it has to pace the emulation.
+void EmuThread_Init(void (*frame_fn)(void), void (*wait_fn)(void));
+void EmuThread_End(void);
+
+// Returns 1 if the emulation runs in the emulation thread
+int EmuThread_IsEnabled(void);
+// Returns 1 if it's called from the emulation thread
+int EmuThread_IsCurrentThread(void);
+
+// Both have to be called from the main thread. While the thread is paused, the
+// main thread can access the emulated console. Calls can be nested.
+void EmuThread_Pause(void);
+void EmuThread_Resume(void);
+
+// Frames are only emulated while it's set. It has to be called while paused.
+void EmuThread_SetRunning(int running);
+
+// When it's called from the emulation thread, the function is called by the
+// main thread the next time it pauses the emulation, and the emulation stops
+// until it's set to run again. If not, it's called right away. It's meant for
+// things that have to be done by the main thread, like opening windows.
+void EmuThread_CallFromMainThread(void (*fn)(void));
+
+// Waits until the emulation thread has finished a frame, for a frame at most
+void EmuThread_WaitFrame(void);
+
+//------------------------------------------------------------------------------
+
+// The state of the input is queued by the main thread once per loop iteration.
+// If the queue is full, the state is dropped.
+void EmuThread_InputPush(const _input_state_t *state);
+// Takes all the queued states at the start of each frame. They are merged, so
+// a key is pressed if it was pressed in any of them, and presses shorter than
+// a frame aren't lost. If the queue is empty, the state is left unchanged.
+void EmuThread_InputPop(_input_state_t *state);
+
+//------------------------------------------------------------------------------
+
+// The emulation thread writes each frame in the buffer returned by
+// EmuThread_FrameBegin(), large enough for a 256x224 ARGB8888 frame, then it
+// calls EmuThread_FrameEnd() to make it the newest one.
+void *EmuThread_FrameBegin(void);
+void EmuThread_FrameEnd(void);
+
+// Returns the newest frame if it hasn't been returned before, or NULL. It stays
+// valid until the next call.
+const void *EmuThread_FrameGet(void);
+
+#endif // EMUTHREAD_UTILS__
@@ -11,7 +11,11 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include <SDL.h>
+
 #include "build_options.h"
+#include "debug_utils.h"
+#include "file_explorer.h"
 #include "general_utils.h"
 
 static int _file_explorer_is_valid_rom_type(char *name)
@@ -36,6 +40,10 @@ static int _file_explorer_is_valid_rom_type(char *name)
         return 1;
     if (strcmp(extension, "SGB") == 0)
         return 1;
+    if (strcmp(extension, "ZIP") == 0)
+        return 1;
+    if (strcmp(extension, "GBM") == 0) // Movies
+        return 1;
 
     extension[0] = extension[1];
     extension[1] = extension[2];
@@ -67,169 +75,377 @@ char GetFolderSeparator(char *path)
 
 //----------------------------------------------------------------------------
 
-static int filenum;
-
 // This holds the last file selected. It persists even after calling
 // FileExplorer_ListFree().
 static char fileselected[MAX_PATHLEN];
 
-static char **filename = NULL;
-static int *list_isdir = NULL;
-static int maxfiles; // Allocated space for files
-static int is_root = 0;
 static char exploring_path[MAX_PATHLEN];
-static int list_inited = 0;
 
-int FileExplorer_GetNumFiles(void)
+// The names of all the entries of a list are stored one after the other in the
+// same buffer. Entries only hold their offset in it, so that the buffer can be
+// reallocated.
+typedef struct
+{
+    size_t name; // Offset in the names buffer
+    int is_dir;
+} _file_explorer_entry_t;
+
+typedef struct
+{
+    char *names;
+    size_t names_size;
+    size_t names_capacity;
+
+    _file_explorer_entry_t *entries;
+    int num_entries;
+    int capacity;
+} _file_explorer_list_t;
+
+// The list that is shown, only used by the main thread. The entries are
+// accessed in the order of file_explorer_order, which is sorted when the scan
+// of the folder ends.
+static _file_explorer_list_t file_explorer_list;
+static int *file_explorer_order;
+
+// The folder is scanned by a thread, that adds the entries it finds to the
+// pending list. They are moved to the list that is shown by
+// FileExplorer_Poll(). The pending list and the flags are protected by
+// file_explorer_mutex.
+static _file_explorer_list_t file_explorer_pending;
+static int file_explorer_scan_done;
+static int file_explorer_scan_cancel;
+
+static char file_explorer_scan_path[MAX_PATHLEN];
+
+static SDL_mutex *file_explorer_mutex;
+static SDL_Thread *file_explorer_thread;
+
+// Returns 0 on success
+static int _file_explorer_list_add(_file_explorer_list_t *list,
+                                   const char *name, int is_dir)
 {
-    return filenum;
+    size_t size = strlen(name) + 1;
+
+    if (list->names_size + size > list->names_capacity)
+    {
+        size_t capacity = list->names_capacity ? list->names_capacity : 4096;
+        while (list->names_size + size > capacity)
+            capacity *= 2;
+
+        char *names = realloc(list->names, capacity);
+        if (names == NULL)
+            return 1;
+
+        list->names = names;
+        list->names_capacity = capacity;
+    }
+
+    if (list->num_entries == list->capacity)
+    {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+
+        _file_explorer_entry_t *entries =
+                realloc(list->entries, capacity * sizeof(*entries));
+        if (entries == NULL)
+            return 1;
+
+        list->entries = entries;
+        list->capacity = capacity;
+    }
+
+    memcpy(&(list->names[list->names_size]), name, size);
+
+    list->entries[list->num_entries].name = list->names_size;
+    list->entries[list->num_entries].is_dir = is_dir;
+    list->num_entries++;
+
+    list->names_size += size;
+
+    return 0;
 }
 
-void FileExplorer_SetPath(char *path)
+static void _file_explorer_list_free(_file_explorer_list_t *list)
 {
-    if (path)
-        s_strncpy(exploring_path, path, sizeof(exploring_path));
-    else
-        s_strncpy(exploring_path, ".", sizeof(exploring_path));
+    free(list->names);
+    free(list->entries);
+    memset(list, 0, sizeof(*list));
 }
 
-void FileExplorer_ListFree(void)
+static const char *_file_explorer_list_name(const _file_explorer_list_t *list,
+                                            int index)
 {
-    if (list_inited == 0)
-        return;
+    return &(list->names[list->entries[index].name]);
+}
+
+static int _file_explorer_entry_is_dir(struct dirent *pent)
+{
+#ifdef _DIRENT_HAVE_D_TYPE
+    // This saves one stat() per file, which is slow in network drives
+    if (pent->d_type == DT_DIR)
+        return 1;
+    if (pent->d_type == DT_REG)
+        return 0;
+#endif
+
+    char checkingfile[MAX_PATHLEN];
+    snprintf(checkingfile, sizeof(checkingfile), "%s%s",
+             file_explorer_scan_path, pent->d_name);
 
-    list_inited = 0;
+    struct stat statbuf;
+    if (stat(checkingfile, &statbuf) != 0)
+        return 0;
 
-    if (list_isdir)
-        free(list_isdir);
+    return S_ISDIR(statbuf.st_mode) != 0;
+}
 
-    if (filename)
+static int _file_explorer_scan_thread_fn(unused__ void *data)
+{
+    DIR *pdir = opendir(file_explorer_scan_path);
+    if (pdir != NULL)
     {
-        for (unsigned int i = 0; i < filenum; i++)
+        struct dirent *pent;
+
+        while ((pent = readdir(pdir)) != NULL)
         {
-            if (filename[i])
-                free(filename[i]);
+            if ((strcmp(pent->d_name, ".") == 0)
+                || (strcmp(pent->d_name, "..") == 0))
+                continue;
+
+            int is_dir = _file_explorer_entry_is_dir(pent);
+
+            if (is_dir == 0)
+            {
+                if (_file_explorer_is_valid_rom_type(pent->d_name) == 0)
+                    continue;
+            }
+
+            SDL_LockMutex(file_explorer_mutex);
+
+            int cancel = file_explorer_scan_cancel;
+            if (cancel == 0)
+            {
+                if (_file_explorer_list_add(&file_explorer_pending,
+                                            pent->d_name, is_dir) != 0)
+                    cancel = 1; // Not enough memory, show what has been found
+            }
+
+            SDL_UnlockMutex(file_explorer_mutex);
+
+            if (cancel)
+                break;
         }
-        free(filename);
+
+        closedir(pdir);
     }
 
-    filenum = 0;
-    maxfiles = 0;
-}
+    SDL_LockMutex(file_explorer_mutex);
+    file_explorer_scan_done = 1;
+    SDL_UnlockMutex(file_explorer_mutex);
 
-void FileExplorer_ListInit(int numfiles)
-{
-    list_isdir = malloc(numfiles * sizeof(int));
-    filename = malloc(numfiles * sizeof(char *));
-    maxfiles = numfiles;
-    is_root = 1;
-    list_inited = 1;
+    return 0;
 }
 
-void FileExplorer_ListAdd(char *name, int isdir)
+// Moves the pending entries to the list that is shown. Returns 1 if the list
+// has changed, and sets done to 1 if the scan has ended.
+static int _file_explorer_take_pending(int *done)
 {
-    if (strcmp(name, ".") == 0)
-        return;
+    int changed = 0;
+
+    SDL_LockMutex(file_explorer_mutex);
 
-    if (strcmp(name, "..") == 0)
+    for (int i = 0; i < file_explorer_pending.num_entries; i++)
     {
-        if (is_root) // Add ".." only if there is not one entry yet
-            is_root = 0;
-        else
-            return;
+        const char *name = _file_explorer_list_name(&file_explorer_pending, i);
+        int is_dir = file_explorer_pending.entries[i].is_dir;
+
+        if (_file_explorer_list_add(&file_explorer_list, name, is_dir) != 0)
+            break;
+
+        changed = 1;
     }
 
-    if (filenum < maxfiles)
+    file_explorer_pending.num_entries = 0;
+    file_explorer_pending.names_size = 0;
+
+    *done = file_explorer_scan_done;
+
+    SDL_UnlockMutex(file_explorer_mutex);
+
+    if (changed)
     {
-        if (isdir == 0)
+        int num = file_explorer_list.num_entries;
+        int *order = realloc(file_explorer_order, num * sizeof(int));
+        if (order == NULL)
         {
-            if (_file_explorer_is_valid_rom_type(name) == 0)
-                return;
+            // Don't show the entries that can't be sorted
+            file_explorer_list.num_entries = 0;
+            free(file_explorer_order);
+            file_explorer_order = NULL;
+            return 1;
         }
 
-        list_isdir[filenum] = isdir;
-        int size = strlen(name) + 1;
-        filename[filenum] = malloc(size);
-        s_strncpy(filename[filenum], name, size);
-        filenum++;
+        // Until the scan ends they are shown in the order they are found
+        for (int i = 0; i < num; i++)
+            order[i] = i;
+
+        file_explorer_order = order;
     }
+
+    return changed;
 }
 
-char *FileExplorer_GetName(int index)
+static int _file_explorer_strcasecmp(const char *a, const char *b)
 {
-    if (index < filenum)
-        return filename[index];
-    return ".";
+    while (1)
+    {
+        int ca = tolower((unsigned char)*a++);
+        int cb = tolower((unsigned char)*b++);
+
+        if ((ca != cb) || (ca == '\0'))
+            return ca - cb;
+    }
 }
 
-int FileExplorer_GetIsDir(int index)
+static int _file_explorer_order_compare(const void *a, const void *b)
 {
-    if (index < filenum)
-        return list_isdir[index];
-    return 0;
+    int index_a = *(const int *)a;
+    int index_b = *(const int *)b;
+
+    // Folders go first
+    int is_dir_a = file_explorer_list.entries[index_a].is_dir;
+    int is_dir_b = file_explorer_list.entries[index_b].is_dir;
+    if (is_dir_a != is_dir_b)
+        return is_dir_b - is_dir_a;
+
+    return _file_explorer_strcasecmp(
+                    _file_explorer_list_name(&file_explorer_list, index_a),
+                    _file_explorer_list_name(&file_explorer_list, index_b));
 }
 
-int FileExplorer_LoadFolder(void)
+static void _file_explorer_sort(void)
 {
-    //Debug_DebugMsg(exploring_path);
+    // The first entry is always ".."
+    if (file_explorer_list.num_entries > 2)
+    {
+        qsort(&(file_explorer_order[1]), file_explorer_list.num_entries - 1,
+              sizeof(int), _file_explorer_order_compare);
+    }
+}
 
-    FileExplorer_ListFree();
+int FileExplorer_GetNumFiles(void)
+{
+    return file_explorer_list.num_entries;
+}
 
-    DIR *pdir;
+void FileExplorer_SetPath(char *path)
+{
+    if (path)
+        s_strncpy(exploring_path, path, sizeof(exploring_path));
+    else
+        s_strncpy(exploring_path, ".", sizeof(exploring_path));
+}
 
-    pdir = opendir(exploring_path);
-    if (pdir == NULL)
+void FileExplorer_ListFree(void)
+{
+    if (file_explorer_thread != NULL)
     {
-        FileExplorer_ListInit(1);
-        FileExplorer_ListAdd("..", 1); // HACK
-        return 1;
+        SDL_LockMutex(file_explorer_mutex);
+        file_explorer_scan_cancel = 1;
+        SDL_UnlockMutex(file_explorer_mutex);
+
+        SDL_WaitThread(file_explorer_thread, NULL);
+        file_explorer_thread = NULL;
     }
 
-    struct dirent *pent;
-    struct stat statbuf;
+    _file_explorer_list_free(&file_explorer_list);
+    _file_explorer_list_free(&file_explorer_pending);
+
+    free(file_explorer_order);
+    file_explorer_order = NULL;
+}
 
-    // Get number of files...
-    unsigned int count = 0;
-    while ((pent = readdir(pdir)) != NULL)
+char *FileExplorer_GetName(int index)
+{
+    if (index < file_explorer_list.num_entries)
     {
-        count++;
+        return (char *)_file_explorer_list_name(&file_explorer_list,
+                                                file_explorer_order[index]);
     }
+    return ".";
+}
+
+int FileExplorer_GetIsDir(int index)
+{
+    if (index < file_explorer_list.num_entries)
+        return file_explorer_list.entries[file_explorer_order[index]].is_dir;
+    return 0;
+}
 
-    rewinddir(pdir);
+void FileExplorer_LoadFolder(void)
+{
+    FileExplorer_ListFree();
+
+    // Make it go always first. It's there even if the folder can't be opened.
+    file_explorer_order = malloc(sizeof(int));
+    if (file_explorer_order == NULL)
+        return;
+    file_explorer_order[0] = 0;
+    if (_file_explorer_list_add(&file_explorer_list, "..", 1) != 0)
+        return;
+
+    s_strncpy(file_explorer_scan_path, exploring_path,
+              sizeof(file_explorer_scan_path));
 
-    //Debug_DebugMsgArg("Directory files: %d", count);
+    file_explorer_scan_done = 0;
+    file_explorer_scan_cancel = 0;
 
-    if (count == 0)
+    if (file_explorer_mutex == NULL)
+        file_explorer_mutex = SDL_CreateMutex();
+
+    if (file_explorer_mutex != NULL)
     {
-        FileExplorer_ListInit(1);
-        FileExplorer_ListAdd("..", 1); // HACK
-        return 1;
+        file_explorer_thread = SDL_CreateThread(_file_explorer_scan_thread_fn,
+                                                "File explorer", NULL);
     }
 
-    // Allocate enough space and get information...
-    FileExplorer_ListInit(count);
-    FileExplorer_ListAdd("..", 1); // Make it go always first
-    while (1)
+    if (file_explorer_thread == NULL)
     {
-        pent = readdir(pdir);
-        if (pent == NULL)
-            break;
+        Debug_LogMsgArg("%s: Scanning folder in the main thread: %s",
+                        __func__, SDL_GetError());
 
-        char checkingfile[MAX_PATHLEN];
-        snprintf(checkingfile, sizeof(checkingfile), "%s%s", exploring_path,
-                 pent->d_name);
-
-        stat(checkingfile, &statbuf);
-        FileExplorer_ListAdd(pent->d_name, S_ISDIR(statbuf.st_mode) != 0);
-        //Debug_DebugMsgArg("Entry: %d || <%s> dir: %d", filenum, pent->d_name,
-        //                  S_ISDIR(statbuf.st_mode) != 0);
+        int done;
+        _file_explorer_scan_thread_fn(NULL);
+        _file_explorer_take_pending(&done);
+        _file_explorer_sort();
     }
+}
 
-    //Debug_DebugMsgArg("Shown files: %d", filenum);
+int FileExplorer_Poll(void)
+{
+    if (file_explorer_thread == NULL)
+        return 0;
 
-    closedir(pdir);
+    int done;
+    int changed = _file_explorer_take_pending(&done);
+
+    if (done)
+    {
+        SDL_WaitThread(file_explorer_thread, NULL);
+        file_explorer_thread = NULL;
 
-    return filenum;
+        // Take the entries added between the last check and the end
+        _file_explorer_take_pending(&done);
+        _file_explorer_sort();
+
+        changed = 1;
+    }
+
+    return changed;
+}
+
+int FileExplorer_IsScanning(void)
+{
+    return file_explorer_thread != NULL;
 }
 
 void FileExplorer_GoUp(void)
@@ -261,6 +477,7 @@ int FileExplorer_SelectEntry(char *file)
     if (strcmp(file, "..") == 0)
     {
         FileExplorer_GoUp();
+        FileExplorer_LoadFolder();
         return 1;
     }
 
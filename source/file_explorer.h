@@ -12,7 +12,14 @@ void FileExplorer_SetPath(char *path);
 void FileExplorer_ListFree(void);
 char *FileExplorer_GetName(int index);
 int FileExplorer_GetIsDir(int index);
-int FileExplorer_LoadFolder(void);
+// The folder is scanned in a different thread. The entries are added to the
+// list when FileExplorer_Poll() is called, and they are sorted when the scan
+// ends. The first entry is always "..".
+void FileExplorer_LoadFolder(void);
+// Returns 1 if the list has changed since the last call
+int FileExplorer_Poll(void);
+// Returns 1 until the scan has ended and the last entries have been polled
+int FileExplorer_IsScanning(void);
 
 // Returns 1 if dir, 0 if file
 int FileExplorer_SelectEntry(char *file);
@@ -5,6 +5,8 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,8 +15,14 @@
 #include <time.h>
 #include <unistd.h>
 
+#ifndef _WIN32
+# include <sys/mman.h>
+#endif
+
 #include "build_options.h"
+#include "config.h"
 #include "debug_utils.h"
+#include "file_utils.h"
 #include "general_utils.h"
 
 static char running_path[MAX_PATHLEN];
@@ -168,6 +176,297 @@ void FileLoad(const char *filename, void **buffer, unsigned int *size_)
     fclose(f);
 }
 
+#define LARGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#ifndef _WIN32
+
+static size_t LargeAllocSize(size_t size)
+{
+    return (size + LARGE_PAGE_SIZE - 1) & ~(size_t)(LARGE_PAGE_SIZE - 1);
+}
+
+// Returns NULL on error
+static void *LargeAllocHuge(size_t size)
+{
+#ifdef MAP_HUGETLB
+    // Pages reserved by the administrator, they are used right away
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED)
+        return ptr;
+#endif
+
+#ifdef MADV_HUGEPAGE
+    // Transparent huge pages need a region aligned to their size. Map more
+    // than needed and remove what is outside of the aligned region.
+    u8 *base = mmap(NULL, size + LARGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    uintptr_t addr = (uintptr_t)base;
+    u8 *aligned = (u8 *)((addr + LARGE_PAGE_SIZE - 1)
+                         & ~(uintptr_t)(LARGE_PAGE_SIZE - 1));
+    size_t head = aligned - base;
+
+    if (head > 0)
+        munmap(base, head);
+    munmap(aligned + size, LARGE_PAGE_SIZE - head);
+
+    // If this fails the normal pages are used
+    madvise(aligned, size, MADV_HUGEPAGE);
+
+    return aligned;
+#else
+    return NULL;
+#endif
+}
+
+#endif // _WIN32
+
+void *LargeAlloc(size_t size)
+{
+#ifndef _WIN32
+    size = LargeAllocSize(size);
+
+    if (EmulatorConfig.gba_huge_pages)
+    {
+        void *ptr = LargeAllocHuge(size);
+        if (ptr != NULL)
+            return ptr;
+    }
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+#else
+    return calloc(1, size);
+#endif
+}
+
+void LargeFree(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return;
+
+#ifndef _WIN32
+    munmap(ptr, LargeAllocSize(size));
+#else
+    free(ptr);
+#endif
+}
+
+#ifndef _WIN32
+
+static int RegionMakeWritable(void *ptr, size_t size, size_t page_size)
+{
+    uintptr_t start = (uintptr_t)ptr & ~(uintptr_t)(page_size - 1);
+    uintptr_t end = ((uintptr_t)ptr + size + page_size - 1)
+                    & ~(uintptr_t)(page_size - 1);
+
+    return mprotect((void *)start, end - start, PROT_READ | PROT_WRITE);
+}
+
+#endif // _WIN32
+
+int LargeMakeWritable(void *ptr, size_t size)
+{
+#ifndef _WIN32
+    if (RegionMakeWritable(ptr, size, sysconf(_SC_PAGESIZE)) == 0)
+        return 0;
+
+    // Huge pages can only be changed as a whole
+    if ((errno == EINVAL)
+        && (RegionMakeWritable(ptr, size, LARGE_PAGE_SIZE) == 0))
+    {
+        return 0;
+    }
+
+    Debug_LogMsgArg("%s: %s", __func__, strerror(errno));
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+// Fallback used when the file can't be mapped
+static int FileMapAllocate(const char *filename, _file_map_t *map)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", filename);
+        return 1;
+    }
+
+    size_t read_size = map->size;
+    if (read_size > map->map_size)
+        read_size = map->map_size;
+
+    map->data = LargeAlloc(map->map_size);
+    if (map->data == NULL)
+    {
+        Debug_ErrorMsgArg("Not enought memory to load %s!", filename);
+        fclose(f);
+        return 1;
+    }
+
+    if (fread(map->data, read_size, 1, f) != 1)
+    {
+        Debug_ErrorMsgArg("Error while reading: %s", filename);
+        fclose(f);
+        LargeFree(map->data, map->map_size);
+        map->data = NULL;
+        return 1;
+    }
+
+    fclose(f);
+
+    map->mapped = 0;
+    return 0;
+}
+
+int FileMap(const char *filename, size_t map_size, _file_map_t *map)
+{
+    map->data = NULL;
+    map->map_size = map_size;
+    map->size = 0;
+    map->mapped = 0;
+
+    struct stat s;
+    if (stat(filename, &s) != 0)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", filename);
+        return 1;
+    }
+
+    map->size = s.st_size;
+    if (map->size == 0)
+    {
+        Debug_ErrorMsgArg("Size of %s is 0!", filename);
+        return 1;
+    }
+
+#ifndef _WIN32
+    if (EmulatorConfig.gba_huge_pages)
+        return FileMapAllocate(filename, map);
+
+    // Reserve the whole region with zeroed pages, then replace the start of it
+    // with the file. The pages of the file are only read when they are used.
+    size_t file_map_size = map->size;
+    if (file_map_size > map_size)
+        file_map_size = map_size;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0)
+    {
+        u8 *base = mmap(NULL, map_size, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED)
+        {
+            void *file = mmap(base, file_map_size, PROT_READ,
+                              MAP_PRIVATE | MAP_FIXED, fd, 0);
+            if (file != MAP_FAILED)
+            {
+                close(fd);
+                map->data = base;
+                map->mapped = 1;
+                return 0;
+            }
+
+            munmap(base, map_size);
+        }
+
+        close(fd);
+    }
+#endif
+
+    return FileMapAllocate(filename, map);
+}
+
+void FileUnmap(_file_map_t *map)
+{
+    if (map->data == NULL)
+        return;
+
+#ifndef _WIN32
+    if (map->mapped)
+        munmap(map->data, map->map_size);
+    else
+        LargeFree(map->data, map->map_size);
+#else
+    LargeFree(map->data, map->map_size);
+#endif
+
+    map->data = NULL;
+    map->mapped = 0;
+}
+
+#ifndef _WIN32
+
+void *FileMapWritable(const char *filename, size_t size)
+{
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        Debug_LogMsgArg("%s couldn't be opened!", filename);
+        return NULL;
+    }
+
+    struct stat s;
+    if (fstat(fd, &s) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *ptr = MAP_FAILED;
+
+    if ((size_t)s.st_size == size)
+    {
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    else if (s.st_size == 0) // Just created, it's filled with zeroes
+    {
+        if (ftruncate(fd, size) == 0)
+            ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    close(fd); // The mapping is kept after closing the file
+
+    return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+void FileMapWritableSync(void *ptr, size_t size, int wait)
+{
+    if (msync(ptr, size, wait ? MS_SYNC : MS_ASYNC) != 0)
+        Debug_LogMsgArg("%s: msync() failed", __func__);
+}
+
+void FileUnmapWritable(void *ptr, size_t size)
+{
+    FileMapWritableSync(ptr, size, 1);
+    munmap(ptr, size);
+}
+
+#else // _WIN32
+
+void *FileMapWritable(unused__ const char *filename, unused__ size_t size)
+{
+    return NULL;
+}
+
+void FileMapWritableSync(unused__ void *ptr, unused__ size_t size,
+                         unused__ int wait)
+{
+}
+
+void FileUnmapWritable(unused__ void *ptr, unused__ size_t size)
+{
+}
+
+#endif // _WIN32
+
 int FileExists(const char *filename)
 {
     FILE *f = fopen(filename, "rb");
@@ -235,7 +534,8 @@ int DirCreate(char *path)
 
 static char _fu_filename[MAX_PATHLEN];
 
-char *FU_GetNewTimestampFilename(const char *basename)
+char *FU_GetNewTimestampFilenameExt(const char *basename,
+                                    const char *extension)
 {
     long long int number = 0;
 
@@ -253,8 +553,9 @@ char *FU_GetNewTimestampFilename(const char *basename)
     // same second.
     while (1)
     {
-        snprintf(_fu_filename, sizeof(_fu_filename), "%s%s_%s_%lld.png",
-                 DirGetScreenshotFolderPath(), basename, timestamp, number);
+        snprintf(_fu_filename, sizeof(_fu_filename), "%s%s_%s_%lld.%s",
+                 DirGetScreenshotFolderPath(), basename, timestamp, number,
+                 extension);
 
         FILE *file = fopen(_fu_filename, "rb");
         if (file == NULL)
@@ -266,3 +567,8 @@ char *FU_GetNewTimestampFilename(const char *basename)
 
     return _fu_filename;
 }
+
+char *FU_GetNewTimestampFilename(const char *basename)
+{
+    return FU_GetNewTimestampFilenameExt(basename, "png");
+}
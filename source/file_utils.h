@@ -7,6 +7,8 @@
 #ifndef FILE_UTILS__
 #define FILE_UTILS__
 
+#include <stddef.h>
+
 void DirSetRunningPath(char *path);
 char *DirGetRunningPath(void);
 char *DirGetBiosFolderPath(void);
@@ -15,11 +17,56 @@ char *DirGetScreenshotFolderPath(void);
 void FileLoad_NoError(const char *filename, void **buffer, unsigned int *size_);
 void FileLoad(const char *filename, void **buffer, unsigned int *size_);
 
+typedef struct
+{
+    void *data;
+    size_t map_size; // Size of the region pointed by "data"
+    unsigned int size; // Size of the file
+    int mapped; // 1 if the file is mapped in memory, 0 if it has been loaded
+} _file_map_t;
+
+// Maps a file in memory as read-only, sharing its pages with any other process
+// that maps it. The region is "map_size" bytes long. Anything after the end of
+// the file reads as zero, and files bigger than the region are truncated. If
+// the file can't be mapped it's loaded into an allocated region. That is also
+// done when huge pages are enabled, the pages of a file can't be huge. The
+// mapping is private, LargeMakeWritable() can be used on it. Returns 0 on
+// success.
+int FileMap(const char *filename, size_t map_size, _file_map_t *map);
+void FileUnmap(_file_map_t *map);
+
+// Maps a file in memory for reading and writing. The changes are written to the
+// file by the system even if the emulator crashes. If the file doesn't exist it
+// is created filled with zeroes of "size" bytes. If it exists, it's only mapped
+// if its size is "size". Returns NULL on error, or if the system can't do it.
+void *FileMapWritable(const char *filename, size_t size);
+// Writes the modified pages to the disk. If "wait" is 0 it only starts writing
+// them, so it doesn't block.
+void FileMapWritableSync(void *ptr, size_t size, int wait);
+void FileUnmapWritable(void *ptr, size_t size); // Waits for the data to be saved
+
+// Allocates a zeroed region for big buffers that are accessed randomly, like
+// the ROM of the GBA. If EmulatorConfig.gba_huge_pages is set it's backed by
+// 2 MiB pages when the system allows it, which saves a lot of TLB misses. The
+// region has to be freed with LargeFree() with the same size.
+void *LargeAlloc(size_t size);
+void LargeFree(void *ptr, size_t size);
+
+// Allows writing to [ptr, ptr + size) in a region returned by FileMap() or
+// LargeAlloc(). The pages of a mapped file are copied by the system the first
+// time they are written, so the file and the pages that aren't written are
+// still shared. Returns 0 on success.
+int LargeMakeWritable(void *ptr, size_t size);
+
 int FileExists(const char *filename); // Returns 1 if file exists
 
 int DirCheckExistence(char *path);
 int DirCreate(char *path);
 
+// Returns a new file name in the screenshots folder. The "png" extension is
+// used unless one is specified.
 char *FU_GetNewTimestampFilename(const char *basename);
+char *FU_GetNewTimestampFilenameExt(const char *basename,
+                                    const char *extension);
 
 #endif // FILE_UTILS__
@@ -0,0 +1,503 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "debug_utils.h"
+#include "flac_utils.h"
+#include "general_utils.h"
+
+// https://xiph.org/flac/format.html
+
+#define FLAC_BITS_PER_SAMPLE    (16)
+#define FLAC_CHANNELS           (2)
+
+#define FLAC_MAX_FIXED_ORDER    (4)
+#define FLAC_MAX_RICE_PARAM     (14)
+
+// Channel assignments
+#define FLAC_CHANNELS_INDEPENDENT   (1)
+#define FLAC_CHANNELS_LEFT_SIDE     (8)
+#define FLAC_CHANNELS_RIGHT_SIDE    (9)
+#define FLAC_CHANNELS_MID_SIDE      (10)
+
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+    u8 *data;
+    u32 size; // Bytes written
+    u64 acc;
+    int acc_bits;
+} _flac_bits_t;
+
+static void flac_bits_init(_flac_bits_t *b, u8 *data)
+{
+    b->data = data;
+    b->size = 0;
+    b->acc = 0;
+    b->acc_bits = 0;
+}
+
+// Up to 32 bits at a time
+static void flac_bits_put(_flac_bits_t *b, u32 value, int bits)
+{
+    if (bits == 0)
+        return;
+
+    u64 mask = (bits == 32) ? 0xFFFFFFFFULL : ((1ULL << bits) - 1);
+
+    b->acc = (b->acc << bits) | (value & mask);
+    b->acc_bits += bits;
+
+    while (b->acc_bits >= 8)
+    {
+        b->acc_bits -= 8;
+        b->data[b->size++] = (u8)(b->acc >> b->acc_bits);
+    }
+}
+
+static void flac_bits_align(_flac_bits_t *b)
+{
+    if (b->acc_bits > 0)
+        flac_bits_put(b, 0, 8 - b->acc_bits);
+}
+
+static void flac_bits_put_signed(_flac_bits_t *b, s32 value, int bits)
+{
+    flac_bits_put(b, (u32)value, bits);
+}
+
+static void flac_bits_put_rice(_flac_bits_t *b, s32 value, int param)
+{
+    u32 u = ((u32)value << 1) ^ (u32)(value >> 31);
+    u32 q = u >> param;
+
+    while (q >= 31)
+    {
+        flac_bits_put(b, 0, 31);
+        q -= 31;
+    }
+    flac_bits_put(b, 1, q + 1);
+    flac_bits_put(b, u, param);
+}
+
+// Frame numbers are coded like UTF-8 characters
+static void flac_bits_put_utf8(_flac_bits_t *b, u32 value)
+{
+    if (value < 0x80)
+    {
+        flac_bits_put(b, value, 8);
+        return;
+    }
+
+    int bytes = 2;
+    while ((bytes < 6) && (value >= (1U << (5 * bytes + 1))))
+        bytes++;
+
+    int shift = 6 * (bytes - 1);
+    u32 prefix = (0xFF00 >> bytes) & 0xFF;
+    flac_bits_put(b, prefix | (value >> shift), 8);
+
+    while (shift > 0)
+    {
+        shift -= 6;
+        flac_bits_put(b, 0x80 | ((value >> shift) & 0x3F), 8);
+    }
+}
+
+static u8 flac_crc8(const u8 *data, u32 size)
+{
+    u32 crc = 0;
+
+    for (u32 i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        crc &= 0xFF;
+    }
+
+    return crc;
+}
+
+static u16 flac_crc16(const u8 *data, u32 size)
+{
+    u32 crc = 0;
+
+    for (u32 i = 0; i < size; i++)
+    {
+        crc ^= (u32)data[i] << 8;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) : (crc << 1);
+        crc &= 0xFFFF;
+    }
+
+    return crc;
+}
+
+//------------------------------------------------------------------------------
+
+typedef enum
+{
+    FLAC_SUBFRAME_CONSTANT,
+    FLAC_SUBFRAME_VERBATIM,
+    FLAC_SUBFRAME_FIXED,
+} _flac_subframe_type_e;
+
+typedef struct
+{
+    _flac_subframe_type_e type;
+    int order;
+    int rice_param;
+    u32 bits; // Size of the encoded subframe
+} _flac_subframe_t;
+
+static s32 flac_fixed_residual(const s32 *x, u32 i, int order)
+{
+    switch (order)
+    {
+        case 0:
+            return x[i];
+        case 1:
+            return x[i] - x[i - 1];
+        case 2:
+            return x[i] - 2 * x[i - 1] + x[i - 2];
+        case 3:
+            return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+        default:
+            return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3]
+                   + x[i - 4];
+    }
+}
+
+static u32 flac_rice_bits(const s32 *x, u32 n, int order, int param)
+{
+    u32 bits = 0;
+
+    for (u32 i = order; i < n; i++)
+    {
+        s32 r = flac_fixed_residual(x, i, order);
+        u32 u = ((u32)r << 1) ^ (u32)(r >> 31);
+        bits += (u >> param) + 1 + param;
+    }
+
+    return bits;
+}
+
+static void flac_subframe_analyze(const s32 *x, u32 n, int bps,
+                                  _flac_subframe_t *sf)
+{
+    // Subframe header: 8 bits
+
+    int constant = 1;
+    for (u32 i = 1; i < n; i++)
+    {
+        if (x[i] != x[0])
+        {
+            constant = 0;
+            break;
+        }
+    }
+
+    if (constant)
+    {
+        sf->type = FLAC_SUBFRAME_CONSTANT;
+        sf->bits = 8 + bps;
+        return;
+    }
+
+    sf->type = FLAC_SUBFRAME_VERBATIM;
+    sf->bits = 8 + (n * bps);
+
+    // Pick the predictor with the smallest residual
+
+    int max_order = FLAC_MAX_FIXED_ORDER;
+    if ((u32)max_order >= n)
+        max_order = n - 1;
+
+    u64 best_sum = UINT64_MAX;
+    int order = 0;
+
+    for (int o = 0; o <= max_order; o++)
+    {
+        u64 sum = 0;
+        for (u32 i = max_order; i < n; i++)
+        {
+            s32 r = flac_fixed_residual(x, i, o);
+            sum += (r < 0) ? -(s64)r : r;
+        }
+
+        if (sum < best_sum)
+        {
+            best_sum = sum;
+            order = o;
+        }
+    }
+
+    // Estimate the Rice parameter from the mean of the residual and check the
+    // values around it.
+
+    u64 mean = (2 * best_sum) / (n - max_order);
+    int estimate = 0;
+    while ((estimate < FLAC_MAX_RICE_PARAM)
+           && ((1ULL << (estimate + 1)) <= mean))
+    {
+        estimate++;
+    }
+
+    // Warmup samples, coding method, partition order and Rice parameter
+    u32 header_bits = 8 + (order * bps) + 2 + 4 + 4;
+
+    for (int param = estimate - 1; param <= estimate + 1; param++)
+    {
+        if ((param < 0) || (param > FLAC_MAX_RICE_PARAM))
+            continue;
+
+        u32 bits = header_bits + flac_rice_bits(x, n, order, param);
+        if (bits < sf->bits)
+        {
+            sf->type = FLAC_SUBFRAME_FIXED;
+            sf->order = order;
+            sf->rice_param = param;
+            sf->bits = bits;
+        }
+    }
+}
+
+static void flac_subframe_write(_flac_bits_t *b, const s32 *x, u32 n, int bps,
+                                const _flac_subframe_t *sf)
+{
+    flac_bits_put(b, 0, 1); // Padding
+
+    switch (sf->type)
+    {
+        case FLAC_SUBFRAME_CONSTANT:
+            flac_bits_put(b, 0x00, 6);
+            flac_bits_put(b, 0, 1); // No wasted bits
+            flac_bits_put_signed(b, x[0], bps);
+            break;
+
+        case FLAC_SUBFRAME_VERBATIM:
+            flac_bits_put(b, 0x01, 6);
+            flac_bits_put(b, 0, 1);
+            for (u32 i = 0; i < n; i++)
+                flac_bits_put_signed(b, x[i], bps);
+            break;
+
+        case FLAC_SUBFRAME_FIXED:
+            flac_bits_put(b, 0x08 | sf->order, 6);
+            flac_bits_put(b, 0, 1);
+            for (int i = 0; i < sf->order; i++)
+                flac_bits_put_signed(b, x[i], bps);
+
+            flac_bits_put(b, 0, 2); // Rice coding, 4 bit parameters
+            flac_bits_put(b, 0, 4); // Partition order 0
+            flac_bits_put(b, sf->rice_param, 4);
+            for (u32 i = sf->order; i < n; i++)
+            {
+                flac_bits_put_rice(b, flac_fixed_residual(x, i, sf->order),
+                                   sf->rice_param);
+            }
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static int flac_write_streaminfo(_flac_encoder_t *enc)
+{
+    u8 data[42];
+    _flac_bits_t b;
+    flac_bits_init(&b, data);
+
+    u32 block_size = FLAC_BLOCK_FRAMES;
+    if (enc->total_frames < FLAC_BLOCK_FRAMES)
+        block_size = enc->total_frames;
+
+    flac_bits_put(&b, 0x664C6143, 32); // "fLaC"
+
+    flac_bits_put(&b, 1, 1); // Last metadata block
+    flac_bits_put(&b, 0, 7); // STREAMINFO
+    flac_bits_put(&b, 34, 24);
+
+    flac_bits_put(&b, block_size, 16);
+    flac_bits_put(&b, block_size, 16);
+    flac_bits_put(&b, enc->min_frame_size, 24);
+    flac_bits_put(&b, enc->max_frame_size, 24);
+    flac_bits_put(&b, enc->sample_rate, 20);
+    flac_bits_put(&b, FLAC_CHANNELS - 1, 3);
+    flac_bits_put(&b, FLAC_BITS_PER_SAMPLE - 1, 5);
+    flac_bits_put(&b, (u32)(enc->total_frames >> 32), 4);
+    flac_bits_put(&b, (u32)enc->total_frames, 32);
+
+    // The MD5 signature of the audio data is optional
+    for (int i = 0; i < 4; i++)
+        flac_bits_put(&b, 0, 32);
+
+    if (fwrite(data, sizeof(data), 1, enc->file) != 1)
+        return 1;
+
+    return 0;
+}
+
+static void flac_encode_block(_flac_encoder_t *enc)
+{
+    static s32 left[FLAC_BLOCK_FRAMES];
+    static s32 right[FLAC_BLOCK_FRAMES];
+    static s32 mid[FLAC_BLOCK_FRAMES];
+    static s32 side[FLAC_BLOCK_FRAMES];
+
+    u32 n = enc->block_frames;
+    if (n == 0)
+        return;
+
+    for (u32 i = 0; i < n; i++)
+    {
+        left[i] = enc->block[i * 2];
+        right[i] = enc->block[i * 2 + 1];
+        mid[i] = (left[i] + right[i]) >> 1;
+        side[i] = left[i] - right[i];
+    }
+
+    const int bps = FLAC_BITS_PER_SAMPLE;
+
+    _flac_subframe_t sf_left, sf_right, sf_mid, sf_side;
+    flac_subframe_analyze(left, n, bps, &sf_left);
+    flac_subframe_analyze(right, n, bps, &sf_right);
+    flac_subframe_analyze(mid, n, bps, &sf_mid);
+    flac_subframe_analyze(side, n, bps + 1, &sf_side);
+
+    // Pick the stereo mode that needs less space
+
+    int assignment = FLAC_CHANNELS_INDEPENDENT;
+    u32 bits = sf_left.bits + sf_right.bits;
+
+    if (sf_left.bits + sf_side.bits < bits)
+    {
+        assignment = FLAC_CHANNELS_LEFT_SIDE;
+        bits = sf_left.bits + sf_side.bits;
+    }
+    if (sf_right.bits + sf_side.bits < bits)
+    {
+        assignment = FLAC_CHANNELS_RIGHT_SIDE;
+        bits = sf_right.bits + sf_side.bits;
+    }
+    if (sf_mid.bits + sf_side.bits < bits)
+    {
+        assignment = FLAC_CHANNELS_MID_SIDE;
+        bits = sf_mid.bits + sf_side.bits;
+    }
+
+    _flac_bits_t b;
+    flac_bits_init(&b, enc->frame);
+
+    // Frame header
+
+    int block_size_code = (n == FLAC_BLOCK_FRAMES) ? 12 : 7;
+
+    flac_bits_put(&b, 0x3FFE, 14); // Sync code
+    flac_bits_put(&b, 0, 1);
+    flac_bits_put(&b, 0, 1); // Fixed block size
+    flac_bits_put(&b, block_size_code, 4);
+    flac_bits_put(&b, 0, 4); // Sample rate from STREAMINFO
+    flac_bits_put(&b, assignment, 4);
+    flac_bits_put(&b, 4, 3); // 16 bits per sample
+    flac_bits_put(&b, 0, 1);
+    flac_bits_put_utf8(&b, enc->frame_number);
+    if (block_size_code == 7)
+        flac_bits_put(&b, n - 1, 16);
+    flac_bits_put(&b, flac_crc8(b.data, b.size), 8);
+
+    // Subframes
+
+    switch (assignment)
+    {
+        case FLAC_CHANNELS_INDEPENDENT:
+            flac_subframe_write(&b, left, n, bps, &sf_left);
+            flac_subframe_write(&b, right, n, bps, &sf_right);
+            break;
+        case FLAC_CHANNELS_LEFT_SIDE:
+            flac_subframe_write(&b, left, n, bps, &sf_left);
+            flac_subframe_write(&b, side, n, bps + 1, &sf_side);
+            break;
+        case FLAC_CHANNELS_RIGHT_SIDE:
+            flac_subframe_write(&b, side, n, bps + 1, &sf_side);
+            flac_subframe_write(&b, right, n, bps, &sf_right);
+            break;
+        case FLAC_CHANNELS_MID_SIDE:
+            flac_subframe_write(&b, mid, n, bps, &sf_mid);
+            flac_subframe_write(&b, side, n, bps + 1, &sf_side);
+            break;
+    }
+
+    flac_bits_align(&b);
+    flac_bits_put(&b, flac_crc16(b.data, b.size), 16);
+
+    if (fwrite(enc->frame, b.size, 1, enc->file) != 1)
+        Debug_LogMsgArg("%s: Couldn't write to file", __func__);
+
+    if ((enc->min_frame_size == 0) || (b.size < enc->min_frame_size))
+        enc->min_frame_size = b.size;
+    if (b.size > enc->max_frame_size)
+        enc->max_frame_size = b.size;
+
+    enc->total_frames += n;
+    enc->frame_number++;
+    enc->block_frames = 0;
+}
+
+//------------------------------------------------------------------------------
+
+int FLAC_EncoderStart(_flac_encoder_t *enc, FILE *file, u32 sample_rate)
+{
+    enc->file = file;
+    enc->sample_rate = sample_rate;
+    enc->block_frames = 0;
+    enc->total_frames = 0;
+    enc->frame_number = 0;
+    enc->min_frame_size = 0;
+    enc->max_frame_size = 0;
+
+    // It is written again at the end, when the size of the stream is known
+    return flac_write_streaminfo(enc);
+}
+
+void FLAC_EncoderWrite(_flac_encoder_t *enc, const s16 *samples, u32 frames)
+{
+    while (frames > 0)
+    {
+        u32 count = FLAC_BLOCK_FRAMES - enc->block_frames;
+        if (count > frames)
+            count = frames;
+
+        memcpy(&enc->block[enc->block_frames * 2], samples,
+               count * 2 * sizeof(s16));
+
+        enc->block_frames += count;
+        samples += count * 2;
+        frames -= count;
+
+        if (enc->block_frames == FLAC_BLOCK_FRAMES)
+            flac_encode_block(enc);
+    }
+}
+
+int FLAC_EncoderEnd(_flac_encoder_t *enc)
+{
+    flac_encode_block(enc);
+
+    if (fseek(enc->file, 0, SEEK_SET) != 0)
+        return 1;
+
+    int ret = flac_write_streaminfo(enc);
+
+    fseek(enc->file, 0, SEEK_END);
+
+    return ret;
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef FLAC_UTILS__
+#define FLAC_UTILS__
+
+#include <stdio.h>
+
+#include "general_utils.h"
+
+// Minimal FLAC encoder for 16 bit stereo streams. Each block uses the best
+// fixed predictor (orders 0 to 4) and stereo decorrelation mode, with the
+// residual coded as a single Rice partition. The output is much bigger than
+// the one of the reference encoder, but it is fast and it is enough to make
+// long recordings manageable.
+
+#define FLAC_BLOCK_FRAMES   (4096)
+
+// Big enough for a verbatim block with a 17 bit side channel, plus headers
+#define FLAC_FRAME_MAX_BYTES    (((FLAC_BLOCK_FRAMES * 2 * 17) / 8) + 64)
+
+typedef struct
+{
+    FILE *file;
+    u32 sample_rate;
+
+    s16 block[FLAC_BLOCK_FRAMES * 2]; // Left and right, interleaved
+    u32 block_frames;
+
+    u64 total_frames;
+    u32 frame_number;
+    u32 min_frame_size;
+    u32 max_frame_size;
+
+    u8 frame[FLAC_FRAME_MAX_BYTES];
+} _flac_encoder_t;
+
+// Writes the stream header to a file opened for writing in binary mode.
+// Returns 1 on error, 0 if OK.
+int FLAC_EncoderStart(_flac_encoder_t *enc, FILE *file, u32 sample_rate);
+
+void FLAC_EncoderWrite(_flac_encoder_t *enc, const s16 *samples, u32 frames);
+
+// Encodes the remaining samples and updates the stream header, the file isn't
+// closed. Returns 1 on error, 0 if OK.
+int FLAC_EncoderEnd(_flac_encoder_t *enc);
+
+#endif // FLAC_UTILS__
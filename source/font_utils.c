@@ -23,6 +23,132 @@
 
 extern const uint8_t fnt_data[]; // in font_data.c
 
+// The characters are expanded from the font texture to the format of the
+// buffers (3 bytes per pixel) the first time they are used, so that they can be
+// drawn with one memcpy() per row. There is one atlas with the original colors
+// and a few with colors applied. The latter are reused in a round-robin way.
+
+#define FONT_GLYPH_PITCH        (FONT_WIDTH * 3)
+#define FONT_GLYPH_SIZE         (FONT_GLYPH_PITCH * FONT_HEIGHT)
+
+#define FONT_COLOR_ATLASES      (8)
+
+typedef struct {
+    int color; // -1 if the atlas has the original colors
+    u8 ready[256];
+    u8 glyphs[256][FONT_GLYPH_SIZE];
+} _fu_atlas_t;
+
+static _fu_atlas_t fu_atlas_plain = { -1, { 0 }, { { 0 } } };
+
+static _fu_atlas_t fu_atlas_color[FONT_COLOR_ATLASES];
+static int fu_atlas_color_used;
+static int fu_atlas_color_next;
+
+static _fu_atlas_t *FU_AtlasColorGet(int color)
+{
+    color &= 0xFFFFFF;
+
+    for (int i = 0; i < fu_atlas_color_used; i++)
+    {
+        if (fu_atlas_color[i].color == color)
+            return &fu_atlas_color[i];
+    }
+
+    _fu_atlas_t *atlas = &fu_atlas_color[fu_atlas_color_next];
+
+    fu_atlas_color_next = (fu_atlas_color_next + 1) % FONT_COLOR_ATLASES;
+    if (fu_atlas_color_used < FONT_COLOR_ATLASES)
+        fu_atlas_color_used++;
+
+    atlas->color = color;
+    memset(atlas->ready, 0, sizeof(atlas->ready));
+
+    return atlas;
+}
+
+static const u8 *FU_GlyphGet(_fu_atlas_t *atlas, unsigned char c)
+{
+    u8 *glyph = atlas->glyphs[c];
+
+    if (atlas->ready[c])
+        return glyph;
+
+    int texx = (c % FONT_CHARS_IN_ROW) * FONT_WIDTH;
+    int texy = (c / FONT_CHARS_IN_ROW) * FONT_HEIGHT;
+
+    // Font is 4 bytes per pixel
+    int tex_offset = (texy * (FONT_CHARS_IN_ROW * FONT_WIDTH * 4)) + texx * 4;
+
+    int color = atlas->color;
+    u8 *dst = glyph;
+
+    for (int y = 0; y < FONT_HEIGHT; y++)
+    {
+        const u8 *texcopy = &(fnt_data[tex_offset]);
+
+        for (int x = 0; x < FONT_WIDTH; x++)
+        {
+            int r = *texcopy++;
+            int g = *texcopy++;
+            int b = *texcopy++;
+
+            if (color == -1)
+            {
+                *dst++ = r;
+                *dst++ = g;
+                *dst++ = b;
+            }
+            else
+            {
+                *dst++ = (r * (color & 0xFF)) >> 8;
+                *dst++ = (g * ((color >> 8) & 0xFF)) >> 8;
+                *dst++ = (b * ((color >> 16) & 0xFF)) >> 8;
+            }
+
+            texcopy++; // Skip alpha
+        }
+
+        tex_offset += FONT_CHARS_IN_ROW * FONT_WIDTH * 4;
+    }
+
+    atlas->ready[c] = 1;
+
+    return glyph;
+}
+
+static void FU_GlyphDraw(char *buffer, int bufw, int tx, int ty,
+                         const u8 *glyph)
+{
+    char *dst = &(buffer[((ty * bufw) + tx) * 3]); // 3 bytes per pixel
+
+    for (int y = 0; y < FONT_HEIGHT; y++)
+    {
+        memcpy(dst, glyph, FONT_GLYPH_PITCH);
+        glyph += FONT_GLYPH_PITCH;
+        dst += bufw * 3;
+    }
+}
+
+static void FU_PrintString(char *buffer, int bufw, int tx, int ty,
+                           _fu_atlas_t *atlas, const char *txt)
+{
+    while (1)
+    {
+        unsigned char c = *txt++;
+
+        if (c == '\0')
+            break;
+
+        if ((tx + FONT_WIDTH) > bufw)
+            break;
+
+        FU_GlyphDraw(buffer, bufw, tx, ty, FU_GlyphGet(atlas, c));
+
+        tx += FONT_WIDTH;
+    }
+}
+
 //------------------------------------------------------------------------------
 
 int FU_Print(char *buffer, int bufw, int bufh, int tx, int ty,
@@ -42,41 +168,7 @@ int FU_Print(char *buffer, int bufw, int bufh, int tx, int ty,
     if ((ty + FONT_HEIGHT) > bufh)
         return 0; // Multiline is not supported
 
-    int i = 0;
-    while (1)
-    {
-        unsigned char c = txtbuffer[i++];
-
-        if (c == '\0')
-            break;
-
-        if ((tx + FONT_WIDTH) > bufw)
-            break;
-
-        int texx = (c % FONT_CHARS_IN_ROW) * FONT_WIDTH;
-        int texy = (c / FONT_CHARS_IN_ROW) * FONT_HEIGHT;
-
-        int tex_offset = (texy * (FONT_CHARS_IN_ROW * FONT_WIDTH * 4))
-                         + texx * 4;             // Font is 4 bytes per pixel
-        int buf_offset = ((ty * bufw) + tx) * 3; // Buffer is 3 bytes per pixel
-
-        for (int y = 0; y < FONT_HEIGHT; y++)
-        {
-            char *bufcopy = &(buffer[buf_offset]);
-            const u8 *texcopy = &(fnt_data[tex_offset]);
-
-            for (int x = 0; x < FONT_WIDTH; x++)
-            {
-                *bufcopy++ = *texcopy++;
-                *bufcopy++ = *texcopy++;
-                *bufcopy++ = *texcopy++;
-                texcopy++;
-            }
-            tex_offset += (FONT_CHARS_IN_ROW * FONT_WIDTH * 4);
-            buf_offset += bufw * 3;
-        }
-        tx += FONT_WIDTH;
-    }
+    FU_PrintString(buffer, bufw, tx, ty, &fu_atlas_plain, txtbuffer);
 
 #if 0
     // Print font
@@ -114,46 +206,8 @@ int FU_PrintColor(char *buffer, int bufw, int bufh, int tx, int ty, int color,
     if ((ty + FONT_HEIGHT) > bufh)
         return 0; // Multiline is not supported
 
-    int i = 0;
-    while (1)
-    {
-        unsigned char c = txtbuffer[i++];
-
-        if (c == '\0')
-            break;
-
-        if ((tx + FONT_WIDTH) > bufw)
-            break;
-
-        int texx = (c % FONT_CHARS_IN_ROW) * FONT_WIDTH;
-        int texy = (c / FONT_CHARS_IN_ROW) * FONT_HEIGHT;
-
-        int tex_offset = (texy * (FONT_CHARS_IN_ROW * FONT_WIDTH * 4))
-                         + texx * 4;             // Font is 4 bytes per pixel
-        int buf_offset = ((ty * bufw) + tx) * 3; // Buffer is 3 bytes per pixel
-
-        for (int y = 0; y < FONT_HEIGHT; y++)
-        {
-            char *bufcopy = &(buffer[buf_offset]);
-            const u8 *texcopy = &(fnt_data[tex_offset]);
-
-            for (int x = 0; x < FONT_WIDTH; x++)
-            {
-                int r = (uint8_t)(*texcopy++);
-                int g = (uint8_t)(*texcopy++);
-                int b = (uint8_t)(*texcopy++);
-
-                *bufcopy++ = (r * (color & 0xFF)) >> 8;
-                *bufcopy++ = (g * ((color >> 8) & 0xFF)) >> 8;
-                *bufcopy++ = (b * ((color >> 16) & 0xFF)) >> 8;
-
-                texcopy++; // Skip alpha
-            }
-            tex_offset += FONT_CHARS_IN_ROW * FONT_WIDTH * 4;
-            buf_offset += bufw * 3;
-        }
-        tx += FONT_WIDTH;
-    }
+    FU_PrintString(buffer, bufw, tx, ty, FU_AtlasColorGet(color),
+                   txtbuffer);
 
     return ret;
 }
@@ -172,34 +226,8 @@ int FU_PrintChar(char *buffer, int bufw, int bufh, int tx, int ty,
     if ((tx + FONT_WIDTH) > bufw)
         return 0;
 
-    int texx = (c % FONT_CHARS_IN_ROW) * FONT_WIDTH;
-    int texy = (c / FONT_CHARS_IN_ROW) * FONT_HEIGHT;
-
-    // Font is 4 bytes per pixel
-    int tex_offset = (texy * (FONT_CHARS_IN_ROW * FONT_WIDTH * 4)) + texx * 4;
-    int buf_offset = ((ty * bufw) + tx) * 3; // Buffer is 3 bytes per pixel
-
-    for (int y = 0; y < FONT_HEIGHT; y++)
-    {
-        char *bufcopy = &(buffer[buf_offset]);
-        const u8 *texcopy = &(fnt_data[tex_offset]);
-
-        for (int x = 0; x < FONT_WIDTH; x++)
-        {
-            int r = (uint8_t)(*texcopy++);
-            int g = (uint8_t)(*texcopy++);
-            int b = (uint8_t)(*texcopy++);
-
-            *bufcopy++ = (r * (color & 0xFF)) >> 8;
-            *bufcopy++ = (g * ((color >> 8) & 0xFF)) >> 8;
-            *bufcopy++ = (b * ((color >> 16) & 0xFF)) >> 8;
-
-            texcopy++; // Skip alpha
-        }
-
-        tex_offset += (FONT_CHARS_IN_ROW * FONT_WIDTH * 4);
-        buf_offset += bufw * 3;
-    }
+    FU_GlyphDraw(buffer, bufw, tx, ty,
+                 FU_GlyphGet(FU_AtlasColorGet(color), c));
 
     return 1;
 }
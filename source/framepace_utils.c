@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <SDL.h>
+
+#include "config.h"
+#include "debug_utils.h"
+#include "framepace_utils.h"
+#include "window_handler.h"
+
+#define FRAMEPACE_FRAMES_PER_SECOND (60)
+
+// The wait ends by spinning when there are less than this many milliseconds
+// left, SDL_Delay() wakes up too late to be used until the end.
+#define FRAMEPACE_SPIN_MS           (2)
+
+// In VSync mode, refresh rates in this range are considered to be the same as
+// the frame rate of the emulation.
+#define FRAMEPACE_VSYNC_MIN_HZ      (59)
+#define FRAMEPACE_VSYNC_MAX_HZ      (61)
+
+static _framepace_mode_e framepace_mode = FRAMEPACE_TIMER;
+static int framepace_vsync_locked; // 1 if the display paces the loop
+
+static Uint64 framepace_frequency;
+
+// Time of the start of the next frame. The length of a frame isn't a whole
+// amount of counter ticks, so the remainder is accumulated separately.
+static Uint64 framepace_next;
+static Uint64 framepace_next_remainder;
+
+//------------------------------------------------------------------------------
+
+static void _framepace_advance(void)
+{
+    framepace_next += framepace_frequency / FRAMEPACE_FRAMES_PER_SECOND;
+    framepace_next_remainder += framepace_frequency
+                                % FRAMEPACE_FRAMES_PER_SECOND;
+
+    if (framepace_next_remainder >= FRAMEPACE_FRAMES_PER_SECOND)
+    {
+        framepace_next_remainder -= FRAMEPACE_FRAMES_PER_SECOND;
+        framepace_next++;
+    }
+}
+
+static void _framepace_wait_until(Uint64 target)
+{
+    while (1)
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= target)
+            return;
+
+        Uint64 remaining_ms = ((target - now) * 1000) / framepace_frequency;
+        if (remaining_ms > FRAMEPACE_SPIN_MS)
+            SDL_Delay(remaining_ms - FRAMEPACE_SPIN_MS);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void FramePace_Init(int window)
+{
+    framepace_frequency = SDL_GetPerformanceFrequency();
+    framepace_mode = EmulatorConfig.frame_pacing;
+    framepace_vsync_locked = 0;
+
+    if (framepace_mode == FRAMEPACE_VSYNC)
+    {
+        if (WH_SetVSync(window, 1) != 0)
+        {
+            Debug_LogMsgArg("VSync not available, using the timer to pace "
+                            "the emulation.");
+            framepace_mode = FRAMEPACE_TIMER;
+        }
+        else
+        {
+            // The emulation thread isn't paced by the presentation of the
+            // window, it's presented in parallel.
+            int hz = WH_GetRefreshRate(window);
+            if ((hz >= FRAMEPACE_VSYNC_MIN_HZ)
+                && (hz <= FRAMEPACE_VSYNC_MAX_HZ)
+                && (EmulatorConfig.emulation_thread == 0))
+            {
+                framepace_vsync_locked = 1;
+            }
+        }
+    }
+
+    FramePace_Reset();
+}
+
+void FramePace_Reset(void)
+{
+    framepace_next = SDL_GetPerformanceCounter();
+    framepace_next_remainder = 0;
+    _framepace_advance();
+}
+
+void FramePace_Wait(void)
+{
+    if (framepace_mode == FRAMEPACE_FREE)
+    {
+        SDL_Delay(0);
+        return;
+    }
+
+    Uint64 frame = framepace_frequency / FRAMEPACE_FRAMES_PER_SECOND;
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    if (framepace_vsync_locked)
+    {
+        // The wait for the vertical blank has already paced this frame. Only
+        // wait if the display has got a whole frame ahead of the emulation.
+        if ((now + frame) < framepace_next)
+            _framepace_wait_until(framepace_next - frame);
+    }
+    else
+    {
+        _framepace_wait_until(framepace_next);
+    }
+
+    now = SDL_GetPerformanceCounter();
+
+    // If the emulator missed a frame or more, adjust next frame
+    if ((framepace_next + frame) < now)
+        FramePace_Reset();
+    else
+        _framepace_advance();
+}
+
+int FramePace_VSyncEnabled(void)
+{
+    return framepace_mode == FRAMEPACE_VSYNC;
+}
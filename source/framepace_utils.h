@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef FRAMEPACE_UTILS__
+#define FRAMEPACE_UTILS__
+
+// Paces the main loop to the frame rate of the emulated consoles when audio
+// sync isn't used. The mode is selected in the configuration:
+//
+// - Timer: The loop waits until the time of the next frame using the high
+//   resolution counter. It sleeps while it's far away and spins for the last
+//   milliseconds, so it wakes up on time instead of up to 1 ms late.
+//
+// - VSync: The main window is presented in sync with the display. If its
+//   refresh rate is close to 60 Hz, the wait for the vertical blank paces the
+//   loop. If the display runs slightly faster, an extra vertical blank is
+//   waited for every time the display gets a whole frame ahead. If the refresh
+//   rate is different, the timer is used as well, and presentation is only
+//   synchronised to avoid tearing. The timer is always used when the emulation
+//   runs in a separate thread.
+//
+// - Free: Nothing is waited for, the loop runs as fast as it can.
+
+typedef enum
+{
+    FRAMEPACE_TIMER,
+    FRAMEPACE_VSYNC,
+    FRAMEPACE_FREE,
+} _framepace_mode_e;
+
+// Window whose presentation is synchronised with the display in VSync mode
+void FramePace_Init(int window);
+
+// The next frame will start one frame from now. It has to be called after
+// the loop has been paced by something else, like the audio output.
+void FramePace_Reset(void);
+
+// Waits until the next frame has to start
+void FramePace_Wait(void);
+
+// Returns 1 if presenting the main window waits for the vertical blank
+int FramePace_VSyncEnabled(void);
+
+#endif // FRAMEPACE_UTILS__
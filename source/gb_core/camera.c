@@ -18,14 +18,15 @@
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
 // Webcam image (exposed in gc_core/camera.h, values in the range 0-255)
-int gb_camera_webcam_output[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+core_local__ int gb_camera_webcam_output[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
 // Image processed by the retina chip
-static int gb_cam_retina_output_buf[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+static core_local__ int gb_cam_retina_output_buf[GBCAM_SENSOR_W]
+                                                [GBCAM_SENSOR_H];
 
 void GB_CameraEnd(void)
 {
@@ -44,7 +45,7 @@ void GB_CameraWebcamCapture(void)
 
 //----------------------------------------------------------------
 
-static int gb_camera_clock_counter = 0;
+static core_local__ int gb_camera_clock_counter = 0;
 
 void GB_CameraClockCounterReset(void)
 {
@@ -63,6 +64,8 @@ static void GB_CameraClockCounterSet(int new_reference_clocks)
 
 void GB_CameraUpdateClocksCounterReference(int reference_clocks)
 {
+    GB_CPUEventSourceUpdated(GB_EVENT_CAMERA, reference_clocks);
+
     if (GameBoy.Emulator.MemoryController != MEM_CAMERA)
         return;
 
@@ -99,7 +102,7 @@ int GB_CameraGetClocksToNextEvent(void)
 
 //----------------------------------------------------------------------------
 
-static int gb_clamp_int(int min, int value, int max)
+static inline int gb_clamp_int(int min, int value, int max)
 {
     if (value < min)
         return min;
@@ -109,37 +112,89 @@ static int gb_clamp_int(int min, int value, int max)
     return value;
 }
 
-static int gb_min_int(int a, int b)
+// Fills the colors of all pixel values for one position of the 4x4 matrix of
+// the controller. They are converted to Game Boy colors (0 = white).
+static void gb_cam_matrix_fill(u8 *lut, int x, int y)
 {
-    return (a < b) ? a : b;
+    _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
+
+    int base = 6 + (y * 4 + x) * 3;
+
+    u32 r0 = cam->reg[base + 0];
+    u32 r1 = cam->reg[base + 1];
+    u32 r2 = cam->reg[base + 2];
+
+    for (u32 value = 0; value < 256; value++)
+    {
+        u32 color;
+
+        if (value < r0)
+            color = 0x00;
+        else if (value < r1)
+            color = 0x40;
+        else if (value < r2)
+            color = 0x80;
+        else
+            color = 0xC0;
+
+        lut[value] = 3 - (color >> 6);
+    }
 }
 
-static int gb_max_int(int a, int b)
+// The buffers are stored as columns, so all the loops go through the pixels of
+// a column in the inner loop, in memory order. The pixels outside of the image
+// are the same as the closest border pixel. The borders are handled outside of
+// the inner loops so that they have no branches and they can be vectorized.
+
+// 1-D filtering of a column: px * kp + ms * ks, where ms is the pixel below
+// and kp and ks are -1, 0 or 1. The input is signed, the output is unsigned.
+static void gb_cam_filter_1d(int *dst, const int *src, int kp, int ks)
 {
-    return (a > b) ? a : b;
+    const int last = GBCAM_SENSOR_H - 1;
+
+    for (int j = 0; j < last; j++)
+        dst[j] = gb_clamp_int(-128, src[j] * kp + src[j + 1] * ks, 127) + 128;
+
+    dst[last] = gb_clamp_int(-128, src[last] * (kp + ks), 127) + 128;
 }
 
-static u32 gb_cam_matrix_process(u32 value, int x, int y)
+// Horizontal enhancement of a column : P + {2P - (MW + ME)} * alpha
+static void gb_cam_enhance_h(int *dst, const int *west, const int *src,
+                             const int *east, int alpha_x4)
 {
-    _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
+    {
+        int px = src[j];
+        int value = (4 * px + (2 * px - west[j] - east[j]) * alpha_x4) / 4;
+        dst[j] = gb_clamp_int(0, value, 255);
+    }
+}
 
-    x = x & 3;
-    y = y & 3;
+static inline int gb_cam_enhance_2d_px(int px, int mn, int ms, int mw, int me,
+                                       int alpha_x4)
+{
+    int value = (4 * px + (4 * px - mw - me - mn - ms) * alpha_x4) / 4;
+    return gb_clamp_int(-128, value, 127) + 128;
+}
 
-    int base = 6 + (y * 4 + x) * 3;
+// 2D enhancement of a column : P + {4P - (MN + MS + ME + MW)} * alpha
+// The input is signed, the output is unsigned.
+static void gb_cam_enhance_2d(int *dst, const int *west, const int *src,
+                              const int *east, int alpha_x4)
+{
+    const int last = GBCAM_SENSOR_H - 1;
 
-    u32 r0 = cam->reg[base + 0];
-    u32 r1 = cam->reg[base + 1];
-    u32 r2 = cam->reg[base + 2];
+    dst[0] = gb_cam_enhance_2d_px(src[0], src[0], src[1], west[0], east[0],
+                                  alpha_x4);
 
-    if (value < r0)
-        return 0x00;
-    if (value < r1)
-        return 0x40;
-    if (value < r2)
-        return 0x80;
+    for (int j = 1; j < last; j++)
+    {
+        dst[j] = gb_cam_enhance_2d_px(src[j], src[j - 1], src[j + 1],
+                                      west[j], east[j], alpha_x4);
+    }
 
-    return 0xC0;
+    dst[last] = gb_cam_enhance_2d_px(src[last], src[last - 1], src[last],
+                                     west[last], east[last], alpha_x4);
 }
 
 static void GB_CameraTakePicture(void)
@@ -181,6 +236,10 @@ static void GB_CameraTakePicture(void)
             break;
     }
 
+    // Coefficients of the pixel and the one below it in the 1-D filter
+    int kp = (int)(P_bits & BIT(0)) - (int)(M_bits & BIT(0));
+    int ks = (int)((P_bits & BIT(1)) >> 1) - (int)((M_bits & BIT(1)) >> 1);
+
     // Register 1
     u32 N_bit = (cam->reg[1] & BIT(7)) >> 7;
     u32 VH_bits = (cam->reg[1] & (BIT(6) | BIT(5))) >> 5;
@@ -189,11 +248,16 @@ static void GB_CameraTakePicture(void)
     u32 EXPOSURE_bits = cam->reg[3] | (cam->reg[2] << 8);
 
     // Register 4
-    const float edge_ratio_lut[8] = {
-        0.50, 0.75, 1.00, 1.25, 2.00, 3.00, 4.00, 5.00
+    //
+    // The ratios are 0.50, 0.75, 1.00, 1.25, 2.00, 3.00, 4.00 and 5.00. They
+    // are stored multiplied by 4 so that the filters can use integers, and the
+    // results are divided by 4. The results are exactly the same, they are
+    // rounded towards zero like when a float is converted to an integer.
+    const int edge_ratio_x4_lut[8] = {
+        2, 3, 4, 5, 8, 12, 16, 20
     };
 
-    float EDGE_alpha = edge_ratio_lut[(cam->reg[4] & 0x70) >> 4];
+    int EDGE_alpha_x4 = edge_ratio_x4_lut[(cam->reg[4] & 0x70) >> 4];
 
     u32 E3_bit = (cam->reg[4] & BIT(7)) >> 7;
     u32 I_bit = (cam->reg[4] & BIT(3)) >> 3;
@@ -210,118 +274,59 @@ static void GB_CameraTakePicture(void)
     // Sensor handling
     // ---------------
 
-    // Copy webcam buffer to sensor buffer applying color correction and
-    // exposure time
-    for (int i = 0; i < GBCAM_SENSOR_W; i++)
+    // Color correction, exposure time and inversion only depend on the value
+    // of the pixel, so they are calculated once for each possible value.
+    int sensor_lut[256];
+    for (int v = 0; v < 256; v++)
     {
-        for (int j = 0; j < GBCAM_SENSOR_H; j++)
-        {
-            int value = gb_camera_webcam_output[i][j];
-            value = (value * EXPOSURE_bits)
-                    / EmulatorConfig.gbcam_exposure_reference;
+        int value = v;
+        value = (value * EXPOSURE_bits)
+                / EmulatorConfig.gbcam_exposure_reference;
 
-            value = 128 + (((value - 128) * 1) / 8); // "adapt" to "3.1"/5.0 V
-            gb_cam_retina_output_buf[i][j] = gb_clamp_int(0, value, 255);
-        }
-    }
+        value = 128 + (((value - 128) * 1) / 8); // "adapt" to "3.1"/5.0 V
+        value = gb_clamp_int(0, value, 255);
 
-    if (I_bit) // Invert image
-    {
-        for (int i = 0; i < GBCAM_SENSOR_W; i++)
-        {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                gb_cam_retina_output_buf[i][j] =
-                        255 - gb_cam_retina_output_buf[i][j];
-            }
-        }
+        if (I_bit) // Invert image
+            value = 255 - value;
+
+        sensor_lut[v] = value - 128; // Make signed
     }
 
-    // Make signed
+    int sensor_buf[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+
     for (int i = 0; i < GBCAM_SENSOR_W; i++)
     {
         for (int j = 0; j < GBCAM_SENSOR_H; j++)
-        {
-            gb_cam_retina_output_buf[i][j] =
-                    gb_cam_retina_output_buf[i][j] - 128;
-        }
+            sensor_buf[i][j] = sensor_lut[gb_camera_webcam_output[i][j] & 0xFF];
     }
 
-    int temp_buf[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
-
+    // Filter the image and make it unsigned
     u32 filtering_mode = (N_bit << 3) | (VH_bits << 1) | E3_bit;
     switch (filtering_mode)
     {
         // 1-D filtering
         case 0x0:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    temp_buf[i][j] = gb_cam_retina_output_buf[i][j];
-                }
-            }
-
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int ms = temp_buf[i][gb_min_int(j + 1, GBCAM_SENSOR_H - 1)];
-                    int px = temp_buf[i][j];
-
-                    int value = 0;
-                    if (P_bits & BIT(0))
-                        value += px;
-                    if (P_bits & BIT(1))
-                        value += ms;
-                    if (M_bits & BIT(0))
-                        value -= px;
-                    if (M_bits & BIT(1))
-                        value -= ms;
-                    gb_cam_retina_output_buf[i][j] =
-                            gb_clamp_int(-128, value, 127);
-                }
-            }
+            for (int i = 0; i < GBCAM_SENSOR_W; i++)
+                gb_cam_filter_1d(gb_cam_retina_output_buf[i], sensor_buf[i],
+                                 kp, ks);
             break;
         }
 
         // 1-D filtering + Horiz. enhancement : P + {2P - (MW + ME)} * alpha
         case 0x2:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int mw = gb_cam_retina_output_buf[gb_max_int(0, i - 1)][j];
-                    int me = gb_cam_retina_output_buf
-                            [gb_min_int(i + 1, GBCAM_SENSOR_W - 1)][j];
-                    int px = gb_cam_retina_output_buf[i][j];
-
-                    temp_buf[i][j] = gb_clamp_int(0,
-                            px + ((2 * px - mw - me) * EDGE_alpha),
-                            255);
-                }
-            }
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
+            int column[GBCAM_SENSOR_H];
+
+            for (int i = 0; i < GBCAM_SENSOR_W; i++)
             {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int ms = temp_buf[i][gb_min_int(j + 1, GBCAM_SENSOR_H - 1)];
-                    int px = temp_buf[i][j];
-
-                    int value = 0;
-                    if (P_bits & BIT(0))
-                        value += px;
-                    if (P_bits & BIT(1))
-                        value += ms;
-                    if (M_bits & BIT(0))
-                        value -= px;
-                    if (M_bits & BIT(1))
-                        value -= ms;
-                    gb_cam_retina_output_buf[i][j] =
-                            gb_clamp_int(-128, value, 127);
-                }
+                const int *west = sensor_buf[(i > 0) ? (i - 1) : 0];
+                const int *east = sensor_buf[(i < GBCAM_SENSOR_W - 1) ?
+                                             (i + 1) : (GBCAM_SENSOR_W - 1)];
+
+                gb_cam_enhance_h(column, west, sensor_buf[i], east,
+                                 EDGE_alpha_x4);
+                gb_cam_filter_1d(gb_cam_retina_output_buf[i], column, kp, ks);
             }
             break;
         }
@@ -329,29 +334,14 @@ static void GB_CameraTakePicture(void)
         // 2D enhancement : P + {4P - (MN + MS + ME + MW)} * alpha
         case 0xE:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
+            for (int i = 0; i < GBCAM_SENSOR_W; i++)
             {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    int ms = gb_cam_retina_output_buf[i]
-                            [gb_min_int(j + 1, GBCAM_SENSOR_H - 1)];
-                    int mn = gb_cam_retina_output_buf[i][gb_max_int(0, j - 1)];
-                    int mw = gb_cam_retina_output_buf[gb_max_int(0, i - 1)][j];
-                    int me = gb_cam_retina_output_buf
-                            [gb_min_int(i + 1, GBCAM_SENSOR_W - 1)][j];
-                    int px = gb_cam_retina_output_buf[i][j];
-
-                    temp_buf[i][j] = gb_clamp_int(-128,
-                            px + ((4 * px - mw - me - mn - ms) * EDGE_alpha),
-                            127);
-                }
-            }
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
-            {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    gb_cam_retina_output_buf[i][j] = temp_buf[i][j];
-                }
+                const int *west = sensor_buf[(i > 0) ? (i - 1) : 0];
+                const int *east = sensor_buf[(i < GBCAM_SENSOR_W - 1) ?
+                                             (i + 1) : (GBCAM_SENSOR_W - 1)];
+
+                gb_cam_enhance_2d(gb_cam_retina_output_buf[i], west,
+                                  sensor_buf[i], east, EDGE_alpha_x4);
             }
             break;
         }
@@ -361,12 +351,10 @@ static void GB_CameraTakePicture(void)
         // Maybe this is a bug?
         case 0x1:
         {
-            for (int j = 0; j < GBCAM_SENSOR_H; j++)
+            for (int i = 0; i < GBCAM_SENSOR_W; i++)
             {
-                for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                {
-                    gb_cam_retina_output_buf[i][j] = 0;
-                }
+                for (int j = 0; j < GBCAM_SENSOR_H; j++)
+                    gb_cam_retina_output_buf[i][j] = 128;
             }
             break;
         }
@@ -379,17 +367,13 @@ static void GB_CameraTakePicture(void)
                               filtering_mode, cam->reg[0], cam->reg[1],
                               cam->reg[2], cam->reg[3], cam->reg[4],
                               cam->reg[5]);
-            break;
-        }
-    }
 
-    // Make unsigned
-    for (int j = 0; j < GBCAM_SENSOR_H; j++)
-    {
-        for (int i = 0; i < GBCAM_SENSOR_W; i++)
-        {
-            gb_cam_retina_output_buf[i][j] =
-                    gb_cam_retina_output_buf[i][j] + 128;
+            for (int i = 0; i < GBCAM_SENSOR_W; i++)
+            {
+                for (int j = 0; j < GBCAM_SENSOR_H; j++)
+                    gb_cam_retina_output_buf[i][j] = sensor_buf[i][j] + 128;
+            }
+            break;
         }
     }
 
@@ -398,35 +382,40 @@ static void GB_CameraTakePicture(void)
     // Controller handling
     // -------------------
 
-    int fourcolorsbuffer[GBCAM_W][GBCAM_H]; // Buffer after controller matrix
-
-    // Convert to Game Boy colors using the controller matrix
-    for (int j = 0; j < GBCAM_H; j++)
+    // Color of each pixel value for each position of the 4x4 controller
+    // matrix, so that each pixel only needs one lookup.
+    u8 matrix_lut[4][4][256];
+    for (int y = 0; y < 4; y++)
     {
-        for (int i = 0; i < GBCAM_W; i++)
-        {
-            int v;
-            v = gb_cam_retina_output_buf[i][j + (GBCAM_SENSOR_EXTRA_LINES / 2)];
-            fourcolorsbuffer[i][j] = gb_cam_matrix_process(v, i, j);
-        }
+        for (int x = 0; x < 4; x++)
+            gb_cam_matrix_fill(matrix_lut[y][x], x, y);
     }
 
-    // Convert to tiles
+    // Convert to tiles, 8 pixels of a row of a tile at a time
     u8 finalbuffer[14][16][16]; // Final buffer
-    memset(finalbuffer, 0, sizeof(finalbuffer));
     for (int j = 0; j < GBCAM_H; j++)
     {
-        for (int i = 0; i < GBCAM_W; i++)
+        const u8 (*matrix_row)[256] = matrix_lut[j & 3];
+        int row = j + (GBCAM_SENSOR_EXTRA_LINES / 2);
+
+        for (int tx = 0; tx < GBCAM_W / 8; tx++)
         {
-            u8 outcolor = 3 - (fourcolorsbuffer[i][j] >> 6);
+            u32 plane0 = 0;
+            u32 plane1 = 0;
 
-            u8 *tile_base = finalbuffer[j >> 3][i >> 3];
-            tile_base = &tile_base[(j & 7) * 2];
+            for (int b = 0; b < 8; b++)
+            {
+                int i = tx * 8 + b;
+                int v = gb_cam_retina_output_buf[i][row];
+                u32 outcolor = matrix_row[i & 3][v];
 
-            if (outcolor & 1)
-                tile_base[0] |= 1 << (7 - (7 & i));
-            if (outcolor & 2)
-                tile_base[1] |= 1 << (7 - (7 & i));
+                plane0 |= (outcolor & 1) << (7 - b);
+                plane1 |= (outcolor >> 1) << (7 - b);
+            }
+
+            u8 *tile_base = &finalbuffer[j >> 3][tx][(j & 7) * 2];
+            tile_base[0] = plane0;
+            tile_base[1] = plane1;
         }
     }
 
@@ -437,6 +426,8 @@ static void GB_CameraTakePicture(void)
 
 int GB_CameraReadRegister(int address)
 {
+    gb_idle_loop_unsafe = 1;
+
     GB_CameraUpdateClocksCounterReference(GB_CPUClockCounterGet());
 
     _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
@@ -452,6 +443,8 @@ int GB_CameraReadRegister(int address)
 
 void GB_CameraWriteRegister(int address, int value)
 {
+    GB_CameraUpdateClocksCounterReference(GB_CPUClockCounterGet());
+
     _GB_CAMERA_CART_ *cam = &GameBoy.Emulator.CAM;
 
     int reg = (address & 0x7F); // Mirror
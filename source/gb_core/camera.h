@@ -20,7 +20,7 @@
 //----------------------------------------------------------------
 
 // Values in range 0-255
-extern int gb_camera_webcam_output[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
+extern core_local__ int gb_camera_webcam_output[GBCAM_SENSOR_W][GBCAM_SENSOR_H];
 
 //----------------------------------------------------------------
 
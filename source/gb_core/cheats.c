@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+
+#include "../build_options.h"
+#include "../debug_utils.h"
+#include "../general_utils.h"
+
+#include "cheats.h"
+#include "gameboy.h"
+#include "memory.h"
+
+extern core_local__ _GB_CONTEXT_ GameBoy;
+
+#define GB_CHEATS_RAM_MAX   (128)
+
+typedef struct
+{
+    u16 address;
+    u8 value;
+    u8 bank; // WRAM bank of the GBC, 0 to write to the bank that is mapped
+} _gb_cheat_ram_t;
+
+static core_local__ _gb_cheat_ram_t gb_cheats_ram[GB_CHEATS_RAM_MAX];
+static core_local__ int gb_cheats_ram_count;
+
+// Original values of the bytes of the ROM that have been patched, restored in
+// reverse order so that codes that patch the same byte are undone correctly.
+typedef struct
+{
+    u32 offset;
+    u8 original;
+} _gb_cheat_rom_t;
+
+static core_local__ _gb_cheat_rom_t *gb_cheats_rom;
+static core_local__ int gb_cheats_rom_count;
+static core_local__ int gb_cheats_rom_capacity;
+
+void GB_CheatsReset(void)
+{
+    u8 *rom = (u8 *)GameBoy.Emulator.Rom_Pointer;
+
+    for (int i = gb_cheats_rom_count - 1; i >= 0; i--)
+        rom[gb_cheats_rom[i].offset] = gb_cheats_rom[i].original;
+
+    free(gb_cheats_rom);
+    gb_cheats_rom = NULL;
+    gb_cheats_rom_count = 0;
+    gb_cheats_rom_capacity = 0;
+
+    gb_cheats_ram_count = 0;
+}
+
+// Returns 0 on success
+static int gb_cheat_rom_patch(u32 offset, u8 value, int compare)
+{
+    u8 *rom = (u8 *)GameBoy.Emulator.Rom_Pointer;
+
+    if ((compare >= 0) && (rom[offset] != compare))
+        return 0;
+
+    if (gb_cheats_rom_count == gb_cheats_rom_capacity)
+    {
+        int capacity = (gb_cheats_rom_capacity == 0) ?
+                       64 : gb_cheats_rom_capacity * 2;
+        _gb_cheat_rom_t *patches = realloc(gb_cheats_rom,
+                                           capacity * sizeof(_gb_cheat_rom_t));
+        if (patches == NULL)
+            return 1;
+
+        gb_cheats_rom = patches;
+        gb_cheats_rom_capacity = capacity;
+    }
+
+    gb_cheats_rom[gb_cheats_rom_count].offset = offset;
+    gb_cheats_rom[gb_cheats_rom_count].original = rom[offset];
+    gb_cheats_rom_count++;
+
+    rom[offset] = value;
+
+    return 0;
+}
+
+static int gb_cheat_add_game_genie(const char *digits, int count)
+{
+    u32 value = cheat_code_hex(&digits[0], 2);
+    u32 address = ((cheat_code_hex(&digits[5], 1) ^ 0xF) << 12)
+                  | cheat_code_hex(&digits[2], 3);
+
+    int compare = -1;
+    if (count == 9)
+    {
+        // Digit H is only a check of the others, it isn't needed
+        u32 code = (cheat_code_hex(&digits[6], 1) << 4)
+                   | cheat_code_hex(&digits[8], 1);
+        compare = (((code >> 2) | (code << 6)) & 0xFF) ^ 0xBA;
+    }
+
+    if (address >= 0x8000)
+        return 1;
+
+    if (address < 0x4000)
+        return gb_cheat_rom_patch(address, value, compare);
+
+    // Bank 0 is skipped, its data is also seen at 0000-3FFF
+    for (u32 bank = 1; bank < GameBoy.Emulator.ROM_Banks; bank++)
+    {
+        if (gb_cheat_rom_patch((bank * 0x4000) + (address - 0x4000), value,
+                               compare) != 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int gb_cheat_add_gameshark(const char *digits)
+{
+    if (gb_cheats_ram_count == GB_CHEATS_RAM_MAX)
+        return 1;
+
+    u32 type = cheat_code_hex(&digits[0], 2);
+    u32 value = cheat_code_hex(&digits[2], 2);
+    u32 address = (cheat_code_hex(&digits[6], 2) << 8)
+                  | cheat_code_hex(&digits[4], 2);
+
+    u32 bank = 0;
+    if (((type & 0xE0) == 0x80) && ((type & 0x0F) < 8))
+        bank = (type & 7) ? (type & 7) : 1;
+    else if (type > 0x01)
+        return 1;
+
+    if (address < 0x8000)
+        return 1;
+
+    _gb_cheat_ram_t *cheat = &gb_cheats_ram[gb_cheats_ram_count++];
+    cheat->address = address;
+    cheat->value = value;
+    cheat->bank = bank;
+
+    return 0;
+}
+
+int GB_CheatAdd(const char *code)
+{
+    char digits[16];
+    int count = cheat_code_digits(code, digits, sizeof(digits));
+
+    int ret = 1;
+    if (count == 8)
+        ret = gb_cheat_add_gameshark(digits);
+    else if ((count == 6) || (count == 9))
+        ret = gb_cheat_add_game_genie(digits, count);
+
+    if (ret)
+        Debug_LogMsgArg("%s: Invalid code: %s", __func__, code);
+
+    return ret;
+}
+
+void GB_CheatsApply(void)
+{
+    for (int i = 0; i < gb_cheats_ram_count; i++)
+    {
+        _gb_cheat_ram_t *cheat = &gb_cheats_ram[i];
+
+        // Banks that aren't mapped are written directly
+        if ((cheat->bank > 0) && GameBoy.Emulator.CGBEnabled
+            && ((cheat->address & 0xF000) == 0xD000))
+        {
+            u8 *wram = GameBoy.Memory.WorkRAM_Switch[cheat->bank - 1];
+            wram[cheat->address - 0xD000] = cheat->value;
+            continue;
+        }
+
+        GB_MemWrite8(cheat->address, cheat->value);
+    }
+}
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GB_CHEATS__
+#define GB_CHEATS__
+
+// Cheat codes. Two formats are supported, the separators are ignored:
+//
+// - GameShark "TTVVLLHH": VV is written to HHLL at the start of every frame.
+//   TT is 00 or 01, or 8X/9X to write to bank X of the switchable WRAM of the
+//   GBC. Only RAM addresses (8000-FFFF) are accepted.
+// - Game Genie "ABC-DEF" or "ABC-DEF-GHI": The ROM byte at the address is
+//   replaced by AB (when it's equal to the compare value if there is one).
+//   The ROM buffer of the core is patched in place when the code is added and
+//   restored when the codes are removed, so the memory is read the same way as
+//   without cheats. Addresses in 4000-7FFF are patched in all the switchable
+//   banks that match, like the real device does.
+//
+// The codes are kept until GB_CheatsReset() is called or the ROM is unloaded.
+
+void GB_CheatsReset(void);
+// Returns 0 on success, 1 if the code isn't valid
+int GB_CheatAdd(const char *code);
+
+// Called at the start of every frame
+void GB_CheatsApply(void);
+
+#endif // GB_CHEATS__
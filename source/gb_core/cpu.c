@@ -4,9 +4,15 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <string.h>
+
 #include "../build_options.h"
 #include "../debug_utils.h"
 #include "../general_utils.h"
+#include "../opprofile_utils.h"
+#include "../profile_utils.h"
+#include "../savestate_utils.h"
+#include "../trace_utils.h"
 
 #include "camera.h"
 #include "cpu.h"
@@ -22,8 +28,6 @@
 #include "sgb.h"
 #include "sound.h"
 
-#include "../gui/win_gb_debugger.h"
-
 // Single Speed
 // 4194304 Hz
 // 0.2384185791015625 us per clock
@@ -50,27 +54,29 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
-static int gb_last_residual_clocks;
+static core_local__ int gb_last_residual_clocks;
 
 extern const u8 gb_daa_table[256 * 8 * 2]; // In file daa_table.c
 
 //----------------------------------------------------------------
 
-static int gb_break_cpu_loop = 0;
+static core_local__ int gb_break_cpu_loop = 0;
+static core_local__ _profile_slice_e gb_break_cpu_loop_reason;
 
 // Call this function when writing to a register that can generate an event
-void GB_CPUBreakLoop(void)
+void GB_CPUBreakLoop(_profile_slice_e reason)
 {
     gb_break_cpu_loop = 1;
+    gb_break_cpu_loop_reason = reason;
 }
 
 //----------------------------------------------------------------
 
 // This is used for CPU, IRQ and GBC DMA
 
-static int gb_cpu_clock_counter = 0;
+static core_local__ int gb_cpu_clock_counter = 0;
 
 void GB_CPUClockCounterReset(void)
 {
@@ -94,31 +100,142 @@ static int min(int a, int b)
     return (a < b) ? a : b;
 }
 
-static int GB_ClocksForNextEvent(void)
+static int max(int a, int b)
+{
+    return (a > b) ? a : b;
+}
+
+typedef struct
+{
+    void (*update)(int reference_clocks);
+    int (*clocks_to_next_event)(void);
+    int reference_clocks; // Clocks of the last update
+    int next_event_clocks; // Clocks of the next event
+    _profile_section_e profile; // Section of the profiler of the updates
+    _profile_slice_e slice; // Reason of the slices that end at its events
+} _gb_event_source_t;
+
+static core_local__ _gb_event_source_t gb_event_sources[GB_EVENT_NUMBER] = {
+    [GB_EVENT_TIMERS] = {
+        GB_TimersUpdateClocksCounterReference,
+        GB_TimersGetClocksToNextEvent,
+        .profile = PROFILE_TIMERS,
+        .slice = PROFILE_SLICE_TIMERS
+    },
+    [GB_EVENT_PPU] = {
+        GB_PPUUpdateClocksCounterReference,
+        GB_PPUGetClocksToNextEvent,
+        .profile = PROFILE_PPU,
+        .slice = PROFILE_SLICE_PPU
+    },
+    [GB_EVENT_SERIAL] = {
+        GB_SerialUpdateClocksCounterReference,
+        GB_SerialGetClocksToNextEvent,
+        .profile = PROFILE_OTHER,
+        .slice = PROFILE_SLICE_SERIAL
+    },
+    [GB_EVENT_CAMERA] = {
+        GB_CameraUpdateClocksCounterReference,
+        GB_CameraGetClocksToNextEvent,
+        .profile = PROFILE_OTHER,
+        .slice = PROFILE_SLICE_IO
+    },
+    [GB_EVENT_PCPROFILE] = {
+        GB_PCProfileUpdateClocksCounterReference,
+        GB_PCProfileGetClocksToNextEvent,
+        .profile = PROFILE_OTHER,
+        .slice = PROFILE_SLICE_OTHER
+    },
+};
+
+static void GB_EventSourceRun(_gb_event_source_t *src, int reference_clocks)
+{
+    _profile_section_e prev = Profile_Begin(src->profile);
+    src->update(reference_clocks);
+    Profile_End(prev);
+}
+
+// Sources updated since their next event was calculated
+static core_local__ u32 gb_event_sources_stale;
+
+// Clocks of the closest event of all sources
+static core_local__ int gb_next_event_clocks;
+// Source of the closest event
+static core_local__ _profile_slice_e gb_next_event_slice;
+
+void GB_CPUEventSourceUpdated(_gb_event_source_e source, int reference_clocks)
+{
+    gb_event_sources[source].reference_clocks = reference_clocks;
+    gb_event_sources_stale |= BIT(source);
+}
+
+static void GB_EventSourcesSchedule(void)
 {
-    int clocks_to_next_event = GB_TimersGetClocksToNextEvent();
+    gb_next_event_clocks = 0x7FFFFFFF;
+    gb_next_event_slice = PROFILE_SLICE_OTHER;
+
+    for (int i = 0; i < GB_EVENT_NUMBER; i++)
+    {
+        _gb_event_source_t *src = &gb_event_sources[i];
+
+        if (gb_event_sources_stale & BIT(i))
+        {
+            int clocks = src->clocks_to_next_event();
 
-    clocks_to_next_event =
-            min(clocks_to_next_event, GB_PPUGetClocksToNextEvent());
-    clocks_to_next_event =
-            min(clocks_to_next_event, GB_SerialGetClocksToNextEvent());
-    clocks_to_next_event =
-            min(clocks_to_next_event, GB_DMAGetClocksToNextEvent());
-    clocks_to_next_event =
-            min(clocks_to_next_event, GB_SoundGetClocksToNextEvent());
-    clocks_to_next_event =
-            min(clocks_to_next_event, GB_SoundGetClocksToNextEvent());
+            if (clocks > (0x7FFFFFFF - src->reference_clocks))
+                src->next_event_clocks = 0x7FFFFFFF;
+            else
+                src->next_event_clocks = src->reference_clocks + clocks;
+        }
 
-    // SGB?, CAMERA?
+        if (src->next_event_clocks < gb_next_event_clocks)
+        {
+            gb_next_event_clocks = src->next_event_clocks;
+            gb_next_event_slice = src->slice;
+        }
+    }
+
+    gb_event_sources_stale = 0;
+}
+
+// It also returns the reason given to the profiler if the slice of CPU
+// execution ends at the event.
+static int GB_ClocksForNextEvent(_profile_slice_e *reason)
+{
+    if (gb_event_sources_stale)
+        GB_EventSourcesSchedule();
+
+    int clocks_to_next_event = gb_next_event_clocks - GB_CPUClockCounterGet();
+    *reason = gb_next_event_slice;
+
+    int clocks = GB_DMAGetClocksToNextEvent();
+    if (clocks < clocks_to_next_event)
+    {
+        clocks_to_next_event = clocks;
+        *reason = PROFILE_SLICE_DMA;
+    }
+
+    clocks = GB_SoundGetClocksToNextEvent();
+    if (clocks < clocks_to_next_event)
+    {
+        clocks_to_next_event = clocks;
+        *reason = PROFILE_SLICE_APU;
+    }
+
+    // SGB?
 
     // clocks_to_next_event should never be 0.
 
-    // Align to 4 clocks for CPU HALT.
-    return (clocks_to_next_event | 4) & ~3;
+    // Align to 4 clocks for CPU HALT. Round up so that the CPU doesn't stop
+    // after the event if it is already aligned.
+    return (clocks_to_next_event + 3) & ~3;
 }
 
 static void GB_ClockCountersReset(void)
 {
+    // Before the counter of the CPU is reset
+    GB_TraceClockCounterReset();
+
     GB_CPUClockCounterReset();
     GB_TimersClockCounterReset();
     GB_PPUClockCounterReset();
@@ -127,17 +244,101 @@ static void GB_ClockCountersReset(void)
     GB_DMAClockCounterReset();
     // SGB?
     GB_CameraClockCounterReset();
+    GB_PCProfileClockCounterReset();
+    GB_RTCClockCounterReset();
+
+    // All systems are up to date, but their events have to be calculated again
+    for (int i = 0; i < GB_EVENT_NUMBER; i++)
+        GB_CPUEventSourceUpdated(i, 0);
 }
 
 void GB_UpdateCounterToClocks(int reference_clocks)
 {
-    GB_TimersUpdateClocksCounterReference(reference_clocks);
-    GB_PPUUpdateClocksCounterReference(reference_clocks);
-    GB_SerialUpdateClocksCounterReference(reference_clocks);
+    // Skip the lazy systems unless one of them needs to be updated
+    if (gb_event_sources_stale || (gb_next_event_clocks <= reference_clocks))
+    {
+        for (int i = 0; i < GB_EVENT_NUMBER; i++)
+        {
+            _gb_event_source_t *src = &gb_event_sources[i];
+
+            if ((gb_event_sources_stale & BIT(i))
+                || (src->next_event_clocks <= reference_clocks))
+            {
+                GB_EventSourceRun(src, reference_clocks);
+            }
+        }
+    }
+
     GB_SoundUpdateClocksCounterReference(reference_clocks);
     GB_DMAUpdateClocksCounterReference(reference_clocks);
     //SGB_Update(reference_clocks);
-    GB_CameraUpdateClocksCounterReference(reference_clocks);
+}
+
+// Brings the lazy systems up to date, even if they haven't reached any event.
+static void GB_UpdateAllCountersToClocks(int reference_clocks)
+{
+    for (int i = 0; i < GB_EVENT_NUMBER; i++)
+    {
+        _gb_event_source_t *src = &gb_event_sources[i];
+
+        if (src->reference_clocks != reference_clocks)
+            GB_EventSourceRun(src, reference_clocks);
+    }
+
+    // The RTC never has events, it only needs to be up to date before the
+    // counters are reset.
+    GB_RTCUpdateClocksCounterReference(reference_clocks);
+}
+
+// Returns the clocks to skip while the CPU is halted. Nothing can change the
+// state of the emulated machine until a source reaches an event, and the CPU
+// only cares about the ones that can set a bit of IF that is enabled in IE. The
+// PPU always matters because it ends the frame, and the sound because it mixes
+// one sample per update.
+static int GB_CPUHaltClocksToSkip(int clocks_to_next_event, int run_for_clocks)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    // DMA copies are advanced by the loop
+    if (GameBoy.Emulator.OAM_DMA_enabled
+        || (GameBoy.Emulator.GBC_DMA_enabled != GBC_DMA_NONE))
+        return clocks_to_next_event;
+
+    u32 wake_flags = mem->HighRAM[IE_REG - 0xFF80] & (I_TIMER | I_SERIAL);
+
+    int now = GB_CPUClockCounterGet();
+
+    int clocks = run_for_clocks;
+
+    if (GameBoy.Emulator.lcd_on)
+    {
+        clocks = gb_event_sources[GB_EVENT_PPU].reference_clocks - now
+                 + GB_PPUGetClocksToNextModeChange();
+    }
+
+    clocks = min(clocks, GB_SoundGetClocksToNextUpdate());
+    clocks = min(clocks, gb_event_sources[GB_EVENT_CAMERA].next_event_clocks
+                         - now);
+
+    if (wake_flags & I_TIMER)
+    {
+        clocks = min(clocks, gb_event_sources[GB_EVENT_TIMERS].next_event_clocks
+                             - now);
+    }
+    if (wake_flags & I_SERIAL)
+    {
+        clocks = min(clocks, gb_event_sources[GB_EVENT_SERIAL].next_event_clocks
+                             - now);
+    }
+
+    if (clocks >= run_for_clocks)
+        return run_for_clocks;
+
+    // Round up to the next step of 4 clocks
+    clocks = max(clocks, 1);
+    clocks = (clocks + 3) & ~3;
+
+    return min(clocks, run_for_clocks);
 }
 
 //----------------------------------------------------------------
@@ -249,15 +450,35 @@ void GB_CPUEnd(void)
 
 //----------------------------------------------------------------
 
-int gb_break_execution = 0;
+core_local__ int gb_break_execution = 0;
 
 void _gb_break_to_debugger(void)
 {
     gb_break_execution = 1;
+    GB_CPUBreakLoop(PROFILE_SLICE_OTHER);
 }
 
 //----------------------------------------------------------------
 
+// The flags are always calculated as a whole byte and written with a single
+// store, which is cheaper than writing each flag of the bitfield on its own.
+
+// Returns the zero flag of an 8-bit result
+static inline u32 gb_flag_zero(u32 result)
+{
+    return (result & 0xFF) ? 0 : F_ZERO;
+}
+
+// Returns the zero, half carry and carry flags of an 8-bit addition or
+// subtraction of a and b. The carries out of bits 3 and 7 are found in the
+// result, as long as it hasn't been truncated to 8 bits.
+static inline u32 gb_flags_add_sub8(u32 a, u32 b, u32 result)
+{
+    return gb_flag_zero(result)
+           | (((a ^ b ^ result) & 0x10) << 1) // F_HALFCARRY
+           | ((result & 0x100) >> 4); // F_CARRY
+}
+
 // LD r16,nnnn - 3
 #define gb_ld_r16_nnnn(reg_hi, reg_low)                                        \
     {                                                                          \
@@ -309,30 +530,28 @@ void _gb_break_to_debugger(void)
 // INC r8 - 1
 #define gb_inc_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF &= ~F_SUBTRACT;                                            \
-        cpu->F.H = ((reg8 & 0xF) == 0xF);                                      \
         reg8++;                                                                \
-        cpu->F.Z = (reg8 == 0);                                                \
+        cpu->R8.F = (cpu->R8.F & F_CARRY) | gb_flag_zero(reg8)                 \
+                    | ((reg8 & 0xF) ? 0 : F_HALFCARRY);                        \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // DEC r8 - 1
 #define gb_dec_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF |= F_SUBTRACT;                                             \
-        cpu->F.H = ((reg8 & 0xF) == 0x0);                                      \
         reg8--;                                                                \
-        cpu->F.Z = (reg8 == 0);                                                \
+        cpu->R8.F = (cpu->R8.F & F_CARRY) | gb_flag_zero(reg8) | F_SUBTRACT    \
+                    | (((reg8 & 0xF) == 0xF) ? F_HALFCARRY : 0);               \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // ADD HL,r16 - 2
 #define gb_add_hl_r16(reg16)                                                   \
     {                                                                          \
-        cpu->R16.AF &= ~F_SUBTRACT;                                            \
         u32 temp = cpu->R16.HL + reg16;                                        \
-        cpu->F.C = (temp > 0xFFFF);                                            \
-        cpu->F.H = (((cpu->R16.HL & 0x0FFF) + (reg16 & 0x0FFF)) > 0x0FFF);     \
+        cpu->R8.F = (cpu->R8.F & F_ZERO)                                       \
+                    | (((cpu->R16.HL ^ reg16 ^ temp) & 0x1000) >> 7)           \
+                    | ((temp & 0x10000) >> 12);                                \
         cpu->R16.HL = temp & 0xFFFF;                                           \
         GB_CPUClockCounterAdd(8);                                              \
     }
@@ -340,46 +559,35 @@ void _gb_break_to_debugger(void)
 // ADD A,r8 - 1
 #define gb_add_a_r8(reg8)                                                      \
     {                                                                          \
-        cpu->R16.AF &= ~F_SUBTRACT;                                            \
-        u32 temp = cpu->R8.A;                                                  \
-        cpu->F.H = ((temp & 0xF) + ((u32)reg8 & 0xF)) > 0xF;                   \
-        cpu->R8.A += reg8;                                                     \
-        cpu->F.Z = (cpu->R8.A == 0);                                           \
-        cpu->F.C = (temp > cpu->R8.A);                                         \
+        u32 temp = cpu->R8.A + reg8;                                           \
+        cpu->R8.F = gb_flags_add_sub8(cpu->R8.A, reg8, temp);                  \
+        cpu->R8.A = temp;                                                      \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // ADC A,r8 - 1
 #define gb_adc_a_r8(reg8)                                                      \
     {                                                                          \
-        cpu->R16.AF &= ~F_SUBTRACT;                                            \
         u32 temp = cpu->R8.A + reg8 + cpu->F.C;                                \
-        cpu->F.H = (((cpu->R8.A & 0xF) + (reg8 & 0xF)) + cpu->F.C) > 0xF;      \
-        cpu->F.C = (temp > 0xFF);                                              \
-        temp &= 0xFF;                                                          \
+        cpu->R8.F = gb_flags_add_sub8(cpu->R8.A, reg8, temp);                  \
         cpu->R8.A = temp;                                                      \
-        cpu->F.Z = (temp == 0);                                                \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // SUB A,r8 - 1
 #define gb_sub_a_r8(reg8)                                                      \
     {                                                                          \
-        cpu->R8.F = F_SUBTRACT;                                                \
-        cpu->F.H = (cpu->R8.A & 0xF) < (reg8 & 0xF);                           \
-        cpu->F.C = (u32)cpu->R8.A < (u32)reg8;                                 \
-        cpu->R8.A -= reg8;                                                     \
-        cpu->F.Z = (cpu->R8.A == 0);                                           \
+        u32 temp = cpu->R8.A - reg8;                                           \
+        cpu->R8.F = gb_flags_add_sub8(cpu->R8.A, reg8, temp) | F_SUBTRACT;     \
+        cpu->R8.A = temp;                                                      \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // SBC A,r8 - 1
 #define gb_sbc_a_r8(reg8)                                                      \
     {                                                                          \
-        u32 temp = cpu->R8.A - reg8 - ((cpu->R8.F & F_CARRY) ? 1 : 0);         \
-        cpu->R8.F = ((temp & ~0xFF) ? F_CARRY : 0)                             \
-                    | ((temp & 0xFF) ? 0 : F_ZERO) | F_SUBTRACT;               \
-        cpu->F.H = ((cpu->R8.A ^ reg8 ^ temp) & 0x10) != 0;                    \
+        u32 temp = cpu->R8.A - reg8 - cpu->F.C;                                \
+        cpu->R8.F = gb_flags_add_sub8(cpu->R8.A, reg8, temp) | F_SUBTRACT;     \
         cpu->R8.A = temp;                                                      \
         GB_CPUClockCounterAdd(4);                                              \
     }
@@ -387,38 +595,32 @@ void _gb_break_to_debugger(void)
 // AND A,r8 - 1
 #define gb_and_a_r8(reg8)                                                      \
     {                                                                          \
-        cpu->R16.AF |= F_HALFCARRY;                                            \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);                                \
         cpu->R8.A &= reg8;                                                     \
-        cpu->F.Z = (cpu->R8.A == 0);                                           \
+        cpu->R8.F = gb_flag_zero(cpu->R8.A) | F_HALFCARRY;                     \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // XOR A,r8 - 1
 #define gb_xor_a_r8(reg8)                                                      \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);                  \
         cpu->R8.A ^= reg8;                                                     \
-        cpu->F.Z = (cpu->R8.A == 0);                                           \
+        cpu->R8.F = gb_flag_zero(cpu->R8.A);                                   \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // OR A,r8 - 1
 #define gb_or_a_r8(reg8)                                                       \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);                  \
         cpu->R8.A |= reg8;                                                     \
-        cpu->F.Z = (cpu->R8.A == 0);                                           \
+        cpu->R8.F = gb_flag_zero(cpu->R8.A);                                   \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // CP A,r8 - 1
 #define gb_cp_a_r8(reg8)                                                       \
     {                                                                          \
-        cpu->R16.AF |= F_SUBTRACT;                                             \
-        cpu->F.H = (cpu->R8.A & 0xF) < (reg8 & 0xF);                           \
-        cpu->F.C = (u32)cpu->R8.A < (u32)reg8;                                 \
-        cpu->F.Z = (cpu->R8.A == reg8);                                        \
+        u32 temp = cpu->R8.A - reg8;                                           \
+        cpu->R8.F = gb_flags_add_sub8(cpu->R8.A, reg8, temp) | F_SUBTRACT;     \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
@@ -553,90 +755,77 @@ void _gb_break_to_debugger(void)
 // RLC r8 - 2
 #define gb_rlc_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        cpu->F.C = (reg8 & 0x80) != 0;                                         \
-        reg8 = (reg8 << 1) | cpu->F.C;                                         \
-        cpu->F.Z = (reg8 == 0);                                                \
+        reg8 = (reg8 << 1) | (reg8 >> 7);                                      \
+        cpu->R8.F = gb_flag_zero(reg8) | ((reg8 & 0x01) << 4);                 \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // RRC r8 - 2
 #define gb_rrc_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        cpu->F.C = (reg8 & 0x01) != 0;                                         \
-        reg8 = (reg8 >> 1) | (cpu->F.C << 7);                                  \
-        cpu->F.Z = (reg8 == 0);                                                \
+        reg8 = (reg8 >> 1) | (reg8 << 7);                                      \
+        cpu->R8.F = gb_flag_zero(reg8) | ((reg8 & 0x80) >> 3);                 \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // RL r8 - 2
 #define gb_rl_r8(reg8)                                                         \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        u32 temp = cpu->F.C;                                                   \
-        cpu->F.C = (reg8 & 0x80) != 0;                                         \
-        reg8 = (reg8 << 1) | temp;                                             \
-        cpu->F.Z = (reg8 == 0);                                                \
+        u32 temp = (reg8 << 1) | cpu->F.C;                                     \
+        cpu->R8.F = gb_flag_zero(temp) | ((temp & 0x100) >> 4);                \
+        reg8 = temp;                                                           \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // RR r8 - 2
 #define gb_rr_r8(reg8)                                                         \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        u32 temp = cpu->F.C;                                                   \
-        cpu->F.C = (reg8 & 0x01) != 0;                                         \
-        reg8 = (reg8 >> 1) | (temp << 7);                                      \
-        cpu->F.Z = (reg8 == 0);                                                \
+        u32 temp = reg8 | (cpu->F.C << 8);                                     \
+        cpu->R8.F = gb_flag_zero(temp >> 1) | ((temp & 0x01) << 4);            \
+        reg8 = temp >> 1;                                                      \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // SLA r8 - 2
 #define gb_sla_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        cpu->F.C = (reg8 & 0x80) != 0;                                         \
-        reg8 = reg8 << 1;                                                      \
-        cpu->F.Z = (reg8 == 0);                                                \
+        u32 temp = reg8 << 1;                                                  \
+        cpu->R8.F = gb_flag_zero(temp) | ((temp & 0x100) >> 4);                \
+        reg8 = temp;                                                           \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // SRA r8 - 2
 #define gb_sra_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        cpu->F.C = (reg8 & 0x01) != 0;                                         \
+        u32 carry = (reg8 & 0x01) << 4;                                        \
         reg8 = (reg8 & 0x80) | (reg8 >> 1);                                    \
-        cpu->F.Z = (reg8 == 0);                                                \
+        cpu->R8.F = gb_flag_zero(reg8) | carry;                                \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // SWAP r8 - 2
 #define gb_swap_r8(reg8)                                                       \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_CARRY);                  \
         reg8 = ((reg8 >> 4) | (reg8 << 4));                                    \
-        cpu->F.Z = (reg8 == 0);                                                \
+        cpu->R8.F = gb_flag_zero(reg8);                                        \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // SRL r8 - 2
 #define gb_srl_r8(reg8)                                                        \
     {                                                                          \
-        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);                            \
-        cpu->F.C = (reg8 & 0x01) != 0;                                         \
+        u32 carry = (reg8 & 0x01) << 4;                                        \
         reg8 = reg8 >> 1;                                                      \
-        cpu->F.Z = (reg8 == 0);                                                \
+        cpu->R8.F = gb_flag_zero(reg8) | carry;                                \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
 // BIT n,r8 - 2
 #define gb_bit_n_r8(bitn, reg8)                                                \
     {                                                                          \
-        cpu->R16.AF &= ~F_SUBTRACT;                                            \
-        cpu->R16.AF |= F_HALFCARRY;                                            \
-        cpu->F.Z = (reg8 & (1 << bitn)) == 0;                                  \
+        cpu->R8.F = (cpu->R8.F & F_CARRY) | F_HALFCARRY                        \
+                    | ((reg8 & (1 << bitn)) ? 0 : F_ZERO);                     \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
@@ -644,9 +833,9 @@ void _gb_break_to_debugger(void)
 #define gb_bit_n_ptr_hl(bitn)                                                  \
     {                                                                          \
         GB_CPUClockCounterAdd(4);                                              \
-        cpu->R16.AF &= ~F_SUBTRACT;                                            \
-        cpu->R16.AF |= F_HALFCARRY;                                            \
-        cpu->F.Z = (GB_MemRead8(cpu->R16.HL) & (1 << bitn)) == 0;              \
+        u32 temp = GB_MemRead8(cpu->R16.HL);                                   \
+        cpu->R8.F = (cpu->R8.F & F_CARRY) | F_HALFCARRY                        \
+                    | ((temp & (1 << bitn)) ? 0 : F_ZERO);                     \
         GB_CPUClockCounterAdd(4);                                              \
     }
 
@@ -699,6 +888,60 @@ void _gb_break_to_debugger(void)
 
 //----------------------------------------------------------------
 
+// Idle loop detection
+// -------------------
+//
+// Games often wait for an interrupt by polling a register or a variable in a
+// loop. Reads of registers that are updated lazily only change when an event
+// happens, and the CPU loop is always stopped before that. If the CPU state is
+// the same after two consecutive iterations and nothing has been written to
+// memory, all the iterations until the end of the current slice of clocks will
+// be exactly the same. Those iterations are skipped, leaving enough clocks to
+// run the last one normally, so the final state is the same as if all of them
+// had been emulated.
+
+// Game loops smaller than this are checked for idle loops
+#define GB_IDLE_LOOP_MAX_SIZE   (16)
+
+core_local__ int gb_idle_loop_unsafe;
+
+static core_local__ _GB_CPU_ gb_idle_loop_cpu;
+static core_local__ u32 gb_idle_loop_ime;
+static core_local__ int gb_idle_loop_clocks;
+static core_local__ int gb_idle_loop_valid;
+
+static void GB_CPUIdleLoopCheck(int finish_clocks)
+{
+    _GB_CPU_ *cpu = &GameBoy.CPU;
+    u32 ime = GameBoy.Memory.InterruptMasterEnable;
+    int clocks = GB_CPUClockCounterGet();
+
+    if (gb_idle_loop_valid && (gb_idle_loop_unsafe == 0)
+        && (gb_idle_loop_ime == ime)
+        && (memcmp(&gb_idle_loop_cpu, cpu, sizeof(_GB_CPU_)) == 0))
+    {
+        int iteration_clocks = clocks - gb_idle_loop_clocks;
+        int clocks_left = finish_clocks - clocks;
+
+        if ((iteration_clocks > 0) && (clocks_left > iteration_clocks))
+        {
+            GB_CPUClockCounterAdd(((clocks_left - 1) / iteration_clocks)
+                                  * iteration_clocks);
+        }
+
+        gb_idle_loop_valid = 0;
+        return;
+    }
+
+    memcpy(&gb_idle_loop_cpu, cpu, sizeof(_GB_CPU_));
+    gb_idle_loop_ime = ime;
+    gb_idle_loop_clocks = clocks;
+    gb_idle_loop_valid = 1;
+    gb_idle_loop_unsafe = 0;
+}
+
+//----------------------------------------------------------------
+
 // This function tries to run the specified number of clocks and returns the
 // actually executed number of clocks
 static int GB_CPUExecute(int clocks)
@@ -711,31 +954,67 @@ static int GB_CPUExecute(int clocks)
     // If nothing interesting happens before, stop here
     int finish_clocks = GB_CPUClockCounterGet() + clocks;
 
+    // The clocks of the previous call can't be compared with the new ones
+    gb_idle_loop_valid = 0;
+
+    // Breakpoints and the trace can't change while this function runs, the EI
+    // delay is only started by EI, and the halt bug is only triggered by HALT,
+    // which exits the loop. Unless one of them is active, skip their checks.
+    int breakpoints = GB_DebugCPUBreakpointsUsed();
+    int trace = trace_enabled;
+    int slow_checks = breakpoints || trace || mem->interrupts_enable_count
+                      || GameBoy.Emulator.halt_bug;
+#ifdef ENABLE_OPCODE_PROFILE
+    int opprofile = opprofile_enabled;
+#endif
+
     while (GB_CPUClockCounterGet() < finish_clocks)
     {
-        if (GB_DebugCPUIsBreakpoint(cpu->R16.PC))
-        {
-            _gb_break_to_debugger();
-            Win_GBDisassemblerSetFocus();
-            break;
-        }
+        u32 instruction_pc = cpu->R16.PC;
 
-        if (mem->interrupts_enable_count) // EI interrupt enable delay
+        if (slow_checks)
         {
-            mem->interrupts_enable_count = 0;
-            mem->InterruptMasterEnable = 1;
-            // Don't break right now, break after this instruction
-            GB_CPUBreakLoop();
+            if (breakpoints && GB_DebugCPUIsBreakpoint(cpu->R16.PC))
+            {
+                _gb_break_to_debugger();
+                GB_DebugNotifyBreak();
+                break;
+            }
+
+            if (mem->interrupts_enable_count) // EI interrupt enable delay
+            {
+                mem->interrupts_enable_count = 0;
+                mem->InterruptMasterEnable = 1;
+                // Don't break right now, break after this instruction
+                GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
+            }
         }
 
+#ifdef ENABLE_OPCODE_PROFILE
+        int opprofile_clocks = GB_CPUClockCounterGet();
+#endif
+
         u8 opcode = (u8)GB_MemRead8(cpu->R16.PC++);
         cpu->R16.PC &= 0xFFFF;
 
-        if (GameBoy.Emulator.halt_bug)
+#ifdef ENABLE_OPCODE_PROFILE
+        // The opcode is replaced by the second byte in CB opcodes
+        u32 opprofile_prefix = (opcode == 0xCB) ? 0x100 : 0;
+#endif
+
+        if (slow_checks)
         {
-            GameBoy.Emulator.halt_bug = 0;
-            cpu->R16.PC--;
-            cpu->R16.PC &= 0xFFFF;
+            if (trace)
+                GB_TraceInstruction(instruction_pc, opcode);
+
+            if (GameBoy.Emulator.halt_bug)
+            {
+                GameBoy.Emulator.halt_bug = 0;
+                cpu->R16.PC--;
+                cpu->R16.PC &= 0xFFFF;
+            }
+
+            slow_checks = breakpoints || trace;
         }
 
         switch (opcode)
@@ -762,9 +1041,8 @@ static int GB_CPUExecute(int clocks)
                 gb_ld_r8_nn(cpu->R8.B);
                 break;
             case 0x07: // RLCA - 1
-                cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
-                cpu->F.C = (cpu->R8.A & 0x80) != 0;
-                cpu->R8.A = (cpu->R8.A << 1) | cpu->F.C;
+                cpu->R8.A = (cpu->R8.A << 1) | (cpu->R8.A >> 7);
+                cpu->R8.F = (cpu->R8.A & 0x01) << 4;
                 GB_CPUClockCounterAdd(4);
                 break;
             case 0x08: // LD [nnnn],SP - 5
@@ -799,9 +1077,8 @@ static int GB_CPUExecute(int clocks)
                 gb_ld_r8_nn(cpu->R8.C);
                 break;
             case 0x0F: // RRCA - 1
-                cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
-                cpu->F.C = (cpu->R8.A & 0x01) != 0;
-                cpu->R8.A = (cpu->R8.A >> 1) | (cpu->F.C << 7);
+                cpu->R8.A = (cpu->R8.A >> 1) | (cpu->R8.A << 7);
+                cpu->R8.F = (cpu->R8.A & 0x80) >> 3;
                 GB_CPUClockCounterAdd(4);
                 break;
             case 0x10: // STOP - 1*
@@ -830,6 +1107,11 @@ static int GB_CPUExecute(int clocks)
                         GameBoy.Emulator.cpu_change_speed_clocks = 128 * 1024;
                         GameBoy.Emulator.cpu_change_speed_clocks -= 84;
 
+                        // The clocks before the switch are counted with the
+                        // old speed.
+                        GB_RTCUpdateClocksCounterReference(
+                                GB_CPUClockCounterGet());
+
                         GameBoy.Emulator.DoubleSpeed ^= 1;
                         mem->IO_Ports[KEY1_REG - 0xFF00] =
                                 GameBoy.Emulator.DoubleSpeed << 7;
@@ -839,7 +1121,7 @@ static int GB_CPUExecute(int clocks)
                         GameBoy.Emulator.CPUHalt = 2;
                     }
                 }
-                GB_CPUBreakLoop();
+                GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
                 break;
             case 0x11: // LD DE,nnnn - 3
                 gb_ld_r16_nnnn(cpu->R8.D, cpu->R8.E);
@@ -861,10 +1143,9 @@ static int GB_CPUExecute(int clocks)
                 break;
             case 0x17: // RLA - 1
             {
-                cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
-                u32 temp = cpu->F.C; // Old carry flag
-                cpu->F.C = (cpu->R8.A & 0x80) != 0;
-                cpu->R8.A = (cpu->R8.A << 1) | temp;
+                u32 temp = (cpu->R8.A << 1) | cpu->F.C;
+                cpu->R8.F = (temp & 0x100) >> 4;
+                cpu->R8.A = temp;
                 GB_CPUClockCounterAdd(4);
                 break;
             }
@@ -897,10 +1178,9 @@ static int GB_CPUExecute(int clocks)
                 break;
             case 0x1F: // RRA - 1
             {
-                cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_ZERO);
-                u32 temp = cpu->F.C; // Old carry flag
-                cpu->F.C = cpu->R8.A & 0x01;
-                cpu->R8.A = (cpu->R8.A >> 1) | (temp << 7);
+                u32 temp = cpu->R8.A | (cpu->F.C << 8);
+                cpu->R8.F = (temp & 0x01) << 4;
+                cpu->R8.A = temp >> 1;
                 GB_CPUClockCounterAdd(4);
                 break;
             }
@@ -941,9 +1221,9 @@ static int GB_CPUExecute(int clocks)
                 gb_jr_cond_nn(cpu->F.Z);
                 break;
             case 0x29: // ADD HL,HL - 2
-                cpu->R16.AF &= ~F_SUBTRACT;
-                cpu->F.C = (cpu->R16.HL & 0x8000) != 0;
-                cpu->F.H = (cpu->R16.HL & 0x0800) != 0;
+                cpu->R8.F = (cpu->R8.F & F_ZERO)
+                            | ((cpu->R16.HL & 0x8000) >> 11)
+                            | ((cpu->R16.HL & 0x0800) >> 6);
                 cpu->R16.HL = (cpu->R16.HL << 1) & 0xFFFF;
                 GB_CPUClockCounterAdd(8);
                 break;
@@ -990,10 +1270,9 @@ static int GB_CPUExecute(int clocks)
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.HL);
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~F_SUBTRACT;
-                cpu->F.H = ((temp & 0xF) == 0xF);
                 temp = (temp + 1) & 0xFF;
-                cpu->F.Z = (temp == 0);
+                cpu->R8.F = (cpu->R8.F & F_CARRY) | gb_flag_zero(temp)
+                            | ((temp & 0xF) ? 0 : F_HALFCARRY);
                 GB_MemWrite8(cpu->R16.HL, temp);
                 GB_CPUClockCounterAdd(4);
                 break;
@@ -1003,10 +1282,10 @@ static int GB_CPUExecute(int clocks)
                 GB_CPUClockCounterAdd(4);
                 u32 temp = GB_MemRead8(cpu->R16.HL);
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF |= F_SUBTRACT;
-                cpu->F.H = ((temp & 0xF) == 0x0);
                 temp = (temp - 1) & 0xFF;
-                cpu->F.Z = (temp == 0);
+                cpu->R8.F = (cpu->R8.F & F_CARRY) | gb_flag_zero(temp)
+                            | (((temp & 0xF) == 0xF) ? F_HALFCARRY : 0)
+                            | F_SUBTRACT;
                 GB_MemWrite8(cpu->R16.HL, temp);
                 GB_CPUClockCounterAdd(4);
                 break;
@@ -1021,8 +1300,7 @@ static int GB_CPUExecute(int clocks)
                 break;
             }
             case 0x37: // SCF - 1
-                cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                cpu->R16.AF |= F_CARRY;
+                cpu->R8.F = (cpu->R8.F & F_ZERO) | F_CARRY;
                 GB_CPUClockCounterAdd(4);
                 break;
             case 0x38: // JR C,nn - 3/2
@@ -1050,8 +1328,7 @@ static int GB_CPUExecute(int clocks)
                 gb_ld_r8_nn(cpu->R8.A);
                 break;
             case 0x3F: // CCF - 1
-                cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                cpu->F.C = !cpu->F.C;
+                cpu->R8.F = (cpu->R8.F & (F_ZERO | F_CARRY)) ^ F_CARRY;
                 GB_CPUClockCounterAdd(4);
                 break;
             case 0x40: // LD B,B - 1
@@ -1271,7 +1548,7 @@ static int GB_CPUExecute(int clocks)
                         GameBoy.Emulator.CPUHalt = 1;
                     }
                 }
-                GB_CPUBreakLoop();
+                GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
                 break;
             case 0x77: // LD [HL],A - 2
                 gb_ld_ptr_r16_r8(cpu->R16.HL, cpu->R8.A);
@@ -1327,23 +1604,12 @@ static int GB_CPUExecute(int clocks)
             case 0x86: // ADD A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~F_SUBTRACT;
-                u32 temp = cpu->R8.A;
-                u32 temp2 = GB_MemRead8(cpu->R16.HL);
-                cpu->F.H = ((temp & 0xF) + (temp2 & 0xF)) > 0xF;
-                cpu->R8.A += temp2;
-                cpu->F.Z = (cpu->R8.A == 0);
-                cpu->F.C = (temp > cpu->R8.A);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_add_a_r8(value);
                 break;
             }
             case 0x87: // ADD A,A - 1
-                cpu->R16.AF &= ~F_SUBTRACT;
-                cpu->F.H = (cpu->R8.A & BIT(3)) != 0;
-                cpu->F.C = (cpu->R8.A & BIT(7)) != 0;
-                cpu->R8.A += cpu->R8.A;
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                gb_add_a_r8(cpu->R8.A);
                 break;
             case 0x88: // ADC A,B - 1
                 gb_adc_a_r8(cpu->R8.B);
@@ -1366,30 +1632,13 @@ static int GB_CPUExecute(int clocks)
             case 0x8E: // ADC A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~F_SUBTRACT;
-                u32 temp = GB_MemRead8(cpu->R16.HL);
-                u32 temp2 = cpu->R8.A + temp + cpu->F.C;
-                cpu->F.H = (((cpu->R8.A & 0xF) + (temp & 0xF)) + cpu->F.C) > 0xF;
-                cpu->F.C = (temp2 > 0xFF);
-                temp2 &= 0xFF;
-                cpu->R8.A = temp2;
-                cpu->F.Z = (temp2 == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_adc_a_r8(value);
                 break;
             }
             case 0x8F: // ADC A,A - 1
-            {
-                cpu->R16.AF &= ~F_SUBTRACT;
-                u32 temp = (((u32)cpu->R8.A) << 1) + cpu->F.C;
-                // Carry flag not needed to test this
-                cpu->F.H = (cpu->R8.A & 0x08) != 0;
-                cpu->F.C = (temp > 0xFF);
-                temp &= 0xFF;
-                cpu->R8.A = temp;
-                cpu->F.Z = (temp == 0);
-                GB_CPUClockCounterAdd(4);
+                gb_adc_a_r8(cpu->R8.A);
                 break;
-            }
             case 0x90: // SUB A,B - 1
                 gb_sub_a_r8(cpu->R8.B);
                 break;
@@ -1411,13 +1660,8 @@ static int GB_CPUExecute(int clocks)
             case 0x96: // SUB A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.HL);
-                cpu->R8.F = F_SUBTRACT;
-                cpu->F.H = (cpu->R8.A & 0xF) < (temp & 0xF);
-                cpu->F.C = (u32)cpu->R8.A < (u32)temp;
-                cpu->R8.A -= temp;
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_sub_a_r8(value);
                 break;
             }
             case 0x97: // SUB A,A - 1
@@ -1446,14 +1690,8 @@ static int GB_CPUExecute(int clocks)
             case 0x9E: // SBC A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp2 = GB_MemRead8(cpu->R16.HL);
-                u32 temp = cpu->R8.A - temp2 - ((cpu->R8.F & F_CARRY) ? 1 : 0);
-                cpu->R8.F = ((temp & ~0xFF) ? F_CARRY : 0)
-                            | ((temp & 0xFF) ? 0 : F_ZERO)
-                            | F_SUBTRACT;
-                cpu->F.H = ((cpu->R8.A ^ temp2 ^ temp) & 0x10) != 0;
-                cpu->R8.A = temp;
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_sbc_a_r8(value);
                 break;
             }
             case 0x9F: // SBC A,A - 1
@@ -1481,19 +1719,14 @@ static int GB_CPUExecute(int clocks)
                 gb_and_a_r8(cpu->R8.L);
                 break;
             case 0xA6: // AND A,[HL] - 2
+            {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF |= F_HALFCARRY;
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);
-                cpu->R8.A &= GB_MemRead8(cpu->R16.HL);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_and_a_r8(value);
                 break;
+            }
             case 0xA7: // AND A,A - 1
-                cpu->R16.AF |= F_HALFCARRY;
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);
-                //cpu->R8.A &= cpu->R8.A;
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                gb_and_a_r8(cpu->R8.A);
                 break;
             case 0xA8: // XOR A,B - 1
                 gb_xor_a_r8(cpu->R8.B);
@@ -1514,12 +1747,12 @@ static int GB_CPUExecute(int clocks)
                 gb_xor_a_r8(cpu->R8.L);
                 break;
             case 0xAE: // XOR A,[HL] - 2
+            {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                cpu->R8.A ^= GB_MemRead8(cpu->R16.HL);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_xor_a_r8(value);
                 break;
+            }
             case 0xAF: // XOR A,A - 1
                 cpu->R16.AF = F_ZERO;
                 GB_CPUClockCounterAdd(4);
@@ -1543,17 +1776,14 @@ static int GB_CPUExecute(int clocks)
                 gb_or_a_r8(cpu->R8.L);
                 break;
             case 0xB6: // OR A,[HL] - 2
+            {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                cpu->R8.A |= GB_MemRead8(cpu->R16.HL);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_or_a_r8(value);
                 break;
+            }
             case 0xB7: // OR A,A - 1
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                //cpu->R8.A |= cpu->R8.A;
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                gb_or_a_r8(cpu->R8.A);
                 break;
             case 0xB8: // CP A,B - 1
                 gb_cp_a_r8(cpu->R8.B);
@@ -1576,17 +1806,12 @@ static int GB_CPUExecute(int clocks)
             case 0xBE: // CP A,[HL] - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF |= F_SUBTRACT;
-                u32 temp = GB_MemRead8(cpu->R16.HL);
-                cpu->F.H = (cpu->R8.A & 0xF) < (temp & 0xF);
-                cpu->F.C = (u32)cpu->R8.A < temp;
-                cpu->F.Z = (cpu->R8.A == temp);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.HL);
+                gb_cp_a_r8(value);
                 break;
             }
             case 0xBF: // CP A,A - 1
-                cpu->R16.AF |= (F_SUBTRACT | F_ZERO);
-                cpu->R16.AF &= ~(F_HALFCARRY | F_CARRY);
+                cpu->R8.F = F_SUBTRACT | F_ZERO;
                 GB_CPUClockCounterAdd(4);
                 break;
             case 0xC0: // RET NZ - 5/2
@@ -1620,14 +1845,8 @@ static int GB_CPUExecute(int clocks)
             case 0xC6: // ADD A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~F_SUBTRACT;
-                u32 temp = cpu->R8.A;
-                u32 temp2 = GB_MemRead8(cpu->R16.PC++);
-                cpu->F.H = ((temp & 0xF) + (temp2 & 0xF)) > 0xF;
-                cpu->R8.A += temp2;
-                cpu->F.Z = (cpu->R8.A == 0);
-                cpu->F.C = (temp > cpu->R8.A);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_add_a_r8(value);
                 break;
             }
             case 0xC7: // RST 0x0000 - 4
@@ -1682,10 +1901,8 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        cpu->F.C = (temp & 0x80) != 0;
-                        temp = (temp << 1) | cpu->F.C;
-                        cpu->F.Z = (temp == 0);
+                        temp = ((temp << 1) | (temp >> 7)) & 0xFF;
+                        cpu->R8.F = gb_flag_zero(temp) | ((temp & 0x01) << 4);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -1717,10 +1934,8 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        cpu->F.C = (temp & 0x01) != 0;
-                        temp = (temp >> 1) | (cpu->F.C << 7);
-                        cpu->F.Z = (temp == 0);
+                        temp = ((temp >> 1) | (temp << 7)) & 0xFF;
+                        cpu->R8.F = gb_flag_zero(temp) | ((temp & 0x80) >> 3);
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -1752,11 +1967,10 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp2 = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        u32 temp = cpu->F.C; // Old carry flag
-                        cpu->F.C = (temp2 & 0x80) != 0;
-                        temp2 = ((temp2 << 1) | temp) & 0xFF;
-                        cpu->F.Z = (temp2 == 0);
+                        temp2 = (temp2 << 1) | cpu->F.C;
+                        cpu->R8.F = gb_flag_zero(temp2)
+                                    | ((temp2 & 0x100) >> 4);
+                        temp2 &= 0xFF;
                         GB_MemWrite8(cpu->R16.HL, temp2);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -1788,11 +2002,10 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp2 = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        u32 temp = cpu->F.C; // Old carry flag
-                        cpu->F.C = (temp2 & 0x01) != 0;
-                        temp2 = (temp2 >> 1) | (temp << 7);
-                        cpu->F.Z = (temp2 == 0);
+                        temp2 |= cpu->F.C << 8;
+                        cpu->R8.F = gb_flag_zero(temp2 >> 1)
+                                    | ((temp2 & 0x01) << 4);
+                        temp2 >>= 1;
                         GB_MemWrite8(cpu->R16.HL, temp2);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -1824,10 +2037,9 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        cpu->F.C = (temp & 0x80) != 0;
-                        temp = (temp << 1) & 0xFF;
-                        cpu->F.Z = (temp == 0);
+                        temp <<= 1;
+                        cpu->R8.F = gb_flag_zero(temp) | ((temp & 0x100) >> 4);
+                        temp &= 0xFF;
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -1859,10 +2071,9 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        cpu->F.C = (temp & 0x01) != 0;
+                        u32 carry = (temp & 0x01) << 4;
                         temp = (temp & 0x80) | (temp >> 1);
-                        cpu->F.Z = (temp == 0);
+                        cpu->R8.F = gb_flag_zero(temp) | carry;
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -1894,10 +2105,9 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY | F_CARRY);
                         temp = ((temp >> 4) | (temp << 4)) & 0xFF;
+                        cpu->R8.F = gb_flag_zero(temp);
                         GB_MemWrite8(cpu->R16.HL, temp);
-                        cpu->F.Z = (temp == 0);
                         GB_CPUClockCounterAdd(4);
                         break;
                     }
@@ -1928,10 +2138,9 @@ static int GB_CPUExecute(int clocks)
                         GB_CPUClockCounterAdd(4);
                         u32 temp = GB_MemRead8(cpu->R16.HL);
                         GB_CPUClockCounterAdd(4);
-                        cpu->R16.AF &= ~(F_SUBTRACT | F_HALFCARRY);
-                        cpu->F.C = (temp & 0x01) != 0;
+                        u32 carry = (temp & 0x01) << 4;
                         temp = temp >> 1;
-                        cpu->F.Z = (temp == 0);
+                        cpu->R8.F = gb_flag_zero(temp) | carry;
                         GB_MemWrite8(cpu->R16.HL, temp);
                         GB_CPUClockCounterAdd(4);
                         break;
@@ -2557,14 +2766,8 @@ static int GB_CPUExecute(int clocks)
             case 0xCE: // ADC A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~F_SUBTRACT;
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
-                u32 temp2 = cpu->R8.A + temp + cpu->F.C;
-                cpu->F.H = (((cpu->R8.A & 0xF) + (temp & 0xF)) + cpu->F.C) > 0xF;
-                cpu->F.C = (temp2 > 0xFF);
-                cpu->R8.A = (temp2 & 0xFF);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_adc_a_r8(value);
                 break;
             }
             case 0xCF: // RST 0x0008 - 4
@@ -2591,13 +2794,8 @@ static int GB_CPUExecute(int clocks)
             case 0xD6: // SUB A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
-                cpu->R16.AF |= F_SUBTRACT;
-                cpu->F.H = (cpu->R8.A & 0xF) < (temp & 0xF);
-                cpu->F.C = (u32)cpu->R8.A < temp;
-                cpu->R8.A -= temp;
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_sub_a_r8(value);
                 break;
             }
             case 0xD7: // RST 0x0010 - 4
@@ -2618,7 +2816,7 @@ static int GB_CPUExecute(int clocks)
                 cpu->R16.PC = temp;
                 GameBoy.Memory.InterruptMasterEnable = 1;
                 GB_CPUClockCounterAdd(4);
-                GB_CPUBreakLoop();
+                GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
                 break;
             }
             case 0xDA: // JP C,nnnn - 4/3
@@ -2636,14 +2834,8 @@ static int GB_CPUExecute(int clocks)
             case 0xDE: // SBC A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                u32 temp2 = GB_MemRead8(cpu->R16.PC++);
-                u32 temp = cpu->R8.A - temp2 - ((cpu->R8.F & F_CARRY) ? 1 : 0);
-                cpu->R8.F = ((temp & ~0xFF) ? F_CARRY : 0)
-                            | ((temp & 0xFF) ? 0 : F_ZERO)
-                            | F_SUBTRACT;
-                cpu->F.H = ((cpu->R8.A ^ temp2 ^ temp) & 0x10) != 0;
-                cpu->R8.A = temp;
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_sbc_a_r8(value);
                 break;
             }
             case 0xDF: // RST 0x0018 - 4
@@ -2678,11 +2870,8 @@ static int GB_CPUExecute(int clocks)
             case 0xE6: // AND A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY);
-                cpu->R16.AF |= F_HALFCARRY;
-                cpu->R8.A &= GB_MemRead8(cpu->R16.PC++);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_and_a_r8(value);
                 break;
             }
             case 0xE7: // RST 0x0020 - 4
@@ -2693,9 +2882,9 @@ static int GB_CPUExecute(int clocks)
                 GB_CPUClockCounterAdd(4);
                 // Expand sign
                 u32 temp = (u16)(s16)(s8)GB_MemRead8(cpu->R16.PC++);
-                cpu->R8.F = 0;
-                cpu->F.C = ((cpu->R16.SP & 0x00FF) + (temp & 0x00FF)) > 0x00FF;
-                cpu->F.H = ((cpu->R16.SP & 0x000F) + (temp & 0x000F)) > 0x000F;
+                // The flags come from the carries out of bits 3 and 7
+                u32 carries = cpu->R16.SP ^ temp ^ (cpu->R16.SP + temp);
+                cpu->R8.F = ((carries & 0x10) << 1) | ((carries & 0x100) >> 4);
                 cpu->R16.SP = (cpu->R16.SP + temp) & 0xFFFF;
                 GB_CPUClockCounterAdd(12);
                 break;
@@ -2727,12 +2916,12 @@ static int GB_CPUExecute(int clocks)
                 gb_undefined_opcode(opcode);
                 break;
             case 0xEE: // XOR A,nn - 2
+            {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                cpu->R8.A ^= GB_MemRead8(cpu->R16.PC++);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_xor_a_r8(value);
                 break;
+            }
             case 0xEF: // RST 0x0028 - 4
                 gb_rst_nnnn(0x0028);
                 break;
@@ -2767,12 +2956,12 @@ static int GB_CPUExecute(int clocks)
                 gb_push_r16(cpu->R8.A, cpu->R8.F);
                 break;
             case 0xF6: // OR A,nn - 2
+            {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF &= ~(F_SUBTRACT | F_CARRY | F_HALFCARRY);
-                cpu->R8.A |= GB_MemRead8(cpu->R16.PC++);
-                cpu->F.Z = (cpu->R8.A == 0);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_or_a_r8(value);
                 break;
+            }
             case 0xF7: // RST 0x0030 - 4
                 gb_rst_nnnn(0x0030);
                 break;
@@ -2783,9 +2972,9 @@ static int GB_CPUExecute(int clocks)
                 cpu->R16.PC &= 0xFFFF;
                 s32 res = (s32)cpu->R16.SP + temp;
                 cpu->R16.HL = res & 0xFFFF;
-                cpu->R8.F = 0;
-                cpu->F.C = ((cpu->R16.SP & 0x00FF) + (temp & 0x00FF)) > 0x00FF;
-                cpu->F.H = ((cpu->R16.SP & 0x000F) + (temp & 0x000F)) > 0x000F;
+                // The flags come from the carries out of bits 3 and 7
+                u32 carries = cpu->R16.SP ^ temp ^ res;
+                cpu->R8.F = ((carries & 0x10) << 1) | ((carries & 0x100) >> 4);
                 GB_CPUClockCounterAdd(8);
                 break;
             }
@@ -2808,6 +2997,7 @@ static int GB_CPUExecute(int clocks)
             }
             case 0xFB: // EI - 1
                 GameBoy.Memory.interrupts_enable_count = 1;
+                slow_checks = 1;
                 //GameBoy.Memory.InterruptMasterEnable = 1;
                 GB_CPUClockCounterAdd(4);
                 break;
@@ -2820,13 +3010,8 @@ static int GB_CPUExecute(int clocks)
             case 0xFE: // CP A,nn - 2
             {
                 GB_CPUClockCounterAdd(4);
-                cpu->R16.AF |= F_SUBTRACT;
-                u32 temp = GB_MemRead8(cpu->R16.PC++);
-                u32 temp2 = cpu->R8.A;
-                cpu->F.H = (temp2 & 0xF) < (temp & 0xF);
-                cpu->F.C = (temp2 < temp);
-                cpu->F.Z = (temp2 == temp);
-                GB_CPUClockCounterAdd(4);
+                u32 value = GB_MemRead8(cpu->R16.PC++);
+                gb_cp_a_r8(value);
                 break;
             }
             case 0xFF: // RST 0x0038 - 4
@@ -2844,17 +3029,24 @@ static int GB_CPUExecute(int clocks)
                 break;
         } // End switch
 
-        if (gb_break_cpu_loop) // Some event happened - handle it out of loop
+#ifdef ENABLE_OPCODE_PROFILE
+        if (opprofile)
         {
-            gb_break_cpu_loop = 0;
-            break;
+            u32 index = OPPROFILE_GB(opprofile_prefix | opcode);
+            OPProfile_Executed(index);
+            OPProfile_Cycles(index, GB_CPUClockCounterGet() - opprofile_clocks);
         }
+#endif
 
-        // Debug break function
-        if (gb_break_execution)
+        // Short jumps backwards can be idle loops
+        if (((instruction_pc - cpu->R16.PC) & 0xFFFF) < GB_IDLE_LOOP_MAX_SIZE)
+            GB_CPUIdleLoopCheck(finish_clocks);
+
+        // Some event happened - handle it out of loop. This is also set by
+        // _gb_break_to_debugger(), but don't clear gb_break_execution here!
+        if (gb_break_cpu_loop)
         {
-            // Something important has happened - exit from execution.
-            // Don't set this flag to 0 here!
+            gb_break_cpu_loop = 0;
             break;
         }
 
@@ -2866,11 +3058,11 @@ static int GB_CPUExecute(int clocks)
 //----------------------------------------------------------------
 
 // Returns 1 if breakpoint executed
-int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
+static int GB_RunForClocks(s32 run_for_clocks)
 {
     gb_break_execution = 0;
 
-    Win_GBDisassemblerStartAddressSetDefault();
+    GB_DebugNotifyRun();
 
     run_for_clocks += gb_last_residual_clocks;
     if (run_for_clocks < 0)
@@ -2880,8 +3072,13 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
 
     while (1)
     {
-        int clocks_to_next_event = GB_ClocksForNextEvent();
-        clocks_to_next_event = min(clocks_to_next_event, run_for_clocks);
+        _profile_slice_e reason;
+        int clocks_to_next_event = GB_ClocksForNextEvent(&reason);
+        if (run_for_clocks < clocks_to_next_event)
+        {
+            clocks_to_next_event = run_for_clocks;
+            reason = PROFILE_SLICE_OTHER;
+        }
 
         if (clocks_to_next_event > 0)
         {
@@ -2919,24 +3116,33 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
                             // GB_CPUClockCounterAdd() internal
                             executed_clocks =
                                     GB_CPUExecute(clocks_to_next_event);
+                            // The CPU loop has been stopped
+                            if (executed_clocks < clocks_to_next_event)
+                                reason = gb_break_cpu_loop_reason;
                         }
                         else // Halt or stop
                         {
-                            executed_clocks = clocks_to_next_event;
-                            GB_CPUClockCounterAdd(clocks_to_next_event);
+                            executed_clocks =
+                                    GB_CPUHaltClocksToSkip(clocks_to_next_event,
+                                                           run_for_clocks);
+                            GB_CPUClockCounterAdd(executed_clocks);
                         }
                     }
                     else
                     {
                         executed_clocks = irq_executed_clocks;
+                        reason = PROFILE_SLICE_IRQ;
                     }
                 }
                 else
                 {
                     executed_clocks = dma_executed_clocks;
+                    reason = PROFILE_SLICE_DMA;
                 }
             }
 
+            Profile_SliceEnd(reason, executed_clocks);
+
             run_for_clocks -= executed_clocks;
         }
 
@@ -2944,6 +3150,7 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
 
         if ((run_for_clocks <= 0) || GameBoy.Emulator.FrameDrawn)
         {
+            GB_UpdateAllCountersToClocks(GB_CPUClockCounterGet());
             gb_last_residual_clocks = run_for_clocks;
             GameBoy.Emulator.FrameDrawn = 0;
             return 0;
@@ -2951,6 +3158,7 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
 
         if (gb_break_execution)
         {
+            GB_UpdateAllCountersToClocks(GB_CPUClockCounterGet());
             gb_last_residual_clocks = 0;
             return 1;
         }
@@ -2960,8 +3168,33 @@ int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
     return 0;
 }
 
+int GB_RunFor(s32 run_for_clocks) // 1 frame = 70224 clocks
+{
+    GB_DebugWatchpointsArm(1);
+    int ret = GB_RunForClocks(run_for_clocks);
+    GB_DebugWatchpointsArm(0);
+
+    return ret;
+}
+
 void GB_RunForInstruction(void)
 {
     gb_last_residual_clocks = 0;
     GB_RunFor(4);
 }
+
+//----------------------------------------------------------------
+
+void GB_CPUStateSave(_savestate_t *st)
+{
+    SaveState_WriteChunk(st, "CPU ", &gb_last_residual_clocks,
+                         sizeof(gb_last_residual_clocks));
+}
+
+void GB_CPUStateLoad(_savestate_t *st)
+{
+    SaveState_ReadChunk(st, "CPU ", &gb_last_residual_clocks,
+                        sizeof(gb_last_residual_clocks));
+
+    gb_idle_loop_valid = 0;
+}
@@ -7,6 +7,9 @@
 #ifndef GB_CPU__
 #define GB_CPU__
 
+#include "../profile_utils.h"
+#include "../savestate_utils.h"
+
 #include "gameboy.h"
 
 void GB_CPUInit(void);
@@ -22,10 +25,44 @@ void GB_UpdateCounterToClocks(int reference_clocks);
 
 //----------------------------------------------------------------
 
+// Systems of the GB that are updated lazily. When the CPU loop exits, they are
+// only updated if they have reached their next event. The rest of the time they
+// catch up when their registers are accessed, or at the end of GB_RunFor().
+// Sound and DMA are updated every time the CPU loop exits.
+typedef enum
+{
+    GB_EVENT_TIMERS,
+    GB_EVENT_PPU,
+    GB_EVENT_SERIAL,
+    GB_EVENT_CAMERA,
+    GB_EVENT_PCPROFILE,
+
+    GB_EVENT_NUMBER
+} _gb_event_source_e;
+
+// This has to be called from the *UpdateClocksCounterReference() function of
+// all the systems above. The state of the system may be modified right after
+// the update (by a register write, for example), so the time of its next event
+// is calculated again before the CPU loop is entered.
+void GB_CPUEventSourceUpdated(_gb_event_source_e source, int reference_clocks);
+
+//----------------------------------------------------------------
+
 // This will make the execution to exit the CPU loop and update the other
 // systems of the GB. Call when writing to a register that can generate an
-// event!!!
-void GB_CPUBreakLoop(void);
+// event!!! The reason is only used to tell the profiler why the slice of CPU
+// execution has ended.
+void GB_CPUBreakLoop(_profile_slice_e reason);
+
+// Like GB_CPUBreakLoop(), but it also stops the emulation until the user resumes
+// it from the debugger.
+void _gb_break_to_debugger(void);
+
+//----------------------------------------------------------------
+
+// Set when the CPU writes to memory or reads a register that can change without
+// generating an event. Loops that do it are never considered idle loops.
+extern core_local__ int gb_idle_loop_unsafe;
 
 //----------------------------------------------------------------
 
@@ -35,4 +72,11 @@ int GB_RunFor(s32 clocks);
 
 void GB_RunForInstruction(void);
 
+//----------------------------------------------------------------
+
+// The clock counters and the events of the lazy systems aren't saved because
+// GB_RunFor() starts from scratch every time it is called.
+void GB_CPUStateSave(_savestate_t *st);
+void GB_CPUStateLoad(_savestate_t *st);
+
 #endif // GB_CPU__
@@ -9,8 +9,12 @@
 #include <string.h>
 
 #include "../build_options.h"
+#include "../debug_utils.h"
 #include "../font_utils.h"
 #include "../general_utils.h"
+#include "../opprofile_utils.h"
+#include "../pcprofile_utils.h"
+#include "../trace_utils.h"
 
 #include "cpu.h"
 #include "debug.h"
@@ -21,111 +25,232 @@
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
-#define GB_MAX_BREAKPOINTS 20
+// Set by the frontend, they are the same for all the consoles of the process
+static void (*gb_debug_run_callback)(void) = NULL;
+static void (*gb_debug_break_callback)(void) = NULL;
 
-static u32 gb_brkpoint_addrlist[GB_MAX_BREAKPOINTS];
-static int gb_brkpoint_used[GB_MAX_BREAKPOINTS];
-static int gb_any_breakpoint_used = 0;
+void GB_DebugSetCallbacks(void (*run_fn)(void), void (*break_fn)(void))
+{
+    gb_debug_run_callback = run_fn;
+    gb_debug_break_callback = break_fn;
+}
+
+void GB_DebugNotifyRun(void)
+{
+    if (gb_debug_run_callback)
+        gb_debug_run_callback();
+}
+
+void GB_DebugNotifyBreak(void)
+{
+    if (gb_debug_break_callback)
+        gb_debug_break_callback();
+}
+
+//------------------------------------------------------------------------------
+
+// The CPU can only execute code in the 16-bit address space, so there is a bit
+// for each address and there is no limit to the number of breakpoints.
+
+static core_local__ u8 gb_brkpoint_bitmap[0x10000 / 8];
+static core_local__ int gb_brkpoint_num = 0;
 
 int GB_DebugIsBreakpoint(u32 addr)
 {
-    if (gb_any_breakpoint_used == 0)
+    if (addr > 0xFFFF)
         return 0;
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
-    {
-        if (gb_brkpoint_used[i])
-        {
-            if (gb_brkpoint_addrlist[i] == addr)
-            {
-                return 1;
-            }
-        }
-    }
-    return 0;
+    return (gb_brkpoint_bitmap[addr >> 3] & BIT(addr & 7)) != 0;
 }
 
-static u32 gb_last_executed_opcode = 1;
+static core_local__ u32 gb_last_executed_opcode = 1;
 
 int GB_DebugCPUIsBreakpoint(u32 addr)
 {
-    if (gb_any_breakpoint_used == 0)
-        return 0;
-
     if (gb_last_executed_opcode == addr)
     {
         gb_last_executed_opcode = 1;
         return 0;
     }
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
-    {
-        if (gb_brkpoint_used[i])
-        {
-            if (gb_brkpoint_addrlist[i] == addr)
-            {
-                gb_last_executed_opcode = addr;
-                return 1;
-            }
-        }
-    }
-    return 0;
+    if (GB_DebugIsBreakpoint(addr) == 0)
+        return 0;
+
+    gb_last_executed_opcode = addr;
+    return 1;
+}
+
+int GB_DebugCPUBreakpointsUsed(void)
+{
+    return gb_brkpoint_num > 0;
 }
 
 void GB_DebugAddBreakpoint(u32 addr)
 {
-    if (GB_DebugIsBreakpoint(addr))
+    if ((addr > 0xFFFF) || GB_DebugIsBreakpoint(addr))
         return;
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
-    {
-        if (gb_brkpoint_used[i] == 0)
-        {
-            gb_brkpoint_addrlist[i] = addr;
-            gb_brkpoint_used[i] = 1;
-            gb_any_breakpoint_used = 1;
-            return;
-        }
-    }
+    gb_brkpoint_bitmap[addr >> 3] |= BIT(addr & 7);
+    gb_brkpoint_num++;
 }
 
 void GB_DebugClearBreakpoint(u32 addr)
 {
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    if (GB_DebugIsBreakpoint(addr) == 0)
+        return;
+
+    gb_brkpoint_bitmap[addr >> 3] &= ~BIT(addr & 7);
+    gb_brkpoint_num--;
+}
+
+void GB_DebugClearBreakpointAll(void)
+{
+    memset(gb_brkpoint_bitmap, 0, sizeof(gb_brkpoint_bitmap));
+    gb_brkpoint_num = 0;
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+    u32 start;
+    u32 end;
+    int type; // 0 if the slot is free
+} _gb_watchpoint_t;
+
+static core_local__ _gb_watchpoint_t gb_watchpoints[GB_MAX_WATCHPOINTS];
+
+core_local__ int gb_watchpoint_types = 0;
+core_local__ int gb_watchpoint_check_types = 0;
+
+void GB_DebugWatchpointsArm(int arm)
+{
+    gb_watchpoint_check_types = arm ? gb_watchpoint_types : 0;
+}
+
+static void gb_watchpoints_updated(void)
+{
+    gb_watchpoint_types = 0;
+    for (int i = 0; i < GB_MAX_WATCHPOINTS; i++)
+        gb_watchpoint_types |= gb_watchpoints[i].type;
+
+    GB_MemReadPagesUpdate();
+}
+
+int GB_DebugAddWatchpoint(u32 start, u32 end, int type)
+{
+    if (end < start)
     {
-        if (gb_brkpoint_used[i])
+        u32 tmp = start;
+        start = end;
+        end = tmp;
+    }
+
+    start &= 0xFFFF;
+    end &= 0xFFFF;
+
+    for (int i = 0; i < GB_MAX_WATCHPOINTS; i++)
+    {
+        _gb_watchpoint_t *w = &gb_watchpoints[i];
+
+        if (w->type == 0)
+            continue;
+
+        // Setting the same range again changes its type
+        if ((w->start == start) && (w->end == end))
         {
-            if (gb_brkpoint_addrlist[i] == addr)
-            {
-                gb_brkpoint_used[i] = 0;
-                break;
-            }
+            w->type = type;
+            gb_watchpoints_updated();
+            return 0;
         }
     }
 
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    for (int i = 0; i < GB_MAX_WATCHPOINTS; i++)
     {
-        if (gb_brkpoint_used[i])
+        _gb_watchpoint_t *w = &gb_watchpoints[i];
+
+        if (w->type == 0)
         {
-            return;
+            w->start = start;
+            w->end = end;
+            w->type = type;
+            gb_watchpoints_updated();
+            return 0;
         }
     }
 
-    gb_any_breakpoint_used = 0;
+    return 1;
 }
 
-void GB_DebugClearBreakpointAll(void)
+void GB_DebugClearWatchpoint(u32 start, u32 end)
 {
-    for (int i = 0; i < GB_MAX_BREAKPOINTS; i++)
+    if (end < start)
     {
-        gb_brkpoint_used[i] = 0;
+        u32 tmp = start;
+        start = end;
+        end = tmp;
     }
 
-    gb_any_breakpoint_used = 0;
+    for (int i = 0; i < GB_MAX_WATCHPOINTS; i++)
+    {
+        _gb_watchpoint_t *w = &gb_watchpoints[i];
+
+        if ((w->start == start) && (w->end == end))
+            w->type = 0;
+    }
+
+    gb_watchpoints_updated();
+}
+
+void GB_DebugClearWatchpointAll(void)
+{
+    memset(gb_watchpoints, 0, sizeof(gb_watchpoints));
+    gb_watchpoints_updated();
+}
+
+int GB_DebugGetWatchpoint(int index, u32 *start, u32 *end, int *type)
+{
+    _gb_watchpoint_t *w = &gb_watchpoints[index];
+
+    if (w->type == 0)
+        return 0;
+
+    *start = w->start;
+    *end = w->end;
+    *type = w->type;
+    return 1;
+}
+
+int GB_DebugWatchpointInRange(u32 first, u32 last, int type)
+{
+    for (int i = 0; i < GB_MAX_WATCHPOINTS; i++)
+    {
+        _gb_watchpoint_t *w = &gb_watchpoints[i];
+
+        if ((w->type & type) && (w->start <= last) && (first <= w->end))
+            return 1;
+    }
+
+    return 0;
+}
+
+void GB_DebugWatchpointCheck(u32 address, int type)
+{
+    if (GB_DebugWatchpointInRange(address, address, type) == 0)
+        return;
+
+    Debug_LogMsgArg("Watchpoint: %s %04X",
+                    (type == GB_WATCH_READ) ? "Read from" : "Write to",
+                    address);
+
+    // The access isn't interrupted, the execution stops after the current
+    // instruction.
+    _gb_break_to_debugger();
+    GB_DebugNotifyBreak();
 }
 
 //------------------------------------------------------------------------------
@@ -150,6 +275,13 @@ static const int debug_command_param_size[256] = {
     1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 2, 0, 0, 0, 1, 0
 };
 
+// Size of the instruction in bytes, opcode included
+static int gb_debug_opcode_size(u8 opcode)
+{
+    static const int size[4] = { 1, 2, 3, 2 };
+    return size[debug_command_param_size[opcode]];
+}
+
 static const char *debug_commands[256] = {
     "nop", "ld bc,#0x%04X", "ld [bc],a", "inc bc",
     "inc b", "dec b", "ld b,#0x%02X", "rlca",
@@ -386,6 +518,97 @@ static const int debug_commands_cb_info[256] = {
 
 //------------------------------------------------------------------------------
 
+// Clocks between samples of the PC profiler
+#define GB_PCPROFILE_PERIOD     (256)
+
+static core_local__ int gb_pcprofile_clock_counter = 0;
+static core_local__ int gb_pcprofile_clocks; // Clocks since the last sample
+
+void GB_PCProfileClockCounterReset(void)
+{
+    gb_pcprofile_clock_counter = 0;
+}
+
+void GB_PCProfileUpdateClocksCounterReference(int reference_clocks)
+{
+    GB_CPUEventSourceUpdated(GB_EVENT_PCPROFILE, reference_clocks);
+
+    int increment_clocks = reference_clocks - gb_pcprofile_clock_counter;
+    gb_pcprofile_clock_counter = reference_clocks;
+
+    if (pcprofile_enabled == 0)
+        return;
+
+    gb_pcprofile_clocks += increment_clocks;
+    if (gb_pcprofile_clocks < GB_PCPROFILE_PERIOD)
+        return;
+
+    // Code in the switchable ROM bank is told apart by the bank number
+    u32 address = GameBoy.CPU.R16.PC;
+    if ((address >= 0x4000) && (address < 0x8000))
+        address |= GameBoy.Memory.selected_rom << 16;
+
+    PCProfile_Sample(address, gb_pcprofile_clocks / GB_PCPROFILE_PERIOD);
+    gb_pcprofile_clocks %= GB_PCPROFILE_PERIOD;
+}
+
+int GB_PCProfileGetClocksToNextEvent(void)
+{
+    if (pcprofile_enabled == 0)
+        return 0x7FFFFFFF;
+
+    return GB_PCPROFILE_PERIOD - gb_pcprofile_clocks;
+}
+
+void GB_PCProfileSetEnabled(int enable)
+{
+    // Catch up with the previous state before changing it
+    GB_PCProfileUpdateClocksCounterReference(GB_CPUClockCounterGet());
+
+    gb_pcprofile_clocks = 0;
+
+    if (enable)
+        PCProfile_Start(PCPROFILE_GB);
+    else
+        PCProfile_Stop();
+
+#ifdef ENABLE_OPCODE_PROFILE
+    if (enable)
+        OPProfile_Start();
+    else
+        OPProfile_Stop();
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// Clocks executed before the last time the clock counters were reset
+static core_local__ u64 gb_trace_clocks = 0;
+
+void GB_TraceClockCounterReset(void)
+{
+    gb_trace_clocks += GB_CPUClockCounterGet();
+}
+
+void GB_TraceInstruction(u32 address, u8 opcode)
+{
+    u32 value = opcode;
+    int size = gb_debug_opcode_size(opcode);
+    for (int i = 1; i < size; i++)
+        value |= GB_MemRead8((address + i) & 0xFFFF) << (i * 8);
+
+    u32 mode = 0;
+    if (GameBoy.Emulator.DoubleSpeed)
+        mode |= TRACE_GB_MODE_DOUBLE_SPEED;
+    if (GameBoy.Memory.InterruptMasterEnable)
+        mode |= TRACE_GB_MODE_IME;
+
+    Trace_Add(address, value, size, mode,
+              gb_trace_clocks + GB_CPUClockCounterGet());
+}
+
+//------------------------------------------------------------------------------
+
 int gb_debug_get_address_increment(u32 address)
 {
     int temp;
@@ -511,57 +734,47 @@ int gb_dissasemble_add_io_register_name(int reg_address, char *dest,
     return 0;
 }
 
-static char text[128];
-char *GB_Dissasemble(u16 addr, int *step)
+// Writes the instruction to dest without any comment. It returns the size of
+// the instruction, and the information and parameter used for the comments.
+static int gb_disassemble_bytes(u16 addr, const u8 *bytes, char *dest,
+                                int dest_size, int *info_ret, int *param_ret)
 {
-    if ((addr == GameBoy.CPU.R16.PC) || gb_debug_get_address_is_code(addr))
-    {
-        u16 op_addr = addr;
+    u8 cmd = bytes[0];
+    int paramsize = debug_command_param_size[cmd];
 
-        u8 cmd = GB_MemRead8(addr++);
-        int paramsize = debug_command_param_size[cmd];
+    int info = 0;
+    int param = 0;
+    int step = 1;
 
-        int info = 0;
-        int param = 0;
+    addr++;
 
-        if (paramsize == 0) // Instruction without parameters
-        {
-            *step = 1;
-            snprintf(text, sizeof(text), "%02X       %s",
-                     cmd, debug_commands[cmd]);
-            info = debug_commands_info[cmd];
-            param = 0;
-        }
-        else if (paramsize == 1) // Instruction with one byte as parameter
-        {
-            char instr_text[64];
+    if (paramsize == 0) // Instruction without parameters
+    {
+        snprintf(dest, dest_size, "%02X       %s", cmd, debug_commands[cmd]);
+        info = debug_commands_info[cmd];
+        param = 0;
+    }
+    else if (paramsize == 1) // Instruction with one byte as parameter
+    {
+        char instr_text[64];
 
-            addr &= 0xFFFF;
-            param = (int)(u8)GB_MemRead8(addr++);
-            if (debug_commands[cmd] == NULL)
+        param = bytes[1];
+        if (debug_commands[cmd] == NULL)
+        {
+            if (cmd == 0x10) // STOP
             {
-                if (cmd == 0x10) // STOP
-                {
-                    s_strncpy(instr_text,
-                              (param == 0x00) ? "stop" : "stop ; [!] corrupted",
-                              sizeof(instr_text));
-                    param = 0;
-                    info = 0;
-                }
-                else if (cmd == 0xCB)
-                {
-                    s_strncpy(instr_text, debug_commands_cb[param],
-                              sizeof(instr_text));
-                    param = 0;
-                    info = debug_commands_cb_info[param];
-                }
-                else
-                {
-                    char temp[32];
-                    s_strncpy(temp, debug_commands[cmd], sizeof(temp));
-                    info = debug_commands_info[cmd];
-                    snprintf(instr_text, sizeof(instr_text), temp, param);
-                }
+                s_strncpy(instr_text,
+                          (param == 0x00) ? "stop" : "stop ; [!] corrupted",
+                          sizeof(instr_text));
+                param = 0;
+                info = 0;
+            }
+            else if (cmd == 0xCB)
+            {
+                s_strncpy(instr_text, debug_commands_cb[param],
+                          sizeof(instr_text));
+                param = 0;
+                info = debug_commands_cb_info[param];
             }
             else
             {
@@ -570,43 +783,88 @@ char *GB_Dissasemble(u16 addr, int *step)
                 info = debug_commands_info[cmd];
                 snprintf(instr_text, sizeof(instr_text), temp, param);
             }
-
-            snprintf(text, sizeof(text),
-                     "%02X%02X     %s", cmd, param, instr_text);
-            *step = 2;
-        }
-        else if (paramsize == 2) // Instruction with two bytes as parameters
-        {
-            char instr_text[64];
-
-            addr &= 0xFFFF;
-            u8 param1 = GB_MemRead8(addr++);
-            addr &= 0xFFFF;
-            u8 param2 = GB_MemRead8(addr++);
-            param = param1 | (param2 << 8);
-            char temp[32];
-            s_strncpy(temp, debug_commands[cmd], sizeof(temp));
-            snprintf(instr_text, sizeof(instr_text), temp, param);
-            info = debug_commands_info[cmd];
-            snprintf(text, sizeof(text),
-                     "%02X%02X%02X   %s", cmd, param1, param2, instr_text);
-            *step = 3;
         }
-        else if (paramsize == 3) // Relative jump
+        else
         {
-            param = (s8)GB_MemRead8(addr++);
             char temp[32];
-            char instr_text[64];
             s_strncpy(temp, debug_commands[cmd], sizeof(temp));
-            snprintf(instr_text, sizeof(instr_text), temp,
-                     (param + addr) & 0xFFFF);
             info = debug_commands_info[cmd];
-            snprintf(text, sizeof(text),
-                     "%02X%02X     %s", cmd, (u8)param, instr_text);
-            param = param + addr;
-            *step = 2;
+            snprintf(instr_text, sizeof(instr_text), temp, param);
         }
 
+        snprintf(dest, dest_size, "%02X%02X     %s", cmd, bytes[1],
+                 instr_text);
+        step = 2;
+    }
+    else if (paramsize == 2) // Instruction with two bytes as parameters
+    {
+        char instr_text[64];
+
+        u8 param1 = bytes[1];
+        u8 param2 = bytes[2];
+        param = param1 | (param2 << 8);
+        char temp[32];
+        s_strncpy(temp, debug_commands[cmd], sizeof(temp));
+        snprintf(instr_text, sizeof(instr_text), temp, param);
+        info = debug_commands_info[cmd];
+        snprintf(dest, dest_size,
+                 "%02X%02X%02X   %s", cmd, param1, param2, instr_text);
+        step = 3;
+    }
+    else if (paramsize == 3) // Relative jump
+    {
+        param = (s8)bytes[1];
+        addr++;
+        char temp[32];
+        char instr_text[64];
+        s_strncpy(temp, debug_commands[cmd], sizeof(temp));
+        snprintf(instr_text, sizeof(instr_text), temp,
+                 (param + addr) & 0xFFFF);
+        info = debug_commands_info[cmd];
+        snprintf(dest, dest_size,
+                 "%02X%02X     %s", cmd, (u8)param, instr_text);
+        param = param + addr;
+        step = 2;
+    }
+
+    *info_ret = info;
+    *param_ret = param;
+
+    return step;
+}
+
+int GB_DisassembleBytes(u16 addr, const u8 *bytes, char *dest, int dest_size)
+{
+    int info, param;
+    return gb_disassemble_bytes(addr, bytes, dest, dest_size, &info, &param);
+}
+
+static core_local__ int gb_disassemble_state_used;
+
+int GB_DisassemblerStateUsed(void)
+{
+    return gb_disassemble_state_used;
+}
+
+static core_local__ char text[128];
+char *GB_Dissasemble(u16 addr, int *step)
+{
+    gb_disassemble_state_used = 0;
+
+    if ((addr == GameBoy.CPU.R16.PC) || gb_debug_get_address_is_code(addr))
+    {
+        u16 op_addr = addr;
+
+        u8 bytes[3];
+        bytes[0] = GB_MemRead8(addr);
+        int size = gb_debug_opcode_size(bytes[0]);
+        for (int i = 1; i < size; i++)
+            bytes[i] = GB_MemRead8((addr + i) & 0xFFFF);
+
+        int info, param;
+        *step = gb_disassemble_bytes(op_addr, bytes, text, sizeof(text),
+                                     &info, &param);
+
         // Add extra information
         int comment_added = 0;
 
@@ -615,18 +873,22 @@ char *GB_Dissasemble(u16 addr, int *step)
             case OP_NONE:
                 break;
             case RW_BC:
+                gb_disassemble_state_used = 1;
                 comment_added = gb_dissasemble_add_io_register_name(
                         GameBoy.CPU.R16.BC, text, 1, sizeof(text));
                 break;
             case RW_DE:
+                gb_disassemble_state_used = 1;
                 comment_added = gb_dissasemble_add_io_register_name(
                         GameBoy.CPU.R16.DE, text, 1, sizeof(text));
                 break;
             case RW_HL:
+                gb_disassemble_state_used = 1;
                 comment_added = gb_dissasemble_add_io_register_name(
                         GameBoy.CPU.R16.HL, text, 1, sizeof(text));
                 break;
             case RW_SP:
+                gb_disassemble_state_used = 1;
                 comment_added = gb_dissasemble_add_io_register_name(
                         GameBoy.CPU.R16.SP, text, 1, sizeof(text));
                 break;
@@ -639,11 +901,13 @@ char *GB_Dissasemble(u16 addr, int *step)
                         param | 0xFF00, text, 1, sizeof(text));
                 break;
             case RW_FF_C:
+                gb_disassemble_state_used = 1;
                 comment_added = gb_dissasemble_add_io_register_name(
                         ((int)(u8)GameBoy.CPU.R8.C) | 0xFF00,
                         text, 1, sizeof(text));
                 break;
             case JMP_HL:
+                gb_disassemble_state_used = 1;
                 param = (int)(u16)GameBoy.CPU.R16.HL;
                 // fallthrough
             case JMP_REL:
@@ -668,6 +932,8 @@ char *GB_Dissasemble(u16 addr, int *step)
             int cond = info & 0xFFFF0000;
             if (cond)
             {
+                gb_disassemble_state_used = 1;
+
                 int cond_true = 0;
                 if (cond == COND_NZ)
                     cond_true = (GameBoy.CPU.F.Z == false);
@@ -9,14 +9,65 @@
 
 #include "gameboy.h"
 
+// Functions of the debugger called by the core. The first one is called every
+// time that the CPU starts running, the second one when the execution stops at
+// a breakpoint or a watchpoint. Both can be NULL.
+void GB_DebugSetCallbacks(void (*run_fn)(void), void (*break_fn)(void));
+void GB_DebugNotifyRun(void);
+void GB_DebugNotifyBreak(void);
+
 void GB_DebugAddBreakpoint(u32 addr);
 void GB_DebugClearBreakpoint(u32 addr);
 int GB_DebugIsBreakpoint(u32 addr);    // Used in debugger
 int GB_DebugCPUIsBreakpoint(u32 addr); // Used in CPU loop
+int GB_DebugCPUBreakpointsUsed(void);   // Used in CPU loop
 void GB_DebugClearBreakpointAll(void);
 
+// Watchpoints stop the execution after the CPU or a DMA read or write any
+// address in [start, end]. The pages of memory with read watchpoints are removed
+// from gb_mem_read_page[], so the rest of reads don't check them. There is no
+// page table for writes, they only check gb_watchpoint_check_types.
+
+#define GB_WATCH_READ           BIT(0)
+#define GB_WATCH_WRITE          BIT(1)
+
+#define GB_MAX_WATCHPOINTS      (16)
+
+// Returns 0 on success, 1 if there is no space for more watchpoints
+int GB_DebugAddWatchpoint(u32 start, u32 end, int type);
+void GB_DebugClearWatchpoint(u32 start, u32 end);
+void GB_DebugClearWatchpointAll(void);
+// Returns 1 and the watchpoint if the index is used, 0 if not
+int GB_DebugGetWatchpoint(int index, u32 *start, u32 *end, int *type);
+
+// Used by the memory handlers. The first one has the types of all watchpoints,
+// the second one is the same while GB_RunFor() runs and 0 the rest of the time,
+// so that the debugger windows can access memory without hitting them.
+extern core_local__ int gb_watchpoint_types;
+extern core_local__ int gb_watchpoint_check_types;
+void GB_DebugWatchpointsArm(int arm);
+int GB_DebugWatchpointInRange(u32 first, u32 last, int type);
+void GB_DebugWatchpointCheck(u32 address, int type);
+
+// PC profiler (see pcprofile_utils.h). It's updated as an event source.
+void GB_PCProfileSetEnabled(int enable);
+void GB_PCProfileClockCounterReset(void);
+void GB_PCProfileUpdateClocksCounterReference(int reference_clocks);
+int GB_PCProfileGetClocksToNextEvent(void);
+
+// Execution trace (see trace_utils.h)
+void GB_TraceClockCounterReset(void);
+void GB_TraceInstruction(u32 address, u8 opcode);
+
 int gb_debug_get_address_increment(u32 address);
 int gb_debug_get_address_is_code(u32 address);
 char *GB_Dissasemble(u16 addr, int *step);
+// Returns 1 if the text of the last instruction disassembled depends on the
+// registers of the CPU, so it can change even if the bytes of the instruction
+// don't. The text of the instruction pointed by PC always depends on them.
+int GB_DisassemblerStateUsed(void);
+// Disassembles the instruction in bytes (as many as it needs, up to 3) without
+// reading memory or the registers. Returns the size of the instruction.
+int GB_DisassembleBytes(u16 addr, const u8 *bytes, char *dest, int dest_size);
 
 #endif // GB_DEBUG__
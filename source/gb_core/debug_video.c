@@ -22,7 +22,7 @@
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -227,17 +227,11 @@ void GB_Debug_PrintSprite(char *buf, int bufw, unused__ int bufh, int buff_x,
                 else
                     data += y * 2;
 
-                int x_;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
-
-                x_ = 7 - x_;
-
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 for (int i = 0; i < 2; i++)
                 {
@@ -296,17 +290,11 @@ void GB_Debug_PrintSprite(char *buf, int bufw, unused__ int bufh, int buff_x,
                 else
                     data += y * 2;
 
-                int x_;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                if (GB_Sprite->Info & (1 << 5))
-                    x_ = 7 - x; // Flip X
-                else
-                    x_ = x;
-
-                x_ = 7 - x_;
-
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 for (int i = 0; i < 2; i++)
                 {
@@ -415,17 +403,11 @@ void GB_Debug_PrintZoomedSprite(char *buf, int sprite)
                 else
                     data += y * 2;
 
-                int x_;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
-
-                x_ = 7 - x_;
-
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 for (int i = 0; i < 8; i++)
                 {
@@ -472,17 +454,11 @@ void GB_Debug_PrintZoomedSprite(char *buf, int sprite)
                 else
                     data += y * 2;
 
-                int x_;
-
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
-
-                x_ = 7 - x_;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 for (int i = 0; i < 8; i++)
                 {
@@ -551,17 +527,11 @@ static void _gb_debug_print_sprite_alpha_at_position(char *buf, int bufw,
                 else
                     data += y * 2;
 
-                int x_;
-
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
-
-                x_ = 7 - x_;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 for (int i = 0; i < 2; i++)
                 {
@@ -618,17 +588,11 @@ static void _gb_debug_print_sprite_alpha_at_position(char *buf, int bufw,
                 else
                     data += y * 2;
 
-                int x_;
-
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                x_ = 7 - x_;
-
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 for (int i = 0; i < 2; i++)
                 {
@@ -716,17 +680,11 @@ void GB_Debug_PrintSpriteAlpha(char *buf, int sprite)
                 else
                     data += y * 2;
 
-                int x_;
-
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                x_ = 7 - x_;
-
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 if (color != 0) // Don't display transparent color
                 {
@@ -773,17 +731,11 @@ void GB_Debug_PrintSpriteAlpha(char *buf, int sprite)
                 else
                     data += y * 2;
 
-                int x_;
-
-                if (GB_Sprite->Info & (1 << 5)) // Flip X
-                    x_ = 7 - x;
-                else
-                    x_ = x;
-
-                x_ = 7 - x_;
+                // Flip X
+                u32 row = GB_TileRowDecode(data,
+                                           (GB_Sprite->Info & (1 << 5)) != 0);
 
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> (x * 2)) & 3;
 
                 if (color != 0) // Don't display transparent color
                 {
@@ -806,59 +758,33 @@ void GB_Debug_PrintSpriteAlpha(char *buf, int sprite)
 
 //------------------------------------------------------------------------------
 
-void GB_Debug_TileVRAMDraw(char *buffer0, int bufw0, unused__ int bufh0,
-                           char *buffer1, int bufw1, unused__ int bufh1)
+void GB_Debug_TileVRAMDrawTile(char *buffer, int bufw, int bank, int tile)
 {
-    _GB_MEMORY_ *mem = &GameBoy.Memory;
-
-    for (int y = 0; y < 192; y++)
-    {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
-
-            u8 *data = &mem->VideoRAM[tile << 4]; // Bank 0
-
-            data += ((y & 7) * 2);
-
-            u32 x_ = 7 - (x & 7);
-
-            u32 color =
-                    ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+    u8 *tile_data = &GameBoy.Memory.VideoRAM[tile << 4]; // Bank 0
+    if (bank)
+        tile_data += 0x2000; // Bank 1
 
-            buffer0[(y * bufw0 + x) * 3 + 0] = gb_pal_colors[color][0];
-            buffer0[(y * bufw0 + x) * 3 + 1] = gb_pal_colors[color][1];
-            buffer0[(y * bufw0 + x) * 3 + 2] = gb_pal_colors[color][2];
-        }
-    }
+    int x0 = (tile % 16) * 8;
+    int y0 = (tile / 16) * 8;
 
-    for (int y = 0; y < 192; y++)
+    for (int y = 0; y < 8; y++)
     {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
-
-            u8 *data = &mem->VideoRAM[tile << 4];
-            data += 0x2000; // Bank 1;
-
-            data += (y & 7) * 2;
+        u32 row = GB_TileRowDecode(tile_data + (y * 2), 0);
 
-            u32 x_ = 7 - (x & 7);
-
-            u32 color =
-                    ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+        for (int x = 0; x < 8; x++)
+        {
+            u32 color = (row >> (x * 2)) & 3;
 
-            buffer1[(y * bufw1 + x) * 3 + 0] = gb_pal_colors[color][0];
-            buffer1[(y * bufw1 + x) * 3 + 1] = gb_pal_colors[color][1];
-            buffer1[(y * bufw1 + x) * 3 + 2] = gb_pal_colors[color][2];
+            int index = ((y0 + y) * bufw + (x0 + x)) * 3;
+            buffer[index + 0] = gb_pal_colors[color][0];
+            buffer[index + 1] = gb_pal_colors[color][1];
+            buffer[index + 2] = gb_pal_colors[color][2];
         }
     }
 }
 
-void GB_Debug_TileVRAMDrawPaletted(char *buffer0, unused__ int bufw0,
-                                   unused__ int bufh0, char *buffer1,
-                                   unused__ int bufw1, unused__ int bufh1,
-                                   int pal, int pal_is_spr)
+void GB_Debug_TileVRAMDrawTilePaletted(char *buffer, int bufw, int bank,
+                                       int tile, int pal, int pal_is_spr)
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
@@ -869,20 +795,20 @@ void GB_Debug_TileVRAMDrawPaletted(char *buffer0, unused__ int bufw0,
     bg_pal[2] = gb_pal_colors[(bgp_reg >> 4) & 0x3][0];
     bg_pal[3] = gb_pal_colors[(bgp_reg >> 6) & 0x3][0];
 
-    for (int y = 0; y < 192; y++)
-    {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
-
-            u8 *data = &mem->VideoRAM[tile << 4]; // Bank 0
+    u8 *tile_data = &mem->VideoRAM[tile << 4]; // Bank 0
+    if (bank)
+        tile_data += 0x2000; // Bank 1
 
-            data += (y & 7) * 2;
+    int x0 = (tile % 16) * 8;
+    int y0 = (tile / 16) * 8;
 
-            u32 x_ = 7 - (x & 7);
+    for (int y = 0; y < 8; y++)
+    {
+        u32 row = GB_TileRowDecode(tile_data + (y * 2), 0);
 
-            u32 color = ((*data >> x_) & 1)
-                        | ((((*(data + 1)) >> x_) << 1) & 2);
+        for (int x = 0; x < 8; x++)
+        {
+            u32 color = (row >> (x * 2)) & 3;
 
             if (GameBoy.Emulator.CGBEnabled)
             {
@@ -907,55 +833,35 @@ void GB_Debug_TileVRAMDrawPaletted(char *buffer0, unused__ int bufw0,
                         | (bg_pal[color] << 16);
             }
 
-            buffer0[(y * bufw0 + x) * 3 + 0] = color & 0xFF;
-            buffer0[(y * bufw0 + x) * 3 + 1] = (color >> 8) & 0xFF;
-            buffer0[(y * bufw0 + x) * 3 + 2] = (color >> 16) & 0xFF;
+            int index = ((y0 + y) * bufw + (x0 + x)) * 3;
+            buffer[index + 0] = color & 0xFF;
+            buffer[index + 1] = (color >> 8) & 0xFF;
+            buffer[index + 2] = (color >> 16) & 0xFF;
         }
     }
+}
 
-    for (int y = 0; y < 192; y++)
+void GB_Debug_TileVRAMDraw(char *buffer0, int bufw0, unused__ int bufh0,
+                           char *buffer1, int bufw1, unused__ int bufh1)
+{
+    for (int tile = 0; tile < 384; tile++)
     {
-        for (int x = 0; x < 128; x++)
-        {
-            u32 tile = (x >> 3) + ((y >> 3) * 16);
-
-            u8 *data = &mem->VideoRAM[tile << 4];
-            data += 0x2000; // Bank 1
-
-            data += (y & 7) * 2;
-
-            u32 x_ = 7 - (x & 7);
-
-            u32 color = ((*data >> x_) & 1)
-                        | ((((*(data + 1)) >> x_) << 1) & 2);
-
-            if (GameBoy.Emulator.CGBEnabled)
-            {
-                u32 pal_index = (pal * 8) + (2 * color);
-
-                if (pal_is_spr)
-                {
-                    color = GameBoy.Emulator.spr_pal[pal_index]
-                            | (GameBoy.Emulator.spr_pal[pal_index + 1] << 8);
-                }
-                else
-                {
-                    color = GameBoy.Emulator.bg_pal[pal_index]
-                            | (GameBoy.Emulator.bg_pal[pal_index + 1] << 8);
-                }
-                color = rgb16to32(color);
-            }
-            else
-            {
-                color = bg_pal[color]
-                        | (bg_pal[color] << 8)
-                        | (bg_pal[color] << 16);
-            }
+        GB_Debug_TileVRAMDrawTile(buffer0, bufw0, 0, tile);
+        GB_Debug_TileVRAMDrawTile(buffer1, bufw1, 1, tile);
+    }
+}
 
-            buffer1[(y * bufw0 + x) * 3 + 0] = color & 0xFF;
-            buffer1[(y * bufw0 + x) * 3 + 1] = (color >> 8) & 0xFF;
-            buffer1[(y * bufw0 + x) * 3 + 2] = (color >> 16) & 0xFF;
-        }
+void GB_Debug_TileVRAMDrawPaletted(char *buffer0, int bufw0,
+                                   unused__ int bufh0, char *buffer1,
+                                   int bufw1, unused__ int bufh1,
+                                   int pal, int pal_is_spr)
+{
+    for (int tile = 0; tile < 384; tile++)
+    {
+        GB_Debug_TileVRAMDrawTilePaletted(buffer0, bufw0, 0, tile,
+                                          pal, pal_is_spr);
+        GB_Debug_TileVRAMDrawTilePaletted(buffer1, bufw1, 1, tile,
+                                          pal, pal_is_spr);
     }
 }
 
@@ -972,9 +878,7 @@ void GB_Debug_TileDrawZoomed64x64(char *buffer, int tile, int bank)
         for (int x = 0; x < 8; x++)
         {
             u8 *data = tile_data + ((y & 7) * 2);
-            u32 x_ = 7 - (x & 7);
-            u32 color =
-                    ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+            u32 color = (GB_TileRowDecode(data, 0) >> ((x & 7) * 2)) & 3;
 
             tiletempbuffer[x + y * 8] = (gb_pal_colors[color][0] << 16)
                                         | (gb_pal_colors[color][1] << 8)
@@ -1020,9 +924,7 @@ void GB_Debug_TileDrawZoomedPaletted64x64(char *buffer, int tile, int bank,
         for (int x = 0; x < 8; x++)
         {
             u8 *data = tile_data + ((y & 7) * 2);
-            u32 x_ = 7 - (x & 7);
-            u32 color =
-                    ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+            u32 color = (GB_TileRowDecode(data, 0) >> ((x & 7) * 2)) & 3;
 
             if (GameBoy.Emulator.CGBEnabled)
             {
@@ -1101,16 +1003,10 @@ void GB_Debug_MapPrint(char *buffer, int bufw, unused__ int bufh, int map,
                 else
                     data += ((y & 7) * 2);
 
-                u32 x_;
-
                 // H flip
-                if (tileinfo & (1 << 5))
-                    x_ = (x & 7);
-                else
-                    x_ = 7 - (x & 7);
+                u32 row = GB_TileRowDecode(data, (tileinfo & (1 << 5)) != 0);
 
-                u32 color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> ((x & 7) * 2)) & 3;
                 u32 pal_index = ((tileinfo & 7) * 8) + (2 * color);
 
                 color = GameBoy.Emulator.bg_pal[pal_index]
@@ -1147,10 +1043,7 @@ void GB_Debug_MapPrint(char *buffer, int bufw, unused__ int bufh, int map,
 
                 u8 *data = (&tiledata[tile << 4]) + ((y & 7) << 1);
 
-                u32 x_ = 7 - (x & 7);
-
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (GB_TileRowDecode(data, 0) >> ((x & 7) * 2)) & 3;
 
                 buffer[(y * bufw + x) * 3 + 0] = bg_pal[color];
                 buffer[(y * bufw + x) * 3 + 1] = bg_pal[color];
@@ -1195,16 +1088,10 @@ void GB_Debug_MapPrintBW(char *buffer, int bufw, unused__ int bufh, int map,
                 else
                     data += ((y & 7) * 2);
 
-                u32 x_;
-
                 // H flip
-                if (tileinfo & (1 << 5))
-                    x_ = x & 7;
-                else
-                    x_ = 7 - (x & 7);
+                u32 row = GB_TileRowDecode(data, (tileinfo & (1 << 5)) != 0);
 
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (row >> ((x & 7) * 2)) & 3;
 
                 buffer[(y * bufw + x) * 3 + 0] = gb_pal_colors[color][0];
                 buffer[(y * bufw + x) * 3 + 1] = gb_pal_colors[color][1];
@@ -1230,10 +1117,7 @@ void GB_Debug_MapPrintBW(char *buffer, int bufw, unused__ int bufh, int map,
 
                 u8 *data = (&tiledata[tile << 4]) + ((y & 7) << 1);
 
-                u32 x_ = 7 - (x & 7);
-
-                u32 color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
+                u32 color = (GB_TileRowDecode(data, 0) >> ((x & 7) * 2)) & 3;
 
                 buffer[(y * bufw + x) * 3 + 0] = gb_pal_colors[color][0];
                 buffer[(y * bufw + x) * 3 + 1] = gb_pal_colors[color][1];
@@ -1262,12 +1146,9 @@ void GB_Debug_GBCameraMiniPhotoPrint(char *buffer, int bufw, unused__ int bufh,
 
             int baselineaddr = basetileaddr + ((y & 7) << 1);
 
-            u8 data = mem->ExternRAM[bank][baselineaddr];
-            u8 data2 = mem->ExternRAM[bank][baselineaddr + 1];
-
-            u32 x_ = 7 - (x & 7);
+            u8 *data = &mem->ExternRAM[bank][baselineaddr];
 
-            u32 color = ((data >> x_) & 1) | (((data2 >> x_) << 1) & 2);
+            u32 color = (GB_TileRowDecode(data, 0) >> ((x & 7) * 2)) & 3;
 
             int bufindex = ((y + posy) * bufw + (x + posx)) * 3;
             buffer[bufindex + 0] = gb_pal_colors[color][0];
@@ -1297,12 +1178,9 @@ void GB_Debug_GBCameraPhotoPrint(char *buffer, int bufw, unused__ int bufh,
 
             int baselineaddr = basetileaddr + ((y & 7) << 1);
 
-            u8 data = mem->ExternRAM[bank][baselineaddr];
-            u8 data2 = mem->ExternRAM[bank][baselineaddr + 1];
-
-            u32 x_ = 7 - (x & 7);
+            u8 *data = &mem->ExternRAM[bank][baselineaddr];
 
-            u32 color = ((data >> x_) & 1) | (((data2 >> x_) << 1) & 2);
+            u32 color = (GB_TileRowDecode(data, 0) >> ((x & 7) * 2)) & 3;
 
             int bufindex = (y * bufw + x) * 3;
             buffer[bufindex + 0] = gb_pal_colors[color][0];
@@ -28,6 +28,11 @@ void GB_Debug_TileVRAMDraw(char *buffer0, int bufw0, int bufh0,
 void GB_Debug_TileVRAMDrawPaletted(char *buffer0, int bufw0, int bufh0,
                                    char *buffer1, int bufw1, int bufh1,
                                    int pal, int pal_is_spr);
+// They draw only one of the tiles drawn by the functions above, at the same
+// position of the buffer.
+void GB_Debug_TileVRAMDrawTile(char *buffer, int bufw, int bank, int tile);
+void GB_Debug_TileVRAMDrawTilePaletted(char *buffer, int bufw, int bank,
+                                       int tile, int pal, int pal_is_spr);
 void GB_Debug_TileDrawZoomed64x64(char *buffer, int tile, int bank);
 void GB_Debug_TileDrawZoomedPaletted64x64(char *buffer, int tile, int bank,
                                           int palette, int is_sprite_palette);
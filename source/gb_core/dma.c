@@ -4,6 +4,8 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include "../profile_utils.h"
+
 #include "gameboy.h"
 
 #include "cpu.h"
@@ -11,7 +13,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
@@ -23,6 +25,7 @@ void GB_DMAInit(void)
     GameBoy.Emulator.OAM_DMA_src = 0;
     GameBoy.Emulator.OAM_DMA_dst = 0;
     GameBoy.Emulator.OAM_DMA_last_read_byte = 0;
+    GB_MemReadPagesUpdate();
 
     // HDMA/GDMA
     GameBoy.Emulator.GBC_DMA_enabled = GBC_DMA_NONE;
@@ -54,6 +57,7 @@ static void GB_DMAInitOAMCopy(int src_addr_high_byte)
     GameBoy.Emulator.OAM_DMA_dst = 0xFE00;
     GameBoy.Emulator.OAM_DMA_last_read_byte = 0x00;
     // Change read and write functions
+    GB_MemReadPagesUpdate();
 }
 
 static void GB_DMAInitGBCCopy(int register_value)
@@ -131,7 +135,7 @@ static void GB_DMAStopGBCCopy(void)
 
 //----------------------------------------------------------------
 
-static int gb_dma_clock_counter = 0;
+static core_local__ int gb_dma_clock_counter = 0;
 
 void GB_DMAClockCounterReset(void)
 {
@@ -152,6 +156,8 @@ void GB_DMAUpdateClocksCounterReference(int reference_clocks)
 {
     if (GameBoy.Emulator.OAM_DMA_enabled)
     {
+        _profile_section_e prev = Profile_Begin(PROFILE_DMA);
+
         // This needs 160 * 4 + 4 clocks to end
 
         int increment_clocks = reference_clocks - GB_DMAClockCounterGet();
@@ -161,6 +167,23 @@ void GB_DMAUpdateClocksCounterReference(int reference_clocks)
         int last_destination_to_copy =
                 0xFE00 + (GameBoy.Emulator.OAM_DMA_clocks_elapsed / 4) - 2;
 
+        int last = (last_destination_to_copy < 0xFEA0) ?
+                   last_destination_to_copy : 0xFE9F;
+
+        if (GameBoy.Emulator.OAM_DMA_dst <= last)
+        {
+            u32 size = last - GameBoy.Emulator.OAM_DMA_dst + 1;
+
+            if (GB_MemCopyDMA(GameBoy.Emulator.OAM_DMA_dst,
+                              GameBoy.Emulator.OAM_DMA_src, size))
+            {
+                GameBoy.Emulator.OAM_DMA_src += size;
+                GameBoy.Emulator.OAM_DMA_dst += size;
+                GameBoy.Emulator.OAM_DMA_last_read_byte =
+                        GameBoy.Memory.ObjAttrMem[last - 0xFE00];
+            }
+        }
+
         while (GameBoy.Emulator.OAM_DMA_dst <= last_destination_to_copy)
         {
             if (GameBoy.Emulator.OAM_DMA_dst >= 0xFEA0)
@@ -175,7 +198,10 @@ void GB_DMAUpdateClocksCounterReference(int reference_clocks)
         if (last_destination_to_copy >= 0xFEA0)
         {
             GameBoy.Emulator.OAM_DMA_enabled = 0;
+            GB_MemReadPagesUpdate();
         }
+
+        Profile_End(prev);
     }
 
     GB_DMAClockCounterSet(reference_clocks);
@@ -218,7 +244,7 @@ void GB_DMAWriteDMA(int reference_clocks, int value)
     // instead of other ram)... etc...
     GameBoy.Memory.IO_Ports[DMA_REG - 0xFF00] = value;
     GB_DMAInitOAMCopy(value);
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_DMA);
 }
 
 void GB_DMAWriteHDMA1(int value) // reference_clocks not needed
@@ -259,7 +285,7 @@ void GB_DMAWriteHDMA5(int value)
 {
     //Start/Stop GBC DMA copy
 
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_DMA);
 
     GameBoy.Memory.IO_Ports[HDMA5_REG - 0xFF00] = value;
 
@@ -334,6 +360,46 @@ int GB_DMAExecute(int clocks)
 
                 u32 bytes = GameBoy.Emulator.gdma_bytes_left;
 
+                // One byte is copied every time the clocks left are a multiple
+                // of the clocks per byte. If they are all in plain memory, copy
+                // the ones of this slice at once.
+                int clocks_per_byte = clocks_per_byte_mask + 1;
+                int first_byte_clocks =
+                        GameBoy.Emulator.gdma_copy_clocks_left
+                        & clocks_per_byte_mask;
+                if (first_byte_clocks == 0)
+                    first_byte_clocks = clocks_per_byte;
+
+                if (execute_now_clocks >= first_byte_clocks)
+                {
+                    u32 count = 1 + ((execute_now_clocks - first_byte_clocks)
+                                     / clocks_per_byte);
+                    if (count >= bytes)
+                    {
+                        // Stop right after the last byte
+                        count = bytes;
+                        execute_now_clocks = first_byte_clocks
+                                             + ((count - 1) * clocks_per_byte);
+                    }
+
+                    if (GB_MemCopyHDMA(GameBoy.Emulator.gdma_dst,
+                                       GameBoy.Emulator.gdma_src, count))
+                    {
+                        GameBoy.Emulator.gdma_copy_clocks_left -=
+                                execute_now_clocks;
+                        GB_CPUClockCounterAdd(execute_now_clocks);
+
+                        GameBoy.Emulator.gdma_src += count;
+                        GameBoy.Emulator.gdma_dst += count;
+
+                        bytes -= count;
+                        if (bytes == 0)
+                            GameBoy.Emulator.GBC_DMA_enabled = GBC_DMA_NONE;
+
+                        execute_now_clocks = 0;
+                    }
+                }
+
                 while (execute_now_clocks--)
                 {
                     GameBoy.Emulator.gdma_copy_clocks_left--;
@@ -416,13 +482,27 @@ int GB_DMAExecute(int clocks)
 
                         GB_CPUClockCounterAdd(4); // Init copy
 
-                        for (int i = 0; i < 16; i++)
+                        // The copy needs the same time in single and double
+                        // speeds mode.
+                        int byte_clocks = 2 << GameBoy.Emulator.DoubleSpeed;
+
+                        if (GB_MemCopyHDMA(GameBoy.Emulator.gdma_dst,
+                                           GameBoy.Emulator.gdma_src, 16))
+                        {
+                            GB_CPUClockCounterAdd(16 * byte_clocks);
+                            GameBoy.Emulator.gdma_src += 16;
+                            GameBoy.Emulator.gdma_dst += 16;
+                        }
+                        else
                         {
-                            // The copy needs the same time in single and double
-                            // speeds mode.
-                            GB_CPUClockCounterAdd(2 << GameBoy.Emulator.DoubleSpeed);
-                            u8 v = GB_MemReadHDMA8(GameBoy.Emulator.gdma_src++);
-                            GB_MemWriteHDMA8(GameBoy.Emulator.gdma_dst++, v);
+                            for (int i = 0; i < 16; i++)
+                            {
+                                GB_CPUClockCounterAdd(byte_clocks);
+                                u8 v = GB_MemReadHDMA8(
+                                        GameBoy.Emulator.gdma_src++);
+                                GB_MemWriteHDMA8(GameBoy.Emulator.gdma_dst++,
+                                                 v);
+                            }
                         }
 
                         mem->IO_Ports[HDMA1_REG - 0xFF00] =
@@ -97,6 +97,13 @@
 # define PACKED __attribute__ ((packed))
 #endif
 
+#ifndef ALIGNED
+# define ALIGNED(n) __attribute__ ((aligned(n)))
+#endif
+
+// Size of a cache line of the host
+#define GB_CACHE_LINE_SIZE  (64)
+
 #define KEY_A       BIT(0)
 #define KEY_B       BIT(1)
 #define KEY_SELECT  BIT(2)
@@ -108,8 +115,11 @@
 
 #define KEY_SPEEDUP BIT(10)
 
+// All the members are naturally aligned, so there is no need to pack them. The
+// 32-bit pairs leave space for carries, and the 8-bit registers are the low
+// bytes of each pair (only little endian hosts are supported).
 typedef union {
-    struct PACKED
+    struct
     {
         u8 F, A; // F can't be accesed by CPU in a normal way
         u8 dummy1[2];
@@ -124,7 +134,7 @@ typedef union {
         u8 PCL, PCH;
         u8 dummy6[2];
     } R8;
-    struct PACKED
+    struct
     {
         u32 AF;
         u32 BC;
@@ -133,7 +143,7 @@ typedef union {
         u32 SP; // Stack Pointer
         u32 PC; // Program Counter
     } R16;
-    struct PACKED
+    struct
     {
         u8   zero : 4;
         bool C    : 1; // carry
@@ -170,7 +180,6 @@ typedef u32 (*gb_mem_read_fn_ptr)(u32);
 
 typedef struct
 {
-    u8 *ROM_Base;                 // 0000 | 16KB
     u8 *ROM_Switch[512];          // 4000 | 16KB
     u8 VideoRAM[0x4000];          // 8000 | 8KB -- 2 banks in GBC - Only 0x2000
                                   //               needed in GB mode, but
@@ -186,14 +195,13 @@ typedef struct
     u8 IO_Ports[0x80];            // FF00 | 128B
     u8 HighRAM[0x80];             // FF80 | 128B
 
-    gb_mem_write_fn_ptr MemWrite, MemWriteReg; // 8 bit
-    gb_mem_read_fn_ptr MemRead, MemReadReg;    // 8 bit
-
-    u32 selected_rom, selected_ram;
-    u32 selected_wram, selected_vram; //gbc only
+    // The fields below are used in most memory accesses. They are placed after
+    // the buffers so that they are next to the CPU registers in _GB_CONTEXT_.
 
-    u32 mbc_mode;
+    gb_mem_write_fn_ptr MemWrite ALIGNED(GB_CACHE_LINE_SIZE); // 8 bit
+    gb_mem_read_fn_ptr MemRead;                                // 8 bit
 
+    u8 *ROM_Base;      // 0000 | 16KB
     u8 *VideoRAM_Curr; //
     u8 *ROM_Curr;      // Pointers to current banks
     u8 *RAM_Curr;      //
@@ -205,6 +213,11 @@ typedef struct
 
     mapper_write_fn MapperWrite;
     mapper_read_fn MapperRead;
+
+    u32 selected_rom, selected_ram;
+    u32 selected_wram, selected_vram; //gbc only
+
+    u32 mbc_mode;
 } _GB_MEMORY_;
 
 //------------------------------------------------------------------------------
@@ -302,36 +315,37 @@ typedef struct
 
 typedef struct
 {
-    u32 selected_hardware; // HW_*** defines, -1 = auto
-
-    u32 HardwareType; // HW_*** defines
-    char Title[17];
-    u32 ROM_Banks, RAM_Banks;
-    u32 MemoryController; // MBCn, etc...
-    u32 HasBattery;
-    u32 HasTimer;
-    u32 EnableBank0Switch;
-    _GB_MB3_TIMER_ Timer;
-    _GB_MB3_TIMER_ LatchedTime;
-    _GB_MB7_CART_ MBC7;
-    _GB_MMM01_CART_ MMM01;
-    _GB_CAMERA_CART_ CAM;
-    u32 rumble; // Rumble enabled
-    u32 *Rom_Pointer;
-    char save_filename[MAX_PATHLEN];
-    u32 game_supports_gbc;
+    // Fields used while emulating each instruction. The information of the
+    // cartridge and other rarely used fields go after them.
 
-    u8 *boot_rom;
-    u32 boot_rom_loaded;
-    u32 enable_boot_rom;
+    // Other things
+    u32 CPUHalt;
+    u32 halt_bug;
+    u32 cpu_change_speed_clocks; // clocks needed to change speed
+    u32 DoubleSpeed;
 
-    u32 gbc_in_gb_mode;
+    u32 HardwareType; // HW_*** defines
     u32 CGBEnabled; // This can be 0 even if the hardware is GBC, GBA or GBA_SP
                     // (GBC running in DMG mode)
+    u32 SGBEnabled;
+    u32 wait_cycles;
 
-    // CGB only
-    u32 spr_pal[64];
-    u32 bg_pal[64];
+    // DIV, Timer, Sound
+    u32 sys_clocks; // 16 bit register. The 8 most significant bits are DIV_REG
+    u32 timer_overflow_mask;
+    u32 timer_enabled;             // Enable TIMA to increment
+    u32 timer_irq_delay_active;    // To trigger IF flag
+    u32 timer_reload_delay_active; // To reload TIMA from TMA
+    u32 tima_just_reloaded;
+
+    // LCD
+    s32 ly_clocks;  // Clocks left for ly change
+    s32 ly_drawn;   // 1 if this line has been drawn
+    u32 ScreenMode; // For vblank, hblank...
+    u32 CurrentScanLine;
+    u32 stat_signal; // When this goes from 0 to 1, STAT interrupt is triggered.
+    gb_ppu_update_fn_ptr PPUUpdate; // argument = increment clocks
+    gb_ppu_clocks_to_event_fn_ptr PPUClocksToNextEvent;
 
     u32 lcd_on;
     draw_scanline_fn_ptr DrawScanlineFn;
@@ -354,32 +368,6 @@ typedef struct
 
     u32 hdma_last_ly_copied; // To limit to 0x10 bytes per HBlank
 
-    // Other things
-    u32 CPUHalt;
-    u32 halt_bug;
-    u32 cpu_change_speed_clocks; // clocks needed to change speed
-    u32 DoubleSpeed;
-
-    u32 SGBEnabled;
-    u32 wait_cycles;
-
-    // LCD
-    s32 ly_clocks;  // Clocks left for ly change
-    s32 ly_drawn;   // 1 if this line has been drawn
-    u32 ScreenMode; // For vblank, hblank...
-    u32 CurrentScanLine;
-    u32 stat_signal; // When this goes from 0 to 1, STAT interrupt is triggered.
-    gb_ppu_update_fn_ptr PPUUpdate; // argument = increment clocks
-    gb_ppu_clocks_to_event_fn_ptr PPUClocksToNextEvent;
-
-    // DIV, Timer, Sound
-    u32 sys_clocks; // 16 bit register. The 8 most significant bits are DIV_REG
-    u32 timer_overflow_mask;
-    u32 timer_enabled;             // Enable TIMA to increment
-    u32 timer_irq_delay_active;    // To trigger IF flag
-    u32 timer_reload_delay_active; // To reload TIMA from TMA
-    u32 tima_just_reloaded;
-
     // Serial
     u32 serial_enabled;
     u32 serial_clocks_to_flip_clock_signal;
@@ -396,6 +384,42 @@ typedef struct
 
     u32 FrameDrawn;
 
+    // Cartridge
+
+    u32 selected_hardware; // HW_*** defines, -1 = auto
+
+    char Title[17];
+    u32 ROM_Banks, RAM_Banks;
+    u32 MemoryController; // MBCn, etc...
+    u32 HasBattery;
+    u32 HasTimer;
+    u32 EnableBank0Switch;
+    _GB_MB3_TIMER_ Timer;
+    _GB_MB3_TIMER_ LatchedTime;
+    u64 rtc_clocks; // Double speed clocks not added to Timer yet
+    _GB_MB7_CART_ MBC7;
+    _GB_MMM01_CART_ MMM01;
+    _GB_CAMERA_CART_ CAM;
+    u32 rumble; // Rumble enabled
+    u32 *Rom_Pointer;
+    u32 game_supports_gbc;
+
+    u8 *boot_rom;
+    u32 boot_rom_loaded;
+    u32 enable_boot_rom;
+
+    u32 gbc_in_gb_mode;
+
+    // CGB only
+    u32 spr_pal[64];
+    u32 bg_pal[64];
+    // Colors of the palettes above in the format of the framebuffer. They are
+    // updated whenever the palette RAM is written.
+    u32 spr_pal_color[32];
+    u32 bg_pal_color[32];
+
+    char save_filename[MAX_PATHLEN];
+
 } _EMULATOR_INFO_;
 
 //------------------------------------------------------------------------------
@@ -404,10 +428,14 @@ typedef struct
 //--                                                                          --
 //------------------------------------------------------------------------------
 
+// The memory goes first so that the fields at the end of _GB_MEMORY_ and the
+// ones at the start of _EMULATOR_INFO_ are next to the CPU registers. That way
+// the interpreter only touches a few cache lines of the context, and the big
+// buffers are only loaded when they are accessed.
 typedef struct
 {
-    _GB_CPU_ CPU;
     _GB_MEMORY_ Memory;
+    _GB_CPU_ CPU;
     _EMULATOR_INFO_ Emulator;
 } _GB_CONTEXT_;
 
@@ -9,10 +9,14 @@
 #include <string.h>
 
 #include "../build_options.h"
+#include "../config.h"
 #include "../debug_utils.h"
 #include "../file_utils.h"
 #include "../general_utils.h"
+#include "../opprofile_utils.h"
+#include "../savestate_utils.h"
 
+#include "cheats.h"
 #include "cpu.h"
 #include "gameboy.h"
 #include "gb_main.h"
@@ -23,11 +27,26 @@
 #include "sound.h"
 #include "video.h"
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 int GB_Input_Get(int player);
 void GB_Input_Update(void);
 
+// Used to recover the previous state if a save state can't be loaded
+static core_local__ _savestate_t gb_state_backup;
+
+// State of the console at the end of the first frame after the boot ROM has
+// been unmapped. Resets jump straight to it instead of running the boot ROM
+// again, which takes a few seconds of emulated time. It only lives as long as
+// the ROM is loaded. Keeping it in a file wouldn't be worth it: the state
+// format changes between builds, and the first boot isn't any slower.
+static core_local__ _savestate_t gb_boot_state;
+static core_local__ int gb_boot_state_pending; // Waiting for the boot to end
+
+// Battery backed data, kept while the boot state is loaded
+static core_local__ u8 gb_boot_extern_ram[16][0x2000];
+static core_local__ _GB_MB3_TIMER_ gb_boot_timer[2];
+
 //---------------------------------
 
 int GB_ROMLoad(const char *rom_path)
@@ -43,6 +62,11 @@ int GB_ROMLoad(const char *rom_path)
         return 0;
     }
 
+    return GB_ROMLoadBuffer(rom_path, ptr, size);
+}
+
+int GB_ROMLoadBuffer(const char *rom_path, void *ptr, u32 size)
+{
     if (GB_CartridgeLoad(ptr, size) == 0)
     {
         Debug_ErrorMsgArg("Error while loading cartridge.\n"
@@ -61,6 +85,8 @@ int GB_ROMLoad(const char *rom_path)
     GB_PowerOn();
     GB_SkipFrame(0);
 
+    GB_BootStateReset();
+
     return 1;
 }
 
@@ -70,7 +96,59 @@ void GB_End(int save)
         GB_SRAM_Save();
 
     GB_PowerOff();
+    GB_CheatsReset();
     GB_Cartridge_Unload();
+
+    SaveState_Free(&gb_state_backup);
+
+    SaveState_Free(&gb_boot_state);
+    gb_boot_state_pending = 0;
+}
+
+//---------------------------------------------------------------------------
+
+void GB_BootStateReset(void)
+{
+    gb_boot_state_pending = 0;
+
+    if ((EmulatorConfig.boot_state_cache == 0)
+        || (GameBoy.Emulator.enable_boot_rom == 0))
+        return;
+
+    if (gb_boot_state.data == NULL)
+    {
+        gb_boot_state_pending = 1;
+        return;
+    }
+
+    // The cartridge RAM and the RTC have to survive the reset, the boot state
+    // has the values they had when the ROM was loaded.
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    _EMULATOR_INFO_ *emu = &GameBoy.Emulator;
+
+    memcpy(gb_boot_extern_ram, mem->ExternRAM, sizeof(gb_boot_extern_ram));
+    gb_boot_timer[0] = emu->Timer;
+    gb_boot_timer[1] = emu->LatchedTime;
+
+    // If it can't be loaded the console is left as it is after the reset, and
+    // it runs the boot ROM like it would without the boot state.
+    if (GB_StateLoad(&gb_boot_state) != 0)
+        return;
+
+    memcpy(mem->ExternRAM, gb_boot_extern_ram, sizeof(gb_boot_extern_ram));
+    emu->Timer = gb_boot_timer[0];
+    emu->LatchedTime = gb_boot_timer[1];
+}
+
+static void GB_BootStateCheck(void)
+{
+    if (GameBoy.Emulator.enable_boot_rom)
+        return;
+
+    gb_boot_state_pending = 0;
+
+    if (GB_StateSave(&gb_boot_state) != 0)
+        SaveState_Free(&gb_boot_state);
 }
 
 //---------------------------------------------------------------------------
@@ -84,13 +162,121 @@ int GB_IsEnabledSGB(void)
 
 void GB_RunForOneFrame(void)
 {
+    GB_CheatsApply();
     GB_CheckJoypadInterrupt();
     GB_RunFor(70224 << GameBoy.Emulator.DoubleSpeed);
+    GB_SoundFrameEnd();
+
+    if (gb_boot_state_pending)
+        GB_BootStateCheck();
+
+#ifdef ENABLE_OPCODE_PROFILE
+    OPProfile_FrameEnd();
+#endif
+}
+
+//---------------------------------------------------------------------------
+
+static u32 GB_StateRomID(void)
+{
+    // The header of the ROM has the title, licensee and checksums
+    return SaveState_Hash((u8 *)GameBoy.Emulator.Rom_Pointer + 0x100, 0x50);
+}
+
+static void GB_StateWrite(_savestate_t *st)
+{
+    SaveState_Begin(st, SAVESTATE_SYSTEM_GB, GB_StateRomID());
+
+    GB_ContextStateSave(st);
+    GB_CPUStateSave(st);
+    GB_SoundStateSave(st);
+    GB_VideoStateSave(st);
+    if (GameBoy.Emulator.SGBEnabled)
+        SGB_StateSave(st);
+}
+
+static void GB_StateRead(_savestate_t *st)
+{
+    GB_ContextStateLoad(st);
+    GB_InterruptsPendingUpdate();
+    if (st->error) // The rest of the state can't be used without the context
+        return;
+
+    GB_CPUStateLoad(st);
+    GB_SoundStateLoad(st);
+    GB_VideoStateLoad(st);
+    if (GameBoy.Emulator.SGBEnabled)
+        SGB_StateLoad(st);
+}
+
+int GB_StateSave(_savestate_t *st)
+{
+    GB_StateWrite(st);
+
+    return st->error;
+}
+
+int GB_StateLoad(_savestate_t *st)
+{
+    if (SaveState_Open(st, SAVESTATE_SYSTEM_GB, GB_StateRomID()) != 0)
+        return 1;
+
+    // If the state is valid but any chunk is wrong, the state of the emulator
+    // would be left half loaded. Keep a copy to restore it in that case.
+    GB_StateWrite(&gb_state_backup);
+    if (gb_state_backup.error)
+        return 1;
+
+    GB_StateRead(st);
+
+    if (st->error)
+    {
+        SaveState_Open(&gb_state_backup, SAVESTATE_SYSTEM_GB, GB_StateRomID());
+        GB_StateRead(&gb_state_backup);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void GB_StateGetFilename(char *path, size_t size)
+{
+    snprintf(path, size, "%s.st", GameBoy.Emulator.save_filename);
+}
+
+void GB_QuickStateSave(void)
+{
+    char path[MAX_PATHLEN];
+    GB_StateGetFilename(path, sizeof(path));
+
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    if ((GB_StateSave(&st) != 0) || (SaveState_FileSave(&st, path) != 0))
+        Debug_ErrorMsgArg("Couldn't save state to %s", path);
+
+    SaveState_Free(&st);
+}
+
+void GB_QuickStateLoad(void)
+{
+    char path[MAX_PATHLEN];
+    GB_StateGetFilename(path, sizeof(path));
+
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    if (SaveState_FileLoad(&st, path) != 0)
+        Debug_ErrorMsgArg("Couldn't open %s", path);
+    else if (GB_StateLoad(&st) != 0)
+        Debug_ErrorMsgArg("%s isn't a valid state for this game", path);
+
+    SaveState_Free(&st);
 }
 
 //---------------------------------------------------------------------------
 
-static int Keys[4];
+static core_local__ int Keys[4];
 
 void GB_InputSet(int player, int a, int b, int st, int se,
                  int r, int l, int u, int d)
@@ -170,3 +356,20 @@ int GB_Input_Get(int player)
 {
     return Keys[player];
 }
+
+static core_local__ gb_input_latch_fn_ptr gb_input_latch_fn;
+
+void GB_InputLatchSet(gb_input_latch_fn_ptr fn)
+{
+    gb_input_latch_fn = fn;
+}
+
+void GB_InputLatch(void)
+{
+    gb_input_latch_fn_ptr fn = gb_input_latch_fn;
+    if (fn == NULL)
+        return;
+
+    gb_input_latch_fn = NULL;
+    fn();
+}
@@ -7,15 +7,41 @@
 #ifndef GB_GB_MAIN__
 #define GB_GB_MAIN__
 
+#include "../savestate_utils.h"
+
 void GB_Input_Update(void);
 
 int GB_ROMLoad(const char *rom_path);
+// Same as GB_ROMLoad() with a ROM that has already been loaded. The buffer must
+// have been allocated with malloc(), and it is owned by the emulator from now
+// on. rom_path is only used to name the save files.
+int GB_ROMLoadBuffer(const char *rom_path, void *ptr, u32 size);
 void GB_End(int save);
 
+// Called after the console is powered on. If the boot state cache is enabled,
+// the console is moved to the state it had right after the first boot of the
+// ROM that is loaded, or the state is saved at the end of this boot.
+void GB_BootStateReset(void);
+
+// When a ROM with RTC is loaded, its clock is advanced by the time that has
+// passed since the save file was written, according to the clock of the host.
+// If a fixed time (in seconds since the epoch) is set, it's used instead so
+// that the result doesn't depend on when the ROM is loaded. 0 restores the
+// clock of the host.
+void GB_RTC_SetFixedTime(u64 timestamp);
+
 int GB_Screen_Init(void);
 
 void GB_RunForOneFrame(void);
 
+// They return 0 on success. If a state can't be loaded the emulation isn't
+// modified.
+int GB_StateSave(_savestate_t *st);
+int GB_StateLoad(_savestate_t *st);
+// Save and load the state of the current game to a file next to the ROM
+void GB_QuickStateSave(void);
+void GB_QuickStateLoad(void);
+
 int GB_IsEnabledSGB(void);
 
 void GB_InputSet(int player, int a, int b, int st, int se,
@@ -25,4 +51,12 @@ void GB_InputSetMBC7Buttons(int up, int down, int right, int left);
 
 int GB_Input_Get(int player);
 
+// Late latch of the input. If a function is set, it is called the first time
+// that the game reads P1 after setting it, and then it's cleared. It's meant
+// to call GB_InputSet() with the state of the keys at that moment, instead of
+// the one at the start of the frame.
+typedef void (*gb_input_latch_fn_ptr)(void);
+void GB_InputLatchSet(gb_input_latch_fn_ptr fn);
+void GB_InputLatch(void); // Called by the memory handlers
+
 #endif // GB_GB_MAIN__
@@ -10,6 +10,7 @@
 #include "../config.h"
 #include "../debug_utils.h"
 #include "../general_utils.h"
+#include "../savestate_utils.h"
 
 #include "camera.h"
 #include "cpu.h"
@@ -25,7 +26,7 @@
 #include "sound.h"
 #include "video.h"
 
-_GB_CONTEXT_ GameBoy;
+core_local__ _GB_CONTEXT_ GameBoy;
 
 void GB_PowerOn(void)
 {
@@ -83,6 +84,8 @@ void GB_HardReset(void)
     }
 
     GB_PowerOn();
+
+    GB_BootStateReset();
 }
 
 int GB_EmulatorIsEnabledSGB(void)
@@ -94,3 +97,143 @@ int GB_RumbleEnabled(void)
 {
     return GameBoy.Emulator.rumble;
 }
+
+//------------------------------------------------------------------------------
+
+// The pointers to the current banks are saved as offsets so that they are valid
+// in any session. ROM banks are relative to the ROM, the rest are relative to
+// the memory of the context.
+
+typedef struct
+{
+    s32 rom_base;
+    s32 rom_curr;
+    s32 vram_curr;
+    s32 ram_curr;
+    s32 wram_curr;
+} _gb_context_pointers_t;
+
+static s32 gb_pointer_to_offset(const u8 *ptr, const u8 *base)
+{
+    if (ptr == NULL)
+        return -1;
+
+    return ptr - base;
+}
+
+static u8 *gb_offset_to_pointer(_savestate_t *st, s32 offset, u8 *base,
+                                size_t size)
+{
+    if (offset < 0)
+        return NULL;
+
+    if ((size_t)offset >= size)
+    {
+        st->error = 1;
+        return NULL;
+    }
+
+    return base + offset;
+}
+
+void GB_ContextStateSave(_savestate_t *st)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    const u8 *rom = (const u8 *)GameBoy.Emulator.Rom_Pointer;
+    const u8 *ctx = (const u8 *)mem;
+
+    _gb_context_pointers_t ptrs = {
+        gb_pointer_to_offset(mem->ROM_Base, rom),
+        gb_pointer_to_offset(mem->ROM_Curr, rom),
+        gb_pointer_to_offset(mem->VideoRAM_Curr, ctx),
+        gb_pointer_to_offset(mem->RAM_Curr, ctx),
+        gb_pointer_to_offset(mem->WorkRAM_Curr, ctx),
+    };
+
+    SaveState_ChunkBegin(st, "GB  ");
+    SaveState_Write(st, &GameBoy, sizeof(GameBoy));
+    SaveState_Write(st, &ptrs, sizeof(ptrs));
+    SaveState_ChunkEnd(st);
+}
+
+void GB_ContextStateLoad(_savestate_t *st)
+{
+    // Everything that belongs to the current session
+    static core_local__ _GB_CONTEXT_ current;
+    memcpy(&current, &GameBoy, sizeof(GameBoy));
+
+    _gb_context_pointers_t ptrs;
+
+    SaveState_ChunkOpen(st, "GB  ");
+    SaveState_Read(st, &GameBoy, sizeof(GameBoy));
+    SaveState_Read(st, &ptrs, sizeof(ptrs));
+    SaveState_ChunkClose(st);
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    _EMULATOR_INFO_ *emu = &GameBoy.Emulator;
+
+    if (st->error || (emu->HardwareType != current.Emulator.HardwareType))
+    {
+        memcpy(&GameBoy, &current, sizeof(GameBoy));
+        st->error = 1;
+        return;
+    }
+
+    memcpy(mem->ROM_Switch, current.Memory.ROM_Switch,
+           sizeof(mem->ROM_Switch));
+    mem->MapperWrite = current.Memory.MapperWrite;
+    mem->MapperRead = current.Memory.MapperRead;
+
+    emu->selected_hardware = current.Emulator.selected_hardware;
+    emu->Rom_Pointer = current.Emulator.Rom_Pointer;
+    memcpy(emu->save_filename, current.Emulator.save_filename,
+           sizeof(emu->save_filename));
+    emu->boot_rom = current.Emulator.boot_rom;
+    emu->boot_rom_loaded = current.Emulator.boot_rom_loaded;
+    emu->PPUUpdate = current.Emulator.PPUUpdate;
+    emu->PPUClocksToNextEvent = current.Emulator.PPUClocksToNextEvent;
+    emu->serial_device = current.Emulator.serial_device;
+    emu->SerialSend_Fn = current.Emulator.SerialSend_Fn;
+    emu->SerialRecv_Fn = current.Emulator.SerialRecv_Fn;
+
+    if (emu->enable_boot_rom && (emu->boot_rom_loaded == 0))
+    {
+        memcpy(&GameBoy, &current, sizeof(GameBoy));
+        st->error = 1;
+        return;
+    }
+
+    u8 *rom = (u8 *)emu->Rom_Pointer;
+    size_t rom_size = emu->ROM_Banks * 0x4000;
+    u8 *ctx = (u8 *)mem;
+
+    mem->ROM_Base = gb_offset_to_pointer(st, ptrs.rom_base, rom, rom_size);
+    mem->ROM_Curr = gb_offset_to_pointer(st, ptrs.rom_curr, rom, rom_size);
+    mem->VideoRAM_Curr = gb_offset_to_pointer(st, ptrs.vram_curr, ctx,
+                                              sizeof(_GB_MEMORY_));
+    mem->RAM_Curr = gb_offset_to_pointer(st, ptrs.ram_curr, ctx,
+                                         sizeof(_GB_MEMORY_));
+    mem->WorkRAM_Curr = gb_offset_to_pointer(st, ptrs.wram_curr, ctx,
+                                             sizeof(_GB_MEMORY_));
+
+    if (st->error)
+    {
+        memcpy(&GameBoy, &current, sizeof(GameBoy));
+        return;
+    }
+
+    if (emu->SGBEnabled)
+        emu->DrawScanlineFn = &SGB_ScreenDrawScanline;
+    else if (emu->CGBEnabled)
+        emu->DrawScanlineFn = &GBC_ScreenDrawScanline;
+    else if (emu->gbc_in_gb_mode)
+        emu->DrawScanlineFn = &GBC_GB_ScreenDrawScanline;
+    else
+        emu->DrawScanlineFn = &GB_ScreenDrawScanline;
+
+    GB_MemUpdateReadWriteFunctionPointers();
+    GB_MemReadPagesUpdate();
+
+    for (int i = 0; i < GB_DIRTY_REGION_NUMBER; i++)
+        GB_MemDirtySetAll(i);
+}
@@ -7,6 +7,8 @@
 #ifndef GB_GENERAL__
 #define GB_GENERAL__
 
+#include "../savestate_utils.h"
+
 void GB_PowerOn(void);  // This function doesn't allocate anything
 void GB_PowerOff(void); // This function doesn't free anything
 
@@ -16,4 +18,10 @@ int GB_EmulatorIsEnabledSGB(void);
 
 int GB_RumbleEnabled(void);
 
+// The pointers to functions and to data owned by the frontend aren't saved.
+// They are kept from the current session, so a state can only be loaded on the
+// same hardware it was saved on.
+void GB_ContextStateSave(_savestate_t *st);
+void GB_ContextStateLoad(_savestate_t *st);
+
 #endif // GB_GENERAL__
@@ -22,7 +22,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 static const u32 gb_timer_clock_overflow_mask[4] = {
     1024 - 1, 16 - 1, 64 - 1, 256 - 1
@@ -30,52 +30,107 @@ static const u32 gb_timer_clock_overflow_mask[4] = {
 
 //----------------------------------------------------------------
 
-void GB_HandleRTC(void)
+// The RTC is advanced with the clocks emulated by the CPU, so it isn't affected
+// by the speed of the emulation. The clocks are only turned into seconds when
+// the game accesses the clock.
+
+// Clocks of a second of the RTC, counted in double speed mode
+#define GB_RTC_CLOCKS_PER_SECOND    (2 * 4194304)
+
+static core_local__ int gb_rtc_clock_counter;
+
+void GB_RTCClockCounterReset(void)
+{
+    gb_rtc_clock_counter = 0;
+}
+
+void GB_RTCUpdateClocksCounterReference(int reference_clocks)
 {
     if (!GameBoy.Emulator.HasTimer)
         return;
 
-    // Handle RTC
+    u64 increment_clocks = reference_clocks - gb_rtc_clock_counter;
 
-    if (GameBoy.Emulator.Timer.halt != 0)
-        return;
+    // The frequency of the RTC doesn't depend on the speed of the CPU
+    GameBoy.Emulator.rtc_clocks +=
+            increment_clocks << (1 - GameBoy.Emulator.DoubleSpeed);
 
-    // Increase timer
+    gb_rtc_clock_counter = reference_clocks;
+}
+
+void GB_RTCAdvance(u64 seconds)
+{
+    _GB_MB3_TIMER_ *timer = &GameBoy.Emulator.Timer;
 
-    GameBoy.Emulator.Timer.sec++;
-    if (GameBoy.Emulator.Timer.sec < 60)
+    if (timer->halt != 0)
         return;
 
-    GameBoy.Emulator.Timer.sec -= 60;
-    GameBoy.Emulator.Timer.min++;
+    timer->sec += seconds % 60;
+    seconds /= 60;
+    if (timer->sec > 59)
+    {
+        timer->sec -= 60;
+        seconds++;
+    }
 
-    if (GameBoy.Emulator.Timer.min < 60)
-        return;
+    timer->min += seconds % 60;
+    seconds /= 60;
+    if (timer->min > 59)
+    {
+        timer->min -= 60;
+        seconds++;
+    }
 
-    GameBoy.Emulator.Timer.min -= 60;
-    GameBoy.Emulator.Timer.hour++;
+    timer->hour += seconds % 24;
+    seconds /= 24;
+    if (timer->hour > 23)
+    {
+        timer->hour -= 24;
+        seconds++;
+    }
 
-    if (GameBoy.Emulator.Timer.hour < 24)
+    u64 days = timer->days + seconds;
+    if (days > 511)
+    {
+        // The carry flag persists until the game clears it
+        days &= 511;
+        timer->carry = 1;
+    }
+    timer->days = days;
+}
+
+void GB_RTCUpdate(void)
+{
+    if (!GameBoy.Emulator.HasTimer)
         return;
 
-    GameBoy.Emulator.Timer.hour -= 24;
-    GameBoy.Emulator.Timer.days++;
+    GB_RTCUpdateClocksCounterReference(GB_CPUClockCounterGet());
 
-    if (GameBoy.Emulator.Timer.days < 512)
-        return;
+    u64 seconds = GameBoy.Emulator.rtc_clocks / GB_RTC_CLOCKS_PER_SECOND;
+    GameBoy.Emulator.rtc_clocks %= GB_RTC_CLOCKS_PER_SECOND;
 
-    GameBoy.Emulator.Timer.days -= 512;
-    GameBoy.Emulator.Timer.carry = 1;
-    // The carry flag persists until the user clears it
+    GB_RTCAdvance(seconds);
 }
 
 //----------------------------------------------------------------
 
+// 1 if (IF & IE) may be different from 0. It is always set when a bit of IF or
+// IE is set, but bits cleared by the PPU or by GB_InterruptsExecute() are only
+// noticed the next time the registers are checked.
+static core_local__ int gb_irq_pending = 0;
+
+void GB_InterruptsPendingUpdate(void)
+{
+    gb_irq_pending = (GameBoy.Memory.IO_Ports[IF_REG - 0xFF00]
+                      & GameBoy.Memory.HighRAM[IE_REG - 0xFF80] & 0x1F) != 0;
+}
+
 void GB_InterruptsInit(void)
 {
     GameBoy.Memory.InterruptMasterEnable = 0;
 
     GameBoy.Memory.IO_Ports[IF_REG - 0xFF00] = 0xE0;
+    GB_InterruptsPendingUpdate();
 
     GameBoy.Memory.IO_Ports[TIMA_REG - 0xFF00] = 0x00; // Verified on hardware
     GameBoy.Memory.IO_Ports[TMA_REG - 0xFF00] = 0x00;  // Verified on hardware
@@ -205,6 +260,8 @@ void GB_InterruptsInit(void)
         GameBoy.Emulator.LatchedTime.days = 0;
         GameBoy.Emulator.LatchedTime.carry = 0;
         GameBoy.Emulator.LatchedTime.halt = 0; //GameBoy.Emulator.Timer.halt ?
+
+        GameBoy.Emulator.rtc_clocks = 0;
     }
 }
 
@@ -222,8 +279,14 @@ int GB_InterruptsExecute(void)
 
     int executed_clocks = 0;
 
+    if (gb_irq_pending == 0)
+        return 0;
+
     int interrupts = mem->IO_Ports[IF_REG - 0xFF00]
                      & mem->HighRAM[IE_REG - 0xFF80] & 0x1F;
+    if (interrupts == 0)
+        gb_irq_pending = 0;
+
     if (interrupts != 0)
     {
         if (mem->InterruptMasterEnable) // Execute interrupt and clear IME
@@ -342,6 +405,8 @@ int GB_InterruptsExecute(void)
             }
             GB_CPUClockCounterAdd(8);
 
+            GB_InterruptsPendingUpdate();
+
             int end_clocks = GB_CPUClockCounterGet();
             executed_clocks = end_clocks - start_clocks;
         }
@@ -366,6 +431,8 @@ int GB_InterruptsExecute(void)
 void GB_InterruptsSetFlag(int flag)
 {
     GameBoy.Memory.IO_Ports[IF_REG - 0xFF00] |= flag;
+    if (GameBoy.Memory.HighRAM[IE_REG - 0xFF80] & flag)
+        gb_irq_pending = 1;
     // This is checked in GB_IRQExecute(), not here!
     //if (GameBoy.Memory.HighRAM[IE_REG - 0xFF80] & flag)
     //{
@@ -376,7 +443,7 @@ void GB_InterruptsSetFlag(int flag)
     //        GameBoy.Emulator.CPUHalt = 0;
     //    }
     //}
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
 }
 
 //----------------------------------------------------------------
@@ -384,7 +451,8 @@ void GB_InterruptsSetFlag(int flag)
 void GB_InterruptsWriteIE(int value) // reference_clocks not needed
 {
     GameBoy.Memory.HighRAM[IE_REG - 0xFF80] = value;
-    GB_CPUBreakLoop();
+    GB_InterruptsPendingUpdate();
+    GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
 }
 
 void GB_InterruptsWriteIF(int reference_clocks, int value)
@@ -394,12 +462,13 @@ void GB_InterruptsWriteIF(int reference_clocks, int value)
     GB_TimersUpdateClocksCounterReference(reference_clocks);
     GB_SerialUpdateClocksCounterReference(reference_clocks);
     GameBoy.Memory.IO_Ports[IF_REG - 0xFF00] = value | (0xE0);
-    GB_CPUBreakLoop();
+    GB_InterruptsPendingUpdate();
+    GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
 }
 
 //----------------------------------------------------------------
 
-static int gb_timer_clock_counter = 0;
+static core_local__ int gb_timer_clock_counter = 0;
 
 void GB_TimersClockCounterReset(void)
 {
@@ -441,7 +510,7 @@ static void GB_TimerIncreaseTIMA(void)
 
 void GB_TimersWriteDIV(int reference_clocks, unused__ int value)
 {
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_TIMERS);
 
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
@@ -463,7 +532,7 @@ void GB_TimersWriteDIV(int reference_clocks, unused__ int value)
 
 void GB_TimersWriteTIMA(int reference_clocks, int value)
 {
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_TIMERS);
 
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
@@ -490,7 +559,7 @@ void GB_TimersWriteTIMA(int reference_clocks, int value)
 
 void GB_TimersWriteTMA(int reference_clocks, int value)
 {
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_TIMERS);
 
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
@@ -512,7 +581,7 @@ void GB_TimersWriteTMA(int reference_clocks, int value)
 
 void GB_TimersWriteTAC(int reference_clocks, int value)
 {
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_TIMERS);
 
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
@@ -765,6 +834,23 @@ void GB_TimersUpdateClocksCounterReference(int reference_clocks)
         {
             while (timer_update_clocks >= timer_overflow_count)
             {
+                // The increments that don't overflow TIMA can be done at once.
+                // Only the ones that overflow it need to be done one by one to
+                // handle the IRQ and reload delays.
+                int tima = mem->IO_Ports[TIMA_REG - 0xFF00];
+                int steps = timer_update_clocks / timer_overflow_count;
+                if (steps > 0xFF - tima)
+                    steps = 0xFF - tima;
+
+                if ((steps > 0)
+                    && (GameBoy.Emulator.timer_irq_delay_active == 0)
+                    && (GameBoy.Emulator.timer_reload_delay_active == 0))
+                {
+                    mem->IO_Ports[TIMA_REG - 0xFF00] = tima + steps;
+                    timer_update_clocks -= steps * timer_overflow_count;
+                    continue;
+                }
+
                 GB_TimerIncreaseTIMA();
 
                 timer_update_clocks -= timer_overflow_count;
@@ -781,6 +867,10 @@ void GB_TimersUpdateClocksCounterReference(int reference_clocks)
     // DIV
     // ---
 
+    // DIV doesn't have any event of its own, the register is updated from
+    // sys_clocks whenever the timers are updated, and they are always updated
+    // before it is read.
+
     GameBoy.Emulator.sys_clocks =
             (GameBoy.Emulator.sys_clocks + increment_clocks) & 0xFFFF;
 
@@ -790,12 +880,14 @@ void GB_TimersUpdateClocksCounterReference(int reference_clocks)
     // Done...
 
     GB_TimersClockCounterSet(reference_clocks);
+    GB_CPUEventSourceUpdated(GB_EVENT_TIMERS, reference_clocks);
 }
 
 int GB_TimersGetClocksToNextEvent(void)
 {
-    // DIV
-    int clocks_to_next_event = 256 - (GameBoy.Emulator.sys_clocks & 0xFF);
+    // Only the events that change the state of the CPU or the value of TIMA
+    // after an overflow need to be scheduled.
+    int clocks_to_next_event = 0x7FFFFFFF;
 
     // It seems that TAC can't disable the IRQ once it is prepared
     if (GameBoy.Emulator.timer_irq_delay_active)
@@ -856,7 +948,7 @@ void GB_CheckJoypadInterrupt(void)
         if (GameBoy.Emulator.CPUHalt == 2) // Exit stop mode (in any hardware)
             GameBoy.Emulator.CPUHalt = 0;
 
-        GB_CPUBreakLoop();
+        GB_CPUBreakLoop(PROFILE_SLICE_IRQ);
     }
 
     return;
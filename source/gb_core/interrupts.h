@@ -24,13 +24,22 @@
 #define I_SERIAL (1 << 3)
 #define I_JOYPAD (1 << 4)
 
-void GB_HandleRTC(void);
+// Clock of MBC3 cartridges. GB_RTCUpdate() brings the Timer registers up to
+// date, and it has to be called before they are accessed. GB_RTCAdvance() adds
+// the specified seconds to them, unless the clock is halted.
+void GB_RTCClockCounterReset(void);
+void GB_RTCUpdateClocksCounterReference(int reference_clocks);
+void GB_RTCUpdate(void);
+void GB_RTCAdvance(u64 seconds);
 
 void GB_InterruptsInit(void);
 void GB_InterruptsEnd(void);
 
 int GB_InterruptsExecute(void);
 
+// Has to be called if IF or IE are modified without the functions below
+void GB_InterruptsPendingUpdate(void);
+
 void GB_InterruptsSetFlag(int flag);
 
 void GB_InterruptsWriteIE(int value); // reference_clocks not needed
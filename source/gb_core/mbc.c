@@ -26,7 +26,7 @@
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -56,6 +56,15 @@ void GB_MapperEnd(void)
 
 //------------------------------------------------------------------------------
 
+// Switch the ROM bank mapped at 4000-7FFF to the one in selected_rom
+static void gb_mapper_rom_bank_update(void)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+    GB_MemReadPagesUpdateROMBank();
+}
+
 static void GB_NoMapperWrite(unused__ u32 address, unused__ u32 value)
 {
     //Debug_DebugMsgArg("NO MAPPER WROTE - %02x to %04x", value, address);
@@ -74,6 +83,7 @@ static void GB_MBC1Write(u32 address, u32 value)
             mem->RAMEnabled = ((value & 0xF) == 0xA);
             if (GameBoy.Emulator.RAM_Banks == 0)
                 mem->RAMEnabled = 0;
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x2:
         case 0x3: // ROM Bank Number - lower 5 bits
@@ -85,7 +95,7 @@ static void GB_MBC1Write(u32 address, u32 value)
 
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
 
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            gb_mapper_rom_bank_update();
             break;
         case 0x4:
         case 0x5: // RAM Bank Number - or - Upper Bits of ROM Bank Number
@@ -97,13 +107,14 @@ static void GB_MBC1Write(u32 address, u32 value)
 
                 mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
 
-                mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                gb_mapper_rom_bank_update();
             }
             else // RAM mode
             {
                 mem->selected_ram = value;
                 mem->selected_ram &= GameBoy.Emulator.RAM_Banks - 1;
                 mem->RAM_Curr = mem->ExternRAM[mem->selected_ram];
+                GB_MemReadPagesUpdateRAM();
             }
             break;
         case 0x6:
@@ -147,7 +158,7 @@ static void GB_MBC2Write(u32 address, u32 value)
                 mem->selected_rom = value & (GameBoy.Emulator.ROM_Banks - 1);
                 if (mem->selected_rom == 0)
                     mem->selected_rom++;
-                mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                gb_mapper_rom_bank_update();
             }
             break;
         case 0x4:
@@ -179,6 +190,7 @@ static void GB_MBC3Write(u32 address, u32 value)
             mem->RAMEnabled = ((value & 0xF) == 0xA);
             if (GameBoy.Emulator.RAM_Banks == 0)
                 mem->RAMEnabled = 0;
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x2:
         case 0x3: // ROM Bank Number
@@ -186,7 +198,7 @@ static void GB_MBC3Write(u32 address, u32 value)
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
             if (mem->selected_rom == 0)
                 mem->selected_rom = 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            gb_mapper_rom_bank_update();
             break;
         case 0x4:
         case 0x5: // RAM Bank Number - or - RTC Register Select
@@ -203,6 +215,7 @@ static void GB_MBC3Write(u32 address, u32 value)
                 mem->selected_ram = value;
                 mem->mbc_mode = 0;
             }
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x6:
         case 0x7: // Latch Clock Data
@@ -210,6 +223,8 @@ static void GB_MBC3Write(u32 address, u32 value)
             // but some games don't do that.
             if (value == 0x01)
             {
+                GB_RTCUpdate();
+
                 GameBoy.Emulator.LatchedTime.sec = GameBoy.Emulator.Timer.sec;
                 GameBoy.Emulator.LatchedTime.min = GameBoy.Emulator.Timer.min;
                 GameBoy.Emulator.LatchedTime.hour = GameBoy.Emulator.Timer.hour;
@@ -229,10 +244,14 @@ static void GB_MBC3Write(u32 address, u32 value)
             }
             else // RTC REGISTER
             {
+                GB_RTCUpdate();
+
                 switch (mem->selected_ram)
                 {
                     case 0x08: // Sec
+                        // This also resets the counter of the current second
                         GameBoy.Emulator.Timer.sec = value;
+                        GameBoy.Emulator.rtc_clocks = 0;
                         return;
                     case 0x09: // Min
                         GameBoy.Emulator.Timer.min = value;
@@ -278,18 +297,19 @@ static void GB_MBC5Write(u32 address, u32 value)
             mem->RAMEnabled = ((value & 0x0F) == 0x0A);
             if (GameBoy.Emulator.RAM_Banks == 0)
                 mem->RAMEnabled = 0;
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x2:
             mem->selected_rom &= 0xFF00;
             mem->selected_rom |= (value & 0xFF);
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            gb_mapper_rom_bank_update();
             break;
         case 0x3:
             mem->selected_rom &= 0xFF;
             mem->selected_rom |= value << 8;
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            gb_mapper_rom_bank_update();
             break;
         case 0x4:
         case 0x5:
@@ -303,6 +323,7 @@ static void GB_MBC5Write(u32 address, u32 value)
             }
             mem->selected_ram = value & (GameBoy.Emulator.RAM_Banks - 1);
             mem->RAM_Curr = mem->ExternRAM[mem->selected_ram];
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x6: // Some games write 0 and 1 here (for MBC1 compatibility?).
         case 0x7:
@@ -334,6 +355,7 @@ static void GB_MBC6Write(u32 address, u32 value)
                 mem->RAMEnabled = ((value & 0x0A) == 0x0A);
                 if (GameBoy.Emulator.RAM_Banks == 0)
                     mem->RAMEnabled = 0;
+                GB_MemReadPagesUpdateRAM();
                 break;
             }
             //Debug_DebugMsgArg("MBC6 WROTE - %02x to %04x", value, address);
@@ -350,7 +372,7 @@ static void GB_MBC6Write(u32 address, u32 value)
             {
                 if (value == 0)
                 {
-                    mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                    gb_mapper_rom_bank_update();
                 }
                 //else
                 //{
@@ -377,6 +399,7 @@ static void GB_MBC6Write(u32 address, u32 value)
                 {
                     //mem->ROM_Base = mem->ROM_Switch[mem->selected_ram];
                     mem->RAM_Curr = mem->ExternRAM[mem->selected_ram];
+                    GB_MemReadPagesUpdateRAM();
                 }
                 //else
                 //{
@@ -420,7 +443,7 @@ static void GB_MBC7Write(u32 address, u32 value)
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
             if (mem->selected_rom == 0)
                 mem->selected_rom = 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            gb_mapper_rom_bank_update();
             break;
         case 0x4:
         case 0x5:
@@ -648,6 +671,7 @@ static void GB_MMM01Write(u32 address, u32 value)
                     mem->selected_rom = (GameBoy.Emulator.MMM01.offset + 1)
                                         & (GameBoy.Emulator.ROM_Banks - 1);
                     mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                    GB_MemReadPagesUpdateROM();
                     GameBoy.Emulator.EnableBank0Switch = 0;
                 }
             }
@@ -665,7 +689,7 @@ static void GB_MMM01Write(u32 address, u32 value)
                 // Taito Pack
                 mem->selected_rom = (value & GameBoy.Emulator.MMM01.mask)
                                     + GameBoy.Emulator.MMM01.offset;
-                mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+                gb_mapper_rom_bank_update();
             }
             //Debug_DebugMsgArg("MMM01 WROTE - %02x to %04x", value, address);
             break;
@@ -674,6 +698,7 @@ static void GB_MMM01Write(u32 address, u32 value)
             mem->RAMEnabled = value & 0x01;
             if (GameBoy.Emulator.RAM_Banks == 0)
                 mem->RAMEnabled = 0;
+            GB_MemReadPagesUpdateRAM();
             //Debug_DebugMsgArg("MMM01 WROTE - %02x to %04x", value, address);
             break;
         case 0x4: // ?
@@ -731,12 +756,13 @@ static void GB_CameraWrite(u32 address, u32 value)
             mem->RAMEnabled = ((value & 0x0F) == 0x0A);
             if (GameBoy.Emulator.RAM_Banks == 0)
                 mem->RAMEnabled = 0;
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x2: // ROM change. Bank 0 is allowed
             mem->selected_rom &= 0xFF00;
             mem->selected_rom |= (value & 0xFF);
             mem->selected_rom &= GameBoy.Emulator.ROM_Banks - 1;
-            mem->ROM_Curr = mem->ROM_Switch[mem->selected_rom];
+            gb_mapper_rom_bank_update();
             break;
         case 0x3:
             break;
@@ -752,6 +778,7 @@ static void GB_CameraWrite(u32 address, u32 value)
                 mem->selected_ram = value & (GameBoy.Emulator.RAM_Banks - 1);
                 mem->RAM_Curr = mem->ExternRAM[mem->selected_ram];
             }
+            GB_MemReadPagesUpdateRAM();
             break;
         case 0x5:
         case 0x6:
@@ -938,3 +965,32 @@ void GB_MapperSet(int type)
             break;
     }
 }
+
+u8 *GB_MapperRAMReadPointer(void)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    mapper_read_fn read = mem->MapperRead;
+
+    if (read == &GB_MBC1Read)
+    {
+        if ((GameBoy.Emulator.RAM_Banks == 0) || (mem->RAMEnabled == 0))
+            return NULL;
+        return mem->RAM_Curr;
+    }
+    else if (read == &GB_MBC3Read)
+    {
+        if ((GameBoy.Emulator.RAM_Banks == 0) || (mem->RAMEnabled == 0)
+            || (mem->mbc_mode != 1))
+            return NULL;
+        return mem->RAM_Curr;
+    }
+    else if (read == &GB_CameraRead)
+    {
+        if (mem->mbc_mode != 0)
+            return NULL;
+        return mem->RAM_Curr;
+    }
+
+    // MBC2 reads only have 4 bits, the rest aren't plain RAM reads
+    return NULL;
+}
@@ -7,8 +7,14 @@
 #ifndef GB_MBC__
 #define GB_MBC__
 
+#include "../general_utils.h"
+
 void GB_MapperSet(int type);
 
+// Returns the buffer mapped at A000-BFFF if reads from it can be done directly
+// (see GB_MemReadPagesUpdateRAM()), or NULL if they need the mapper handler.
+u8 *GB_MapperRAMReadPointer(void);
+
 void GB_MapperInit(void);
 void GB_MapperEnd(void);
 
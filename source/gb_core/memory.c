@@ -11,6 +11,7 @@
 #include "../build_options.h"
 #include "../debug_utils.h"
 #include "../general_utils.h"
+#include "../heatmap_utils.h"
 
 #include "cpu.h"
 #include "debug.h"
@@ -19,6 +20,7 @@
 #include "gb_main.h"
 #include "general.h"
 #include "interrupts.h"
+#include "mbc.h"
 #include "memory.h"
 #include "memory_dmg.h"
 #include "memory_gbc.h"
@@ -30,7 +32,99 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
+
+core_local__ u8 *gb_mem_read_page[0x100];
+
+// Handlers of the I/O registers (FF00-FF7F) of the current hardware model
+static core_local__ gb_mem_read_fn_ptr gb_mem_reg_read[0x80];
+static core_local__ gb_mem_write_fn_ptr gb_mem_reg_write[0x80];
+
+//----------------------------------------------------------------
+
+static void gb_mem_read_pages_set(u32 first, u32 last, u8 *base)
+{
+    // The heatmap counts the reads from GB_MemRead8Handler()
+    if (heatmap_enabled)
+        base = NULL;
+
+    for (u32 i = first; i <= last; i++)
+    {
+        if (base == NULL)
+            gb_mem_read_page[i] = NULL;
+        else
+            gb_mem_read_page[i] = &base[(i - first) << 8];
+    }
+
+    // Pages with read watchpoints have to go through GB_MemRead8Handler()
+    if (gb_watchpoint_types & GB_WATCH_READ)
+    {
+        for (u32 i = first; i <= last; i++)
+        {
+            if (GB_DebugWatchpointInRange(i << 8, (i << 8) | 0xFF,
+                                          GB_WATCH_READ))
+                gb_mem_read_page[i] = NULL;
+        }
+    }
+}
+
+void GB_MemReadPagesUpdateROM(void)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    gb_mem_read_pages_set(0x00, 0x3F, mem->ROM_Base);
+    gb_mem_read_pages_set(0x40, 0x7F, mem->ROM_Curr);
+
+    // The boot ROM is mapped over 0000-00FF, and over 0200-08FF in GBC
+    if (GameBoy.Emulator.enable_boot_rom)
+        gb_mem_read_pages_set(0x00, 0x08, NULL);
+}
+
+void GB_MemReadPagesUpdateROMBank(void)
+{
+    gb_mem_read_pages_set(0x40, 0x7F, GameBoy.Memory.ROM_Curr);
+}
+
+void GB_MemReadPagesUpdateRAM(void)
+{
+    // NULL unless the mapper is set to plain RAM accesses
+    gb_mem_read_pages_set(0xA0, 0xBF, GB_MapperRAMReadPointer());
+}
+
+void GB_MemReadPagesUpdate(void)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    GB_MemReadPagesUpdateROM();
+
+#ifdef VRAM_MEM_CHECKING
+    gb_mem_read_pages_set(0x80, 0x9F, NULL);
+#else
+    gb_mem_read_pages_set(0x80, 0x9F, mem->VideoRAM_Curr);
+#endif
+
+    GB_MemReadPagesUpdateRAM();
+
+    // During OAM DMA, reads from C000-CFFF may return the byte being copied
+    if (GameBoy.Emulator.OAM_DMA_enabled)
+        gb_mem_read_pages_set(0xC0, 0xCF, NULL);
+    else
+        gb_mem_read_pages_set(0xC0, 0xCF, mem->WorkRAM);
+
+    gb_mem_read_pages_set(0xD0, 0xDF, mem->WorkRAM_Curr);
+
+    // In DMG, echo RAM at E000-EFFF is mixed with the external RAM
+    if ((mem->MemRead == GB_MemRead8_DMG_BootEnabled)
+        || (mem->MemRead == GB_MemRead8_DMG_BootDisabled))
+        gb_mem_read_pages_set(0xE0, 0xEF, NULL);
+    else
+        gb_mem_read_pages_set(0xE0, 0xEF, mem->WorkRAM);
+
+    gb_mem_read_pages_set(0xF0, 0xFD, mem->WorkRAM_Curr);
+
+    // OAM, IO ports and high RAM
+    gb_mem_read_pages_set(0xFE, 0xFF, NULL);
+}
 
 //----------------------------------------------------------------
 
@@ -46,8 +140,7 @@ void GB_MemUpdateReadWriteFunctionPointers(void)
             case HW_GBP:
                 GameBoy.Memory.MemRead = GB_MemRead8_DMG_BootEnabled;
                 GameBoy.Memory.MemWrite = GB_MemWrite8_DMG;
-                GameBoy.Memory.MemReadReg = GB_MemReadReg8_DMG;
-                GameBoy.Memory.MemWriteReg = GB_MemWriteReg8_DMG;
+                GB_MemRegTablesFill_DMG(gb_mem_reg_read, gb_mem_reg_write);
                 break;
 
             default:
@@ -59,8 +152,7 @@ void GB_MemUpdateReadWriteFunctionPointers(void)
             case HW_GBA_SP:
                 GameBoy.Memory.MemRead = GB_MemRead8_GBC_BootEnabled;
                 GameBoy.Memory.MemWrite = GB_MemWrite8_GBC;
-                GameBoy.Memory.MemReadReg = GB_MemReadReg8_GBC;
-                GameBoy.Memory.MemWriteReg = GB_MemWriteReg8_GBC;
+                GB_MemRegTablesFill_GBC(gb_mem_reg_read, gb_mem_reg_write);
                 break;
         }
     }
@@ -74,8 +166,7 @@ void GB_MemUpdateReadWriteFunctionPointers(void)
             case HW_GBP:
                 GameBoy.Memory.MemRead = GB_MemRead8_DMG_BootDisabled;
                 GameBoy.Memory.MemWrite = GB_MemWrite8_DMG;
-                GameBoy.Memory.MemReadReg = GB_MemReadReg8_DMG;
-                GameBoy.Memory.MemWriteReg = GB_MemWriteReg8_DMG;
+                GB_MemRegTablesFill_DMG(gb_mem_reg_read, gb_mem_reg_write);
                 break;
 
             default:
@@ -87,11 +178,12 @@ void GB_MemUpdateReadWriteFunctionPointers(void)
             case HW_GBA_SP:
                 GameBoy.Memory.MemRead = GB_MemRead8_GBC_BootDisabled;
                 GameBoy.Memory.MemWrite = GB_MemWrite8_GBC;
-                GameBoy.Memory.MemReadReg = GB_MemReadReg8_GBC;
-                GameBoy.Memory.MemWriteReg = GB_MemWriteReg8_GBC;
+                GB_MemRegTablesFill_GBC(gb_mem_reg_read, gb_mem_reg_write);
                 break;
         }
     }
+
+    GB_MemReadPagesUpdate();
 }
 
 void GB_MemInit(void)
@@ -161,6 +253,10 @@ void GB_MemInit(void)
     mem->RAM_Curr = mem->ExternRAM[0];
     mem->WorkRAM_Curr = mem->WorkRAM_Switch[0];
 
+    mem->RAMEnabled = 0; // MBC
+
+    GB_MemReadPagesUpdate();
+
     // Prepare registers
     // -----------------
 
@@ -168,8 +264,6 @@ void GB_MemInit(void)
     // Sound registers are inited in GB_SoundInit()
     // PPU registers in GB_PPUInit()
 
-    GameBoy.Memory.RAMEnabled = 0; // MBC
-
     GB_MemWriteReg8(0xFF72, 0x00);
     GB_MemWriteReg8(0xFF73, 0x00);
 
@@ -191,18 +285,227 @@ void GB_MemInit(void)
         for (int i = 0; i < 64; i++)
         {
             GameBoy.Emulator.bg_pal[i] = 0xFF;
-            GameBoy.Emulator.spr_pal[i] = rand() & 0xFF;
+            GameBoy.Emulator.spr_pal[i] = core_rand() & 0xFF;
+            GBC_PaletteColorUpdate(i);
         }
     }
+
+    GB_MemDirtySetAll(GB_DIRTY_VRAM);
+    GB_MemDirtySetAll(GB_DIRTY_OAM);
+    GB_MemDirtySetAll(GB_DIRTY_PAL);
 }
 
 void GB_MemEnd(void)
 {
-    // Nothing to do
+    Heatmap_End();
+}
+
+//----------------------------------------------------------------
+
+core_local__ u8 gb_dirty_vram[0x4000 >> GB_DIRTY_PAGE_SHIFT];
+core_local__ u8 gb_dirty_oam[1];
+core_local__ u8 gb_dirty_pal[1];
+
+core_local__ int gb_sram_dirty;
+
+// The pages can be thread-local (see core_local__), so their addresses can't be
+// used to initialize a table.
+static u8 *gb_dirty_region_get(_gb_dirty_region_e region, u32 *num_pages)
+{
+    switch (region)
+    {
+        case GB_DIRTY_VRAM:
+            *num_pages = sizeof(gb_dirty_vram);
+            return gb_dirty_vram;
+        case GB_DIRTY_OAM:
+            *num_pages = sizeof(gb_dirty_oam);
+            return gb_dirty_oam;
+        case GB_DIRTY_PAL:
+            *num_pages = sizeof(gb_dirty_pal);
+            return gb_dirty_pal;
+        default:
+            *num_pages = 0;
+            return NULL;
+    }
+}
+
+void GB_MemDirtySetAll(_gb_dirty_region_e region)
+{
+    u32 num_pages;
+    u8 *pages = gb_dirty_region_get(region, &num_pages);
+    memset(pages, 0xFF, num_pages);
+}
+
+int GB_MemDirtyCheck(_gb_dirty_region_e region, u32 user,
+                     u32 offset, u32 size)
+{
+    u32 num_pages;
+    u8 *pages = gb_dirty_region_get(region, &num_pages);
+
+    if (size == 0)
+        return 0;
+
+    u32 first = offset >> GB_DIRTY_PAGE_SHIFT;
+    u32 last = (offset + size - 1) >> GB_DIRTY_PAGE_SHIFT;
+    if (last >= num_pages)
+        last = num_pages - 1;
+
+    int dirty = 0;
+
+    for (u32 i = first; i <= last; i++)
+    {
+        if (pages[i] & user)
+        {
+            pages[i] &= ~user;
+            dirty = 1;
+        }
+    }
+
+    return dirty;
+}
+
+//----------------------------------------------------------------
+
+static inline void gb_mem_watchpoint_check(u32 address, int type)
+{
+    if (gb_watchpoint_check_types & type)
+        GB_DebugWatchpointCheck(address, type);
 }
 
 //----------------------------------------------------------------
 
+typedef enum
+{
+    GB_HEATMAP_ROM,
+    GB_HEATMAP_VRAM,
+    GB_HEATMAP_SRAM,
+    GB_HEATMAP_WRAM,
+    GB_HEATMAP_OAM,
+    GB_HEATMAP_IO,
+    GB_HEATMAP_HRAM,
+
+    GB_HEATMAP_REGIONS
+} _gb_heatmap_region_e;
+
+void GB_MemHeatmapSetEnabled(int enabled)
+{
+    if (enabled)
+    {
+        u32 ram_banks = GameBoy.Emulator.RAM_Banks;
+        if (ram_banks == 0) // MBC2 and RTC registers
+            ram_banks = 1;
+        else if (ram_banks > 16)
+            ram_banks = 16;
+
+        const _heatmap_region_t regions[GB_HEATMAP_REGIONS] = {
+            { "ROM", GameBoy.Emulator.ROM_Banks * 0x4000,
+              0x0000, 0x4000, 0x4000 },
+            { "VRAM", 0x4000, 0x8000, 0x2000, 0x8000 },
+            { "SRAM", ram_banks * 0x2000, 0xA000, 0x2000, 0xA000 },
+            { "WRAM", 0x8000, 0xC000, 0x1000, 0xD000 },
+            { "OAM", 0xA0, 0xFE00, 0, 0 },
+            { "IO", 0x80, 0xFF00, 0, 0 },
+            { "HRAM", 0x80, 0xFF80, 0, 0 },
+        };
+
+        Heatmap_Start(regions, GB_HEATMAP_REGIONS);
+    }
+    else
+    {
+        if (heatmap_enabled == 0)
+            return;
+
+        Heatmap_End();
+    }
+
+    GB_MemReadPagesUpdate();
+}
+
+// The accesses are counted in the bank that is mapped at that moment. Echo RAM
+// is counted as work RAM.
+static void gb_mem_heatmap_count(u32 address, int type)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    const u8 *rom = (const u8 *)GameBoy.Emulator.Rom_Pointer;
+    const u8 *wram_switch = &mem->WorkRAM_Switch[0][0];
+
+    int region;
+    u32 offset;
+
+    switch (address >> 12)
+    {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0x3:
+            region = GB_HEATMAP_ROM;
+            offset = (mem->ROM_Base - rom) + address;
+            break;
+        case 0x4:
+        case 0x5:
+        case 0x6:
+        case 0x7:
+            region = GB_HEATMAP_ROM;
+            offset = (mem->ROM_Curr - rom) + (address - 0x4000);
+            break;
+        case 0x8:
+        case 0x9:
+            region = GB_HEATMAP_VRAM;
+            offset = (mem->VideoRAM_Curr - mem->VideoRAM) + (address - 0x8000);
+            break;
+        case 0xA:
+        case 0xB:
+            region = GB_HEATMAP_SRAM;
+            offset = (mem->RAM_Curr - &mem->ExternRAM[0][0])
+                     + (address - 0xA000);
+            break;
+        case 0xC:
+        case 0xE:
+            region = GB_HEATMAP_WRAM;
+            offset = address & 0xFFF;
+            break;
+        case 0xD:
+            region = GB_HEATMAP_WRAM;
+            offset = 0x1000 + (mem->WorkRAM_Curr - wram_switch)
+                     + (address & 0xFFF);
+            break;
+        default:
+            if (address < 0xFE00)
+            {
+                region = GB_HEATMAP_WRAM;
+                offset = 0x1000 + (mem->WorkRAM_Curr - wram_switch)
+                         + (address & 0xFFF);
+            }
+            else if (address < 0xFF00)
+            {
+                region = GB_HEATMAP_OAM;
+                offset = address - 0xFE00;
+            }
+            else if (address < 0xFF80)
+            {
+                region = GB_HEATMAP_IO;
+                offset = address - 0xFF00;
+            }
+            else
+            {
+                region = GB_HEATMAP_HRAM;
+                offset = address - 0xFF80;
+            }
+            break;
+    }
+
+    if (type == GB_WATCH_READ)
+        Heatmap_Read(region, offset);
+    else
+        Heatmap_Write(region, offset);
+}
+
+static inline void gb_mem_heatmap_check(u32 address, int type)
+{
+    if (heatmap_enabled)
+        gb_mem_heatmap_count(address, type);
+}
+
 void GB_MemWrite16(u32 address, u32 value)
 {
     GB_MemWrite8(address++, value & 0xFF);
@@ -211,12 +514,17 @@ void GB_MemWrite16(u32 address, u32 value)
 
 void GB_MemWrite8(u32 address, u32 value)
 {
+    gb_idle_loop_unsafe = 1;
+    gb_mem_watchpoint_check(address, GB_WATCH_WRITE);
+    gb_mem_heatmap_check(address, GB_WATCH_WRITE);
     GameBoy.Memory.MemWrite(address, value);
 }
 
 void GB_MemWriteReg8(u32 address, u32 value)
 {
-    GameBoy.Memory.MemWriteReg(address, value);
+    u32 index = address - 0xFF00;
+    if (index < 0x80)
+        gb_mem_reg_write[index](address, value);
 }
 
 //----------------------------------------------------------------
@@ -226,14 +534,23 @@ u32 GB_MemRead16(u32 address)
     return GB_MemRead8(address) | (GB_MemRead8((address + 1) & 0xFFFF) << 8);
 }
 
-u32 GB_MemRead8(u32 address)
+u32 GB_MemRead8Handler(u32 address)
 {
+    gb_mem_watchpoint_check(address, GB_WATCH_READ);
+    gb_mem_heatmap_check(address, GB_WATCH_READ);
+
+    if (address >= 0xFF80) // High RAM (and IE)
+        return GameBoy.Memory.HighRAM[address - 0xFF80];
+
     return GameBoy.Memory.MemRead(address);
 }
 
 u32 GB_MemReadReg8(u32 address)
 {
-    return GameBoy.Memory.MemReadReg(address);
+    u32 index = address - 0xFF00;
+    if (index < 0x80)
+        return gb_mem_reg_read[index](address);
+    return 0xFF;
 }
 
 //----------------------------------------------------------------
@@ -245,13 +562,19 @@ void GB_MemWriteDMA8(u32 address, u32 value)
     if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 2 or 3)
         return;
 #endif
+    gb_mem_watchpoint_check(address, GB_WATCH_WRITE);
+    gb_mem_heatmap_check(address, GB_WATCH_WRITE);
     GameBoy.Memory.ObjAttrMem[address - 0xFE00] = value;
+    GB_MemDirtySet(gb_dirty_oam, address - 0xFE00);
 }
 
 u32 GB_MemReadDMA8(u32 address) // Not verified yet - different for GBC and DMG
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
+    gb_mem_watchpoint_check(address, GB_WATCH_READ);
+    gb_mem_heatmap_check(address, GB_WATCH_READ);
+
     switch (address >> 12)
     {
         case 0x0:
@@ -300,7 +623,13 @@ void GB_MemWriteHDMA8(u32 address, u32 value)
     if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
         return;
 
-    GameBoy.Memory.VideoRAM_Curr[address & 0x1FFF] = value;
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    gb_mem_watchpoint_check(0x8000 | (address & 0x1FFF), GB_WATCH_WRITE);
+    gb_mem_heatmap_check(0x8000 | (address & 0x1FFF), GB_WATCH_WRITE);
+    mem->VideoRAM_Curr[address & 0x1FFF] = value;
+    GB_MemDirtySet(gb_dirty_vram,
+                   (mem->VideoRAM_Curr - mem->VideoRAM) + (address & 0x1FFF));
 
 #if 0
     if ((address & 0xE000) == 0x8000) // 8000h or 9000h - Video RAM (VRAM)
@@ -327,6 +656,9 @@ u32 GB_MemReadHDMA8(u32 address)
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
+    gb_mem_watchpoint_check(address, GB_WATCH_READ);
+    gb_mem_heatmap_check(address, GB_WATCH_READ);
+
     switch (address >> 12)
     {
         case 0x0:
@@ -370,6 +702,79 @@ u32 GB_MemReadHDMA8(u32 address)
 
 //----------------------------------------------------------------
 
+// Returns a pointer to [address, address + size) if the DMA reads it from ROM
+// or work RAM, NULL if it has to go through GB_MemReadDMA8() or
+// GB_MemReadHDMA8(). Both of them read these regions the same way.
+static const u8 *GB_MemDMAReadPointer(u32 address, u32 size)
+{
+    if (gb_watchpoint_check_types & GB_WATCH_READ)
+        return NULL;
+
+    // The heatmap counts the bytes one at a time
+    if (heatmap_enabled)
+        return NULL;
+
+    u32 end = address + size - 1;
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    if (end < 0x4000)
+        return &mem->ROM_Base[address];
+    if ((address >= 0x4000) && (end < 0x8000))
+        return &mem->ROM_Curr[address - 0x4000];
+    if ((address >= 0xC000) && (end < 0xD000))
+        return &mem->WorkRAM[address - 0xC000];
+    if ((address >= 0xD000) && (end < 0xE000))
+        return &mem->WorkRAM_Curr[address - 0xD000];
+
+    return NULL;
+}
+
+int GB_MemCopyDMA(u32 dst, u32 src, u32 size)
+{
+    if (gb_watchpoint_check_types & GB_WATCH_WRITE)
+        return 0;
+
+    const u8 *ptr = GB_MemDMAReadPointer(src, size);
+    if (ptr == NULL)
+        return 0;
+
+    memcpy(&GameBoy.Memory.ObjAttrMem[dst - 0xFE00], ptr, size);
+    GB_MemDirtySet(gb_dirty_oam, dst - 0xFE00);
+
+    return 1;
+}
+
+int GB_MemCopyHDMA(u32 dst, u32 src, u32 size)
+{
+    if (gb_watchpoint_check_types & GB_WATCH_WRITE)
+        return 0;
+
+    // The destination wraps inside the VRAM bank
+    u32 offset = dst & 0x1FFF;
+    if (offset + size > 0x2000)
+        return 0;
+
+    const u8 *ptr = GB_MemDMAReadPointer(src, size);
+    if (ptr == NULL)
+        return 0;
+
+    if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
+        return 1; // The whole block is lost, like with GB_MemWriteHDMA8()
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    memcpy(&mem->VideoRAM_Curr[offset], ptr, size);
+
+    u32 vram_offset = (mem->VideoRAM_Curr - mem->VideoRAM) + offset;
+    for (u32 i = 0; i < size; i += 1 << GB_DIRTY_PAGE_SHIFT)
+        GB_MemDirtySet(gb_dirty_vram, vram_offset + i);
+    GB_MemDirtySet(gb_dirty_vram, vram_offset + size - 1);
+
+    return 1;
+}
+
+//----------------------------------------------------------------
+
 void GB_MemoryWriteSVBK(int value) // reference_clocks not needed
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
@@ -382,6 +787,8 @@ void GB_MemoryWriteSVBK(int value) // reference_clocks not needed
 
     mem->selected_wram = value - 1;
     mem->WorkRAM_Curr = mem->WorkRAM_Switch[mem->selected_wram];
+
+    GB_MemReadPagesUpdate();
 }
 
 void GB_MemoryWriteVBK(int value) // reference_clocks not needed
@@ -396,4 +803,6 @@ void GB_MemoryWriteVBK(int value) // reference_clocks not needed
         mem->VideoRAM_Curr = &mem->VideoRAM[0x2000];
     else
         mem->VideoRAM_Curr = &mem->VideoRAM[0x0000];
+
+    GB_MemReadPagesUpdate();
 }
@@ -17,7 +17,21 @@ void GB_MemWrite8(u32 address, u32 value);
 void GB_MemWriteReg8(u32 address, u32 value);
 
 u32 GB_MemRead16(u32 address); // Only used by debugger
-u32 GB_MemRead8(u32 address);
+
+// Pages of the memory map that can be read directly, see
+// GB_MemReadPagesUpdate(). The others are read with GB_MemRead8Handler().
+extern core_local__ u8 *gb_mem_read_page[0x100];
+u32 GB_MemRead8Handler(u32 address);
+
+static inline u32 GB_MemRead8(u32 address)
+{
+    u8 *page = gb_mem_read_page[(address >> 8) & 0xFF];
+    if (page)
+        return page[address & 0xFF];
+
+    return GB_MemRead8Handler(address);
+}
+
 u32 GB_MemReadReg8(u32 address);
 
 // This assumes that address is 0xFE00-0xFEA0
@@ -27,7 +41,70 @@ u32 GB_MemReadDMA8(u32 address);
 void GB_MemWriteHDMA8(u32 address, u32 value);
 u32 GB_MemReadHDMA8(u32 address);
 
+// Copy "size" bytes from "src" to "dst" with the same result as the functions
+// above. They only do it if the source is ROM or work RAM, there are no
+// watchpoints and the heatmap isn't running. They return 1 if the bytes have
+// been copied, 0 if the caller has to copy them one at a time instead. "size"
+// can't be 0.
+int GB_MemCopyDMA(u32 dst, u32 src, u32 size);
+int GB_MemCopyHDMA(u32 dst, u32 src, u32 size);
+
 void GB_MemoryWriteSVBK(int value); // reference_clocks not needed
 void GB_MemoryWriteVBK(int value);  // reference_clocks not needed
 
+// The memory map is divided in 256 pages of 256 bytes. Pages that can be read
+// directly from a buffer have a pointer to it, the rest are read through the
+// MemRead handler. They have to be updated whenever the mapping changes.
+void GB_MemReadPagesUpdate(void);
+void GB_MemReadPagesUpdateROM(void); // Only pages 0x00-0x7F
+void GB_MemReadPagesUpdateROMBank(void); // Only pages 0x40-0x7F
+void GB_MemReadPagesUpdateRAM(void); // Only pages 0xA0-0xBF
+
+// Starts or stops counting the accesses to each region (see heatmap_utils.h).
+// The reads done by the debugger with GB_MemRead8() are counted too.
+void GB_MemHeatmapSetEnabled(int enabled);
+
+// VRAM (both banks), OAM and GBC palette RAM (BG palettes followed by OBJ
+// palettes) are divided in pages of 256 bytes. Each page has one bit for each
+// user of this information. Writing to a page sets all of its bits, and each
+// user clears its own bits when it checks for changes.
+
+#define GB_DIRTY_PAGE_SHIFT     8
+
+typedef enum
+{
+    GB_DIRTY_VRAM,
+    GB_DIRTY_OAM,
+    GB_DIRTY_PAL,
+
+    GB_DIRTY_REGION_NUMBER
+} _gb_dirty_region_e;
+
+#define GB_DIRTY_USER_TILEVIEWER    BIT(0) // Debugger windows
+#define GB_DIRTY_USER_MAPVIEWER     BIT(1)
+#define GB_DIRTY_USER_SPRVIEWER     BIT(2)
+#define GB_DIRTY_USER_PALVIEWER     BIT(3)
+#define GB_DIRTY_USER_SPRLINES      BIT(4) // Sprites of each line (video.c)
+#define GB_DIRTY_USER_BGLINES       BIT(5) // BG of each line (video.c)
+
+extern core_local__ u8 gb_dirty_vram[0x4000 >> GB_DIRTY_PAGE_SHIFT];
+extern core_local__ u8 gb_dirty_oam[1];
+extern core_local__ u8 gb_dirty_pal[1];
+
+static inline void GB_MemDirtySet(u8 *pages, u32 offset)
+{
+    pages[offset >> GB_DIRTY_PAGE_SHIFT] = 0xFF;
+}
+
+void GB_MemDirtySetAll(_gb_dirty_region_e region);
+
+// Returns 1 if any page in the range has been written since the last time the
+// user checked it, and clears the bits of the user in that range.
+int GB_MemDirtyCheck(_gb_dirty_region_e region, u32 user,
+                     u32 offset, u32 size);
+
+// Set when the cartridge RAM (or RTC) may have been written, cleared when the
+// battery save file is read or written.
+extern core_local__ int gb_sram_dirty;
+
 #endif // GB_MEMORY__
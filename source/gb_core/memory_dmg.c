@@ -19,6 +19,7 @@
 #include "general.h"
 #include "interrupts.h"
 #include "memory.h"
+#include "memory_dmg.h"
 #include "ppu.h"
 #include "ppu_dmg.h"
 #include "serial.h"
@@ -28,7 +29,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
@@ -200,10 +201,13 @@ void GB_MemWrite8_DMG(u32 address, u32 value)
                 return;
 #endif
             mem->VideoRAM_Curr[address - 0x8000] = value;
+            GB_MemDirtySet(gb_dirty_vram, (mem->VideoRAM_Curr - mem->VideoRAM)
+                                          + (address - 0x8000));
             return;
         case 0xA:
         case 0xB: // 8KB External RAM
             GameBoy.Memory.MapperWrite(address, value);
+            gb_sram_dirty = 1;
             return;
         case 0xC: // 4KB Work RAM Bank 0
             mem->WorkRAM[address - 0xC000] = value;
@@ -215,6 +219,7 @@ void GB_MemWrite8_DMG(u32 address, u32 value)
         {
             mem->WorkRAM[address - 0xE000] = value;
             GameBoy.Memory.MapperWrite(address - 0xE000 + 0xA000, value);
+            gb_sram_dirty = 1;
             return;
         }
         case 0xF:
@@ -234,6 +239,7 @@ void GB_MemWrite8_DMG(u32 address, u32 value)
                 }
 #endif
                 mem->ObjAttrMem[address - 0xFE00] = value;
+                GB_MemDirtySet(gb_dirty_oam, address - 0xFE00);
                 return;
             }
             else if (address < 0xFF00) // Not Usable
@@ -268,356 +274,429 @@ void GB_MemWrite8_DMG(u32 address, u32 value)
 
 //----------------------------------------------------------------
 
-u32 GB_MemReadReg8_DMG(u32 address)
+// I/O registers
+//
+// Each register has its own handler, and the tables of the handlers of each
+// hardware model are filled by GB_MemRegTablesFill_DMG() and
+// GB_MemRegTablesFill_GBC(). The GBC tables start from the DMG ones, so the
+// handlers of this file are the ones of the registers that behave the same way
+// in all models.
+
+static u32 GB_MemReadRegUnused(unused__ u32 address)
+{
+    return 0xFF;
+}
+
+static u32 GB_MemReadRegPlain(u32 address)
+{
+    return GameBoy.Memory.IO_Ports[address - 0xFF00];
+}
+
+static u32 GB_MemReadRegNone(unused__ u32 address)
+{
+    return 0x00;
+}
+
+static u32 GB_MemReadRegSB(unused__ u32 address)
+{
+    gb_idle_loop_unsafe = 1;
+    GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[SB_REG - 0xFF00];
+}
+
+static u32 GB_MemReadRegSC_DMG(unused__ u32 address)
+{
+    gb_idle_loop_unsafe = 1;
+    GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[SC_REG - 0xFF00] | 0x7E;
+}
+
+static u32 GB_MemReadRegTIMA(unused__ u32 address)
+{
+    gb_idle_loop_unsafe = 1;
+    GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[TIMA_REG - 0xFF00];
+}
+
+static u32 GB_MemReadRegTAC(unused__ u32 address)
+{
+    return GameBoy.Memory.IO_Ports[TAC_REG - 0xFF00] | 0xF8;
+}
+
+static u32 GB_MemReadRegDIV(unused__ u32 address)
+{
+    GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[DIV_REG - 0xFF00];
+}
+
+static u32 GB_MemReadRegIF(unused__ u32 address)
+{
+    //GB_UpdateCounterToClocks(GB_CPUClockCounterGet());
+    GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[IF_REG - 0xFF00];
+}
+
+static u32 GB_MemReadRegSTAT(unused__ u32 address)
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-    switch (address)
+    GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    if (GameBoy.Emulator.lcd_on)
+        return mem->IO_Ports[STAT_REG - 0xFF00] | 0x80;
+    return (mem->IO_Ports[STAT_REG - 0xFF00] | 0x80) & 0xFC;
+}
+
+static u32 GB_MemReadRegLY(unused__ u32 address)
+{
+    if (GameBoy.Emulator.lcd_on)
     {
-        // Serial
-        case SB_REG:
-            GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[SB_REG - 0xFF00];
-        case SC_REG:
-            GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[SC_REG - 0xFF00] | 0x7E;
-
-        // Timer
-        case TMA_REG:
-            return mem->IO_Ports[address - 0xFF00];
-        case TIMA_REG:
-            GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[TIMA_REG - 0xFF00];
-        case TAC_REG:
-            return mem->IO_Ports[TAC_REG - 0xFF00] | 0xF8;
-
-        // Divider
-        case DIV_REG:
-            GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[DIV_REG - 0xFF00];
-
-        // Interrupts
-        case IF_REG:
-            //GB_UpdateCounterToClocks(GB_CPUClockCounterGet());
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[IF_REG - 0xFF00];
-
-        // DMA
-        case DMA_REG: // This is R/W in all GB models
-            return mem->IO_Ports[DMA_REG - 0xFF00];
-
-        // Video
-        case LCDC_REG:
-        case SCY_REG:
-        case SCX_REG:
-        case LYC_REG:
-        case BGP_REG:
-        case OBP0_REG:
-        case OBP1_REG:
-        case WY_REG:
-        case WX_REG:
-            return mem->IO_Ports[address - 0xFF00];
-
-        // TODO
-
-        case STAT_REG:
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            if (GameBoy.Emulator.lcd_on)
-                return mem->IO_Ports[STAT_REG - 0xFF00] | 0x80;
-            return (mem->IO_Ports[STAT_REG - 0xFF00] | 0x80) & 0xFC;
-
-        case LY_REG:
-            if (GameBoy.Emulator.lcd_on)
-            {
-                GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-                return mem->IO_Ports[LY_REG - 0xFF00];
-            }
-            else
-            {
-                return 0; // Verified on hardware
-            }
+        GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+        return GameBoy.Memory.IO_Ports[LY_REG - 0xFF00];
+    }
+    else
+    {
+        return 0; // Verified on hardware
+    }
+}
 
-        case NR12_REG:
-        case NR22_REG:
-        case NR42_REG:
-        case NR43_REG:
-        case NR50_REG:
-        case NR51_REG:
-            return mem->IO_Ports[address - 0xFF00];
+static u32 GB_MemReadRegP1(unused__ u32 address)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-        case P1_REG:
-            //GB_SGBUpdate(GB_CPUClockCounterGet()); TODO
+    //GB_SGBUpdate(GB_CPUClockCounterGet()); TODO
 
-            if (GameBoy.Emulator.SGBEnabled == 1)
-                return SGB_ReadP1();
+    GB_InputLatch();
 
-            u32 result = 0;
+    if (GameBoy.Emulator.SGBEnabled == 1)
+        return SGB_ReadP1();
 
-            u32 p1_reg = mem->IO_Ports[P1_REG - 0xFF00];
-            int Keys = GB_Input_Get(0);
-            if ((p1_reg & (1 << 5)) == 0) // A-B-SEL-STA
-            {
-                result |= (Keys & KEY_A) ? JOY_A : 0;
-                result |= (Keys & KEY_B) ? JOY_B : 0;
-                result |= (Keys & KEY_SELECT) ? JOY_SELECT : 0;
-                result |= (Keys & KEY_START) ? JOY_START : 0;
-            }
-            if ((p1_reg & (1 << 4)) == 0) // PAD
-            {
-                result |= (Keys & KEY_UP) ? JOY_UP : 0;
-                result |= (Keys & KEY_DOWN) ? JOY_DOWN : 0;
-                result |= (Keys & KEY_LEFT) ? JOY_LEFT : 0;
-                result |= (Keys & KEY_RIGHT) ? JOY_RIGHT : 0;
-            }
+    u32 result = 0;
 
-            result = (~result) & 0x0F;
-            result |= p1_reg & 0xF0;
-            result |= 0xC0;
-
-            mem->IO_Ports[P1_REG - 0xFF00] = result;
-            return result;
-
-        case NR10_REG:
-            return mem->IO_Ports[NR10_REG - 0xFF00] | 0x80;
-        case NR11_REG:
-        case NR21_REG:
-            return mem->IO_Ports[address - 0xFF00] | 0x3F;
-        case NR13_REG:
-        case NR23_REG:
-        case NR33_REG:
-            return 0xFF;
-        case NR14_REG:
-        case NR24_REG:
-        case NR34_REG:
-        case NR44_REG:
-            return mem->IO_Ports[address - 0xFF00] | 0xBF;
-        case NR30_REG:
-            return mem->IO_Ports[NR30_REG - 0xFF00] | 0x7F;
-        case NR32_REG:
-            return mem->IO_Ports[NR32_REG - 0xFF00] | 0x9F;
-        case NR31_REG:
-        case NR41_REG:
-            return 0xFF;
-        case NR52_REG:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[NR52_REG - 0xFF00] | 0x70;
-
-        // Wave pattern for channel 3
-        case 0xFF30:
-        case 0xFF31:
-        case 0xFF32:
-        case 0xFF33:
-        case 0xFF34:
-        case 0xFF35:
-        case 0xFF36:
-        case 0xFF37:
-        case 0xFF38:
-        case 0xFF39:
-        case 0xFF3A:
-        case 0xFF3B:
-        case 0xFF3C:
-        case 0xFF3D:
-        case 0xFF3E:
-        case 0xFF3F:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-
-            // Is GBC mode enabled or GBC hardware?
-            //if (GameBoy.Emulator.CGBEnabled == 1)
-            //    return mem->IO_Ports[address - 0xFF00];
-            // Demotronic says that it can't be read... :S
-
-            // There are some moments when playing that the sound hardware reads
-            // from this RAM and those registers read the current value being
-            // played.
-            if (mem->IO_Ports[NR52_REG - 0xFF00] & (1 << 2)) // If playing...
-                return 0xFF;
-            else
-                return mem->IO_Ports[address - 0xFF00];
+    u32 p1_reg = mem->IO_Ports[P1_REG - 0xFF00];
+    int Keys = GB_Input_Get(0);
+    if ((p1_reg & (1 << 5)) == 0) // A-B-SEL-STA
+    {
+        result |= (Keys & KEY_A) ? JOY_A : 0;
+        result |= (Keys & KEY_B) ? JOY_B : 0;
+        result |= (Keys & KEY_SELECT) ? JOY_SELECT : 0;
+        result |= (Keys & KEY_START) ? JOY_START : 0;
+    }
+    if ((p1_reg & (1 << 4)) == 0) // PAD
+    {
+        result |= (Keys & KEY_UP) ? JOY_UP : 0;
+        result |= (Keys & KEY_DOWN) ? JOY_DOWN : 0;
+        result |= (Keys & KEY_LEFT) ? JOY_LEFT : 0;
+        result |= (Keys & KEY_RIGHT) ? JOY_RIGHT : 0;
+    }
 
-        // Undocumented registers...
-        case 0xFF76:
-        case 0xFF77:
-            return 0x00;
+    result = (~result) & 0x0F;
+    result |= p1_reg & 0xF0;
+    result |= 0xC0;
 
-        case 0xFF75:
-            return mem->IO_Ports[0xFF75 - 0xFF00] | 0x8F;
+    mem->IO_Ports[P1_REG - 0xFF00] = result;
+    return result;
+}
 
-        default:
-            return 0xFF;
-    }
+static u32 GB_MemReadRegNR10(unused__ u32 address)
+{
+    return GameBoy.Memory.IO_Ports[NR10_REG - 0xFF00] | 0x80;
+}
 
-    return 0xFF;
+static u32 GB_MemReadRegDuty(u32 address) // NR11, NR21
+{
+    return GameBoy.Memory.IO_Ports[address - 0xFF00] | 0x3F;
 }
 
-//----------------------------------------------------------------
+static u32 GB_MemReadRegFreqHi(u32 address) // NR14, NR24, NR34, NR44
+{
+    return GameBoy.Memory.IO_Ports[address - 0xFF00] | 0xBF;
+}
 
-void GB_MemWriteReg8_DMG(u32 address, u32 value)
+static u32 GB_MemReadRegNR30(unused__ u32 address)
+{
+    return GameBoy.Memory.IO_Ports[NR30_REG - 0xFF00] | 0x7F;
+}
+
+static u32 GB_MemReadRegNR32(unused__ u32 address)
+{
+    return GameBoy.Memory.IO_Ports[NR32_REG - 0xFF00] | 0x9F;
+}
+
+static u32 GB_MemReadRegNR52(unused__ u32 address)
+{
+    gb_idle_loop_unsafe = 1;
+    GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[NR52_REG - 0xFF00] | 0x70;
+}
+
+static u32 GB_MemReadRegWave(u32 address) // Wave pattern for channel 3
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-    switch (address)
-    {
-        // Serial
-        case SB_REG:
-            GB_SerialWriteSB(GB_CPUClockCounterGet(), value);
-            return;
-        case SC_REG:
-            GB_SerialWriteSC(GB_CPUClockCounterGet(), value);
-            return;
+    gb_idle_loop_unsafe = 1;
+    GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
+
+    // Is GBC mode enabled or GBC hardware?
+    //if (GameBoy.Emulator.CGBEnabled == 1)
+    //    return mem->IO_Ports[address - 0xFF00];
+    // Demotronic says that it can't be read... :S
+
+    // There are some moments when playing that the sound hardware reads
+    // from this RAM and those registers read the current value being
+    // played.
+    if (mem->IO_Ports[NR52_REG - 0xFF00] & (1 << 2)) // If playing...
+        return 0xFF;
+    else
+        return mem->IO_Ports[address - 0xFF00];
+}
 
-        // Timer
-        case TIMA_REG:
-            GB_TimersWriteTIMA(GB_CPUClockCounterGet(), value);
-            return;
-        case TMA_REG:
-            GB_TimersWriteTMA(GB_CPUClockCounterGet(), value);
-            return;
-        case TAC_REG:
-            GB_TimersWriteTAC(GB_CPUClockCounterGet(), value);
-            return;
+static u32 GB_MemReadRegFF75(unused__ u32 address)
+{
+    return GameBoy.Memory.IO_Ports[0xFF75 - 0xFF00] | 0x8F;
+}
 
-        // Divider
-        case DIV_REG:
-            GB_TimersWriteDIV(GB_CPUClockCounterGet(), value);
-            return;
+//----------------------------------------------------------------
 
-        // Interrupts
-        case IF_REG:
-            GB_InterruptsWriteIF(GB_CPUClockCounterGet(), value);
-            return;
+static void GB_MemWriteRegIgnore(unused__ u32 address, unused__ u32 value)
+{
+}
 
-        // DMA
-        case DMA_REG:
-            GB_DMAWriteDMA(GB_CPUClockCounterGet(), value);
-            return;
+static void GB_MemWriteRegPlain(u32 address, u32 value)
+{
+    GameBoy.Memory.IO_Ports[address - 0xFF00] = value;
+}
 
-        // Video
-        case LY_REG: // Read only
-            return;
-        case LYC_REG:
-            GB_PPUWriteLYC_DMG(GB_CPUClockCounterGet(), value);
-            return;
-        case LCDC_REG:
-            GB_PPUWriteLCDC_DMG(GB_CPUClockCounterGet(), value);
-            return;
-        case STAT_REG:
-            GB_PPUWriteSTAT_DMG(GB_CPUClockCounterGet(), value);
-            return;
+static void GB_MemWriteRegSB(unused__ u32 address, u32 value)
+{
+    GB_SerialWriteSB(GB_CPUClockCounterGet(), value);
+}
 
-        // TODO: Registers below
-
-        case SCY_REG:
-        case SCX_REG:
-        case BGP_REG:
-        case OBP0_REG:
-        case OBP1_REG:
-        case WY_REG:
-        case WX_REG:
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            mem->IO_Ports[address - 0xFF00] = value;
-            return;
+static void GB_MemWriteRegSC(unused__ u32 address, u32 value)
+{
+    GB_SerialWriteSC(GB_CPUClockCounterGet(), value);
+}
 
-        case P1_REG:
-            //GB_SGBUpdate(GB_CPUClockCounterGet()); TODO
-            if (GameBoy.Emulator.SGBEnabled == 1)
-                SGB_WriteP1(value);
-            mem->IO_Ports[P1_REG - 0xFF00] = value & 0x30;
-            // Note: Writing to this register can trigger the joypad interrupt
-            GB_CheckJoypadInterrupt();
-            return;
+static void GB_MemWriteRegTIMA(unused__ u32 address, u32 value)
+{
+    GB_TimersWriteTIMA(GB_CPUClockCounterGet(), value);
+}
 
-        // Sound
-        case NR10_REG:
-        case NR11_REG:
-        case NR12_REG:
-        case NR13_REG:
-        case NR14_REG:
-        case NR21_REG:
-        case NR22_REG:
-        case NR23_REG:
-        case NR24_REG:
-        case NR30_REG:
-        case NR31_REG:
-        case NR32_REG:
-        case NR33_REG:
-        case NR34_REG:
-        case NR41_REG:
-        case NR42_REG:
-        case NR43_REG:
-        case NR44_REG:
-        case NR50_REG:
-        case NR51_REG:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            mem->IO_Ports[address - 0xFF00] = value;
-            GB_SoundRegWrite(address, value);
-            return;
-        case NR52_REG:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            mem->IO_Ports[NR52_REG - 0xFF00] &= 0x0F; // Status flags
-            mem->IO_Ports[NR52_REG - 0xFF00] |= (value & 0xF0);
-            GB_SoundRegWrite(address, value);
-            return;
+static void GB_MemWriteRegTMA(unused__ u32 address, u32 value)
+{
+    GB_TimersWriteTMA(GB_CPUClockCounterGet(), value);
+}
 
-        // Wave for channel 3
-        case 0xFF30:
-        case 0xFF31:
-        case 0xFF32:
-        case 0xFF33:
-        case 0xFF34:
-        case 0xFF35:
-        case 0xFF36:
-        case 0xFF37:
-        case 0xFF38:
-        case 0xFF39:
-        case 0xFF3A:
-        case 0xFF3B:
-        case 0xFF3C:
-        case 0xFF3D:
-        case 0xFF3E:
-        case 0xFF3F:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            // If not playing, allow writing here
-            if ((mem->IO_Ports[NR52_REG - 0xFF00] & (1 << 2)) == 0)
-                mem->IO_Ports[address - 0xFF00] = value;
-            return;
+static void GB_MemWriteRegTAC(unused__ u32 address, u32 value)
+{
+    GB_TimersWriteTAC(GB_CPUClockCounterGet(), value);
+}
 
-        // Undocumented registers...
+static void GB_MemWriteRegDIV(unused__ u32 address, u32 value)
+{
+    GB_TimersWriteDIV(GB_CPUClockCounterGet(), value);
+}
 
-        // Writes done by the boot ROM:
-        //
-        // DMG ROM: [FF50]=01
-        //
-        // MGB ROM: [FF50]=FF
-        //
-        // SGB ROM: [FF50]=01
+static void GB_MemWriteRegIF(unused__ u32 address, u32 value)
+{
+    GB_InterruptsWriteIF(GB_CPUClockCounterGet(), value);
+}
 
-        case 0xFF50: //Disable boot rom
-            if (GameBoy.Emulator.enable_boot_rom)
-            {
-                //if (value == 1) // DMG or SGB
-                //if (value == 0xFF) // MGB
-                GameBoy.Emulator.enable_boot_rom = 0;
-                GB_MemUpdateReadWriteFunctionPointers();
-                GB_CPUBreakLoop();
-            }
-            return;
+static void GB_MemWriteRegDMA(unused__ u32 address, u32 value)
+{
+    GB_DMAWriteDMA(GB_CPUClockCounterGet(), value);
+}
 
-        case 0xFF76:
-        case 0xFF77:
-            return;
-        case 0xFF72:
-            mem->IO_Ports[0xFF72 - 0xFF00] = value;
-            return;
-        case 0xFF73:
-            mem->IO_Ports[0xFF73 - 0xFF00] = value;
-            return;
-        case 0xFF75:
-            mem->IO_Ports[0xFF75 - 0xFF00] = value | 0x8F;
-            return;
+static void GB_MemWriteRegLYC_DMG(unused__ u32 address, u32 value)
+{
+    GB_PPUWriteLYC_DMG(GB_CPUClockCounterGet(), value);
+}
 
-        default:
-            return;
+static void GB_MemWriteRegLCDC_DMG(unused__ u32 address, u32 value)
+{
+    GB_PPUWriteLCDC_DMG(GB_CPUClockCounterGet(), value);
+}
+
+static void GB_MemWriteRegSTAT_DMG(unused__ u32 address, u32 value)
+{
+    GB_PPUWriteSTAT_DMG(GB_CPUClockCounterGet(), value);
+}
+
+static void GB_MemWriteRegVideo(u32 address, u32 value)
+{
+    GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    GameBoy.Memory.IO_Ports[address - 0xFF00] = value;
+}
+
+static void GB_MemWriteRegP1_DMG(unused__ u32 address, u32 value)
+{
+    //GB_SGBUpdate(GB_CPUClockCounterGet()); TODO
+    if (GameBoy.Emulator.SGBEnabled == 1)
+        SGB_WriteP1(value);
+    GameBoy.Memory.IO_Ports[P1_REG - 0xFF00] = value & 0x30;
+    // Note: Writing to this register can trigger the joypad interrupt
+    GB_CheckJoypadInterrupt();
+}
+
+static void GB_MemWriteRegSound(u32 address, u32 value)
+{
+    GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    GameBoy.Memory.IO_Ports[address - 0xFF00] = value;
+    GB_SoundRegWrite(address, value);
+}
+
+static void GB_MemWriteRegNR52(u32 address, u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    mem->IO_Ports[NR52_REG - 0xFF00] &= 0x0F; // Status flags
+    mem->IO_Ports[NR52_REG - 0xFF00] |= (value & 0xF0);
+    GB_SoundRegWrite(address, value);
+}
+
+static void GB_MemWriteRegWave(u32 address, u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    // If not playing, allow writing here
+    if ((mem->IO_Ports[NR52_REG - 0xFF00] & (1 << 2)) == 0)
+        mem->IO_Ports[address - 0xFF00] = value;
+}
+
+// Writes done by the boot ROM:
+//
+// DMG ROM: [FF50]=01
+//
+// MGB ROM: [FF50]=FF
+//
+// SGB ROM: [FF50]=01
+static void GB_MemWriteRegFF50_DMG(unused__ u32 address, unused__ u32 value)
+{
+    if (GameBoy.Emulator.enable_boot_rom)
+    {
+        //if (value == 1) // DMG or SGB
+        //if (value == 0xFF) // MGB
+        GameBoy.Emulator.enable_boot_rom = 0;
+        GB_MemUpdateReadWriteFunctionPointers();
+        GB_CPUBreakLoop(PROFILE_SLICE_IO);
     }
 }
+
+static void GB_MemWriteRegFF75(unused__ u32 address, u32 value)
+{
+    GameBoy.Memory.IO_Ports[0xFF75 - 0xFF00] = value | 0x8F;
+}
+
+//----------------------------------------------------------------
+
+#define REG(address)    ((address) - 0xFF00)
+
+void GB_MemRegTablesFill_DMG(gb_mem_read_fn_ptr *read,
+                             gb_mem_write_fn_ptr *write)
+{
+    for (int i = 0; i < 0x80; i++)
+    {
+        read[i] = GB_MemReadRegUnused;
+        write[i] = GB_MemWriteRegIgnore;
+    }
+
+    // Joypad
+    read[REG(P1_REG)] = GB_MemReadRegP1;
+    write[REG(P1_REG)] = GB_MemWriteRegP1_DMG;
+
+    // Serial
+    read[REG(SB_REG)] = GB_MemReadRegSB;
+    write[REG(SB_REG)] = GB_MemWriteRegSB;
+    read[REG(SC_REG)] = GB_MemReadRegSC_DMG;
+    write[REG(SC_REG)] = GB_MemWriteRegSC;
+
+    // Timer and divider
+    read[REG(DIV_REG)] = GB_MemReadRegDIV;
+    write[REG(DIV_REG)] = GB_MemWriteRegDIV;
+    read[REG(TIMA_REG)] = GB_MemReadRegTIMA;
+    write[REG(TIMA_REG)] = GB_MemWriteRegTIMA;
+    read[REG(TMA_REG)] = GB_MemReadRegPlain;
+    write[REG(TMA_REG)] = GB_MemWriteRegTMA;
+    read[REG(TAC_REG)] = GB_MemReadRegTAC;
+    write[REG(TAC_REG)] = GB_MemWriteRegTAC;
+
+    // Interrupts
+    read[REG(IF_REG)] = GB_MemReadRegIF;
+    write[REG(IF_REG)] = GB_MemWriteRegIF;
+
+    // Sound
+    read[REG(NR10_REG)] = GB_MemReadRegNR10;
+    read[REG(NR11_REG)] = GB_MemReadRegDuty;
+    read[REG(NR12_REG)] = GB_MemReadRegPlain;
+    read[REG(NR14_REG)] = GB_MemReadRegFreqHi;
+    read[REG(NR21_REG)] = GB_MemReadRegDuty;
+    read[REG(NR22_REG)] = GB_MemReadRegPlain;
+    read[REG(NR24_REG)] = GB_MemReadRegFreqHi;
+    read[REG(NR30_REG)] = GB_MemReadRegNR30;
+    read[REG(NR32_REG)] = GB_MemReadRegNR32;
+    read[REG(NR34_REG)] = GB_MemReadRegFreqHi;
+    read[REG(NR42_REG)] = GB_MemReadRegPlain;
+    read[REG(NR43_REG)] = GB_MemReadRegPlain;
+    read[REG(NR44_REG)] = GB_MemReadRegFreqHi;
+    read[REG(NR50_REG)] = GB_MemReadRegPlain;
+    read[REG(NR51_REG)] = GB_MemReadRegPlain;
+    read[REG(NR52_REG)] = GB_MemReadRegNR52;
+    // NR13, NR23, NR31, NR33 and NR41 are write only
+
+    for (u32 i = NR10_REG; i <= NR51_REG; i++)
+    {
+        if (i != 0xFF15 && i != 0xFF1F) // Unused
+            write[REG(i)] = GB_MemWriteRegSound;
+    }
+    write[REG(NR52_REG)] = GB_MemWriteRegNR52;
+
+    for (u32 i = 0xFF30; i <= 0xFF3F; i++)
+    {
+        read[REG(i)] = GB_MemReadRegWave;
+        write[REG(i)] = GB_MemWriteRegWave;
+    }
+
+    // Video
+    read[REG(LCDC_REG)] = GB_MemReadRegPlain;
+    write[REG(LCDC_REG)] = GB_MemWriteRegLCDC_DMG;
+    read[REG(STAT_REG)] = GB_MemReadRegSTAT;
+    write[REG(STAT_REG)] = GB_MemWriteRegSTAT_DMG;
+    read[REG(LY_REG)] = GB_MemReadRegLY;
+    // LY is read only
+    read[REG(LYC_REG)] = GB_MemReadRegPlain;
+    write[REG(LYC_REG)] = GB_MemWriteRegLYC_DMG;
+
+    // TODO: Registers below
+
+    read[REG(SCY_REG)] = GB_MemReadRegPlain;
+    write[REG(SCY_REG)] = GB_MemWriteRegVideo;
+    read[REG(SCX_REG)] = GB_MemReadRegPlain;
+    write[REG(SCX_REG)] = GB_MemWriteRegVideo;
+    read[REG(BGP_REG)] = GB_MemReadRegPlain;
+    write[REG(BGP_REG)] = GB_MemWriteRegVideo;
+    read[REG(OBP0_REG)] = GB_MemReadRegPlain;
+    write[REG(OBP0_REG)] = GB_MemWriteRegVideo;
+    read[REG(OBP1_REG)] = GB_MemReadRegPlain;
+    write[REG(OBP1_REG)] = GB_MemWriteRegVideo;
+    read[REG(WY_REG)] = GB_MemReadRegPlain;
+    write[REG(WY_REG)] = GB_MemWriteRegVideo;
+    read[REG(WX_REG)] = GB_MemReadRegPlain;
+    write[REG(WX_REG)] = GB_MemWriteRegVideo;
+
+    // DMA. This is R/W in all GB models
+    read[REG(DMA_REG)] = GB_MemReadRegPlain;
+    write[REG(DMA_REG)] = GB_MemWriteRegDMA;
+
+    // Undocumented registers...
+    write[REG(0xFF50)] = GB_MemWriteRegFF50_DMG;
+
+    write[REG(0xFF72)] = GB_MemWriteRegPlain;
+    write[REG(0xFF73)] = GB_MemWriteRegPlain;
+    read[REG(0xFF75)] = GB_MemReadRegFF75;
+    write[REG(0xFF75)] = GB_MemWriteRegFF75;
+    read[REG(0xFF76)] = GB_MemReadRegNone;
+    read[REG(0xFF77)] = GB_MemReadRegNone;
+}
@@ -14,8 +14,9 @@ u32 GB_MemRead8_DMG_BootDisabled(u32 address);
 
 void GB_MemWrite8_DMG(u32 address, u32 value);
 
-u32 GB_MemReadReg8_DMG(u32 address);
-
-void GB_MemWriteReg8_DMG(u32 address, u32 value);
+// Fills the tables of handlers of the I/O registers (0xFF00-0xFF7F), indexed
+// by address - 0xFF00.
+void GB_MemRegTablesFill_DMG(gb_mem_read_fn_ptr *read,
+                             gb_mem_write_fn_ptr *write);
 
 #endif // GB_MEMORY_DMG__
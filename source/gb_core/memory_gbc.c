@@ -19,6 +19,8 @@
 #include "general.h"
 #include "interrupts.h"
 #include "memory.h"
+#include "memory_dmg.h"
+#include "memory_gbc.h"
 #include "ppu.h"
 #include "ppu_gbc.h"
 #include "serial.h"
@@ -28,7 +30,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
@@ -238,10 +240,13 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
                 return;
 #endif
             mem->VideoRAM_Curr[address - 0x8000] = value;
+            GB_MemDirtySet(gb_dirty_vram, (mem->VideoRAM_Curr - mem->VideoRAM)
+                                          + (address - 0x8000));
             return;
         case 0xA:
         case 0xB: // 8KB External RAM
             GameBoy.Memory.MapperWrite(address, value);
+            gb_sram_dirty = 1;
             return;
         case 0xC: // 4KB Work RAM Bank 0
             mem->WorkRAM[address - 0xC000] = value;
@@ -253,6 +258,7 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
         {
             mem->WorkRAM[address - 0xE000] = value;
             GameBoy.Memory.MapperWrite(address - 0xE000 + 0xA000, value);
+            gb_sram_dirty = 1;
             return;
         }
         case 0xF:
@@ -260,6 +266,7 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
             {
                 mem->WorkRAM_Curr[address - 0xF000] = value;
                 GameBoy.Memory.MapperWrite(address - 0xF000 + 0xB000, value);
+                gb_sram_dirty = 1;
                 return;
             }
             else if (address < 0xFEA0) // Sprite Attribute Table
@@ -270,6 +277,7 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
                     return;
 #endif
                 mem->ObjAttrMem[address - 0xFE00] = value;
+                GB_MemDirtySet(gb_dirty_oam, address - 0xFE00);
                 return;
             }
             else if (address < 0xFF00) // Not Usable
@@ -312,594 +320,360 @@ void GB_MemWrite8_GBC(u32 address, u32 value)
 
 //----------------------------------------------------------------
 
-u32 GB_MemReadReg8_GBC(u32 address)
-{
-    _GB_MEMORY_ *mem = &GameBoy.Memory;
-
-    switch (address)
-    {
-        // Serial
-        case SB_REG:
-            GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[SB_REG - 0xFF00];
-        case SC_REG:
-            GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[SC_REG - 0xFF00]
-                   | ((GameBoy.Emulator.CGBEnabled == 1) ? 0x7C : 0x7E);
-
-        // Timer
-        case TMA_REG:
-            return mem->IO_Ports[address - 0xFF00];
-        case TIMA_REG:
-            GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[TIMA_REG - 0xFF00];
-        case TAC_REG:
-            return mem->IO_Ports[TAC_REG - 0xFF00] | (0xF8);
-
-        // Divider
-        case DIV_REG:
-            GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[DIV_REG - 0xFF00];
-
-        // Interrupts
-        case IF_REG:
-            //GB_UpdateCounterToClocks(GB_CPUClockCounterGet());
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            GB_TimersUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[IF_REG - 0xFF00];
-
-        // DMA
-        case DMA_REG: // This is R/W in all GB models
-            return mem->IO_Ports[DMA_REG - 0xFF00];
-
-        // Video
-        case LCDC_REG:
-        case SCY_REG:
-        case SCX_REG:
-        case LYC_REG:
-        case BGP_REG:
-        case OBP0_REG:
-        case OBP1_REG:
-        case WY_REG:
-        case WX_REG:
-            return mem->IO_Ports[address - 0xFF00];
-
-        // GBC Registers
-        // -------------
-
-        // HDMA
-        case HDMA5_REG:
-            // This register is updated in the execution loop. The other HDMAx
-            // registers are write only
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            return mem->IO_Ports[address - 0xFF00];
-
-        // Speed switch
-        case KEY1_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            return mem->IO_Ports[KEY1_REG - 0xFF00] | 0x7E;
-
-        // Video ram bank
-        case VBK_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFE;
-            return mem->IO_Ports[VBK_REG - 0xFF00];
-
-        // Work ram bank
-        case SVBK_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            return mem->IO_Ports[SVBK_REG - 0xFF00];
-
-        // TODO
-        case BCPS_REG:
-        case OCPS_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            return mem->IO_Ports[address - 0xFF00];
-
-        case NR12_REG:
-        case NR22_REG:
-        case NR42_REG:
-        case NR43_REG:
-        case NR50_REG:
-        case NR51_REG:
-            return mem->IO_Ports[address - 0xFF00];
-
-        case STAT_REG:
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            if (GameBoy.Emulator.lcd_on)
-                return mem->IO_Ports[STAT_REG - 0xFF00] | 0x80;
-            return (mem->IO_Ports[STAT_REG - 0xFF00] | 0x80) & 0xFC;
-
-        case P1_REG:
-            //GB_SGBUpdate(GB_CPUClockCounterGet()); TODO
-
-            if (GameBoy.Emulator.SGBEnabled == 1)
-                return SGB_ReadP1();
-
-            u32 result = 0;
+// I/O registers
+//
+// Only the handlers of the registers that behave differently than in DMG are
+// here, the rest of the table is filled by GB_MemRegTablesFill_DMG().
 
-            u32 p1_reg = mem->IO_Ports[P1_REG - 0xFF00];
-            int Keys = GB_Input_Get(0);
-            if ((p1_reg & (1 << 5)) == 0) // A-B-SEL-STA
-            {
-                result |= (Keys & KEY_A) ? JOY_A : 0;
-                result |= (Keys & KEY_B) ? JOY_B : 0;
-                result |= (Keys & KEY_SELECT) ? JOY_SELECT : 0;
-                result |= (Keys & KEY_START) ? JOY_START : 0;
-            }
-            if ((p1_reg & (1 << 4)) == 0) // PAD
-            {
-                result |= (Keys & KEY_UP) ? JOY_UP : 0;
-                result |= (Keys & KEY_DOWN) ? JOY_DOWN : 0;
-                result |= (Keys & KEY_LEFT) ? JOY_LEFT : 0;
-                result |= (Keys & KEY_RIGHT) ? JOY_RIGHT : 0;
-            }
+static u32 GB_MemReadRegSC_GBC(unused__ u32 address)
+{
+    gb_idle_loop_unsafe = 1;
+    GB_SerialUpdateClocksCounterReference(GB_CPUClockCounterGet());
+    return GameBoy.Memory.IO_Ports[SC_REG - 0xFF00]
+           | ((GameBoy.Emulator.CGBEnabled == 1) ? 0x7C : 0x7E);
+}
 
-            result = (~result) & 0x0F;
-            result |= p1_reg & 0xF0;
-            result |= 0xC0;
-
-            mem->IO_Ports[P1_REG - 0xFF00] = result;
-            return result;
-
-        case NR10_REG:
-            return mem->IO_Ports[NR10_REG - 0xFF00] | 0x80;
-        case NR11_REG:
-        case NR21_REG:
-            return mem->IO_Ports[address - 0xFF00] | 0x3F;
-        case NR13_REG:
-        case NR23_REG:
-        case NR33_REG:
-            return 0xFF;
-        case NR14_REG:
-        case NR24_REG:
-        case NR34_REG:
-        case NR44_REG:
-            return mem->IO_Ports[address - 0xFF00] | 0xBF;
-        case NR30_REG:
-            return mem->IO_Ports[NR30_REG - 0xFF00] | 0x7F;
-        case NR32_REG:
-            return mem->IO_Ports[NR32_REG - 0xFF00] | 0x9F;
-        case NR31_REG:
-        case NR41_REG:
-            return 0xFF;
-        case NR52_REG:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            return mem->IO_Ports[NR52_REG - 0xFF00] | 0x70;
-
-        // Wave pattern for channel 3
-        case 0xFF30:
-        case 0xFF31:
-        case 0xFF32:
-        case 0xFF33:
-        case 0xFF34:
-        case 0xFF35:
-        case 0xFF36:
-        case 0xFF37:
-        case 0xFF38:
-        case 0xFF39:
-        case 0xFF3A:
-        case 0xFF3B:
-        case 0xFF3C:
-        case 0xFF3D:
-        case 0xFF3E:
-        case 0xFF3F:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-
-            // Is GBC mode enabled or GBC hardware?
-            //if (GameBoy.Emulator.CGBEnabled == 1)
-            //    return mem->IO_Ports[address - 0xFF00];
-            // Demotronic says that it can't be read... :S
-
-            // There are some moments when playing that the sound hardware reads
-            // from this ram and those registers read the current value being
-            // played.
-
-            if (mem->IO_Ports[NR52_REG - 0xFF00] & (1 << 2)) // If playing...
-                return 0xFF;
-            else
-                return mem->IO_Ports[address - 0xFF00];
+// HDMA5, SVBK, BCPS, OCPS and FF74
+static u32 GB_MemReadRegCGBOnly(u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFF;
+    return GameBoy.Memory.IO_Ports[address - 0xFF00];
+}
 
-        case LY_REG:
-            if (GameBoy.Emulator.lcd_on)
-            {
-                GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-                return mem->IO_Ports[LY_REG - 0xFF00];
-            }
-            else
-            {
-                return 0; // Verified on hardware (GBC and GBA SP)
-            }
+static u32 GB_MemReadRegKEY1(unused__ u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFF;
+    return GameBoy.Memory.IO_Ports[KEY1_REG - 0xFF00] | 0x7E;
+}
 
-        // GAMEBOY COLOR REGISTERS
-        // -----------------------
+static u32 GB_MemReadRegVBK(unused__ u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFE;
+    return GameBoy.Memory.IO_Ports[VBK_REG - 0xFF00];
+}
 
-        case RP_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
+static u32 GB_MemReadRegRP(unused__ u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFF;
 
-            // 0x02 = no receive signal
-            return (mem->IO_Ports[RP_REG - 0xFF00] | 0x3C) | 0x02;
+    // 0x02 = no receive signal
+    return (GameBoy.Memory.IO_Ports[RP_REG - 0xFF00] | 0x3C) | 0x02;
+}
 
-        case BCPD_REG:
-        {
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+static u32 GB_MemReadRegBCPD(unused__ u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFF;
+    GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
-            if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
-                return 0xFF;
+    if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
+        return 0xFF;
 #endif
-            u8 index = mem->IO_Ports[BCPS_REG - 0xFF00] & 0x3F;
-            return GameBoy.Emulator.bg_pal[index];
-        }
+    u8 index = GameBoy.Memory.IO_Ports[BCPS_REG - 0xFF00] & 0x3F;
+    return GameBoy.Emulator.bg_pal[index];
+}
 
-        case OCPD_REG:
-        {
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
+static u32 GB_MemReadRegOCPD(unused__ u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFF;
+    GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 #ifdef VRAM_MEM_CHECKING
-            if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
-                return 0xFF;
+    if (GameBoy.Emulator.lcd_on && GameBoy.Emulator.ScreenMode == 3)
+        return 0xFF;
 #endif
-            u8 index = mem->IO_Ports[OCPS_REG - 0xFF00] & 0x3F;
-            return GameBoy.Emulator.spr_pal[index];
-        }
-
-        // Undocumented registers...
-        case 0xFF6C:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            return mem->IO_Ports[0xFF6C - 0xFF00] | 0xFE;
-
-        case 0xFF76:
-        case 0xFF77:
-            return 0x00;
-
-        case 0xFF74:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return 0xFF;
-            return mem->IO_Ports[0xFF74 - 0xFF00];
-
-        case 0xFF75:
-            return mem->IO_Ports[0xFF75 - 0xFF00] | 0x8F;
-
-        default:
-            return 0xFF;
-    }
+    u8 index = GameBoy.Memory.IO_Ports[OCPS_REG - 0xFF00] & 0x3F;
+    return GameBoy.Emulator.spr_pal[index];
+}
 
-    return 0xFF;
+static u32 GB_MemReadRegFF6C(unused__ u32 address)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return 0xFF;
+    return GameBoy.Memory.IO_Ports[0xFF6C - 0xFF00] | 0xFE;
 }
 
 //----------------------------------------------------------------
 
-void GB_MemWriteReg8_GBC(u32 address, u32 value)
+static void GB_MemWriteRegLYC_GBC(unused__ u32 address, u32 value)
 {
-    _GB_MEMORY_ *mem = &GameBoy.Memory;
-
-    switch (address)
-    {
-        // Serial
-        case SB_REG:
-            GB_SerialWriteSB(GB_CPUClockCounterGet(), value);
-            return;
-        case SC_REG:
-            GB_SerialWriteSC(GB_CPUClockCounterGet(), value);
-            return;
-
-        // Timer
-        case TIMA_REG:
-            GB_TimersWriteTIMA(GB_CPUClockCounterGet(), value);
-            return;
-        case TMA_REG:
-            GB_TimersWriteTMA(GB_CPUClockCounterGet(), value);
-            return;
-        case TAC_REG:
-            GB_TimersWriteTAC(GB_CPUClockCounterGet(), value);
-            return;
-
-        // Divider
-        case DIV_REG:
-            GB_TimersWriteDIV(GB_CPUClockCounterGet(), value);
-            return;
+    GB_PPUWriteLYC_GBC(GB_CPUClockCounterGet(), value);
+}
 
-        // Interrupts
-        case IF_REG:
-            GB_InterruptsWriteIF(GB_CPUClockCounterGet(), value);
-            return;
+static void GB_MemWriteRegLCDC_GBC(unused__ u32 address, u32 value)
+{
+    GB_PPUWriteLCDC_GBC(GB_CPUClockCounterGet(), value);
+}
 
-        // DMA
-        case DMA_REG:
-            GB_DMAWriteDMA(GB_CPUClockCounterGet(), value);
-            return;
+static void GB_MemWriteRegSTAT_GBC(unused__ u32 address, u32 value)
+{
+    GB_PPUWriteSTAT_GBC(GB_CPUClockCounterGet(), value);
+}
 
-        // Video
-        case LY_REG: // Read only
-            return;
-        case LYC_REG:
-            GB_PPUWriteLYC_GBC(GB_CPUClockCounterGet(), value);
-            return;
-        case LCDC_REG:
-            GB_PPUWriteLCDC_GBC(GB_CPUClockCounterGet(), value);
-            return;
-        case STAT_REG:
-            GB_PPUWriteSTAT_GBC(GB_CPUClockCounterGet(), value);
-            return;
+static void GB_MemWriteRegP1_GBC(unused__ u32 address, u32 value)
+{
+    GameBoy.Memory.IO_Ports[P1_REG - 0xFF00] = value & 0x30;
+    // Writing to this register can trigger the joypad interrupt
+    GB_CheckJoypadInterrupt();
+}
 
-        // Joypad
-        case P1_REG:
-            mem->IO_Ports[P1_REG - 0xFF00] = value & 0x30;
-            // Writing to this register can trigger the joypad interrupt
-            GB_CheckJoypadInterrupt();
-            return;
+// GDMA/HDMA
+static void GB_MemWriteRegHDMA1(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_DMAWriteHDMA1(value);
+}
 
-        // GBC Registers
-        // -------------
+static void GB_MemWriteRegHDMA2(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_DMAWriteHDMA2(value);
+}
 
-        // GDMA/HDMA
-        case HDMA1_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_DMAWriteHDMA1(value);
-            return;
-        case HDMA2_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_DMAWriteHDMA2(value);
-            return;
-        case HDMA3_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_DMAWriteHDMA3(value);
-            return;
-        case HDMA4_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_DMAWriteHDMA4(value);
-            return;
-        case HDMA5_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_DMAWriteHDMA5(value);
-            return;
+static void GB_MemWriteRegHDMA3(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_DMAWriteHDMA3(value);
+}
 
-        // Speed switch
-        case KEY1_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            mem->IO_Ports[KEY1_REG - 0xFF00] &= 0xFE;
-            mem->IO_Ports[KEY1_REG - 0xFF00] |= value & 1;
-            return;
+static void GB_MemWriteRegHDMA4(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_DMAWriteHDMA4(value);
+}
 
-        // Work ram bank
-        case SVBK_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_MemoryWriteSVBK(value);
-            return;
+static void GB_MemWriteRegHDMA5(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_DMAWriteHDMA5(value);
+}
 
-        // Video ram bank
-        case VBK_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            GB_MemoryWriteVBK(value);
-            return;
+static void GB_MemWriteRegKEY1(unused__ u32 address, u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-        // TODO: Registers below
-
-        case SCY_REG:
-        case SCX_REG:
-        case BGP_REG:
-        case OBP0_REG:
-        case OBP1_REG:
-        case WY_REG:
-        case WX_REG:
-            GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            mem->IO_Ports[address - 0xFF00] = value;
-            return;
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    mem->IO_Ports[KEY1_REG - 0xFF00] &= 0xFE;
+    mem->IO_Ports[KEY1_REG - 0xFF00] |= value & 1;
+}
 
-        // Sound
-        case NR10_REG:
-        case NR11_REG:
-        case NR12_REG:
-        case NR13_REG:
-        case NR14_REG:
-        case NR21_REG:
-        case NR22_REG:
-        case NR23_REG:
-        case NR24_REG:
-        case NR30_REG:
-        case NR31_REG:
-        case NR32_REG:
-        case NR33_REG:
-        case NR34_REG:
-        case NR41_REG:
-        case NR42_REG:
-        case NR43_REG:
-        case NR44_REG:
-        case NR50_REG:
-        case NR51_REG:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            mem->IO_Ports[address - 0xFF00] = value;
-            GB_SoundRegWrite(address, value);
-            return;
-        case NR52_REG:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            mem->IO_Ports[NR52_REG - 0xFF00] &= 0x0F; // Status flags
-            mem->IO_Ports[NR52_REG - 0xFF00] |= (value & 0xF0);
-            GB_SoundRegWrite(address, value);
-            return;
+static void GB_MemWriteRegSVBK(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_MemoryWriteSVBK(value);
+}
 
-        // Wave for channel 3
-        case 0xFF30:
-        case 0xFF31:
-        case 0xFF32:
-        case 0xFF33:
-        case 0xFF34:
-        case 0xFF35:
-        case 0xFF36:
-        case 0xFF37:
-        case 0xFF38:
-        case 0xFF39:
-        case 0xFF3A:
-        case 0xFF3B:
-        case 0xFF3C:
-        case 0xFF3D:
-        case 0xFF3E:
-        case 0xFF3F:
-            GB_SoundUpdateClocksCounterReference(GB_CPUClockCounterGet());
-            // If not playing, allow the write
-            if ((mem->IO_Ports[NR52_REG - 0xFF00] & (1 << 2)) == 0)
-                mem->IO_Ports[address - 0xFF00] = value;
-            return;
+static void GB_MemWriteRegVBK(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    GB_MemoryWriteVBK(value);
+}
 
-        // GAMEBOY COLOR REGISTERS
-        // -----------------------
+// BCPS and OCPS
+static void GB_MemWriteRegPalIndex(u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
 
-        // PALETTES
-        case BCPS_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+    GameBoy.Memory.IO_Ports[address - 0xFF00] = value | (1 << 6);
+}
 
-            mem->IO_Ports[BCPS_REG - 0xFF00] = value | (1 << 6);
-            return;
+static void GB_MemWriteRegBCPD(unused__ u32 address, u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-        case BCPD_REG:
-        {
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
 #ifdef VRAM_MEM_CHECKING
-            if (GameBoy.Emulator.ScreenMode == 3 && GameBoy.Emulator.lcd_on)
-                return;
+    if (GameBoy.Emulator.ScreenMode == 3 && GameBoy.Emulator.lcd_on)
+        return;
 #endif
-            u8 index = mem->IO_Ports[BCPS_REG - 0xFF00] & 0x3F;
-            GameBoy.Emulator.bg_pal[index] = value;
-            mem->IO_Ports[BCPD_REG - 0xFF00] = value;
-
-            if (mem->IO_Ports[BCPS_REG - 0xFF00] & (1 << 7))
-            {
-                u32 index = (mem->IO_Ports[BCPS_REG - 0xFF00] + 1) & 0x3F;
-                index |= (mem->IO_Ports[BCPS_REG - 0xFF00] & (1 << 7))
-                         | (1 << 6);
-                mem->IO_Ports[BCPS_REG - 0xFF00] = index;
-            }
-            return;
-        }
+    u8 index = mem->IO_Ports[BCPS_REG - 0xFF00] & 0x3F;
+    GameBoy.Emulator.bg_pal[index] = value;
+    GBC_PaletteColorUpdate(index);
+    GB_MemDirtySet(gb_dirty_pal, index);
+    mem->IO_Ports[BCPD_REG - 0xFF00] = value;
 
-        case OCPS_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+    if (mem->IO_Ports[BCPS_REG - 0xFF00] & (1 << 7))
+    {
+        u32 index = (mem->IO_Ports[BCPS_REG - 0xFF00] + 1) & 0x3F;
+        index |= (mem->IO_Ports[BCPS_REG - 0xFF00] & (1 << 7)) | (1 << 6);
+        mem->IO_Ports[BCPS_REG - 0xFF00] = index;
+    }
+}
 
-            mem->IO_Ports[OCPS_REG - 0xFF00] = value | (1 << 6);
-            return;
+static void GB_MemWriteRegOCPD(unused__ u32 address, u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-        case OCPD_REG:
-        {
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
 #ifdef VRAM_MEM_CHECKING
-            if (GameBoy.Emulator.ScreenMode == 3 && GameBoy.Emulator.lcd_on)
-                return;
+    if (GameBoy.Emulator.ScreenMode == 3 && GameBoy.Emulator.lcd_on)
+        return;
 #endif
-            u8 index = mem->IO_Ports[OCPS_REG - 0xFF00] & 0x3F;
-            GameBoy.Emulator.spr_pal[index] = value;
-            mem->IO_Ports[OCPD_REG - 0xFF00] = value;
-
-            if (mem->IO_Ports[OCPS_REG - 0xFF00] & (1 << 7))
-            {
-                u32 index = (mem->IO_Ports[OCPS_REG - 0xFF00] + 1) & 0x3F;
-                index |= (mem->IO_Ports[OCPS_REG - 0xFF00] & (1 << 7))
-                         | (1 << 6);
-                mem->IO_Ports[OCPS_REG - 0xFF00] = index;
-            }
-            return;
-        }
+    u8 index = mem->IO_Ports[OCPS_REG - 0xFF00] & 0x3F;
+    GameBoy.Emulator.spr_pal[index] = value;
+    GBC_PaletteColorUpdate(index);
+    GB_MemDirtySet(gb_dirty_pal, 64 + index);
+    mem->IO_Ports[OCPD_REG - 0xFF00] = value;
 
-        case RP_REG:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+    if (mem->IO_Ports[OCPS_REG - 0xFF00] & (1 << 7))
+    {
+        u32 index = (mem->IO_Ports[OCPS_REG - 0xFF00] + 1) & 0x3F;
+        index |= (mem->IO_Ports[OCPS_REG - 0xFF00] & (1 << 7)) | (1 << 6);
+        mem->IO_Ports[OCPS_REG - 0xFF00] = index;
+    }
+}
 
-            mem->IO_Ports[RP_REG - 0xFF00] |= 0x3C;
-            return;
+static void GB_MemWriteRegRP(unused__ u32 address, unused__ u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
 
-        // Undocumented registers...
+    GameBoy.Memory.IO_Ports[RP_REG - 0xFF00] |= 0x3C;
+}
 
-        // Writes done by the boot ROM:
-        //
-        // CGB ROM: [FF50]=11
-        //  GB game:     [FF6C]=FE, [FF4C]=04, [FF6C]=01
-        //  GB+GBC game: [FF6C]=FE, [FF4C]=80
-        //  GBC game:    [FF6C]=FE, [FF4C]=C0
+// Undocumented registers...
 
-        // Change to DMG mode is done when disabling boot ROM (?)
+// Writes done by the boot ROM:
+//
+// CGB ROM: [FF50]=11
+//  GB game:     [FF6C]=FE, [FF4C]=04, [FF6C]=01
+//  GB+GBC game: [FF6C]=FE, [FF4C]=80
+//  GBC game:    [FF6C]=FE, [FF4C]=C0
 
-        case 0xFF4C: // Change to GB mode ?
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
-            // 80h/C0h is writen here if gbc features (bit 7 = gbc mode?)
-            // 04h is writen if no gbc features (bit 3 = gb mode?)
+// Change to DMG mode is done when disabling boot ROM (?)
 
-            //if (value & 0x80) // GBC mode
-            //if (value & 0x04) // GB mode
-            return;
-        case 0xFF6C: // Lock/unlock gbc palettes?
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+static void GB_MemWriteRegFF4C(unused__ u32 address, unused__ u32 value)
+{
+    // Change to GB mode ?
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
+    // 80h/C0h is writen here if gbc features (bit 7 = gbc mode?)
+    // 04h is writen if no gbc features (bit 3 = gb mode?)
+
+    //if (value & 0x80) // GBC mode
+    //if (value & 0x04) // GB mode
+}
 
-            mem->IO_Ports[0xFF6C - 0xFF00] = value | 0xFE;
-            return;
-        case 0xFF74:
-            if (GameBoy.Emulator.CGBEnabled == 0)
-                return;
+static void GB_MemWriteRegFF6C(unused__ u32 address, u32 value)
+{
+    // Lock/unlock gbc palettes?
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
 
-            mem->IO_Ports[0xFF74 - 0xFF00] = value;
-            return;
+    GameBoy.Memory.IO_Ports[0xFF6C - 0xFF00] = value | 0xFE;
+}
 
-        case 0xFF50: // Disable boot rom
-            if (GameBoy.Emulator.enable_boot_rom)
-            {
-                //if (value == 1) // DMG or SGB
-                //if (value == 0xFF) // MGB
+static void GB_MemWriteRegFF74(unused__ u32 address, u32 value)
+{
+    if (GameBoy.Emulator.CGBEnabled == 0)
+        return;
 
-                GameBoy.Emulator.enable_boot_rom = 0;
+    GameBoy.Memory.IO_Ports[0xFF74 - 0xFF00] = value;
+}
 
-                if (GameBoy.Emulator.CGBEnabled
-                    && (mem->IO_Ports[0xFF6C - 0xFF00] & 1))
-                {
-                    //if (value == 0x11) // CGB
+static void GB_MemWriteRegFF50_GBC(unused__ u32 address, unused__ u32 value)
+{
+    // Disable boot rom
+    if (GameBoy.Emulator.enable_boot_rom)
+    {
+        //if (value == 1) // DMG or SGB
+        //if (value == 0xFF) // MGB
 
-                    GameBoy.Emulator.CGBEnabled = 0;
-                    GameBoy.Emulator.gbc_in_gb_mode = 1;
-                    GameBoy.Emulator.DrawScanlineFn =
-                            &GBC_GB_ScreenDrawScanline;
-                }
+        GameBoy.Emulator.enable_boot_rom = 0;
 
-                GB_MemUpdateReadWriteFunctionPointers();
+        if (GameBoy.Emulator.CGBEnabled
+            && (GameBoy.Memory.IO_Ports[0xFF6C - 0xFF00] & 1))
+        {
+            //if (value == 0x11) // CGB
 
-                GB_CPUBreakLoop();
-            }
-            return;
+            GameBoy.Emulator.CGBEnabled = 0;
+            GameBoy.Emulator.gbc_in_gb_mode = 1;
+            GameBoy.Emulator.DrawScanlineFn = &GBC_GB_ScreenDrawScanline;
+        }
 
-        case 0xFF76:
-        case 0xFF77:
-            return;
-        case 0xFF72:
-            mem->IO_Ports[0xFF72 - 0xFF00] = value;
-            return;
-        case 0xFF73:
-            mem->IO_Ports[0xFF73 - 0xFF00] = value;
-            return;
-        case 0xFF75:
-            mem->IO_Ports[0xFF75 - 0xFF00] = value | 0x8F;
-            return;
+        GB_MemUpdateReadWriteFunctionPointers();
 
-        default:
-            return;
+        GB_CPUBreakLoop(PROFILE_SLICE_IO);
     }
 }
+
+//----------------------------------------------------------------
+
+#define REG(address)    ((address) - 0xFF00)
+
+void GB_MemRegTablesFill_GBC(gb_mem_read_fn_ptr *read,
+                             gb_mem_write_fn_ptr *write)
+{
+    GB_MemRegTablesFill_DMG(read, write);
+
+    read[REG(SC_REG)] = GB_MemReadRegSC_GBC;
+
+    // Video
+    write[REG(LYC_REG)] = GB_MemWriteRegLYC_GBC;
+    write[REG(LCDC_REG)] = GB_MemWriteRegLCDC_GBC;
+    write[REG(STAT_REG)] = GB_MemWriteRegSTAT_GBC;
+
+    // Joypad
+    write[REG(P1_REG)] = GB_MemWriteRegP1_GBC;
+
+    // GBC Registers
+    // -------------
+
+    // HDMA. HDMA5 is updated in the execution loop. The other HDMAx registers
+    // are write only
+    read[REG(HDMA5_REG)] = GB_MemReadRegCGBOnly;
+    write[REG(HDMA1_REG)] = GB_MemWriteRegHDMA1;
+    write[REG(HDMA2_REG)] = GB_MemWriteRegHDMA2;
+    write[REG(HDMA3_REG)] = GB_MemWriteRegHDMA3;
+    write[REG(HDMA4_REG)] = GB_MemWriteRegHDMA4;
+    write[REG(HDMA5_REG)] = GB_MemWriteRegHDMA5;
+
+    // Speed switch
+    read[REG(KEY1_REG)] = GB_MemReadRegKEY1;
+    write[REG(KEY1_REG)] = GB_MemWriteRegKEY1;
+
+    // Video ram bank
+    read[REG(VBK_REG)] = GB_MemReadRegVBK;
+    write[REG(VBK_REG)] = GB_MemWriteRegVBK;
+
+    // Work ram bank
+    read[REG(SVBK_REG)] = GB_MemReadRegCGBOnly;
+    write[REG(SVBK_REG)] = GB_MemWriteRegSVBK;
+
+    // Palettes
+    read[REG(BCPS_REG)] = GB_MemReadRegCGBOnly;
+    write[REG(BCPS_REG)] = GB_MemWriteRegPalIndex;
+    read[REG(BCPD_REG)] = GB_MemReadRegBCPD;
+    write[REG(BCPD_REG)] = GB_MemWriteRegBCPD;
+    read[REG(OCPS_REG)] = GB_MemReadRegCGBOnly;
+    write[REG(OCPS_REG)] = GB_MemWriteRegPalIndex;
+    read[REG(OCPD_REG)] = GB_MemReadRegOCPD;
+    write[REG(OCPD_REG)] = GB_MemWriteRegOCPD;
+
+    // Infrared port
+    read[REG(RP_REG)] = GB_MemReadRegRP;
+    write[REG(RP_REG)] = GB_MemWriteRegRP;
+
+    // Undocumented registers...
+    write[REG(0xFF4C)] = GB_MemWriteRegFF4C;
+    write[REG(0xFF50)] = GB_MemWriteRegFF50_GBC;
+    read[REG(0xFF6C)] = GB_MemReadRegFF6C;
+    write[REG(0xFF6C)] = GB_MemWriteRegFF6C;
+    read[REG(0xFF74)] = GB_MemReadRegCGBOnly;
+    write[REG(0xFF74)] = GB_MemWriteRegFF74;
+}
@@ -21,7 +21,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
@@ -192,7 +192,7 @@ void GB_PPUEnd(void)
 
 //----------------------------------------------------------------
 
-static int gb_ppu_clock_counter = 0;
+static core_local__ int gb_ppu_clock_counter = 0;
 
 void GB_PPUClockCounterReset(void)
 {
@@ -219,6 +219,7 @@ void GB_PPUUpdateClocksCounterReference(int reference_clocks)
     }
 
     GB_PPUClockCounterSet(reference_clocks);
+    GB_CPUEventSourceUpdated(GB_EVENT_PPU, reference_clocks);
 }
 
 int GB_PPUGetClocksToNextEvent(void)
@@ -226,6 +227,39 @@ int GB_PPUGetClocksToNextEvent(void)
     return GameBoy.Emulator.PPUClocksToNextEvent();
 }
 
+int GB_PPUGetClocksToNextModeChange(void)
+{
+    if (GameBoy.Emulator.lcd_on == 0)
+        return 0x7FFFFFFF;
+
+    // This is valid for DMG and GBC. DoubleSpeed is always 0 in DMG mode.
+    int ds = GameBoy.Emulator.DoubleSpeed;
+    int limit;
+
+    switch (GameBoy.Emulator.ScreenMode)
+    {
+        case 2:
+            limit = 82 << ds;
+            break;
+        case 3:
+            limit = 252 << ds;
+            break;
+        case 0:
+            if (GameBoy.Emulator.ly_drawn == 0)
+                limit = 4;
+            else
+                limit = 456 << ds;
+            break;
+        case 1:
+            limit = 456 << ds;
+            break;
+        default:
+            return 0x7FFFFFFF;
+    }
+
+    return limit - GameBoy.Emulator.ly_clocks;
+}
+
 //----------------------------------------------------------------
 
 void GB_PPUCheckStatSignal(void)
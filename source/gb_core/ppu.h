@@ -14,6 +14,10 @@ void GB_PPUClockCounterReset(void);
 void GB_PPUUpdateClocksCounterReference(int reference_clocks);
 int GB_PPUGetClocksToNextEvent(void);
 
+// Exact clocks left until the mode or the line changes. This has to match the
+// limits used by GB_PPUUpdateClocks_DMG() and GB_PPUUpdateClocks_GBC().
+int GB_PPUGetClocksToNextModeChange(void);
+
 void GB_PPUCheckStatSignal(void);
 void GB_PPUCheckLYC(void);
 
@@ -18,7 +18,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
@@ -31,7 +31,7 @@ void GB_PPUWriteLYC_DMG(int reference_clocks, int value)
     {
         GB_PPUCheckLYC();
         GB_PPUCheckStatSignal();
-        GB_CPUBreakLoop();
+        GB_CPUBreakLoop(PROFILE_SLICE_PPU);
     }
 }
 
@@ -69,7 +69,7 @@ void GB_PPUWriteLCDC_DMG(int reference_clocks, int value)
 
     mem->IO_Ports[LCDC_REG - 0xFF00] = value;
 
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_PPU);
 }
 
 void GB_PPUWriteSTAT_DMG(unused__ int reference_clocks, int value)
@@ -78,7 +78,7 @@ void GB_PPUWriteSTAT_DMG(unused__ int reference_clocks, int value)
 
     GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_PPU);
 
     mem->IO_Ports[STAT_REG - 0xFF00] &= 0x07;
     mem->IO_Ports[STAT_REG - 0xFF00] |= value & 0xF8;
@@ -267,11 +267,13 @@ int GB_PPUGetClocksToNextEvent_DMG(void)
                 clocks_to_next_event = 82 - GameBoy.Emulator.ly_clocks;
                 break;
             case 3:
-                clocks_to_next_event = 4;
+                clocks_to_next_event = 252 - GameBoy.Emulator.ly_clocks;
                 break;
             case 0:
-                clocks_to_next_event = 4;
-                //clocks_to_next_event = 456 - GameBoy.Emulator.ly_clocks;
+                if (GameBoy.Emulator.ly_drawn == 0)
+                    clocks_to_next_event = 4 - GameBoy.Emulator.ly_clocks;
+                else
+                    clocks_to_next_event = 456 - GameBoy.Emulator.ly_clocks;
                 break;
             case 1:
                 clocks_to_next_event = 456 - GameBoy.Emulator.ly_clocks;
@@ -18,7 +18,7 @@
 
 //----------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //----------------------------------------------------------------
 
@@ -30,7 +30,7 @@ void GB_PPUWriteLYC_GBC(int reference_clocks, int value)
     {
         GB_PPUCheckLYC();
         GB_PPUCheckStatSignal();
-        GB_CPUBreakLoop();
+        GB_CPUBreakLoop(PROFILE_SLICE_PPU);
     }
 }
 
@@ -68,7 +68,7 @@ void GB_PPUWriteLCDC_GBC(int reference_clocks, int value)
 
     mem->IO_Ports[LCDC_REG - 0xFF00] = value;
 
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_PPU);
 }
 
 void GB_PPUWriteSTAT_GBC(unused__ int reference_clocks, int value)
@@ -77,7 +77,7 @@ void GB_PPUWriteSTAT_GBC(unused__ int reference_clocks, int value)
 
     GB_PPUUpdateClocksCounterReference(GB_CPUClockCounterGet());
 
-    GB_CPUBreakLoop();
+    GB_CPUBreakLoop(PROFILE_SLICE_PPU);
 
     mem->IO_Ports[STAT_REG - 0xFF00] &= 0x07;
     mem->IO_Ports[STAT_REG - 0xFF00] |= value & 0xF8;
@@ -247,12 +247,19 @@ int GB_PPUGetClocksToNextEvent_GBC(void)
                                        - GameBoy.Emulator.ly_clocks;
                 break;
             case 3:
-                clocks_to_next_event = 4;
+                clocks_to_next_event = (252 << GameBoy.Emulator.DoubleSpeed)
+                                       - GameBoy.Emulator.ly_clocks;
                 break;
             case 0:
-                clocks_to_next_event = 4;
-                //clocks_to_next_event = (456 << GameBoy.Emulator.DoubleSpeed)
-                //                     - GameBoy.Emulator.ly_clocks;
+                if (GameBoy.Emulator.ly_drawn == 0)
+                {
+                    clocks_to_next_event = 4 - GameBoy.Emulator.ly_clocks;
+                }
+                else
+                {
+                    clocks_to_next_event = (456 << GameBoy.Emulator.DoubleSpeed)
+                                           - GameBoy.Emulator.ly_clocks;
+                }
                 break;
             case 1:
                 clocks_to_next_event = (456 << GameBoy.Emulator.DoubleSpeed)
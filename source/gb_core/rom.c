@@ -11,6 +11,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "../autosave_utils.h"
 #include "../build_options.h"
 #include "../config.h"
 #include "../debug_utils.h"
@@ -21,8 +22,10 @@
 #include "gameboy.h"
 #include "gb_main.h"
 #include "general.h"
+#include "interrupts.h"
 #include "licensees.h"
 #include "mbc.h"
+#include "memory.h"
 #include "rom.h"
 #include "video.h"
 
@@ -116,9 +119,9 @@ static const u8 gb_nintendo_logo[48] = {
     0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E
 };
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
-static int showconsole = 0;
+static core_local__ int showconsole = 0;
 
 int GB_ShowConsoleRequested(void)
 {
@@ -729,52 +732,57 @@ void GB_Cardridge_Set_Filename(char *filename)
 
 //--------------------------------------------------------------------------
 
-void GB_RTC_Save(FILE *savefile)
+#define GB_RTC_SAVE_SIZE    (12 * 4)
+
+static core_local__ u64 gb_rtc_fixed_time; // 0 = Use the clock of the host
+
+void GB_RTC_SetFixedTime(u64 timestamp)
 {
-    if (GameBoy.Emulator.HasTimer == 0)
-        return;
+    gb_rtc_fixed_time = timestamp;
+}
 
-    time_t current_time = time(NULL);
+static u64 GB_RTC_GetTime(void)
+{
+    if (gb_rtc_fixed_time != 0)
+        return gb_rtc_fixed_time;
 
-    int error = 0;
+    return (u64)time(NULL);
+}
+
+// Writes the RTC data of the save file to a buffer of GB_RTC_SAVE_SIZE bytes
+static void GB_RTC_Save(u8 *data)
+{
+    time_t current_time = GB_RTC_GetTime();
+
+    GB_RTCUpdate();
 
     // Time
 
-    if (fwrite(&GameBoy.Emulator.Timer.sec, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.Timer.min, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.Timer.hour, 1, 4, savefile) != 4)
-        error = 1;
+    memcpy(&data[0], &GameBoy.Emulator.Timer.sec, 4);
+    memcpy(&data[4], &GameBoy.Emulator.Timer.min, 4);
+    memcpy(&data[8], &GameBoy.Emulator.Timer.hour, 4);
 
     u32 days_low = GameBoy.Emulator.Timer.days & 0xFF;
     u32 days_hi = (GameBoy.Emulator.Timer.days >> 8)
                   | (GameBoy.Emulator.Timer.halt << 6)
                   | (GameBoy.Emulator.Timer.carry << 7);
 
-    if (fwrite(&days_low, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&days_hi, 1, 4, savefile) != 4)
-        error = 1;
+    memcpy(&data[12], &days_low, 4);
+    memcpy(&data[16], &days_hi, 4);
 
     // Latched time
 
-    if (fwrite(&GameBoy.Emulator.LatchedTime.sec, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.LatchedTime.min, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&GameBoy.Emulator.LatchedTime.hour, 1, 4, savefile) != 4)
-        error = 1;
+    memcpy(&data[20], &GameBoy.Emulator.LatchedTime.sec, 4);
+    memcpy(&data[24], &GameBoy.Emulator.LatchedTime.min, 4);
+    memcpy(&data[28], &GameBoy.Emulator.LatchedTime.hour, 4);
 
     days_low = GameBoy.Emulator.LatchedTime.days & 0xFF;
     days_hi = (GameBoy.Emulator.LatchedTime.days >> 8)
               | (GameBoy.Emulator.LatchedTime.halt << 6)
               | (GameBoy.Emulator.LatchedTime.carry << 7);
 
-    if (fwrite(&days_low, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&days_hi, 1, 4, savefile) != 4)
-        error = 1;
+    memcpy(&data[32], &days_low, 4);
+    memcpy(&data[36], &days_hi, 4);
 
     // Timestamp
 
@@ -798,13 +806,8 @@ void GB_RTC_Save(FILE *savefile)
         timestamp_hi = (current_time >> 32); // TODO: Remove warning?
     }
 
-    if (fwrite(&timestamp_low, 1, 4, savefile) != 4)
-        error = 1;
-    if (fwrite(&timestamp_hi, 1, 4, savefile) != 4)
-        error = 1;
-
-    if (error)
-        Debug_ErrorMsgArg("Error while saving RTC data!");
+    memcpy(&data[40], &timestamp_low, 4);
+    memcpy(&data[44], &timestamp_hi, 4);
 }
 
 void GB_RTC_Load(FILE *savefile)
@@ -812,7 +815,7 @@ void GB_RTC_Load(FILE *savefile)
     if (GameBoy.Emulator.HasTimer == 0)
         return;
 
-    u64 current_time = (u64)time(NULL);
+    u64 current_time = GB_RTC_GetTime();
     u64 old_time;
 
     ConsolePrint("Loading RTC data... ");
@@ -874,90 +877,64 @@ void GB_RTC_Load(FILE *savefile)
         old_time = current_time;
     }
 
-    if (GameBoy.Emulator.Timer.halt == 1)
-        return; // Nothing else to do...
-
-    u64 delta_time = current_time - old_time;
-
-    GameBoy.Emulator.Timer.sec += delta_time % 60;
-    if (GameBoy.Emulator.Timer.sec > 59)
-    {
-        GameBoy.Emulator.Timer.sec -= 60;
-        delta_time += 60;
-    }
-
-    GameBoy.Emulator.Timer.min += (delta_time / 60) % 60;
-    if (GameBoy.Emulator.Timer.min > 59)
-    {
-        GameBoy.Emulator.Timer.min -= 60;
-        delta_time += 3600;
-    }
-
-    GameBoy.Emulator.Timer.hour += (delta_time / 3600) % 24;
-    if (GameBoy.Emulator.Timer.hour > 23)
-    {
-        GameBoy.Emulator.Timer.hour -= 24;
-        delta_time += 3600 * 24;
-    }
-
-    GameBoy.Emulator.Timer.days += delta_time / (3600 * 24);
-    while (GameBoy.Emulator.Timer.days > 511)
-    {
-        GameBoy.Emulator.Timer.days &= 511;
-        GameBoy.Emulator.Timer.carry = 1;
-    }
+    // The file may have been saved later than the current time if it is fixed
+    if (current_time > old_time)
+        GB_RTCAdvance(current_time - old_time);
 
     ConsolePrint("Done!\n");
 }
 
 //--------------------------------------------------------------------------
 
+// The file is written by the autosave thread, so this doesn't have to wait for
+// the disk and the old file is only replaced once the new one is complete.
 void GB_SRAM_Save(void)
 {
     if ((GameBoy.Emulator.RAM_Banks == 0) || (GameBoy.Emulator.HasBattery == 0))
         return;
 
-    int size = strlen(GameBoy.Emulator.save_filename) + 5;
-    char *name = malloc(size);
-    snprintf(name, size, "%s.sav", GameBoy.Emulator.save_filename);
+    size_t ram_size;
+    if (GameBoy.Emulator.MemoryController == MEM_MBC2)
+        ram_size = 512; // 512 * 4 bits
+    else
+        ram_size = GameBoy.Emulator.RAM_Banks * 8 * 1024; // Complete banks
+
+    size_t size = ram_size;
+    if (GameBoy.Emulator.HasTimer)
+        size += GB_RTC_SAVE_SIZE;
 
-    FILE *savefile = fopen(name, "wb+");
+    char name[MAX_PATHLEN];
+    snprintf(name, sizeof(name), "%s.sav", GameBoy.Emulator.save_filename);
 
-    if (!savefile)
+    u8 *data = Autosave_Begin(name, size);
+    if (data == NULL)
     {
         Debug_ErrorMsgArg("Couldn't save SRAM.");
-        free(name);
         return;
     }
 
     if (GameBoy.Emulator.MemoryController == MEM_MBC2)
     {
-        // 512 * 4 bits
-        int n = fwrite(GameBoy.Memory.ExternRAM[0], 1, 512, savefile);
-        if (n != 512)
-            Debug_ErrorMsgArg("Error while writing SRAM: %d bytes written.", n);
+        memcpy(data, GameBoy.Memory.ExternRAM[0], 512);
     }
-    //else if (((_GB_ROM_HEADER_ *)GameBoy.Emulator.Rom_Pointer)->ram_size == 1)
-    //{
-    //    // 2 KB
-    //    fwrite(GameBoy.Memory.ExternRAM[0], 1, 2 * 1024, savefile);
-    //}
     else
     {
-        // Complete banks
         for (int a = 0; a < GameBoy.Emulator.RAM_Banks; a++)
-        {
-            int n = fwrite(GameBoy.Memory.ExternRAM[a], 1, 8 * 1024, savefile);
-            if (n != (8 * 1024))
-                Debug_ErrorMsgArg("Error while writing SRAM bank %d: %d bytes written",
-                                  a, n);
-        }
+            memcpy(&data[a * 8 * 1024], GameBoy.Memory.ExternRAM[a], 8 * 1024);
     }
 
-    GB_RTC_Save(savefile);
+    if (GameBoy.Emulator.HasTimer)
+        GB_RTC_Save(&data[ram_size]);
 
-    fclose(savefile);
-    free(name);
+    Autosave_Commit();
+
+    gb_sram_dirty = 0;
+}
+
+void GB_SRAM_Autosave(void)
+{
+    if (gb_sram_dirty)
+        GB_SRAM_Save();
 }
 
 void GB_SRAM_Load(void)
@@ -965,6 +942,11 @@ void GB_SRAM_Load(void)
     if ((GameBoy.Emulator.RAM_Banks == 0) || (GameBoy.Emulator.HasBattery == 0))
         return;
 
+    // An older version of the file may still be waiting to be written
+    Autosave_Flush();
+
+    gb_sram_dirty = 0;
+
     // Reset cartridge RAM in case there is no SAV
     for (int i = 0; i < GameBoy.Emulator.RAM_Banks; i++)
     {
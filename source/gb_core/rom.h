@@ -68,4 +68,7 @@ void GB_Cardridge_Set_Filename(char *filename);
 void GB_SRAM_Save(void);
 void GB_SRAM_Load(void);
 
+// Writes the save file only if the cartridge RAM has changed since last time
+void GB_SRAM_Autosave(void);
+
 #endif // GB_ROM__
@@ -15,6 +15,7 @@
 #include "../debug_utils.h"
 #include "../file_utils.h"
 #include "../general_utils.h"
+#include "../link_utils.h"
 #include "../png_utils.h"
 
 #include "cpu.h"
@@ -24,7 +25,7 @@
 #include "interrupts.h"
 #include "serial.h"
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -45,13 +46,60 @@ static void GB_SerialSendBit(void)
         mem->IO_Ports[SC_REG - 0xFF00] &= ~0x80;
         mem->IO_Ports[SB_REG - 0xFF00] = GameBoy.Emulator.SerialRecv_Fn();
 
-        GB_CPUBreakLoop();
+        GB_CPUBreakLoop(PROFILE_SLICE_SERIAL);
     }
 }
 
+// All the devices exchange full bytes, nothing happens in the middle of a
+// transfer. The clock signal isn't emulated edge by edge, the number of times
+// it flips is used to advance the transfer, and the CPU only has to stop at the
+// end of it.
+
+// Number of flips of the clock signal left until the end of the transfer
+static int GB_SerialClockFlipsLeft(void)
+{
+    int bits_left = 8 - (GameBoy.Emulator.serial_transfered_bits & 7);
+
+    // Each bit is sent in a falling edge, so it needs two flips, but the first
+    // one is already done if the signal is high.
+    return (bits_left * 2) - GameBoy.Emulator.serial_clock_signal;
+}
+
+static void GB_SerialClockFlip(int flips)
+{
+    int signal = GameBoy.Emulator.serial_clock_signal;
+
+    if (flips < GB_SerialClockFlipsLeft())
+    {
+        GameBoy.Emulator.serial_transfered_bits += (flips + signal) >> 1;
+        GameBoy.Emulator.serial_clock_signal = signal ^ (flips & 1);
+    }
+    else
+    {
+        int bits_left = 8 - (GameBoy.Emulator.serial_transfered_bits & 7);
+
+        // The last falling edge ends the transfer
+        GameBoy.Emulator.serial_transfered_bits += bits_left - 1;
+        GameBoy.Emulator.serial_clock_signal = 0;
+        GB_SerialSendBit();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void GB_LinkPoll(void); // Below in this file
+static void GB_LinkSlaveStateChanged(void);
+
+// While linked to another Game Boy, messages are checked this often (in clocks)
+// even if nothing happens in the serial port, in case the other one starts a
+// transfer.
+#define GB_LINK_POLL_CLOCKS (512)
+
+static core_local__ int gb_link_poll_clocks = 0;
+
 //------------------------------------------------------------------------------
 
-static int gb_serial_clock_counter = 0;
+static core_local__ int gb_serial_clock_counter = 0;
 
 void GB_SerialClockCounterReset(void)
 {
@@ -85,22 +133,27 @@ void GB_SerialUpdateClocksCounterReference(int reference_clocks)
                     (GameBoy.Emulator.serial_clocks & (flip_clocks - 1))
                     + increment_clocks;
 
-            while (serial_new_clocks >= flip_clocks)
-            {
-                serial_new_clocks -= flip_clocks;
-
-                GameBoy.Emulator.serial_clock_signal ^= 1;
-
-                if (GameBoy.Emulator.serial_clock_signal == 0) // Falling edge
-                    GB_SerialSendBit();
-            }
+            int flips = serial_new_clocks / flip_clocks;
+            if (flips > 0)
+                GB_SerialClockFlip(flips);
         }
     }
 
     GameBoy.Emulator.serial_clocks += increment_clocks;
     GameBoy.Emulator.serial_clocks &= (512 / 2) - 1;
 
+    if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
+    {
+        gb_link_poll_clocks += increment_clocks;
+        if (gb_link_poll_clocks >= GB_LINK_POLL_CLOCKS)
+        {
+            gb_link_poll_clocks = 0;
+            GB_LinkPoll();
+        }
+    }
+
     GB_SerialClockCounterSet(reference_clocks);
+    GB_CPUEventSourceUpdated(GB_EVENT_SERIAL, reference_clocks);
 }
 
 int GB_SerialGetClocksToNextEvent(void)
@@ -113,10 +166,26 @@ int GB_SerialGetClocksToNextEvent(void)
         {
             int clocks = GameBoy.Emulator.serial_clocks_to_flip_clock_signal;
 
-            return clocks - (GameBoy.Emulator.serial_clocks & (clocks - 1));
+            int to_next_flip = clocks
+                    - (GameBoy.Emulator.serial_clocks & (clocks - 1));
+            int transfer_end = to_next_flip
+                    + ((GB_SerialClockFlipsLeft() - 1) * clocks);
+
+            // While linked, the poll of messages can happen before
+            if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
+            {
+                int poll = GB_LINK_POLL_CLOCKS - gb_link_poll_clocks;
+                if (poll < transfer_end)
+                    return poll;
+            }
+
+            return transfer_end;
         }
     }
 
+    if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
+        return GB_LINK_POLL_CLOCKS - gb_link_poll_clocks;
+
     return 0x7FFFFFFF;
 }
 
@@ -126,6 +195,9 @@ void GB_SerialWriteSB(int reference_clocks, int value)
 {
     GB_SerialUpdateClocksCounterReference(reference_clocks);
     GameBoy.Memory.IO_Ports[SB_REG - 0xFF00] = value;
+
+    if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
+        GB_LinkSlaveStateChanged();
 }
 
 void GB_SerialWriteSC(int reference_clocks, int value)
@@ -182,7 +254,11 @@ void GB_SerialWriteSC(int reference_clocks, int value)
     }
 
     GameBoy.Memory.IO_Ports[SC_REG - 0xFF00] = value;
-    GB_CPUBreakLoop();
+
+    if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
+        GB_LinkSlaveStateChanged();
+
+    GB_CPUBreakLoop(PROFILE_SLICE_SERIAL);
 }
 
 //------------------------------------------------------------------------------
@@ -224,89 +300,101 @@ typedef struct
     u32 packetcompressed[GBPRINTER_NUMPACKETS];
 } _GB_PRINTER_;
 
-_GB_PRINTER_ GB_Printer;
+core_local__ _GB_PRINTER_ GB_Printer;
 
-int printer_file_number = 0;
+core_local__ int printer_file_number = 0;
 
-static void GB_PrinterPrint(void)
-{
-    char *endbuffer = malloc(20 * 18 * 16);
-    memset(endbuffer, 0, 20 * 18 * 16);
+// Size of the image of a page (20x18 tiles)
+#define GBPRINTER_PAGE_SIZE (20 * 18 * 16)
 
-    char *ptr = endbuffer;
+// Decodes the received packets into a page
+static void GB_PrinterDecodePackets(u8 *dst)
+{
+    u8 *ptr = dst;
+    u8 *end = dst + GBPRINTER_PAGE_SIZE;
 
     for (int i = 0; i < GBPRINTER_NUMPACKETS; i++)
     {
+        u8 *src = GB_Printer.packets[i];
+        int size = GB_Printer.packetsize[i];
+
         if (GB_Printer.packetcompressed[i] == 0)
         {
-            memcpy(ptr, GB_Printer.packets[i], GB_Printer.packetsize[i]);
-            ptr += GB_Printer.packetsize[i];
+            if (size > (end - ptr))
+                size = end - ptr;
+            memcpy(ptr, src, size);
+            ptr += size;
+            continue;
         }
-        else
+
+        while (size > 0)
         {
-            unsigned char *src = GB_Printer.packets[i];
-            int size = GB_Printer.packetsize[i];
+            int data = *src++;
+            size--;
 
-            while (1)
+            if (data & 0x80) // Repeat
             {
-                int data = *src++;
+                data = (data & 0x7F) + 2;
+                if ((size < 1) || (data > (end - ptr)))
+                    break;
+                memset(ptr, *src++, data);
                 size--;
-
-                if (data & 0x80) // Repeat
-                {
-                    data = (data & 0x7F) + 2;
-                    memset(ptr, *src++, data);
-                    size--;
-                    ptr += data;
-                }
-                else // Normal
-                {
-                    data++;
-                    memcpy(ptr, src, data);
-                    ptr += data;
-                    src += data;
-                    size -= data;
-                }
-
-                if (size == 0)
+            }
+            else // Normal
+            {
+                data++;
+                if ((data > size) || (data > (end - ptr)))
                     break;
-
-                if (size < 0)
-                    Debug_ErrorMsgArg("GB_PrinterPrint: size < 0 (%d)", size);
+                memcpy(ptr, src, data);
+                src += data;
+                size -= data;
             }
+
+            ptr += data;
         }
+
+        if (size != 0)
+            Debug_ErrorMsgArg("GB_PrinterPrint: Invalid packet %d", i);
     }
+}
+
+static void GB_PrinterPrint(void)
+{
+    u8 page[GBPRINTER_PAGE_SIZE];
+    memset(page, 0, sizeof(page));
 
+    GB_PrinterDecodePackets(page);
+
+    // The image is converted straight into the buffer of the PNG writer, the
+    // background thread encodes it and saves it.
     char *filename = FU_GetNewTimestampFilename("gb_printer");
 
-    u32 buf_temp[160 * 144 * 4];
-    memset(buf_temp, 0, sizeof(buf_temp));
-    const u32 gb_pal_colors[4][3] = {
-        { 255, 255, 255 }, { 168, 168, 168 }, { 80, 80, 80 }, { 0, 0, 0 }
-    };
+    u32 *buf = PNG_SaveBegin(filename, 160, 144, 0);
+    if (buf == NULL)
+        return;
+
+    const u32 gb_pal_colors[4] = { 0xFFFFFF, 0xA8A8A8, 0x505050, 0x000000 };
 
     for (int y = 0; y < 144; y++)
     {
-        for (int x = 0; x < 160; x++)
+        for (int tx = 0; tx < 20; tx++)
         {
-            int tile = ((y >> 3) * 20) + (x >> 3);
-
-            char *tileptr = &endbuffer[tile * 16];
-
-            tileptr += (y & 7) * 2;
+            const u8 *tileptr = &page[((((y >> 3) * 20) + tx) * 16)
+                                      + ((y & 7) * 2)];
+            u32 lo = tileptr[0];
+            u32 hi = tileptr[1];
 
-            int x_ = 7 - (x & 7);
-
-            int color =
-                    ((*tileptr >> x_) & 1) | ((((*(tileptr + 1)) >> x_) << 1) & 2);
+            for (int x = 0; x < 8; x++)
+            {
+                int x_ = 7 - x;
+                int color = ((lo >> x_) & 1) | (((hi >> x_) << 1) & 2);
 
-            buf_temp[y * 160 + x] = (gb_pal_colors[color][0] << 16)
-                                    | (gb_pal_colors[color][1] << 8)
-                                    | gb_pal_colors[color][2];
+                *buf++ = gb_pal_colors[color];
+            }
         }
     }
 
-    Save_PNG(filename, 160, 144, buf_temp, 0);
+    PNG_SaveCommit();
 
     printer_file_number++;
 }
@@ -477,6 +565,155 @@ static u32 GB_RecvPrinter(void)
     return GB_Printer.output;
 }
 
+//------------------------------------------------------------------------------
+//                                GAME BOY
+
+// Link cable with a Game Boy emulated by another instance of the emulator. The
+// one that uses the internal clock (the master) starts the transfers. When it
+// has shifted out a whole byte, it sends it to the other one (the slave). If
+// the slave is waiting for a transfer, it receives it, but the master also
+// needs the byte that the slave has shifted out at the same time:
+//
+// - Lockstep mode: The master waits until the slave replies with the byte it
+//   had in SB when it received the transfer. Both sides see the same values as
+//   with a real cable, but every byte takes a round trip.
+//
+// - Speculative mode: Whenever the slave is ready for a transfer, it sends the
+//   byte it will shift out. The master uses the last one it has received, so
+//   it never waits. If the slave prepares the byte after the master has started
+//   the transfer, the master gets an old value.
+
+#define GB_LINK_MSG_TRANSFER    ('T') // Byte clocked out by the master
+#define GB_LINK_MSG_REPLY       ('R') // Byte clocked out by the slave
+#define GB_LINK_MSG_READY       ('S') // Byte the slave will clock out
+
+// Time the master waits for the reply in lockstep mode (in ms)
+#define GB_LINK_REPLY_TIMEOUT   (1000)
+
+// Byte received in the last transfer
+static core_local__ u32 gb_link_received = 0xFF;
+// Byte the slave will clock out
+static core_local__ u32 gb_link_peer_ready = 0xFF;
+
+static int GB_LinkSlaveIsReady(void)
+{
+    if (GameBoy.Emulator.serial_enabled == 0)
+        return 0;
+
+    return (GameBoy.Memory.IO_Ports[SC_REG - 0xFF00] & 0x01) == 0;
+}
+
+// Called when SB or SC are written, so that the master knows what it will get
+static void GB_LinkSlaveStateChanged(void)
+{
+    if (EmulatorConfig.link_lockstep)
+        return;
+
+    u32 value = 0xFF; // Nothing is shifted out if there is no transfer
+    if (GB_LinkSlaveIsReady())
+        value = GameBoy.Memory.IO_Ports[SB_REG - 0xFF00];
+
+    Link_Send(GB_LINK_MSG_READY, value);
+}
+
+// The other Game Boy has clocked a byte out
+static void GB_LinkSlaveTransfer(u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    int ready = GB_LinkSlaveIsReady();
+
+    if (EmulatorConfig.link_lockstep)
+    {
+        u32 reply = ready ? mem->IO_Ports[SB_REG - 0xFF00] : 0xFF;
+        Link_Send(GB_LINK_MSG_REPLY, reply);
+    }
+
+    if (ready == 0)
+        return;
+
+    GameBoy.Emulator.serial_enabled = 0;
+    GameBoy.Emulator.serial_transfered_bits = 0;
+
+    mem->IO_Ports[SB_REG - 0xFF00] = value;
+    mem->IO_Ports[SC_REG - 0xFF00] &= ~0x80;
+
+    GB_InterruptsSetFlag(I_SERIAL);
+
+    GB_LinkSlaveStateChanged();
+
+    GB_CPUBreakLoop(PROFILE_SLICE_SERIAL);
+}
+
+// Returns 1 if the message is a reply and saves it
+static int GB_LinkHandleMessage(u8 type, u8 value)
+{
+    switch (type)
+    {
+        case GB_LINK_MSG_TRANSFER:
+            GB_LinkSlaveTransfer(value);
+            return 0;
+        case GB_LINK_MSG_REPLY:
+            gb_link_received = value;
+            return 1;
+        case GB_LINK_MSG_READY:
+            gb_link_peer_ready = value;
+            return 0;
+        default:
+            Debug_DebugMsgArg("Link cable: Invalid message: %02X %02X",
+                              type, value);
+            return 0;
+    }
+}
+
+static void GB_LinkPoll(void)
+{
+    u8 type, value;
+
+    while (Link_Receive(&type, &value, 0))
+    {
+        // Replies only arrive while the master waits for them
+        GB_LinkHandleMessage(type, value);
+    }
+}
+
+static void GB_SendLink(u32 data)
+{
+    // Take the latest byte prepared by the slave
+    GB_LinkPoll();
+
+    gb_link_received = gb_link_peer_ready;
+
+    if (Link_IsConnected() == 0)
+    {
+        gb_link_received = 0xFF;
+        return;
+    }
+
+    Link_Send(GB_LINK_MSG_TRANSFER, data);
+
+    if (EmulatorConfig.link_lockstep == 0)
+        return;
+
+    // If both ends start a transfer at the same time, each one receives the
+    // transfer of the other one while it waits. They aren't slaves, so they
+    // reply with 0xFF, like a real cable.
+    u8 type, value;
+    while (Link_Receive(&type, &value, GB_LINK_REPLY_TIMEOUT))
+    {
+        if (GB_LinkHandleMessage(type, value))
+            return;
+    }
+
+    Debug_DebugMsgArg("Link cable: The other Game Boy didn't reply.");
+    gb_link_received = 0xFF;
+}
+
+static u32 GB_RecvLink(void)
+{
+    return gb_link_received;
+}
+
 //------------------------------------------------------------------------------
 
 void GB_SerialPlug(int device)
@@ -497,8 +734,14 @@ void GB_SerialPlug(int device)
             GameBoy.Emulator.SerialRecv_Fn = &GB_RecvPrinter;
             GB_PrinterReset();
             break;
-        case SERIAL_GAMEBOY: // TODO
-            //break;
+        case SERIAL_GAMEBOY:
+            GameBoy.Emulator.SerialSend_Fn = &GB_SendLink;
+            GameBoy.Emulator.SerialRecv_Fn = &GB_RecvLink;
+            gb_link_received = 0xFF;
+            gb_link_peer_ready = 0xFF;
+            gb_link_poll_clocks = 0;
+            Link_Start(EmulatorConfig.link_address, EmulatorConfig.link_port);
+            break;
         default:
             GameBoy.Emulator.SerialSend_Fn = &GB_SendNone;
             GameBoy.Emulator.SerialRecv_Fn = &GB_RecvNone;
@@ -596,7 +839,5 @@ void GB_SerialEnd(void)
         GB_PrinterReset();
 
     if (GameBoy.Emulator.serial_device == SERIAL_GAMEBOY)
-    {
-        // TODO
-    }
+        Link_Stop();
 }
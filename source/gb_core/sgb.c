@@ -11,6 +11,7 @@
 #include "../build_options.h"
 #include "../debug_utils.h"
 #include "../general_utils.h"
+#include "../savestate_utils.h"
 
 #include "debug.h"
 #include "gameboy.h"
@@ -19,11 +20,11 @@
 #include "sgb.h"
 #include "video.h"
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
-_SGB_INFO_ SGBInfo;
+core_local__ _SGB_INFO_ SGBInfo;
 
-static u32 sgb_screenbuffer[4 * 1024];
+static core_local__ u32 sgb_screenbuffer[4 * 1024];
 
 #if 0
 const u32 sgb_defaultpalettes[32][16] = {
@@ -191,6 +192,8 @@ void SGB_Init(void)
     memset(SGBInfo.tile_map, 0, 32 * 32 * 4);
 
     memset(SGBInfo.data, 0, sizeof(SGBInfo.data));
+
+    SGB_ScreenBorderInvalidate();
 }
 
 // For delay between frames (not used for now)
@@ -664,6 +667,8 @@ static void SGB_OBJ_TRN(void)
             SGBInfo.palette[6][i] = SGBInfo.snes_palette[pal6 + (i >> 2)][i & 3];
             SGBInfo.palette[7][i] = SGBInfo.snes_palette[pal7 + (i >> 2)][i & 3];
         }
+
+        SGB_ScreenBorderInvalidate();
     }
 }
 
@@ -1034,3 +1039,45 @@ u32 SGB_ReadP1(void)
         return result;
     }
 }
+
+//------------------------------------------------------------------------------
+
+// The RAM of the SNES is only saved if the game has sent any data to it.
+void SGB_StateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "SGB ");
+    SaveState_Write(st, &SGBInfo, sizeof(SGBInfo));
+    SaveState_Write(st, sgb_screenbuffer, sizeof(sgb_screenbuffer));
+    SaveState_ChunkEnd(st);
+
+    if (SGBInfo.sgb_bank0_ram)
+        SaveState_WriteChunk(st, "SGBR", SGBInfo.sgb_bank0_ram, 0x2000);
+}
+
+void SGB_StateLoad(_savestate_t *st)
+{
+    u8 *sgb_bank0_ram = SGBInfo.sgb_bank0_ram;
+
+    SaveState_ChunkOpen(st, "SGB ");
+    SaveState_Read(st, &SGBInfo, sizeof(SGBInfo));
+    SaveState_Read(st, sgb_screenbuffer, sizeof(sgb_screenbuffer));
+    SaveState_ChunkClose(st);
+
+    SGBInfo.sgb_bank0_ram = sgb_bank0_ram;
+
+    if (SaveState_ChunkFind(st, "SGBR") == 0)
+    {
+        if (SGBInfo.sgb_bank0_ram == NULL)
+            SGBInfo.sgb_bank0_ram = malloc(0x2000);
+
+        SaveState_Read(st, SGBInfo.sgb_bank0_ram, 0x2000);
+        SaveState_ChunkClose(st);
+    }
+    else if (SGBInfo.sgb_bank0_ram)
+    {
+        free(SGBInfo.sgb_bank0_ram);
+        SGBInfo.sgb_bank0_ram = NULL;
+    }
+
+    SGB_ScreenBorderInvalidate();
+}
@@ -19,6 +19,8 @@
 // A 60ms (4 frames) delay should be invoked between each packet transfer.
 #define SGB_PACKET_DELAY        (280896)
 
+#include "../savestate_utils.h"
+
 #include "gameboy.h"
 
 typedef struct
@@ -75,7 +77,7 @@ typedef struct
     u32 disable_sgb;
 } _SGB_INFO_;
 
-extern _SGB_INFO_ SGBInfo;
+extern core_local__ _SGB_INFO_ SGBInfo;
 
 void SGB_Init(void);
 void SGB_End(void);
@@ -85,4 +87,7 @@ int SGB_MultiplayerIsEnabled(void); // Returns 0 if disabled, mode if enabled
 void SGB_WriteP1(u32 value);
 u32 SGB_ReadP1(void);
 
+void SGB_StateSave(_savestate_t *st);
+void SGB_StateLoad(_savestate_t *st);
+
 #endif // GB_SGB__
@@ -12,21 +12,22 @@
 #include "../config.h"
 #include "../debug_utils.h"
 #include "../general_utils.h"
+#include "../profile_utils.h"
+#include "../resample_utils.h"
+#include "../savestate_utils.h"
 
 #include "debug.h"
 #include "gameboy.h"
 #include "general.h"
 #include "memory.h"
+#include "sound.h"
 
-// Quite a big buffer, but it works fine this way.  The bigger, the less
-// possibilities to underflow, but the more delay between actions and sound
-// output.
-//
-// Note: It must be a power of two.
-#define GB_BUFFER_SIZE      (16384)
-#define GB_BUFFER_SAMPLES   (GB_BUFFER_SIZE / 2)
+// 4194304 Hz CPU / 22050 Hz sound output = 190. The output stream is resampled
+// to the rate of the output device.
+#define GB_SOUND_SAMPLE_CLOCKS      (190)
+#define GB_SOUND_SAMPLE_RATE        (4194304 / GB_SOUND_SAMPLE_CLOCKS)
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 static const s8 GB_SquareWave[4][32] = {
     { -128, -128, -128, -128, -128, -128, -128, -128,
@@ -50,11 +51,145 @@ static const s8 GB_SquareWave[4][32] = {
      -128, -128, -128, -128, 127, 127, 127, 127 }
 };
 
-static s8 GB_WavePattern[32];
+static core_local__ s8 GB_WavePattern[32];
 
 extern const u8 gb_noise_7[16];    // In file noise.c
 extern const u8 gb_noise_15[4096]; // In file noise.c
 
+// Channels are synthesized by averaging their output over the duration of each
+// output sample instead of point-sampling it. This is the same as filtering
+// the band-limited steps with a box filter one sample wide, so fast square
+// waves and noise don't alias into audible tones.
+//
+// The phase of the channels is a fixed point position in their waveform, in
+// steps of the square and wave tables or in bits of the noise tables. The
+// average of a waveform between two positions is the difference between its
+// integrals at both ends divided by the distance, and the integrals come from
+// prefix sums of the waveforms, so this only costs a few operations per channel
+// and sample regardless of the frequency.
+
+#define GB_PHASE_SHIFT      (16)
+#define GB_PHASE_ONE        (1 << GB_PHASE_SHIFT)
+
+// Sum of the first N steps of the waveforms. Index 32 is the whole period.
+static core_local__ s32 GB_SquareWavePrefix[4][33];
+static core_local__ s32 GB_WavePatternPrefix[33];
+
+// Number of set bits in the first N bytes of the noise tables
+static core_local__ u16 gb_noise_7_ones[16 + 1];
+static core_local__ u16 gb_noise_15_ones[4096 + 1];
+static core_local__ u8 gb_byte_ones[256];
+
+static void gb_sound_prefix_fill(s32 *prefix, const s8 *wave)
+{
+    prefix[0] = 0;
+    for (int i = 0; i < 32; i++)
+        prefix[i + 1] = prefix[i] + wave[i];
+}
+
+static void gb_sound_ones_fill(u16 *ones, const u8 *bits, int size)
+{
+    ones[0] = 0;
+    for (int i = 0; i < size; i++)
+        ones[i + 1] = ones[i] + gb_byte_ones[bits[i]];
+}
+
+static void gb_sound_tables_init(void)
+{
+    for (int i = 0; i < 4; i++)
+        gb_sound_prefix_fill(GB_SquareWavePrefix[i], GB_SquareWave[i]);
+
+    for (int i = 0; i < 256; i++)
+    {
+        int n = 0;
+        for (int b = i; b; b >>= 1)
+            n += b & 1;
+        gb_byte_ones[i] = n;
+    }
+
+    gb_sound_ones_fill(gb_noise_7_ones, gb_noise_7, 16);
+    gb_sound_ones_fill(gb_noise_15_ones, gb_noise_15, 4096);
+}
+
+// Phase increment per output sample of a channel that advances the specified
+// number of steps (or bits) per second.
+static u32 gb_sound_phase_inc(u32 steps_per_second)
+{
+    return (u32)(((u64)steps_per_second << GB_PHASE_SHIFT) / 22050);
+}
+
+// Integral of a 32 step waveform from position 0 to pos
+static s64 gb_sound_wave_integral(const s8 *wave, const s32 *prefix, u32 pos)
+{
+    u32 step = pos >> GB_PHASE_SHIFT;
+    u32 frac = pos & (GB_PHASE_ONE - 1);
+
+    s64 sum = (s64)(step >> 5) * prefix[32] + prefix[step & 31];
+
+    return (sum << GB_PHASE_SHIFT) + (s64)wave[step & 31] * frac;
+}
+
+static int gb_sound_wave_sample(const s8 *wave, const s32 *prefix,
+                                u32 *phase, u32 inc)
+{
+    u32 start = *phase;
+    u32 end = start + inc;
+
+    *phase = end & ((32 << GB_PHASE_SHIFT) - 1);
+
+    if (inc == 0)
+        return wave[start >> GB_PHASE_SHIFT];
+
+    s64 area = gb_sound_wave_integral(wave, prefix, end)
+               - gb_sound_wave_integral(wave, prefix, start);
+
+    return (int)(area / (s64)inc);
+}
+
+// Integral of the noise from bit 0 to pos, where the noise table has a period
+// of (1 << period_shift) bits. Set bits output 127 and cleared bits -127.
+static s64 gb_sound_noise_integral(const u8 *bits, const u16 *ones,
+                                   int period_shift, u32 pos)
+{
+    u32 bit = pos >> GB_PHASE_SHIFT;
+    u32 frac = pos & (GB_PHASE_ONE - 1);
+
+    u32 index = bit & ((1 << period_shift) - 1);
+    u32 byte = bits[index >> 3];
+    u32 shift = index & 7;
+
+    s64 count = (s64)(bit >> period_shift) * ones[1 << (period_shift - 3)]
+                + ones[index >> 3] + gb_byte_ones[byte >> (8 - shift)];
+
+    s64 count_fixed = (count << GB_PHASE_SHIFT)
+                      + ((byte >> (7 - shift)) & 1) * frac;
+
+    return 127 * (2 * count_fixed - (s64)pos);
+}
+
+static int gb_sound_noise_sample(int width_7, u32 *phase, u32 inc)
+{
+    const u8 *bits = width_7 ? gb_noise_7 : gb_noise_15;
+    const u16 *ones = width_7 ? gb_noise_7_ones : gb_noise_15_ones;
+    int period_shift = width_7 ? 7 : 15;
+
+    u32 start = *phase & ((1 << (period_shift + GB_PHASE_SHIFT)) - 1);
+    u32 end = start + inc;
+
+    *phase = end & ((1 << (period_shift + GB_PHASE_SHIFT)) - 1);
+
+    if (inc == 0)
+    {
+        u32 bit = start >> GB_PHASE_SHIFT;
+        return (((bits[bit >> 3] >> (7 - (bit & 7))) & 1) * 2 - 1) * 127;
+    }
+
+    s64 area = gb_sound_noise_integral(bits, ones, period_shift, end)
+               - gb_sound_noise_integral(bits, ones, period_shift, start);
+
+    return (int)(area / (s64)inc);
+}
+
 typedef struct
 {
     struct // Tone & Sweep
@@ -85,7 +220,8 @@ typedef struct
 
         u32 running;
         u32 outfreq;
-        u32 samplecount;
+        u32 phase; // See GB_PHASE_SHIFT
+        u32 phaseinc;
     } Chn1;
 
     struct // Tone
@@ -109,7 +245,8 @@ typedef struct
 
         u32 running;
         u32 outfreq;
-        u32 samplecount;
+        u32 phase; // See GB_PHASE_SHIFT
+        u32 phaseinc;
     } Chn2;
 
     struct // Wave Output
@@ -130,7 +267,8 @@ typedef struct
 
         u32 running;
         u32 outfreq;
-        u32 samplecount;
+        u32 phase; // See GB_PHASE_SHIFT
+        u32 phaseinc;
     } Chn3;
 
     struct // Noise
@@ -157,7 +295,8 @@ typedef struct
 
         u32 running;
         u32 outfreq;
-        u32 samplecount;
+        u32 phase; // See GB_PHASE_SHIFT
+        u32 phaseinc;
     } Chn4;
 
     u32 leftvol;
@@ -165,11 +304,6 @@ typedef struct
     u32 clocks;
 
     u32 nextsample_clocks;
-    s16 buffer[GB_BUFFER_SIZE / 2];
-    u32 buffer_next_input_sample;
-    u32 buffer_next_output_sample;
-    int samples_left_to_input;
-    int samples_left_to_output;
 
     // Some temporary variables to avoid doing the same calculations every time
     // a sample is going to be generated:
@@ -181,9 +315,22 @@ typedef struct
     u32 master_enable;
 } _GB_SOUND_HARDWARE_;
 
-static _GB_SOUND_HARDWARE_ Sound;
+static core_local__ _GB_SOUND_HARDWARE_ Sound;
+
+// Kept out of the state of the hardware so that it can be saved as it is
+static core_local__ _resample_stream_t gb_sound_stream;
+
+static core_local__ int output_enabled;
 
-static int output_enabled;
+// While the output is suspended the hardware is still emulated, but no output
+// samples are generated. Unlike disabling the output, the samples that haven't
+// been played yet are kept.
+static core_local__ int output_suspended;
+
+void GB_SoundSetOutputSuspended(int suspended)
+{
+    output_suspended = suspended;
+}
 
 int GB_SoundHardwareIsOn(void)
 {
@@ -224,34 +371,34 @@ void GB_SoundCallback(void *buffer, long len)
         return;
     }
 
-    //Should print: (GB_BUFFER_SAMPLES / 3 * 2) - (GB_BUFFER_SAMPLES / 3)
-    //Debug_LogMsgArg("%d, %d - %d %s", len, Sound.samples_left_to_input,
-    //    Sound.samples_left_to_output,
-    //    Sound.samples_left_to_output
-    //        > Sound.samples_left_to_input - (GB_BUFFER_SAMPLES / 2) ?
-    //            "SLOW" : "FAST");
+    Resample_Read(&gb_sound_stream, (s16 *)buffer, len / 4);
+}
 
-    s16 *writebuffer = (s16 *)buffer;
+u32 GB_SoundGetSampleRate(void)
+{
+    return GB_SOUND_SAMPLE_RATE;
+}
 
-    if (Sound.samples_left_to_output < len / 4)
-        return;
+void GB_SoundGetOutputStats(_resample_stats_t *stats)
+{
+    Resample_GetStats(&gb_sound_stream, stats);
+}
 
-    Sound.samples_left_to_input += len / 4;
-    Sound.samples_left_to_output -= len / 4;
+static core_local__ u32 gb_sound_frame_hash;
 
-    for (int i = 0; i < len / 2; i++)
-    {
-        writebuffer[i] = Sound.buffer[Sound.buffer_next_output_sample++];
-        Sound.buffer_next_output_sample &= GB_BUFFER_SAMPLES - 1;
-    }
+void GB_SoundFrameEnd(void)
+{
+    gb_sound_frame_hash = Resample_TakeHash(&gb_sound_stream);
+}
+
+u32 GB_SoundGetFrameHash(void)
+{
+    return gb_sound_frame_hash;
 }
 
 void GB_SoundResetBufferPointers(void)
 {
-    Sound.buffer_next_input_sample = 0;
-    Sound.buffer_next_output_sample = 0;
-    Sound.samples_left_to_input = GB_BUFFER_SAMPLES;
-    Sound.samples_left_to_output = 0;
+    Resample_Reset(&gb_sound_stream, GB_SOUND_SAMPLE_RATE);
 }
 
 void GB_SoundInit(void)
@@ -260,6 +407,8 @@ void GB_SoundInit(void)
     memset(&Sound, 0, sizeof(Sound));
     GB_SoundResetBufferPointers();
 
+    gb_sound_tables_init();
+
     output_enabled = 1;
 
     Sound.leftvol_1 = Sound.rightvol_1 = 0;
@@ -380,6 +529,8 @@ void GB_SoundLoadWave(void)
         *bufferptr++ = (mem->IO_Ports[count] & 0xF0) - 127;
         *bufferptr++ = ((mem->IO_Ports[count] & 0xF) << 4) - 127;
     }
+
+    gb_sound_prefix_fill(GB_WavePatternPrefix, GB_WavePattern);
 }
 
 void GB_ToggleSound(void)
@@ -394,20 +545,9 @@ void GB_SoundMix(void)
     //if (output_enabled == 0)
     //    return; // Not needed here
 
-    if (EmulatorConfig.snd_mute)
-        return;
-
-    if (Sound.samples_left_to_input < 1)
-        return;
-
-    Sound.samples_left_to_input--;
-    Sound.samples_left_to_output++;
-
-    if (Sound.master_enable == 0)
+    if (EmulatorConfig.snd_mute || (Sound.master_enable == 0))
     {
-        Sound.buffer[Sound.buffer_next_input_sample++] = 0;
-        Sound.buffer[Sound.buffer_next_input_sample++] = 0;
-        Sound.buffer_next_input_sample &= GB_BUFFER_SAMPLES - 1;
+        Resample_Write(&gb_sound_stream, 0, 0);
         return;
     }
 #if 0
@@ -435,45 +575,35 @@ void GB_SoundMix(void)
 
     if (Sound.Chn1.running && (EmulatorConfig.chn_flags & 0x1))
     {
-        int index = (((Sound.Chn1.samplecount++) * ((Sound.Chn1.outfreq)
-                  * (32 / 2))) / 22050) & 31;
-        int out_1 = (int)GB_SquareWave[Sound.Chn1.duty][index];
+        int out_1 = gb_sound_wave_sample(GB_SquareWave[Sound.Chn1.duty],
+                                         GB_SquareWavePrefix[Sound.Chn1.duty],
+                                         &Sound.Chn1.phase,
+                                         Sound.Chn1.phaseinc);
         outvalue_left += out_1 * Sound.leftvol_1;
         outvalue_right += out_1 * Sound.rightvol_1;
     }
     if (Sound.Chn2.running && (EmulatorConfig.chn_flags & 0x2))
     {
-        int index = (((Sound.Chn2.samplecount++) * ((Sound.Chn2.outfreq)
-                  * (32 / 2))) / 22050) & 31;
-
-        int out_2 = (int)GB_SquareWave[Sound.Chn2.duty][index];
+        int out_2 = gb_sound_wave_sample(GB_SquareWave[Sound.Chn2.duty],
+                                         GB_SquareWavePrefix[Sound.Chn2.duty],
+                                         &Sound.Chn2.phase,
+                                         Sound.Chn2.phaseinc);
         outvalue_left += out_2 * Sound.leftvol_2;
         outvalue_right += out_2 * Sound.rightvol_2;
     }
     if (Sound.Chn3.running && (EmulatorConfig.chn_flags & 0x4))
     {
-        int index = (((Sound.Chn3.samplecount++) * ((Sound.Chn3.outfreq)
-                  * (32 / 2))) / 22050) & 31;
-        int out_3 = (int)GB_WavePattern[index];
+        int out_3 = gb_sound_wave_sample(GB_WavePattern, GB_WavePatternPrefix,
+                                         &Sound.Chn3.phase,
+                                         Sound.Chn3.phaseinc);
         outvalue_left += out_3 * Sound.leftvol_3;
         outvalue_right += out_3 * Sound.rightvol_3;
     }
     if (Sound.Chn4.running && (EmulatorConfig.chn_flags & 0x8))
     {
-        int out_4;
-        int value = ((Sound.Chn4.samplecount++) * Sound.Chn4.outfreq / 2) / 22050;
-
-        if (Sound.Chn4.width_7) // 7 bit
-        {
-            out_4 = gb_noise_7[(value / 8) & 15] >> (7 - (value & 7));
-        }
-        else // 15 bit
-        {
-            out_4 = gb_noise_15[(value / 8) & 4095] >> (7 - (value & 7));
-        }
-
-        out_4 &= 1;
-        out_4 = ((out_4 * 2) - 1) * 127;
+        int out_4 = gb_sound_noise_sample(Sound.Chn4.width_7,
+                                          &Sound.Chn4.phase,
+                                          Sound.Chn4.phaseinc);
         outvalue_left += out_4 * Sound.leftvol_4;
         outvalue_right += out_4 * Sound.rightvol_4;
     }
@@ -488,413 +618,502 @@ void GB_SoundMix(void)
     else if (outvalue_right < (-32768))
         outvalue_right = -32768;
 
-    Sound.buffer[Sound.buffer_next_input_sample++] =
-            (outvalue_left * EmulatorConfig.volume) / 128;
-    Sound.buffer[Sound.buffer_next_input_sample++] =
-            (outvalue_right * EmulatorConfig.volume) / 128;
-    Sound.buffer_next_input_sample &= GB_BUFFER_SAMPLES - 1;
+    Resample_Write(&gb_sound_stream,
+                   (outvalue_left * EmulatorConfig.volume) / 128,
+                   (outvalue_right * EmulatorConfig.volume) / 128);
 }
 
-void GB_SoundRegWrite(u32 address, u32 value)
+// Voice 1
+// -------
+
+static void GB_SoundWriteNR10(u32 value)
 {
-    //fprintf(stdout, "%04x - %02x\r\n", address, value);
+    Sound.Chn1.reg[0] = value;
+    // Don't update sweep yet...
+}
+
+static void GB_SoundWriteNR11(u32 value)
+{
+    Sound.Chn1.reg[1] = value;
+
+    Sound.Chn1.stepsleft = (64 - (value & 0x3F)) << 2;
+    Sound.Chn1.duty = (value >> 6) & 3;
+}
+
+static void GB_SoundWriteNR12(u32 value)
+{
+    Sound.Chn1.reg[2] = value;
+    // Don't update envelope yet...
+
+    if (Sound.Chn1.running) // "zombie mode"
+    {
+        if (Sound.Chn1.envactive && (Sound.Chn1.envelope == 0))
+            Sound.Chn1.vol = (Sound.Chn1.vol + 1) & 0xF;
+        else if ((Sound.Chn1.reg[2] & (1 << 3)) == 0)
+            Sound.Chn1.vol = (Sound.Chn1.vol + 2) & 0xF;
+
+        if ((Sound.Chn1.reg[2] ^ value) & (1 << 3))
+            Sound.Chn1.vol = 0x10 - Sound.Chn1.vol;
+
+        Sound.leftvol_1 = Sound.Chn1.speakerleft ?
+                                (Sound.Chn1.vol * Sound.leftvol) : 0;
+        Sound.rightvol_1 = Sound.Chn1.speakerright ?
+                                (Sound.Chn1.vol * Sound.rightvol) : 0;
+    }
+}
+
+static void GB_SoundWriteNR13(u32 value)
+{
+    Sound.Chn1.reg[3] = value;
+
+    Sound.Chn1.freq &= 0x0700;
+    Sound.Chn1.freq |= Sound.Chn1.reg[3];
+
+    Sound.Chn1.outfreq = 131072 / (2048 - Sound.Chn1.freq);
+    Sound.Chn1.phaseinc =
+            gb_sound_phase_inc(Sound.Chn1.outfreq * 16);
+}
 
+static void GB_SoundWriteNR14(u32 value)
+{
     _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-    if (Sound.master_enable == 0)
+    Sound.Chn1.reg[4] = value;
+
+    Sound.Chn1.freq &= 0xFF;
+    Sound.Chn1.freq |= (Sound.Chn1.reg[4] & 0x07) << 8;
+
+    Sound.Chn1.outfreq = 131072 / (2048 - Sound.Chn1.freq);
+    Sound.Chn1.phaseinc =
+            gb_sound_phase_inc(Sound.Chn1.outfreq * 16);
+
+    Sound.Chn1.limittime = (Sound.Chn1.reg[4] & (1 << 6));
+
+    if (value & (1 << 7))
     {
-        if ((address == NR52_REG) && (value & (1 << 7)))
-        {
-            GB_SoundPowerOn();
-            Sound.master_enable = 1;
-        }
-        return;
+        Sound.Chn1.running = 1;
+
+        // Update sweep
+        Sound.Chn1.sweeptime = (Sound.Chn1.reg[0] >> 4) & 0x07;
+        Sound.Chn1.sweepstepsleft = Sound.Chn1.sweeptime << 1;
+        Sound.Chn1.sweepinc = ((Sound.Chn1.reg[0] & (1 << 3)) == 0);
+        Sound.Chn1.sweepshift = Sound.Chn1.reg[0] & 0x07;
+        Sound.Chn1.sweepfreq = Sound.Chn1.freq;
+
+        // Update envelope
+        Sound.Chn1.vol = (Sound.Chn1.reg[2] >> 4);
+        Sound.Chn1.envelope = Sound.Chn1.reg[2] & 0x07;
+        Sound.Chn1.envactive = 1; // Sound.Chn1.envelope != 0;
+        Sound.Chn1.envincrease = Sound.Chn1.reg[2] & (1 << 3);
+        Sound.Chn1.envstepstochange = Sound.Chn1.envelope << 2;
+        Sound.leftvol_1 = Sound.Chn1.speakerleft ?
+                                (Sound.Chn1.vol * Sound.leftvol) : 0;
+        Sound.rightvol_1 = Sound.Chn1.speakerright ?
+                                (Sound.Chn1.vol * Sound.rightvol) : 0;
+
+        mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 0);
     }
+    else
+    {
+        //mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 0);
+    }
+}
+
+// Voice 2
+// -------
+
+static void GB_SoundWriteNR21(u32 value)
+{
+    Sound.Chn2.reg[1] = value;
+
+    Sound.Chn2.stepsleft = (64 - (value & 0x3F)) << 2;
+    Sound.Chn2.duty = (value >> 6) & 3;
+}
+
+static void GB_SoundWriteNR22(u32 value)
+{
+    Sound.Chn2.reg[2] = value;
+    // Don't update envelope yet...
 
-    switch (address)
+    if (Sound.Chn2.running) // "zombie mode"
     {
-        // Voice 1
-        // -------
-
-        case NR10_REG:
-            Sound.Chn1.reg[0] = value;
-            // Don't update sweep yet...
-            return;
-        case NR11_REG:
-            Sound.Chn1.reg[1] = value;
-
-            Sound.Chn1.stepsleft = (64 - (value & 0x3F)) << 2;
-            Sound.Chn1.duty = (value >> 6) & 3;
-            return;
-        case NR12_REG:
-            Sound.Chn1.reg[2] = value;
-            // Don't update envelope yet...
-
-            if (Sound.Chn1.running) // "zombie mode"
-            {
-                if (Sound.Chn1.envactive && (Sound.Chn1.envelope == 0))
-                    Sound.Chn1.vol = (Sound.Chn1.vol + 1) & 0xF;
-                else if ((Sound.Chn1.reg[2] & (1 << 3)) == 0)
-                    Sound.Chn1.vol = (Sound.Chn1.vol + 2) & 0xF;
+        if (Sound.Chn2.envactive && (Sound.Chn2.envelope == 0))
+            Sound.Chn2.vol = (Sound.Chn2.vol + 1) & 0xF;
+        else if ((Sound.Chn2.reg[2] & (1 << 3)) == 0)
+            Sound.Chn2.vol = (Sound.Chn2.vol + 2) & 0xF;
+
+        if ((Sound.Chn2.reg[2] ^ value) & (1 << 3))
+            Sound.Chn2.vol = 0x10 - Sound.Chn2.vol;
+
+        Sound.leftvol_2 = Sound.Chn2.speakerleft ?
+                                (Sound.Chn2.vol * Sound.leftvol) : 0;
+        Sound.rightvol_2 = Sound.Chn2.speakerright ?
+                                (Sound.Chn2.vol * Sound.rightvol) : 0;
+    }
+}
 
-                if ((Sound.Chn1.reg[2] ^ value) & (1 << 3))
-                    Sound.Chn1.vol = 0x10 - Sound.Chn1.vol;
+static void GB_SoundWriteNR23(u32 value)
+{
+    Sound.Chn2.reg[3] = value;
 
-                Sound.leftvol_1 = Sound.Chn1.speakerleft ?
-                                        (Sound.Chn1.vol * Sound.leftvol) : 0;
-                Sound.rightvol_1 = Sound.Chn1.speakerright ?
-                                        (Sound.Chn1.vol * Sound.rightvol) : 0;
-            }
-            return;
-        case NR13_REG:
-            Sound.Chn1.reg[3] = value;
+    Sound.Chn2.freq &= 0x0700;
+    Sound.Chn2.freq |= value;
 
-            Sound.Chn1.freq &= 0x0700;
-            Sound.Chn1.freq |= Sound.Chn1.reg[3];
+    Sound.Chn2.outfreq = 131072 / (2048 - Sound.Chn2.freq);
+    Sound.Chn2.phaseinc =
+            gb_sound_phase_inc(Sound.Chn2.outfreq * 16);
+}
 
-            Sound.Chn1.outfreq = 131072 / (2048 - Sound.Chn1.freq);
-            return;
-        case NR14_REG:
-            Sound.Chn1.reg[4] = value;
+static void GB_SoundWriteNR24(u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-            Sound.Chn1.freq &= 0xFF;
-            Sound.Chn1.freq |= (Sound.Chn1.reg[4] & 0x07) << 8;
+    Sound.Chn2.reg[4] = value;
 
-            Sound.Chn1.outfreq = 131072 / (2048 - Sound.Chn1.freq);
+    Sound.Chn2.freq &= 0xFF;
+    Sound.Chn2.freq |= (value & 0x07) << 8;
 
-            Sound.Chn1.limittime = (Sound.Chn1.reg[4] & (1 << 6));
+    Sound.Chn2.outfreq = 131072 / (2048 - Sound.Chn2.freq);
+    Sound.Chn2.phaseinc =
+            gb_sound_phase_inc(Sound.Chn2.outfreq * 16);
 
-            if (value & (1 << 7))
-            {
-                Sound.Chn1.running = 1;
-
-                // Update sweep
-                Sound.Chn1.sweeptime = (Sound.Chn1.reg[0] >> 4) & 0x07;
-                Sound.Chn1.sweepstepsleft = Sound.Chn1.sweeptime << 1;
-                Sound.Chn1.sweepinc = ((Sound.Chn1.reg[0] & (1 << 3)) == 0);
-                Sound.Chn1.sweepshift = Sound.Chn1.reg[0] & 0x07;
-                Sound.Chn1.sweepfreq = Sound.Chn1.freq;
-
-                // Update envelope
-                Sound.Chn1.vol = (Sound.Chn1.reg[2] >> 4);
-                Sound.Chn1.envelope = Sound.Chn1.reg[2] & 0x07;
-                Sound.Chn1.envactive = 1; // Sound.Chn1.envelope != 0;
-                Sound.Chn1.envincrease = Sound.Chn1.reg[2] & (1 << 3);
-                Sound.Chn1.envstepstochange = Sound.Chn1.envelope << 2;
-                Sound.leftvol_1 = Sound.Chn1.speakerleft ?
-                                        (Sound.Chn1.vol * Sound.leftvol) : 0;
-                Sound.rightvol_1 = Sound.Chn1.speakerright ?
-                                        (Sound.Chn1.vol * Sound.rightvol) : 0;
+    Sound.Chn2.limittime = (value & (1 << 6));
 
-                mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 0);
-            }
-            else
-            {
-                //mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 0);
-            }
-            return;
+    if (value & (1 << 7))
+    {
+        Sound.Chn2.running = 1;
+
+        // Update envelope
+        Sound.Chn2.vol = (Sound.Chn2.reg[2] >> 4);
+        Sound.Chn2.envelope = Sound.Chn2.reg[2] & 0x07;
+        Sound.Chn2.envactive = 1; // Sound.Chn2.envelope != 0;
+        Sound.Chn2.envincrease = Sound.Chn2.reg[2] & (1 << 3);
+        Sound.Chn2.envstepstochange = Sound.Chn2.envelope << 2;
+        Sound.leftvol_2 = Sound.Chn2.speakerleft ?
+                                (Sound.Chn2.vol * Sound.leftvol) : 0;
+        Sound.rightvol_2 = Sound.Chn2.speakerright ?
+                                (Sound.Chn2.vol * Sound.rightvol) : 0;
+
+        mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 1);
+    }
+    else
+    {
+        //mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 1);
+    }
+}
 
-        // Voice 2
-        // -------
+// Voice 3
+// -------
 
-        case NR21_REG:
-            Sound.Chn2.reg[1] = value;
+static void GB_SoundWriteNR30(u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-            Sound.Chn2.stepsleft = (64 - (value & 0x3F)) << 2;
-            Sound.Chn2.duty = (value >> 6) & 3;
-            return;
-        case NR22_REG:
-            Sound.Chn2.reg[2] = value;
-            // Don't update envelope yet...
+    Sound.Chn3.reg[0] = value;
 
-            if (Sound.Chn2.running) // "zombie mode"
-            {
-                if (Sound.Chn2.envactive && (Sound.Chn2.envelope == 0))
-                    Sound.Chn2.vol = (Sound.Chn2.vol + 1) & 0xF;
-                else if ((Sound.Chn2.reg[2] & (1 << 3)) == 0)
-                    Sound.Chn2.vol = (Sound.Chn2.vol + 2) & 0xF;
+    if (value & (1 << 7))
+    {
+        mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 2);
 
-                if ((Sound.Chn2.reg[2] ^ value) & (1 << 3))
-                    Sound.Chn2.vol = 0x10 - Sound.Chn2.vol;
+        GB_SoundLoadWave();
 
-                Sound.leftvol_2 = Sound.Chn2.speakerleft ?
-                                        (Sound.Chn2.vol * Sound.leftvol) : 0;
-                Sound.rightvol_2 = Sound.Chn2.speakerright ?
-                                        (Sound.Chn2.vol * Sound.rightvol) : 0;
-            }
-            return;
+        Sound.Chn3.phase = 0;
+        Sound.Chn3.outfreq = 131072 / (2048 - Sound.Chn3.freq);
+        Sound.Chn3.phaseinc =
+                gb_sound_phase_inc(Sound.Chn3.outfreq * 16);
+        Sound.Chn3.playing = 1;
+    }
+    else
+    {
+        Sound.Chn3.playing = 0;
+        mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 2);
+        Sound.Chn3.running = 0;
+    }
+}
 
-        case NR23_REG:
-            Sound.Chn2.reg[3] = value;
+static void GB_SoundWriteNR31(u32 value)
+{
+    Sound.Chn3.reg[1] = value;
 
-            Sound.Chn2.freq &= 0x0700;
-            Sound.Chn2.freq |= value;
+    Sound.Chn3.stepsleft = (256 - value) << 2;
+}
 
-            Sound.Chn2.outfreq = 131072 / (2048 - Sound.Chn2.freq);
-            return;
-        case NR24_REG:
-            Sound.Chn2.reg[4] = value;
+static void GB_SoundWriteNR32(u32 value)
+{
+    Sound.Chn3.reg[2] = value;
 
-            Sound.Chn2.freq &= 0xFF;
-            Sound.Chn2.freq |= (value & 0x07) << 8;
+    switch ((value >> 5) & 3)
+    {
+        case 0:
+            Sound.Chn3.vol = 0x0;
+            break;
+        case 1:
+            Sound.Chn3.vol = 0xF;
+            break;
+        case 2:
+            Sound.Chn3.vol = 0x7;
+            break;
+        case 3:
+            Sound.Chn3.vol = 0x3;
+            break;
+    }
 
-            Sound.Chn2.outfreq = 131072 / (2048 - Sound.Chn2.freq);
+    Sound.leftvol_3 = Sound.Chn3.speakerleft ?
+                                (Sound.Chn3.vol * Sound.leftvol) : 0;
+    Sound.rightvol_3 = Sound.Chn3.speakerright ?
+                                (Sound.Chn3.vol * Sound.rightvol) : 0;
+}
 
-            Sound.Chn2.limittime = (value & (1 << 6));
+static void GB_SoundWriteNR33(u32 value)
+{
+    Sound.Chn3.reg[3] = value;
 
-            if (value & (1 << 7))
-            {
-                Sound.Chn2.running = 1;
-
-                // Update envelope
-                Sound.Chn2.vol = (Sound.Chn2.reg[2] >> 4);
-                Sound.Chn2.envelope = Sound.Chn2.reg[2] & 0x07;
-                Sound.Chn2.envactive = 1; // Sound.Chn2.envelope != 0;
-                Sound.Chn2.envincrease = Sound.Chn2.reg[2] & (1 << 3);
-                Sound.Chn2.envstepstochange = Sound.Chn2.envelope << 2;
-                Sound.leftvol_2 = Sound.Chn2.speakerleft ?
-                                        (Sound.Chn2.vol * Sound.leftvol) : 0;
-                Sound.rightvol_2 = Sound.Chn2.speakerright ?
-                                        (Sound.Chn2.vol * Sound.rightvol) : 0;
+    Sound.Chn3.freq &= 0x0700;
+    Sound.Chn3.freq |= value;
 
-                mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 1);
-            }
-            else
-            {
-                //mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 1);
-            }
-            return;
+    if (Sound.Chn3.playing)
+    {
+        Sound.Chn3.outfreq = 131072 / (2048 - Sound.Chn3.freq);
+        Sound.Chn3.phaseinc =
+                gb_sound_phase_inc(Sound.Chn3.outfreq * 16);
+    }
+}
 
-        // Voice 3
-        // -------
+static void GB_SoundWriteNR34(u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-        case NR30_REG:
-            Sound.Chn3.reg[0] = value;
+    Sound.Chn3.reg[4] = value;
 
-            if (value & (1 << 7))
-            {
-                mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 2);
+    Sound.Chn3.freq &= 0xFF;
+    Sound.Chn3.freq |= (value & 0x07) << 8;
 
-                GB_SoundLoadWave();
+    Sound.Chn3.outfreq = 131072 / (2048 - Sound.Chn3.freq);
+    Sound.Chn3.phaseinc =
+            gb_sound_phase_inc(Sound.Chn3.outfreq * 16);
 
-                Sound.Chn3.samplecount = 0;
-                Sound.Chn3.outfreq = 131072 / (2048 - Sound.Chn3.freq);
-                Sound.Chn3.playing = 1;
-            }
-            else
-            {
-                Sound.Chn3.playing = 0;
-                mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 2);
-                Sound.Chn3.running = 0;
-            }
-            return;
-        case NR31_REG:
-            Sound.Chn3.reg[1] = value;
+    Sound.Chn3.limittime = (value & (1 << 6));
 
-            Sound.Chn3.stepsleft = (256 - value) << 2;
-            return;
-        case NR32_REG:
-            Sound.Chn3.reg[2] = value;
+    if (Sound.Chn3.playing) // ?
+    {
+        if (value & (1 << 7))
+        {
+            //Sound.Chn3.playing = 1; // ?
+            Sound.Chn3.phase = 0;
+            mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 2);
+            GB_SoundLoadWave();
+            Sound.Chn3.running = 1;
+        }
+    }
+}
 
-            switch ((value >> 5) & 3)
-            {
-                case 0:
-                    Sound.Chn3.vol = 0x0;
-                    break;
-                case 1:
-                    Sound.Chn3.vol = 0xF;
-                    break;
-                case 2:
-                    Sound.Chn3.vol = 0x7;
-                    break;
-                case 3:
-                    Sound.Chn3.vol = 0x3;
-                    break;
-            }
+// Voice 4
+// -------
 
-            Sound.leftvol_3 = Sound.Chn3.speakerleft ?
-                                        (Sound.Chn3.vol * Sound.leftvol) : 0;
-            Sound.rightvol_3 = Sound.Chn3.speakerright ?
-                                        (Sound.Chn3.vol * Sound.rightvol) : 0;
-            return;
-        case NR33_REG:
-            Sound.Chn3.reg[3] = value;
+static void GB_SoundWriteNR41(u32 value)
+{
+    Sound.Chn4.reg[1] = value;
 
-            Sound.Chn3.freq &= 0x0700;
-            Sound.Chn3.freq |= value;
+    Sound.Chn4.stepsleft = (64 - (value & 0x3F)) << 2;
+}
 
-            if (Sound.Chn3.playing)
-            {
-                Sound.Chn3.outfreq = 131072 / (2048 - Sound.Chn3.freq);
-            }
-            return;
-        case NR34_REG:
-            Sound.Chn3.reg[4] = value;
+static void GB_SoundWriteNR42(u32 value)
+{
+    Sound.Chn4.reg[2] = value;
+    // Don't update envelope yet...
+#if 0
+    // No zombie mode in channel 4?
+    if (Sound.Chn4.running) // "zombie mode"
+    {
+        if (Sound.Chn4.envactive && (Sound.Chn4.envelope == 0))
+            Sound.Chn4.vol = (Sound.Chn4.vol + 1) & 0xF;
+        else if ((Sound.Chn4.reg[2] & (1 << 3)) == 0)
+            Sound.Chn4.vol = (Sound.Chn4.vol + 2) & 0xF;
+
+        if ((Sound.Chn4.reg[2] ^ value) & (1 << 3))
+            Sound.Chn4.vol = 0x10 - Sound.Chn4.vol;
+
+        Sound.leftvol_4 = Sound.Chn4.speakerleft ?
+                                (Sound.Chn4.vol * Sound.leftvol) : 0;
+        Sound.rightvol_4 = Sound.Chn4.speakerright ?
+                                (Sound.Chn4.vol * Sound.rightvol) : 0;
+    }
+#endif
+}
 
-            Sound.Chn3.freq &= 0xFF;
-            Sound.Chn3.freq |= (value & 0x07) << 8;
+static void GB_SoundWriteNR43(u32 value)
+{
+    Sound.Chn4.reg[3] = value;
 
-            Sound.Chn3.outfreq = 131072 / (2048 - Sound.Chn3.freq);
+    Sound.Chn4.shift = (value >> 4) & 0x0F;
+    Sound.Chn4.width_7 = value & (1 << 3);
+    Sound.Chn4.freq_ratio = value & 0x07;
 
-            Sound.Chn3.limittime = (value & (1 << 6));
+    if (Sound.Chn4.shift > 13)
+    {
+        Sound.Chn4.outfreq = 0;
+        Sound.Chn4.phaseinc = 0;
+        return;
+    }
 
-            if (Sound.Chn3.playing) // ?
-            {
-                if (value & (1 << 7))
-                {
-                    //Sound.Chn3.playing = 1; // ?
-                    Sound.Chn3.samplecount = 0;
-                    mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 2);
-                    GB_SoundLoadWave();
-                    Sound.Chn3.running = 1;
-                }
-            }
-            return;
+    //const s32 NoiseFreqRatio[8] = {
+    //    1048576, 524288, 370728, 262144, 220436, 185364, 155872,
+    //    131072
+    //};
+    const s32 NoiseFreqRatio[8] = {
+        1048576, 524288, 262144, 174763, 131072, 104858, 87381, 74898
+    };
+
+    Sound.Chn4.outfreq = NoiseFreqRatio[Sound.Chn4.freq_ratio]
+                         >> (Sound.Chn4.shift + 1);
+    if (Sound.Chn4.outfreq > (1 << 18))
+        Sound.Chn4.outfreq = 1 << 18;
+    Sound.Chn4.phaseinc = gb_sound_phase_inc(Sound.Chn4.outfreq / 2);
+}
 
-        // Voice 4
-        // -------
+static void GB_SoundWriteNR44(u32 value)
+{
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
 
-        case NR41_REG:
-            Sound.Chn4.reg[1] = value;
+    Sound.Chn4.reg[4] = value;
 
-            Sound.Chn4.stepsleft = (64 - (value & 0x3F)) << 2;
-            return;
-        case NR42_REG:
-            Sound.Chn4.reg[2] = value;
-            // Don't update envelope yet...
-#if 0
-            // No zombie mode in channel 4?
-            if (Sound.Chn4.running) // "zombie mode"
-            {
-                if (Sound.Chn4.envactive && (Sound.Chn4.envelope == 0))
-                    Sound.Chn4.vol = (Sound.Chn4.vol + 1) & 0xF;
-                else if ((Sound.Chn4.reg[2] & (1 << 3)) == 0)
-                    Sound.Chn4.vol = (Sound.Chn4.vol + 2) & 0xF;
+    Sound.Chn4.limittime = value & (1 << 6);
 
-                if ((Sound.Chn4.reg[2] ^ value) & (1 << 3))
-                    Sound.Chn4.vol = 0x10 - Sound.Chn4.vol;
+    if (value & (1 << 7))
+    {
+        Sound.Chn4.running = 1;
+
+        // Update envelope
+        Sound.Chn4.vol = (Sound.Chn4.reg[2] >> 4);
+        Sound.Chn4.envelope = Sound.Chn4.reg[2] & 0x07;
+        Sound.Chn4.envactive = 1; // Sound.Chn4.envelope != 0;
+        Sound.Chn4.envincrease = Sound.Chn4.reg[2] & (1 << 3);
+        Sound.Chn4.envstepstochange = Sound.Chn4.envelope << 2;
+        Sound.leftvol_4 = Sound.Chn4.speakerleft ?
+                                (Sound.Chn4.vol * Sound.leftvol) : 0;
+        Sound.rightvol_4 = Sound.Chn4.speakerright ?
+                                (Sound.Chn4.vol * Sound.rightvol) : 0;
+
+        mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 3);
+    }
+    else
+    {
+        //mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 3);
+    }
+}
 
-                Sound.leftvol_4 = Sound.Chn4.speakerleft ?
-                                        (Sound.Chn4.vol * Sound.leftvol) : 0;
-                Sound.rightvol_4 = Sound.Chn4.speakerright ?
-                                        (Sound.Chn4.vol * Sound.rightvol) : 0;
-            }
-#endif
-            return;
-        case NR43_REG:
-            Sound.Chn4.reg[3] = value;
+// Control
+// -------
 
-            Sound.Chn4.shift = (value >> 4) & 0x0F;
-            Sound.Chn4.width_7 = value & (1 << 3);
-            Sound.Chn4.freq_ratio = value & 0x07;
+static void GB_SoundWriteNR50(u32 value)
+{
+    Sound.rightvol = value & 0x7;
+    Sound.leftvol = (value >> 4) & 0x7;
+    Sound.leftvol_1 = Sound.Chn1.speakerleft ?
+                                (Sound.Chn1.vol * Sound.leftvol) : 0;
+    Sound.rightvol_1 = Sound.Chn1.speakerright ?
+                                (Sound.Chn1.vol * Sound.rightvol) : 0;
+    Sound.leftvol_2 = Sound.Chn2.speakerleft ?
+                                (Sound.Chn2.vol * Sound.leftvol) : 0;
+    Sound.rightvol_2 = Sound.Chn2.speakerright ?
+                                (Sound.Chn2.vol * Sound.rightvol) : 0;
+    Sound.leftvol_3 = Sound.Chn3.speakerleft ?
+                                (Sound.Chn3.vol * Sound.leftvol) : 0;
+    Sound.rightvol_3 = Sound.Chn3.speakerright ?
+                                (Sound.Chn3.vol * Sound.rightvol) : 0;
+    Sound.leftvol_4 = Sound.Chn4.speakerleft ?
+                                (Sound.Chn4.vol * Sound.leftvol) : 0;
+    Sound.rightvol_4 = Sound.Chn4.speakerright ?
+                                (Sound.Chn4.vol * Sound.rightvol) : 0;
+}
 
-            if (Sound.Chn4.shift > 13)
-            {
-                Sound.Chn4.outfreq = 0;
-                return;
-            }
+static void GB_SoundWriteNR51(u32 value)
+{
+    Sound.Chn1.speakerright = (value & (1 << 0));
+    Sound.Chn1.speakerleft = (value & (1 << 4));
+    Sound.Chn2.speakerright = (value & (1 << 1));
+    Sound.Chn2.speakerleft = (value & (1 << 5));
+    Sound.Chn3.speakerright = (value & (1 << 2));
+    Sound.Chn3.speakerleft = (value & (1 << 6));
+    Sound.Chn4.speakerright = (value & (1 << 3));
+    Sound.Chn4.speakerleft = (value & (1 << 7));
+    Sound.leftvol_1 = Sound.Chn1.speakerleft ?
+                                (Sound.Chn1.vol * Sound.leftvol) : 0;
+    Sound.rightvol_1 = Sound.Chn1.speakerright ?
+                                (Sound.Chn1.vol * Sound.rightvol) : 0;
+    Sound.leftvol_2 = Sound.Chn2.speakerleft ?
+                                (Sound.Chn2.vol * Sound.leftvol) : 0;
+    Sound.rightvol_2 = Sound.Chn2.speakerright ?
+                                (Sound.Chn2.vol * Sound.rightvol) : 0;
+    Sound.leftvol_3 = Sound.Chn3.speakerleft ?
+                                (Sound.Chn3.vol * Sound.leftvol) : 0;
+    Sound.rightvol_3 = Sound.Chn3.speakerright ?
+                                (Sound.Chn3.vol * Sound.rightvol) : 0;
+    Sound.leftvol_4 = Sound.Chn4.speakerleft ?
+                                (Sound.Chn4.vol * Sound.leftvol) : 0;
+    Sound.rightvol_4 = Sound.Chn4.speakerright ?
+                                (Sound.Chn4.vol * Sound.rightvol) : 0;
+}
 
-            //const s32 NoiseFreqRatio[8] = {
-            //    1048576, 524288, 370728, 262144, 220436, 185364, 155872,
-            //    131072
-            //};
-            const s32 NoiseFreqRatio[8] = {
-                1048576, 524288, 262144, 174763, 131072, 104858, 87381, 74898
-            };
-
-            Sound.Chn4.outfreq = NoiseFreqRatio[Sound.Chn4.freq_ratio]
-                                 >> (Sound.Chn4.shift + 1);
-            if (Sound.Chn4.outfreq > (1 << 18))
-                Sound.Chn4.outfreq = 1 << 18;
-            return;
-        case NR44_REG:
-            Sound.Chn4.reg[4] = value;
-
-            Sound.Chn4.limittime = value & (1 << 6);
-
-            if (value & (1 << 7))
-            {
-                Sound.Chn4.running = 1;
-
-                // Update envelope
-                Sound.Chn4.vol = (Sound.Chn4.reg[2] >> 4);
-                Sound.Chn4.envelope = Sound.Chn4.reg[2] & 0x07;
-                Sound.Chn4.envactive = 1; // Sound.Chn4.envelope != 0;
-                Sound.Chn4.envincrease = Sound.Chn4.reg[2] & (1 << 3);
-                Sound.Chn4.envstepstochange = Sound.Chn4.envelope << 2;
-                Sound.leftvol_4 = Sound.Chn4.speakerleft ?
-                                        (Sound.Chn4.vol * Sound.leftvol) : 0;
-                Sound.rightvol_4 = Sound.Chn4.speakerright ?
-                                        (Sound.Chn4.vol * Sound.rightvol) : 0;
+static void GB_SoundWriteNR52(u32 value)
+{
+    if ((value & (1 << 7)) == 0)
+    {
+        GB_SoundPowerOff();
+        Sound.master_enable = 0;
+    }
+}
 
-                mem->IO_Ports[NR52_REG - 0xFF00] |= (1 << 3);
-            }
-            else
-            {
-                //mem->IO_Ports[NR52_REG - 0xFF00] &= ~(1 << 3);
-            }
-            return;
+// Indexed by address - NR10_REG
+static void (*const gb_sound_reg_write[])(u32) = {
+    GB_SoundWriteNR10,
+    GB_SoundWriteNR11,
+    GB_SoundWriteNR12,
+    GB_SoundWriteNR13,
+    GB_SoundWriteNR14,
+    NULL,
+    GB_SoundWriteNR21,
+    GB_SoundWriteNR22,
+    GB_SoundWriteNR23,
+    GB_SoundWriteNR24,
+    GB_SoundWriteNR30,
+    GB_SoundWriteNR31,
+    GB_SoundWriteNR32,
+    GB_SoundWriteNR33,
+    GB_SoundWriteNR34,
+    NULL,
+    GB_SoundWriteNR41,
+    GB_SoundWriteNR42,
+    GB_SoundWriteNR43,
+    GB_SoundWriteNR44,
+    GB_SoundWriteNR50,
+    GB_SoundWriteNR51,
+    GB_SoundWriteNR52,
+};
 
-        // Control
-        // -------
+void GB_SoundRegWrite(u32 address, u32 value)
+{
+    //fprintf(stdout, "%04x - %02x\r\n", address, value);
 
-        case NR50_REG:
-            Sound.rightvol = value & 0x7;
-            Sound.leftvol = (value >> 4) & 0x7;
-            Sound.leftvol_1 = Sound.Chn1.speakerleft ?
-                                        (Sound.Chn1.vol * Sound.leftvol) : 0;
-            Sound.rightvol_1 = Sound.Chn1.speakerright ?
-                                        (Sound.Chn1.vol * Sound.rightvol) : 0;
-            Sound.leftvol_2 = Sound.Chn2.speakerleft ?
-                                        (Sound.Chn2.vol * Sound.leftvol) : 0;
-            Sound.rightvol_2 = Sound.Chn2.speakerright ?
-                                        (Sound.Chn2.vol * Sound.rightvol) : 0;
-            Sound.leftvol_3 = Sound.Chn3.speakerleft ?
-                                        (Sound.Chn3.vol * Sound.leftvol) : 0;
-            Sound.rightvol_3 = Sound.Chn3.speakerright ?
-                                        (Sound.Chn3.vol * Sound.rightvol) : 0;
-            Sound.leftvol_4 = Sound.Chn4.speakerleft ?
-                                        (Sound.Chn4.vol * Sound.leftvol) : 0;
-            Sound.rightvol_4 = Sound.Chn4.speakerright ?
-                                        (Sound.Chn4.vol * Sound.rightvol) : 0;
-            return;
-        case NR51_REG:
-            Sound.Chn1.speakerright = (value & (1 << 0));
-            Sound.Chn1.speakerleft = (value & (1 << 4));
-            Sound.Chn2.speakerright = (value & (1 << 1));
-            Sound.Chn2.speakerleft = (value & (1 << 5));
-            Sound.Chn3.speakerright = (value & (1 << 2));
-            Sound.Chn3.speakerleft = (value & (1 << 6));
-            Sound.Chn4.speakerright = (value & (1 << 3));
-            Sound.Chn4.speakerleft = (value & (1 << 7));
-            Sound.leftvol_1 = Sound.Chn1.speakerleft ?
-                                        (Sound.Chn1.vol * Sound.leftvol) : 0;
-            Sound.rightvol_1 = Sound.Chn1.speakerright ?
-                                        (Sound.Chn1.vol * Sound.rightvol) : 0;
-            Sound.leftvol_2 = Sound.Chn2.speakerleft ?
-                                        (Sound.Chn2.vol * Sound.leftvol) : 0;
-            Sound.rightvol_2 = Sound.Chn2.speakerright ?
-                                        (Sound.Chn2.vol * Sound.rightvol) : 0;
-            Sound.leftvol_3 = Sound.Chn3.speakerleft ?
-                                        (Sound.Chn3.vol * Sound.leftvol) : 0;
-            Sound.rightvol_3 = Sound.Chn3.speakerright ?
-                                        (Sound.Chn3.vol * Sound.rightvol) : 0;
-            Sound.leftvol_4 = Sound.Chn4.speakerleft ?
-                                        (Sound.Chn4.vol * Sound.leftvol) : 0;
-            Sound.rightvol_4 = Sound.Chn4.speakerright ?
-                                        (Sound.Chn4.vol * Sound.rightvol) : 0;
-            return;
-        case NR52_REG:
-            if ((value & (1 << 7)) == 0)
-            {
-                GB_SoundPowerOff();
-                Sound.master_enable = 0;
-            }
-            return;
-        default:
-            Debug_DebugMsgArg("GB Sound: [%04x]=%02x (?)\n", address, value);
-            return;
+    if (Sound.master_enable == 0)
+    {
+        if ((address == NR52_REG) && (value & (1 << 7)))
+        {
+            GB_SoundPowerOn();
+            Sound.master_enable = 1;
+        }
+        return;
+    }
+
+    u32 index = address - NR10_REG;
+    if ((index < ARRAY_NUM_ELEMENTS(gb_sound_reg_write))
+        && (gb_sound_reg_write[index] != NULL))
+    {
+        gb_sound_reg_write[index](value);
+        return;
     }
+
+    Debug_DebugMsgArg("GB Sound: [%04x]=%02x (?)\n", address, value);
 }
 
 void GB_SoundEnd(void)
@@ -904,7 +1123,7 @@ void GB_SoundEnd(void)
 
 //----------------------------------------------------------------
 
-static int gb_sound_clock_counter = 0;
+static core_local__ int gb_sound_clock_counter = 0;
 
 void GB_SoundClockCounterReset(void)
 {
@@ -921,6 +1140,11 @@ static void GB_SoundClockCounterSet(int new_reference_clocks)
     gb_sound_clock_counter = new_reference_clocks;
 }
 
+static int GB_SoundSampleClocksGet(void)
+{
+    return GB_SOUND_SAMPLE_CLOCKS << GameBoy.Emulator.DoubleSpeed;
+}
+
 void GB_SoundUpdateClocksCounterReference(int reference_clocks)
 {
     _GB_MEMORY_ *mem = &GameBoy.Memory;
@@ -931,37 +1155,26 @@ void GB_SoundUpdateClocksCounterReference(int reference_clocks)
 
     Sound.clocks += increment_clocks;
 
-    if (output_enabled)
+    if (output_enabled && (output_suspended == 0))
     {
         Sound.nextsample_clocks += increment_clocks;
 
-        // This is an ugly hack to make sound buffer not overflow or underflow
-
-        // 4194304 Hz CPU / 22050 Hz sound output.
-        if (Sound.samples_left_to_output >
-                        Sound.samples_left_to_input - (GB_BUFFER_SAMPLES / 2))
+        int clocks_ref = GB_SoundSampleClocksGet();
+        if (Sound.nextsample_clocks > clocks_ref)
         {
-            int clocks_ref = (191 + 4) << GameBoy.Emulator.DoubleSpeed;
-            if (Sound.nextsample_clocks > clocks_ref)
-            {
-                Sound.nextsample_clocks -= clocks_ref;
-                GB_SoundMix();
-            }
-        }
-        else
-        {
-            int clocks_ref = (191 - 4) << GameBoy.Emulator.DoubleSpeed;
-            if (Sound.nextsample_clocks > clocks_ref)
-            {
-                Sound.nextsample_clocks -= clocks_ref;
-                GB_SoundMix();
-            }
+            Sound.nextsample_clocks -= clocks_ref;
+
+            _profile_section_e prev = Profile_Begin(PROFILE_APU);
+            GB_SoundMix();
+            Profile_End(prev);
         }
     }
 
     // 4194304 Hz CPU / 256 Steps per second
     if (Sound.clocks >= (16384 << GameBoy.Emulator.DoubleSpeed))
     {
+        _profile_section_e prev = Profile_Begin(PROFILE_APU);
+
         Sound.clocks -= 16384 << GameBoy.Emulator.DoubleSpeed;
         if (Sound.master_enable)
         {
@@ -1044,6 +1257,8 @@ void GB_SoundUpdateClocksCounterReference(int reference_clocks)
 
                         Sound.Chn1.outfreq = 131072
                                              / (2048 - Sound.Chn1.sweepfreq);
+                        Sound.Chn1.phaseinc =
+                                gb_sound_phase_inc(Sound.Chn1.outfreq * 16);
                     }
                     else
                     {
@@ -1183,18 +1398,35 @@ void GB_SoundUpdateClocksCounterReference(int reference_clocks)
                 }
             }
         }
+
+        Profile_End(prev);
     }
 
     GB_SoundClockCounterSet(reference_clocks);
 }
 
-int GB_SoundGetClocksToNextEvent(void)
+int GB_SoundGetClocksToNextUpdate(void)
 {
-    int clocks_to_next_event = 0x7FFFFFFF;
+    // Next step of the length, envelope and sweep counters
+    int clocks = (16384 << GameBoy.Emulator.DoubleSpeed) - (int)Sound.clocks;
 
-    // TODO
+    // Next output sample
+    if (output_enabled && (output_suspended == 0))
+    {
+        int sample_clocks = GB_SoundSampleClocksGet() + 1
+                            - (int)Sound.nextsample_clocks;
+        if (sample_clocks < clocks)
+            clocks = sample_clocks;
+    }
 
-    return clocks_to_next_event;
+    return clocks;
+}
+
+int GB_SoundGetClocksToNextEvent(void)
+{
+    // Only one output sample is generated per update, so the sound has to be
+    // updated at least once per sample.
+    return GB_SoundGetClocksToNextUpdate();
 }
 
 //----------------------------------------------------------------
@@ -1211,3 +1443,21 @@ void GB_SoundSetConfig(int vol, int chn_flags)
     EmulatorConfig.chn_flags &= 0x30;
     EmulatorConfig.chn_flags |= chn_flags;
 }
+
+//----------------------------------------------------------------
+
+void GB_SoundStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "SND ");
+    SaveState_Write(st, &Sound, sizeof(Sound));
+    SaveState_Write(st, GB_WavePattern, sizeof(GB_WavePattern));
+    SaveState_ChunkEnd(st);
+}
+
+void GB_SoundStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "SND ");
+    SaveState_Read(st, &Sound, sizeof(Sound));
+    SaveState_Read(st, GB_WavePattern, sizeof(GB_WavePattern));
+    SaveState_ChunkClose(st);
+}
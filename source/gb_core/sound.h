@@ -7,6 +7,9 @@
 #ifndef GB_SOUND__
 #define GB_SOUND__
 
+#include "../resample_utils.h"
+#include "../savestate_utils.h"
+
 #include "gameboy.h"
 
 void GB_SoundInit(void);
@@ -15,14 +18,30 @@ void GB_ToggleSound(void);
 void GB_SoundUpdate(u32 clocks);
 void GB_SoundRegWrite(u32 address, u32 value);
 void GB_SoundResetBufferPointers(void);
+void GB_SoundSetOutputSuspended(int suspended);
 void GB_SoundEnd(void);
 void GB_SoundCallback(void *buffer, long len);
+// Rate at which the samples are generated, in Hz
+u32 GB_SoundGetSampleRate(void);
+// Health of the buffer between the emulation and the audio callback
+void GB_SoundGetOutputStats(_resample_stats_t *stats);
+// Called at the end of each frame. The hash is the CRC32C of the samples that
+// were generated during the frame.
+void GB_SoundFrameEnd(void);
+u32 GB_SoundGetFrameHash(void);
 
 void GB_SoundClockCounterReset(void);
 void GB_SoundUpdateClocksCounterReference(int reference_clocks);
 int GB_SoundGetClocksToNextEvent(void);
 
+// Clocks left until an update does more than advancing the internal counters,
+// that is, until it mixes a sample or steps the length and envelope counters.
+int GB_SoundGetClocksToNextUpdate(void);
+
 void GB_SoundGetConfig(int *vol, int *chn_flags);
 void GB_SoundSetConfig(int vol, int chn_flags);
 
+void GB_SoundStateSave(_savestate_t *st);
+void GB_SoundStateLoad(_savestate_t *st);
+
 #endif // GB_SOUND__
@@ -11,7 +11,9 @@
 
 #include "../build_options.h"
 #include "../file_utils.h"
+#include "../hash_utils.h"
 #include "../png_utils.h"
+#include "../savestate_utils.h"
 
 #include "debug.h"
 #include "gameboy.h"
@@ -21,18 +23,56 @@
 #include "sound.h"
 #include "video.h"
 
-extern _GB_CONTEXT_ GameBoy;
-extern _SGB_INFO_ SGBInfo;
+extern core_local__ _GB_CONTEXT_ GameBoy;
+extern core_local__ _SGB_INFO_ SGBInfo;
 
 // Variables related to the GameBoy framebuffer
-static u32 gb_blur;
-static u32 gb_realcolors;
-static u32 gb_cur_fb;
-static u16 gb_framebuffer[2][256 * 224];
+static core_local__ u32 gb_blur;
+static core_local__ u32 gb_realcolors;
+static core_local__ u32 gb_cur_fb;
+static core_local__ u16 gb_framebuffer[2][256 * 224];
+
+// Set when the result of GB_Screen_WriteBuffer_24RGB() changes
+static core_local__ int gb_screen_changed = 1;
+static core_local__ int gb_framebuffer_last_diff = 1;
+// Hash of the last frame that has been drawn
+static core_local__ u32 gb_framebuffer_hash;
+
+// Called when a frame has been drawn. The hash of the frame is compared with
+// the one of the previous frame to know if the screen has changed. With blur,
+// the screen is the average of the last two frames, so it also changes if the
+// previous comparison did.
+static void gb_framebuffer_swap(void)
+{
+    u32 hash = Hash_CRC32C(0, gb_framebuffer[gb_cur_fb],
+                           sizeof(gb_framebuffer[0]));
+    int diff = hash != gb_framebuffer_hash;
+
+    if (diff || (gb_blur && gb_framebuffer_last_diff))
+        gb_screen_changed = 1;
+
+    gb_framebuffer_last_diff = diff;
+    gb_framebuffer_hash = hash;
+
+    gb_cur_fb ^= 1;
+}
+
+u32 GB_ScreenGetHash(void)
+{
+    return gb_framebuffer_hash;
+}
+
+int GB_ScreenHasChanged(void)
+{
+    if (GameBoy.Emulator.rumble)
+        return 1;
+
+    return gb_screen_changed;
+}
 
 //-----------------------------------------------------------
 
-static int gb_frameskip = 0;
+static core_local__ int gb_frameskip = 0;
 
 void GB_SkipFrame(int skip)
 {
@@ -49,14 +89,16 @@ int GB_HasToSkipFrame(void)
 void GB_EnableBlur(int enable)
 {
     gb_blur = enable;
+    gb_screen_changed = 1;
 }
 
 void GB_EnableRealColors(int enable)
 {
     gb_realcolors = enable;
+    gb_screen_changed = 1;
 }
 
-static u32 pal_red, pal_green, pal_blue;
+static core_local__ u32 pal_red, pal_green, pal_blue;
 
 void GB_ConfigGetPalette(u8 *red, u8 *green, u8 *blue)
 {
@@ -83,12 +125,278 @@ void GB_ConfigLoadPalette(void)
 // -------------------------------------------------------------
 // -------------------------------------------------------------
 
-static u32 gb_framebuffer_bgcolor0[256];
-static u32 gb_framebuffer_bgpriority[256]; // For GBC
+static core_local__ u32 gb_framebuffer_bgcolor0[256];
+static core_local__ u32 gb_framebuffer_bgpriority[256]; // For GBC
+
+static core_local__ int window_current_line;
+
+core_local__ u16 gb_tile_row_expand[2][256];
+
+static void gb_tile_row_expand_fill(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        u32 normal = 0;
+        u32 flipped = 0;
+
+        for (int x = 0; x < 8; x++)
+        {
+            if (i & (1 << (7 - x)))
+                normal |= 1 << (x * 2);
+            if (i & (1 << x))
+                flipped |= 1 << (x * 2);
+        }
+
+        gb_tile_row_expand[0][i] = normal;
+        gb_tile_row_expand[1][i] = flipped;
+    }
+}
+
+static int min(int a, int b)
+{
+    return (a < b) ? a : b;
+}
+
+// Draws pixels x to x_end - 1 of a line of the BG or window with a DMG
+// palette. map_x and map_y are the coordinates inside the map of pixel x.
+static void gb_draw_map_line(u16 *dst, int x, int x_end, const u8 *tilemap,
+                             const u8 *tiledata, int tile_base_8800,
+                             u32 map_x, u32 map_y, const u32 *pal)
+{
+    const u8 *map_row = &tilemap[((map_y >> 3) & 31) * 32];
+    u32 line_offset = (map_y & 7) * 2;
+
+    while (x < x_end)
+    {
+        u32 tile = map_row[(map_x >> 3) & 31];
+
+        if (tile_base_8800)
+            tile ^= 0x80;
+
+        u32 row = GB_TileRowDecode(&tiledata[(tile << 4) + line_offset], 0);
+
+        int skip = map_x & 7;
+        int count = min(8 - skip, x_end - x);
+
+        row >>= skip * 2;
+        map_x += count;
+
+        for ( ; count > 0; count--, row >>= 2, x++)
+        {
+            u32 color = row & 3;
+            dst[x] = pal[color];
+            gb_framebuffer_bgcolor0[x] = (color == 0);
+        }
+    }
+}
+
+// Same as gb_draw_map_line(), but it uses the GBC tile attributes.
+static void gbc_draw_map_line(u16 *dst, int x, int x_end, const u8 *tilemap,
+                              const u8 *tiledata, int tile_base_8800,
+                              u32 map_x, u32 map_y)
+{
+    u32 map_row = ((map_y >> 3) & 31) * 32;
+
+    while (x < x_end)
+    {
+        u32 tile_location = map_row + ((map_x >> 3) & 31);
+        u32 tile = tilemap[tile_location];
+        u32 tileinfo = tilemap[tile_location + 0x2000];
+
+        if (tile_base_8800)
+            tile ^= 0x80;
+
+        // Bank 1?
+        const u8 *data = &tiledata[(tile << 4)
+                                   + ((tileinfo & (1 << 3)) ? 0x2000 : 0)];
+
+        // V flip
+        if (tileinfo & (1 << 6))
+            data += (7 - (map_y & 7)) * 2;
+        else
+            data += (map_y & 7) * 2;
+
+        // H flip
+        u32 row = GB_TileRowDecode(data, (tileinfo & (1 << 5)) != 0);
+
+        const u32 *pal = &GameBoy.Emulator.bg_pal_color[(tileinfo & 7) * 4];
+        u32 priority = ((tileinfo & (1 << 7)) != 0);
+
+        int skip = map_x & 7;
+        int count = min(8 - skip, x_end - x);
+
+        row >>= skip * 2;
+        map_x += count;
+
+        for ( ; count > 0; count--, row >>= 2, x++)
+        {
+            u32 color = row & 3;
+            dst[x] = pal[color];
+            gb_framebuffer_bgcolor0[x] = (color == 0);
+            gb_framebuffer_bgpriority[x] = priority;
+        }
+    }
+}
+
+// Sprites that are visible in each line, up to 10, in OAM order. They only
+// change when the OAM or the height of the sprites change, so they are found
+// once for all lines instead of checking the 40 sprites in each line.
+typedef struct
+{
+    u8 count;
+    u8 index[10];
+} _gb_sprite_line_t;
+
+static core_local__ _gb_sprite_line_t gb_sprite_lines[144];
+static core_local__ s32 gb_sprite_lines_height;
+
+static const _gb_sprite_line_t *gb_sprite_line_get(s32 y, s32 spriteheight)
+{
+    int dirty = GB_MemDirtyCheck(GB_DIRTY_OAM, GB_DIRTY_USER_SPRLINES,
+                                 0, 40 * 4);
+
+    if (dirty || (gb_sprite_lines_height != spriteheight))
+    {
+        _GB_OAM_ *GB_OAM = (void *)GameBoy.Memory.ObjAttrMem;
+
+        for (int l = 0; l < 144; l++)
+            gb_sprite_lines[l].count = 0;
+
+        for (int a = 0; a < 40; a++)
+        {
+            s32 real_y = GB_OAM->Sprite[a].Y - 16;
+            s32 first = (real_y < 0) ? 0 : real_y;
+            s32 last = min(real_y + spriteheight, 144);
+
+            for (s32 l = first; l < last; l++)
+            {
+                _gb_sprite_line_t *line = &gb_sprite_lines[l];
+                if (line->count < 10)
+                    line->index[line->count++] = a;
+            }
+        }
+
+        gb_sprite_lines_height = spriteheight;
+    }
+
+    return &gb_sprite_lines[y];
+}
+
+// The BG and window of each line drawn by GB_ScreenDrawScanline() are saved
+// with the state they were drawn with. If nothing they depend on has changed
+// in the next frame, they are copied instead of being drawn again, which is
+// what happens in most frames of menus and dialogs.
+//
+// VRAM writes are tracked per page: Each page holds the value of a counter at
+// the last time it was seen dirty, and a line is only valid if none of the
+// pages it reads has been written after it was drawn.
+
+typedef struct
+{
+    u32 lcd_reg;
+    u32 bgp_reg;
+    u32 scx_reg;
+    u32 scy_reg;
+    u32 wx_reg;
+    s32 win_x;
+    s32 win_line;
+} _gb_bg_line_key_t;
+
+typedef struct
+{
+    int valid;
+    u32 stamp;
+    _gb_bg_line_key_t key;
+    u16 pixels[160];
+    u32 bgcolor0[160];
+} _gb_bg_line_t;
+
+static core_local__ _gb_bg_line_t gb_bg_lines[144];
+
+static core_local__ u32 gb_vram_stamp;
+static core_local__ u32 gb_vram_page_stamp[0x2000 >> GB_DIRTY_PAGE_SHIFT];
+
+static void gb_bg_lines_invalidate(void)
+{
+    for (int y = 0; y < 144; y++)
+        gb_bg_lines[y].valid = 0;
+}
+
+static void gb_vram_stamps_update(void)
+{
+    u32 now = gb_vram_stamp + 1;
+    int changed = 0;
+
+    for (u32 p = 0; p < (0x2000 >> GB_DIRTY_PAGE_SHIFT); p++)
+    {
+        if (gb_dirty_vram[p] & GB_DIRTY_USER_BGLINES)
+        {
+            gb_dirty_vram[p] &= ~GB_DIRTY_USER_BGLINES;
+            gb_vram_page_stamp[p] = now;
+            changed = 1;
+        }
+    }
+
+    if (changed)
+        gb_vram_stamp = now;
+}
+
+static int gb_vram_range_changed(u32 offset, u32 size, u32 stamp)
+{
+    u32 first = offset >> GB_DIRTY_PAGE_SHIFT;
+    u32 last = (offset + size - 1) >> GB_DIRTY_PAGE_SHIFT;
+
+    for (u32 p = first; p <= last; p++)
+    {
+        if (gb_vram_page_stamp[p] > stamp)
+            return 1;
+    }
+
+    return 0;
+}
+
+// Copies the saved line to dst if it is still valid. The map offsets are the
+// rows of the tile maps read by the BG and the window.
+static int gb_bg_line_reuse(int y, u16 *dst, const _gb_bg_line_key_t *key,
+                            u32 bg_row_offset, u32 win_row_offset)
+{
+    _gb_bg_line_t *line = &gb_bg_lines[y];
+
+    if (!line->valid || memcmp(&line->key, key, sizeof(*key)) != 0)
+        return 0;
+
+    if (key->lcd_reg & (1 << 0))
+    {
+        u32 tiledata = (key->lcd_reg & (1 << 4)) ? 0x0000 : 0x0800;
+
+        if (gb_vram_range_changed(tiledata, 0x1000, line->stamp)
+            || gb_vram_range_changed(bg_row_offset, 32, line->stamp))
+            return 0;
+
+        if ((key->win_x < 160)
+            && gb_vram_range_changed(win_row_offset, 32, line->stamp))
+            return 0;
+    }
+
+    memcpy(dst, line->pixels, sizeof(line->pixels));
+    memcpy(gb_framebuffer_bgcolor0, line->bgcolor0, sizeof(line->bgcolor0));
+
+    return 1;
+}
+
+static void gb_bg_line_save(int y, const u16 *src,
+                            const _gb_bg_line_key_t *key)
+{
+    _gb_bg_line_t *line = &gb_bg_lines[y];
 
-static int window_current_line;
+    line->valid = 1;
+    line->stamp = gb_vram_stamp;
+    line->key = *key;
+    memcpy(line->pixels, src, sizeof(line->pixels));
+    memcpy(line->bgcolor0, gb_framebuffer_bgcolor0, sizeof(line->bgcolor0));
+}
 
-static u32 gbpalettes[4] = {
+static core_local__ u32 gbpalettes[4] = {
     GB_RGB(31, 31, 31), GB_RGB(21, 21, 21), GB_RGB(10, 10, 10), GB_RGB(0, 0, 0)
 };
 
@@ -99,6 +407,8 @@ void GB_SetPalette(u32 red, u32 green, u32 blue)
                            ((blue * 2) / 3) >> 3);
     gbpalettes[2] = GB_RGB((red / 3) >> 3, (green / 3) >> 3, (blue / 3) >> 3);
     gbpalettes[3] = GB_RGB(0, 0, 0);
+
+    gb_bg_lines_invalidate();
 }
 
 u32 GB_GameBoyGetGray(u32 number)
@@ -138,7 +448,7 @@ void GB_ScreenDrawScanline(s32 y)
             for (int x = 0; x < 160; x++)
                 gb_framebuffer[gb_cur_fb][base_index + x] = GB_RGB(31, 31, 31);
             if (y == 143)
-                gb_cur_fb ^= 1;
+                gb_framebuffer_swap();
             return;
         }
 
@@ -179,91 +489,63 @@ void GB_ScreenDrawScanline(s32 y)
         u8 *wintilemap = (lcd_reg & (1 << 6)) ?
                             &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
 
-        bool increase_win = false;
+        int tile_base_8800 = !(lcd_reg & (1 << 4));
+        u16 *dst = &gb_framebuffer[gb_cur_fb][base_index];
 
         // Draw BG + window
-        for (int x = 0; x < 160; x++)
-        {
-            u32 color = bg_pal[0];
-            bool window_draw = 0;
-            bool bg_color0 = false;
-
-            if (window_current_line >= 0)
-            {
-                if ((lcd_reg & (1 << 5)) && (lcd_reg & (1 << 0))) // Window
-                {
-                    if (wy_reg <= y)
-                    {
-                        if ((wx_reg < 8)
-                            || ((wx_reg > 7) && ((wx_reg - 7) <= x)))
-                        {
-                            increase_win = true;
-
-                            u32 y_ = window_current_line;
-                            u32 x_ = x - wx_reg;
-                            u32 tile = wintilemap[((y_ >> 3) * 32)
-                                                  + ((x_ + 7) >> 3)];
-
-                            if (!(lcd_reg & (1 << 4))) // If tile base is 0x8800
-                            {
-                                if (tile & (1 << 7))
-                                    tile &= 0x7F;
-                                else
-                                    tile += 128;
-                            }
 
-                            u8 *data = &tiledata[tile << 4];
-
-                            data += (y_ & 7) * 2;
+        int win_x = 160; // First pixel of the window
+        if ((window_current_line >= 0) && (lcd_reg & (1 << 5))
+            && (lcd_reg & (1 << 0)) && (wy_reg <= y))
+        {
+            win_x = (wx_reg < 8) ? 0 : min(wx_reg - 7, 160);
+        }
 
-                            x_ = 7 - ((x_ + 7) & 7);
+        _gb_bg_line_key_t key = {
+            .lcd_reg = lcd_reg & ~((1 << 1) | (1 << 2)), // Ignore sprites
+            .bgp_reg = bgp_reg,
+            .scx_reg = scx_reg,
+            .scy_reg = scy_reg,
+            .wx_reg = (win_x < 160) ? wx_reg : 0,
+            .win_x = win_x,
+            .win_line = (win_x < 160) ? window_current_line : 0,
+        };
 
-                            color = ((*data >> x_) & 1)
-                                    | ((((*(data + 1)) >> x_) << 1) & 2);
+        u32 bg_row_offset = (bgtilemap - mem->VideoRAM)
+                            + (((y + scy_reg) >> 3) & 31) * 32;
+        u32 win_row_offset = (wintilemap - mem->VideoRAM)
+                             + ((window_current_line >> 3) & 31) * 32;
 
-                            bg_color0 = (color == 0);
+        gb_vram_stamps_update();
 
-                            color = bg_pal[color];
-                            window_draw = true;
-                        }
-                    }
-                }
+        if (!gb_bg_line_reuse(y, dst, &key, bg_row_offset, win_row_offset))
+        {
+            if (lcd_reg & (1 << 0)) // BG
+            {
+                gb_draw_map_line(dst, 0, win_x, bgtilemap, tiledata,
+                                 tile_base_8800, scx_reg, y + scy_reg,
+                                 bg_pal);
             }
-
-            if (lcd_reg & (1 << 0) && (!window_draw)) // BG
+            else
             {
-                u32 x_ = x + scx_reg;
-                u32 y_ = y + scy_reg;
-
-                u32 tile = bgtilemap[(((y_ >> 3) & 31) * 32) + ((x_ >> 3) & 31)];
-
-                if (!(lcd_reg & (1 << 4))) // If tile base is 0x8800
+                for (int x = 0; x < 160; x++)
                 {
-                    if (tile & (1 << 7))
-                        tile &= 0x7F;
-                    else
-                        tile += 128;
+                    dst[x] = bg_pal[0];
+                    gb_framebuffer_bgcolor0[x] = false;
                 }
+            }
 
-                u8 *data = &tiledata[tile << 4];
-
-                data += (y_ & 7) << 1;
-
-                x_ = 7 - (x_ & 7);
-
-                color =
-                        ((*data >> x_) & 1) | ((((*(data + 1)) >> x_) << 1) & 2);
-
-                bg_color0 = (color == 0);
-
-                color = bg_pal[color];
+            if (win_x < 160) // Window
+            {
+                gb_draw_map_line(dst, win_x, 160, wintilemap, tiledata,
+                                 tile_base_8800, win_x + 7 - wx_reg,
+                                 window_current_line, bg_pal);
             }
 
-            gb_framebuffer[gb_cur_fb][base_index + x] = color;
-            gb_framebuffer_bgcolor0[x] = bg_color0;
+            gb_bg_line_save(y, dst, &key);
         }
 
-        if (increase_win)
+        if (win_x < 160)
             window_current_line++;
 
         // If sprites are enabled, draw the ones visible this scanline
@@ -277,95 +559,62 @@ void GB_ScreenDrawScanline(s32 y)
             // For 8x16 sprites, last bit is ignored
             u32 tilemask = ((spriteheight == 16) ? 0xFE : 0xFF);
 
-            u32 spritesdrawn = 0; // For the 10-sprites-per-scanline limit
-            u32 drawsprite[40];
+            // Limited to 10 sprites per scanline
+            const _gb_sprite_line_t *line = gb_sprite_line_get(y,
+                                                               spriteheight);
 
-            for (int a = 0; a < 40; a++)
+            for (int i = line->count - 1; i >= 0; i--)
             {
-                GB_Sprite = &GB_OAM->Sprite[a];
-
-                drawsprite[a] = 0;
-
-                s32 real_y = GB_Sprite->Y - 16;
-
-                if ((real_y <= y) && ((real_y + spriteheight) > y))
-                {
-                    if (spritesdrawn < 10)
-                    {
-                        drawsprite[a] = 1;
-                        spritesdrawn++;
-                    }
-                }
-            }
+                GB_Sprite = &GB_OAM->Sprite[line->index[i]];
 
-            for (int a = 39; a >= 0; a--)
-            {
                 // TODO: Fix.
                 // When sprites with different x coordinate values overlap, the
                 // one with the smaller x coordinate (closer to the left) will
                 // have priority and appear above any others. This applies in
                 // Non CGB Mode only.
 
-                if (drawsprite[a])
+                s32 real_y = GB_Sprite->Y - 16;
+
+                if ((real_y <= y) && ((real_y + spriteheight) > y))
                 {
-                    GB_Sprite = &GB_OAM->Sprite[a];
+                    u32 tile = GB_Sprite->Tile & tilemask;
+
+                    u8 *data = &mem->VideoRAM[tile << 4];
 
-                    s32 real_y = GB_Sprite->Y - 16;
+                    // Flip Y
+                    if (GB_Sprite->Info & (1 << 6))
+                        data += (spriteheight - y + real_y - 1) * 2;
+                    else
+                        data += (y - real_y) * 2;
 
-                    if ((real_y <= y) && ((real_y + spriteheight) > y))
-                    {
-                        u32 tile = GB_Sprite->Tile & tilemask;
+                    // Flip X
+                    u32 row = GB_TileRowDecode(data,
+                                    (GB_Sprite->Info & (1 << 5)) != 0);
 
-                        u8 *data = &mem->VideoRAM[tile << 4];
+                    u32 *spr_pal = (GB_Sprite->Info & (1 << 4)) ?
+                                   spr_pal1 : spr_pal0;
 
-                        // Flip Y
-                        if (GB_Sprite->Info & (1 << 6))
-                            data += (spriteheight - y + real_y - 1) * 2;
-                        else
-                            data += (y - real_y) * 2;
+                    // If BG has priority and it is enabled...
+                    int bg_priority = (GB_Sprite->Info & (1 << 7))
+                                      && (lcd_reg & (1 << 0));
 
-                        // Lets draw the sprite...
-                        s32 real_x = GB_Sprite->X - 8;
-                        for (int x__ = 0; x__ < 8; x__++)
-                        {
-                            u32 color = ((*data >> x__) & 1)
-                                        | ((((*(data + 1)) >> x__) << 1) & 2);
+                    // Lets draw the sprite...
+                    s32 x_ = GB_Sprite->X - 8;
+                    for ( ; row != 0; row >>= 2, x_++)
+                    {
+                        u32 color = row & 3;
 
-                            if (color != 0) // Color 0 is transparent
-                            {
-                                if (GB_Sprite->Info & (1 << 4))
-                                    color = spr_pal1[color];
-                                else
-                                    color = spr_pal0[color];
+                        if (color == 0) // Color 0 is transparent
+                            continue;
 
-                                s32 x_ = real_x;
+                        if ((x_ < 0) || (x_ >= 160))
+                            continue;
 
-                                // Flip X
-                                if (GB_Sprite->Info & (1 << 5))
-                                    x_ = x_ + x__;
-                                else
-                                    x_ += 7 - x__;
+                        if (bg_priority && !gb_framebuffer_bgcolor0[x_])
+                            continue;
 
-                                if (x_ >= 0 && x_ < 160)
-                                {
-                                    // If BG has priority and it is enabled...
-                                    if ((GB_Sprite->Info & (1 << 7))
-                                        && (lcd_reg & (1 << 0)))
-                                    {
-                                        if (gb_framebuffer_bgcolor0[x_])
-                                        {
-                                            gb_framebuffer[gb_cur_fb]
-                                                          [base_index + x_] = color;
-                                        }
-                                    }
-                                    else
-                                    {
-                                        gb_framebuffer[gb_cur_fb]
-                                                      [base_index + x_] = color;
-                                    }
-                                }
-                            }
-                        }
+                        gb_framebuffer[gb_cur_fb][base_index + x_] =
+                                spr_pal[color];
                     }
                 }
             }
@@ -380,23 +629,32 @@ void GB_ScreenDrawScanline(s32 y)
     }
 
     if (y == 143)
-        gb_cur_fb ^= 1;
+        gb_framebuffer_swap();
 }
 
 //******************************************************************************
 
+void GBC_PaletteColorUpdate(int index)
+{
+    u32 pal_ram_index = index & 0x3E;
+
+    GameBoy.Emulator.bg_pal_color[pal_ram_index >> 1] =
+            (GameBoy.Emulator.bg_pal[pal_ram_index]
+             | (GameBoy.Emulator.bg_pal[pal_ram_index + 1] << 8)) & 0x7FFF;
+
+    GameBoy.Emulator.spr_pal_color[pal_ram_index >> 1] =
+            (GameBoy.Emulator.spr_pal[pal_ram_index]
+             | (GameBoy.Emulator.spr_pal[pal_ram_index + 1] << 8)) & 0x7FFF;
+}
+
 u32 gbc_getbgpalcolor(int pal, int color)
 {
-    u32 pal_ram_index = (pal * 8) + (2 * color);
-    return GameBoy.Emulator.bg_pal[pal_ram_index]
-           | (GameBoy.Emulator.bg_pal[pal_ram_index + 1] << 8);
+    return GameBoy.Emulator.bg_pal_color[(pal * 4) + color];
 }
 
 u32 gbc_getsprpalcolor(int pal, int color)
 {
-    u32 pal_ram_index = (pal * 8) + (2 * color);
-    return GameBoy.Emulator.spr_pal[pal_ram_index]
-           | (GameBoy.Emulator.spr_pal[pal_ram_index + 1] << 8);
+    return GameBoy.Emulator.spr_pal_color[(pal * 4) + color];
 }
 
 void GBC_ScreenDrawScanline(s32 y)
@@ -437,7 +695,7 @@ void GBC_ScreenDrawScanline(s32 y)
             for (int x = 0; x < 160; x++)
                 gb_framebuffer[gb_cur_fb][base_index + x] = color_;
             if (y == 143)
-                gb_cur_fb ^= 1;
+                gb_framebuffer_swap();
             return;
         }
 
@@ -455,126 +713,28 @@ void GBC_ScreenDrawScanline(s32 y)
         u8 *wintilemap = (lcd_reg & (1 << 6)) ?
                                 &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
 
-        bool increase_win = false;
+        int tile_base_8800 = !(lcd_reg & (1 << 4));
+        u16 *dst = &gb_framebuffer[gb_cur_fb][base_index];
 
         // Draw BG + window
-        for (int x = 0; x < 160; x++)
-        {
-            u32 color = GB_RGB(31, 31, 31);
-            bool window_draw = 0;
-            bool color0 = false;
-            u32 tileinfo;
 
-            if (window_current_line >= 0)
-            {
-                if (lcd_reg & (1 << 5)) // Window
-                {
-                    if (wy_reg <= y)
-                    {
-                        if ((wx_reg < 8)
-                            || ((wx_reg > 7) && ((wx_reg - 7) <= x)))
-                        {
-                            increase_win = true;
-
-                            u32 y_ = window_current_line;
-                            u32 x_ = x - wx_reg;
-
-                            u32 tile_location = ((y_ >> 3) * 32)
-                                                + ((x_ + 7) >> 3);
-                            u32 tile = wintilemap[tile_location];
-                            tileinfo = wintilemap[tile_location + 0x2000];
-
-                            if (!(lcd_reg & (1 << 4))) // If tile base is 0x8800
-                            {
-                                if (tile & (1 << 7))
-                                    tile &= 0x7F;
-                                else
-                                    tile += 128;
-                            }
-
-                            // Bank 1?
-                            u8 *data = &tiledata[(tile << 4)
-                                    + ((tileinfo & (1 << 3)) ? 0x2000 : 0 )];
-
-                            // V flip
-                            if (tileinfo & (1 << 6))
-                                data += ((7 - y_) & 7) * 2;
-                            else
-                                data += (y_ & 7) * 2;
-
-                            u32 pal_index = tileinfo & 7;
-
-                            // H flip
-                            if (tileinfo & (1 << 5))
-                                x_ = (x_ + 7) & 7;
-                            else
-                                x_ = 7 - ((x_ + 7) & 7);
-
-                            color = ((*data >> x_) & 1)
-                                    | ((((*(data + 1)) >> x_) << 1) & 2);
-
-                            color0 = (color == 0);
-
-                            u32 pal_ram_index = (pal_index * 8) + (2 * color);
-                            color = GameBoy.Emulator.bg_pal[pal_ram_index]
-                                    | (GameBoy.Emulator.bg_pal[pal_ram_index + 1] << 8);
-                            window_draw = true;
-                        }
-                    }
-                }
-            }
-
-            if (!window_draw) // BG
-            {
-                u32 x_ = x + scx_reg;
-                u32 y_ = y + scy_reg;
-
-                u32 tile_location = (((y_ >> 3) & 31) * 32) + ((x_ >> 3) & 31);
-                u32 tile = bgtilemap[tile_location];
-                tileinfo = bgtilemap[tile_location + 0x2000];
-
-                if (!(lcd_reg & (1 << 4))) // If tile base is 0x8800
-                {
-                    if (tile & (1 << 7))
-                        tile &= 0x7F;
-                    else
-                        tile += 128;
-                }
-
-                // Bank 1?
-                u8 *data = &tiledata[(tile << 4)
-                                     + ((tileinfo & (1 << 3)) ? 0x2000 : 0)];
-
-                // V flip
-                if (tileinfo & (1 << 6))
-                    data += ((7 - y_) & 7) * 2;
-                else
-                    data += (y_ & 7) * 2;
-
-                // H flip
-                if (tileinfo & (1 << 5))
-                    x_ = x_ & 7;
-                else
-                    x_ = 7 - (x_ & 7);
-
-                color = ((*data >> x_) & 1)
-                        | ((((*(data + 1)) >> x_) << 1) & 2);
-                color0 = (color == 0);
-
-                u32 pal_index = tileinfo & 7;
-
-                u32 pal_ram_index = (pal_index * 8) + (2 * color);
-                color = GameBoy.Emulator.bg_pal[pal_ram_index]
-                        | (GameBoy.Emulator.bg_pal[pal_ram_index + 1] << 8);
-            }
-
-            gb_framebuffer[gb_cur_fb][base_index + x] = color;
-            gb_framebuffer_bgcolor0[x] = color0;
-            gb_framebuffer_bgpriority[x] = ((tileinfo & (1 << 7)) != 0);
+        int win_x = 160; // First pixel of the window
+        if ((window_current_line >= 0) && (lcd_reg & (1 << 5))
+            && (wy_reg <= y))
+        {
+            win_x = (wx_reg < 8) ? 0 : min(wx_reg - 7, 160);
         }
 
-        if (increase_win)
+        gbc_draw_map_line(dst, 0, win_x, bgtilemap, tiledata, tile_base_8800,
+                          scx_reg, y + scy_reg);
+
+        if (win_x < 160) // Window
+        {
+            gbc_draw_map_line(dst, win_x, 160, wintilemap, tiledata,
+                              tile_base_8800, win_x + 7 - wx_reg,
+                              window_current_line);
             window_current_line++;
+        }
 
         // If sprites are enabled, draw the ones visible this scanline
         // Note: The BG transparent color is bg_pal[0]
@@ -584,36 +744,16 @@ void GBC_ScreenDrawScanline(s32 y)
             _GB_OAM_ *GB_OAM = (void *)mem->ObjAttrMem;
             _GB_OAM_ENTRY_ *GB_Sprite;
 
-            // For 8x16 sprites, last bit is ignored
-            u32 tilemask = ((spriteheight == 16) ? 0xFE : 0xFF);
-
-            u32 spritesdrawn = 0; // For the 10-sprites-per-scanline limit
-            u32 drawsprite[40];
-
-            for (int a = 0; a < 40; a++)
-            {
-                GB_Sprite = &GB_OAM->Sprite[a];
-
-                drawsprite[a] = 0;
-
-                s32 real_y = GB_Sprite->Y - 16;
-
-                if ((real_y <= y) && ((real_y + spriteheight) > y))
-                {
-                    if (spritesdrawn < 10)
-                    {
-                        drawsprite[a] = 1;
-                        spritesdrawn++;
-                    }
-                }
-            }
-
-            for (int a = 39; a >= 0; a--)
-            {
-                if (!drawsprite[a])
-                    continue;
+            // For 8x16 sprites, last bit is ignored
+            u32 tilemask = ((spriteheight == 16) ? 0xFE : 0xFF);
+
+            // Limited to 10 sprites per scanline
+            const _gb_sprite_line_t *line = gb_sprite_line_get(y,
+                                                               spriteheight);
 
-                GB_Sprite = &GB_OAM->Sprite[a];
+            for (int i = line->count - 1; i >= 0; i--)
+            {
+                GB_Sprite = &GB_OAM->Sprite[line->index[i]];
 
                 s32 real_y = GB_Sprite->Y - 16;
 
@@ -632,31 +772,23 @@ void GBC_ScreenDrawScanline(s32 y)
                     else
                         data += (y - real_y) * 2;
 
-                    u32 pal_index = GB_Sprite->Info & 7;
+                    const u32 *pal = &GameBoy.Emulator.spr_pal_color
+                                            [(GB_Sprite->Info & 7) * 4];
 
-                    pal_index = pal_index * 8;
+                    // Flip X
+                    int hflip = (GB_Sprite->Info & (1 << 5)) != 0;
+                    u32 row = GB_TileRowDecode(data, hflip);
 
                     // Let's draw the sprite...
-                    s32 real_x = GB_Sprite->X - 8;
-                    for (int x__ = 0; x__ < 8; x__++)
+                    s32 x_ = GB_Sprite->X - 8;
+                    for ( ; row != 0; row >>= 2, x_++)
                     {
-                        u32 color = ((*data >> x__) & 1)
-                                    | ((((*(data + 1)) >> x__) << 1) & 2);
+                        u32 color = row & 3;
 
                         if (color == 0) // Color 0 is transparent
                             continue;
 
-                        u32 pal_mem_pointer = pal_index + (2 * color);
-                        color = GameBoy.Emulator.spr_pal[pal_mem_pointer]
-                                | (GameBoy.Emulator.spr_pal[pal_mem_pointer + 1] << 8);
-
-                        s32 x_ = real_x;
-
-                        // Flip X
-                        if (GB_Sprite->Info & (1 << 5))
-                            x_ = x_ + x__;
-                        else
-                            x_ += 7 - x__;
+                        color = pal[color];
 
                         if ((x_ >= 0) && (x_ < 160))
                         {
@@ -703,7 +835,7 @@ void GBC_ScreenDrawScanline(s32 y)
     }
 
     if (y == 143)
-        gb_cur_fb ^= 1;
+        gb_framebuffer_swap();
 }
 
 void GBC_GB_ScreenDrawScanline(s32 y)
@@ -738,7 +870,7 @@ void GBC_GB_ScreenDrawScanline(s32 y)
             for (int x = 0; x < 160; x++)
                 gb_framebuffer[gb_cur_fb][base_index + x] = GB_RGB(0, 0, 0);
             if (y == 143)
-                gb_cur_fb ^= 1;
+                gb_framebuffer_swap();
             return;
         }
 
@@ -779,105 +911,42 @@ void GBC_GB_ScreenDrawScanline(s32 y)
         u8 *wintilemap = (lcd_reg & (1 << 6)) ?
                                 &mem->VideoRAM[0x1C00] : &mem->VideoRAM[0x1800];
 
-        bool increase_win = false;
+        int tile_base_8800 = !(lcd_reg & (1 << 4));
+        u16 *dst = &gb_framebuffer[gb_cur_fb][base_index];
 
         // Draw BG + window
-        for (int x = 0; x < 160; x++)
+
+        // This should only disable BG, but GBC in GB mode disables both window
+        // and BG
+        if (lcd_reg & (1 << 0))
         {
-            // This should only disable BG, but GBC in GB mode disables both
-            // window and BG
-            if (lcd_reg & (1 << 0))
+            int win_x = 160; // First pixel of the window
+            if ((window_current_line >= 0) && (lcd_reg & (1 << 5))
+                && (wy_reg <= y))
             {
-                u32 color = GB_RGB(31, 31, 31);
-                bool window_draw = 0;
-                bool bg_color0 = false;
-
-                if (window_current_line >= 0)
-                {
-                    if (lcd_reg & (1 << 5)) // Window
-                    {
-                        if (wy_reg <= y)
-                        {
-                            if ((wx_reg < 8)
-                                || ((wx_reg > 7) && ((wx_reg - 7) <= x)))
-                            {
-                                increase_win = true;
-
-                                u32 y_ = window_current_line;
-                                u32 x_ = x - wx_reg;
-                                u32 tile = wintilemap[((y_ >> 3) * 32)
-                                                      + ((x_ + 7) >> 3)];
-
-                                // If tile base is 0x8800
-                                if (!(lcd_reg & (1 << 4)))
-                                {
-                                    if (tile & (1 << 7))
-                                        tile &= 0x7F;
-                                    else
-                                        tile += 128;
-                                }
-
-                                u8 *data = &tiledata[tile << 4];
-
-                                data += (y_ & 7) * 2;
-
-                                x_ = 7 - ((x_ + 7) & 7);
-
-                                color = ((*data >> x_) & 1)
-                                        | ((((*(data + 1)) >> x_) << 1) & 2);
-
-                                bg_color0 = (color == 0);
-
-                                color = bg_pal[color];
-                                window_draw = true;
-                            }
-                        }
-                    }
-                }
-
-                if (!window_draw) // BG
-                {
-                    u32 x_ = x + scx_reg;
-                    u32 y_ = y + scy_reg;
-
-                    u32 tile = bgtilemap[(((y_ >> 3) & 31) * 32)
-                                         + ((x_ >> 3) & 31)];
-
-                    if (!(lcd_reg & (1 << 4))) // If tile base is 0x8800
-                    {
-                        if (tile & (1 << 7))
-                            tile &= 0x7F;
-                        else
-                            tile += 128;
-                    }
-
-                    u8 *data = &tiledata[tile << 4];
-
-                    data += (y_ & 7) << 1;
-
-                    x_ = 7 - (x_ & 7);
-
-                    color = ((*data >> x_) & 1)
-                            | ((((*(data + 1)) >> x_) << 1) & 2);
-
-                    bg_color0 = (color == 0);
+                win_x = (wx_reg < 8) ? 0 : min(wx_reg - 7, 160);
+            }
 
-                    color = bg_pal[color];
-                }
+            gb_draw_map_line(dst, 0, win_x, bgtilemap, tiledata,
+                             tile_base_8800, scx_reg, y + scy_reg, bg_pal);
 
-                gb_framebuffer[gb_cur_fb][base_index + x] = color;
-                gb_framebuffer_bgcolor0[x] = bg_color0;
+            if (win_x < 160) // Window
+            {
+                gb_draw_map_line(dst, win_x, 160, wintilemap, tiledata,
+                                 tile_base_8800, win_x + 7 - wx_reg,
+                                 window_current_line, bg_pal);
+                window_current_line++;
             }
-            else
+        }
+        else
+        {
+            for (int x = 0; x < 160; x++)
             {
-                gb_framebuffer[gb_cur_fb][base_index + x] = bg_pal[0];
+                dst[x] = bg_pal[0];
                 gb_framebuffer_bgcolor0[x] = 1;
             }
         }
 
-        if (increase_win)
-            window_current_line++;
-
         // If sprites are enabled, draw the ones visible this scanline
         // Note: The BG transparent color is bg_pal[0]
         if (lcd_reg & (1 << 1))
@@ -889,40 +958,20 @@ void GBC_GB_ScreenDrawScanline(s32 y)
             // For 8x16 sprites, last bit is ignored
             u32 tilemask = ((spriteheight == 16) ? 0xFE : 0xFF);
 
-            u32 spritesdrawn = 0; // For the 10-sprites-per-scanline limit
-            u32 drawsprite[40];
+            // Limited to 10 sprites per scanline
+            const _gb_sprite_line_t *line = gb_sprite_line_get(y,
+                                                               spriteheight);
 
-            for (int a = 0; a < 40; a++)
+            for (int i = line->count - 1; i >= 0; i--)
             {
-                GB_Sprite = &GB_OAM->Sprite[a];
-
-                drawsprite[a] = 0;
-
-                s32 real_y = GB_Sprite->Y - 16;
-
-                if ((real_y <= y) && ((real_y + spriteheight) > y))
-                {
-                    if (spritesdrawn < 10)
-                    {
-                        drawsprite[a] = 1;
-                        spritesdrawn++;
-                    }
-                }
-            }
+                GB_Sprite = &GB_OAM->Sprite[line->index[i]];
 
-            for (int a = 39; a >= 0; a--)
-            {
                 // TODO: Fix.
                 // When sprites with different x coordinate values overlap, the
                 // one with the smaller x coordinate (closer to the left) will
                 // have priority and appear above any others. This applies in
                 // Non CGB Mode only.
 
-                if (!drawsprite[a])
-                    continue;
-
-                GB_Sprite = &GB_OAM->Sprite[a];
-
                 s32 real_y = GB_Sprite->Y - 16;
 
                 if ((real_y <= y) && ((real_y + spriteheight) > y))
@@ -937,43 +986,34 @@ void GBC_GB_ScreenDrawScanline(s32 y)
                     else
                         data += (y - real_y) * 2;
 
+                    // Flip X
+                    int hflip = (GB_Sprite->Info & (1 << 5)) != 0;
+                    u32 row = GB_TileRowDecode(data, hflip);
+
+                    u32 *spr_pal = (GB_Sprite->Info & (1 << 4)) ?
+                                   spr_pal1 : spr_pal0;
+
+                    // If BG has priority and it is enabled...
+                    int bg_priority = (GB_Sprite->Info & (1 << 7))
+                                      && (lcd_reg & (1 << 0));
+
                     // Lets draw the sprite...
-                    s32 real_x = GB_Sprite->X - 8;
-                    for (int x__ = 0; x__ < 8; x__++)
+                    s32 x_ = GB_Sprite->X - 8;
+                    for ( ; row != 0; row >>= 2, x_++)
                     {
-                        u32 color = ((*data >> x__) & 1)
-                                    | ((((*(data + 1)) >> x__) << 1) & 2);
+                        u32 color = row & 3;
 
-                        if (color != 0) // Color 0 is transparent
-                        {
-                            if (GB_Sprite->Info & (1 << 4))
-                                color = spr_pal1[color];
-                            else
-                                color = spr_pal0[color];
+                        if (color == 0) // Color 0 is transparent
+                            continue;
 
-                            s32 x_ = real_x;
+                        if ((x_ < 0) || (x_ >= 160))
+                            continue;
 
-                            // Flip X
-                            if (GB_Sprite->Info & (1 << 5))
-                                x_ = x_ + x__;
-                            else
-                                x_ += 7 - x__;
+                        if (bg_priority && !gb_framebuffer_bgcolor0[x_])
+                            continue;
 
-                            if ((x_ >= 0) && (x_ < 160))
-                            {
-                                // If BG has priority and it is enabled...
-                                if ((GB_Sprite->Info & (1 << 7))
-                                    && (lcd_reg & (1 << 0)))
-                                {
-                                    if (gb_framebuffer_bgcolor0[x_])
-                                        gb_framebuffer[gb_cur_fb][base_index + x_] = color;
-                                }
-                                else
-                                {
-                                    gb_framebuffer[gb_cur_fb][base_index + x_] = color;
-                                }
-                            }
-                        }
+                        gb_framebuffer[gb_cur_fb][base_index + x_] =
+                                spr_pal[color];
                     }
                 }
             }
@@ -988,19 +1028,18 @@ void GBC_GB_ScreenDrawScanline(s32 y)
     }
 
     if (y == 143)
-        gb_cur_fb ^= 1;
+        gb_framebuffer_swap();
 }
 
 //******************************************************************************
 
-u32 SGB_GetPixelColor(u32 x, u32 y, u32 palindex)
-{
-    int pal = SGBInfo.ATF_list[SGBInfo.curr_ATF][(20 * (y >> 3)) + (x >> 3)];
-    return SGBInfo.palette[pal][palindex];
-}
-
 void SGB_ScreenDrawBorder(void)
 {
+    // It is drawn in both framebuffers, the comparison won't see the changes
+    gb_screen_changed = 1;
+
+    SGB_ScreenBorderInvalidate();
+
     for (int i = 0; i < 32; i++)
     {
         for (int j = 0; j < 28; j++)
@@ -1063,7 +1102,27 @@ void SGB_ScreenDrawBorder(void)
     }
 }
 
-void SGB_ScreenDrawBorderInside(void)
+// The part of the border that is drawn over the game screen is cached here. It
+// is only rendered again after the tiles, the map or the palettes of the border
+// change.
+
+#define SGB_BORDER_INSIDE_X         (6 * 8)
+#define SGB_BORDER_INSIDE_Y         (4 * 8)
+#define SGB_BORDER_INSIDE_WIDTH     (20 * 8)
+#define SGB_BORDER_INSIDE_HEIGHT    (19 * 8)
+
+#define SGB_BORDER_TRANSPARENT      0xFFFFFFFF
+
+static core_local__ u32 sgb_border_inside[SGB_BORDER_INSIDE_HEIGHT]
+                                         [SGB_BORDER_INSIDE_WIDTH];
+static core_local__ int sgb_border_inside_valid = 0;
+
+void SGB_ScreenBorderInvalidate(void)
+{
+    sgb_border_inside_valid = 0;
+}
+
+static void sgb_border_inside_render(void)
 {
     for (int i = 6; i < 26; i++)
     {
@@ -1099,31 +1158,55 @@ void SGB_ScreenDrawBorderInside(void)
                     data2 += y << 1;
                 }
 
-                //if (*data != 0 && *data2 != 0)
-                //{
-                    for (int x = 0; x < 8; x++)
-                    {
-                        u32 x_;
-                        if (xflip)
-                            x_ = x;
-                        else
-                            x_ = 7 - x;
+                u32 *dst = &sgb_border_inside[y + (j << 3)
+                                              - SGB_BORDER_INSIDE_Y]
+                                             [(i << 3) - SGB_BORDER_INSIDE_X];
 
-                        u32 color = (*data >> x_) & 1;
-                        color |= ((((*(data + 1)) >> x_) << 1) & (1 << 1));
-                        color |= ((((*data2) >> x_) << 2) & (1 << 2));
-                        color |= ((((*(data2 + 1)) >> x_) << 3) & (1 << 3));
+                for (int x = 0; x < 8; x++)
+                {
+                    u32 x_;
+                    if (xflip)
+                        x_ = x;
+                    else
+                        x_ = 7 - x;
 
-                        if (color != 0)
-                        {
-                            color = SGBInfo.palette[pal][color];
+                    u32 color = (*data >> x_) & 1;
+                    color |= ((((*(data + 1)) >> x_) << 1) & (1 << 1));
+                    color |= ((((*data2) >> x_) << 2) & (1 << 2));
+                    color |= ((((*(data2 + 1)) >> x_) << 3) & (1 << 3));
 
-                            int temp = ((y + (j << 3)) * 256) + (x + (i << 3));
-                            gb_framebuffer[0][temp] = color;
-                            gb_framebuffer[1][temp] = color;
-                        }
-                    }
-                //}
+                    if (color != 0)
+                        dst[x] = SGBInfo.palette[pal][color];
+                    else
+                        dst[x] = SGB_BORDER_TRANSPARENT;
+                }
+            }
+        }
+    }
+
+    sgb_border_inside_valid = 1;
+}
+
+void SGB_ScreenDrawBorderInside(void)
+{
+    if (!sgb_border_inside_valid)
+        sgb_border_inside_render();
+
+    for (int y = 0; y < SGB_BORDER_INSIDE_HEIGHT; y++)
+    {
+        u32 *src = &sgb_border_inside[y][0];
+        int base = ((y + SGB_BORDER_INSIDE_Y) * 256) + SGB_BORDER_INSIDE_X;
+        u16 *dst0 = &gb_framebuffer[0][base];
+        u16 *dst1 = &gb_framebuffer[1][base];
+
+        for (int x = 0; x < SGB_BORDER_INSIDE_WIDTH; x++)
+        {
+            u32 color = src[x];
+
+            if (color != SGB_BORDER_TRANSPARENT)
+            {
+                dst0[x] = color;
+                dst1[x] = color;
             }
         }
     }
@@ -1158,7 +1241,7 @@ void SGB_ScreenDrawScanline(s32 y)
         if (y == 143)
         {
             SGB_ScreenDrawBorderInside();
-            gb_cur_fb ^= 1;
+            gb_framebuffer_swap();
         }
         return;
     }
@@ -1170,7 +1253,7 @@ void SGB_ScreenDrawScanline(s32 y)
         if (y == 143)
         {
             SGB_ScreenDrawBorderInside();
-            gb_cur_fb ^= 1;
+            gb_framebuffer_swap();
         }
         return;
     }
@@ -1183,7 +1266,7 @@ void SGB_ScreenDrawScanline(s32 y)
         if (y == 143)
         {
             SGB_ScreenDrawBorderInside();
-            gb_cur_fb ^= 1;
+            gb_framebuffer_swap();
         }
         return;
     }
@@ -1203,7 +1286,7 @@ void SGB_ScreenDrawScanline(s32 y)
             if (y == 143)
             {
                 SGB_ScreenDrawBorderInside();
-                gb_cur_fb ^= 1;
+                gb_framebuffer_swap();
             }
             return;
         }
@@ -1231,6 +1314,20 @@ void SGB_ScreenDrawScanline(s32 y)
         spr_pal1[2] = (obp1_reg >> 4) & 0x3;
         spr_pal1[3] = (obp1_reg >> 6) & 0x3;
 
+        // The attribute file assigns a palette to each 8x8 cell of the screen,
+        // and it only changes with the ATTR commands. The colors of the BG of
+        // the cells of this scanline are resolved once instead of per pixel.
+        const u32 *atf_row = &SGBInfo.ATF_list[SGBInfo.curr_ATF][20 * (y >> 3)];
+        u32 bg_cell_color[20][4];
+        for (int i = 0; i < 20; i++)
+        {
+            const u32 *pal = SGBInfo.palette[atf_row[i]];
+            bg_cell_color[i][0] = pal[bg_pal[0]];
+            bg_cell_color[i][1] = pal[bg_pal[1]];
+            bg_cell_color[i][2] = pal[bg_pal[2]];
+            bg_cell_color[i][3] = pal[bg_pal[3]];
+        }
+
         // Scroll values
         u32 scx_reg = mem->IO_Ports[SCX_REG - 0xFF00];
         u32 scy_reg = mem->IO_Ports[SCY_REG - 0xFF00];
@@ -1250,7 +1347,7 @@ void SGB_ScreenDrawScanline(s32 y)
         // Draw BG + window
         for (int x = 0; x < 160; x++)
         {
-            u32 color = SGB_GetPixelColor(x, y, bg_pal[0]);
+            u32 color = bg_cell_color[x >> 3][0];
             bool window_draw = 0;
             bool bg_color0 = false;
 
@@ -1288,7 +1385,7 @@ void SGB_ScreenDrawScanline(s32 y)
 
                             bg_color0 = (color == 0);
 
-                            color = SGB_GetPixelColor(x, y, bg_pal[color]);
+                            color = bg_cell_color[x >> 3][color];
                             window_draw = true;
                         }
                     }
@@ -1322,7 +1419,7 @@ void SGB_ScreenDrawScanline(s32 y)
 
                 bg_color0 = (color == 0);
 
-                color = SGB_GetPixelColor(x, y, bg_pal[color]);
+                color = bg_cell_color[x >> 3][color];
             }
 
             gb_framebuffer[gb_cur_fb][base_index + x + 48] = color;
@@ -1343,40 +1440,20 @@ void SGB_ScreenDrawScanline(s32 y)
             // For 8x16 sprites, last bit is ignored
             u32 tilemask = ((spriteheight == 16) ? 0xFE : 0xFF);
 
-            u32 spritesdrawn = 0; // For the 10-sprites-per-scanline limit
-            u32 drawsprite[40];
+            // Limited to 10 sprites per scanline
+            const _gb_sprite_line_t *line = gb_sprite_line_get(y,
+                                                               spriteheight);
 
-            for (int a = 0; a < 40; a++)
+            for (int i = line->count - 1; i >= 0; i--)
             {
-                GB_Sprite = &GB_OAM->Sprite[a];
-
-                drawsprite[a] = 0;
-
-                s32 real_y = GB_Sprite->Y - 16;
-
-                if ((real_y <= y) && ((real_y + spriteheight) > y))
-                {
-                    if (spritesdrawn < 10)
-                    {
-                        drawsprite[a] = 1;
-                        spritesdrawn++;
-                    }
-                }
-            }
+                GB_Sprite = &GB_OAM->Sprite[line->index[i]];
 
-            for (int a = 39; a >= 0; a--)
-            {
                 // TODO: Fix.
                 // When sprites with different x coordinate values overlap, the
                 // one with the smaller x coordinate (closer to the left) will
                 // have priority and appear above any others. This applies in
                 // Non CGB Mode only.
 
-                if (!drawsprite[a])
-                    continue;
-
-                GB_Sprite = &GB_OAM->Sprite[a];
-
                 s32 real_y = (GB_Sprite->Y - 16);
 
                 if ((real_y <= y) && ((real_y + spriteheight) > y))
@@ -1410,14 +1487,13 @@ void SGB_ScreenDrawScanline(s32 y)
 
                             if ((x_ >= 0) && (x_ < 160))
                             {
+                                const u32 *pal =
+                                        SGBInfo.palette[atf_row[x_ >> 3]];
+
                                 if (GB_Sprite->Info & (1 << 4))
-                                {
-                                    color = SGB_GetPixelColor(x_, y, spr_pal1[color]);
-                                }
+                                    color = pal[spr_pal1[color]];
                                 else
-                                {
-                                    color = SGB_GetPixelColor(x_, y, spr_pal0[color]);
-                                }
+                                    color = pal[spr_pal0[color]];
 
                                 // If BG has priority and it is enabled...
                                 if ((GB_Sprite->Info & (1 << 7))
@@ -1452,7 +1528,7 @@ void SGB_ScreenDrawScanline(s32 y)
     if (y == 143)
     {
         SGB_ScreenDrawBorderInside();
-        gb_cur_fb ^= 1;
+        gb_framebuffer_swap();
     }
 }
 
@@ -1462,138 +1538,154 @@ void SGB_ScreenDrawScanline(s32 y)
 // -------------------------------------------------------------
 // -------------------------------------------------------------
 
+// Real colors:
+// R = ((r * 13 + g * 2 + b) >> 1)
+// G = ((g * 3 + b) << 1)
+// B = ((r * 3 + g * 2 + b * 11) >> 1)
+//
+// The result of each one of the 32768 possible colors is calculated when the
+// screen is initialized. Each entry holds R in bits 0-7, G in bits 8-15 and B
+// in bits 16-23.
+
+static core_local__ u32 gb_realcolors_lut[32768];
+
+// Components of each color without any conversion, with the same layout as the
+// real colors table. They can be converted to 8 bits by shifting the entry.
+static core_local__ u32 gb_rgb555_components[32768];
+
+static void gb_color_luts_fill(void)
+{
+    for (int data = 0; data < 32768; data++)
+    {
+        int r = data & 0x1F;
+        int g = (data >> 5) & 0x1F;
+        int b = (data >> 10) & 0x1F;
+
+        u32 _r = ((r * 13 + g * 2 + b) >> 1);
+        u32 _g = (g * 3 + b) << 1;
+        u32 _b = ((r * 3 + g * 2 + b * 11) >> 1);
+
+        gb_realcolors_lut[data] = _r | (_g << 8) | (_b << 16);
+        gb_rgb555_components[data] = r | (g << 8) | (b << 16);
+    }
+}
+
 int GB_Screen_Init(void)
 {
+    gb_tile_row_expand_fill();
+    gb_color_luts_fill();
+
     memset(gb_framebuffer, 0, sizeof(gb_framebuffer));
+    gb_bg_lines_invalidate();
+    gb_screen_changed = 1;
+    gb_framebuffer_last_diff = 1;
     return 0;
 }
 
-static void GB_Screen_WritePixel(char *buffer, int x, int y,
-                                 int r, int g, int b)
-{
-    u8 *p = (u8 *)buffer + (y * 160 + x) * 3;
-    *p++ = r;
-    *p++ = g;
-    *p = b;
-}
+// The buffers can be 24-bit RGB (3 bytes per pixel) or 32-bit ARGB8888 (4 bytes
+// per pixel). The format is the same for the whole buffer, so the check is
+// always predicted correctly.
 
-static void GB_Screen_WritePixelSGB(char *buffer, int x, int y,
-                                    int r, int g, int b)
+// Writes a color with R in bits 0-7, G in bits 8-15 and B in bits 16-23 to the
+// buffer, and returns a pointer to the next pixel.
+static inline u8 *gb_scr_write_rgb(u8 *p, u32 rgb, int argb)
 {
-    u8 *p = (u8 *)buffer + (y * (160 + 96) + x) * 3;
-    *p++ = r;
-    *p++ = g;
-    *p = b;
+    if (argb)
+    {
+        *(u32 *)p = 0xFF000000 | ((rgb & 0xFF) << 16) | (rgb & 0xFF00)
+                    | ((rgb >> 16) & 0xFF);
+        return p + 4;
+    }
+
+    p[0] = rgb;
+    p[1] = rgb >> 8;
+    p[2] = rgb >> 16;
+    return p + 3;
 }
 
-static void gb_scr_writebuffer_sgb(char *buffer)
+static void gb_scr_writebuffer_sgb(u8 *p, int argb)
 {
     int last_fb = gb_cur_fb ^ 1;
-    for (int i = 0; i < 256; i++)
-    {
-        for (int j = 0; j < 224; j++)
-        {
-            int data = gb_framebuffer[last_fb][j * 256 + i];
-            int r = data & 0x1F;
-            int g = (data >> 5) & 0x1F;
-            int b = (data >> 10) & 0x1F;
-            GB_Screen_WritePixelSGB(buffer, i, j, r << 3, g << 3, b << 3);
-        }
-    }
+    u16 *src = &gb_framebuffer[last_fb][0];
+
+    for (int i = 0; i < 256 * 224; i++)
+        p = gb_scr_write_rgb(p, gb_rgb555_components[src[i] & 0x7FFF] << 3,
+                             argb);
 }
 
-static void gb_scr_writebuffer_dmg_cgb(char *buffer)
+static void gb_scr_writebuffer_dmg_cgb(u8 *p, int argb)
 {
     int last_fb = gb_cur_fb ^ 1;
-    for (int i = 0; i < 160; i++)
+
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        u16 *src = &gb_framebuffer[last_fb][j * 256];
+
+        for (int i = 0; i < 160; i++)
         {
-            int data = gb_framebuffer[last_fb][j * 256 + i];
-            int r = data & 0x1F;
-            int g = (data >> 5) & 0x1F;
-            int b = (data >> 10) & 0x1F;
-            GB_Screen_WritePixel(buffer, i, j, r << 3, g << 3, b << 3);
+            p = gb_scr_write_rgb(p,
+                                 gb_rgb555_components[src[i] & 0x7FFF] << 3,
+                                 argb);
         }
     }
 }
 
-static void gb_scr_writebuffer_dmg_cgb_blur(char *buffer)
+static void gb_scr_writebuffer_dmg_cgb_blur(u8 *p, int argb)
 {
-    for (int i = 0; i < 160; i++)
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        u16 *src1 = &gb_framebuffer[0][j * 256];
+        u16 *src2 = &gb_framebuffer[1][j * 256];
+
+        for (int i = 0; i < 160; i++)
         {
-            int data1 = gb_framebuffer[0][j * 256 + i];
-            int r1 = data1 & 0x1F;
-            int g1 = (data1 >> 5) & 0x1F;
-            int b1 = (data1 >> 10) & 0x1F;
-
-            int data2 = gb_framebuffer[1][j * 256 + i];
-            int r2 = data2 & 0x1F;
-            int g2 = (data2 >> 5) & 0x1F;
-            int b2 = (data2 >> 10) & 0x1F;
-            int r = (r1 + r2) << 2;
-            int g = (g1 + g2) << 2;
-            int b = (b1 + b2) << 2;
-            GB_Screen_WritePixel(buffer, i, j, r, g, b);
+            // Each component of the sum fits in its byte, so the 3 of them can
+            // be added at the same time.
+            u32 sum = gb_rgb555_components[src1[i] & 0x7FFF]
+                      + gb_rgb555_components[src2[i] & 0x7FFF];
+            p = gb_scr_write_rgb(p, sum << 2, argb);
         }
     }
 }
 
-// Real colors:
-// R = ((r * 13 + g * 2 + b) >> 1)
-// G = ((g * 3 + b) << 1)
-// B = ((r * 3 + g * 2 + b * 11) >> 1)
-
-static void gb_scr_writebuffer_dmg_cgb_realcolors(char *buffer)
+static void gb_scr_writebuffer_dmg_cgb_realcolors(u8 *p, int argb)
 {
     int last_fb = gb_cur_fb ^ 1;
-    for (int i = 0; i < 160; i++)
+
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
-        {
-            int data = gb_framebuffer[last_fb][j * 256 + i];
-            int r = data & 0x1F;
-            int g = (data >> 5) & 0x1F;
-            int b = (data >> 10) & 0x1F;
-
-            int _r = ((r * 13 + g * 2 + b) >> 1);
-            int _g = (g * 3 + b) << 1;
-            int _b = ((r * 3 + g * 2 + b * 11) >> 1);
-            GB_Screen_WritePixel(buffer, i, j, _r, _g, _b);
-        }
+        u16 *src = &gb_framebuffer[last_fb][j * 256];
+
+        for (int i = 0; i < 160; i++)
+            p = gb_scr_write_rgb(p, gb_realcolors_lut[src[i] & 0x7FFF], argb);
     }
 }
 
-static void gb_scr_writebuffer_dmg_cgb_blur_realcolors(char *buffer)
+static void gb_scr_writebuffer_dmg_cgb_blur_realcolors(u8 *p, int argb)
 {
-    for (int i = 0; i < 160; i++)
+    for (int j = 0; j < 144; j++)
     {
-        for (int j = 0; j < 144; j++)
+        u16 *src1 = &gb_framebuffer[0][j * 256];
+        u16 *src2 = &gb_framebuffer[1][j * 256];
+
+        for (int i = 0; i < 160; i++)
         {
-            int data1 = gb_framebuffer[0][j * 256 + i];
-            int r1 = data1 & 0x1F;
-            int g1 = (data1 >> 5) & 0x1F;
-            int b1 = (data1 >> 10) & 0x1F;
-            int data2 = gb_framebuffer[1][j * 256 + i];
-            int r2 = data2 & 0x1F;
-            int g2 = (data2 >> 5) & 0x1F;
-            int b2 = (data2 >> 10) & 0x1F;
-            int r = (r1 + r2) >> 1;
-            int g = (g1 + g2) >> 1;
-            int b = (b1 + b2) >> 1;
-            int _r = ((r * 13 + g * 2 + b) >> 1);
-            int _g = (g * 3 + b) << 1;
-            int _b = ((r * 3 + g * 2 + b * 11) >> 1);
-            GB_Screen_WritePixel(buffer, i, j, _r, _g, _b);
+            u32 data1 = src1[i];
+            u32 data2 = src2[i];
+
+            // Average of each component, rounded down. The lowest bit of each
+            // component is removed before shifting so that it doesn't leak
+            // into the component below.
+            u32 data = (data1 & data2) + (((data1 ^ data2) & 0x7BDE) >> 1);
+
+            p = gb_scr_write_rgb(p, gb_realcolors_lut[data & 0x7FFF], argb);
         }
     }
 }
 
-typedef void (*draw_to_buf_fn)(char *);
+typedef void (*draw_to_buf_fn)(u8 *, int);
 
-void GB_Screen_WriteBuffer_24RGB(char *buffer)
+static void gb_screen_write_buffer(u8 *buffer, int argb, int blur)
 {
     draw_to_buf_fn draw_fn = NULL;
 
@@ -1605,14 +1697,14 @@ void GB_Screen_WriteBuffer_24RGB(char *buffer)
     else if ((GameBoy.Emulator.HardwareType == HW_GBA)
              || (GameBoy.Emulator.HardwareType == HW_GBA_SP))
     {
-        if (gb_blur)
+        if (blur)
             draw_fn = &gb_scr_writebuffer_dmg_cgb_blur;
         else
             draw_fn = &gb_scr_writebuffer_dmg_cgb;
     }
     else
     {
-        if (gb_blur)
+        if (blur)
         {
             if (gb_realcolors)
                 draw_fn = &gb_scr_writebuffer_dmg_cgb_blur_realcolors;
@@ -1630,6 +1722,8 @@ void GB_Screen_WriteBuffer_24RGB(char *buffer)
 
     if (GameBoy.Emulator.rumble)
     {
+        // The shaking is only visual. It doesn't use core_rand() so that it
+        // doesn't change the random values that the emulation sees.
         int rand_ = rand();
         int mov_x = (rand_ % 3) - 1;
         int mov_y = ((rand_ >> 8) % 3) - 1;
@@ -1648,10 +1742,17 @@ void GB_Screen_WriteBuffer_24RGB(char *buffer)
             h = 144;
         }
 
-        char *buf = malloc(w * h * 3);
+        int bpp = argb ? 4 : 3;
+
+        u8 *buf = malloc(w * h * bpp);
         if (buf == NULL)
             return;
-        draw_fn(buf);
+        draw_fn(buf, argb);
+
+        // The contents of 32-bit buffers may be undefined (they are usually
+        // textures), so the pixels left uncovered by the movement are cleared.
+        if (argb)
+            memset(buffer, 0, w * h * bpp);
 
         for (int j = 0; j < h; j++)
         {
@@ -1664,10 +1765,8 @@ void GB_Screen_WriteBuffer_24RGB(char *buffer)
 
                     if ((x_dst >= 0) && (x_dst < w))
                     {
-                        int dst = (y_dst * w + x_dst) * 3;
-                        buffer[dst + 0] = buf[(j * w + i) * 3 + 0];
-                        buffer[dst + 1] = buf[(j * w + i) * 3 + 1];
-                        buffer[dst + 2] = buf[(j * w + i) * 3 + 2];
+                        memcpy(&buffer[(y_dst * w + x_dst) * bpp],
+                               &buf[(j * w + i) * bpp], bpp);
                     }
                 }
             }
@@ -1677,8 +1776,25 @@ void GB_Screen_WriteBuffer_24RGB(char *buffer)
     }
     else
     {
-        draw_fn(buffer);
+        draw_fn(buffer, argb);
     }
+
+    gb_screen_changed = 0;
+}
+
+void GB_Screen_WriteBuffer_24RGB(char *buffer)
+{
+    gb_screen_write_buffer((u8 *)buffer, 0, gb_blur);
+}
+
+void GB_Screen_WriteBuffer_32ARGB(void *buffer)
+{
+    gb_screen_write_buffer(buffer, 1, gb_blur);
+}
+
+void GB_Screen_WriteBuffer_32ARGB_NoBlur(void *buffer)
+{
+    gb_screen_write_buffer(buffer, 1, 0);
 }
 
 // -------------------------------------------------------------
@@ -1687,24 +1803,26 @@ void GB_Screen_WriteBuffer_24RGB(char *buffer)
 // -------------------------------------------------------------
 // -------------------------------------------------------------
 
-void GB_Screenshot(void)
+void GB_ScreenGetSize(int *width, int *height)
 {
-    char *name = FU_GetNewTimestampFilename("gb_screenshot");
-
-    int width, height;
-
     if (GameBoy.Emulator.SGBEnabled)
     {
-        width = 256;
-        height = 224;
+        *width = 256;
+        *height = 224;
     }
     else
     {
-        width = 160;
-        height = 144;
+        *width = 160;
+        *height = 144;
     }
+}
+
+void GB_ScreenConvertLastFrameTo32RGB(void *dst)
+{
+    int width, height;
+    GB_ScreenGetSize(&width, &height);
 
-    u32 *buf_temp = calloc(width * height * 4, 1);
+    u32 *buf = dst;
     int last_fb = gb_cur_fb ^ 1;
 
     for (int y = 0; y < height; y++)
@@ -1712,11 +1830,55 @@ void GB_Screenshot(void)
         for (int x = 0; x < width; x++)
         {
             u32 data = gb_framebuffer[last_fb][y * 256 + x];
-            buf_temp[y * width + x] = ((data & 0x1F) << 3)
-                                      | ((((data >> 5) & 0x1F) << 3) << 8)
-                                      | ((((data >> 10) & 0x1F) << 3) << 16);
+            buf[y * width + x] = ((data & 0x1F) << 3)
+                                 | ((((data >> 5) & 0x1F) << 3) << 8)
+                                 | ((((data >> 10) & 0x1F) << 3) << 16);
         }
     }
-    Save_PNG(name, width, height, buf_temp, 0);
-    free(buf_temp);
+}
+
+void GB_Screenshot(void)
+{
+    char *name = FU_GetNewTimestampFilename("gb_screenshot");
+
+    int width, height;
+    GB_ScreenGetSize(&width, &height);
+
+    // The image is encoded and written by a background thread
+    u32 *buf_temp = PNG_SaveBegin(name, width, height, 0);
+    if (buf_temp == NULL)
+        return;
+
+    GB_ScreenConvertLastFrameTo32RGB(buf_temp);
+    PNG_SaveCommit();
+}
+
+// -------------------------------------------------------------
+// -------------------------------------------------------------
+
+void GB_VideoStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "VID ");
+    SaveState_Write(st, &gb_cur_fb, sizeof(gb_cur_fb));
+    SaveState_Write(st, gb_framebuffer, sizeof(gb_framebuffer));
+    SaveState_Write(st, &window_current_line, sizeof(window_current_line));
+    SaveState_ChunkEnd(st);
+}
+
+void GB_VideoStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "VID ");
+    SaveState_Read(st, &gb_cur_fb, sizeof(gb_cur_fb));
+    SaveState_Read(st, gb_framebuffer, sizeof(gb_framebuffer));
+    SaveState_Read(st, &window_current_line, sizeof(window_current_line));
+    SaveState_ChunkClose(st);
+
+    gb_cur_fb &= 1;
+
+    gb_screen_changed = 1;
+    gb_framebuffer_last_diff = 1;
+    gb_framebuffer_hash = Hash_CRC32C(0, gb_framebuffer[gb_cur_fb ^ 1],
+                                      sizeof(gb_framebuffer[0]));
+
+    sgb_border_inside_valid = 0;
 }
@@ -7,6 +7,8 @@
 #ifndef GB_VIDEO__
 #define GB_VIDEO__
 
+#include "../savestate_utils.h"
+
 #include "gameboy.h"
 
 void GB_SkipFrame(int skip);
@@ -25,6 +27,22 @@ void GB_ConfigLoadPalette(void);
 void GB_SetPalette(u32 red, u32 green, u32 blue);
 u32 GB_GameBoyGetGray(u32 number);
 
+// Expands the bits of a byte of tile data so that there is a free bit between
+// each one of them. The second table is used for horizontally flipped tiles.
+extern core_local__ u16 gb_tile_row_expand[2][256];
+
+// Returns the 8 pixels of a row of a tile. Pixel N, counting from the left, is
+// in bits 2N and 2N+1.
+static inline u32 GB_TileRowDecode(const u8 *data, int hflip)
+{
+    const u16 *expand = gb_tile_row_expand[hflip];
+    return expand[data[0]] | (expand[data[1]] << 1);
+}
+
+// Updates the cached color that uses the byte of palette RAM at this index, in
+// both the BG and sprite palettes.
+void GBC_PaletteColorUpdate(int index);
+
 u32 gbc_getbgpalcolor(int pal, int color);
 u32 gbc_getsprpalcolor(int pal, int color);
 
@@ -33,12 +51,37 @@ void GBC_ScreenDrawScanline(s32 y);
 void GBC_GB_ScreenDrawScanline(s32 y); // GBC when switched to GB mode.
 
 void SGB_ScreenDrawBorder(void);
+// Must be called when the tiles, map or palettes of the border change without
+// calling SGB_ScreenDrawBorder().
+void SGB_ScreenBorderInvalidate(void);
 void SGB_ScreenDrawScanline(s32 y);
 
 //----------------------------------------------------
 
 // Write to buffer in 24 bit format
 void GB_Screen_WriteBuffer_24RGB(char *buffer);
+// Write to buffer in 32 bit ARGB8888 format, 0xAARRGGBB in native endianness
+// (alpha set to 255).
+void GB_Screen_WriteBuffer_32ARGB(void *buffer);
+// Same as GB_Screen_WriteBuffer_32ARGB(), but the previous frame isn't blended
+// even if blur is enabled. For frontends that blend the frames themselves.
+void GB_Screen_WriteBuffer_32ARGB_NoBlur(void *buffer);
+// Returns 1 if GB_Screen_WriteBuffer_24RGB() or GB_Screen_WriteBuffer_32ARGB()
+// would write something different from what they wrote the last time.
+int GB_ScreenHasChanged(void);
+// CRC32C of the last frame that has been drawn (the whole 256x224 buffer). It
+// is calculated when the frame is finished, so reading it is free.
+u32 GB_ScreenGetHash(void);
 void GB_Screenshot(void);
 
+// Size of the screen, it is bigger when the SGB border is enabled
+void GB_ScreenGetSize(int *width, int *height);
+// Write the last complete frame to a buffer in 32 bit format
+void GB_ScreenConvertLastFrameTo32RGB(void *dst);
+
+//----------------------------------------------------
+
+void GB_VideoStateSave(_savestate_t *st);
+void GB_VideoStateLoad(_savestate_t *st);
+
 #endif // GB_VIDEO__
@@ -4,10 +4,15 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stddef.h>
+
 #include "../build_options.h"
 #include "../debug_utils.h"
+#include "../opprofile_utils.h"
+#include "../trace_utils.h"
 
 #include "bios.h"
+#include "code_cache.h"
 #include "cpu.h"
 #include "disassembler.h"
 #include "gba.h"
@@ -15,55 +20,32 @@
 #include "memory.h"
 #include "shifts.h"
 
-#include "../gui/win_gba_debugger.h"
-
 //------------------------------------------------------------------------------
 
+// For each condition, bit N of the mask is set if the condition passes when the
+// NZCV flags (bits 31-28 of the CPSR) are equal to N.
+static const u16 arm_condition_table[16] = {
+    0xF0F0, // EQ: Z
+    0x0F0F, // NE: !Z
+    0xCCCC, // CS: C
+    0x3333, // CC: !C
+    0xFF00, // MI: N
+    0x00FF, // PL: !N
+    0xAAAA, // VS: V
+    0x5555, // VC: !V
+    0x0C0C, // HI: C && !Z
+    0xF3F3, // LS: !C || Z
+    0xAA55, // GE: N == V
+    0x55AA, // LT: N != V
+    0x0A05, // GT: !Z && (N == V)
+    0xF5FA, // LE: Z || (N != V)
+    0xFFFF, // AL
+    0x0000, // NV: (ARMv1,v2 only) (Reserved ARMv3 and up)
+};
+
 u32 arm_check_condition(u32 cond)
 {
-    if (cond == 14)
-        return 1; // This is the most used
-
-    switch (cond)
-    {
-        case 0:
-            return CPU.CPSR & F_Z;
-        case 1:
-            return (CPU.CPSR & F_Z) == 0;
-        case 2:
-            return CPU.CPSR & F_C;
-        case 3:
-            return (CPU.CPSR & F_C) == 0;
-        case 4:
-            return CPU.CPSR & F_N;
-        case 5:
-            return (CPU.CPSR & F_N) == 0;
-        case 6:
-            return CPU.CPSR & F_V;
-        case 7:
-            return (CPU.CPSR & F_V) == 0;
-        case 8:
-            return (CPU.CPSR & (F_C | F_Z)) == F_C;
-        case 9:
-            return ((CPU.CPSR & F_C) == 0) || (CPU.CPSR & F_Z);
-        case 10:
-            return !((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0);
-        case 11:
-            return ((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0);
-        case 12:
-            return ((CPU.CPSR & F_Z) == 0)
-                   && !(((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0));
-        case 13:
-            return (CPU.CPSR & F_Z)
-                   || (((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0));
-        case 14:
-            return 1;
-        default:
-        case 15:
-            return 0; // (ARMv1,v2 only) (Reserved ARMv3 and up)
-    }
-
-    return 0;
+    return (arm_condition_table[cond & 0xF] >> (CPU.CPSR >> 28)) & 1;
 }
 
 //------------------------------------------------------------------------------
@@ -86,14 +68,56 @@ static u32 arm_bit_count(u16 value)
     return count;
 }
 
-static void arm_ldm(u32 address, u32 reg)
+// The registers of the list are transferred in order, the lowest one from or to
+// "address" and the others from or to the next words. "count" is the number of
+// registers in the list.
+
+static void arm_ldm_list(u32 address, u32 rlist, u32 count)
+{
+    u32 data[16];
+    GBA_MemoryRead32Multiple(address & ~3, data, count);
+
+    u32 n = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (rlist & BIT(i))
+            CPU.R[i] = data[n++];
+    }
+}
+
+static void arm_stm_list(u32 address, u32 rlist, u32 count)
 {
-    CPU.R[reg] = GBA_MemoryRead32(address & ~3);
+    u32 data[16];
+
+    u32 n = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (rlist & BIT(i))
+            data[n++] = CPU.R[i] + ((i == 15) ? 12 : 0);
+    }
+
+    GBA_MemoryWrite32Multiple(address & ~3, data, count);
 }
 
-static void arm_stm(u32 address, u32 reg)
+// The base is written back after storing the first register, so it's only
+// stored unchanged if it's the first register of the list.
+static void arm_stm_list_writeback(u32 address, u32 rlist, u32 count,
+                                   u32 Rn, u32 base)
 {
-    GBA_MemoryWrite32(address & ~3, CPU.R[reg] + ((reg == 15) ? 12 : 0));
+    u32 data[16];
+
+    u32 n = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (rlist & BIT(i))
+        {
+            data[n++] = CPU.R[i] + ((i == 15) ? 12 : 0);
+            if (n == 1)
+                CPU.R[Rn] = base;
+        }
+    }
+
+    GBA_MemoryWrite32Multiple(address & ~3, data, count);
 }
 
 //------------------------------------------------------------------------------
@@ -109,7 +133,7 @@ static void arm_stm(u32 address, u32 reg)
     CPU.CPSR &= ~((0x1F) | F_T | F_I);                              \
     CPU.CPSR |= M_UNDEFINED | F_I;                                  \
     CPU.R[R_PC] = 0;                                                \
-    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)        \
+    clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)        \
               + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])       \
               + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]) + 1 ;   \
     return clocks;                                                  \
@@ -119,17 +143,32 @@ static void arm_stm(u32 address, u32 reg)
 
 //------------------------------------------------------------------------------
 
-extern u32 cpu_loop_break;
+extern core_local__ u32 cpu_loop_break;
 // Returns residual clocks
 s32 GBA_ExecuteARM(s32 clocks)
 {
+    // Block of decoded instructions that contains the PC
+    _arm_decoded_t *block = NULL;
+    u8 *block_valid = NULL;
+    u32 block_base = 1; // Not aligned, it will never match the PC
+    // Memory of the block, used while it isn't decoded
+    const u32 *block_fetch = NULL;
+
+    // Breakpoints can't change while this function runs. If there aren't any,
+    // the only cost of checking them is testing this variable.
+    int breakpoints = GBA_DebugCPUBreakpointsUsed();
+    int trace = trace_enabled;
+#ifdef ENABLE_OPCODE_PROFILE
+    int opprofile = opprofile_enabled;
+#endif
+
     while (clocks > 0)
     {
-        if (GBA_DebugCPUIsBreakpoint(CPU.R[R_PC]))
+        if (breakpoints && GBA_DebugCPUIsBreakpoint(CPU.R[R_PC]))
         {
             cpu_loop_break = 1;
             GBA_RunFor_ExecutionBreak();
-            Win_GBADisassemblerSetFocus();
+            GBA_DebugNotifyBreak();
         }
 
         if (cpu_loop_break)
@@ -143,2422 +182,2461 @@ s32 GBA_ExecuteARM(s32 clocks)
         u32 PCseq = ((CPU.OldPC + 4) == CPU.R[R_PC]);
         CPU.OldPC = CPU.R[R_PC];
 
-        u32 opcode = GBA_MemoryReadFast32(CPU.R[R_PC]);
+        if ((CPU.R[R_PC] & ~(GBA_CODE_CACHE_BLOCK_SIZE - 1)) != block_base)
+        {
+            block_base = CPU.R[R_PC] & ~(GBA_CODE_CACHE_BLOCK_SIZE - 1);
+            block_fetch = GBA_MemoryFetchBlock(block_base);
+            block = GBA_CodeCacheGetARMBlock(block_base, &block_valid);
+        }
+        else if (*block_valid == 0)
+        {
+            block = GBA_CodeCacheGetARMBlock(block_base, &block_valid);
+        }
+
+        u32 opcode, cond, group;
 
-        if (arm_check_condition((opcode >> 28) & 0xF))
+        if (block)
+        {
+            _arm_decoded_t *entry =
+                &block[(CPU.R[R_PC] >> 2) & (GBA_CODE_CACHE_ARM_ENTRIES - 1)];
+            opcode = entry->opcode;
+            cond = entry->cond;
+            group = entry->group;
+        }
+        else
         {
-            u32 ident = (opcode >> 25) & 7;
+            opcode = block_fetch[(CPU.R[R_PC] >> 2)
+                                 & (GBA_CODE_CACHE_ARM_ENTRIES - 1)];
+            cond = opcode >> 28;
+            group = GBA_ARMDecodeGroup(opcode);
             opcode &= 0x01FFFFFF;
+        }
+
+        // The decoded opcodes don't have all the bits of the original one
+        if (trace)
+        {
+            u32 raw = block_fetch[(CPU.R[R_PC] >> 2)
+                                  & (GBA_CODE_CACHE_ARM_ENTRIES - 1)];
+            GBA_TraceInstruction(raw, 4, clocks);
+        }
+
+#ifdef ENABLE_OPCODE_PROFILE
+        u32 opprofile_index = 0;
+        s32 opprofile_clocks = clocks;
+        if (opprofile)
+        {
+            u32 raw = block_fetch[(CPU.R[R_PC] >> 2)
+                                  & (GBA_CODE_CACHE_ARM_ENTRIES - 1)];
+            opprofile_index = OPPROFILE_ARM(((raw >> 16) & 0xFF0)
+                                            | ((raw >> 4) & 0xF));
+            OPProfile_Executed(opprofile_index);
+        }
+#endif
 
-            switch (ident)
+        if (arm_check_condition(cond))
+        {
+            switch (group)
             {
-                case 0:
+                case ARM_GROUP_MUL_SWP_HALF:
                 {
-                    if (opcode & BIT(4))
+                    // X.24.23.22:21.20.6.5
+                    u32 switchval = ((opcode >> 5) & 3)
+                                    | ((opcode >> 18) & 0x7C);
+                    switch (switchval)
                     {
-                        if (opcode & BIT(7))
-                        {
-                            // X.24.23.22:21.20.6.5
-                            u32 switchval = ((opcode >> 5) & 3)
-                                            | ((opcode >> 18) & 0x7C);
-                            switch (switchval)
-                            {
-                                // Multiplication
-                                // --------------
-                                //
-                                // Rd = (opcode >> 16) & 0xF; // |        (RdHi)
-                                // Rn = (opcode >> 12) & 0xF; // | r0-r14 (RdLo)
-                                // Rs = (opcode >> 8) & 0xF;  // |
-                                // Rm = opcode & 0xF;         // |
-                                case 0x00: // MUL{cond}
-                                {
-                                    // 1S+mI
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF);
-                                    arm_mul((opcode >> 16) & 0xF, opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x04: // MUL{cond}S
-                                {
-                                    // 1S+mI
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF);
-                                    arm_muls((opcode >> 16) & 0xF, opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x08: // MLA{cond}
-                                {
-                                    // 1S+mI+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
-                                    arm_mla((opcode >> 16) & 0xF, opcode & 0xF,
-                                            (opcode >> 8) & 0xF, (opcode >> 12) & 0xF);
-                                    break;
-                                }
-                                case 0x0C: // MLA{cond}S
-                                {
-                                    // 1S+mI+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
-                                    arm_mlas((opcode >> 16) & 0xF, opcode & 0xF,
-                                             (opcode >> 8) & 0xF, (opcode >> 12) & 0xF);
-                                    break;
-                                }
-                                case 0x10:
-                                case 0x14:
-                                case 0x18:
-                                case 0x1C:
-                                {
-                                    CPU.R[R_PC] -= 4; // Undefined Instruction #0-2
-                                    clocks -= 100;    // Don't trap!!! ???
-                                    break;
-                                }
-                                case 0x20: // UMULL{cond}
-                                {
-                                    // 1S+mI+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
-                                    arm_umull((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                              opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x24: // UMULL{cond}S
-                                {
-                                    // 1S+mI+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
-                                    arm_umulls((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                               opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x28: // UMLAL{cond}
-                                {
-                                    // 1S+mI+2I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
-                                    arm_umlal((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                              opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x2C: // UMLAL{cond}S
-                                {
-                                    // 1S+mI+2I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
-                                    arm_umlals((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                               opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x30: // SMULL{cond}
-                                {
-                                    // 1S+mI+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
-                                    arm_smull((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                              opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x34: // SMULL{cond}S
-                                {
-                                    // 1S+mI+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
-                                    arm_smulls((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                               opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x38: // SMLAL{cond}
-                                {
-                                    // 1S+mI+2I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
-                                    arm_smlal((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                              opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
-                                case 0x3C: // SMLAL{cond}S
-                                {
-                                    // 1S+mI+2I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
-                                    arm_smlals((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                               opcode & 0xF, (opcode >> 8) & 0xF);
-                                    break;
-                                }
+                        // Multiplication
+                        // --------------
+                        //
+                        // Rd = (opcode >> 16) & 0xF; // |        (RdHi)
+                        // Rn = (opcode >> 12) & 0xF; // | r0-r14 (RdLo)
+                        // Rs = (opcode >> 8) & 0xF;  // |
+                        // Rm = opcode & 0xF;         // |
+                        case 0x00: // MUL{cond}
+                        {
+                            // 1S+mI
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF);
+                            arm_mul((opcode >> 16) & 0xF, opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x04: // MUL{cond}S
+                        {
+                            // 1S+mI
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF);
+                            arm_muls((opcode >> 16) & 0xF, opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x08: // MLA{cond}
+                        {
+                            // 1S+mI+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
+                            arm_mla((opcode >> 16) & 0xF, opcode & 0xF,
+                                    (opcode >> 8) & 0xF, (opcode >> 12) & 0xF);
+                            break;
+                        }
+                        case 0x0C: // MLA{cond}S
+                        {
+                            // 1S+mI+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
+                            arm_mlas((opcode >> 16) & 0xF, opcode & 0xF,
+                                     (opcode >> 8) & 0xF, (opcode >> 12) & 0xF);
+                            break;
+                        }
+                        case 0x10:
+                        case 0x14:
+                        case 0x18:
+                        case 0x1C:
+                        {
+                            CPU.R[R_PC] -= 4; // Undefined Instruction #0-2
+                            clocks -= 100;    // Don't trap!!! ???
+                            break;
+                        }
+                        case 0x20: // UMULL{cond}
+                        {
+                            // 1S+mI+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
+                            arm_umull((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                      opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x24: // UMULL{cond}S
+                        {
+                            // 1S+mI+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
+                            arm_umulls((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                       opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x28: // UMLAL{cond}
+                        {
+                            // 1S+mI+2I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
+                            arm_umlal((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                      opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x2C: // UMLAL{cond}S
+                        {
+                            // 1S+mI+2I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_unsigned_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
+                            arm_umlals((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                       opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x30: // SMULL{cond}
+                        {
+                            // 1S+mI+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
+                            arm_smull((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                      opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x34: // SMULL{cond}S
+                        {
+                            // 1S+mI+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 1;
+                            arm_smulls((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                       opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x38: // SMLAL{cond}
+                        {
+                            // 1S+mI+2I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
+                            arm_smlal((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                      opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
+                        case 0x3C: // SMLAL{cond}S
+                        {
+                            // 1S+mI+2I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + arm_signed_mul_extra_cycles((opcode >> 16) & 0xF) + 2;
+                            arm_smlals((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                       opcode & 0xF, (opcode >> 8) & 0xF);
+                            break;
+                        }
 
-                                // Single Data Swap (SWP)
-                                //-------------------------
-
-                                case 0x60:
-                                case 0x64:
-                                case 0x68:
-                                case 0x6C:
-                                case 0x70:
-                                case 0x74:
-                                case 0x78:
-                                case 0x7C:
-                                {
-                                    CPU.R[R_PC] -= 4; // Undefined Instruction #0-1
-                                    clocks -= 100;    // Don't trap!!! ???
-                                    break;
-                                }
+                        // Single Data Swap (SWP)
+                        //-------------------------
+
+                        case 0x60:
+                        case 0x64:
+                        case 0x68:
+                        case 0x6C:
+                        case 0x70:
+                        case 0x74:
+                        case 0x78:
+                        case 0x7C:
+                        {
+                            CPU.R[R_PC] -= 4; // Undefined Instruction #0-1
+                            clocks -= 100;    // Don't trap!!! ???
+                            break;
+                        }
 
-                                case 0x40:
-                                case 0x44:
-                                case 0x48:
-                                case 0x4C:
-                                {
-                                    if ((opcode & (0xF00 | (3 << 20))))
-                                    {
-                                        CPU.R[R_PC] -= 4; // Undefined Instruction #0-1
-                                        clocks -= 100;    // Don't trap!!! ???
-                                        break;
-                                    }
-                                    // SWP{cond} Rd,Rm,[Rn]
-                                    u32 val = CPU.R[opcode & 0xF];
-                                    u32 addr = CPU.R[(opcode >> 16) & 0xF];
-                                    CPU.R[(opcode >> 12) & 0xF] = GBA_MemoryRead32(addr);
-                                    GBA_MemoryWrite32(addr, val);
-                                    // 1S+2N+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + (2 * GBA_MemoryGetAccessCyclesNoSeq32(addr)) + 1;
+                        case 0x40:
+                        case 0x44:
+                        case 0x48:
+                        case 0x4C:
+                        {
+                            if ((opcode & (0xF00 | (3 << 20))))
+                            {
+                                CPU.R[R_PC] -= 4; // Undefined Instruction #0-1
+                                clocks -= 100;    // Don't trap!!! ???
+                                break;
+                            }
+                            // SWP{cond} Rd,Rm,[Rn]
+                            u32 val = CPU.R[opcode & 0xF];
+                            u32 addr = CPU.R[(opcode >> 16) & 0xF];
+                            CPU.R[(opcode >> 12) & 0xF] = GBA_MemoryRead32(addr);
+                            GBA_MemoryWrite32(addr, val);
+                            // 1S+2N+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + (2 * GBA_MemoryGetAccessCyclesNoSeq32(addr)) + 1;
 
-                                    break;
-                                }
-                                case 0x50:
-                                case 0x54:
-                                case 0x58:
-                                case 0x5C:
-                                {
-                                    if ((opcode & (0xF00 | (3 << 20))))
-                                    {
-                                        CPU.R[R_PC] -= 4; // Undefined Instruction #0-1
-                                        clocks -= 100;    // DON'T TRAP!!! ???
-                                        break;
-                                    }
-                                    // SWP{cond}B Rd,Rm,[Rn]
-                                    u32 val = CPU.R[opcode & 0xF];
-                                    u32 addr = CPU.R[(opcode >> 16) & 0xF];
-                                    CPU.R[(opcode >> 12) & 0xF] = (u32)(u8)GBA_MemoryRead8(addr);
-                                    GBA_MemoryWrite8(addr, (u8)val);
-                                    // 1S+2N+1I
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC])
-                                              + (2 * GBA_MemoryGetAccessCyclesNoSeq16(addr)) + 1;
-                                    break;
-                                }
+                            break;
+                        }
+                        case 0x50:
+                        case 0x54:
+                        case 0x58:
+                        case 0x5C:
+                        {
+                            if ((opcode & (0xF00 | (3 << 20))))
+                            {
+                                CPU.R[R_PC] -= 4; // Undefined Instruction #0-1
+                                clocks -= 100;    // DON'T TRAP!!! ???
+                                break;
+                            }
+                            // SWP{cond}B Rd,Rm,[Rn]
+                            u32 val = CPU.R[opcode & 0xF];
+                            u32 addr = CPU.R[(opcode >> 16) & 0xF];
+                            CPU.R[(opcode >> 12) & 0xF] = (u32)(u8)GBA_MemoryRead8(addr);
+                            GBA_MemoryWrite8(addr, (u8)val);
+                            // 1S+2N+1I
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC])
+                                      + (2 * GBA_MemoryGetAccessCyclesNoSeq16(addr)) + 1;
+                            break;
+                        }
 
-                                // Halfword and Signed Data Transfer
-                                // ---------------------------------
-
-                                // Execution Time: For Normal LDR, 1S+1N+1I.
-                                //                 For LDR PC, 2S+2N+1I. For STRH 2N.
-
-                                // STR: opcodes 2 and 3, undefined -- 0 reserved for SWP and MULs
-                                case 0x02:
-                                case 0x03:
-                                case 0x0A:
-                                case 0x0B:
-                                case 0x12:
-                                case 0x13:
-                                case 0x1A:
-                                case 0x1B:
-                                case 0x22:
-                                case 0x23:
-                                case 0x2A:
-                                case 0x2B:
-                                case 0x32:
-                                case 0x33:
-                                case 0x3A:
-                                case 0x3B:
-                                case 0x42:
-                                case 0x43:
-                                case 0x4A:
-                                case 0x4B:
-                                case 0x52:
-                                case 0x53:
-                                case 0x5A:
-                                case 0x5B:
-                                case 0x62:
-                                case 0x63:
-                                case 0x6A:
-                                case 0x6B:
-                                case 0x72:
-                                case 0x73:
-                                case 0x7A:
-                                case 0x7B:
-                                {
-                                    CPU.R[R_PC] -= 4; // Undefined Instruction
-                                    clocks -= 100;    // Don't trap!!! ???
-                                    break;
-                                }
-                                // In post-indexing mode, writeback always enabled
-                                case 0x01:
-                                case 0x09: // STR{cond}H  Rd,[Rn],-Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address - CPU.R[Rm];
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
-                                }
-                                case 0x05:
-                                case 0x0D: // LDR{cond}H  Rd,[Rn],-Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address - CPU.R[Rm];
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x06:
-                                case 0x0E: // LDR{cond}SB Rd,[Rn],-Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address - CPU.R[Rm];
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x07:
-                                case 0x0F: // LDR{cond}SH Rd,[Rn],-Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address - CPU.R[Rm];
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x11:
-                                case 0x19: // STR{cond}H  Rd,[Rn],-#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address - offset;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
-                                }
-                                case 0x15:
-                                case 0x1D: // LDR{cond}H  Rd,[Rn],-#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address - offset;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x16:
-                                case 0x1E: // LDR{cond}SB Rd,[Rn],-#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address - offset;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x17:
-                                case 0x1F: // LDR{cond}SH Rd,[Rn],-#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address - offset;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x21:
-                                case 0x29: // STR{cond}H  Rd,[Rn],Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address + CPU.R[Rm];
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
-                                }
-                                case 0x25:
-                                case 0x2D: // LDR{cond}H  Rd,[Rn],Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address + CPU.R[Rm];
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x26:
-                                case 0x2E: // LDR{cond}SB Rd,[Rn],Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address + CPU.R[Rm];
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x27:
-                                case 0x2F: // LDR{cond}SH Rd,[Rn],Rm
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    CPU.R[Rn] = address + CPU.R[Rm];
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x31:
-                                case 0x39: // STR{cond}H  Rd,[Rn],#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address + offset;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address); // 2N
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
-                                }
-                                case 0x35:
-                                case 0x3D: // LDR{cond}H  Rd,[Rn],#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address + offset;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x36:
-                                case 0x3E: // LDR{cond}SB Rd,[Rn],#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address + offset;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x37:
-                                case 0x3F: // LDR{cond}SH Rd,[Rn],#
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    CPU.R[Rn] = address + offset;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                // In pre-indexing, writeback and no-writeback versions are different
-                                case 0x41: // STR{cond}H  Rd,[Rn,-Rm]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    break;
-                                }
-                                case 0x45: // LDR{cond}H  Rd,[Rn,-Rm]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x46: // LDR{cond}SB Rd,[Rn,-Rm]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x47: // LDR{cond}SH Rd,[Rn,-Rm]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x49: // STR{cond}H  Rd,[Rn,-Rm]!
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
-                                }
-                                case 0x4D: // LDR{cond}H  Rd,[Rn,-Rm]!
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x4E: // LDR{cond}SB Rd,[Rn,-Rm]!
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x4F: // LDR{cond}SH Rd,[Rn,-Rm]!
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address -= CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x51: // STR{cond}H  Rd,[Rn,-#]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    break;
-                                }
-                                case 0x55: // LDR{cond}H  Rd,[Rn,-#]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x56: // LDR{cond}SB Rd,[Rn,-#]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x57: // LDR{cond}SH Rd,[Rn,-#]
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
-                                }
-                                case 0x59: // STR{cond}H  Rd,[Rn,-#]!
-                                {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    CPU.R[Rn] = address;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
-                                }
-                                case 0x5D: // LDR{cond}H  Rd,[Rn,-#]!
+                        // Halfword and Signed Data Transfer
+                        // ---------------------------------
+
+                        // Execution Time: For Normal LDR, 1S+1N+1I.
+                        //                 For LDR PC, 2S+2N+1I. For STRH 2N.
+
+                        // STR: opcodes 2 and 3, undefined -- 0 reserved for SWP and MULs
+                        case 0x02:
+                        case 0x03:
+                        case 0x0A:
+                        case 0x0B:
+                        case 0x12:
+                        case 0x13:
+                        case 0x1A:
+                        case 0x1B:
+                        case 0x22:
+                        case 0x23:
+                        case 0x2A:
+                        case 0x2B:
+                        case 0x32:
+                        case 0x33:
+                        case 0x3A:
+                        case 0x3B:
+                        case 0x42:
+                        case 0x43:
+                        case 0x4A:
+                        case 0x4B:
+                        case 0x52:
+                        case 0x53:
+                        case 0x5A:
+                        case 0x5B:
+                        case 0x62:
+                        case 0x63:
+                        case 0x6A:
+                        case 0x6B:
+                        case 0x72:
+                        case 0x73:
+                        case 0x7A:
+                        case 0x7B:
+                        {
+                            CPU.R[R_PC] -= 4; // Undefined Instruction
+                            clocks -= 100;    // Don't trap!!! ???
+                            break;
+                        }
+                        // In post-indexing mode, writeback always enabled
+                        case 0x01:
+                        case 0x09: // STR{cond}H  Rd,[Rn],-Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address - CPU.R[Rm];
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x05:
+                        case 0x0D: // LDR{cond}H  Rd,[Rn],-Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address - CPU.R[Rm];
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x06:
+                        case 0x0E: // LDR{cond}SB Rd,[Rn],-Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address - CPU.R[Rm];
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x07:
+                        case 0x0F: // LDR{cond}SH Rd,[Rn],-Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address - CPU.R[Rm];
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x11:
+                        case 0x19: // STR{cond}H  Rd,[Rn],-#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address - offset;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x15:
+                        case 0x1D: // LDR{cond}H  Rd,[Rn],-#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address - offset;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x16:
+                        case 0x1E: // LDR{cond}SB Rd,[Rn],-#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address - offset;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x17:
+                        case 0x1F: // LDR{cond}SH Rd,[Rn],-#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address - offset;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x21:
+                        case 0x29: // STR{cond}H  Rd,[Rn],Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address + CPU.R[Rm];
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x25:
+                        case 0x2D: // LDR{cond}H  Rd,[Rn],Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address + CPU.R[Rm];
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x26:
+                        case 0x2E: // LDR{cond}SB Rd,[Rn],Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address + CPU.R[Rm];
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x27:
+                        case 0x2F: // LDR{cond}SH Rd,[Rn],Rm
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            CPU.R[Rn] = address + CPU.R[Rm];
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x31:
+                        case 0x39: // STR{cond}H  Rd,[Rn],#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address + offset;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address); // 2N
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x35:
+                        case 0x3D: // LDR{cond}H  Rd,[Rn],#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address + offset;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x36:
+                        case 0x3E: // LDR{cond}SB Rd,[Rn],#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address + offset;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x37:
+                        case 0x3F: // LDR{cond}SH Rd,[Rn],#
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            CPU.R[Rn] = address + offset;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        // In pre-indexing, writeback and no-writeback versions are different
+                        case 0x41: // STR{cond}H  Rd,[Rn,-Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            break;
+                        }
+                        case 0x45: // LDR{cond}H  Rd,[Rn,-Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x46: // LDR{cond}SB Rd,[Rn,-Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x47: // LDR{cond}SH Rd,[Rn,-Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x49: // STR{cond}H  Rd,[Rn,-Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x4D: // LDR{cond}H  Rd,[Rn,-Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x4E: // LDR{cond}SB Rd,[Rn,-Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x4F: // LDR{cond}SH Rd,[Rn,-Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address -= CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x51: // STR{cond}H  Rd,[Rn,-#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            break;
+                        }
+                        case 0x55: // LDR{cond}H  Rd,[Rn,-#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x56: // LDR{cond}SB Rd,[Rn,-#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x57: // LDR{cond}SH Rd,[Rn,-#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x59: // STR{cond}H  Rd,[Rn,-#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            CPU.R[Rn] = address;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x5D: // LDR{cond}H  Rd,[Rn,-#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x5E: // LDR{cond}SB Rd,[Rn,-#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x5F: // LDR{cond}SH Rd,[Rn,-#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address -= offset;
+                            CPU.R[Rn] = address;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x61: // STR{cond}H  Rd,[Rn,Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            break;
+                        }
+                        case 0x65: // LDR{cond}H  Rd,[Rn,Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x66: // LDR{cond}SB Rd,[Rn,Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x67: // LDR{cond}SH Rd,[Rn,Rm]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x69: // STR{cond}H  Rd,[Rn,Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x6D: // LDR{cond}H  Rd,[Rn,Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x6E: // LDR{cond}SB Rd,[Rn,Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x6F: // LDR{cond}SH Rd,[Rn,Rm]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 Rm = opcode & 0xF; // (not including R15)
+                            address += CPU.R[Rm];
+                            CPU.R[Rn] = address;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x71: // STR{cond}H  Rd,[Rn,#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            break;
+                        }
+                        case 0x75: // LDR{cond}H  Rd,[Rn,#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x76: // LDR{cond}SB Rd,[Rn,#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x77: // LDR{cond}SH Rd,[Rn,#]
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x79: // STR{cond}H  Rd,[Rn,#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            CPU.R[Rn] = address;
+                            GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
+                            // 2N
+                            clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                      + GBA_MemoryGetAccessCyclesNoSeq16(address);
+                            if (Rn == R_PC)
+                                CPU.R[R_PC] -= 4;
+                            break;
+                        }
+                        case 0x7D: // LDR{cond}H  Rd,[Rn,#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
+                            if (address & 1)
+                                CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x7E: // LDR{cond}SB Rd,[Rn,#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            CPU.R[Rn] = address;
+                            CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        case 0x7F: // LDR{cond}SH Rd,[Rn,#]!
+                        {
+                            u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
+                            u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
+                            u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
+                            u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+                            address += offset;
+                            CPU.R[Rn] = address;
+                            if (address & 1)
+                                CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
+                            else
+                                CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
+                                      + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
+                            if (Rd == 15)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                CPU.R[R_PC] -= 4;
+                            }
+                            else if (Rn == R_PC)
+                            {
+                                CPU.R[R_PC] -= 4;
+                            }
+                            break;
+                        }
+                        default: // ???
+                        {
+                            CPU.R[R_PC] -= 4;
+                            clocks -= 100;
+                            break;
+                        }
+                    }
+                    break;
+                }
+                case ARM_GROUP_DP_REG_SHIFT:
+                {
+                    switch (opcode >> 20)
+                    {
+                        case 0x12: // BX{cond} Rn
+                        {
+                            if ((opcode & 0x000FFFF0) == 0x000FFF10)
+                            {
+                                u32 Rn = opcode & 0xF;
+                                if (CPU.R[Rn] & 1) // Switch to THUMB
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.CPSR |= F_T;
+                                    CPU.R[R_PC] = (CPU.R[Rn] + (Rn == R_PC ? 8 : 0)) & (~1);
+                                    // 2S+1N
+                                    clocks -= (2 * GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC))
+                                              + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC]);
+
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x5E: // LDR{cond}SB Rd,[Rn,-#]!
+                                else
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.R[R_PC] = (CPU.R[Rn] + (Rn == R_PC ? 8 : 0)) & (~3);
                                 }
-                                case 0x5F: // LDR{cond}SH Rd,[Rn,-#]!
+                                CPU.R[R_PC] -= 4; // To avoid skipping an instruction
+                                // 2S+1N
+                                clocks -= (2 * GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC))
+                                          + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC]);
+                                break;
+                            }
+                            else
+                            {
+                                CPU.R[R_PC] -= 4; // Undefined Instruction
+                                clocks -= 100;    // Don't trap!!! ???
+                                break;
+                            }
+                        }
+
+                        // Data Processing, (Register shifted by Register) 2nd Operand
+                        // -----------------------------------------------------------
+
+                        // Execution time: 1S+1I+y
+                        // if 8~B -> y = 0;
+                        // else if (Rd=R15). y=1S+1N
+                        case 0x00:
+                            arm_and_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address -= offset;
-                                    CPU.R[Rn] = address;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x61: // STR{cond}H  Rd,[Rn,Rm]
+                            }
+                            break;
+                        case 0x01:
+                            arm_ands_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x65: // LDR{cond}H  Rd,[Rn,Rm]
+                            }
+                            break;
+                        case 0x02:
+                            arm_eor_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]); // 1S+1N
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x66: // LDR{cond}SB Rd,[Rn,Rm]
+                            }
+                            break;
+                        case 0x03:
+                            arm_eors_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x67: // LDR{cond}SH Rd,[Rn,Rm]
+                            }
+                            break;
+                        case 0x04:
+                            arm_sub_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x69: // STR{cond}H  Rd,[Rn,Rm]!
+                            }
+                            break;
+                        case 0x05:
+                            arm_subs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x6D: // LDR{cond}H  Rd,[Rn,Rm]!
+                            }
+                            break;
+                        case 0x06:
+                            arm_rsb_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x6E: // LDR{cond}SB Rd,[Rn,Rm]!
+                            }
+                            break;
+                        case 0x07:
+                            arm_rsbs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x6F: // LDR{cond}SH Rd,[Rn,Rm]!
+                            }
+                            break;
+                        case 0x08:
+                            arm_add_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 Rm = opcode & 0xF; // (not including R15)
-                                    address += CPU.R[Rm];
-                                    CPU.R[Rn] = address;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x71: // STR{cond}H  Rd,[Rn,#]
+                            }
+                            break;
+                        case 0x09:
+                            arm_adds_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x75: // LDR{cond}H  Rd,[Rn,#]
+                            }
+                            break;
+                        case 0x0A:
+                            arm_adc_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x76: // LDR{cond}SB Rd,[Rn,#]
+                            }
+                            break;
+                        case 0x0B:
+                            arm_adcs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x77: // LDR{cond}SH Rd,[Rn,#]
+                            }
+                            break;
+                        case 0x0C:
+                            arm_sbc_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x79: // STR{cond}H  Rd,[Rn,#]!
+                            }
+                            break;
+                        case 0x0D:
+                            arm_sbcs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    CPU.R[Rn] = address;
-                                    GBA_MemoryWrite16(address, CPU.R[Rd] + ((Rd == R_PC) ? 12 : 0));
-                                    // 2N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesNoSeq16(address);
-                                    if (Rn == R_PC)
-                                        CPU.R[R_PC] -= 4;
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x7D: // LDR{cond}H  Rd,[Rn,#]!
+                            }
+                            break;
+                        case 0x0E:
+                            arm_rsc_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (u32)GBA_MemoryRead16(address & ~1);
-                                    if (address & 1)
-                                        CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x7E: // LDR{cond}SB Rd,[Rn,#]!
+                            }
+                            break;
+                        case 0x0F:
+                            arm_rscs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    CPU.R[Rn] = address;
-                                    CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                case 0x7F: // LDR{cond}SH Rd,[Rn,#]!
+                            }
+                            break;
+                        case 0x11:
+                            arm_tst_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x13:
+                            arm_teq_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x15:
+                            arm_cmp_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x17:
+                            arm_cmn_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x18:
+                            arm_orr_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    u32 Rn = (opcode >> 16) & 0xF; // (including R15=PC+8)
-                                    u32 Rd = (opcode >> 12) & 0xF; // (including R15=PC+12)
-                                    u32 address = CPU.R[Rn] + ((Rn == R_PC) ? 8 : 0);
-                                    u32 offset = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
-                                    address += offset;
-                                    CPU.R[Rn] = address;
-                                    if (address & 1)
-                                        CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(address);
-                                    else
-                                        CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(address);
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
-                                              + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
-                                    if (Rd == 15)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    else if (Rn == R_PC)
-                                    {
-                                        CPU.R[R_PC] -= 4;
-                                    }
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                default: // ???
+                            }
+                            break;
+                        case 0x19:
+                            arm_orrs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    CPU.R[R_PC] -= 4;
-                                    clocks -= 100;
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
                             }
                             break;
-                        }
-                        else
-                        {
-                            switch (opcode >> 20)
+                        case 0x1A:
+                            arm_mov_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
                             {
-                                case 0x12: // BX{cond} Rn
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    if ((opcode & 0x000FFFF0) == 0x000FFF10)
-                                    {
-                                        u32 Rn = opcode & 0xF;
-                                        if (CPU.R[Rn] & 1) // Switch to THUMB
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.CPSR |= F_T;
-                                            CPU.R[R_PC] = (CPU.R[Rn] + (Rn == R_PC ? 8 : 0)) & (~1);
-                                            // 2S+1N
-                                            clocks -= (2 * GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC))
-                                                      + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC]);
-
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                        else
-                                        {
-                                            CPU.R[R_PC] = (CPU.R[Rn] + (Rn == R_PC ? 8 : 0)) & (~3);
-                                        }
-                                        CPU.R[R_PC] -= 4; // To avoid skipping an instruction
-                                        // 2S+1N
-                                        clocks -= (2 * GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC))
-                                                  + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC]);
-                                        break;
-                                    }
-                                    else
-                                    {
-                                        CPU.R[R_PC] -= 4; // Undefined Instruction
-                                        clocks -= 100;    // Don't trap!!! ???
-                                        break;
-                                    }
-                                }
-
-                                // Data Processing, (Register shifted by Register) 2nd Operand
-                                // -----------------------------------------------------------
-
-                                // Execution time: 1S+1I+y
-                                // if 8~B -> y = 0;
-                                // else if (Rd=R15). y=1S+1N
-                                case 0x00:
-                                    arm_and_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x01:
-                                    arm_ands_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x02:
-                                    arm_eor_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]); // 1S+1N
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x03:
-                                    arm_eors_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x04:
-                                    arm_sub_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x05:
-                                    arm_subs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x06:
-                                    arm_rsb_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x07:
-                                    arm_rsbs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x08:
-                                    arm_add_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x09:
-                                    arm_adds_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x0A:
-                                    arm_adc_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x0B:
-                                    arm_adcs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x0C:
-                                    arm_sbc_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x0D:
-                                    arm_sbcs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x0E:
-                                    arm_rsc_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x0F:
-                                    arm_rscs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x11:
-                                    arm_tst_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
-                                                    (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    break;
-                                case 0x13:
-                                    arm_teq_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
-                                                    (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    break;
-                                case 0x15:
-                                    arm_cmp_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
-                                                    (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    break;
-                                case 0x17:
-                                    arm_cmn_rshiftr((opcode >> 16) & 0xF, opcode & 0xF,
-                                                    (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    break;
-                                case 0x18:
-                                    arm_orr_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x19:
-                                    arm_orrs_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x1A:
-                                    arm_mov_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
-                                                    (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x1B:
-                                    arm_movs_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
-                                                     (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x1C:
-                                    arm_bic_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                    opcode & 0xF, (opcode >> 5) & 3,
-                                                    (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x1D:
-                                    arm_bics_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                     opcode & 0xF, (opcode >> 5) & 3,
-                                                     (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x1E:
-                                    arm_mvn_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
-                                                    (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x1F:
-                                    arm_mvns_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
-                                                     (opcode >> 5) & 3, (opcode >> 8) & 0xF);
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                    if (((opcode >> 12) & 0xF) == 0xF)
-                                    {
-                                        // 1S+1N
-                                        clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                                  + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                        if (CPU.CPSR & F_T)
-                                        {
-                                            CPU.EXECUTION_MODE = EXEC_THUMB;
-                                            CPU.R[R_PC] += 4;
-                                            return GBA_ExecuteTHUMB(clocks);
-                                        }
-                                    }
-                                    break;
-                                case 0x10:
-                                case 0x14:
-                                case 0x16:
-                                    CPU.R[R_PC] -= 4; // Undefined Instruction
-                                    clocks -= 100;    // Don't trap!!! ???
-                                    break;
-                                default: // ???
-                                    CPU.R[R_PC] -= 4;
-                                    clocks -= 100;
-                                    break;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
+                                }
                             }
                             break;
-                        }
-                    }
-                    else
-                    {
-                        switch (opcode >> 20)
-                        {
-                            // PSR Transfer (MRS, MSR)
-                            // -----------------------
-
-                            case 0x10: // MRS{cond} Rd,cpsr
-                            {
-                                //if ((opcode & ((0x3F << 16) | 0xFFF)) == ((0x0F << 16)))
-                                //{
-                                    CPU.R[(opcode >> 12) & 0xF] = CPU.CPSR;
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                //}
-                                //else
-                                //{
-                                //    //Undefined Instruction -- DON'T TRAP!!! ???
-                                //}
-                                break;
-                            }
-                            case 0x14: // MRS{cond} Rd,spsr
+                        case 0x1B:
+                            arm_movs_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
+                                             (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
                             {
-                                //if ((opcode & ((0x3F << 16) | 0xFFF)) == ((0x0F << 16)))
-                                //{
-                                    if (CPU.MODE == CPU_USER || CPU.MODE == CPU_SYSTEM)
-                                    {
-                                        Debug_DebugMsgArg("mrs Rd,spsr -- in user/system mode.\n"
-                                                          "pc = 0x%08X", CPU.R[R_PC]);
-                                        GBA_ExecutionBreak();
-                                    }
-                                    else
-                                    {
-                                        CPU.R[(opcode >> 12) & 0xF] = CPU.SPSR;
-                                    }
-                                    // 1S cycle
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                //}
-                                //else
-                                //{
-                                //    //Undefined Instruction -- Don't trap!!! ???
-                                //}
-                                break;
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
+                                {
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
+                                }
                             }
-                            case 0x12: // MSR{cond} cpsr{_field},Rm
+                            break;
+                        case 0x1C:
+                            arm_bic_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
                             {
-                                u32 value = CPU.R[opcode & 0xF];
-                                u32 result = 0;
-                                if (opcode & BIT(19))
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    result |= value & 0xFF000000;
-                                    CPU.CPSR &= 0x00FFFFFF;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                if (CPU.MODE != CPU_USER)
+                            }
+                            break;
+                        case 0x1D:
+                            arm_bics_rshiftr((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    if (opcode & BIT(18))
-                                    {
-                                        result |= value & 0x00FF0000;
-                                        CPU.CPSR &= 0xFF00FFFF;
-                                    }
-                                    if (opcode & BIT(17))
-                                    {
-                                        result |= value & 0x0000FF00;
-                                        CPU.CPSR &= 0xFFFF00FF;
-                                    }
-                                    if (opcode & BIT(16))
-                                    {
-                                        result |= value & 0x000000FF;
-                                        CPU.CPSR &= 0xFFFFFF00;
-                                        CPU.CPSR |= result;
-                                        GBA_CPUChangeMode(result & 0x1F);
-                                    }
-                                    else
-                                    {
-                                        CPU.CPSR |= result;
-                                    }
-                                    GBA_ExecutionBreak();
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                else
+                            }
+                            break;
+                        case 0x1E:
+                            arm_mvn_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    CPU.CPSR |= result;
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                break;
                             }
-                            case 0x16: // MSR{cond} spsr{_field},Rm
+                            break;
+                        case 0x1F:
+                            arm_mvns_rshiftr((opcode >> 12) & 0xF, opcode & 0xF,
+                                             (opcode >> 5) & 3, (opcode >> 8) & 0xF);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
                             {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
+                                {
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
+                                }
+                            }
+                            break;
+                        case 0x10:
+                        case 0x14:
+                        case 0x16:
+                            CPU.R[R_PC] -= 4; // Undefined Instruction
+                            clocks -= 100;    // Don't trap!!! ???
+                            break;
+                        default: // ???
+                            CPU.R[R_PC] -= 4;
+                            clocks -= 100;
+                            break;
+                    }
+                    break;
+                }
+                case ARM_GROUP_DP_IMM_SHIFT:
+                {
+                    switch (opcode >> 20)
+                    {
+                        // PSR Transfer (MRS, MSR)
+                        // -----------------------
+
+                        case 0x10: // MRS{cond} Rd,cpsr
+                        {
+                            //if ((opcode & ((0x3F << 16) | 0xFFF)) == ((0x0F << 16)))
+                            //{
+                                CPU.R[(opcode >> 12) & 0xF] = CPU.CPSR;
+                                // 1S cycle
+                                clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            //}
+                            //else
+                            //{
+                            //    //Undefined Instruction -- DON'T TRAP!!! ???
+                            //}
+                            break;
+                        }
+                        case 0x14: // MRS{cond} Rd,spsr
+                        {
+                            //if ((opcode & ((0x3F << 16) | 0xFFF)) == ((0x0F << 16)))
+                            //{
                                 if (CPU.MODE == CPU_USER || CPU.MODE == CPU_SYSTEM)
                                 {
-                                    Debug_DebugMsgArg("msr spsr,Rm -- in user/system mode.\n"
-                                                      "pc = 0x%08X",
-                                                      CPU.R[R_PC]);
-                                    GBA_ExecutionBreak();
-                                    clocks--;
-                                    break;
+                                    Debug_DebugMsgArg("mrs Rd,spsr -- in user/system mode.\n"
+                                                      "pc = 0x%08X", CPU.R[R_PC]);
+                                    GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
                                 }
-                                u32 value = CPU.R[opcode & 0xF];
-                                u32 result = 0;
-                                if (opcode & BIT(19))
+                                else
                                 {
-                                    result |= value & 0xFF000000;
-                                    CPU.SPSR &= 0x00FFFFFF;
+                                    CPU.R[(opcode >> 12) & 0xF] = CPU.SPSR;
                                 }
+                                // 1S cycle
+                                clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            //}
+                            //else
+                            //{
+                            //    //Undefined Instruction -- Don't trap!!! ???
+                            //}
+                            break;
+                        }
+                        case 0x12: // MSR{cond} cpsr{_field},Rm
+                        {
+                            u32 value = CPU.R[opcode & 0xF];
+                            u32 result = 0;
+                            if (opcode & BIT(19))
+                            {
+                                result |= value & 0xFF000000;
+                                CPU.CPSR &= 0x00FFFFFF;
+                            }
+                            if (CPU.MODE != CPU_USER)
+                            {
                                 if (opcode & BIT(18))
                                 {
                                     result |= value & 0x00FF0000;
-                                    CPU.SPSR &= 0xFF00FFFF;
+                                    CPU.CPSR &= 0xFF00FFFF;
                                 }
                                 if (opcode & BIT(17))
                                 {
                                     result |= value & 0x0000FF00;
-                                    CPU.SPSR &= 0xFFFF00FF;
+                                    CPU.CPSR &= 0xFFFF00FF;
                                 }
                                 if (opcode & BIT(16))
                                 {
                                     result |= value & 0x000000FF;
-                                    CPU.SPSR &= 0xFFFFFF00;
+                                    CPU.CPSR &= 0xFFFFFF00;
+                                    CPU.CPSR |= result;
+                                    GBA_CPUChangeMode(result & 0x1F);
                                 }
-                                CPU.SPSR |= result;
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                                else
+                                {
+                                    CPU.CPSR |= result;
+                                }
+                                GBA_ExecutionBreak(PROFILE_SLICE_IRQ);
+                            }
+                            else
+                            {
+                                CPU.CPSR |= result;
+                            }
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        }
+                        case 0x16: // MSR{cond} spsr{_field},Rm
+                        {
+                            if (CPU.MODE == CPU_USER || CPU.MODE == CPU_SYSTEM)
+                            {
+                                Debug_DebugMsgArg("msr spsr,Rm -- in user/system mode.\n"
+                                                  "pc = 0x%08X",
+                                                  CPU.R[R_PC]);
+                                GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
+                                clocks--;
                                 break;
                             }
+                            u32 value = CPU.R[opcode & 0xF];
+                            u32 result = 0;
+                            if (opcode & BIT(19))
+                            {
+                                result |= value & 0xFF000000;
+                                CPU.SPSR &= 0x00FFFFFF;
+                            }
+                            if (opcode & BIT(18))
+                            {
+                                result |= value & 0x00FF0000;
+                                CPU.SPSR &= 0xFF00FFFF;
+                            }
+                            if (opcode & BIT(17))
+                            {
+                                result |= value & 0x0000FF00;
+                                CPU.SPSR &= 0xFFFF00FF;
+                            }
+                            if (opcode & BIT(16))
+                            {
+                                result |= value & 0x000000FF;
+                                CPU.SPSR &= 0xFFFFFF00;
+                            }
+                            CPU.SPSR |= result;
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        }
 
-                            // Data Processing, (Shift by Inmediate) 2nd Operand
-                            // -------------------------------------------------
+                        // Data Processing, (Shift by Inmediate) 2nd Operand
+                        // -------------------------------------------------
 
-                            // Execution time: 1S+y
-                            // if 8~B -> y = 0;
-                            // else if (Rd=R15). y=1S+1N
-                            case 0x00:
-                                arm_and_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                        // Execution time: 1S+y
+                        // if 8~B -> y = 0;
+                        // else if (Rd=R15). y=1S+1N
+                        case 0x00:
+                            arm_and_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x01:
-                                arm_ands_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x01:
+                            arm_ands_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x02:
-                                arm_eor_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x02:
+                            arm_eor_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x03:
-                                arm_eors_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x03:
+                            arm_eors_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x04:
-                                arm_sub_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
-                                {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                            }
+                            break;
+                        case 0x04:
+                            arm_sub_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
+                                {
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x05:
-                                arm_subs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x05:
+                            arm_subs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x06:
-                                arm_rsb_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x06:
+                            arm_rsb_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x07:
-                                arm_rsbs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x07:
+                            arm_rsbs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x08:
-                                arm_add_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x08:
+                            arm_add_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x09:
-                                arm_adds_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x09:
+                            arm_adds_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x0A:
-                                arm_adc_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x0A:
+                            arm_adc_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x0B:
-                                arm_adcs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x0B:
+                            arm_adcs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x0C:
-                                arm_sbc_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x0C:
+                            arm_sbc_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x0D:
-                                arm_sbcs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x0D:
+                            arm_sbcs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x0E:
-                                arm_rsc_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x0E:
+                            arm_rsc_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x0F:
-                                arm_rscs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x0F:
+                            arm_rscs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x11:
-                                arm_tst_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
-                                                (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                break;
-                            case 0x13:
-                                arm_teq_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
-                                                (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                break;
-                            case 0x15:
-                                arm_cmp_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
-                                                (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                break;
-                            case 0x17:
-                                arm_cmn_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
-                                                (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                break;
-                            case 0x18:
-                                arm_orr_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x11:
+                            arm_tst_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x13:
+                            arm_teq_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x15:
+                            arm_cmp_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x17:
+                            arm_cmn_rshifti((opcode >> 16) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            break;
+                        case 0x18:
+                            arm_orr_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x19:
-                                arm_orrs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x19:
+                            arm_orrs_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x1A:
-                                arm_mov_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
-                                                (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x1A:
+                            arm_mov_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x1B:
-                                arm_movs_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
-                                                 (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x1B:
+                            arm_movs_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
+                                             (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x1C:
-                                arm_bic_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                opcode & 0xF, (opcode >> 5) & 3,
-                                                (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x1C:
+                            arm_bic_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                            opcode & 0xF, (opcode >> 5) & 3,
+                                            (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x1D:
-                                arm_bics_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
-                                                 opcode & 0xF, (opcode >> 5) & 3,
-                                                 (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x1D:
+                            arm_bics_rshifti((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
+                                             opcode & 0xF, (opcode >> 5) & 3,
+                                             (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x1E:
-                                arm_mvn_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
-                                                (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x1E:
+                            arm_mvn_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
+                                            (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            case 0x1F:
-                                arm_mvns_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
-                                                 (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
-                                // 1S cycle
-                                clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
-                                if (((opcode >> 12) & 0xF) == 0xF)
+                            }
+                            break;
+                        case 0x1F:
+                            arm_mvns_rshifti((opcode >> 12) & 0xF, opcode & 0xF,
+                                             (opcode >> 5) & 3, (opcode >> 7) & 0x1F);
+                            // 1S cycle
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
+                            if (((opcode >> 12) & 0xF) == 0xF)
+                            {
+                                // 1S+1N
+                                clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
+                                          + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
+                                if (CPU.CPSR & F_T)
                                 {
-                                    // 1S+1N
-                                    clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
-                                              + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
-                                    if (CPU.CPSR & F_T)
-                                    {
-                                        CPU.EXECUTION_MODE = EXEC_THUMB;
-                                        CPU.R[R_PC] += 4;
-                                        return GBA_ExecuteTHUMB(clocks);
-                                    }
+                                    CPU.EXECUTION_MODE = EXEC_THUMB;
+                                    CPU.R[R_PC] += 4;
+                                    return GBA_ExecuteTHUMB(clocks);
                                 }
-                                break;
-                            default: // ???
-                            {
-                                CPU.R[R_PC] -= 4;
-                                clocks -= 100;
-                                break;
                             }
+                            break;
+                        default: // ???
+                        {
+                            CPU.R[R_PC] -= 4;
+                            clocks -= 100;
+                            break;
                         }
-                        break;
                     }
                     break;
                 }
-                case 1:
+                case ARM_GROUP_DP_IMM:
                 {
                     switch (opcode >> 20)
                     {
@@ -2568,7 +2646,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         case 0x12: // MSR{cond} CPSR{_field},Imm
                         {
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             u32 value = ror_immed_no_carry(opcode & 0xFF, ((opcode >> 8) & 0xF) << 1);
                             u32 result = 0;
                             if (opcode & BIT(19))
@@ -2599,7 +2677,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                                 {
                                     CPU.CPSR |= result;
                                 }
-                                GBA_ExecutionBreak();
+                                GBA_ExecutionBreak(PROFILE_SLICE_IRQ);
                             }
                             else
                             {
@@ -2614,12 +2692,12 @@ s32 GBA_ExecuteARM(s32 clocks)
                                 Debug_DebugMsgArg("msr spsr,Inm -- in user/system mode.\n"
                                                   "pc = 0x%08X",
                                                   CPU.R[R_PC]);
-                                GBA_ExecutionBreak();
+                                GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
                                 clocks--;
                                 break;
                             }
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             u32 value = ror_immed_no_carry(opcode & 0xFF, ((opcode >> 8) & 0xF) << 1);
                             u32 result = 0;
                             if (opcode & BIT(19))
@@ -2656,7 +2734,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_and_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2674,7 +2752,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_ands_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2692,7 +2770,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_eor_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2710,7 +2788,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_eors_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2728,7 +2806,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_sub_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2746,7 +2824,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_subs_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2764,7 +2842,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_rsb_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2782,7 +2860,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_rsbs_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2800,7 +2878,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_add_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2818,7 +2896,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_adds_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2836,7 +2914,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_adc_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2854,7 +2932,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_adcs_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2872,7 +2950,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_sbc_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2890,7 +2968,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_sbcs_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2908,7 +2986,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_rsc_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2926,7 +3004,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_rscs_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2944,31 +3022,31 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_tst_immed((opcode >> 16) & 0xF, opcode & 0xFF,
                                           (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             break;
                         case 0x13:
                             arm_teq_immed((opcode >> 16) & 0xF, opcode & 0xFF,
                                           (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             break;
                         case 0x15:
                             arm_cmp_immed((opcode >> 16) & 0xF, opcode & 0xFF,
                                           (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             break;
                         case 0x17:
                             arm_cmn_immed((opcode >> 16) & 0xF, opcode & 0xFF,
                                           (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             break;
                         case 0x18:
                             arm_orr_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -2986,7 +3064,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_orrs_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3004,7 +3082,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_mov_immed((opcode >> 12) & 0xF, opcode & 0xFF,
                                           (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3022,7 +3100,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_movs_immed((opcode >> 12) & 0xF, opcode & 0xFF,
                                            (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3040,7 +3118,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_bic_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                           opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3058,7 +3136,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_bics_immed((opcode >> 12) & 0xF, (opcode >> 16) & 0xF,
                                            opcode & 0xFF, (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3076,7 +3154,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_mvn_immed((opcode >> 12) & 0xF, opcode & 0xFF,
                                           (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3094,7 +3172,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             arm_mvns_immed((opcode >> 12) & 0xF, opcode & 0xFF,
                                            (opcode >> 7) & 0x1E);
                             // 1S cycle
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
                             if (((opcode >> 12) & 0xF) == 0xF)
                             {
                                 // 1S+1N
@@ -3119,7 +3197,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                     }
                     break;
                 }
-                case 2:
+                case ARM_GROUP_LDR_STR_IMM:
                 {
                     // LDR/STR -- Inmediate as offset
                     u32 Rn = ((opcode >> 16) & 0xF); // (including R15=PC+8)
@@ -3146,7 +3224,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address - offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3174,7 +3252,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address - offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3200,7 +3278,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address + offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3226,7 +3304,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address + offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3248,7 +3326,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3272,7 +3350,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3294,7 +3372,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3318,7 +3396,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3340,7 +3418,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3364,7 +3442,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3386,7 +3464,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3410,7 +3488,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3427,7 +3505,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                     }
                     break;
                 }
-                case 3:
+                case ARM_GROUP_LDR_STR_REG:
                 {
                     if (opcode & BIT(4)) // Undefined Instruction
                     {
@@ -3465,7 +3543,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address - offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3493,7 +3571,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address - offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3519,7 +3597,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address + offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3545,7 +3623,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
                             CPU.R[Rn] = address + offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3567,7 +3645,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3591,7 +3669,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3613,7 +3691,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3637,7 +3715,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) - offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3659,7 +3737,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3683,7 +3761,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead32(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address) + 1;
                             if (Rd == 15)
                             {
@@ -3705,7 +3783,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                         {
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3729,7 +3807,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0) + offset;
                             CPU.R[Rn] = address;
                             CPU.R[Rd] = GBA_MemoryRead8(address);
-                            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                       + GBA_MemoryGetAccessCyclesNoSeq16(address) + 1;
                             if (Rd == 15)
                             {
@@ -3746,7 +3824,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                     }
                     break;
                 }
-                case 4:
+                case ARM_GROUP_LDM_STM:
                 {
                     //if ((opcode & (3 << 21)) == (3 << 21)) // ????
                     //{
@@ -3767,7 +3845,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                     if (Rn == 15)
                     {
                         Debug_DebugMsgArg("At %08X LDM/STM with base = PC.", CPU.R[R_PC]);
-                        GBA_ExecutionBreak();
+                        GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
                     }
 
                     //if (opcode & (1 << Rn))
@@ -3798,14 +3876,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                }
-                            }
+                            arm_stm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -3818,14 +3890,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -3849,21 +3915,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address + 4, opcode & 0xFFFF,
+                                                   bitcount, Rn, address);
+                            address += bitcount << 2;
 
                             clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -3877,14 +3931,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             address -= bitcount << 2;
                             CPU.R[Rn] = address;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -3911,14 +3959,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                }
-                            }
+                            arm_stm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             GBA_CPUChangeMode(oldcpu);
 
@@ -3944,14 +3986,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -3980,21 +4016,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address + 4, opcode & 0xFFFF,
+                                                   bitcount, Rn, address);
+                            address += bitcount << 2;
 
                             GBA_CPUChangeMode(oldcpu);
 
@@ -4021,14 +4045,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             address -= bitcount << 2;
                             CPU.R[Rn] = address;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4053,14 +4071,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_stm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -4072,14 +4084,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn] + (Rn == 15 ? 8 : 0); // Tested in real hardware
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4102,21 +4108,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4 + bitcount * 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address, opcode & 0xFFFF,
+                                                   bitcount, Rn, address + bitcount * 4);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4135,14 +4129,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             else
                                 address += 8;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4170,14 +4158,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_stm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             GBA_CPUChangeMode(oldcpu);
 
@@ -4202,14 +4184,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4236,21 +4212,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4 + bitcount * 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address, opcode & 0xFFFF,
+                                                   bitcount, Rn, address + bitcount * 4);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4278,14 +4242,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             CPU.R[Rn] += bitcount * 4;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4312,14 +4270,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_stm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -4332,14 +4284,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4365,21 +4311,9 @@ s32 GBA_ExecuteARM(s32 clocks)
 
                             //CPU.R[Rn] = address;
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address, opcode & 0xFFFF,
+                                                   bitcount, Rn, address);
+                            address += bitcount << 2;
 
                             clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -4393,14 +4327,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             address -= bitcount << 2;
                             CPU.R[Rn] = address;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4427,14 +4355,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_stm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             GBA_CPUChangeMode(oldcpu);
 
@@ -4460,14 +4382,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             address -= bitcount << 2;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4498,21 +4414,9 @@ s32 GBA_ExecuteARM(s32 clocks)
 
                             //CPU.R[Rn] = address;
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_stm(address, i);
-                                    address += 4;
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address, opcode & 0xFFFF,
+                                                   bitcount, Rn, address);
+                            address += bitcount << 2;
 
                             GBA_CPUChangeMode(oldcpu);
 
@@ -4539,14 +4443,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             address -= bitcount << 2;
                             CPU.R[Rn] = address;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    arm_ldm(address, i);
-                                    address += 4;
-                                }
-                            }
+                            arm_ldm_list(address, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4571,14 +4469,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                }
-                            }
+                            arm_stm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             clocks -= GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                       + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -4590,14 +4482,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4620,21 +4506,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4 + bitcount * 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address + 4, opcode & 0xFFFF,
+                                                   bitcount, Rn, address + bitcount * 4);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4650,14 +4524,8 @@ s32 GBA_ExecuteARM(s32 clocks)
 
                             CPU.R[Rn] += bitcount * 4;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4685,14 +4553,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                }
-                            }
+                            arm_stm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             GBA_CPUChangeMode(oldcpu);
 
@@ -4717,14 +4579,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             if (opcode & BIT(15))
                             {
@@ -4751,21 +4607,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 address = CPU.R[Rn];
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
 
-                            int isfirst = 1;
-
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_stm(address, i);
-                                    if (isfirst)
-                                    {
-                                        CPU.R[Rn] = address - 4 + bitcount * 4;
-                                        isfirst = 0;
-                                    }
-                                }
-                            }
+                            arm_stm_list_writeback(address + 4, opcode & 0xFFFF,
+                                                   bitcount, Rn, address + bitcount * 4);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4793,14 +4637,8 @@ s32 GBA_ExecuteARM(s32 clocks)
                             u32 bitcount = arm_bit_count(opcode & 0xFFFF);
                             CPU.R[Rn] += bitcount * 4;
 
-                            for (int i = 0; i < 16; i++)
-                            {
-                                if (opcode & BIT(i))
-                                {
-                                    address += 4;
-                                    arm_ldm(address, i);
-                                }
-                            }
+                            arm_ldm_list(address + 4, opcode & 0xFFFF, bitcount);
+                            address += bitcount << 2;
 
                             //CPU.R[Rn] = address;
 
@@ -4828,7 +4666,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                     }
                     break;
                 }
-                case 5:
+                case ARM_GROUP_B_BL:
                 {
                     if (opcode & BIT(24)) // BL{cond}
                     {
@@ -4841,19 +4679,19 @@ s32 GBA_ExecuteARM(s32 clocks)
                     CPU.R[R_PC] -= 4; // To avoid skipping an instruction
 
                     // 2S + 1N cycles
-                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                    clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                               + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                               + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
                     break;
                 }
-                case 6:
+                case ARM_GROUP_COP_TRANSFER:
                 {
                     // Coprocessor Data Transfers (LDC,STC)
                     // Irrelevant in GBA because no coprocessor exists.
                     ARM_UNDEFINED_INSTRUCTION();
                     break;
                 }
-                case 7:
+                case ARM_GROUP_COP_SWI:
                 {
                     if (opcode & BIT(24))
                     {
@@ -4869,12 +4707,9 @@ s32 GBA_ExecuteARM(s32 clocks)
                             }
                             if (swinummber != 4)
                             {
-                                GBA_Swi(swinummber);
-                                // Delay some arbitrary time
-                                // TODO: Have a list of average time costs? This
-                                // would be hard for swiCopy() or decompression
-                                // routines.
-                                clocks -= 50;
+                                // TODO: The time of the copy and
+                                // decompression routines is arbitrary.
+                                clocks -= GBA_Swi(swinummber);
                                 break;
                             }
                         }
@@ -4890,7 +4725,7 @@ s32 GBA_ExecuteARM(s32 clocks)
 
                         CPU.R[R_PC] = 4;
                         // 2S + 1N cycles
-                        clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC)
+                        clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC)
                                   + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_PC])
                                   + GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_PC]);
                         break;
@@ -4914,7 +4749,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                             else
                             {
                                 Debug_DebugMsgArg("CP14 ICEbreaker used!");
-                                GBA_ExecutionBreak();
+                                GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
 
                                 // MRC{cond} Pn,<cpopc>,Rd,Cn,Cm{,<cp>}   ;move from CoPro to ARM
                                 if (opcode & BIT(20))
@@ -4933,7 +4768,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                                     }
 
                                     // 1S+(b+1)I+1C cycles (b = 0?)
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC) + 1 + 1;
+                                    clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC) + 1 + 1;
                                     break;
                                 }
                                 else // MCR{cond} Pn,<cpopc>,Rd,Cn,Cm{,<cp>}   ;move from ARM to CoPro
@@ -4941,7 +4776,7 @@ s32 GBA_ExecuteARM(s32 clocks)
                                     // No effect (?)
 
                                     // 1S+bI+1C cycles (b = 0?)
-                                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.OldPC) + 0 + 1;
+                                    clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.OldPC) + 0 + 1;
                                     break;
                                 }
                             }
@@ -4959,10 +4794,20 @@ s32 GBA_ExecuteARM(s32 clocks)
         else
         {
             // 1S cycle
-            clocks -= GBA_MemoryGetAccessCycles(PCseq, 1, CPU.R[R_PC]);
+            clocks -= GBA_MemoryGetFetchCycles(PCseq, 1, CPU.R[R_PC]);
         }
 
+#ifdef ENABLE_OPCODE_PROFILE
+        if (opprofile)
+            OPProfile_Cycles(opprofile_index, opprofile_clocks - clocks);
+#endif
+
         CPU.R[R_PC] += 4;
+
+        // Short jumps backwards can be idle loops. OldPC is the address of the
+        // instruction that has just been executed.
+        if ((CPU.OldPC - CPU.R[R_PC]) < GBA_IDLE_LOOP_MAX_SIZE)
+            clocks = GBA_CPUIdleLoopCheck(clocks);
     }
 
     return clocks;
@@ -31,8 +31,7 @@ static void arm_ands_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u8 carry;
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 & ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -57,8 +56,7 @@ static void arm_eors_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u8 carry;
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 ^ ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -86,10 +84,8 @@ static void arm_subs_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u64 t2 = ~ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, CPU.R[Rd]) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, CPU.R[Rd]));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -116,11 +112,8 @@ static void arm_rsbs_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u32 t2 = ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW((u32)t1, t2, CPU.R[Rd]) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW((u32)t1, t2, CPU.R[Rd]));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -146,11 +139,7 @@ static void arm_adds_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u32 t2 = ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, CPU.R[Rd]) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, ADD_OVERFLOW(t1, t2, CPU.R[Rd]));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -176,11 +165,7 @@ static void arm_adcs_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u32 t2 = ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, CPU.R[Rd]) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, ADD_OVERFLOW(t1, t2, CPU.R[Rd]));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -206,11 +191,8 @@ static void arm_sbcs_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u64 t2 = (u64)~ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2 + ((CPU.CPSR & F_C) ? 1ULL : 0ULL);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -236,11 +218,8 @@ static void arm_rscs_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u64 t2 = (u64) ~(CPU.R[Rn] + (Rn == 15 ? 8 : 0));
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -257,8 +236,7 @@ static void arm_tst_immed(u32 Rn, u32 val, u32 ror_bits)
     u8 carry;
     u32 tmp = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
               & ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (tmp ? 0 : F_Z) | (tmp & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(tmp, carry);
 }
 
 static void arm_teq_immed(u32 Rn, u32 val, u32 ror_bits)
@@ -266,8 +244,7 @@ static void arm_teq_immed(u32 Rn, u32 val, u32 ror_bits)
     u8 carry;
     u32 tmp = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
               ^ ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (tmp ? 0 : F_Z) | (tmp & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(tmp, carry);
 }
 
 static void arm_cmp_immed(u32 Rn, u32 val, u32 ror_bits)
@@ -276,11 +253,8 @@ static void arm_cmp_immed(u32 Rn, u32 val, u32 ror_bits)
     u32 t1 = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
     u32 t2 = ~ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
 }
 
 static void arm_cmn_immed(u32 Rn, u32 val, u32 ror_bits)
@@ -288,11 +262,7 @@ static void arm_cmn_immed(u32 Rn, u32 val, u32 ror_bits)
     u32 t1 = CPU.R[Rn] + (Rn == 15 ? 8 : 0);
     u32 t2 = ror_immed_no_carry(val, ror_bits);
     u64 temp = (u64)t1 + (u64)t2;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
 }
 
 static void arm_orr_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
@@ -308,8 +278,7 @@ static void arm_orrs_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u8 carry;
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 | ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -332,8 +301,7 @@ static void arm_movs_immed(u32 Rd, u32 val, u32 ror_bits)
 {
     u8 carry;
     CPU.R[Rd] = ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -358,8 +326,7 @@ static void arm_bics_immed(u32 Rd, u32 Rn, u32 val, u32 ror_bits)
     u8 carry;
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 & ~ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -382,8 +349,7 @@ static void arm_mvns_immed(u32 Rd, u32 val, u32 ror_bits)
 {
     u8 carry;
     CPU.R[Rd] = ~ror_immed(val, ror_bits, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -413,8 +379,7 @@ static void arm_ands_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 12 : 0))
                 & cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                    CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -442,8 +407,7 @@ static void arm_eors_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 12 : 0))
                 ^ cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                    CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -473,11 +437,8 @@ static void arm_subs_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
                                         CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, CPU.R[Rd]) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, CPU.R[Rd]));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -507,11 +468,8 @@ static void arm_rsbs_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
                                        CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW((u32)t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW((u32)t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -540,11 +498,7 @@ static void arm_adds_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
                                        CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -574,11 +528,7 @@ static void arm_adcs_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
                                        CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -609,11 +559,8 @@ static void arm_sbcs_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
                                              CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -642,11 +589,8 @@ static void arm_rscs_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
                                        CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW((u32)t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW((u32)t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -664,8 +608,7 @@ static void arm_tst_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
     u32 tmp = (CPU.R[Rn] + (Rn == 15 ? 12 : 0))
               & cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                  CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (tmp ? 0 : F_Z) | (tmp & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(tmp, carry);
 }
 
 static void arm_teq_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
@@ -674,8 +617,7 @@ static void arm_teq_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
     u32 tmp = (CPU.R[Rn] + (Rn == 15 ? 12 : 0))
               ^ cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                  CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (tmp ? 0 : F_Z) | (tmp & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(tmp, carry);
 }
 
 static void arm_cmp_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
@@ -685,11 +627,8 @@ static void arm_cmp_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
     u64 t2 = ~cpu_shift_by_reg_no_carry(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                         CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
 }
 
 static void arm_cmn_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
@@ -698,11 +637,7 @@ static void arm_cmn_rshiftr(u32 Rn, u32 Rm, u32 shift, u32 Rs)
     u32 t2 = cpu_shift_by_reg_no_carry(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                        CPU.R[Rs]);
     u64 temp = (u64)t1 + (u64)t2;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
 }
 
 static void arm_orr_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
@@ -721,8 +656,7 @@ static void arm_orrs_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 12 : 0))
                 | cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                    CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -748,8 +682,7 @@ static void arm_movs_rshiftr(u32 Rd, u32 Rm, u32 shift, u32 Rs)
     u8 carry;
     CPU.R[Rd] = cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                  CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -777,8 +710,7 @@ static void arm_bics_rshiftr(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 Rs)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 12 : 0))
                 & ~cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                     CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -804,8 +736,7 @@ static void arm_mvns_rshiftr(u32 Rd, u32 Rm, u32 shift, u32 Rs)
     u8 carry;
     CPU.R[Rd] = ~cpu_shift_by_reg(shift, CPU.R[Rm] + (Rm == 15 ? 12 : 0),
                                   CPU.R[Rs], &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -835,8 +766,7 @@ static void arm_ands_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 & cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                      value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -864,8 +794,7 @@ static void arm_eors_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 ^ cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                      value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -895,11 +824,8 @@ static void arm_subs_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                                           value);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -928,11 +854,8 @@ static void arm_rsbs_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                                          value);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW((u32)t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW((u32)t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -961,11 +884,7 @@ static void arm_adds_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                                          value);
     u64 temp = (u64)t1 + (u64)t2;
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -995,11 +914,7 @@ static void arm_adcs_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                                          CPU.R[Rm] + (Rm == 15 ? 8 : 0), value);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1030,11 +945,8 @@ static void arm_sbcs_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                                                value);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1063,11 +975,8 @@ static void arm_rscs_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                                          value);
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1 : 0);
     CPU.R[Rd] = (u32)temp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1085,8 +994,7 @@ static void arm_tst_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
     u32 tmp = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
               & cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                    value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (tmp ? 0 : F_Z) | (tmp & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(tmp, carry);
 }
 
 static void arm_teq_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
@@ -1095,8 +1003,7 @@ static void arm_teq_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
     u32 tmp = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
               ^ cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                    value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (tmp ? 0 : F_Z) | (tmp & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(tmp, carry);
 }
 
 static void arm_cmp_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
@@ -1107,11 +1014,8 @@ static void arm_cmp_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
                                           CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                           value);
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, (u32)t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32,
+                        ADD_OVERFLOW(t1, (u32)t2, (u32)temp));
 }
 
 static void arm_cmn_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
@@ -1120,11 +1024,7 @@ static void arm_cmn_rshifti(u32 Rn, u32 Rm, u32 shift, u32 value)
     u32 t2 = cpu_shift_by_immed_no_carry(shift,
                                          CPU.R[Rm] + (Rm == 15 ? 8 : 0), value);
     u64 temp = (u64)t1 + (u64)t2;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
 }
 
 static void arm_orr_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
@@ -1143,8 +1043,7 @@ static void arm_orrs_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
     CPU.R[Rd] = (CPU.R[Rn] + (Rn == 15 ? 8 : 0))
                 | cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                      value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1170,8 +1069,7 @@ static void arm_movs_rshifti(u32 Rd, u32 Rm, u32 shift, u32 value)
     u8 carry;
     CPU.R[Rd] = cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                    value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1200,8 +1098,7 @@ static void arm_bics_rshifti(u32 Rd, u32 Rn, u32 Rm, u32 shift, u32 value)
                 & ~cpu_shift_by_immed(shift,
                                       CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                       value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1227,8 +1124,7 @@ static void arm_mvns_rshifti(u32 Rd, u32 Rm, u32 shift, u32 value)
     u8 carry;
     CPU.R[Rd] = ~cpu_shift_by_immed(shift, CPU.R[Rm] + (Rm == 15 ? 8 : 0),
                                     value, &carry);
-    CPU.CPSR &= ~(F_Z | F_C | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
     if (Rd == 15)
     {
         if (CPU.MODE != CPU_USER)
@@ -1309,8 +1205,7 @@ static void arm_mul(u32 Rd, u32 Rm, u32 Rs)
 static void arm_muls(u32 Rd, u32 Rm, u32 Rs)
 {
     CPU.R[Rd] = ((s32)CPU.R[Rm]) * ((s32)CPU.R[Rs]);
-    CPU.CPSR &= ~(F_Z | F_N); // Carry destroyed
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]); // Carry destroyed
 }
 
 static void arm_mla(u32 Rd, u32 Rm, u32 Rs, u32 Rn)
@@ -1321,8 +1216,7 @@ static void arm_mla(u32 Rd, u32 Rm, u32 Rs, u32 Rn)
 static void arm_mlas(u32 Rd, u32 Rm, u32 Rs, u32 Rn)
 {
     CPU.R[Rd] = (((s32)CPU.R[Rm]) * ((s32)CPU.R[Rs])) + (s32)CPU.R[Rn];
-    CPU.CPSR &= ~(F_Z | F_N); // Carry destroyed
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]); // Carry destroyed
 }
 
 static void arm_umull(u32 RdLo, u32 RdHi, u32 Rm, u32 Rs)
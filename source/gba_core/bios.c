@@ -9,16 +9,24 @@
 #include <string.h>
 
 #include "../build_options.h"
+#include "../config.h"
 #include "../debug_utils.h"
+#include "../trace_utils.h"
 
 #include "cpu.h"
+#include "disassembler.h"
 #include "dma.h"
 #include "memory.h"
 #include "sound.h"
+#include "video.h"
 
 //------------------------------------------------------------------------------
 
-static int gba_bios_loaded_from_file;
+static core_local__ int gba_bios_loaded_from_file;
+
+// Sine table used by the affine SWIs. 256 entries for a full turn, 1.14 fixed
+// point. It's the same one that the real BIOS has.
+static core_local__ s16 gba_bios_sin_table[256];
 
 void GBA_BiosLoaded(int loaded)
 {
@@ -49,6 +57,76 @@ void GBA_BiosEmulatedLoad(void)
     };
 
     memcpy(Mem.rom_bios, gba_bios, sizeof(gba_bios));
+
+    for (int i = 0; i < 256; i++)
+    {
+        double angle = (2.0 * M_PI * i) / 256.0;
+        gba_bios_sin_table[i] = (s16)lround(sin(angle) * (double)(1 << 14));
+    }
+}
+
+// The IRQ vector of the emulated BIOS saves some registers and jumps to the
+// handler of the game. The handler returns to 0x70, where they are restored:
+//
+//     0x18: B     0x60
+//     0x60: STMFD SP!, {R0-R3, R12, LR}
+//     0x64: MOV   R0, #0x04000000
+//     0x68: ADD   LR, PC, #0          ; LR = 0x70
+//     0x6C: LDR   PC, [R0, #-4]       ; [0x03FFFFFC] = [0x03007FFC]
+//     0x70: LDMFD SP!, {R0-R3, R12, LR}
+//     0x74: SUBS  PC, LR, #4
+//
+// Everything up to the jump to the handler is done here, and the clocks that
+// GBA_ExecuteARM() counts for those instructions are subtracted. If they
+// wouldn't all be executed in this slice, nothing is done.
+s32 GBA_BiosIRQVectorHLE(s32 clocks)
+{
+    // The code of the BIOS has to be executed if it's being debugged
+    if ((EmulatorConfig.gba_hle_irq == 0) || gba_bios_loaded_from_file
+        || trace_enabled || GBA_DebugCPUBreakpointsUsed())
+        return clocks;
+
+    u32 sp = CPU.R[R_SP];
+
+    // B 0x60
+    s32 used = GBA_MemoryGetFetchCycles(0, 1, 0x18)
+               + GBA_MemoryGetAccessCyclesNoSeq32(0x5C)
+               + GBA_MemoryGetAccessCyclesSeq32(0x5C);
+
+    // STMFD SP!, {R0-R3, R12, LR}
+    used += GBA_MemoryGetAccessCyclesNoSeq32(0x60)
+            + GBA_MemoryGetAccessCyclesNoSeq32(sp)
+            + (GBA_MemoryGetAccessCyclesSeq32(sp) * 5);
+
+    // MOV R0, #0x04000000
+    used += GBA_MemoryGetFetchCycles(1, 1, 0x64);
+
+    // ADD LR, PC, #0
+    used += GBA_MemoryGetFetchCycles(1, 1, 0x68);
+
+    // The LDR is executed if there are clocks left before it
+    if (used >= clocks)
+        return clocks;
+
+    const u32 regs[6] = { 0, 1, 2, 3, 12, R_LR };
+    for (int i = 0; i < 6; i++)
+        GBA_MemoryWrite32((sp - 24 + (i * 4)) & ~3, CPU.R[regs[i]]);
+    CPU.R[R_SP] = sp - 24;
+
+    CPU.R[0] = 0x04000000;
+    CPU.R[R_LR] = 0x70;
+
+    // LDR PC, [R0, #-4]
+    u32 handler = GBA_MemoryRead32(0x03FFFFFC);
+    used += GBA_MemoryGetFetchCycles(1, 1, 0x6C)
+            + GBA_MemoryGetAccessCyclesNoSeq32(0x03FFFFFC) + 1
+            + GBA_MemoryGetAccessCyclesNoSeq32(handler)
+            + GBA_MemoryGetAccessCyclesSeq32(handler);
+
+    CPU.OldPC = 0x6C;
+    CPU.R[R_PC] = handler;
+
+    return clocks - used;
 }
 
 //------------------------------------------------------------------------------
@@ -58,6 +136,7 @@ static void GBA_SWI_SoftReset(void)
     u8 ret_flag = GBA_MemoryRead8(0x3007FFA);
 
     memset(&(Mem.iwram[0x03007E00 - 0x03000000]), 0, 0x200);
+    GBA_MemoryBlockModified(0x03007E00, 0x200);
     memset(&CPU, 0, sizeof(CPU));
 
     CPU.EXECUTION_MODE = EXEC_ARM;
@@ -66,10 +145,10 @@ static void GBA_SWI_SoftReset(void)
     //GBA_CPUChangeMode(M_SYSTEM);
 
     CPU.R[R_SP] = 0x03007F00;
-    CPU.R_user[13 - 8] = 0x03007F00;
+    CPU.bank[CPU_USER].R13 = 0x03007F00;
 
-    CPU.R13_svc = 0x03007FE0;
-    CPU.R13_irq = 0x03007FA0;
+    CPU.bank[CPU_SUPERVISOR].R13 = 0x03007FE0;
+    CPU.bank[CPU_IRQ].R13 = 0x03007FA0;
 
     if (ret_flag)
     {
@@ -92,23 +171,32 @@ static void GBA_SWI_RegisterRamReset(void)
     if (r0 & BIT(0)) // 256K on-board WRAM
     {
         memset(Mem.ewram, 0, sizeof(Mem.ewram));
+        GBA_MemoryBlockModified(0x02000000, sizeof(Mem.ewram));
     }
     if (r0 & BIT(1)) // 32K in-chip WRAM -- excluding last 200h bytes
     {
         // The range excluded is 3007E00h - 3007FFFh
         memset(Mem.iwram, 0, sizeof(Mem.iwram) - 0x200);
+        GBA_MemoryBlockModified(0x03000000, sizeof(Mem.iwram) - 0x200);
     }
     if (r0 & BIT(2)) // Palette
     {
         memset(Mem.pal_ram, 0, sizeof(Mem.pal_ram));
+        gba_video_memory_version++;
+        GBA_MemoryDirtySetAll(GBA_DIRTY_PAL);
     }
     if (r0 & BIT(3)) // VRAM
     {
         memset(Mem.vram, 0, sizeof(Mem.vram));
+        gba_video_memory_version++;
+        GBA_VideoInvalidateAllVRAM();
+        GBA_MemoryDirtySetAll(GBA_DIRTY_VRAM);
     }
     if (r0 & BIT(4)) // OAM
     {
         memset(Mem.oam, 0, sizeof(Mem.oam));
+        gba_video_memory_version++;
+        GBA_MemoryDirtySetAll(GBA_DIRTY_OAM);
     }
     if (r0 & BIT(5)) // Reset SIO registers
     {
@@ -196,26 +284,33 @@ static void GBA_SWI_RegisterRamReset(void)
     GBA_MemoryWrite16(DISPCNT, 0x0080);
 }
 
-static void GBA_SWI_CpuSet(void)
+// Copies or fills "count" units of "unit" bytes from the address in R0 to the
+// address in R1, and updates the registers. If both ranges are in plain memory
+// it is done as a single block copy, if not it goes through the memory
+// handlers one unit at a time.
+static void GBA_BiosCpuSet(u32 count, u32 unit, int fill)
 {
-    int count = CPU.R[2] & 0x001FFFFF;
-    CPU.R[2] &= ~0x001FFFFF;
+    s32 srcadd = fill ? 0 : (s32)unit;
 
-    if (CPU.R[2] & BIT(26)) // 32 bit
+    if (GBA_MemoryCopyBlock(CPU.R[1], unit, CPU.R[0], srcadd, count, unit))
     {
-        CPU.R[0] &= ~3;
-        CPU.R[1] &= ~3;
+        CPU.R[0] += srcadd * count;
+        CPU.R[1] += unit * count;
+        return;
+    }
 
-        if (CPU.R[2] & BIT(24)) // Fill
+    if (unit == 4)
+    {
+        if (fill)
         {
-            u32 fill = GBA_MemoryRead32(CPU.R[0]);
+            u32 data = GBA_MemoryRead32(CPU.R[0]);
             while (count--)
             {
-                GBA_MemoryWrite32(CPU.R[1], fill);
+                GBA_MemoryWrite32(CPU.R[1], data);
                 CPU.R[1] += 4;
             }
         }
-        else // Copy
+        else
         {
             while (count--)
             {
@@ -225,21 +320,18 @@ static void GBA_SWI_CpuSet(void)
             }
         }
     }
-    else // 16 bit
+    else
     {
-        CPU.R[0] &= ~1;
-        CPU.R[1] &= ~1;
-
-        if (CPU.R[2] & BIT(24)) // Fill
+        if (fill)
         {
-            u16 fill = GBA_MemoryRead16(CPU.R[0]);
+            u16 data = GBA_MemoryRead16(CPU.R[0]);
             while (count--)
             {
-                GBA_MemoryWrite16(CPU.R[1], fill);
+                GBA_MemoryWrite16(CPU.R[1], data);
                 CPU.R[1] += 2;
             }
         }
-        else // Copy
+        else
         {
             while (count--)
             {
@@ -251,119 +343,396 @@ static void GBA_SWI_CpuSet(void)
     }
 }
 
+static void GBA_SWI_CpuSet(void)
+{
+    u32 count = CPU.R[2] & 0x001FFFFF;
+    CPU.R[2] &= ~0x001FFFFF;
+
+    int fill = CPU.R[2] & BIT(24);
+
+    if (CPU.R[2] & BIT(26)) // 32 bit
+    {
+        CPU.R[0] &= ~3;
+        CPU.R[1] &= ~3;
+        GBA_BiosCpuSet(count, 4, fill);
+    }
+    else // 16 bit
+    {
+        CPU.R[0] &= ~1;
+        CPU.R[1] &= ~1;
+        GBA_BiosCpuSet(count, 2, fill);
+    }
+}
+
 static void GBA_SWI_CpuFastSet(void)
 {
-    int count = CPU.R[2] & 0x001FFFF8; // Must be a multiple of 8 words
+    u32 count = CPU.R[2] & 0x001FFFF8; // Must be a multiple of 8 words
     CPU.R[2] &= ~0x001FFFFF;
 
     CPU.R[0] &= ~3;
     CPU.R[1] &= ~3;
 
-    if (CPU.R[2] & BIT(24)) // Fill
+    GBA_BiosCpuSet(count, 4, CPU.R[2] & BIT(24));
+}
+
+// The clocks of the math SWIs are approximations of what the code of the BIOS
+// takes, including the SWI call and return. The ones of the SWIs that don't
+// have a model are arbitrary.
+#define BIOS_SWI_CLOCKS             (50)
+#define BIOS_SWI_CALL_CLOCKS        (26)
+
+#define BIOS_AFFINE_OBJ_CLOCKS      (24) // Per element
+#define BIOS_AFFINE_BG_CLOCKS       (52) // Per element
+
+// Clocks of a multiplication with this value as multiplier (see
+// arm_signed_mul_extra_cycles())
+static s32 GBA_BiosMulClocks(s32 value)
+{
+    u32 temp = (value < 0) ? ~(u32)value : (u32)value;
+
+    if (temp & 0xFF000000)
+        return 4;
+    if (temp & 0x00FF0000)
+        return 3;
+    if (temp & 0x0000FF00)
+        return 2;
+    return 1;
+}
+
+static int GBA_BiosBitLength(u32 value)
+{
+    int bits = 0;
+
+    while (value)
     {
-        u32 fill = GBA_MemoryRead32(CPU.R[0]);
-        while (count--)
+        value >>= 1;
+        bits++;
+    }
+
+    return bits;
+}
+
+// The BIOS divides with a shift and subtract loop. It runs one iteration for
+// each bit of difference between the lengths of the absolute values.
+static s32 GBA_BiosDiv(s32 num, s32 den, s32 *quot, s32 *rem)
+{
+    u32 abs_num = (num < 0) ? -(u32)num : (u32)num;
+    u32 abs_den = (den < 0) ? -(u32)den : (u32)den;
+
+    if (den == -1) // Avoid the overflow of 0x80000000 / -1
+    {
+        *quot = (s32)(-(u32)num);
+        *rem = 0;
+    }
+    else
+    {
+        *quot = num / den;
+        *rem = num % den;
+    }
+
+    int loops = GBA_BiosBitLength(abs_num) - GBA_BiosBitLength(abs_den);
+    if (loops < 1)
+        loops = 1;
+
+    return 4 + (13 * loops) + 7;
+}
+
+static s32 GBA_SWI_Div(u8 number, s32 num, s32 den)
+{
+    if (den == 0)
+    {
+        Debug_DebugMsgArg("SWI 0x%02X: Division by 0", number);
+        return BIOS_SWI_CLOCKS;
+    }
+
+    s32 quot, rem;
+    s32 clocks = GBA_BiosDiv(num, den, &quot, &rem);
+
+    CPU.R[0] = quot;
+    CPU.R[1] = rem;
+    CPU.R[3] = (quot < 0) ? -(u32)quot : (u32)quot;
+
+    return BIOS_SWI_CALL_CLOCKS + clocks;
+}
+
+// The BIOS calculates one bit of the result in each iteration
+static s32 GBA_SWI_Sqrt(void)
+{
+    u32 value = CPU.R[0];
+
+    CPU.R[0] = (u16)sqrt(value);
+
+    return BIOS_SWI_CALL_CLOCKS + 8
+           + (11 * ((GBA_BiosBitLength(value) + 1) / 2));
+}
+
+// Polynomial approximation used by the BIOS. Not accurate at the bounds.
+//
+// tan: 16bit: 1bit sign, 1bit integral part, 14bit decimal part
+// Return: "-PI/2 < THETA < PI/2" in a range of C000h-4000h.
+static s32 GBA_BiosArcTan(s32 tan, s32 *clocks)
+{
+    static const s32 coefficients[7] = {
+        0x390, 0x91C, 0xFB6, 0x16AA, 0x2081, 0x3651, 0xA259
+    };
+
+    s32 a = -((tan * tan) >> 14);
+    s32 r = ((0xA9 * a) >> 14) + coefficients[0];
+
+    // The rest of the code plus the internal cycles of each multiplication
+    *clocks += 37 + GBA_BiosMulClocks(tan) + GBA_BiosMulClocks(a);
+
+    for (int i = 1; i < 7; i++)
+    {
+        *clocks += GBA_BiosMulClocks(r);
+        r = ((a * r) >> 14) + coefficients[i];
+    }
+
+    *clocks += GBA_BiosMulClocks(r);
+
+    return (tan * r) >> 16;
+}
+
+static s32 GBA_SWI_ArcTan(void)
+{
+    s32 clocks = 0;
+    CPU.R[0] = GBA_BiosArcTan((s32)CPU.R[0], &clocks);
+    return BIOS_SWI_CALL_CLOCKS + clocks;
+}
+
+// X and Y are 1.1.14 fixed point. The angle is calculated with ArcTan() from
+// the ratio of the smaller to the bigger value.
+//
+// Return: 0000h-FFFFh for 0 <= THETA < 2PI.
+static s32 GBA_SWI_ArcTan2(void)
+{
+    s32 x = (s16)CPU.R[0];
+    s32 y = (s16)CPU.R[1];
+    s32 clocks = 0;
+    s32 tan, rem;
+    u32 result;
+
+    if (y == 0)
+    {
+        result = (x >= 0) ? 0x0000 : 0x8000;
+        clocks = 11;
+    }
+    else if (x == 0)
+    {
+        result = (y >= 0) ? 0x4000 : 0xC000;
+        clocks = 11;
+    }
+    else if (y >= 0)
+    {
+        if ((x >= 0) && (x >= y))
         {
-            GBA_MemoryWrite32(CPU.R[1], fill);
-            CPU.R[1] += 4;
+            clocks = GBA_BiosDiv(y << 14, x, &tan, &rem);
+            result = GBA_BiosArcTan(tan, &clocks);
+        }
+        else if ((x < 0) && (-x >= y))
+        {
+            clocks = GBA_BiosDiv(y << 14, x, &tan, &rem);
+            result = GBA_BiosArcTan(tan, &clocks) + 0x8000;
+        }
+        else
+        {
+            clocks = GBA_BiosDiv(x << 14, y, &tan, &rem);
+            result = 0x4000 - GBA_BiosArcTan(tan, &clocks);
         }
     }
-    else // Copy
+    else
     {
-        while (count--)
+        if ((x <= 0) && (-x > -y))
+        {
+            clocks = GBA_BiosDiv(y << 14, x, &tan, &rem);
+            result = GBA_BiosArcTan(tan, &clocks) + 0x8000;
+        }
+        else if ((x > 0) && (x >= -y))
         {
-            GBA_MemoryWrite32(CPU.R[1], GBA_MemoryRead32(CPU.R[0]));
-            CPU.R[1] += 4;
-            CPU.R[0] += 4;
+            clocks = GBA_BiosDiv(y << 14, x, &tan, &rem);
+            result = GBA_BiosArcTan(tan, &clocks) + 0x10000;
+        }
+        else
+        {
+            clocks = GBA_BiosDiv(x << 14, y, &tan, &rem);
+            result = 0xC000 - GBA_BiosArcTan(tan, &clocks);
         }
     }
+
+    CPU.R[0] = result & 0xFFFF;
+
+    return BIOS_SWI_CALL_CLOCKS + clocks;
 }
 
-static void GBA_SWI_BgAffineSet(void)
+// Rotation and scaling matrix. The scale factors are 8.8 fixed point, and only
+// the upper 8 bits of the angle are used (256 steps in a full turn).
+static void GBA_BiosAffineMatrix(s16 sx, s16 sy, u16 angle, s16 *matrix)
 {
-    int count = CPU.R[2];
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
+    s32 sin_ = gba_bios_sin_table[angle >> 8];
+    s32 cos_ = gba_bios_sin_table[((angle >> 8) + 64) & 0xFF];
+
+    matrix[0] = (cos_ * sx) >> 14;  // PA
+    matrix[1] = (-sin_ * sx) >> 14; // PB
+    matrix[2] = (sin_ * sy) >> 14;  // PC
+    matrix[3] = (cos_ * sy) >> 14;  // PD
+}
+
+// Source: 20 bytes per element
+//
+//   s32 Original data's center X (8bit fractional portion)
+//   s32 Original data's center Y (8bit fractional portion)
+//   s16 Display's center X
+//   s16 Display's center Y
+//   s16 Scaling ratio in X direction (8bit fractional portion)
+//   s16 Scaling ratio in Y direction (8bit fractional portion)
+//   u16 Angle of rotation (8bit fractional portion)
+//
+// Destination: 16 bytes per element
+//
+//   s16 PA, PB, PC, PD
+//   s32 Start X, Start Y
+static void GBA_BiosBgAffineElement(const u8 *src, u8 *dst)
+{
+    s32 cx = *(const u32 *)&src[0];
+    s32 cy = *(const u32 *)&src[4];
+    s16 dispx = *(const u16 *)&src[8];
+    s16 dispy = *(const u16 *)&src[10];
+    s16 sx = *(const u16 *)&src[12];
+    s16 sy = *(const u16 *)&src[14];
+    u16 angle = *(const u16 *)&src[16];
+
+    s16 m[4];
+    GBA_BiosAffineMatrix(sx, sy, angle, m);
+
+    *(u16 *)&dst[0] = m[0];
+    *(u16 *)&dst[2] = m[1];
+    *(u16 *)&dst[4] = m[2];
+    *(u16 *)&dst[6] = m[3];
+    *(u32 *)&dst[8] = cx - ((m[0] * dispx) + (m[1] * dispy));
+    *(u32 *)&dst[12] = cy - ((m[2] * dispx) + (m[3] * dispy));
+}
+
+static s32 GBA_SWI_BgAffineSet(void)
+{
+    u32 src = CPU.R[0] & ~3;
+    u32 dst = CPU.R[1] & ~3;
+    u32 count = CPU.R[2];
 
-    while (count--)
+    if (count == 0)
+        return BIOS_SWI_CALL_CLOCKS;
+
+    s32 clocks = BIOS_SWI_CALL_CLOCKS + (count * BIOS_AFFINE_BG_CLOCKS);
+
+    // Process all elements from and to memory directly if possible
+    const u8 *src_ptr = NULL;
+    u8 *dst_ptr = NULL;
+
+    if (count < 0x100000)
     {
-        s32 cx = GBA_MemoryRead32(src);
-        src += 4;
-        s32 cy = GBA_MemoryRead32(src);
-        src += 4;
-        float dispx = (float)(s16)GBA_MemoryRead16(src);
-        src += 2;
-        float dispy = (float)(s16)GBA_MemoryRead16(src);
-        src += 2;
-        float sx = ((float)(s16)GBA_MemoryRead16(src)) / (float)(1 << 8);
-        src += 2;
-        float sy = ((float)(s16)GBA_MemoryRead16(src)) / (float)(1 << 8);
-        src += 2;
-        float angle = (float)2.0 * (float)M_PI
-                      * (((float)(u8)(GBA_MemoryRead16(src) >> 8)) / (float)0xFF);
-        src += 4; // Align
-
-        float sin_ = sin(angle);
-        float cos_ = cos(angle);
-        s16 A = (s16)(cos_ * (float)(1 << 8) * sx);
-        s16 B = (s16)(-sin_ * (float)(1 << 8) * sx);
-        s16 C = (s16)(sin_ * (float)(1 << 8) * sy);
-        s16 D = (s16)(cos_ * (float)(1 << 8) * sy);
-
-        GBA_MemoryWrite16(dst, A);
-        dst += 2;
-        GBA_MemoryWrite16(dst, B);
-        dst += 2;
-        GBA_MemoryWrite16(dst, C);
-        dst += 2;
-        GBA_MemoryWrite16(dst, D);
-        dst += 2;
+        src_ptr = GBA_MemoryGetReadPointer(src, count * 20);
+        dst_ptr = GBA_MemoryGetWritePointer(dst, count * 16);
+    }
 
-        s32 startx = cx - (s32)((cos_ * sx * dispx - sin_ * sx * dispy)
-                   * (float)(1 << 8));
-        s32 starty = cy - (s32)((sin_ * sy * dispx + cos_ * sy * dispy)
-                   * (float)(1 << 8));
+    if (src_ptr && dst_ptr)
+    {
+        for (u32 i = 0; i < count; i++)
+            GBA_BiosBgAffineElement(&src_ptr[i * 20], &dst_ptr[i * 16]);
 
-        GBA_MemoryWrite32(dst, startx);
-        dst += 4;
-        GBA_MemoryWrite32(dst, starty);
-        dst += 4;
+        GBA_MemoryBlockModified(dst, count * 16);
+        return clocks;
     }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        u32 in[5];
+        for (int j = 0; j < 5; j++)
+            in[j] = GBA_MemoryRead32(src + (j * 4));
+
+        u32 out[4];
+        GBA_BiosBgAffineElement((const u8 *)in, (u8 *)out);
+
+        for (int j = 0; j < 4; j++)
+            GBA_MemoryWrite32(dst + (j * 4), out[j]);
+
+        src += 20;
+        dst += 16;
+    }
+
+    return clocks;
 }
 
-static void GBA_SWI_ObjAffineSet(void)
+// Source: 8 bytes per element
+//
+//   s16 Scaling ratio in X direction (8bit fractional portion)
+//   s16 Scaling ratio in Y direction (8bit fractional portion)
+//   u16 Angle of rotation (8bit fractional portion)
+//   u16 Unused
+//
+// Destination: PA, PB, PC and PD, with R3 bytes between them (2 for an array,
+// 8 to write them to the OAM directly).
+static s32 GBA_SWI_ObjAffineSet(void)
 {
-    int addressadd = CPU.R[3];
-    int count = CPU.R[2];
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
+    u32 src = CPU.R[0] & ~1;
+    u32 dst = CPU.R[1] & ~1;
+    u32 count = CPU.R[2];
+    s32 stride = CPU.R[3];
+
+    if (count == 0)
+        return BIOS_SWI_CALL_CLOCKS;
+
+    s32 clocks = BIOS_SWI_CALL_CLOCKS + (count * BIOS_AFFINE_OBJ_CLOCKS);
 
-    while (count--)
+    // Process all elements from and to memory directly if possible
+    const u8 *src_ptr = NULL;
+    u8 *dst_ptr = NULL;
+    u32 dst_size = 0;
+
+    if ((stride > 0) && (stride < 0x100) && ((stride & 1) == 0)
+        && (count < 0x10000))
     {
-        float sx = ((float)(s16)GBA_MemoryRead16(src)) / (float)(1 << 8);
-        src += 2;
-        float sy = ((float)(s16)GBA_MemoryRead16(src)) / (float)(1 << 8);
-        src += 2;
-        float angle = (float)2.0 * (float)M_PI
-                      * (((float)(u8)(GBA_MemoryRead16(src) >> 8)) / (float)0xFF);
-        src += 4; // Align
-
-        float sin_ = sin(angle);
-        float cos_ = cos(angle);
-        s16 A = (s16)(cos_ * (float)(1 << 8) * sx);
-        s16 B = (s16)(-sin_ * (float)(1 << 8) * sx);
-        s16 C = (s16)(sin_ * (float)(1 << 8) * sy);
-        s16 D = (s16)(cos_ * (float)(1 << 8) * sy);
-
-        GBA_MemoryWrite16(dst, A);
-        dst += addressadd;
-        GBA_MemoryWrite16(dst, B);
-        dst += addressadd;
-        GBA_MemoryWrite16(dst, C);
-        dst += addressadd;
-        GBA_MemoryWrite16(dst, D);
-        dst += addressadd;
+        dst_size = (((count * 4) - 1) * stride) + 2;
+        src_ptr = GBA_MemoryGetReadPointer(src, count * 8);
+        dst_ptr = GBA_MemoryGetWritePointer(dst, dst_size);
     }
+
+    if (src_ptr && dst_ptr)
+    {
+        u8 *out = dst_ptr;
+
+        for (u32 i = 0; i < count; i++)
+        {
+            const u8 *in = &src_ptr[i * 8];
+
+            s16 m[4];
+            GBA_BiosAffineMatrix(*(const u16 *)&in[0], *(const u16 *)&in[2],
+                                 *(const u16 *)&in[4], m);
+
+            for (int j = 0; j < 4; j++)
+            {
+                *(u16 *)out = m[j];
+                out += stride;
+            }
+        }
+
+        GBA_MemoryBlockModified(dst, dst_size);
+        return clocks;
+    }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        s16 m[4];
+        GBA_BiosAffineMatrix(GBA_MemoryRead16(src), GBA_MemoryRead16(src + 2),
+                             GBA_MemoryRead16(src + 4), m);
+        src += 8;
+
+        for (int j = 0; j < 4; j++)
+        {
+            GBA_MemoryWrite16(dst, m[j]);
+            dst += stride;
+        }
+    }
+
+    return clocks;
 }
 
 static void GBA_SWI_BitUnPack(void)
@@ -416,7 +785,7 @@ static void GBA_SWI_BitUnPack(void)
                 break;
             default:
                 Debug_DebugMsgArg("SWI 0x10: Invalid src width");
-                GBA_ExecutionBreak();
+                GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
                 return;
         }
         if (src_bitindex == 8)
@@ -443,7 +812,7 @@ static void GBA_SWI_BitUnPack(void)
                 break;
             default:
                 Debug_DebugMsgArg("SWI 0x10: Invalid dst width");
-                GBA_ExecutionBreak();
+                GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
                 return;
         }
         if (dst_bitindex == 32)
@@ -455,153 +824,200 @@ static void GBA_SWI_BitUnPack(void)
     }
 }
 
-static void GBA_SWI_LZ77UnCompWram(void)
+// The decompression functions read the source and write the destination
+// directly from host memory when they are in plain memory regions. When not,
+// they go through the memory handlers, using the same access size as the BIOS
+// for the destination.
+
+typedef struct
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 1)
-    //{
-    //    Debug_DebugMsgArg("SWI 11 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    u8 *buffer = malloc(size + 2);
-    if (buffer == NULL)
+    u32 address; // Address of the next byte to read
+    u32 start;   // Address of ptr[0]
+    u32 size;    // Bytes that can be read from ptr
+    const u8 *ptr;
+} _bios_input_t;
+
+static void GBA_BiosInputInit(_bios_input_t *in, u32 address)
+{
+    in->address = address;
+    in->start = address;
+    in->size = 0;
+    in->ptr = GBA_MemoryGetReadRegion(address, &in->size);
+    if (in->ptr == NULL)
+        in->size = 0;
+}
+
+static inline u8 GBA_BiosInputRead8(_bios_input_t *in)
+{
+    u32 address = in->address++;
+    u32 offset = address - in->start;
+    if (offset < in->size)
+        return in->ptr[offset];
+    return GBA_MemoryRead8(address);
+}
+
+static inline u32 GBA_BiosInputRead32(_bios_input_t *in)
+{
+    u32 address = in->address;
+    u32 offset = address - in->start;
+    in->address += 4;
+    // Misaligned reads are rotated by the memory handlers
+    if (((address & 3) == 0) && (offset < in->size) && (in->size - offset >= 4))
+        return *(const u32 *)&in->ptr[offset];
+    return GBA_MemoryRead32(address);
+}
+
+typedef struct
+{
+    u32 address; // Start of the destination
+    u32 unit;    // Size of the writes of the BIOS: 1, 2 or 4 bytes
+    u32 size;    // Size of the output
+    u32 total;   // Bytes written so far
+    u8 *ptr;     // Host pointer to the destination, or NULL
+    u32 pending; // Bytes of the current unit when ptr is NULL
+} _bios_output_t;
+
+static void GBA_BiosOutputInit(_bios_output_t *out, u32 address, u32 size,
+                               u32 unit)
+{
+    out->address = address & ~(unit - 1);
+    out->unit = unit;
+    out->size = size;
+    out->total = 0;
+    out->pending = 0;
+
+    // Bytes written by the BIOS, including the padding of the last unit
+    u32 rounded = (size + unit - 1) & ~(unit - 1);
+
+    out->ptr = NULL;
+    if ((unit > 1) || ((address >> 24) == 2) || ((address >> 24) == 3))
+        out->ptr = GBA_MemoryGetWritePointer(out->address, rounded);
+}
+
+static inline void GBA_BiosOutputWrite8(_bios_output_t *out, u8 data)
+{
+    if (out->ptr != NULL)
     {
-        Debug_ErrorMsgArg("SWI 11 - Couldn't allocate memory");
-        GBA_ExecutionBreak();
+        out->ptr[out->total++] = data;
         return;
     }
-    u8 *buffertmp = buffer;
-    int total = 0;
-    while (size > total)
+
+    u32 shift = (out->total & (out->unit - 1)) * 8;
+    out->pending |= (u32)data << shift;
+    out->total++;
+
+    if ((out->total & (out->unit - 1)) == 0)
     {
-        u8 flag = GBA_MemoryRead8(src++);
-        for (int i = 0; i < 8; i++)
-        {
-            if (flag & 0x80)
-            {
-                // Compressed - Copy N+3 Bytes from Dest-Disp-1 to Dest
-                u16 info = ((u16)GBA_MemoryRead8(src++)) << 8;
-                info |= (u16)GBA_MemoryRead8(src++);
-                u32 displacement = (info & 0x0FFF);
-                int num = 3 + ((info >> 12) & 0xF);
-                u32 offset = total - displacement - 1;
-                if (offset > total) // This also checks for negative values
-                {
-                    Debug_ErrorMsgArg("SWI 11 - Error while decoding");
-                    GBA_ExecutionBreak();
-                    free(buffer);
-                    return;
-                }
-                while (num--)
-                {
-                    *buffertmp++ = ((u8 *)buffer)[offset++];
-                    total++;
-                    if (size <= total)
-                        break;
-                }
-            }
-            else
-            {
-                // Uncompressed - Copy 1 Byte from Source to Dest
-                *buffertmp++ = GBA_MemoryRead8(src++);
-                total++;
-                if (size <= total)
-                    break;
-            }
-            flag <<= 1;
-        }
+        u32 address = out->address + out->total - out->unit;
+        if (out->unit == 4)
+            GBA_MemoryWrite32(address, out->pending);
+        else if (out->unit == 2)
+            GBA_MemoryWrite16(address, out->pending);
+        else
+            GBA_MemoryWrite8(address, out->pending);
+        out->pending = 0;
     }
-    // Copy to VRAM in 16 bit blocks
-    u8 *dstbuf = buffer;
-    while (size--)
-        GBA_MemoryWrite8(dst++, *dstbuf++);
-    free(buffer);
 }
 
-static void GBA_SWI_LZ77UnCompVram(void)
+// Reads back a byte that has already been written
+static inline u8 GBA_BiosOutputRead8(_bios_output_t *out, u32 offset)
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
+    if (out->ptr != NULL)
+        return out->ptr[offset];
 
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
+    u32 unit_start = out->total & ~(out->unit - 1);
+    if (offset >= unit_start)
+        return out->pending >> ((offset - unit_start) * 8);
+    return GBA_MemoryRead8(out->address + offset);
+}
+
+static void GBA_BiosOutputEnd(_bios_output_t *out)
+{
+    // The last unit is padded with zeroes
+    while (out->total & (out->unit - 1))
+        GBA_BiosOutputWrite8(out, 0);
+
+    if (out->ptr != NULL)
+        GBA_MemoryBlockModified(out->address, out->total);
+}
+
+static void GBA_SWI_LZ77UnComp(int swi, u32 unit)
+{
+    _bios_input_t in;
+    GBA_BiosInputInit(&in, CPU.R[0]);
+
+    u32 header = GBA_BiosInputRead32(&in);
     //if (((header >> 4) & 7) != 1)
     //{
-    //    Debug_DebugMsgArg("SWI 12 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
+    //    Debug_DebugMsgArg("SWI %02X -- Compression type %d -- ABORTED",
+    //                      swi, ((header >> 4) & 7));
     //    return;
     //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    u16 *buffer = malloc(size + 2);
-    if (buffer == NULL)
-    {
-        Debug_ErrorMsgArg("SWI 12 - Couldn't allocate memory");
-        GBA_ExecutionBreak();
-        return;
-    }
-    u8 *buffertmp = (u8 *)buffer;
-    int total = 0;
-    while (size > total)
+    u32 size = (header >> 8) & 0x00FFFFFF;
+
+    _bios_output_t out;
+    GBA_BiosOutputInit(&out, CPU.R[1], size, unit);
+
+    while (size > out.total)
     {
-        u8 flag = GBA_MemoryRead8(src++);
+        u8 flag = GBA_BiosInputRead8(&in);
         for (int i = 0; i < 8; i++)
         {
             if (flag & 0x80)
             {
                 // Compressed - Copy N+3 Bytes from Dest-Disp-1 to Dest
-                u16 info = ((u16)GBA_MemoryRead8(src++)) << 8;
-                info |= (u16)GBA_MemoryRead8(src++);
+                u16 info = ((u16)GBA_BiosInputRead8(&in)) << 8;
+                info |= (u16)GBA_BiosInputRead8(&in);
                 u32 displacement = (info & 0x0FFF);
                 int num = 3 + ((info >> 12) & 0xF);
-                u32 offset = total - displacement - 1;
-                if (offset > total) // This also checks for negative values
+                u32 offset = out.total - displacement - 1;
+                if (offset > out.total) // This also checks for negative values
                 {
-                    Debug_ErrorMsgArg("SWI 12 - Error while decoding");
-                    GBA_ExecutionBreak();
-                    free(buffer);
+                    Debug_ErrorMsgArg("SWI %02X - Error while decoding", swi);
+                    GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
+                    GBA_BiosOutputEnd(&out);
                     return;
                 }
                 while (num--)
                 {
-                    *buffertmp++ = ((u8 *)buffer)[offset++];
-                    total++;
-                    if (size <= total)
+                    GBA_BiosOutputWrite8(&out,
+                                         GBA_BiosOutputRead8(&out, offset++));
+                    if (size <= out.total)
                         break;
                 }
+                if (size <= out.total)
+                    break;
             }
             else
             {
                 // Uncompressed - Copy 1 Byte from Source to Dest
-                *buffertmp++ = GBA_MemoryRead8(src++);
-                total++;
-                if (size <= total)
+                GBA_BiosOutputWrite8(&out, GBA_BiosInputRead8(&in));
+                if (size <= out.total)
                     break;
             }
             flag <<= 1;
         }
     }
-    // Copy to VRAM in 16 bit blocks
-    u16 *dstbuf = buffer;
-    while (size > 0)
-    {
-        GBA_MemoryWrite16(dst, *dstbuf++);
-        dst += 2;
-        size -= 2;
-    }
-    free(buffer);
+
+    GBA_BiosOutputEnd(&out);
+}
+
+static void GBA_SWI_LZ77UnCompWram(void)
+{
+    GBA_SWI_LZ77UnComp(0x11, 1);
+}
+
+static void GBA_SWI_LZ77UnCompVram(void)
+{
+    GBA_SWI_LZ77UnComp(0x12, 2); // Written in 16 bit blocks
 }
 
 static void GBA_SWI_HuffUnComp(void)
 {
-    int src = CPU.R[0] & ~3;
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
+    _bios_input_t in;
+    GBA_BiosInputInit(&in, CPU.R[0] & ~3);
+
+    u32 header = GBA_BiosInputRead32(&in);
     //if (((header >> 4) & 7) != 2)
     //{
     //    Debug_DebugMsgArg("SWI 13 -- Compression type %d -- ABORTED",
@@ -612,44 +1028,49 @@ static void GBA_SWI_HuffUnComp(void)
     if ((chunk_size != 4) && (chunk_size != 8))
     {
         Debug_ErrorMsgArg("SWI 0x13 - Data size error: %d", chunk_size);
-        GBA_ExecutionBreak();
-        return;
-    }
-    int size = (header >> 8) & 0x00FFFFFF;
-    u32 *buffer = malloc(size + 2);
-    if (buffer == NULL)
-    {
-        Debug_ErrorMsgArg("SWI 13 - Couldn't allocate memory");
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
         return;
     }
-    u8 *buffertmp = (u8 *)buffer;
+    u32 size = (header >> 8) & 0x00FFFFFF;
+
+    _bios_output_t out;
+    GBA_BiosOutputInit(&out, CPU.R[1], size, 4); // Written in 32 bit blocks
+
+    u32 treesize = (((u32)GBA_BiosInputRead8(&in)) * 2) + 1;
+    u32 treetable = in.address;
+    in.address += treesize; // Bitstream
+
+    // The nodes are read from the tree table directly if possible
+    u32 tree_left = 0;
+    const u8 *tree = GBA_MemoryGetReadRegion(treetable, &tree_left);
+    if (tree == NULL)
+        tree_left = 0;
 
-    u32 treesize = (((u32)GBA_MemoryRead8(src++)) * 2) + 1;
-    u32 treetable = src;
-    src += treesize; // Bitstream
-    int total = 0;
     int bit4index = 0;
     int bitsleft = 0;
     u32 bitstream = 0;
+    u8 data = 0;
 
     while (1)
     {
         int searching = 1;
         u32 nodeaddr = treetable;
+        u8 nodeinfo;
         while (searching)
         {
             if (bitsleft == 0)
             {
-                bitstream = GBA_MemoryRead32(src);
-                src += 4;
+                bitstream = GBA_BiosInputRead32(&in);
                 bitsleft = 32;
             }
             int node = bitstream >> 31; // Get bit 31
             //Debug_DebugMsgArg("Node %d", node);
             bitstream <<= 1;
             bitsleft--;
-            u8 nodeinfo = GBA_MemoryRead8(nodeaddr);
+            if ((nodeaddr - treetable) < tree_left)
+                nodeinfo = tree[nodeaddr - treetable];
+            else
+                nodeinfo = GBA_MemoryRead8(nodeaddr);
             if (node && (nodeinfo & BIT(6)))
                 searching = 0;
             if ((node == 0) && (nodeinfo & BIT(7)))
@@ -657,153 +1078,82 @@ static void GBA_SWI_HuffUnComp(void)
             nodeaddr = (nodeaddr & ~1)
                        + ((int)(nodeinfo & 0x3F)) * 2 + 2 + node;
         }
-        //Debug_DebugMsgArg("Data: %02X", GBA_MemoryRead8(nodeaddr));
+        if ((nodeaddr - treetable) < tree_left)
+            nodeinfo = tree[nodeaddr - treetable];
+        else
+            nodeinfo = GBA_MemoryRead8(nodeaddr);
+        //Debug_DebugMsgArg("Data: %02X", nodeinfo);
         if (chunk_size == 8)
         {
-            *buffertmp++ = GBA_MemoryRead8(nodeaddr);
-            total++;
+            GBA_BiosOutputWrite8(&out, nodeinfo);
         }
         else //if (chunk_size == 4)
         {
             if (bit4index & 1)
-            {
-                *buffertmp |= GBA_MemoryRead8(nodeaddr) << 4;
-                buffertmp++;
-                total++;
-            }
+                GBA_BiosOutputWrite8(&out, data | (nodeinfo << 4));
             else
-            {
-                *buffertmp = GBA_MemoryRead8(nodeaddr);
-            }
+                data = nodeinfo;
             bit4index ^= 1;
         }
-        if (size <= total)
+        if (size <= out.total)
             break;
     }
-    // Copy in 32 bit blocks
-    u32 *dstbuf = buffer;
-    while (size > 0)
-    {
-        GBA_MemoryWrite32(dst, *dstbuf++);
-        dst += 4;
-        size -= 4;
-    }
-    free(buffer);
+
+    GBA_BiosOutputEnd(&out);
 }
 
-static void GBA_SWI_RLUnCompWram(void)
+static void GBA_SWI_RLUnComp(u32 unit)
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
+    _bios_input_t in;
+    GBA_BiosInputInit(&in, CPU.R[0]);
+
+    u32 header = GBA_BiosInputRead32(&in);
     //if (((header >> 4) & 7) != 3)
     //{
-    //    Debug_DebugMsgArg("SWI 14 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
+    //    Debug_DebugMsgArg("SWI %02X -- Compression type %d -- ABORTED",
+    //                      (unit == 1) ? 0x14 : 0x15, ((header >> 4) & 7));
     //    return;
     //}
-    int size = (header >> 8) & 0x00FFFFFF;
-    while (size > 0)
+    u32 size = (header >> 8) & 0x00FFFFFF;
+
+    _bios_output_t out;
+    GBA_BiosOutputInit(&out, CPU.R[1], size, unit);
+
+    while (size > out.total)
     {
-        u8 flg = GBA_MemoryRead8(src);
-        src++;
+        u8 flg = GBA_BiosInputRead8(&in);
         if (flg & BIT(7)) // Compressed - 1 byte repeated N times
         {
             int len = (flg & 0x7F) + 3;
-            u8 data = GBA_MemoryRead8(src);
-            src++;
-            while (len)
+            u8 data = GBA_BiosInputRead8(&in);
+            while (len && (size > out.total))
             {
-                GBA_MemoryWrite8(dst, data);
-                dst++;
-                size--;
+                GBA_BiosOutputWrite8(&out, data);
                 len--;
             }
         }
         else // N uncompressed bytes
         {
             int len = (flg & 0x7F) + 1;
-            while (len)
+            while (len && (size > out.total))
             {
-                GBA_MemoryWrite8(dst, GBA_MemoryRead8(src));
-                src++;
-                dst++;
-                size--;
+                GBA_BiosOutputWrite8(&out, GBA_BiosInputRead8(&in));
                 len--;
             }
         }
     }
+
+    GBA_BiosOutputEnd(&out);
 }
 
-static void GBA_SWI_RLUnCompVram(void)
+static void GBA_SWI_RLUnCompWram(void)
 {
-    int src = CPU.R[0];
-    int dst = CPU.R[1];
-    u32 header = GBA_MemoryRead32(src);
-    src += 4;
-    //if (((header >> 4) & 7) != 3)
-    //{
-    //    Debug_DebugMsgArg("SWI 15 -- Compression type %d -- ABORTED",
-    //                      ((header >> 4) & 7));
-    //    return;
-    //}
-    int size = (header >> 8) & 0x00FFFFFF;
-
-    u16 writedata = 0;
-    int curbyte = 0;
+    GBA_SWI_RLUnComp(1);
+}
 
-    while (size > 0)
-    {
-        u8 flg = GBA_MemoryRead8(src);
-        src++;
-        if (flg & BIT(7)) // Compressed - 1 byte repeated N times
-        {
-            int len = (flg & 0x7F) + 3;
-            u8 data = GBA_MemoryRead8(src);
-            src++;
-            while (len)
-            {
-                if (curbyte & 1)
-                {
-                    writedata |= ((u16)data) << 8;
-                    GBA_MemoryWrite16(dst, writedata);
-                    dst += 2;
-                    writedata = 0;
-                }
-                else
-                {
-                    writedata = (u16)data;
-                }
-                curbyte ^= 1;
-                size--;
-                len--;
-            }
-        }
-        else // N uncompressed bytes
-        {
-            int len = (flg & 0x7F) + 1;
-            while (len)
-            {
-                if (curbyte & 1)
-                {
-                    writedata |= ((u16)GBA_MemoryRead8(src)) << 8;
-                    src++;
-                    GBA_MemoryWrite16(dst, writedata);
-                    dst += 2;
-                    writedata = 0;
-                }
-                else
-                {
-                    writedata = (u16)GBA_MemoryRead8(src);
-                    src++;
-                }
-                curbyte ^= 1;
-                size--;
-                len--;
-            }
-        }
-    }
+static void GBA_SWI_RLUnCompVram(void)
+{
+    GBA_SWI_RLUnComp(2); // Written in 16 bit blocks
 }
 
 static void GBA_SWI_Diff8bitUnFilterWram(void)
@@ -921,181 +1271,136 @@ static void GBA_SWI_Diff16bitUnFilter(void)
 
 //------------------------------------------------------------------------------
 
-void GBA_Swi(u8 number)
+s32 GBA_Swi(u8 number)
 {
     switch (number)
     {
         case 0x00: // SoftReset
         {
             GBA_SWI_SoftReset();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x01: // RegisterRamReset
         {
             GBA_SWI_RegisterRamReset();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x02: // Halt
         {
             GBA_MemoryWrite8(HALTCNT, 0x00);
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x03: // Stop
         {
             GBA_MemoryWrite8(HALTCNT, 0x80);
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x04: // IntrWait
         {
             Debug_ErrorMsgArg("GBA_SWI(): SWI 0x04 mustn't get here.");
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x05: // VBlankIntrWait
         {
             Debug_ErrorMsgArg("GBA_SWI(): SWI 0x05 mustn't get here.");
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x06: // Div
         {
-            if (CPU.R[1] == 0)
-            {
-                Debug_DebugMsgArg("SWI 0x06: Division by 0");
-                return;
-            }
-            s32 num = (s32)CPU.R[0] / (s32)CPU.R[1];
-            s32 mod = (s32)CPU.R[0] % (s32)CPU.R[1];
-            CPU.R[0] = num;
-            CPU.R[1] = mod;
-            CPU.R[3] = abs(num);
-            return;
+            return GBA_SWI_Div(number, CPU.R[0], CPU.R[1]);
         }
         case 0x07: // DivArm
         {
-            if (CPU.R[0] == 0)
-            {
-                Debug_DebugMsgArg("SWI 0x07: Division by 0");
-                return;
-            }
-            s32 num = (s32)CPU.R[1] / (s32)CPU.R[0];
-            s32 mod = (s32)CPU.R[1] % (s32)CPU.R[0];
-            CPU.R[0] = num;
-            CPU.R[1] = mod;
-            CPU.R[3] = abs(num);
-            return;
+            return GBA_SWI_Div(number, CPU.R[1], CPU.R[0]);
         }
         case 0x08: // Sqrt
         {
-            CPU.R[0] = (u16)sqrt((u32)CPU.R[0]);
-            return;
+            return GBA_SWI_Sqrt();
         }
         case 0x09: // ArcTan
         {
-            // This is what the BIOS does... Not accurate at the bounds.
-            s32 r1 = -((((s32)CPU.R[0]) * ((s32)CPU.R[0])) >> 14);
-            s32 r3 = ((((s32)0xA9) * r1) >> 14) + 0x390;
-            r3 = ((r1 * r3) >> 14) + 0x91C;
-            r3 = ((r1 * r3) >> 14) + 0xFB6;
-            r3 = ((r1 * r3) >> 14) + 0x16AA;
-            r3 = ((r1 * r3) >> 14) + 0x2081;
-            r3 = ((r1 * r3) >> 14) + 0x3651;
-            r3 = ((r1 * r3) >> 14) + 0xA259;
-            CPU.R[0] = (((s32)CPU.R[0]) * r3) >> 16;
-
-            // Emulated: Accurate always
-            // r0: Tan, 16bit: 1bit sign, 1bit integral part, 14bit decimal part
-            // Return: "-PI/2 < THETA < PI/2" in a range of C000h-4000h.
-            // CPU.R[0] = (s32)(atan(((float)(s16)(u16)CPU.R[0])
-            //                       / (float)(1 << 14))
-            //                  * (((float)0x4000) / ((float)M_PI_2)));
-            return;
+            return GBA_SWI_ArcTan();
         }
         case 0x0A: // ArcTan2
         {
-            float x = ((float)(s16)CPU.R[0]) / (float)(1 << 14);
-            float y = ((float)(s16)CPU.R[1]) / (float)(1 << 14);
-            CPU.R[0] = (u32)(u16)(s16)(s32)
-                (atan2(y, x) * (((float)0xFFFF) / ((float)2.0 * (float)M_PI)));
-            // Return: 0000h-FFFFh for 0 <= THETA < 2PI.
-            return;
+            return GBA_SWI_ArcTan2();
         }
         case 0x0B: // CpuSet
         {
             GBA_SWI_CpuSet();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x0C: // CpuFastSet
         {
             GBA_SWI_CpuFastSet();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x0D: // GetBiosChecksum
         {
             CPU.R[0] = 0xBAAE187F; // 0xBAAE1880 DS in GBA mode
             // The only difference is that the byte at [3F0Ch] is changed from
             // 00h to 01h
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x0E: // BgAffineSet
         {
-            GBA_SWI_BgAffineSet();
-            return;
+            return GBA_SWI_BgAffineSet();
         }
         case 0x0F: // ObjAffineSet
         {
-            GBA_SWI_ObjAffineSet();
-            return;
+            return GBA_SWI_ObjAffineSet();
         }
         case 0x10: // BitUnPack
         {
             GBA_SWI_BitUnPack();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x11: // LZ77UnCompWram -- 8 bit
         {
             GBA_SWI_LZ77UnCompWram();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x12: // LZ77UnCompVram -- 16 bit
         {
             GBA_SWI_LZ77UnCompVram();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x13: // HuffUnComp
         {
             GBA_SWI_HuffUnComp();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x14: // RLUnCompWram -- 8 bit
         {
             GBA_SWI_RLUnCompWram();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x15: // RLUnCompVram -- 16 bit
         {
             GBA_SWI_RLUnCompVram();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x16: // Diff8bitUnFilterWram
         {
             GBA_SWI_Diff8bitUnFilterWram();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x17: // Diff8bitUnFilterVram
         {
             GBA_SWI_Diff8bitUnFilterVram();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x18: // Diff16bitUnFilter
         {
             GBA_SWI_Diff16bitUnFilter();
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x19: // SoundBias
         {
             int level = CPU.R[0] ? 0x200 : 0;
             // Ignore delay
             GBA_MemoryWrite16(SOUNDBIAS, (REG_SOUNDBIAS & 0xFC00) | level);
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x1A: // SoundDriverInit
         case 0x1B: // SoundDriverMode
@@ -1118,12 +1423,12 @@ void GBA_Swi(u8 number)
             CPU.R[R_LR] = 0x00000000;
             CPU.R[R_PC] = 0x00000000; // Enough...
             GBA_RegisterWrite16(TM0CNT_L, 0xFF6F);
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x27: // CustomHalt
         {
             GBA_MemoryWrite8(HALTCNT, CPU.R[2] & 0xFF);
-            return;
+            return BIOS_SWI_CLOCKS;
         }
         case 0x28: // SoundDriverVSyncOff
         case 0x29: // SoundDriverVSyncOn
@@ -1139,5 +1444,7 @@ void GBA_Swi(u8 number)
             "Please, get a GBA BIOS file, name it \"" GBA_BIOS_FILENAME
             "\" and place it in the \"bios\" folder.",
             number);
-    GBA_ExecutionBreak();
+    GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
+
+    return BIOS_SWI_CLOCKS;
 }
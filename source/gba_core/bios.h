@@ -14,6 +14,13 @@ int GBA_BiosIsLoaded(void);
 
 void GBA_BiosEmulatedLoad(void);
 
-void GBA_Swi(u8 number);
+// Called at the start of an ARM slice with the PC at the IRQ vector. It returns
+// the clocks left after running the IRQ entry code of the emulated BIOS, or the
+// same clocks if it can't skip it.
+s32 GBA_BiosIRQVectorHLE(s32 clocks);
+
+// Emulates a SWI when the BIOS isn't loaded from a file. It returns the clocks
+// that it takes.
+s32 GBA_Swi(u8 number);
 
 #endif // GBA_BIOS__
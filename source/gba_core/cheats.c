@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include "../build_options.h"
+#include "../debug_utils.h"
+#include "../file_utils.h"
+#include "../general_utils.h"
+
+#include "cheats.h"
+#include "code_cache.h"
+#include "gba.h"
+#include "memory.h"
+
+#define GBA_CHEATS_RAM_MAX  (256)
+#define GBA_CHEATS_ROM_MAX  (64)
+
+typedef enum
+{
+    GBA_CHEAT_WRITE8,
+    GBA_CHEAT_WRITE16,
+    GBA_CHEAT_WRITE32,
+    GBA_CHEAT_OR16,
+    GBA_CHEAT_AND16,
+    GBA_CHEAT_ADD16,
+    // The next code is skipped if the condition isn't true
+    GBA_CHEAT_IF_EQUAL16,
+    GBA_CHEAT_IF_NOT_EQUAL16,
+    GBA_CHEAT_IF_GREATER16,
+    GBA_CHEAT_IF_LESS16,
+    GBA_CHEAT_IF_AND16,
+} _gba_cheat_op_e;
+
+typedef struct
+{
+    u32 op;
+    u32 address;
+    u32 value;
+} _gba_cheat_ram_t;
+
+static core_local__ _gba_cheat_ram_t gba_cheats_ram[GBA_CHEATS_RAM_MAX];
+static core_local__ int gba_cheats_ram_count;
+
+// Restored in reverse order so that codes that patch the same halfword are
+// undone correctly.
+typedef struct
+{
+    u32 offset;
+    u16 original;
+} _gba_cheat_rom_t;
+
+static core_local__ _gba_cheat_rom_t gba_cheats_rom[GBA_CHEATS_ROM_MAX];
+static core_local__ int gba_cheats_rom_count;
+
+void GBA_CheatsReset(void)
+{
+    for (int i = gba_cheats_rom_count - 1; i >= 0; i--)
+    {
+        u16 *ptr = (u16 *)&Mem.rom_wait0[gba_cheats_rom[i].offset];
+        *ptr = gba_cheats_rom[i].original;
+    }
+
+    // The decoded instructions of the patched code have to be discarded
+    if (gba_cheats_rom_count > 0)
+        GBA_CodeCacheFlush();
+
+    gba_cheats_rom_count = 0;
+    gba_cheats_ram_count = 0;
+}
+
+static int gba_cheat_add_ram(u32 op, u32 address, u32 value)
+{
+    if (gba_cheats_ram_count == GBA_CHEATS_RAM_MAX)
+        return 1;
+
+    _gba_cheat_ram_t *cheat = &gba_cheats_ram[gba_cheats_ram_count++];
+    cheat->op = op;
+    cheat->address = address;
+    cheat->value = value;
+
+    return 0;
+}
+
+static int gba_cheat_add_rom(u32 address, u16 value)
+{
+    if (gba_cheats_rom_count == GBA_CHEATS_ROM_MAX)
+        return 1;
+
+    u32 offset = address & 0x01FFFFFE;
+    u16 *ptr = (u16 *)&Mem.rom_wait0[offset];
+
+    if (LargeMakeWritable(ptr, sizeof(u16)) != 0)
+        return 1;
+
+    gba_cheats_rom[gba_cheats_rom_count].offset = offset;
+    gba_cheats_rom[gba_cheats_rom_count].original = *ptr;
+    gba_cheats_rom_count++;
+
+    *ptr = value;
+
+    GBA_CodeCacheFlush();
+
+    return 0;
+}
+
+static int gba_cheat_add_codebreaker(const char *digits)
+{
+    u32 type = cheat_code_hex(&digits[0], 1);
+    u32 address = cheat_code_hex(&digits[1], 7);
+    u32 value = cheat_code_hex(&digits[8], 4);
+
+    switch (type)
+    {
+        case 0x0: // Master codes
+        case 0x1:
+            return 0;
+        case 0x2:
+            return gba_cheat_add_ram(GBA_CHEAT_OR16, address, value);
+        case 0x3:
+            return gba_cheat_add_ram(GBA_CHEAT_WRITE8, address, value & 0xFF);
+        case 0x6:
+            return gba_cheat_add_ram(GBA_CHEAT_AND16, address, value);
+        case 0x7:
+            return gba_cheat_add_ram(GBA_CHEAT_IF_EQUAL16, address, value);
+        case 0x8:
+            return gba_cheat_add_ram(GBA_CHEAT_WRITE16, address, value);
+        case 0xA:
+            return gba_cheat_add_ram(GBA_CHEAT_IF_NOT_EQUAL16, address, value);
+        case 0xB:
+            return gba_cheat_add_ram(GBA_CHEAT_IF_GREATER16, address, value);
+        case 0xC:
+            return gba_cheat_add_ram(GBA_CHEAT_IF_LESS16, address, value);
+        case 0xE:
+            return gba_cheat_add_ram(GBA_CHEAT_ADD16, address, value);
+        case 0xF:
+            return gba_cheat_add_ram(GBA_CHEAT_IF_AND16, address, value);
+        default: // Slides, encryption seeds, etc
+            return 1;
+    }
+}
+
+static int gba_cheat_add_gameshark(const char *digits)
+{
+    u32 type = cheat_code_hex(&digits[0], 1);
+    u32 address = cheat_code_hex(&digits[1], 7);
+    u32 value = cheat_code_hex(&digits[8], 8);
+
+    switch (type)
+    {
+        case 0x0:
+            return gba_cheat_add_ram(GBA_CHEAT_WRITE8, address, value & 0xFF);
+        case 0x1:
+            return gba_cheat_add_ram(GBA_CHEAT_WRITE16, address,
+                                     value & 0xFFFF);
+        case 0x2:
+            return gba_cheat_add_ram(GBA_CHEAT_WRITE32, address, value);
+        case 0x6:
+            return gba_cheat_add_rom(0x08000000 + (address << 1),
+                                     value & 0xFFFF);
+        case 0xD:
+            return gba_cheat_add_ram(GBA_CHEAT_IF_EQUAL16, address,
+                                     value & 0xFFFF);
+        default:
+            return 1;
+    }
+}
+
+int GBA_CheatAdd(const char *code)
+{
+    char digits[20];
+    int count = cheat_code_digits(code, digits, sizeof(digits));
+
+    int ret = 1;
+    if (count == 12)
+        ret = gba_cheat_add_codebreaker(digits);
+    else if (count == 16)
+        ret = gba_cheat_add_gameshark(digits);
+
+    if (ret)
+        Debug_LogMsgArg("%s: Invalid code: %s", __func__, code);
+
+    return ret;
+}
+
+void GBA_CheatsApply(void)
+{
+    for (int i = 0; i < gba_cheats_ram_count; i++)
+    {
+        _gba_cheat_ram_t *cheat = &gba_cheats_ram[i];
+        u32 address = cheat->address;
+        u32 value = cheat->value;
+        int condition = 1;
+
+        switch (cheat->op)
+        {
+            case GBA_CHEAT_WRITE8:
+                GBA_MemoryWrite8(address, value);
+                break;
+            case GBA_CHEAT_WRITE16:
+                GBA_MemoryWrite16(address, value);
+                break;
+            case GBA_CHEAT_WRITE32:
+                GBA_MemoryWrite32(address, value);
+                break;
+            case GBA_CHEAT_OR16:
+                GBA_MemoryWrite16(address, GBA_MemoryRead16(address) | value);
+                break;
+            case GBA_CHEAT_AND16:
+                GBA_MemoryWrite16(address, GBA_MemoryRead16(address) & value);
+                break;
+            case GBA_CHEAT_ADD16:
+                GBA_MemoryWrite16(address, GBA_MemoryRead16(address) + value);
+                break;
+            case GBA_CHEAT_IF_EQUAL16:
+                condition = GBA_MemoryRead16(address) == value;
+                break;
+            case GBA_CHEAT_IF_NOT_EQUAL16:
+                condition = GBA_MemoryRead16(address) != value;
+                break;
+            case GBA_CHEAT_IF_GREATER16:
+                condition = GBA_MemoryRead16(address) > value;
+                break;
+            case GBA_CHEAT_IF_LESS16:
+                condition = GBA_MemoryRead16(address) < value;
+                break;
+            case GBA_CHEAT_IF_AND16:
+                condition = (GBA_MemoryRead16(address) & value) != 0;
+                break;
+        }
+
+        if (condition == 0)
+            i++;
+    }
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GBA_CHEATS__
+#define GBA_CHEATS__
+
+// Cheat codes. Only codes that aren't encrypted are supported, the separators
+// are ignored. The type of the code is detected from its length:
+//
+// - CodeBreaker "XAAAAAAA YYYY": 3 (8 bit write), 8 (16 bit write), 2 (OR),
+//   6 (AND) and E (add). The conditions 7 (equal), A (not equal), B (greater
+//   than), C (less than) and F (AND isn't zero) skip the next code when they
+//   aren't true. The master codes (0 and 1) are accepted and ignored.
+// - GameShark / Action Replay v1 and v2 "XAAAAAAA YYYYYYYY": 0, 1 and 2 (8, 16
+//   and 32 bit writes), D (skip the next code if the value isn't equal) and 6
+//   (ROM patch at 08000000 + AAAAAAA * 2).
+//
+// RAM codes are run in order at the start of every frame, so the conditions
+// are evaluated at frame boundaries. ROM patches are written to the ROM buffer
+// when they are added and the original values are restored when the codes are
+// removed. The pages of the buffer that aren't patched are still shared with
+// the file (see LargeMakeWritable()), and the memory is read the same way as
+// without cheats.
+//
+// The codes are kept until GBA_CheatsReset() is called or the ROM is unloaded.
+
+void GBA_CheatsReset(void);
+// Returns 0 on success, 1 if the code isn't valid
+int GBA_CheatAdd(const char *code);
+
+// Called at the start of every frame
+void GBA_CheatsApply(void);
+
+#endif // GBA_CHEATS__
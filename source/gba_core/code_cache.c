@@ -0,0 +1,437 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../build_options.h"
+#include "../debug_utils.h"
+
+#include "code_cache.h"
+#include "gba.h"
+#include "memory.h"
+
+// Straight-line code is decoded once and stored here, so that the interpreters
+// don't need to fetch and classify the same opcodes every time a loop is
+// executed. ROM and BIOS blocks are never invalidated, IWRAM and EWRAM blocks
+// are invalidated by the memory write handlers. ARM and THUMB decoded blocks
+// are kept separately, as the same memory can be executed in both states.
+//
+// Most code is only run a few times (initialization code, code copied to RAM
+// once, etc), and decoding a whole block for it costs more than fetching its
+// instructions from memory. Blocks start cold: the interpreters fetch the code
+// from memory and every instruction they run from the block is counted. The
+// block is decoded when the count reaches GBA_CODE_CACHE_HOT_COUNT.
+// Invalidating a block makes it cold again, so data written next to code
+// doesn't force the code to be decoded again all the time.
+//
+// Nothing is saved to disk between sessions. Decoding a block is a copy of its
+// opcodes and a table lookup for each ARM one, which is cheaper than reading
+// the decoded block back from a file would be.
+
+//------------------------------------------------------------------------------
+
+typedef enum
+{
+    CACHE_REGION_BIOS,
+    CACHE_REGION_EWRAM,
+    CACHE_REGION_IWRAM,
+    CACHE_REGION_ROM,
+
+    CACHE_REGION_NUMBER
+} _code_cache_region_e;
+
+#define BIOS_SIZE  (16 * 1024)
+#define EWRAM_SIZE (256 * 1024)
+#define IWRAM_SIZE (32 * 1024)
+
+#define BIOS_BLOCKS     (BIOS_SIZE / GBA_CODE_CACHE_BLOCK_SIZE)
+#define EWRAM_BLOCKS    (EWRAM_SIZE / GBA_CODE_CACHE_BLOCK_SIZE)
+#define IWRAM_BLOCKS    (IWRAM_SIZE / GBA_CODE_CACHE_BLOCK_SIZE)
+
+static core_local__ _arm_decoded_t arm_cache_bios[BIOS_SIZE / 4];
+static core_local__ u8 arm_cache_bios_valid[BIOS_BLOCKS];
+static core_local__ _arm_decoded_t arm_cache_ewram[EWRAM_SIZE / 4];
+core_local__ u8 gba_code_cache_arm_ewram_valid[EWRAM_BLOCKS];
+static core_local__ _arm_decoded_t arm_cache_iwram[IWRAM_SIZE / 4];
+core_local__ u8 gba_code_cache_arm_iwram_valid[IWRAM_BLOCKS];
+
+static core_local__ _thumb_decoded_t thumb_cache_bios[BIOS_SIZE / 2];
+static core_local__ u8 thumb_cache_bios_valid[BIOS_BLOCKS];
+static core_local__ _thumb_decoded_t thumb_cache_ewram[EWRAM_SIZE / 2];
+core_local__ u8 gba_code_cache_thumb_ewram_valid[EWRAM_BLOCKS];
+static core_local__ _thumb_decoded_t thumb_cache_iwram[IWRAM_SIZE / 2];
+core_local__ u8 gba_code_cache_thumb_iwram_valid[IWRAM_BLOCKS];
+
+core_local__ u8 gba_code_cache_ewram_used[EWRAM_BLOCKS];
+core_local__ u8 gba_code_cache_iwram_used[IWRAM_BLOCKS];
+
+// Instructions run from each block since it was last decoded
+static core_local__ u8 arm_cache_bios_heat[BIOS_BLOCKS];
+static core_local__ u8 arm_cache_ewram_heat[EWRAM_BLOCKS];
+static core_local__ u8 arm_cache_iwram_heat[IWRAM_BLOCKS];
+static core_local__ u8 thumb_cache_bios_heat[BIOS_BLOCKS];
+static core_local__ u8 thumb_cache_ewram_heat[EWRAM_BLOCKS];
+static core_local__ u8 thumb_cache_iwram_heat[IWRAM_BLOCKS];
+
+// The ROM ones are allocated to fit the size of the ROM
+static core_local__ u32 code_cache_rom_size = 0;
+
+// Set by GBA_CodeCacheInit(). The arrays above can be thread-local (see
+// core_local__), so their addresses can't be used to initialize them.
+static core_local__ _arm_decoded_t *arm_cache_entries[CACHE_REGION_NUMBER];
+static core_local__ u8 *arm_cache_valid[CACHE_REGION_NUMBER];
+static core_local__ u8 *arm_cache_heat[CACHE_REGION_NUMBER];
+static core_local__ _thumb_decoded_t *thumb_cache_entries[CACHE_REGION_NUMBER];
+static core_local__ u8 *thumb_cache_valid[CACHE_REGION_NUMBER];
+static core_local__ u8 *thumb_cache_heat[CACHE_REGION_NUMBER];
+// Only the regions that can be written have them
+static core_local__ u8 *cache_used[CACHE_REGION_NUMBER];
+
+// Returned for code that isn't hot yet, so that the caller asks again
+static core_local__ u8 code_cache_never_valid = 0;
+// Returned for code that can't be cached. The caller can fetch the rest of the
+// block from memory without asking again.
+static core_local__ u8 code_cache_uncacheable = 1;
+
+//------------------------------------------------------------------------------
+
+// Indexed by bits 27-20 and 7-4 of the opcode
+core_local__ u8 gba_arm_decode_table[4096];
+
+static u32 arm_decode_group_slow(u32 opcode)
+{
+    switch ((opcode >> 25) & 7)
+    {
+        case 0:
+            if (opcode & BIT(4))
+            {
+                if (opcode & BIT(7))
+                    return ARM_GROUP_MUL_SWP_HALF;
+
+                return ARM_GROUP_DP_REG_SHIFT;
+            }
+            return ARM_GROUP_DP_IMM_SHIFT;
+        case 1:
+            return ARM_GROUP_DP_IMM;
+        case 2:
+            return ARM_GROUP_LDR_STR_IMM;
+        case 3:
+            return ARM_GROUP_LDR_STR_REG;
+        case 4:
+            return ARM_GROUP_LDM_STM;
+        case 5:
+            return ARM_GROUP_B_BL;
+        case 6:
+            return ARM_GROUP_COP_TRANSFER;
+        case 7:
+        default:
+            return ARM_GROUP_COP_SWI;
+    }
+}
+
+static void arm_decode_table_init(void)
+{
+    for (u32 i = 0; i < 4096; i++)
+    {
+        u32 opcode = ((i & 0xFF0) << 16) | ((i & 0xF) << 4);
+        gba_arm_decode_table[i] = arm_decode_group_slow(opcode);
+    }
+}
+
+static void arm_cache_decode_block(_arm_decoded_t *entry, const u32 *src)
+{
+    for (int i = 0; i < GBA_CODE_CACHE_ARM_ENTRIES; i++)
+    {
+        u32 opcode = src[i];
+
+        entry[i].opcode = opcode & 0x01FFFFFF;
+        entry[i].cond = opcode >> 28;
+        entry[i].group = GBA_ARMDecodeGroup(opcode);
+    }
+}
+
+static void thumb_cache_decode_block(_thumb_decoded_t *entry, const u16 *src)
+{
+    for (int i = 0; i < GBA_CODE_CACHE_THUMB_ENTRIES; i++)
+    {
+        entry[i].opcode = src[i];
+        entry[i].bl_pair = 0;
+    }
+
+    // BL is always a pair of opcodes, unless the second half is in the next
+    // block. A write to either half invalidates the whole block, so the pair
+    // can't be broken while it's cached.
+    for (int i = 0; i < GBA_CODE_CACHE_THUMB_ENTRIES - 1; i++)
+    {
+        if (((src[i] & 0xF800) == 0xF000) && ((src[i + 1] & 0xF800) == 0xF800))
+            entry[i].bl_pair = 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_CodeCacheFlush(void)
+{
+    for (int i = 0; i < CACHE_REGION_NUMBER; i++)
+    {
+        size_t size;
+
+        switch (i)
+        {
+            case CACHE_REGION_BIOS:
+                size = BIOS_SIZE;
+                break;
+            case CACHE_REGION_EWRAM:
+                size = EWRAM_SIZE;
+                break;
+            case CACHE_REGION_IWRAM:
+                size = IWRAM_SIZE;
+                break;
+            case CACHE_REGION_ROM:
+            default:
+                size = code_cache_rom_size;
+                break;
+        }
+
+        if (arm_cache_valid[i])
+            memset(arm_cache_valid[i], 0, size / GBA_CODE_CACHE_BLOCK_SIZE);
+        if (thumb_cache_valid[i])
+            memset(thumb_cache_valid[i], 0, size / GBA_CODE_CACHE_BLOCK_SIZE);
+        if (arm_cache_heat[i])
+            memset(arm_cache_heat[i], 0, size / GBA_CODE_CACHE_BLOCK_SIZE);
+        if (thumb_cache_heat[i])
+            memset(thumb_cache_heat[i], 0, size / GBA_CODE_CACHE_BLOCK_SIZE);
+        if (cache_used[i])
+            memset(cache_used[i], 0, size / GBA_CODE_CACHE_BLOCK_SIZE);
+    }
+}
+
+void GBA_CodeCacheInit(void)
+{
+    GBA_CodeCacheEnd();
+
+    arm_decode_table_init();
+
+    arm_cache_entries[CACHE_REGION_BIOS] = arm_cache_bios;
+    arm_cache_entries[CACHE_REGION_EWRAM] = arm_cache_ewram;
+    arm_cache_entries[CACHE_REGION_IWRAM] = arm_cache_iwram;
+    arm_cache_valid[CACHE_REGION_BIOS] = arm_cache_bios_valid;
+    arm_cache_valid[CACHE_REGION_EWRAM] = gba_code_cache_arm_ewram_valid;
+    arm_cache_valid[CACHE_REGION_IWRAM] = gba_code_cache_arm_iwram_valid;
+    arm_cache_heat[CACHE_REGION_BIOS] = arm_cache_bios_heat;
+    arm_cache_heat[CACHE_REGION_EWRAM] = arm_cache_ewram_heat;
+    arm_cache_heat[CACHE_REGION_IWRAM] = arm_cache_iwram_heat;
+
+    thumb_cache_entries[CACHE_REGION_BIOS] = thumb_cache_bios;
+    thumb_cache_entries[CACHE_REGION_EWRAM] = thumb_cache_ewram;
+    thumb_cache_entries[CACHE_REGION_IWRAM] = thumb_cache_iwram;
+    thumb_cache_valid[CACHE_REGION_BIOS] = thumb_cache_bios_valid;
+    thumb_cache_valid[CACHE_REGION_EWRAM] = gba_code_cache_thumb_ewram_valid;
+    thumb_cache_valid[CACHE_REGION_IWRAM] = gba_code_cache_thumb_iwram_valid;
+    thumb_cache_heat[CACHE_REGION_BIOS] = thumb_cache_bios_heat;
+    thumb_cache_heat[CACHE_REGION_EWRAM] = thumb_cache_ewram_heat;
+    thumb_cache_heat[CACHE_REGION_IWRAM] = thumb_cache_iwram_heat;
+
+    cache_used[CACHE_REGION_EWRAM] = gba_code_cache_ewram_used;
+    cache_used[CACHE_REGION_IWRAM] = gba_code_cache_iwram_used;
+
+    u32 size = GBA_GetRomSize();
+    size = (size + GBA_CODE_CACHE_BLOCK_SIZE - 1)
+           & ~(GBA_CODE_CACHE_BLOCK_SIZE - 1);
+
+    if (size > 0)
+    {
+        // Most of this is never touched, so let calloc() give us zeroed pages
+        // lazily instead of clearing it here.
+        u32 blocks = size / GBA_CODE_CACHE_BLOCK_SIZE;
+
+        arm_cache_entries[CACHE_REGION_ROM] =
+                calloc(size / 4, sizeof(_arm_decoded_t));
+        arm_cache_valid[CACHE_REGION_ROM] = calloc(blocks, 1);
+        arm_cache_heat[CACHE_REGION_ROM] = calloc(blocks, 1);
+        thumb_cache_entries[CACHE_REGION_ROM] =
+                calloc(size / 2, sizeof(_thumb_decoded_t));
+        thumb_cache_valid[CACHE_REGION_ROM] = calloc(blocks, 1);
+        thumb_cache_heat[CACHE_REGION_ROM] = calloc(blocks, 1);
+
+        if ((arm_cache_entries[CACHE_REGION_ROM] == NULL)
+            || (arm_cache_valid[CACHE_REGION_ROM] == NULL)
+            || (arm_cache_heat[CACHE_REGION_ROM] == NULL)
+            || (thumb_cache_entries[CACHE_REGION_ROM] == NULL)
+            || (thumb_cache_valid[CACHE_REGION_ROM] == NULL)
+            || (thumb_cache_heat[CACHE_REGION_ROM] == NULL))
+        {
+            Debug_ErrorMsgArg("Not enough memory for the code cache.");
+            GBA_CodeCacheEnd();
+            size = 0;
+        }
+    }
+
+    code_cache_rom_size = size;
+
+    GBA_CodeCacheFlush();
+}
+
+void GBA_CodeCacheEnd(void)
+{
+    free(arm_cache_entries[CACHE_REGION_ROM]);
+    free(arm_cache_valid[CACHE_REGION_ROM]);
+    free(arm_cache_heat[CACHE_REGION_ROM]);
+    free(thumb_cache_entries[CACHE_REGION_ROM]);
+    free(thumb_cache_valid[CACHE_REGION_ROM]);
+    free(thumb_cache_heat[CACHE_REGION_ROM]);
+
+    arm_cache_entries[CACHE_REGION_ROM] = NULL;
+    arm_cache_valid[CACHE_REGION_ROM] = NULL;
+    arm_cache_heat[CACHE_REGION_ROM] = NULL;
+    thumb_cache_entries[CACHE_REGION_ROM] = NULL;
+    thumb_cache_valid[CACHE_REGION_ROM] = NULL;
+    thumb_cache_heat[CACHE_REGION_ROM] = NULL;
+
+    code_cache_rom_size = 0;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the region of the cache that holds an address and the offset of the
+// start of the block inside it, or -1 if it can't be cached.
+static int code_cache_locate(u32 address, u32 *offset, const u8 **src)
+{
+    int region;
+
+    switch (address >> 24)
+    {
+        case 0:
+            region = CACHE_REGION_BIOS;
+            *offset = address & (BIOS_SIZE - 1);
+            *src = Mem.rom_bios;
+            break;
+        case 2:
+            region = CACHE_REGION_EWRAM;
+            *offset = address & (EWRAM_SIZE - 1);
+            *src = Mem.ewram;
+            break;
+        case 3:
+            region = CACHE_REGION_IWRAM;
+            *offset = address & (IWRAM_SIZE - 1);
+            *src = Mem.iwram;
+            break;
+        case 8:
+        case 9:
+        case 0xA:
+        case 0xB:
+        case 0xC:
+        case 0xD:
+            region = CACHE_REGION_ROM;
+            *offset = address & 0x01FFFFFF;
+            *src = Mem.rom_wait0;
+            if (*offset >= code_cache_rom_size)
+                return -1;
+            break;
+        default:
+            return -1;
+    }
+
+    *offset &= ~(GBA_CODE_CACHE_BLOCK_SIZE - 1);
+
+    return region;
+}
+
+_arm_decoded_t *GBA_CodeCacheGetARMBlock(u32 address, u8 **valid)
+{
+    u32 offset;
+    const u8 *src;
+
+    int region = code_cache_locate(address, &offset, &src);
+    if (region < 0)
+    {
+        *valid = &code_cache_uncacheable;
+        return NULL;
+    }
+
+    u32 index = offset >> GBA_CODE_CACHE_BLOCK_SHIFT;
+    u8 *flag = &arm_cache_valid[region][index];
+    _arm_decoded_t *block = &arm_cache_entries[region][offset >> 2];
+
+    if (*flag == 0)
+    {
+        u8 *heat = &arm_cache_heat[region][index];
+        if (*heat < GBA_CODE_CACHE_HOT_COUNT)
+        {
+            (*heat)++;
+            *valid = &code_cache_never_valid;
+            return NULL;
+        }
+        *heat = 0;
+
+        arm_cache_decode_block(block, (const u32 *)&src[offset]);
+        *flag = 1;
+
+        if (cache_used[region])
+            cache_used[region][index] = 1;
+    }
+
+    *valid = flag;
+
+    return block;
+}
+
+_thumb_decoded_t *GBA_CodeCacheGetTHUMBBlock(u32 address, u8 **valid)
+{
+    u32 offset;
+    const u8 *src;
+
+    int region = code_cache_locate(address, &offset, &src);
+    if (region < 0)
+    {
+        *valid = &code_cache_uncacheable;
+        return NULL;
+    }
+
+    u32 index = offset >> GBA_CODE_CACHE_BLOCK_SHIFT;
+    u8 *flag = &thumb_cache_valid[region][index];
+    _thumb_decoded_t *block = &thumb_cache_entries[region][offset >> 1];
+
+    if (*flag == 0)
+    {
+        u8 *heat = &thumb_cache_heat[region][index];
+        if (*heat < GBA_CODE_CACHE_HOT_COUNT)
+        {
+            (*heat)++;
+            *valid = &code_cache_never_valid;
+            return NULL;
+        }
+        *heat = 0;
+
+        thumb_cache_decode_block(block, (const u16 *)&src[offset]);
+        *flag = 1;
+
+        if (cache_used[region])
+            cache_used[region][index] = 1;
+    }
+
+    *valid = flag;
+
+    return block;
+}
+
+_code_cache_tier_e GBA_CodeCacheGetTier(u32 address, int thumb)
+{
+    u32 offset;
+    const u8 *src;
+
+    int region = code_cache_locate(address, &offset, &src);
+    if (region < 0)
+        return GBA_CODE_CACHE_TIER_NONE;
+
+    u8 *valid = thumb ? thumb_cache_valid[region] : arm_cache_valid[region];
+
+    if (valid[offset >> GBA_CODE_CACHE_BLOCK_SHIFT])
+        return GBA_CODE_CACHE_TIER_DECODED;
+
+    return GBA_CODE_CACHE_TIER_COLD;
+}
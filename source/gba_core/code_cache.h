@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GBA_CODE_CACHE__
+#define GBA_CODE_CACHE__
+
+#include "gba.h"
+
+// Code is decoded in blocks of this size. Any write to a block of IWRAM or
+// EWRAM that contains decoded code invalidates the whole block, so it shouldn't
+// be too big or data placed next to code will force it to be decoded again all
+// the time.
+#define GBA_CODE_CACHE_BLOCK_SHIFT      (8)
+#define GBA_CODE_CACHE_BLOCK_SIZE       (1 << GBA_CODE_CACHE_BLOCK_SHIFT)
+#define GBA_CODE_CACHE_ARM_ENTRIES      (GBA_CODE_CACHE_BLOCK_SIZE / 4)
+#define GBA_CODE_CACHE_THUMB_ENTRIES    (GBA_CODE_CACHE_BLOCK_SIZE / 2)
+
+// Number of instructions that have to be run from a block before it's decoded
+#define GBA_CODE_CACHE_HOT_COUNT        (32)
+
+// Groups of instructions handled by each one of the top level cases of the
+// ARM interpreter.
+typedef enum
+{
+    ARM_GROUP_DP_IMM_SHIFT, // Data Processing (shift by immediate), MRS, MSR
+    ARM_GROUP_DP_REG_SHIFT, // Data Processing (shift by register), BX
+    ARM_GROUP_MUL_SWP_HALF, // Multiply, SWP, LDRH/STRH/LDRSB/LDRSH
+    ARM_GROUP_DP_IMM,       // Data Processing (immediate), MSR immediate
+    ARM_GROUP_LDR_STR_IMM,  // LDR/STR with immediate offset
+    ARM_GROUP_LDR_STR_REG,  // LDR/STR with register offset
+    ARM_GROUP_LDM_STM,      // LDM/STM
+    ARM_GROUP_B_BL,         // B, BL
+    ARM_GROUP_COP_TRANSFER, // LDC/STC
+    ARM_GROUP_COP_SWI,      // CDP, MRC, MCR, SWI
+} _arm_group_e;
+
+typedef struct
+{
+    u32 opcode; // Bits 0-24 of the instruction
+    u8 cond;    // Bits 28-31 of the instruction
+    u8 group;   // One of _arm_group_e
+} _arm_decoded_t;
+
+typedef struct
+{
+    u16 opcode;
+    // 1 if this is the first half of a BL and the second half is the next
+    // entry of the block, so that both of them can be run as one instruction.
+    u16 bl_pair;
+} _thumb_decoded_t;
+
+//------------------------------------------------------------------------------
+
+void GBA_CodeCacheInit(void); // Call after GBA_MemoryInit()
+void GBA_CodeCacheEnd(void);
+
+// Invalidate everything. Needed after writing to RAM without using the
+// GBA_MemoryWriteXX() functions.
+void GBA_CodeCacheFlush(void);
+
+// They return the block of decoded instructions that contains the specified
+// address, decoding it if needed. They return NULL if the code at that address
+// can't be cached (I/O, VRAM, etc) or if the block isn't hot yet. In that
+// case, the instruction has to be fetched and decoded by the caller, and the
+// caller has to ask again for the next instruction. 'valid' points to a flag
+// that is cleared when the block has to be asked for again. It is never cleared
+// for blocks that can't be cached.
+_arm_decoded_t *GBA_CodeCacheGetARMBlock(u32 address, u8 **valid);
+_thumb_decoded_t *GBA_CodeCacheGetTHUMBBlock(u32 address, u8 **valid);
+
+typedef enum
+{
+    GBA_CODE_CACHE_TIER_NONE,    // The code at this address can't be cached
+    GBA_CODE_CACHE_TIER_COLD,    // Fetched from memory by the interpreter
+    GBA_CODE_CACHE_TIER_DECODED, // Run from the decoded block
+} _code_cache_tier_e;
+
+// Used by the debugger to show how the block of an address is being run
+_code_cache_tier_e GBA_CodeCacheGetTier(u32 address, int thumb);
+
+//------------------------------------------------------------------------------
+
+extern core_local__ u8 gba_arm_decode_table[4096];
+
+// Returns the _arm_group_e of an opcode. Only bits 27-20 and 7-4 are needed.
+static inline u32 GBA_ARMDecodeGroup(u32 opcode)
+{
+    return gba_arm_decode_table[((opcode >> 16) & 0xFF0)
+                                | ((opcode >> 4) & 0xF)];
+}
+
+//------------------------------------------------------------------------------
+
+extern core_local__ u8 gba_code_cache_arm_ewram_valid[];
+extern core_local__ u8 gba_code_cache_arm_iwram_valid[];
+extern core_local__ u8 gba_code_cache_thumb_ewram_valid[];
+extern core_local__ u8 gba_code_cache_thumb_iwram_valid[];
+
+// Set when a block is decoded in any state, cleared when it's invalidated. Most
+// writes to RAM are to blocks that don't contain code, they only need to read
+// this flag.
+extern core_local__ u8 gba_code_cache_ewram_used[];
+extern core_local__ u8 gba_code_cache_iwram_used[];
+
+// Called by the memory write handlers.
+
+static inline void GBA_CodeCacheInvalidateBlock(u8 *used, u8 *arm_valid,
+                                                u8 *thumb_valid, u32 index)
+{
+    if (used[index] == 0)
+        return;
+
+    used[index] = 0;
+    arm_valid[index] = 0;
+    thumb_valid[index] = 0;
+}
+
+static inline void GBA_CodeCacheInvalidateEWRAM(u32 address)
+{
+    u32 index = (address & 0x3FFFF) >> GBA_CODE_CACHE_BLOCK_SHIFT;
+    GBA_CodeCacheInvalidateBlock(gba_code_cache_ewram_used,
+                                 gba_code_cache_arm_ewram_valid,
+                                 gba_code_cache_thumb_ewram_valid, index);
+}
+
+static inline void GBA_CodeCacheInvalidateIWRAM(u32 address)
+{
+    u32 index = (address & 0x7FFF) >> GBA_CODE_CACHE_BLOCK_SHIFT;
+    GBA_CodeCacheInvalidateBlock(gba_code_cache_iwram_used,
+                                 gba_code_cache_arm_iwram_valid,
+                                 gba_code_cache_thumb_iwram_valid, index);
+}
+
+#endif // GBA_CODE_CACHE__
@@ -4,20 +4,25 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stddef.h>
 #include <string.h>
 
 #include "../build_options.h"
 #include "../config.h"
 #include "../debug_utils.h"
+#include "../profile_utils.h"
+#include "../trace_utils.h"
 
+#include "bios.h"
 #include "cpu.h"
 #include "gba.h"
 #include "memory.h"
 
 //------------------------------------------------------------------------------
 
-_cpu_t CPU;
-u32 cpu_loop_break = 0;
+core_local__ _cpu_t CPU;
+core_local__ u32 cpu_loop_break = 0;
+static core_local__ _profile_slice_e cpu_loop_break_reason;
 
 void GBA_CPUInit(void)
 {
@@ -43,15 +48,16 @@ void GBA_CPUInit(void)
     }
 
     // Default stack pointers (Set by BIOS)
-    CPU.R_user[13 - 8] = 0x03007F00;
-    CPU.R13_svc = 0x03007FE0;
-    CPU.R13_irq = 0x03007FA0;
+    CPU.bank[CPU_USER].R13 = 0x03007F00;
+    CPU.bank[CPU_SUPERVISOR].R13 = 0x03007FE0;
+    CPU.bank[CPU_IRQ].R13 = 0x03007FA0;
 
     CPU.OldPC = 0;
 
     REG_IME = 0;
 
     cpu_loop_break = 0;
+    cpu_loop_break_reason = PROFILE_SLICE_OTHER;
 
     GBA_CPUClearHalted();
 }
@@ -66,168 +72,63 @@ void GBA_CPUInit(void)
 
 void GBA_CPUChangeMode(u32 value)
 {
-    static const u32 mode_value[CPU_MODE_NUMBER] = {
-        M_USER, M_FIQ, M_IRQ, M_SUPERVISOR, M_ABORT, M_UNDEFINED, M_SYSTEM
+    // Mode that corresponds to the lower 4 bits of each value, the bank of the
+    // registers of system mode is the one of user mode.
+    static const s8 mode_from_value[16] = {
+        CPU_USER, CPU_FIQ, CPU_IRQ, CPU_SUPERVISOR, -1, -1, -1, CPU_ABORT,
+        -1, -1, -1, CPU_UNDEFINED, -1, -1, -1, CPU_SYSTEM
     };
 
-    // If the mode is the same one as the current one, do nothing
-    if (mode_value[CPU.MODE] == value)
-        return;
-
-    //CPU.SPSR = CPU.CPSR;
-
-    switch (CPU.MODE) // Save current registers
-    {
-        case CPU_USER:
-        case CPU_SYSTEM:
-        {
-            for (int i = 0; i < 7; i++)
-                CPU.R_user[i] = CPU.R[i + 8];
-            break;
-        }
-        case CPU_FIQ:
-        {
-            for (int i = 0; i < 7; i++)
-                CPU.R_fiq[i] = CPU.R[i + 8];
-            CPU.SPSR_fiq = CPU.SPSR;
-            break;
-        }
-        case CPU_SUPERVISOR:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R_user[i] = CPU.R[i + 8];
-            CPU.R13_svc = CPU.R[13];
-            CPU.R14_svc = CPU.R[14];
-            CPU.SPSR_svc = CPU.SPSR;
-            break;
-        }
-        case CPU_ABORT:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R_user[i] = CPU.R[i + 8];
-            CPU.R13_abt = CPU.R[13];
-            CPU.R14_abt = CPU.R[14];
-            CPU.SPSR_abt = CPU.SPSR;
-            break;
-        }
-        case CPU_IRQ:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R_user[i] = CPU.R[i + 8];
-            CPU.R13_irq = CPU.R[13];
-            CPU.R14_irq = CPU.R[14];
-            CPU.SPSR_irq = CPU.SPSR;
-            break;
-        }
-        case CPU_UNDEFINED:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R_user[i] = CPU.R[i + 8];
-            CPU.R13_und = CPU.R[13];
-            CPU.R14_und = CPU.R[14];
-            CPU.SPSR_und = CPU.SPSR;
-            break;
-        }
-        default:
-            return;
-    }
+    int mode = (value & ~0xF) == 0x10 ? mode_from_value[value & 0xF] : -1;
 
-    if (value == mode_value[CPU_USER])
-    {
-        CPU.MODE = CPU_USER;
-    }
-    else if (value == mode_value[CPU_FIQ])
-    {
-        CPU.MODE = CPU_FIQ;
-    }
-    else if (value == mode_value[CPU_IRQ])
-    {
-        CPU.MODE = CPU_IRQ;
-    }
-    else if (value == mode_value[CPU_SUPERVISOR])
-    {
-        CPU.MODE = CPU_SUPERVISOR;
-    }
-    else if (value == mode_value[CPU_ABORT])
-    {
-        CPU.MODE = CPU_ABORT;
-    }
-    else if (value == mode_value[CPU_UNDEFINED])
-    {
-        CPU.MODE = CPU_UNDEFINED;
-    }
-    else if (value == mode_value[CPU_SYSTEM])
-    {
-        CPU.MODE = CPU_SYSTEM;
-    }
-    else
+    if (mode < 0)
     {
         Debug_DebugMsgArg("Trying to change to CPU mode 0x%02X (invalid).",
                           value);
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
         return; // Error
     }
 
-    switch (CPU.MODE) // Load new registers
+    // If the mode is the same one as the current one, do nothing
+    if ((_cpu_mode_e)mode == CPU.MODE)
+        return;
+
+    int old_bank = (CPU.MODE == CPU_SYSTEM) ? CPU_USER : CPU.MODE;
+    int new_bank = (mode == CPU_SYSTEM) ? CPU_USER : mode;
+
+    CPU.MODE = mode;
+
+    // User and system mode share all registers
+    if (old_bank == new_bank)
+        return;
+
+    _cpu_bank_t *prev = &CPU.bank[old_bank];
+    prev->R13 = CPU.R[13];
+    prev->R14 = CPU.R[14];
+
+    const _cpu_bank_t *next = &CPU.bank[new_bank];
+    CPU.R[13] = next->R13;
+    CPU.R[14] = next->R14;
+
+    // User mode doesn't have a SPSR, the one of the previous mode is kept
+    if (old_bank != CPU_USER)
+        prev->SPSR = CPU.SPSR;
+    if (new_bank != CPU_USER)
+        CPU.SPSR = next->SPSR;
+
+    if (old_bank == CPU_FIQ)
     {
-        case CPU_USER:
-        case CPU_SYSTEM:
-        {
-            for (int i = 0; i < 7; i++)
-                CPU.R[i + 8] = CPU.R_user[i];
-            break;
-        }
-        case CPU_FIQ:
-        {
-            for (int i = 0; i < 7; i++)
-                CPU.R[i + 8] = CPU.R_fiq[i];
-            CPU.SPSR = CPU.SPSR_fiq;
-            break;
-        }
-        case CPU_SUPERVISOR:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R[i + 8] = CPU.R_user[i];
-            CPU.R[13] = CPU.R13_svc;
-            CPU.R[14] = CPU.R14_svc;
-            CPU.SPSR = CPU.SPSR_svc;
-            break;
-        }
-        case CPU_ABORT:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R[i + 8] = CPU.R_user[i];
-            CPU.R[13] = CPU.R13_abt;
-            CPU.R[14] = CPU.R14_abt;
-            CPU.SPSR = CPU.SPSR_abt;
-            break;
-        }
-        case CPU_IRQ:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R[i + 8] = CPU.R_user[i];
-            CPU.R[13] = CPU.R13_irq;
-            CPU.R[14] = CPU.R14_irq;
-            CPU.SPSR = CPU.SPSR_irq;
-            break;
-        }
-        case CPU_UNDEFINED:
-        {
-            for (int i = 0; i < 5; i++)
-                CPU.R[i + 8] = CPU.R_user[i];
-            CPU.R[13] = CPU.R13_und;
-            CPU.R[14] = CPU.R14_und;
-            CPU.SPSR = CPU.SPSR_und;
-            break;
-        }
-        default:
-            return;
+        memcpy(CPU.R_fiq, &CPU.R[8], sizeof(CPU.R_fiq));
+        memcpy(&CPU.R[8], CPU.R_user, sizeof(CPU.R_user));
+    }
+    else if (new_bank == CPU_FIQ)
+    {
+        memcpy(CPU.R_user, &CPU.R[8], sizeof(CPU.R_user));
+        memcpy(&CPU.R[8], CPU.R_fiq, sizeof(CPU.R_fiq));
     }
-
-    return;
 }
 
-static s32 gba_halt;
+static core_local__ s32 gba_halt;
 
 void GBA_CPUSetHalted(s32 value)
 {
@@ -255,18 +156,120 @@ void GBA_CPUClearHalted(void)
     gba_halt = 0;
 }
 
+//------------------------------------------------------------------------------
+
+// Idle loop detection
+// -------------------
+//
+// Games often wait for an interrupt by polling a register or a variable in a
+// loop. Nothing that the loop can read changes until the CPU returns to
+// GBA_RunFor() and the rest of the hardware is updated. If the CPU state is the
+// same after two consecutive iterations and nothing has been written to
+// memory, all the iterations until the end of the current slice of clocks will
+// be exactly the same. Those iterations are skipped, leaving enough clocks to
+// run the last one normally, so the final state is the same as if all of them
+// had been emulated.
+
+core_local__ u32 gba_idle_loop_memory_written;
+
+// Only the registers that can be seen from the loop need to be compared
+#define IDLE_LOOP_STATE_SIZE    (offsetof(_cpu_t, R_user))
+
+static core_local__ _cpu_t idle_loop_state;
+static core_local__ s32 idle_loop_clocks;
+static core_local__ int idle_loop_valid;
+
+s32 GBA_CPUIdleLoopCheck(s32 clocks)
+{
+    if (idle_loop_valid && (gba_idle_loop_memory_written == 0)
+        && (memcmp(&idle_loop_state, &CPU, IDLE_LOOP_STATE_SIZE) == 0))
+    {
+        s32 iteration_clocks = idle_loop_clocks - clocks;
+
+        if ((iteration_clocks > 0) && (clocks > iteration_clocks))
+            clocks -= ((clocks - 1) / iteration_clocks) * iteration_clocks;
+
+        idle_loop_valid = 0;
+        return clocks;
+    }
+
+    memcpy(&idle_loop_state, &CPU, IDLE_LOOP_STATE_SIZE);
+    idle_loop_clocks = clocks;
+    idle_loop_valid = 1;
+    gba_idle_loop_memory_written = 0;
+
+    return clocks;
+}
+
+//------------------------------------------------------------------------------
+
+// Clocks executed before the current slice and clocks given to it, used to
+// calculate the clock of each instruction in the execution trace
+static core_local__ u64 gba_trace_clocks = 0;
+static core_local__ s32 gba_trace_slice_clocks = 0;
+
+void GBA_TraceClocksAdd(s32 clocks)
+{
+    gba_trace_clocks += clocks;
+}
+
+void GBA_TraceInstruction(u32 opcode, u32 size, s32 clocks)
+{
+    Trace_Add(CPU.R[R_PC], opcode, size, CPU.CPSR & (F_T | 0x1F),
+              gba_trace_clocks + (gba_trace_slice_clocks - clocks));
+}
+
 s32 GBA_Execute(s32 clocks) // Returns total clocks not executed
 {
     if (GBA_CPUGetHalted()) // Execute all clocks
         return 0;
 
+    // The clocks of the previous slice can't be compared with the new ones
+    idle_loop_valid = 0;
+
+    gba_trace_slice_clocks = clocks;
+
     if (CPU.EXECUTION_MODE == EXEC_ARM)
+    {
+        // GBA_InterruptCheck() jumps to the IRQ vector before a new slice
+        if (CPU.R[R_PC] == 0x18)
+            clocks = GBA_BiosIRQVectorHLE(clocks);
+
         return GBA_ExecuteARM(clocks);
+    }
     else
         return GBA_ExecuteTHUMB(clocks);
 }
 
-void GBA_ExecutionBreak(void)
+void GBA_ExecutionBreak(_profile_slice_e reason)
 {
     cpu_loop_break = 1;
+    cpu_loop_break_reason = reason;
+}
+
+_profile_slice_e GBA_ExecutionBreakReason(void)
+{
+    _profile_slice_e reason = cpu_loop_break_reason;
+    cpu_loop_break_reason = PROFILE_SLICE_OTHER;
+    return reason;
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_CPUStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "CPU ");
+    SaveState_Write(st, &CPU, sizeof(CPU));
+    SaveState_Write(st, &gba_halt, sizeof(gba_halt));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_CPUStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "CPU ");
+    SaveState_Read(st, &CPU, sizeof(CPU));
+    SaveState_Read(st, &gba_halt, sizeof(gba_halt));
+    SaveState_ChunkClose(st);
+
+    idle_loop_valid = 0;
 }
@@ -7,9 +7,34 @@
 #ifndef GBA_CPU__
 #define GBA_CPU__
 
+#include "../profile_utils.h"
+
 #include "gba.h"
 
-extern _cpu_t CPU;
+extern core_local__ _cpu_t CPU;
+
+// Set the condition flags of CPSR from the result of an instruction, leaving
+// the other flags as they are. The carry and overflow are 0 or not 0.
+
+static inline void GBA_CPUSetFlagsNZ(u32 result)
+{
+    CPU.CPSR = (CPU.CPSR & ~(F_N | F_Z))
+               | (result & F_N) | ((u32)(result == 0) << 30);
+}
+
+static inline void GBA_CPUSetFlagsNZC(u32 result, u32 carry)
+{
+    CPU.CPSR = (CPU.CPSR & ~(F_N | F_Z | F_C))
+               | (result & F_N) | ((u32)(result == 0) << 30)
+               | ((u32)(carry != 0) << 29);
+}
+
+static inline void GBA_CPUSetFlagsNZCV(u32 result, u32 carry, u32 overflow)
+{
+    CPU.CPSR = (CPU.CPSR & ~(F_N | F_Z | F_C | F_V))
+               | (result & F_N) | ((u32)(result == 0) << 30)
+               | ((u32)(carry != 0) << 29) | ((u32)(overflow != 0) << 28);
+}
 
 void GBA_CPUInit(void);
 
@@ -20,10 +45,33 @@ s32 GBA_ExecuteTHUMB(s32 clocks); // In thumb.c
 
 // Returns total clocks not executed
 s32 GBA_Execute(s32 clocks);
-void GBA_ExecutionBreak(void);
+// Stops the CPU loop so that the scheduler can handle an event. The reason is
+// only used to tell the profiler why the slice of CPU execution has ended.
+void GBA_ExecutionBreak(_profile_slice_e reason);
+// Returns the reason of the last call to GBA_ExecutionBreak() and clears it
+_profile_slice_e GBA_ExecutionBreakReason(void);
+
+// Execution trace (see trace_utils.h). The clocks are the ones left in the
+// current slice of CPU execution.
+void GBA_TraceClocksAdd(s32 clocks); // Called after each slice
+void GBA_TraceInstruction(u32 opcode, u32 size, s32 clocks);
+
+// Set by the memory write functions, used by the idle loop detection
+extern core_local__ u32 gba_idle_loop_memory_written;
+
+// Game loops smaller than this are checked for idle loops
+#define GBA_IDLE_LOOP_MAX_SIZE  (64)
+
+// Call after a jump backwards of less than GBA_IDLE_LOOP_MAX_SIZE bytes. It
+// returns the clocks left in the current slice after skipping any iteration
+// that is known to do nothing.
+s32 GBA_CPUIdleLoopCheck(s32 clocks);
 
 void GBA_CPUSetHalted(s32 value);
 s32 GBA_CPUGetHalted(void); // 0 = no, 1 = halt, 2 = stop
 void GBA_CPUClearHalted(void);
 
+void GBA_CPUStateSave(_savestate_t *st);
+void GBA_CPUStateLoad(_savestate_t *st);
+
 #endif // GBA_CPU__
@@ -5,67 +5,107 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../build_options.h"
+#include "../debug_utils.h"
 #include "../font_utils.h"
 
 #include "cpu.h"
+#include "disassembler.h"
 #include "gba.h"
 #include "memory.h"
 #include "shifts.h"
 
 //------------------------------------------------------------------------------
 
-#define GBA_MAX_BREAKPOINTS 20
+// Set by the frontend, it's the same for all the consoles of the process
+static void (*gba_debug_break_callback)(void) = NULL;
 
-static u32 gba_brkpoint_addrlist[GBA_MAX_BREAKPOINTS];
-static int gba_brkpoint_used[GBA_MAX_BREAKPOINTS];
-static int gba_any_breakpoint_used = 0;
+void GBA_DebugSetBreakCallback(void (*fn)(void))
+{
+    gba_debug_break_callback = fn;
+}
 
-int GBA_DebugIsBreakpoint(u32 addr)
+void GBA_DebugNotifyBreak(void)
 {
-    if (gba_any_breakpoint_used == 0)
-        return 0;
+    if (gba_debug_break_callback)
+        gba_debug_break_callback();
+}
+
+//------------------------------------------------------------------------------
+
+// There is no limit to the number of breakpoints, they are kept in a sorted
+// list. The bitmap has a bit for each page of memory that is set if there is
+// any breakpoint in it, so the CPU loop can discard most addresses without
+// searching the list. The top bits of the addresses are ignored by the bus, so
+// they aren't used to select the page.
+
+#define GBA_BREAKPOINT_PAGE_SHIFT   (12)
+#define GBA_BREAKPOINT_PAGE_BITS    (28 - GBA_BREAKPOINT_PAGE_SHIFT)
+
+static core_local__ u8 gba_brkpoint_pages[(1 << GBA_BREAKPOINT_PAGE_BITS) / 8];
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+static core_local__ u32 *gba_brkpoint_list = NULL;
+static core_local__ int gba_brkpoint_num = 0;
+static core_local__ int gba_brkpoint_size = 0;
+
+static u32 gba_brkpoint_page(u32 addr)
+{
+    return (addr & 0x0FFFFFFF) >> GBA_BREAKPOINT_PAGE_SHIFT;
+}
+
+// Returns the index of the first breakpoint that isn't lower than the address
+static int gba_brkpoint_find(u32 addr)
+{
+    int min = 0;
+    int max = gba_brkpoint_num;
+
+    while (min < max)
     {
-        if (gba_brkpoint_used[i])
-        {
-            if (gba_brkpoint_addrlist[i] == addr)
-            {
-                return 1;
-            }
-        }
+        int mid = (min + max) / 2;
+        if (gba_brkpoint_list[mid] < addr)
+            min = mid + 1;
+        else
+            max = mid;
     }
-    return 0;
-}
 
-static u32 gba_last_executed_opcode = 1;
+    return min;
+}
 
-int GBA_DebugCPUIsBreakpoint(u32 addr)
+int GBA_DebugIsBreakpoint(u32 addr)
 {
-    if (gba_any_breakpoint_used == 0)
+    u32 page = gba_brkpoint_page(addr);
+
+    if ((gba_brkpoint_pages[page >> 3] & BIT(page & 7)) == 0)
         return 0;
 
+    int i = gba_brkpoint_find(addr);
+
+    return (i < gba_brkpoint_num) && (gba_brkpoint_list[i] == addr);
+}
+
+static core_local__ u32 gba_last_executed_opcode = 1;
+
+int GBA_DebugCPUIsBreakpoint(u32 addr)
+{
     if (gba_last_executed_opcode == addr)
     {
         gba_last_executed_opcode = 1;
         return 0;
     }
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
-    {
-        if (gba_brkpoint_used[i])
-        {
-            if (gba_brkpoint_addrlist[i] == addr)
-            {
-                gba_last_executed_opcode = addr;
-                return 1;
-            }
-        }
-    }
-    return 0;
+    if (GBA_DebugIsBreakpoint(addr) == 0)
+        return 0;
+
+    gba_last_executed_opcode = addr;
+    return 1;
+}
+
+int GBA_DebugCPUBreakpointsUsed(void)
+{
+    return gba_brkpoint_num > 0;
 }
 
 void GBA_DebugAddBreakpoint(u32 addr)
@@ -73,62 +113,249 @@ void GBA_DebugAddBreakpoint(u32 addr)
     if (GBA_DebugIsBreakpoint(addr))
         return;
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    if (gba_brkpoint_num == gba_brkpoint_size)
     {
-        if (gba_brkpoint_used[i] == 0)
+        int size = (gba_brkpoint_size == 0) ? 32 : gba_brkpoint_size * 2;
+
+        u32 *list = realloc(gba_brkpoint_list, size * sizeof(u32));
+        if (list == NULL)
         {
-            gba_brkpoint_addrlist[i] = addr;
-            gba_brkpoint_used[i] = 1;
-            gba_any_breakpoint_used = 1;
+            Debug_ErrorMsgArg("Not enough memory for more breakpoints.");
             return;
         }
+
+        gba_brkpoint_list = list;
+        gba_brkpoint_size = size;
     }
+
+    int i = gba_brkpoint_find(addr);
+
+    memmove(&gba_brkpoint_list[i + 1], &gba_brkpoint_list[i],
+            (gba_brkpoint_num - i) * sizeof(u32));
+    gba_brkpoint_list[i] = addr;
+    gba_brkpoint_num++;
+
+    u32 page = gba_brkpoint_page(addr);
+    gba_brkpoint_pages[page >> 3] |= BIT(page & 7);
 }
 
 void GBA_DebugClearBreakpoint(u32 addr)
 {
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    int i = gba_brkpoint_find(addr);
+
+    if ((i == gba_brkpoint_num) || (gba_brkpoint_list[i] != addr))
+        return;
+
+    gba_brkpoint_num--;
+    memmove(&gba_brkpoint_list[i], &gba_brkpoint_list[i + 1],
+            (gba_brkpoint_num - i) * sizeof(u32));
+
+    // Only clear the page if there are no more breakpoints in it
+    u32 page = gba_brkpoint_page(addr);
+
+    for (int j = 0; j < gba_brkpoint_num; j++)
     {
-        if (gba_brkpoint_used[i])
+        if (gba_brkpoint_page(gba_brkpoint_list[j]) == page)
+            return;
+    }
+
+    gba_brkpoint_pages[page >> 3] &= ~BIT(page & 7);
+}
+
+void GBA_DebugClearBreakpointAll(void)
+{
+    free(gba_brkpoint_list);
+    gba_brkpoint_list = NULL;
+    gba_brkpoint_num = 0;
+    gba_brkpoint_size = 0;
+
+    memset(gba_brkpoint_pages, 0, sizeof(gba_brkpoint_pages));
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+    u32 start;
+    u32 end;
+    int type; // 0 if the slot is free
+} _gba_watchpoint_t;
+
+static core_local__ _gba_watchpoint_t gba_watchpoints[GBA_MAX_WATCHPOINTS];
+
+core_local__ int gba_watchpoint_types = 0;
+core_local__ int gba_watchpoint_check_types = 0;
+
+void GBA_DebugWatchpointsArm(int arm)
+{
+    gba_watchpoint_check_types = arm ? gba_watchpoint_types : 0;
+}
+
+static void gba_watchpoints_updated(void)
+{
+    gba_watchpoint_types = 0;
+    for (int i = 0; i < GBA_MAX_WATCHPOINTS; i++)
+        gba_watchpoint_types |= gba_watchpoints[i].type;
+
+    GBA_MemoryWatchpointsUpdated();
+}
+
+int GBA_DebugAddWatchpoint(u32 start, u32 end, int type)
+{
+    if (end < start)
+    {
+        u32 tmp = start;
+        start = end;
+        end = tmp;
+    }
+
+    for (int i = 0; i < GBA_MAX_WATCHPOINTS; i++)
+    {
+        _gba_watchpoint_t *w = &gba_watchpoints[i];
+
+        if (w->type == 0)
+            continue;
+
+        // Setting the same range again changes its type
+        if ((w->start == start) && (w->end == end))
         {
-            if (gba_brkpoint_addrlist[i] == addr)
-            {
-                gba_brkpoint_used[i] = 0;
-                break;
-            }
+            w->type = type;
+            gba_watchpoints_updated();
+            return 0;
         }
     }
 
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
+    for (int i = 0; i < GBA_MAX_WATCHPOINTS; i++)
     {
-        if (gba_brkpoint_used[i])
-            return;
+        _gba_watchpoint_t *w = &gba_watchpoints[i];
+
+        if (w->type == 0)
+        {
+            w->start = start;
+            w->end = end;
+            w->type = type;
+            gba_watchpoints_updated();
+            return 0;
+        }
     }
 
-    gba_any_breakpoint_used = 0;
+    return 1;
 }
 
-void GBA_DebugClearBreakpointAll(void)
+void GBA_DebugClearWatchpoint(u32 start, u32 end)
+{
+    if (end < start)
+    {
+        u32 tmp = start;
+        start = end;
+        end = tmp;
+    }
+
+    for (int i = 0; i < GBA_MAX_WATCHPOINTS; i++)
+    {
+        _gba_watchpoint_t *w = &gba_watchpoints[i];
+
+        if ((w->start == start) && (w->end == end))
+            w->type = 0;
+    }
+
+    gba_watchpoints_updated();
+}
+
+void GBA_DebugClearWatchpointAll(void)
+{
+    memset(gba_watchpoints, 0, sizeof(gba_watchpoints));
+    gba_watchpoints_updated();
+}
+
+int GBA_DebugGetWatchpoint(int index, u32 *start, u32 *end, int *type)
+{
+    _gba_watchpoint_t *w = &gba_watchpoints[index];
+
+    if (w->type == 0)
+        return 0;
+
+    *start = w->start;
+    *end = w->end;
+    *type = w->type;
+    return 1;
+}
+
+int GBA_DebugWatchpointInRange(u32 address, u32 size, int type)
+{
+    u32 last = address + size - 1;
+
+    for (int i = 0; i < GBA_MAX_WATCHPOINTS; i++)
+    {
+        _gba_watchpoint_t *w = &gba_watchpoints[i];
+
+        if ((w->type & type) && (w->start <= last) && (address <= w->end))
+            return 1;
+    }
+
+    return 0;
+}
+
+void GBA_DebugWatchpointCheck(u32 address, u32 size, int type)
 {
-    for (int i = 0; i < GBA_MAX_BREAKPOINTS; i++)
-        gba_brkpoint_used[i] = 0;
+    if (GBA_DebugWatchpointInRange(address, size, type) == 0)
+        return;
+
+    Debug_LogMsgArg("Watchpoint: %s %08X (%u bytes)",
+                    (type == GBA_WATCH_READ) ? "Read from" : "Write to",
+                    address, size);
 
-    gba_any_breakpoint_used = 0;
+    // The access isn't interrupted, the execution stops after the current
+    // instruction or the current DMA transfer.
+    GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
+    GBA_RunFor_ExecutionBreak();
+    GBA_DebugNotifyBreak();
 }
 
 //------------------------------------------------------------------------------
 
+// They are thread-local even if the cores aren't, so that other threads can
+// disassemble offline (see dump_utils.c) while the debugger reads the state.
+static _Thread_local int gba_disassembler_offline = 0;
+static _Thread_local int gba_disassembler_state_used = 0;
+
+void GBA_DisassemblerSetOffline(int offline)
+{
+    gba_disassembler_offline = offline;
+}
+
+int GBA_DisassemblerStateUsed(void)
+{
+    return gba_disassembler_state_used;
+}
+
+// Called before reading the registers or memory to add information to the
+// text. Returns 0 if they can't be used.
+static int gba_disassembler_state_available(void)
+{
+    if (gba_disassembler_offline)
+        return 0;
+
+    gba_disassembler_state_used = 1;
+    return 1;
+}
+
 u32 arm_check_condition(u32 cond); // In arm.c
 
 // Returns 1 if there is a ';' in the line (previous to this or written by this)
 static int gba_dissasemble_add_condition_met(int cond, u32 address, char *dest,
                                              int add_comment, int dest_size)
 {
+    if (gba_disassembler_offline)
+        return 0;
+
     if (CPU.R[R_PC] == address)
     {
         if (cond == 14) // Always
             return 0;
 
+        gba_disassembler_state_used = 1;
+
         if (add_comment)
         {
             if (arm_check_condition(cond))
@@ -256,6 +483,10 @@ static struct
 static int gba_dissasemble_add_io_register_name(int reg_address, char *dest,
                                                 int add_comment, int dest_size)
 {
+    // All the addresses come from the registers or from memory
+    if (!gba_disassembler_state_available())
+        return 0;
+
     int i = 0;
 
     while (1)
@@ -349,6 +580,8 @@ static const char arm_shift_type[4][4] = { "lsl", "lsr", "asr", "ror" };
 
 void GBA_DisassembleARM(u32 opcode, u32 address, char *dest, int dest_size)
 {
+    gba_disassembler_state_used = 0;
+
     int arm_cond_code = (opcode >> 28) & 0xF;
     const char *cond = arm_cond[arm_cond_code];
     u32 ident = (opcode >> 25) & 7;
@@ -371,7 +604,8 @@ void GBA_DisassembleARM(u32 opcode, u32 address, char *dest, int dest_size)
                         char *sign = (opcode & BIT(23)) ? "+" : "-";
 
                         // Only if "Immediate as offset"
-                        u32 writeresult = (opcode & BIT(22)) && (Rn == R_PC);
+                        u32 writeresult = (opcode & BIT(22)) && (Rn == R_PC)
+                                          && gba_disassembler_state_available();
 
                         u32 addr = CPU.R[Rn];
 
@@ -630,9 +864,10 @@ void GBA_DisassembleARM(u32 opcode, u32 address, char *dest, int dest_size)
                     {
                         // BX{cond}
                         u32 Rn = opcode & 0xF;
-                        if (CPU.R[Rn] & 1) // Switch to THUMB
+                        if (gba_disassembler_state_available()
+                            && (CPU.R[Rn] & 1))
                         {
-                            // PC=Rn-1, T=Rn.0
+                            // Switch to THUMB. PC=Rn-1, T=Rn.0
                             snprintf(dest, dest_size,
                                      "bx%s r%d ; Switch to THUMB", cond, Rn);
                             gba_dissasemble_add_condition_met(arm_cond_code,
@@ -1123,7 +1358,7 @@ void GBA_DisassembleARM(u32 opcode, u32 address, char *dest, int dest_size)
 
             if (opcode & BIT(20)) // LDR{cond}{B}{T} Rd,<Address>
             {
-                if (Rn == R_PC)
+                if ((Rn == R_PC) && gba_disassembler_state_available())
                 {
                     if (opcode & BIT(24)) // Pre-indexed
                     {
@@ -1497,6 +1732,8 @@ static const char thumb_alu_operation[16][4] = {
 
 void GBA_DisassembleTHUMB(u16 opcode, u32 address, char *dest, int dest_size)
 {
+    gba_disassembler_state_used = 0;
+
     u16 ident = opcode >> 12;
     opcode &= 0x0FFF;
 
@@ -1635,6 +1872,12 @@ void GBA_DisassembleTHUMB(u16 opcode, u32 address, char *dest, int dest_size)
                 //snprintf(dest, dest_size, "ldr r%d, [pc, #0x%03X] =0x%08X",
                 //         Rd, offset,
                 //         GBA_MemoryRead32(((address + 4) & (~2)) + offset));
+                if (!gba_disassembler_state_available())
+                {
+                    snprintf(dest, dest_size, "ldr r%d, [0x%08X]", Rd,
+                             ((address + 4) & (~2)) + offset);
+                    return;
+                }
                 snprintf(dest, dest_size, "ldr r%d, =0x%08X", Rd,
                          GBA_MemoryRead32(((address + 4) & (~2)) + offset));
                 return;
@@ -1750,7 +1993,8 @@ void GBA_DisassembleTHUMB(u16 opcode, u32 address, char *dest, int dest_size)
                                 {
                                     // BX  Rs
                                     u16 Rs = (opcode >> 3) & 0xF;
-                                    if (CPU.R[Rs] & BIT(0))
+                                    if (!gba_disassembler_state_available()
+                                        || (CPU.R[Rs] & BIT(0)))
                                     {
                                         snprintf(dest, dest_size, "bx r%d", Rs);
                                     }
@@ -2231,6 +2475,16 @@ void GBA_DisassembleTHUMB(u16 opcode, u32 address, char *dest, int dest_size)
         case 0xF:
         {
             // BL label
+            if (!gba_disassembler_state_available())
+            {
+                // The other half can't be read
+                if (opcode & BIT(11))
+                    s_strncpy(dest, "bl (2nd part)", dest_size);
+                else
+                    s_strncpy(dest, "bl (1st part)", dest_size);
+                return;
+            }
+
             if (opcode & BIT(11)) // Second part
             {
                 u16 prev = GBA_MemoryRead16(address - 2);
@@ -9,12 +9,57 @@
 
 #include "gba.h"
 
+// Function of the debugger called when the execution stops at a breakpoint or a
+// watchpoint, so that it can show where. It can be NULL.
+void GBA_DebugSetBreakCallback(void (*fn)(void));
+void GBA_DebugNotifyBreak(void);
+
 void GBA_DebugAddBreakpoint(u32 addr);
 void GBA_DebugClearBreakpoint(u32 addr);
 int GBA_DebugIsBreakpoint(u32 addr);    // Used in debugger
 int GBA_DebugCPUIsBreakpoint(u32 addr); // Used in CPU loop
+int GBA_DebugCPUBreakpointsUsed(void);   // Used in CPU loop
 void GBA_DebugClearBreakpointAll(void);
 
+// Watchpoints stop the execution after the CPU, a DMA or the BIOS read or write
+// any address in [start, end]. Addresses are compared as they are accessed, so
+// accesses through other mirrors of the same memory aren't detected. The pages
+// of memory with watchpoints are moved out of the fast path of the memory
+// handlers, the rest of accesses don't check them.
+
+#define GBA_WATCH_READ          BIT(0)
+#define GBA_WATCH_WRITE         BIT(1)
+
+#define GBA_MAX_WATCHPOINTS     (16)
+
+// Returns 0 on success, 1 if there is no space for more watchpoints
+int GBA_DebugAddWatchpoint(u32 start, u32 end, int type);
+void GBA_DebugClearWatchpoint(u32 start, u32 end);
+void GBA_DebugClearWatchpointAll(void);
+// Returns 1 and the watchpoint if the index is used, 0 if not
+int GBA_DebugGetWatchpoint(int index, u32 *start, u32 *end, int *type);
+
+// Used by the memory handlers. The first one has the types of all watchpoints,
+// the second one is the same while GBA_RunFor() runs and 0 the rest of the
+// time, so that the debugger windows can access memory without hitting them.
+extern core_local__ int gba_watchpoint_types;
+extern core_local__ int gba_watchpoint_check_types;
+void GBA_DebugWatchpointsArm(int arm);
+int GBA_DebugWatchpointInRange(u32 address, u32 size, int type);
+void GBA_DebugWatchpointCheck(u32 address, u32 size, int type);
+
+// While it's set, the disassemblers don't read memory or the registers of the
+// CPU to add comments or the values loaded from literal pools, so that they can
+// be used when they don't have the values of the moment the instruction was
+// executed, like when decoding a trace. It only affects the calling thread.
+void GBA_DisassemblerSetOffline(int offline);
+
+// Returns 1 if the text of the last instruction disassembled depends on the
+// registers of the CPU or on memory other than the opcode, so it can change
+// even if the opcode doesn't. The text of the instruction pointed by PC always
+// depends on them.
+int GBA_DisassemblerStateUsed(void);
+
 void GBA_DisassembleARM(u32 opcode, u32 address, char *dest, int dest_size);
 
 void GBA_DisassembleTHUMB(u16 opcode, u32 address, char *dest, int dest_size);
@@ -4,14 +4,21 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdlib.h>
+
 #include "../build_options.h"
 #include "../debug_utils.h"
+#include "../profile_utils.h"
 
 #include "cpu.h"
+#include "disassembler.h"
 #include "dma.h"
 #include "gba.h"
 #include "interrupts.h"
 #include "memory.h"
+#include "save.h"
+#include "scheduler.h"
+#include "sound.h"
 #include "video.h"
 
 typedef struct
@@ -44,7 +51,7 @@ typedef struct
     u32 special;
 } _dma_channel_;
 
-static _dma_channel_ DMA[4];
+static core_local__ _dma_channel_ DMA[4];
 
 //--------------------------------------------------------------------------
 
@@ -55,11 +62,114 @@ static s32 gba_dma_dst_add[4] = {
     2, -2, 0, 2
 };
 
-static int gba_dmaworking = 0;
-static s32 gba_dma_extra_clocks_elapsed = 0;
+static core_local__ int gba_dmaworking = 0;
+static core_local__ s32 gba_dma_extra_clocks_elapsed = 0;
+
+// The EEPROM is accessed with DMA3 transfers of one bit per halfword. Copying
+// them one halfword at a time through the memory handlers is very slow, so the
+// save code handles the whole packet if the other end is in plain memory.
+static int GBA_DMATransferEEPROM(_dma_channel_ *dma)
+{
+    u32 size = dma->num_chunks * 2;
+
+    if ((dma->dstaddr >> 24) == 0x0D)
+    {
+        if ((dma->srcadd != 2) || (dma->dstadd != 2))
+            return 0;
+
+        if (gba_watchpoint_types & GBA_WATCH_WRITE)
+        {
+            if (GBA_DebugWatchpointInRange(dma->dstaddr, size,
+                                           GBA_WATCH_WRITE))
+                return 0;
+        }
+
+        const u8 *src = GBA_MemoryGetReadPointer(dma->srcaddr, size);
+        if (src == NULL)
+            return 0;
+
+        if (GBA_SaveEEPROMWritePacket(dma->dstaddr, (const u16 *)src,
+                                      dma->num_chunks) == 0)
+            return 0;
+    }
+    else if ((dma->srcaddr >> 24) == 0x0D)
+    {
+        if (dma->dstadd != 2)
+            return 0;
+
+        if (gba_watchpoint_types & GBA_WATCH_READ)
+        {
+            if (GBA_DebugWatchpointInRange(dma->srcaddr, size,
+                                           GBA_WATCH_READ))
+                return 0;
+        }
+
+        u8 *dst = GBA_MemoryGetWritePointer(dma->dstaddr, size);
+        if (dst == NULL)
+            return 0;
+
+        if (GBA_SaveEEPROMReadPacket(dma->srcaddr, (u16 *)dst,
+                                     dma->num_chunks) == 0)
+            return 0;
+
+        GBA_MemoryBlockModified(dma->dstaddr, size);
+    }
+    else
+    {
+        return 0;
+    }
+
+    dma->srcaddr += dma->srcadd * dma->num_chunks;
+    dma->dstaddr += dma->dstadd * dma->num_chunks;
+    return 1;
+}
+
+// The cycles of the transfer are added all at once (in clockstotal), so it
+// doesn't matter if the data is copied in one go. Transfers between plain
+// memory regions are done as a single block copy, the rest go through the
+// memory handlers one unit at a time.
+static void GBA_DMATransfer(_dma_channel_ *dma)
+{
+    u32 unit = dma->copywords ? 4 : 2;
+
+    if (GBA_MemoryCopyBlock(dma->dstaddr, dma->dstadd, dma->srcaddr,
+                            dma->srcadd, dma->num_chunks, unit))
+    {
+        dma->srcaddr += dma->srcadd * dma->num_chunks;
+        dma->dstaddr += dma->dstadd * dma->num_chunks;
+        return;
+    }
+
+    if ((dma == &DMA[3]) && (dma->copywords == 0))
+    {
+        if (GBA_DMATransferEEPROM(dma))
+            return;
+    }
+
+    if (dma->copywords) // Copy words
+    {
+        for (int i = 0; i < dma->num_chunks; i++)
+        {
+            GBA_MemoryWrite32(dma->dstaddr, GBA_MemoryRead32(dma->srcaddr));
+            dma->srcaddr += dma->srcadd;
+            dma->dstaddr += dma->dstadd;
+        }
+    }
+    else // Copy halfwords
+    {
+        for (int i = 0; i < dma->num_chunks; i++)
+        {
+            GBA_MemoryWrite16(dma->dstaddr, GBA_MemoryRead16(dma->srcaddr));
+            dma->srcaddr += dma->srcadd;
+            dma->dstaddr += dma->dstadd;
+        }
+    }
+}
 
 void GBA_DMA0Setup(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_DMA, 1);
+
     DMA[0].enabled = 0;
     DMA[0].starttime = 0;
 
@@ -119,12 +229,12 @@ void GBA_DMA0Setup(void)
     if (DMA[0].starttime == START_NOW)
     {
         gba_dmaworking = 1;
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
     }
     else if (DMA[0].starttime == START_SPECIAL) // Prohibited
     {
         Debug_DebugMsgArg("DMA 0 in mode 3 - prohibited");
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
         DMA[0].enabled = 0;
     }
 
@@ -138,12 +248,14 @@ void GBA_DMA0Setup(void)
                                 DMA[0].srcaddr, DMA[0].srcadd, DMA[0].dstaddr,
                                 DMA[0].dstadd, DMA[0].num_chunks);
     MessageBox(NULL, text, "EMULATION", MB_OK);
-    GBA_ExecutionBreak();
+    GBA_ExecutionBreak(PROFILE_SLICE_DMA);
 #endif
 }
 
 void GBA_DMA1Setup(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_DMA, 1);
+
     DMA[1].enabled = 0;
     DMA[1].starttime = 0;
 
@@ -201,11 +313,13 @@ void GBA_DMA1Setup(void)
     DMA[1].repeat = REG_DMA1CNT_H & BIT(9);
 
     if (DMA[1].starttime == START_NOW)
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
 }
 
 void GBA_DMA2Setup(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_DMA, 1);
+
     DMA[2].enabled = 0;
     DMA[2].starttime = 0;
 
@@ -263,11 +377,13 @@ void GBA_DMA2Setup(void)
     DMA[2].repeat = REG_DMA2CNT_H & BIT(9);
 
     if (DMA[2].starttime == START_NOW)
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
 }
 
 void GBA_DMA3Setup(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_DMA, 1);
+
     DMA[3].enabled = 0;
     DMA[3].starttime = 0;
 
@@ -330,7 +446,7 @@ void GBA_DMA3Setup(void)
     if (REG_DMA3CNT_H & BIT(11))
     {
         Debug_DebugMsgArg("Game Pak DRQ  - DMA3 (not emulated)");
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
     }
     // Not emulated -- It depends on a pin in the GBA Game Pak
     // BIT 11: Game Pak DRQ - DMA3 only - (0=Normal, 1=DRQ <from> Game Pak, DMA3)
@@ -339,7 +455,7 @@ void GBA_DMA3Setup(void)
     if (DMA[3].starttime == START_NOW)
     {
         gba_dmaworking = 1;
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
     }
 #if 0
     char text[64];
@@ -351,7 +467,7 @@ void GBA_DMA3Setup(void)
                                  DMA[3].srcaddr, DMA[3].srcadd, DMA[3].dstaddr,
                                  DMA[3].dstadd, DMA[3].num_chunks);
     MessageBox(NULL, text, "EMULATION", MB_OK);
-    GBA_ExecutionBreak();
+    GBA_ExecutionBreak(PROFILE_SLICE_DMA);
 #endif
 }
 
@@ -366,7 +482,7 @@ static s32 GBA_DMA0Update(s32 clocks)
     if (DMA[0].starttime == START_SPECIAL)
     {
         Debug_DebugMsgArg("DMA0, MODE: START_SPECIAL (?)");
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
         DMA[0].enabled = 0;
         return 0x7FFFFFFF;
     }
@@ -408,26 +524,7 @@ static s32 GBA_DMA0Update(s32 clocks)
 
         if (copy)
         {
-            if (DMA[0].copywords) // Copy words
-            {
-                for (int i = 0; i < DMA[0].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[0].dstaddr,
-                                      GBA_MemoryRead32(DMA[0].srcaddr));
-                    DMA[0].srcaddr += DMA[0].srcadd;
-                    DMA[0].dstaddr += DMA[0].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (int i = 0; i < DMA[0].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[0].dstaddr,
-                                      GBA_MemoryRead16(DMA[0].srcaddr));
-                    DMA[0].srcaddr += DMA[0].srcadd;
-                    DMA[0].dstaddr += DMA[0].dstadd;
-                }
-            }
+            GBA_DMATransfer(&DMA[0]);
         }
     }
 
@@ -522,26 +619,7 @@ static s32 GBA_DMA1Update(s32 clocks)
 
         if (copy)
         {
-            if (DMA[1].copywords) // Copy words
-            {
-                for (int i = 0; i < DMA[1].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[1].dstaddr,
-                                      GBA_MemoryRead32(DMA[1].srcaddr));
-                    DMA[1].srcaddr += DMA[1].srcadd;
-                    DMA[1].dstaddr += DMA[1].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (int i = 0; i < DMA[1].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[1].dstaddr,
-                                      GBA_MemoryRead16(DMA[1].srcaddr));
-                    DMA[1].srcaddr += DMA[1].srcadd;
-                    DMA[1].dstaddr += DMA[1].dstadd;
-                }
-            }
+            GBA_DMATransfer(&DMA[1]);
         }
     }
 
@@ -589,7 +667,7 @@ static s32 GBA_DMA1Update(s32 clocks)
     if (DMA[1].starttime != 3)
     {
         MessageBox(NULL, "DMA 1 enabled.", "EMULATION", MB_OK);
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
     }
     REG_DMA1CNT_H &= ~BIT(15);
     DMA[1].enabled = 0;
@@ -651,26 +729,7 @@ static s32 GBA_DMA2Update(s32 clocks)
 
         if (copy)
         {
-            if (DMA[2].copywords) // Copy words
-            {
-                for (int i = 0; i < DMA[2].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[2].dstaddr,
-                                      GBA_MemoryRead32(DMA[2].srcaddr));
-                    DMA[2].srcaddr += DMA[2].srcadd;
-                    DMA[2].dstaddr += DMA[2].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (int i = 0; i < DMA[2].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[2].dstaddr,
-                                      GBA_MemoryRead16(DMA[2].srcaddr));
-                    DMA[2].srcaddr += DMA[2].srcadd;
-                    DMA[2].dstaddr += DMA[2].dstadd;
-                }
-            }
+            GBA_DMATransfer(&DMA[2]);
         }
     }
 
@@ -717,7 +776,7 @@ static s32 GBA_DMA2Update(s32 clocks)
     if (DMA[2].starttime != 3)
     {
         MessageBox(NULL, "DMA 2 enabled.", "EMULATION", MB_OK);
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
     }
     REG_DMA2CNT_H &= ~BIT(15);
     DMA[2].enabled = 0;
@@ -735,7 +794,7 @@ static s32 GBA_DMA3Update(s32 clocks)
     if (DMA[3].starttime == START_SPECIAL)
     {
         Debug_DebugMsgArg("DMA3, MODE: START_SPECIAL -- NOT EMULATED");
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_DMA);
         DMA[3].enabled = 0;
         return 0x7FFFFFFF;
     }
@@ -789,26 +848,7 @@ static s32 GBA_DMA3Update(s32 clocks)
             //MessageBox(NULL, text, "EMULATION", MB_OK);
             //GBA_ExecutionBreak();
 
-            if (DMA[3].copywords) // Copy words
-            {
-                for (int i = 0; i < DMA[3].num_chunks; i++)
-                {
-                    GBA_MemoryWrite32(DMA[3].dstaddr,
-                                      GBA_MemoryRead32(DMA[3].srcaddr));
-                    DMA[3].srcaddr += DMA[3].srcadd;
-                    DMA[3].dstaddr += DMA[3].dstadd;
-                }
-            }
-            else // Copy halfwords
-            {
-                for (int i = 0; i < DMA[3].num_chunks; i++)
-                {
-                    GBA_MemoryWrite16(DMA[3].dstaddr,
-                                      GBA_MemoryRead16(DMA[3].srcaddr));
-                    DMA[3].srcaddr += DMA[3].srcadd;
-                    DMA[3].dstaddr += DMA[3].dstadd;
-                }
-            }
+            GBA_DMATransfer(&DMA[3]);
         }
     }
 
@@ -859,6 +899,14 @@ s32 GBA_DMAUpdate(s32 clocks)
     gba_dma_extra_clocks_elapsed = 0;
     gba_dmaworking = 0;
 
+    if (!(DMA[0].enabled || DMA[1].enabled || DMA[2].enabled
+          || DMA[3].enabled))
+    {
+        // Nothing to do until a channel is enabled again
+        GBA_SchedulerSetPolling(GBA_EVENT_DMA, 0);
+        return 0x7FFFFFFF;
+    }
+
     s32 tempclocks;
 
     if (DMA[0].enabled)
@@ -893,9 +941,20 @@ s32 GBA_DMAUpdate(s32 clocks)
             return tempclocks;
     }
 
+    // The channels that are still enabled are waiting for the H-Blank or the
+    // V-Blank, and they don't need any time to pass until then. The screen
+    // wakes this up when it changes mode, see GBA_DMAScreenModeChanged().
+    GBA_SchedulerSetPolling(GBA_EVENT_DMA, 0);
+
     return 0x7FFFFFFF;
 }
 
+void GBA_DMAScreenModeChanged(void)
+{
+    if (DMA[0].enabled || DMA[1].enabled || DMA[2].enabled || DMA[3].enabled)
+        GBA_SchedulerWake(GBA_EVENT_DMA);
+}
+
 int GBA_DMAisWorking(void)
 {
     return gba_dmaworking;
@@ -918,6 +977,33 @@ s32 GBA_DMAGetExtraClocksElapsed(void)
 
 //---------------------------------------------------------
 
+// Sends 4 words to the FIFO that is the destination of the DMA channel.
+static void GBA_DMASoundTransfer(_dma_channel_ *dma)
+{
+    _profile_section_e prev = Profile_Begin(PROFILE_DMA);
+
+    const u8 *src = NULL;
+    if (dma->srcadd == 4)
+        src = GBA_MemoryGetReadPointer(dma->srcaddr, 16);
+
+    if (src != NULL)
+    {
+        GBA_SoundFifoWrite(dma->dstaddr, src);
+        dma->srcaddr += 16;
+    }
+    else
+    {
+        // Copy words
+        for (int i = 0; i < 4; i++)
+        {
+            GBA_MemoryWrite32(dma->dstaddr, GBA_MemoryRead32(dma->srcaddr));
+            dma->srcaddr += dma->srcadd;
+        }
+    }
+
+    Profile_End(prev);
+}
+
 void GBA_DMASoundRequestData(int A, int B)
 {
     // This should check if another dma is running and return without copying
@@ -927,18 +1013,7 @@ void GBA_DMASoundRequestData(int A, int B)
         if ((A && (DMA[1].dstaddr == FIFO_A))
             || (B && (DMA[1].dstaddr == FIFO_B)))
         {
-            // Copy words
-            for (int i = 0; i < 4; i++)
-            {
-                //if (GBA_MemoryRead32(DMA[1].srcaddr) != 0)
-                //    Debug_DebugMsgArg("%08X",DMA[1].srcaddr);
-                //Debug_DebugMsgArg("[%08x]= %08X", DMA[1].srcaddr,
-                //                  GBA_MemoryRead32(DMA[1].srcaddr));
-                //Debug_DebugMsgArg("%08X", GBA_MemoryRead32(DMA[1].srcaddr));
-                GBA_MemoryWrite32(DMA[1].dstaddr,
-                                  GBA_MemoryRead32(DMA[1].srcaddr));
-                DMA[1].srcaddr += DMA[1].srcadd;
-            }
+            GBA_DMASoundTransfer(&DMA[1]);
             if (REG_DMA2CNT_H & BIT(14))
                 GBA_CallInterrupt(BIT(9));
         }
@@ -949,15 +1024,31 @@ void GBA_DMASoundRequestData(int A, int B)
         if ((A && (DMA[2].dstaddr == FIFO_A))
             || (B && (DMA[2].dstaddr == FIFO_B)))
         {
-            // Copy words
-            for (int i = 0; i < 4; i++)
-            {
-                GBA_MemoryWrite32(DMA[2].dstaddr,
-                                  GBA_MemoryRead32(DMA[2].srcaddr));
-                DMA[2].srcaddr += DMA[2].srcadd;
-            }
+            GBA_DMASoundTransfer(&DMA[2]);
             if (REG_DMA2CNT_H & BIT(14))
                 GBA_CallInterrupt(BIT(10));
         }
     }
 }
+
+//---------------------------------------------------------
+
+void GBA_DMAStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "DMA ");
+    SaveState_Write(st, DMA, sizeof(DMA));
+    SaveState_Write(st, &gba_dmaworking, sizeof(gba_dmaworking));
+    SaveState_Write(st, &gba_dma_extra_clocks_elapsed,
+                    sizeof(gba_dma_extra_clocks_elapsed));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_DMAStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "DMA ");
+    SaveState_Read(st, DMA, sizeof(DMA));
+    SaveState_Read(st, &gba_dmaworking, sizeof(gba_dmaworking));
+    SaveState_Read(st, &gba_dma_extra_clocks_elapsed,
+                   sizeof(gba_dma_extra_clocks_elapsed));
+    SaveState_ChunkClose(st);
+}
@@ -18,6 +18,9 @@ s32 GBA_DMAUpdate(s32 clocks);
 
 int GBA_DMAisWorking(void);
 
+// Called by the screen when it enters the H-Blank or the V-Blank
+void GBA_DMAScreenModeChanged(void);
+
 s32 GBA_DMAGetExtraClocksElapsed(void);
 
 int gba_dma3numchunks(void); // For EEPROM
@@ -25,4 +28,7 @@ int gba_dma3enabled(void);
 
 void GBA_DMASoundRequestData(int A, int B);
 
+void GBA_DMAStateSave(_savestate_t *st);
+void GBA_DMAStateLoad(_savestate_t *st);
+
 #endif // GBA_DMA__
@@ -8,28 +8,52 @@
 #include <stdlib.h>
 
 #include "../build_options.h"
+#include "../config.h"
 #include "../debug_utils.h"
 #include "../file_utils.h"
+#include "../opprofile_utils.h"
+#include "../pcprofile_utils.h"
 #include "../png_utils.h"
+#include "../profile_utils.h"
+#include "../savestate_utils.h"
+#include "../trace_utils.h"
 
 #include "bios.h"
+#include "cheats.h"
+#include "code_cache.h"
 #include "cpu.h"
+#include "disassembler.h"
 #include "dma.h"
 #include "gba.h"
+#include "gpio.h"
 #include "interrupts.h"
 #include "memory.h"
 #include "rom.h"
 #include "save.h"
+#include "scheduler.h"
+#include "sio.h"
 #include "sound.h"
 #include "timers.h"
 #include "video.h"
 
-static s32 clocks_to_next_event;
-static s32 lastresidualclocks = 0;
+static core_local__ s32 clocks_to_next_event;
+static core_local__ s32 lastresidualclocks = 0;
+// Reason of the end of the next slice if it reaches clocks_to_next_event. It is
+// only updated while the profiler is enabled.
+static core_local__ _profile_slice_e next_event_reason = PROFILE_SLICE_OTHER;
 
-static int inited = 0;
+static core_local__ int inited = 0;
 
-int GBA_ROM_SIZE;
+// Used to recover the previous state if a save state can't be loaded
+static core_local__ _savestate_t gba_state_backup;
+
+// State at the end of the first frame after the BIOS has jumped to the ROM, so
+// that resets don't have to show the logo of the BIOS again. Same as the boot
+// state of the GB core, it's discarded when the ROM is unloaded.
+static core_local__ _savestate_t gba_boot_state;
+static core_local__ int gba_boot_state_pending; // Waiting for the boot to end
+
+core_local__ int GBA_ROM_SIZE;
 int GBA_GetRomSize(void)
 {
     return GBA_ROM_SIZE;
@@ -40,7 +64,43 @@ _cpu_t *GBA_CPUGet(void)
     return &CPU;
 }
 
-int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize)
+// Clocks between samples of the PC profiler
+#define GBA_PCPROFILE_PERIOD    (1024)
+
+static core_local__ s32 gba_pcprofile_clocks;
+
+// Interrupts are only checked between slices of CPU execution, so an event of
+// the scheduler would change the emulation. Instead, the samples are taken at
+// the end of the slices, with the clocks executed since the previous sample.
+static void GBA_PCProfileUpdate(s32 clocks)
+{
+    gba_pcprofile_clocks += clocks;
+    if (gba_pcprofile_clocks < GBA_PCPROFILE_PERIOD)
+        return;
+
+    PCProfile_Sample(CPU.R[R_PC], gba_pcprofile_clocks / GBA_PCPROFILE_PERIOD);
+    gba_pcprofile_clocks %= GBA_PCPROFILE_PERIOD;
+}
+
+void GBA_PCProfileSetEnabled(int enable)
+{
+    gba_pcprofile_clocks = 0;
+
+    if (enable)
+        PCProfile_Start(PCPROFILE_GBA);
+    else
+        PCProfile_Stop();
+
+#ifdef ENABLE_OPCODE_PROFILE
+    if (enable)
+        OPProfile_Start();
+    else
+        OPProfile_Stop();
+#endif
+}
+
+static int GBA_InitRomBuffer(void *bios_ptr, void *rom_ptr, u32 romsize,
+                             int rom_in_place)
 {
     if (inited)
         GBA_EndRom(1); // Shouldn't be needed here
@@ -58,26 +118,46 @@ int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize)
         GBA_ROM_SIZE = romsize;
     }
 
-    GBA_DetectSaveType(rom_ptr, romsize);
+    GBA_DetectSaveType(rom_ptr, GBA_ROM_SIZE);
     GBA_ResetSaveBuffer();
     GBA_SaveReadFile();
 
     GBA_HeaderCheck(rom_ptr);
 
+    // The scheduler has to be ready before any subsystem is initialized, they
+    // may need to change their polling state.
+    GBA_SchedulerInit();
+    GBA_SchedulerRegister(GBA_EVENT_SCREEN, GBA_UpdateScreenTimings);
+    GBA_SchedulerRegister(GBA_EVENT_DMA, GBA_DMAUpdate);
+    GBA_SchedulerRegister(GBA_EVENT_TIMERS, GBA_TimersUpdate);
+    GBA_SchedulerRegister(GBA_EVENT_SOUND, GBA_SoundUpdate);
+    GBA_SchedulerRegister(GBA_EVENT_SIO, GBA_SIOUpdate);
+
+    // Before the memory, the GPIO port changes how the ROM is mapped
+    GBA_GPIOInit(rom_ptr);
     GBA_CPUInit();
     GBA_InterruptInit();
     GBA_TimerInitAll();
-    GBA_MemoryInit(bios_ptr, rom_ptr, GBA_ROM_SIZE);
+    GBA_MemoryInit(bios_ptr, rom_ptr, GBA_ROM_SIZE, rom_in_place);
+    GBA_CodeCacheInit();
     GBA_UpdateDrawScanlineFn();
     GBA_DMA0Setup();
     GBA_DMA1Setup();
     GBA_DMA2Setup();
     GBA_DMA3Setup();
     GBA_SoundInit();
-    GBA_FillFadeTables();
+    GBA_VideoInit();
+    GBA_SIOInit();
 
     GBA_SkipFrame(0);
 
+    // Without the boot the first frame is already past it, but that isn't the
+    // state a reset would leave the console in. The boot of the BIOS of the
+    // emulator is short, there is nothing to gain with it.
+    gba_boot_state_pending = EmulatorConfig.boot_state_cache
+                             && EmulatorConfig.load_from_boot_rom
+                             && GBA_BiosIsLoaded();
+
     clocks_to_next_event = 1;
     lastresidualclocks = 0;
 
@@ -89,6 +169,16 @@ int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize)
     return 1;
 }
 
+int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize)
+{
+    return GBA_InitRomBuffer(bios_ptr, rom_ptr, romsize, 0);
+}
+
+int GBA_InitRomInPlace(void *bios_ptr, void *rom_ptr, u32 romsize)
+{
+    return GBA_InitRomBuffer(bios_ptr, rom_ptr, romsize, 1);
+}
+
 int GBA_EndRom(int save)
 {
     if (inited == 0)
@@ -96,19 +186,72 @@ int GBA_EndRom(int save)
 
     if (save)
         GBA_SaveWriteFile();
+    GBA_SaveEnd();
 
+    GBA_SIOEnd();
+    GBA_CheatsReset();
+    GBA_CodeCacheEnd();
     GBA_MemoryEnd();
 
+    SaveState_Free(&gba_state_backup);
+
+    SaveState_Free(&gba_boot_state);
+    gba_boot_state_pending = 0;
+
     inited = 0;
 
     return 1;
 }
 
+static void GBA_BootStateReset(void)
+{
+    gba_boot_state_pending = 0;
+
+    if ((EmulatorConfig.boot_state_cache == 0) || (GBA_BiosIsLoaded() == 0))
+        return;
+
+    if (gba_boot_state.data == NULL)
+    {
+        gba_boot_state_pending = 1;
+        return;
+    }
+
+    // The save memory has to survive the reset, the boot state has the data it
+    // had when the ROM was loaded.
+    _savestate_t save;
+    SaveState_Init(&save);
+
+    SaveState_Begin(&save, SAVESTATE_SYSTEM_GBA, 0);
+    GBA_SaveMemoryStateSave(&save);
+
+    // If it can't be loaded the BIOS does the boot like without the boot state
+    if ((save.error == 0) && (GBA_StateLoad(&gba_boot_state) == 0))
+    {
+        SaveState_Open(&save, SAVESTATE_SYSTEM_GBA, 0);
+        GBA_SaveMemoryStateLoad(&save);
+    }
+
+    SaveState_Free(&save);
+}
+
+static void GBA_BootStateCheck(void)
+{
+    // Frames that end with the CPU in the BIOS are still part of the boot
+    if (CPU.R[R_PC] < 0x02000000)
+        return;
+
+    gba_boot_state_pending = 0;
+
+    if (GBA_StateSave(&gba_boot_state) != 0)
+        SaveState_Free(&gba_boot_state);
+}
+
 void GBA_Reset(void)
 {
     GBA_CPUClearHalted();
     GBA_Swi(0x26);
-    // Enough for now
+
+    GBA_BootStateReset();
 }
 
 void GBA_HandleInput(int a, int b, int l, int r, int st, int se,
@@ -140,21 +283,158 @@ void GBA_HandleInput(int a, int b, int l, int r, int st, int se,
     REG_KEYINPUT = input;
 }
 
+static core_local__ gba_input_latch_fn_ptr gba_input_latch_fn;
+
+void GBA_InputLatchSet(gba_input_latch_fn_ptr fn)
+{
+    gba_input_latch_fn = fn;
+}
+
+void GBA_InputLatch(void)
+{
+    gba_input_latch_fn_ptr fn = gba_input_latch_fn;
+    if (fn == NULL)
+        return;
+
+    gba_input_latch_fn = NULL;
+    fn();
+}
+
 void GBA_Screenshot(void)
 {
     char *name = FU_GetNewTimestampFilename("gba_screenshot");
-    u32 *buffer = malloc(240 * 160 * 4);
+
+    // The image is encoded and written by a background thread
+    u32 *buffer = PNG_SaveBegin(name, 240, 160, 0);
+    if (buffer == NULL)
+        return;
+
     GBA_ConvertScreenBufferTo32RGB(buffer);
-    Save_PNG(name, 240, 160, buffer, 0);
-    free(buffer);
+    PNG_SaveCommit();
+}
+
+//------------------------------------------------------------------------------
+
+static u32 GBA_StateRomID(void)
+{
+    // The header of the ROM has the title, game code and checksum
+    return SaveState_Hash(Mem.rom_wait0, 0xC0);
+}
+
+static void GBA_StateWrite(_savestate_t *st)
+{
+    SaveState_Begin(st, SAVESTATE_SYSTEM_GBA, GBA_StateRomID());
+
+    SaveState_ChunkBegin(st, "GBA ");
+    SaveState_Write(st, &clocks_to_next_event, sizeof(clocks_to_next_event));
+    SaveState_Write(st, &lastresidualclocks, sizeof(lastresidualclocks));
+    SaveState_ChunkEnd(st);
+
+    GBA_SchedulerStateSave(st);
+    GBA_CPUStateSave(st);
+    GBA_InterruptStateSave(st);
+    GBA_TimersStateSave(st);
+    GBA_SaveMemoryStateSave(st);
+    GBA_GPIOStateSave(st);
+    GBA_MemoryStateSave(st);
+    GBA_DMAStateSave(st);
+    GBA_SoundStateSave(st);
+    GBA_VideoStateSave(st);
+    GBA_SIOStateSave(st);
+}
+
+static void GBA_StateRead(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "GBA ");
+    SaveState_Read(st, &clocks_to_next_event, sizeof(clocks_to_next_event));
+    SaveState_Read(st, &lastresidualclocks, sizeof(lastresidualclocks));
+    SaveState_ChunkClose(st);
+
+    GBA_SchedulerStateLoad(st);
+    GBA_CPUStateLoad(st);
+    GBA_InterruptStateLoad(st);
+    GBA_TimersStateLoad(st);
+    GBA_SaveMemoryStateLoad(st);
+    GBA_GPIOStateLoad(st); // Before the memory, it changes the map of the ROM
+    GBA_MemoryStateLoad(st);
+    GBA_DMAStateLoad(st);
+    GBA_SoundStateLoad(st);
+    GBA_VideoStateLoad(st);
+    GBA_SIOStateLoad(st);
+
+    GBA_CodeCacheFlush();
+}
+
+int GBA_StateSave(_savestate_t *st)
+{
+    if (inited == 0)
+        return 1;
+
+    GBA_StateWrite(st);
+
+    return st->error;
+}
+
+int GBA_StateLoad(_savestate_t *st)
+{
+    if (inited == 0)
+        return 1;
+
+    if (SaveState_Open(st, SAVESTATE_SYSTEM_GBA, GBA_StateRomID()) != 0)
+        return 1;
+
+    // If the state is valid but any chunk is wrong, the state of the emulator
+    // would be left half loaded. Keep a copy to restore it in that case.
+    GBA_StateWrite(&gba_state_backup);
+    if (gba_state_backup.error)
+        return 1;
+
+    GBA_StateRead(st);
+
+    if (st->error)
+    {
+        SaveState_Open(&gba_state_backup, SAVESTATE_SYSTEM_GBA,
+                       GBA_StateRomID());
+        GBA_StateRead(&gba_state_backup);
+        return 1;
+    }
+
+    return 0;
+}
+
+void GBA_QuickStateSave(void)
+{
+    char path[MAX_PATHLEN];
+    GBA_SaveGetStateFilename(path, sizeof(path));
+
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    if ((GBA_StateSave(&st) != 0) || (SaveState_FileSave(&st, path) != 0))
+        Debug_ErrorMsgArg("Couldn't save state to %s", path);
+
+    SaveState_Free(&st);
 }
 
-static s32 min(s32 a, s32 b)
+void GBA_QuickStateLoad(void)
 {
-    return ((a < b) ? a : b);
+    char path[MAX_PATHLEN];
+    GBA_SaveGetStateFilename(path, sizeof(path));
+
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    if (SaveState_FileLoad(&st, path) != 0)
+        Debug_ErrorMsgArg("Couldn't open %s", path);
+    else if (GBA_StateLoad(&st) != 0)
+        Debug_ErrorMsgArg("%s isn't a valid state for this game", path);
+
+    SaveState_Free(&st);
 }
 
-int gba_execution_break = 0;
+//------------------------------------------------------------------------------
+
+core_local__ int gba_execution_break = 0;
 
 void GBA_RunFor_ExecutionBreak(void)
 {
@@ -163,11 +443,20 @@ void GBA_RunFor_ExecutionBreak(void)
 
 void GBA_RunForOneFrame(void)
 {
+    GBA_CheatsApply();
     GBA_CheckKeypadInterrupt();
     GBA_RunFor(280896); // Clocksperframe = 280896
+    GBA_SoundFrameEnd();
+
+    if (gba_boot_state_pending)
+        GBA_BootStateCheck();
+
+#ifdef ENABLE_OPCODE_PROFILE
+    OPProfile_FrameEnd();
+#endif
 }
 
-u32 GBA_RunFor(s32 totalclocks)
+static u32 GBA_RunForClocks(s32 totalclocks)
 {
     s32 residualclocks, executedclocks;
     totalclocks += lastresidualclocks;
@@ -175,37 +464,48 @@ u32 GBA_RunFor(s32 totalclocks)
 
     while (totalclocks >= clocks_to_next_event)
     {
+        _profile_slice_e reason = next_event_reason;
+
         if (GBA_DMAisWorking())
         {
             executedclocks = GBA_DMAGetExtraClocksElapsed()
                              + clocks_to_next_event;
+            reason = PROFILE_SLICE_DMA;
         }
         else
         {
             if (GBA_InterruptCheck())
             {
                 // 2S + 1N cycles ?
-                executedclocks = GBA_MemoryGetAccessCycles(0, 1, CPU.OldPC)
+                executedclocks = GBA_MemoryGetFetchCycles(0, 1, CPU.OldPC)
                                  + GBA_MemoryGetAccessCyclesNoSeq(1, CPU.R[R_PC])
                                  + GBA_MemoryGetAccessCyclesSeq(1, CPU.R[R_PC]);
+                reason = PROFILE_SLICE_IRQ;
             }
             else
             {
                 residualclocks = GBA_Execute(clocks_to_next_event);
                 executedclocks = clocks_to_next_event - residualclocks;
+                if (residualclocks > 0) // The CPU loop has been stopped
+                    reason = GBA_ExecutionBreakReason();
             }
 
             has_executed = executedclocks && !GBA_CPUGetHalted();
         }
 
-        clocks_to_next_event = GBA_UpdateScreenTimings(executedclocks);
-        int tmp = GBA_DMAUpdate(executedclocks);
-        clocks_to_next_event = min(tmp, clocks_to_next_event);
-        tmp = GBA_TimersUpdate(executedclocks);
-        clocks_to_next_event = min(tmp, clocks_to_next_event);
-        tmp = GBA_SoundUpdate(executedclocks);
-        clocks_to_next_event = min(tmp, clocks_to_next_event);
-        // Check if any other event is going to happen before
+        clocks_to_next_event = GBA_SchedulerUpdate(executedclocks);
+
+        if (profile_enabled)
+        {
+            Profile_SliceEnd(reason, executedclocks);
+            next_event_reason = GBA_SchedulerGetNextEventReason();
+        }
+
+        if (pcprofile_enabled)
+            GBA_PCProfileUpdate(executedclocks);
+
+        if (trace_enabled)
+            GBA_TraceClocksAdd(executedclocks);
 
         totalclocks -= executedclocks;
 
@@ -219,37 +519,48 @@ u32 GBA_RunFor(s32 totalclocks)
 
     while (totalclocks > 0)
     {
+        _profile_slice_e reason = PROFILE_SLICE_OTHER;
+
         if (GBA_DMAisWorking())
         {
             executedclocks = GBA_DMAGetExtraClocksElapsed()
                              + clocks_to_next_event;
+            reason = PROFILE_SLICE_DMA;
         }
         else
         {
             if (GBA_InterruptCheck())
             {
                 // 2S + 1N cycles ?
-                executedclocks = GBA_MemoryGetAccessCycles(0, 1, CPU.OldPC)
+                executedclocks = GBA_MemoryGetFetchCycles(0, 1, CPU.OldPC)
                                  + GBA_MemoryGetAccessCyclesNoSeq(1, CPU.R[R_PC])
                                  + GBA_MemoryGetAccessCyclesSeq(1, CPU.R[R_PC]);
+                reason = PROFILE_SLICE_IRQ;
             }
             else
             {
                 residualclocks = GBA_Execute(totalclocks);
                 executedclocks = totalclocks - residualclocks;
+                if (residualclocks > 0) // The CPU loop has been stopped
+                    reason = GBA_ExecutionBreakReason();
             }
 
             has_executed = executedclocks && !GBA_CPUGetHalted();
         }
 
-        clocks_to_next_event = GBA_UpdateScreenTimings(executedclocks);
-        clocks_to_next_event = min(GBA_DMAUpdate(executedclocks),
-                                   clocks_to_next_event);
-        clocks_to_next_event = min(GBA_TimersUpdate(executedclocks),
-                                   clocks_to_next_event);
-        clocks_to_next_event = min(GBA_SoundUpdate(executedclocks),
-                                   clocks_to_next_event);
-        // Check if other events are going to happen earlier
+        clocks_to_next_event = GBA_SchedulerUpdate(executedclocks);
+
+        if (profile_enabled)
+        {
+            Profile_SliceEnd(reason, executedclocks);
+            next_event_reason = GBA_SchedulerGetNextEventReason();
+        }
+
+        if (pcprofile_enabled)
+            GBA_PCProfileUpdate(executedclocks);
+
+        if (trace_enabled)
+            GBA_TraceClocksAdd(executedclocks);
 
         totalclocks -= executedclocks;
 
@@ -266,6 +577,15 @@ u32 GBA_RunFor(s32 totalclocks)
     return has_executed;
 }
 
+u32 GBA_RunFor(s32 totalclocks)
+{
+    GBA_DebugWatchpointsArm(1);
+    u32 ret = GBA_RunForClocks(totalclocks);
+    GBA_DebugWatchpointsArm(0);
+
+    return ret;
+}
+
 void GBA_DebugStep(void)
 {
     // Hack to make it always execute ONLY one instruction
@@ -8,6 +8,7 @@
 #define GBA__
 
 #include "../general_utils.h"
+#include "../savestate_utils.h"
 
 //------------------------------------------------------------------------------
 
@@ -64,6 +65,12 @@ typedef enum
 #define F_STATE    BIT(5) // (0=ARM, 1=THUMB) - Do not change manually!
 #define F_T        BIT(5)
 
+typedef struct
+{
+    u32 R13, R14;
+    u32 SPSR;
+} _cpu_bank_t;
+
 typedef struct
 {
     u32 R[16]; // 0-15
@@ -74,22 +81,12 @@ typedef struct
 
     //-----------------------------------
 
-    u32 R_user[7]; // 8-14
-
-    u32 R_fiq[7]; // 8-14
-    u32 SPSR_fiq; // FIQ
-
-    u32 R13_svc, R14_svc; // Supervisor
-    u32 SPSR_svc;
-
-    u32 R13_abt, R14_abt; // Abort
-    u32 SPSR_abt;
-
-    u32 R13_irq, R14_irq; // IRQ
-    u32 SPSR_irq;
-
-    u32 R13_und, R14_und; // Undefined
-    u32 SPSR_und;
+    // Registers of the modes that aren't active. R8-R12 are only banked in FIQ
+    // mode, the other modes share the ones of user mode. System mode uses the
+    // bank of user mode (its SPSR and the entry of system mode aren't used).
+    u32 R_user[5]; // 8-12
+    u32 R_fiq[5]; // 8-12
+    _cpu_bank_t bank[CPU_MODE_NUMBER];
 
     _cpu_mode_e MODE;
     _exec_mode_e EXECUTION_MODE;
@@ -147,6 +144,13 @@ typedef struct
 int GBA_GetRomSize(void);
 
 int GBA_InitRom(void *bios_ptr, void *rom_ptr, u32 romsize);
+// Same as GBA_InitRom(), but the ROM is used from the buffer instead of being
+// copied. The buffer has to be GBA_ROM_BUFFER_SIZE bytes long with zeroes after
+// the end of the ROM. It's only modified by ROM patch cheats, after calling
+// LargeMakeWritable() on it, so it can be a read-only buffer returned by
+// FileMap(). It has to be valid until GBA_EndRom() is called.
+#define GBA_ROM_BUFFER_SIZE (0x02000000) // 32 MiB
+int GBA_InitRomInPlace(void *bios_ptr, void *rom_ptr, u32 romsize);
 int GBA_EndRom(int save);
 void GBA_Reset(void);
 
@@ -154,14 +158,33 @@ _cpu_t *GBA_CPUGet(void); // For the disassembler
 
 void GBA_Screenshot(void);
 
+// Save states of the whole emulated machine. They return 0 on success. The
+// state can only be loaded while the same ROM is running.
+int GBA_StateSave(_savestate_t *st);
+int GBA_StateLoad(_savestate_t *st);
+// Save and load the state from the file that goes with the save file
+void GBA_QuickStateSave(void);
+void GBA_QuickStateLoad(void);
+
 void GBA_RunForOneFrame(void);
 void GBA_RunFor_ExecutionBreak(void);
 
 void GBA_HandleInput(int a, int b, int l, int r, int st, int se,
                      int dr, int dl, int du, int dd);
 
+// Late latch of the input. If a function is set, it is called the first time
+// that the game reads KEYINPUT after setting it, and then it's cleared. It's
+// meant to call GBA_HandleInput() with the state of the keys at that moment,
+// instead of the one at the start of the frame.
+typedef void (*gba_input_latch_fn_ptr)(void);
+void GBA_InputLatchSet(gba_input_latch_fn_ptr fn);
+void GBA_InputLatch(void); // Called by the memory handlers
+
 u32 GBA_RunFor(s32 totalclocks);
 
 void GBA_DebugStep(void);
 
+// Starts or stops the PC profiler (see pcprofile_utils.h)
+void GBA_PCProfileSetEnabled(int enable);
+
 #endif // GBA__
@@ -245,76 +245,81 @@ void GBA_Debug_PrintSpritesPage(int page, int buf_has_alpha_channel,
 
 //----------------------------------------------------------------
 
-void GBA_Debug_PrintTiles(char *buffer, int bufw, unused__ int bufh, int cbb,
-                          int colors, int palette)
+void GBA_Debug_PrintTile(char *buffer, int bufw, int cbb, int colors,
+                         int palette, int tile)
 {
     u8 *charbaseblockptr = (u8 *)&Mem.vram[cbb - 0x06000000];
 
-    for (int i = 0; i < 256; i++)
+    int x = (tile & 31) * 8;
+    int y = ((tile >> 5) & 31) * 8;
+
+    // The last character base block only has room for half of the tiles
+    int tiles_max = (colors == 256) ? 512 : 1024;
+    if (cbb == 0x06014000)
+        tiles_max /= 2;
+
+    if ((tile & 0x3FF) >= tiles_max)
     {
-        for (int j = 0; j < 256; j++)
+        for (int j = y; j < y + 8; j++)
         {
-            int index = (j * bufw + i) * 3;
-            buffer[index + 0] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
-            buffer[index + 1] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
-            buffer[index + 2] = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
+            for (int i = x; i < x + 8; i++)
+            {
+                int index = (j * bufw + i) * 3;
+
+                if (((i ^ j) & 7) == 0)
+                {
+                    buffer[index + 0] = 255;
+                    buffer[index + 1] = 0;
+                    buffer[index + 2] = 0;
+                }
+                else
+                {
+                    u8 color = ((i & 16) ^ (j & 16)) ? 0x80 : 0xB0;
+                    buffer[index + 0] = color;
+                    buffer[index + 1] = color;
+                    buffer[index + 2] = color;
+                }
+            }
         }
+
+        return;
     }
 
     if (colors == 256) // 256 Colors
     {
-        int jmax = (cbb == 0x06014000) ? 64 : 128; // Half size
+        u8 *dataptr = (u8 *)&(charbaseblockptr[(tile & 0x3FF) * 64]);
 
         // If cbb >= 0x06010000 --> sprite
         u32 pal = (cbb >= 0x06010000) ? 256 : 0;
 
-        for (int i = 0; i < 256; i++)
+        for (int j = 0; j < 8; j++)
         {
-            for (int j = 0; j < jmax; j++)
+            for (int i = 0; i < 8; i++)
             {
-                u32 Index = (i / 8) + (j / 8) * 32;
-                u8 *dataptr = (u8 *)&(charbaseblockptr[(Index & 0x3FF) * 64]);
-
-                int data = dataptr[(i & 7) + ((j & 7) * 8)];
+                int data = dataptr[i + (j * 8)];
 
                 u32 color = rgb16to32(((u16 *)Mem.pal_ram)[data + pal]);
 
-                int index = (j * bufw + i) * 3;
+                int index = ((y + j) * bufw + (x + i)) * 3;
                 buffer[index + 0] = color & 0xFF;
                 buffer[index + 1] = (color >> 8) & 0xFF;
                 buffer[index + 2] = (color >> 16) & 0xFF;
             }
         }
-        for (int i = 0; i < 256; i++)
-        {
-            for (int j = jmax; j < 256; j++)
-            {
-                if (((i ^ j) & 7) == 0)
-                {
-                    int index = (j * bufw + i) * 3;
-                    buffer[index + 0] = 255;
-                    buffer[index + 1] = 0;
-                    buffer[index + 2] = 0;
-                }
-            }
-        }
     }
     else if (colors == 16) // 16 colors
     {
-        int jmax = (cbb == 0x06014000) ? 128 : 256; // Half size
+        u8 *dataptr = (u8 *)&(charbaseblockptr[(tile & 0x3FF) * 32]);
 
         // If cbb >= 0x06010000 --> sprite
         u32 pal = (cbb >= 0x06010000) ? (palette + 16) : palette;
         u16 *palptr = (u16 *)&Mem.pal_ram[pal * 2 * 16];
 
-        for (int i = 0; i < 256; i++)
+        for (int j = 0; j < 8; j++)
         {
-            for (int j = 0; j < jmax; j++)
+            for (int i = 0; i < 8; i++)
             {
-                u32 Index = (i / 8) + (j / 8) * 32;
-                u8 *dataptr = (u8 *)&(charbaseblockptr[(Index & 0x3FF) * 32]);
-
-                int data = dataptr[((i & 7) + ((j & 7) * 8)) / 2];
+                int data = dataptr[(i + (j * 8)) / 2];
 
                 if (i & 1)
                     data = data >> 4;
@@ -323,29 +328,22 @@ void GBA_Debug_PrintTiles(char *buffer, int bufw, unused__ int bufh, int cbb,
 
                 u32 color = rgb16to32(palptr[data]);
 
-                int index = (j * bufw + i) * 3;
+                int index = ((y + j) * bufw + (x + i)) * 3;
                 buffer[index + 0] = color & 0xFF;
                 buffer[index + 1] = (color >> 8) & 0xFF;
                 buffer[index + 2] = (color >> 16) & 0xFF;
             }
         }
-
-        for (int i = 0; i < 256; i++)
-        {
-            for (int j = jmax; j < 256; j++)
-            {
-                if (((i ^ j) & 7) == 0)
-                {
-                    int index = (j * bufw + i) * 3;
-                    buffer[index + 0] = 255;
-                    buffer[index + 1] = 0;
-                    buffer[index + 2] = 0;
-                }
-            }
-        }
     }
 }
 
+void GBA_Debug_PrintTiles(char *buffer, int bufw, unused__ int bufh, int cbb,
+                          int colors, int palette)
+{
+    for (int tile = 0; tile < 1024; tile++)
+        GBA_Debug_PrintTile(buffer, bufw, cbb, colors, palette, tile);
+}
+
 void GBA_Debug_PrintTilesAlpha(char *buffer, int bufw, int bufh, int cbb,
                                int colors, int palette)
 {
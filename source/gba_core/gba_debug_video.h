@@ -19,6 +19,10 @@ void GBA_Debug_PrintSpritesPage(int page, int buf_has_alpha_channel,
 
 void GBA_Debug_PrintTiles(char *buffer, int bufw, int bufh, int cbb,
                           int colors, int palette);
+// Prints only one of the tiles printed by GBA_Debug_PrintTiles(), at the same
+// position of the buffer.
+void GBA_Debug_PrintTile(char *buffer, int bufw, int cbb, int colors,
+                         int palette, int tile);
 void GBA_Debug_PrintTilesAlpha(char *buffer, int bufw, int bufh, int cbb,
                                int colors, int palette);
 
@@ -0,0 +1,502 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <string.h>
+#include <time.h>
+
+#include "../build_options.h"
+#include "../debug_utils.h"
+#include "../general_utils.h"
+
+#include "gba.h"
+#include "gpio.h"
+#include "scheduler.h"
+
+#define GPIO_REG_DATA           (0xC4)
+#define GPIO_REG_DIRECTION      (0xC6)
+#define GPIO_REG_CONTROL        (0xC8)
+
+#define GPIO_PIN_SCK            BIT(0) // Clock of the RTC and solar sensor
+#define GPIO_PIN_SIO            BIT(1) // Data of the RTC, reset of the sensor
+#define GPIO_PIN_CS             BIT(2) // RTC selected if high, sensor if low
+#define GPIO_PIN_3              BIT(3) // Flag of the sensor, rumble
+
+#define GPIO_DEVICE_RTC         BIT(0)
+#define GPIO_DEVICE_SOLAR       BIT(1)
+#define GPIO_DEVICE_RUMBLE      BIT(2)
+
+// Commands of the RTC. The bits of all bytes are sent starting by the least
+// significant one. Bits 0-3 of the command byte are always 0110b, bits 4-6 are
+// the command and bit 7 is set to read the registers.
+#define RTC_CMD_RESET           (0)
+#define RTC_CMD_DATETIME        (2)
+#define RTC_CMD_IRQ             (3)
+#define RTC_CMD_CONTROL         (4)
+#define RTC_CMD_TIME            (6)
+
+#define RTC_CMD_MAGIC           (0x6)
+#define RTC_CMD_READ            BIT(7)
+
+#define RTC_CONTROL_24H         BIT(6)
+#define RTC_CONTROL_MASK        (0x6A) // Bit 7 is the power failure flag
+
+// Bytes of data that go after each command
+static const u8 gba_rtc_command_length[8] = { 0, 0, 7, 0, 1, 0, 3, 0 };
+
+#define GBA_CLOCKS_PER_SECOND   (16 * 1024 * 1024)
+
+// Seconds between 1970-01-01 (UNIX epoch) and 2000-01-01 (epoch of the RTC)
+#define RTC_SECONDS_2000        (946684800)
+
+typedef struct
+{
+    // The time of the RTC is rtc_seconds at the time rtc_clocks of the
+    // scheduler. Seconds are counted since the UNIX epoch, but in local time.
+    s64 rtc_seconds;
+    s64 rtc_clocks;
+
+    u8 data; // Last value written by the GBA
+    u8 direction; // 1 = Output of the GBA, 0 = Output of the cartridge
+    u8 control;
+    u8 pins; // Last value of the outputs of the GBA
+    u8 device_data; // Value of the outputs of the cartridge
+
+    u8 rtc_command; // 0 if no command has been received yet
+    u8 rtc_byte;
+    u8 rtc_bits; // Bits of rtc_byte transferred
+    u8 rtc_index; // Bytes of data of the command transferred
+    u8 rtc_buffer[7];
+    u8 rtc_control;
+    u8 rtc_weekday_offset; // Added to the weekday calculated from the date
+
+    u8 solar_counter;
+
+    u8 padding[5];
+} _gba_gpio_t;
+
+static core_local__ _gba_gpio_t GPIO;
+
+static core_local__ u32 gba_gpio_devices;
+
+static core_local__ int gba_solar_level;
+
+static core_local__ u64 gba_rtc_fixed_time; // 0 = Use the clock of the host
+
+typedef struct
+{
+    char code[3]; // First 3 characters of the game code, without the region
+    u32 devices;
+} _gba_gpio_game_t;
+
+static const _gba_gpio_game_t gba_gpio_games[] = {
+    { "AXV", GPIO_DEVICE_RTC }, // Pokemon Ruby
+    { "AXP", GPIO_DEVICE_RTC }, // Pokemon Sapphire
+    { "BPE", GPIO_DEVICE_RTC }, // Pokemon Emerald
+    { "BKA", GPIO_DEVICE_RTC }, // Sennen Kazoku
+    { "BR4", GPIO_DEVICE_RTC }, // Rockman EXE 4.5
+    { "U3I", GPIO_DEVICE_RTC | GPIO_DEVICE_SOLAR }, // Boktai
+    { "U32", GPIO_DEVICE_RTC | GPIO_DEVICE_SOLAR }, // Boktai 2
+    { "U33", GPIO_DEVICE_RTC | GPIO_DEVICE_SOLAR }, // Boktai 3
+    { "V49", GPIO_DEVICE_RUMBLE }, // Drill Dozer
+    { "RZW", GPIO_DEVICE_RUMBLE }, // WarioWare Twisted
+};
+
+//------------------------------------------------------------------------------
+
+// Days since 1970-01-01 of a date of the proleptic Gregorian calendar
+static s64 GBA_RTCDaysFromDate(s64 year, u32 month, u32 day)
+{
+    year -= (month <= 2);
+    s64 era = ((year >= 0) ? year : (year - 399)) / 400;
+    u32 year_of_era = (u32)(year - (era * 400));
+    u32 day_of_year = ((153 * ((month > 2) ? (month - 3) : (month + 9)) + 2)
+                       / 5) + day - 1;
+    u32 day_of_era = (year_of_era * 365) + (year_of_era / 4)
+                     - (year_of_era / 100) + day_of_year;
+    return (era * 146097) + day_of_era - 719468;
+}
+
+static void GBA_RTCDateFromDays(s64 days, s64 *year, u32 *month, u32 *day)
+{
+    days += 719468;
+    s64 era = ((days >= 0) ? days : (days - 146096)) / 146097;
+    u32 day_of_era = (u32)(days - (era * 146097));
+    u32 year_of_era = (day_of_era - (day_of_era / 1460)
+                       + (day_of_era / 36524) - (day_of_era / 146096)) / 365;
+    u32 day_of_year = day_of_era - ((365 * year_of_era) + (year_of_era / 4)
+                                    - (year_of_era / 100));
+    u32 mp = ((5 * day_of_year) + 2) / 153;
+
+    *day = day_of_year - (((153 * mp) + 2) / 5) + 1;
+    *month = (mp < 10) ? (mp + 3) : (mp - 9);
+    *year = year_of_era + (era * 400) + (*month <= 2);
+}
+
+static u8 GBA_RTCToBCD(u32 value)
+{
+    return ((value / 10) << 4) | (value % 10);
+}
+
+static u32 GBA_RTCFromBCD(u8 value)
+{
+    return ((value >> 4) * 10) + (value & 0xF);
+}
+
+static s64 GBA_RTCHostTime(void)
+{
+    if (gba_rtc_fixed_time != 0)
+        return gba_rtc_fixed_time;
+
+    // The RTC has no time zones, it has to show the local time
+    time_t t = time(NULL);
+    struct tm *date = localtime(&t);
+    if (date == NULL)
+        return t;
+
+    s64 days = GBA_RTCDaysFromDate(date->tm_year + 1900, date->tm_mon + 1,
+                                   date->tm_mday);
+
+    return (days * 86400) + (date->tm_hour * 3600) + (date->tm_min * 60)
+           + date->tm_sec;
+}
+
+// The time is only calculated when the game reads it
+static s64 GBA_RTCTime(void)
+{
+    s64 clocks = GBA_SchedulerGetTime() - GPIO.rtc_clocks;
+    return GPIO.rtc_seconds + (clocks / GBA_CLOCKS_PER_SECOND);
+}
+
+static void GBA_RTCTimeSet(s64 seconds)
+{
+    GPIO.rtc_seconds = seconds;
+    GPIO.rtc_clocks = GBA_SchedulerGetTime();
+}
+
+static u32 GBA_RTCWeekday(s64 days)
+{
+    // 1970-01-01 was a thursday, weekday 4 if sunday is 0
+    return (u32)((days + 4 + GPIO.rtc_weekday_offset) % 7);
+}
+
+// Fills the buffer with the 7 bytes of the date and time registers
+static void GBA_RTCRegistersGet(u8 *buffer)
+{
+    s64 seconds = GBA_RTCTime();
+    if (seconds < RTC_SECONDS_2000)
+        seconds = RTC_SECONDS_2000;
+
+    s64 days = seconds / 86400;
+    u32 time = seconds % 86400;
+
+    s64 year;
+    u32 month, day;
+    GBA_RTCDateFromDays(days, &year, &month, &day);
+
+    u32 hour = time / 3600;
+    u32 hour_12 = (GPIO.rtc_control & RTC_CONTROL_24H) ? hour : (hour % 12);
+
+    buffer[0] = GBA_RTCToBCD(year % 100);
+    buffer[1] = GBA_RTCToBCD(month);
+    buffer[2] = GBA_RTCToBCD(day);
+    buffer[3] = GBA_RTCWeekday(days);
+    buffer[4] = GBA_RTCToBCD(hour_12) | ((hour >= 12) ? BIT(7) : 0);
+    buffer[5] = GBA_RTCToBCD((time / 60) % 60);
+    buffer[6] = GBA_RTCToBCD(time % 60);
+}
+
+// Sets the time from the 7 bytes of the date and time registers
+static void GBA_RTCRegistersSet(const u8 *buffer)
+{
+    u32 year = GBA_RTCFromBCD(buffer[0]) % 100;
+    u32 month = GBA_RTCFromBCD(buffer[1] & 0x1F);
+    u32 day = GBA_RTCFromBCD(buffer[2] & 0x3F);
+    u32 weekday = buffer[3] & 7;
+    u32 hour = GBA_RTCFromBCD(buffer[4] & 0x3F) % 24;
+    u32 minute = GBA_RTCFromBCD(buffer[5] & 0x7F) % 60;
+    u32 second = GBA_RTCFromBCD(buffer[6] & 0x7F) % 60;
+
+    if (((GPIO.rtc_control & RTC_CONTROL_24H) == 0) && (buffer[4] & BIT(7)))
+        hour = (hour % 12) + 12;
+
+    if ((month < 1) || (month > 12))
+        month = 1;
+    if ((day < 1) || (day > 31))
+        day = 1;
+
+    s64 days = GBA_RTCDaysFromDate(2000 + year, month, day);
+
+    GPIO.rtc_weekday_offset = 0;
+    GPIO.rtc_weekday_offset = (weekday + 7 - GBA_RTCWeekday(days)) % 7;
+
+    GBA_RTCTimeSet((days * 86400) + (hour * 3600) + (minute * 60) + second);
+}
+
+static void GBA_RTCTransferEnd(void)
+{
+    GPIO.rtc_command = 0;
+    GPIO.rtc_byte = 0;
+    GPIO.rtc_bits = 0;
+    GPIO.rtc_index = 0;
+}
+
+static void GBA_RTCCommandStart(u8 command)
+{
+    if ((command & 0xF) != RTC_CMD_MAGIC)
+    {
+        Debug_DebugMsgArg("RTC: Invalid command 0x%02X", command);
+        return;
+    }
+
+    u32 cmd = (command >> 4) & 7;
+
+    switch (cmd)
+    {
+        case RTC_CMD_RESET:
+            GPIO.rtc_control = 0;
+            GPIO.rtc_weekday_offset = 0;
+            GBA_RTCTimeSet(RTC_SECONDS_2000);
+            break;
+        case RTC_CMD_DATETIME:
+        case RTC_CMD_TIME:
+        {
+            u8 regs[7];
+            GBA_RTCRegistersGet(regs);
+            if (cmd == RTC_CMD_DATETIME)
+                memcpy(GPIO.rtc_buffer, regs, 7);
+            else
+                memcpy(GPIO.rtc_buffer, &regs[4], 3);
+            break;
+        }
+        case RTC_CMD_CONTROL:
+            GPIO.rtc_buffer[0] = GPIO.rtc_control;
+            break;
+        default: // The interrupt output isn't connected to anything
+            break;
+    }
+
+    if (gba_rtc_command_length[cmd] > 0)
+        GPIO.rtc_command = command;
+}
+
+static void GBA_RTCCommandData(u8 data)
+{
+    u32 cmd = (GPIO.rtc_command >> 4) & 7;
+
+    GPIO.rtc_buffer[GPIO.rtc_index++] = data;
+    if (GPIO.rtc_index < gba_rtc_command_length[cmd])
+        return;
+
+    switch (cmd)
+    {
+        case RTC_CMD_DATETIME:
+            GBA_RTCRegistersSet(GPIO.rtc_buffer);
+            break;
+        case RTC_CMD_TIME:
+        {
+            u8 regs[7];
+            GBA_RTCRegistersGet(regs); // Keep the date
+            memcpy(&regs[4], GPIO.rtc_buffer, 3);
+            GBA_RTCRegistersSet(regs);
+            break;
+        }
+        case RTC_CMD_CONTROL:
+            GPIO.rtc_control = data & RTC_CONTROL_MASK;
+            break;
+        default:
+            break;
+    }
+
+    GBA_RTCTransferEnd();
+}
+
+static void GBA_RTCUpdate(u8 pins, u8 old_pins)
+{
+    if ((pins & GPIO_PIN_CS) == 0)
+    {
+        GBA_RTCTransferEnd();
+        return;
+    }
+
+    // Bits are transferred when the clock goes from low to high
+    if (((pins & GPIO_PIN_SCK) == 0) || (old_pins & GPIO_PIN_SCK))
+        return;
+
+    if (GPIO.rtc_command & RTC_CMD_READ)
+    {
+        u8 bit = (GPIO.rtc_buffer[GPIO.rtc_index] >> GPIO.rtc_bits) & 1;
+        GPIO.device_data = (GPIO.device_data & ~GPIO_PIN_SIO) | (bit << 1);
+
+        if (++GPIO.rtc_bits < 8)
+            return;
+
+        GPIO.rtc_bits = 0;
+
+        u32 cmd = (GPIO.rtc_command >> 4) & 7;
+        if (++GPIO.rtc_index >= gba_rtc_command_length[cmd])
+            GBA_RTCTransferEnd();
+        return;
+    }
+
+    if (pins & GPIO_PIN_SIO)
+        GPIO.rtc_byte |= BIT(GPIO.rtc_bits);
+
+    if (++GPIO.rtc_bits < 8)
+        return;
+
+    u8 byte = GPIO.rtc_byte;
+    GPIO.rtc_byte = 0;
+    GPIO.rtc_bits = 0;
+
+    if (GPIO.rtc_command == 0)
+        GBA_RTCCommandStart(byte);
+    else
+        GBA_RTCCommandData(byte);
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_GPIOSetSolarLevel(int level)
+{
+    if (level < 0)
+        level = 0;
+    else if (level > 255)
+        level = 255;
+
+    gba_solar_level = level;
+}
+
+// The game resets the counter of the sensor and sends pulses until the flag is
+// set. The number of pulses goes from 0xE8 in darkness to around 0x50 in the
+// strongest sunlight.
+static void GBA_SolarUpdate(u8 pins, u8 old_pins)
+{
+    if (pins & GPIO_PIN_CS) // Selected when it's low
+        return;
+
+    if (pins & GPIO_PIN_SIO)
+        GPIO.solar_counter = 0;
+    else if ((pins & GPIO_PIN_SCK) && ((old_pins & GPIO_PIN_SCK) == 0))
+    {
+        if (GPIO.solar_counter < 0xFF)
+            GPIO.solar_counter++;
+    }
+
+    u32 threshold = 0xE8 - ((gba_solar_level * (0xE8 - 0x50)) / 255);
+
+    if (GPIO.solar_counter >= threshold)
+        GPIO.device_data |= GPIO_PIN_3;
+    else
+        GPIO.device_data &= ~GPIO_PIN_3;
+}
+
+int GBA_GPIORumbleEnabled(void)
+{
+    if ((gba_gpio_devices & GPIO_DEVICE_RUMBLE) == 0)
+        return 0;
+
+    return (GPIO.pins & GPIO_PIN_3) != 0;
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_GPIOSetFixedTime(u64 timestamp)
+{
+    gba_rtc_fixed_time = timestamp;
+}
+
+void GBA_GPIOInit(const void *rom)
+{
+    memset(&GPIO, 0, sizeof(GPIO));
+
+    gba_gpio_devices = 0;
+
+    const char *game_code = (const char *)rom + 0xAC;
+
+    for (size_t i = 0; i < ARRAY_NUM_ELEMENTS(gba_gpio_games); i++)
+    {
+        if (memcmp(game_code, gba_gpio_games[i].code, 3) == 0)
+        {
+            gba_gpio_devices = gba_gpio_games[i].devices;
+            break;
+        }
+    }
+
+    if (gba_gpio_devices & GPIO_DEVICE_RTC)
+        Debug_LogMsgArg("GPIO: RTC detected");
+    if (gba_gpio_devices & GPIO_DEVICE_SOLAR)
+        Debug_LogMsgArg("GPIO: Solar sensor detected");
+    if (gba_gpio_devices & GPIO_DEVICE_RUMBLE)
+        Debug_LogMsgArg("GPIO: Rumble detected");
+
+    GPIO.rtc_control = RTC_CONTROL_24H;
+    GBA_RTCTimeSet(GBA_RTCHostTime());
+}
+
+int GBA_GPIOIsReadable(void)
+{
+    return (gba_gpio_devices != 0) && (GPIO.control & 1);
+}
+
+u16 GBA_GPIORead16(u32 address)
+{
+    switch (address & 0xFE)
+    {
+        case GPIO_REG_DATA:
+            return ((GPIO.data & GPIO.direction)
+                    | (GPIO.device_data & ~GPIO.direction)) & 0xF;
+        case GPIO_REG_DIRECTION:
+            return GPIO.direction;
+        case GPIO_REG_CONTROL:
+            return GPIO.control;
+        default:
+            return 0;
+    }
+}
+
+int GBA_GPIOWrite16(u32 address, u16 data)
+{
+    if (gba_gpio_devices == 0)
+        return 0;
+
+    switch (address & 0xFE)
+    {
+        case GPIO_REG_DATA:
+            GPIO.data = data & 0xF;
+            break;
+        case GPIO_REG_DIRECTION:
+            GPIO.direction = data & 0xF;
+            break;
+        case GPIO_REG_CONTROL:
+        {
+            int readable = GBA_GPIOIsReadable();
+            GPIO.control = data & 1;
+            return readable != GBA_GPIOIsReadable();
+        }
+        default:
+            return 0;
+    }
+
+    u8 old_pins = GPIO.pins;
+    GPIO.pins = GPIO.data & GPIO.direction;
+
+    if (gba_gpio_devices & GPIO_DEVICE_RTC)
+        GBA_RTCUpdate(GPIO.pins, old_pins);
+    if (gba_gpio_devices & GPIO_DEVICE_SOLAR)
+        GBA_SolarUpdate(GPIO.pins, old_pins);
+
+    return 0;
+}
+
+void GBA_GPIOStateSave(_savestate_t *st)
+{
+    SaveState_WriteChunk(st, "GPIO", &GPIO, sizeof(GPIO));
+}
+
+void GBA_GPIOStateLoad(_savestate_t *st)
+{
+    SaveState_ReadChunk(st, "GPIO", &GPIO, sizeof(GPIO));
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GBA_GPIO__
+#define GBA_GPIO__
+
+#include "gba.h"
+
+// General purpose I/O port of the cartridge, at 0x080000C4-0x080000C9 (and the
+// mirrors in the other wait state regions). Some cartridges have extra hardware
+// connected to it, detected from the game code of the header:
+//
+// - Seiko S-3511 real time clock (Pokemon Ruby/Sapphire/Emerald, Boktai...).
+//   Its time isn't advanced by the emulator, it is calculated when it's read
+//   from the time of the scheduler, so it costs nothing while it isn't used.
+//   When the ROM is loaded it starts with the time of the host, changes done
+//   by the game are only kept in the save states.
+// - Solar sensor (Boktai). The light level is set by the frontend.
+// - Rumble (Drill Dozer, WarioWare Twisted). The gyro sensor of WarioWare
+//   Twisted isn't emulated.
+//
+// The registers can only be read when bit 0 of the control register is set,
+// reads return the ROM otherwise. Only the page of the ROM with the registers
+// goes through the slow path of the memory handlers while they are readable.
+
+#define GBA_GPIO_ADDRESS_START  (0xC4) // Offset inside of the ROM
+#define GBA_GPIO_ADDRESS_END    (0xCA)
+
+// If a fixed time (in seconds since the epoch, UTC) is set, the RTC starts with
+// it instead of with the time of the host so that the emulation doesn't depend
+// on when the ROM is loaded. 0 restores the clock of the host. It has to be set
+// before the ROM is loaded.
+void GBA_GPIOSetFixedTime(u64 timestamp);
+
+void GBA_GPIOInit(const void *rom);
+
+// Returns 1 if the cartridge has hardware in the port and the registers are
+// readable.
+int GBA_GPIOIsReadable(void);
+
+// The address is the one of a register, aligned to 16 bits
+u16 GBA_GPIORead16(u32 address);
+// Returns 1 if the registers have changed from readable to write-only or the
+// other way around.
+int GBA_GPIOWrite16(u32 address, u16 data);
+
+int GBA_GPIORumbleEnabled(void);
+
+// From 0 (darkness) to 255 (strongest sunlight)
+void GBA_GPIOSetSolarLevel(int level);
+
+void GBA_GPIOStateSave(_savestate_t *st);
+void GBA_GPIOStateLoad(_savestate_t *st);
+
+#endif // GBA_GPIO__
@@ -8,6 +8,7 @@
 
 #include "bios.h"
 #include "cpu.h"
+#include "dma.h"
 #include "gba.h"
 #include "memory.h"
 #include "video.h"
@@ -16,23 +17,36 @@
 #define SCR_HBL       (1)
 #define SCR_VBL_DRAW  (2)
 #define SCR_VBL_HBL   (3)
-u32 screenmode = SCR_DRAW;
+core_local__ u32 screenmode = SCR_DRAW;
 
 #define HDRAW_CLOCKS (960)
 #define HBL_CLOCKS   (272)
 //#define HLINE_CLOCKS (1232)
 //#define VBL_CLOCKS   (83776) // 68 * HLINE_CLOCKS
-static s32 scrclocks = HDRAW_CLOCKS;
+static core_local__ s32 scrclocks = HDRAW_CLOCKS;
 
-static u32 ly = 0;
+static core_local__ u32 ly = 0;
+
+// 1 if (REG_IE & REG_IF) != 0. IME and the I flag of the CPSR are only checked
+// when there is something pending, most slices end with nothing to do.
+static core_local__ int gba_irq_pending = 0;
+
+void GBA_InterruptPendingUpdate(void)
+{
+    gba_irq_pending = (REG_IE & REG_IF) != 0;
+}
 
 void GBA_CallInterrupt(u32 flag)
 {
     REG_IF |= flag;
+    GBA_InterruptPendingUpdate();
 }
 
 int GBA_InterruptCheck(void)
 {
+    if (gba_irq_pending == 0)
+        return 0;
+
     if (GBA_CPUGetHalted() == 2)
         return 0;
 
@@ -96,16 +110,16 @@ void GBA_InterruptLCD(u32 flag)
         GBA_CallInterrupt(flag >> 3);
 }
 
-static int justchangedscreenmode = 0;
+static core_local__ int justchangedscreenmode = 0;
 
 int GBA_ScreenJustChangedMode(void)
 {
     return justchangedscreenmode;
 }
 
-s32 GBA_UpdateScreenTimings(s32 clocks)
+static s32 GBA_ScreenTimingsStep(s32 clocks)
 {
-    static int hblinterruptexecuted = 0;
+    static core_local__ int hblinterruptexecuted = 0;
 
     scrclocks -= clocks;
     justchangedscreenmode = 0;
@@ -127,6 +141,7 @@ s32 GBA_UpdateScreenTimings(s32 clocks)
                 screenmode = SCR_HBL;
                 scrclocks = HBL_CLOCKS + scrclocks;
                 justchangedscreenmode = 1;
+                GBA_DMAScreenModeChanged();
                 hblinterruptexecuted = 0;
             }
             break;
@@ -163,6 +178,7 @@ s32 GBA_UpdateScreenTimings(s32 clocks)
                 }
 
                 justchangedscreenmode = 1;
+                GBA_DMAScreenModeChanged();
             }
             else if ((scrclocks <= (HBL_CLOCKS - (1006 - HDRAW_CLOCKS)))
                      && (hblinterruptexecuted == 0))
@@ -240,10 +256,83 @@ s32 GBA_UpdateScreenTimings(s32 clocks)
     return scrclocks;
 }
 
+// During the V-Blank period, if the CPU is halted and only an interrupt of the
+// screen can wake it up, nothing can see the state of the screen change until
+// the next interrupt that can wake it. The lines in the middle don't need their
+// own events, they are caught up the next time the screen is updated. It
+// returns the clocks until the CPU can be woken up, or 0 if every line needs
+// its events.
+static s32 GBA_ScreenVBlankSkipClocks(void)
+{
+    if ((screenmode != SCR_VBL_DRAW) && (screenmode != SCR_VBL_HBL))
+        return 0;
+
+    if (GBA_CPUGetHalted() != 1)
+        return 0;
+
+    // Any interrupt that doesn't come from the screen could wake up the CPU,
+    // and it may have a pending interrupt already.
+    if (REG_IE & ~(BIT(0) | BIT(1) | BIT(2)))
+        return 0;
+    if (REG_IE & REG_IF)
+        return 0;
+
+    if ((REG_IE & BIT(1)) && (REG_DISPSTAT & BIT(4))) // H-Blank
+        return 0;
+    if ((REG_IE & BIT(2)) && (REG_DISPSTAT & BIT(5))) // V-Counter
+    {
+        if ((REG_DISPSTAT >> 8) > ly)
+            return 0;
+    }
+
+    // Clocks until the start of line 0
+    s32 clocks = scrclocks + (227 - ly) * (HDRAW_CLOCKS + HBL_CLOCKS);
+    if (screenmode == SCR_VBL_DRAW)
+        clocks += HBL_CLOCKS;
+
+    return clocks;
+}
+
+s32 GBA_UpdateScreenTimings(s32 clocks)
+{
+    // If some lines of the V-Blank period have been skipped, several steps
+    // have to be done to catch up. In any other case, only one is needed.
+    s32 clocks_left = GBA_ScreenTimingsStep(clocks);
+    while (clocks_left <= 0)
+        clocks_left = GBA_ScreenTimingsStep(0);
+
+    s32 skip_clocks = GBA_ScreenVBlankSkipClocks();
+    if (skip_clocks > 0)
+        return skip_clocks;
+
+    return clocks_left;
+}
+
 void GBA_InterruptInit(void)
 {
     scrclocks = HDRAW_CLOCKS;
     screenmode = SCR_DRAW;
     ly = 0;
     justchangedscreenmode = 0;
+    gba_irq_pending = 0;
+}
+
+void GBA_InterruptStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "SCRT");
+    SaveState_Write(st, &scrclocks, sizeof(scrclocks));
+    SaveState_Write(st, &screenmode, sizeof(screenmode));
+    SaveState_Write(st, &ly, sizeof(ly));
+    SaveState_Write(st, &justchangedscreenmode, sizeof(justchangedscreenmode));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_InterruptStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "SCRT");
+    SaveState_Read(st, &scrclocks, sizeof(scrclocks));
+    SaveState_Read(st, &screenmode, sizeof(screenmode));
+    SaveState_Read(st, &ly, sizeof(ly));
+    SaveState_Read(st, &justchangedscreenmode, sizeof(justchangedscreenmode));
+    SaveState_ChunkClose(st);
 }
@@ -12,7 +12,7 @@
 #define SCR_DRAW         (0)
 #define SCR_HBL          (1)
 #define SCR_VBL          (2)
-extern u32 screenmode;
+extern core_local__ u32 screenmode;
 
 #define HDRAW_CLOCKS (960)
 #define HBL_CLOCKS   (272)
@@ -20,6 +20,8 @@ extern u32 screenmode;
 //#define VBL_CLOCKS   (83776) // 68 * HLINE_CLOCKS
 
 void GBA_CallInterrupt(u32 flag);
+// Has to be called whenever REG_IE or REG_IF are written
+void GBA_InterruptPendingUpdate(void);
 
 void GBA_InterruptLCD(u32 flag);
 
@@ -32,4 +34,7 @@ void GBA_CheckKeypadInterrupt(void);
 
 void GBA_InterruptInit(void);
 
+void GBA_InterruptStateSave(_savestate_t *st);
+void GBA_InterruptStateLoad(_savestate_t *st);
+
 #endif // GBA_INTERRUPTS__
@@ -10,24 +10,30 @@
 
 #include "../build_options.h"
 #include "../debug_utils.h"
+#include "../file_utils.h"
+#include "../heatmap_utils.h"
 
 #include "bios.h"
+#include "code_cache.h"
 #include "cpu.h"
+#include "disassembler.h"
 #include "dma.h"
 #include "gba.h"
+#include "gpio.h"
 #include "interrupts.h"
 #include "memory.h"
 #include "save.h"
 #include "shifts.h"
+#include "sio.h"
 #include "sound.h"
 #include "timers.h"
 #include "video.h"
 
-_mem_t Mem;
+core_local__ _mem_t Mem;
 
 //------------------------------------------------------------------------------
 
-static u32 *memarray[16];
+static core_local__ u32 *memarray[16];
 
 static u32 memsizemask[16] = {
     0x3FFF, 0, 0x3FFFF, 0x7FFF,
@@ -48,18 +54,6 @@ u32 GBA_MemoryReadFast32(u32 address)
         return ptr[(address & memsizemask[index]) >> 2];
 }
 
-void GBA_MemoryWriteFast32(u32 address, u32 data)
-{
-    if (address & 0xF0000000)
-        return;
-    u32 index = (address >> 24) & 0xF;
-    u32 *ptr = memarray[index];
-    if (ptr == NULL)
-        return;
-    else
-        ptr[(address & memsizemask[index]) >> 2] = data;
-}
-
 u16 GBA_MemoryReadFast16(u32 address)
 {
     if (address & 0xF0000000)
@@ -72,18 +66,6 @@ u16 GBA_MemoryReadFast16(u32 address)
         return ptr[(address & memsizemask[index]) >> 1];
 }
 
-void GBA_MemoryWriteFast16(u32 address, u16 data)
-{
-    if (address & 0xF0000000)
-        return;
-    u32 index = (address >> 24) & 0xF;
-    u16 *ptr = (u16 *)memarray[index];
-    if (ptr == NULL)
-        return;
-    else
-        ptr[(address & memsizemask[index]) >> 1] = data;
-}
-
 u8 GBA_MemoryReadFast8(u32 address)
 {
     if (address & 0xF0000000)
@@ -96,16 +78,21 @@ u8 GBA_MemoryReadFast8(u32 address)
         return ptr[address & memsizemask[index]];
 }
 
-void GBA_MemoryWriteFast8(u32 address, u8 data)
+// Every mask is bigger than a block and they are aligned, so the blocks are
+// never split by a mirror.
+static const u32 gba_fetch_zero_block[GBA_CODE_CACHE_BLOCK_SIZE / 4];
+
+const void *GBA_MemoryFetchBlock(u32 address)
 {
     if (address & 0xF0000000)
-        return;
+        return gba_fetch_zero_block;
     u32 index = (address >> 24) & 0xF;
     u8 *ptr = (u8 *)memarray[index];
     if (ptr == NULL)
-        return;
+        return gba_fetch_zero_block;
     else
-        ptr[address & memsizemask[index]] = data;
+        return &ptr[address & memsizemask[index]
+                    & ~(GBA_CODE_CACHE_BLOCK_SIZE - 1)];
 }
 
 //------------------------------------------------------------------------------
@@ -132,7 +119,405 @@ static void GBA_MemoryReadFastFillArray(void)
 
 //------------------------------------------------------------------------------
 
-void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
+// The memory map is split in pages that can be accessed directly from the
+// memory handlers, without checking which region they belong to. A NULL pointer
+// means that the access has to go through the slow path. I/O, BIOS (its reads
+// depend on the PC), VRAM, palette and OAM (mirrored more than once per page)
+// and save memory always go through it. Only EWRAM and IWRAM can be written
+// from the fast path.
+
+#define MEM_PAGE_SHIFT      (14)
+#define MEM_PAGE_SIZE       (1 << MEM_PAGE_SHIFT)
+#define MEM_PAGE_MASK       (MEM_PAGE_SIZE - 1)
+
+#define MEM_READ_PAGES      (0x10000000 >> MEM_PAGE_SHIFT)
+#define MEM_WRITE_PAGES     (0x04000000 >> MEM_PAGE_SHIFT)
+
+static core_local__ u8 *mem_read_pages[MEM_READ_PAGES];
+
+typedef struct
+{
+    u8 *ptr;
+    // Flags of the code cache blocks of this page
+    u8 *code_used;
+    u8 *arm_valid;
+    u8 *thumb_valid;
+} _mem_write_page_t;
+
+static core_local__ _mem_write_page_t mem_write_pages[MEM_WRITE_PAGES];
+
+static inline u8 *GBA_MemoryReadPage(u32 address)
+{
+    u32 page = address >> MEM_PAGE_SHIFT;
+    if (page >= MEM_READ_PAGES)
+        return NULL;
+    return mem_read_pages[page];
+}
+
+static inline _mem_write_page_t *GBA_MemoryWritePage(u32 address)
+{
+    u32 page = address >> MEM_PAGE_SHIFT;
+    if ((page >= MEM_WRITE_PAGES) || (mem_write_pages[page].ptr == NULL))
+        return NULL;
+    return &mem_write_pages[page];
+}
+
+static inline void GBA_MemoryWritePageInvalidate(_mem_write_page_t *wp,
+                                                 u32 address)
+{
+    u32 index = (address & MEM_PAGE_MASK) >> GBA_CODE_CACHE_BLOCK_SHIFT;
+    GBA_CodeCacheInvalidateBlock(wp->code_used, wp->arm_valid,
+                                 wp->thumb_valid, index);
+}
+
+static void GBA_MemoryPagesFill(void)
+{
+    memset(mem_read_pages, 0, sizeof(mem_read_pages));
+    memset(mem_write_pages, 0, sizeof(mem_write_pages));
+
+    for (u32 page = 0; page < MEM_READ_PAGES; page++)
+    {
+        u32 address = page << MEM_PAGE_SHIFT;
+
+        switch (address >> 24)
+        {
+            case 2:
+            {
+                u32 offset = address & 0x3FFFF;
+                u32 block = offset >> GBA_CODE_CACHE_BLOCK_SHIFT;
+                mem_read_pages[page] = &Mem.ewram[offset];
+                mem_write_pages[page].ptr = &Mem.ewram[offset];
+                mem_write_pages[page].code_used =
+                        &gba_code_cache_ewram_used[block];
+                mem_write_pages[page].arm_valid =
+                        &gba_code_cache_arm_ewram_valid[block];
+                mem_write_pages[page].thumb_valid =
+                        &gba_code_cache_thumb_ewram_valid[block];
+                break;
+            }
+            case 3:
+            {
+                u32 offset = address & 0x7FFF;
+                u32 block = offset >> GBA_CODE_CACHE_BLOCK_SHIFT;
+                mem_read_pages[page] = &Mem.iwram[offset];
+                mem_write_pages[page].ptr = &Mem.iwram[offset];
+                mem_write_pages[page].code_used =
+                        &gba_code_cache_iwram_used[block];
+                mem_write_pages[page].arm_valid =
+                        &gba_code_cache_arm_iwram_valid[block];
+                mem_write_pages[page].thumb_valid =
+                        &gba_code_cache_thumb_iwram_valid[block];
+                break;
+            }
+            case 8:
+            case 9:
+            case 0xA:
+            case 0xB:
+            case 0xC:
+                mem_read_pages[page] = &Mem.rom_wait0[address & 0x01FFFFFF];
+                break;
+            case 0xD:
+                // The EEPROM is mapped here. If the save type is detected
+                // later it may stop being EEPROM, but the slow path handles
+                // that case correctly too.
+                if (GBA_SaveIsEEPROM())
+                {
+                    if (GBA_GetRomSize() <= (16 * 1024 * 1024))
+                        break;
+                    if ((address + MEM_PAGE_SIZE) > 0x0DFFFF00)
+                        break;
+                }
+                mem_read_pages[page] = &Mem.rom_wait0[address & 0x01FFFFFF];
+                break;
+            default:
+                break;
+        }
+    }
+
+    // While the registers of the GPIO port are readable, reads of the page that
+    // has them have to go through the slow path. Reads of the rest of the ROM
+    // stay in the fast path.
+    if (GBA_GPIOIsReadable())
+    {
+        mem_read_pages[0x08000000 >> MEM_PAGE_SHIFT] = NULL;
+        mem_read_pages[0x0A000000 >> MEM_PAGE_SHIFT] = NULL;
+        mem_read_pages[0x0C000000 >> MEM_PAGE_SHIFT] = NULL;
+    }
+
+    // The heatmap counts the accesses from the slow path
+    if (heatmap_enabled)
+    {
+        memset(mem_read_pages, 0, sizeof(mem_read_pages));
+        memset(mem_write_pages, 0, sizeof(mem_write_pages));
+        return;
+    }
+
+    if (gba_watchpoint_types == 0)
+        return;
+
+    // The accesses to pages with watchpoints have to go through the slow path,
+    // which checks them.
+    for (u32 page = 0; page < MEM_READ_PAGES; page++)
+    {
+        u32 address = page << MEM_PAGE_SHIFT;
+
+        if (GBA_DebugWatchpointInRange(address, MEM_PAGE_SIZE, GBA_WATCH_READ))
+            mem_read_pages[page] = NULL;
+
+        if (page >= MEM_WRITE_PAGES)
+            continue;
+
+        if (GBA_DebugWatchpointInRange(address, MEM_PAGE_SIZE, GBA_WATCH_WRITE))
+            mem_write_pages[page].ptr = NULL;
+    }
+}
+
+void GBA_MemoryWatchpointsUpdated(void)
+{
+    GBA_MemoryPagesFill();
+}
+
+// Returns 1 if the address is in one of the mirrors of the GPIO port
+static inline int GBA_MemoryInGPIO(u32 address)
+{
+    if ((address < 0x08000000) || (address >= 0x0E000000))
+        return 0;
+
+    u32 offset = address & 0x01FFFFFF;
+    return (offset >= GBA_GPIO_ADDRESS_START)
+           && (offset < GBA_GPIO_ADDRESS_END);
+}
+
+// For 16-bit aligned addresses of the first page of the ROM, when the
+// registers are readable.
+static u16 GBA_MemoryReadGPIO16(u32 address)
+{
+    if (GBA_MemoryInGPIO(address))
+        return GBA_GPIORead16(address);
+    return *((u16 *)&(Mem.rom_wait2[address & 0x01FFFFFE]));
+}
+
+static void GBA_MemoryWriteGPIO16(u32 address, u16 data)
+{
+    if (GBA_GPIOWrite16(address, data))
+        GBA_MemoryPagesFill();
+}
+
+static inline void GBA_MemoryWatchpointCheck(u32 address, u32 size, int type)
+{
+    if (gba_watchpoint_check_types & type)
+        GBA_DebugWatchpointCheck(address, size, type);
+}
+
+//------------------------------------------------------------------------------
+
+typedef enum
+{
+    GBA_HEATMAP_BIOS,
+    GBA_HEATMAP_EWRAM,
+    GBA_HEATMAP_IWRAM,
+    GBA_HEATMAP_IO,
+    GBA_HEATMAP_PAL,
+    GBA_HEATMAP_VRAM,
+    GBA_HEATMAP_OAM,
+    GBA_HEATMAP_ROM,
+    GBA_HEATMAP_SRAM,
+
+    GBA_HEATMAP_REGIONS
+} _gba_heatmap_region_e;
+
+void GBA_MemoryHeatmapSetEnabled(int enabled)
+{
+    if (enabled)
+    {
+        const _heatmap_region_t regions[GBA_HEATMAP_REGIONS] = {
+            { "BIOS", 0x4000, 0x00000000, 0, 0 },
+            { "EWRAM", 0x40000, 0x02000000, 0, 0 },
+            { "IWRAM", 0x8000, 0x03000000, 0, 0 },
+            { "IO", 0x400, 0x04000000, 0, 0 },
+            { "PAL", 0x400, 0x05000000, 0, 0 },
+            { "VRAM", 0x18000, 0x06000000, 0, 0 },
+            { "OAM", 0x400, 0x07000000, 0, 0 },
+            { "ROM", GBA_GetRomSize(), 0x08000000, 0, 0 },
+            { "SRAM", 0x10000, 0x0E000000, 0, 0 },
+        };
+
+        Heatmap_Start(regions, GBA_HEATMAP_REGIONS);
+    }
+    else
+    {
+        if (heatmap_enabled == 0)
+            return;
+
+        Heatmap_End();
+    }
+
+    GBA_MemoryPagesFill();
+}
+
+// The accesses are counted once, in the bucket of their first byte. The ROM
+// mirrors with different wait states are counted in the same region.
+static void GBA_MemoryHeatmapCount(u32 address, int type)
+{
+    int region;
+    u32 offset;
+
+    switch (address >> 24)
+    {
+        case 0:
+            region = GBA_HEATMAP_BIOS;
+            offset = address;
+            break;
+        case 2:
+            region = GBA_HEATMAP_EWRAM;
+            offset = address & 0x3FFFF;
+            break;
+        case 3:
+            region = GBA_HEATMAP_IWRAM;
+            offset = address & 0x7FFF;
+            break;
+        case 4:
+            region = GBA_HEATMAP_IO;
+            offset = address & 0x00FFFFFF;
+            break;
+        case 5:
+            region = GBA_HEATMAP_PAL;
+            offset = address & 0x3FF;
+            break;
+        case 6:
+            region = GBA_HEATMAP_VRAM;
+            offset = address & 0x1FFFF;
+            if (offset >= 0x18000)
+                offset -= 0x8000;
+            break;
+        case 7:
+            region = GBA_HEATMAP_OAM;
+            offset = address & 0x3FF;
+            break;
+        case 8:
+        case 9:
+        case 0xA:
+        case 0xB:
+        case 0xC:
+        case 0xD:
+            region = GBA_HEATMAP_ROM;
+            offset = address & 0x01FFFFFF;
+            break;
+        case 0xE:
+        case 0xF:
+            region = GBA_HEATMAP_SRAM;
+            offset = address & 0xFFFF;
+            break;
+        default:
+            return;
+    }
+
+    if (type == GBA_WATCH_READ)
+        Heatmap_Read(region, offset);
+    else
+        Heatmap_Write(region, offset);
+}
+
+static inline void GBA_MemoryHeatmapCheck(u32 address, int type)
+{
+    if (heatmap_enabled)
+        GBA_MemoryHeatmapCount(address, type);
+}
+
+//------------------------------------------------------------------------------
+
+core_local__ u8 gba_dirty_pal[sizeof(Mem.pal_ram) >> GBA_DIRTY_PAGE_SHIFT];
+core_local__ u8 gba_dirty_vram[sizeof(Mem.vram) >> GBA_DIRTY_PAGE_SHIFT];
+core_local__ u8 gba_dirty_oam[sizeof(Mem.oam) >> GBA_DIRTY_PAGE_SHIFT];
+
+// The pages can be thread-local (see core_local__), so their addresses can't be
+// used to initialize a table.
+static u8 *gba_dirty_region_get(_gba_dirty_region_e region, u32 *num_pages)
+{
+    switch (region)
+    {
+        case GBA_DIRTY_PAL:
+            *num_pages = sizeof(gba_dirty_pal);
+            return gba_dirty_pal;
+        case GBA_DIRTY_VRAM:
+            *num_pages = sizeof(gba_dirty_vram);
+            return gba_dirty_vram;
+        case GBA_DIRTY_OAM:
+            *num_pages = sizeof(gba_dirty_oam);
+            return gba_dirty_oam;
+        default:
+            *num_pages = 0;
+            return NULL;
+    }
+}
+
+void GBA_MemoryDirtySetAll(_gba_dirty_region_e region)
+{
+    u32 num_pages;
+    u8 *pages = gba_dirty_region_get(region, &num_pages);
+    memset(pages, 0xFF, num_pages);
+}
+
+int GBA_MemoryDirtyCheck(_gba_dirty_region_e region, u32 user,
+                         u32 offset, u32 size)
+{
+    u32 num_pages;
+    u8 *pages = gba_dirty_region_get(region, &num_pages);
+
+    if (size == 0)
+        return 0;
+
+    u32 first = offset >> GBA_DIRTY_PAGE_SHIFT;
+    u32 last = (offset + size - 1) >> GBA_DIRTY_PAGE_SHIFT;
+    if (last >= num_pages)
+        last = num_pages - 1;
+
+    int dirty = 0;
+
+    for (u32 i = first; i <= last; i++)
+    {
+        if (pages[i] & user)
+        {
+            pages[i] &= ~user;
+            dirty = 1;
+        }
+    }
+
+    return dirty;
+}
+
+//------------------------------------------------------------------------------
+
+// Palette, VRAM and OAM writes only notify the video code if the data changes,
+// so that it can reuse scanlines that haven't changed since the last frame.
+
+static inline void GBA_MemoryWriteVideo32(u8 *ptr, u32 data)
+{
+    if (*(u32 *)ptr != data)
+    {
+        *(u32 *)ptr = data;
+        gba_video_memory_version++;
+    }
+}
+
+static inline void GBA_MemoryWriteVideo16(u8 *ptr, u16 data)
+{
+    if (*(u16 *)ptr != data)
+    {
+        *(u16 *)ptr = data;
+        gba_video_memory_version++;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void GBA_RegisterTableFill(void);
+
+// 1 if the buffer of the ROM has been allocated here and has to be freed
+static core_local__ int mem_rom_allocated;
+
+void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize,
+                    int rom_in_place)
 {
     Mem.rom_bios = (u8 *)calloc(1, 16 * 1024);
     if (bios_ptr)
@@ -147,9 +532,23 @@ void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
     memset(Mem.pal_ram, 0, sizeof(Mem.pal_ram));
     memset(Mem.vram, 0, sizeof(Mem.vram));
     memset(Mem.oam, 0, sizeof(Mem.oam));
+    gba_video_memory_version++;
+    GBA_MemoryDirtySetAll(GBA_DIRTY_PAL);
+    GBA_MemoryDirtySetAll(GBA_DIRTY_VRAM);
+    GBA_MemoryDirtySetAll(GBA_DIRTY_OAM);
 
-    u8 *rom_buffer = calloc(1, 0x02000000); // 32 * 1024 * 1024);
-    memcpy(rom_buffer, rom_ptr, romsize);
+    u8 *rom_buffer;
+    if (rom_in_place)
+    {
+        rom_buffer = (u8 *)rom_ptr;
+        mem_rom_allocated = 0;
+    }
+    else
+    {
+        rom_buffer = LargeAlloc(GBA_ROM_BUFFER_SIZE);
+        memcpy(rom_buffer, rom_ptr, romsize);
+        mem_rom_allocated = 1;
+    }
     Mem.rom_wait0 = rom_buffer;
     Mem.rom_wait1 = rom_buffer;
     Mem.rom_wait2 = rom_buffer;
@@ -157,10 +556,13 @@ void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
     //memset(Mem.sram, 0, sizeof(Mem.sram));
 
     GBA_MemoryReadFastFillArray();
+    GBA_MemoryPagesFill();
 
     // Init registers
     // --------------
 
+    GBA_RegisterTableFill();
+
     GBA_RegisterWrite16(DISPCNT, 0x0080);
     GBA_RegisterWrite16(GREENSWAP, 0);
     GBA_RegisterWrite16(DISPSTAT, 0);
@@ -265,8 +667,49 @@ void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize)
 
 void GBA_MemoryEnd(void)
 {
+    Heatmap_End();
+
     free(Mem.rom_bios);
-    free(Mem.rom_wait0); // Only free one of the pointers to ROM
+    if (mem_rom_allocated)
+        LargeFree(Mem.rom_wait0, GBA_ROM_BUFFER_SIZE); // Only one of them
+}
+
+// BIOS and ROM aren't saved, the state can only be loaded with the same ROM.
+void GBA_MemoryStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "MEM ");
+    SaveState_Write(st, Mem.ewram, sizeof(Mem.ewram));
+    SaveState_Write(st, Mem.iwram, sizeof(Mem.iwram));
+    SaveState_Write(st, Mem.io_regs, sizeof(Mem.io_regs));
+    SaveState_Write(st, Mem.pal_ram, sizeof(Mem.pal_ram));
+    SaveState_Write(st, Mem.vram, sizeof(Mem.vram));
+    SaveState_Write(st, Mem.oam, sizeof(Mem.oam));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_MemoryStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "MEM ");
+    SaveState_Read(st, Mem.ewram, sizeof(Mem.ewram));
+    SaveState_Read(st, Mem.iwram, sizeof(Mem.iwram));
+    SaveState_Read(st, Mem.io_regs, sizeof(Mem.io_regs));
+    SaveState_Read(st, Mem.pal_ram, sizeof(Mem.pal_ram));
+    SaveState_Read(st, Mem.vram, sizeof(Mem.vram));
+    SaveState_Read(st, Mem.oam, sizeof(Mem.oam));
+    SaveState_ChunkClose(st);
+
+    // Everything that is derived from the contents of the memory
+
+    GBA_InterruptPendingUpdate();
+
+    gba_video_memory_version++;
+    GBA_MemoryDirtySetAll(GBA_DIRTY_PAL);
+    GBA_MemoryDirtySetAll(GBA_DIRTY_VRAM);
+    GBA_MemoryDirtySetAll(GBA_DIRTY_OAM);
+
+    GBA_MemoryPagesFill();
+
+    GBA_MemoryAccessCyclesUpdate();
 }
 
 //------------------------------------------------------------------------------
@@ -275,6 +718,16 @@ u32 GBA_MemoryRead32(u32 address)
 {
     register u32 data;
 
+    u8 *page = GBA_MemoryReadPage(address);
+    if (page != NULL)
+    {
+        data = *((u32 *)&(page[address & (MEM_PAGE_MASK & ~3)]));
+        goto rotate;
+    }
+
+    GBA_MemoryWatchpointCheck(address & ~3, 4, GBA_WATCH_READ);
+    GBA_MemoryHeatmapCheck(address & ~3, GBA_WATCH_READ);
+
     switch (address >> 24)
     {
         case 0:
@@ -321,6 +774,12 @@ u32 GBA_MemoryRead32(u32 address)
             //break;
         case 0xC:
         case 0xD:
+            if (GBA_MemoryInGPIO(address & ~3) && GBA_GPIOIsReadable())
+            {
+                data = GBA_MemoryReadGPIO16(address & ~3)
+                       | (GBA_MemoryReadGPIO16((address & ~3) + 2) << 16);
+                break;
+            }
             data = *((u32 *)&(Mem.rom_wait2[address & 0x01FFFFFC]));
             break;
         case 0xE:
@@ -329,6 +788,7 @@ u32 GBA_MemoryRead32(u32 address)
             return 0;
     }
 
+rotate:
 #ifdef ENABLE_ASM_X86
     asm("and $3,%%eax    \n\t" // eax = address & 3
         "mov $3,%%cl     \n\t" // cl = 3
@@ -347,16 +807,31 @@ u32 GBA_MemoryRead32(u32 address)
 
 void GBA_MemoryWrite32(u32 address, u32 data)
 {
+    gba_idle_loop_memory_written = 1;
+
+    _mem_write_page_t *wp = GBA_MemoryWritePage(address);
+    if (wp != NULL)
+    {
+        *((u32 *)&(wp->ptr[address & (MEM_PAGE_MASK & ~3)])) = data;
+        GBA_MemoryWritePageInvalidate(wp, address);
+        return;
+    }
+
+    GBA_MemoryWatchpointCheck(address & ~3, 4, GBA_WATCH_WRITE);
+    GBA_MemoryHeatmapCheck(address & ~3, GBA_WATCH_WRITE);
+
     if (address < 0x02000000)
         return;
     if (address < 0x03000000)
     {
         *((u32 *)&(Mem.ewram[address & 0x3FFFC])) = data;
+        GBA_CodeCacheInvalidateEWRAM(address);
         return;
     }
     if (address < 0x04000000)
     {
         *((u32 *)&(Mem.iwram[address & 0x7FFC])) = data;
+        GBA_CodeCacheInvalidateIWRAM(address);
         return;
     }
     if (address < 0x05000000)
@@ -366,19 +841,30 @@ void GBA_MemoryWrite32(u32 address, u32 data)
     }
     if (address < 0x06000000)
     {
-        *((u32 *)&(Mem.pal_ram[address & 0x3FC])) = data;
+        GBA_MemoryWriteVideo32(&Mem.pal_ram[address & 0x3FC], data);
+        GBA_MemoryDirtySet(gba_dirty_pal, address & 0x3FC);
         return;
     }
     if (address < 0x06018000)
     {
-        *((u32 *)&(Mem.vram[(address & ~3) - 0x06000000])) = data;
+        u32 offset = (address & ~3) - 0x06000000;
+        GBA_MemoryWriteVideo32(&Mem.vram[offset], data);
+        GBA_VideoInvalidateVRAM(offset);
+        GBA_MemoryDirtySet(gba_dirty_vram, offset);
         return;
     }
     if (address < 0x07000000)
         return;
     if (address < 0x08000000)
     {
-        *((u32 *)&(Mem.oam[address & 0x3FC])) = data;
+        GBA_MemoryWriteVideo32(&Mem.oam[address & 0x3FC], data);
+        GBA_MemoryDirtySet(gba_dirty_oam, address & 0x3FC);
+        return;
+    }
+    if (GBA_MemoryInGPIO(address & ~3))
+    {
+        GBA_MemoryWriteGPIO16(address & ~3, data & 0xFFFF);
+        GBA_MemoryWriteGPIO16((address & ~3) + 2, data >> 16);
         return;
     }
 
@@ -393,8 +879,58 @@ void GBA_MemoryWrite32(u32 address, u32 data)
     return;
 }
 
+void GBA_MemoryRead32Multiple(u32 address, u32 *data, u32 count)
+{
+    if (count == 0)
+        return;
+
+    u32 offset = address & MEM_PAGE_MASK;
+
+    u8 *page = GBA_MemoryReadPage(address);
+    if ((page != NULL) && ((offset + (count << 2)) <= MEM_PAGE_SIZE))
+    {
+        memcpy(data, &page[offset], count << 2);
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++)
+        data[i] = GBA_MemoryRead32(address + (i << 2));
+}
+
+void GBA_MemoryWrite32Multiple(u32 address, const u32 *data, u32 count)
+{
+    if (count == 0)
+        return;
+
+    u32 offset = address & MEM_PAGE_MASK;
+
+    _mem_write_page_t *wp = GBA_MemoryWritePage(address);
+    if ((wp != NULL) && ((offset + (count << 2)) <= MEM_PAGE_SIZE))
+    {
+        gba_idle_loop_memory_written = 1;
+
+        memcpy(&wp->ptr[offset], data, count << 2);
+
+        // At most 64 bytes are written, so they can't be in more than two
+        // blocks of the code cache.
+        GBA_MemoryWritePageInvalidate(wp, address);
+        GBA_MemoryWritePageInvalidate(wp, address + ((count - 1) << 2));
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++)
+        GBA_MemoryWrite32(address + (i << 2), data[i]);
+}
+
 u16 GBA_MemoryRead16(u32 address)
 {
+    u8 *page = GBA_MemoryReadPage(address);
+    if (page != NULL)
+        return *((u16 *)&(page[address & (MEM_PAGE_MASK & ~1)]));
+
+    GBA_MemoryWatchpointCheck(address & ~1, 2, GBA_WATCH_READ);
+    GBA_MemoryHeatmapCheck(address & ~1, GBA_WATCH_READ);
+
     if (address < 0x00004000)
     {
         if (CPU.R[R_PC] < 0x00004000)
@@ -417,6 +953,9 @@ u16 GBA_MemoryRead16(u32 address)
     if (address < 0x08000000)
         return *((u16 *)&(Mem.oam[address & 0x3FE]));
 
+    if (GBA_MemoryInGPIO(address) && GBA_GPIOIsReadable())
+        return GBA_GPIORead16(address & ~1);
+
     if (GBA_SaveIsEEPROM())
     {
         if (GBA_GetRomSize() > (16 * 1024 * 1024))
@@ -445,16 +984,31 @@ u16 GBA_MemoryRead16(u32 address)
 
 void GBA_MemoryWrite16(u32 address, u16 data)
 {
+    gba_idle_loop_memory_written = 1;
+
+    _mem_write_page_t *wp = GBA_MemoryWritePage(address);
+    if (wp != NULL)
+    {
+        *((u16 *)&(wp->ptr[address & (MEM_PAGE_MASK & ~1)])) = data;
+        GBA_MemoryWritePageInvalidate(wp, address);
+        return;
+    }
+
+    GBA_MemoryWatchpointCheck(address & ~1, 2, GBA_WATCH_WRITE);
+    GBA_MemoryHeatmapCheck(address & ~1, GBA_WATCH_WRITE);
+
     if (address < 0x02000000)
         return;
     if (address < 0x03000000)
     {
         *((u16 *)&(Mem.ewram[address & 0x3FFFE])) = data;
+        GBA_CodeCacheInvalidateEWRAM(address);
         return;
     }
     if (address < 0x04000000)
     {
         *((u16 *)&(Mem.iwram[address & 0x7FFE])) = data;
+        GBA_CodeCacheInvalidateIWRAM(address);
         return;
     }
     if (address < 0x05000000)
@@ -464,19 +1018,29 @@ void GBA_MemoryWrite16(u32 address, u16 data)
     }
     if (address < 0x06000000)
     {
-        *((u16 *)&(Mem.pal_ram[address & 0x3FE])) = data;
+        GBA_MemoryWriteVideo16(&Mem.pal_ram[address & 0x3FE], data);
+        GBA_MemoryDirtySet(gba_dirty_pal, address & 0x3FE);
         return;
     }
     if (address < 0x06018000)
     {
-        *((u16 *)&(Mem.vram[(address & ~1) - 0x06000000])) = data;
+        u32 offset = (address & ~1) - 0x06000000;
+        GBA_MemoryWriteVideo16(&Mem.vram[offset], data);
+        GBA_VideoInvalidateVRAM(offset);
+        GBA_MemoryDirtySet(gba_dirty_vram, offset);
         return;
     }
     if (address < 0x07000000)
         return;
     if (address < 0x08000000)
     {
-        *((u16 *)&(Mem.oam[address & 0x3FE])) = data;
+        GBA_MemoryWriteVideo16(&Mem.oam[address & 0x3FE], data);
+        GBA_MemoryDirtySet(gba_dirty_oam, address & 0x3FE);
+        return;
+    }
+    if (GBA_MemoryInGPIO(address))
+    {
+        GBA_MemoryWriteGPIO16(address & ~1, data);
         return;
     }
 
@@ -499,6 +1063,13 @@ void GBA_MemoryWrite16(u32 address, u16 data)
 
 u8 GBA_MemoryRead8(u32 address)
 {
+    u8 *page = GBA_MemoryReadPage(address);
+    if (page != NULL)
+        return page[address & MEM_PAGE_MASK];
+
+    GBA_MemoryWatchpointCheck(address, 1, GBA_WATCH_READ);
+    GBA_MemoryHeatmapCheck(address, GBA_WATCH_READ);
+
     if (address < 0x00004000)
     {
         if (CPU.R[R_PC] < 0x00004000)
@@ -521,6 +1092,9 @@ u8 GBA_MemoryRead8(u32 address)
     if (address < 0x08000000)
         return *((u8 *)&(Mem.oam[address & 0x3FF]));
 
+    if (GBA_MemoryInGPIO(address) && GBA_GPIOIsReadable())
+        return GBA_GPIORead16(address & ~1) >> ((address & 1) << 3);
+
     if (GBA_SaveIsEEPROM())
     {
         if (GBA_GetRomSize() > (16 * 1024 * 1024))
@@ -555,16 +1129,31 @@ static u16 expand8to16(u8 data)
 
 void GBA_MemoryWrite8(u32 address, u8 data)
 {
+    gba_idle_loop_memory_written = 1;
+
+    _mem_write_page_t *wp = GBA_MemoryWritePage(address);
+    if (wp != NULL)
+    {
+        wp->ptr[address & MEM_PAGE_MASK] = data;
+        GBA_MemoryWritePageInvalidate(wp, address);
+        return;
+    }
+
+    GBA_MemoryWatchpointCheck(address, 1, GBA_WATCH_WRITE);
+    GBA_MemoryHeatmapCheck(address, GBA_WATCH_WRITE);
+
     if (address < 0x02000000)
         return;
     if (address < 0x03000000)
     {
         *((u8 *)&(Mem.ewram[address & 0x3FFFF])) = data;
+        GBA_CodeCacheInvalidateEWRAM(address);
         return;
     }
     if (address < 0x04000000)
     {
         *((u8 *)&(Mem.iwram[address & 0x7FFF])) = data;
+        GBA_CodeCacheInvalidateIWRAM(address);
         return;
     }
     if (address < 0x05000000)
@@ -574,19 +1163,32 @@ void GBA_MemoryWrite8(u32 address, u8 data)
     }
     if (address < 0x06000000)
     {
-        *((u16 *)&(Mem.pal_ram[address & 0x3FE])) = expand8to16(data);
+        GBA_MemoryWriteVideo16(&Mem.pal_ram[address & 0x3FE],
+                               expand8to16(data));
+        GBA_MemoryDirtySet(gba_dirty_pal, address & 0x3FE);
         return;
     }
     if (address < 0x06018000)
     {
-        *((u16 *)&(Mem.vram[(address & ~1) - 0x06000000])) = expand8to16(data);
+        u32 offset = (address & ~1) - 0x06000000;
+        GBA_MemoryWriteVideo16(&Mem.vram[offset], expand8to16(data));
+        GBA_VideoInvalidateVRAM(offset);
+        GBA_MemoryDirtySet(gba_dirty_vram, offset);
         return;
     }
     if (address < 0x07000000)
         return;
     if (address < 0x08000000)
     {
-        *((u16 *)&(Mem.oam[address & 0x3FE])) = expand8to16(data);
+        GBA_MemoryWriteVideo16(&Mem.oam[address & 0x3FE], expand8to16(data));
+        GBA_MemoryDirtySet(gba_dirty_oam, address & 0x3FE);
+        return;
+    }
+    if (GBA_MemoryInGPIO(address))
+    {
+        // The registers are only 4 bits wide
+        if ((address & 1) == 0)
+            GBA_MemoryWriteGPIO16(address, data);
         return;
     }
 
@@ -615,331 +1217,576 @@ void GBA_MemoryWrite8(u32 address, u8 data)
 
 //------------------------------------------------------------------------------
 
-void GBA_RegisterWrite32(u32 address, u32 data)
+// Returns a pointer to the memory at "address" if it belongs to a plain memory
+// region, NULL otherwise. "left" is set to the number of bytes from "address"
+// to the end of the region (or of its mirror).
+static u8 *GBA_MemoryRegionPointer(u32 address, u32 *left, int write)
 {
-    GBA_RegisterWrite16(address, (u16)data);
-    GBA_RegisterWrite16(address + 2, (u16)(data >> 16));
+    u32 offset;
+
+    switch (address >> 24)
+    {
+        case 2:
+            offset = address & 0x3FFFF;
+            *left = sizeof(Mem.ewram) - offset;
+            return &Mem.ewram[offset];
+        case 3:
+            offset = address & 0x7FFF;
+            *left = sizeof(Mem.iwram) - offset;
+            return &Mem.iwram[offset];
+        case 5:
+            offset = address & 0x3FF;
+            *left = sizeof(Mem.pal_ram) - offset;
+            return &Mem.pal_ram[offset];
+        case 6:
+            offset = address - 0x06000000;
+            if (offset >= 0x18000)
+                return NULL;
+            *left = 0x18000 - offset;
+            return &Mem.vram[offset];
+        case 7:
+            offset = address & 0x3FF;
+            *left = sizeof(Mem.oam) - offset;
+            return &Mem.oam[offset];
+        case 8:
+        case 9:
+        case 0xA:
+        case 0xB:
+        case 0xC: // 0xD may have the EEPROM mapped at the end
+            if (write)
+                return NULL;
+            offset = address & 0x01FFFFFF;
+            *left = 0x02000000 - offset;
+            if ((offset < GBA_GPIO_ADDRESS_END) && GBA_GPIOIsReadable())
+            {
+                if (offset >= GBA_GPIO_ADDRESS_START)
+                    return NULL;
+                *left = GBA_GPIO_ADDRESS_START - offset;
+            }
+            return &Mem.rom_wait0[offset];
+        default:
+            return NULL;
+    }
 }
 
-u32 GBA_RegisterRead32(u32 address)
+// Returns 1 if a block access to [address, address + size) has to be done one
+// unit at a time through the memory handlers so that watchpoints are checked
+// and the heatmap counts the accesses.
+static int GBA_MemoryBlockIsWatched(u32 address, u32 size, int write)
 {
-    return ((u32)GBA_RegisterRead16(address))
-           | (((u32)GBA_RegisterRead16(address + 2)) << 16);
+    int type = write ? GBA_WATCH_WRITE : GBA_WATCH_READ;
+
+    // Every access of the block has to be counted
+    if (heatmap_enabled)
+        return 1;
+
+    if ((gba_watchpoint_types & type) == 0)
+        return 0;
+
+    return GBA_DebugWatchpointInRange(address, size, type);
 }
 
-void GBA_RegisterWrite16(u32 address, u16 data)
+// Returns a pointer to the memory of [address, address + size) if it is all in
+// the same plain memory region and it doesn't cross the end of a mirror, NULL
+// otherwise.
+static u8 *GBA_MemoryBlockPointer(u32 address, u32 size, int write)
 {
-    if (address & 0x00FFFC00) // >= 4000400
-        return;
+    u32 left;
+    u8 *ptr = GBA_MemoryRegionPointer(address, &left, write);
+    if ((ptr == NULL) || (left < size))
+        return NULL;
+    if (GBA_MemoryBlockIsWatched(address, size, write))
+        return NULL;
+    return ptr;
+}
+
+// Does the same as the individual writes to [address, address + size) would do
+// apart from writing the data.
+static void GBA_MemoryBlockWritten(u32 address, u32 size, int changed)
+{
+    u32 end;
 
-    switch (address & 0x3FF)
+    gba_idle_loop_memory_written = 1;
+
+    switch (address >> 24)
     {
-        case DISPCNT - REG_BASE:
-            REG_DISPCNT = data;
-            GBA_UpdateDrawScanlineFn();
-            GBA_ExecutionBreak();
+        case 2:
+            end = (address & 0x3FFFF) + size;
+            for (u32 a = address & 0x3FFFF; a < end;
+                 a += GBA_CODE_CACHE_BLOCK_SIZE)
+            {
+                GBA_CodeCacheInvalidateEWRAM(a);
+            }
+            GBA_CodeCacheInvalidateEWRAM(end - 1);
             return;
+        case 3:
+            end = (address & 0x7FFF) + size;
+            for (u32 a = address & 0x7FFF; a < end;
+                 a += GBA_CODE_CACHE_BLOCK_SIZE)
+            {
+                GBA_CodeCacheInvalidateIWRAM(a);
+            }
+            GBA_CodeCacheInvalidateIWRAM(end - 1);
+            return;
+        case 5:
+            end = (address & 0x3FF) + size;
+            for (u32 o = address & 0x3FF; o < end; o += 2)
+                GBA_MemoryDirtySet(gba_dirty_pal, o);
+            break;
+        case 6:
+            end = (address - 0x06000000) + size;
+            for (u32 o = address - 0x06000000; o < end; o += 2)
+            {
+                GBA_VideoInvalidateVRAM(o);
+                GBA_MemoryDirtySet(gba_dirty_vram, o);
+            }
+            break;
+        case 7:
+            end = (address & 0x3FF) + size;
+            for (u32 o = address & 0x3FF; o < end; o += 2)
+                GBA_MemoryDirtySet(gba_dirty_oam, o);
+            break;
+        default:
+            return;
+    }
+
+    // Only palette, VRAM and OAM get here
+    if (changed)
+        gba_video_memory_version++;
+}
+
+const u8 *GBA_MemoryGetReadPointer(u32 address, u32 size)
+{
+    return GBA_MemoryBlockPointer(address, size, 0);
+}
+
+const u8 *GBA_MemoryGetReadRegion(u32 address, u32 *size)
+{
+    const u8 *ptr = GBA_MemoryRegionPointer(address, size, 0);
+    if ((ptr != NULL) && GBA_MemoryBlockIsWatched(address, *size, 0))
+        return NULL;
+    return ptr;
+}
+
+u8 *GBA_MemoryGetWritePointer(u32 address, u32 size)
+{
+    return GBA_MemoryBlockPointer(address, size, 1);
+}
+
+void GBA_MemoryBlockModified(u32 address, u32 size)
+{
+    if (size > 0)
+        GBA_MemoryBlockWritten(address, size, 1);
+}
+
+int GBA_MemoryCopyBlock(u32 dst, s32 dstadd, u32 src, s32 srcadd,
+                        u32 count, u32 unit)
+{
+    if (count == 0)
+        return 0;
+
+    u32 size = count * unit;
+
+    // Lowest address of each block
+    u32 dst_lo = dst;
+    u32 src_lo = src;
+
+    if (dstadd == -(s32)unit)
+        dst_lo = dst - (size - unit);
+    else if (dstadd != (s32)unit)
+        return 0;
 
-        case DISPSTAT - REG_BASE:
-            if ((data >> 8) == (REG_DISPSTAT >> 8)) // Same lyc as before
+    if (srcadd == -(s32)unit)
+        src_lo = src - (size - unit);
+    else if ((srcadd != (s32)unit) && (srcadd != 0))
+        return 0;
+
+    u8 *dstp = GBA_MemoryBlockPointer(dst_lo, size, 1);
+    if (dstp == NULL)
+        return 0;
+
+    u8 *srcp = GBA_MemoryBlockPointer(src_lo, (srcadd == 0) ? unit : size, 0);
+    if (srcp == NULL)
+        return 0;
+
+    int changed = 0;
+
+    if (srcadd == 0)
+    {
+        // Fill. Writing the value to the source doesn't change it, so it
+        // doesn't matter if the source is inside the destination.
+        if (unit == 4)
+        {
+            u32 value = *(u32 *)srcp;
+            for (u32 i = 0; i < size; i += 4)
             {
-                REG_DISPSTAT = (REG_DISPSTAT & 0x0007) | (data & 0xFFF8);
+                changed |= *(u32 *)&dstp[i] != value;
+                *(u32 *)&dstp[i] = value;
             }
-            else
+        }
+        else
+        {
+            u16 value = *(u16 *)srcp;
+            for (u32 i = 0; i < size; i += 2)
             {
-                REG_DISPSTAT = (REG_DISPSTAT & 0x0007) | (data & 0xFFF8);
-                if ((REG_DISPSTAT >> 8) == REG_VCOUNT)
-                {
-                    REG_DISPSTAT |= BIT(2);
-                    GBA_InterruptLCD(BIT(5));
-                }
-                else
-                {
-                    REG_DISPSTAT &= ~BIT(2);
-                }
+                changed |= *(u16 *)&dstp[i] != value;
+                *(u16 *)&dstp[i] = value;
             }
+        }
+    }
+    else
+    {
+        if (srcadd != dstadd)
+            return 0;
 
-            GBA_ExecutionBreak();
-            return;
+        // Copying one unit at a time only gives the same result as memmove()
+        // if no unit is written before being read.
+        uintptr_t d = (uintptr_t)dstp;
+        uintptr_t s = (uintptr_t)srcp;
+        int overlap = (d < s + size) && (s < d + size);
 
-        case VCOUNT - REG_BASE:
-        case KEYINPUT - REG_BASE:
-            return; // Read only
+        if (overlap)
+        {
+            if ((srcadd > 0) && (s < d))
+                return 0;
+            if ((srcadd < 0) && (d < s))
+                return 0;
 
-        case BG0HOFS - REG_BASE:
-            REG_BG0HOFS = data & 0x1FF;
-            return;
-        case BG0VOFS - REG_BASE:
-            REG_BG0VOFS = data & 0x1FF;
-            return;
-        case BG1HOFS - REG_BASE:
-            REG_BG1HOFS = data & 0x1FF;
-            return;
-        case BG1VOFS - REG_BASE:
-            REG_BG1VOFS = data & 0x1FF;
-            return;
-        case BG2HOFS - REG_BASE:
-            REG_BG2HOFS = data & 0x1FF;
-            return;
-        case BG2VOFS - REG_BASE:
-            REG_BG2VOFS = data & 0x1FF;
-            return;
-        case BG3HOFS - REG_BASE:
-            REG_BG3HOFS = data & 0x1FF;
-            return;
-        case BG3VOFS - REG_BASE:
-            REG_BG3VOFS = data & 0x1FF;
-            return;
+            changed = (d != s);
+        }
+        else
+        {
+            changed = memcmp(dstp, srcp, size) != 0;
+        }
 
-        case BG2X_L - REG_BASE:
-            REG_BG2X_L = data;
-            GBA_VideoUpdateRegister(BG2X_L);
-            return;
-        case BG2X_H - REG_BASE:
-            REG_BG2X_H = data & 0x0FFF;
-            GBA_VideoUpdateRegister(BG2X_H);
-            return;
-        case BG2Y_L - REG_BASE:
-            REG_BG2Y_L = data;
-            GBA_VideoUpdateRegister(BG2Y_L);
-            return;
-        case BG2Y_H - REG_BASE:
-            REG_BG2Y_H = data & 0x0FFF;
-            GBA_VideoUpdateRegister(BG2Y_H);
-            return;
+        if (changed)
+            memmove(dstp, srcp, size);
+    }
 
-        case BG3X_L - REG_BASE:
-            REG_BG3X_L = data;
-            GBA_VideoUpdateRegister(BG3X_L);
-            return;
-        case BG3X_H - REG_BASE:
-            REG_BG3X_H = data & 0x0FFF;
-            GBA_VideoUpdateRegister(BG3X_H);
-            return;
-        case BG3Y_L - REG_BASE:
-            REG_BG3Y_L = data;
-            GBA_VideoUpdateRegister(BG3Y_L);
-            return;
-        case BG3Y_H - REG_BASE:
-            REG_BG3Y_H = data & 0x0FFF;
-            GBA_VideoUpdateRegister(BG3Y_H);
-            return;
+    GBA_MemoryBlockWritten(dst_lo, size, changed);
 
-        case WIN0H - REG_BASE:
-            REG_WIN0H = data;
-            GBA_VideoUpdateRegister(WIN0H);
-            return;
-        case WIN0V - REG_BASE:
-            REG_WIN0V = data;
-            GBA_VideoUpdateRegister(WIN0V);
-            return;
-        case WIN1H - REG_BASE:
-            REG_WIN1H = data;
-            GBA_VideoUpdateRegister(WIN1H);
-            return;
-        case WIN1V - REG_BASE:
-            REG_WIN1V = data;
-            GBA_VideoUpdateRegister(WIN1V);
-            return;
-        case WININ - REG_BASE:
-            REG_WININ = data;
-            GBA_VideoUpdateRegister(WININ);
-            return;
-        case WINOUT - REG_BASE:
-            REG_WINOUT = data;
-            GBA_VideoUpdateRegister(WINOUT);
-            return;
-        case MOSAIC - REG_BASE:
-            REG_MOSAIC = data;
-            GBA_VideoUpdateRegister(MOSAIC);
-            return;
+    return 1;
+}
 
-//        extern s32 scrclocks;
-//        case BLDCNT - REG_BASE:
-//            REG_BLDCNT = data;
-//            Debug_DebugMsgArg("CNT %d", scrclocks);
-//            return;
-//        case BLDALPHA - REG_BASE:
-//            REG_BLDALPHA = data;
-//            Debug_DebugMsgArg("ALPHA %d", scrclocks);
-//            return;
-//        case BLDY - REG_BASE:
-//            REG_BLDY = data;
-//            Debug_DebugMsgArg("Y %d", scrclocks);
-//            return;
-
-        case DMA0CNT_H - REG_BASE:
-            REG_DMA0CNT_H = data;
-            GBA_DMA0Setup();
-            GBA_ExecutionBreak();
-            return;
-        case DMA1CNT_H - REG_BASE:
-            REG_DMA1CNT_H = data;
-            GBA_DMA1Setup();
-            GBA_ExecutionBreak();
-            return;
-        case DMA2CNT_H - REG_BASE:
-            REG_DMA2CNT_H = data;
-            GBA_DMA2Setup();
-            GBA_ExecutionBreak();
-            return;
-        case DMA3CNT_H - REG_BASE:
-            REG_DMA3CNT_H = data;
-            GBA_DMA3Setup();
-            GBA_ExecutionBreak();
-            return;
+//------------------------------------------------------------------------------
 
-        case TM0CNT_L - REG_BASE:
-            GBA_TimerSetStart0(data);
-            GBA_ExecutionBreak();
-            return;
-        case TM0CNT_H - REG_BASE:
-            REG_TM0CNT_H = data;
-            GBA_TimerSetup0();
-            GBA_ExecutionBreak();
-            return;
-        case TM1CNT_L - REG_BASE:
-            GBA_TimerSetStart1(data);
-            GBA_ExecutionBreak();
-            return;
-        case TM1CNT_H - REG_BASE:
-            REG_TM1CNT_H = data;
-            GBA_TimerSetup1();
-            GBA_ExecutionBreak();
-            return;
-        case TM2CNT_L - REG_BASE:
-            GBA_TimerSetStart2(data);
-            GBA_ExecutionBreak();
-            return;
-        case TM2CNT_H - REG_BASE:
-            REG_TM2CNT_H = data;
-            GBA_TimerSetup2();
-            GBA_ExecutionBreak();
-            return;
-        case TM3CNT_L - REG_BASE:
-            GBA_TimerSetStart3(data);
-            GBA_ExecutionBreak();
-            return;
-        case TM3CNT_H - REG_BASE:
-            REG_TM3CNT_H = data;
-            GBA_TimerSetup3();
-            GBA_ExecutionBreak();
-            return;
+// Writes to the I/O registers are dispatched through a table with one entry per
+// 16-bit register. The data is masked with the writable bits of the register
+// before calling the handler. Some pairs of registers also have a 32-bit
+// handler so that 32-bit writes don't need to be split in two.
 
-        case SOUND1CNT_L - REG_BASE:
-            REG_SOUND1CNT_L = data;
-            GBA_SoundRegWrite16(SOUND1CNT_L, data);
-            return;
-        case SOUND1CNT_H - REG_BASE:
-            REG_SOUND1CNT_H = data;
-            GBA_SoundRegWrite16(SOUND1CNT_H, data);
-            return;
-        case SOUND1CNT_X - REG_BASE:
-            REG_SOUND1CNT_X = data;
-            GBA_SoundRegWrite16(SOUND1CNT_X, data);
-            return;
-        case SOUND2CNT_L - REG_BASE:
-            REG_SOUND2CNT_L = data;
-            GBA_SoundRegWrite16(SOUND2CNT_L, data);
-            return;
-        case SOUND2CNT_H - REG_BASE:
-            REG_SOUND2CNT_H = data;
-            GBA_SoundRegWrite16(SOUND2CNT_H, data);
-            return;
-        case SOUND3CNT_L - REG_BASE:
-            REG_SOUND3CNT_L = data;
-            GBA_SoundRegWrite16(SOUND3CNT_L, data);
-            return;
-        case SOUND3CNT_H - REG_BASE:
-            REG_SOUND3CNT_H = data;
-            GBA_SoundRegWrite16(SOUND3CNT_H, data);
-            return;
-        case SOUND3CNT_X - REG_BASE:
-            REG_SOUND3CNT_X = data;
-            GBA_SoundRegWrite16(SOUND3CNT_X, data);
-            return;
-        case SOUND4CNT_L - REG_BASE:
-            REG_SOUND4CNT_L = data;
-            GBA_SoundRegWrite16(SOUND4CNT_L, data);
-            return;
-        case SOUND4CNT_H - REG_BASE:
-            REG_SOUND4CNT_H = data;
-            GBA_SoundRegWrite16(SOUND4CNT_H, data);
-            return;
-        case SOUNDCNT_L - REG_BASE:
-            REG_SOUNDCNT_L = data;
-            GBA_SoundRegWrite16(SOUNDCNT_L, data);
-            return;
-        case SOUNDCNT_H - REG_BASE:
-            REG_SOUNDCNT_H = data;
-            GBA_SoundRegWrite16(SOUNDCNT_H, data);
-            return;
-        case SOUNDCNT_X - REG_BASE:
-            REG_SOUNDCNT_X &= 0x000F;
-            REG_SOUNDCNT_X |= data & 0xFFF0;
-            GBA_SoundRegWrite16(SOUNDCNT_X, data & 0xFFF0);
-            return;
-        case SOUNDBIAS - REG_BASE:
-            REG_SOUNDBIAS = data;
-            GBA_SoundRegWrite16(SOUNDBIAS, data);
-            return;
-        case FIFO_A + 0 - REG_BASE:
-            REG_16(FIFO_A + 0) = data;
-            GBA_SoundRegWrite16(FIFO_A + 0, data);
-            return;
-        case FIFO_A + 2 - REG_BASE:
-            REG_16(FIFO_A + 2) = data;
-            GBA_SoundRegWrite16(FIFO_A + 2, data);
-            return;
-        case FIFO_B + 0 - REG_BASE:
-            REG_16(FIFO_B + 0) = data;
-            GBA_SoundRegWrite16(FIFO_B + 0, data);
-            return;
-        case FIFO_B + 2 - REG_BASE:
-            REG_16(FIFO_B + 2) = data;
-            GBA_SoundRegWrite16(FIFO_B + 2, data);
-            return;
-        case WAVE_RAM + 0 - REG_BASE:
-        case WAVE_RAM + 2 - REG_BASE:
-        case WAVE_RAM + 4 - REG_BASE:
-        case WAVE_RAM + 6 - REG_BASE:
-        case WAVE_RAM + 8 - REG_BASE:
-        case WAVE_RAM + 10 - REG_BASE:
-        case WAVE_RAM + 12 - REG_BASE:
-        case WAVE_RAM + 14 - REG_BASE:
-            REG_16(address) = data;
-            GBA_SoundRegWrite16(address, data);
-            return;
+typedef void (*gba_register_write16_fn)(u32 address, u16 data);
+typedef void (*gba_register_write32_fn)(u32 address, u32 data);
 
-        case IE - REG_BASE:
-            REG_IE = data;
-            GBA_ExecutionBreak();
-            return;
-        case IF - REG_BASE:
-            REG_IF &= ~data;
-            return;
-        case WAITCNT:
-            REG_WAITCNT = data;
-            GBA_MemoryAccessCyclesUpdate();
-            return;
-        case IME - REG_BASE:
-            REG_IME = data;
-            GBA_ExecutionBreak();
-            return;
-        case POSTFLG - REG_BASE: // POSTFLG + HALTCNT
-            REG_POSTFLG = (u8)data;
-            REG_HALTCNT = (u8)(data >> 8);
-            GBA_CPUSetHalted((u8)(data >> 8));
-            GBA_ExecutionBreak();
-            return;
+typedef struct
+{
+    gba_register_write16_fn write;
+    u16 mask;
+} _gba_register_t;
 
-        case 0x4000128 - REG_BASE:
-            return;
+static core_local__ _gba_register_t gba_register_table[0x400 / 2];
 
-        default:
-            REG_16(address) = data;
-            return;
+// NULL if 32-bit writes have to be split into two 16-bit writes
+static core_local__ gba_register_write32_fn gba_register_table_32[0x400 / 4];
+
+static void (*const gba_dma_setup[4])(void) = {
+    GBA_DMA0Setup, GBA_DMA1Setup, GBA_DMA2Setup, GBA_DMA3Setup
+};
+
+static void (*const gba_timer_set_start[4])(u16) = {
+    GBA_TimerSetStart0, GBA_TimerSetStart1,
+    GBA_TimerSetStart2, GBA_TimerSetStart3
+};
+
+static void (*const gba_timer_setup[4])(void) = {
+    GBA_TimerSetup0, GBA_TimerSetup1, GBA_TimerSetup2, GBA_TimerSetup3
+};
+
+//------------------------------------------------------------------------------
+
+static void GBA_RegisterWriteStore(u32 address, u16 data)
+{
+    REG_16(address) = data;
+}
+
+static void GBA_RegisterWriteIgnore(unused__ u32 address, unused__ u16 data)
+{
+    // Read only
+}
+
+static void GBA_RegisterWriteDISPCNT(unused__ u32 address, u16 data)
+{
+    REG_DISPCNT = data;
+    GBA_UpdateDrawScanlineFn();
+    GBA_ExecutionBreak(PROFILE_SLICE_PPU);
+}
+
+static void GBA_RegisterWriteDISPSTAT(unused__ u32 address, u16 data)
+{
+    if ((data >> 8) == (REG_DISPSTAT >> 8)) // Same lyc as before
+    {
+        REG_DISPSTAT = (REG_DISPSTAT & 0x0007) | data;
+    }
+    else
+    {
+        REG_DISPSTAT = (REG_DISPSTAT & 0x0007) | data;
+        if ((REG_DISPSTAT >> 8) == REG_VCOUNT)
+        {
+            REG_DISPSTAT |= BIT(2);
+            GBA_InterruptLCD(BIT(5));
+        }
+        else
+        {
+            REG_DISPSTAT &= ~BIT(2);
+        }
+    }
+
+    GBA_ExecutionBreak(PROFILE_SLICE_PPU);
+}
+
+static void GBA_RegisterWriteVideo(u32 address, u16 data)
+{
+    REG_16(address) = data;
+    GBA_VideoUpdateRegister(address);
+}
+
+static void GBA_RegisterWriteDMACNT_H(u32 address, u16 data)
+{
+    REG_16(address) = data;
+    gba_dma_setup[(address - DMA0CNT_H) / 12]();
+    GBA_ExecutionBreak(PROFILE_SLICE_DMA);
+}
+
+static void GBA_RegisterWriteTMCNT_L(u32 address, u16 data)
+{
+    gba_timer_set_start[(address - TM0CNT_L) / 4](data);
+    GBA_ExecutionBreak(PROFILE_SLICE_TIMERS);
+}
+
+static void GBA_RegisterWriteTMCNT_H(u32 address, u16 data)
+{
+    REG_16(address) = data;
+    gba_timer_setup[(address - TM0CNT_H) / 4]();
+    GBA_ExecutionBreak(PROFILE_SLICE_TIMERS);
+}
+
+static void GBA_RegisterWriteSound(u32 address, u16 data)
+{
+    REG_16(address) = data;
+    GBA_SoundRegWrite16(address, data);
+}
+
+static void GBA_RegisterWriteSOUNDCNT_X(unused__ u32 address, u16 data)
+{
+    REG_SOUNDCNT_X = (REG_SOUNDCNT_X & 0x000F) | data;
+    GBA_SoundRegWrite16(SOUNDCNT_X, data);
+}
+
+static void GBA_RegisterWriteSIOCNT(unused__ u32 address, u16 data)
+{
+    GBA_SIOWriteSIOCNT(data);
+    GBA_ExecutionBreak(PROFILE_SLICE_SERIAL);
+}
+
+static void GBA_RegisterWriteIE(unused__ u32 address, u16 data)
+{
+    REG_IE = data;
+    GBA_InterruptPendingUpdate();
+    GBA_ExecutionBreak(PROFILE_SLICE_IRQ);
+}
+
+static void GBA_RegisterWriteIF(unused__ u32 address, u16 data)
+{
+    REG_IF &= ~data;
+    GBA_InterruptPendingUpdate();
+}
+
+static void GBA_RegisterWriteBreak(u32 address, u16 data)
+{
+    REG_16(address) = data;
+    GBA_ExecutionBreak(PROFILE_SLICE_IO);
+}
+
+static void GBA_RegisterWriteWAITCNT(unused__ u32 address, u16 data)
+{
+    REG_WAITCNT = data;
+    GBA_MemoryAccessCyclesUpdate();
+}
+
+static void GBA_RegisterWritePOSTFLG(unused__ u32 address, u16 data)
+{
+    // POSTFLG + HALTCNT
+    REG_POSTFLG = (u8)data;
+    REG_HALTCNT = (u8)(data >> 8);
+    GBA_CPUSetHalted((u8)(data >> 8));
+    GBA_ExecutionBreak(PROFILE_SLICE_IO);
+}
+
+//------------------------------------------------------------------------------
+
+static void GBA_RegisterWrite32Store(u32 address, u32 data)
+{
+    REG_32(address) = data;
+}
+
+static void GBA_RegisterWrite32DMACNT(u32 address, u32 data)
+{
+    REG_32(address) = data;
+    gba_dma_setup[(address - DMA0CNT_L) / 12]();
+    GBA_ExecutionBreak(PROFILE_SLICE_DMA);
+}
+
+static void GBA_RegisterWrite32TMCNT(u32 address, u32 data)
+{
+    int timer = (address - TM0CNT_L) / 4;
+
+    gba_timer_set_start[timer]((u16)data);
+    REG_16(address + 2) = (u16)(data >> 16);
+    gba_timer_setup[timer]();
+    GBA_ExecutionBreak(PROFILE_SLICE_TIMERS);
+}
+
+static void GBA_RegisterWrite32FIFO(u32 address, u32 data)
+{
+    REG_32(address) = data;
+    GBA_SoundRegWrite16(address, (u16)data);
+    GBA_SoundRegWrite16(address + 2, (u16)(data >> 16));
+}
+
+//------------------------------------------------------------------------------
+
+static void GBA_RegisterSet(u32 address, gba_register_write16_fn write,
+                            u16 mask)
+{
+    _gba_register_t *reg = &gba_register_table[(address - REG_BASE) >> 1];
+
+    reg->write = write;
+    reg->mask = mask;
+}
+
+static void GBA_RegisterSet32(u32 address, gba_register_write32_fn write)
+{
+    gba_register_table_32[(address - REG_BASE) >> 2] = write;
+}
+
+static void GBA_RegisterTableFill(void)
+{
+    for (u32 i = 0; i < 0x400; i += 2)
+        GBA_RegisterSet(REG_BASE + i, GBA_RegisterWriteStore, 0xFFFF);
+
+    memset(gba_register_table_32, 0, sizeof(gba_register_table_32));
+
+    GBA_RegisterSet(DISPCNT, GBA_RegisterWriteDISPCNT, 0xFFFF);
+    GBA_RegisterSet(DISPSTAT, GBA_RegisterWriteDISPSTAT, 0xFFF8);
+    GBA_RegisterSet(VCOUNT, GBA_RegisterWriteIgnore, 0);
+
+    for (u32 i = BG0HOFS; i <= BG3VOFS; i += 2)
+        GBA_RegisterSet(i, GBA_RegisterWriteStore, 0x01FF);
+
+    GBA_RegisterSet(BG2X_L, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(BG2X_H, GBA_RegisterWriteVideo, 0x0FFF);
+    GBA_RegisterSet(BG2Y_L, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(BG2Y_H, GBA_RegisterWriteVideo, 0x0FFF);
+    GBA_RegisterSet(BG3X_L, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(BG3X_H, GBA_RegisterWriteVideo, 0x0FFF);
+    GBA_RegisterSet(BG3Y_L, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(BG3Y_H, GBA_RegisterWriteVideo, 0x0FFF);
+
+    GBA_RegisterSet(WIN0H, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(WIN1H, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(WIN0V, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(WIN1V, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(WININ, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(WINOUT, GBA_RegisterWriteVideo, 0xFFFF);
+    GBA_RegisterSet(MOSAIC, GBA_RegisterWriteVideo, 0xFFFF);
+
+    GBA_RegisterSet(SOUND1CNT_L, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND1CNT_H, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND1CNT_X, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND2CNT_L, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND2CNT_H, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND3CNT_L, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND3CNT_H, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND3CNT_X, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND4CNT_L, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUND4CNT_H, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUNDCNT_L, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUNDCNT_H, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(SOUNDCNT_X, GBA_RegisterWriteSOUNDCNT_X, 0xFFF0);
+    GBA_RegisterSet(SOUNDBIAS, GBA_RegisterWriteSound, 0xFFFF);
+
+    for (u32 i = WAVE_RAM; i < WAVE_RAM + 16; i += 2)
+        GBA_RegisterSet(i, GBA_RegisterWriteSound, 0xFFFF);
+
+    GBA_RegisterSet(FIFO_A + 0, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(FIFO_A + 2, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(FIFO_B + 0, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet(FIFO_B + 2, GBA_RegisterWriteSound, 0xFFFF);
+    GBA_RegisterSet32(FIFO_A, GBA_RegisterWrite32FIFO);
+    GBA_RegisterSet32(FIFO_B, GBA_RegisterWrite32FIFO);
+
+    for (int i = 0; i < 4; i++)
+    {
+        u32 base = DMA0SAD + (i * 12);
+
+        GBA_RegisterSet(base + 10, GBA_RegisterWriteDMACNT_H, 0xFFFF);
+        GBA_RegisterSet32(base + 0, GBA_RegisterWrite32Store); // SAD
+        GBA_RegisterSet32(base + 4, GBA_RegisterWrite32Store); // DAD
+        GBA_RegisterSet32(base + 8, GBA_RegisterWrite32DMACNT);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        u32 base = TM0CNT_L + (i * 4);
+
+        GBA_RegisterSet(base + 0, GBA_RegisterWriteTMCNT_L, 0xFFFF);
+        GBA_RegisterSet(base + 2, GBA_RegisterWriteTMCNT_H, 0xFFFF);
+        GBA_RegisterSet32(base, GBA_RegisterWrite32TMCNT);
     }
+
+    GBA_RegisterSet(SIOCNT, GBA_RegisterWriteSIOCNT, 0x7FFF);
+
+    GBA_RegisterSet(KEYINPUT, GBA_RegisterWriteIgnore, 0);
+
+    GBA_RegisterSet(IE, GBA_RegisterWriteIE, 0xFFFF);
+    GBA_RegisterSet(IF, GBA_RegisterWriteIF, 0xFFFF);
+    GBA_RegisterSet(IME, GBA_RegisterWriteBreak, 0xFFFF);
+    GBA_RegisterSet(WAITCNT, GBA_RegisterWriteWAITCNT, 0x5FFF);
+    GBA_RegisterSet(POSTFLG, GBA_RegisterWritePOSTFLG, 0xFFFF);
+}
+
+void GBA_RegisterWrite32(u32 address, u32 data)
+{
+    if (address & 0x00FFFC00) // >= 4000400
+        return;
+
+    gba_register_write32_fn write =
+            gba_register_table_32[(address & 0x3FF) >> 2];
+
+    if (write)
+    {
+        write(address, data);
+        return;
+    }
+
+    GBA_RegisterWrite16(address, (u16)data);
+    GBA_RegisterWrite16(address + 2, (u16)(data >> 16));
+}
+
+u32 GBA_RegisterRead32(u32 address)
+{
+    return ((u32)GBA_RegisterRead16(address))
+           | (((u32)GBA_RegisterRead16(address + 2)) << 16);
+}
+
+void GBA_RegisterWrite16(u32 address, u16 data)
+{
+    if (address & 0x00FFFC00) // >= 4000400
+        return;
+
+    const _gba_register_t *reg = &gba_register_table[(address & 0x3FF) >> 1];
+
+    reg->write(address, data & reg->mask);
 }
 
 static const int gbaregister_canread_16[0x400 / 2] = {
@@ -988,6 +1835,14 @@ u16 GBA_RegisterRead16(u32 address)
     if (address & 0x00FFFC00) // >= 4000400
         return 0;
 
+    // The timer counters are updated lazily
+    u32 timer_offset = (address & 0x3FF) - (TM0CNT_L - REG_BASE);
+    if ((timer_offset < 0x10) && ((timer_offset & 2) == 0))
+        GBA_TimersSync();
+
+    if ((address & 0x3FE) == (KEYINPUT - REG_BASE))
+        GBA_InputLatch();
+
     if (gbaregister_canread_16[(address & 0x3FF) >> 1])
         return REG_16(address);
     else
@@ -999,7 +1854,7 @@ void GBA_RegisterWrite8(u32 address, u8 data) // ??????
     if (address == REG_POSTFLG)
     {
         Debug_DebugMsgArg("reg_write_8 REG_POSTFLG (bug)");
-        GBA_ExecutionBreak();
+        GBA_ExecutionBreak(PROFILE_SLICE_OTHER);
     }
     // TODO: Bug: This will enter HALT mode when writing to REG_POSTFLG
     u16 temp = GBA_RegisterRead16(address & ~1);
@@ -1019,21 +1874,11 @@ u8 GBA_RegisterRead8(u32 address)
 
 //------------------------------------------------------------------------------
 
-u32 wait_table_seq[16] = { // Default values
-    0, 0, 2, 0, 0, 0, 0, 0, 2, 2, 4, 4, 8, 8, 4, 4
-};
-u32 wait_table_nonseq[16] = {
-    0, 0, 2, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4, 4
-};
-
-//u32 wait_table_seq[16] = { // Default values
-//    0, 0, 1, 0, 0, 0, 0, 0, 1, 1, 3, 3, 7, 7, 3, 3
-//};
-//u32 wait_table_nonseq[16] = { // Cheated clocks
-//    0, 0, 1, 0, 0, 0, 0, 0, 3, 3, 3, 3, 3, 3, 3, 3
-//};
+core_local__ u32 gba_access_cycles[2][2][16];
+core_local__ u32 gba_fetch_cycles[2][2][16];
 
-const s32 mem_bus_is_16[16] = { // 1 if the address range has a 16-bit bus
+// 1 if the address range has a 16-bit bus
+static const u32 mem_bus_is_16[16] = {
     0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1
 };
 
@@ -1041,51 +1886,100 @@ void GBA_MemoryAccessCyclesUpdate(void)
 {
     u32 data = REG_WAITCNT;
 
+    // Wait states of each region. Only the ones of the game pak can change.
+    u32 wait_seq[16] = {
+        0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+    u32 wait_nonseq[16] = {
+        0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+
     static const u32 sram_wait[4] = { 4, 3, 2, 8 };
     static const u32 rom_wait_nonseq[4] = { 4, 3, 2, 8 };
     static const u32 rom_wait_seq0[2] = { 2, 1 };
     static const u32 rom_wait_seq1[2] = { 4, 1 };
     static const u32 rom_wait_seq2[2] = { 8, 1 };
 
-    //static const u32 sram_wait[4] = { 3, 2, 1, 7 }; // Cheated clocks
-    //static const u32 rom_wait_nonseq[4] = { 3, 2, 1, 7 };
-    //static const u32 rom_wait_seq0[2] = { 1, 0 };
-    //static const u32 rom_wait_seq1[2] = { 3, 0 };
-    //static const u32 rom_wait_seq2[2] = { 7, 0 };
-
+    // 0-1   SRAM Wait Control (0..3 = 4,3,2,8 cycles)
     u32 sram_clocks = sram_wait[data & 3];
-    wait_table_seq[14] = sram_clocks;
-    wait_table_seq[15] = sram_clocks;
-    wait_table_nonseq[14] = sram_clocks;
-    wait_table_nonseq[15] = sram_clocks;
+    wait_seq[14] = sram_clocks;
+    wait_seq[15] = sram_clocks;
+    wait_nonseq[14] = sram_clocks;
+    wait_nonseq[15] = sram_clocks;
 
+    // 2-3   Wait State 0 First Access (0..3 = 4,3,2,8 cycles)
+    // 4     Wait State 0 Second Access (0..1 = 2,1 cycles)
     u32 rom0_nonseq = rom_wait_nonseq[(data >> 2) & 3];
-    wait_table_nonseq[8] = rom0_nonseq;
-    wait_table_nonseq[9] = rom0_nonseq;
+    wait_nonseq[8] = rom0_nonseq;
+    wait_nonseq[9] = rom0_nonseq;
 
     u32 rom0_seq = rom_wait_seq0[(data >> 4) & 1];
-    wait_table_seq[8] = rom0_seq;
-    wait_table_seq[9] = rom0_seq;
+    wait_seq[8] = rom0_seq;
+    wait_seq[9] = rom0_seq;
 
+    // 5-6   Wait State 1 First Access (0..3 = 4,3,2,8 cycles)
+    // 7     Wait State 1 Second Access (0..1 = 4,1 cycles)
     u32 rom1_nonseq = rom_wait_nonseq[(data >> 5) & 3];
-    wait_table_nonseq[10] = rom1_nonseq;
-    wait_table_nonseq[11] = rom1_nonseq;
+    wait_nonseq[10] = rom1_nonseq;
+    wait_nonseq[11] = rom1_nonseq;
 
     u32 rom1_seq = rom_wait_seq1[(data >> 7) & 1];
-    wait_table_seq[10] = rom1_seq;
-    wait_table_seq[11] = rom1_seq;
+    wait_seq[10] = rom1_seq;
+    wait_seq[11] = rom1_seq;
 
+    // 8-9   Wait State 2 First Access (0..3 = 4,3,2,8 cycles)
+    // 10    Wait State 2 Second Access (0..1 = 8,1 cycles)
     u32 rom2_nonseq = rom_wait_nonseq[(data >> 8) & 3];
-    wait_table_nonseq[12] = rom2_nonseq;
-    wait_table_nonseq[13] = rom2_nonseq;
+    wait_nonseq[12] = rom2_nonseq;
+    wait_nonseq[13] = rom2_nonseq;
 
     u32 rom2_seq = rom_wait_seq2[(data >> 10) & 1];
-    wait_table_seq[12] = rom2_seq;
-    wait_table_seq[13] = rom2_seq;
-
-    // TODO: Phi, prefetch, etc...
+    wait_seq[12] = rom2_seq;
+    wait_seq[13] = rom2_seq;
 
     // 11-12 PHI Terminal Output (0..3 = Disable, 4.19MHz, 8.38MHz, 16.78MHz)
+    // Nothing that is emulated is connected to it.
+
+    for (int i = 0; i < 16; i++)
+    {
+        u32 nonseq = wait_nonseq[i] + 1;
+        u32 seq = wait_seq[i] + 1;
+
+        gba_access_cycles[0][0][i] = nonseq;
+        gba_access_cycles[1][0][i] = seq;
+
+        // A 32-bit access to a 16-bit bus is split in two accesses, and the
+        // second one is sequential.
+        if (mem_bus_is_16[i])
+        {
+            gba_access_cycles[0][1][i] = nonseq + seq;
+            gba_access_cycles[1][1][i] = seq + seq;
+        }
+        else
+        {
+            gba_access_cycles[0][1][i] = nonseq;
+            gba_access_cycles[1][1][i] = seq;
+        }
+    }
+
+    memcpy(gba_fetch_cycles, gba_access_cycles, sizeof(gba_fetch_cycles));
+
     // 14    Game Pak Prefetch Buffer (Pipe) (0=Disable, 1=Enable)
+    //
+    // While the CPU runs code from the ROM, the buffer reads the next halfwords
+    // whenever the CPU isn't using the game pak bus. Sequential opcodes are
+    // then read from the buffer in one clock per halfword instead of waiting
+    // for the ROM. How full the buffer is isn't tracked, it's considered to be
+    // always ahead of the CPU. Jumps empty it, so non-sequential fetches cost
+    // the same as without it.
+    if (data & BIT(14))
+    {
+        for (int i = 8; i < 14; i++)
+        {
+            gba_fetch_cycles[1][0][i] = 1;
+            gba_fetch_cycles[1][1][i] = 2;
+        }
+    }
+
     // 15    Game Pak Type Flag (Read Only) (0=GBA, 1=CGB) (IN35 signal)
 }
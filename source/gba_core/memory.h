@@ -9,31 +9,117 @@
 
 #include "gba.h"
 
-extern _mem_t Mem;
+extern core_local__ _mem_t Mem;
 
 //----------------------------------------------------------------------
 
-void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize);
+// If rom_in_place is 1 the ROM buffer is used directly, see GBA_InitRomInPlace()
+void GBA_MemoryInit(u32 *bios_ptr, u32 *rom_ptr, u32 romsize,
+                    int rom_in_place);
 void GBA_MemoryEnd(void);
 
+// The save memory has to be loaded before calling GBA_MemoryStateLoad()
+void GBA_MemoryStateSave(_savestate_t *st);
+void GBA_MemoryStateLoad(_savestate_t *st);
+
 //----------------------------------------------------------------------
 
 u32 GBA_MemoryReadFast32(u32 address); // They don't do any checking
 u16 GBA_MemoryReadFast16(u32 address);
 u8 GBA_MemoryReadFast8(u32 address);
-//void GBA_MemoryWriteFast32(u32 address,u32 data); // They don't work right
-//void GBA_MemoryWriteFast16(u32 address,u16 data);
-//void GBA_MemoryWriteFast8(u32 address,u8 data);
+
+// Returns the memory of the GBA_CODE_CACHE_BLOCK_SIZE bytes block that contains
+// the address, so that the interpreters can fetch the instructions of the block
+// without looking up the address every time. Unmapped blocks read as zero.
+const void *GBA_MemoryFetchBlock(u32 address);
 
 u32 GBA_MemoryRead32(u32 address);
 void GBA_MemoryWrite32(u32 address, u32 data);
 
+// Same as reading or writing "count" consecutive words starting at "address"
+// (aligned to 4) with the functions above, used by LDM and STM. If all of them
+// are in the same page of plain RAM or ROM, the page is only looked up once.
+void GBA_MemoryRead32Multiple(u32 address, u32 *data, u32 count);
+void GBA_MemoryWrite32Multiple(u32 address, const u32 *data, u32 count);
+
 u16 GBA_MemoryRead16(u32 address);
 void GBA_MemoryWrite16(u32 address, u16 data);
 
 u8 GBA_MemoryRead8(u32 address);
 void GBA_MemoryWrite8(u32 address, u8 data);
 
+// Copies "count" units of "unit" bytes (2 or 4) the same way as a DMA transfer,
+// adding "srcadd" and "dstadd" to the addresses after each unit. It only does
+// it if both blocks are in plain memory (EWRAM, IWRAM, palette, VRAM, OAM, and
+// ROM as source) and the transfer can be done with memmove() or a fill. It
+// returns 1 if the block has been copied, 0 if the caller has to copy it one
+// unit at a time. The addresses are expected to be aligned to "unit".
+int GBA_MemoryCopyBlock(u32 dst, s32 dstadd, u32 src, s32 srcadd,
+                        u32 count, u32 unit);
+
+// Returns a pointer to the data of [address, address + size) if it can be read
+// directly from the same plain memory region, NULL otherwise.
+const u8 *GBA_MemoryGetReadPointer(u32 address, u32 size);
+// Same as GBA_MemoryGetReadPointer(), but it returns in "size" the number of
+// bytes that can be read from the pointer.
+const u8 *GBA_MemoryGetReadRegion(u32 address, u32 *size);
+
+// Returns a pointer to [address, address + size) if it can be written directly
+// with 16 and 32-bit accesses, NULL otherwise. Only EWRAM and IWRAM behave the
+// same way with 8-bit accesses. After writing to it, the caller must call
+// GBA_MemoryBlockModified() with the range that has been modified.
+u8 *GBA_MemoryGetWritePointer(u32 address, u32 size);
+void GBA_MemoryBlockModified(u32 address, u32 size);
+
+// Has to be called when the watchpoints change (see disassembler.h)
+void GBA_MemoryWatchpointsUpdated(void);
+
+// Starts or stops counting the accesses to each region (see heatmap_utils.h).
+// The instructions that the CPU fetches aren't counted, they are read from the
+// code cache.
+void GBA_MemoryHeatmapSetEnabled(int enabled);
+
+//----------------------------------------------------------------------
+
+// Palette, VRAM and OAM are divided in pages of 512 bytes. Each page has one
+// bit for each user of this information (renderer caches, debugger windows...).
+// Writing to a page sets all of its bits, and each user clears its own bits
+// when it checks for changes.
+
+#define GBA_DIRTY_PAGE_SHIFT    9
+
+typedef enum
+{
+    GBA_DIRTY_PAL,
+    GBA_DIRTY_VRAM,
+    GBA_DIRTY_OAM,
+
+    GBA_DIRTY_REGION_NUMBER
+} _gba_dirty_region_e;
+
+#define GBA_DIRTY_USER_VIDEO        BIT(0) // Sprite lists of the renderer
+#define GBA_DIRTY_USER_TILEVIEWER   BIT(1) // Debugger windows
+#define GBA_DIRTY_USER_MAPVIEWER    BIT(2)
+#define GBA_DIRTY_USER_SPRVIEWER    BIT(3)
+#define GBA_DIRTY_USER_PALVIEWER    BIT(4)
+
+extern core_local__ u8
+        gba_dirty_pal[sizeof(Mem.pal_ram) >> GBA_DIRTY_PAGE_SHIFT];
+extern core_local__ u8 gba_dirty_vram[sizeof(Mem.vram) >> GBA_DIRTY_PAGE_SHIFT];
+extern core_local__ u8 gba_dirty_oam[sizeof(Mem.oam) >> GBA_DIRTY_PAGE_SHIFT];
+
+static inline void GBA_MemoryDirtySet(u8 *pages, u32 offset)
+{
+    pages[offset >> GBA_DIRTY_PAGE_SHIFT] = 0xFF;
+}
+
+void GBA_MemoryDirtySetAll(_gba_dirty_region_e region);
+
+// Returns 1 if any page in the range has been written since the last time the
+// user checked it, and clears the bits of the user in that range.
+int GBA_MemoryDirtyCheck(_gba_dirty_region_e region, u32 user,
+                         u32 offset, u32 size);
+
 //----------------------------------------------------------------------
 
 void GBA_RegisterWrite32(u32 address, u32 data);
@@ -47,73 +133,50 @@ u8 GBA_RegisterRead8(u32 address);
 
 void GBA_MemoryAccessCyclesUpdate(void);
 
-extern u32 wait_table_seq[];
-extern u32 wait_table_nonseq[];
-extern const s32 mem_bus_is_16[];
+// Clocks that an access takes, indexed by [seq][32bit][region], where the
+// region is (address >> 24) & 0xF. They are rebuilt when WAITCNT is written.
+extern core_local__ u32 gba_access_cycles[2][2][16];
+// Same for the opcode fetches, which may be read from the prefetch buffer
+extern core_local__ u32 gba_fetch_cycles[2][2][16];
+
+static inline u32 GBA_MemoryGetFetchCycles(u32 seq, u32 _32bit, u32 address)
+{
+    return gba_fetch_cycles[seq][_32bit][(address >> 24) & 0xF];
+}
 
 static inline u32 GBA_MemoryGetAccessCycles(u32 seq, u32 _32bit, u32 address)
 {
-    //if ((address & 0x1FFFF) == 0)
-    //    seq = 0;
-    u32 index = (address >> 24) & 0xF;
-    u32 doubletime = _32bit && mem_bus_is_16[index];
-    if (seq)
-    {
-        return (wait_table_seq[index] + 1) << doubletime;
-    }
-    else
-    {
-        if (doubletime)
-            return (wait_table_seq[index] + wait_table_nonseq[index] + 2);
-        else
-            return (wait_table_nonseq[index] + 1);
-    }
+    return gba_access_cycles[seq][_32bit][(address >> 24) & 0xF];
 }
 
 static inline u32 GBA_MemoryGetAccessCyclesNoSeq(u32 _32bit, u32 address)
 {
-    u32 index = (address >> 24) & 0xF;
-    if (_32bit && mem_bus_is_16[index])
-        return (wait_table_seq[index] + wait_table_nonseq[index] + 2);
-    else
-        return (wait_table_nonseq[index] + 1);
+    return gba_access_cycles[0][_32bit][(address >> 24) & 0xF];
 }
 
 static inline u32 GBA_MemoryGetAccessCyclesSeq(u32 _32bit, u32 address)
 {
-    //if ((address & 0x1FFFF) == 0)
-    //    return GBA_MemoryGetAccessCyclesNoSeq(_32bit, address);
-    u32 index = (address >> 24) & 0xF;
-    return (wait_table_seq[index] + 1) << (_32bit && mem_bus_is_16[index]);
+    return gba_access_cycles[1][_32bit][(address >> 24) & 0xF];
 }
 
 static inline u32 GBA_MemoryGetAccessCyclesNoSeq32(u32 address)
 {
-    u32 index = (address >> 24) & 0xF;
-    if (mem_bus_is_16[index])
-        return (wait_table_seq[index] + wait_table_nonseq[index] + 2);
-    else
-        return (wait_table_nonseq[index] + 1);
+    return gba_access_cycles[0][1][(address >> 24) & 0xF];
 }
 
 static inline u32 GBA_MemoryGetAccessCyclesNoSeq16(u32 address)
 {
-    return (wait_table_nonseq[(address >> 24) & 0xF] + 1);
+    return gba_access_cycles[0][0][(address >> 24) & 0xF];
 }
 
 static inline u32 GBA_MemoryGetAccessCyclesSeq32(u32 address)
 {
-    //if ((address & 0x1FFFF) == 0)
-    //    return GBA_MemoryGetAccessCyclesNoSeq32(address);
-    u32 index = (address >> 24) & 0xF;
-    return (wait_table_seq[index] + 1) << (mem_bus_is_16[index]);
+    return gba_access_cycles[1][1][(address >> 24) & 0xF];
 }
 
 static inline u32 GBA_MemoryGetAccessCyclesSeq16(u32 address)
 {
-    //if ((address & 0x1FFFF) == 0)
-    //    return GBA_MemoryGetAccessCyclesNoSeq16(address);
-    return (wait_table_seq[(address >> 24) & 0xF] + 1);
+    return gba_access_cycles[1][0][(address >> 24) & 0xF];
 }
 
 //------------------------------------------------------------------------------
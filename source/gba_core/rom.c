@@ -144,7 +144,7 @@ typedef struct
 
 //------------------------------------------------------------------------------
 
-static int showconsole = 0;
+static core_local__ int showconsole = 0;
 
 int GBA_ShowConsoleRequested(void)
 {
@@ -9,8 +9,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../autosave_utils.h"
 #include "../build_options.h"
+#include "../config.h"
 #include "../debug_utils.h"
+#include "../file_utils.h"
 
 #include "cpu.h"
 #include "dma.h"
@@ -40,49 +43,75 @@ typedef enum
     SAV_AUTODETECT
 } _sav_types_;
 
-// Returns 1 if equal (TODO: Replace by libc)
-static int str_cmp_len(const char *str1, const char *str2, int len)
-{
-    for (int i = 0; i < len; i++)
-    {
-        if (str1[i] != str2[i])
-            return 0;
-    }
-    return 1;
-}
+core_local__ int SAVE_TYPE = SAV_NONE;
 
-int SAVE_TYPE = SAV_NONE;
+// Save type to use instead of detecting it, or -1
+static core_local__ int save_type_known = -1;
+// Result of the last detection, before the type is autodetected while running
+static core_local__ int save_type_detected = SAV_AUTODETECT;
 
 int GBA_SaveIsEEPROM(void)
 {
     return (SAVE_TYPE == SAV_EEPROM) || (SAVE_TYPE == SAV_AUTODETECT);
 }
 
+// All the strings end with "_V". The ROM is read only once looking for '_', and
+// the strings are only compared where it's found. If the ROM contains more than
+// one string, the first one in save_type_strings[] is used.
 void GBA_DetectSaveType(u8 *romptr, int size)
 {
-    for (int j = 0; j < SAV_TYPES; j++)
+    if (save_type_known >= 0)
     {
-        for (int i = 0; i < size; i++)
+        SAVE_TYPE = save_type_known;
+        save_type_detected = SAVE_TYPE;
+        save_type_known = -1;
+        return;
+    }
+
+    int found = SAV_TYPES;
+
+    const u8 *ptr = romptr;
+    const u8 *end = romptr + size;
+
+    while (found > 0)
+    {
+        ptr = memchr(ptr, '_', end - ptr);
+        if (ptr == NULL)
+            break;
+
+        int offset = ptr - romptr;
+        ptr++;
+
+        if ((ptr == end) || (*ptr != 'V'))
+            continue;
+
+        for (int j = 0; j < found; j++)
         {
             int len = strlen(save_type_strings[j]);
+            int start = offset - (len - 2);
 
             // Avoid crashing if strangely there are some characters at the end
             // of the rom...
-            if (i + len < size)
+            if ((start < 0) || (start + len >= size))
+                continue;
+
+            if (memcmp(&romptr[start], save_type_strings[j], len) == 0)
             {
-                if (str_cmp_len((const char *)&(romptr[i]),
-                                save_type_strings[j], len))
-                {
-                    //Debug_DebugMsgArg(&(romptr[i]));
-                    //GBA_ExecutionBreak();
-                    SAVE_TYPE = j;
-                    return;
-                }
+                found = j;
+                break;
             }
         }
     }
 
+    if (found < SAV_TYPES)
+    {
+        SAVE_TYPE = found;
+        save_type_detected = SAVE_TYPE;
+        return;
+    }
+
     SAVE_TYPE = SAV_AUTODETECT;
+    save_type_detected = SAVE_TYPE;
 
     // Not detected any string... Try to autodetect save type.
     //Debug_DebugMsgArg("No save type string detected.");
@@ -91,59 +120,233 @@ void GBA_DetectSaveType(u8 *romptr, int size)
     return;
 }
 
-u8 SRAM_BUFFER[32 * 1024];
+#define SAVE_SRAM_SIZE          (32 * 1024)
+#define SAVE_FLASH512_SIZE      (64 * 1024)
+#define SAVE_FLASH1M_SIZE       (128 * 1024)
+#define SAVE_EEPROM_SIZE_MAX    (8 * 1024)
+
+// The buffers point to this memory unless they are mapped from the save file.
+// They start as NULL because the address of a thread-local variable isn't a
+// constant in C, they are set the first time the save memory is reset.
+static core_local__ u8 sram_memory[SAVE_SRAM_SIZE];
+static core_local__ u8 flash512_memory[SAVE_FLASH512_SIZE];
+static core_local__ u8 flash1m_memory[SAVE_FLASH1M_SIZE];
+static core_local__ u64 eeprom_memory[SAVE_EEPROM_SIZE_MAX / sizeof(u64)];
+
+core_local__ u8 *SRAM_BUFFER;
 
-u8 FLASH_BUFFER512[64 * 1024];
-u8 FLASH_BUFFER1M[128 * 1024];
-u8 *FLASH_1M_PTR;
+core_local__ u8 *FLASH_BUFFER512;
+core_local__ u8 *FLASH_BUFFER1M;
+core_local__ u8 *FLASH_1M_PTR;
 
-u32 FLASH_STATE; // 0 = nothing, 1 = see FLASH_CMD
-u32 FLASH_CMD;
+core_local__ u32 FLASH_STATE; // 0 = nothing, 1 = see FLASH_CMD
+core_local__ u32 FLASH_CMD;
 
 // 0 if nothing, 1 if 5555=0xAA, 2 if 2AAA=0x55 (ready for command)
-u32 FLASH_CMD_STATE;
-
-int eeprom_detect_size;
-u64 EEPROM_BUFFER[1024];
-u32 EEPROM_SIZE;
-u32 EEPROM_ADDRESS_BUS;
-u32 EEPROM_ADDRESS;
-u32 EEPROM_ADDRESS_MASK;
-u32 EEPROM_CMD;
-u32 EEPROM_CMD_LEN;
-u32 EEPROM_DATA_STREAMING;
-u64 EEPROM_READ_BUFFER;
-
-static const char *savetype[SAV_TYPES + 3] = {
+core_local__ u32 FLASH_CMD_STATE;
+
+core_local__ int eeprom_detect_size;
+core_local__ u64 *EEPROM_BUFFER;
+core_local__ u32 EEPROM_SIZE;
+core_local__ u32 EEPROM_ADDRESS_BUS;
+core_local__ u32 EEPROM_ADDRESS;
+core_local__ u32 EEPROM_ADDRESS_MASK;
+core_local__ u32 EEPROM_CMD;
+core_local__ u32 EEPROM_CMD_LEN;
+core_local__ u32 EEPROM_DATA_STREAMING;
+core_local__ u64 EEPROM_READ_BUFFER;
+
+static core_local__ const char *savetype[SAV_TYPES + 3] = {
     "EEPROM", "SRAM (32KB)", "FLASH 64KB", "FLASH 64KB", "FLASH 128KB",
     "-", "None", "Unknown/None. Autodetecting...\n"
 };
 
+void GBA_SaveSetKnownType(int type)
+{
+    if (((type >= 0) && (type < SAV_TYPES)) || (type == SAV_AUTODETECT))
+        save_type_known = type;
+    else
+        save_type_known = -1;
+}
+
+int GBA_SaveGetDetectedType(void)
+{
+    return save_type_detected;
+}
+
 const char *GBA_GetSaveTypeString(void)
 {
     return savetype[SAVE_TYPE];
 }
 
+core_local__ char SAVE_PATH[MAX_PATHLEN];
+
+// 1 if the save memory has changed since it was last read or written
+static core_local__ int save_dirty;
+
+// If EmulatorConfig.gba_save_mmap is set, the buffer of the save type is
+// replaced by a mapping of the save file, so the writes of the game go straight
+// to it and they aren't lost if the emulator crashes. The file is mapped when
+// the ROM is loaded if it already exists, or the first time the save is written
+// otherwise. It's only done with files that have the size of the buffer, 512
+// byte EEPROMs and files with other sizes use the normal buffers.
+static core_local__ void *save_map;
+static core_local__ size_t save_map_size;
+
+static void GBA_SaveUseMemoryBuffers(u32 flash_1m_bank)
+{
+    SRAM_BUFFER = sram_memory;
+    FLASH_BUFFER512 = flash512_memory;
+    FLASH_BUFFER1M = flash1m_memory;
+    FLASH_1M_PTR = flash_1m_bank ? &(FLASH_BUFFER1M[0x10000]) : FLASH_BUFFER1M;
+    EEPROM_BUFFER = eeprom_memory;
+}
+
+static void GBA_SaveUnmapFile(void)
+{
+    if (save_map == NULL)
+    {
+        if (SRAM_BUFFER == NULL)
+            GBA_SaveUseMemoryBuffers(0);
+        return;
+    }
+
+    // Keep the data in case the save type changes while the ROM is running,
+    // for example when loading a save state.
+    if (SRAM_BUFFER == save_map)
+        memcpy(sram_memory, save_map, save_map_size);
+    else if (FLASH_BUFFER512 == save_map)
+        memcpy(flash512_memory, save_map, save_map_size);
+    else if (FLASH_BUFFER1M == save_map)
+        memcpy(flash1m_memory, save_map, save_map_size);
+    else if ((void *)EEPROM_BUFFER == save_map)
+        memcpy(eeprom_memory, save_map, save_map_size);
+
+    u32 flash_1m_bank = (FLASH_1M_PTR == &(FLASH_BUFFER1M[0x10000]));
+
+    FileUnmapWritable(save_map, save_map_size);
+    save_map = NULL;
+    save_map_size = 0;
+
+    GBA_SaveUseMemoryBuffers(flash_1m_bank);
+}
+
+// Returns the buffer of the current save type, or NULL if it doesn't have one
+static void *GBA_SaveGetBuffer(size_t *size)
+{
+    switch (SAVE_TYPE)
+    {
+        case SAV_SRAM:
+            *size = SAVE_SRAM_SIZE;
+            return SRAM_BUFFER;
+        case SAV_FLASH:
+        case SAV_FLASH512:
+            *size = SAVE_FLASH512_SIZE;
+            return FLASH_BUFFER512;
+        case SAV_FLASH1M:
+            *size = SAVE_FLASH1M_SIZE;
+            return FLASH_BUFFER1M;
+        case SAV_EEPROM:
+            *size = EEPROM_SIZE; // 0 if the size hasn't been detected yet
+            return EEPROM_BUFFER;
+        case SAV_NONE:
+        case SAV_AUTODETECT:
+        default:
+            *size = 0;
+            return NULL;
+    }
+}
+
+// Returns 0 if the buffer of the current save type is now the save file. If
+// "copy" is 1 the contents of the buffer are copied to the file, if not the
+// file has to exist already.
+static int GBA_SaveMapFile(int copy)
+{
+    if (EmulatorConfig.gba_save_mmap == 0)
+        return 1;
+
+    size_t size;
+    void *buffer = GBA_SaveGetBuffer(&size);
+    if ((buffer == NULL) || (size == 0))
+        return 1;
+
+    if ((SAVE_TYPE == SAV_EEPROM) && (size != SAVE_EEPROM_SIZE_MAX))
+        return 1;
+
+    if ((copy == 0) && (FileExists(SAVE_PATH) == 0))
+        return 1;
+
+    // The buffer of another save type may be mapped
+    GBA_SaveUnmapFile();
+    buffer = GBA_SaveGetBuffer(&size);
+
+    // An older version of the file may still be waiting to be written
+    Autosave_Flush();
+
+    void *map = FileMapWritable(SAVE_PATH, size);
+    if (map == NULL)
+        return 1;
+
+    if (copy)
+        memcpy(map, buffer, size);
+
+    switch (SAVE_TYPE)
+    {
+        case SAV_SRAM:
+            SRAM_BUFFER = map;
+            break;
+        case SAV_FLASH:
+        case SAV_FLASH512:
+            FLASH_BUFFER512 = map;
+            break;
+        case SAV_FLASH1M:
+        {
+            size_t bank_offset = FLASH_1M_PTR - FLASH_BUFFER1M;
+            FLASH_BUFFER1M = map;
+            FLASH_1M_PTR = &(FLASH_BUFFER1M[bank_offset]);
+            break;
+        }
+        case SAV_EEPROM:
+            EEPROM_BUFFER = map;
+            break;
+        default:
+            break;
+    }
+
+    save_map = map;
+    save_map_size = size;
+
+    return 0;
+}
+
+void GBA_SaveEnd(void)
+{
+    GBA_SaveUnmapFile();
+}
+
 void GBA_ResetSaveBuffer(void)
 {
+    // The file may be mapped in the buffer that is going to be cleared
+    GBA_SaveUnmapFile();
+
     switch (SAVE_TYPE)
     {
         case SAV_SRAM:
-            memset(SRAM_BUFFER, 0, sizeof(SRAM_BUFFER));
+            memset(SRAM_BUFFER, 0, SAVE_SRAM_SIZE);
             return;
         case SAV_FLASH:
         case SAV_FLASH512:
             FLASH_CMD = 0;
             FLASH_CMD_STATE = 0;
             FLASH_STATE = 0;
-            memset(FLASH_BUFFER512, 0, sizeof(FLASH_BUFFER512));
+            memset(FLASH_BUFFER512, 0, SAVE_FLASH512_SIZE);
             return;
         case SAV_FLASH1M:
             FLASH_CMD = 0;
             FLASH_CMD_STATE = 0;
             FLASH_STATE = 0;
             FLASH_1M_PTR = FLASH_BUFFER1M;
-            memset(FLASH_BUFFER1M, 0, sizeof(FLASH_BUFFER1M));
+            memset(FLASH_BUFFER1M, 0, SAVE_FLASH1M_SIZE);
             return;
         case SAV_EEPROM:
             eeprom_detect_size = 1;
@@ -153,7 +356,7 @@ void GBA_ResetSaveBuffer(void)
             EEPROM_CMD = 0;
             EEPROM_CMD_LEN = 0;
             EEPROM_DATA_STREAMING = 0;
-            memset(EEPROM_BUFFER, 0, sizeof(EEPROM_BUFFER));
+            memset(EEPROM_BUFFER, 0, SAVE_EEPROM_SIZE_MAX);
             return;
         case SAV_NONE:
         case SAV_AUTODETECT:
@@ -162,8 +365,6 @@ void GBA_ResetSaveBuffer(void)
     }
 }
 
-char SAVE_PATH[MAX_PATHLEN];
-
 void GBA_SaveSetFilename(char *rom_path)
 {
     if (strlen(rom_path) > (MAX_PATHLEN - 1))
@@ -182,6 +383,13 @@ void GBA_SaveSetFilename(char *rom_path)
     //Debug_DebugMsgArg(SAVE_PATH);
 }
 
+void GBA_SaveGetStateFilename(char *path, size_t size)
+{
+    // Replace "sav" by "st"
+    int len = strlen(SAVE_PATH) - 3;
+    snprintf(path, size, "%.*sst", len, SAVE_PATH);
+}
+
 //--------------------------------------------------------------------------
 
 u8 GBA_SaveRead8(u32 address)
@@ -367,7 +575,10 @@ void GBA_SaveWrite8(u32 address, u8 data)
         case SAV_SRAM:
         {
             if ((address >= 0x0E000000) && (address < 0x0E008000))
+            {
                 SRAM_BUFFER[address - 0x0E000000] = data;
+                save_dirty = 1;
+            }
             return;
         }
         case SAV_FLASH:
@@ -401,6 +612,7 @@ void GBA_SaveWrite8(u32 address, u8 data)
                         memset((void *)((uintptr_t)FLASH_BUFFER512
                                         + (address & 0x0000F000)),
                                0xFF, 0xFFF);
+                        save_dirty = 1;
                         FLASH_CMD = 0x30;
                         FLASH_STATE = 1;
                     }
@@ -424,7 +636,8 @@ void GBA_SaveWrite8(u32 address, u8 data)
                             if (FLASH_CMD == 0x80)
                             {
                                 memset(FLASH_BUFFER512, 0xFF,
-                                       sizeof(FLASH_BUFFER512));
+                                       SAVE_FLASH512_SIZE);
+                                save_dirty = 1;
                                 FLASH_CMD = 0x10;
                                 FLASH_STATE = 1;
                             }
@@ -467,7 +680,10 @@ void GBA_SaveWrite8(u32 address, u8 data)
                 if (FLASH_CMD == 0xA0) // Write byte
                 {
                     if ((address >= 0x0E000000) && (address < 0x0E010000))
+                    {
                         FLASH_BUFFER512[address - 0x0E000000] = data;
+                        save_dirty = 1;
+                    }
                 }
                 FLASH_CMD_STATE = 0;
                 FLASH_CMD = 0;
@@ -505,6 +721,7 @@ void GBA_SaveWrite8(u32 address, u8 data)
                         memset((void *)((uintptr_t)FLASH_1M_PTR
                                         + (address & 0x0000F000)),
                                0xFF, 0xFFF);
+                        save_dirty = 1;
                         FLASH_CMD = 0x30;
                         FLASH_STATE = 1;
                     }
@@ -527,7 +744,8 @@ void GBA_SaveWrite8(u32 address, u8 data)
                             if (FLASH_CMD == 0x80)
                             {
                                 memset(FLASH_BUFFER1M, 0xFF,
-                                       sizeof(FLASH_BUFFER1M));
+                                       SAVE_FLASH1M_SIZE);
+                                save_dirty = 1;
                                 FLASH_CMD = 0x10;
                                 FLASH_STATE = 1;
                             }
@@ -575,7 +793,10 @@ void GBA_SaveWrite8(u32 address, u8 data)
                 if (FLASH_CMD == 0xA0) // Write byte
                 {
                     if ((address >= 0x0E000000) && (address < 0x0E010000))
+                    {
                         FLASH_1M_PTR[address - 0x0E000000] = data;
+                        save_dirty = 1;
+                    }
                 }
                 else if (FLASH_CMD == 0xB0) // Change bank
                 {
@@ -714,6 +935,7 @@ void GBA_SaveWrite16(u32 address, u16 data)
                     {
                         u32 addr = EEPROM_ADDRESS & EEPROM_ADDRESS_MASK;
                         EEPROM_BUFFER[addr] = EEPROM_READ_BUFFER;
+                        save_dirty = 1;
 
                         //Debug_DebugMsgArg("EEPROM: WRITE %X", EEPROM_ADDRESS);
 
@@ -737,82 +959,144 @@ void GBA_SaveWrite16(u32 address, u16 data)
     return;
 }
 
+// Packets sent by DMA3 to the EEPROM (one bit per halfword, MSB first):
+//
+// Read request: 1, 1, address (6 or 14 bits), 0
+// Write request: 1, 0, address (6 or 14 bits), data (64 bits), 0
+//
+// After a read request, the response is 4 bits that should be ignored and the
+// 64 bits of data. Packets that don't look like this are left to the slow path.
+
+int GBA_SaveEEPROMWritePacket(u32 address, const u16 *bits, u32 count)
+{
+    if ((SAVE_TYPE != SAV_EEPROM) || eeprom_detect_size)
+        return 0;
+
+    // The state machine is reset when writing to the start of the window
+    if ((address < 0x0D000000) || ((address & 0xFF) != 0))
+        return 0;
+
+    u32 bus = EEPROM_ADDRESS_BUS;
+
+    u32 cmd = ((bits[0] & 1) << 1) | (bits[1] & 1);
+
+    u32 eeprom_address = 0;
+    for (u32 i = 0; i < bus; i++)
+        eeprom_address = (eeprom_address << 1) | (bits[2 + i] & 1);
+
+    if ((cmd == 3) && (count == 2 + bus + 1))
+    {
+        EEPROM_CMD = cmd;
+        EEPROM_CMD_LEN = 0;
+        EEPROM_ADDRESS = eeprom_address;
+        EEPROM_DATA_STREAMING = 68;
+
+        u32 addr = EEPROM_ADDRESS & EEPROM_ADDRESS_MASK;
+        EEPROM_READ_BUFFER = EEPROM_BUFFER[addr];
+        return 1;
+    }
+
+    if ((cmd == 2) && (count == 2 + bus + 64 + 1))
+    {
+        u64 data = 0;
+        for (u32 i = 0; i < 64; i++)
+            data = (data << 1) | (u64)(bits[2 + bus + i] & 1);
+
+        EEPROM_CMD = cmd;
+        EEPROM_CMD_LEN = 0;
+        EEPROM_ADDRESS = eeprom_address;
+        EEPROM_DATA_STREAMING = 64;
+        EEPROM_READ_BUFFER = data;
+
+        u32 addr = EEPROM_ADDRESS & EEPROM_ADDRESS_MASK;
+        EEPROM_BUFFER[addr] = data;
+        save_dirty = 1;
+        return 1;
+    }
+
+    return 0;
+}
+
+int GBA_SaveEEPROMReadPacket(u32 address, u16 *bits, u32 count)
+{
+    if (SAVE_TYPE != SAV_EEPROM)
+        return 0;
+
+    // With ROMs bigger than 16 MB, only the end of the window is the EEPROM
+    if (GBA_GetRomSize() > (16 * 1024 * 1024))
+    {
+        if (address < 0x0DFFFF00)
+            return 0;
+    }
+    else
+    {
+        if (address < 0x0D000000)
+            return 0;
+    }
+
+    if ((EEPROM_CMD != 3) || (EEPROM_DATA_STREAMING != 68) || (count != 68))
+        return 0;
+
+    for (u32 i = 0; i < 4; i++)
+        bits[i] = 0;
+
+    u64 data = EEPROM_READ_BUFFER;
+    for (u32 i = 0; i < 64; i++)
+        bits[4 + i] = (data >> (63 - i)) & 1;
+
+    EEPROM_DATA_STREAMING = 0;
+    EEPROM_READ_BUFFER = 0;
+
+    return 1;
+}
+
 //---------------------------------------------------------------
 
+// The file is written by the autosave thread, so this doesn't have to wait for
+// the disk and the old file is only replaced once the new one is complete. If
+// the file is mapped the data is already in it, the system is only asked to
+// start writing it to the disk.
 void GBA_SaveWriteFile(void)
 {
-    switch (SAVE_TYPE)
+    size_t size;
+    const void *data = GBA_SaveGetBuffer(&size);
+
+    if ((data == NULL) || (size == 0)) // EEPROM size not detected yet
+        return;
+
+    if ((data == save_map) || (GBA_SaveMapFile(1) == 0))
     {
-        case SAV_SRAM:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(SRAM_BUFFER, sizeof(SRAM_BUFFER), 1, f) != 1)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
-        case SAV_FLASH:
-        case SAV_FLASH512:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(FLASH_BUFFER512, sizeof(FLASH_BUFFER512), 1, f) != 1)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
-        case SAV_FLASH1M:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(FLASH_BUFFER1M, sizeof(FLASH_BUFFER1M), 1, f) != 1)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
-        case SAV_EEPROM:
-        {
-            FILE *f = fopen(SAVE_PATH, "wb");
-            if (f == NULL)
-            {
-                Debug_ErrorMsgArg("Couldn't open file for saving.");
-                return;
-            }
-            if (fwrite(EEPROM_BUFFER, 1, EEPROM_SIZE, f) != EEPROM_SIZE)
-            {
-                Debug_ErrorMsgArg("Couldn't save data to file.");
-            }
-            fclose(f);
-            return;
-        }
-        case SAV_NONE:
-        case SAV_AUTODETECT:
-        default:
-            return;
+        FileMapWritableSync(save_map, save_map_size, 0);
+        save_dirty = 0;
+        return;
     }
+
+    void *buffer = Autosave_Begin(SAVE_PATH, size);
+    if (buffer == NULL)
+        return;
+
+    memcpy(buffer, data, size);
+    Autosave_Commit();
+
+    save_dirty = 0;
+}
+
+void GBA_SaveAutosave(void)
+{
+    if (save_dirty)
+        GBA_SaveWriteFile();
 }
 
 void GBA_SaveReadFile(void)
 {
+    // An older version of the file may still be waiting to be written
+    Autosave_Flush();
+
+    save_dirty = 0;
+
+    if (GBA_SaveMapFile(0) == 0)
+        return;
+
     switch (SAVE_TYPE)
     {
         case SAV_SRAM:
@@ -820,7 +1104,7 @@ void GBA_SaveReadFile(void)
             FILE *f = fopen(SAVE_PATH, "rb");
             if (f == NULL) // Maybe file didn't exist
                 return;
-            if (fread(SRAM_BUFFER, sizeof(SRAM_BUFFER), 1, f) != 1)
+            if (fread(SRAM_BUFFER, SAVE_SRAM_SIZE, 1, f) != 1)
             {
                 Debug_ErrorMsgArg("Couldn't read data from file.");
             }
@@ -833,7 +1117,7 @@ void GBA_SaveReadFile(void)
             FILE *f = fopen(SAVE_PATH, "rb");
             if (f == NULL) // Maybe file didn't exist
                 return;
-            if (fread(FLASH_BUFFER512, sizeof(FLASH_BUFFER512), 1, f) != 1)
+            if (fread(FLASH_BUFFER512, SAVE_FLASH512_SIZE, 1, f) != 1)
             {
                 Debug_ErrorMsgArg("Couldn't read data from file.");
             }
@@ -845,7 +1129,7 @@ void GBA_SaveReadFile(void)
             FILE *f = fopen(SAVE_PATH, "rb");
             if (f == NULL) // Maybe file didn't exist
                 return;
-            if (fread(FLASH_BUFFER1M, sizeof(FLASH_BUFFER1M), 1, f) != 1)
+            if (fread(FLASH_BUFFER1M, SAVE_FLASH1M_SIZE, 1, f) != 1)
             {
                 //Debug_ErrorMsgArg("Couldn't read data from file.");
                 // TODO: Maybe save type autodetection said it is FLASH1M , but
@@ -880,3 +1164,61 @@ void GBA_SaveReadFile(void)
             return;
     }
 }
+
+//--------------------------------------------------------------------------
+
+// The whole save memory is saved, not only the memory of the detected type, so
+// that the state is the same if the type is detected after saving it.
+void GBA_SaveMemoryStateSave(_savestate_t *st)
+{
+    u32 flash_1m_bank = (FLASH_1M_PTR == &(FLASH_BUFFER1M[0x10000]));
+
+    SaveState_ChunkBegin(st, "SAVE");
+    SaveState_Write(st, &SAVE_TYPE, sizeof(SAVE_TYPE));
+    SaveState_Write(st, SRAM_BUFFER, SAVE_SRAM_SIZE);
+    SaveState_Write(st, FLASH_BUFFER512, SAVE_FLASH512_SIZE);
+    SaveState_Write(st, FLASH_BUFFER1M, SAVE_FLASH1M_SIZE);
+    SaveState_Write(st, &flash_1m_bank, sizeof(flash_1m_bank));
+    SaveState_Write(st, &FLASH_STATE, sizeof(FLASH_STATE));
+    SaveState_Write(st, &FLASH_CMD, sizeof(FLASH_CMD));
+    SaveState_Write(st, &FLASH_CMD_STATE, sizeof(FLASH_CMD_STATE));
+    SaveState_Write(st, &eeprom_detect_size, sizeof(eeprom_detect_size));
+    SaveState_Write(st, EEPROM_BUFFER, SAVE_EEPROM_SIZE_MAX);
+    SaveState_Write(st, &EEPROM_SIZE, sizeof(EEPROM_SIZE));
+    SaveState_Write(st, &EEPROM_ADDRESS_BUS, sizeof(EEPROM_ADDRESS_BUS));
+    SaveState_Write(st, &EEPROM_ADDRESS, sizeof(EEPROM_ADDRESS));
+    SaveState_Write(st, &EEPROM_ADDRESS_MASK, sizeof(EEPROM_ADDRESS_MASK));
+    SaveState_Write(st, &EEPROM_CMD, sizeof(EEPROM_CMD));
+    SaveState_Write(st, &EEPROM_CMD_LEN, sizeof(EEPROM_CMD_LEN));
+    SaveState_Write(st, &EEPROM_DATA_STREAMING, sizeof(EEPROM_DATA_STREAMING));
+    SaveState_Write(st, &EEPROM_READ_BUFFER, sizeof(EEPROM_READ_BUFFER));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_SaveMemoryStateLoad(_savestate_t *st)
+{
+    u32 flash_1m_bank = 0;
+
+    SaveState_ChunkOpen(st, "SAVE");
+    SaveState_Read(st, &SAVE_TYPE, sizeof(SAVE_TYPE));
+    SaveState_Read(st, SRAM_BUFFER, SAVE_SRAM_SIZE);
+    SaveState_Read(st, FLASH_BUFFER512, SAVE_FLASH512_SIZE);
+    SaveState_Read(st, FLASH_BUFFER1M, SAVE_FLASH1M_SIZE);
+    SaveState_Read(st, &flash_1m_bank, sizeof(flash_1m_bank));
+    SaveState_Read(st, &FLASH_STATE, sizeof(FLASH_STATE));
+    SaveState_Read(st, &FLASH_CMD, sizeof(FLASH_CMD));
+    SaveState_Read(st, &FLASH_CMD_STATE, sizeof(FLASH_CMD_STATE));
+    SaveState_Read(st, &eeprom_detect_size, sizeof(eeprom_detect_size));
+    SaveState_Read(st, EEPROM_BUFFER, SAVE_EEPROM_SIZE_MAX);
+    SaveState_Read(st, &EEPROM_SIZE, sizeof(EEPROM_SIZE));
+    SaveState_Read(st, &EEPROM_ADDRESS_BUS, sizeof(EEPROM_ADDRESS_BUS));
+    SaveState_Read(st, &EEPROM_ADDRESS, sizeof(EEPROM_ADDRESS));
+    SaveState_Read(st, &EEPROM_ADDRESS_MASK, sizeof(EEPROM_ADDRESS_MASK));
+    SaveState_Read(st, &EEPROM_CMD, sizeof(EEPROM_CMD));
+    SaveState_Read(st, &EEPROM_CMD_LEN, sizeof(EEPROM_CMD_LEN));
+    SaveState_Read(st, &EEPROM_DATA_STREAMING, sizeof(EEPROM_DATA_STREAMING));
+    SaveState_Read(st, &EEPROM_READ_BUFFER, sizeof(EEPROM_READ_BUFFER));
+    SaveState_ChunkClose(st);
+
+    FLASH_1M_PTR = flash_1m_bank ? &(FLASH_BUFFER1M[0x10000]) : FLASH_BUFFER1M;
+}
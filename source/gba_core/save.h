@@ -12,6 +12,13 @@
 int GBA_SaveIsEEPROM(void);
 
 void GBA_DetectSaveType(u8 *romptr, int size);
+
+// The save type detected when a ROM is loaded can be stored and used the next
+// time the same ROM is loaded to skip the detection. The known type is only
+// used by the next call to GBA_DetectSaveType(). A negative value means that
+// the save type has to be detected from the ROM.
+void GBA_SaveSetKnownType(int type);
+int GBA_SaveGetDetectedType(void);
 void GBA_ResetSaveBuffer(void);
 void GBA_SaveSetFilename(char *rom_path);
 
@@ -22,7 +29,27 @@ u16 GBA_SaveRead16(u32 address);
 void GBA_SaveWrite8(u32 address, u8 data);
 void GBA_SaveWrite16(u32 address, u16 data);
 
+// DMA3 accesses the EEPROM one bit at a time, with one halfword per bit. These
+// functions handle a whole request packet written to the EEPROM or the response
+// read from it. They return 1 if they have done it, 0 if the transfer has to go
+// through GBA_SaveWrite16() and GBA_SaveRead16() one halfword at a time.
+int GBA_SaveEEPROMWritePacket(u32 address, const u16 *bits, u32 count);
+int GBA_SaveEEPROMReadPacket(u32 address, u16 *bits, u32 count);
+
 void GBA_SaveWriteFile(void);
 void GBA_SaveReadFile(void);
+// Called when the ROM is unloaded. If the save file is mapped (see
+// EmulatorConfig.gba_save_mmap), it waits until it's written to the disk. The
+// changes done by the game are kept even if the ROM is unloaded without saving.
+void GBA_SaveEnd(void);
+
+// Writes the save file only if the save memory has changed since the last time
+void GBA_SaveAutosave(void);
+
+// Returns the path of the save state file, next to the save file
+void GBA_SaveGetStateFilename(char *path, size_t size);
+
+void GBA_SaveMemoryStateSave(_savestate_t *st);
+void GBA_SaveMemoryStateLoad(_savestate_t *st);
 
 #endif // GBA_SAVE__
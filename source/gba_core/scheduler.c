@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../build_options.h"
+#include "../debug_utils.h"
+#include "../profile_utils.h"
+
+#include "gba.h"
+#include "scheduler.h"
+
+// All times are absolute clock counts since the scheduler was initialized. The
+// events are kept in a binary min-heap sorted by the time of their next event,
+// so the closest one is always the first element of the heap.
+
+//------------------------------------------------------------------------------
+
+#define EVENT_NEVER     INT64_MAX
+
+typedef struct
+{
+    gba_event_update_fn update;
+    int polling;
+    int heap_index;     // -1 if not in the heap
+    s64 last_update;
+    s64 deadline;
+} _gba_event_t;
+
+static core_local__ _gba_event_t gba_events[GBA_EVENT_NUMBER];
+
+static core_local__ int gba_event_heap[GBA_EVENT_NUMBER];
+static core_local__ int gba_event_heap_size;
+
+static core_local__ s64 gba_scheduler_time;
+// Value of gba_scheduler_time before the current slice was added to it
+static core_local__ s64 gba_scheduler_slice_start;
+
+// Section of the profiler that the time spent in each event is added to
+static const _profile_section_e gba_event_profile[GBA_EVENT_NUMBER] = {
+    [GBA_EVENT_SCREEN] = PROFILE_PPU,
+    [GBA_EVENT_DMA] = PROFILE_DMA,
+    [GBA_EVENT_TIMERS] = PROFILE_TIMERS,
+    [GBA_EVENT_SOUND] = PROFILE_APU,
+    [GBA_EVENT_SIO] = PROFILE_OTHER,
+};
+
+// Reason given to the profiler when a slice ends at the event of each source
+static const _profile_slice_e gba_event_slice[GBA_EVENT_NUMBER] = {
+    [GBA_EVENT_SCREEN] = PROFILE_SLICE_PPU,
+    [GBA_EVENT_DMA] = PROFILE_SLICE_DMA,
+    [GBA_EVENT_TIMERS] = PROFILE_SLICE_TIMERS,
+    [GBA_EVENT_SOUND] = PROFILE_SLICE_APU,
+    [GBA_EVENT_SIO] = PROFILE_SLICE_SERIAL,
+};
+
+//------------------------------------------------------------------------------
+
+static void gba_event_heap_swap(int a, int b)
+{
+    int temp = gba_event_heap[a];
+    gba_event_heap[a] = gba_event_heap[b];
+    gba_event_heap[b] = temp;
+
+    gba_events[gba_event_heap[a]].heap_index = a;
+    gba_events[gba_event_heap[b]].heap_index = b;
+}
+
+static s64 gba_event_heap_deadline(int index)
+{
+    return gba_events[gba_event_heap[index]].deadline;
+}
+
+static void gba_event_heap_fix(int index)
+{
+    // Move up
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (gba_event_heap_deadline(parent) <= gba_event_heap_deadline(index))
+            break;
+        gba_event_heap_swap(parent, index);
+        index = parent;
+    }
+
+    // Move down
+    while (1)
+    {
+        int smallest = index;
+        int left = (2 * index) + 1;
+        int right = left + 1;
+
+        if ((left < gba_event_heap_size)
+            && (gba_event_heap_deadline(left)
+                < gba_event_heap_deadline(smallest)))
+        {
+            smallest = left;
+        }
+        if ((right < gba_event_heap_size)
+            && (gba_event_heap_deadline(right)
+                < gba_event_heap_deadline(smallest)))
+        {
+            smallest = right;
+        }
+
+        if (smallest == index)
+            break;
+
+        gba_event_heap_swap(smallest, index);
+        index = smallest;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void gba_event_run(_gba_event_e event)
+{
+    _gba_event_t *ev = &gba_events[event];
+
+    _profile_section_e prev = Profile_Begin(gba_event_profile[event]);
+    s32 clocks_to_event = ev->update(gba_scheduler_time - ev->last_update);
+    Profile_End(prev);
+    ev->last_update = gba_scheduler_time;
+
+    if (clocks_to_event == 0x7FFFFFFF)
+        ev->deadline = EVENT_NEVER;
+    else
+        ev->deadline = gba_scheduler_time + clocks_to_event;
+
+    gba_event_heap_fix(ev->heap_index);
+}
+
+void GBA_SchedulerInit(void)
+{
+    memset(gba_events, 0, sizeof(gba_events));
+
+    for (int i = 0; i < GBA_EVENT_NUMBER; i++)
+        gba_events[i].heap_index = -1;
+
+    gba_event_heap_size = 0;
+    gba_scheduler_time = 0;
+    gba_scheduler_slice_start = 0;
+}
+
+void GBA_SchedulerRegister(_gba_event_e event, gba_event_update_fn update)
+{
+    _gba_event_t *ev = &gba_events[event];
+
+    if (ev->heap_index >= 0)
+    {
+        Debug_ErrorMsgArg("%s: Event %d already registered.", __func__, event);
+        return;
+    }
+
+    ev->update = update;
+    ev->polling = 1;
+    ev->last_update = gba_scheduler_time;
+    ev->deadline = EVENT_NEVER;
+
+    ev->heap_index = gba_event_heap_size;
+    gba_event_heap[gba_event_heap_size++] = event;
+    gba_event_heap_fix(ev->heap_index);
+}
+
+void GBA_SchedulerSetPolling(_gba_event_e event, int enable)
+{
+    _gba_event_t *ev = &gba_events[event];
+
+    if (ev->heap_index < 0) // Not registered yet
+        return;
+
+    if (enable && (ev->polling == 0))
+    {
+        // Bring it up to date before its state changes
+        if (ev->last_update != gba_scheduler_time)
+            gba_event_run(event);
+    }
+
+    ev->polling = enable;
+}
+
+void GBA_SchedulerSync(_gba_event_e event)
+{
+    _gba_event_t *ev = &gba_events[event];
+
+    if (ev->heap_index < 0) // Not registered yet
+        return;
+
+    if (ev->last_update != gba_scheduler_time)
+        gba_event_run(event);
+}
+
+void GBA_SchedulerWake(_gba_event_e event)
+{
+    _gba_event_t *ev = &gba_events[event];
+
+    if ((ev->heap_index < 0) || ev->polling)
+        return;
+
+    if (ev->last_update < gba_scheduler_slice_start)
+        ev->last_update = gba_scheduler_slice_start;
+
+    ev->polling = 1;
+}
+
+s64 GBA_SchedulerGetTime(void)
+{
+    return gba_scheduler_time;
+}
+
+s32 GBA_SchedulerUpdate(s32 clocks)
+{
+    gba_scheduler_slice_start = gba_scheduler_time;
+    gba_scheduler_time += clocks;
+
+    for (int i = 0; i < GBA_EVENT_NUMBER; i++)
+    {
+        _gba_event_t *ev = &gba_events[i];
+
+        if (ev->heap_index < 0)
+            continue;
+
+        if (ev->polling || (ev->deadline <= gba_scheduler_time))
+            gba_event_run(i);
+    }
+
+    if (gba_event_heap_size == 0)
+        return 0x7FFFFFFF;
+
+    s64 clocks_to_event = gba_event_heap_deadline(0) - gba_scheduler_time;
+
+    if (clocks_to_event > 0x7FFFFFFF)
+        return 0x7FFFFFFF;
+
+    return clocks_to_event;
+}
+
+_profile_slice_e GBA_SchedulerGetNextEventReason(void)
+{
+    if (gba_event_heap_size == 0)
+        return PROFILE_SLICE_OTHER;
+
+    return gba_event_slice[gba_event_heap[0]];
+}
+
+//------------------------------------------------------------------------------
+
+// The update functions aren't saved, only the timing of each event.
+void GBA_SchedulerStateSave(_savestate_t *st)
+{
+    SaveState_ChunkBegin(st, "SCHD");
+    SaveState_Write(st, &gba_scheduler_time, sizeof(gba_scheduler_time));
+    for (int i = 0; i < GBA_EVENT_NUMBER; i++)
+    {
+        _gba_event_t *ev = &gba_events[i];
+
+        SaveState_Write(st, &ev->polling, sizeof(ev->polling));
+        SaveState_Write(st, &ev->last_update, sizeof(ev->last_update));
+        SaveState_Write(st, &ev->deadline, sizeof(ev->deadline));
+    }
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_SchedulerStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "SCHD");
+    SaveState_Read(st, &gba_scheduler_time, sizeof(gba_scheduler_time));
+    for (int i = 0; i < GBA_EVENT_NUMBER; i++)
+    {
+        _gba_event_t *ev = &gba_events[i];
+
+        SaveState_Read(st, &ev->polling, sizeof(ev->polling));
+        SaveState_Read(st, &ev->last_update, sizeof(ev->last_update));
+        SaveState_Read(st, &ev->deadline, sizeof(ev->deadline));
+    }
+    SaveState_ChunkClose(st);
+
+    // Insert the events in the heap again with their new deadlines
+    int size = gba_event_heap_size;
+    gba_event_heap_size = 0;
+    for (int i = 0; i < size; i++)
+    {
+        int index = gba_event_heap_size++;
+        gba_events[gba_event_heap[index]].heap_index = index;
+        gba_event_heap_fix(index);
+    }
+}
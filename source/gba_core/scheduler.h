@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GBA_SCHEDULER__
+#define GBA_SCHEDULER__
+
+#include "../profile_utils.h"
+
+#include "gba.h"
+
+// Sources of events. When several of them have to be updated at the same time
+// they are updated in this order.
+typedef enum
+{
+    GBA_EVENT_SCREEN,
+    GBA_EVENT_DMA,
+    GBA_EVENT_TIMERS,
+    GBA_EVENT_SOUND,
+    GBA_EVENT_SIO,
+
+    GBA_EVENT_NUMBER
+} _gba_event_e;
+
+// Receives the clocks elapsed since the last time it was called and returns the
+// clocks left until its next event. 0x7FFFFFFF means "no event".
+typedef s32 (*gba_event_update_fn)(s32 clocks);
+
+void GBA_SchedulerInit(void);
+
+// A registered source is polled (updated after every slice of CPU execution)
+// until it disables polling. After that, it is only updated when its event is
+// reached.
+void GBA_SchedulerRegister(_gba_event_e event, gba_event_update_fn update);
+
+// Sources should stop polling when they have nothing to do and enable it again
+// before changing their state. Enabling polling catches up the source to the
+// current time first.
+void GBA_SchedulerSetPolling(_gba_event_e event, int enable);
+
+// Catches up a source to the current time without changing its polling state.
+// Used by sources that are only updated lazily when their state is read.
+void GBA_SchedulerSync(_gba_event_e event);
+
+// Called by a source from its update function to make a source that comes
+// later in the order be updated in the same GBA_SchedulerUpdate(). It enables
+// polling, and the woken source receives the clocks of the current slice, as if
+// it had been polled all along. Only for sources whose state doesn't depend on
+// the time that passes while they aren't polling.
+void GBA_SchedulerWake(_gba_event_e event);
+
+// Advances the time and updates the sources that are polled or whose event has
+// been reached. It returns the clocks left until the next event.
+s32 GBA_SchedulerUpdate(s32 clocks);
+
+// Reason given to the profiler if the next slice of CPU execution ends at the
+// time returned by GBA_SchedulerUpdate().
+_profile_slice_e GBA_SchedulerGetNextEventReason(void);
+
+// Clocks elapsed since the scheduler was initialized. It only advances between
+// slices of CPU execution. It is saved in the states, so anything derived from
+// it is deterministic.
+s64 GBA_SchedulerGetTime(void);
+
+// The events have to be registered before loading a state
+void GBA_SchedulerStateSave(_savestate_t *st);
+void GBA_SchedulerStateLoad(_savestate_t *st);
+
+#endif // GBA_SCHEDULER__
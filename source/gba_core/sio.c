@@ -0,0 +1,446 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <string.h>
+
+#include "../build_options.h"
+#include "../config.h"
+#include "../debug_utils.h"
+#include "../link_utils.h"
+
+#include "gba.h"
+#include "interrupts.h"
+#include "memory.h"
+#include "scheduler.h"
+#include "sio.h"
+
+// The side that starts a transfer (the master in normal mode, the parent in
+// multiplayer mode) sends its data to the other emulator as soon as it starts.
+// The other emulator replies with its own data right away, so the reply is
+// usually there when the emulated transfer ends. Only then the master waits
+// for it if needed. Data is sent as 'D' messages, one per byte starting with
+// the least significant one, followed by the message that says what to do
+// with it.
+
+#define GBA_SIO_MSG_DATA            ('D') // Value = Byte of data
+#define GBA_SIO_MSG_NORMAL          ('N') // Value = Number of bits
+#define GBA_SIO_MSG_NORMAL_REPLY    ('n')
+#define GBA_SIO_MSG_MULTI           ('M')
+#define GBA_SIO_MSG_MULTI_REPLY     ('m')
+
+// Messages are checked this often (in clocks) while the link cable is enabled,
+// in case the other emulator starts a transfer.
+#define GBA_SIO_POLL_CLOCKS         (4096)
+
+// Time the master waits for the reply when the transfer ends (in ms)
+#define GBA_SIO_REPLY_TIMEOUT       (1000)
+
+#define SIOCNT_INTERNAL_CLOCK       BIT(0)
+#define SIOCNT_FAST_CLOCK           BIT(1)
+#define SIOCNT_SI                   BIT(2)
+#define SIOCNT_SD                   BIT(3)
+#define SIOCNT_ID_SHIFT             (4)
+#define SIOCNT_ID_MASK              (3 << SIOCNT_ID_SHIFT)
+#define SIOCNT_START                BIT(7)
+#define SIOCNT_IRQ_ENABLE           BIT(14)
+
+typedef enum
+{
+    GBA_SIO_MODE_NORMAL_8,
+    GBA_SIO_MODE_NORMAL_32,
+    GBA_SIO_MODE_MULTI,
+    GBA_SIO_MODE_OTHER, // Not emulated
+} _gba_sio_mode_e;
+
+typedef struct
+{
+    u32 busy; // A transfer started by this GBA is in progress
+    s32 clocks_left; // Until the end of the transfer
+} _gba_sio_t;
+
+static core_local__ _gba_sio_t SIO;
+
+static core_local__ int gba_sio_link; // 1 if the link cable is enabled
+static core_local__ s32 gba_sio_poll_clocks;
+
+// Bytes received before the message that uses them
+static core_local__ u32 gba_sio_received_data;
+static core_local__ int gba_sio_received_bytes;
+
+// The reply can arrive before the end of the transfer
+static core_local__ u32 gba_sio_reply;
+static core_local__ int gba_sio_reply_received;
+
+// Clocks per bit in multiplayer mode for 9600, 38400, 57600 and 115200 bps
+static const s32 gba_sio_multi_clocks_per_bit[4] = { 1748, 437, 291, 146 };
+
+//------------------------------------------------------------------------------
+
+static _gba_sio_mode_e gba_sio_mode(void)
+{
+    if (REG_RCNT & BIT(15)) // General purpose or JOY bus mode
+        return GBA_SIO_MODE_OTHER;
+
+    return (REG_SIOCNT >> 12) & 3; // The value 3 is UART mode
+}
+
+static int gba_sio_connected(void)
+{
+    return gba_sio_link && Link_IsConnected();
+}
+
+static int gba_sio_is_parent(void)
+{
+    // The parent has its SI terminal grounded by the cable
+    return gba_sio_connected() && (EmulatorConfig.link_address[0] == '\0');
+}
+
+// Updates the read only bits that depend on the cable
+static void gba_sio_update_status(void)
+{
+    _gba_sio_mode_e mode = gba_sio_mode();
+
+    if (mode == GBA_SIO_MODE_MULTI)
+    {
+        REG_SIOCNT &= ~(SIOCNT_SI | SIOCNT_SD);
+        if (gba_sio_is_parent() == 0)
+            REG_SIOCNT |= SIOCNT_SI;
+        if (gba_sio_connected())
+            REG_SIOCNT |= SIOCNT_SD;
+    }
+    else if (mode != GBA_SIO_MODE_OTHER)
+    {
+        // SI is high if nothing is connected
+        REG_SIOCNT &= ~SIOCNT_SI;
+        if (gba_sio_connected() == 0)
+            REG_SIOCNT |= SIOCNT_SI;
+    }
+}
+
+static void gba_sio_send(u32 data, int bytes, u8 type, u8 value)
+{
+    for (int i = 0; i < bytes; i++)
+        Link_Send(GBA_SIO_MSG_DATA, (data >> (i * 8)) & 0xFF);
+
+    Link_Send(type, value);
+}
+
+static void gba_sio_transfer_end(void)
+{
+    REG_SIOCNT &= ~SIOCNT_START;
+
+    if (REG_SIOCNT & SIOCNT_IRQ_ENABLE)
+        GBA_CallInterrupt(BIT(7));
+}
+
+//------------------------------------------------------------------------------
+
+// The other emulator has started a transfer in normal mode
+static void gba_sio_slave_normal(u32 data, int bits)
+{
+    _gba_sio_mode_e mode = gba_sio_mode();
+
+    int ready = 0;
+
+    if ((REG_SIOCNT & SIOCNT_START)
+        && ((REG_SIOCNT & SIOCNT_INTERNAL_CLOCK) == 0))
+    {
+        if ((mode == GBA_SIO_MODE_NORMAL_8) && (bits == 8))
+            ready = 1;
+        else if ((mode == GBA_SIO_MODE_NORMAL_32) && (bits == 32))
+            ready = 1;
+    }
+
+    // If this GBA isn't waiting for a transfer, SI stays high
+    u32 reply = 0xFFFFFFFF;
+    if (ready)
+        reply = (bits == 8) ? (REG_SIODATA8 & 0xFF) : REG_SIODATA32;
+
+    gba_sio_send(reply, bits / 8, GBA_SIO_MSG_NORMAL_REPLY, bits);
+
+    if (ready == 0)
+        return;
+
+    if (bits == 8)
+        REG_SIODATA8 = data & 0xFF;
+    else
+        REG_SIODATA32 = data;
+
+    gba_sio_transfer_end();
+}
+
+// The parent has started a transfer in multiplayer mode
+static void gba_sio_child_multi(u32 data)
+{
+    if ((gba_sio_mode() != GBA_SIO_MODE_MULTI) || gba_sio_is_parent())
+    {
+        gba_sio_send(0xFFFF, 2, GBA_SIO_MSG_MULTI_REPLY, 0);
+        return;
+    }
+
+    u16 reply = REG_SIOMLT_SEND;
+
+    gba_sio_send(reply, 2, GBA_SIO_MSG_MULTI_REPLY, 0);
+
+    REG_SIOMULTI0 = data;
+    REG_SIOMULTI1 = reply;
+    REG_SIOMULTI2 = 0xFFFF;
+    REG_SIOMULTI3 = 0xFFFF;
+
+    REG_SIOCNT &= ~SIOCNT_ID_MASK;
+    REG_SIOCNT |= 1 << SIOCNT_ID_SHIFT;
+
+    gba_sio_transfer_end();
+}
+
+// Returns 1 if the message is the reply to the current transfer
+static int gba_sio_handle_message(u8 type, u8 value)
+{
+    if (type == GBA_SIO_MSG_DATA)
+    {
+        if (gba_sio_received_bytes < 4)
+        {
+            gba_sio_received_data |= (u32)value
+                                     << (gba_sio_received_bytes * 8);
+            gba_sio_received_bytes++;
+        }
+        return 0;
+    }
+
+    u32 data = gba_sio_received_data;
+
+    gba_sio_received_data = 0;
+    gba_sio_received_bytes = 0;
+
+    switch (type)
+    {
+        case GBA_SIO_MSG_NORMAL:
+            gba_sio_slave_normal(data, value);
+            return 0;
+        case GBA_SIO_MSG_MULTI:
+            gba_sio_child_multi(data);
+            return 0;
+        case GBA_SIO_MSG_NORMAL_REPLY:
+        case GBA_SIO_MSG_MULTI_REPLY:
+            if (SIO.busy == 0) // The master has stopped waiting for it
+                return 0;
+            gba_sio_reply = data;
+            gba_sio_reply_received = 1;
+            return 1;
+        default:
+            Debug_DebugMsgArg("%s: Invalid message: %02X %02X", __func__,
+                              type, value);
+            return 0;
+    }
+}
+
+static void gba_sio_poll(void)
+{
+    u8 type, value;
+
+    while (Link_Receive(&type, &value, 0))
+        gba_sio_handle_message(type, value);
+
+    // The connection may have been established or lost
+    gba_sio_update_status();
+}
+
+//------------------------------------------------------------------------------
+
+static void gba_sio_start(void)
+{
+    _gba_sio_mode_e mode = gba_sio_mode();
+
+    if ((mode == GBA_SIO_MODE_NORMAL_8) || (mode == GBA_SIO_MODE_NORMAL_32))
+    {
+        // With the external clock, wait until the other one starts it
+        if ((REG_SIOCNT & SIOCNT_INTERNAL_CLOCK) == 0)
+            return;
+
+        // 256 KHz or 2 MHz
+        s32 clocks_per_bit = (REG_SIOCNT & SIOCNT_FAST_CLOCK) ? 8 : 64;
+
+        if (mode == GBA_SIO_MODE_NORMAL_8)
+        {
+            SIO.clocks_left = 8 * clocks_per_bit;
+            gba_sio_send(REG_SIODATA8 & 0xFF, 1, GBA_SIO_MSG_NORMAL, 8);
+        }
+        else
+        {
+            SIO.clocks_left = 32 * clocks_per_bit;
+            gba_sio_send(REG_SIODATA32, 4, GBA_SIO_MSG_NORMAL, 32);
+        }
+    }
+    else if (mode == GBA_SIO_MODE_MULTI)
+    {
+        // Each GBA sends a start bit, 16 data bits and a stop bit
+        s32 clocks_per_bit = gba_sio_multi_clocks_per_bit[REG_SIOCNT & 3];
+        SIO.clocks_left = 2 * 18 * clocks_per_bit;
+
+        gba_sio_send(REG_SIOMLT_SEND, 2, GBA_SIO_MSG_MULTI, 0);
+    }
+    else
+    {
+        return;
+    }
+
+    SIO.busy = 1;
+    gba_sio_reply_received = 0;
+}
+
+static void gba_sio_finish(void)
+{
+    // Nothing drives SI if there is nothing connected
+    u32 reply = 0xFFFFFFFF;
+
+    if (gba_sio_connected())
+    {
+        u8 type, value;
+
+        while (gba_sio_reply_received == 0)
+        {
+            if (Link_Receive(&type, &value, GBA_SIO_REPLY_TIMEOUT) == 0)
+                break;
+            gba_sio_handle_message(type, value);
+        }
+
+        if (gba_sio_reply_received)
+            reply = gba_sio_reply;
+        else
+            Debug_DebugMsgArg("%s: The other GBA didn't reply.", __func__);
+    }
+
+    SIO.busy = 0;
+
+    switch (gba_sio_mode())
+    {
+        case GBA_SIO_MODE_NORMAL_8:
+            REG_SIODATA8 = reply & 0xFF;
+            break;
+        case GBA_SIO_MODE_NORMAL_32:
+            REG_SIODATA32 = reply;
+            break;
+        case GBA_SIO_MODE_MULTI:
+            REG_SIOMULTI0 = REG_SIOMLT_SEND;
+            REG_SIOMULTI1 = reply & 0xFFFF;
+            REG_SIOMULTI2 = 0xFFFF;
+            REG_SIOMULTI3 = 0xFFFF;
+            REG_SIOCNT &= ~SIOCNT_ID_MASK; // The parent is always 0
+            break;
+        default:
+            // The mode has been changed in the middle of the transfer
+            break;
+    }
+
+    gba_sio_transfer_end();
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_SIOInit(void)
+{
+    memset(&SIO, 0, sizeof(SIO));
+
+    gba_sio_received_data = 0;
+    gba_sio_received_bytes = 0;
+    gba_sio_reply_received = 0;
+    gba_sio_poll_clocks = GBA_SIO_POLL_CLOCKS;
+
+    gba_sio_link = EmulatorConfig.gba_link_cable;
+    if (gba_sio_link)
+        Link_Start(EmulatorConfig.link_address, EmulatorConfig.link_port);
+
+    gba_sio_update_status();
+}
+
+void GBA_SIOEnd(void)
+{
+    if (gba_sio_link)
+        Link_Stop();
+
+    gba_sio_link = 0;
+}
+
+void GBA_SIOWriteSIOCNT(u16 data)
+{
+    GBA_SchedulerSetPolling(GBA_EVENT_SIO, 1);
+
+    u16 old = REG_SIOCNT;
+
+    u16 read_only;
+    if (((data >> 12) & 3) == GBA_SIO_MODE_MULTI)
+    {
+        read_only = SIOCNT_SI | SIOCNT_SD | SIOCNT_ID_MASK | BIT(6);
+
+        // Only the parent can start transfers
+        if (gba_sio_is_parent() == 0)
+            read_only |= SIOCNT_START;
+    }
+    else
+    {
+        read_only = SIOCNT_SI;
+    }
+
+    REG_SIOCNT = (data & ~read_only) | (old & read_only);
+
+    gba_sio_update_status();
+
+    // Stopping a transfer cancels it
+    if ((REG_SIOCNT & SIOCNT_START) == 0)
+    {
+        SIO.busy = 0;
+        return;
+    }
+
+    if ((old & SIOCNT_START) == 0)
+        gba_sio_start();
+}
+
+s32 GBA_SIOUpdate(s32 clocks)
+{
+    if (gba_sio_link)
+    {
+        gba_sio_poll_clocks -= clocks;
+        if (gba_sio_poll_clocks <= 0)
+        {
+            gba_sio_poll_clocks = GBA_SIO_POLL_CLOCKS;
+            gba_sio_poll();
+        }
+    }
+
+    if (SIO.busy)
+    {
+        SIO.clocks_left -= clocks;
+        if (SIO.clocks_left <= 0)
+            gba_sio_finish();
+    }
+
+    // The scheduler will call this function again at the end of the transfer
+    // or when the next messages have to be checked.
+    GBA_SchedulerSetPolling(GBA_EVENT_SIO, 0);
+
+    s32 returnclocks = 0x7FFFFFFF;
+
+    if (gba_sio_link)
+        returnclocks = gba_sio_poll_clocks;
+
+    if (SIO.busy && (SIO.clocks_left < returnclocks))
+        returnclocks = SIO.clocks_left;
+
+    return returnclocks;
+}
+
+//------------------------------------------------------------------------------
+
+void GBA_SIOStateSave(_savestate_t *st)
+{
+    SaveState_WriteChunk(st, "SIO ", &SIO, sizeof(SIO));
+}
+
+void GBA_SIOStateLoad(_savestate_t *st)
+{
+    SaveState_ReadChunk(st, "SIO ", &SIO, sizeof(SIO));
+}
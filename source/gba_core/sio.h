@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef GBA_SIO__
+#define GBA_SIO__
+
+#include "gba.h"
+
+// Serial port in normal (8 and 32 bit) and multiplayer modes. If the link cable
+// is enabled in the configuration, the other end is another instance of the
+// emulator (see link_utils.h). The one that waits for the connection is the
+// parent in multiplayer mode. UART and general purpose modes aren't emulated.
+
+void GBA_SIOInit(void);
+void GBA_SIOEnd(void);
+
+void GBA_SIOWriteSIOCNT(u16 data);
+
+s32 GBA_SIOUpdate(s32 clocks);
+
+void GBA_SIOStateSave(_savestate_t *st);
+void GBA_SIOStateLoad(_savestate_t *st);
+
+#endif // GBA_SIO__
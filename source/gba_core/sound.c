@@ -11,19 +11,18 @@
 #include "../build_options.h"
 #include "../config.h"
 #include "../debug_utils.h"
+#include "../resample_utils.h"
 
 #include "cpu.h"
 #include "dma.h"
 #include "memory.h"
+#include "scheduler.h"
 #include "sound.h"
 
-// Quite a big buffer, but it works fine this way.  The bigger, the less
-// possibilities to underflow, but the more delay between actions and sound
-// output.
-//
-// Note: It must be a power of two.
-#define GBA_BUFFER_SIZE     (16384)
-#define GBA_BUFFER_SAMPLES  (GBA_BUFFER_SIZE / 2)
+// 16.78 MHz CPU / 22050 = 761. The output stream is resampled to the rate of
+// the output device.
+#define GBA_SOUND_SAMPLE_CLOCKS     (761)
+#define GBA_SOUND_SAMPLE_RATE       (16777216 / GBA_SOUND_SAMPLE_CLOCKS)
 
 static const s8 GBA_SquareWave[4][32] = {
     { -128, -128, -128, -128, -128, -128, -128, -128,
@@ -47,11 +46,35 @@ static const s8 GBA_SquareWave[4][32] = {
      -128, -128, -128, -128, 127, 127, 127, 127 }
 };
 
-static s8 GBA_WavePattern[64];
+static core_local__ s8 GBA_WavePattern[64];
 
 extern const u8 gb_noise_7[16]; // See gb_core/noise.c
 extern const u8 gb_noise_15[4096];
 
+// Direct Sound FIFOs. They hold 32 bytes, like the real ones. "head" and
+// "tail" are free running counters, the difference is the number of bytes in
+// the FIFO and they are only masked to index the buffer.
+#define FIFO_BUFFER_SIZE    (32)
+#define FIFO_REFILL_LEVEL   (16) // The DMA is requested at this level or below
+
+typedef struct
+{
+    int vol;
+
+    u32 speakerright;
+    u32 speakerleft;
+
+    u32 timer; // Timer 0 - 1
+
+    u8 buffer[FIFO_BUFFER_SIZE];
+    u32 head; // Next byte that is played
+    u32 tail; // Next byte that is written
+
+    u8 out_sample;
+
+    u32 running;
+} _gba_sound_fifo_t;
+
 typedef struct
 {
     struct // Tone & Sweep
@@ -60,7 +83,7 @@ typedef struct
 
         s32 freq;
 
-        u32 sweepstepsleft;
+        u32 sweepstepsleft; // Each step is 1/128 sec
         u32 sweeptime; // If 0, not active
         u32 sweepinc;
         u32 sweepshift;
@@ -72,7 +95,7 @@ typedef struct
         u32 envactive; // If != 0, activate
         u32 envelope;
         u32 envincrease;
-        u32 envstepstochange;
+        u32 envstepstochange; // Each step is 1/64 sec
 
         u32 stepsleft; // Each step is 1/256 sec
         u32 limittime; // Activates "stepsleft"
@@ -96,7 +119,7 @@ typedef struct
         u32 envactive; // If != 0, activate
         u32 envelope;
         u32 envincrease;
-        u32 envstepstochange;
+        u32 envstepstochange; // Each step is 1/64 sec
 
         u32 stepsleft; // Each step is 1/256 sec
         u32 limittime; // Activates "stepsleft"
@@ -146,7 +169,7 @@ typedef struct
         u32 envactive; // If != 0, activate
         u32 envelope;
         u32 envincrease;
-        u32 envstepstochange;
+        u32 envstepstochange; // Each step is 1/64 sec
 
         u32 stepsleft; // Each step is 1/256 sec
         u32 limittime; // Activates "stepsleft"
@@ -161,58 +184,17 @@ typedef struct
         u32 samplecount;
     } Chn4;
 
-#define FIFO_BUFFER_SIZE 128
-
-    struct // DMA A
-    {
-        int vol;
-
-        u32 speakerright;
-        u32 speakerleft;
-
-        u32 timer; // Timer 0 - 1
-
-        int cursample;
-        int cursamplewrite;
-        u8 buffer[FIFO_BUFFER_SIZE];
-        int datalen;
-
-        u8 out_sample;
-
-        u32 running;
-    } FifoA;
-
-    struct // DMA B
-    {
-        int vol;
-
-        u32 speakerright;
-        u32 speakerleft;
-
-        u32 timer; // Timer 0 - 1
-
-        int cursample;
-        int cursamplewrite;
-        u8 buffer[FIFO_BUFFER_SIZE];
-        int datalen;
-
-        u8 out_sample;
-
-        u32 running;
-    } FifoB;
+    _gba_sound_fifo_t FifoA; // DMA A
+    _gba_sound_fifo_t FifoB; // DMA B
 
     u32 leftvol;
     u32 rightvol;
-    u32 clocks;
+    u32 clocks; // Clocks since the last step of the frame sequencer
+    u32 sequencer_step; // 0 - 7
 
     int PSG_master_volume;
 
     u32 nextsample_clocks;
-    s16 buffer[GBA_BUFFER_SIZE / 2];
-    u32 buffer_next_input_sample;
-    u32 buffer_next_output_sample;
-    int samples_left_to_input;
-    int samples_left_to_output;
 
     // Some temporary variables to avoid doing the same calculations every time
     // a sample is going to be generated:
@@ -227,9 +209,76 @@ typedef struct
     u32 master_enable;
 } _GBA_SOUND_HARDWARE_;
 
-static _GBA_SOUND_HARDWARE_ Sound;
+static core_local__ _GBA_SOUND_HARDWARE_ Sound;
+
+static void GBA_SoundFifoReset(_gba_sound_fifo_t *fifo)
+{
+    fifo->head = 0;
+    fifo->tail = 0;
+    memset(fifo->buffer, 0, sizeof(fifo->buffer));
+}
+
+// Makes the next byte the one that is heard
+static void GBA_SoundFifoPop(_gba_sound_fifo_t *fifo)
+{
+    fifo->out_sample = fifo->buffer[fifo->head & (FIFO_BUFFER_SIZE - 1)];
+    fifo->head++;
+    fifo->running = 1;
+}
+
+// Writes to a full FIFO are lost
+static void GBA_SoundFifoPush(_gba_sound_fifo_t *fifo, u8 data)
+{
+    if ((fifo->tail - fifo->head) >= FIFO_BUFFER_SIZE)
+        return;
+
+    fifo->buffer[fifo->tail & (FIFO_BUFFER_SIZE - 1)] = data;
+    fifo->tail++;
+}
+
+// Kept out of the state of the hardware so that it can be saved as it is
+static core_local__ _resample_stream_t gba_sound_stream;
+
+static core_local__ int output_enabled;
 
-static int output_enabled;
+// While the output is suspended the hardware is still emulated, but no output
+// samples are generated. Unlike disabling the output, the samples that haven't
+// been played yet are kept.
+static core_local__ int output_suspended;
+
+// Writes to the PSG registers only change the samples that are mixed after
+// them. They are delayed until GBA_SoundUpdate() has mixed the samples that
+// were due before them. The write breaks the execution, so that happens at the
+// end of the same slice, before the CPU runs again.
+#define GBA_SOUND_WRITE_LOG_SIZE    (32)
+
+typedef struct
+{
+    u32 address;
+    u16 value;
+} _gba_sound_write_t;
+
+static core_local__ _gba_sound_write_t
+        gba_sound_write_log[GBA_SOUND_WRITE_LOG_SIZE];
+static core_local__ int gba_sound_write_log_count;
+
+static void GBA_SoundRegApply(u32 address, u16 value);
+
+static void GBA_SoundWriteLogReplay(void)
+{
+    for (int i = 0; i < gba_sound_write_log_count; i++)
+    {
+        _gba_sound_write_t *w = &gba_sound_write_log[i];
+        GBA_SoundRegApply(w->address, w->value);
+    }
+
+    gba_sound_write_log_count = 0;
+}
+
+void GBA_SoundSetOutputSuspended(int suspended)
+{
+    output_suspended = suspended;
+}
 
 int GBA_SoundHardwareIsOn(void)
 {
@@ -279,16 +328,10 @@ void GBA_SoundPowerOn(void)
     Sound.Chn4.seed = 0xFF;
 
     Sound.FifoA.out_sample = 0;
-    Sound.FifoA.cursample = 0;
-    Sound.FifoA.cursamplewrite = 0;
-    memset(Sound.FifoA.buffer, 0, sizeof(Sound.FifoA.buffer));
-    Sound.FifoA.datalen = 0;
+    GBA_SoundFifoReset(&Sound.FifoA);
 
     Sound.FifoB.out_sample = 0;
-    Sound.FifoB.cursample = 0;
-    Sound.FifoB.cursamplewrite = 0;
-    memset(Sound.FifoB.buffer, 0, sizeof(Sound.FifoB.buffer));
-    Sound.FifoB.datalen = 0;
+    GBA_SoundFifoReset(&Sound.FifoB);
 
     // While Bit 7 is cleared, both PSG and FIFO sounds are disabled, and all
     // PSG registers (4000060h..4000081h) are reset to zero (and must be
@@ -320,40 +363,41 @@ void GBA_SoundCallback(void *buffer, long len)
         return;
     }
 
-    // Should print: (GBA_BUFFER_SAMPLES / 3 * 2) - (GBA_BUFFER_SAMPLES / 3)
-    //Debug_LogMsgArg("%d, %d - %d %s", len,
-    //    Sound.samples_left_to_input, Sound.samples_left_to_output,
-    //    Sound.samples_left_to_output
-    //        > Sound.samples_left_to_input - (GBA_BUFFER_SAMPLES / 2) ?
-    //            "SLOW" : "FAST");
+    Resample_Read(&gba_sound_stream, (s16 *)buffer, len / 4);
+}
 
-    s16 *writebuffer = (s16 *)buffer;
+u32 GBA_SoundGetSampleRate(void)
+{
+    return GBA_SOUND_SAMPLE_RATE;
+}
 
-    if (Sound.samples_left_to_output < len / 4)
-        return;
+void GBA_SoundGetOutputStats(_resample_stats_t *stats)
+{
+    Resample_GetStats(&gba_sound_stream, stats);
+}
 
-    Sound.samples_left_to_input += len / 4;
-    Sound.samples_left_to_output -= len / 4;
+static core_local__ u32 gba_sound_frame_hash;
 
-    for (int i = 0; i < len / 2; i++)
-    {
-        writebuffer[i] = Sound.buffer[Sound.buffer_next_output_sample++];
-        Sound.buffer_next_output_sample &= GBA_BUFFER_SAMPLES - 1;
-    }
+void GBA_SoundFrameEnd(void)
+{
+    gba_sound_frame_hash = Resample_TakeHash(&gba_sound_stream);
+}
+
+u32 GBA_SoundGetFrameHash(void)
+{
+    return gba_sound_frame_hash;
 }
 
 void GBA_SoundResetBufferPointers(void)
 {
-    Sound.buffer_next_input_sample = 0;
-    Sound.buffer_next_output_sample = 0;
-    Sound.samples_left_to_input = GBA_BUFFER_SAMPLES;
-    Sound.samples_left_to_output = 0;
+    Resample_Reset(&gba_sound_stream, GBA_SOUND_SAMPLE_RATE);
 }
 
 void GBA_SoundInit(void)
 {
     // Prepare memory
     memset(&Sound, 0, sizeof(Sound));
+    gba_sound_write_log_count = 0;
     GBA_SoundResetBufferPointers();
     output_enabled = 1;
 
@@ -364,14 +408,8 @@ void GBA_SoundInit(void)
     Sound.leftvol_A = Sound.rightvol_A = 0;
     Sound.leftvol_B = Sound.rightvol_B = 0;
 
-    Sound.FifoA.cursample = 0;
-    Sound.FifoA.cursamplewrite = 0;
-    Sound.FifoA.datalen = 0;
-    memset(Sound.FifoA.buffer, 0, sizeof(Sound.FifoA.buffer));
-    Sound.FifoB.cursample = 0;
-    Sound.FifoB.cursamplewrite = 0;
-    Sound.FifoB.datalen = 0;
-    memset(Sound.FifoB.buffer, 0, sizeof(Sound.FifoB.buffer));
+    GBA_SoundFifoReset(&Sound.FifoA);
+    GBA_SoundFifoReset(&Sound.FifoB);
 
     // Set registers to initial values
     GBA_SoundRegWrite16(SOUND1CNT_L, 0);
@@ -457,392 +495,510 @@ void GBA_ToggleSound(void)
         GBA_SoundResetBufferPointers();
 }
 
-void GBA_SoundMix(void)
+// Maximum number of output samples mixed at once
+#define GBA_SOUND_MIX_BLOCK     (128)
+
+// Adds "count" samples of a channel that plays a waveform from a table. The
+// position in the table only depends on the number of samples played.
+static void GBA_SoundMixWave(s32 *left, s32 *right, int count,
+                             u32 *samplecount, u32 outfreq,
+                             const s8 *wave, int mask, int lvol, int rvol)
 {
-    //if (output_enabled == 0)
-    //return;
-    if (EmulatorConfig.snd_mute)
-        return;
+    u32 step = outfreq * (32 / 2);
+    u32 sample = *samplecount;
 
-    if (Sound.samples_left_to_input < 1)
-        return;
+    for (int i = 0; i < count; i++)
+    {
+        int index = ((sample++ * step) / 22050) & mask;
+        int out = (int)wave[index];
+        left[i] += out * lvol;
+        right[i] += out * rvol;
+    }
 
-    Sound.samples_left_to_input--;
-    Sound.samples_left_to_output++;
+    *samplecount = sample;
+}
 
-    if (Sound.master_enable == 0)
+static void GBA_SoundMixNoise(s32 *left, s32 *right, int count)
+{
+    const u8 *noise = Sound.Chn4.width_7 ? gb_noise_7 : gb_noise_15;
+    int noise_mask = Sound.Chn4.width_7 ? 15 : 4095;
+
+    u32 outfreq = Sound.Chn4.outfreq;
+    u32 sample = Sound.Chn4.samplecount;
+    int lvol = Sound.leftvol_4;
+    int rvol = Sound.rightvol_4;
+
+    for (int i = 0; i < count; i++)
     {
-        Sound.buffer[Sound.buffer_next_input_sample++] = 0;
-        Sound.buffer[Sound.buffer_next_input_sample++] = 0;
-        Sound.buffer_next_input_sample &= GBA_BUFFER_SAMPLES - 1;
-        return;
+        int value = (((sample++) * outfreq / 2) / 22050);
+
+        int out = (noise[(value / 8) & noise_mask] >> (7 - (value & 7))) & 1;
+        out = ((out * 2) - 1) * 127;
+        left[i] += out * lvol;
+        right[i] += out * rvol;
     }
 
-    s32 outvalue_left = 0, outvalue_right = 0;
+    Sound.Chn4.samplecount = sample;
+}
 
-    if (Sound.Chn1.running && (EmulatorConfig.chn_flags & 0x1))
+// Generates "count" output samples (up to GBA_SOUND_MIX_BLOCK). The state of
+// the channels doesn't change while they are generated, so the volumes and
+// enable flags are only checked once and each channel is mixed in its own loop.
+static void GBA_SoundMix(s16 *out, int count)
+{
+    if (EmulatorConfig.snd_mute || (Sound.master_enable == 0))
     {
-        int index = (((Sound.Chn1.samplecount++)
-                     * ((Sound.Chn1.outfreq) * (32 / 2))) / 22050) & 31;
-        int out_1 = (int)GBA_SquareWave[Sound.Chn1.duty][index];
-        outvalue_left += out_1 * Sound.leftvol_1;
-        outvalue_right += out_1 * Sound.rightvol_1;
+        memset(out, 0, count * 2 * sizeof(s16));
+        return;
     }
-    if (Sound.Chn2.running && (EmulatorConfig.chn_flags & 0x2))
+
+    s32 left[GBA_SOUND_MIX_BLOCK] = { 0 };
+    s32 right[GBA_SOUND_MIX_BLOCK] = { 0 };
+
+    int flags = EmulatorConfig.chn_flags;
+
+    if (Sound.Chn1.running && (flags & 0x1))
     {
-        int index = (((Sound.Chn2.samplecount++)
-                     * ((Sound.Chn2.outfreq) * (32 / 2))) / 22050) & 31;
-        int out_2 = (int)GBA_SquareWave[Sound.Chn2.duty][index];
-        outvalue_left += out_2 * Sound.leftvol_2;
-        outvalue_right += out_2 * Sound.rightvol_2;
+        GBA_SoundMixWave(left, right, count, &Sound.Chn1.samplecount,
+                         Sound.Chn1.outfreq, GBA_SquareWave[Sound.Chn1.duty],
+                         31, Sound.leftvol_1, Sound.rightvol_1);
     }
-    if (Sound.Chn3.running && (EmulatorConfig.chn_flags & 0x4))
+    if (Sound.Chn2.running && (flags & 0x2))
     {
-        int index = (((Sound.Chn3.samplecount++)
-                     * ((Sound.Chn3.outfreq) * (32 / 2))) / 22050) & 63;
-        int out_3 = (int)GBA_WavePattern[index];
-        outvalue_left += out_3 * Sound.leftvol_3;
-        outvalue_right += out_3 * Sound.rightvol_3;
+        GBA_SoundMixWave(left, right, count, &Sound.Chn2.samplecount,
+                         Sound.Chn2.outfreq, GBA_SquareWave[Sound.Chn2.duty],
+                         31, Sound.leftvol_2, Sound.rightvol_2);
     }
-    if (Sound.Chn4.running && (EmulatorConfig.chn_flags & 0x8))
+    if (Sound.Chn3.running && (flags & 0x4))
     {
-        int out_4;
-        int value = (((Sound.Chn4.samplecount++)
-                     * Sound.Chn4.outfreq / 2) / 22050);
-
-        if (Sound.Chn4.width_7) // 7 bit
-        {
-            out_4 = gb_noise_7[(value / 8) & 15] >> (7 - (value & 7));
-        }
-        else // 15 bit
-        {
-            out_4 = gb_noise_15[(value / 8) & 4095] >> (7 - (value & 7));
-        }
-
-        out_4 &= 1;
-        out_4 = ((out_4 * 2) - 1) * 127;
-        outvalue_left += out_4 * Sound.leftvol_4;
-        outvalue_right += out_4 * Sound.rightvol_4;
+        GBA_SoundMixWave(left, right, count, &Sound.Chn3.samplecount,
+                         Sound.Chn3.outfreq, GBA_WavePattern,
+                         63, Sound.leftvol_3, Sound.rightvol_3);
     }
+    if (Sound.Chn4.running && (flags & 0x8))
+        GBA_SoundMixNoise(left, right, count);
 
-    // PSG_master_volume = 0..2
-    outvalue_left = (outvalue_left * Sound.PSG_master_volume) >> 1;
-    outvalue_right = (outvalue_right * Sound.PSG_master_volume) >> 1;
     // -128..128 * 0..8 * 0..16 = -16384 .. +16384
     // Each PSG channel -> -16384 .. +16384
 
-    if (Sound.FifoA.running && (EmulatorConfig.chn_flags & 0x10))
+    // The FIFO output samples only change when a timer overflows, which can't
+    // happen in the middle of a block.
+    s32 fifo_left = 0, fifo_right = 0;
+
+    if (Sound.FifoA.running && (flags & 0x10))
     {
         int out_A = (int)(s8)Sound.FifoA.out_sample;
-        outvalue_left += out_A * Sound.leftvol_A * 256;   // leftvol_A = 0..2
-        outvalue_right += out_A * Sound.rightvol_A * 256; // "* 2" ????
-        //Debug_DebugMsgArg("%d - %d %d - %d %d", Sound.FifoA.out_sample,
-        //                  Sound.leftvol_A, Sound.rightvol_A,
-        //                  outvalue_left, outvalue_right);
+        fifo_left += out_A * Sound.leftvol_A * 256;   // leftvol_A = 0..2
+        fifo_right += out_A * Sound.rightvol_A * 256; // "* 2" ????
     }
-    if (Sound.FifoB.running && (EmulatorConfig.chn_flags & 0x20))
+    if (Sound.FifoB.running && (flags & 0x20))
     {
         int out_B = (int)(s8)Sound.FifoB.out_sample;
-        outvalue_left += out_B * Sound.leftvol_B * 256;   // leftvol_B = 0..2
-        outvalue_right += out_B * Sound.rightvol_B * 256; // "* 2" ????
+        fifo_left += out_B * Sound.leftvol_B * 256;   // leftvol_B = 0..2
+        fifo_right += out_B * Sound.rightvol_B * 256; // "* 2" ????
     }
     // -128..128 * 0..2 * 256 = -65536 .. +65536
     // FIFO channels -> -65536 .. +65536
 
-    // Add everything, total -> -81920 .. +81920 -- clamp to -65536 .. +65536
-    // Clamp to bias / 200h * 65536 ??
+    int psg_vol = Sound.PSG_master_volume; // 0..2
+    int volume = EmulatorConfig.volume;
+
+    for (int i = 0; i < count; i++)
+    {
+        s32 l = ((left[i] * psg_vol) >> 1) + fifo_left;
+        s32 r = ((right[i] * psg_vol) >> 1) + fifo_right;
 
-    if (outvalue_left > 65535)
-        outvalue_left = 65535;
-    else if (outvalue_left < (-65536))
-        outvalue_left = -65536;
+        // Add everything, total -> -81920 .. +81920 -- clamp to -65536 ..
+        // +65536. Clamp to bias / 200h * 65536 ??
 
-    if (outvalue_right > 65535)
-        outvalue_right = 65535;
-    else if (outvalue_right < (-65536))
-        outvalue_right = -65536;
+        if (l > 65535)
+            l = 65535;
+        else if (l < (-65536))
+            l = -65536;
 
-    outvalue_left >>= 1;
-    outvalue_right >>= 1;
+        if (r > 65535)
+            r = 65535;
+        else if (r < (-65536))
+            r = -65536;
 
-    Sound.buffer[Sound.buffer_next_input_sample++] =
-            (outvalue_left * EmulatorConfig.volume) / 128;
-    Sound.buffer[Sound.buffer_next_input_sample++] =
-            (outvalue_right * EmulatorConfig.volume) / 128;
-    Sound.buffer_next_input_sample &= GBA_BUFFER_SAMPLES - 1;
+        out[i * 2] = ((l >> 1) * volume) / 128;
+        out[i * 2 + 1] = ((r >> 1) * volume) / 128;
+    }
 }
 
-// Every 65535 clocks update hardware, every ~512 generate output
-u32 GBA_SoundUpdate(u32 clocks)
+// The frame sequencer runs at 512 Hz. The length counters are clocked in the
+// even steps (256 Hz), the sweep in steps 2 and 6 (128 Hz) and the envelopes in
+// step 7 (64 Hz).
+#define GBA_SOUND_SEQUENCER_CLOCKS  (16777216 / 512)
+
+#define GBA_SOUND_STEP_LENGTH       BIT(0)
+#define GBA_SOUND_STEP_SWEEP        BIT(1)
+#define GBA_SOUND_STEP_ENVELOPE     BIT(2)
+
+static const u32 gba_sound_sequencer_steps[8] = {
+    GBA_SOUND_STEP_LENGTH,
+    0,
+    GBA_SOUND_STEP_LENGTH | GBA_SOUND_STEP_SWEEP,
+    0,
+    GBA_SOUND_STEP_LENGTH,
+    0,
+    GBA_SOUND_STEP_LENGTH | GBA_SOUND_STEP_SWEEP,
+    GBA_SOUND_STEP_ENVELOPE
+};
+
+static void GBA_SoundLengthStep(void)
 {
-    Sound.clocks += clocks;
+    if (Sound.Chn1.running && Sound.Chn1.limittime)
+    {
+        if (Sound.Chn1.stepsleft > 0)
+            Sound.Chn1.stepsleft--;
 
-    if (output_enabled)
+        if (Sound.Chn1.stepsleft == 0)
+        {
+            Sound.Chn1.running = 0;
+            Sound.Chn1.envactive = 0;
+            REG_SOUNDCNT_X &= ~(1 << 0);
+        }
+    }
+
+    if (Sound.Chn2.running && Sound.Chn2.limittime)
     {
-        Sound.nextsample_clocks += clocks;
+        if (Sound.Chn2.stepsleft > 0)
+            Sound.Chn2.stepsleft--;
 
-        // 16777216 Hz?
+        if (Sound.Chn2.stepsleft == 0)
+        {
+            Sound.Chn2.running = 0;
+            Sound.Chn2.envactive = 0;
+            REG_SOUNDCNT_X &= ~(1 << 1);
+        }
+    }
 
-        // 16.78 MHz CPU / 22050 = 761
-        // 16.78 MHz CPU / 32768 Hz sound output = 512
+    if (Sound.Chn3.running && Sound.Chn3.limittime)
+    {
+        if (Sound.Chn3.stepsleft > 0)
+            Sound.Chn3.stepsleft--;
 
-        //This is an ugly hack to make sound buffer not overflow or underflow...
-        if (Sound.samples_left_to_output
-            > Sound.samples_left_to_input - (GBA_BUFFER_SAMPLES / 2))
+        if (Sound.Chn3.stepsleft == 0)
         {
-            if (Sound.nextsample_clocks > (761 + 10))
-            {
-                Sound.nextsample_clocks -= (761 + 10);
-                GBA_SoundMix();
-            }
+            Sound.Chn3.running = 0;
+            REG_SOUNDCNT_X &= ~(1 << 2);
         }
-        else
+    }
+
+    if (Sound.Chn4.running && Sound.Chn4.limittime)
+    {
+        if (Sound.Chn4.stepsleft > 0)
+            Sound.Chn4.stepsleft--;
+
+        if (Sound.Chn4.stepsleft == 0)
         {
-            if (Sound.nextsample_clocks > (761 - 10))
-            {
-                Sound.nextsample_clocks -= (761 - 10);
-                GBA_SoundMix();
-            }
+            Sound.Chn4.running = 0;
+            Sound.Chn4.envactive = 0;
+            REG_SOUNDCNT_X &= ~(1 << 3);
         }
     }
+}
+
+static void GBA_SoundSweepStep(void)
+{
+    if ((Sound.Chn1.running == 0) || (Sound.Chn1.sweeptime == 0))
+        return;
+
+    if (Sound.Chn1.sweepstepsleft > 0)
+        Sound.Chn1.sweepstepsleft--;
+
+    if (Sound.Chn1.sweepstepsleft > 0)
+        return;
+
+    Sound.Chn1.sweepstepsleft = Sound.Chn1.sweeptime;
 
-    // 16.78 MHz CPU / 256 Steps per second (aprox)
-    if (Sound.clocks > 65535)
-        Sound.clocks -= 65536;
+    if (Sound.Chn1.sweepinc)
+    {
+        Sound.Chn1.sweepfreq += Sound.Chn1.sweepfreq
+                                / (1 << Sound.Chn1.sweepshift);
+    }
     else
-        return 65536 - Sound.clocks;
+    {
+        Sound.Chn1.sweepfreq -= Sound.Chn1.sweepfreq
+                                / (1 << Sound.Chn1.sweepshift);
+    }
 
-    if (Sound.master_enable == 0)
-        return 65536 - Sound.clocks;
+    // This isn't correct, but it prevents a division by zero
+    Sound.Chn1.sweepfreq &= 2047;
 
-    // Channel 1
-    if (Sound.Chn1.running)
+    Sound.Chn1.outfreq = 131072 / (2048 - Sound.Chn1.sweepfreq);
+}
+
+// Returns the new volume, or -1 if the envelope has finished
+static int GBA_SoundEnvelopeVolume(u32 vol, u32 increase)
+{
+    if (increase)
+        return (vol < 0x0F) ? (int)(vol + 1) : -1;
+    else
+        return (vol > 0) ? (int)(vol - 1) : -1;
+}
+
+static void GBA_SoundEnvelopeStep(void)
+{
+    if (Sound.Chn1.running && Sound.Chn1.envactive && Sound.Chn1.envelope)
     {
-        if (Sound.Chn1.limittime)
+        if (Sound.Chn1.envstepstochange > 0)
+            Sound.Chn1.envstepstochange--;
+
+        if (Sound.Chn1.envstepstochange == 0)
         {
-            if (Sound.Chn1.stepsleft > 0)
+            Sound.Chn1.envstepstochange = Sound.Chn1.envelope;
+
+            int vol = GBA_SoundEnvelopeVolume(Sound.Chn1.vol,
+                                              Sound.Chn1.envincrease);
+            if (vol >= 0)
             {
-                Sound.Chn1.stepsleft--;
+                Sound.Chn1.vol = vol;
+                Sound.leftvol_1 = Sound.Chn1.speakerleft ?
+                                (Sound.Chn1.vol * Sound.leftvol) : 0;
+                Sound.rightvol_1 = Sound.Chn1.speakerright ?
+                                (Sound.Chn1.vol * Sound.rightvol) : 0;
             }
             else
             {
-                Sound.Chn1.running = 0;
                 Sound.Chn1.envactive = 0;
-                REG_SOUNDCNT_X &= ~(1 << 0);
             }
         }
-        if (Sound.Chn1.envactive && Sound.Chn1.envelope)
+    }
+
+    if (Sound.Chn2.running && Sound.Chn2.envactive && Sound.Chn2.envelope)
+    {
+        if (Sound.Chn2.envstepstochange > 0)
+            Sound.Chn2.envstepstochange--;
+
+        if (Sound.Chn2.envstepstochange == 0)
         {
-            if (Sound.Chn1.envstepstochange == 0)
-            {
-                Sound.Chn1.envstepstochange = Sound.Chn1.envelope << 2;
+            Sound.Chn2.envstepstochange = Sound.Chn2.envelope;
 
-                if (Sound.Chn1.envincrease)
-                {
-                    if (Sound.Chn1.vol < 0x0F)
-                    {
-                        Sound.Chn1.vol++;
-                        Sound.leftvol_1 = Sound.Chn1.speakerleft ?
-                                        (Sound.Chn1.vol * Sound.leftvol) : 0;
-                        Sound.rightvol_1 = Sound.Chn1.speakerright ?
-                                        (Sound.Chn1.vol * Sound.rightvol) : 0;
-                    }
-                    else
-                    {
-                        Sound.Chn1.envactive = 0;
-                    }
-                }
-                else
-                {
-                    if (Sound.Chn1.vol > 0)
-                    {
-                        Sound.Chn1.vol--;
-                        Sound.leftvol_1 = Sound.Chn1.speakerleft ?
-                                        (Sound.Chn1.vol * Sound.leftvol) : 0;
-                        Sound.rightvol_1 = Sound.Chn1.speakerright ?
-                                        (Sound.Chn1.vol * Sound.rightvol) : 0;
-                    }
-                    else
-                    {
-                        Sound.Chn1.envactive = 0;
-                    }
-                }
+            int vol = GBA_SoundEnvelopeVolume(Sound.Chn2.vol,
+                                              Sound.Chn2.envincrease);
+            if (vol >= 0)
+            {
+                Sound.Chn2.vol = vol;
+                Sound.leftvol_2 = Sound.Chn2.speakerleft ?
+                                (Sound.Chn2.vol * Sound.leftvol) : 0;
+                Sound.rightvol_2 = Sound.Chn2.speakerright ?
+                                (Sound.Chn2.vol * Sound.rightvol) : 0;
             }
             else
             {
-                Sound.Chn1.envstepstochange--;
+                Sound.Chn2.envactive = 0;
             }
         }
-        if (Sound.Chn1.sweeptime > 0)
-        {
-            if (Sound.Chn1.sweepstepsleft == 0)
-            {
-                Sound.Chn1.sweepstepsleft = Sound.Chn1.sweeptime << 1;
+    }
 
-                if (Sound.Chn1.sweepinc)
-                {
-                    Sound.Chn1.sweepfreq += Sound.Chn1.sweepfreq
-                                            / (1 << Sound.Chn1.sweepshift);
-                }
-                else
-                {
-                    Sound.Chn1.sweepfreq -= Sound.Chn1.sweepfreq
-                                            / (1 << Sound.Chn1.sweepshift);
-                }
+    if (Sound.Chn4.running && Sound.Chn4.envactive && Sound.Chn4.envelope)
+    {
+        if (Sound.Chn4.envstepstochange > 0)
+            Sound.Chn4.envstepstochange--;
 
-                // This isn't correct, but it prevents a division by zero
-                Sound.Chn1.sweepfreq &= 2047;
+        if (Sound.Chn4.envstepstochange == 0)
+        {
+            Sound.Chn4.envstepstochange = Sound.Chn4.envelope;
 
-                Sound.Chn1.outfreq = 131072 / (2048 - Sound.Chn1.sweepfreq);
+            int vol = GBA_SoundEnvelopeVolume(Sound.Chn4.vol,
+                                              Sound.Chn4.envincrease);
+            if (vol >= 0)
+            {
+                Sound.Chn4.vol = vol;
+                Sound.leftvol_4 = Sound.Chn4.speakerleft ?
+                                (Sound.Chn4.vol * Sound.leftvol) : 0;
+                Sound.rightvol_4 = Sound.Chn4.speakerright ?
+                                (Sound.Chn4.vol * Sound.rightvol) : 0;
             }
             else
             {
-                Sound.Chn1.sweepstepsleft--;
+                Sound.Chn4.envactive = 0;
             }
         }
     }
+}
+
+// Returns the kind of steps of the frame sequencer that would change the state
+// of any channel. Idle channels don't need the sequencer at all.
+static u32 GBA_SoundSequencerStepsNeeded(void)
+{
+    u32 needed = 0;
+
+    if (Sound.master_enable == 0)
+        return 0;
+
+    if (Sound.Chn1.running)
+    {
+        if (Sound.Chn1.limittime)
+            needed |= GBA_SOUND_STEP_LENGTH;
+        if (Sound.Chn1.sweeptime > 0)
+            needed |= GBA_SOUND_STEP_SWEEP;
+        if (Sound.Chn1.envactive && Sound.Chn1.envelope)
+            needed |= GBA_SOUND_STEP_ENVELOPE;
+    }
 
-    // Channel 2
     if (Sound.Chn2.running)
     {
         if (Sound.Chn2.limittime)
-        {
-            if (Sound.Chn2.stepsleft > 0)
-            {
-                Sound.Chn2.stepsleft--;
-            }
-            else
-            {
-                Sound.Chn2.running = 0;
-                Sound.Chn2.envactive = 0;
-                REG_SOUNDCNT_X &= ~(1 << 1);
-            }
-        }
+            needed |= GBA_SOUND_STEP_LENGTH;
         if (Sound.Chn2.envactive && Sound.Chn2.envelope)
-        {
-            if (Sound.Chn2.envstepstochange == 0)
-            {
-                Sound.Chn2.envstepstochange = Sound.Chn2.envelope << 2;
+            needed |= GBA_SOUND_STEP_ENVELOPE;
+    }
 
-                if (Sound.Chn2.envincrease)
-                {
-                    if (Sound.Chn2.vol < 0x0F)
-                    {
-                        Sound.Chn2.vol++;
-                        Sound.leftvol_2 = Sound.Chn2.speakerleft ?
-                                        (Sound.Chn2.vol * Sound.leftvol) : 0;
-                        Sound.rightvol_2 = Sound.Chn2.speakerright ?
-                                        (Sound.Chn2.vol * Sound.rightvol) : 0;
-                    }
-                    else
-                    {
-                        Sound.Chn2.envactive = 0;
-                    }
-                }
-                else
-                {
-                    if (Sound.Chn2.vol > 0)
-                    {
-                        Sound.Chn2.vol--;
-                        Sound.leftvol_2 = Sound.Chn2.speakerleft ?
-                                        (Sound.Chn2.vol * Sound.leftvol) : 0;
-                        Sound.rightvol_2 = Sound.Chn2.speakerright ?
-                                        (Sound.Chn2.vol * Sound.rightvol) : 0;
-                    }
-                    else
-                    {
-                        Sound.Chn2.envactive = 0;
-                    }
-                }
-            }
-            else
-            {
-                Sound.Chn2.envstepstochange--;
-            }
-        }
+    if (Sound.Chn3.running && Sound.Chn3.limittime)
+        needed |= GBA_SOUND_STEP_LENGTH;
+
+    if (Sound.Chn4.running)
+    {
+        if (Sound.Chn4.limittime)
+            needed |= GBA_SOUND_STEP_LENGTH;
+        if (Sound.Chn4.envactive && Sound.Chn4.envelope)
+            needed |= GBA_SOUND_STEP_ENVELOPE;
     }
 
-    // Channel 3
-    if (Sound.Chn3.running)
+    return needed;
+}
+
+static void GBA_SoundSequencerStep(void)
+{
+    u32 steps = gba_sound_sequencer_steps[Sound.sequencer_step];
+
+    Sound.sequencer_step = (Sound.sequencer_step + 1) & 7;
+
+    if (Sound.master_enable == 0)
+        return;
+
+    if (steps & GBA_SOUND_STEP_LENGTH)
+        GBA_SoundLengthStep();
+    if (steps & GBA_SOUND_STEP_SWEEP)
+        GBA_SoundSweepStep();
+    if (steps & GBA_SOUND_STEP_ENVELOPE)
+        GBA_SoundEnvelopeStep();
+}
+
+// Output samples are generated in batches. Everything that changes the output
+// of the channels brings the sound up to date before doing it: the register
+// write handlers enable polling, and the timers sync it before the FIFOs play
+// their next sample. That way, each sample is generated with the state the
+// hardware had at its time.
+#define GBA_SOUND_SAMPLES_PER_UPDATE    (128)
+
+// The sound is only updated when a batch of output samples has to be generated
+// or when a step of the frame sequencer changes the state of a channel.
+s32 GBA_SoundUpdate(s32 clocks)
+{
+    if (output_enabled && (output_suspended == 0))
     {
-        if (Sound.Chn3.stepsleft > 0)
+        Sound.nextsample_clocks += clocks;
+
+        // 16777216 Hz?
+
+        // One sample is generated every time that the counter goes over
+        // GBA_SOUND_SAMPLE_CLOCKS, and it's reduced by that amount each time.
+        u32 samples = 0;
+        if (Sound.nextsample_clocks > GBA_SOUND_SAMPLE_CLOCKS)
         {
-            Sound.Chn3.stepsleft--;
+            samples = (Sound.nextsample_clocks - 1) / GBA_SOUND_SAMPLE_CLOCKS;
+            Sound.nextsample_clocks -= samples * GBA_SOUND_SAMPLE_CLOCKS;
         }
-        else if (Sound.Chn3.limittime)
+
+        while (samples > 0)
         {
-            Sound.Chn3.running = 0;
-            REG_SOUNDCNT_X &= ~(1 << 2);
+            s16 out[GBA_SOUND_MIX_BLOCK * 2];
+            int count = (samples > GBA_SOUND_MIX_BLOCK) ?
+                        GBA_SOUND_MIX_BLOCK : samples;
+
+            GBA_SoundMix(out, count);
+            Resample_WriteFrames(&gba_sound_stream, out, count);
+
+            samples -= count;
         }
+
+        Resample_Flush(&gba_sound_stream);
     }
 
-    // Channel 4
-    if (Sound.Chn4.running)
+    GBA_SoundWriteLogReplay();
+
+    Sound.clocks += clocks;
+
+    // Steps that don't do anything only advance the frame sequencer
+    if (Sound.clocks >= GBA_SOUND_SEQUENCER_CLOCKS)
     {
-        if (Sound.Chn4.limittime)
+        if (GBA_SoundSequencerStepsNeeded() == 0)
         {
-            if (Sound.Chn4.stepsleft > 0)
-            {
-                Sound.Chn4.stepsleft--;
-            }
-            else
-            {
-                Sound.Chn4.running = 0;
-                Sound.Chn4.envactive = 0;
-                REG_SOUNDCNT_X &= ~(1 << 3);
-            }
+            u32 steps = Sound.clocks / GBA_SOUND_SEQUENCER_CLOCKS;
+            Sound.clocks -= steps * GBA_SOUND_SEQUENCER_CLOCKS;
+            Sound.sequencer_step = (Sound.sequencer_step + steps) & 7;
         }
-        if (Sound.Chn4.envactive && Sound.Chn4.envelope)
+        else
         {
-            if (Sound.Chn4.envstepstochange == 0)
-            {
-                Sound.Chn4.envstepstochange = Sound.Chn4.envelope << 2;
-
-                if (Sound.Chn4.envincrease)
-                {
-                    if (Sound.Chn4.vol < 0x0F)
-                    {
-                        Sound.Chn4.vol++;
-                        Sound.leftvol_4 = Sound.Chn4.speakerleft ?
-                                        (Sound.Chn4.vol * Sound.leftvol) : 0;
-                        Sound.rightvol_4 = Sound.Chn4.speakerright ?
-                                        (Sound.Chn4.vol * Sound.rightvol) : 0;
-                    }
-                    else
-                    {
-                        Sound.Chn4.envactive = 0;
-                    }
-                }
-                else
-                {
-                    if (Sound.Chn4.vol > 0)
-                    {
-                        Sound.Chn4.vol--;
-                        Sound.leftvol_4 = Sound.Chn4.speakerleft ?
-                                        (Sound.Chn4.vol * Sound.leftvol) : 0;
-                        Sound.rightvol_4 = Sound.Chn4.speakerright ?
-                                        (Sound.Chn4.vol * Sound.rightvol) : 0;
-                    }
-                    else
-                    {
-                        Sound.Chn4.envactive = 0;
-                    }
-                }
-            }
-            else
+            while (Sound.clocks >= GBA_SOUND_SEQUENCER_CLOCKS)
             {
-                Sound.Chn4.envstepstochange--;
+                Sound.clocks -= GBA_SOUND_SEQUENCER_CLOCKS;
+                GBA_SoundSequencerStep();
             }
         }
     }
 
-    return 65536 - Sound.clocks;
+    GBA_SchedulerSetPolling(GBA_EVENT_SOUND, 0);
+
+    s32 next = 0x7FFFFFFF;
+
+    // Last output sample of the next batch
+    if (output_enabled && (output_suspended == 0))
+    {
+        next = (GBA_SOUND_SAMPLE_CLOCKS * GBA_SOUND_SAMPLES_PER_UPDATE) + 1
+               - Sound.nextsample_clocks;
+    }
+
+    // Next step of the frame sequencer that does something
+    u32 needed = GBA_SoundSequencerStepsNeeded();
+    if (needed)
+    {
+        s32 step_clocks = GBA_SOUND_SEQUENCER_CLOCKS - Sound.clocks;
+        for (int i = 0; i < 8; i++)
+        {
+            u32 step = (Sound.sequencer_step + i) & 7;
+            if (gba_sound_sequencer_steps[step] & needed)
+                break;
+            step_clocks += GBA_SOUND_SEQUENCER_CLOCKS;
+        }
+        if (step_clocks < next)
+            next = step_clocks;
+    }
+
+    return next;
 }
 
 void GBA_SoundRegWrite16(u32 address, u16 value)
 {
-    GBA_ExecutionBreak();
+    GBA_ExecutionBreak(PROFILE_SLICE_APU);
+
+    GBA_SchedulerSetPolling(GBA_EVENT_SOUND, 1);
+
+    // SOUNDCNT_H, SOUNDCNT_X, SOUNDBIAS and the FIFOs are used by the Direct
+    // Sound channels, which aren't driven by GBA_SoundUpdate(). They are
+    // applied right away, after any write that is waiting.
+    int psg = (address < SOUNDCNT_H)
+              || ((address >= WAVE_RAM) && (address < FIFO_A));
 
+    if (psg && (gba_sound_write_log_count < GBA_SOUND_WRITE_LOG_SIZE))
+    {
+        _gba_sound_write_t *w = &gba_sound_write_log[gba_sound_write_log_count];
+        w->address = address;
+        w->value = value;
+        gba_sound_write_log_count++;
+        return;
+    }
+
+    GBA_SoundWriteLogReplay();
+    GBA_SoundRegApply(address, value);
+}
+
+static void GBA_SoundRegApply(u32 address, u16 value)
+{
     if (Sound.master_enable == 0)
     {
         if ((address == SOUNDCNT_X) && (value & (1 << 7)))
@@ -873,7 +1029,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
         case SOUND1CNT_H:
             Sound.Chn1.reg[1] = value;
 
-            Sound.Chn1.stepsleft = (64 - (value & 0x3F)) << 2;
+            Sound.Chn1.stepsleft = 64 - (value & 0x3F);
             Sound.Chn1.duty = (value >> 6) & 3;
 
             // Don't update envelope yet...
@@ -900,7 +1056,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
 
                 // Update sweep
                 Sound.Chn1.sweeptime = (Sound.Chn1.reg[0] >> 4) & 0x07;
-                Sound.Chn1.sweepstepsleft = Sound.Chn1.sweeptime << 1;
+                Sound.Chn1.sweepstepsleft = Sound.Chn1.sweeptime;
                 Sound.Chn1.sweepinc = ((Sound.Chn1.reg[0] & (1 << 3)) == 0);
                 Sound.Chn1.sweepshift = Sound.Chn1.reg[0] & 0x07;
                 Sound.Chn1.sweepfreq = Sound.Chn1.freq;
@@ -910,7 +1066,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
                 Sound.Chn1.envelope = (Sound.Chn1.reg[1] >> 8) & 0x07;
                 Sound.Chn1.envactive = 1; //Sound.Chn1.envelope != 0;
                 Sound.Chn1.envincrease = Sound.Chn1.reg[1] & (1 << 11);
-                Sound.Chn1.envstepstochange = Sound.Chn1.envelope << 2;
+                Sound.Chn1.envstepstochange = Sound.Chn1.envelope;
                 Sound.leftvol_1 = Sound.Chn1.speakerleft ?
                                         (Sound.Chn1.vol * Sound.leftvol) : 0;
                 Sound.rightvol_1 = Sound.Chn1.speakerright ?
@@ -928,7 +1084,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
         case SOUND2CNT_L:
             Sound.Chn2.reg[1] = value;
 
-            Sound.Chn2.stepsleft = (64 - (value & 0x3F)) << 2;
+            Sound.Chn2.stepsleft = 64 - (value & 0x3F);
             Sound.Chn2.duty = (value >> 6) & 3;
 
             // Don't update envelope yet...
@@ -959,7 +1115,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
                 Sound.Chn2.envelope = (Sound.Chn2.reg[1] >> 8) & 0x07;
                 Sound.Chn2.envactive = 1; //Sound.Chn2.envelope != 0;
                 Sound.Chn2.envincrease = Sound.Chn2.reg[1] & (1 << 11);
-                Sound.Chn2.envstepstochange = Sound.Chn2.envelope << 2;
+                Sound.Chn2.envstepstochange = Sound.Chn2.envelope;
                 Sound.leftvol_2 = Sound.Chn2.speakerleft ?
                                         (Sound.Chn2.vol * Sound.leftvol) : 0;
                 Sound.rightvol_2 = Sound.Chn2.speakerright ?
@@ -999,7 +1155,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
         case SOUND3CNT_H:
             Sound.Chn3.reg[1] = value;
 
-            Sound.Chn3.stepsleft = (256 - value) << 2;
+            Sound.Chn3.stepsleft = 256 - (value & 0xFF);
 
             if (value & BIT(15))
             {
@@ -1059,7 +1215,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
         case SOUND4CNT_L:
             Sound.Chn4.reg[1] = value;
 
-            Sound.Chn4.stepsleft = (64 - (value & 0x3F)) << 2;
+            Sound.Chn4.stepsleft = 64 - (value & 0x3F);
 
             // Don't update envelope yet...
 
@@ -1105,7 +1261,7 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
                 Sound.Chn4.envelope = (Sound.Chn4.reg[1] >> 8) & 0x07;
                 Sound.Chn4.envactive = 1; //Sound.Chn4.envelope != 0;
                 Sound.Chn4.envincrease = Sound.Chn4.reg[1] & (1 << 11);
-                Sound.Chn4.envstepstochange = Sound.Chn4.envelope << 2;
+                Sound.Chn4.envstepstochange = Sound.Chn4.envelope;
                 Sound.leftvol_4 = Sound.Chn4.speakerleft ?
                                         (Sound.Chn4.vol * Sound.leftvol) : 0;
                 Sound.rightvol_4 = Sound.Chn4.speakerright ?
@@ -1183,24 +1339,17 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
             Sound.leftvol_B = Sound.FifoB.speakerleft ? Sound.FifoB.vol : 0;
             Sound.rightvol_B = Sound.FifoB.speakerright ? Sound.FifoB.vol : 0;
 
+            // The timers only schedule the overflows that the FIFOs use
+            GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 1);
+
             Sound.FifoA.timer = (value & BIT(10)) ? 1 : 0;
             Sound.FifoB.timer = (value & BIT(14)) ? 1 : 0;
 
             if (value & BIT(11))
-            {
-                Sound.FifoA.cursample = 0;
-                Sound.FifoA.cursamplewrite = 0;
-                Sound.FifoA.datalen = 0;
-                memset(Sound.FifoA.buffer, 0, sizeof(Sound.FifoA.buffer));
-            }
+                GBA_SoundFifoReset(&Sound.FifoA);
 
             if (value & BIT(15))
-            {
-                Sound.FifoB.cursample = 0;
-                Sound.FifoB.cursamplewrite = 0;
-                Sound.FifoB.datalen = 0;
-                memset(Sound.FifoB.buffer, 0, sizeof(Sound.FifoB.buffer));
-            }
+                GBA_SoundFifoReset(&Sound.FifoB);
             return;
         }
 
@@ -1270,83 +1419,96 @@ void GBA_SoundRegWrite16(u32 address, u16 value)
         }
 
         case FIFO_A + 0:
-        {
-            int index = Sound.FifoA.cursamplewrite;
-            Sound.FifoA.buffer[index + 0] = value & 0xFF;
-            Sound.FifoA.buffer[index + 1] = (value >> 8) & 0xFF;
-            Sound.FifoA.datalen += 2;
-            return;
-        }
         case FIFO_A + 2:
-        {
-            int index = Sound.FifoA.cursamplewrite;
-            Sound.FifoA.buffer[index + 2] = value & 0xFF;
-            Sound.FifoA.buffer[index + 3] = (value >> 8) & 0xFF;
-            Sound.FifoA.datalen += 2;
-            Sound.FifoA.cursamplewrite += 4;
-            Sound.FifoA.cursamplewrite &= FIFO_BUFFER_SIZE - 1;
+            GBA_SoundFifoPush(&Sound.FifoA, value & 0xFF);
+            GBA_SoundFifoPush(&Sound.FifoA, (value >> 8) & 0xFF);
             return;
-        }
         case FIFO_B + 0:
-        {
-            int index = Sound.FifoB.cursamplewrite;
-            Sound.FifoB.buffer[index + 0] = value & 0xFF;
-            Sound.FifoB.buffer[index + 1] = (value >> 8) & 0xFF;
-            Sound.FifoB.datalen += 2;
-            return;
-        }
         case FIFO_B + 2:
-        {
-            int index = Sound.FifoB.cursamplewrite;
-            Sound.FifoB.buffer[index + 2] = value & 0xFF;
-            Sound.FifoB.buffer[index + 3] = (value >> 8) & 0xFF;
-            Sound.FifoB.datalen += 2;
-            Sound.FifoB.cursamplewrite += 4;
-            Sound.FifoB.cursamplewrite &= FIFO_BUFFER_SIZE - 1;
+            GBA_SoundFifoPush(&Sound.FifoB, value & 0xFF);
+            GBA_SoundFifoPush(&Sound.FifoB, (value >> 8) & 0xFF);
             return;
-        }
 
         case SOUNDBIAS:
             return;
 
         default:
             Debug_DebugMsgArg("GBA Sound: [%08x]=%04x (?)\n", address, value);
-            GBA_ExecutionBreak();
+            GBA_ExecutionBreak(PROFILE_SLICE_APU);
             return;
     }
 }
 
-void GBA_SoundTimerCheck(int number)
+void GBA_SoundFifoWrite(u32 address, const u8 *data)
 {
-    if (Sound.FifoA.timer == number)
+    REG_32(address) = *(const u32 *)&data[12];
+
+    _gba_sound_fifo_t *fifo = (address == FIFO_A) ? &Sound.FifoA : &Sound.FifoB;
+
+    for (int i = 0; i < 16; i++)
+        GBA_SoundFifoPush(fifo, data[i]);
+}
+
+int GBA_SoundTimerIsUsed(int number)
+{
+    return (Sound.FifoA.timer == number) || (Sound.FifoB.timer == number);
+}
+
+// Plays the samples of a FIFO for the specified number of overflows of its
+// timer. Only the last one can be heard, the mixer hasn't run in between.
+static void GBA_SoundFifoTimerOverflow(_gba_sound_fifo_t *fifo, u32 overflows,
+                                       int A, int B)
+{
+    while (overflows > 0)
     {
-        Sound.FifoA.running = 0;
-        if (Sound.FifoA.datalen > 0)
+        u32 level = fifo->tail - fifo->head;
+
+        // The pops that leave more than FIFO_REFILL_LEVEL bytes don't request
+        // the DMA, so all of them can be done at once.
+        if (level > (FIFO_REFILL_LEVEL + 1))
         {
-            Sound.FifoA.datalen--;
-            Sound.FifoA.out_sample = Sound.FifoA.buffer[Sound.FifoA.cursample++];
-            Sound.FifoA.cursample &= FIFO_BUFFER_SIZE - 1;
-            Sound.FifoA.running = 1;
+            u32 pops = level - (FIFO_REFILL_LEVEL + 1);
+            if (pops > overflows)
+                pops = overflows;
+
+            fifo->head += pops - 1;
+            GBA_SoundFifoPop(fifo);
+
+            overflows -= pops;
+            continue;
         }
-        if (Sound.FifoA.datalen <= 16) // Request data!!!
-            GBA_DMASoundRequestData(1, 0);
-    }
 
-    if (Sound.FifoB.timer == number)
-    {
-        Sound.FifoB.running = 0;
-        if (Sound.FifoB.datalen > 0)
+        fifo->running = 0;
+        if (level > 0)
+            GBA_SoundFifoPop(fifo);
+
+        GBA_DMASoundRequestData(A, B);
+
+        overflows--;
+
+        // If the DMA hasn't refilled it, it won't do it in the next overflows
+        // either, and they would only find the FIFO empty.
+        if (fifo->tail == fifo->head)
         {
-            Sound.FifoB.datalen--;
-            Sound.FifoB.out_sample = Sound.FifoB.buffer[Sound.FifoB.cursample++];
-            Sound.FifoB.cursample &= FIFO_BUFFER_SIZE - 1;
-            Sound.FifoB.running = 1;
+            if (overflows > 0)
+                fifo->running = 0;
+            return;
         }
-        if (Sound.FifoB.datalen <= 16) // Request data!!!
-            GBA_DMASoundRequestData(0, 1);
     }
 }
 
+void GBA_SoundTimerOverflow(int number, u32 overflows)
+{
+    // Generate the samples before this point with the current FIFO samples
+    GBA_SchedulerSync(GBA_EVENT_SOUND);
+
+    if (Sound.FifoA.timer == number)
+        GBA_SoundFifoTimerOverflow(&Sound.FifoA, overflows, 1, 0);
+
+    if (Sound.FifoB.timer == number)
+        GBA_SoundFifoTimerOverflow(&Sound.FifoB, overflows, 0, 1);
+}
+
 void GBA_SoundEnd(void)
 {
 
@@ -1384,3 +1546,26 @@ int gba_debug_get_psg_vol(int chan)
             return 0;
     }
 }
+
+//------------------------------------------------------------------------------
+
+void GBA_SoundStateSave(_savestate_t *st)
+{
+    // It's always empty between slices, this is just in case
+    GBA_SoundWriteLogReplay();
+
+    SaveState_ChunkBegin(st, "SND ");
+    SaveState_Write(st, &Sound, sizeof(Sound));
+    SaveState_Write(st, GBA_WavePattern, sizeof(GBA_WavePattern));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_SoundStateLoad(_savestate_t *st)
+{
+    SaveState_ChunkOpen(st, "SND ");
+    SaveState_Read(st, &Sound, sizeof(Sound));
+    SaveState_Read(st, GBA_WavePattern, sizeof(GBA_WavePattern));
+    SaveState_ChunkClose(st);
+
+    gba_sound_write_log_count = 0;
+}
@@ -8,16 +8,34 @@
 #define GBA_SOUND__
 
 #include "../general_utils.h"
+#include "../resample_utils.h"
+#include "../savestate_utils.h"
 
 void GBA_SoundInit(void);
 int GBA_SoundHardwareIsOn(void);
 void GB_ToggleSound(void);
-u32 GBA_SoundUpdate(u32 clocks);
+s32 GBA_SoundUpdate(s32 clocks);
 void GBA_SoundRegWrite16(u32 address, u16 value);
+// Same as writing the 4 words at "data" to FIFO_A or FIFO_B, used by sound DMA
+void GBA_SoundFifoWrite(u32 address, const u8 *data);
 void GBA_SoundResetBufferPointers(void);
+void GBA_SoundSetOutputSuspended(int suspended);
 void GBA_SoundEnd(void);
+
+void GBA_SoundStateSave(_savestate_t *st);
+void GBA_SoundStateLoad(_savestate_t *st);
 void GBA_SoundCallback(void *buffer, long len);
-void GBA_SoundTimerCheck(int number);
+// Rate at which the samples are generated, in Hz
+u32 GBA_SoundGetSampleRate(void);
+// Health of the buffer between the emulation and the audio callback
+void GBA_SoundGetOutputStats(_resample_stats_t *stats);
+// Called at the end of each frame. The hash is the CRC32C of the samples that
+// were generated during the frame.
+void GBA_SoundFrameEnd(void);
+u32 GBA_SoundGetFrameHash(void);
+int GBA_SoundTimerIsUsed(int number); // Returns 1 if a FIFO uses that timer
+// Called when a timer used by a FIFO overflows one or more times
+void GBA_SoundTimerOverflow(int number, u32 overflows);
 
 void GBA_SoundGetConfig(int *vol, int *chn_flags);
 void GBA_SoundSetConfig(int vol, int chn_flags);
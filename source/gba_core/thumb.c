@@ -4,11 +4,15 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stddef.h>
+
 #include "../build_options.h"
 #include "../debug_utils.h"
-#include "../gui/win_gba_debugger.h"
+#include "../opprofile_utils.h"
+#include "../trace_utils.h"
 
 #include "bios.h"
+#include "code_cache.h"
 #include "cpu.h"
 #include "disassembler.h"
 #include "gba.h"
@@ -62,14 +66,35 @@ static u32 thumb_bit_count(u16 value)
     return count;
 }
 
-static void thumb_ldm(u32 address, u32 reg)
+// The registers of the list are transferred in order, the lowest one from or to
+// "address" and the others from or to the next words. "count" is the number of
+// registers in the list.
+
+static void thumb_ldm_list(u32 address, u32 registers, u32 count)
 {
-    CPU.R[reg] = GBA_MemoryRead32(address & ~3);
+    u32 data[16];
+    GBA_MemoryRead32Multiple(address & ~3, data, count);
+
+    u32 n = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (registers & BIT(i))
+            CPU.R[i] = data[n++];
+    }
 }
 
-static void thumb_stm(u32 address, u32 reg)
+static void thumb_stm_list(u32 address, u32 registers, u32 count)
 {
-    GBA_MemoryWrite32(address & ~3, CPU.R[reg]);
+    u32 data[16];
+
+    u32 n = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        if (registers & BIT(i))
+            data[n++] = CPU.R[i];
+    }
+
+    GBA_MemoryWrite32Multiple(address & ~3, data, count);
 }
 
 //------------------------------------------------------------------------------
@@ -113,39 +138,34 @@ static void thumb_stm(u32 address, u32 reg)
 static void thumb_and(u16 Rd, u16 Rs)
 {
     CPU.R[Rd] &= CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]);
 }
 
 static void thumb_eor(u16 Rd, u16 Rs)
 {
     CPU.R[Rd] ^= CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]);
 }
 
 static void thumb_lsl(u16 Rd, u16 Rs)
 {
     u8 carry;
     CPU.R[Rd] = lsl_shift_by_reg(CPU.R[Rd], CPU.R[Rs] & 0xFF, &carry);
-    CPU.CPSR &= ~(F_Z | F_N | F_C);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
 }
 
 static void thumb_lsr(u16 Rd, u16 Rs)
 {
     u8 carry;
     CPU.R[Rd] = lsr_shift_by_reg(CPU.R[Rd], CPU.R[Rs] & 0xFF, &carry);
-    CPU.CPSR &= ~(F_Z | F_N | F_C);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
 }
 
 static void thumb_asr(u16 Rd, u16 Rs)
 {
     u8 carry;
     CPU.R[Rd] = asr_shift_by_reg(CPU.R[Rd], CPU.R[Rs] & 0xFF, &carry);
-    CPU.CPSR &= ~(F_Z | F_N | F_C);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
 }
 
 static void thumb_adc(u16 Rd, u16 Rs)
@@ -153,11 +173,7 @@ static void thumb_adc(u16 Rd, u16 Rs)
     u32 t1 = CPU.R[Rd];
     u32 t2 = CPU.R[Rs];
     u64 temp = (u64)t1 + (u64)t2 + (u64)((CPU.CPSR & F_C) ? 1ULL : 0ULL);
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (((u32)temp) ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
     CPU.R[Rd] = (u32)temp;
 }
 
@@ -166,11 +182,7 @@ static void thumb_sbc(u16 Rd, u16 Rs)
     u32 t1 = CPU.R[Rd];
     u32 t2 = ~CPU.R[Rs];
     u64 temp = (u64)t1 + (u64)t2 + ((CPU.CPSR & F_C) ? 1ULL : 0ULL);
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= ((u32)temp ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
     CPU.R[Rd] = (u32)temp;
 }
 
@@ -178,26 +190,20 @@ static void thumb_ror(u16 Rd, u16 Rs)
 {
     u8 carry;
     CPU.R[Rd] = ror_shift_by_reg(CPU.R[Rd], CPU.R[Rs] & 0xFF, &carry);
-    CPU.CPSR &= ~(F_Z | F_N | F_C);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N) | (carry ? F_C : 0);
+    GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
 }
 
 static void thumb_tst(u16 Rd, u16 Rs)
 {
     u32 temp = CPU.R[Rd] & CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (temp ? 0 : F_Z) | (temp & F_N);
+    GBA_CPUSetFlagsNZ(temp);
 }
 
 static void thumb_neg(u16 Rd, u16 Rs)
 {
     u32 tmp = CPU.R[Rs];
     CPU.R[Rd] = -(s32)tmp;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | (tmp ? 0 : F_C)
-                | (ADD_OVERFLOW(0, ~tmp, CPU.R[Rd]) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], !tmp, ADD_OVERFLOW(0, ~tmp, CPU.R[Rd]));
 }
 
 static void thumb_cmp(u16 Rd, u16 Rs)
@@ -205,11 +211,7 @@ static void thumb_cmp(u16 Rd, u16 Rs)
     u32 t1 = CPU.R[Rd];
     u32 t2 = ~CPU.R[Rs];
     u64 temp = (u64)t1 + (u64)t2 + 1ULL;
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (((u32)temp) ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(t1, t2, (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32, ADD_OVERFLOW(t1, t2, (u32)temp));
 }
 
 static void thumb_cmn(u16 Rd, u16 Rs)
@@ -221,63 +223,89 @@ static void thumb_cmn(u16 Rd, u16 Rs)
         "seto %%bl \n\t"
         : "=a"(carry), "=b"(overflow)
         : "r"(CPU.R[Rd]), "r"(CPU.R[Rs]));
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z)
-                | (CPU.R[Rd] & F_N)
-                | (carry ? F_C : 0)
-                | (overflow ? F_V : 0);
+    GBA_CPUSetFlagsNZCV(CPU.R[Rd], carry, overflow);
 #else
     u64 temp = (u64)CPU.R[Rd] + (u64)CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-    CPU.CPSR |= (((u32)temp) ? 0 : F_Z)
-                | (((u32)temp) & F_N)
-                | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                | (ADD_OVERFLOW(CPU.R[Rd], CPU.R[Rs], (u32)temp) ? F_V : 0);
+    GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32,
+                        ADD_OVERFLOW(CPU.R[Rd], CPU.R[Rs], (u32)temp));
 #endif
 }
 
 static void thumb_orr(u16 Rd, u16 Rs)
 {
     CPU.R[Rd] |= CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]);
 }
 
 static void thumb_mul(u16 Rd, u16 Rs)
 {
     CPU.R[Rd] *= CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]);
     // Carry flag destroyed
 }
 
 static void thumb_bic(u16 Rd, u16 Rs)
 {
     CPU.R[Rd] &= ~CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]);
 }
 
 static void thumb_mvn(u16 Rd, u16 Rs)
 {
     CPU.R[Rd] = ~CPU.R[Rs];
-    CPU.CPSR &= ~(F_Z | F_N);
-    CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N);
+    GBA_CPUSetFlagsNZ(CPU.R[Rd]);
+}
+
+// BL label -- Second part
+// PC = LR + (nn SHL 1), and LR = PC+2 OR 1
+static s32 thumb_bl_second_part(u32 PCseq, u16 opcode, s32 clocks)
+{
+    clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
+    // 1S cycle
+    u32 temp = CPU.R[R_LR] + (((u32)opcode & 0x7FF) << 1);
+    CPU.R[R_LR] = (CPU.R[R_PC] + 2) | 1;
+    CPU.R[R_PC] = temp;
+    clocks -= GBA_MemoryGetAccessCyclesNoSeq16(CPU.R[R_PC])
+              + GBA_MemoryGetAccessCyclesSeq16(CPU.R[R_PC]); // 1S+1N
+    CPU.R[R_PC] -= 2;
+    return clocks;
 }
 
 //------------------------------------------------------------------------------
 
-extern u32 cpu_loop_break;
+// The main switch of the interpreter uses bits 15-6 of the opcode as index.
+// Most instructions are identified by the top 8 bits, so these macros expand
+// to all the values that share them. ALU operations (010000b) are identified
+// by bits 9-6 as well.
+#define THUMB_OP(top)           ((top) << 2) ... (((top) << 2) | 3)
+#define THUMB_OPS(first, last)  ((first) << 2) ... (((last) << 2) | 3)
+#define THUMB_ALU(op)           ((0x40 << 2) | (op))
+
+extern core_local__ u32 cpu_loop_break;
 // Returns residual clocks
 s32 GBA_ExecuteTHUMB(s32 clocks)
 {
+    _thumb_decoded_t *block = NULL;
+    u8 *block_valid = NULL;
+    u32 block_base = 1; // Not aligned, it will never match the PC
+    // Memory of the block, used while it isn't decoded
+    const u16 *block_fetch = NULL;
+
+    // Breakpoints can't change while this function runs. If there aren't any,
+    // the only cost of checking them is testing this variable.
+    int breakpoints = GBA_DebugCPUBreakpointsUsed();
+    int trace = trace_enabled;
+#ifdef ENABLE_OPCODE_PROFILE
+    int opprofile = opprofile_enabled;
+#endif
+
     while (clocks > 0)
     {
-        if (GBA_DebugCPUIsBreakpoint(CPU.R[R_PC]))
+        if (breakpoints && GBA_DebugCPUIsBreakpoint(CPU.R[R_PC]))
         {
             cpu_loop_break = 1;
             GBA_RunFor_ExecutionBreak();
-            Win_GBADisassemblerSetFocus();
+            GBA_DebugNotifyBreak();
         }
 
         if (cpu_loop_break)
@@ -289,14 +317,49 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
         u32 PCseq = ((CPU.OldPC + 2) == CPU.R[R_PC]);
         CPU.OldPC = CPU.R[R_PC];
 
-        u16 opcode = GBA_MemoryReadFast16(CPU.R[R_PC]);
+        if ((CPU.R[R_PC] & ~(GBA_CODE_CACHE_BLOCK_SIZE - 1)) != block_base)
+        {
+            block_base = CPU.R[R_PC] & ~(GBA_CODE_CACHE_BLOCK_SIZE - 1);
+            block_fetch = GBA_MemoryFetchBlock(block_base);
+            block = GBA_CodeCacheGetTHUMBBlock(block_base, &block_valid);
+        }
+        else if (*block_valid == 0)
+        {
+            block = GBA_CodeCacheGetTHUMBBlock(block_base, &block_valid);
+        }
+
+        _thumb_decoded_t *entry = NULL;
+        u16 opcode;
+
+        if (block)
+        {
+            entry = &block[(CPU.R[R_PC] >> 1)
+                           & (GBA_CODE_CACHE_THUMB_ENTRIES - 1)];
+            opcode = entry->opcode;
+        }
+        else
+        {
+            opcode = block_fetch[(CPU.R[R_PC] >> 1)
+                                 & (GBA_CODE_CACHE_THUMB_ENTRIES - 1)];
+        }
+
+        if (trace)
+            GBA_TraceInstruction(opcode, 2, clocks);
 
-        u16 ident = opcode >> 8;
+        // Bits 15-6 are enough to identify any instruction without having to
+        // check anything else after the jump.
+        u16 ident = opcode >> 6;
         opcode &= 0x0FFF;
 
+#ifdef ENABLE_OPCODE_PROFILE
+        s32 opprofile_clocks = clocks;
+        if (opprofile)
+            OPProfile_Executed(OPPROFILE_THUMB(ident));
+#endif
+
         switch (ident)
         {
-            case 0x0 ... 0x7:
+            case THUMB_OPS(0x0, 0x7):
             {
                 // LSL Rd,Rs,#Offset
                 u16 Rd = opcode & 7;
@@ -304,14 +367,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 immed = (opcode >> 6) & 0x1F;
                 u8 carry;
                 CPU.R[Rd] = lsl_shift_by_immed(CPU.R[Rs], immed, &carry);
-                CPU.CPSR &= ~(F_Z | F_N | F_C);
-                CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (carry ? F_C : 0);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0x8 ... 0xF:
+            case THUMB_OPS(0x8, 0xF):
             {
                 // LSR Rd,Rs,#Offset
                 u16 Rd = opcode & 7;
@@ -319,14 +380,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 immed = (opcode >> 6) & 0x1F;
                 u8 carry;
                 CPU.R[Rd] = lsr_shift_by_immed(CPU.R[Rs], immed, &carry);
-                CPU.CPSR &= ~(F_Z | F_N | F_C);
-                CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (carry ? F_C : 0);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0x10 ... 0x17:
+            case THUMB_OPS(0x10, 0x17):
             {
                 // ASR Rd,Rs,#Offset
                 u16 Rd = opcode & 7;
@@ -334,14 +393,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 immed = (opcode >> 6) & 0x1F;
                 u8 carry;
                 CPU.R[Rd] = asr_shift_by_immed(CPU.R[Rs], immed, &carry);
-                CPU.CPSR &= ~(F_Z | F_N | F_C);
-                CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (carry ? F_C : 0);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                GBA_CPUSetFlagsNZC(CPU.R[Rd], carry);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0x18 ... 0x19:
+            case THUMB_OPS(0x18, 0x19):
             {
                 // ADD Rd,Rs,Rn
                 u16 Rd = opcode & 7;
@@ -355,25 +412,19 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                     "seto %%bl \n\t"
                     : "=r"(CPU.R[Rd]), "=a"(carry), "=b"(overflow)
                     : "r"(CPU.R[Rs]), "r"(CPU.R[Rn]));
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (carry ? F_C : 0) | (overflow ? F_V : 0);
+                GBA_CPUSetFlagsNZCV(CPU.R[Rd], carry, overflow);
 #else
                 u64 temp = (u64)CPU.R[Rs] + (u64)CPU.R[Rn];
                 CPU.R[Rd] = (u32)temp;
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                            | (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (ADD_OVERFLOW(CPU.R[Rs], CPU.R[Rn],
-                                            CPU.R[Rd])
-                                       ? F_V
-                                       : 0);
+                GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                                    ADD_OVERFLOW(CPU.R[Rs], CPU.R[Rn],
+                                                 CPU.R[Rd]));
 #endif
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0x1A ... 0x1B:
+            case THUMB_OPS(0x1A, 0x1B):
             {
                 // SUB Rd,Rs,Rn
                 u16 Rd = opcode & 7;
@@ -382,18 +433,14 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u64 addval = 1ULL + (u64)(u32)~CPU.R[Rn];
                 u64 temp = (u64)CPU.R[Rs] + (u64)addval;
                 CPU.R[Rd] = (u32)temp;
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                            | (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (ADD_OVERFLOW(CPU.R[Rs], (u32)(addval - 1),
-                                            CPU.R[Rd])
-                                       ? F_V
-                                       : 0);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                                    ADD_OVERFLOW(CPU.R[Rs], (u32)(addval - 1),
+                                                 CPU.R[Rd]));
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0x1C ... 0x1D:
+            case THUMB_OPS(0x1C, 0x1D):
             {
                 // ADD Rd,Rs,#nn
                 u16 Rd = opcode & 7;
@@ -407,25 +454,18 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                     "seto %%bl \n\t"
                     : "=r"(CPU.R[Rd]), "=a"(carry), "=b"(overflow)
                     : "r"(CPU.R[Rs]), "r"(immed));
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (carry ? F_C : 0) | (overflow ? F_V : 0);
+                GBA_CPUSetFlagsNZCV(CPU.R[Rd], carry, overflow);
 #else
                 u64 temp = (u64)CPU.R[Rs] + (u64)immed;
                 CPU.R[Rd] = (u32)temp;
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                            | (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (ADD_OVERFLOW(CPU.R[Rs], immed,
-                                            CPU.R[Rd])
-                                       ? F_V
-                                       : 0);
+                GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                                    ADD_OVERFLOW(CPU.R[Rs], immed, CPU.R[Rd]));
 #endif
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0x1E ... 0x1F:
+            case THUMB_OPS(0x1E, 0x1F):
             {
                 // SUB Rd,Rs,#nn
                 u16 Rd = opcode & 7;
@@ -433,80 +473,73 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u64 immed = 1ULL + (u64)(u32) ~((opcode >> 6) & 0x7);
                 u64 temp = (u64)CPU.R[Rs] + (u64)immed;
                 CPU.R[Rd] = (u32)temp;
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                            | (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)
-                            | (ADD_OVERFLOW(CPU.R[Rs], (u32)(immed - 1),
-                                            CPU.R[Rd])
-                                       ? F_V
-                                       : 0);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32,
+                                    ADD_OVERFLOW(CPU.R[Rs], (u32)(immed - 1),
+                                                 CPU.R[Rd]));
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
 
 #define MOV_REG_IMM(Rd)                                             \
     {                                                               \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]); \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]); \
         CPU.R[Rd] = opcode & 0xFF;                                  \
-        CPU.CPSR &= ~(F_Z | F_N);                                   \
-        CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z);                          \
+        GBA_CPUSetFlagsNZ(CPU.R[Rd]);                               \
         break;                                                      \
     } // 1S cycle
 
     // MOV Rd,#nn
-            case 0x20:
+            case THUMB_OP(0x20):
                 MOV_REG_IMM(0);
-            case 0x21:
+            case THUMB_OP(0x21):
                 MOV_REG_IMM(1);
-            case 0x22:
+            case THUMB_OP(0x22):
                 MOV_REG_IMM(2);
-            case 0x23:
+            case THUMB_OP(0x23):
                 MOV_REG_IMM(3);
-            case 0x24:
+            case THUMB_OP(0x24):
                 MOV_REG_IMM(4);
-            case 0x25:
+            case THUMB_OP(0x25):
                 MOV_REG_IMM(5);
-            case 0x26:
+            case THUMB_OP(0x26):
                 MOV_REG_IMM(6);
-            case 0x27:
+            case THUMB_OP(0x27):
                 MOV_REG_IMM(7);
 
 #define CMP_REG_IMM(Rd)                                                         \
     {                                                                           \
         u32 immed = opcode & 0xFF;                                              \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);             \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);             \
         u64 val = (u64)~immed;                                                  \
         u64 temp = (u64)CPU.R[Rd] + (u64)val + 1ULL;                            \
-        CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);                                   \
-        CPU.CPSR |= ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)                  \
-                    | ((u32)temp ? 0 : F_Z) | (((u32)temp) & F_N)               \
-                    | (ADD_OVERFLOW(CPU.R[Rd], (u32)val, (u32)temp) ? F_V : 0); \
+        GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32,                              \
+                            ADD_OVERFLOW(CPU.R[Rd], (u32)val, (u32)temp));      \
         break;                                                                  \
     }
             // CMP Rd,#nn
-            case 0x28:
+            case THUMB_OP(0x28):
                 CMP_REG_IMM(0);
-            case 0x29:
+            case THUMB_OP(0x29):
                 CMP_REG_IMM(1);
-            case 0x2A:
+            case THUMB_OP(0x2A):
                 CMP_REG_IMM(2);
-            case 0x2B:
+            case THUMB_OP(0x2B):
                 CMP_REG_IMM(3);
-            case 0x2C:
+            case THUMB_OP(0x2C):
                 CMP_REG_IMM(4);
-            case 0x2D:
+            case THUMB_OP(0x2D):
                 CMP_REG_IMM(5);
-            case 0x2E:
+            case THUMB_OP(0x2E):
                 CMP_REG_IMM(6);
-            case 0x2F:
+            case THUMB_OP(0x2F):
                 CMP_REG_IMM(7);
 
 #ifdef ENABLE_ASM_X86
 #define ADD_REG_IMM(Rd)                                             \
     {                                                               \
         u32 immed = opcode & 0xFF;                                  \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]); \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]); \
         u8 carry, overflow;                                         \
         asm("add %3,%4 \n\t"                                        \
             "mov %4,%0 \n\t"                                        \
@@ -514,150 +547,119 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
             "seto %%bl \n\t"                                        \
             : "=r"(CPU.R[Rd]), "=a"(carry), "=b"(overflow)          \
             : "r"(CPU.R[Rd]), "r"(immed));                          \
-        CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);                       \
-        CPU.CPSR |= (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)       \
-                    | (carry ? F_C : 0) | (overflow ? F_V : 0);     \
+        GBA_CPUSetFlagsNZCV(CPU.R[Rd], carry, overflow);            \
         break;                                                      \
     }
 #else
 #define ADD_REG_IMM(Rd)                                             \
     {                                                               \
         u32 immed = opcode & 0xFF;                                  \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]); \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]); \
         u64 temp = (u64)CPU.R[Rd] + (u64)immed;                     \
         u32 overflow = ADD_OVERFLOW(CPU.R[Rd], immed, temp);        \
         CPU.R[Rd] = (u32)temp;                                      \
-        CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);                       \
-        CPU.CPSR |= ((temp & 0xFFFFFFFF00000000LL) ? F_C : 0)       \
-                    | (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)     \
-                    | (overflow ? F_V : 0);                         \
+        GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, overflow);       \
         break;                                                      \
     }
 #endif
             // ADD Rd,#nn
-            case 0x30:
+            case THUMB_OP(0x30):
                 ADD_REG_IMM(0);
-            case 0x31:
+            case THUMB_OP(0x31):
                 ADD_REG_IMM(1);
-            case 0x32:
+            case THUMB_OP(0x32):
                 ADD_REG_IMM(2);
-            case 0x33:
+            case THUMB_OP(0x33):
                 ADD_REG_IMM(3);
-            case 0x34:
+            case THUMB_OP(0x34):
                 ADD_REG_IMM(4);
-            case 0x35:
+            case THUMB_OP(0x35):
                 ADD_REG_IMM(5);
-            case 0x36:
+            case THUMB_OP(0x36):
                 ADD_REG_IMM(6);
-            case 0x37:
+            case THUMB_OP(0x37):
                 ADD_REG_IMM(7);
 
 #define SUB_REG_IMM(Rd)                                              \
     {                                                                \
         u32 immed = opcode & 0xFF;                                   \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);  \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);  \
         u64 val = (u64)~immed;                                       \
         u64 temp = (u64)CPU.R[Rd] + (u64)val + 1ULL;                 \
         u32 overflow = ADD_OVERFLOW(CPU.R[Rd], (u32)val, (u32)temp); \
         CPU.R[Rd] = (u32)temp;                                       \
-        CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);                        \
-        CPU.CPSR |= ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)       \
-                    | (CPU.R[Rd] ? 0 : F_Z) | (CPU.R[Rd] & F_N)      \
-                    | (overflow ? F_V : 0);                          \
+        GBA_CPUSetFlagsNZCV(CPU.R[Rd], temp >> 32, overflow);        \
         break;                                                       \
     }
             // SUB Rd,#nn
-            case 0x38:
+            case THUMB_OP(0x38):
                 SUB_REG_IMM(0);
-            case 0x39:
+            case THUMB_OP(0x39):
                 SUB_REG_IMM(1);
-            case 0x3A:
+            case THUMB_OP(0x3A):
                 SUB_REG_IMM(2);
-            case 0x3B:
+            case THUMB_OP(0x3B):
                 SUB_REG_IMM(3);
-            case 0x3C:
+            case THUMB_OP(0x3C):
                 SUB_REG_IMM(4);
-            case 0x3D:
+            case THUMB_OP(0x3D):
                 SUB_REG_IMM(5);
-            case 0x3E:
+            case THUMB_OP(0x3E):
                 SUB_REG_IMM(6);
-            case 0x3F:
+            case THUMB_OP(0x3F):
                 SUB_REG_IMM(7);
 
-            case 0x40 ... 0x43:
-            {
-                // ALU operations
-                u16 Rd = opcode & 7;
-                u16 Rs = (opcode >> 3) & 7;
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
-                // 1S cycle
-
-                switch ((opcode >> 6) & 0xF)
-                {
-                    case 0:
-                        thumb_and(Rd, Rs);
-                        break;
-                    case 1:
-                        thumb_eor(Rd, Rs);
-                        break;
-                    case 2:
-                        thumb_lsl(Rd, Rs);
-                        clocks--; // 1I
-                        break;
-                    case 3:
-                        thumb_lsr(Rd, Rs);
-                        clocks--; // 1I
-                        break;
-                    case 4:
-                        thumb_asr(Rd, Rs);
-                        clocks--; // 1I
-                        break;
-                    case 5:
-                        thumb_adc(Rd, Rs);
-                        break;
-                    case 6:
-                        thumb_sbc(Rd, Rs);
-                        break;
-                    case 7:
-                        thumb_ror(Rd, Rs);
-                        clocks--; // 1I
-                        break;
-                    case 8:
-                        thumb_tst(Rd, Rs);
-                        break;
-                    case 9:
-                        thumb_neg(Rd, Rs);
-                        break;
-                    case 10:
-                        thumb_cmp(Rd, Rs);
-                        break;
-                    case 11:
-                        thumb_cmn(Rd, Rs);
-                        break;
-                    case 12:
-                        thumb_orr(Rd, Rs);
-                        break;
-                    case 13:
-                        thumb_mul(Rd, Rs);
-                        clocks -= thumb_mul_extra_cycles(Rd); // mI
-                        break;
-                    case 14:
-                        thumb_bic(Rd, Rs);
-                        break;
-                    case 15:
-                        thumb_mvn(Rd, Rs);
-                        break;
-                    default:
-                        break; // ???
-                }
-                break;
-            }
-            case 0x44:
+#define ALU_OP(function, extra_clocks)                              \
+    {                                                               \
+        u16 Rd = opcode & 7;                                        \
+        u16 Rs = (opcode >> 3) & 7;                                 \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]); \
+        function(Rd, Rs);                                           \
+        clocks -= extra_clocks;                                     \
+        break;                                                      \
+    } // 1S cycle + extra cycles
+
+            // ALU operations. Each operation has its own entry in the dispatch
+            // table, so there is no need for a second switch.
+            case THUMB_ALU(0x0):
+                ALU_OP(thumb_and, 0);
+            case THUMB_ALU(0x1):
+                ALU_OP(thumb_eor, 0);
+            case THUMB_ALU(0x2):
+                ALU_OP(thumb_lsl, 1); // 1I
+            case THUMB_ALU(0x3):
+                ALU_OP(thumb_lsr, 1); // 1I
+            case THUMB_ALU(0x4):
+                ALU_OP(thumb_asr, 1); // 1I
+            case THUMB_ALU(0x5):
+                ALU_OP(thumb_adc, 0);
+            case THUMB_ALU(0x6):
+                ALU_OP(thumb_sbc, 0);
+            case THUMB_ALU(0x7):
+                ALU_OP(thumb_ror, 1); // 1I
+            case THUMB_ALU(0x8):
+                ALU_OP(thumb_tst, 0);
+            case THUMB_ALU(0x9):
+                ALU_OP(thumb_neg, 0);
+            case THUMB_ALU(0xA):
+                ALU_OP(thumb_cmp, 0);
+            case THUMB_ALU(0xB):
+                ALU_OP(thumb_cmn, 0);
+            case THUMB_ALU(0xC):
+                ALU_OP(thumb_orr, 0);
+            case THUMB_ALU(0xD):
+                ALU_OP(thumb_mul, thumb_mul_extra_cycles(Rd)); // mI
+            case THUMB_ALU(0xE):
+                ALU_OP(thumb_bic, 0);
+            case THUMB_ALU(0xF):
+                ALU_OP(thumb_mvn, 0);
+
+            case THUMB_OP(0x44):
             {
                 // Hi register operations/branch exchange
 
                 // ADD Rd,Rs
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 u16 Rd = (opcode & 7) | ((opcode >> 4) & 8);
                 u16 Rs = (opcode >> 3) & 0xF;
@@ -674,7 +676,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
 
                 break;
             }
-            case 0x45:
+            case THUMB_OP(0x45):
             {
                 // Hi register operations/branch exchange
 
@@ -684,26 +686,21 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u32 t1 = CPU.R[Rd] + (Rd == R_PC ? 4 : 0);
                 u64 t2 = (u64) ~(CPU.R[Rs] + (Rs == R_PC ? 4 : 0));
                 u64 temp = (u64)t1 + (u64)t2 + 1ULL;
-                CPU.CPSR &= ~(F_Z | F_C | F_N | F_V);
-                CPU.CPSR |= ((u32)temp ? 0 : F_Z) | (((u32)temp) & F_N)
-                            | ((temp & 0xFFFFFFFF00000000ULL) ? F_C : 0)
-                            | (ADD_OVERFLOW(t1, (u32)(t2 - 1),
-                                            (u32)temp)
-                                       ? F_V
-                                       : 0);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                GBA_CPUSetFlagsNZCV((u32)temp, temp >> 32,
+                                    ADD_OVERFLOW(t1, (u32)(t2 - 1), (u32)temp));
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
 
                 // This works in low registers, not just high registers.
                 // Tested in real hardware (Unused Opcode #4-1)
                 break;
             }
-            case 0x46:
+            case THUMB_OP(0x46):
             {
                 // Hi register operations/branch exchange
 
                 // MOV Rd,Rs
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 u16 Rd = (opcode & 7) | ((opcode >> 4) & 8);
                 u16 Rs = (opcode >> 3) & 0xF;
@@ -720,7 +717,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
 
                 break;
             }
-            case 0x47:
+            case THUMB_OP(0x47):
             {
                 // Hi register operations/branch exchange
                 if (opcode & (BIT(7) | 0x7))
@@ -735,7 +732,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                     // BX  Rs
                     u16 Rs = (opcode >> 3) & 0xF;
                     u32 val = ((Rs == R_PC) ? ((CPU.R[R_PC] + 4) & (~2)) : CPU.R[Rs]);
-                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                    clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                     // 1S cycle
                     if ((val & BIT(0)) == 0) // Switch to ARM
                     {
@@ -761,30 +758,30 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
         u32 offset = (opcode & 0xFF) << 2;                         \
         u32 addr = ((CPU.R[R_PC] + 4) & (~2)) + offset;            \
         CPU.R[Rd] = GBA_MemoryRead32(addr);                        \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]) \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]) \
                   + GBA_MemoryGetAccessCyclesSeq32(addr) + 1;      \
         break;                                                     \
     } // 1S+1N+1I
 
     // LDR Rd,[PC,#nn]
-            case 0x48:
+            case THUMB_OP(0x48):
                 LDR_REG_PC_IMM(0);
-            case 0x49:
+            case THUMB_OP(0x49):
                 LDR_REG_PC_IMM(1);
-            case 0x4A:
+            case THUMB_OP(0x4A):
                 LDR_REG_PC_IMM(2);
-            case 0x4B:
+            case THUMB_OP(0x4B):
                 LDR_REG_PC_IMM(3);
-            case 0x4C:
+            case THUMB_OP(0x4C):
                 LDR_REG_PC_IMM(4);
-            case 0x4D:
+            case THUMB_OP(0x4D):
                 LDR_REG_PC_IMM(5);
-            case 0x4E:
+            case THUMB_OP(0x4E):
                 LDR_REG_PC_IMM(6);
-            case 0x4F:
+            case THUMB_OP(0x4F):
                 LDR_REG_PC_IMM(7);
 
-            case 0x50 ... 0x51:
+            case THUMB_OPS(0x50, 0x51):
             {
                 // STR  Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -796,7 +793,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                           + GBA_MemoryGetAccessCyclesNoSeq32(addr); // 2N
                 break;
             }
-            case 0x52 ... 0x53:
+            case THUMB_OPS(0x52, 0x53):
             {
                 // STRH Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -808,7 +805,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr); // 2N
                 break;
             }
-            case 0x54 ... 0x55:
+            case THUMB_OPS(0x54, 0x55):
             {
                 // STRB Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -820,7 +817,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr); // 2N
                 break;
             }
-            case 0x56 ... 0x57:
+            case THUMB_OPS(0x56, 0x57):
             {
                 // LDSB Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -828,12 +825,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 Ro = (opcode >> 6) & 7;
                 u32 addr = CPU.R[Rb] + CPU.R[Ro];
                 CPU.R[Rd] = (u32)(s32)(s8)GBA_MemoryRead8(addr);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x58 ... 0x59:
+            case THUMB_OPS(0x58, 0x59):
             {
                 // LDR  Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -841,12 +838,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 Ro = (opcode >> 6) & 7;
                 u32 addr = CPU.R[Rb] + CPU.R[Ro];
                 CPU.R[Rd] = GBA_MemoryRead32(addr);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq32(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x5A ... 0x5B:
+            case THUMB_OPS(0x5A, 0x5B):
             {
                 // LDRH Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -856,12 +853,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 CPU.R[Rd] = (u32)(u16)GBA_MemoryRead16(addr & ~1);
                 if (addr & 1)
                     CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x5C ... 0x5D:
+            case THUMB_OPS(0x5C, 0x5D):
             {
                 // LDRB Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -869,12 +866,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 Ro = (opcode >> 6) & 7;
                 u32 addr = CPU.R[Rb] + CPU.R[Ro];
                 CPU.R[Rd] = (u32)(u8)GBA_MemoryRead8(addr);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x5E ... 0x5F:
+            case THUMB_OPS(0x5E, 0x5F):
             {
                 // LDSH Rd,[Rb,Ro]
                 u16 Rd = opcode & 7;
@@ -885,12 +882,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                     CPU.R[Rd] = (s32)(s8)GBA_MemoryRead8(addr);
                 else
                     CPU.R[Rd] = (s32)(s16)GBA_MemoryRead16(addr);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x60 ... 0x67:
+            case THUMB_OPS(0x60, 0x67):
             {
                 // STR  Rd,[Rb,#nn]
                 u16 Rb = (opcode >> 3) & 7;
@@ -902,7 +899,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                           + GBA_MemoryGetAccessCyclesNoSeq32(addr); // 2N
                 break;
             }
-            case 0x68 ... 0x6F:
+            case THUMB_OPS(0x68, 0x6F):
             {
                 // LDR  Rd,[Rb,#nn]
                 u16 Rb = (opcode >> 3) & 7;
@@ -910,12 +907,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 offset = (opcode >> 4) & (0x1F << 2);
                 u32 addr = CPU.R[Rb] + offset;
                 CPU.R[Rd] = GBA_MemoryRead32(addr);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq32(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x70 ... 0x77:
+            case THUMB_OPS(0x70, 0x77):
             {
                 // STRB  Rd,[Rb,#nn]
                 u16 Rb = (opcode >> 3) & 7;
@@ -927,7 +924,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr); // 2N
                 break;
             }
-            case 0x78 ... 0x7F:
+            case THUMB_OPS(0x78, 0x7F):
             {
                 // LDRB  Rd,[Rb,#nn]
                 u16 Rb = (opcode >> 3) & 7;
@@ -935,12 +932,12 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 u16 offset = (opcode >> 6) & 0x1F;
                 u32 addr = CPU.R[Rb] + offset;
                 CPU.R[Rd] = (u32)GBA_MemoryRead8(addr);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr) + 1;
                 // 1S+1N+1I
                 break;
             }
-            case 0x80 ... 0x87:
+            case THUMB_OPS(0x80, 0x87):
             {
                 // STRH  Rd,[Rb,#nn]
                 u16 Rd = opcode & 7;
@@ -952,7 +949,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr); // 2N
                 break;
             }
-            case 0x88 ... 0x8F:
+            case THUMB_OPS(0x88, 0x8F):
             {
                 // LDRH Rd,[Rb,#nn]
                 u16 Rd = opcode & 7;
@@ -962,7 +959,7 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 CPU.R[Rd] = (u32)GBA_MemoryRead16(addr);
                 if (addr & 1)
                     CPU.R[Rd] = ror_immed_no_carry(CPU.R[Rd], 8);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                           + GBA_MemoryGetAccessCyclesNoSeq16(addr) + 1;
                 // 1S+1N+1I
                 break;
@@ -978,21 +975,21 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
     } // 2N
 
     // STR  Rd,[SP,#nn]
-            case 0x90:
+            case THUMB_OP(0x90):
                 STR_REG_SP_IMM(0);
-            case 0x91:
+            case THUMB_OP(0x91):
                 STR_REG_SP_IMM(1);
-            case 0x92:
+            case THUMB_OP(0x92):
                 STR_REG_SP_IMM(2);
-            case 0x93:
+            case THUMB_OP(0x93):
                 STR_REG_SP_IMM(3);
-            case 0x94:
+            case THUMB_OP(0x94):
                 STR_REG_SP_IMM(4);
-            case 0x95:
+            case THUMB_OP(0x95):
                 STR_REG_SP_IMM(5);
-            case 0x96:
+            case THUMB_OP(0x96):
                 STR_REG_SP_IMM(6);
-            case 0x97:
+            case THUMB_OP(0x97):
                 STR_REG_SP_IMM(7);
 
 #define LDR_REG_SP_IMM(Rd)                                         \
@@ -1000,113 +997,107 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
         u32 offset = (opcode & 0xFF) << 2;                         \
         u32 addr = CPU.R[R_SP] + offset;                           \
         CPU.R[Rd] = GBA_MemoryRead32(addr);                        \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]) \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]) \
                   + GBA_MemoryGetAccessCyclesNoSeq32(addr) + 1;    \
         break;                                                     \
     } // 1S+1N+1I
 
     // LDR  Rd,[SP,#nn]
-            case 0x98:
+            case THUMB_OP(0x98):
                 LDR_REG_SP_IMM(0);
-            case 0x99:
+            case THUMB_OP(0x99):
                 LDR_REG_SP_IMM(1);
-            case 0x9A:
+            case THUMB_OP(0x9A):
                 LDR_REG_SP_IMM(2);
-            case 0x9B:
+            case THUMB_OP(0x9B):
                 LDR_REG_SP_IMM(3);
-            case 0x9C:
+            case THUMB_OP(0x9C):
                 LDR_REG_SP_IMM(4);
-            case 0x9D:
+            case THUMB_OP(0x9D):
                 LDR_REG_SP_IMM(5);
-            case 0x9E:
+            case THUMB_OP(0x9E):
                 LDR_REG_SP_IMM(6);
-            case 0x9F:
+            case THUMB_OP(0x9F):
                 LDR_REG_SP_IMM(7);
 
 #define ADD_REG_PC_IMM(Rd)                                          \
     {                                                               \
         u32 offset = (opcode & 0xFF) << 2;                          \
         CPU.R[Rd] = ((CPU.R[R_PC] + 4) & (~2)) + offset;            \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]); \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]); \
         break;                                                      \
     } // 1S cycle
 
     // ADD  Rd,PC,#nn
-            case 0xA0:
+            case THUMB_OP(0xA0):
                 ADD_REG_PC_IMM(0);
-            case 0xA1:
+            case THUMB_OP(0xA1):
                 ADD_REG_PC_IMM(1);
-            case 0xA2:
+            case THUMB_OP(0xA2):
                 ADD_REG_PC_IMM(2);
-            case 0xA3:
+            case THUMB_OP(0xA3):
                 ADD_REG_PC_IMM(3);
-            case 0xA4:
+            case THUMB_OP(0xA4):
                 ADD_REG_PC_IMM(4);
-            case 0xA5:
+            case THUMB_OP(0xA5):
                 ADD_REG_PC_IMM(5);
-            case 0xA6:
+            case THUMB_OP(0xA6):
                 ADD_REG_PC_IMM(6);
-            case 0xA7:
+            case THUMB_OP(0xA7):
                 ADD_REG_PC_IMM(7);
 
 #define ADD_REG_SP_IMM(Rd)                                          \
     {                                                               \
         u32 offset = (opcode & 0xFF) << 2;                          \
         CPU.R[Rd] = CPU.R[R_SP] + offset;                           \
-        clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]); \
+        clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]); \
         break;                                                      \
     } // 1S cycle
 
     // ADD  Rd,SP,#nn
-            case 0xA8:
+            case THUMB_OP(0xA8):
                 ADD_REG_SP_IMM(0);
-            case 0xA9:
+            case THUMB_OP(0xA9):
                 ADD_REG_SP_IMM(1);
-            case 0xAA:
+            case THUMB_OP(0xAA):
                 ADD_REG_SP_IMM(2);
-            case 0xAB:
+            case THUMB_OP(0xAB):
                 ADD_REG_SP_IMM(3);
-            case 0xAC:
+            case THUMB_OP(0xAC):
                 ADD_REG_SP_IMM(4);
-            case 0xAD:
+            case THUMB_OP(0xAD):
                 ADD_REG_SP_IMM(5);
-            case 0xAE:
+            case THUMB_OP(0xAE):
                 ADD_REG_SP_IMM(6);
-            case 0xAF:
+            case THUMB_OP(0xAF):
                 ADD_REG_SP_IMM(7);
 
-            case 0xB0:
+            case THUMB_OP(0xB0):
             {
                 s32 offset = (opcode & 0x7F) << 2;
                 if (opcode & BIT(7)) // ADD  SP,#-nn
                     CPU.R[R_SP] -= offset;
                 else // ADD  SP,#nn
                     CPU.R[R_SP] += offset;
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 break;
             }
-            case 0xB1 ... 0xB3:
+            case THUMB_OPS(0xB1, 0xB3):
             {
                 // Undefined Opcode #B -- tested in hardware
                 THUMB_UNDEFINED_INSTRUCTION();
                 break;
             }
-            case 0xB4:
+            case THUMB_OP(0xB4):
             {
                 // PUSH {Rlist}
                 u32 registers = opcode & 0xFF;
                 u32 bitcount = thumb_bit_count(registers);
                 u32 address = CPU.R[R_SP] - (bitcount << 2);
                 CPU.R[R_SP] = address;
-                for (int i = 0; i < 8; i++)
-                {
-                    if (registers & BIT(i))
-                    {
-                        thumb_stm(address, i);
-                        address += 4;
-                    }
-                }
+                thumb_stm_list(address, registers, bitcount);
+                address += bitcount << 2;
                 if (bitcount)
                 {
                     clocks -= (GBA_MemoryGetAccessCyclesSeq32(address)
@@ -1118,21 +1109,15 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 // 1N cycle
                 break;
             }
-            case 0xB5:
+            case THUMB_OP(0xB5):
             {
                 // PUSH {Rlist,LR}
                 u32 registers = (opcode & 0xFF) | BIT(R_LR);
                 u32 bitcount = thumb_bit_count(registers);
                 u32 address = CPU.R[R_SP] - (bitcount << 2);
                 CPU.R[R_SP] = address;
-                for (int i = 0; i < 16; i++)
-                {
-                    if (registers & BIT(i))
-                    {
-                        thumb_stm(address, i);
-                        address += 4;
-                    }
-                }
+                thumb_stm_list(address, registers, bitcount);
+                address += bitcount << 2;
                 clocks -= (GBA_MemoryGetAccessCyclesSeq32(address)
                            * (bitcount - 1))
                           + GBA_MemoryGetAccessCyclesNoSeq32(address)
@@ -1140,13 +1125,13 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 // (n-1)S+2N
                 break;
             }
-            case 0xB6 ... 0xBB:
+            case THUMB_OPS(0xB6, 0xBB):
             {
                 // Undefined opcode #B -- tested on hardware
                 THUMB_UNDEFINED_INSTRUCTION();
                 break;
             }
-            case 0xBC:
+            case THUMB_OP(0xBC):
             {
                 // POP {Rlist}
                 u32 registers = opcode & 0xFF;
@@ -1158,17 +1143,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 else
                 {
-                    int count = 0;
-                    for (int i = 0; i < 8; i++)
-                    {
-                        if (registers & BIT(i))
-                        {
-                            thumb_ldm(CPU.R[R_SP], i);
-                            CPU.R[R_SP] += 4;
-                            count++;
-                        }
-                    }
-                    clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC])
+                    int count = thumb_bit_count(registers);
+                    thumb_ldm_list(CPU.R[R_SP], registers, count);
+                    CPU.R[R_SP] += count << 2;
+                    clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC])
                               + 1;
                     if (count)
                     {
@@ -1179,24 +1157,17 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xBD:
+            case THUMB_OP(0xBD):
             {
                 // POP {Rlist,PC}
                 u32 registers = (opcode & 0xFF) | BIT(R_PC);
-                int count = 0;
-                for (int i = 0; i < 16; i++)
-                {
-                    if (registers & BIT(i))
-                    {
-                        thumb_ldm(CPU.R[R_SP], i);
-                        CPU.R[R_SP] += 4;
-                        count++;
-                    }
-                }
+                int count = thumb_bit_count(registers);
+                thumb_ldm_list(CPU.R[R_SP], registers, count);
+                CPU.R[R_SP] += count << 2;
                 // Don't skip an instruction, don't change to ARM mode
                 CPU.R[R_PC] = (CPU.R[R_PC] - 2) & (~1);
 
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]) + 1
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]) + 1
                           + GBA_MemoryGetAccessCyclesNoSeq32(CPU.R[R_SP])
                           + (GBA_MemoryGetAccessCyclesSeq32(CPU.R[R_SP])
                              * (count - 1))
@@ -1207,13 +1178,13 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 // Empty rlist DOESN'T trigger Undefined instruction exception.
                 // Tested on hardware
             }
-            case 0xBE:
+            case THUMB_OP(0xBE):
             {
                 // Undefined opcode #B -- tested on hardware
                 THUMB_UNDEFINED_INSTRUCTION();
                 break;
             }
-            case 0xBF:
+            case THUMB_OP(0xBF):
             {
                 // Undefined opcode #B -- tested on hardware
                 THUMB_UNDEFINED_INSTRUCTION();
@@ -1224,16 +1195,9 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
     {                                                                            \
         u32 address = CPU.R[Rb];                                                 \
         clocks -= GBA_MemoryGetAccessCyclesNoSeq16(CPU.R[R_PC]);                 \
-        int bitcount = 0;                                                        \
-        for (int i = 0; i < 8; i++)                                              \
-        {                                                                        \
-            if (opcode & BIT(i))                                                 \
-            {                                                                    \
-                thumb_stm(address, i);                                           \
-                address += 4;                                                    \
-                bitcount++;                                                      \
-            }                                                                    \
-        }                                                                        \
+        int bitcount = thumb_bit_count(opcode & 0xFF);                           \
+        thumb_stm_list(address, opcode & 0xFF, bitcount);                        \
+        address += bitcount << 2;                                                \
         if (bitcount)                                                            \
         {                                                                        \
             clocks -= (GBA_MemoryGetAccessCyclesSeq32(address) * (bitcount - 1)) \
@@ -1249,21 +1213,21 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 // Empty rlist adds 0x40 to base register. Tested on hardware.
 
             // STMIA Rb!,{Rlist}
-            case 0xC0:
+            case THUMB_OP(0xC0):
                 STMIA(0);
-            case 0xC1:
+            case THUMB_OP(0xC1):
                 STMIA(1);
-            case 0xC2:
+            case THUMB_OP(0xC2):
                 STMIA(2);
-            case 0xC3:
+            case THUMB_OP(0xC3):
                 STMIA(3);
-            case 0xC4:
+            case THUMB_OP(0xC4):
                 STMIA(4);
-            case 0xC5:
+            case THUMB_OP(0xC5):
                 STMIA(5);
-            case 0xC6:
+            case THUMB_OP(0xC6):
                 STMIA(6);
-            case 0xC7:
+            case THUMB_OP(0xC7):
                 STMIA(7);
 
 #define LDMIA(Rb)                                                          \
@@ -1275,17 +1239,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
         else                                                               \
         {                                                                  \
             u32 address = CPU.R[Rb];                                       \
-            clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);    \
-            int bitcount = 0;                                              \
-            for (int i = 0; i < 8; i++)                                    \
-            {                                                              \
-                if (opcode & BIT(i))                                       \
-                {                                                          \
-                    thumb_ldm(address, i);                                 \
-                    address += 4;                                          \
-                    bitcount++;                                            \
-                }                                                          \
-            }                                                              \
+            clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);    \
+            int bitcount = thumb_bit_count(opcode & 0xFF);                 \
+            thumb_ldm_list(address, opcode & 0xFF, bitcount);              \
+            address += bitcount << 2;                                      \
             if (bitcount)                                                  \
             {                                                              \
                 clocks -= (GBA_MemoryGetAccessCyclesSeq32(address)         \
@@ -1300,27 +1257,27 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 // about it...
 
             // LDMIA Rb!,{Rlist}
-            case 0xC8:
+            case THUMB_OP(0xC8):
                 LDMIA(0);
-            case 0xC9:
+            case THUMB_OP(0xC9):
                 LDMIA(1);
-            case 0xCA:
+            case THUMB_OP(0xCA):
                 LDMIA(2);
-            case 0xCB:
+            case THUMB_OP(0xCB):
                 LDMIA(3);
-            case 0xCC:
+            case THUMB_OP(0xCC):
                 LDMIA(4);
-            case 0xCD:
+            case THUMB_OP(0xCD):
                 LDMIA(5);
-            case 0xCE:
+            case THUMB_OP(0xCE):
                 LDMIA(6);
-            case 0xCF:
+            case THUMB_OP(0xCF):
                 LDMIA(7);
 
-            case 0xD0:
+            case THUMB_OP(0xD0):
             {
                 // BEQ label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (CPU.CPSR & F_Z)
                 {
@@ -1333,10 +1290,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD1:
+            case THUMB_OP(0xD1):
             {
                 // BNE label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if ((CPU.CPSR & F_Z) == 0)
                 {
@@ -1349,10 +1306,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD2:
+            case THUMB_OP(0xD2):
             {
                 // BCS label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (CPU.CPSR & F_C)
                 {
@@ -1365,10 +1322,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD3:
+            case THUMB_OP(0xD3):
             {
                 // BCC label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if ((CPU.CPSR & F_C) == 0)
                 {
@@ -1381,10 +1338,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD4:
+            case THUMB_OP(0xD4):
             {
                 // BMI label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (CPU.CPSR & F_N)
                 {
@@ -1397,10 +1354,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD5:
+            case THUMB_OP(0xD5):
             {
                 // BPL label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if ((CPU.CPSR & F_N) == 0)
                 {
@@ -1413,10 +1370,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD6:
+            case THUMB_OP(0xD6):
             {
                 // BVS label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (CPU.CPSR & F_V)
                 {
@@ -1429,10 +1386,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD7:
+            case THUMB_OP(0xD7):
             {
                 // BVC label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if ((CPU.CPSR & F_V) == 0)
                 {
@@ -1445,10 +1402,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD8:
+            case THUMB_OP(0xD8):
             {
                 // BHI label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if ((CPU.CPSR & (F_C | F_Z)) == F_C)
                 {
@@ -1461,10 +1418,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xD9:
+            case THUMB_OP(0xD9):
             {
                 // BLS label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (((CPU.CPSR & F_C) == 0) || (CPU.CPSR & F_Z))
                 {
@@ -1477,10 +1434,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xDA:
+            case THUMB_OP(0xDA):
             {
                 // BGE label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (!(((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0)))
                 {
@@ -1493,10 +1450,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xDB:
+            case THUMB_OP(0xDB):
             {
                 // BLT label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0))
                 {
@@ -1509,10 +1466,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xDC:
+            case THUMB_OP(0xDC):
             {
                 // BGT label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if (((CPU.CPSR & F_Z) == 0)
                     && !(((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0)))
@@ -1526,10 +1483,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xDD:
+            case THUMB_OP(0xDD):
             {
                 // BLE label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 if ((CPU.CPSR & F_Z)
                     || (((CPU.CPSR & F_N) != 0) ^ ((CPU.CPSR & F_V) != 0)))
@@ -1543,13 +1500,13 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 }
                 break;
             }
-            case 0xDE:
+            case THUMB_OP(0xDE):
             {
                 // B{cond} with cond = always -- Tested in real hardware
                 THUMB_UNDEFINED_INSTRUCTION(); // Undefined opcode #D
                 break;
             }
-            case 0xDF:
+            case THUMB_OP(0xDF):
             {
                 // SWI nn
                 if (GBA_BiosIsLoaded() == 0)
@@ -1564,18 +1521,18 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                     if (swinummber != 4)
                     {
                         CPU.R[R_PC] += 2;
-                        GBA_Swi(swinummber);
-                        clocks -= 50;
+                        clocks -= GBA_Swi(swinummber);
                         return clocks;
                         //return GBA_ExecuteARM(clocks);
                     }
                 }
 
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
 
-                CPU.R14_svc = CPU.R[R_PC] + 2; // Save return address
-                CPU.SPSR_svc = CPU.CPSR;       // Save CPSR flags
+                // Save return address and CPSR flags
+                CPU.bank[CPU_SUPERVISOR].R14 = CPU.R[R_PC] + 2;
+                CPU.bank[CPU_SUPERVISOR].SPSR = CPU.CPSR;
                 // Enter SVC, ARM state, IRQs disabled
                 GBA_CPUChangeMode(M_SUPERVISOR);
                 CPU.EXECUTION_MODE = EXEC_ARM;
@@ -1589,10 +1546,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 return clocks;
                 //return GBA_ExecuteARM(clocks);
             }
-            case 0xE0 ... 0xE3:
+            case THUMB_OPS(0xE0, 0xE3):
             {
                 // B label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
 
                 s32 offset = (opcode & 0x3FF) << 1;
@@ -1602,10 +1559,10 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 CPU.R[R_PC] -= 2;
                 break;
             }
-            case 0xE4 ... 0xE7:
+            case THUMB_OPS(0xE4, 0xE7):
             {
                 // B label
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
                 s32 offset = (opcode & 0x3FF) << 1;
                 offset |= 0xFFFFF800;
@@ -1615,50 +1572,52 @@ s32 GBA_ExecuteTHUMB(s32 clocks)
                 CPU.R[R_PC] -= 2;
                 break;
             }
-            case 0xE8 ... 0xEF:
+            case THUMB_OPS(0xE8, 0xEF):
             {
                 // Undefined Opcode #E -- tested on hardware
                 THUMB_UNDEFINED_INSTRUCTION();
                 break;
             }
-            case 0xF0 ... 0xF3:
-            {
-                // BL label -- First part
-                // LR = PC + 4 + (nn SHL 12)
-                CPU.R[R_LR] = CPU.R[R_PC] + 4
-                              + (((u32)opcode & 0x7FF) << 12);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
-                // 1S cycle
-                break;
-            }
-            case 0xF4 ... 0xF7:
+            case THUMB_OPS(0xF0, 0xF7):
             {
                 // BL label -- First part
-                // LR = PC + 4 + (nn SHL 12)
+                // LR = PC + 4 + (nn SHL 12), nn is signed
                 CPU.R[R_LR] = CPU.R[R_PC] + 4
-                              + ((((u32)opcode & 0x7FF) << 12) | 0xFF800000);
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
+                              + ((u32)((s32)((u32)opcode << 21) >> 9));
+                clocks -= GBA_MemoryGetFetchCycles(PCseq, 0, CPU.R[R_PC]);
                 // 1S cycle
+
+                // Run the second part right away if nothing would have
+                // happened between both parts: the main loop would have run
+                // again, and there are no breakpoints or traces to check.
+                if (entry && entry->bl_pair && (clocks > 0)
+                    && !breakpoints && !trace)
+                {
+                    CPU.R[R_PC] += 2;
+                    CPU.OldPC = CPU.R[R_PC];
+                    clocks = thumb_bl_second_part(1, entry[1].opcode, clocks);
+                }
                 break;
             }
-            case 0xF8 ... 0xFF:
+            case THUMB_OPS(0xF8, 0xFF):
             {
-                // BL label -- Second part
-                // PC = LR + (nn SHL 1), and LR = PC+2 OR 1
-                clocks -= GBA_MemoryGetAccessCycles(PCseq, 0, CPU.R[R_PC]);
-                // 1S cycle
-                u32 temp = CPU.R[R_LR] + (((u32)opcode & 0x7FF) << 1);
-                CPU.R[R_LR] = (CPU.R[R_PC] + 2) | 1;
-                CPU.R[R_PC] = temp;
-                clocks -= GBA_MemoryGetAccessCyclesNoSeq16(CPU.R[R_PC])
-                          + GBA_MemoryGetAccessCyclesSeq16(CPU.R[R_PC]); // 1S+1N
-                CPU.R[R_PC] -= 2;
+                clocks = thumb_bl_second_part(PCseq, opcode, clocks);
                 break;
             }
         }
 
+#ifdef ENABLE_OPCODE_PROFILE
+        if (opprofile)
+            OPProfile_Cycles(OPPROFILE_THUMB(ident), opprofile_clocks - clocks);
+#endif
+
         CPU.R[R_PC] += 2;
         //CPU.R[R_PC] = (CPU.R[R_PC] + 2) & ~1;
+
+        // Short jumps backwards can be idle loops. OldPC is the address of the
+        // instruction that has just been executed.
+        if ((CPU.OldPC - CPU.R[R_PC]) < GBA_IDLE_LOOP_MAX_SIZE)
+            clocks = GBA_CPUIdleLoopCheck(clocks);
     }
 
     return clocks;
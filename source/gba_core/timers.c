@@ -11,6 +11,7 @@
 #include "gba.h"
 #include "interrupts.h"
 #include "memory.h"
+#include "scheduler.h"
 #include "sound.h"
 #include "timers.h"
 
@@ -26,7 +27,7 @@ typedef struct
     u16 enabled;
 } _timer_t;
 
-_timer_t Timer[4];
+core_local__ _timer_t Timer[4];
 
 //----------------------------------------------------------------
 
@@ -46,21 +47,29 @@ void GBA_TimerInitAll(void)
 
 void GBA_TimerSetStart0(u16 val)
 {
+    // The reload value is used by any overflow that hasn't been handled yet
+    GBA_TimersSync();
     Timer[0].start = val;
 }
 
 void GBA_TimerSetStart1(u16 val)
 {
+    // The reload value is used by any overflow that hasn't been handled yet
+    GBA_TimersSync();
     Timer[1].start = val;
 }
 
 void GBA_TimerSetStart2(u16 val)
 {
+    // The reload value is used by any overflow that hasn't been handled yet
+    GBA_TimersSync();
     Timer[2].start = val;
 }
 
 void GBA_TimerSetStart3(u16 val)
 {
+    // The reload value is used by any overflow that hasn't been handled yet
+    GBA_TimersSync();
     Timer[3].start = val;
 }
 
@@ -92,6 +101,8 @@ static const s32 gba_timerclockspertic[4] = { 1, 64, 256, 1024 };
 
 void GBA_TimerSetup0(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 1);
+
     Timer[0].cascade = REG_TM0CNT_H & BIT(2);
     //if (Timer[0].cascade) // Disable
     Timer[0].irqenable = REG_TM0CNT_H & BIT(6);
@@ -108,6 +119,8 @@ void GBA_TimerSetup0(void)
 
 void GBA_TimerSetup1(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 1);
+
     Timer[1].cascade = REG_TM1CNT_H & BIT(2);
     Timer[1].irqenable = REG_TM1CNT_H & BIT(6);
     Timer[1].enabled = REG_TM1CNT_H & BIT(7);
@@ -123,6 +136,8 @@ void GBA_TimerSetup1(void)
 
 void GBA_TimerSetup2(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 1);
+
     Timer[2].cascade = REG_TM2CNT_H & BIT(2);
     Timer[2].irqenable = REG_TM2CNT_H & BIT(6);
     Timer[2].enabled = REG_TM2CNT_H & BIT(7);
@@ -138,6 +153,8 @@ void GBA_TimerSetup2(void)
 
 void GBA_TimerSetup3(void)
 {
+    GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 1);
+
     Timer[3].cascade = REG_TM3CNT_H & BIT(2);
     Timer[3].irqenable = REG_TM3CNT_H & BIT(6);
     Timer[3].enabled = REG_TM3CNT_H & BIT(7);
@@ -153,139 +170,138 @@ void GBA_TimerSetup3(void)
 
 //----------------------------------------------------------------
 
-s32 GBA_TimersUpdate(s32 clocks)
-{
-    int timer0overflowed = 0;
-    int timer1overflowed = 0;
-    int timer2overflowed = 0;
+// The registers of the counters are only valid after calling this function.
+// They are updated when a timer overflows in a way that matters (it requests an
+// IRQ, it feeds a sound FIFO or there's a cascade timer after it that matters)
+// and when they are read.
 
-    s32 returnclocks = 0x7FFFFFFF;
+#define REG_TMCNT_L(n)      REG_16(TM0CNT_L + ((n) * 4))
 
-    if (Timer[0].enabled)
+// Adds the specified number of ticks to the counter of a timer and returns the
+// number of times that it has overflowed.
+static u32 gba_timer_add_ticks(int n, u32 ticks)
+{
+    u32 counter = REG_TMCNT_L(n);
+    u32 ticks_to_overflow = 0x10000 - counter;
+
+    if (ticks < ticks_to_overflow)
     {
-        //if (Timer[0].cascade == 0)
-        {
-            Timer[0].remainingclocks -= clocks;
-            while (Timer[0].remainingclocks <= 0)
-            {
-                Timer[0].remainingclocks += Timer[0].clockspertick;
-                REG_TM0CNT_L++;
-                if (REG_TM0CNT_L == 0)
-                {
-                    GBA_SoundTimerCheck(0);
-                    REG_TM0CNT_L = Timer[0].start;
-                    if (Timer[0].irqenable)
-                        GBA_CallInterrupt(BIT(3));
-                    timer0overflowed = 1;
-                }
-            }
+        REG_TMCNT_L(n) = counter + ticks;
+        return 0;
+    }
 
-            returnclocks = Timer[0].remainingclocks
-                           * (0x10000 - (u32)REG_TM0CNT_L);
-        }
+    // After overflowing, the counter is reloaded with the start value
+    ticks -= ticks_to_overflow;
+    u32 period = 0x10000 - (u32)Timer[n].start;
+
+    REG_TMCNT_L(n) = Timer[n].start + (ticks % period);
+    return 1 + (ticks / period);
+}
+
+static int gba_timer_counts_clocks(int n)
+{
+    // Timer 0 can't be in cascade mode
+    return (n == 0) || (Timer[n].cascade == 0);
+}
+
+s32 GBA_TimersUpdate(s32 clocks)
+{
+    if (!(Timer[0].enabled || Timer[1].enabled || Timer[2].enabled
+          || Timer[3].enabled))
+    {
+        // Nothing to do until a timer is enabled again
+        GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 0);
+        return 0x7FFFFFFF;
     }
 
-    if (Timer[1].enabled)
+    u32 overflows = 0; // Overflows of the previous timer
+
+    for (int n = 0; n < 4; n++)
     {
-        if (Timer[1].cascade == 0)
-        {
-            Timer[1].remainingclocks -= clocks;
-            while (Timer[1].remainingclocks <= 0)
-            {
-                Timer[1].remainingclocks += Timer[1].clockspertick;
-                REG_TM1CNT_L++;
-                if (REG_TM1CNT_L == 0)
-                {
-                    GBA_SoundTimerCheck(1);
-                    REG_TM1CNT_L = Timer[1].start;
-                    if (Timer[1].irqenable)
-                        GBA_CallInterrupt(BIT(4));
-                    timer1overflowed = 1;
-                }
-            }
+        _timer_t *t = &Timer[n];
 
-            returnclocks = min(returnclocks,
-                               Timer[1].remainingclocks
-                                       * (0x10000 - (u32)REG_TM1CNT_L));
-        }
-        else if (timer0overflowed)
+        if (!t->enabled)
         {
-            REG_TM1CNT_L++;
-            if (REG_TM1CNT_L == 0)
-            {
-                REG_TM1CNT_L = Timer[1].start;
-                if (Timer[1].irqenable)
-                    GBA_CallInterrupt(BIT(4));
-                timer1overflowed = 1;
-            }
+            overflows = 0;
+            continue;
         }
-    }
-    if (Timer[2].enabled)
-    {
-        if (Timer[2].cascade == 0)
+
+        if (gba_timer_counts_clocks(n))
         {
-            Timer[2].remainingclocks -= clocks;
-            while (Timer[2].remainingclocks <= 0)
+            u32 ticks = 0;
+
+            t->remainingclocks -= clocks;
+            if (t->remainingclocks <= 0)
             {
-                Timer[2].remainingclocks += Timer[2].clockspertick;
-                REG_TM2CNT_L++;
-                if (REG_TM2CNT_L == 0)
-                {
-                    REG_TM2CNT_L = Timer[2].start;
-                    if (Timer[2].irqenable)
-                        GBA_CallInterrupt(BIT(5));
-                    timer2overflowed = 1;
-                }
+                ticks = ((u32)(-t->remainingclocks) / t->clockspertick) + 1;
+                t->remainingclocks += ticks * t->clockspertick;
             }
 
-            returnclocks = min(returnclocks,
-                               Timer[2].remainingclocks
-                                       * (0x10000 - (u32)REG_TM2CNT_L));
+            overflows = gba_timer_add_ticks(n, ticks);
         }
-        else if (timer1overflowed)
+        else
         {
-            REG_TM2CNT_L++;
-            if (REG_TM2CNT_L == 0)
-            {
-                REG_TM2CNT_L = Timer[2].start;
-                if (Timer[2].irqenable)
-                    GBA_CallInterrupt(BIT(5));
-                timer2overflowed = 1;
-            }
+            overflows = gba_timer_add_ticks(n, overflows);
         }
+
+        if (overflows == 0)
+            continue;
+
+        if ((n < 2) && GBA_SoundTimerIsUsed(n))
+            GBA_SoundTimerOverflow(n, overflows);
+
+        if (t->irqenable)
+            GBA_CallInterrupt(BIT(3 + n));
     }
-    if (Timer[3].enabled)
+
+    // Look for the next overflow that has any effect. The overflows of a timer
+    // matter if the next one is a cascade timer whose overflows matter.
+
+    s32 returnclocks = 0x7FFFFFFF;
+    int next_matters = 0;
+
+    for (int n = 3; n >= 0; n--)
     {
-        if (Timer[3].cascade == 0)
-        {
-            Timer[3].remainingclocks -= clocks;
-            while (Timer[3].remainingclocks <= 0)
-            {
-                Timer[3].remainingclocks += Timer[3].clockspertick;
-                REG_TM3CNT_L++;
-                if (REG_TM3CNT_L == 0)
-                {
-                    REG_TM3CNT_L = Timer[3].start;
-                    if (Timer[3].irqenable)
-                        GBA_CallInterrupt(BIT(6));
-                }
-            }
+        _timer_t *t = &Timer[n];
 
-            returnclocks = min(returnclocks,
-                               Timer[3].remainingclocks
-                                       * (0x10000 - (u32)REG_TM3CNT_L));
-        }
-        else if (timer2overflowed)
+        int matters = 0;
+
+        if (t->enabled)
         {
-            REG_TM3CNT_L++;
-            if (REG_TM3CNT_L == 0)
+            matters = t->irqenable || ((n < 2) && GBA_SoundTimerIsUsed(n))
+                      || next_matters;
+
+            if (matters && gba_timer_counts_clocks(n))
             {
-                REG_TM3CNT_L = Timer[3].start;
-                if (Timer[3].irqenable)
-                    GBA_CallInterrupt(BIT(6));
+                s32 ticks_left = 0x10000 - (u32)REG_TMCNT_L(n);
+                s32 clocks_left = t->remainingclocks
+                                  + (ticks_left - 1) * t->clockspertick;
+                returnclocks = min(returnclocks, clocks_left);
             }
         }
+
+        // Only a cascade timer passes the requirement to the previous one
+        next_matters = matters && (n > 0) && (t->cascade != 0);
     }
 
+    // The scheduler will call this function again at the next overflow that
+    // matters, or when the timers are read or their configuration changes.
+    GBA_SchedulerSetPolling(GBA_EVENT_TIMERS, 0);
+
     return returnclocks;
 }
+
+void GBA_TimersSync(void)
+{
+    GBA_SchedulerSync(GBA_EVENT_TIMERS);
+}
+
+void GBA_TimersStateSave(_savestate_t *st)
+{
+    SaveState_WriteChunk(st, "TMR ", Timer, sizeof(Timer));
+}
+
+void GBA_TimersStateLoad(_savestate_t *st)
+{
+    SaveState_ReadChunk(st, "TMR ", Timer, sizeof(Timer));
+}
@@ -29,4 +29,12 @@ void GBA_TimerSetup3(void);
 
 s32 GBA_TimersUpdate(s32 clocks);
 
+// The counters of the timers are only updated when they overflow in a way that
+// has side effects (IRQ, sound FIFO or cascade), this updates them before they
+// are read.
+void GBA_TimersSync(void);
+
+void GBA_TimersStateSave(_savestate_t *st);
+void GBA_TimersStateLoad(_savestate_t *st);
+
 #endif // GBA_TIMERS__
@@ -7,18 +7,25 @@
 #include <string.h>
 
 #include "../build_options.h"
+#include "../hash_utils.h"
 
 #include "gba.h"
 #include "memory.h"
 #include "video.h"
 
-extern _mem_t Mem;
-static int curr_screen_buffer = 0;
-static u16 screen_buffer_array[2][240 * 160]; // Doble buffer
-static u16 *screen_buffer = screen_buffer_array[0];
+extern core_local__ _mem_t Mem;
+static core_local__ int curr_screen_buffer = 0;
+static core_local__ u16 screen_buffer_array[2][240 * 160]; // Doble buffer
+// Set by GBA_VideoInit(). The array can be thread-local (see core_local__), so
+// its address can't be used to initialize it.
+static core_local__ u16 *screen_buffer;
+// Set if any scanline of the buffer isn't the same as in the previous frame
+static core_local__ int screen_buffer_changed[2];
+// Hash of each scanline of the buffers, updated when the scanline is drawn
+static core_local__ u32 screen_line_hash[2][160];
 
 typedef void (*draw_scanline_fn)(s32);
-static draw_scanline_fn DrawScanlineFn;
+static core_local__ draw_scanline_fn DrawScanlineFn;
 
 static void GBA_DrawScanlineMode0(s32 y);
 static void GBA_DrawScanlineMode1(s32 y);
@@ -28,12 +35,15 @@ static void GBA_DrawScanlineMode4(s32 y);
 static void GBA_DrawScanlineMode5(s32 y);
 void GBA_DrawScanlineWhite(s32 y);
 
-static s32 BG2lastx, BG2lasty; // For affine transformation
-static s32 BG3lastx, BG3lasty;
+static core_local__ s32 BG2lastx, BG2lasty; // For affine transformation
+static core_local__ s32 BG3lastx, BG3lasty;
 
-static s32 MosSprX, MosSprY, MosBgX, MosBgY;
-static u32 Win0X1, Win0X2, Win0Y1, Win0Y2;
-static u32 Win1X1, Win1X2, Win1Y1, Win1Y2;
+static core_local__ s32 mosBG2lastx, mosBG2lasty, mos2A, mos2C;
+static core_local__ s32 mosBG3lastx, mosBG3lasty, mos3A, mos3C;
+
+static core_local__ s32 MosSprX, MosSprY, MosBgX, MosBgY;
+static core_local__ u32 Win0X1, Win0X2, Win0Y1, Win0Y2;
+static core_local__ u32 Win1X1, Win1X2, Win1Y1, Win1Y2;
 
 //-----------------------------------------------------------
 
@@ -46,7 +56,207 @@ static void mem_clear_32(u32 *ptr, u32 size)
 
 //-----------------------------------------------------------
 
-static int gba_frameskip = 0;
+// Per-pixel flags of a scanline are stored as masks with one bit per pixel.
+// Pixel x is bit (x & 63) of word (x >> 6). Bits 240-255 are always 0.
+
+#define LINE_MASK_WORDS 4
+
+static inline int line_mask_get(const u64 *mask, int x)
+{
+    return (mask[x >> 6] >> (x & 63)) & 1;
+}
+
+static inline void line_mask_set(u64 *mask, int x)
+{
+    mask[x >> 6] |= (u64)1 << (x & 63);
+}
+
+// Sets the bit if value isn't 0. The mask must be cleared beforehand.
+static inline void line_mask_set_if(u64 *mask, int x, u32 value)
+{
+    mask[x >> 6] |= (u64)(value != 0) << (x & 63);
+}
+
+static void line_mask_fill(u64 *mask, int value)
+{
+    mask[0] = value ? ~(u64)0 : 0;
+    mask[1] = mask[0];
+    mask[2] = mask[0];
+    mask[3] = mask[0] & 0x0000FFFFFFFFFFFFULL;
+}
+
+static void line_mask_or(u64 *mask, const u64 *src)
+{
+    for (int w = 0; w < LINE_MASK_WORDS; w++)
+        mask[w] |= src[w];
+}
+
+static void line_mask_and(u64 *mask, const u64 *src)
+{
+    for (int w = 0; w < LINE_MASK_WORDS; w++)
+        mask[w] &= src[w];
+}
+
+static void line_mask_and_not(u64 *mask, const u64 *src)
+{
+    for (int w = 0; w < LINE_MASK_WORDS; w++)
+        mask[w] &= ~src[w];
+}
+
+// Sets or clears pixels x1 to x2 - 1
+static void line_mask_range(u64 *mask, int x1, int x2, int value)
+{
+    for (int w = 0; w < LINE_MASK_WORDS; w++)
+    {
+        int start = (x1 > (w * 64)) ? x1 : (w * 64);
+        int end = (x2 < ((w + 1) * 64)) ? x2 : ((w + 1) * 64);
+
+        if (start >= end)
+            continue;
+
+        int len = end - start;
+        u64 bits = (len == 64) ? ~(u64)0 : (((u64)1 << len) - 1);
+        bits <<= start & 63;
+
+        if (value)
+            mask[w] |= bits;
+        else
+            mask[w] &= ~bits;
+    }
+}
+
+//-----------------------------------------------------------
+
+// Scanline cache
+// --------------
+//
+// Most of the time the screen doesn't change much from one frame to the next.
+// Before drawing a scanline, all the state that affects it is compared with the
+// state it had the last time it was drawn. If it hasn't changed, the scanline
+// is copied from the screen buffer that already has it. Writes to palette, VRAM
+// and OAM only increment gba_video_memory_version if they change the data.
+
+core_local__ u32 gba_video_memory_version;
+
+typedef struct
+{
+    u16 io_regs[0x58 / 2]; // From DISPCNT to BLDY
+    s32 bg_last[4];
+    s32 mos_bg_last[8];
+    s32 mos[4];
+    u32 win[8];
+    u32 memory_version;
+} _gba_scanline_state_t;
+
+typedef struct
+{
+    _gba_scanline_state_t state;
+    s32 mos_bg_last_after[8]; // The affine mosaic state is updated when drawing
+    int buffer; // Screen buffer that has this scanline, -1 if none
+} _gba_scanline_cache_t;
+
+static core_local__ _gba_scanline_cache_t scanline_cache[160];
+static core_local__ _gba_scanline_state_t scanline_state;
+
+static void gba_scanline_mosaic_get(s32 *mos_bg_last)
+{
+    mos_bg_last[0] = mosBG2lastx;
+    mos_bg_last[1] = mosBG2lasty;
+    mos_bg_last[2] = mos2A;
+    mos_bg_last[3] = mos2C;
+    mos_bg_last[4] = mosBG3lastx;
+    mos_bg_last[5] = mosBG3lasty;
+    mos_bg_last[6] = mos3A;
+    mos_bg_last[7] = mos3C;
+}
+
+static void gba_scanline_mosaic_set(const s32 *mos_bg_last)
+{
+    mosBG2lastx = mos_bg_last[0];
+    mosBG2lasty = mos_bg_last[1];
+    mos2A = mos_bg_last[2];
+    mos2C = mos_bg_last[3];
+    mosBG3lastx = mos_bg_last[4];
+    mosBG3lasty = mos_bg_last[5];
+    mos3A = mos_bg_last[6];
+    mos3C = mos_bg_last[7];
+}
+
+static void gba_scanline_state_get(_gba_scanline_state_t *state)
+{
+    memcpy(state->io_regs, Mem.io_regs, sizeof(state->io_regs));
+
+    state->bg_last[0] = BG2lastx;
+    state->bg_last[1] = BG2lasty;
+    state->bg_last[2] = BG3lastx;
+    state->bg_last[3] = BG3lasty;
+
+    gba_scanline_mosaic_get(state->mos_bg_last);
+
+    state->mos[0] = MosSprX;
+    state->mos[1] = MosSprY;
+    state->mos[2] = MosBgX;
+    state->mos[3] = MosBgY;
+
+    state->win[0] = Win0X1;
+    state->win[1] = Win0X2;
+    state->win[2] = Win0Y1;
+    state->win[3] = Win0Y2;
+    state->win[4] = Win1X1;
+    state->win[5] = Win1X2;
+    state->win[6] = Win1Y1;
+    state->win[7] = Win1Y2;
+
+    state->memory_version = gba_video_memory_version;
+}
+
+static void gba_scanline_cache_invalidate(void)
+{
+    for (int y = 0; y < 160; y++)
+        scanline_cache[y].buffer = -1;
+}
+
+// Returns 1 if the scanline has been taken from the cache. If not, the state
+// is kept in scanline_state so that gba_scanline_cache_store() can save it.
+static int gba_scanline_cache_restore(s32 y)
+{
+    _gba_scanline_cache_t *line = &scanline_cache[y];
+
+    gba_scanline_state_get(&scanline_state);
+
+    if (line->buffer < 0)
+        return 0;
+
+    if (memcmp(&line->state, &scanline_state, sizeof(scanline_state)) != 0)
+        return 0;
+
+    if (line->buffer != curr_screen_buffer)
+    {
+        memcpy(&screen_buffer[240 * y],
+               &screen_buffer_array[line->buffer][240 * y],
+               240 * sizeof(u16));
+        screen_line_hash[curr_screen_buffer][y] =
+                screen_line_hash[line->buffer][y];
+        line->buffer = curr_screen_buffer;
+    }
+
+    gba_scanline_mosaic_set(line->mos_bg_last_after);
+
+    return 1;
+}
+
+static void gba_scanline_cache_store(s32 y)
+{
+    _gba_scanline_cache_t *line = &scanline_cache[y];
+
+    line->state = scanline_state;
+    gba_scanline_mosaic_get(line->mos_bg_last_after);
+    line->buffer = curr_screen_buffer;
+}
+
+//-----------------------------------------------------------
+
+static core_local__ int gba_frameskip = 0;
 
 void GBA_SkipFrame(int skip)
 {
@@ -58,6 +268,36 @@ int GBA_HasToSkipFrame(void)
     return gba_frameskip;
 }
 
+int GBA_ScreenBufferHasChanged(void)
+{
+    return screen_buffer_changed[curr_screen_buffer ^ 1];
+}
+
+static void gba_screen_line_hash_update(s32 y)
+{
+    screen_line_hash[curr_screen_buffer][y] =
+            Hash_CRC32C(0, &screen_buffer[240 * y], 240 * sizeof(u16));
+}
+
+static void gba_screen_hash_update_all(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        for (int y = 0; y < 160; y++)
+        {
+            screen_line_hash[i][y] =
+                    Hash_CRC32C(0, &screen_buffer_array[i][240 * y],
+                                240 * sizeof(u16));
+        }
+    }
+}
+
+u32 GBA_ScreenBufferGetHash(void)
+{
+    return Hash_CRC32C(0, screen_line_hash[curr_screen_buffer ^ 1],
+                       sizeof(screen_line_hash[0]));
+}
+
 //-----------------------------------------------------------
 
 void GBA_UpdateDrawScanlineFn(void)
@@ -102,6 +342,7 @@ void GBA_DrawScanline(s32 y)
     {
         curr_screen_buffer ^= 1;
         screen_buffer = screen_buffer_array[curr_screen_buffer];
+        screen_buffer_changed[curr_screen_buffer] = 0;
 
         BG2lastx = REG_BG2X;
         if (BG2lastx & BIT(27))
@@ -118,7 +359,13 @@ void GBA_DrawScanline(s32 y)
             BG3lasty |= 0xF0000000;
     }
 
-    DrawScanlineFn(y);
+    if (!gba_scanline_cache_restore(y))
+    {
+        DrawScanlineFn(y);
+        gba_screen_line_hash_update(y);
+        gba_scanline_cache_store(y);
+        screen_buffer_changed[curr_screen_buffer] = 1;
+    }
 
     BG2lastx += (s32)(s16)REG_BG2PB;
     BG2lasty += (s32)(s16)REG_BG2PD;
@@ -137,19 +384,24 @@ void GBA_DrawScanlineWhite(s32 y)
         curr_screen_buffer ^= 1;
         screen_buffer = screen_buffer_array[curr_screen_buffer];
     }
+    screen_buffer_changed[curr_screen_buffer] = 1;
+
     u32 *destptr = (u32 *)&screen_buffer[240 * y];
 
     for (int i = 0; i < 240 / 2; i++)
         *destptr++ = 0x7FFF7FFF;
+
+    gba_screen_line_hash_update(y);
+    scanline_cache[y].buffer = -1;
 }
 
 //------------------------------------------------------------------------------
 //
-u16 sprfb[4][240];
-int sprvisible[4][240];
-int sprwin[240];
-int sprblend[4][240];   // This sprite pixel is in blending mode
-u16 sprblendfb[4][240]; // One line for each sprite priority
+core_local__ u16 sprfb[4][240];
+core_local__ u64 sprvisible[4][LINE_MASK_WORDS];
+core_local__ u64 sprwin[LINE_MASK_WORDS];
+core_local__ int sprblend[4][240];   // This sprite pixel is in blending mode
+core_local__ u16 sprblendfb[4][240]; // One line for each sprite priority
 
 static const int spr_size[4][4][2] = { // Inputs = [Shape][Size][{x, y}]
     { { 8, 8 }, { 16, 16 }, { 32, 32 }, { 64, 64 } }, // Square
@@ -158,766 +410,842 @@ static const int spr_size[4][4][2] = { // Inputs = [Shape][Size][{x, y}]
     { { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } }        // Prohibited
 };
 
-static void gba_sprites_draw_mode012(s32 ly)
+// Decoded sprites
+// ---------------
+//
+// The attributes of the 128 sprites are decoded when OAM is modified, and kept
+// in one array per field so that the renderer doesn't have to extract them
+// from the OAM entries for every sprite in every scanline.
+
+#define SPR_FLAG_AFFINE     BIT(0)
+#define SPR_FLAG_256        BIT(1) // 256 colors
+#define SPR_FLAG_MOSAIC     BIT(2)
+#define SPR_FLAG_HFLIP      BIT(3) // Only for regular sprites
+#define SPR_FLAG_VFLIP      BIT(4)
+
+static core_local__ s16 spr_x[128];
+static core_local__ s16 spr_y[128];
+static core_local__ u8 spr_w[128]; // Size of the sprite
+static core_local__ u8 spr_h[128];
+static core_local__ u8 spr_canvas_w[128]; // Double for double size sprites
+static core_local__ u8 spr_canvas_h[128];
+static core_local__ u16 spr_tile_base[128]; // Halved in 256 color mode
+static core_local__ u16 *spr_palette[128];
+static core_local__ u8 spr_prio[128];
+static core_local__ u8 spr_mode[128];
+static core_local__ u8 spr_flags[128];
+static core_local__ _oam_matrix_entry_t *spr_matrix[128];
+static core_local__ u16 spr_cycles[128]; // Clocks needed in each scanline
+
+// Sprites sorted by the scanlines they cover
+// -------------------------------------------
+//
+// Instead of checking all 128 sprites in every scanline, there is a list of the
+// sprites that cover each scanline (in OAM order). It is rebuilt, along with
+// the decoded sprites, the first time it is needed after OAM has been modified.
+
+static core_local__ u8 spr_line_list[160][128];
+static core_local__ int spr_line_count[160];
+
+static void gba_sprites_decode(int i)
 {
-    _oam_spr_entry_t *spr = (_oam_spr_entry_t *)Mem.oam;
+    _oam_spr_entry_t *spr = &(((_oam_spr_entry_t *)Mem.oam)[i]);
+
+    u16 attr0 = spr->attr0;
+    u16 attr1 = spr->attr1;
+    u16 attr2 = spr->attr2;
+
+    u16 shape = attr0 >> 14;
+    u16 size = attr1 >> 14;
+    int sx = spr_size[shape][size][0];
+    int sy = spr_size[shape][size][1];
+
+    int y = (attr0 & 0xFF);
+    y |= (y < 160) ? 0 : 0xFFFFFF00;
+    int x = (int)(attr1 & 0x1FF) | ((attr1 & BIT(8)) ? 0xFFFFFE00 : 0);
 
-    for (int i = 0; i < 128; i++)
+    spr_x[i] = x;
+    spr_y[i] = y;
+    spr_w[i] = sx;
+    spr_h[i] = sy;
+
+    int flags = 0;
+
+    if (attr0 & BIT(12))
+        flags |= SPR_FLAG_MOSAIC;
+
+    // Each pixel of a regular sprite takes 1 clock to render, affine sprites
+    // take 2 clocks per pixel of the canvas plus 10 clocks.
+    if (attr0 & BIT(8)) // Affine sprite
     {
-        u16 attr0 = spr->attr0;
+        flags |= SPR_FLAG_AFFINE;
 
-        if (attr0 & BIT(8)) // Affine sprite -- No H flip or V flip
+        if (attr0 & BIT(9)) // Double size
         {
-            int mosaic = attr0 & BIT(12);
+            sx <<= 1;
+            sy <<= 1;
+        }
+
+        spr_matrix[i] =
+                &(((_oam_matrix_entry_t *)Mem.oam)[(attr1 >> 9) & 0x1F]);
+
+        spr_cycles[i] = 10 + (sx * 2);
+    }
+    else
+    {
+        if (attr1 & BIT(12))
+            flags |= SPR_FLAG_HFLIP;
+        if (attr1 & BIT(13))
+            flags |= SPR_FLAG_VFLIP;
+
+        spr_cycles[i] = sx;
+    }
+
+    spr_canvas_w[i] = sx;
+    spr_canvas_h[i] = sy;
+
+    spr_mode[i] = (attr0 >> 10) & 3;
+    spr_prio[i] = (attr2 >> 10) & 3;
+
+    if (attr0 & BIT(13)) // 256 colors
+    {
+        flags |= SPR_FLAG_256;
+
+        // In 256 mode, they need double space
+        spr_tile_base[i] = (attr2 & 0x3FF) >> 1;
+        spr_palette[i] = (u16 *)&(Mem.pal_ram[256 * 2]);
+    }
+    else
+    {
+        u16 palno = attr2 >> 12;
+        spr_tile_base[i] = attr2 & 0x3FF;
+        spr_palette[i] = (u16 *)&Mem.pal_ram[512 + (palno * 32)];
+    }
+
+    spr_flags[i] = flags;
+}
+
+static void gba_sprites_line_list_build(void)
+{
+    memset(spr_line_count, 0, sizeof(spr_line_count));
+
+    _oam_spr_entry_t *spr = (_oam_spr_entry_t *)Mem.oam;
+
+    for (int i = 0; i < 128; i++, spr++)
+    {
+        // Not displayed
+        if ((spr->attr0 & (BIT(8) | BIT(9))) == BIT(9))
+            continue;
+
+        gba_sprites_decode(i);
+
+        int y = spr_y[i];
 
-            u16 attr1 = spr->attr1;
-            u16 attr2 = spr->attr2;
+        int y1 = (y < 0) ? 0 : y;
+        int y2 = (y + spr_canvas_h[i] > 160) ? 160 : y + spr_canvas_h[i];
 
-            _oam_matrix_entry_t *mat =
-                    &(((_oam_matrix_entry_t *)Mem.oam)[(attr1 >> 9) & 0x1F]);
+        for (int ly = y1; ly < y2; ly++)
+            spr_line_list[ly][spr_line_count[ly]++] = i;
+    }
+}
+
+// Sprites are drawn until the clocks available in the scanline run out. There
+// are less of them if DISPCNT allows access to OAM during H-Blank.
+static int gba_sprites_line_cycles_available(void)
+{
+    return (REG_DISPCNT & BIT(5)) ? 954 : 1210;
+}
+
+static void gba_sprites_draw_mode012(s32 ly)
+{
+    if (GBA_MemoryDirtyCheck(GBA_DIRTY_OAM, GBA_DIRTY_USER_VIDEO,
+                             0, sizeof(Mem.oam)))
+    {
+        gba_sprites_line_list_build();
+    }
+
+    int cycles = gba_sprites_line_cycles_available();
+
+    for (int n = 0; n < spr_line_count[ly]; n++)
+    {
+        int i = spr_line_list[ly][n];
+
+        cycles -= spr_cycles[i];
+        if (cycles < 0)
+            break;
+
+        int flags = spr_flags[i];
+        int mosaic = flags & SPR_FLAG_MOSAIC;
+        int mode = spr_mode[i];
+        u16 prio = spr_prio[i];
+        u16 tilebaseno = spr_tile_base[i];
+        u16 *palptr = spr_palette[i];
+        int x = spr_x[i];
+        int y = spr_y[i];
 
-            u16 shape = attr0 >> 14;
-            u16 size = attr1 >> 14;
-            int hsx = spr_size[shape][size][0] >> 1; // Half size
-            int hsy = spr_size[shape][size][1] >> 1;
+        if (flags & SPR_FLAG_AFFINE) // Affine sprite -- No H flip or V flip
+        {
+            _oam_matrix_entry_t *mat = spr_matrix[i];
 
-            int y = (attr0 & 0xFF);
-            y |= (y < 160) ? 0 : 0xFFFFFF00;
-            int x = (int)(attr1 & 0x1FF) | ((attr1 & BIT(8)) ? 0xFFFFFE00 : 0);
+            int hsx = spr_w[i] >> 1; // Half size
+            int hsy = spr_h[i] >> 1;
 
-            // Is double size?
-            int hrealsx = (attr0 & BIT(9)) ? hsx << 1 : hsx; // Half canvas size
-            int hrealsy = (attr0 & BIT(9)) ? hsy << 1 : hsy;
+            int hrealsx = spr_canvas_w[i] >> 1; // Half canvas size
+            int hrealsy = spr_canvas_h[i] >> 1;
 
             int cx = x + hrealsx; // Center of the sprite
             int cy = y + hrealsy;
 
-            if ((y <= ly) && ((y + (hrealsy << 1)) > ly)) // If in this line
+            int ydiff = ly - cy;
+            if (mosaic)
+                ydiff = ydiff - ydiff % MosSprY;
+
+            if (flags & SPR_FLAG_256) // 256 colors
             {
-                int mode = (attr0 >> 10) & 3;
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + (hrealsx << 1)) && (j < 240))
+                {
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
+                    {
+                        int xdiff = j - cx;
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
+
+                        // Get texture coordinates (relative to center)
+                        u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
+                        u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
+                        // Get texture coordinates (absolute)
+                        px += hsx;
+                        py += hsy;
+
+                        // The variables are unsigned, so this also checks
+                        // for negative numbers
+                        if ((px < (hsx << 1)) && (py < (hsy << 1)))
+                        {
+                            u32 tileadd = 0;
+                            if (REG_DISPCNT & BIT(6)) // 1D mapping
+                            {
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * (hsx * 2) / 8);
+                            }
+                            else // 2D mapping
+                            {
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * 16);
+                            }
 
-                u16 prio = (attr2 >> 10) & 3;
-                u16 tilebaseno = attr2 & 0x3FF;
-                int ydiff = ly - cy;
-                if (mosaic)
-                    ydiff = ydiff - ydiff % MosSprY;
+                            u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                    + ((tilebaseno + tileadd) * 64)]);
 
-                if (attr0 & BIT(13)) // 256 colors
-                {
-                    tilebaseno >>= 1; // In 256 mode, they need double space
+                            int _x = px & 7;
+                            int _y = py & 7;
 
-                    u16 *palptr = (u16 *)&(Mem.pal_ram[256 * 2]);
+                            u8 data = tile_ptr[_x + (_y * 8)];
 
-                    int j = (x < 0) ? 0 : x; // Search start point
-                    while (j < (x + (hrealsx << 1)) && (j < 240))
-                    {
-                        if ((sprvisible[prio][j] == 0) || (mode == 2))
-                        {
-                            int xdiff = j - cx;
-                            if (mosaic)
-                                xdiff = xdiff - xdiff % MosSprX;
-
-                            // Get texture coordinates (relative to center)
-                            u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
-                            u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
-                            // Get texture coordinates (absolute)
-                            px += hsx;
-                            py += hsy;
-
-                            // The variables are unsigned, so this also checks
-                            // for negative numbers
-                            if ((px < (hsx << 1)) && (py < (hsy << 1)))
+                            if (data)
                             {
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
+                                if (mode == 0)
                                 {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * (hsx * 2) / 8);
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
                                 }
-                                else // 2D mapping
+                                else if (mode == 1) // Transp
                                 {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * 16);
+                                    sprblend[prio][j] = 1;
+                                    sprblendfb[prio][j] = palptr[data];
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
                                 }
-
-                                u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                        + ((tilebaseno + tileadd) * 64)]);
-
-                                int _x = px & 7;
-                                int _y = py & 7;
-
-                                u8 data = tile_ptr[_x + (_y * 8)];
-
-                                if (data)
+                                else if (mode == 2) // 3 = prohibited
                                 {
-                                    if (mode == 0)
-                                    {
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 1) // Transp
-                                    {
-                                        sprblend[prio][j] = 1;
-                                        sprblendfb[prio][j] = palptr[data];
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 2) // 3 = prohibited
-                                    {
-                                        sprwin[j] = 1;
-                                    }
+                                    line_mask_set(sprwin, j);
                                 }
                             }
                         }
-                        j++;
                     }
+                    j++;
                 }
-                else // 16 colors
+            }
+            else // 16 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + (hrealsx << 1)) && (j < 240))
                 {
-                    u16 palno = attr2 >> 12;
-                    u16 *palptr = (u16 *)&Mem.pal_ram[512 + (palno * 32)];
-
-                    int j = (x < 0) ? 0 : x; // Search start point
-                    while (j < (x + (hrealsx << 1)) && (j < 240))
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
                     {
-                        if ((sprvisible[prio][j] == 0) || (mode == 2))
+                        int xdiff = j - cx;
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
+
+                        // Get texture coordinates (relative to center)
+                        u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
+                        u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
+                        // Get texture coordinates (absolute)
+                        px += hsx;
+                        py += hsy;
+
+                        // The variables are unsigned, so this also checks
+                        // for negative numbers
+                        if ((px < (hsx << 1)) && (py < (hsy << 1)))
                         {
-                            int xdiff = j - cx;
-                            if (mosaic)
-                                xdiff = xdiff - xdiff % MosSprX;
-
-                            // Get texture coordinates (relative to center)
-                            u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
-                            u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
-                            // Get texture coordinates (absolute)
-                            px += hsx;
-                            py += hsy;
-
-                            // The variables are unsigned, so this also checks
-                            // for negative numbers
-                            if ((px < (hsx << 1)) && (py < (hsy << 1)))
+                            u32 tileadd = 0;
+                            if (REG_DISPCNT & BIT(6)) // 1D mapping
                             {
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
-                                {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * (hsx * 2) / 8);
-                                }
-                                else // 2D mapping
-                                {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * 32);
-                                }
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * (hsx * 2) / 8);
+                            }
+                            else // 2D mapping
+                            {
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * 32);
+                            }
 
-                                u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                        + ((tilebaseno + tileadd) * 32)]);
+                            u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                    + ((tilebaseno + tileadd) * 32)]);
 
-                                int _x = px & 7;
-                                int _y = py & 7;
+                            int _x = px & 7;
+                            int _y = py & 7;
 
-                                u8 data = tile_ptr[(_x / 2) + (_y * 4)];
+                            u8 data = tile_ptr[(_x / 2) + (_y * 4)];
 
-                                if (_x & 1)
-                                    data = data >> 4;
-                                else
-                                    data = data & 0xF;
+                            if (_x & 1)
+                                data = data >> 4;
+                            else
+                                data = data & 0xF;
 
-                                if (data)
+                            if (data)
+                            {
+                                if (mode == 0)
                                 {
-                                    if (mode == 0)
-                                    {
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 1) // Transp
-                                    {
-                                        sprblend[prio][j] = 1;
-                                        sprblendfb[prio][j] = palptr[data];
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 2) // 3 = prohibited
-                                    {
-                                        sprwin[j] = 1;
-                                    }
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
+                                }
+                                else if (mode == 1) // Transp
+                                {
+                                    sprblend[prio][j] = 1;
+                                    sprblendfb[prio][j] = palptr[data];
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
+                                }
+                                else if (mode == 2) // 3 = prohibited
+                                {
+                                    line_mask_set(sprwin, j);
                                 }
                             }
                         }
-                        j++;
                     }
+                    j++;
                 }
             }
         }
         else // Regular sprite
         {
-            if ((attr0 & BIT(9)) == 0) // Displayed
-            {
-                int mosaic = attr0 & BIT(12);
+            int sx = spr_w[i];
+            int sy = spr_h[i];
 
-                u16 attr1 = spr->attr1;
-                u16 attr2 = spr->attr2;
+            int ydiff = ly - y;
 
-                u16 shape = attr0 >> 14;
-                u16 size = attr1 >> 14;
-                int sx = spr_size[shape][size][0];
-                int sy = spr_size[shape][size][1];
+            if (flags & SPR_FLAG_VFLIP)
+                ydiff = sy - ydiff - 1; // V flip
 
-                int y = (attr0 & 0xFF);
-                y |= (y < 160) ? 0 : 0xFFFFFF00;
-                int x = (int)(attr1 & 0x1FF)
-                        | ((attr1 & BIT(8)) ? 0xFFFFFE00 : 0);
+            if (mosaic)
+                ydiff = ydiff - ydiff % MosSprY;
 
-                if ((y <= ly) && ((y + sy) > ly)) // If in this line
+            if (flags & SPR_FLAG_256) // 256 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + sx) && (j < 240))
                 {
-                    int mode = (attr0 >> 10) & 3;
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
+                    {
+                        int xdiff = j - x;
 
-                    int ydiff = ly - y;
+                        if (flags & SPR_FLAG_HFLIP)
+                            xdiff = sx - xdiff - 1; // H flip
 
-                    if (attr1 & BIT(13))
-                        ydiff = sy - ydiff - 1; // V flip
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
 
-                    if (mosaic)
-                        ydiff = ydiff - ydiff % MosSprY;
+                        u32 tileadd = 0;
+                        if (REG_DISPCNT & BIT(6)) // 1D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * sx / 8);
+                        }
+                        else // 2D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * 16);
+                        }
 
-                    u16 prio = (attr2 >> 10) & 3;
-                    u16 tilebaseno = attr2 & 0x3FF;
+                        u32 tileindex = tilebaseno + tileadd;
+                        u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                + (tileindex * 64)]);
 
-                    if (attr0 & BIT(13)) // 256 colors
-                    {
-                        tilebaseno >>= 1; // In 256 mode, they need double space
+                        int _x = xdiff & 7;
+                        int _y = ydiff & 7;
 
-                        u16 *palptr = (u16 *)&(Mem.pal_ram[256 * 2]);
+                        u8 data = tile_ptr[_x + (_y * 8)];
 
-                        int j = (x < 0) ? 0 : x; // Search start point
-                        while (j < (x + sx) && (j < 240))
+                        if (data)
                         {
-                            if ((sprvisible[prio][j] == 0) || (mode == 2))
+                            if (mode == 0)
+                            {
+                                sprfb[prio][j] = palptr[data];
+                                line_mask_set(sprvisible[prio], j);
+                            }
+                            else if (mode == 1) // Transp
+                            {
+                                sprblend[prio][j] = 1;
+                                sprblendfb[prio][j] = palptr[data];
+                                sprfb[prio][j] = palptr[data];
+                                line_mask_set(sprvisible[prio], j);
+                            }
+                            else if (mode == 2) // 3 = prohibited
                             {
-                                int xdiff = j - x;
+                                line_mask_set(sprwin, j);
+                            }
+                        }
+                    }
+                    j++;
+                }
+            }
+            else // 16 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + sx) && (j < 240))
+                {
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
+                    {
+                        int xdiff = j - x;
 
-                                if (attr1 & BIT(12))
-                                    xdiff = sx - xdiff - 1; // H flip
+                        if (flags & SPR_FLAG_HFLIP)
+                            xdiff = sx - xdiff - 1; // H flip
 
-                                if (mosaic)
-                                    xdiff = xdiff - xdiff % MosSprX;
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
 
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
-                                {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * sx / 8);
-                                }
-                                else // 2D mapping
-                                {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * 16);
-                                }
+                        u32 tileadd = 0;
+                        if (REG_DISPCNT & BIT(6)) // 1D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * sx / 8);
+                        }
+                        else // 2D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * 32);
+                        }
 
-                                u32 tileindex = tilebaseno + tileadd;
-                                u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                        + (tileindex * 64)]);
+                        u32 tileindex = tilebaseno + tileadd;
+                        u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                + (tileindex * 32)]);
 
-                                int _x = xdiff & 7;
-                                int _y = ydiff & 7;
+                        int _x = xdiff & 7;
+                        int _y = ydiff & 7;
 
-                                u8 data = tile_ptr[_x + (_y * 8)];
+                        u8 data = tile_ptr[(_x / 2) + (_y * 4)];
 
-                                if (data)
-                                {
-                                    if (mode == 0)
-                                    {
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 1) // Transp
-                                    {
-                                        sprblend[prio][j] = 1;
-                                        sprblendfb[prio][j] = palptr[data];
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 2) // 3 = prohibited
-                                    {
-                                        sprwin[j] = 1;
-                                    }
-                                }
-                            }
-                            j++;
-                        }
-                    }
-                    else // 16 colors
-                    {
-                        u16 palno = attr2 >> 12;
-                        u16 *palptr = (u16 *)&Mem.pal_ram[512 + (palno * 32)];
+                        if (_x & 1)
+                            data = data >> 4;
+                        else
+                            data = data & 0xF;
 
-                        int j = (x < 0) ? 0 : x; // Search start point
-                        while (j < (x + sx) && (j < 240))
+                        if (data)
                         {
-                            if ((sprvisible[prio][j] == 0) || (mode == 2))
+                            if (mode == 0)
                             {
-                                int xdiff = j - x;
-
-                                if (attr1 & BIT(12))
-                                    xdiff = sx - xdiff - 1; // H flip
-
-                                if (mosaic)
-                                    xdiff = xdiff - xdiff % MosSprX;
-
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
-                                {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * sx / 8);
-                                }
-                                else // 2D mapping
-                                {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * 32);
-                                }
-
-                                u32 tileindex = tilebaseno + tileadd;
-                                u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                        + (tileindex * 32)]);
-
-                                int _x = xdiff & 7;
-                                int _y = ydiff & 7;
-
-                                u8 data = tile_ptr[(_x / 2) + (_y * 4)];
-
-                                if (_x & 1)
-                                    data = data >> 4;
-                                else
-                                    data = data & 0xF;
-
-                                if (data)
-                                {
-                                    if (mode == 0)
-                                    {
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 1) // Transp
-                                    {
-                                        sprblend[prio][j] = 1;
-                                        sprblendfb[prio][j] = palptr[data];
-                                        sprfb[prio][j] = palptr[data];
-                                        sprvisible[prio][j] = 1;
-                                    }
-                                    else if (mode == 2) // 3 = prohibited
-                                    {
-                                        sprwin[j] = 1;
-                                    }
-                                }
+                                sprfb[prio][j] = palptr[data];
+                                line_mask_set(sprvisible[prio], j);
+                            }
+                            else if (mode == 1) // Transp
+                            {
+                                sprblend[prio][j] = 1;
+                                sprblendfb[prio][j] = palptr[data];
+                                sprfb[prio][j] = palptr[data];
+                                line_mask_set(sprvisible[prio], j);
+                            }
+                            else if (mode == 2) // 3 = prohibited
+                            {
+                                line_mask_set(sprwin, j);
                             }
-                            j++;
                         }
                     }
+                    j++;
                 }
             }
         }
-        spr++;
     }
 }
 
 static void gba_sprites_draw_mode345(s32 ly)
 {
-    _oam_spr_entry_t *spr = (_oam_spr_entry_t *)Mem.oam;
-
-    for (int i = 0; i < 128; i++)
+    if (GBA_MemoryDirtyCheck(GBA_DIRTY_OAM, GBA_DIRTY_USER_VIDEO,
+                             0, sizeof(Mem.oam)))
     {
-        u16 attr0 = spr->attr0;
+        gba_sprites_line_list_build();
+    }
 
-        if (attr0 & BIT(8)) // Affine sprite -- No H flip or V flip
-        {
-            int mosaic = attr0 & BIT(12);
+    int cycles = gba_sprites_line_cycles_available();
 
-            u16 attr1 = spr->attr1;
-            u16 attr2 = spr->attr2;
+    for (int n = 0; n < spr_line_count[ly]; n++)
+    {
+        int i = spr_line_list[ly][n];
+
+        cycles -= spr_cycles[i];
+        if (cycles < 0)
+            break;
 
-            _oam_matrix_entry_t *mat =
-                    &(((_oam_matrix_entry_t *)Mem.oam)[(attr1 >> 9) & 0x1F]);
+        int flags = spr_flags[i];
+        int mosaic = flags & SPR_FLAG_MOSAIC;
+        int mode = spr_mode[i];
+        u16 prio = spr_prio[i];
+        u16 tilebaseno = spr_tile_base[i];
+        u16 *palptr = spr_palette[i];
+        int x = spr_x[i];
+        int y = spr_y[i];
 
-            u16 shape = attr0 >> 14;
-            u16 size = attr1 >> 14;
-            int hsx = spr_size[shape][size][0] >> 1; // Half size
-            int hsy = spr_size[shape][size][1] >> 1;
+        if (flags & SPR_FLAG_AFFINE) // Affine sprite -- No H flip or V flip
+        {
+            _oam_matrix_entry_t *mat = spr_matrix[i];
 
-            int y = (attr0 & 0xFF);
-            y |= (y < 160) ? 0 : 0xFFFFFF00;
-            int x = (int)(attr1 & 0x1FF) | ((attr1 & BIT(8)) ? 0xFFFFFE00 : 0);
+            int hsx = spr_w[i] >> 1; // Half size
+            int hsy = spr_h[i] >> 1;
 
-            // Is double size?
-            int hrealsx = (attr0 & BIT(9)) ? hsx << 1 : hsx; // Half canvas size
-            int hrealsy = (attr0 & BIT(9)) ? hsy << 1 : hsy;
+            int hrealsx = spr_canvas_w[i] >> 1; // Half canvas size
+            int hrealsy = spr_canvas_h[i] >> 1;
 
             int cx = x + hrealsx; // Center of the sprite
             int cy = y + hrealsy;
 
-            if ((y <= ly) && ((y + (hrealsy << 1)) > ly)) // If in this line
-            {
-                int mode = (attr0 >> 10) & 3;
-
-                u16 prio = (attr2 >> 10) & 3;
-                u16 tilebaseno = attr2 & 0x3FF;
-                int ydiff = ly - cy;
-                if (mosaic)
-                    ydiff = ydiff - ydiff % MosSprY;
+            int ydiff = ly - cy;
+            if (mosaic)
+                ydiff = ydiff - ydiff % MosSprY;
 
-                if (attr0 & BIT(13)) // 256 colors
+            if (flags & SPR_FLAG_256) // 256 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + (hrealsx << 1)) && (j < 240))
                 {
-                    tilebaseno >>= 1; // In 256 mode, they need double space
-
-                    u16 *palptr = (u16 *)&(Mem.pal_ram[256 * 2]);
-
-                    int j = (x < 0) ? 0 : x; // Search start point
-                    while (j < (x + (hrealsx << 1)) && (j < 240))
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
                     {
-                        if ((sprvisible[prio][j] == 0) || (mode == 2))
+                        int xdiff = j - cx;
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
+
+                        // Get texture coordinates (relative to center)
+                        u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
+                        u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
+                        // Get texture coordinates (absolute)
+                        px += hsx;
+                        py += hsy;
+
+                        // The variables are unsigned, so this also checks
+                        // for negative numbers
+                        if ((px < (hsx << 1)) && (py < (hsy << 1)))
                         {
-                            int xdiff = j - cx;
-                            if (mosaic)
-                                xdiff = xdiff - xdiff % MosSprX;
-
-                            // Get texture coordinates (relative to center)
-                            u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
-                            u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
-                            // Get texture coordinates (absolute)
-                            px += hsx;
-                            py += hsy;
-
-                            // The variables are unsigned, so this also checks
-                            // for negative numbers
-                            if ((px < (hsx << 1)) && (py < (hsy << 1)))
+                            u32 tileadd = 0;
+                            if (REG_DISPCNT & BIT(6)) // 1D mapping
                             {
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
-                                {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * (hsx * 2) / 8);
-                                }
-                                else // 2D mapping
-                                {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * 16);
-                                }
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * (hsx * 2) / 8);
+                            }
+                            else // 2D mapping
+                            {
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * 16);
+                            }
 
-                                // Each tile needs double space
-                                if (tilebaseno + tileadd >= 256)
-                                {
-                                    u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                            + ((tilebaseno + tileadd) * 64)]);
+                            // Each tile needs double space
+                            if (tilebaseno + tileadd >= 256)
+                            {
+                                u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                        + ((tilebaseno + tileadd) * 64)]);
 
-                                    int _x = px & 7;
-                                    int _y = py & 7;
+                                int _x = px & 7;
+                                int _y = py & 7;
 
-                                    u8 data = tile_ptr[_x + (_y * 8)];
+                                u8 data = tile_ptr[_x + (_y * 8)];
 
-                                    if (data)
+                                if (data)
+                                {
+                                    if (mode == 0)
                                     {
-                                        if (mode == 0)
-                                        {
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 1) // Transp
-                                        {
-                                            sprblend[prio][j] = 1;
-                                            sprblendfb[prio][j] = palptr[data];
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 2) // 3 = prohibited
-                                        {
-                                            sprwin[j] = 1;
-                                        }
+                                        sprfb[prio][j] = palptr[data];
+                                        line_mask_set(sprvisible[prio], j);
+                                    }
+                                    else if (mode == 1) // Transp
+                                    {
+                                        sprblend[prio][j] = 1;
+                                        sprblendfb[prio][j] = palptr[data];
+                                        sprfb[prio][j] = palptr[data];
+                                        line_mask_set(sprvisible[prio], j);
+                                    }
+                                    else if (mode == 2) // 3 = prohibited
+                                    {
+                                        line_mask_set(sprwin, j);
                                     }
                                 }
                             }
                         }
-                        j++;
                     }
+                    j++;
                 }
-                else // 16 colors
+            }
+            else // 16 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + (hrealsx << 1)) && (j < 240))
                 {
-                    u16 palno = attr2 >> 12;
-                    u16 *palptr = (u16 *)&Mem.pal_ram[512 + (palno * 32)];
-
-                    int j = (x < 0) ? 0 : x; // Search start point
-                    while (j < (x + (hrealsx << 1)) && (j < 240))
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
                     {
-                        if ((sprvisible[prio][j] == 0) || (mode == 2))
+                        int xdiff = j - cx;
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
+
+                        // Get texture coordinates (relative to center)
+                        u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
+                        u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
+                        // Get texture coordinates (absolute)
+                        px += hsx;
+                        py += hsy;
+
+                        // The variables are unsigned, so this also checks
+                        // for negative numbers
+                        if ((px < (hsx << 1)) && (py < (hsy << 1)))
                         {
-                            int xdiff = j - cx;
-                            if (mosaic)
-                                xdiff = xdiff - xdiff % MosSprX;
-
-                            // Get texture coordinates (relative to center)
-                            u32 px = (mat->pa * xdiff + mat->pb * ydiff) >> 8;
-                            u32 py = (mat->pc * xdiff + mat->pd * ydiff) >> 8;
-                            // Get texture coordinates (absolute)
-                            px += hsx;
-                            py += hsy;
-
-                            // The variables are unsigned, so this also checks
-                            // for negative numbers
-                            if ((px < (hsx << 1)) && (py < (hsy << 1)))
+                            u32 tileadd = 0;
+                            if (REG_DISPCNT & BIT(6)) // 1D mapping
                             {
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
-                                {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * (hsx * 2) / 8);
-                                }
-                                else // 2D mapping
-                                {
-                                    int tilex = px >> 3;
-                                    int tiley = py >> 3;
-                                    tileadd = tilex + (tiley * 32);
-                                }
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * (hsx * 2) / 8);
+                            }
+                            else // 2D mapping
+                            {
+                                int tilex = px >> 3;
+                                int tiley = py >> 3;
+                                tileadd = tilex + (tiley * 32);
+                            }
 
-                                if (tilebaseno + tileadd >= 512)
-                                {
-                                    u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                            + ((tilebaseno + tileadd) * 32)]);
+                            if (tilebaseno + tileadd >= 512)
+                            {
+                                u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                        + ((tilebaseno + tileadd) * 32)]);
 
-                                    int _x = px & 7;
-                                    int _y = py & 7;
+                                int _x = px & 7;
+                                int _y = py & 7;
 
-                                    u8 data = tile_ptr[(_x / 2) + (_y * 4)];
+                                u8 data = tile_ptr[(_x / 2) + (_y * 4)];
 
-                                    if (_x & 1)
-                                        data = data >> 4;
-                                    else
-                                        data = data & 0xF;
+                                if (_x & 1)
+                                    data = data >> 4;
+                                else
+                                    data = data & 0xF;
 
-                                    if (data)
+                                if (data)
+                                {
+                                    if (mode == 0)
                                     {
-                                        if (mode == 0)
-                                        {
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 1) // Transp
-                                        {
-                                            sprblend[prio][j] = 1;
-                                            sprblendfb[prio][j] = palptr[data];
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 2) // 3 = prohibited
-                                        {
-                                            sprwin[j] = 1;
-                                        }
+                                        sprfb[prio][j] = palptr[data];
+                                        line_mask_set(sprvisible[prio], j);
+                                    }
+                                    else if (mode == 1) // Transp
+                                    {
+                                        sprblend[prio][j] = 1;
+                                        sprblendfb[prio][j] = palptr[data];
+                                        sprfb[prio][j] = palptr[data];
+                                        line_mask_set(sprvisible[prio], j);
+                                    }
+                                    else if (mode == 2) // 3 = prohibited
+                                    {
+                                        line_mask_set(sprwin, j);
                                     }
                                 }
                             }
                         }
-                        j++;
                     }
+                    j++;
                 }
             }
         }
         else // Regular sprite
         {
-            if ((attr0 & BIT(9)) == 0) // Displayed
-            {
-                int mosaic = attr0 & BIT(12);
+            int sx = spr_w[i];
+            int sy = spr_h[i];
 
-                u16 attr1 = spr->attr1;
-                u16 attr2 = spr->attr2;
+            int ydiff = ly - y;
 
-                u16 shape = attr0 >> 14;
-                u16 size = attr1 >> 14;
-                int sx = spr_size[shape][size][0];
-                int sy = spr_size[shape][size][1];
+            if (flags & SPR_FLAG_VFLIP)
+                ydiff = sy - ydiff - 1; // V flip
 
-                int y = (attr0 & 0xFF);
-                y |= (y < 160) ? 0 : 0xFFFFFF00;
-                int x = (int)(attr1 & 0x1FF)
-                        | ((attr1 & BIT(8)) ? 0xFFFFFE00 : 0);
+            if (mosaic)
+                ydiff = ydiff - ydiff % MosSprY;
 
-                if ((y <= ly) && ((y + sy) > ly)) // If in this line
+            if (flags & SPR_FLAG_256) // 256 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + sx) && (j < 240))
                 {
-                    int mode = (attr0 >> 10) & 3;
-
-                    int ydiff = ly - y;
-
-                    if (attr1 & BIT(13))
-                        ydiff = sy - ydiff - 1; // V flip
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
+                    {
+                        int xdiff = j - x;
 
-                    if (mosaic)
-                        ydiff = ydiff - ydiff % MosSprY;
+                        if (flags & SPR_FLAG_HFLIP)
+                            xdiff = sx - xdiff - 1; // H flip
 
-                    u16 prio = (attr2 >> 10) & 3;
-                    u16 tilebaseno = attr2 & 0x3FF;
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
 
-                    if (attr0 & BIT(13)) // 256 colors
-                    {
-                        tilebaseno >>= 1; // in 256 mode, they need double space
+                        u32 tileadd = 0;
+                        if (REG_DISPCNT & BIT(6)) // 1D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * sx / 8);
+                        }
+                        else // 2D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * 16);
+                        }
 
-                        u16 *palptr = (u16 *)&(Mem.pal_ram[256 * 2]);
+                        u32 tileindex = tilebaseno + tileadd;
 
-                        int j = (x < 0) ? 0 : x; // Search start point
-                        while (j < (x + sx) && (j < 240))
+                        // Each tile needs double space
+                        if (tileindex >= 256)
                         {
-                            if ((sprvisible[prio][j] == 0) || (mode == 2))
-                            {
-                                int xdiff = j - x;
+                            u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                    + (tileindex * 64)]);
 
-                                if (attr1 & BIT(12))
-                                    xdiff = sx - xdiff - 1; // H flip
+                            int _x = xdiff & 7;
+                            int _y = ydiff & 7;
 
-                                if (mosaic)
-                                    xdiff = xdiff - xdiff % MosSprX;
+                            u8 data = tile_ptr[_x + (_y * 8)];
 
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
+                            if (data)
+                            {
+                                if (mode == 0)
                                 {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * sx / 8);
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
                                 }
-                                else // 2D mapping
+                                else if (mode == 1) // Transp
                                 {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * 16);
+                                    sprblend[prio][j] = 1;
+                                    sprblendfb[prio][j] = palptr[data];
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
                                 }
-
-                                u32 tileindex = tilebaseno + tileadd;
-
-                                // Each tile needs double space
-                                if (tileindex >= 256)
+                                else if (mode == 2) // 3 = prohibited
                                 {
-                                    u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                            + (tileindex * 64)]);
-
-                                    int _x = xdiff & 7;
-                                    int _y = ydiff & 7;
-
-                                    u8 data = tile_ptr[_x + (_y * 8)];
-
-                                    if (data)
-                                    {
-                                        if (mode == 0)
-                                        {
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 1) // Transp
-                                        {
-                                            sprblend[prio][j] = 1;
-                                            sprblendfb[prio][j] = palptr[data];
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 2) // 3 = prohibited
-                                        {
-                                            sprwin[j] = 1;
-                                        }
-                                    }
+                                    line_mask_set(sprwin, j);
                                 }
                             }
-                            j++;
                         }
                     }
-                    else // 16 colors
+                    j++;
+                }
+            }
+            else // 16 colors
+            {
+                int j = (x < 0) ? 0 : x; // Search start point
+                while (j < (x + sx) && (j < 240))
+                {
+                    if ((mode == 2)
+                        || (!line_mask_get(sprvisible[prio], j)))
                     {
-                        u16 palno = attr2 >> 12;
-                        u16 *palptr = (u16 *)&Mem.pal_ram[512 + (palno * 32)];
+                        int xdiff = j - x;
+
+                        if (flags & SPR_FLAG_HFLIP)
+                            xdiff = sx - xdiff - 1; // H flip
+
+                        if (mosaic)
+                            xdiff = xdiff - xdiff % MosSprX;
 
-                        int j = (x < 0) ? 0 : x; // Search start point
-                        while (j < (x + sx) && (j < 240))
+                        u32 tileadd = 0;
+                        if (REG_DISPCNT & BIT(6)) // 1D mapping
                         {
-                            if ((sprvisible[prio][j] == 0) || (mode == 2))
-                            {
-                                int xdiff = j - x;
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * sx / 8);
+                        }
+                        else // 2D mapping
+                        {
+                            int tilex = xdiff >> 3;
+                            int tiley = ydiff >> 3;
+                            tileadd = tilex + (tiley * 32);
+                        }
 
-                                if (attr1 & BIT(12))
-                                    xdiff = sx - xdiff - 1; // H flip
+                        u32 tileindex = tilebaseno + tileadd;
 
-                                if (mosaic)
-                                    xdiff = xdiff - xdiff % MosSprX;
+                        if (tileindex >= 512)
+                        {
+                            u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
+                                    + (tileindex * 32)]);
+
+                            int _x = xdiff & 7;
+                            int _y = ydiff & 7;
+
+                            u8 data = tile_ptr[(_x / 2) + (_y * 4)];
+
+                            if (_x & 1)
+                                data = data >> 4;
+                            else
+                                data = data & 0xF;
 
-                                u32 tileadd = 0;
-                                if (REG_DISPCNT & BIT(6)) // 1D mapping
+                            if (data)
+                            {
+                                if (mode == 0)
                                 {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * sx / 8);
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
                                 }
-                                else // 2D mapping
+                                else if (mode == 1) // Transp
                                 {
-                                    int tilex = xdiff >> 3;
-                                    int tiley = ydiff >> 3;
-                                    tileadd = tilex + (tiley * 32);
+                                    sprblend[prio][j] = 1;
+                                    sprblendfb[prio][j] = palptr[data];
+                                    sprfb[prio][j] = palptr[data];
+                                    line_mask_set(sprvisible[prio], j);
                                 }
-
-                                u32 tileindex = tilebaseno + tileadd;
-
-                                if (tileindex >= 512)
+                                else if (mode == 2) // 3 = prohibited
                                 {
-                                    u8 *tile_ptr = (u8 *)&(Mem.vram[0x10000
-                                            + (tileindex * 32)]);
-
-                                    int _x = xdiff & 7;
-                                    int _y = ydiff & 7;
-
-                                    u8 data = tile_ptr[(_x / 2) + (_y * 4)];
-
-                                    if (_x & 1)
-                                        data = data >> 4;
-                                    else
-                                        data = data & 0xF;
-
-                                    if (data)
-                                    {
-                                        if (mode == 0)
-                                        {
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 1) // Transp
-                                        {
-                                            sprblend[prio][j] = 1;
-                                            sprblendfb[prio][j] = palptr[data];
-                                            sprfb[prio][j] = palptr[data];
-                                            sprvisible[prio][j] = 1;
-                                        }
-                                        else if (mode == 2) // 3 = prohibited
-                                        {
-                                            sprwin[j] = 1;
-                                        }
-                                    }
+                                    line_mask_set(sprwin, j);
                                 }
                             }
-                            j++;
                         }
                     }
+                    j++;
                 }
             }
         }
-        spr++;
     }
 }
 
 //------------------------------------------------------------------------------
 
-u16 bgfb[4][240];
-int bgvisible[4][240];
-u16 backdrop[240];
-int backdropvisible[240]; // This array is filled in GBA_FillFadeTables()
+core_local__ u16 bgfb[4][240];
+core_local__ u64 bgvisible[4][LINE_MASK_WORDS];
+core_local__ u16 backdrop[240];
+core_local__ u64 backdropvisible[LINE_MASK_WORDS]; // Filled in GBA_VideoInit()
 
 static const u32 text_bg_size[4][2] = {
     { 256, 256 }, { 512, 256 }, { 256, 512 }, { 512, 512 }
@@ -929,495 +1257,323 @@ static u32 se_index(u32 tx, u32 ty, u32 pitch) // From tonc
     return sbb * 1024 + (ty % 32) * 32 + tx % 32;
 }
 
-static void gba_bg0drawtext(s32 y)
-{
-    int sx = REG_BG0HOFS;
-    int sy = REG_BG0VOFS;
-    u16 control = REG_BG0CNT;
-
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-    u16 *scrbaseblockptr = (u16 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
-
-    u32 maskx = text_bg_size[control >> 14][0] - 1;
-    u32 masky = text_bg_size[control >> 14][1] - 1;
+// Decoded rows of 4 bpp tiles. Each 4 bytes of VRAM are expanded to the 8
+// palette indices of the row they hold, in left to right order. The VRAM write
+// handlers clear the valid flag of the rows they modify.
 
-    u32 startx = sx & maskx;
-    u32 starty = (y + sy) & masky;
+core_local__ u8 gba_video_tile_row_valid[0x18000 / 4];
+static core_local__ u8 tile_row_4bpp[0x18000 / 4][8];
 
-    u32 sizex = text_bg_size[control >> 14][0] / 8;
+void GBA_VideoInvalidateAllVRAM(void)
+{
+    memset(gba_video_tile_row_valid, 0, sizeof(gba_video_tile_row_valid));
+}
 
-    int mosaic = (control & BIT(6)); // Mosaic
-    if (mosaic)
-        starty -= starty % MosBgY;
+static const u8 *gba_tile_row_4bpp_get(u32 offset)
+{
+    u32 row = offset >> 2;
+    u8 *decoded = tile_row_4bpp[row];
 
-    u16 *fb = bgfb[0];
-    int *visptr = bgvisible[0];
-    if (control & BIT(7)) // 256 colors
+    if (gba_video_tile_row_valid[row] == 0)
     {
-        for (int i = 0; i < 240; i++)
-        {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
+        const u8 *src = &Mem.vram[offset];
 
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
+        for (int i = 0; i < 4; i++)
+        {
+            decoded[(i * 2) + 0] = src[i] & 0xF;
+            decoded[(i * 2) + 1] = src[i] >> 4;
+        }
 
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
+        gba_video_tile_row_valid[row] = 1;
+    }
 
-            int data = charbaseblockptr[((SE & 0x3FF) * 64) + (_x + (_y * 8))];
+    return decoded;
+}
 
-            *fb++ = ((u16 *)Mem.pal_ram)[data];
-            *visptr++ = data;
+// Backgrounds with mosaic are drawn like the others and the mosaic is applied
+// to the line after that. The screen is split in blocks of MosBgX x MosBgY
+// pixels starting from the top left corner, and all the pixels of a block show
+// the top left pixel of the block. Vertically, the line that is drawn is the
+// first one of the block. Horizontally, the first pixel of each block is
+// repeated in the rest of it.
+static void gba_mosaic_line_apply(u16 *fb, u64 *vis, int size)
+{
+    if (size == 1)
+        return;
 
-            //startx = (startx + 1) & maskx;
-        }
-    }
-    else // 16 colors
+    for (int x = 0; x < 240; x += size)
     {
-        for (int i = 0; i < 240; i++)
-        {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
-
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            // 12-15-pal
-            u16 *palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
-
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
-
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
-
-            u32 data =
-                    charbaseblockptr[((SE & 0x3FF) * 32) + ((_x / 2) + (_y * 4))];
-
-            if (_x & 1)
-                data = data >> 4;
-            else
-                data = data & 0xF;
+        int end = (x + size < 240) ? x + size : 240;
 
-            *fb++ = palptr[data];
-            *visptr++ = data;
+        u16 color = fb[x];
+        for (int i = x + 1; i < end; i++)
+            fb[i] = color;
 
-            //startx = (startx + 1) & maskx;
-        }
+        line_mask_range(vis, x + 1, end, line_mask_get(vis, x));
     }
 }
 
-static void gba_bg1drawtext(s32 y)
+static void gba_bgdrawtext(int bg, s32 y)
 {
-    int sx = REG_BG1HOFS;
-    int sy = REG_BG1VOFS;
-    u16 control = REG_BG1CNT;
+    int sx = REG_16(BG0HOFS + (bg * 4));
+    int sy = REG_16(BG0VOFS + (bg * 4));
+    u16 control = REG_16(BG0CNT + (bg * 2));
 
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
+    line_mask_fill(bgvisible[bg], 0);
+
+    int mosaic = control & BIT(6);
+    if (mosaic)
+        y -= y % MosBgY;
+
+    u32 charbase = ((control >> 2) & 3) * (16 * 1024);
     u16 *scrbaseblockptr =
             (u16 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
 
     u32 maskx = text_bg_size[control >> 14][0] - 1;
     u32 masky = text_bg_size[control >> 14][1] - 1;
 
-    u32 startx = sx & maskx;
     u32 starty = (y + sy) & masky;
 
     u32 sizex = text_bg_size[control >> 14][0] / 8;
 
-    int mosaic = (control & BIT(6)); // Mosaic
-    if (mosaic)
-        starty -= starty % MosBgY;
+    u16 *fb = bgfb[bg];
+    u64 *vis = bgvisible[bg];
 
-    u16 *fb = bgfb[1];
-    int *visptr = bgvisible[1];
-    if (control & BIT(7)) // 256 colors
+    // Draw one tile row at a time. Only the first and last ones can be partial.
+    int i = 0;
+    while (i < 240)
     {
-        for (int i = 0; i < 240; i++)
-        {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
+        u32 startx = (sx + i) & maskx;
 
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
+        u32 index = se_index(startx / 8, starty / 8, sizex);
+        u16 SE = scrbaseblockptr[index];
+        // Screen entry data:
+        // 0-9 tile id
+        // 10-hflip
+        // 11-vflip
+        // 12-15-pal (only in 16 color mode)
 
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
+        int _y = starty & 7;
+        if (SE & BIT(11))
+            _y = 7 - _y; // V flip
 
-            int data = charbaseblockptr[((SE & 0x3FF) * 64) + (_x + (_y * 8))];
+        u32 flip = (SE & BIT(10)) ? 7 : 0; // H flip
 
-            *fb++ = ((u16 *)Mem.pal_ram)[data];
-            *visptr++ = data;
+        const u8 *row;
+        u16 *palptr;
 
-            //startx = (startx + 1) & maskx;
+        if (control & BIT(7)) // 256 colors
+        {
+            row = &Mem.vram[charbase + ((SE & 0x3FF) * 64) + (_y * 8)];
+            palptr = (u16 *)Mem.pal_ram;
         }
-    }
-    else // 16 colors
-    {
-        for (int i = 0; i < 240; i++)
+        else // 16 colors
         {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
-
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            // 12-15-pal
-            u16 *palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
-
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
-
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
-
-            u32 data =
-                    charbaseblockptr[((SE & 0x3FF) * 32) + ((_x / 2) + (_y * 4))];
-
-            if (_x & 1)
-                data = data >> 4;
-            else
-                data = data & 0xF;
+            row = gba_tile_row_4bpp_get(charbase + ((SE & 0x3FF) * 32)
+                                        + (_y * 4));
+            palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
+        }
 
-            *fb++ = palptr[data];
-            *visptr++ = data;
+        int x = startx & 7;
+        int count = 8 - x;
+        if (count > (240 - i))
+            count = 240 - i;
+
+        for (int j = 0; j < count; j++)
+        {
+            u32 data = row[(x + j) ^ flip];
 
-            //startx = (startx + 1) & maskx;
+            fb[i + j] = palptr[data];
+            line_mask_set_if(vis, i + j, data);
         }
+
+        i += count;
     }
+
+    if (mosaic)
+        gba_mosaic_line_apply(fb, vis, MosBgX);
 }
 
-static void gba_bg2drawtext(s32 y)
-{
-    int sx = REG_BG2HOFS;
-    int sy = REG_BG2VOFS;
-    u16 control = REG_BG2CNT;
+//------------------------------------------------------------------------------
 
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-    u16 *scrbaseblockptr =
-            (u16 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
+static u32 se_index_affine(u32 tx, u32 ty, u32 tpitch)
+{
+    return (ty * tpitch) + tx;
+}
 
-    u32 maskx = text_bg_size[control >> 14][0] - 1;
-    u32 masky = text_bg_size[control >> 14][1] - 1;
+static const u32 affine_bg_size[4] = {
+    128, 256, 512, 1024
+};
 
-    u32 startx = sx & maskx;
-    u32 starty = (y + sy) & masky;
+// Draws one line of an affine background starting at (currx, curry) and moving
+// (A, C) per pixel. There are loops specialised for wraparound and clipping,
+// and for lines where C is 0 (like in most scaled backgrounds), as the row of
+// the map doesn't change.
+static void gba_bgdrawaffine(int bg, u16 control, s32 currx, s32 curry,
+                             s32 A, s32 C)
+{
+    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
+    u8 *scrbaseblockptr = (u8 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
 
-    u32 sizex = text_bg_size[control >> 14][0] / 8;
+    u32 size = affine_bg_size[control >> 14];
+    u32 sizemask = size - 1;
+    u32 tilesize = size / 8;
 
-    int mosaic = (control & BIT(6)); // Mosaic
-    if (mosaic)
-        starty -= starty % MosBgY;
+    int wrap = control & BIT(13);
 
-    u16 *fb = bgfb[2];
-    int *visptr = bgvisible[2];
-    if (control & BIT(7)) // 256 colors
+    u16 *pal = (u16 *)Mem.pal_ram;
+    u16 *fb = bgfb[bg];
+    u64 *vis = bgvisible[bg];
+    line_mask_fill(vis, 0);
+
+    if (C == 0) // The row of the map is the same for the whole line
     {
-        for (int i = 0; i < 240; i++)
+        u32 _y = (curry >> 8);
+
+        if (wrap)
+            _y &= sizemask;
+
+        if (_y >= size) // Outside of the map
         {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
-
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            int _x = startx & 7;
-            if (mosaic)
-                _x = (startx - startx % MosBgX) & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
+            for (int i = 0; i < 240; i++)
+                fb[i] = pal[0];
+            return;
+        }
 
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
+        u8 *scrrowptr = &scrbaseblockptr[(_y / 8) * tilesize];
+        u8 *charrowptr = &charbaseblockptr[(_y & 7) * 8];
 
-            int data = charbaseblockptr[((SE & 0x3FF) * 64) + (_x + (_y * 8))];
+        if (wrap)
+        {
+            for (int i = 0; i < 240; i++)
+            {
+                u32 _x = (currx >> 8) & sizemask;
+                u8 SE = scrrowptr[_x / 8];
+                u8 data = charrowptr[(SE * 64) + (_x & 7)];
 
-            *fb++ = ((u16 *)Mem.pal_ram)[data];
-            *visptr++ = data;
+                fb[i] = pal[data];
+                line_mask_set_if(vis, i, data);
 
-            //startx = (startx + 1) & maskx;
+                currx += A;
+            }
         }
-    }
-    else // 16 colors
-    {
-        for (int i = 0; i < 240; i++)
+        else
         {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
-
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            // 12-15-pal
-            u16 *palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
-
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
-
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
-
-            u32 data =
-                    charbaseblockptr[((SE & 0x3FF) * 32) + ((_x / 2) + (_y * 4))];
-
-            if (_x & 1)
-                data = data >> 4;
-            else
-                data = data & 0xF;
+            for (int i = 0; i < 240; i++)
+            {
+                u32 _x = (currx >> 8);
+                u8 data = 0;
+                if (_x < size)
+                {
+                    u8 SE = scrrowptr[_x / 8];
+                    data = charrowptr[(SE * 64) + (_x & 7)];
+                }
 
-            *fb++ = palptr[data];
-            *visptr++ = data;
+                fb[i] = pal[data];
+                line_mask_set_if(vis, i, data);
 
-            //startx = (startx + 1) & maskx;
+                currx += A;
+            }
         }
+        return;
     }
-}
-
-static void gba_bg3drawtext(s32 y)
-{
-    int sx = REG_BG3HOFS;
-    int sy = REG_BG3VOFS;
-    u16 control = REG_BG3CNT;
 
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-    u16 *scrbaseblockptr =
-            (u16 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
-
-    u32 maskx = text_bg_size[control >> 14][0] - 1;
-    u32 masky = text_bg_size[control >> 14][1] - 1;
-
-    u32 startx = sx & maskx;
-    u32 starty = (y + sy) & masky;
-
-    u32 sizex = text_bg_size[control >> 14][0] / 8;
-
-    int mosaic = (control & BIT(6)); // Mosaic
-    if (mosaic)
-        starty -= starty % MosBgY;
-
-    u16 *fb = bgfb[3];
-    int *visptr = bgvisible[3];
-    if (control & BIT(7)) // 256 colors
+    if (wrap)
     {
         for (int i = 0; i < 240; i++)
         {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
-
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
-
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
+            u32 _x = (currx >> 8) & sizemask;
+            u32 _y = (curry >> 8) & sizemask;
 
-            int data = charbaseblockptr[((SE & 0x3FF) * 64) + (_x + (_y * 8))];
+            u32 index = se_index_affine(_x / 8, _y / 8, tilesize);
+            u8 SE = scrbaseblockptr[index];
+            u8 data = charbaseblockptr[(SE * 64) + ((_x & 7) + ((_y & 7) * 8))];
 
-            *fb++ = ((u16 *)Mem.pal_ram)[data];
-            *visptr++ = data;
+            fb[i] = pal[data];
+            line_mask_set_if(vis, i, data);
 
-            //startx = (startx + 1) & maskx;
+            currx += A;
+            curry += C;
         }
     }
-    else // 16 colors
+    else
     {
         for (int i = 0; i < 240; i++)
         {
-            startx = (sx + i) & maskx;
-            if (mosaic)
-                startx -= startx % MosBgX;
-
-            u32 index = se_index(startx / 8, starty / 8, sizex);
-            u16 SE = scrbaseblockptr[index];
-            // Screen entry data:
-            // 0-9 tile id
-            // 10-hflip
-            // 11-vflip
-            // 12-15-pal
-            u16 *palptr = (u16 *)&Mem.pal_ram[(SE >> 12) * (2 * 16)];
-
-            int _x = startx & 7;
-            if (SE & BIT(10))
-                _x = 7 - _x; // H flip
-
-            int _y = starty & 7;
-            if (SE & BIT(11))
-                _y = 7 - _y; // V flip
-
-            u32 data =
-                    charbaseblockptr[((SE & 0x3FF) * 32) + ((_x / 2) + (_y * 4))];
-
-            if (_x & 1)
-                data = data >> 4;
-            else
-                data = data & 0xF;
+            u32 _x = (currx >> 8);
+            u32 _y = (curry >> 8);
+
+            // The size is a power of 2 and the coordinates are unsigned, so
+            // this checks both of them at the same time, including negative
+            // values.
+            u8 data = 0;
+            if ((_x | _y) < size)
+            {
+                u32 index = se_index_affine(_x / 8, _y / 8, tilesize);
+                u8 SE = scrbaseblockptr[index];
+                data = charbaseblockptr[(SE * 64)
+                                        + ((_x & 7) + ((_y & 7) * 8))];
+            }
 
-            *fb++ = palptr[data];
-            *visptr++ = data;
+            fb[i] = pal[data];
+            line_mask_set_if(vis, i, data);
 
-            //startx = (startx + 1) & maskx;
+            currx += A;
+            curry += C;
         }
     }
 }
 
-//------------------------------------------------------------------------------
-
-static u32 se_index_affine(u32 tx, u32 ty, u32 tpitch)
+// Gets the start point of BG2 in this line and how much it moves per pixel.
+// With mosaic, the values of the first line of the mosaic block are used in
+// the whole block. Returns 1 if mosaic is enabled.
+static int gba_bg2_line_start_get(s32 y, s32 *currx, s32 *curry,
+                                  s32 *A, s32 *C)
 {
-    return (ty * tpitch) + tx;
-}
-
-static const u32 affine_bg_size[4] = {
-    128, 256, 512, 1024
-};
-
-static s32 mosBG2lastx, mosBG2lasty, mos2A, mos2C;
-
-static void gba_bg2drawaffine(s32 y)
-{
-    u16 control = REG_BG2CNT;
-
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-    u8 *scrbaseblockptr = (u8 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
-
-    u32 size = affine_bg_size[control >> 14];
-    u32 sizemask = size - 1;
-    u32 tilesize = size / 8;
-
-    s32 currx = BG2lastx;
-    s32 curry = BG2lasty;
-
     // | PA PB |
     // | PC PD |
 
-    s32 A = (s32)(s16)REG_BG2PA;
-    s32 C = (s32)(s16)REG_BG2PC;
-
-    u16 *fb = bgfb[2];
-    int *visptr = bgvisible[2];
+    *currx = BG2lastx;
+    *curry = BG2lasty;
+    *A = (s32)(s16)REG_BG2PA;
+    *C = (s32)(s16)REG_BG2PC;
 
-    int mosaic = (control & BIT(6)); // Mosaic
+    if ((REG_BG2CNT & BIT(6)) == 0) // Mosaic
+        return 0;
 
-    if (mosaic)
+    if (y % MosBgY == 0)
     {
-        if (y % MosBgY == 0)
-        {
-            mosBG2lastx = BG2lastx;
-            mosBG2lasty = BG2lasty;
-            mos2A = A;
-            mos2C = C;
-        }
-        else
-        {
-            currx = mosBG2lastx;
-            curry = mosBG2lasty;
-            A = mos2A;
-            C = mos2C;
-        }
+        mosBG2lastx = *currx;
+        mosBG2lasty = *curry;
+        mos2A = *A;
+        mos2C = *C;
     }
-
-    u8 data = 0;
-    for (int i = 0; i < 240; i++) // Always 256 colors
+    else
     {
-        u32 _x = (currx >> 8);
-        u32 _y = (curry >> 8);
-
-        if (!mosaic || ((i % MosBgX) == 0))
-        {
-            data = 0;
-            if (control & BIT(13)) // Wrap
-            {
-                _x &= sizemask;
-                _y &= sizemask;
+        *currx = mosBG2lastx;
+        *curry = mosBG2lasty;
+        *A = mos2A;
+        *C = mos2C;
+    }
 
-                int __x = _x & 7;
-                int __y = _y & 7;
+    return 1;
+}
 
-                u32 index = se_index_affine(_x / 8, _y / 8, tilesize);
-                u8 SE = scrbaseblockptr[index];
-                data = charbaseblockptr[(SE * 64) + (__x + (__y * 8))];
-            }
-            else if ((_x < size) && (_y < size))
-            {
-                int __x = _x & 7;
-                int __y = _y & 7;
+static void gba_bg2drawaffine(s32 y)
+{
+    s32 currx, curry, A, C;
+    int mosaic = gba_bg2_line_start_get(y, &currx, &curry, &A, &C);
 
-                u32 index = se_index_affine(_x / 8, _y / 8, tilesize);
-                u8 SE = scrbaseblockptr[index];
-                data = charbaseblockptr[(SE * 64) + (__x + (__y * 8))];
-            }
-        }
-        *fb++ = ((u16 *)Mem.pal_ram)[data];
-        *visptr++ = data;
+    gba_bgdrawaffine(2, REG_BG2CNT, currx, curry, A, C);
 
-        currx += A;
-        curry += C;
-    }
+    if (mosaic)
+        gba_mosaic_line_apply(bgfb[2], bgvisible[2], MosBgX);
 }
 
-static s32 mosBG3lastx, mosBG3lasty, mos3A, mos3C;
-
 static void gba_bg3drawaffine(s32 y)
 {
     u16 control = REG_BG3CNT;
 
-    u8 *charbaseblockptr = (u8 *)&Mem.vram[((control >> 2) & 3) * (16 * 1024)];
-    u8 *scrbaseblockptr = (u8 *)&Mem.vram[((control >> 8) & 0x1F) * (2 * 1024)];
-
-    u32 size = affine_bg_size[control >> 14];
-    u32 sizemask = size - 1;
-    u32 tilesize = size / 8;
-
     s32 currx = BG3lastx;
     s32 curry = BG3lasty;
 
@@ -1427,9 +1583,6 @@ static void gba_bg3drawaffine(s32 y)
     s32 A = (s32)(s16)REG_BG3PA;
     s32 C = (s32)(s16)REG_BG3PC;
 
-    u16 *fb = bgfb[3];
-    int *visptr = bgvisible[3];
-
     int mosaic = (control & BIT(6)); // Mosaic
 
     if (mosaic)
@@ -1450,63 +1603,59 @@ static void gba_bg3drawaffine(s32 y)
         }
     }
 
-    u8 data = 0;
-    for (int i = 0; i < 240; i++) // Always 256 colors
-    {
-        u32 _x = (currx >> 8);
-        u32 _y = (curry >> 8);
+    gba_bgdrawaffine(3, control, currx, curry, A, C);
 
-        if (!mosaic || ((i % MosBgX) == 0))
-        {
-            data = 0;
-            if (control & BIT(13)) // Wrap
-            {
-                _x &= sizemask;
-                _y &= sizemask;
+    if (mosaic)
+        gba_mosaic_line_apply(bgfb[3], bgvisible[3], MosBgX);
+}
 
-                int __x = _x & 7;
-                int __y = _y & 7;
+//------------------------------------------------------------------------------
 
-                u32 index = se_index_affine(_x / 8, _y / 8, tilesize);
-                u8 SE = scrbaseblockptr[index];
-                data = charbaseblockptr[(SE * 64) + (__x + (__y * 8))];
-            }
-            else if ((_x < size) && (_y < size))
-            {
-                int __x = _x & 7;
-                int __y = _y & 7;
+// Returns 1 if BG2 isn't rotated or scaled in this scanline, and the row of the
+// bitmap that is shown is inside it. In that case the scanline shows the pixels
+// of that row starting from column x0, one by one. The range of pixels of the
+// scanline that show the bitmap is returned in [start, end).
+static int gba_bg2_bitmap_identity(s32 currx, s32 curry, s32 A, s32 C,
+                                   int width, int height,
+                                   s32 *row, s32 *x0, int *start, int *end)
+{
+    if ((A != 0x100) || (C != 0))
+        return 0;
 
-                u32 index = se_index_affine(_x / 8, _y / 8, tilesize);
-                u8 SE = scrbaseblockptr[index];
-                data = charbaseblockptr[(SE * 64) + (__x + (__y * 8))];
-            }
-        }
+    s32 _y = curry >> 8;
+    if ((_y < 0) || (_y >= height))
+        return 0;
 
-        *fb++ = ((u16 *)Mem.pal_ram)[data];
-        *visptr++ = data;
+    s32 _x = currx >> 8;
 
-        currx += A;
-        curry += C;
-    }
-}
+    *row = _y;
+    *x0 = _x;
 
-//------------------------------------------------------------------------------
+    *start = (_x < 0) ? ((-_x < 240) ? -_x : 240) : 0;
+    *end = (width - _x < 240) ? width - _x : 240;
+    if (*end < *start)
+        *end = *start;
 
-static void gba_bg2drawbitmapmode3(unused__ s32 y)
-{
-    s32 currx = BG2lastx;
-    s32 curry = BG2lasty;
+    return 1;
+}
 
+static void gba_bg2drawbitmapmode3(s32 currx, s32 curry, s32 A, s32 C)
+{
     u16 *srcptr = (u16 *)&Mem.vram;
 
-    // | PA PB |
-    // | PC PD |
-
-    s32 A = (s32)(s16)REG_BG2PA;
-    s32 C = (s32)(s16)REG_BG2PC;
+    s32 row, x0;
+    int start, end;
+    if (gba_bg2_bitmap_identity(currx, curry, A, C, 240, 160,
+                                &row, &x0, &start, &end))
+    {
+        memcpy(&bgfb[2][start], &srcptr[x0 + start + 240 * row],
+               (end - start) * sizeof(u16));
+        line_mask_range(bgvisible[2], start, end, 1);
+        return;
+    }
 
     u16 *fb = bgfb[2];
-    int *visptr = bgvisible[2];
+    u64 *vis = bgvisible[2];
 
     for (int i = 0; i < 240; i++)
     {
@@ -1515,30 +1664,34 @@ static void gba_bg2drawbitmapmode3(unused__ s32 y)
         if (!((_x > 239) || (_y > 159)))
         {
             *fb = srcptr[_x + 240 * _y];
-            *visptr = 1;
+            line_mask_set(vis, i);
         }
         fb++;
-        visptr++;
         currx += A;
         curry += C;
     }
 }
 
-static void gba_bg2drawbitmapmode4(unused__ s32 y)
+static void gba_bg2drawbitmapmode4(s32 currx, s32 curry, s32 A, s32 C)
 {
-    s32 currx = BG2lastx;
-    s32 curry = BG2lasty;
-
     u8 *srcptr = (u8 *)&Mem.vram[(REG_DISPCNT & BIT(4)) ? 0xA000 : 0];
 
-    // | PA PB |
-    // | PC PD |
+    s32 row, x0;
+    int start, end;
+    if (gba_bg2_bitmap_identity(currx, curry, A, C, 240, 160,
+                                &row, &x0, &start, &end))
+    {
+        const u16 *pal = (const u16 *)Mem.pal_ram;
+        const u8 *src = &srcptr[x0 + 240 * row];
 
-    s32 A = (s32)(s16)REG_BG2PA;
-    s32 C = (s32)(s16)REG_BG2PC;
+        for (int i = start; i < end; i++)
+            bgfb[2][i] = pal[src[i]];
+        line_mask_range(bgvisible[2], start, end, 1);
+        return;
+    }
 
     u16 *fb = bgfb[2];
-    int *visptr = bgvisible[2];
+    u64 *vis = bgvisible[2];
 
     for (int i = 0; i < 240; i++)
     {
@@ -1547,30 +1700,31 @@ static void gba_bg2drawbitmapmode4(unused__ s32 y)
         if (!((_x > 239) || (_y > 159)))
         {
             *fb = ((u16 *)Mem.pal_ram)[srcptr[_x + 240 * _y]];
-            *visptr = 1;
+            line_mask_set(vis, i);
         }
         fb++;
-        visptr++;
         currx += A;
         curry += C;
     }
 }
 
-static void gba_bg2drawbitmapmode5(unused__ s32 y)
+static void gba_bg2drawbitmapmode5(s32 currx, s32 curry, s32 A, s32 C)
 {
-    s32 currx = BG2lastx;
-    s32 curry = BG2lasty;
-
     u16 *srcptr = (u16 *)&Mem.vram[((REG_DISPCNT & BIT(4)) ? 0xA000 : 0)];
 
-    // | PA PB |
-    // | PC PD |
-
-    s32 A = (s32)(s16)REG_BG2PA;
-    s32 C = (s32)(s16)REG_BG2PC;
+    s32 row, x0;
+    int start, end;
+    if (gba_bg2_bitmap_identity(currx, curry, A, C, 160, 128,
+                                &row, &x0, &start, &end))
+    {
+        memcpy(&bgfb[2][start], &srcptr[x0 + start + 160 * row],
+               (end - start) * sizeof(u16));
+        line_mask_range(bgvisible[2], start, end, 1);
+        return;
+    }
 
     u16 *fb = bgfb[2];
-    int *visptr = bgvisible[2];
+    u64 *vis = bgvisible[2];
 
     for (int i = 0; i < 240; i++)
     {
@@ -1579,15 +1733,29 @@ static void gba_bg2drawbitmapmode5(unused__ s32 y)
         if (!((_x > 159) || (_y > 127)))
         {
             *fb = (u16)srcptr[_x + 160 * _y];
-            *visptr = 1;
+            line_mask_set(vis, i);
         }
         fb++;
-        visptr++;
         currx += A;
         curry += C;
     }
 }
 
+// Draws one line of BG2 in modes 3-5 starting at (currx, curry) and moving
+// (A, C) per pixel
+typedef void (*gba_bg2_bitmap_line_fn)(s32 currx, s32 curry, s32 A, s32 C);
+
+static void gba_bg2drawbitmap(s32 y, gba_bg2_bitmap_line_fn draw_line)
+{
+    s32 currx, curry, A, C;
+    int mosaic = gba_bg2_line_start_get(y, &currx, &curry, &A, &C);
+
+    draw_line(currx, curry, A, C);
+
+    if (mosaic)
+        gba_mosaic_line_apply(bgfb[2], bgvisible[2], MosBgX);
+}
+
 //------------------------------------------------------------------------------
 
 static void gba_video_all_buffers_clear(void)
@@ -1620,10 +1788,10 @@ typedef enum
 } _layer_type_;
 
 // layer_fb[0] goes at the bottom, layer_fb[layer_active_num - 1] at the top
-static int *layer_vis[9];
-static u16 *layer_fb[9];
-static _layer_type_ layer_id[9];
-static int layer_active_num;
+static core_local__ u64 *layer_vis[9];
+static core_local__ u16 *layer_fb[9];
+static core_local__ _layer_type_ layer_id[9];
+static core_local__ int layer_active_num;
 
 static void gba_sort_layers(int video_mode)
 {
@@ -1718,658 +1886,280 @@ static void gba_sort_layers(int video_mode)
         cur_layer++;
     }
 
-    // Priority 0
-
-    for (int i = 3; i >= 0; i--)
-    {
-        if (bgprio[i] == 0)
-        {
-            bgprio[i] = -1;
-            layer_vis[cur_layer] = bgvisible[i];
-            layer_fb[cur_layer] = bgfb[i];
-            layer_id[cur_layer] = BG0 + i;
-            cur_layer++;
-        }
-    }
-
-    if (spren)
-    {
-        layer_vis[cur_layer] = sprvisible[0];
-        layer_fb[cur_layer] = sprfb[0];
-        layer_id[cur_layer] = SPR0;
-        cur_layer++;
-    }
-
-    // End
-
-    layer_active_num = cur_layer; // Total number of active layers
-}
-
-static void gba_blit_layers(int y)
-{
-    u16 *destptr = (u16 *)&screen_buffer[240 * y];
-
-    for (int i = 0; i < layer_active_num; i++)
-    {
-        u16 *dest = destptr;
-
-        int *vis = layer_vis[i];
-        u16 *fb = layer_fb[i];
-
-        for (int j = 0; j < 240; j++)
-        {
-            if (*vis++)
-                *dest = *fb;
-            dest++;
-            fb++;
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-
-// Color effect is enabled / disabled by windows
-int win_coloreffect_enable[240];
-
-// bits 13-15 of DISPCNT
-static void gba_window_apply(int y, int win0, int win1, int winobj)
-{
-    if (!(winobj || win1 || win0))
-    {
-        if ((REG_BLDCNT >> 6) & 3) // Special effect
-        {
-            for (int i = 0; i < 240; i++)
-                win_coloreffect_enable[i] = 1;
-        }
-        return;
-    }
-
-    u32 in0 = REG_WININ & 0xFF;
-    u32 in1 = (REG_WININ >> 8) & 0xFF;
-    u32 out = REG_WINOUT & 0xFF;
-    u32 inobj = (REG_WINOUT >> 8) & 0xFF;
-
-    int win_show[240];
-
-    if (REG_DISPCNT & BIT(8))
-    {
-        if (out & BIT(0))
-        {
-            for (int i = 0; i < 240; i++)
-                win_show[i] = 1;
-        }
-        else
-        {
-            memset(win_show, 0, sizeof(win_show));
-        }
-
-        if (winobj) // obj has lowest priority
-        {
-            int *show = win_show;
-            int *ptrsprwin = sprwin;
-            if (inobj & BIT(0))
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 1;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-            else
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 0;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-        }
-        if (win1) // Intermediate priority
-        {
-            if (in1 & BIT(0))
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-        if (win0) // Highest priority
-        {
-            if (in0 & BIT(0))
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-
-        int *vis = bgvisible[0];
-        int *show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-    }
-
-    if (REG_DISPCNT & BIT(9))
-    {
-        if (out & BIT(1))
-        {
-            for (int i = 0; i < 240; i++)
-                win_show[i] = 1;
-        }
-        else
-        {
-            memset(win_show, 0, sizeof(win_show));
-        }
-        if (winobj) // obj has lowest priority
-        {
-            int *show = win_show;
-            int *ptrsprwin = sprwin;
-            if (inobj & BIT(1))
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 1;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-            else
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 0;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-        }
-        if (win1) // Intermediate priority
-        {
-            if (in1 & BIT(1))
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-        if (win0) // Highest priority
-        {
-            if (in0 & BIT(1))
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-
-        int *vis = bgvisible[1];
-        int *show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-    }
-
-    if (REG_DISPCNT & BIT(10))
-    {
-        if (out & BIT(2))
-        {
-            for (int i = 0; i < 240; i++)
-                win_show[i] = 1;
-        }
-        else
-        {
-            memset(win_show, 0, sizeof(win_show));
-        }
-        if (winobj) // obj has lowest priority
-        {
-            int *show = win_show;
-            int *ptrsprwin = sprwin;
-            if (inobj & BIT(2))
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 1;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-            else
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 0;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-        }
-        if (win1) // intermediate priority
-        {
-            if (in1 & BIT(2))
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-        if (win0) // Highest priority
-        {
-            if (in0 & BIT(2))
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-
-        int *vis = bgvisible[2];
-        int *show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-    }
-
-    if (REG_DISPCNT & BIT(11))
-    {
-        if (out & BIT(3))
-        {
-            for (int i = 0; i < 240; i++)
-                win_show[i] = 1;
-        }
-        else
-        {
-            memset(win_show, 0, sizeof(win_show));
-        }
-        if (winobj) // obj has lowest priority
-        {
-            int *show = win_show;
-            int *ptrsprwin = sprwin;
-            if (inobj & BIT(3))
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 1;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-            else
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 0;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-        }
-        if (win1) // Intermediate priority
-        {
-            if (in1 & BIT(3))
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-        if (win0) // Highest priority
-        {
-            if (in0 & BIT(3))
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-
-        int *vis = bgvisible[3];
-        int *show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-    }
-
-    if (REG_DISPCNT & BIT(12)) // Sprites
-    {
-        if (out & BIT(4))
-        {
-            for (int i = 0; i < 240; i++)
-                win_show[i] = 1;
-        }
-        else
-        {
-            memset(win_show, 0, sizeof(win_show));
-        }
-        if (winobj) // obj has lowest priority
-        {
-            int *show = win_show;
-            int *ptrsprwin = sprwin;
-            if (inobj & BIT(4))
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 1;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-            else
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 0;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-        }
-        if (win1) // Intermediate priority
-        {
-            if (in1 & BIT(4))
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-        if (win0) // Highest priority
-        {
-            if (in0 & BIT(4))
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 0;
-                }
-            }
-        }
-
-        int *vis = sprvisible[0];
-        int *show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-        vis = sprvisible[1];
-        show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-        vis = sprvisible[2];
-        show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-        vis = sprvisible[3];
-        show = win_show;
-        for (int i = 0; i < 240; i++)
-        {
-            *vis = *vis && *show;
-            vis++;
-            show++;
-        }
-    }
-
-    if ((REG_BLDCNT >> 6) & 3) // Special effect
+    // Priority 0
+
+    for (int i = 3; i >= 0; i--)
     {
-        if (out & BIT(5))
-        {
-            for (int i = 0; i < 240; i++)
-                win_show[i] = 1;
-        }
-        else
-        {
-            memset(win_show, 0, sizeof(win_show));
-        }
-        if (winobj) // obj has lowest priority
-        {
-            int *show = win_show;
-            int *ptrsprwin = sprwin;
-            if (inobj & BIT(5))
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 1;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-            else
-            {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (*ptrsprwin)
-                        *show = 0;
-                    show++;
-                    ptrsprwin++;
-                }
-            }
-        }
-        if (win1) // Intermediate priority
+        if (bgprio[i] == 0)
         {
-            if (in1 & BIT(5))
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 1;
-                }
-            }
-            else
-            {
-                if (y >= Win1Y1 && y <= Win1Y2)
-                {
-                    for (int i = Win1X1; i < Win1X2; i++)
-                        win_show[i] = 0;
-                }
-            }
+            bgprio[i] = -1;
+            layer_vis[cur_layer] = bgvisible[i];
+            layer_fb[cur_layer] = bgfb[i];
+            layer_id[cur_layer] = BG0 + i;
+            cur_layer++;
         }
-        if (win0) // Highest priority
+    }
+
+    if (spren)
+    {
+        layer_vis[cur_layer] = sprvisible[0];
+        layer_fb[cur_layer] = sprfb[0];
+        layer_id[cur_layer] = SPR0;
+        cur_layer++;
+    }
+
+    // End
+
+    layer_active_num = cur_layer; // Total number of active layers
+}
+
+static void gba_blit_layers(int y)
+{
+    u16 *destptr = (u16 *)&screen_buffer[240 * y];
+
+    for (int i = 0; i < layer_active_num; i++)
+    {
+        const u64 *vis = layer_vis[i];
+        const u16 *fb = layer_fb[i];
+
+        for (int w = 0; w < LINE_MASK_WORDS; w++)
         {
-            if (in0 & BIT(5))
+            u64 bits = vis[w];
+
+            if (bits == 0)
+                continue;
+
+            int x = w * 64;
+
+            if (bits == ~(u64)0)
             {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 1;
-                }
+                memcpy(&destptr[x], &fb[x], 64 * sizeof(u16));
+                continue;
             }
-            else
+
+            while (bits)
             {
-                if (y >= Win0Y1 && y <= Win0Y2)
-                {
-                    for (int i = Win0X1; i < Win0X2; i++)
-                        win_show[i] = 0;
-                }
+                if (bits & 1)
+                    destptr[x] = fb[x];
+                bits >>= 1;
+                x++;
             }
         }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Color effect is enabled / disabled by windows
+core_local__ u64 win_coloreffect_enable[LINE_MASK_WORDS];
+
+// The scanline is split in the regions of each window (WIN0, WIN1, OBJ window
+// and outside of all windows). Each pixel belongs to only one of them, the one
+// with the highest priority that contains it.
+typedef enum
+{
+    WIN_REGION_0 = 0,
+    WIN_REGION_1,
+    WIN_REGION_OBJ,
+    WIN_REGION_OUT,
+
+    WIN_REGION_NUM
+} _win_region_e;
+
+static void gba_window_regions_build(u64 regions[][LINE_MASK_WORDS], int y,
+                                     int win0, int win1, int winobj)
+{
+    u64 *r0 = regions[WIN_REGION_0];
+    u64 *r1 = regions[WIN_REGION_1];
+    u64 *robj = regions[WIN_REGION_OBJ];
+    u64 *rout = regions[WIN_REGION_OUT];
+
+    line_mask_fill(r0, 0);
+    if (win0 && (y >= Win0Y1) && (y <= Win0Y2))
+        line_mask_range(r0, Win0X1, Win0X2, 1);
+
+    line_mask_fill(r1, 0);
+    if (win1 && (y >= Win1Y1) && (y <= Win1Y2))
+    {
+        line_mask_range(r1, Win1X1, Win1X2, 1);
+        line_mask_and_not(r1, r0);
+    }
 
-        memcpy(win_coloreffect_enable, win_show,
-               sizeof(win_coloreffect_enable));
+    line_mask_fill(robj, 0);
+    if (winobj)
+    {
+        line_mask_or(robj, sprwin);
+        line_mask_and_not(robj, r0);
+        line_mask_and_not(robj, r1);
     }
+
+    line_mask_fill(rout, 1);
+    line_mask_and_not(rout, r0);
+    line_mask_and_not(rout, r1);
+    line_mask_and_not(rout, robj);
 }
 
-static u16 white_table[32][17]; // color, evy
-static u16 black_table[32][17]; // color, evy
+// Fills a mask with the pixels of the scanline in which the layer selected by
+// "bit" (bit 0-5 of WININ and WINOUT) is shown.
+static void gba_window_mask_build(u64 *show, u64 regions[][LINE_MASK_WORDS],
+                                  u32 bit)
+{
+    const u32 enable[WIN_REGION_NUM] = {
+        REG_WININ & 0xFF,           // WIN_REGION_0
+        (REG_WININ >> 8) & 0xFF,    // WIN_REGION_1
+        (REG_WINOUT >> 8) & 0xFF,   // WIN_REGION_OBJ
+        REG_WINOUT & 0xFF           // WIN_REGION_OUT
+    };
+
+    line_mask_fill(show, 0);
+
+    for (int r = 0; r < WIN_REGION_NUM; r++)
+    {
+        if (enable[r] & bit)
+            line_mask_or(show, regions[r]);
+    }
+}
 
-void GBA_FillFadeTables(void)
+// bits 13-15 of DISPCNT
+static void gba_window_apply(int y, int win0, int win1, int winobj)
 {
-    for (int i = 0; i < 32; i++)
+    if (!(winobj || win1 || win0))
     {
-        for (int y = 0; y < 17; y++)
+        if ((REG_BLDCNT >> 6) & 3) // Special effect
+            line_mask_fill(win_coloreffect_enable, 1);
+        return;
+    }
+
+    u64 regions[WIN_REGION_NUM][LINE_MASK_WORDS];
+    gba_window_regions_build(regions, y, win0, win1, winobj);
+
+    u64 win_show[LINE_MASK_WORDS];
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (REG_DISPCNT & BIT(8 + i))
         {
-            white_table[i][y] = i + (((31 - i) * y) >> 4);
-            black_table[i][y] = i - ((i * y) >> 4);
+            gba_window_mask_build(win_show, regions, BIT(i));
+            line_mask_and(bgvisible[i], win_show);
         }
     }
 
-    // Fill array: Backdrop is always visible
-    for (int i = 0; i < 240; i++)
+    if (REG_DISPCNT & BIT(12)) // Sprites
+    {
+        gba_window_mask_build(win_show, regions, BIT(4));
+        for (int i = 0; i < 4; i++)
+            line_mask_and(sprvisible[i], win_show);
+    }
+
+    if ((REG_BLDCNT >> 6) & 3) // Special effect
+        gba_window_mask_build(win_coloreffect_enable, regions, BIT(5));
+}
+
+// Screen colors converted to 32-bit RGB (with alpha set to 255) for all the
+// possible 15-bit colors. The 24-bit conversion uses the lower 3 bytes.
+static core_local__ u32 rgb555_to_32rgb[0x8000];
+
+static void gba_screen_conversion_table_fill(void)
+{
+    for (u32 data = 0; data < 0x8000; data++)
+    {
+        rgb555_to_32rgb[data] = ((data & 0x1F) << 3)
+                                | ((data & (0x1F << 5)) << 6)
+                                | ((data & (0x1F << 10)) << 9)
+                                | (0xFF << 24);
+    }
+}
+
+void GBA_VideoInit(void)
+{
+    screen_buffer = screen_buffer_array[curr_screen_buffer];
+
+    gba_scanline_cache_invalidate();
+    GBA_VideoInvalidateAllVRAM();
+    gba_screen_conversion_table_fill();
+
+    screen_buffer_changed[0] = 1;
+    screen_buffer_changed[1] = 1;
+    gba_screen_hash_update_all();
+
+    // Backdrop is always visible
+    line_mask_fill(backdropvisible, 1);
+    line_mask_fill(win_coloreffect_enable, 1);
+}
+
+// The color effects are applied to each one of the three components of a pixel
+// separately, and each component has only 32 possible values. The results for
+// the current coefficients are kept in tables, which are only rebuilt when the
+// coefficients change.
+
+static core_local__ u8 blend_table[32][32]; // [1st target][2nd target]
+static core_local__ u32 blend_table_coefs = 0xFFFFFFFF; // eva | (evb << 8)
+
+static core_local__ u8 fade_white_table[32];
+static core_local__ u32 fade_white_table_evy = 0xFFFFFFFF;
+
+static core_local__ u8 fade_black_table[32];
+static core_local__ u32 fade_black_table_evy = 0xFFFFFFFF;
+
+static void blend_table_update(u32 eva, u32 evb)
+{
+    u32 coefs = eva | (evb << 8);
+    if (blend_table_coefs == coefs)
+        return;
+
+    blend_table_coefs = coefs;
+
+    for (int c1 = 0; c1 < 32; c1++)
     {
-        backdropvisible[i] = 1;
-        win_coloreffect_enable[i] = 1;
+        for (int c2 = 0; c2 < 32; c2++)
+        {
+            u32 c = ((c1 * eva) >> 4) + ((c2 * evb) >> 4);
+            blend_table[c1][c2] = (c > 31) ? 31 : c;
+        }
     }
 }
 
-static u16 fade_white(u16 col, u16 evy)
+static void fade_white_table_update(u32 evy)
+{
+    if (fade_white_table_evy == evy)
+        return;
+
+    fade_white_table_evy = evy;
+
+    for (int c = 0; c < 32; c++)
+        fade_white_table[c] = c + (((31 - c) * evy) >> 4);
+}
+
+static void fade_black_table_update(u32 evy)
 {
-    return (white_table[(col >> 10) & 0x1F][evy] << 10)
-           | (white_table[(col >> 5) & 0x1F][evy] << 5)
-           | white_table[col & 0x1F][evy];
+    if (fade_black_table_evy == evy)
+        return;
+
+    fade_black_table_evy = evy;
+
+    for (int c = 0; c < 32; c++)
+        fade_black_table[c] = c - ((c * evy) >> 4);
 }
-static u16 fade_black(u16 col, u16 evy)
+
+static inline u16 fade_white(u16 col)
 {
-    return (black_table[(col >> 10) & 0x1F][evy] << 10)
-           | (black_table[(col >> 5) & 0x1F][evy] << 5)
-           | black_table[col & 0x1F][evy];
+    return fade_white_table[col & 0x1F]
+           | (fade_white_table[(col >> 5) & 0x1F] << 5)
+           | (fade_white_table[(col >> 10) & 0x1F] << 10);
 }
 
-static u16 min(u16 a, u16 b)
+static inline u16 fade_black(u16 col)
 {
-    return (a < b) ? a : b;
+    return fade_black_table[col & 0x1F]
+           | (fade_black_table[(col >> 5) & 0x1F] << 5)
+           | (fade_black_table[(col >> 10) & 0x1F] << 10);
 }
 
-static u16 blend(u16 col_1, u16 col_2, u16 eva, u16 evb)
+static inline u16 blend(u16 col_1, u16 col_2)
 {
-    u16 r = min(31, (((col_1 & 0x1F) * eva) >> 4)
-                            + (((col_2 & 0x1F) * evb) >> 4));
-    u16 g = min(31, ((((col_1 >> 5) & 0x1F) * eva) >> 4)
-                            + ((((col_2 >> 5) & 0x1F) * evb) >> 4));
-    u16 b = min(31, ((((col_1 >> 10) & 0x1F) * eva) >> 4)
-                            + ((((col_2 >> 10) & 0x1F) * evb) >> 4));
-    return (b << 10) | (g << 5) | r;
+    return blend_table[col_1 & 0x1F][col_2 & 0x1F]
+           | (blend_table[(col_1 >> 5) & 0x1F][(col_2 >> 5) & 0x1F] << 5)
+           | (blend_table[(col_1 >> 10) & 0x1F][(col_2 >> 10) & 0x1F] << 10);
 }
 
 static void gba_effects_apply(void)
@@ -2394,21 +2184,18 @@ static void gba_effects_apply(void)
     // special effects. Ie. alpha blending and semi-transparency can be used for
     // OBJ-to-BG or BG-to-OBJ , but not for OBJ-to-OBJ.
 
-    for (int l = 0; l < 3; l++)
+    // This clears sprite layer pixels that have another layer with higher
+    // priority
+    u64 spr_above[LINE_MASK_WORDS] = { 0 };
+    for (int l = 1; l < 4; l++)
     {
-        // This clears sprite layer pixels that have another layer with higher
-        // priority
+        line_mask_or(spr_above, sprvisible[l - 1]);
+        line_mask_and_not(sprvisible[l], spr_above);
+
         for (int i = 0; i < 240; i++)
         {
-            if (sprvisible[l][i])
-            {
-                int k = l + 1;
-                for (; k < 4; k++)
-                {
-                    sprvisible[k][i] = 0;
-                    sprblend[k][i] = 0;
-                }
-            }
+            if (line_mask_get(spr_above, i))
+                sprblend[l][i] = 0;
         }
     }
 
@@ -2424,7 +2211,7 @@ static void gba_effects_apply(void)
             int i = 0;
             while (i < 240)
             {
-                if (win_coloreffect_enable[i])
+                if (line_mask_get(win_coloreffect_enable, i))
                 {
                     if (sprblend[0][i] | sprblend[1][i] | sprblend[2][i]
                         | sprblend[3][i])
@@ -2507,30 +2294,27 @@ static void gba_effects_apply(void)
     if (evb > 16)
         evb = 16;
 
+    blend_table_update(eva, evb);
+
     if (mode == 1)
     {
         // Disable blending for transparent sprites when a 1st-target visible
         // pixel of any layer has higher priority
-        int already_first_target[240];
-        mem_clear_32((void *)already_first_target,
-                     sizeof(already_first_target));
+        u64 already_first_target[LINE_MASK_WORDS];
+        line_mask_fill(already_first_target, 0);
 
         for (int l = (layer_active_num - 1); l >= 0; l--)
         {
             if (!((layer_id[l] >= SPR0) && (layer_id[l] <= SPR3)))
             {
-                for (int i = 0; i < 240; i++)
-                {
-                    if (layer_vis[l][i])
-                        already_first_target[i] = 1;
-                }
+                line_mask_or(already_first_target, layer_vis[l]);
             }
             else
             {
                 int sprite_layer = layer_id[l] - SPR0;
                 for (int i = 0; i < 240; i++)
                 {
-                    if (already_first_target[i])
+                    if (line_mask_get(already_first_target, i))
                         sprblend[sprite_layer][i] = 0;
                 }
             }
@@ -2554,13 +2338,13 @@ static void gba_effects_apply(void)
                     int k = l - 1;
                     for (; k >= 0; k--)
                     {
-                        if (layer_vis[k][i])
+                        if (line_mask_get(layer_vis[k], i))
                         {
                             if (layer_is_second_target[k])
                             {
                                 sprfb[sprlayer][i] = blend(
                                         sprblendfb[sprlayer][i],
-                                        layer_fb[k][i], eva, evb);
+                                        layer_fb[k][i]);
                             }
                             else
                             {
@@ -2586,13 +2370,13 @@ static void gba_effects_apply(void)
             {
                 for (int i = 0; i < 240; i++)
                 {
-                    if (win_coloreffect_enable[i])
+                    if (line_mask_get(win_coloreffect_enable, i))
                     {
                         // Search a non-transparent second target pixel
                         int k = l - 1;
                         for (; k >= 0; k--)
                         {
-                            if (layer_vis[k][i])
+                            if (line_mask_get(layer_vis[k], i))
                             {
                                 // Blending is only applied if the two layers
                                 // are together, not if anything in between
@@ -2606,14 +2390,13 @@ static void gba_effects_apply(void)
                                         {
                                             sprfb[sprlayer][i] = blend(
                                                     sprfb[sprlayer][i],
-                                                    layer_fb[k][i], eva, evb);
+                                                    layer_fb[k][i]);
                                         }
                                     }
                                     else
                                     {
                                         layer_fb[l][i] = blend(layer_fb[l][i],
-                                                               layer_fb[k][i],
-                                                               eva, evb);
+                                                               layer_fb[k][i]);
                                     }
                                 }
                                 break;
@@ -2630,6 +2413,8 @@ static void gba_effects_apply(void)
         if (evy > 16)
             evy = 16;
 
+        fade_white_table_update(evy);
+
         for (int l = layer_active_num - 1; l >= 0; l--)
         {
             if (layer_is_first_target[l])
@@ -2640,11 +2425,11 @@ static void gba_effects_apply(void)
 
                     for (int i = 0; i < 240; i++)
                     {
-                        if (win_coloreffect_enable[i])
+                        if (line_mask_get(win_coloreffect_enable, i))
                         {
                             if (sprblend[sprlayer][i] == 0)
                             {
-                                layer_fb[l][i] = fade_white(layer_fb[l][i], evy);
+                                layer_fb[l][i] = fade_white(layer_fb[l][i]);
                             }
                         }
                     }
@@ -2653,9 +2438,9 @@ static void gba_effects_apply(void)
                 {
                     for (int i = 0; i < 240; i++)
                     {
-                        if (win_coloreffect_enable[i])
+                        if (line_mask_get(win_coloreffect_enable, i))
                         {
-                            layer_fb[l][i] = fade_white(layer_fb[l][i], evy);
+                            layer_fb[l][i] = fade_white(layer_fb[l][i]);
                         }
                     }
                 }
@@ -2668,6 +2453,8 @@ static void gba_effects_apply(void)
         if (evy > 16)
             evy = 16;
 
+        fade_black_table_update(evy);
+
         for (int l = layer_active_num - 1; l >= 0; l--)
         {
             if (layer_is_first_target[l])
@@ -2678,11 +2465,11 @@ static void gba_effects_apply(void)
 
                     for (int i = 0; i < 240; i++)
                     {
-                        if (win_coloreffect_enable[i])
+                        if (line_mask_get(win_coloreffect_enable, i))
                         {
                             if (sprblend[sprlayer][i] == 0)
                             {
-                                layer_fb[l][i] = fade_black(layer_fb[l][i], evy);
+                                layer_fb[l][i] = fade_black(layer_fb[l][i]);
                             }
                         }
                     }
@@ -2691,9 +2478,9 @@ static void gba_effects_apply(void)
                 {
                     for (int i = 0; i < 240; i++)
                     {
-                        if (win_coloreffect_enable[i])
+                        if (line_mask_get(win_coloreffect_enable, i))
                         {
-                            layer_fb[l][i] = fade_black(layer_fb[l][i], evy);
+                            layer_fb[l][i] = fade_black(layer_fb[l][i]);
                         }
                     }
                 }
@@ -2721,6 +2508,65 @@ static void gba_greenswap_apply(int y)
 
 //------------------------------------------------------------------------------
 
+// Features of a scanline that need the complete mixer
+#define GBA_LINE_WINDOWS        BIT(0)
+#define GBA_LINE_EFFECTS        BIT(1)
+#define GBA_LINE_SPR_BLEND      BIT(2) // Semi-transparent sprites to blend
+
+static int gba_scanline_features(s32 y)
+{
+    int features = 0;
+
+    if (REG_DISPCNT & (BIT(13) | BIT(14) | BIT(15)))
+        features |= GBA_LINE_WINDOWS;
+
+    if ((REG_BLDCNT >> 6) & 3)
+    {
+        features |= GBA_LINE_EFFECTS;
+    }
+    else if ((REG_BLDCNT & 0x3F00) && (REG_DISPCNT & BIT(12)))
+    {
+        // Semi-transparent sprites are blended even without a color effect,
+        // as long as there is a 2nd target. The list has been updated when
+        // drawing the sprites of this line.
+        for (int n = 0; n < spr_line_count[y]; n++)
+        {
+            if (spr_mode[spr_line_list[y][n]] == 1)
+            {
+                features |= GBA_LINE_SPR_BLEND;
+                break;
+            }
+        }
+    }
+
+    return features;
+}
+
+// Combines the layers drawn in the buffers and writes the result to the screen.
+// Most scanlines of most games don't use windows or effects. In that case the
+// layers just have to be drawn in priority order, so the window and effect
+// passes are skipped.
+static void gba_scanline_mix(int video_mode, s32 y)
+{
+    if (gba_scanline_features(y) == 0)
+    {
+        gba_sort_layers(video_mode);
+        gba_blit_layers(y);
+        gba_greenswap_apply(y);
+        return;
+    }
+
+    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
+                     REG_DISPCNT & BIT(15));
+
+    gba_sort_layers(video_mode);
+    gba_effects_apply();
+    gba_blit_layers(y);
+    gba_greenswap_apply(y);
+}
+
+//------------------------------------------------------------------------------
+
 static void GBA_DrawScanlineMode0(s32 y)
 {
     if (GBA_HasToSkipFrame())
@@ -2733,24 +2579,18 @@ static void GBA_DrawScanlineMode0(s32 y)
     for (int i = 0; i < 240; i++)
         backdrop[i] = bd_col;
     if (REG_DISPCNT & BIT(8))
-        gba_bg0drawtext(y);
+        gba_bgdrawtext(0, y);
     if (REG_DISPCNT & BIT(9))
-        gba_bg1drawtext(y);
+        gba_bgdrawtext(1, y);
     if (REG_DISPCNT & BIT(10))
-        gba_bg2drawtext(y);
+        gba_bgdrawtext(2, y);
     if (REG_DISPCNT & BIT(11))
-        gba_bg3drawtext(y);
+        gba_bgdrawtext(3, y);
     if (REG_DISPCNT & BIT(12))
         gba_sprites_draw_mode012(y);
 
-    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
-                     REG_DISPCNT & BIT(15));
-
     // Mix
-    gba_sort_layers(0);
-    gba_effects_apply();
-    gba_blit_layers(y);
-    gba_greenswap_apply(y);
+    gba_scanline_mix(0, y);
 }
 
 static void GBA_DrawScanlineMode1(s32 y)
@@ -2765,21 +2605,16 @@ static void GBA_DrawScanlineMode1(s32 y)
     for (int i = 0; i < 240; i++)
         backdrop[i] = bd_col;
     if (REG_DISPCNT & BIT(8))
-        gba_bg0drawtext(y);
+        gba_bgdrawtext(0, y);
     if (REG_DISPCNT & BIT(9))
-        gba_bg1drawtext(y);
+        gba_bgdrawtext(1, y);
     if (REG_DISPCNT & BIT(10))
         gba_bg2drawaffine(y);
     if (REG_DISPCNT & BIT(12))
         gba_sprites_draw_mode012(y);
-    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
-                     REG_DISPCNT & BIT(15));
 
     // Mix
-    gba_sort_layers(1);
-    gba_effects_apply();
-    gba_blit_layers(y);
-    gba_greenswap_apply(y);
+    gba_scanline_mix(1, y);
 }
 
 static void GBA_DrawScanlineMode2(s32 y)
@@ -2799,14 +2634,47 @@ static void GBA_DrawScanlineMode2(s32 y)
         gba_bg3drawaffine(y);
     if (REG_DISPCNT & BIT(12))
         gba_sprites_draw_mode012(y);
-    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
-                     REG_DISPCNT & BIT(15));
 
     // Mix
-    gba_sort_layers(2);
-    gba_effects_apply();
-    gba_blit_layers(y);
+    gba_scanline_mix(2, y);
+}
+
+// In modes 3-5 the only background is BG2. When there are no sprites, windows
+// or color effects, the scanline is just the bitmap over the backdrop, and it
+// can be written to the screen without going through the layer mixer. Returns
+// 1 if the scanline has been drawn.
+static int gba_bitmap_scanline_direct(s32 y,
+                                      gba_bg2_bitmap_line_fn draw_line)
+{
+    if (REG_DISPCNT & (BIT(12) | BIT(13) | BIT(14) | BIT(15)))
+        return 0;
+
+    if ((REG_BLDCNT >> 6) & 3)
+        return 0;
+
+    u16 *destptr = (u16 *)&screen_buffer[240 * y];
+    u16 bd_col = *((u16 *)Mem.pal_ram);
+
+    if (REG_DISPCNT & BIT(10)) // BG2 enabled
+    {
+        const u16 *fb = bgfb[2];
+        const u64 *vis = bgvisible[2];
+
+        line_mask_fill(bgvisible[2], 0);
+        gba_bg2drawbitmap(y, draw_line);
+
+        for (int i = 0; i < 240; i++)
+            destptr[i] = line_mask_get(vis, i) ? fb[i] : bd_col;
+    }
+    else
+    {
+        for (int i = 0; i < 240; i++)
+            destptr[i] = bd_col;
+    }
+
     gba_greenswap_apply(y);
+
+    return 1;
 }
 
 static void GBA_DrawScanlineMode3(s32 y)
@@ -2814,6 +2682,9 @@ static void GBA_DrawScanlineMode3(s32 y)
     if (GBA_HasToSkipFrame())
         return;
 
+    if (gba_bitmap_scanline_direct(y, gba_bg2drawbitmapmode3))
+        return;
+
     gba_video_all_buffers_clear();
 
     // Draw layers
@@ -2823,15 +2694,10 @@ static void GBA_DrawScanlineMode3(s32 y)
     if (REG_DISPCNT & BIT(12))
         gba_sprites_draw_mode345(y);
     if (REG_DISPCNT & BIT(10)) // BG2 enabled
-        gba_bg2drawbitmapmode3(y);
-    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
-                     REG_DISPCNT & BIT(15));
+        gba_bg2drawbitmap(y, gba_bg2drawbitmapmode3);
 
     // Mix
-    gba_sort_layers(3);
-    gba_effects_apply();
-    gba_blit_layers(y);
-    gba_greenswap_apply(y);
+    gba_scanline_mix(3, y);
 }
 
 static void GBA_DrawScanlineMode4(s32 y)
@@ -2839,6 +2705,9 @@ static void GBA_DrawScanlineMode4(s32 y)
     if (GBA_HasToSkipFrame())
         return;
 
+    if (gba_bitmap_scanline_direct(y, gba_bg2drawbitmapmode4))
+        return;
+
     gba_video_all_buffers_clear();
 
     // Draw layers
@@ -2848,15 +2717,10 @@ static void GBA_DrawScanlineMode4(s32 y)
     if (REG_DISPCNT & BIT(12))
         gba_sprites_draw_mode345(y);
     if (REG_DISPCNT & BIT(10)) // BG2 enabled
-        gba_bg2drawbitmapmode4(y);
-    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
-                     REG_DISPCNT & BIT(15));
+        gba_bg2drawbitmap(y, gba_bg2drawbitmapmode4);
 
     // Mix
-    gba_sort_layers(4);
-    gba_effects_apply();
-    gba_blit_layers(y);
-    gba_greenswap_apply(y);
+    gba_scanline_mix(4, y);
 }
 
 static void GBA_DrawScanlineMode5(s32 y)
@@ -2864,6 +2728,9 @@ static void GBA_DrawScanlineMode5(s32 y)
     if (GBA_HasToSkipFrame())
         return;
 
+    if (gba_bitmap_scanline_direct(y, gba_bg2drawbitmapmode5))
+        return;
+
     gba_video_all_buffers_clear();
 
     // Draw layers
@@ -2873,15 +2740,10 @@ static void GBA_DrawScanlineMode5(s32 y)
     if (REG_DISPCNT & BIT(12))
         gba_sprites_draw_mode345(y);
     if (REG_DISPCNT & BIT(10)) // BG2 enabled
-        gba_bg2drawbitmapmode5(y);
-    gba_window_apply(y, REG_DISPCNT & BIT(13), REG_DISPCNT & BIT(14),
-                     REG_DISPCNT & BIT(15));
+        gba_bg2drawbitmap(y, gba_bg2drawbitmapmode5);
 
     // Mix
-    gba_sort_layers(5);
-    gba_effects_apply();
-    gba_blit_layers(y);
-    gba_greenswap_apply(y);
+    gba_scanline_mix(5, y);
 }
 
 //------------------------------------------------------------------------------
@@ -2978,13 +2840,22 @@ void GBA_ConvertScreenBufferTo32RGB(void *dst)
 {
     u16 *src = screen_buffer_array[curr_screen_buffer ^ 1];
     u32 *dest = (u32 *)dst;
+
+    for (int i = 0; i < 240 * 160; i++)
+        *dest++ = rgb555_to_32rgb[*src++ & 0x7FFF];
+}
+
+void GBA_ConvertScreenBufferTo32ARGB(void *dst)
+{
+    u16 *src = screen_buffer_array[curr_screen_buffer ^ 1];
+    u32 *dest = (u32 *)dst;
+
+    // Swap the red and blue components of the entries of the table
     for (int i = 0; i < 240 * 160; i++)
     {
-        u32 data = (u32)*src++;
-        *dest++ = ((data & 0x1F) << 3)
-                  | ((data & (0x1F << 5)) << 6)
-                  | ((data & (0x1F << 10)) << 9)
-                  | (0xFF << 24);
+        u32 data = rgb555_to_32rgb[*src++ & 0x7FFF];
+        *dest++ = (data & 0xFF00FF00) | ((data & 0xFF) << 16)
+                  | ((data >> 16) & 0xFF);
     }
 }
 
@@ -2995,9 +2866,73 @@ void GBA_ConvertScreenBufferTo24RGB(void *dst)
 
     for (int i = 0; i < 240 * 160; i++)
     {
-        u32 data = (u32)*src++;
-        *dest++ = (data & 0x1F) << 3;
-        *dest++ = (data & (0x1F << 5)) >> 2;
-        *dest++ = (data & (0x1F << 10)) >> 7;
+        u32 data = rgb555_to_32rgb[*src++ & 0x7FFF];
+        *dest++ = data & 0xFF;
+        *dest++ = (data >> 8) & 0xFF;
+        *dest++ = (data >> 16) & 0xFF;
     }
 }
+
+//------------------------------------------------------------------------------
+
+// The screen buffers are saved too so that the last frame can be displayed
+// right after loading a state.
+void GBA_VideoStateSave(_savestate_t *st)
+{
+    _gba_scanline_state_t state;
+    gba_scanline_state_get(&state);
+
+    SaveState_ChunkBegin(st, "VID ");
+    SaveState_Write(st, state.bg_last, sizeof(state.bg_last));
+    SaveState_Write(st, state.mos_bg_last, sizeof(state.mos_bg_last));
+    SaveState_Write(st, state.mos, sizeof(state.mos));
+    SaveState_Write(st, state.win, sizeof(state.win));
+    SaveState_Write(st, &curr_screen_buffer, sizeof(curr_screen_buffer));
+    SaveState_Write(st, screen_buffer_array, sizeof(screen_buffer_array));
+    SaveState_ChunkEnd(st);
+}
+
+void GBA_VideoStateLoad(_savestate_t *st)
+{
+    _gba_scanline_state_t state;
+
+    SaveState_ChunkOpen(st, "VID ");
+    SaveState_Read(st, state.bg_last, sizeof(state.bg_last));
+    SaveState_Read(st, state.mos_bg_last, sizeof(state.mos_bg_last));
+    SaveState_Read(st, state.mos, sizeof(state.mos));
+    SaveState_Read(st, state.win, sizeof(state.win));
+    SaveState_Read(st, &curr_screen_buffer, sizeof(curr_screen_buffer));
+    SaveState_Read(st, screen_buffer_array, sizeof(screen_buffer_array));
+    SaveState_ChunkClose(st);
+
+    BG2lastx = state.bg_last[0];
+    BG2lasty = state.bg_last[1];
+    BG3lastx = state.bg_last[2];
+    BG3lasty = state.bg_last[3];
+
+    gba_scanline_mosaic_set(state.mos_bg_last);
+
+    MosSprX = state.mos[0];
+    MosSprY = state.mos[1];
+    MosBgX = state.mos[2];
+    MosBgY = state.mos[3];
+
+    Win0X1 = state.win[0];
+    Win0X2 = state.win[1];
+    Win0Y1 = state.win[2];
+    Win0Y2 = state.win[3];
+    Win1X1 = state.win[4];
+    Win1X2 = state.win[5];
+    Win1Y1 = state.win[6];
+    Win1Y2 = state.win[7];
+
+    curr_screen_buffer &= 1;
+    screen_buffer = screen_buffer_array[curr_screen_buffer];
+    screen_buffer_changed[0] = 1;
+    screen_buffer_changed[1] = 1;
+    gba_screen_hash_update_all();
+
+    gba_scanline_cache_invalidate();
+    GBA_VideoInvalidateAllVRAM();
+    GBA_UpdateDrawScanlineFn();
+}
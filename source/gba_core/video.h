@@ -12,8 +12,35 @@
 void GBA_SkipFrame(int skip);
 int GBA_HasToSkipFrame(void);
 
-// Must be called to fill the look up tables used for blending effects.
-void GBA_FillFadeTables(void);
+// Returns 1 if the screen buffer returned by the conversion functions isn't the
+// same as the one of the previous frame that was drawn. If not, the frontend
+// can keep the result of the last conversion.
+int GBA_ScreenBufferHasChanged(void);
+// Returns the hash of the screen buffer returned by the conversion functions.
+// It's the CRC32C of the CRC32C of each scanline, which are calculated as they
+// are drawn, so it can be used to compare frames without reading them.
+u32 GBA_ScreenBufferGetHash(void);
+
+// Must be called when the GBA is reset.
+void GBA_VideoInit(void);
+
+// The memory has to be loaded before calling GBA_VideoStateLoad()
+void GBA_VideoStateSave(_savestate_t *st);
+void GBA_VideoStateLoad(_savestate_t *st);
+
+// Incremented when the contents of palette, VRAM or OAM change.
+extern core_local__ u32 gba_video_memory_version;
+
+// The text backgrounds keep a cache of decoded tile rows. The VRAM write
+// handlers must invalidate the rows they modify.
+extern core_local__ u8 gba_video_tile_row_valid[0x18000 / 4];
+
+static inline void GBA_VideoInvalidateVRAM(u32 offset)
+{
+    gba_video_tile_row_valid[offset >> 2] = 0;
+}
+
+void GBA_VideoInvalidateAllVRAM(void);
 
 // Note: The correct way of emulating is drawing a pixel every 4 clocks. This is
 // an optimization that makes pretty much all games show as expected.
@@ -28,5 +55,7 @@ void GBA_DrawScanlineWhite(s32 y);
 void GBA_ConvertScreenBufferTo24RGB(void *dst);
 // 32-bit RGB (with alpha set to 255 in all pixels)
 void GBA_ConvertScreenBufferTo32RGB(void *dst);
+// 32-bit ARGB8888, 0xAARRGGBB in native endianness (alpha set to 255)
+void GBA_ConvertScreenBufferTo32ARGB(void *dst);
 
 #endif // GBA_VIDEO__
@@ -4,11 +4,21 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#ifdef __linux__
+# define _GNU_SOURCE // sched_setaffinity()
+#endif
+
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+# include <windows.h>
+#elif defined __linux__
+# include <sched.h>
+#endif
+
 #include "general_utils.h"
 
 void s_strncpy(char *dest, const char *src, int _size)
@@ -25,10 +35,49 @@ void s_strncat(char *dest, const char *src, int _size)
 
 //------------------------------------------------------------------------------
 
+static core_local__ u32 core_rand_seed = 1;
+
+int core_rand(void)
+{
+    core_rand_seed = core_rand_seed * 1103515245 + 12345;
+    return (core_rand_seed >> 16) & 0x7FFF;
+}
+
+void core_srand(unsigned int seed)
+{
+    core_rand_seed = seed;
+}
+
 void memset_rand(u8 *start, u32 _size)
 {
     while (_size--)
-        *start++ = rand();
+        *start++ = core_rand();
+}
+
+//------------------------------------------------------------------------------
+
+int ThreadPinToCPU(int cpu)
+{
+    if (cpu < 0)
+        return 1;
+
+#ifdef _WIN32
+    if (cpu >= (int)(sizeof(DWORD_PTR) * 8))
+        return 1;
+
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) == 0;
+#elif defined __linux__
+    if (cpu >= CPU_SETSIZE)
+        return 1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return sched_setaffinity(0, sizeof(set), &set) != 0;
+#else
+    return 1;
+#endif
 }
 
 //----------------------------------------------------------------------------------
@@ -53,6 +102,40 @@ u64 asciihex_to_int(const char *text)
     }
 }
 
+int cheat_code_digits(const char *code, char *digits, int size)
+{
+    int count = 0;
+
+    for ( ; *code != '\0'; code++)
+    {
+        char c = *code;
+
+        if ((c == ' ') || (c == '-') || (c == ':'))
+            continue;
+
+        if (isxdigit((unsigned char)c) == 0)
+            return -1;
+
+        if (count >= (size - 1))
+            return -1;
+
+        digits[count++] = c;
+    }
+
+    digits[count] = '\0';
+
+    return count;
+}
+
+u32 cheat_code_hex(const char *digits, int count)
+{
+    char text[9];
+
+    s_strncpy(text, digits, count + 1);
+
+    return asciihex_to_int(text);
+}
+
 u64 asciidec_to_int(const char *text)
 {
     long int value = 0, i = 0;
@@ -76,45 +159,30 @@ void ScaleImage24RGB(int zoom, char *srcbuf, int srcw, int srch, char *dstbuf,
     int dest_x_offset = (dstw - (srcw * zoom)) / 2;
     int dest_y_offset = (dsth - (srch * zoom)) / 2;
 
-    int dest_x_end = dest_x_offset + srcw * zoom;
-    int dest_y_end = dest_y_offset + srch * zoom;
-
-    int srcx = 0;
-    int srcy = 0;
-
-    int srcx_inc_count = 0;
-    int srcy_inc_count = 0;
-
-    //int destx = dest_x_offset;
-    int desty = dest_y_offset;
+    size_t dest_line_size = srcw * zoom * 3;
 
-    for (; desty < dest_y_end; desty++)
+    for (int srcy = 0; srcy < srch; srcy++)
     {
-        srcx = 0;
-        int destx = dest_x_offset;
-        char *dstline = &(dstbuf[(desty * dstw + destx) * 3]);
-        char *srcline = &(srcbuf[(srcy * srcw + srcx) * 3]);
+        int desty = dest_y_offset + srcy * zoom;
+        char *dstline = &(dstbuf[(desty * dstw + dest_x_offset) * 3]);
+        char *srcline = &(srcbuf[srcy * srcw * 3]);
 
-        for (; destx < dest_x_end; destx++)
+        // Scale the row once...
+        char *dst = dstline;
+        for (int srcx = 0; srcx < srcw; srcx++)
         {
-            *dstline++ = *(srcline + 0);
-            *dstline++ = *(srcline + 1);
-            *dstline++ = *(srcline + 2);
-
-            srcx_inc_count++;
-            if (srcx_inc_count == zoom)
+            for (int i = 0; i < zoom; i++)
             {
-                srcline += 3;
-                srcx_inc_count = 0;
-                srcx++;
+                *dst++ = srcline[0];
+                *dst++ = srcline[1];
+                *dst++ = srcline[2];
             }
-        }
 
-        srcy_inc_count++;
-        if (srcy_inc_count == zoom)
-        {
-            srcy_inc_count = 0;
-            srcy++;
+            srcline += 3;
         }
+
+        // ...and copy it to the other rows that come from the same source row
+        for (int i = 1; i < zoom; i++)
+            memcpy(dstline + i * dstw * 3, dstline, dest_line_size);
     }
 }
@@ -20,19 +20,50 @@ typedef signed char s8;
 
 #define unused__ __attribute__((unused))
 
+// Storage of the state of the emulated consoles. If ENABLE_THREAD_LOCAL_CORES
+// is defined each thread has its own copy of all of it, so several consoles can
+// run at the same time in different threads of the same process. The state of
+// a console can only be used from the thread that runs it.
+#if defined(ENABLE_THREAD_LOCAL_CORES) && defined(__cplusplus)
+#define core_local__ thread_local
+#elif defined(ENABLE_THREAD_LOCAL_CORES)
+#define core_local__ _Thread_local
+#else
+#define core_local__
+#endif
+
 // Safe versions of strncpy and strncat that set a terminating character if
 // needed.
 void s_strncpy(char *dest, const char *src, int _size);
 void s_strncat(char *dest, const char *src, int _size);
 
+// Replacement of rand() for the cores. It gives the same sequence in all
+// platforms and, with ENABLE_THREAD_LOCAL_CORES, each thread has its own one,
+// so the result of a console doesn't depend on the ones running next to it.
+int core_rand(void);
+// The sequence starts with a seed of 1, like the one of rand()
+void core_srand(unsigned int seed);
+
 void memset_rand(u8 *start, u32 _size);
 
+// Makes the calling thread run only in the specified CPU, so that it isn't
+// moved between CPUs and it keeps its caches. Returns 0 on success, 1 if it
+// isn't supported in this platform or the CPU number isn't valid.
+int ThreadPinToCPU(int cpu);
+
 // Converts an hexadecimal number in an ASCII string into integer
 u64 asciihex_to_int(const char *text);
 
 // Converts a decimal number in an ASCII string into integer
 u64 asciidec_to_int(const char *text);
 
+// Copies the hexadecimal digits of a cheat code to "digits" as a string,
+// skipping the separators (spaces, '-' and ':'). Returns the number of digits,
+// or -1 if there is any other character or there are more than "size - 1".
+int cheat_code_digits(const char *code, char *digits, int size);
+// Converts "count" hexadecimal digits (8 at most) that start at "digits"
+u32 cheat_code_hex(const char *digits, int count);
+
 void ScaleImage24RGB(int zoom, char *srcbuf, int srcw, int srch, char *dstbuf,
                      int dstw, int dsth);
 
@@ -7,6 +7,9 @@
 #ifndef WIN_GB_DEBUGGER__
 #define WIN_GB_DEBUGGER__
 
+// The AutoUpdate() functions are called after every frame. They only redraw
+// the windows if what they show has changed since they were last updated.
+
 // win_gb_disassembler.c
 // ---------------------
 
@@ -21,6 +24,7 @@ void Win_GBDisassemblerClose(void);
 
 int Win_GBMemViewerCreate(void); // Returns 1 if error
 void Win_GBMemViewerUpdate(void);
+void Win_GBMemViewerAutoUpdate(void);
 void Win_GBMemViewerRender(void);
 void Win_GBMemViewerClose(void);
 
@@ -37,6 +41,7 @@ void Win_GBIOViewerClose(void);
 
 int Win_GBTileViewerCreate(void); // Returns 1 if error
 void Win_GBTileViewerUpdate(void);
+void Win_GBTileViewerAutoUpdate(void);
 void Win_GBTileViewerClose(void);
 
 // win_gb_mapviewer.c
@@ -44,6 +49,7 @@ void Win_GBTileViewerClose(void);
 
 int Win_GBMapViewerCreate(void); // Returns 1 if error
 void Win_GBMapViewerUpdate(void);
+void Win_GBMapViewerAutoUpdate(void);
 void Win_GBMapViewerClose(void);
 
 // win_gb_sprviewer.c
@@ -51,6 +57,7 @@ void Win_GBMapViewerClose(void);
 
 int Win_GBSprViewerCreate(void); // Returns 1 if error
 void Win_GBSprViewerUpdate(void);
+void Win_GBSprViewerAutoUpdate(void);
 void Win_GBSprViewerClose(void);
 
 // win_gb_palviewer.c
@@ -58,6 +65,7 @@ void Win_GBSprViewerClose(void);
 
 int Win_GBPalViewerCreate(void); // Returns 1 if error
 void Win_GBPalViewerUpdate(void);
+void Win_GBPalViewerAutoUpdate(void);
 void Win_GBPalViewerClose(void);
 
 // win_gb_sgbviewer.c
@@ -9,8 +9,13 @@
 #include <SDL.h>
 
 #include "../debug_utils.h"
+#include "../dump_utils.h"
+#include "../emuthread_utils.h"
+#include "../file_utils.h"
 #include "../font_utils.h"
 #include "../general_utils.h"
+#include "../opprofile_utils.h"
+#include "../pcprofile_utils.h"
 #include "../window_handler.h"
 
 #include "win_gb_debugger.h"
@@ -27,16 +32,16 @@
 static int WinIDGBDis;
 
 #define WIN_GB_DISASSEMBLER_WIDTH  450
-#define WIN_GB_DISASSEMBLER_HEIGHT 432
+#define WIN_GB_DISASSEMBLER_HEIGHT 492
 
 static int GBDisassemblerCreated = 0;
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 #define CPU_DISASSEMBLER_MAX_INSTRUCTIONS (35)
-#define CPU_STACK_MAX_LINES               (19)
+#define CPU_STACK_MAX_LINES               (15)
 
 static int gb_cpu_line_address[CPU_DISASSEMBLER_MAX_INSTRUCTIONS];
 
@@ -48,7 +53,9 @@ static u32 gb_disassembler_start_address;
 static _gui_console gb_disassembly_con, gb_regs_con, gb_stack_con;
 static _gui_element gb_disassembly_textbox, gb_regs_textbox, gb_stack_textbox;
 
-static _gui_element gb_disassembler_step_btn, gb_disassembler_goto_btn;
+static _gui_element gb_disassembler_step_btn, gb_disassembler_goto_btn,
+                    gb_disassembler_profile_btn, gb_disassembler_watch_btn,
+                    gb_disassembler_export_btn;
 
 static _gui_element *gb_disassembler_window_gui_elements[] = {
     &gb_disassembly_textbox,
@@ -56,6 +63,9 @@ static _gui_element *gb_disassembler_window_gui_elements[] = {
     &gb_stack_textbox,
     &gb_disassembler_step_btn,
     &gb_disassembler_goto_btn,
+    &gb_disassembler_profile_btn,
+    &gb_disassembler_watch_btn,
+    &gb_disassembler_export_btn,
     NULL
 };
 
@@ -74,6 +84,88 @@ static void _win_gb_disassembler_goto(void);
 
 //------------------------------------------------------------------------------
 
+// While the profiler is running, the functions with the most samples are shown
+// instead of the disassembly.
+static void _win_gb_disassembler_profile_update(void)
+{
+    // The first two lines are used by the header
+    _pcprofile_entry_t entries[CPU_DISASSEMBLER_MAX_INSTRUCTIONS - 2];
+    int num = PCProfile_GetTop(entries, CPU_DISASSEMBLER_MAX_INSTRUCTIONS - 2);
+    u64 total = PCProfile_GetTotalSamples();
+
+    GUI_ConsoleModePrintf(&gb_disassembly_con, 0, 0,
+                          "Profiling... %llu samples", total);
+    GUI_ConsoleColorizeLine(&gb_disassembly_con, 0, 0xFFFFFF00);
+
+    for (int i = 0; i < num; i++)
+    {
+        char address[16];
+        PCProfile_AddressToString(entries[i].address, address,
+                                  sizeof(address));
+
+        double percent = (100.0 * entries[i].samples) / total;
+
+        GUI_ConsoleModePrintf(&gb_disassembly_con, 0, i + 2,
+                              "%6.2f%% %s %s", percent, address,
+                              entries[i].name);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Cache of the text of the instructions that only depends on their bytes and
+// address. The bytes are read from memory every update and compared with the
+// ones of the entry, so writes to memory don't need to invalidate anything.
+
+#define GB_DISASM_CACHE_ENTRIES (256) // Must be a power of 2
+
+typedef struct
+{
+    int valid;
+    u16 address;
+    int step;
+    u32 bytes;
+    char text[136];
+} _gb_disasm_cache_entry_t;
+
+static _gb_disasm_cache_entry_t gb_disasm_cache[GB_DISASM_CACHE_ENTRIES];
+
+static u32 _win_gb_disassembler_read_bytes(u16 address, int size)
+{
+    u32 bytes = 0;
+    for (int i = 0; i < size; i++)
+        bytes |= (u32)GB_MemRead8((address + i) & 0xFFFF) << (i * 8);
+    return bytes;
+}
+
+// The instruction pointed by PC is never cached, its text depends on the CPU.
+static const char *_win_gb_disassembler_get_text(u16 address, int *step,
+                                                 int is_pc)
+{
+    _gb_disasm_cache_entry_t *entry =
+                    &gb_disasm_cache[address & (GB_DISASM_CACHE_ENTRIES - 1)];
+
+    if (!is_pc && entry->valid && (entry->address == address)
+        && (entry->bytes == _win_gb_disassembler_read_bytes(address,
+                                                            entry->step)))
+    {
+        *step = entry->step;
+        return entry->text;
+    }
+
+    const char *text = GB_Dissasemble(address, step);
+    snprintf(entry->text, sizeof(entry->text), "%04X:%s", address, text);
+
+    entry->valid = !is_pc && !GB_DisassemblerStateUsed();
+    entry->address = address;
+    entry->step = *step;
+    entry->bytes = _win_gb_disassembler_read_bytes(address, *step);
+
+    return entry->text;
+}
+
+//------------------------------------------------------------------------------
+
 void Win_GBDisassemblerStartAddressSetDefault(void)
 {
     gb_disassembler_set_default_address = 1;
@@ -106,8 +198,32 @@ void Win_GBDisassemblerUpdate(void)
     GUI_ConsoleModePrintf(&gb_regs_con, 0, 8, "N:%d Z:%d",
                           (flags & F_SUBTRACT) != 0, (flags & F_ZERO) != 0);
 
+    // STACK
+
+    u16 stack_address = GameBoy.CPU.R16.SP - ((CPU_STACK_MAX_LINES / 2) * 2);
+    for (int i = 0; i < CPU_STACK_MAX_LINES; i++)
+    {
+        GUI_ConsoleModePrintf(&gb_stack_con, 0, i, "%04X:%04X", stack_address,
+                              GB_MemRead16(stack_address));
+
+        if (stack_address == GameBoy.CPU.R16.SP)
+            GUI_ConsoleColorizeLine(&gb_stack_con, i, 0xFFFFFF00);
+
+        stack_address += 2;
+    }
+
     // DISASSEMBLER
 
+    // The profiler isn't stopped if this window is closed
+    GUI_SetButtonText(&gb_disassembler_profile_btn,
+                      pcprofile_enabled ? "Stop prof." : "Profile");
+
+    if (pcprofile_enabled)
+    {
+        _win_gb_disassembler_profile_update();
+        return;
+    }
+
     if (gb_disassembler_set_default_address)
     {
         gb_disassembler_set_default_address = 0;
@@ -165,15 +281,13 @@ void Win_GBDisassemblerUpdate(void)
     }
 
     u16 address = gb_disassembler_start_address;
-    char opcode_text[128];
 
     for (int i = 0; i < CPU_DISASSEMBLER_MAX_INSTRUCTIONS; i++)
     {
         int step;
-        s_strncpy(opcode_text, GB_Dissasemble(address, &step),
-                  sizeof(opcode_text));
-        GUI_ConsoleModePrintf(&gb_disassembly_con, 0, i, "%04X:%s", address,
-                              opcode_text);
+        const char *text = _win_gb_disassembler_get_text(address, &step,
+                                        address == GameBoy.CPU.R16.PC);
+        GUI_ConsoleModePrintf(&gb_disassembly_con, 0, i, "%s", text);
         gb_cpu_line_address[i] = address;
 
         if (GB_DebugIsBreakpoint(address))
@@ -189,18 +303,6 @@ void Win_GBDisassemblerUpdate(void)
         }
         address += step;
     }
-
-    address = GameBoy.CPU.R16.SP - ((CPU_STACK_MAX_LINES / 2) * 2);
-    for (int i = 0; i < CPU_STACK_MAX_LINES; i++)
-    {
-        GUI_ConsoleModePrintf(&gb_stack_con, 0, i, "%04X:%04X", address,
-                              GB_MemRead16(address));
-
-        if (address == GameBoy.CPU.R16.SP)
-            GUI_ConsoleColorizeLine(&gb_stack_con, i, 0xFFFFFF00);
-
-        address += 2;
-    }
 }
 
 static void _win_gb_dissasembler_render(void)
@@ -304,6 +406,9 @@ static int _win_gb_disassembler_callback(SDL_Event *e)
 
 static void _win_gb_disassembly_textbox_callback(unused__ int x, int y)
 {
+    if (pcprofile_enabled)
+        return;
+
     u32 addr = gb_cpu_line_address[y / FONT_HEIGHT];
 
     if (GB_DebugIsBreakpoint(addr) == 0)
@@ -396,6 +501,122 @@ static void _win_gb_disassembler_goto(void)
                         _win_gb_disassembly_inputwindow_callback);
 }
 
+static void _win_gb_disassembler_profile(void)
+{
+    if (GBDisassemblerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    if (pcprofile_enabled == 0)
+    {
+        GB_PCProfileSetEnabled(1);
+        return;
+    }
+
+    GB_PCProfileSetEnabled(0);
+
+    const char *path = PCProfile_Export();
+    if (path != NULL)
+        Debug_LogMsgArg("PC profiler: Report saved to %s", path);
+
+#ifdef ENABLE_OPCODE_PROFILE
+    path = OPProfile_ExportCSV();
+    if (path != NULL)
+        Debug_LogMsgArg("Opcode profiler: Report saved to %s", path);
+#endif
+}
+
+// The watchpoint is asked in three steps: start address, end address and type
+static int gb_debugger_watch_step;
+static u32 gb_debugger_watch_start, gb_debugger_watch_end;
+
+static void _win_gb_disassembler_watch_callback(char *text, int is_valid)
+{
+    if (is_valid == 0)
+        return;
+
+    text[4] = '\0';
+    u32 value = asciihex_to_int(text);
+
+    if (gb_debugger_watch_step == 0)
+    {
+        gb_debugger_watch_start = value;
+        gb_debugger_watch_step = 1;
+        GUI_InputWindowOpen(&gui_iw_gb_disassembler, "Watch end address",
+                            _win_gb_disassembler_watch_callback);
+        return;
+    }
+
+    if (gb_debugger_watch_step == 1)
+    {
+        gb_debugger_watch_end = value;
+        gb_debugger_watch_step = 2;
+        GUI_InputWindowOpen(&gui_iw_gb_disassembler,
+                            "1=Read 2=Write 3=Both 0=Clear",
+                            _win_gb_disassembler_watch_callback);
+        return;
+    }
+
+    int type = value & (GB_WATCH_READ | GB_WATCH_WRITE);
+
+    if (type == 0)
+    {
+        GB_DebugClearWatchpoint(gb_debugger_watch_start,
+                                gb_debugger_watch_end);
+    }
+    else if (GB_DebugAddWatchpoint(gb_debugger_watch_start,
+                                   gb_debugger_watch_end, type))
+    {
+        Debug_ErrorMsgArg("Too many watchpoints (max: %d)",
+                          GB_MAX_WATCHPOINTS);
+        return;
+    }
+
+    Debug_LogMsgArg("Watchpoints:");
+    for (int i = 0; i < GB_MAX_WATCHPOINTS; i++)
+    {
+        u32 start, end;
+        if (GB_DebugGetWatchpoint(i, &start, &end, &type))
+        {
+            Debug_LogMsgArg("  %04X-%04X %s%s", start, end,
+                            (type & GB_WATCH_READ) ? "R" : "",
+                            (type & GB_WATCH_WRITE) ? "W" : "");
+        }
+    }
+}
+
+static void _win_gb_disassembler_watch(void)
+{
+    if (GBDisassemblerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    gb_debugger_watch_step = 0;
+
+    GUI_InputWindowOpen(&gui_iw_gb_disassembler, "Watch start address",
+                        _win_gb_disassembler_watch_callback);
+}
+
+// The whole ROM is exported, one bank after another
+static void _win_gb_disassembler_export(void)
+{
+    if (GBDisassemblerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    _dump_region_t region = { DUMP_FORMAT_GB, 0x0000, 0x4000, 0x4000 };
+
+    char *path = FU_GetNewTimestampFilenameExt("disassembly", "txt");
+    Dump_Start(path, &region, GameBoy.Emulator.Rom_Pointer,
+               GameBoy.Emulator.ROM_Banks * 0x4000);
+}
+
 //----------------------------------------------------------------
 
 int Win_GBDisassemblerCreate(void)
@@ -428,8 +649,24 @@ int Win_GBDisassemblerCreate(void)
                   2 + 10 * FONT_WIDTH, 24,
                   "Goto (F8)", _win_gb_disassembler_goto);
 
+    GUI_SetButton(&gb_disassembler_profile_btn,
+                  5 + 51 * FONT_WIDTH + 12, 6 + 9 * FONT_HEIGHT + 84,
+                  2 + 10 * FONT_WIDTH, 24,
+                  "Profile", _win_gb_disassembler_profile);
+
+    GUI_SetButton(&gb_disassembler_watch_btn,
+                  5 + 51 * FONT_WIDTH + 12, 6 + 9 * FONT_HEIGHT + 120,
+                  2 + 10 * FONT_WIDTH, 24,
+                  "Watch", _win_gb_disassembler_watch);
+
+    GUI_SetButton(&gb_disassembler_export_btn,
+                  5 + 51 * FONT_WIDTH + 12, 6 + 9 * FONT_HEIGHT + 156,
+                  2 + 10 * FONT_WIDTH, 24,
+                  "Export", _win_gb_disassembler_export);
+
     GUI_SetTextBox(&gb_stack_textbox, &gb_stack_con,
-                   6 + 51 * FONT_WIDTH + 12, 6 + 9 * FONT_HEIGHT + 48 + 24 + 12,
+                   6 + 51 * FONT_WIDTH + 12,
+                   6 + 9 * FONT_HEIGHT + 156 + 24 + 12,
                    10 * FONT_WIDTH, CPU_STACK_MAX_LINES * FONT_HEIGHT,
                    NULL);
 
@@ -453,6 +690,13 @@ int Win_GBDisassemblerCreate(void)
 
 void Win_GBDisassemblerSetFocus(void)
 {
+    // Breakpoints may be hit in the emulation thread, which can't open windows
+    if (EmuThread_IsCurrentThread())
+    {
+        EmuThread_CallFromMainThread(Win_GBDisassemblerSetFocus);
+        return;
+    }
+
     if (GBDisassemblerCreated == 1)
     {
         WH_Focus(WinIDGBDis);
@@ -25,7 +25,7 @@
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -259,7 +259,8 @@ static void _win_gb_mapviewer_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gb_map");
-    Save_PNG(name, GB_MAP_BUFFER_WIDTH, GB_MAP_BUFFER_HEIGHT, buffer_temp, 0);
+    Save_PNG_Async(name, GB_MAP_BUFFER_WIDTH, GB_MAP_BUFFER_HEIGHT, buffer_temp,
+                   0);
 #endif
     Win_GB_GBCameraViewerUpdate();
 }
@@ -21,10 +21,11 @@
 
 #include "../gb_core/debug_video.h"
 #include "../gb_core/gameboy.h"
+#include "../gb_core/memory.h"
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -52,6 +53,8 @@ static char gb_map_zoomed_tile_buffer[64 * 64 * 3];
 
 static int gb_map_zoomed_tile_is_pal = 1;
 
+static u8 gb_mapview_bgp = 0; // Value when the window was last updated
+
 //------------------------------------------------------------------------------
 
 static _gui_console gb_mapview_con;
@@ -119,6 +122,14 @@ void Win_GBMapViewerUpdate(void)
     if (Win_MainRunningGB() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_MAPVIEWER,
+                     0, sizeof(gb_dirty_pal) << GB_DIRTY_PAGE_SHIFT);
+    GB_MemDirtyCheck(GB_DIRTY_VRAM, GB_DIRTY_USER_MAPVIEWER,
+                     0, sizeof(gb_dirty_vram) << GB_DIRTY_PAGE_SHIFT);
+
+    gb_mapview_bgp = GameBoy.Memory.IO_Ports[BGP_REG - 0xFF00];
+
     GUI_ConsoleClear(&gb_mapview_con);
 
     _GB_MEMORY_ *mem = &GameBoy.Memory;
@@ -201,6 +212,34 @@ static void _win_gb_map_viewer_render(void)
     WH_Render(WinIDGBMapViewer, buffer);
 }
 
+void Win_GBMapViewerAutoUpdate(void)
+{
+    if (GBMapViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    int changed = GB_MemDirtyCheck(GB_DIRTY_VRAM, GB_DIRTY_USER_MAPVIEWER,
+                                   0, sizeof(gb_dirty_vram)
+                                      << GB_DIRTY_PAGE_SHIFT);
+
+    if (gb_map_zoomed_tile_is_pal)
+    {
+        changed |= GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_MAPVIEWER,
+                                    0, sizeof(gb_dirty_pal)
+                                       << GB_DIRTY_PAGE_SHIFT);
+        changed |= GameBoy.Memory.IO_Ports[BGP_REG - 0xFF00]
+                   != gb_mapview_bgp;
+    }
+
+    if (changed)
+    {
+        Win_GBMapViewerUpdate();
+        _win_gb_map_viewer_render();
+    }
+}
+
 static int _win_gb_map_viewer_callback(SDL_Event *e)
 {
     if (GBMapViewerCreated == 0)
@@ -297,7 +336,8 @@ static void _win_gb_mapviewer_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gb_map");
-    Save_PNG(name, GB_MAP_BUFFER_WIDTH, GB_MAP_BUFFER_HEIGHT, buffer_temp, 0);
+    Save_PNG_Async(name, GB_MAP_BUFFER_WIDTH, GB_MAP_BUFFER_HEIGHT, buffer_temp,
+                   0);
 
     Win_GBMapViewerUpdate();
 }
@@ -9,14 +9,18 @@
 #include <SDL.h>
 
 #include "../debug_utils.h"
+#include "../dump_utils.h"
+#include "../file_utils.h"
 #include "../font_utils.h"
 #include "../general_utils.h"
+#include "../heatmap_utils.h"
 #include "../window_handler.h"
 
 #include "win_gb_debugger.h"
 #include "win_main.h"
 #include "win_utils.h"
 
+#include "../gb_core/gameboy.h"
 #include "../gb_core/memory.h"
 
 //------------------------------------------------------------------------------
@@ -30,11 +34,17 @@ static int GBMemViewerCreated = 0;
 
 //------------------------------------------------------------------------------
 
+extern core_local__ _GB_CONTEXT_ GameBoy;
+
+//------------------------------------------------------------------------------
+
 #define GB_MEMVIEWER_MAX_LINES          (20)
 #define GB_MEMVIEWER_ADDRESS_JUMP_LINE  (16)
+#define GB_MEMVIEWER_MAX_COLUMNS        (69)
 
 #define GB_MEMVIEWER_8  0
 #define GB_MEMVIEWER_16 1
+#define GB_MEMVIEWER_HEATMAP 2
 
 static int gb_memviewer_mode = GB_MEMVIEWER_8;
 
@@ -47,15 +57,18 @@ static u16 gb_memviewer_clicked_address;
 static _gui_console gb_memview_con;
 static _gui_element gb_memview_textbox;
 
-static _gui_element gb_memview_goto_btn;
+static _gui_element gb_memview_dump_btn, gb_memview_goto_btn;
 
-static _gui_element gb_memview_mode_8_radbtn, gb_memview_mode_16_radbtn;
+static _gui_element gb_memview_mode_8_radbtn, gb_memview_mode_16_radbtn,
+                    gb_memview_mode_heatmap_radbtn;
 
 static _gui_element *gb_memviwer_window_gui_elements[] = {
     &gb_memview_textbox,
+    &gb_memview_dump_btn,
     &gb_memview_goto_btn,
     &gb_memview_mode_8_radbtn,
     &gb_memview_mode_16_radbtn,
+    &gb_memview_mode_heatmap_radbtn,
     NULL
 };
 
@@ -78,86 +91,333 @@ static char win_gb_memviewer_character_fix(char c)
     return '.';
 }
 
-void Win_GBMemViewerUpdate(void)
+// The bytes shown in the window the last time it was updated. Only the lines
+// that have changed are printed again. The bytes that change are highlighted
+// for a few frames.
+
+#define GB_MEMVIEWER_HIGHLIGHT_FRAMES   (30)
+#define GB_MEMVIEWER_HIGHLIGHT_COLOR    (0xFF8080FF)
+
+#define GB_MEMVIEWER_SNAPSHOT_SIZE \
+        (GB_MEMVIEWER_MAX_LINES * GB_MEMVIEWER_ADDRESS_JUMP_LINE)
+
+static u8 gb_memviewer_snapshot[GB_MEMVIEWER_SNAPSHOT_SIZE];
+static u8 gb_memviewer_highlight[GB_MEMVIEWER_SNAPSHOT_SIZE];
+static u16 gb_memviewer_snapshot_address;
+static int gb_memviewer_snapshot_mode = -1; // -1 = Invalid snapshot
+
+static char *_win_gb_mem_viewer_hex(char *dst, u32 value, int digits)
 {
-    if (GBMemViewerCreated == 0)
-        return;
+    static const char hex[] = "0123456789ABCDEF";
 
-    if (Win_MainRunningGB() == 0)
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        dst[i] = hex[value & 0xF];
+        value >>= 4;
+    }
+
+    return dst + digits;
+}
+
+static void _win_gb_mem_viewer_print_line(int line)
+{
+    u16 address = gb_memviewer_snapshot_address
+                  + line * GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+    const u8 *data =
+            &gb_memviewer_snapshot[line * GB_MEMVIEWER_ADDRESS_JUMP_LINE];
+    const u8 *highlight =
+            &gb_memviewer_highlight[line * GB_MEMVIEWER_ADDRESS_JUMP_LINE];
+
+    int size = 1 << gb_memviewer_mode; // Size of each value in bytes
+
+    char textbuf[100];
+    char *ptr = textbuf;
+
+    ptr = _win_gb_mem_viewer_hex(ptr, address, 4);
+    *ptr++ = ' ';
+    *ptr++ = ':';
+    *ptr++ = ' ';
+
+    int values_x = ptr - textbuf;
+
+    for (int j = 0; j < GB_MEMVIEWER_ADDRESS_JUMP_LINE; j += size)
+    {
+        u32 value = 0;
+        for (int k = size - 1; k >= 0; k--)
+            value = (value << 8) | data[j + k];
+
+        ptr = _win_gb_mem_viewer_hex(ptr, value, size * 2);
+        *ptr++ = ' ';
+    }
+
+    *ptr++ = ':';
+    *ptr++ = ' ';
+
+    int chars_x = ptr - textbuf;
+
+    for (int j = 0; j < GB_MEMVIEWER_ADDRESS_JUMP_LINE; j++)
+    {
+        *ptr++ = win_gb_memviewer_character_fix(data[j]);
+        if ((j & 3) == 3)
+            *ptr++ = ' ';
+    }
+
+    // Lines that don't fit in the window are cut. They mustn't continue in
+    // the next line, it may not be printed again.
+    int len = ptr - textbuf;
+    if (len > GB_MEMVIEWER_MAX_COLUMNS)
+        len = GB_MEMVIEWER_MAX_COLUMNS;
+    textbuf[len] = '\0';
+
+    GUI_ConsoleModePrintf(&gb_memview_con, 0, line, "%s", textbuf);
+    GUI_ConsoleColorizeRange(&gb_memview_con, 0, line, len, 0xFFFFFFFF);
+
+    for (int j = 0; j < GB_MEMVIEWER_ADDRESS_JUMP_LINE; j++)
+    {
+        if (highlight[j] == 0)
+            continue;
+
+        int value_index = j / size;
+        GUI_ConsoleColorizeRange(&gb_memview_con,
+                                 values_x + value_index * (size * 2 + 1),
+                                 line, size * 2,
+                                 GB_MEMVIEWER_HIGHLIGHT_COLOR);
+        GUI_ConsoleColorizeRange(&gb_memview_con, chars_x + j + (j / 4),
+                                 line, 1, GB_MEMVIEWER_HIGHLIGHT_COLOR);
+    }
+}
+
+// In heatmap mode each line shows the accesses to up to 32 buckets of 256 bytes
+// of the same bank. The heatmap runs while the window is in this mode, and it
+// is printed again every few frames.
+
+#define GB_MEMVIEWER_HEATMAP_BUCKETS    (32)
+#define GB_MEMVIEWER_HEATMAP_FRAMES     (30)
+
+static int gb_memviewer_heatmap_line;
+static int gb_memviewer_heatmap_frames;
+
+static void _win_gb_mem_viewer_heatmap_scroll(int lines)
+{
+    int last = Heatmap_GetLineCount(GB_MEMVIEWER_HEATMAP_BUCKETS)
+               - GB_MEMVIEWER_MAX_LINES;
+
+    gb_memviewer_heatmap_line += lines;
+    if (gb_memviewer_heatmap_line > last)
+        gb_memviewer_heatmap_line = last;
+    if (gb_memviewer_heatmap_line < 0)
+        gb_memviewer_heatmap_line = 0;
+}
+
+// Goes to the first bank that is mapped at that address
+static void _win_gb_mem_viewer_heatmap_goto(u32 address)
+{
+    int lines = Heatmap_GetLineCount(GB_MEMVIEWER_HEATMAP_BUCKETS);
+
+    for (int i = 0; i < lines; i++)
+    {
+        int region, count;
+        u32 offset, bank;
+
+        Heatmap_GetLine(i, GB_MEMVIEWER_HEATMAP_BUCKETS, &region, &offset,
+                        &count);
+
+        u32 start = Heatmap_GetAddress(region, offset, &bank);
+        if ((address >= start)
+            && (address < start + (count << HEATMAP_BUCKET_SHIFT)))
+        {
+            gb_memviewer_heatmap_line = i;
+            _win_gb_mem_viewer_heatmap_scroll(0);
+            return;
+        }
+    }
+}
+
+static void _win_gb_mem_viewer_heatmap_print_line(int line, u64 max)
+{
+    int region, count;
+    u32 offset;
+
+    if (Heatmap_GetLine(gb_memviewer_heatmap_line + line,
+                        GB_MEMVIEWER_HEATMAP_BUCKETS, &region, &offset,
+                        &count))
         return;
 
-    GUI_ConsoleClear(&gb_memview_con);
+    const _heatmap_region_t *r = Heatmap_GetRegion(region);
+    const _heatmap_bucket_t *buckets =
+            &Heatmap_GetBuckets(region)[offset >> HEATMAP_BUCKET_SHIFT];
 
-    u16 address = gb_memviewer_start_address;
+    char textbuf[100];
+    char *ptr = textbuf;
 
-    char textbuf[300];
+    u32 bank;
+    u32 address = Heatmap_GetAddress(region, offset, &bank);
+    ptr = _win_gb_mem_viewer_hex(ptr, bank, 2);
+    *ptr++ = ':';
+    ptr = _win_gb_mem_viewer_hex(ptr, address, 4);
+    *ptr++ = ' ';
 
-    if (gb_memviewer_mode == GB_MEMVIEWER_16)
+    int cells_x = ptr - textbuf;
+
+    int levels[GB_MEMVIEWER_HEATMAP_BUCKETS];
+    u64 reads = 0;
+    u64 writes = 0;
+
+    for (int j = 0; j < GB_MEMVIEWER_HEATMAP_BUCKETS; j++)
     {
-        for (int i = 0; i < GB_MEMVIEWER_MAX_LINES; i++)
+        if (j >= count)
         {
-            snprintf(textbuf, sizeof(textbuf), "%04X : ", address);
+            *ptr++ = ' ';
+            continue;
+        }
 
-            u16 tmpaddr = address;
-            for (int j = 0; j < 8; j++)
-            {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%04X ", GB_MemRead16(tmpaddr));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr += 2;
-            }
-            s_strncat(textbuf, ": ", sizeof(textbuf));
+        levels[j] = Heatmap_GetLevel(&buckets[j], max);
+        *ptr++ = Heatmap_GetCharacter(levels[j]);
+        reads += buckets[j].reads;
+        writes += buckets[j].writes;
+    }
 
-            tmpaddr = address;
-            for (int j = 0; j < 16; j++)
-            {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%c",
-                         win_gb_memviewer_character_fix(GB_MemRead8(tmpaddr)));
-                if ((j & 3) == 3)
-                    s_strncat(tmp, " ", sizeof(tmp));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
-            }
+    char reads_text[10], writes_text[10];
+    Heatmap_FormatCount(reads_text, sizeof(reads_text), reads);
+    Heatmap_FormatCount(writes_text, sizeof(writes_text), writes);
+
+    snprintf(ptr, sizeof(textbuf) - (ptr - textbuf), " R %4s W %4s %s",
+             reads_text, writes_text, r->name);
 
-            GUI_ConsoleModePrintf(&gb_memview_con, 0, i, textbuf);
+    int len = strlen(textbuf);
+    if (len > GB_MEMVIEWER_MAX_COLUMNS)
+        len = GB_MEMVIEWER_MAX_COLUMNS;
+    textbuf[len] = '\0';
+
+    GUI_ConsoleModePrintf(&gb_memview_con, 0, line, "%s", textbuf);
+    GUI_ConsoleColorizeRange(&gb_memview_con, 0, line, len, 0xFFFFFFFF);
+
+    for (int j = 0; j < count; j++)
+    {
+        GUI_ConsoleColorizeRange(&gb_memview_con, cells_x + j, line, 1,
+                                 Heatmap_GetColor(&buckets[j], levels[j]));
+    }
+}
+
+static int _win_gb_mem_viewer_heatmap_refresh(int every_frame)
+{
+    if (every_frame)
+    {
+        gb_memviewer_heatmap_frames++;
+        if (gb_memviewer_heatmap_frames < GB_MEMVIEWER_HEATMAP_FRAMES)
+            return 0;
+    }
+
+    gb_memviewer_heatmap_frames = 0;
+
+    // It is stopped when the ROM is unloaded
+    if (heatmap_enabled == 0)
+        GB_MemHeatmapSetEnabled(1);
+
+    _win_gb_mem_viewer_heatmap_scroll(0);
+
+    u64 max = Heatmap_GetMax();
+
+    GUI_ConsoleClear(&gb_memview_con);
+
+    for (int i = 0; i < GB_MEMVIEWER_MAX_LINES; i++)
+        _win_gb_mem_viewer_heatmap_print_line(i, max);
+
+    // The hexadecimal view has to be printed again when it is selected
+    gb_memviewer_snapshot_mode = -1;
+
+    return 1;
+}
+
+// If called every frame, only the lines that have changed are printed. If not,
+// all of them are printed. Returns 1 if the window has to be drawn again.
+static int _win_gb_mem_viewer_refresh(int every_frame)
+{
+    if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+        return _win_gb_mem_viewer_heatmap_refresh(every_frame);
 
-            address += GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+    int same_view = (gb_memviewer_snapshot_mode == gb_memviewer_mode)
+                    && (gb_memviewer_snapshot_address
+                        == gb_memviewer_start_address);
+
+    if (same_view == 0)
+    {
+        GUI_ConsoleClear(&gb_memview_con);
+        memset(gb_memviewer_highlight, 0, sizeof(gb_memviewer_highlight));
+        every_frame = 0;
+    }
+
+    u8 data[GB_MEMVIEWER_SNAPSHOT_SIZE];
+
+    for (int i = 0; i < GB_MEMVIEWER_SNAPSHOT_SIZE; i++)
+    {
+        u16 address = gb_memviewer_start_address + i;
+
+        // Reading from the handlers may trigger watchpoints or have side
+        // effects in the mapper. Every frame, only the memory that can be read
+        // directly is refreshed.
+        if (every_frame)
+        {
+            const u8 *page = gb_mem_read_page[address >> 8];
+            if (page)
+                data[i] = page[address & 0xFF];
+            else
+                data[i] = gb_memviewer_snapshot[i];
+        }
+        else
+        {
+            data[i] = GB_MemRead8(address);
         }
     }
-    else if (gb_memviewer_mode == GB_MEMVIEWER_8)
+
+    gb_memviewer_snapshot_address = gb_memviewer_start_address;
+    gb_memviewer_snapshot_mode = gb_memviewer_mode;
+
+    int redraw = 0;
+
+    for (int i = 0; i < GB_MEMVIEWER_MAX_LINES; i++)
     {
-        for (int i = 0; i < GB_MEMVIEWER_MAX_LINES; i++)
+        int changed = (every_frame == 0);
+
+        for (int j = 0; j < GB_MEMVIEWER_ADDRESS_JUMP_LINE; j++)
         {
-            snprintf(textbuf, sizeof(textbuf), "%04X : ", address);
+            int index = i * GB_MEMVIEWER_ADDRESS_JUMP_LINE + j;
 
-            u16 tmpaddr = address;
-            for (int j = 0; j < 16; j++)
+            if (same_view && (data[index] != gb_memviewer_snapshot[index]))
             {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%02X ", GB_MemRead8(tmpaddr));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
+                gb_memviewer_highlight[index] = GB_MEMVIEWER_HIGHLIGHT_FRAMES;
+                changed = 1;
             }
-            s_strncat(textbuf, ": ", sizeof(textbuf));
-
-            tmpaddr = address;
-            for (int j = 0; j < 16; j++)
+            else if (every_frame && gb_memviewer_highlight[index])
             {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%c",
-                         win_gb_memviewer_character_fix(GB_MemRead8(tmpaddr)));
-                if ((j & 3) == 3)
-                    s_strncat(tmp, " ", sizeof(tmp));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
+                gb_memviewer_highlight[index]--;
+                if (gb_memviewer_highlight[index] == 0)
+                    changed = 1;
             }
+        }
 
-            GUI_ConsoleModePrintf(&gb_memview_con, 0, i, textbuf);
-
-            address += GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+        if (changed)
+        {
+            memcpy(&gb_memviewer_snapshot[i * GB_MEMVIEWER_ADDRESS_JUMP_LINE],
+                   &data[i * GB_MEMVIEWER_ADDRESS_JUMP_LINE],
+                   GB_MEMVIEWER_ADDRESS_JUMP_LINE);
+            _win_gb_mem_viewer_print_line(i);
+            redraw = 1;
         }
     }
+
+    return redraw;
+}
+
+void Win_GBMemViewerUpdate(void)
+{
+    if (GBMemViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    _win_gb_mem_viewer_refresh(0);
 }
 
 //----------------------------------------------------------------
@@ -178,6 +438,18 @@ void Win_GBMemViewerRender(void)
     WH_Render(WinIDGBMemViewer, buffer);
 }
 
+void Win_GBMemViewerAutoUpdate(void)
+{
+    if (GBMemViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    if (_win_gb_mem_viewer_refresh(1))
+        Win_GBMemViewerRender();
+}
+
 static int _win_gba_mem_viewer_callback(SDL_Event *e)
 {
     if (GBMemViewerCreated == 0)
@@ -191,8 +463,15 @@ static int _win_gba_mem_viewer_callback(SDL_Event *e)
     {
         if (e->type == SDL_MOUSEWHEEL)
         {
-            gb_memviewer_start_address -=
-                    e->wheel.y * 3 * GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+            if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+            {
+                _win_gb_mem_viewer_heatmap_scroll(-e->wheel.y * 3);
+            }
+            else
+            {
+                gb_memviewer_start_address -=
+                        e->wheel.y * 3 * GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+            }
             redraw = 1;
         }
         else if (e->type == SDL_KEYDOWN)
@@ -205,12 +484,20 @@ static int _win_gba_mem_viewer_callback(SDL_Event *e)
                     break;
 
                 case SDLK_DOWN:
-                    gb_memviewer_start_address += GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+                    if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+                        _win_gb_mem_viewer_heatmap_scroll(1);
+                    else
+                        gb_memviewer_start_address +=
+                                GB_MEMVIEWER_ADDRESS_JUMP_LINE;
                     redraw = 1;
                     break;
 
                 case SDLK_UP:
-                    gb_memviewer_start_address -= GB_MEMVIEWER_ADDRESS_JUMP_LINE;
+                    if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+                        _win_gb_mem_viewer_heatmap_scroll(-1);
+                    else
+                        gb_memviewer_start_address -=
+                                GB_MEMVIEWER_ADDRESS_JUMP_LINE;
                     redraw = 1;
                     break;
             }
@@ -246,6 +533,9 @@ static int _win_gba_mem_viewer_callback(SDL_Event *e)
     if (close_this)
     {
         GBMemViewerCreated = 0;
+
+        if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+            GB_MemHeatmapSetEnabled(0);
         if (GUI_InputWindowIsEnabled(&gui_iw_gb_memviewer))
             GUI_InputWindowClose(&gui_iw_gb_memviewer);
         WH_Close(WinIDGBMemViewer);
@@ -272,6 +562,8 @@ static void _win_gb_mem_viewer_inputwindow_callback(char *text, int is_valid)
         {
             text[4] = '\0';
             u32 newvalue = asciihex_to_int(text);
+            if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+                _win_gb_mem_viewer_heatmap_goto(newvalue);
             newvalue &= ~(GB_MEMVIEWER_ADDRESS_JUMP_LINE - 1);
             gb_memviewer_start_address = newvalue;
         }
@@ -295,6 +587,9 @@ static void _win_gb_mem_viewer_inputwindow_callback(char *text, int is_valid)
 
 static void _win_gb_mem_view_textbox_callback(int x, int y)
 {
+    if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+        return;
+
     int xtile = x / FONT_WIDTH;
     int ytile = y / FONT_HEIGHT;
 
@@ -352,6 +647,20 @@ static void _win_gb_mem_view_textbox_callback(int x, int y)
 
 static void _win_gb_mem_viewer_mode_radbtn_callback(int btn_id)
 {
+    if ((btn_id == GB_MEMVIEWER_HEATMAP)
+        && (gb_memviewer_mode != GB_MEMVIEWER_HEATMAP))
+    {
+        if (Win_MainRunningGB())
+            GB_MemHeatmapSetEnabled(1);
+        gb_memviewer_heatmap_line = 0;
+        gb_memviewer_heatmap_frames = 0;
+    }
+    else if ((btn_id != GB_MEMVIEWER_HEATMAP)
+             && (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP))
+    {
+        GB_MemHeatmapSetEnabled(0);
+    }
+
     gb_memviewer_mode = btn_id;
     Win_GBMemViewerUpdate();
 }
@@ -369,6 +678,112 @@ static void _win_gb_mem_viewer_goto(void)
                         _win_gb_mem_viewer_inputwindow_callback);
 }
 
+// The region that contains the first address shown in the viewer is saved both
+// as a binary file and as a text file. All the banks of the region are saved.
+static void _win_gb_mem_viewer_dump(void)
+{
+    if (GBMemViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+    int cgb = (GameBoy.Emulator.CGBEnabled == 1);
+
+    _dump_region_t region = { DUMP_FORMAT_RAW, 0, 0, 0 };
+    const void *data;
+    u32 size;
+
+    u16 address = gb_memviewer_start_address;
+    if ((address >= 0xE000) && (address < 0xFE00)) // Echo RAM
+        address -= 0x2000;
+
+    switch (address >> 12)
+    {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x6:
+        case 0x7:
+            region.address = 0x0000;
+            region.bank_size = 0x4000;
+            region.bank_address = 0x4000;
+            data = GameBoy.Emulator.Rom_Pointer;
+            size = GameBoy.Emulator.ROM_Banks * 0x4000;
+            break;
+        case 0x8:
+        case 0x9:
+            region.address = 0x8000;
+            region.bank_size = 0x2000;
+            region.bank_address = 0x8000;
+            data = mem->VideoRAM;
+            size = cgb ? 0x4000 : 0x2000;
+            break;
+        case 0xA:
+        case 0xB:
+        {
+            u32 ram_banks = GameBoy.Emulator.RAM_Banks;
+            if (ram_banks == 0) // MBC2 and RTC registers
+                ram_banks = 1;
+            else if (ram_banks > 16)
+                ram_banks = 16;
+
+            region.address = 0xA000;
+            region.bank_size = 0x2000;
+            region.bank_address = 0xA000;
+            data = mem->ExternRAM;
+            size = ram_banks * 0x2000;
+            break;
+        }
+        case 0xC:
+        case 0xD:
+            // The switchable banks are right after the first one
+            region.address = 0xC000;
+            region.bank_size = 0x1000;
+            region.bank_address = 0xD000;
+            data = mem->WorkRAM;
+            size = cgb ? 0x8000 : 0x2000;
+            break;
+        default:
+            if (address < 0xFEA0)
+            {
+                region.address = 0xFE00;
+                data = mem->ObjAttrMem;
+                size = sizeof(mem->ObjAttrMem);
+            }
+            else if (address < 0xFF00)
+            {
+                Debug_ErrorMsgArg("Nothing to dump at address 0x%04X",
+                                  gb_memviewer_start_address);
+                return;
+            }
+            else if (address < 0xFF80)
+            {
+                region.address = 0xFF00;
+                data = mem->IO_Ports;
+                size = sizeof(mem->IO_Ports);
+            }
+            else
+            {
+                region.address = 0xFF80;
+                data = mem->HighRAM;
+                size = sizeof(mem->HighRAM);
+            }
+            break;
+    }
+
+    Dump_Start(FU_GetNewTimestampFilenameExt("dump", "bin"), &region,
+               data, size);
+
+    region.format = DUMP_FORMAT_HEX;
+    Dump_Start(FU_GetNewTimestampFilenameExt("dump", "txt"), &region,
+               data, size);
+}
+
 //----------------------------------------------------------------
 
 int Win_GBMemViewerCreate(void)
@@ -390,13 +805,21 @@ int Win_GBMemViewerCreate(void)
                        6 + 9 * FONT_WIDTH + 12, 6, 9 * FONT_WIDTH, 24,
                        "16 bits", 0, GB_MEMVIEWER_16, 0,
                        _win_gb_mem_viewer_mode_radbtn_callback);
+    GUI_SetRadioButton(&gb_memview_mode_heatmap_radbtn,
+                       18 + 18 * FONT_WIDTH + 12, 6, 9 * FONT_WIDTH, 24,
+                       "Heatmap", 0, GB_MEMVIEWER_HEATMAP, 0,
+                       _win_gb_mem_viewer_mode_radbtn_callback);
 
+    GUI_SetButton(&gb_memview_dump_btn,
+                  68 + 31 * FONT_WIDTH + 30, 6, 8 * FONT_WIDTH, 24,
+                  "Dump", _win_gb_mem_viewer_dump);
     GUI_SetButton(&gb_memview_goto_btn,
                   68 + 39 * FONT_WIDTH + 36, 6, 16 * FONT_WIDTH, 24,
                   "Goto (F8)", _win_gb_mem_viewer_goto);
 
     GUI_SetTextBox(&gb_memview_textbox, &gb_memview_con,
-                   6, 36, 69 * FONT_WIDTH, GB_MEMVIEWER_MAX_LINES * FONT_HEIGHT,
+                   6, 36, GB_MEMVIEWER_MAX_COLUMNS * FONT_WIDTH,
+                   GB_MEMVIEWER_MAX_LINES * FONT_HEIGHT,
                    _win_gb_mem_view_textbox_callback);
 
     GUI_InputWindowClose(&gui_iw_gb_memviewer);
@@ -407,6 +830,8 @@ int Win_GBMemViewerCreate(void)
 
     gb_memviewer_start_address = 0;
 
+    gb_memviewer_snapshot_mode = -1;
+
     WinIDGBMemViewer = WH_Create(WIN_GB_MEMVIEWER_WIDTH,
                                  WIN_GB_MEMVIEWER_HEIGHT, 0, 0, 0);
     WH_SetCaption(WinIDGBMemViewer, "GB Memory Viewer");
@@ -425,5 +850,9 @@ void Win_GBMemViewerClose(void)
         return;
 
     GBMemViewerCreated = 0;
+
+    if (gb_memviewer_mode == GB_MEMVIEWER_HEATMAP)
+        GB_MemHeatmapSetEnabled(0);
+
     WH_Close(WinIDGBMemViewer);
 }
@@ -21,6 +21,11 @@
 
 #include "../gb_core/debug_video.h"
 #include "../gb_core/gameboy.h"
+#include "../gb_core/memory.h"
+
+//------------------------------------------------------------------------------
+
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -36,6 +41,9 @@ static int GBPalViewerCreated = 0;
 static u32 gb_palview_sprpal = 0; // 1 if selected a color from sprite palettes
 static u32 gb_palview_selectedindex = 0;
 
+// Values of BGP, OBP0 and OBP1 when the window was last updated
+static u8 gb_palview_regs[3];
+
 #define GB_PAL_BUFFER_WIDTH ((20 * 4) + 1)
 #define GB_PAL_BUFFER_HEIGHT ((20 * 8) + 1)
 
@@ -102,6 +110,14 @@ void Win_GBPalViewerUpdate(void)
     if (Win_MainRunningGB() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_PALVIEWER,
+                     0, sizeof(gb_dirty_pal) << GB_DIRTY_PAGE_SHIFT);
+
+    gb_palview_regs[0] = GameBoy.Memory.IO_Ports[BGP_REG - 0xFF00];
+    gb_palview_regs[1] = GameBoy.Memory.IO_Ports[OBP0_REG - 0xFF00];
+    gb_palview_regs[2] = GameBoy.Memory.IO_Ports[OBP1_REG - 0xFF00];
+
     GUI_ConsoleClear(&gb_palview_con);
 
     u32 r, g, b;
@@ -177,6 +193,30 @@ static void _win_gb_pal_viewer_render(void)
     WH_Render(WinIDGBPalViewer, buffer);
 }
 
+void Win_GBPalViewerAutoUpdate(void)
+{
+    if (GBPalViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    int changed = (mem->IO_Ports[BGP_REG - 0xFF00] != gb_palview_regs[0])
+                  || (mem->IO_Ports[OBP0_REG - 0xFF00] != gb_palview_regs[1])
+                  || (mem->IO_Ports[OBP1_REG - 0xFF00] != gb_palview_regs[2]);
+
+    changed |= GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_PALVIEWER,
+                                0, sizeof(gb_dirty_pal) << GB_DIRTY_PAGE_SHIFT);
+
+    if (changed)
+    {
+        Win_GBPalViewerUpdate();
+        _win_gb_pal_viewer_render();
+    }
+}
+
 static int _win_gb_pal_viewer_callback(SDL_Event *e)
 {
     if (GBPalViewerCreated == 0)
@@ -269,8 +309,8 @@ static void _win_gb_palviewer_dump_btn_callback(void)
     }
 
     char *name_bg = FU_GetNewTimestampFilename("gb_palette_bg");
-    Save_PNG(name_bg, GB_PAL_BUFFER_WIDTH, GB_PAL_BUFFER_HEIGHT,
-             buffer_temp, 0);
+    Save_PNG_Async(name_bg, GB_PAL_BUFFER_WIDTH, GB_PAL_BUFFER_HEIGHT,
+                   buffer_temp, 0);
 
     src = gb_pal_spr_buffer;
     dst = buffer_temp;
@@ -283,8 +323,8 @@ static void _win_gb_palviewer_dump_btn_callback(void)
     }
 
     char *name_spr = FU_GetNewTimestampFilename("gb_palette_spr");
-    Save_PNG(name_spr, GB_PAL_BUFFER_WIDTH, GB_PAL_BUFFER_HEIGHT,
-             buffer_temp, 0);
+    Save_PNG_Async(name_spr, GB_PAL_BUFFER_WIDTH, GB_PAL_BUFFER_HEIGHT,
+                   buffer_temp, 0);
 
     Win_GBPalViewerUpdate();
 }
@@ -26,7 +26,7 @@
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -850,7 +850,7 @@ static void _win_gb_sgbviewer_border_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gb_sgb_border");
-    Save_PNG(name, 256, 256, border_buff, 1);
+    Save_PNG_Async(name, 256, 256, border_buff, 1);
 
     free(border_buff);
 
@@ -909,7 +909,7 @@ static void _win_gb_sgbviewer_tiles_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gb_sgb_tiles");
-    Save_PNG(name, 128, 128, tiles_buff, 0);
+    Save_PNG_Async(name, 128, 128, tiles_buff, 0);
 
     free(tiles_buff);
 
@@ -974,7 +974,7 @@ static void _win_gb_sgbviewer_atf_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gb_sgb_atf");
-    Save_PNG(name, 161, 145, buf, 0);
+    Save_PNG_Async(name, 161, 145, buf, 0);
 
     free(buf);
 
@@ -1037,7 +1037,7 @@ static void _win_gb_sgbviewer_pal_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gb_sgb_pal");
-    Save_PNG(name, 160, 80, buf, 0);
+    Save_PNG_Async(name, 160, 80, buf, 0);
 
     free(buf);
 
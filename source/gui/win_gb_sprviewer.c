@@ -21,6 +21,7 @@
 
 #include "../gb_core/debug_video.h"
 #include "../gb_core/gameboy.h"
+#include "../gb_core/memory.h"
 
 //------------------------------------------------------------------------------
 
@@ -33,12 +34,15 @@ static int GBSprViewerCreated = 0;
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
 static u32 gb_sprview_selected_spr = 0;
 
+// Values of LCDC, OBP0 and OBP1 when the window was last updated
+static u8 gb_sprview_regs[3];
+
 #define GB_SPR_ALLSPR_BUFFER_WIDTH  (256)
 #define GB_SPR_ALLSPR_BUFFER_HEIGHT (256)
 
@@ -102,6 +106,18 @@ void Win_GBSprViewerUpdate(void)
     if (Win_MainRunningGB() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_SPRVIEWER,
+                     0, sizeof(gb_dirty_pal) << GB_DIRTY_PAGE_SHIFT);
+    GB_MemDirtyCheck(GB_DIRTY_VRAM, GB_DIRTY_USER_SPRVIEWER,
+                     0, sizeof(gb_dirty_vram) << GB_DIRTY_PAGE_SHIFT);
+    GB_MemDirtyCheck(GB_DIRTY_OAM, GB_DIRTY_USER_SPRVIEWER,
+                     0, sizeof(gb_dirty_oam) << GB_DIRTY_PAGE_SHIFT);
+
+    gb_sprview_regs[0] = GameBoy.Memory.IO_Ports[LCDC_REG - 0xFF00];
+    gb_sprview_regs[1] = GameBoy.Memory.IO_Ports[OBP0_REG - 0xFF00];
+    gb_sprview_regs[2] = GameBoy.Memory.IO_Ports[OBP1_REG - 0xFF00];
+
     GUI_ConsoleClear(&gb_sprview_con);
 
     u8 spr_x, spr_y, tile, info;
@@ -174,6 +190,37 @@ static void _win_gb_spr_viewer_render(void)
     WH_Render(WinIDGBSprViewer, buffer);
 }
 
+void Win_GBSprViewerAutoUpdate(void)
+{
+    if (GBSprViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    _GB_MEMORY_ *mem = &GameBoy.Memory;
+
+    // Only the size of the sprites is used from LCDC
+    int changed = ((mem->IO_Ports[LCDC_REG - 0xFF00] ^ gb_sprview_regs[0])
+                   & (1 << 2))
+                  || (mem->IO_Ports[OBP0_REG - 0xFF00] != gb_sprview_regs[1])
+                  || (mem->IO_Ports[OBP1_REG - 0xFF00] != gb_sprview_regs[2]);
+
+    changed |= GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_SPRVIEWER,
+                                0, sizeof(gb_dirty_pal) << GB_DIRTY_PAGE_SHIFT);
+    changed |= GB_MemDirtyCheck(GB_DIRTY_VRAM, GB_DIRTY_USER_SPRVIEWER,
+                                0, sizeof(gb_dirty_vram)
+                                   << GB_DIRTY_PAGE_SHIFT);
+    changed |= GB_MemDirtyCheck(GB_DIRTY_OAM, GB_DIRTY_USER_SPRVIEWER,
+                                0, sizeof(gb_dirty_oam) << GB_DIRTY_PAGE_SHIFT);
+
+    if (changed)
+    {
+        Win_GBSprViewerUpdate();
+        _win_gb_spr_viewer_render();
+    }
+}
+
 static int _win_gb_spr_viewer_callback(SDL_Event *e)
 {
     if (GBSprViewerCreated == 0)
@@ -234,8 +281,8 @@ static void _win_gb_sprviewer_allspr_dump_btn_callback(void)
     GB_Debug_PrintSpritesAlpha(allbuf);
 
     char *name = FU_GetNewTimestampFilename("gb_sprite_all");
-    Save_PNG(name, GB_SPR_ALLSPR_BUFFER_WIDTH, GB_SPR_ALLSPR_BUFFER_HEIGHT,
-             allbuf, 1);
+    Save_PNG_Async(name, GB_SPR_ALLSPR_BUFFER_WIDTH,
+                   GB_SPR_ALLSPR_BUFFER_HEIGHT, allbuf, 1);
 
     Win_GBSprViewerUpdate();
 }
@@ -252,7 +299,7 @@ static void _win_gb_sprviewer_zoomed_dump_btn_callback(void)
     int sy = 8 << ((mem->IO_Ports[LCDC_REG - 0xFF00] & (1 << 2)) != 0);
 
     char *name = FU_GetNewTimestampFilename("gb_sprite");
-    Save_PNG(name, 8, sy, buf, 1);
+    Save_PNG_Async(name, 8, sy, buf, 1);
 
     Win_GBSprViewerUpdate();
 }
@@ -21,10 +21,11 @@
 
 #include "../gb_core/debug_video.h"
 #include "../gb_core/gameboy.h"
+#include "../gb_core/memory.h"
 
 //------------------------------------------------------------------------------
 
-extern _GB_CONTEXT_ GameBoy;
+extern core_local__ _GB_CONTEXT_ GameBoy;
 
 //------------------------------------------------------------------------------
 
@@ -53,6 +54,8 @@ static char gb_tile_zoomed_tile_buffer[64 * 64 * 3];
 static int gb_tile_zoomed_tile_is_pal = 1;
 static int gb_tile_zoomed_tile_sel_pal = 0; // 0 = b/w ; 1 = bg ; 2 = spr
 
+static u8 gb_tileview_bgp = 0; // Value when the window was last updated
+
 //------------------------------------------------------------------------------
 
 static _gui_console gb_tileview_con;
@@ -120,6 +123,38 @@ static void _win_gb_tileviewer_zoomed_tile_bw_radbtn_callback(int num)
 
 //----------------------------------------------------------------
 
+// Draws the parts of the window that depend on the selected tile
+static void _win_gb_tileviewer_update_selection(void)
+{
+    GUI_Draw_SetDrawingColor(255, 0, 0);
+    char *buf;
+    if (gb_tileview_selected_bank == 0)
+        buf = gb_tile_bank0_buffer;
+    else
+        buf = gb_tile_bank1_buffer;
+
+    int l = ((gb_tileview_selected_index % 16) * 8); // Left
+    int t = ((gb_tileview_selected_index / 16) * 8); // Top
+    int r = l + 7;                                   // Right
+    int b = t + 7;                                   // Bottom
+    GUI_Draw_Rect(buf, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT, l, r, t, b);
+
+    if (gb_tile_zoomed_tile_is_pal == 0)
+    {
+        GB_Debug_TileDrawZoomed64x64(gb_tile_zoomed_tile_buffer,
+                                     gb_tileview_selected_index,
+                                     gb_tileview_selected_bank);
+    }
+    else
+    {
+        GB_Debug_TileDrawZoomedPaletted64x64(gb_tile_zoomed_tile_buffer,
+                                             gb_tileview_selected_index,
+                                             gb_tileview_selected_bank,
+                                             gb_tile_zoomed_tile_sel_pal,
+                                             gb_tile_zoomed_tile_is_pal == 2);
+    }
+}
+
 void Win_GBTileViewerUpdate(void)
 {
     if (GBTileViewerCreated == 0)
@@ -128,6 +163,14 @@ void Win_GBTileViewerUpdate(void)
     if (Win_MainRunningGB() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_TILEVIEWER,
+                     0, sizeof(gb_dirty_pal) << GB_DIRTY_PAGE_SHIFT);
+    GB_MemDirtyCheck(GB_DIRTY_VRAM, GB_DIRTY_USER_TILEVIEWER,
+                     0, sizeof(gb_dirty_vram) << GB_DIRTY_PAGE_SHIFT);
+
+    gb_tileview_bgp = GameBoy.Memory.IO_Ports[BGP_REG - 0xFF00];
+
     GUI_ConsoleClear(&gb_tileview_con);
 
     if (gb_tile_zoomed_tile_is_pal == 0)
@@ -153,33 +196,7 @@ void Win_GBTileViewerUpdate(void)
     snprintf(text, sizeof(text), "Pal: %d", gb_tile_zoomed_tile_sel_pal);
     GUI_SetLabelCaption(&gb_tileview_zoomed_tile_pal_label, text);
 
-    GUI_Draw_SetDrawingColor(255, 0, 0);
-    char *buf;
-    if (gb_tileview_selected_bank == 0)
-        buf = gb_tile_bank0_buffer;
-    else
-        buf = gb_tile_bank1_buffer;
-
-    int l = ((gb_tileview_selected_index % 16) * 8); // Left
-    int t = ((gb_tileview_selected_index / 16) * 8); // Top
-    int r = l + 7;                                   // Right
-    int b = t + 7;                                   // Bottom
-    GUI_Draw_Rect(buf, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT, l, r, t, b);
-
-    if (gb_tile_zoomed_tile_is_pal == 0)
-    {
-        GB_Debug_TileDrawZoomed64x64(gb_tile_zoomed_tile_buffer,
-                                     gb_tileview_selected_index,
-                                     gb_tileview_selected_bank);
-    }
-    else
-    {
-        GB_Debug_TileDrawZoomedPaletted64x64(gb_tile_zoomed_tile_buffer,
-                                             gb_tileview_selected_index,
-                                             gb_tileview_selected_bank,
-                                             gb_tile_zoomed_tile_sel_pal,
-                                             gb_tile_zoomed_tile_is_pal == 2);
-    }
+    _win_gb_tileviewer_update_selection();
 
     u32 tile = gb_tileview_selected_index;
     u32 tileindex = (tile > 255) ? (tile - 256) : (tile);
@@ -202,6 +219,69 @@ void Win_GBTileViewerUpdate(void)
     }
 }
 
+// Returns 1 if any tile has been redrawn
+static int _win_gb_tileviewer_update_changed_tiles(void)
+{
+    // A change in the palette affects all tiles
+    if (gb_tile_zoomed_tile_is_pal)
+    {
+        int changed = GB_MemDirtyCheck(GB_DIRTY_PAL, GB_DIRTY_USER_TILEVIEWER,
+                                       0, sizeof(gb_dirty_pal)
+                                          << GB_DIRTY_PAGE_SHIFT);
+        changed |= GameBoy.Memory.IO_Ports[BGP_REG - 0xFF00]
+                   != gb_tileview_bgp;
+
+        if (changed)
+        {
+            Win_GBTileViewerUpdate();
+            return 1;
+        }
+    }
+
+    // Each page has a row of tiles
+    const u32 tiles_per_page = (1 << GB_DIRTY_PAGE_SHIFT) / 16;
+
+    int changed = 0;
+
+    for (int bank = 0; bank < 2; bank++)
+    {
+        char *buf = bank ? gb_tile_bank1_buffer : gb_tile_bank0_buffer;
+
+        for (u32 tile = 0; tile < 384; tile += tiles_per_page)
+        {
+            if (GB_MemDirtyCheck(GB_DIRTY_VRAM, GB_DIRTY_USER_TILEVIEWER,
+                                 (bank * 0x2000) + (tile * 16),
+                                 tiles_per_page * 16) == 0)
+            {
+                continue;
+            }
+
+            for (u32 i = tile; i < tile + tiles_per_page; i++)
+            {
+                if (gb_tile_zoomed_tile_is_pal == 0)
+                {
+                    GB_Debug_TileVRAMDrawTile(buf, GB_TILE_BUFFER_WIDTH,
+                                              bank, i);
+                }
+                else
+                {
+                    GB_Debug_TileVRAMDrawTilePaletted(buf,
+                            GB_TILE_BUFFER_WIDTH, bank, i,
+                            gb_tile_zoomed_tile_sel_pal,
+                            gb_tile_zoomed_tile_is_pal == 2);
+                }
+            }
+
+            changed = 1;
+        }
+    }
+
+    if (changed)
+        _win_gb_tileviewer_update_selection();
+
+    return changed;
+}
+
 //----------------------------------------------------------------
 
 static void _win_gb_tile_viewer_render(void)
@@ -216,6 +296,18 @@ static void _win_gb_tile_viewer_render(void)
     WH_Render(WinIDGBTileViewer, buffer);
 }
 
+void Win_GBTileViewerAutoUpdate(void)
+{
+    if (GBTileViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGB() == 0)
+        return;
+
+    if (_win_gb_tileviewer_update_changed_tiles())
+        _win_gb_tile_viewer_render();
+}
+
 static int _win_gb_tile_viewer_callback(SDL_Event *e)
 {
     if (GBTileViewerCreated == 0)
@@ -303,7 +395,8 @@ static void _win_gb_tileviewer_dump_btn_callback(void)
     }
 
     char *name_b0 = FU_GetNewTimestampFilename("gb_tiles_bank0");
-    Save_PNG(name_b0, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT, buf0, 0);
+    Save_PNG_Async(name_b0, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT, buf0,
+                   0);
 
     if (GameBoy.Emulator.CGBEnabled)
     {
@@ -316,7 +409,8 @@ static void _win_gb_tileviewer_dump_btn_callback(void)
         }
 
         char *name_b1 = FU_GetNewTimestampFilename("gb_tiles_bank1");
-        Save_PNG(name_b1, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT, buf1, 0);
+        Save_PNG_Async(name_b1, GB_TILE_BUFFER_WIDTH, GB_TILE_BUFFER_HEIGHT,
+                       buf1, 0);
     }
 
     Win_GBTileViewerUpdate();
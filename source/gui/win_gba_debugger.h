@@ -7,6 +7,9 @@
 #ifndef WIN_GBA_DEBUGGER__
 #define WIN_GBA_DEBUGGER__
 
+// The AutoUpdate() functions are called after every frame. They only redraw
+// the windows if what they show has changed since they were last updated.
+
 // win_gba_disassembler.c
 // ----------------------
 
@@ -21,6 +24,7 @@ void Win_GBADisassemblerClose(void);
 
 int Win_GBAMemViewerCreate(void); // Returns 1 on error
 void Win_GBAMemViewerUpdate(void);
+void Win_GBAMemViewerAutoUpdate(void);
 void Win_GBAMemViewerRender(void);
 void Win_GBAMemViewerClose(void);
 
@@ -37,6 +41,7 @@ void Win_GBAIOViewerClose(void);
 
 int Win_GBATileViewerCreate(void); // Returns 1 on error
 void Win_GBATileViewerUpdate(void);
+void Win_GBATileViewerAutoUpdate(void);
 void Win_GBATileViewerClose(void);
 
 // win_gba_mapviewer.c
@@ -44,6 +49,7 @@ void Win_GBATileViewerClose(void);
 
 int Win_GBAMapViewerCreate(void); // Returns 1 on error
 void Win_GBAMapViewerUpdate(void);
+void Win_GBAMapViewerAutoUpdate(void);
 void Win_GBAMapViewerClose(void);
 
 // win_gba_sprviewer.c
@@ -51,6 +57,7 @@ void Win_GBAMapViewerClose(void);
 
 int Win_GBASprViewerCreate(void); // Returns 1 on error
 void Win_GBASprViewerUpdate(void);
+void Win_GBASprViewerAutoUpdate(void);
 void Win_GBASprViewerClose(void);
 
 // win_gba_palviewer.c
@@ -58,6 +65,7 @@ void Win_GBASprViewerClose(void);
 
 int Win_GBAPalViewerCreate(void); // Returns 1 on error
 void Win_GBAPalViewerUpdate(void);
+void Win_GBAPalViewerAutoUpdate(void);
 void Win_GBAPalViewerClose(void);
 
 #endif // WIN_GBA_DEBUGGER__
@@ -9,14 +9,20 @@
 #include <SDL.h>
 
 #include "../debug_utils.h"
+#include "../dump_utils.h"
+#include "../emuthread_utils.h"
+#include "../file_utils.h"
 #include "../font_utils.h"
 #include "../general_utils.h"
+#include "../opprofile_utils.h"
+#include "../pcprofile_utils.h"
 #include "../window_handler.h"
 
 #include "win_gba_debugger.h"
 #include "win_main.h"
 #include "win_utils.h"
 
+#include "../gba_core/code_cache.h"
 #include "../gba_core/cpu.h"
 #include "../gba_core/disassembler.h"
 #include "../gba_core/gba.h"
@@ -27,7 +33,7 @@
 static int WinIDGBADis;
 
 #define WIN_GBA_DISASSEMBLER_WIDTH  600
-#define WIN_GBA_DISASSEMBLER_HEIGHT 480
+#define WIN_GBA_DISASSEMBLER_HEIGHT 552
 
 static int GBADisassemblerCreated = 0;
 
@@ -49,7 +55,9 @@ static u32 gba_disassembler_start_address;
 static _gui_console gba_disassembly_con, gba_regs_con;
 static _gui_element gba_disassembly_textbox, gba_regs_textbox;
 
-static _gui_element gba_disassembler_step_btn, gba_disassembler_goto_btn;
+static _gui_element gba_disassembler_step_btn, gba_disassembler_goto_btn,
+                    gba_disassembler_profile_btn, gba_disassembler_watch_btn,
+                    gba_disassembler_export_btn;
 
 static _gui_element gba_disassembler_disassembly_mode_label;
 
@@ -61,6 +69,9 @@ static _gui_element *gba_disassembler_window_gui_elements[] = {
     &gba_regs_textbox,
     &gba_disassembler_step_btn,
     &gba_disassembler_goto_btn,
+    &gba_disassembler_profile_btn,
+    &gba_disassembler_watch_btn,
+    &gba_disassembler_export_btn,
     &gba_disassembler_disassembly_mode_label,
     &gba_disassembler_auto_radbtn,
     &gba_disassembler_arm_radbtn,
@@ -83,6 +94,109 @@ static void _win_gba_disassembler_goto(void);
 
 //------------------------------------------------------------------------------
 
+// While the profiler is running, the functions with the most samples are shown
+// instead of the disassembly.
+static void _win_gba_disassembler_profile_update(void)
+{
+    // The first two lines are used by the header
+    _pcprofile_entry_t entries[CPU_DISASSEMBLER_MAX_INSTRUCTIONS - 2];
+    int num = PCProfile_GetTop(entries, CPU_DISASSEMBLER_MAX_INSTRUCTIONS - 2);
+    u64 total = PCProfile_GetTotalSamples();
+
+    GUI_ConsoleModePrintf(&gba_disassembly_con, 0, 0,
+                          "Profiling... %llu samples", total);
+    GUI_ConsoleColorizeLine(&gba_disassembly_con, 0, 0xFFFFFF00);
+
+    for (int i = 0; i < num; i++)
+    {
+        char address[16];
+        PCProfile_AddressToString(entries[i].address, address,
+                                  sizeof(address));
+
+        double percent = (100.0 * entries[i].samples) / total;
+
+        GUI_ConsoleModePrintf(&gba_disassembly_con, 0, i + 2,
+                              "%6.2f%% %s %s", percent, address,
+                              entries[i].name);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Cache of the text of the instructions that only depends on their opcode and
+// address. The opcode is read from memory every update and compared with the
+// one of the entry, so writes to memory don't need to invalidate anything.
+
+#define GBA_DISASM_CACHE_ENTRIES (256) // Must be a power of 2
+
+typedef struct
+{
+    int valid;
+    int thumb;
+    u32 address;
+    u32 opcode;
+    char text[156];
+} _gba_disasm_cache_entry_t;
+
+static _gba_disasm_cache_entry_t gba_disasm_cache[GBA_DISASM_CACHE_ENTRIES];
+
+// The instruction pointed by PC is never cached, its text depends on the CPU.
+static const char *_win_gba_disassembler_get_text(u32 address, u32 opcode,
+                                                  int thumb, int is_pc)
+{
+    u32 index = (address >> (thumb ? 1 : 2)) & (GBA_DISASM_CACHE_ENTRIES - 1);
+    _gba_disasm_cache_entry_t *entry = &gba_disasm_cache[index];
+
+    if (!is_pc && entry->valid && (entry->thumb == thumb)
+        && (entry->address == address) && (entry->opcode == opcode))
+    {
+        return entry->text;
+    }
+
+    char opcode_text[128];
+
+    if (thumb)
+    {
+        GBA_DisassembleTHUMB(opcode, address, opcode_text,
+                             sizeof(opcode_text));
+        snprintf(entry->text, sizeof(entry->text), "%08X:%04X %s", address,
+                 opcode, opcode_text);
+    }
+    else
+    {
+        GBA_DisassembleARM(opcode, address, opcode_text,
+                           sizeof(opcode_text));
+        snprintf(entry->text, sizeof(entry->text), "%08X:%08X %s", address,
+                 opcode, opcode_text);
+    }
+
+    entry->valid = !is_pc && !GBA_DisassemblerStateUsed();
+    entry->thumb = thumb;
+    entry->address = address;
+    entry->opcode = opcode;
+
+    return entry->text;
+}
+
+// Shown before each instruction: '*' if its block is decoded in the code cache,
+// '.' if the interpreter fetches it from memory because the block is cold, and
+// nothing if it can't be cached at all.
+static char _win_gba_disassembler_tier_char(u32 address, int thumb)
+{
+    switch (GBA_CodeCacheGetTier(address, thumb))
+    {
+        case GBA_CODE_CACHE_TIER_DECODED:
+            return '*';
+        case GBA_CODE_CACHE_TIER_COLD:
+            return '.';
+        case GBA_CODE_CACHE_TIER_NONE:
+        default:
+            return ' ';
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void Win_GBADisassemblerStartAddressSetDefault(void)
 {
     gba_disassembler_set_default_address = 1;
@@ -157,8 +271,15 @@ void Win_GBADisassemblerUpdate(void)
 
     // DISASSEMBLER
 
-    char opcode_text[128];
-    char final_text[156];
+    // The profiler isn't stopped if this window is closed
+    GUI_SetButtonText(&gba_disassembler_profile_btn,
+                      pcprofile_enabled ? "Stop profile" : "Profile");
+
+    if (pcprofile_enabled)
+    {
+        _win_gba_disassembler_profile_update();
+        return;
+    }
 
     if (((disassemble_mode == GBA_DISASM_CPU_AUTO) &&
          (cpu->EXECUTION_MODE == EXEC_ARM)) ||
@@ -170,12 +291,13 @@ void Win_GBADisassemblerUpdate(void)
         {
             u32 opcode = GBA_MemoryReadFast32(address);
 
-            GBA_DisassembleARM(opcode, address, opcode_text,
-                               sizeof(opcode_text));
-            snprintf(final_text, sizeof(final_text), "%08X:%08X %s", address,
-                     opcode, opcode_text);
+            const char *text = _win_gba_disassembler_get_text(address, opcode,
+                                        0, address == cpu->R[R_PC]);
 
-            GUI_ConsoleModePrintf(&gba_disassembly_con, 0, i, final_text);
+            char tier = _win_gba_disassembler_tier_char(address, 0);
+
+            GUI_ConsoleModePrintf(&gba_disassembly_con, 0, i, "%c%s", tier,
+                                  text);
 
             if (GBA_DebugIsBreakpoint(address))
             {
@@ -206,12 +328,13 @@ void Win_GBADisassemblerUpdate(void)
         {
             u16 opcode = GBA_MemoryReadFast16(address);
 
-            GBA_DisassembleTHUMB(opcode, address, opcode_text,
-                                 sizeof(opcode_text));
-            snprintf(final_text, sizeof(final_text), "%08X:%04X %s", address,
-                     opcode, opcode_text);
+            const char *text = _win_gba_disassembler_get_text(address, opcode,
+                                        1, address == cpu->R[R_PC]);
+
+            char tier = _win_gba_disassembler_tier_char(address, 1);
 
-            GUI_ConsoleModePrintf(&gba_disassembly_con, 0, i, final_text);
+            GUI_ConsoleModePrintf(&gba_disassembly_con, 0, i, "%c%s", tier,
+                                  text);
 
             if (GBA_DebugIsBreakpoint(address))
             {
@@ -369,6 +492,9 @@ static int _win_gba_disassembler_callback(SDL_Event *e)
 
 static void _win_gba_disassembly_textbox_callback(unused__ int x, int y)
 {
+    if (pcprofile_enabled)
+        return;
+
     _cpu_t *cpu = GBA_CPUGet();
 
     int instr_size;
@@ -504,6 +630,132 @@ static void _win_gba_disassembler_goto(void)
                         _win_gba_disassembly_inputwindow_callback);
 }
 
+static void _win_gba_disassembler_profile(void)
+{
+    if (GBADisassemblerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    if (pcprofile_enabled == 0)
+    {
+        GBA_PCProfileSetEnabled(1);
+        return;
+    }
+
+    GBA_PCProfileSetEnabled(0);
+
+    const char *path = PCProfile_Export();
+    if (path != NULL)
+        Debug_LogMsgArg("PC profiler: Report saved to %s", path);
+
+#ifdef ENABLE_OPCODE_PROFILE
+    path = OPProfile_ExportCSV();
+    if (path != NULL)
+        Debug_LogMsgArg("Opcode profiler: Report saved to %s", path);
+#endif
+}
+
+// The watchpoint is asked in three steps: start address, end address and type
+static int gba_debugger_watch_step;
+static u32 gba_debugger_watch_start, gba_debugger_watch_end;
+
+static void _win_gba_disassembler_watch_callback(char *text, int is_valid)
+{
+    if (is_valid == 0)
+        return;
+
+    text[8] = '\0';
+    u32 value = asciihex_to_int(text);
+
+    if (gba_debugger_watch_step == 0)
+    {
+        gba_debugger_watch_start = value;
+        gba_debugger_watch_step = 1;
+        GUI_InputWindowOpen(&gui_iw_gba_disassembler, "Watch end address",
+                            _win_gba_disassembler_watch_callback);
+        return;
+    }
+
+    if (gba_debugger_watch_step == 1)
+    {
+        gba_debugger_watch_end = value;
+        gba_debugger_watch_step = 2;
+        GUI_InputWindowOpen(&gui_iw_gba_disassembler,
+                            "1=Read 2=Write 3=Both 0=Clear",
+                            _win_gba_disassembler_watch_callback);
+        return;
+    }
+
+    int type = value & (GBA_WATCH_READ | GBA_WATCH_WRITE);
+
+    if (type == 0)
+    {
+        GBA_DebugClearWatchpoint(gba_debugger_watch_start,
+                                 gba_debugger_watch_end);
+    }
+    else if (GBA_DebugAddWatchpoint(gba_debugger_watch_start,
+                                    gba_debugger_watch_end, type))
+    {
+        Debug_ErrorMsgArg("Too many watchpoints (max: %d)",
+                          GBA_MAX_WATCHPOINTS);
+        return;
+    }
+
+    Debug_LogMsgArg("Watchpoints:");
+    for (int i = 0; i < GBA_MAX_WATCHPOINTS; i++)
+    {
+        u32 start, end;
+        if (GBA_DebugGetWatchpoint(i, &start, &end, &type))
+        {
+            Debug_LogMsgArg("  %08X-%08X %s%s", start, end,
+                            (type & GBA_WATCH_READ) ? "R" : "",
+                            (type & GBA_WATCH_WRITE) ? "W" : "");
+        }
+    }
+}
+
+static void _win_gba_disassembler_watch(void)
+{
+    if (GBADisassemblerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    gba_debugger_watch_step = 0;
+
+    GUI_InputWindowOpen(&gui_iw_gba_disassembler, "Watch start address",
+                        _win_gba_disassembler_watch_callback);
+}
+
+// The whole ROM is exported using the current disassembly mode
+static void _win_gba_disassembler_export(void)
+{
+    if (GBADisassemblerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    _cpu_t *cpu = GBA_CPUGet();
+
+    int thumb;
+    if (disassemble_mode == GBA_DISASM_CPU_AUTO)
+        thumb = (cpu->CPSR & F_T) != 0;
+    else
+        thumb = (disassemble_mode == GBA_DISASM_CPU_THUMB);
+
+    _dump_region_t region = {
+        thumb ? DUMP_FORMAT_GBA_THUMB : DUMP_FORMAT_GBA_ARM,
+        0x08000000, 0, 0
+    };
+
+    char *path = FU_GetNewTimestampFilenameExt("disassembly", "txt");
+    Dump_Start(path, &region, Mem.rom_wait0, GBA_GetRomSize());
+}
+
 //----------------------------------------------------------------
 
 int Win_GBADisassemblerCreate(void)
@@ -530,22 +782,31 @@ int Win_GBADisassemblerCreate(void)
     GUI_SetButton(&gba_disassembler_goto_btn, 6 + 66 * FONT_WIDTH + 12, 316,
                   16 * FONT_WIDTH, 24, "Goto (F8)", _win_gba_disassembler_goto);
 
+    GUI_SetButton(&gba_disassembler_profile_btn, 6 + 66 * FONT_WIDTH + 12, 352,
+                  16 * FONT_WIDTH, 24, "Profile", _win_gba_disassembler_profile);
+
+    GUI_SetButton(&gba_disassembler_watch_btn, 6 + 66 * FONT_WIDTH + 12, 388,
+                  16 * FONT_WIDTH, 24, "Watch", _win_gba_disassembler_watch);
+
+    GUI_SetButton(&gba_disassembler_export_btn, 6 + 66 * FONT_WIDTH + 12, 424,
+                  16 * FONT_WIDTH, 24, "Export", _win_gba_disassembler_export);
+
     GUI_SetLabel(&gba_disassembler_disassembly_mode_label,
-                 6 + 66 * FONT_WIDTH + 12, 366, 16 * FONT_WIDTH, 24,
+                 6 + 66 * FONT_WIDTH + 12, 450, 16 * FONT_WIDTH, 24,
                  "Disassembly mode");
 
     GUI_SetRadioButton(&gba_disassembler_auto_radbtn,
-                       6 + 66 * FONT_WIDTH + 12, 388,
+                       6 + 66 * FONT_WIDTH + 12, 470,
                        16 * FONT_WIDTH, 24,
                        "Auto", 0, GBA_DISASM_CPU_AUTO, 1,
                        _win_gba_cpu_mode_radbtn_callback);
     GUI_SetRadioButton(&gba_disassembler_arm_radbtn,
-                       6 + 66 * FONT_WIDTH + 12, 418,
+                       6 + 66 * FONT_WIDTH + 12, 496,
                        16 * FONT_WIDTH, 24,
                        "ARM", 0, GBA_DISASM_CPU_ARM, 0,
                        _win_gba_cpu_mode_radbtn_callback);
     GUI_SetRadioButton(&gba_disassembler_thumb_radbtn,
-                       6 + 66 * FONT_WIDTH + 12, 448,
+                       6 + 66 * FONT_WIDTH + 12, 522,
                        16 * FONT_WIDTH, 24,
                        "THUMB", 0, GBA_DISASM_CPU_THUMB, 0,
                        _win_gba_cpu_mode_radbtn_callback);
@@ -572,6 +833,13 @@ int Win_GBADisassemblerCreate(void)
 
 void Win_GBADisassemblerSetFocus(void)
 {
+    // Breakpoints may be hit in the emulation thread, which can't open windows
+    if (EmuThread_IsCurrentThread())
+    {
+        EmuThread_CallFromMainThread(Win_GBADisassemblerSetFocus);
+        return;
+    }
+
     if (GBADisassemblerCreated == 1)
     {
         WH_Focus(WinIDGBADis);
@@ -902,6 +902,8 @@ void Win_GBAIOViewerUpdate(void)
                 "   1", "  64", " 256", "1024"
             };
 
+            GBA_TimersSync();
+
             // Timer 0
 
             GUI_ConsoleClear(&gba_ioview_timers_tmr0_con);
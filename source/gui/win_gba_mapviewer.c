@@ -42,6 +42,7 @@ static u32 gba_mapview_sizex = 0;
 static u32 gba_mapview_sizey = 0;
 static u32 gba_mapview_bgmode = 0;
 static u32 gba_mapview_bgcontrolreg = 0;
+static u32 gba_mapview_dispcnt_mode = 0;
 
 static int gba_mapview_scrollx = 0;
 static int gba_mapview_scrolly = 0;
@@ -215,10 +216,17 @@ void Win_GBAMapViewerUpdate(void)
     if (Win_MainRunningGBA() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_MAPVIEWER,
+                         0, sizeof(Mem.pal_ram));
+    GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM, GBA_DIRTY_USER_MAPVIEWER,
+                         0, sizeof(Mem.vram));
+
     GUI_ConsoleClear(&gba_mapview_con);
     GUI_ConsoleClear(&gba_mapview_tileinfo_con);
 
     u32 mode = REG_DISPCNT & 0x7;
+    gba_mapview_dispcnt_mode = mode;
 
     //--------------------------------------------------------------------------
 
@@ -641,6 +649,43 @@ void Win_GBAMapViewerUpdate(void)
     }
 }
 
+// Returns 1 if the VRAM used by the background shown in the window has changed
+static int _win_gba_mapviewer_vram_changed(void)
+{
+    u32 control = gba_mapview_bgcontrolreg;
+    u32 cbb = ((control >> 2) & 3) * (16 * 1024);
+    u32 sbb = ((control >> 8) & 0x1F) * (2 * 1024);
+    u32 map_entries = (gba_mapview_sizex / 8) * (gba_mapview_sizey / 8);
+    int changed = 0;
+
+    if (gba_mapview_bgmode == 1) // Text
+    {
+        changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM,
+                                        GBA_DIRTY_USER_MAPVIEWER,
+                                        sbb, map_entries * 2);
+        changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM,
+                                        GBA_DIRTY_USER_MAPVIEWER,
+                                        cbb, 1024 * 64);
+    }
+    else if (gba_mapview_bgmode == 2) // Affine
+    {
+        changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM,
+                                        GBA_DIRTY_USER_MAPVIEWER,
+                                        sbb, map_entries);
+        changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM,
+                                        GBA_DIRTY_USER_MAPVIEWER,
+                                        cbb, 256 * 64);
+    }
+    else if (gba_mapview_bgmode >= 3) // Bitmap
+    {
+        changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM,
+                                        GBA_DIRTY_USER_MAPVIEWER,
+                                        0, 0x14000);
+    }
+
+    return changed;
+}
+
 //----------------------------------------------------------------
 
 static void _win_gba_map_viewer_render(void)
@@ -655,6 +700,34 @@ static void _win_gba_map_viewer_render(void)
     WH_Render(WinIDGBAMapViewer, buffer);
 }
 
+void Win_GBAMapViewerAutoUpdate(void)
+{
+    if (GBAMapViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    const u16 control[4] = {
+        REG_BG0CNT, REG_BG1CNT, REG_BG2CNT, REG_BG3CNT
+    };
+
+    int changed = ((REG_DISPCNT & 0x7) != gba_mapview_dispcnt_mode)
+                  || (control[gba_mapview_selected_bg & 3]
+                      != gba_mapview_bgcontrolreg);
+
+    // Only the background palettes are used
+    changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_MAPVIEWER,
+                                    0, 256 * 2);
+    changed |= _win_gba_mapviewer_vram_changed();
+
+    if (changed)
+    {
+        Win_GBAMapViewerUpdate();
+        _win_gba_map_viewer_render();
+    }
+}
+
 static int _win_gba_map_viewer_callback(SDL_Event *e)
 {
     if (GBAMapViewerCreated == 0)
@@ -730,7 +803,7 @@ static void _win_gba_mapviewer_dump_btn_callback(void)
     }
 
     char *name = FU_GetNewTimestampFilename("gba_map");
-    Save_PNG(name, gba_mapview_sizex, gba_mapview_sizey, buf, 1);
+    Save_PNG_Async(name, gba_mapview_sizex, gba_mapview_sizey, buf, 1);
 
     free(buf);
 
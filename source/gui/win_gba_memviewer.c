@@ -9,14 +9,18 @@
 #include <SDL.h>
 
 #include "../debug_utils.h"
+#include "../dump_utils.h"
+#include "../file_utils.h"
 #include "../font_utils.h"
 #include "../general_utils.h"
+#include "../heatmap_utils.h"
 #include "../window_handler.h"
 
 #include "win_gba_debugger.h"
 #include "win_main.h"
 #include "win_utils.h"
 
+#include "../gba_core/gba.h"
 #include "../gba_core/memory.h"
 
 //------------------------------------------------------------------------------
@@ -32,10 +36,12 @@ static int GBAMemViewerCreated = 0;
 
 #define GBA_MEMVIEWER_MAX_LINES         (20)
 #define GBA_MEMVIEWER_ADDRESS_JUMP_LINE (16)
+#define GBA_MEMVIEWER_MAX_COLUMNS       (69)
 
 #define GBA_MEMVIEWER_8  0
 #define GBA_MEMVIEWER_16 1
 #define GBA_MEMVIEWER_32 2
+#define GBA_MEMVIEWER_HEATMAP 3
 
 static int gba_memviewer_mode = GBA_MEMVIEWER_32;
 
@@ -48,17 +54,19 @@ static u32 gba_memviewer_clicked_address;
 static _gui_console gba_memview_con;
 static _gui_element gba_memview_textbox;
 
-static _gui_element gba_memview_goto_btn;
+static _gui_element gba_memview_dump_btn, gba_memview_goto_btn;
 
 static _gui_element gba_memview_mode_8_radbtn, gba_memview_mode_16_radbtn,
-                    gba_memview_mode_32_radbtn;
+                    gba_memview_mode_32_radbtn, gba_memview_mode_heatmap_radbtn;
 
 static _gui_element *gba_memviwer_window_gui_elements[] = {
     &gba_memview_textbox,
+    &gba_memview_dump_btn,
     &gba_memview_goto_btn,
     &gba_memview_mode_8_radbtn,
     &gba_memview_mode_16_radbtn,
     &gba_memview_mode_32_radbtn,
+    &gba_memview_mode_heatmap_radbtn,
     NULL
 };
 
@@ -81,133 +89,312 @@ static char win_gba_memviewer_character_fix(char c)
     return '.';
 }
 
-void Win_GBAMemViewerUpdate(void)
+// The bytes shown in the window the last time it was updated. Only the lines
+// that have changed are printed again. The bytes that change are highlighted
+// for a few frames.
+
+#define GBA_MEMVIEWER_HIGHLIGHT_FRAMES  (30)
+#define GBA_MEMVIEWER_HIGHLIGHT_COLOR   (0xFF8080FF)
+
+#define GBA_MEMVIEWER_SNAPSHOT_SIZE \
+        (GBA_MEMVIEWER_MAX_LINES * GBA_MEMVIEWER_ADDRESS_JUMP_LINE)
+
+static u8 gba_memviewer_snapshot[GBA_MEMVIEWER_SNAPSHOT_SIZE];
+static u8 gba_memviewer_highlight[GBA_MEMVIEWER_SNAPSHOT_SIZE];
+static u32 gba_memviewer_snapshot_address;
+static int gba_memviewer_snapshot_mode = -1; // -1 = Invalid snapshot
+
+static char *_win_gba_mem_viewer_hex(char *dst, u32 value, int digits)
 {
-    if (GBAMemViewerCreated == 0)
-        return;
+    static const char hex[] = "0123456789ABCDEF";
 
-    if (Win_MainRunningGBA() == 0)
-        return;
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        dst[i] = hex[value & 0xF];
+        value >>= 4;
+    }
 
-    GUI_ConsoleClear(&gba_memview_con);
+    return dst + digits;
+}
 
-    u32 address = gba_memviewer_start_address;
+static void _win_gba_mem_viewer_print_line(int line)
+{
+    u32 address = gba_memviewer_snapshot_address
+                  + line * GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+    const u8 *data =
+            &gba_memviewer_snapshot[line * GBA_MEMVIEWER_ADDRESS_JUMP_LINE];
+    const u8 *highlight =
+            &gba_memviewer_highlight[line * GBA_MEMVIEWER_ADDRESS_JUMP_LINE];
 
-    char textbuf[300];
+    int size = 1 << gba_memviewer_mode; // Size of each value in bytes
 
-    if (gba_memviewer_mode == GBA_MEMVIEWER_32)
+    char textbuf[100];
+    char *ptr = textbuf;
+
+    ptr = _win_gba_mem_viewer_hex(ptr, address, 8);
+    *ptr++ = ' ';
+    *ptr++ = ':';
+    *ptr++ = ' ';
+
+    int values_x = ptr - textbuf;
+
+    for (int j = 0; j < GBA_MEMVIEWER_ADDRESS_JUMP_LINE; j += size)
     {
-        for (int i = 0; i < GBA_MEMVIEWER_MAX_LINES; i++)
-        {
-            snprintf(textbuf, sizeof(textbuf), "%08X : ", address);
+        u32 value = 0;
+        for (int k = size - 1; k >= 0; k--)
+            value = (value << 8) | data[j + k];
 
-            u32 tmpaddr = address;
+        ptr = _win_gba_mem_viewer_hex(ptr, value, size * 2);
+        *ptr++ = ' ';
+    }
 
-            for (int j = 0; j < 4; j++)
-            {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%08X ",
-                         GBA_MemoryReadFast32(tmpaddr));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr += 4;
-            }
-            s_strncat(textbuf, ": ", sizeof(textbuf));
+    *ptr++ = ':';
+    *ptr++ = ' ';
 
-            tmpaddr = address;
+    int chars_x = ptr - textbuf;
 
-            for (int j = 0; j < 16; j++)
-            {
-                char tmp[30];
-                u8 val = GBA_MemoryReadFast8(tmpaddr);
-                snprintf(tmp, sizeof(tmp), "%c",
-                         win_gba_memviewer_character_fix(val));
+    for (int j = 0; j < GBA_MEMVIEWER_ADDRESS_JUMP_LINE; j++)
+    {
+        *ptr++ = win_gba_memviewer_character_fix(data[j]);
+        if ((j & 3) == 3)
+            *ptr++ = ' ';
+    }
 
-                if ((j & 3) == 3)
-                    s_strncat(tmp, " ", sizeof(tmp));
+    // Lines that don't fit in the window are cut. They mustn't continue in
+    // the next line, it may not be printed again.
+    int len = ptr - textbuf;
+    if (len > GBA_MEMVIEWER_MAX_COLUMNS)
+        len = GBA_MEMVIEWER_MAX_COLUMNS;
+    textbuf[len] = '\0';
 
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
-            }
+    GUI_ConsoleModePrintf(&gba_memview_con, 0, line, "%s", textbuf);
+    GUI_ConsoleColorizeRange(&gba_memview_con, 0, line, len, 0xFFFFFFFF);
 
-            GUI_ConsoleModePrintf(&gba_memview_con, 0, i, textbuf);
+    for (int j = 0; j < GBA_MEMVIEWER_ADDRESS_JUMP_LINE; j++)
+    {
+        if (highlight[j] == 0)
+            continue;
+
+        int value_index = j / size;
+        GUI_ConsoleColorizeRange(&gba_memview_con,
+                                 values_x + value_index * (size * 2 + 1),
+                                 line, size * 2,
+                                 GBA_MEMVIEWER_HIGHLIGHT_COLOR);
+        GUI_ConsoleColorizeRange(&gba_memview_con, chars_x + j + (j / 4),
+                                 line, 1, GBA_MEMVIEWER_HIGHLIGHT_COLOR);
+    }
+}
 
-            address += GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+// In heatmap mode each line shows the accesses to 32 buckets of 256 bytes. The
+// heatmap runs while the window is in this mode, and it is printed again every
+// few frames.
+
+#define GBA_MEMVIEWER_HEATMAP_BUCKETS   (32)
+#define GBA_MEMVIEWER_HEATMAP_FRAMES    (30)
+
+static int gba_memviewer_heatmap_line;
+static int gba_memviewer_heatmap_frames;
+
+static void _win_gba_mem_viewer_heatmap_scroll(int lines)
+{
+    int last = Heatmap_GetLineCount(GBA_MEMVIEWER_HEATMAP_BUCKETS)
+               - GBA_MEMVIEWER_MAX_LINES;
+
+    gba_memviewer_heatmap_line += lines;
+    if (gba_memviewer_heatmap_line > last)
+        gba_memviewer_heatmap_line = last;
+    if (gba_memviewer_heatmap_line < 0)
+        gba_memviewer_heatmap_line = 0;
+}
+
+static void _win_gba_mem_viewer_heatmap_goto(u32 address)
+{
+    int lines = Heatmap_GetLineCount(GBA_MEMVIEWER_HEATMAP_BUCKETS);
+
+    for (int i = 0; i < lines; i++)
+    {
+        int region, count;
+        u32 offset, bank;
+
+        Heatmap_GetLine(i, GBA_MEMVIEWER_HEATMAP_BUCKETS, &region, &offset,
+                        &count);
+
+        u32 start = Heatmap_GetAddress(region, offset, &bank);
+        if ((address >= start)
+            && (address < start + (count << HEATMAP_BUCKET_SHIFT)))
+        {
+            gba_memviewer_heatmap_line = i;
+            _win_gba_mem_viewer_heatmap_scroll(0);
+            return;
         }
     }
-    else if (gba_memviewer_mode == GBA_MEMVIEWER_16)
+}
+
+static void _win_gba_mem_viewer_heatmap_print_line(int line, u64 max)
+{
+    int region, count;
+    u32 offset;
+
+    if (Heatmap_GetLine(gba_memviewer_heatmap_line + line,
+                        GBA_MEMVIEWER_HEATMAP_BUCKETS, &region, &offset,
+                        &count))
+        return;
+
+    const _heatmap_region_t *r = Heatmap_GetRegion(region);
+    const _heatmap_bucket_t *buckets =
+            &Heatmap_GetBuckets(region)[offset >> HEATMAP_BUCKET_SHIFT];
+
+    char textbuf[100];
+    char *ptr = textbuf;
+
+    u32 bank;
+    u32 address = Heatmap_GetAddress(region, offset, &bank);
+    ptr = _win_gba_mem_viewer_hex(ptr, address, 8);
+    *ptr++ = ' ';
+
+    int cells_x = ptr - textbuf;
+
+    int levels[GBA_MEMVIEWER_HEATMAP_BUCKETS];
+    u64 reads = 0;
+    u64 writes = 0;
+
+    for (int j = 0; j < GBA_MEMVIEWER_HEATMAP_BUCKETS; j++)
     {
-        for (int i = 0; i < GBA_MEMVIEWER_MAX_LINES; i++)
+        if (j >= count)
         {
-            snprintf(textbuf, sizeof(textbuf), "%08X : ", address);
+            *ptr++ = ' ';
+            continue;
+        }
 
-            u32 tmpaddr = address;
-            for (int j = 0; j < 8; j++)
-            {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%04X ",
-                         GBA_MemoryReadFast16(tmpaddr));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr += 2;
-            }
-            s_strncat(textbuf, ": ", sizeof(textbuf));
+        levels[j] = Heatmap_GetLevel(&buckets[j], max);
+        *ptr++ = Heatmap_GetCharacter(levels[j]);
+        reads += buckets[j].reads;
+        writes += buckets[j].writes;
+    }
 
-            tmpaddr = address;
-            for (int j = 0; j < 16; j++)
-            {
-                char tmp[30];
-                u8 val = GBA_MemoryReadFast8(tmpaddr);
-                snprintf(tmp, sizeof(tmp), "%c",
-                         win_gba_memviewer_character_fix(val));
+    char reads_text[10], writes_text[10];
+    Heatmap_FormatCount(reads_text, sizeof(reads_text), reads);
+    Heatmap_FormatCount(writes_text, sizeof(writes_text), writes);
 
-                if ((j & 3) == 3)
-                    s_strncat(tmp, " ", sizeof(tmp));
+    snprintf(ptr, sizeof(textbuf) - (ptr - textbuf), " R %4s W %4s %s",
+             reads_text, writes_text, r->name);
 
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
-            }
+    int len = strlen(textbuf);
+    if (len > GBA_MEMVIEWER_MAX_COLUMNS)
+        len = GBA_MEMVIEWER_MAX_COLUMNS;
+    textbuf[len] = '\0';
 
-            GUI_ConsoleModePrintf(&gba_memview_con, 0, i, textbuf);
+    GUI_ConsoleModePrintf(&gba_memview_con, 0, line, "%s", textbuf);
+    GUI_ConsoleColorizeRange(&gba_memview_con, 0, line, len, 0xFFFFFFFF);
 
-            address += GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
-        }
+    for (int j = 0; j < count; j++)
+    {
+        GUI_ConsoleColorizeRange(&gba_memview_con, cells_x + j, line, 1,
+                                 Heatmap_GetColor(&buckets[j], levels[j]));
     }
-    else if (gba_memviewer_mode == GBA_MEMVIEWER_8)
+}
+
+static int _win_gba_mem_viewer_heatmap_refresh(int every_frame)
+{
+    if (every_frame)
     {
-        for (int i = 0; i < GBA_MEMVIEWER_MAX_LINES; i++)
+        gba_memviewer_heatmap_frames++;
+        if (gba_memviewer_heatmap_frames < GBA_MEMVIEWER_HEATMAP_FRAMES)
+            return 0;
+    }
+
+    gba_memviewer_heatmap_frames = 0;
+
+    // It is stopped when the ROM is unloaded
+    if (heatmap_enabled == 0)
+        GBA_MemoryHeatmapSetEnabled(1);
+
+    _win_gba_mem_viewer_heatmap_scroll(0);
+
+    u64 max = Heatmap_GetMax();
+
+    GUI_ConsoleClear(&gba_memview_con);
+
+    for (int i = 0; i < GBA_MEMVIEWER_MAX_LINES; i++)
+        _win_gba_mem_viewer_heatmap_print_line(i, max);
+
+    // The hexadecimal view has to be printed again when it is selected
+    gba_memviewer_snapshot_mode = -1;
+
+    return 1;
+}
+
+// If called every frame, only the lines that have changed are printed. If not,
+// all of them are printed. Returns 1 if the window has to be drawn again.
+static int _win_gba_mem_viewer_refresh(int every_frame)
+{
+    if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+        return _win_gba_mem_viewer_heatmap_refresh(every_frame);
+
+    u8 data[GBA_MEMVIEWER_SNAPSHOT_SIZE];
+
+    for (int i = 0; i < GBA_MEMVIEWER_SNAPSHOT_SIZE; i++)
+        data[i] = GBA_MemoryReadFast8(gba_memviewer_start_address + i);
+
+    int same_view = (gba_memviewer_snapshot_mode == gba_memviewer_mode)
+                    && (gba_memviewer_snapshot_address
+                        == gba_memviewer_start_address);
+
+    if (same_view == 0)
+    {
+        GUI_ConsoleClear(&gba_memview_con);
+        memset(gba_memviewer_highlight, 0, sizeof(gba_memviewer_highlight));
+        every_frame = 0;
+    }
+
+    gba_memviewer_snapshot_address = gba_memviewer_start_address;
+    gba_memviewer_snapshot_mode = gba_memviewer_mode;
+
+    int redraw = 0;
+
+    for (int i = 0; i < GBA_MEMVIEWER_MAX_LINES; i++)
+    {
+        int changed = (every_frame == 0);
+
+        for (int j = 0; j < GBA_MEMVIEWER_ADDRESS_JUMP_LINE; j++)
         {
-            snprintf(textbuf, sizeof(textbuf), "%08X : ", address);
+            int index = i * GBA_MEMVIEWER_ADDRESS_JUMP_LINE + j;
 
-            u32 tmpaddr = address;
-            for (int j = 0; j < 16; j++)
+            if (same_view && (data[index] != gba_memviewer_snapshot[index]))
             {
-                char tmp[30];
-                snprintf(tmp, sizeof(tmp), "%02X ",
-                         GBA_MemoryReadFast8(tmpaddr));
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
+                gba_memviewer_highlight[index] = GBA_MEMVIEWER_HIGHLIGHT_FRAMES;
+                changed = 1;
             }
-            s_strncat(textbuf, ": ", sizeof(textbuf));
-
-            tmpaddr = address;
-            for (int j = 0; j < 16; j++)
+            else if (every_frame && gba_memviewer_highlight[index])
             {
-                char tmp[30];
-                u8 val = GBA_MemoryReadFast8(tmpaddr);
-                snprintf(tmp, sizeof(tmp), "%c",
-                         win_gba_memviewer_character_fix(val));
-
-                if ((j & 3) == 3)
-                    s_strncat(tmp, " ", sizeof(tmp));
-
-                s_strncat(textbuf, tmp, sizeof(textbuf));
-                tmpaddr++;
+                gba_memviewer_highlight[index]--;
+                if (gba_memviewer_highlight[index] == 0)
+                    changed = 1;
             }
+        }
 
-            GUI_ConsoleModePrintf(&gba_memview_con, 0, i, textbuf);
-
-            address += GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+        if (changed)
+        {
+            memcpy(&gba_memviewer_snapshot[i * GBA_MEMVIEWER_ADDRESS_JUMP_LINE],
+                   &data[i * GBA_MEMVIEWER_ADDRESS_JUMP_LINE],
+                   GBA_MEMVIEWER_ADDRESS_JUMP_LINE);
+            _win_gba_mem_viewer_print_line(i);
+            redraw = 1;
         }
     }
+
+    return redraw;
+}
+
+void Win_GBAMemViewerUpdate(void)
+{
+    if (GBAMemViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    _win_gba_mem_viewer_refresh(0);
 }
 
 //----------------------------------------------------------------
@@ -228,6 +415,18 @@ void Win_GBAMemViewerRender(void)
     WH_Render(WinIDGBAMemViewer, buffer);
 }
 
+void Win_GBAMemViewerAutoUpdate(void)
+{
+    if (GBAMemViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    if (_win_gba_mem_viewer_refresh(1))
+        Win_GBAMemViewerRender();
+}
+
 static int _win_gba_mem_viewer_callback(SDL_Event *e)
 {
     if (GBAMemViewerCreated == 0)
@@ -241,8 +440,15 @@ static int _win_gba_mem_viewer_callback(SDL_Event *e)
     {
         if (e->type == SDL_MOUSEWHEEL)
         {
-            gba_memviewer_start_address -=
-                    e->wheel.y * 3 * GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+            if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+            {
+                _win_gba_mem_viewer_heatmap_scroll(-e->wheel.y * 3);
+            }
+            else
+            {
+                gba_memviewer_start_address -=
+                        e->wheel.y * 3 * GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+            }
             redraw = 1;
         }
         else if (e->type == SDL_KEYDOWN)
@@ -255,14 +461,20 @@ static int _win_gba_mem_viewer_callback(SDL_Event *e)
                     break;
 
                 case SDLK_DOWN:
-                    gba_memviewer_start_address +=
-                            GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+                    if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+                        _win_gba_mem_viewer_heatmap_scroll(1);
+                    else
+                        gba_memviewer_start_address +=
+                                GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
                     redraw = 1;
                     break;
 
                 case SDLK_UP:
-                    gba_memviewer_start_address -=
-                            GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
+                    if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+                        _win_gba_mem_viewer_heatmap_scroll(-1);
+                    else
+                        gba_memviewer_start_address -=
+                                GBA_MEMVIEWER_ADDRESS_JUMP_LINE;
                     redraw = 1;
                     break;
             }
@@ -299,6 +511,9 @@ static int _win_gba_mem_viewer_callback(SDL_Event *e)
     {
         GBAMemViewerCreated = 0;
 
+        if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+            GBA_MemoryHeatmapSetEnabled(0);
+
         if (GUI_InputWindowIsEnabled(&gui_iw_gba_memviewer))
             GUI_InputWindowClose(&gui_iw_gba_memviewer);
 
@@ -326,6 +541,8 @@ static void _win_gba_mem_viewer_inputwindow_callback(char *text, int is_valid)
         {
             text[8] = '\0';
             u32 newvalue = asciihex_to_int(text);
+            if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+                _win_gba_mem_viewer_heatmap_goto(newvalue);
             newvalue &= ~(GBA_MEMVIEWER_ADDRESS_JUMP_LINE - 1);
             gba_memviewer_start_address = newvalue;
         }
@@ -355,6 +572,9 @@ static void _win_gba_mem_viewer_inputwindow_callback(char *text, int is_valid)
 
 static void _win_gba_mem_view_textbox_callback(int x, int y)
 {
+    if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+        return;
+
     int xtile = x / FONT_WIDTH;
     int ytile = y / FONT_HEIGHT;
 
@@ -428,6 +648,20 @@ static void _win_gba_mem_view_textbox_callback(int x, int y)
 
 static void _win_gba_mem_viewer_mode_radiobtn_callback(int btn_id)
 {
+    if ((btn_id == GBA_MEMVIEWER_HEATMAP)
+        && (gba_memviewer_mode != GBA_MEMVIEWER_HEATMAP))
+    {
+        if (Win_MainRunningGBA())
+            GBA_MemoryHeatmapSetEnabled(1);
+        gba_memviewer_heatmap_line = 0;
+        gba_memviewer_heatmap_frames = 0;
+    }
+    else if ((btn_id != GBA_MEMVIEWER_HEATMAP)
+             && (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP))
+    {
+        GBA_MemoryHeatmapSetEnabled(0);
+    }
+
     gba_memviewer_mode = btn_id;
     Win_GBAMemViewerUpdate();
 }
@@ -445,6 +679,83 @@ static void _win_gba_mem_viewer_goto(void)
                         _win_gba_mem_viewer_inputwindow_callback);
 }
 
+// The region that contains the first address shown in the viewer is saved both
+// as a binary file and as a text file.
+static void _win_gba_mem_viewer_dump(void)
+{
+    if (GBAMemViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    u32 address;
+    const void *data;
+    u32 size;
+
+    switch (gba_memviewer_start_address >> 24)
+    {
+        case 0x00:
+            address = 0x00000000;
+            data = Mem.rom_bios;
+            size = 16 * 1024;
+            break;
+        case 0x02:
+            address = 0x02000000;
+            data = Mem.ewram;
+            size = sizeof(Mem.ewram);
+            break;
+        case 0x03:
+            address = 0x03000000;
+            data = Mem.iwram;
+            size = sizeof(Mem.iwram);
+            break;
+        case 0x04:
+            address = 0x04000000;
+            data = Mem.io_regs;
+            size = sizeof(Mem.io_regs);
+            break;
+        case 0x05:
+            address = 0x05000000;
+            data = Mem.pal_ram;
+            size = sizeof(Mem.pal_ram);
+            break;
+        case 0x06:
+            address = 0x06000000;
+            data = Mem.vram;
+            size = 96 * 1024;
+            break;
+        case 0x07:
+            address = 0x07000000;
+            data = Mem.oam;
+            size = sizeof(Mem.oam);
+            break;
+        case 0x08:
+        case 0x09:
+        case 0x0A:
+        case 0x0B:
+        case 0x0C:
+        case 0x0D:
+            // All the wait state mirrors point to the same ROM
+            address = gba_memviewer_start_address & 0x0E000000;
+            data = Mem.rom_wait0;
+            size = GBA_GetRomSize();
+            break;
+        default:
+            Debug_ErrorMsgArg("Nothing to dump at address 0x%08X",
+                              gba_memviewer_start_address);
+            return;
+    }
+
+    _dump_region_t region = { DUMP_FORMAT_RAW, address, 0, 0 };
+    Dump_Start(FU_GetNewTimestampFilenameExt("dump", "bin"), &region,
+               data, size);
+
+    region.format = DUMP_FORMAT_HEX;
+    Dump_Start(FU_GetNewTimestampFilenameExt("dump", "txt"), &region,
+               data, size);
+}
+
 //------------------------------------------------------------------------------
 
 int Win_GBAMemViewerCreate(void)
@@ -470,14 +781,22 @@ int Win_GBAMemViewerCreate(void)
                        18 + 18 * FONT_WIDTH + 12, 6, 9 * FONT_WIDTH, 24,
                        "32 bits", 0, GBA_MEMVIEWER_32, 1,
                        _win_gba_mem_viewer_mode_radiobtn_callback);
+    GUI_SetRadioButton(&gba_memview_mode_heatmap_radbtn,
+                       30 + 27 * FONT_WIDTH + 12, 6, 9 * FONT_WIDTH, 24,
+                       "Heatmap", 0, GBA_MEMVIEWER_HEATMAP, 0,
+                       _win_gba_mem_viewer_mode_radiobtn_callback);
 
+    GUI_SetButton(&gba_memview_dump_btn,
+                  68 + 31 * FONT_WIDTH + 30, 6, 8 * FONT_WIDTH, 24,
+                  "Dump", _win_gba_mem_viewer_dump);
     GUI_SetButton(&gba_memview_goto_btn,
                   68 + 39 * FONT_WIDTH + 36, 6, 16 * FONT_WIDTH, 24,
                   "Goto (F8)", _win_gba_mem_viewer_goto);
 
     GUI_SetTextBox(&gba_memview_textbox, &gba_memview_con,
                    6, 36,
-                   69 * FONT_WIDTH, GBA_MEMVIEWER_MAX_LINES * FONT_HEIGHT,
+                   GBA_MEMVIEWER_MAX_COLUMNS * FONT_WIDTH,
+                   GBA_MEMVIEWER_MAX_LINES * FONT_HEIGHT,
                    _win_gba_mem_view_textbox_callback);
 
     GUI_InputWindowClose(&gui_iw_gba_memviewer);
@@ -488,6 +807,8 @@ int Win_GBAMemViewerCreate(void)
 
     gba_memviewer_mode = GBA_MEMVIEWER_32;
 
+    gba_memviewer_snapshot_mode = -1;
+
     WinIDGBAMemViewer = WH_Create(WIN_GBA_MEMVIEWER_WIDTH,
                                   WIN_GBA_MEMVIEWER_HEIGHT, 0, 0, 0);
     WH_SetCaption(WinIDGBAMemViewer, "GBA Memory Viewer");
@@ -506,5 +827,9 @@ void Win_GBAMemViewerClose(void)
         return;
 
     GBAMemViewerCreated = 0;
+
+    if (gba_memviewer_mode == GBA_MEMVIEWER_HEATMAP)
+        GBA_MemoryHeatmapSetEnabled(0);
+
     WH_Close(WinIDGBAMemViewer);
 }
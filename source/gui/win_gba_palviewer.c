@@ -111,6 +111,10 @@ void Win_GBAPalViewerUpdate(void)
     if (Win_MainRunningGBA() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_PALVIEWER,
+                         0, sizeof(Mem.pal_ram));
+
     GUI_ConsoleClear(&gba_palview_con);
 
     u32 address = 0x05000000 + (gba_palview_sprpal * (256 * 2))
@@ -187,6 +191,22 @@ static void _win_gba_pal_viewer_render(void)
     WH_Render(WinIDGBAPalViewer, buffer);
 }
 
+void Win_GBAPalViewerAutoUpdate(void)
+{
+    if (GBAPalViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    if (GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_PALVIEWER,
+                             0, sizeof(Mem.pal_ram)))
+    {
+        Win_GBAPalViewerUpdate();
+        _win_gba_pal_viewer_render();
+    }
+}
+
 static int _win_gba_pal_viewer_callback(SDL_Event *e)
 {
     if (GBAPalViewerCreated == 0)
@@ -278,7 +298,8 @@ static void _win_gba_palviewer_dump_btn_callback(void)
     }
 
     char *name_bg = FU_GetNewTimestampFilename("gba_palette_bg");
-    Save_PNG(name_bg, GBA_PAL_BUFFER_SIDE, GBA_PAL_BUFFER_SIDE, buffer_temp, 0);
+    Save_PNG_Async(name_bg, GBA_PAL_BUFFER_SIDE, GBA_PAL_BUFFER_SIDE,
+                   buffer_temp, 0);
 
     src = gba_pal_spr_buffer;
     dst = buffer_temp;
@@ -291,8 +312,8 @@ static void _win_gba_palviewer_dump_btn_callback(void)
     }
 
     char *name_spr = FU_GetNewTimestampFilename("gba_palette_spr");
-    Save_PNG(name_spr, GBA_PAL_BUFFER_SIDE, GBA_PAL_BUFFER_SIDE,
-             buffer_temp, 0);
+    Save_PNG_Async(name_spr, GBA_PAL_BUFFER_SIDE, GBA_PAL_BUFFER_SIDE,
+                   buffer_temp, 0);
 
     Win_GBAPalViewerUpdate();
 }
@@ -51,6 +51,8 @@ static char gba_spr_zoomed_buffer[GBA_SPR_ZOOMED_BUFFER_WIDTH *
 
 static u32 gba_sprview_selected_matrix = 0;
 
+static u16 gba_sprview_dispcnt = 0; // Value when the window was last updated
+
 //------------------------------------------------------------------------------
 
 static _gui_console gba_sprview_con;
@@ -99,6 +101,16 @@ void Win_GBASprViewerUpdate(void)
     if (Win_MainRunningGBA() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_SPRVIEWER,
+                         0, sizeof(Mem.pal_ram));
+    GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM, GBA_DIRTY_USER_SPRVIEWER,
+                         0, sizeof(Mem.vram));
+    GBA_MemoryDirtyCheck(GBA_DIRTY_OAM, GBA_DIRTY_USER_SPRVIEWER,
+                         0, sizeof(Mem.oam));
+
+    gba_sprview_dispcnt = REG_DISPCNT;
+
     GUI_ConsoleClear(&gba_sprview_con);
 
     static const int spr_size[4][4][2] = { // Shape, size, (x,y)
@@ -304,6 +316,33 @@ static void _win_gba_spr_viewer_render(void)
     WH_Render(WinIDGBASprViewer, buffer);
 }
 
+void Win_GBASprViewerAutoUpdate(void)
+{
+    if (GBASprViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    // The mode and the sprite mapping mode change how the tiles are read
+    int changed = (REG_DISPCNT & (BIT(6) | 0x7)) != (gba_sprview_dispcnt
+                                                    & (BIT(6) | 0x7));
+
+    // Only the sprite palettes and tiles are used
+    changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_SPRVIEWER,
+                                    256 * 2, 256 * 2);
+    changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM, GBA_DIRTY_USER_SPRVIEWER,
+                                    0x10000, 0x8000);
+    changed |= GBA_MemoryDirtyCheck(GBA_DIRTY_OAM, GBA_DIRTY_USER_SPRVIEWER,
+                                    0, sizeof(Mem.oam));
+
+    if (changed)
+    {
+        Win_GBASprViewerUpdate();
+        _win_gba_spr_viewer_render();
+    }
+}
+
 static int _win_gba_spr_viewer_callback(SDL_Event *e)
 {
     if (GBASprViewerCreated == 0)
@@ -370,8 +409,8 @@ static void _win_gba_sprviewer_page_dump_btn_callback(void)
                          ? FU_GetNewTimestampFilename("gba_sprite_page0")
                          : FU_GetNewTimestampFilename("gba_sprite_page1");
 
-    Save_PNG(name, GBA_SPR_ALLSPR_BUFFER_WIDTH, GBA_SPR_ALLSPR_BUFFER_HEIGHT,
-             pagebuf, 1);
+    Save_PNG_Async(name, GBA_SPR_ALLSPR_BUFFER_WIDTH,
+                   GBA_SPR_ALLSPR_BUFFER_HEIGHT, pagebuf, 1);
 
     //Win_GBASprViewerUpdate();
 }
@@ -397,8 +436,8 @@ static void _win_gba_sprviewer_allspr_dump_btn_callback(void)
 
     char *name = FU_GetNewTimestampFilename("gba_sprite_all");
 
-    Save_PNG(name, GBA_SPR_ALLSPR_BUFFER_WIDTH,
-             (GBA_SPR_ALLSPR_BUFFER_HEIGHT * 2) - 16, allbuf, 1);
+    Save_PNG_Async(name, GBA_SPR_ALLSPR_BUFFER_WIDTH,
+                   (GBA_SPR_ALLSPR_BUFFER_HEIGHT * 2) - 16, allbuf, 1);
 
     free(allbuf);
 
@@ -431,7 +470,7 @@ static void _win_gba_sprviewer_zoomed_dump_btn_callback(void)
                                   sx, sy, 0, 0, sx, sy);
 
     char *name = FU_GetNewTimestampFilename("gba_sprite");
-    Save_PNG(name, sx, sy, buf, 1);
+    Save_PNG_Async(name, sx, sy, buf, 1);
 
     //Win_GBASprViewerUpdate();
 }
@@ -20,6 +20,7 @@
 #include "win_utils.h"
 
 #include "../gba_core/gba_debug_video.h"
+#include "../gba_core/memory.h"
 
 //------------------------------------------------------------------------------
 
@@ -141,6 +142,25 @@ static void _win_gba_tileviewer_colors_radbtn_callback(int num)
 
 //----------------------------------------------------------------
 
+// Draws the parts of the window that depend on the selected tile
+static void _win_gba_tileviewer_update_selection(void)
+{
+    GUI_Draw_SetDrawingColor(255, 0, 0);
+    int l = (gba_tileview_selected_index % 32) * 8; // Left
+    int t = (gba_tileview_selected_index / 32) * 8; // Top
+    int r = l + 7;                                  // Right
+    int b = t + 7;                                  // Bottom
+    GUI_Draw_Rect(gba_tile_buffer,
+                  GBA_TILE_BUFFER_WIDTH, GBA_TILE_BUFFER_HEIGHT,
+                  l, r, t, b);
+
+    GBA_Debug_TilePrint64x64(gba_tile_zoomed_tile_buffer, 64, 64,
+                             gba_tileview_selected_cbb,
+                             gba_tileview_selected_index,
+                             gba_tileview_selected_colors,
+                             gba_tileview_selected_pal);
+}
+
 void Win_GBATileViewerUpdate(void)
 {
     if (GBATileViewerCreated == 0)
@@ -149,6 +169,12 @@ void Win_GBATileViewerUpdate(void)
     if (Win_MainRunningGBA() == 0)
         return;
 
+    // Everything is redrawn, so the changes until now don't matter
+    GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_TILEVIEWER,
+                         0, sizeof(Mem.pal_ram));
+    GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM, GBA_DIRTY_USER_TILEVIEWER,
+                         0, sizeof(Mem.vram));
+
     GUI_ConsoleClear(&gba_tileview_con);
 
     u32 address = gba_tileview_selected_cbb
@@ -169,20 +195,50 @@ void Win_GBATileViewerUpdate(void)
                          gba_tileview_selected_colors,
                          gba_tileview_selected_pal);
 
-    GUI_Draw_SetDrawingColor(255, 0, 0);
-    int l = (gba_tileview_selected_index % 32) * 8; // Left
-    int t = (gba_tileview_selected_index / 32) * 8; // Top
-    int r = l + 7;                                  // Right
-    int b = t + 7;                                  // Bottom
-    GUI_Draw_Rect(gba_tile_buffer,
-                  GBA_TILE_BUFFER_WIDTH, GBA_TILE_BUFFER_HEIGHT,
-                  l, r, t, b);
+    _win_gba_tileviewer_update_selection();
+}
 
-    GBA_Debug_TilePrint64x64(gba_tile_zoomed_tile_buffer, 64, 64,
-                             gba_tileview_selected_cbb,
-                             gba_tileview_selected_index,
-                             gba_tileview_selected_colors,
-                             gba_tileview_selected_pal);
+// Returns 1 if any tile has been redrawn
+static int _win_gba_tileviewer_update_changed_tiles(void)
+{
+    // A change in the palette affects all tiles
+    if (GBA_MemoryDirtyCheck(GBA_DIRTY_PAL, GBA_DIRTY_USER_TILEVIEWER,
+                             0, sizeof(Mem.pal_ram)))
+    {
+        Win_GBATileViewerUpdate();
+        return 1;
+    }
+
+    u32 tile_size = (gba_tileview_selected_colors == 256) ? 64 : 32;
+    u32 page_size = 1 << GBA_DIRTY_PAGE_SHIFT;
+    u32 tiles_per_page = page_size / tile_size;
+    u32 base = gba_tileview_selected_cbb - 0x06000000;
+
+    int changed = 0;
+
+    for (u32 tile = 0; tile < 1024; tile += tiles_per_page)
+    {
+        if (GBA_MemoryDirtyCheck(GBA_DIRTY_VRAM, GBA_DIRTY_USER_TILEVIEWER,
+                                 base + tile * tile_size, page_size) == 0)
+        {
+            continue;
+        }
+
+        for (u32 i = tile; i < tile + tiles_per_page; i++)
+        {
+            GBA_Debug_PrintTile(gba_tile_buffer, GBA_TILE_BUFFER_WIDTH,
+                                gba_tileview_selected_cbb,
+                                gba_tileview_selected_colors,
+                                gba_tileview_selected_pal, i);
+        }
+
+        changed = 1;
+    }
+
+    if (changed)
+        _win_gba_tileviewer_update_selection();
+
+    return changed;
 }
 
 //----------------------------------------------------------------
@@ -248,6 +304,18 @@ static int _win_gba_tile_viewer_callback(SDL_Event *e)
     return 0;
 }
 
+void Win_GBATileViewerAutoUpdate(void)
+{
+    if (GBATileViewerCreated == 0)
+        return;
+
+    if (Win_MainRunningGBA() == 0)
+        return;
+
+    if (_win_gba_tileviewer_update_changed_tiles())
+        _win_gba_tile_viewer_render();
+}
+
 //----------------------------------------------------------------
 
 static void _win_gba_tileviewer_dump_btn_callback(void)
@@ -266,7 +334,7 @@ static void _win_gba_tileviewer_dump_btn_callback(void)
                               gba_tileview_selected_pal);
 
     char *name = FU_GetNewTimestampFilename("gba_tiles");
-    Save_PNG(name, GBA_TILE_BUFFER_WIDTH, GBA_TILE_BUFFER_HEIGHT, buf, 1);
+    Save_PNG_Async(name, GBA_TILE_BUFFER_WIDTH, GBA_TILE_BUFFER_HEIGHT, buf, 1);
 
     free(buf);
 
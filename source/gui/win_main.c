@@ -5,9 +5,13 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <SDL.h>
+#include <SDL_opengl.h>
 
 #include "win_main.h"
 #include "win_main_config.h"
@@ -15,15 +19,31 @@
 #include "win_utils.h"
 
 #include "../build_options.h"
+#include "../checkpoint_utils.h"
 #include "../config.h"
 #include "../debug_utils.h"
+#include "../emuthread_utils.h"
 #include "../file_explorer.h"
 #include "../file_utils.h"
 #include "../font_utils.h"
+#include "../framepace_utils.h"
 #include "../general_utils.h"
 #include "../input_utils.h"
+#include "../latency_utils.h"
+#include "../movie_utils.h"
+#include "../opprofile_utils.h"
+#include "../pcprofile_utils.h"
+#include "../profile_utils.h"
+#include "../trace_utils.h"
+#include "../rewind_utils.h"
+#include "../romcache_utils.h"
+#include "../savestate_utils.h"
+#include "../sharedout_utils.h"
 #include "../sound_utils.h"
+#include "../stream_utils.h"
+#include "../videorecord_utils.h"
 #include "../window_handler.h"
+#include "../zip_utils.h"
 
 #include "../gb_core/camera.h"
 #include "../gb_core/debug.h"
@@ -37,6 +57,7 @@
 #include "../gba_core/bios.h"
 #include "../gba_core/disassembler.h"
 #include "../gba_core/gba.h"
+#include "../gba_core/gpio.h"
 #include "../gba_core/rom.h"
 #include "../gba_core/save.h"
 #include "../gba_core/sound.h"
@@ -54,13 +75,92 @@ static int WinIDMain = -1;
 static int _win_main_frameskip = 0;
 static int _win_main_frameskipcount = 0;
 
+// With automatic frameskip, the time it takes to run and present drawn frames
+// and to run skipped frames is measured. After each drawn frame, the frameskip
+// is set to the lowest value that lets the average time per frame fit in the
+// duration of a frame of the console.
+#define WIN_MAIN_AUTO_FRAMESKIP_MAX     (4)
+#define WIN_MAIN_FRAME_MS               (1000.0 / 60.0)
+
+static int _win_main_frameskip_auto = 0;
+static double _win_main_drawn_frame_ms = 0.0; // Moving averages
+static double _win_main_skipped_frame_ms = 0.0;
+
+static Uint64 _win_main_frame_start;
+static int _win_main_frame_skipped = -1; // -1 if it isn't being measured
+
 void Win_MainSetFrameskip(int frameskip)
 {
-    if (_win_main_frameskip == frameskip)
+    int automatic = (frameskip == -1);
+
+    if (automatic)
+    {
+        if (_win_main_frameskip_auto)
+            return;
+
+        frameskip = 0;
+    }
+    else if ((_win_main_frameskip_auto == 0)
+             && (_win_main_frameskip == frameskip))
+    {
         return;
+    }
 
     _win_main_frameskipcount = 0;
     _win_main_frameskip = frameskip;
+    _win_main_frameskip_auto = automatic;
+}
+
+// Average time per frame if "frameskip" frames are skipped after each drawn one
+static double _win_main_auto_frameskip_cost(int frameskip)
+{
+    return (_win_main_drawn_frame_ms
+            + _win_main_skipped_frame_ms * frameskip) / (frameskip + 1);
+}
+
+static void _win_main_auto_frameskip_update(void)
+{
+    int frameskip = _win_main_frameskip;
+
+    // Only skip frames while the host can't keep up with real time, and stop
+    // as soon as it can. Lowering it requires some margin so that it doesn't
+    // keep switching between two values.
+    while ((frameskip < WIN_MAIN_AUTO_FRAMESKIP_MAX)
+           && (_win_main_auto_frameskip_cost(frameskip) > WIN_MAIN_FRAME_MS))
+    {
+        frameskip++;
+    }
+
+    while ((frameskip > 0) && (_win_main_auto_frameskip_cost(frameskip - 1)
+                               < (WIN_MAIN_FRAME_MS * 0.9)))
+    {
+        frameskip--;
+    }
+
+    _win_main_frameskip = frameskip;
+}
+
+// Called before emulating a frame
+static void _win_main_auto_frameskip_frame_start(int skipped)
+{
+    _win_main_frame_start = SDL_GetPerformanceCounter();
+    _win_main_frame_skipped = skipped;
+}
+
+// Called after presenting it, if it's drawn
+static void _win_main_auto_frameskip_frame_end(void)
+{
+    if (_win_main_frame_skipped == -1)
+        return;
+
+    Uint64 ticks = SDL_GetPerformanceCounter() - _win_main_frame_start;
+    double ms = (ticks * 1000.0) / SDL_GetPerformanceFrequency();
+
+    double *average = _win_main_frame_skipped ? &_win_main_skipped_frame_ms
+                                              : &_win_main_drawn_frame_ms;
+    *average += (ms - *average) / 8.0;
+
+    _win_main_frame_skipped = -1;
 }
 
 static void _win_main_update_frameskip(void)
@@ -68,14 +168,23 @@ static void _win_main_update_frameskip(void)
     if (_win_main_frameskipcount >= _win_main_frameskip)
     {
         _win_main_frameskipcount = 0;
+
+        if (_win_main_frameskip_auto)
+            _win_main_auto_frameskip_update();
         return;
     }
 
     _win_main_frameskipcount++;
 }
 
+// During speedup, only the last frame emulated before presenting one is drawn
+static int _win_main_speedup_skip = 0;
+
 static int _win_main_has_to_frameskip(void)
 {
+    if (_win_main_speedup_skip)
+        return 1;
+
     return (_win_main_frameskipcount != 0); // skip when not 0
 }
 
@@ -95,9 +204,6 @@ static SDL_TimerID WinMain_FPS_timer;
 
 static Uint32 _fps_callback_function(Uint32 interval, unused__ void *param)
 {
-    if (WIN_MAIN_RUNNING == RUNNING_GB)
-        GB_HandleRTC();
-
     WinMain_FPS = WinMain_frames_drawn;
     WinMain_frames_drawn = 0;
     char caption[60];
@@ -146,6 +252,8 @@ static int WIN_MAIN_CONFIG_ZOOM = 2;
 
 static void _win_main_clear_message(void); // Below in this file
 static void Win_MainCloseAllSubwindows(void);
+static void _win_main_thread_frame(void);
+static void _win_main_thread_wait(void);
 
 //------------------------------------------------------------------
 
@@ -160,6 +268,9 @@ static int WIN_MAIN_MENU_HAS_TO_UPDATE = 0;
 static char WIN_MAIN_GAME_MENU_BUFFER[256 * CONFIG_ZOOM_MAX * 224
                                       * CONFIG_ZOOM_MAX * 4];
 static char WIN_MAIN_GAME_SCREEN_BUFFER[256 * 224 * 3]; // Max size = SGB
+// The game screen is only sent to the window when it changes or when the window
+// needs to be redrawn.
+static int WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 0;
 
 static int _win_main_get_game_screen_texture_width(void)
 {
@@ -238,9 +349,117 @@ static void _win_main_get_game_screen_texture_dump(void)
     }
 }
 
+// When the GB blur is enabled, the frames that are displayed are blended by the
+// GPU with the previous one (see WH_SetTextureGhosting()), so the core doesn't
+// blend them. The frames sent anywhere else are still blended by the core.
+static int _win_main_gpu_blur = 0;
+
+static void _win_main_game_frame_convert(void *buffer, int gb_blur)
+{
+    _profile_section_e prev = Profile_Begin(PROFILE_CONVERT);
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_ConvertScreenBufferTo32ARGB(buffer);
+    else if ((WIN_MAIN_RUNNING != RUNNING_NONE) && gb_blur)
+        GB_Screen_WriteBuffer_32ARGB(buffer);
+    else if (WIN_MAIN_RUNNING != RUNNING_NONE)
+        GB_Screen_WriteBuffer_32ARGB_NoBlur(buffer);
+    else
+        memset(buffer, 0, _win_main_get_game_screen_texture_width()
+                          * _win_main_get_game_screen_texture_height() * 4);
+
+    Profile_End(prev);
+}
+
+// Writes the current frame of the emulated screen in ARGB8888 format
+static void _win_main_game_frame_write(void *buffer)
+{
+    _win_main_game_frame_convert(buffer, 1);
+}
+
+// The audio overlay replaces the profiler overlay while it is enabled
+static int _win_main_audio_overlay = 0;
+
+static void _win_main_audio_overlay_draw(void *buffer)
+{
+    _resample_stats_t stats;
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_SoundGetOutputStats(&stats);
+    else if (WIN_MAIN_RUNNING == RUNNING_GB)
+        GB_SoundGetOutputStats(&stats);
+    else
+        return;
+
+    Profile_OverlayDrawAudio(buffer, _win_main_get_game_screen_texture_width(),
+                             _win_main_get_game_screen_texture_height(),
+                             &stats);
+}
+
+// Same as _win_main_game_frame_write(), but for frames that are going to be
+// displayed. The overlays are drawn on top of them, but not on the ones that
+// are recorded.
+static void _win_main_game_frame_write_displayed(void *buffer)
+{
+    _win_main_game_frame_convert(buffer, _win_main_gpu_blur == 0);
+
+    if (_win_main_audio_overlay)
+    {
+        _profile_section_e prev = Profile_Begin(PROFILE_CONVERT);
+        _win_main_audio_overlay_draw(buffer);
+        Profile_End(prev);
+    }
+    else if (EmulatorConfig.profile_overlay
+             && (WIN_MAIN_RUNNING != RUNNING_NONE))
+    {
+        _profile_section_e prev = Profile_Begin(PROFILE_CONVERT);
+
+        Profile_OverlayDraw(buffer, _win_main_get_game_screen_texture_width(),
+                            _win_main_get_game_screen_texture_height());
+
+        Profile_End(prev);
+    }
+}
+
+// Writes the current frame of the emulated screen to the texture of the window
+static void _win_main_game_texture_update(void)
+{
+    void *texture = WH_TextureLock(WinIDMain);
+    if (texture == NULL)
+        return;
+
+    _win_main_game_frame_write_displayed(texture);
+
+    WH_TextureUnlock(WinIDMain);
+}
+
+// Copies a frame written by _win_main_game_frame_write() to the texture
+static void _win_main_game_texture_copy(const void *frame)
+{
+    void *texture = WH_TextureLock(WinIDMain);
+    if (texture == NULL)
+        return;
+
+    memcpy(texture, frame, _win_main_get_game_screen_texture_width()
+                           * _win_main_get_game_screen_texture_height() * 4);
+
+    WH_TextureUnlock(WinIDMain);
+}
+
+// Copies the current frame of the emulated screen to the 24-bit buffer used to
+// draw the background of the menu.
+static void _win_main_game_screen_buffer_update(void)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_ConvertScreenBufferTo24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
+    else if (WIN_MAIN_RUNNING != RUNNING_NONE)
+        GB_Screen_WriteBuffer_24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
+}
+
 static void _win_main_set_game_screen(int type)
 {
     WIN_MAIN_SCREEN_TYPE = type;
+    WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 1;
 
     if (WinIDMain != -1)
     {
@@ -249,6 +468,20 @@ static void _win_main_set_game_screen(int type)
                    _win_main_get_game_screen_texture_width(),
                    _win_main_get_game_screen_texture_height(),
                    WIN_MAIN_CONFIG_ZOOM);
+
+        // The SGB border is drawn without blur
+        _win_main_gpu_blur = (type == SCREEN_GB) && EmulatorConfig.enableblur;
+        WH_SetTextureGhosting(WinIDMain, _win_main_gpu_blur ?
+                              EmulatorConfig.blurstrength * 255 / 100 : 0);
+
+        // The emulated screen is written directly to the texture. It's
+        // recreated when its size or format changes, so fill it again.
+        WH_SetTextureFormat(WinIDMain, WH_TEXTURE_ARGB8888);
+        _win_main_game_texture_update();
+
+        // Drop the frame sent by the emulation thread, if any. It may be of a
+        // screen of a different size.
+        EmuThread_FrameGet();
     }
 }
 
@@ -275,7 +508,9 @@ static void _win_main_switch_to_menu(void)
 
     WH_SetSize(WinIDMain,
                256 * WIN_MAIN_CONFIG_ZOOM, 224 * WIN_MAIN_CONFIG_ZOOM, 0, 0, 0);
+    WH_SetTextureFormat(WinIDMain, WH_TEXTURE_RGB24);
 
+    _win_main_game_screen_buffer_update();
     _win_main_get_game_screen_texture_dump();
 }
 
@@ -294,7 +529,7 @@ static void _win_main_switch_to_menu_delayed(void)
 
 //------------------------------------------------------------------
 
-static int _win_main_get_rom_type(char *name)
+static int _win_main_get_rom_type(const char *name)
 {
     char extension[4];
     int len = strlen(name);
@@ -327,36 +562,414 @@ static int _win_main_get_rom_type(char *name)
     return RUNNING_NONE;
 }
 
+static int _win_main_is_movie(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    if (dot == NULL)
+        return 0;
+
+    const char *extension = MOVIE_EXTENSION;
+    for (int i = 0; ; i++)
+    {
+        if (tolower(dot[1 + i]) != extension[i])
+            return 0;
+        if (extension[i] == '\0')
+            return 1;
+    }
+}
+
+// Used to guess the type of a ROM inside an archive with an unknown extension
+static int _win_main_get_rom_type_from_header(const u8 *rom, u32 size)
+{
+    // Fixed value of the GBA header
+    if ((size >= 0xC0) && (rom[0xB2] == 0x96))
+        return RUNNING_GBA;
+
+    // Start of the Nintendo logo in the GB header
+    const u8 gb_logo[4] = { 0xCE, 0xED, 0x66, 0x66 };
+    if ((size >= 0x150) && (memcmp(&rom[0x104], gb_logo, 4) == 0))
+        return RUNNING_GB;
+
+    return RUNNING_NONE;
+}
+
+static int _win_main_zip_is_valid_rom(const char *name)
+{
+    return _win_main_get_rom_type(name) != RUNNING_NONE;
+}
+
+// Decompresses the ROM inside a ZIP archive. GBA ROMs are decompressed in a
+// buffer that can be used by GBA_InitRomInPlace(). Returns the type of the ROM.
+static int _win_main_zip_load(const char *path, void **buffer, u32 *size)
+{
+    _zip_entry_t entry;
+
+    *buffer = NULL;
+    *size = 0;
+
+    if (Zip_FindFile(path, _win_main_zip_is_valid_rom, &entry) != 0)
+        return RUNNING_NONE;
+
+    int type = _win_main_get_rom_type(entry.name);
+
+    u32 buffer_size = entry.size;
+    if ((type != RUNNING_GB) && (buffer_size < GBA_ROM_BUFFER_SIZE))
+        buffer_size = GBA_ROM_BUFFER_SIZE;
+
+    u8 *rom = calloc(1, buffer_size);
+    if (rom == NULL)
+    {
+        Debug_ErrorMsgArg("Not enought memory to load %s!", path);
+        return RUNNING_NONE;
+    }
+
+    if (Zip_Extract(path, &entry, rom) != 0)
+    {
+        free(rom);
+        return RUNNING_NONE;
+    }
+
+    if (type == RUNNING_NONE)
+        type = _win_main_get_rom_type_from_header(rom, entry.size);
+
+    if (type == RUNNING_NONE)
+    {
+        Debug_ErrorMsgArg("%s from %s isn't a GB or GBA ROM!", entry.name,
+                          path);
+        free(rom);
+        return RUNNING_NONE;
+    }
+
+    *buffer = rom;
+    *size = entry.size;
+    return type;
+}
+
 static void *bios_buffer = NULL;
-static void *rom_buffer = NULL;
-static unsigned int rom_size;
+static _file_map_t rom_map;
+
+//------------------------------------------------------------------
+
+// A state is saved after every frame so that the game can be rewound while the
+// rewind key is held, and so that it can be restored after running ahead.
+
+static _savestate_t win_main_frame_state;
+
+// Input used to emulate the current frame
+static _input_state_t win_main_input_state;
+
+static int _win_main_state_save(_savestate_t *st)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        return GBA_StateSave(st);
+    else
+        return GB_StateSave(st);
+}
+
+static int _win_main_state_load(_savestate_t *st)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        return GBA_StateLoad(st);
+    else
+        return GB_StateLoad(st);
+}
+
+// Returns 1 if a frame has been rewound instead of emulated
+static int _win_main_rewind_frame(void)
+{
+    if ((EmulatorConfig.rewind_seconds == 0)
+        || (win_main_input_state.rewind == 0))
+    {
+        return 0;
+    }
+
+    // When the oldest state is reached, stay there until the key is released
+    if (Rewind_Pop(&win_main_frame_state) == 0)
+        _win_main_state_load(&win_main_frame_state);
+
+    return 1;
+}
+
+static void _win_main_skip_frame(int skip)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_SkipFrame(skip);
+    else
+        GB_SkipFrame(skip);
+}
+
+static void _win_main_run_one_frame(void)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_RunForOneFrame();
+    else
+        GB_RunForOneFrame();
+}
+
+static void _win_main_sound_suspend(int suspend)
+{
+    // The sound of the frames that aren't drawn during speedup is dropped
+    suspend |= _win_main_speedup_skip;
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_SoundSetOutputSuspended(suspend);
+    else
+        GB_SoundSetOutputSuspended(suspend);
+}
+
+// Sends the current frame to the video recording, if there is one
+static void _win_main_record_frame(void)
+{
+    if (VideoRecord_IsActive() == 0)
+        return;
+
+    void *buffer = VideoRecord_FrameBegin();
+    if (buffer == NULL)
+        return;
+
+    _win_main_game_frame_write(buffer);
+    VideoRecord_FrameEnd();
+}
+
+// Publishes the current frame in the shared output, if it's enabled
+static void _win_main_shared_output_frame(void)
+{
+    if (SharedOutput_IsActive() == 0)
+        return;
+
+    void *buffer = SharedOutput_FrameBegin(
+                            _win_main_get_game_screen_texture_width(),
+                            _win_main_get_game_screen_texture_height());
+    if (buffer == NULL)
+        return;
+
+    _win_main_game_frame_write(buffer);
+    SharedOutput_FrameEnd();
+}
+
+// Sends the current frame to the remote player, if there is one
+static void _win_main_stream_frame(void)
+{
+    if (Stream_IsActive() == 0)
+        return;
+
+    void *buffer = Stream_FrameBegin(
+                            _win_main_get_game_screen_texture_width(),
+                            _win_main_get_game_screen_texture_height());
+    if (buffer == NULL)
+        return;
+
+    _win_main_game_frame_write(buffer);
+    Stream_FrameEnd();
+}
+
+static void _win_main_screen_update(void)
+{
+    // The frames skipped during speedup don't have sound either, so they are
+    // left out of the recording as well.
+    if (_win_main_speedup_skip == 0)
+    {
+        _win_main_record_frame();
+        _win_main_shared_output_frame();
+        _win_main_stream_frame();
+    }
+
+    if (_win_main_has_to_frameskip())
+        return;
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+    {
+        if (GBA_ScreenBufferHasChanged() == 0)
+            return;
+    }
+    else
+    {
+        if (GB_ScreenHasChanged() == 0)
+            return;
+    }
+
+    // The emulation thread can't access the window. The main thread copies
+    // the frame to the texture when it's displayed.
+    if (EmuThread_IsEnabled())
+    {
+        _win_main_game_frame_write_displayed(EmuThread_FrameBegin());
+        EmuThread_FrameEnd();
+        return;
+    }
+
+    _win_main_game_texture_update();
+
+    WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 1;
+}
+
+// With run-ahead, the state after each frame is saved and the next frames are
+// emulated with the same input, without drawing them or generating sound. Only
+// the last one is drawn and displayed, then the saved state is loaded. That
+// way, the game reacts to the input as many frames earlier as frames are run
+// ahead, as long as it doesn't react to it in those frames anyway.
+static void _win_main_run_frame(void)
+{
+    int ahead = EmulatorConfig.run_ahead_frames;
+    int skip = _win_main_has_to_frameskip();
+
+    // The transfers of the frames run ahead would reach the other emulator
+    if ((WIN_MAIN_RUNNING == RUNNING_GB)
+        && (EmulatorConfig.serial_device == SERIAL_GAMEBOY))
+        ahead = 0;
+    if ((WIN_MAIN_RUNNING == RUNNING_GBA) && EmulatorConfig.gba_link_cable)
+        ahead = 0;
+
+    // The frames saved for rewind have to be drawn, they are displayed when
+    // they are loaded.
+    if ((ahead > 0) && (EmulatorConfig.rewind_seconds == 0))
+        _win_main_skip_frame(1);
+    else
+        _win_main_skip_frame(skip);
+
+    _win_main_run_one_frame();
+
+    int saved = 0;
+    if ((ahead > 0) || (EmulatorConfig.rewind_seconds > 0))
+        saved = (_win_main_state_save(&win_main_frame_state) == 0);
+
+    if (saved && (EmulatorConfig.rewind_seconds > 0))
+        Rewind_Push(&win_main_frame_state);
+
+    if ((ahead == 0) || (saved == 0))
+    {
+        _win_main_screen_update();
+        return;
+    }
+
+    _win_main_sound_suspend(1);
+
+    for (int i = 0; i < ahead; i++)
+    {
+        _win_main_skip_frame((i < (ahead - 1)) ? 1 : skip);
+        _win_main_run_one_frame();
+    }
+
+    _win_main_screen_update();
+
+    _win_main_state_load(&win_main_frame_state);
+
+    _win_main_sound_suspend(0);
+}
+
+static int win_main_autosave_frames;
+
+// Queues the battery save every few seconds if the game has changed it
+static void _win_main_autosave(void)
+{
+    if (EmulatorConfig.autosave_seconds == 0)
+        return;
+
+    win_main_autosave_frames++;
+    if (win_main_autosave_frames < (EmulatorConfig.autosave_seconds * 60))
+        return;
+
+    win_main_autosave_frames = 0;
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        GBA_SaveAutosave();
+    else
+        GB_SRAM_Autosave();
+}
+
+// Path of the checkpoint of the loaded ROM, empty if no ROM is loaded
+static char win_main_checkpoint_path[MAX_PATHLEN];
+static int win_main_checkpoint_frames;
+
+// Saves a state every few seconds so that the game can be resumed if the
+// emulator crashes. The state is compressed and written in the background.
+static void _win_main_checkpoint(void)
+{
+    if (EmulatorConfig.checkpoint_seconds == 0)
+        return;
+
+    win_main_checkpoint_frames++;
+    if (win_main_checkpoint_frames < (EmulatorConfig.checkpoint_seconds * 60))
+        return;
+
+    win_main_checkpoint_frames = 0;
+
+    _savestate_t *st = Checkpoint_Begin(win_main_checkpoint_path);
+    _win_main_state_save(st);
+    Checkpoint_Commit();
+}
+
+// Called after loading a ROM. If the emulator crashed the last time the ROM
+// was running, the emulation continues from the last checkpoint.
+static void _win_main_checkpoint_start(const char *rom_path)
+{
+    snprintf(win_main_checkpoint_path, sizeof(win_main_checkpoint_path),
+             "%s.ckp", rom_path);
+    win_main_checkpoint_frames = 0;
+
+    if (EmulatorConfig.checkpoint_seconds == 0)
+        return;
+
+    if (Checkpoint_Load(&win_main_frame_state, win_main_checkpoint_path) != 0)
+        return;
+
+    if (_win_main_state_load(&win_main_frame_state) == 0)
+    {
+        Debug_LogMsgArg("Resumed from checkpoint: %s",
+                        win_main_checkpoint_path);
+    }
+}
+
+// The checkpoint is only needed if the emulator doesn't unload the ROM
+static void _win_main_checkpoint_end(void)
+{
+    if (win_main_checkpoint_path[0] == '\0')
+        return;
+
+    Checkpoint_Remove(win_main_checkpoint_path);
+    win_main_checkpoint_path[0] = '\0';
+}
+
+//------------------------------------------------------------------
 
 static void _win_main_unload_rom(int save_data)
 {
     _win_main_clear_message();
 
+    Movie_Stop();
+    VideoRecord_Stop();
+    PCProfile_End();
+#ifdef ENABLE_OPCODE_PROFILE
+    OPProfile_End();
+#endif
+    Trace_Stop();
+
     if (WIN_MAIN_RUNNING == RUNNING_GBA)
     {
         GBA_EndRom(save_data);
         GBA_DebugClearBreakpointAll();
+        GBA_DebugClearWatchpointAll();
     }
     else if (WIN_MAIN_RUNNING == RUNNING_GB)
     {
         GB_End(save_data);
         GB_DebugClearBreakpointAll();
+        GB_DebugClearWatchpointAll();
     }
     else
     {
         return;
     }
 
+    _win_main_checkpoint_end();
+
     if (bios_buffer)
         free(bios_buffer);
-    if (rom_buffer)
-        free(rom_buffer);
+    FileUnmap(&rom_map);
 
     bios_buffer = NULL;
-    rom_buffer = NULL;
+
+    Rewind_End();
+    SaveState_Free(&win_main_frame_state);
 
     // Clear screen buffer
     memset(WIN_MAIN_GAME_SCREEN_BUFFER, 0, sizeof(WIN_MAIN_GAME_SCREEN_BUFFER));
@@ -406,10 +1019,39 @@ static int _win_main_load_rom_autodetect(char *path)
 
     _win_main_clear_message();
 
+    // Movies are played with the ROM that is already loaded
+    if (_win_main_is_movie(path))
+    {
+        if (WIN_MAIN_RUNNING == RUNNING_NONE)
+        {
+            Debug_ErrorMsgArg("Load the ROM of the movie before playing it.");
+            return 0;
+        }
+
+        _savestate_system_e system = (WIN_MAIN_RUNNING == RUNNING_GBA) ?
+                                     SAVESTATE_SYSTEM_GBA : SAVESTATE_SYSTEM_GB;
+        if (Movie_PlayStart(path, system) != 0)
+            return 0;
+
+        Rewind_Reset(EmulatorConfig.rewind_seconds * 60);
+
+        _win_main_switch_to_game_delayed();
+
+        return 1;
+    }
+
     if (WIN_MAIN_RUNNING != RUNNING_NONE)
         _win_main_unload_rom(1);
 
-    int type = _win_main_get_rom_type(path);
+    // ROMs in archives are decompressed here, the rest are loaded by the cores
+    void *zip_buffer = NULL;
+    u32 zip_size = 0;
+    int type;
+
+    if (Zip_IsArchive(path))
+        type = _win_main_zip_load(path, &zip_buffer, &zip_size);
+    else
+        type = _win_main_get_rom_type(path);
 
     if (type == RUNNING_NONE)
     {
@@ -417,8 +1059,16 @@ static int _win_main_load_rom_autodetect(char *path)
     }
     else if (type == RUNNING_GB)
     {
-        if (GB_ROMLoad(path))
+        int loaded;
+        if (zip_buffer)
+            loaded = GB_ROMLoadBuffer(path, zip_buffer, zip_size);
+        else
+            loaded = GB_ROMLoad(path);
+
+        if (loaded)
         {
+            PCProfile_SymbolsLoad(path);
+
             if (GB_IsEnabledSGB())
                 _win_main_set_game_screen(SCREEN_SGB);
             else
@@ -426,6 +1076,10 @@ static int _win_main_load_rom_autodetect(char *path)
 
             WIN_MAIN_RUNNING = RUNNING_GB;
 
+            _win_main_checkpoint_start(path);
+
+            Rewind_Reset(EmulatorConfig.rewind_seconds * 60);
+
             Sound_SetCallback(GB_SoundCallback);
 
             _win_main_switch_to_game_delayed();
@@ -436,8 +1090,6 @@ static int _win_main_load_rom_autodetect(char *path)
     }
     else if (type == RUNNING_GBA)
     {
-        // There should be some error checking...
-
         char bios_path[MAX_PATHLEN];
         unsigned int bios_size;
         snprintf(bios_path, sizeof(bios_path), "%s" GBA_BIOS_FILENAME,
@@ -451,12 +1103,45 @@ static int _win_main_load_rom_autodetect(char *path)
         else
             GBA_BiosLoaded(1);
 
-        FileLoad(path, &rom_buffer, &rom_size);
+        if (zip_buffer)
+        {
+            rom_map.data = zip_buffer;
+            rom_map.map_size = GBA_ROM_BUFFER_SIZE;
+            rom_map.size = zip_size;
+            rom_map.mapped = 0;
+        }
+        else if (FileMap(path, GBA_ROM_BUFFER_SIZE, &rom_map) != 0)
+        {
+            // FileMap() has already shown the error
+            free(bios_buffer);
+            bios_buffer = NULL;
+            return 0;
+        }
+
+        // Detecting the save type reads the whole ROM, skip it if possible
+        int save_type;
+        int cached = RomCache_GetSaveType(path, rom_map.data, rom_map.size,
+                                          &save_type) == 0;
+        if (cached)
+            GBA_SaveSetKnownType(save_type);
+
         GBA_SaveSetFilename(path);
-        GBA_InitRom(bios_buffer, rom_buffer, rom_size);
+        GBA_InitRomInPlace(bios_buffer, rom_map.data, rom_map.size);
+
+        if (cached == 0)
+        {
+            RomCache_SetSaveType(path, rom_map.data, rom_map.size,
+                                 GBA_SaveGetDetectedType());
+        }
 
         WIN_MAIN_RUNNING = RUNNING_GBA;
 
+        PCProfile_SymbolsLoad(path);
+
+        _win_main_checkpoint_start(path);
+
+        Rewind_Reset(EmulatorConfig.rewind_seconds * 60);
+
         Sound_SetCallback(GBA_SoundCallback);
 
         _win_main_set_game_screen(SCREEN_GBA);
@@ -577,8 +1262,6 @@ static void _win_main_file_explorer_refresh(void)
 
     GUI_ConsoleClear(&win_main_fileexpoler_con);
 
-    FileExplorer_LoadFolder();
-
     int numfiles = FileExplorer_GetNumFiles();
 
     int start_print_index = _win_main_file_explorer_get_starting_drawing_index();
@@ -606,6 +1289,19 @@ static void _win_main_file_explorer_refresh(void)
                           FileExplorer_GetCurrentPath());
 }
 
+// Shows the entries found since the last call while the folder is scanned
+static void _win_main_file_explorer_poll(void)
+{
+    if (GUI_WindowGetEnabled(&mainwindow_fileexplorer_win) == 0)
+        return;
+
+    if (FileExplorer_Poll())
+    {
+        _win_main_file_explorer_refresh();
+        WIN_MAIN_MENU_HAS_TO_UPDATE = 1;
+    }
+}
+
 static void _win_main_file_explorer_close(void)
 {
     FileExplorer_ListFree();
@@ -676,29 +1372,122 @@ static void _win_main_file_explorer_load(void)
 {
     Win_MainCloseAllSubwindows();
 
-    GUI_WindowSetEnabled(&mainwindow_fileexplorer_win, 1);
-    FileExplorer_SetPath(DirGetRunningPath());
-    _win_main_file_explorer_refresh();
-}
+    GUI_WindowSetEnabled(&mainwindow_fileexplorer_win, 1);
+    FileExplorer_SetPath(DirGetRunningPath());
+    FileExplorer_LoadFolder();
+    _win_main_file_explorer_refresh();
+}
+
+static void _win_main_menu_close(void)
+{
+    Win_MainCloseAllSubwindows();
+    _win_main_unload_rom(1);
+}
+
+static void _win_main_menu_close_no_save(void)
+{
+    Win_MainCloseAllSubwindows();
+    _win_main_unload_rom(0);
+}
+
+static void _win_main_screenshot(void)
+{
+    if (Win_MainRunningGBA())
+        GBA_Screenshot();
+    if (Win_MainRunningGB())
+        GB_Screenshot();
+}
+
+static void _win_main_save_state(void)
+{
+    if (Win_MainRunningGBA())
+        GBA_QuickStateSave();
+    if (Win_MainRunningGB())
+        GB_QuickStateSave();
+}
+
+static void _win_main_load_state(void)
+{
+    // The movie can't continue from a different state
+    Movie_Stop();
+
+    if (Win_MainRunningGBA())
+        GBA_QuickStateLoad();
+    if (Win_MainRunningGB())
+        GB_QuickStateLoad();
+}
+
+static void _win_main_record_sound(void)
+{
+    Sound_RecordToggle();
+}
+
+static void _win_main_record_video(void)
+{
+    if (VideoRecord_IsActive())
+    {
+        VideoRecord_Stop();
+        return;
+    }
+
+    if (WIN_MAIN_RUNNING == RUNNING_NONE)
+        return;
+
+    // All of them need the audio tap of the resampler
+    if (SharedOutput_IsActive() || Stream_IsActive())
+    {
+        Debug_ErrorMsgArg("Videos can't be recorded while the shared output "
+                          "or the stream are enabled.");
+        return;
+    }
+
+    _videorecord_format_e format = EmulatorConfig.video_record_format;
+    const char *extension = "gbv";
+
+    if (format == VIDEORECORD_FORMAT_FFMPEG)
+        extension = "mkv";
+
+    char *path = FU_GetNewTimestampFilenameExt("video", extension);
+
+    VideoRecord_Start(path, format,
+                      _win_main_get_game_screen_texture_width(),
+                      _win_main_get_game_screen_texture_height());
+}
+
+static void _win_main_record_movie_common(int power_on)
+{
+    if (Movie_IsRecording() || Movie_IsPlaying())
+    {
+        Movie_Stop();
+        return;
+    }
+
+    if (WIN_MAIN_RUNNING == RUNNING_NONE)
+        return;
+
+    _savestate_system_e system = (WIN_MAIN_RUNNING == RUNNING_GBA) ?
+                                 SAVESTATE_SYSTEM_GBA : SAVESTATE_SYSTEM_GB;
+
+    char *path = FU_GetNewTimestampFilenameExt("movie", MOVIE_EXTENSION);
+
+    if (Movie_RecordStart(path, system, power_on) != 0)
+        return;
+
+    // The frames before the start of the movie can't be rewound into it
+    Rewind_Reset(EmulatorConfig.rewind_seconds * 60);
 
-static void _win_main_menu_close(void)
-{
-    Win_MainCloseAllSubwindows();
-    _win_main_unload_rom(1);
+    if (WIN_MAIN_MENU_ENABLED)
+        _win_main_switch_to_game();
 }
 
-static void _win_main_menu_close_no_save(void)
+static void _win_main_record_movie(void)
 {
-    Win_MainCloseAllSubwindows();
-    _win_main_unload_rom(0);
+    _win_main_record_movie_common(1);
 }
 
-static void _win_main_screenshot(void)
+static void _win_main_record_movie_from_here(void)
 {
-    if (Win_MainRunningGBA())
-        GBA_Screenshot();
-    if (Win_MainRunningGB())
-        GB_Screenshot();
+    _win_main_record_movie_common(0);
 }
 
 static void _win_main_menu_exit(void)
@@ -725,16 +1514,12 @@ static void _win_main_reset(void)
         if (WIN_MAIN_MENU_ENABLED)
             _win_main_switch_to_game();
 
+        Movie_Stop();
+
         if (WIN_MAIN_RUNNING == RUNNING_GBA)
             GBA_Reset();
         else if (WIN_MAIN_RUNNING == RUNNING_GB)
             GB_HardReset();
-
-        //if (EmulatorConfig.frameskip == -1)
-        //{
-            //FRAMESKIP = 0;
-            //AUTO_FRAMESKIP_WAIT = 2;
-        //}
     }
 }
 
@@ -749,6 +1534,58 @@ static void _win_main_menu_toggle_mute_sound(void)
     Sound_SetEnabled(!Sound_GetEnabled());
 }
 
+static void _win_main_menu_toggle_profile_overlay(void)
+{
+    EmulatorConfig.profile_overlay = !EmulatorConfig.profile_overlay;
+
+    if (EmulatorConfig.profile_overlay)
+        Profile_Start();
+    else
+        Profile_Stop();
+}
+
+static void _win_main_menu_toggle_audio_overlay(void)
+{
+    _win_main_audio_overlay = !_win_main_audio_overlay;
+}
+
+static void _win_main_menu_export_profile(void)
+{
+    if (Profile_GetFrameCount() == 0)
+    {
+        Debug_ErrorMsgArg("Enable the profiler overlay to measure frames.");
+        return;
+    }
+
+    const char *path = Profile_ExportCSV();
+    if (path != NULL)
+        Debug_LogMsgArg("Profile saved to: %s", path);
+}
+
+static void _win_main_menu_toggle_trace(void)
+{
+    if (trace_enabled)
+    {
+        Trace_Stop();
+        return;
+    }
+
+    _trace_system_e system;
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        system = TRACE_GBA;
+    else if (WIN_MAIN_RUNNING == RUNNING_GB)
+        system = TRACE_GB;
+    else
+        return;
+
+    char *path = FU_GetNewTimestampFilenameExt("trace", "bin");
+    if (path == NULL)
+        return;
+
+    if (Trace_Start(path, system) == 0)
+        Debug_LogMsgArg("Execution trace: Saving to %s", path);
+}
+
 static void _win_main_menu_open_configuration_window(void)
 {
     Win_MainCloseAllSubwindows();
@@ -817,6 +1654,112 @@ static void _win_main_menu_open_gbcamera_viewer(void)
 
 //------------------------------------------------------------------
 
+static char sys_info_buffer[10000];
+
+static void _sys_info_printf(const char *msg, ...)
+{
+    va_list args;
+    char buffer[1000];
+
+    va_start(args, msg);
+    vsnprintf(buffer, sizeof(buffer), msg, args);
+    va_end(args);
+
+    s_strncat(sys_info_buffer, buffer, sizeof(sys_info_buffer));
+}
+
+static void _sys_info_reset(void)
+{
+    memset(sys_info_buffer, 0, sizeof(sys_info_buffer));
+
+    _sys_info_printf("SDL information:\n"
+                     "----------------\n"
+                     "\n"
+                     "SDL_GetPlatform(): %s\n\n"
+                     "SDL_GetCPUCount(): %d (Number of logical CPU cores)\n"
+#if SDL_VERSION_ATLEAST(2, 0, 1)
+                     "SDL_GetSystemRAM(): %d MB\n"
+#endif
+                     "SDL_GetCPUCacheLineSize(): %d kB (Cache L1)\n\n",
+                     SDL_GetPlatform(), SDL_GetCPUCount(),
+#if SDL_VERSION_ATLEAST(2, 0, 1)
+                     SDL_GetSystemRAM(),
+#endif
+                     SDL_GetCPUCacheLineSize());
+
+    // None of the cores has code that depends on them yet, this is only to
+    // know what the computers that run the emulator support.
+    _sys_info_printf("CPU features:\n");
+    _sys_info_printf("  SSE2:  %s\n", SDL_HasSSE2() ? "Yes" : "No");
+    _sys_info_printf("  SSSE3: %s\n", SDL_HasSSSE3() ? "Yes" : "No");
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+    _sys_info_printf("  AVX2:  %s\n", SDL_HasAVX2() ? "Yes" : "No");
+#endif
+#if SDL_VERSION_ATLEAST(2, 0, 6)
+    _sys_info_printf("  NEON:  %s\n", SDL_HasNEON() ? "Yes" : "No");
+#endif
+    _sys_info_printf("\n");
+
+    int total_secs, pct;
+    SDL_PowerState st = SDL_GetPowerInfo(&total_secs, &pct);
+    char *st_string;
+    switch (st)
+    {
+        default:
+        case SDL_POWERSTATE_UNKNOWN:
+            st_string = "SDL_POWERSTATE_UNKNOWN (cannot determine power status)";
+            break;
+        case SDL_POWERSTATE_ON_BATTERY:
+            st_string = "SDL_POWERSTATE_ON_BATTERY (not plugged in, running on battery)";
+            break;
+        case SDL_POWERSTATE_NO_BATTERY:
+            st_string = "SDL_POWERSTATE_NO_BATTERY (plugged in, no battery available)";
+            break;
+        case SDL_POWERSTATE_CHARGING:
+            st_string = "SDL_POWERSTATE_CHARGING (plugged in, charging battery)";
+            break;
+        case SDL_POWERSTATE_CHARGED:
+            st_string = "SDL_POWERSTATE_CHARGED (plugged in, battery charged)";
+            break;
+    }
+
+    unsigned int hours, min, secs;
+
+    hours = ((unsigned int)total_secs) / 3600;
+    min = (((unsigned int)total_secs) - (hours * 3600)) / 60;
+    secs = (((unsigned int)total_secs) - (hours * 3600) - (min * 60));
+
+    _sys_info_printf("SDL_GetPowerInfo():\n"
+                     "  %s\n"
+                     "  Time left: %d:%02d:%02d\n"
+                     "  Percentage: %3d%%\n"
+                     "\n",
+                     st_string, hours, min, secs, pct);
+#ifdef ENABLE_OPENGL
+    _sys_info_printf("OpenGL information:\n"
+                     "-------------------\n"
+                     "\n"
+                     "GL_RENDERER   = %s\n"
+                     "GL_VERSION    = %s\n"
+                     "GL_VENDOR     = %s\n"
+                     "GL_EXTENSIONS = ",
+                     (char *)glGetString(GL_RENDERER),
+                     (char *)glGetString(GL_VERSION),
+                     (char *)glGetString(GL_VENDOR));
+    _sys_info_printf("%s\n", (char *)glGetString(GL_EXTENSIONS));
+#endif
+    _sys_info_printf("\nEND LOG\n");
+}
+
+static void _win_main_menu_show_sys_info(void)
+{
+    _sys_info_reset();
+
+    Win_MainShowMessage(3, sys_info_buffer);
+}
+
+//------------------------------------------------------------------
+
 // Window Menu
 
 static _gui_menu_entry mm_separator = {
@@ -841,17 +1784,37 @@ static _gui_menu_entry mmfile_pause = {
 static _gui_menu_entry mmfile_rominfo = {
     "Show Console (Rom Info.)", _win_main_show_console, 1
 };
+static _gui_menu_entry mmfile_savestate = {
+    "Save State (F2)", _win_main_save_state, 1
+};
+static _gui_menu_entry mmfile_loadstate = {
+    "Load State (F3)", _win_main_load_state, 1
+};
 static _gui_menu_entry mmfile_screenshot = {
     "Screenshot (F12)", _win_main_screenshot, 1
 };
+static _gui_menu_entry mmfile_recordsound = {
+    "Record Sound (F11)", _win_main_record_sound, 1
+};
+static _gui_menu_entry mmfile_recordvideo = {
+    "Record Video (F10)", _win_main_record_video, 1
+};
+static _gui_menu_entry mmfile_recordmovie = {
+    "Record Movie From Reset", _win_main_record_movie, 1
+};
+static _gui_menu_entry mmfile_recordmoviehere = {
+    "Record Movie From Here", _win_main_record_movie_from_here, 1
+};
 static _gui_menu_entry mmfile_exit = {
     "Exit (CTRL+E)", _win_main_menu_exit, 1
 };
 
 static _gui_menu_entry *mmfile_elements[] = {
     &mmfile_open, &mmfile_close, &mmfile_closenosav, &mm_separator,
-    &mmfile_reset, &mmfile_pause, &mm_separator, &mmfile_rominfo,
-    &mmfile_screenshot, &mm_separator, &mmfile_exit, NULL
+    &mmfile_reset, &mmfile_pause, &mm_separator, &mmfile_savestate,
+    &mmfile_loadstate, &mm_separator, &mmfile_rominfo, &mmfile_screenshot,
+    &mmfile_recordsound, &mmfile_recordvideo, &mmfile_recordmovie,
+    &mmfile_recordmoviehere, &mm_separator, &mmfile_exit, NULL
 };
 
 static _gui_menu_list main_menu_file = {
@@ -868,7 +1831,7 @@ static _gui_menu_entry mmoptions_mutesound = {
     "Mute Sound (CTRL+M)", _win_main_menu_toggle_mute_sound, 1
 };
 static _gui_menu_entry mmoptions_sysinfo = {
-    "System Information", SysInfoShow, 1
+    "System Information", _win_main_menu_show_sys_info, 1
 };
 
 static _gui_menu_entry *mmoptions_elements[] = {
@@ -910,10 +1873,27 @@ static _gui_menu_entry mmdebug_gbcameraview = {
     "GB Camera Viewer", _win_main_menu_open_gbcamera_viewer, 1
 };
 
+static _gui_menu_entry mmdebug_profileoverlay = {
+    "Profiler Overlay", _win_main_menu_toggle_profile_overlay, 1
+};
+static _gui_menu_entry mmdebug_audiooverlay = {
+    "Audio Overlay", _win_main_menu_toggle_audio_overlay, 1
+};
+static _gui_menu_entry mmdebug_profileexport = {
+    "Export Profile (CSV)", _win_main_menu_export_profile, 1
+};
+
+static _gui_menu_entry mmdebug_trace = {
+    "Execution Trace", _win_main_menu_toggle_trace, 1
+};
+
 static _gui_menu_entry *mmdisas_elements[] = {
     &mmdebug_disas, &mmdebug_memview, &mmdebug_ioview, &mm_separator,
     &mmdebug_tileview, &mmdebug_mapview, &mmdebug_sprview, &mmdebug_palview,
-    &mm_separator, &mmdebug_sgbview, &mmdebug_gbcameraview, NULL
+    &mm_separator, &mmdebug_sgbview, &mmdebug_gbcameraview, &mm_separator,
+    &mmdebug_profileoverlay, &mmdebug_audiooverlay, &mmdebug_profileexport,
+    &mm_separator,
+    &mmdebug_trace, NULL
 };
 
 static _gui_menu_list main_menu_debug = {
@@ -1038,9 +2018,36 @@ static _gui mainwindow_window_gui = {
 
 //------------------------------------------------------------------
 
+// Messages sent from the emulation thread are shown by the main thread. Only
+// the first one is kept until then.
+static int _win_main_deferred_message_type = -1;
+static char _win_main_deferred_message[2000];
+
+static void _win_main_show_deferred_message(void)
+{
+    int type = _win_main_deferred_message_type;
+    _win_main_deferred_message_type = -1;
+
+    if (type != -1)
+        Win_MainShowMessage(type, _win_main_deferred_message);
+}
+
 // Type: 0 = error, 1 = debug, 2 = console, 3 = sys info
 void Win_MainShowMessage(int type, const char *text)
 {
+    if (EmuThread_IsCurrentThread())
+    {
+        if (_win_main_deferred_message_type == -1)
+        {
+            _win_main_deferred_message_type = type;
+            s_strncpy(_win_main_deferred_message, text,
+                      sizeof(_win_main_deferred_message));
+        }
+
+        EmuThread_CallFromMainThread(_win_main_show_deferred_message);
+        return;
+    }
+
     _win_main_switch_to_menu();
 
     if (type == 0)
@@ -1177,6 +2184,12 @@ static int Win_MainEventCallback(SDL_Event *e)
                 _win_main_scrollable_text_window_show_readme();
                 WIN_MAIN_MENU_HAS_TO_UPDATE = 1;
                 break;
+            case SDLK_F2:
+                _win_main_save_state();
+                break;
+            case SDLK_F3:
+                _win_main_load_state();
+                break;
             case SDLK_F5:
                 _win_main_menu_open_disassembler();
                 break;
@@ -1186,6 +2199,12 @@ static int Win_MainEventCallback(SDL_Event *e)
             case SDLK_F7:
                 _win_main_menu_open_io_viewer();
                 break;
+            case SDLK_F10:
+                _win_main_record_video();
+                break;
+            case SDLK_F11:
+                _win_main_record_sound();
+                break;
             case SDLK_F12:
                 _win_main_screenshot();
                 break;
@@ -1311,10 +2330,12 @@ static int Win_MainEventCallback(SDL_Event *e)
         if (e->window.event == SDL_WINDOWEVENT_FOCUS_GAINED)
         {
             WIN_MAIN_MENU_HAS_TO_UPDATE = 1;
+            WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 1;
         }
         else if (e->window.event == SDL_WINDOWEVENT_EXPOSED)
         {
             WIN_MAIN_MENU_HAS_TO_UPDATE = 1;
+            WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 1;
         }
         else if (e->window.event == SDL_WINDOWEVENT_CLOSE)
         {
@@ -1364,6 +2385,11 @@ int Win_MainCreate(char *rom_path)
     //_win_main_scrollable_text_window_close();
     //_win_main_clear_message();
 
+    // The debuggers follow the execution of the cores
+    GB_DebugSetCallbacks(Win_GBDisassemblerStartAddressSetDefault,
+                         Win_GBDisassemblerSetFocus);
+    GBA_DebugSetBreakCallback(Win_GBADisassemblerSetFocus);
+
     Win_MainChangeZoom(EmulatorConfig.screen_size);
     Win_MainSetFrameskip(EmulatorConfig.frameskip);
 
@@ -1380,12 +2406,44 @@ int Win_MainCreate(char *rom_path)
 
     WH_SetCaption(WinIDMain, "GiiBiiAdvance");
 
+    FramePace_Init(WinIDMain);
+
+    // Registered first so that it's called after the emulation thread ends
+    atexit(VideoRecord_Stop);
+
+    if (EmulatorConfig.shared_output[0] != '\0')
+    {
+        if (SharedOutput_Start(EmulatorConfig.shared_output) == 0)
+            atexit(SharedOutput_Stop);
+    }
+
+    if (EmulatorConfig.stream_port != 0)
+    {
+        if (SharedOutput_IsActive())
+        {
+            Debug_ErrorMsgArg("The stream can't be enabled at the same time "
+                              "as the shared output.");
+        }
+        else if (Stream_Start(EmulatorConfig.stream_port) == 0)
+        {
+            atexit(Stream_Stop);
+        }
+    }
+
+    Latency_SetEnabled(EmulatorConfig.input_latency_report);
+
+    EmuThread_Init(_win_main_thread_frame, _win_main_thread_wait);
+    atexit(EmuThread_End);
+
     WH_SetEventCallback(WinIDMain, Win_MainEventCallback);
     WH_SetEventMainWindow(WinIDMain);
 
     FPS_TimerInit();
     atexit(FPS_TimerEnd);
 
+    if (EmulatorConfig.profile_overlay)
+        Profile_Start();
+
     WIN_MAIN_RUNNING = RUNNING_NONE;
 
     // If the emulator was started with a game as argument...
@@ -1406,10 +2464,36 @@ void Win_MainRender(void)
 {
     if (WIN_MAIN_MENU_ENABLED == 0)
     {
-        if (WIN_MAIN_RUNNING != RUNNING_NONE)
+        u64 present_start = Profile_TimerBegin();
+
+        if (EmuThread_IsEnabled())
+        {
+            const void *frame = EmuThread_FrameGet();
+            if (frame != NULL)
+            {
+                _win_main_game_texture_copy(frame);
+                WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 1;
+            }
+        }
+
+        if ((WIN_MAIN_RUNNING != RUNNING_NONE)
+            && WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE)
         {
-            WH_Render(WinIDMain, WIN_MAIN_GAME_SCREEN_BUFFER);
+            WIN_MAIN_GAME_SCREEN_HAS_TO_UPDATE = 0;
+
+            // Waiting for the vertical blank doesn't count as work
+            if (FramePace_VSyncEnabled() && (EmuThread_IsEnabled() == 0))
+                _win_main_auto_frameskip_frame_end();
+
+            WH_RenderTexture(WinIDMain);
+
+            Latency_FramePresented();
         }
+
+        Profile_TimerEnd(PROFILE_PRESENT, present_start);
+
+        if (EmuThread_IsEnabled() == 0)
+            _win_main_auto_frameskip_frame_end();
     }
     else
     {
@@ -1434,15 +2518,269 @@ int Win_MainRunningGB(void)
     return (WIN_MAIN_RUNNING == RUNNING_GB);
 }
 
+// With late latch, the keys are read again when the game reads them for the
+// first time in the frame, instead of only at the start of the frame. Events
+// can only be pumped by the main thread, so it isn't used with the emulation
+// thread. It isn't used either when the input of each frame has to be the one
+// seen at its start: Movies, and run-ahead (which emulates the same frames
+// again with that input).
+static int _win_main_late_latch_enabled(void)
+{
+    if (EmulatorConfig.input_late_latch == 0)
+        return 0;
+
+    if (EmuThread_IsEnabled() || (EmulatorConfig.run_ahead_frames > 0))
+        return 0;
+
+    if (Movie_IsRecording() || Movie_IsPlaying())
+        return 0;
+
+    return 1;
+}
+
+static void _win_main_input_latch(void)
+{
+    SDL_PumpEvents();
+
+    _input_state_t state;
+    Input_GetState(&state);
+
+    // The keys that control the emulator keep the state of the frame start
+    memcpy(win_main_input_state.keys, state.keys, sizeof(state.keys));
+    win_main_input_state.mbc7_up = state.mbc7_up;
+    win_main_input_state.mbc7_down = state.mbc7_down;
+    win_main_input_state.mbc7_right = state.mbc7_right;
+    win_main_input_state.mbc7_left = state.mbc7_left;
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+        Input_SetState_GBA(&win_main_input_state);
+    else
+        Input_SetState_GB(&win_main_input_state);
+
+    Latency_InputApplied(&win_main_input_state);
+}
+
+static void _win_main_emulate_frame(void)
+{
+    Profile_FrameBegin();
+
+    _win_main_auto_frameskip_frame_start(_win_main_has_to_frameskip());
+
+    if (EmuThread_IsEnabled())
+        EmuThread_InputPop(&win_main_input_state);
+    else
+        Input_GetState(&win_main_input_state);
+
+    // Rewinding changes the state of the emulation, so it ends the movie
+    if ((EmulatorConfig.rewind_seconds > 0) && win_main_input_state.rewind)
+        Movie_Stop();
+    else
+        Movie_Frame(&win_main_input_state);
+
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+    {
+        Input_SetState_GBA(&win_main_input_state);
+
+        if (GBA_GPIORumbleEnabled())
+            Input_RumbleEnable();
+    }
+    else
+    {
+        Input_SetState_GB(&win_main_input_state);
+
+        if (GB_RumbleEnabled())
+            Input_RumbleEnable();
+    }
+
+    Latency_InputApplied(&win_main_input_state);
+
+    int late_latch = _win_main_late_latch_enabled();
+    if (late_latch)
+    {
+        if (WIN_MAIN_RUNNING == RUNNING_GBA)
+            GBA_InputLatchSet(_win_main_input_latch);
+        else
+            GB_InputLatchSet(_win_main_input_latch);
+    }
+
+    if (_win_main_rewind_frame() == 0)
+        _win_main_run_frame();
+    else
+        _win_main_screen_update();
+
+    // If the game hasn't read the keys in this frame, it doesn't matter
+    if (late_latch)
+    {
+        GBA_InputLatchSet(NULL);
+        GB_InputLatchSet(NULL);
+    }
+
+    Latency_FrameEmulated();
+
+    _win_main_update_frameskip();
+
+    _win_main_autosave();
+    _win_main_checkpoint();
+
+    WinMain_frames_drawn++;
+
+    // In the emulation thread, only the time it takes to emulate the frame is
+    // measured, the main thread presents it in parallel.
+    if (EmuThread_IsEnabled())
+        _win_main_auto_frameskip_frame_end();
+
+    Profile_FrameEnd();
+}
+
+// Maximum number of frames emulated for each presented frame at max speed
+#define WIN_MAIN_SPEEDUP_MAX_FRAMES     (60)
+
+// Emulates several frames, but only the last one is drawn and only its sound
+// is output. At max speed, it stops when the next frame would make the loop
+// take longer than a frame, so the window keeps being updated 60 times per
+// second.
+static void _win_main_emulate_speedup(void)
+{
+    int speed = EmulatorConfig.speedup_speed;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 limit = SDL_GetPerformanceFrequency() / 60;
+
+    for (int i = 0; i < WIN_MAIN_SPEEDUP_MAX_FRAMES; i++)
+    {
+        int last;
+
+        if (speed > 0)
+        {
+            last = (i == (speed - 1));
+        }
+        else
+        {
+            Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+
+            last = (i == (WIN_MAIN_SPEEDUP_MAX_FRAMES - 1))
+                   || ((i > 0) && ((elapsed + (elapsed / i)) >= limit));
+        }
+
+        _win_main_speedup_skip = !last;
+        _win_main_sound_suspend(0);
+
+        _win_main_emulate_frame();
+
+        if (last)
+            break;
+    }
+
+    _win_main_speedup_skip = 0;
+    _win_main_sound_suspend(0);
+}
+
+// Called by the emulation thread to emulate the frames of one iteration of the
+// main loop. The speedup key is checked in the input of the previous frame.
+static void _win_main_thread_frame(void)
+{
+    if (win_main_input_state.speedup)
+        _win_main_emulate_speedup();
+    else
+        _win_main_emulate_frame();
+}
+
+// Called by the emulation thread after each iteration. It's paced the same way
+// as the main loop when the emulation isn't in a separate thread.
+static void _win_main_thread_wait(void)
+{
+    if (win_main_input_state.speedup && (EmulatorConfig.speedup_speed == 0))
+    {
+        SDL_Delay(0);
+    }
+    else if (Sound_IsSyncEnabled())
+    {
+        Sound_WaitFrame();
+
+        FramePace_Reset();
+    }
+    else
+    {
+        FramePace_Wait();
+    }
+}
+
+// The debugger windows are updated with the frames emulated in the previous
+// iteration of the main loop. The emulation thread is paused at this point.
+static void _win_main_debugger_windows_auto_update(void)
+{
+    if (WIN_MAIN_RUNNING == RUNNING_GBA)
+    {
+        Win_GBAMemViewerAutoUpdate();
+        Win_GBATileViewerAutoUpdate();
+        Win_GBAMapViewerAutoUpdate();
+        Win_GBASprViewerAutoUpdate();
+        Win_GBAPalViewerAutoUpdate();
+    }
+    else if (WIN_MAIN_RUNNING == RUNNING_GB)
+    {
+        Win_GBMemViewerAutoUpdate();
+        Win_GBTileViewerAutoUpdate();
+        Win_GBMapViewerAutoUpdate();
+        Win_GBSprViewerAutoUpdate();
+        Win_GBPalViewerAutoUpdate();
+    }
+}
+
+// Emulates the frames of this iteration of the main loop, or lets the
+// emulation thread emulate them when it's resumed.
+static void _win_main_emulate(int speedup)
+{
+    if (EmuThread_IsEnabled())
+    {
+        _input_state_t state;
+        Input_GetState(&state);
+        EmuThread_InputPush(&state);
+
+        EmuThread_SetRunning(1);
+    }
+    else if (speedup)
+    {
+        _win_main_emulate_speedup();
+    }
+    else
+    {
+        _win_main_emulate_frame();
+    }
+}
+
+int Win_MainIsIdle(void)
+{
+    if (GUI_WindowGetEnabled(&mainwindow_fileexplorer_win)
+        && FileExplorer_IsScanning())
+    {
+        return 0;
+    }
+
+    // Same conditions as the ones that let Win_MainLoopHandle() emulate
+    if ((WIN_MAIN_RUNNING != RUNNING_NONE) && (WIN_MAIN_MENU_ENABLED == 0)
+        && WH_HasKeyboardFocus(WinIDMain))
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
 void Win_MainLoopHandle(void)
 {
     int speedup = Input_Speedup_Enabled();
 
     if (speedup)
-        Win_MainSetFrameskip(10);
+        Win_MainSetFrameskip(0);
     else
         Win_MainSetFrameskip(EmulatorConfig.frameskip);
 
+    // The emulation thread only runs if it's allowed below
+    EmuThread_SetRunning(0);
+
+    _win_main_file_explorer_poll();
+
     if (WH_HasKeyboardFocus(WinIDMain) && (WIN_MAIN_MENU_ENABLED == 0))
     {
         //if (GUI_WindowGetEnabled(&mainwindow_configwin)
@@ -1470,20 +2808,8 @@ void Win_MainLoopHandle(void)
 
             Win_GBADisassemblerStartAddressSetDefault();
 
-            if (speedup)
-                GBA_SoundResetBufferPointers();
-
-            GBA_SkipFrame(_win_main_has_to_frameskip());
-
-            Input_Update_GBA();
-            GBA_RunForOneFrame();
-
-            if (_win_main_has_to_frameskip() == 0)
-                GBA_ConvertScreenBufferTo24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
-
-            _win_main_update_frameskip();
-
-            WinMain_frames_drawn++;
+            _win_main_debugger_windows_auto_update();
+            _win_main_emulate(speedup);
         }
         else if (WIN_MAIN_RUNNING == RUNNING_GB)
         {
@@ -1493,23 +2819,8 @@ void Win_MainLoopHandle(void)
                 return;
             }
 
-            if (speedup)
-                GB_SoundResetBufferPointers();
-
-            GB_SkipFrame(_win_main_has_to_frameskip());
-
-            Input_Update_GB();
-
-            if (GB_RumbleEnabled())
-                Input_RumbleEnable();
-
-            GB_RunForOneFrame();
-            if (_win_main_has_to_frameskip() == 0)
-                GB_Screen_WriteBuffer_24RGB(WIN_MAIN_GAME_SCREEN_BUFFER);
-
-            _win_main_update_frameskip();
-
-            WinMain_frames_drawn++;
+            _win_main_debugger_windows_auto_update();
+            _win_main_emulate(speedup);
         }
     }
     else
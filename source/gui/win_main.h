@@ -12,6 +12,9 @@ void Win_MainRender(void);
 int Win_MainRunningGBA(void);
 int Win_MainRunningGB(void);
 void Win_MainLoopHandle(void);
+// Returns 1 if nothing is going to change until there is an event: the game
+// isn't being emulated and the GUI isn't waiting for anything.
+int Win_MainIsIdle(void);
 
 void Win_MainChangeZoom(int newzoom);
 void Win_MainSetFrameskip(int frameskip); // in win_main.c
@@ -101,6 +101,26 @@ int GUI_ConsoleColorizeLine(_gui_console *con, int y, int color)
     return 1;
 }
 
+int GUI_ConsoleColorizeRange(_gui_console *con, int x, int y, int len,
+                             int color)
+{
+    if ((y < 0) || (y >= con->__console_chars_h))
+        return 0;
+
+    if (x < 0)
+    {
+        len += x;
+        x = 0;
+    }
+    if ((x + len) > con->__console_chars_w)
+        len = con->__console_chars_w - x;
+
+    for (int i = 0; i < len; i++)
+        con->__console_buffer_color[y * con->__console_chars_w + x + i] = color;
+
+    return 1;
+}
+
 // buffer is 24 bit per pixel
 void GUI_ConsoleDraw(_gui_console *con, char *buffer, int buf_w, int buf_h)
 {
@@ -25,6 +25,9 @@ void GUI_ConsoleReset(_gui_console *con, int screen_width, int screen_height);
 void GUI_ConsoleClear(_gui_console *con);
 int GUI_ConsoleModePrintf(_gui_console *con, int x, int y, const char *txt, ...);
 int GUI_ConsoleColorizeLine(_gui_console *con, int y, int color);
+// Only changes the color, the characters are left as they are
+int GUI_ConsoleColorizeRange(_gui_console *con, int x, int y, int len,
+                             int color);
 // The buffer is 24 bit per pixel
 void GUI_ConsoleDraw(_gui_console *con, char *buffer, int buf_w, int buf_h);
 void GUI_ConsoleDrawAt(_gui_console *con, char *buffer, int buf_w, int buf_h,
@@ -52,9 +52,10 @@ static int _gui_inputwindow_send_event(_gui_inputwindow *win, SDL_Event *e)
         else if (key == SDLK_RETURN)
         {
             int l = strlen(win->input_text);
+            // Close it first so that the callback can open it again
+            win->enabled = 0;
             if (win->callback)
                 win->callback(win->input_text, (l > 0) ? 1 : 0);
-            win->enabled = 0;
         }
     }
     return 1;
@@ -281,19 +282,27 @@ int __gui_send_event_element(_gui_element **complete_gui, _gui_element *gui,
         }
         else if (e->type == SDL_MOUSEBUTTONUP)
         {
+            // Only redraw if the button was pressed. The event isn't used if
+            // it wasn't, so it can reach the button that was pressed.
             if (e->button.button == SDL_BUTTON_LEFT)
             {
-                gui->info.button.is_pressed = 0;
-                return 1;
+                if (gui->info.button.is_pressed)
+                {
+                    gui->info.button.is_pressed = 0;
+                    return 1;
+                }
             }
         }
         else if (e->type == SDL_MOUSEMOTION)
         {
-            if (_gui_pos_is_inside_rect(e->motion.x, e->motion.y,
-                                        gui->x, gui->w, gui->y, gui->h))
+            if (gui->info.button.is_pressed)
             {
-                gui->info.button.is_pressed = 0;
-                return 1;
+                if (_gui_pos_is_inside_rect(e->motion.x, e->motion.y,
+                                            gui->x, gui->w, gui->y, gui->h))
+                {
+                    gui->info.button.is_pressed = 0;
+                    return 1;
+                }
             }
         }
     }
@@ -477,6 +486,8 @@ int __gui_send_event_element(_gui_element **complete_gui, _gui_element *gui,
                         (gui->info.scrollabletextwindow.max_drawn_lines - 1)
                         * FONT_HEIGHT))
                 {
+                    int oldline = gui->info.scrollabletextwindow.currentline;
+
                     int percent = ((e->button.y - (baseycoord + FONT_HEIGHT))
                         * 100 ) /
                         ((gui->info.scrollabletextwindow.max_drawn_lines - 4)
@@ -499,12 +510,17 @@ int __gui_send_event_element(_gui_element **complete_gui, _gui_element *gui,
                     if (gui->info.scrollabletextwindow.currentline < 0)
                         gui->info.scrollabletextwindow.currentline = 0;
 
-                    return 1;
+                    // Dragging the bar generates lots of events that don't
+                    // change the line that is shown.
+                    return gui->info.scrollabletextwindow.currentline
+                           != oldline;
                 }
             }
         }
         else if (e->type == SDL_MOUSEWHEEL)
         {
+            int oldline = gui->info.scrollabletextwindow.currentline;
+
             gui->info.scrollabletextwindow.currentline -= e->wheel.y * 3;
 
             if (gui->info.scrollabletextwindow.currentline >=
@@ -517,7 +533,7 @@ int __gui_send_event_element(_gui_element **complete_gui, _gui_element *gui,
             }
             if (gui->info.scrollabletextwindow.currentline < 0)
                 gui->info.scrollabletextwindow.currentline = 0;
-            return 1;
+            return gui->info.scrollabletextwindow.currentline != oldline;
         }
         else if (e->type == SDL_KEYDOWN)
         {
@@ -656,6 +672,8 @@ int __gui_send_event_element(_gui_element **complete_gui, _gui_element *gui,
                 if (_gui_pos_is_inside_rect(e->button.x, e->button.y,
                                             gui->x, gui->w, gui->y, gui->h))
                 {
+                    int oldvalue = gui->info.scrollbar.value;
+
                     int rel_x = e->button.x - gui->x;
                     int rel_y = e->button.y - gui->y;
 
@@ -729,6 +747,10 @@ int __gui_send_event_element(_gui_element **complete_gui, _gui_element *gui,
                     if (gui->info.scrollbar.value > gui->info.scrollbar.value_max)
                         gui->info.scrollbar.value = gui->info.scrollbar.value_max;
 
+                    // Don't redraw the window if the value hasn't changed
+                    if (gui->info.scrollbar.value == oldvalue)
+                        return 0;
+
                     if (gui->info.scrollbar.callback)
                         gui->info.scrollbar.callback(gui->info.scrollbar.value);
 
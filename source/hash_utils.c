@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__ARM_FEATURE_CRC32)
+# include <arm_acle.h>
+#endif
+
+#include "general_utils.h"
+#include "hash_utils.h"
+
+#define HASH_CRC32C_POLYNOMIAL  (0x82F63B78) // Reflected
+
+// Tables to process 8 bytes at a time ("slicing-by-8"). They aren't
+// thread-local, they are filled once before main() and only read after that.
+static u32 hash_table[8][256];
+
+static int hash_accelerated = 0;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+# define HASH_X86_CRC32
+
+__attribute__((target("sse4.2")))
+static u32 hash_crc32c_x86(u32 crc, const u8 *data, size_t size)
+{
+    while ((size > 0) && (((uintptr_t)data & 7) != 0))
+    {
+        crc = __builtin_ia32_crc32qi(crc, *data++);
+        size--;
+    }
+
+# if defined(__x86_64__)
+    u64 crc64 = crc;
+    while (size >= 8)
+    {
+        u64 value;
+        memcpy(&value, data, sizeof(value));
+        crc64 = __builtin_ia32_crc32di(crc64, value);
+        data += 8;
+        size -= 8;
+    }
+    crc = (u32)crc64;
+# endif
+
+    while (size >= 4)
+    {
+        u32 value;
+        memcpy(&value, data, sizeof(value));
+        crc = __builtin_ia32_crc32si(crc, value);
+        data += 4;
+        size -= 4;
+    }
+
+    while (size > 0)
+    {
+        crc = __builtin_ia32_crc32qi(crc, *data++);
+        size--;
+    }
+
+    return crc;
+}
+
+#elif defined(__GNUC__) && defined(__ARM_FEATURE_CRC32)
+
+# define HASH_ARM_CRC32
+
+static u32 hash_crc32c_arm(u32 crc, const u8 *data, size_t size)
+{
+    while (size >= 8)
+    {
+        u64 value;
+        memcpy(&value, data, sizeof(value));
+        crc = __crc32cd(crc, value);
+        data += 8;
+        size -= 8;
+    }
+
+    while (size > 0)
+    {
+        crc = __crc32cb(crc, *data++);
+        size--;
+    }
+
+    return crc;
+}
+
+#endif
+
+// The result of slicing-by-8 depends on the byte order of the words it reads,
+// so the tables are only used 8 bytes at a time in little endian hosts.
+static u32 hash_crc32c_table(u32 crc, const u8 *data, size_t size)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    while (size >= 8)
+    {
+        u32 low, high;
+        memcpy(&low, data, sizeof(low));
+        memcpy(&high, data + 4, sizeof(high));
+        low ^= crc;
+
+        crc = hash_table[7][low & 0xFF] ^ hash_table[6][(low >> 8) & 0xFF]
+              ^ hash_table[5][(low >> 16) & 0xFF] ^ hash_table[4][low >> 24]
+              ^ hash_table[3][high & 0xFF]
+              ^ hash_table[2][(high >> 8) & 0xFF]
+              ^ hash_table[1][(high >> 16) & 0xFF]
+              ^ hash_table[0][high >> 24];
+
+        data += 8;
+        size -= 8;
+    }
+#endif
+
+    while (size > 0)
+    {
+        crc = hash_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        size--;
+    }
+
+    return crc;
+}
+
+__attribute__((constructor))
+static void hash_init(void)
+{
+    for (u32 i = 0; i < 256; i++)
+    {
+        u32 crc = i;
+        for (int j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ ((crc & 1) ? HASH_CRC32C_POLYNOMIAL : 0);
+        hash_table[0][i] = crc;
+    }
+
+    for (u32 i = 0; i < 256; i++)
+    {
+        for (int j = 1; j < 8; j++)
+        {
+            u32 crc = hash_table[j - 1][i];
+            hash_table[j][i] = hash_table[0][crc & 0xFF] ^ (crc >> 8);
+        }
+    }
+
+#if defined(HASH_X86_CRC32)
+    __builtin_cpu_init();
+    hash_accelerated = __builtin_cpu_supports("sse4.2") != 0;
+#elif defined(HASH_ARM_CRC32)
+    hash_accelerated = 1;
+#endif
+}
+
+u32 Hash_CRC32C(u32 crc, const void *data, size_t size)
+{
+    crc = ~crc;
+
+#if defined(HASH_X86_CRC32)
+    if (hash_accelerated)
+        return ~hash_crc32c_x86(crc, data, size);
+#elif defined(HASH_ARM_CRC32)
+    return ~hash_crc32c_arm(crc, data, size);
+#endif
+
+    return ~hash_crc32c_table(crc, data, size);
+}
+
+int Hash_IsAccelerated(void)
+{
+    return hash_accelerated;
+}
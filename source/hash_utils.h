@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef HASH_UTILS__
+#define HASH_UTILS__
+
+// CRC32C (Castagnoli polynomial) of the video and audio output of the cores.
+// The cores hash their framebuffers while they draw them and the samples while
+// they flush them, so the hash of a frame is ready once it has been emulated.
+//
+// The CRC32 instruction of SSE 4.2 (x86) or ARMv8 is used if the CPU supports
+// it, and a table based implementation otherwise. The result is the same.
+
+#include <stddef.h>
+
+#include "general_utils.h"
+
+// Pass 0 as crc to start a hash, or the result of a previous call to continue
+// it with more data.
+u32 Hash_CRC32C(u32 crc, const void *data, size_t size);
+
+// Returns 1 if the CRC32 instructions of the CPU are used
+int Hash_IsAccelerated(void);
+
+#endif // HASH_UTILS__
@@ -0,0 +1,1511 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "build_options.h"
+#include "config.h"
+#include "core_api.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "headless.h"
+#include "input_utils.h"
+#include "movie_utils.h"
+#include "png_utils.h"
+#include "profile_utils.h"
+#include "resample_utils.h"
+#include "romcache_utils.h"
+#include "trace_utils.h"
+
+#include "gb_core/gameboy.h"
+#include "gb_core/gb_main.h"
+#include "gb_core/sound.h"
+#include "gb_core/video.h"
+#include "gba_core/bios.h"
+#include "gba_core/gba.h"
+#include "gba_core/gpio.h"
+#include "gba_core/save.h"
+#include "gba_core/sound.h"
+#include "gba_core/video.h"
+
+#define HEADLESS_DEFAULT_FRAMES     (600)
+
+// Time seen by the RTC of the ROMs when they are loaded (2000-01-01 00:00:00)
+#define HEADLESS_RTC_TIME           (946684800)
+
+// Clocks of one frame at the base speed of each system
+#define HEADLESS_GB_FRAME_CLOCKS    (70224)
+#define HEADLESS_GBA_FRAME_CLOCKS   (280896)
+
+// While benchmarking with audio, the samples that an output device would play
+// are read after each frame. The frontend runs at this many frames per second.
+#define HEADLESS_AUDIO_FRAMES_PER_SECOND    (60)
+#define HEADLESS_AUDIO_MAX_FRAMES           (4096)
+
+extern core_local__ _GB_CONTEXT_ GameBoy;
+
+typedef enum
+{
+    HEADLESS_ROM_NONE,
+    HEADLESS_ROM_GB,
+    HEADLESS_ROM_GBA,
+} _headless_rom_type_e;
+
+typedef struct
+{
+    _headless_rom_type_e type;
+    void *bios_buffer;
+    _file_map_t rom_map;
+} _headless_rom_t;
+
+static void Headless_Usage(void)
+{
+    fprintf(stderr,
+            "Usage: giibiiadvance --headless [options] rom\n"
+            "\n"
+            "Options:\n"
+            "  --frames N   Number of frames to run (default: %d)\n"
+            "  --frame-hashes FILE\n"
+            "               Write the hashes of the screen and the audio of\n"
+            "               each frame, to compare runs of the same movie\n"
+            "  --hash       Print a hash of the last frame\n"
+            "  --movie FILE Play a movie (by default, until it ends)\n"
+            "  --png FILE   Save the last frame as a PNG file\n"
+            "  --time       Print how long it took to run the frames\n"
+            "  --trace FILE Save an execution trace of the frames\n"
+            "\n"
+            "Usage: giibiiadvance --bench [--frames N] [--no-audio] rom ...\n"
+            "\n"
+            "Runs each ROM for N frames (default: %d) and prints the speed\n"
+            "of the emulation as JSON. The audio is read as if it was\n"
+            "played at %d frames per second, and the health of the audio\n"
+            "buffer is included in the results. With --no-audio no samples\n"
+            "are generated.\n"
+            "\n"
+            "Usage: giibiiadvance --test [options] manifest\n"
+            "\n"
+            "Runs the ROMs of the manifest and compares the hashes of the\n"
+            "last frame and of the audio with the expected ones.\n"
+            "\n"
+            "Options:\n"
+            "  --jobs N      Number of threads (default: number of CPUs)\n"
+            "  --pin         Keep each thread in its own CPU\n"
+            "  --pool N      Run each ROM in N consoles of a core pool in\n"
+            "                lockstep, they must all give the expected\n"
+            "                hashes (needs ENABLE_THREAD_LOCAL_CORES)\n"
+            "  --update FILE Write a manifest with the current hashes\n"
+            "\n"
+            "Usage: giibiiadvance --decode-trace trace [output]\n"
+            "\n"
+            "Disassembles an execution trace and writes it as text to the\n"
+            "output file (default: standard output).\n",
+            HEADLESS_DEFAULT_FRAMES, HEADLESS_DEFAULT_FRAMES,
+            HEADLESS_AUDIO_FRAMES_PER_SECOND);
+}
+
+static _headless_rom_type_e Headless_GetRomType(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL)
+        return HEADLESS_ROM_NONE;
+
+    char extension[4];
+    int len = strlen(dot + 1);
+    if (len > 3)
+        return HEADLESS_ROM_NONE;
+
+    for (int i = 0; i <= len; i++)
+        extension[i] = toupper(dot[1 + i]);
+
+    if ((strcmp(extension, "GBA") == 0) || (strcmp(extension, "AGB") == 0)
+        || (strcmp(extension, "BIN") == 0))
+    {
+        return HEADLESS_ROM_GBA;
+    }
+
+    if ((strcmp(extension, "GB") == 0) || (strcmp(extension, "GBC") == 0)
+        || (strcmp(extension, "CGB") == 0) || (strcmp(extension, "SGB") == 0))
+    {
+        return HEADLESS_ROM_GB;
+    }
+
+    return HEADLESS_ROM_NONE;
+}
+
+#define HEADLESS_HASH_INIT  (0xCBF29CE484222325ULL)
+
+// FNV-1a
+static u64 Headless_HashUpdate(u64 hash, const void *data, size_t size)
+{
+    const u8 *p = data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static u64 Headless_Hash(const void *data, size_t size)
+{
+    return Headless_HashUpdate(HEADLESS_HASH_INIT, data, size);
+}
+
+static int Headless_Init(void)
+{
+    if (SDL_Init(SDL_INIT_TIMER) != 0)
+    {
+        fprintf(stderr, "SDL could not initialize! SDL Error: %s\n",
+                SDL_GetError());
+        return 1;
+    }
+    atexit(SDL_Quit);
+
+    // The configuration file isn't loaded so that the results don't depend on
+    // it. The sound is muted, it isn't played anyway.
+    EmulatorConfig.snd_mute = 1;
+
+    GB_RTC_SetFixedTime(HEADLESS_RTC_TIME);
+    GBA_GPIOSetFixedTime(HEADLESS_RTC_TIME);
+
+    return 0;
+}
+
+// Returns 0 on success
+static int Headless_Load(_headless_rom_t *rom, char *rom_path)
+{
+    rom->type = Headless_GetRomType(rom_path);
+    rom->bios_buffer = NULL;
+    rom->rom_map.data = NULL;
+
+    if (rom->type == HEADLESS_ROM_NONE)
+    {
+        fprintf(stderr, "Unknown ROM type: %s\n", rom_path);
+        return 1;
+    }
+
+    if (rom->type == HEADLESS_ROM_GB)
+    {
+        if (GB_ROMLoad(rom_path) == 0)
+            return 1;
+    }
+    else
+    {
+        char bios_path[MAX_PATHLEN];
+        unsigned int bios_size = 0;
+        snprintf(bios_path, sizeof(bios_path), "%s" GBA_BIOS_FILENAME,
+                 DirGetBiosFolderPath());
+
+        FileLoad_NoError(bios_path, &rom->bios_buffer, &bios_size);
+        GBA_BiosLoaded(bios_size != 0);
+
+        if (FileMap(rom_path, GBA_ROM_BUFFER_SIZE, &rom->rom_map) != 0)
+        {
+            free(rom->bios_buffer);
+            return 1;
+        }
+
+        // Detecting the save type reads the whole ROM, skip it if possible
+        int save_type;
+        int cached = RomCache_GetSaveType(rom_path, rom->rom_map.data,
+                                          rom->rom_map.size, &save_type) == 0;
+        if (cached)
+            GBA_SaveSetKnownType(save_type);
+
+        GBA_SaveSetFilename(rom_path);
+        GBA_InitRomInPlace(rom->bios_buffer, rom->rom_map.data,
+                           rom->rom_map.size);
+
+        if (cached == 0)
+        {
+            RomCache_SetSaveType(rom_path, rom->rom_map.data,
+                                 rom->rom_map.size, GBA_SaveGetDetectedType());
+        }
+    }
+
+    return 0;
+}
+
+// The sound hardware is still emulated without output, but the samples aren't
+// generated, which saves time when nobody is going to listen to them.
+static void Headless_SetAudioOutput(const _headless_rom_t *rom, int enable)
+{
+    if (rom->type == HEADLESS_ROM_GB)
+        GB_SoundSetOutputSuspended(!enable);
+    else
+        GBA_SoundSetOutputSuspended(!enable);
+}
+
+// Reads one frame of audio like the audio callback would, so that the buffer
+// between the emulation and the callback behaves like when the sound is played.
+static void Headless_ReadAudio(const _headless_rom_t *rom)
+{
+    static s16 buffer[HEADLESS_AUDIO_MAX_FRAMES * 2];
+
+    u32 frames = Resample_GetOutputRate() / HEADLESS_AUDIO_FRAMES_PER_SECOND;
+    if (frames > HEADLESS_AUDIO_MAX_FRAMES)
+        frames = HEADLESS_AUDIO_MAX_FRAMES;
+
+    u64 start = Profile_TimerBegin();
+
+    if (rom->type == HEADLESS_ROM_GB)
+        GB_SoundCallback(buffer, frames * 4);
+    else
+        GBA_SoundCallback(buffer, frames * 4);
+
+    Profile_TimerEnd(PROFILE_MIXING, start);
+}
+
+// Returns the number of clocks of the emulated system that have been run. If
+// "read_audio" is set, the audio is read after each frame.
+static u64 Headless_RunFrames(const _headless_rom_t *rom, long frames,
+                              int read_audio)
+{
+    u64 clocks = 0;
+
+    for (long i = 0; i < frames; i++)
+    {
+        if (Movie_IsPlaying())
+        {
+            _input_state_t state;
+            memset(&state, 0, sizeof(state));
+            Movie_Frame(&state);
+
+            if (rom->type == HEADLESS_ROM_GB)
+                Input_SetState_GB(&state);
+            else
+                Input_SetState_GBA(&state);
+        }
+
+        if (rom->type == HEADLESS_ROM_GB)
+        {
+            GB_RunForOneFrame();
+            clocks += HEADLESS_GB_FRAME_CLOCKS
+                      << GameBoy.Emulator.DoubleSpeed;
+        }
+        else
+        {
+            GBA_RunForOneFrame();
+            clocks += HEADLESS_GBA_FRAME_CLOCKS;
+        }
+
+        if (read_audio)
+            Headless_ReadAudio(rom);
+    }
+
+    return clocks;
+}
+
+// Returns the last frame as 32-bit RGB pixels, to be freed by the caller
+static u32 *Headless_GetScreen(const _headless_rom_t *rom, int *width,
+                               int *height)
+{
+    if (rom->type == HEADLESS_ROM_GB)
+    {
+        GB_ScreenGetSize(width, height);
+    }
+    else
+    {
+        *width = 240;
+        *height = 160;
+    }
+
+    u32 *screen = calloc(*width * *height, sizeof(u32));
+    if (screen == NULL)
+        return NULL;
+
+    if (rom->type == HEADLESS_ROM_GB)
+        GB_ScreenConvertLastFrameTo32RGB(screen);
+    else
+        GBA_ConvertScreenBufferTo32RGB(screen);
+
+    return screen;
+}
+
+static void Headless_Unload(_headless_rom_t *rom)
+{
+    // Don't overwrite the save data of the ROM
+    if (rom->type == HEADLESS_ROM_GB)
+    {
+        GB_End(0);
+    }
+    else
+    {
+        GBA_EndRom(0);
+        free(rom->bios_buffer);
+        FileUnmap(&rom->rom_map);
+    }
+}
+
+int Headless_Run(int argc, char *argv[])
+{
+    char *rom_path = NULL;
+    const char *png_path = NULL;
+    const char *trace_path = NULL;
+    const char *movie_path = NULL;
+    const char *hashes_path = NULL;
+    long frames = -1;
+    int print_hash = 0;
+    int print_time = 0;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc))
+        {
+            frames = strtol(argv[++i], NULL, 0);
+            if (frames < 0)
+            {
+                Headless_Usage();
+                return 1;
+            }
+        }
+        else if ((strcmp(argv[i], "--png") == 0) && (i + 1 < argc))
+        {
+            png_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+        {
+            trace_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--movie") == 0) && (i + 1 < argc))
+        {
+            movie_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--frame-hashes") == 0) && (i + 1 < argc))
+        {
+            hashes_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--hash") == 0)
+        {
+            print_hash = 1;
+        }
+        else if (strcmp(argv[i], "--time") == 0)
+        {
+            print_time = 1;
+        }
+        else if ((argv[i][0] != '-') && (rom_path == NULL))
+        {
+            rom_path = argv[i];
+        }
+        else
+        {
+            Headless_Usage();
+            return 1;
+        }
+    }
+
+    if (rom_path == NULL)
+    {
+        Headless_Usage();
+        return 1;
+    }
+
+    if (Headless_Init() != 0)
+        return 1;
+
+    _headless_rom_t rom;
+    if (Headless_Load(&rom, rom_path) != 0)
+        return 1;
+
+    // Only the screen is saved, the audio is only needed for its hashes
+    Headless_SetAudioOutput(&rom, hashes_path != NULL);
+
+    if (movie_path)
+    {
+        _savestate_system_e system = (rom.type == HEADLESS_ROM_GB) ?
+                                     SAVESTATE_SYSTEM_GB : SAVESTATE_SYSTEM_GBA;
+        if (Movie_PlayStart(movie_path, system) != 0)
+        {
+            Headless_Unload(&rom);
+            return 1;
+        }
+
+        if (frames < 0)
+            frames = Movie_GetLength();
+    }
+
+    if (frames < 0)
+        frames = HEADLESS_DEFAULT_FRAMES;
+
+    if (trace_path)
+    {
+        _trace_system_e system = (rom.type == HEADLESS_ROM_GB) ?
+                                 TRACE_GB : TRACE_GBA;
+        if (Trace_Start(trace_path, system) != 0)
+        {
+            Headless_Unload(&rom);
+            return 1;
+        }
+    }
+
+    FILE *hashes = NULL;
+    if (hashes_path)
+    {
+        hashes = fopen(hashes_path, "w");
+        if (hashes == NULL)
+        {
+            fprintf(stderr, "Can't open %s\n", hashes_path);
+            Trace_Stop();
+            Movie_Stop();
+            Headless_Unload(&rom);
+            return 1;
+        }
+    }
+
+    Uint32 start = SDL_GetTicks();
+
+    if (hashes)
+    {
+        // The hashes are calculated by the cores while they emulate the frame,
+        // so the frames don't need to be converted to get them.
+        for (long i = 0; i < frames; i++)
+        {
+            Headless_RunFrames(&rom, 1, 0);
+
+            u32 screen_hash, audio_hash;
+            if (rom.type == HEADLESS_ROM_GB)
+            {
+                screen_hash = GB_ScreenGetHash();
+                audio_hash = GB_SoundGetFrameHash();
+            }
+            else
+            {
+                screen_hash = GBA_ScreenBufferGetHash();
+                audio_hash = GBA_SoundGetFrameHash();
+            }
+
+            fprintf(hashes, "%ld %08x %08x\n", i, (unsigned int)screen_hash,
+                    (unsigned int)audio_hash);
+        }
+    }
+    else
+    {
+        Headless_RunFrames(&rom, frames, 0);
+    }
+
+    Uint32 elapsed = SDL_GetTicks() - start;
+
+    if (hashes)
+        fclose(hashes);
+
+    Trace_Stop();
+    Movie_Stop();
+
+    // Last frame
+
+    int width, height;
+    u32 *screen = Headless_GetScreen(&rom, &width, &height);
+    if (screen == NULL)
+    {
+        Headless_Unload(&rom);
+        return 1;
+    }
+
+    int ret = 0;
+
+    if (print_hash)
+    {
+        printf("%016llx\n", (unsigned long long)Headless_Hash(screen,
+                                        width * height * sizeof(u32)));
+    }
+
+    if (png_path)
+    {
+        if (Save_PNG(png_path, width, height, screen, 0) != 0)
+            ret = 1;
+    }
+
+    if (print_time)
+    {
+        double fps = (elapsed > 0) ? (frames * 1000.0) / elapsed : 0.0;
+        fprintf(stderr, "%ld frames in %u ms (%.1f FPS)\n", frames,
+                (unsigned int)elapsed, fps);
+    }
+
+    free(screen);
+
+    Headless_Unload(&rom);
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+
+// Prints a string as a JSON string, escaping the characters that need it
+static void Headless_PrintJSONString(const char *str)
+{
+    putchar('"');
+
+    for ( ; *str != '\0'; str++)
+    {
+        unsigned char c = *str;
+
+        if ((c == '"') || (c == '\\'))
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+
+    putchar('"');
+}
+
+static void Headless_PrintJSONResult(const char *indent, long frames,
+                                     u64 clocks, double seconds,
+                                     const double *section_seconds)
+{
+    double fps = (seconds > 0.0) ? frames / seconds : 0.0;
+    double mhz = (seconds > 0.0) ? (clocks / seconds) / 1000000.0 : 0.0;
+
+    printf("%s\"frames\": %ld,\n", indent, frames);
+    printf("%s\"seconds\": %.6f,\n", indent, seconds);
+    printf("%s\"fps\": %.2f,\n", indent, fps);
+    printf("%s\"guest_mhz\": %.3f,\n", indent, mhz);
+    printf("%s\"time\": {", indent);
+    for (int i = 0; i < PROFILE_NUMBER; i++)
+    {
+        printf("%s\"%s\": %.6f", (i == 0) ? " " : ", ", Profile_GetName(i),
+               section_seconds[i]);
+    }
+    printf(" }\n");
+}
+
+static void Headless_PrintJSONAudio(const char *indent,
+                                    const _resample_stats_t *stats)
+{
+    printf("%s\"audio\": {\n", indent);
+    printf("%s  \"reads\": %u,\n", indent, (unsigned int)stats->reads);
+    printf("%s  \"underruns\": %u,\n", indent,
+           (unsigned int)stats->underruns);
+    printf("%s  \"underrun_frames\": %u,\n", indent,
+           (unsigned int)stats->underrun_frames);
+    printf("%s  \"overruns\": %u,\n", indent, (unsigned int)stats->overruns);
+    printf("%s  \"overrun_frames\": %u,\n", indent,
+           (unsigned int)stats->overrun_frames);
+    printf("%s  \"ratio_ppm\": { \"last\": %d, \"min\": %d, "
+           "\"max\": %d },\n", indent, (int)stats->ratio_ppm,
+           (int)stats->ratio_ppm_min, (int)stats->ratio_ppm_max);
+    printf("%s  \"fill_histogram\": [", indent);
+    for (int i = 0; i < RESAMPLE_FILL_BUCKETS; i++)
+        printf("%s%u", (i == 0) ? " " : ", ", (unsigned int)stats->fill[i]);
+    printf(" ]\n");
+    printf("%s},\n", indent);
+}
+
+int Headless_Bench(int argc, char *argv[])
+{
+    long frames = HEADLESS_DEFAULT_FRAMES;
+    int num_roms = 0;
+    int audio = 1;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc))
+        {
+            frames = strtol(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--no-audio") == 0)
+        {
+            audio = 0;
+        }
+        else if (argv[i][0] != '-')
+        {
+            num_roms++;
+        }
+        else
+        {
+            Headless_Usage();
+            return 1;
+        }
+    }
+
+    if ((num_roms == 0) || (frames <= 0))
+    {
+        Headless_Usage();
+        return 1;
+    }
+
+    if (Headless_Init() != 0)
+        return 1;
+
+    double total_seconds = 0.0;
+    double total_section_seconds[PROFILE_NUMBER] = { 0 };
+    long total_frames = 0;
+    u64 total_clocks = 0;
+    int ret = 0;
+
+    printf("{\n");
+    printf("  \"roms\": [");
+
+    int first = 1;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0)
+        {
+            i++;
+            continue;
+        }
+        if (strcmp(argv[i], "--no-audio") == 0)
+            continue;
+
+        // The ROM is run twice. The first time nothing else is measured, so
+        // the speed isn't affected by the profiler. The second time the
+        // profiler measures how the time is split between the subsystems, and
+        // that split is applied to the time of the first run.
+
+        _headless_rom_t rom;
+        if (Headless_Load(&rom, argv[i]) != 0)
+        {
+            ret = 1;
+            continue;
+        }
+
+        Headless_SetAudioOutput(&rom, audio);
+
+        // Loading the ROM isn't part of the measurement
+        u64 start = SDL_GetPerformanceCounter();
+        u64 clocks = Headless_RunFrames(&rom, frames, audio);
+        u64 end = SDL_GetPerformanceCounter();
+
+        _resample_stats_t audio_stats;
+        if (rom.type == HEADLESS_ROM_GB)
+            GB_SoundGetOutputStats(&audio_stats);
+        else
+            GBA_SoundGetOutputStats(&audio_stats);
+
+        Headless_Unload(&rom);
+
+        double seconds = (double)(end - start)
+                         / (double)SDL_GetPerformanceFrequency();
+
+        if (Headless_Load(&rom, argv[i]) != 0)
+        {
+            ret = 1;
+            continue;
+        }
+
+        Headless_SetAudioOutput(&rom, audio);
+
+        Profile_Start();
+        Headless_RunFrames(&rom, frames, audio);
+        Profile_Stop();
+
+        Headless_Unload(&rom);
+
+        double profiled_seconds = 0.0;
+        for (int j = 0; j < PROFILE_NUMBER; j++)
+            profiled_seconds += Profile_GetSeconds(j);
+
+        double section_seconds[PROFILE_NUMBER];
+        for (int j = 0; j < PROFILE_NUMBER; j++)
+        {
+            section_seconds[j] = (profiled_seconds > 0.0) ?
+                    seconds * (Profile_GetSeconds(j) / profiled_seconds) : 0.0;
+        }
+
+        total_seconds += seconds;
+        total_frames += frames;
+        total_clocks += clocks;
+        for (int j = 0; j < PROFILE_NUMBER; j++)
+            total_section_seconds[j] += section_seconds[j];
+
+        printf("%s\n    {\n", first ? "" : ",");
+        first = 0;
+
+        printf("      \"rom\": ");
+        Headless_PrintJSONString(argv[i]);
+        printf(",\n");
+        printf("      \"system\": \"%s\",\n",
+               (rom.type == HEADLESS_ROM_GB) ? "gb" : "gba");
+        if (audio)
+            Headless_PrintJSONAudio("      ", &audio_stats);
+        Headless_PrintJSONResult("      ", frames, clocks, seconds,
+                                 section_seconds);
+        printf("    }");
+        fflush(stdout);
+    }
+
+    printf("%s],\n", first ? "" : "\n  ");
+
+    printf("  \"total\": {\n");
+    Headless_PrintJSONResult("    ", total_frames, total_clocks, total_seconds,
+                             total_section_seconds);
+    printf("  }\n");
+    printf("}\n");
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+
+// Regression tests. Each line of the manifest has the path of a ROM (relative
+// to the manifest), the number of frames to run, and the expected hashes of the
+// last frame and of all the audio generated while running. A hash can be "-"
+// if it doesn't have to be checked. Everything after a '#' is a comment.
+//
+//     # rom              frames  screen            audio
+//     cpu_instrs.gb      3000    1b7f5a4c2c8e08a1  -
+//
+// The hash of the screen is the same one printed by "--headless --hash". The
+// ROMs are run by a pool of threads that take the next ROM of the list when
+// they are done with the previous one. They are sorted so that the longest
+// ones start first and no thread is left alone with one of them at the end.
+//
+// With "--pool N" each ROM is loaded instead in all the consoles of a pool of
+// the core API, and they are run one frame at a time in lockstep. All of them
+// have to give the expected hashes, and the same ones, so this checks that the
+// consoles don't share any state.
+
+typedef enum
+{
+    HEADLESS_TEST_PASS,
+    HEADLESS_TEST_FAIL,
+    HEADLESS_TEST_ERROR, // The ROM couldn't be loaded
+} _headless_test_result_e;
+
+typedef struct
+{
+    char name[MAX_PATHLEN]; // As written in the manifest
+    char path[MAX_PATHLEN];
+    long frames;
+    int check_screen;
+    int check_audio;
+    u64 expected_screen;
+    u64 expected_audio;
+
+    _headless_test_result_e result;
+    u64 screen;
+    u64 audio;
+    double seconds;
+    int mismatch; // Console of the pool that disagrees with the first one
+} _headless_test_t;
+
+static _headless_test_t *headless_tests;
+static int headless_tests_count;
+static int *headless_tests_order; // Indices sorted by number of frames
+static SDL_atomic_t headless_tests_next;
+static int headless_tests_update; // All the hashes are needed for the manifest
+static int headless_tests_pin; // Pin the threads to CPUs
+
+// Loading the ROMs isn't thread-safe (the cache of save types is shared), but
+// it takes a lot less time than running them.
+static SDL_mutex *headless_load_mutex;
+
+static core_local__ u64 headless_audio_hash;
+
+static void Headless_AudioTap(const s16 *samples, u32 frames,
+                              unused__ u32 rate)
+{
+    headless_audio_hash = Headless_HashUpdate(headless_audio_hash, samples,
+                                              frames * 2 * sizeof(s16));
+}
+
+// Returns 0 on success
+static int Headless_TestParseHash(const char *str, int *check, u64 *hash)
+{
+    if (strcmp(str, "-") == 0)
+    {
+        *check = 0;
+        return 0;
+    }
+
+    char *end;
+    *hash = strtoull(str, &end, 16);
+    *check = 1;
+
+    return (*end != '\0');
+}
+
+// Returns 0 on success
+static int Headless_TestLoadManifest(const char *manifest_path)
+{
+    FILE *f = fopen(manifest_path, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Can't open %s\n", manifest_path);
+        return 1;
+    }
+
+    // Directory of the manifest, with the separator at the end
+    char dir[MAX_PATHLEN];
+    s_strncpy(dir, manifest_path, sizeof(dir));
+    char *sep = strrchr(dir, '/');
+    char *sep_win = strrchr(dir, '\\');
+    if ((sep_win != NULL) && ((sep == NULL) || (sep_win > sep)))
+        sep = sep_win;
+    if (sep != NULL)
+        sep[1] = '\0';
+    else
+        dir[0] = '\0';
+
+    char line[MAX_PATHLEN + 128];
+    int line_number = 0;
+    int ret = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        line_number++;
+
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        const char *delim = " \t\r\n";
+        char *rom = strtok(line, delim);
+        if (rom == NULL)
+            continue; // Empty line
+
+        char *frames = strtok(NULL, delim);
+        char *screen = strtok(NULL, delim);
+        char *audio = strtok(NULL, delim);
+
+        _headless_test_t test;
+        memset(&test, 0, sizeof(test));
+
+        char *end = NULL;
+        if (frames != NULL)
+            test.frames = strtol(frames, &end, 0);
+
+        if ((audio == NULL) || (strtok(NULL, delim) != NULL)
+            || (*end != '\0') || (test.frames <= 0)
+            || Headless_TestParseHash(screen, &test.check_screen,
+                                      &test.expected_screen)
+            || Headless_TestParseHash(audio, &test.check_audio,
+                                      &test.expected_audio))
+        {
+            fprintf(stderr, "%s:%d: Invalid line\n", manifest_path,
+                    line_number);
+            ret = 1;
+            break;
+        }
+
+        s_strncpy(test.name, rom, sizeof(test.name));
+
+        int absolute = (rom[0] == '/') || (rom[0] == '\\')
+                       || (isalpha((unsigned char)rom[0]) && (rom[1] == ':'));
+        snprintf(test.path, sizeof(test.path), "%s%s", absolute ? "" : dir,
+                 rom);
+
+        _headless_test_t *tests = realloc(headless_tests,
+                            (headless_tests_count + 1) * sizeof(*tests));
+        if (tests == NULL)
+        {
+            fprintf(stderr, "Not enough memory\n");
+            ret = 1;
+            break;
+        }
+        headless_tests = tests;
+        headless_tests[headless_tests_count++] = test;
+    }
+
+    fclose(f);
+
+    if ((ret == 0) && (headless_tests_count == 0))
+    {
+        fprintf(stderr, "%s: No ROMs to test\n", manifest_path);
+        ret = 1;
+    }
+
+    return ret;
+}
+
+static int Headless_TestCompareFrames(const void *a, const void *b)
+{
+    long frames_a = headless_tests[*(const int *)a].frames;
+    long frames_b = headless_tests[*(const int *)b].frames;
+
+    if (frames_a != frames_b)
+        return (frames_a < frames_b) ? 1 : -1;
+
+    return *(const int *)a - *(const int *)b; // Keep the order of the manifest
+}
+
+static void Headless_TestRun(_headless_test_t *test)
+{
+    _headless_rom_t rom;
+
+    SDL_LockMutex(headless_load_mutex);
+    // Same random values on every run, no matter which ROMs ran before. The
+    // clock is set here too because each thread has its own core state.
+    core_srand(1);
+    GB_RTC_SetFixedTime(HEADLESS_RTC_TIME);
+    GBA_GPIOSetFixedTime(HEADLESS_RTC_TIME);
+    int ret = Headless_Load(&rom, test->path);
+    SDL_UnlockMutex(headless_load_mutex);
+
+    if (ret != 0)
+    {
+        test->result = HEADLESS_TEST_ERROR;
+        return;
+    }
+
+    headless_audio_hash = HEADLESS_HASH_INIT;
+
+    // The audio isn't generated if its hash isn't needed. The state of the
+    // sound hardware that the ROM can see is the same without it.
+    Headless_SetAudioOutput(&rom, test->check_audio || headless_tests_update);
+
+    u64 start = SDL_GetPerformanceCounter();
+    Headless_RunFrames(&rom, test->frames, 0);
+    u64 end = SDL_GetPerformanceCounter();
+
+    test->seconds = (double)(end - start)
+                    / (double)SDL_GetPerformanceFrequency();
+
+    int width, height;
+    u32 *screen = Headless_GetScreen(&rom, &width, &height);
+
+    Headless_Unload(&rom);
+
+    if (screen == NULL)
+    {
+        test->result = HEADLESS_TEST_ERROR;
+        return;
+    }
+
+    test->screen = Headless_Hash(screen, width * height * sizeof(u32));
+    test->audio = headless_audio_hash;
+
+    free(screen);
+
+    if ((test->check_screen && (test->screen != test->expected_screen))
+        || (test->check_audio && (test->audio != test->expected_audio)))
+    {
+        test->result = HEADLESS_TEST_FAIL;
+    }
+    else
+    {
+        test->result = HEADLESS_TEST_PASS;
+    }
+}
+
+static int Headless_TestThread(void *data)
+{
+    if (headless_tests_pin)
+    {
+        int cpu = (int)(intptr_t)data % SDL_GetCPUCount();
+        if (ThreadPinToCPU(cpu) != 0)
+            fprintf(stderr, "Couldn't pin thread to CPU %d\n", cpu);
+    }
+
+    while (1)
+    {
+        int next = SDL_AtomicAdd(&headless_tests_next, 1);
+        if (next >= headless_tests_count)
+            break;
+
+        Headless_TestRun(&headless_tests[headless_tests_order[next]]);
+    }
+
+    return 0;
+}
+
+static void Headless_TestPrintHash(FILE *f, int check, u64 hash)
+{
+    if (check)
+        fprintf(f, "%016llx", (unsigned long long)hash);
+    else
+        fprintf(f, "-");
+}
+
+// Returns 0 on success
+static int Headless_TestWriteManifest(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Can't open %s\n", path);
+        return 1;
+    }
+
+    fprintf(f, "# rom frames screen audio\n");
+
+    for (int i = 0; i < headless_tests_count; i++)
+    {
+        const _headless_test_t *test = &headless_tests[i];
+
+        fprintf(f, "%s %ld ", test->name, test->frames);
+
+        // Keep the expected values of the ROMs that couldn't be run
+        if (test->result == HEADLESS_TEST_ERROR)
+        {
+            Headless_TestPrintHash(f, test->check_screen,
+                                   test->expected_screen);
+            fprintf(f, " ");
+            Headless_TestPrintHash(f, test->check_audio, test->expected_audio);
+        }
+        else
+        {
+            Headless_TestPrintHash(f, 1, test->screen);
+            fprintf(f, " ");
+            Headless_TestPrintHash(f, 1, test->audio);
+        }
+
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+
+    return 0;
+}
+
+#ifdef ENABLE_THREAD_LOCAL_CORES
+
+typedef struct
+{
+    const _headless_test_t *test;
+    const void *bios;
+    size_t bios_size;
+    u32 flags; // Of Core_RunFrames()
+
+    // One element per console
+    int *ret;
+    u64 *screen;
+    u64 *audio;
+} _headless_pool_job_t;
+
+static void Headless_PoolLoad(u32 index, void *arg)
+{
+    _headless_pool_job_t *job = arg;
+
+    if (headless_tests_pin)
+    {
+        int cpu = index % SDL_GetCPUCount();
+        if (ThreadPinToCPU(cpu) != 0)
+            fprintf(stderr, "Couldn't pin thread to CPU %d\n", cpu);
+    }
+
+    // Same state as Headless_TestRun() before loading the ROM
+    SDL_LockMutex(headless_load_mutex);
+    core_srand(1);
+    GB_RTC_SetFixedTime(HEADLESS_RTC_TIME);
+    GBA_GPIOSetFixedTime(HEADLESS_RTC_TIME);
+    job->ret[index] = Core_LoadFile(job->test->path, job->bios,
+                                    job->bios_size);
+    SDL_UnlockMutex(headless_load_mutex);
+
+    job->audio[index] = HEADLESS_HASH_INIT;
+}
+
+// The samples of the frame that has just been run
+static void Headless_PoolHashAudio(u32 index, void *arg)
+{
+    _headless_pool_job_t *job = arg;
+
+    u32 frames;
+    const s16 *samples = Core_GetAudio(&frames);
+    job->audio[index] = Headless_HashUpdate(job->audio[index], samples,
+                                            frames * 2 * sizeof(s16));
+}
+
+static void Headless_PoolHashScreen(u32 index, void *arg)
+{
+    _headless_pool_job_t *job = arg;
+
+    // The screen is converted like in Headless_TestRun() so that the hashes
+    // match the ones of the manifest.
+    _headless_rom_t rom;
+    rom.type = (Core_GetSystem() == CORE_SYSTEM_GB) ?
+               HEADLESS_ROM_GB : HEADLESS_ROM_GBA;
+
+    int width, height;
+    u32 *screen = Headless_GetScreen(&rom, &width, &height);
+    if (screen == NULL)
+    {
+        job->ret[index] = 1;
+    }
+    else
+    {
+        job->screen[index] = Headless_Hash(screen,
+                                           width * height * sizeof(u32));
+        free(screen);
+    }
+
+    // Don't overwrite the save data of the ROM
+    Core_Unload(0);
+}
+
+static void Headless_PoolUnload(unused__ u32 index, unused__ void *arg)
+{
+    Core_Unload(0);
+}
+
+static void Headless_TestPoolRun(_core_pool_t *pool, u32 consoles,
+                                 _headless_pool_job_t *job,
+                                 _headless_test_t *test)
+{
+    job->test = test;
+    job->flags = (test->check_audio || headless_tests_update) ?
+                 0 : CORE_RUN_NO_AUDIO;
+
+    for (u32 i = 0; i < consoles; i++)
+        job->ret[i] = 1;
+
+    Core_PoolRun(pool, Headless_PoolLoad, job);
+
+    for (u32 i = 0; i < consoles; i++)
+    {
+        if (job->ret[i] != 0)
+        {
+            Core_PoolRun(pool, Headless_PoolUnload, NULL);
+            test->result = HEADLESS_TEST_ERROR;
+            return;
+        }
+    }
+
+    u64 start = SDL_GetPerformanceCounter();
+
+    for (long i = 0; i < test->frames; i++)
+    {
+        Core_PoolRunFrames(pool, NULL, 1, job->flags);
+
+        if ((job->flags & CORE_RUN_NO_AUDIO) == 0)
+            Core_PoolRun(pool, Headless_PoolHashAudio, job);
+    }
+
+    u64 end = SDL_GetPerformanceCounter();
+
+    test->seconds = (double)(end - start)
+                    / (double)SDL_GetPerformanceFrequency();
+
+    Core_PoolRun(pool, Headless_PoolHashScreen, job);
+
+    for (u32 i = 0; i < consoles; i++)
+    {
+        if (job->ret[i] != 0)
+        {
+            test->result = HEADLESS_TEST_ERROR;
+            return;
+        }
+    }
+
+    test->screen = job->screen[0];
+    test->audio = job->audio[0];
+
+    test->mismatch = 0;
+    for (u32 i = 1; i < consoles; i++)
+    {
+        if ((job->screen[i] != test->screen) || (job->audio[i] != test->audio))
+        {
+            test->mismatch = i;
+            break;
+        }
+    }
+
+    if ((test->mismatch != 0)
+        || (test->check_screen && (test->screen != test->expected_screen))
+        || (test->check_audio && (test->audio != test->expected_audio)))
+    {
+        test->result = HEADLESS_TEST_FAIL;
+    }
+    else
+    {
+        test->result = HEADLESS_TEST_PASS;
+    }
+}
+
+// Runs all the ROMs in a pool of consoles, one ROM at a time. Returns 0 on
+// success.
+static int Headless_TestPool(u32 consoles)
+{
+    _headless_pool_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    // The BIOS is shared by all the consoles, it's only read
+    char bios_path[MAX_PATHLEN];
+    void *bios = NULL;
+    unsigned int bios_size = 0;
+    snprintf(bios_path, sizeof(bios_path), "%s" GBA_BIOS_FILENAME,
+             DirGetBiosFolderPath());
+    FileLoad_NoError(bios_path, &bios, &bios_size);
+    job.bios = (bios_size != 0) ? bios : NULL;
+    job.bios_size = bios_size;
+
+    job.ret = calloc(consoles, sizeof(int));
+    job.screen = calloc(consoles, sizeof(u64));
+    job.audio = calloc(consoles, sizeof(u64));
+
+    _core_pool_t *pool = NULL;
+    if ((job.ret != NULL) && (job.screen != NULL) && (job.audio != NULL))
+        pool = Core_PoolCreate(consoles);
+
+    int ret = 0;
+
+    if (pool == NULL)
+    {
+        fprintf(stderr, "Can't create a pool of %u consoles\n",
+                (unsigned int)consoles);
+        ret = 1;
+    }
+    else
+    {
+        for (int i = 0; i < headless_tests_count; i++)
+            Headless_TestPoolRun(pool, consoles, &job, &headless_tests[i]);
+
+        Core_PoolDestroy(pool);
+    }
+
+    free(job.audio);
+    free(job.screen);
+    free(job.ret);
+    free(bios);
+
+    return ret;
+}
+
+#endif // ENABLE_THREAD_LOCAL_CORES
+
+int Headless_Test(int argc, char *argv[])
+{
+    const char *manifest_path = NULL;
+    const char *update_path = NULL;
+    int jobs = 0;
+    int consoles = 0;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc))
+        {
+            jobs = strtol(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "--update") == 0) && (i + 1 < argc))
+        {
+            update_path = argv[++i];
+            headless_tests_update = 1;
+        }
+        else if (strcmp(argv[i], "--pin") == 0)
+        {
+            headless_tests_pin = 1;
+        }
+        else if ((strcmp(argv[i], "--pool") == 0) && (i + 1 < argc))
+        {
+            consoles = strtol(argv[++i], NULL, 0);
+            if (consoles < 2)
+            {
+                Headless_Usage();
+                return 1;
+            }
+        }
+        else if ((argv[i][0] != '-') && (manifest_path == NULL))
+        {
+            manifest_path = argv[i];
+        }
+        else
+        {
+            Headless_Usage();
+            return 1;
+        }
+    }
+
+    if ((manifest_path == NULL) || (jobs < 0))
+    {
+        Headless_Usage();
+        return 1;
+    }
+
+#ifndef ENABLE_THREAD_LOCAL_CORES
+    if (consoles != 0)
+    {
+        fprintf(stderr, "Built without ENABLE_THREAD_LOCAL_CORES, there are "
+                "no core pools.\n");
+        return 1;
+    }
+#endif
+
+    if (Headless_Init() != 0)
+        return 1;
+
+    // The audio is part of the results
+    EmulatorConfig.snd_mute = 0;
+
+    if (Headless_TestLoadManifest(manifest_path) != 0)
+        return 1;
+
+    if (jobs == 0)
+        jobs = SDL_GetCPUCount();
+    if (consoles != 0)
+        jobs = consoles; // One thread per console
+
+#ifndef ENABLE_THREAD_LOCAL_CORES
+    // There is only one copy of the state of each console
+    if (jobs > 1)
+    {
+        fprintf(stderr, "Built without ENABLE_THREAD_LOCAL_CORES, running "
+                "the ROMs one after another.\n");
+    }
+    jobs = 1;
+#endif
+
+    if ((consoles == 0) && (jobs > headless_tests_count))
+        jobs = headless_tests_count;
+
+    headless_tests_order = malloc(headless_tests_count * sizeof(int));
+    headless_load_mutex = SDL_CreateMutex();
+    if ((headless_tests_order == NULL) || (headless_load_mutex == NULL))
+    {
+        fprintf(stderr, "Can't start the tests\n");
+        return 1;
+    }
+
+    for (int i = 0; i < headless_tests_count; i++)
+        headless_tests_order[i] = i;
+    qsort(headless_tests_order, headless_tests_count, sizeof(int),
+          Headless_TestCompareFrames);
+
+    SDL_AtomicSet(&headless_tests_next, 0);
+
+    // The tap is only called from the threads that run the ROMs
+    Resample_SetTap(Headless_AudioTap);
+
+    u64 start = SDL_GetPerformanceCounter();
+
+#ifdef ENABLE_THREAD_LOCAL_CORES
+    if (consoles != 0)
+    {
+        // The core API collects the audio with its own tap
+        if (Headless_TestPool(consoles) != 0)
+            return 1;
+    }
+    else
+#endif
+    {
+        // The current thread is one of the workers
+        SDL_Thread **threads = calloc(jobs, sizeof(SDL_Thread *));
+        for (int i = 1; i < jobs; i++)
+        {
+            threads[i] = SDL_CreateThread(Headless_TestThread, "Test",
+                                          (void *)(intptr_t)i);
+            if (threads[i] == NULL)
+            {
+                fprintf(stderr, "Couldn't create thread: %s\n",
+                        SDL_GetError());
+            }
+        }
+
+        Headless_TestThread((void *)(intptr_t)0);
+
+        for (int i = 1; i < jobs; i++)
+        {
+            if (threads[i] != NULL)
+                SDL_WaitThread(threads[i], NULL);
+        }
+        free(threads);
+    }
+
+    u64 end = SDL_GetPerformanceCounter();
+
+    Resample_SetTap(NULL);
+
+    double seconds = (double)(end - start)
+                     / (double)SDL_GetPerformanceFrequency();
+
+    int passed = 0, failed = 0, errors = 0;
+    double rom_seconds = 0.0;
+
+    for (int i = 0; i < headless_tests_count; i++)
+    {
+        const _headless_test_t *test = &headless_tests[i];
+
+        if (test->result == HEADLESS_TEST_ERROR)
+        {
+            printf("ERROR %s\n", test->name);
+            errors++;
+            continue;
+        }
+
+        double fps = (test->seconds > 0.0) ?
+                     test->frames / test->seconds : 0.0;
+
+        printf("%s  %s (%ld frames, %.3f s, %.1f FPS)\n",
+               (test->result == HEADLESS_TEST_PASS) ? "PASS " : "FAIL ",
+               test->name, test->frames, test->seconds, fps);
+
+        if (test->result == HEADLESS_TEST_FAIL)
+        {
+            if (test->check_screen && (test->screen != test->expected_screen))
+            {
+                printf("      screen %016llx, expected %016llx\n",
+                       (unsigned long long)test->screen,
+                       (unsigned long long)test->expected_screen);
+            }
+            if (test->check_audio && (test->audio != test->expected_audio))
+            {
+                printf("      audio  %016llx, expected %016llx\n",
+                       (unsigned long long)test->audio,
+                       (unsigned long long)test->expected_audio);
+            }
+            if (test->mismatch != 0)
+            {
+                printf("      console %d of the pool disagrees with the "
+                       "first one\n", test->mismatch);
+            }
+            failed++;
+        }
+        else
+        {
+            passed++;
+        }
+
+        rom_seconds += test->seconds;
+    }
+
+    printf("\n%d passed, %d failed, %d errors in %.3f s (%.3f s of emulation "
+           "in %d %s)\n", passed, failed, errors, seconds, rom_seconds,
+           jobs, (consoles != 0) ? "consoles" : "threads");
+
+    int ret = ((failed + errors) == 0) ? 0 : 1;
+
+    if (update_path)
+    {
+        if (Headless_TestWriteManifest(update_path) != 0)
+            ret = 1;
+    }
+
+    SDL_DestroyMutex(headless_load_mutex);
+    free(headless_tests_order);
+    free(headless_tests);
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+
+int Headless_DecodeTrace(int argc, char *argv[])
+{
+    if ((argc < 1) || (argc > 2))
+    {
+        Headless_Usage();
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (argc == 2)
+    {
+        out = fopen(argv[1], "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "Can't open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    int ret = Trace_Decode(argv[0], out);
+
+    if (out != stdout)
+        fclose(out);
+
+    return ret;
+}
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef HEADLESS__
+#define HEADLESS__
+
+// Runs a ROM without creating any window or opening the audio device, as fast
+// as possible, for a number of frames. The arguments are the ones that follow
+// "--headless" in the command line. Returns the exit code of the program.
+int Headless_Run(int argc, char *argv[]);
+
+// Runs each ROM in the arguments that follow "--bench" for a number of frames
+// and prints the speed of the emulation and the time spent in each subsystem
+// as JSON. Returns the exit code of the program.
+int Headless_Bench(int argc, char *argv[]);
+
+// Runs the ROMs of the manifest in the arguments that follow "--test" in
+// parallel and compares the hashes of their screen and audio with the expected
+// ones. With "--pool N" each ROM runs in all the consoles of a core pool
+// instead. Returns the exit code of the program.
+int Headless_Test(int argc, char *argv[]);
+
+// Converts the execution trace in the arguments that follow "--decode-trace" to
+// text. Returns the exit code of the program.
+int Headless_DecodeTrace(int argc, char *argv[]);
+
+#endif // HEADLESS__
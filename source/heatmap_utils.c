@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "heatmap_utils.h"
+
+core_local__ int heatmap_enabled = 0;
+
+core_local__ _heatmap_bucket_t *heatmap_buckets[HEATMAP_MAX_REGIONS];
+core_local__ u32 heatmap_size[HEATMAP_MAX_REGIONS];
+
+static core_local__ _heatmap_region_t heatmap_regions[HEATMAP_MAX_REGIONS];
+static core_local__ int heatmap_region_count = 0;
+
+// All the buckets are allocated in one block
+static core_local__ _heatmap_bucket_t *heatmap_block = NULL;
+static core_local__ u32 heatmap_block_buckets = 0;
+
+static u32 heatmap_region_buckets(const _heatmap_region_t *region)
+{
+    return (region->size + HEATMAP_BUCKET_SIZE - 1) >> HEATMAP_BUCKET_SHIFT;
+}
+
+int Heatmap_Start(const _heatmap_region_t *regions, int count)
+{
+    Heatmap_End();
+
+    if (count > HEATMAP_MAX_REGIONS)
+        count = HEATMAP_MAX_REGIONS;
+
+    u32 total = 0;
+    for (int i = 0; i < count; i++)
+        total += heatmap_region_buckets(&regions[i]);
+
+    heatmap_block = calloc(total > 0 ? total : 1, sizeof(_heatmap_bucket_t));
+    if (heatmap_block == NULL)
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+        return 1;
+    }
+
+    heatmap_block_buckets = total;
+
+    _heatmap_bucket_t *buckets = heatmap_block;
+    for (int i = 0; i < count; i++)
+    {
+        heatmap_regions[i] = regions[i];
+        heatmap_buckets[i] = buckets;
+        heatmap_size[i] = regions[i].size;
+        buckets += heatmap_region_buckets(&regions[i]);
+    }
+
+    heatmap_region_count = count;
+    heatmap_enabled = 1;
+
+    return 0;
+}
+
+void Heatmap_End(void)
+{
+    heatmap_enabled = 0;
+
+    free(heatmap_block);
+    heatmap_block = NULL;
+    heatmap_block_buckets = 0;
+
+    memset(heatmap_buckets, 0, sizeof(heatmap_buckets));
+    memset(heatmap_size, 0, sizeof(heatmap_size));
+    heatmap_region_count = 0;
+}
+
+int Heatmap_GetRegionCount(void)
+{
+    return heatmap_region_count;
+}
+
+const _heatmap_region_t *Heatmap_GetRegion(int region)
+{
+    if ((region < 0) || (region >= heatmap_region_count))
+        return NULL;
+    return &heatmap_regions[region];
+}
+
+const _heatmap_bucket_t *Heatmap_GetBuckets(int region)
+{
+    if ((region < 0) || (region >= heatmap_region_count))
+        return NULL;
+    return heatmap_buckets[region];
+}
+
+u32 Heatmap_GetAddress(int region, u32 offset, u32 *bank)
+{
+    const _heatmap_region_t *r = &heatmap_regions[region];
+
+    if (r->bank_size == 0)
+    {
+        *bank = 0;
+        return r->address + offset;
+    }
+
+    *bank = offset / r->bank_size;
+    u32 base = (*bank == 0) ? r->address : r->bank_address;
+    return base + (offset % r->bank_size);
+}
+
+//------------------------------------------------------------------------------
+
+static u32 heatmap_region_line_buckets(const _heatmap_region_t *region,
+                                       int buckets)
+{
+    if (region->bank_size == 0)
+        return buckets;
+
+    u32 bank_buckets = region->bank_size >> HEATMAP_BUCKET_SHIFT;
+    if (bank_buckets == 0)
+        bank_buckets = 1;
+
+    return (bank_buckets < (u32)buckets) ? bank_buckets : (u32)buckets;
+}
+
+static u32 heatmap_region_lines(const _heatmap_region_t *region, int buckets)
+{
+    u32 line_buckets = heatmap_region_line_buckets(region, buckets);
+    u32 total = heatmap_region_buckets(region);
+    return (total + line_buckets - 1) / line_buckets;
+}
+
+int Heatmap_GetLineCount(int buckets)
+{
+    int lines = 0;
+    for (int i = 0; i < heatmap_region_count; i++)
+        lines += heatmap_region_lines(&heatmap_regions[i], buckets);
+    return lines;
+}
+
+int Heatmap_GetLine(int line, int buckets, int *region, u32 *offset,
+                    int *count)
+{
+    if (line < 0)
+        return 1;
+
+    for (int i = 0; i < heatmap_region_count; i++)
+    {
+        const _heatmap_region_t *r = &heatmap_regions[i];
+        u32 lines = heatmap_region_lines(r, buckets);
+
+        if ((u32)line >= lines)
+        {
+            line -= lines;
+            continue;
+        }
+
+        u32 line_buckets = heatmap_region_line_buckets(r, buckets);
+        u32 first = line * line_buckets;
+        u32 left = heatmap_region_buckets(r) - first;
+
+        *region = i;
+        *offset = first << HEATMAP_BUCKET_SHIFT;
+        *count = (left < line_buckets) ? left : line_buckets;
+        return 0;
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+
+u64 Heatmap_GetMax(void)
+{
+    u64 max = 0;
+
+    for (u32 i = 0; i < heatmap_block_buckets; i++)
+    {
+        u64 total = heatmap_block[i].reads + heatmap_block[i].writes;
+        if (total > max)
+            max = total;
+    }
+
+    return max;
+}
+
+static int heatmap_bits(u64 value)
+{
+    int bits = 0;
+    while (value)
+    {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+int Heatmap_GetLevel(const _heatmap_bucket_t *bucket, u64 max)
+{
+    u64 total = bucket->reads + bucket->writes;
+    if ((total == 0) || (max == 0))
+        return 0;
+
+    // 1 for a single access, HEATMAP_LEVELS - 1 for the maximum
+    int bits = heatmap_bits(total);
+    int max_bits = heatmap_bits(max);
+    if (max_bits == 1)
+        return HEATMAP_LEVELS - 1;
+    return 1 + ((HEATMAP_LEVELS - 2) * (bits - 1)) / (max_bits - 1);
+}
+
+char Heatmap_GetCharacter(int level)
+{
+    static const char characters[HEATMAP_LEVELS] = {
+        '.', ':', '-', '=', '+', '*', '%', '#', '@'
+    };
+
+    return characters[level];
+}
+
+u32 Heatmap_GetColor(const _heatmap_bucket_t *bucket, int level)
+{
+    if (level == 0)
+        return 0xFF808080;
+
+    u64 total = bucket->reads + bucket->writes;
+
+    // Both components are at full brightness when there are as many reads as
+    // writes, so that it goes from green to yellow to red.
+    u32 writes = (u32)((bucket->writes * 512) / total);
+    u32 reads = 512 - writes;
+    if (writes > 256)
+        writes = 256;
+    if (reads > 256)
+        reads = 256;
+
+    u32 brightness = 0x60 + (0x9F * level) / (HEATMAP_LEVELS - 1);
+    u32 r = (brightness * writes) >> 8;
+    u32 g = (brightness * reads) >> 8;
+
+    return 0xFF000000 | (r << 16) | (g << 8);
+}
+
+void Heatmap_FormatCount(char *buffer, size_t size, u64 count)
+{
+    static const char units[] = "KMGTPE";
+
+    if (count < 1000)
+    {
+        snprintf(buffer, size, "%u", (unsigned int)count);
+        return;
+    }
+
+    int unit = 0;
+    while (count >= 1000000)
+    {
+        count /= 1000;
+        unit++;
+    }
+
+    if (count < 10000)
+    {
+        snprintf(buffer, size, "%u.%u%c", (unsigned int)(count / 1000),
+                 (unsigned int)((count / 100) % 10), units[unit]);
+    }
+    else
+    {
+        snprintf(buffer, size, "%u%c", (unsigned int)(count / 1000),
+                 units[unit]);
+    }
+}
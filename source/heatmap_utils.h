@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef HEATMAP_UTILS__
+#define HEATMAP_UTILS__
+
+// Counts the reads and writes done by the emulated CPU and DMA to each block of
+// 256 bytes of memory, to know which regions are accessed the most.
+//
+// The core that is running defines its regions when it starts the heatmap, and
+// counts the accesses from the slow path of its memory handlers. While it is
+// running, the core leaves all the pages of its page tables empty so that every
+// access goes through the slow path. When it isn't running, the only cost is
+// checking heatmap_enabled in the slow path.
+
+#include <stddef.h>
+
+#include "general_utils.h"
+
+#define HEATMAP_BUCKET_SHIFT    (8)
+#define HEATMAP_BUCKET_SIZE     (1 << HEATMAP_BUCKET_SHIFT)
+
+#define HEATMAP_MAX_REGIONS     (16)
+
+typedef struct
+{
+    u64 reads;
+    u64 writes;
+} _heatmap_bucket_t;
+
+typedef struct
+{
+    const char *name;
+    u32 size;           // Size of all the banks together
+    u32 address;        // Address of the first bank in the memory map
+    u32 bank_size;      // 0 if the region isn't banked
+    u32 bank_address;   // Address of the rest of banks
+} _heatmap_region_t;
+
+extern core_local__ int heatmap_enabled;
+
+extern core_local__ _heatmap_bucket_t *heatmap_buckets[HEATMAP_MAX_REGIONS];
+extern core_local__ u32 heatmap_size[HEATMAP_MAX_REGIONS];
+
+// The cores only call them while heatmap_enabled is set. The offset is relative
+// to the start of the first bank of the region. Offsets outside of the region
+// are ignored.
+static inline void Heatmap_Read(int region, u32 offset)
+{
+    if (offset < heatmap_size[region])
+        heatmap_buckets[region][offset >> HEATMAP_BUCKET_SHIFT].reads++;
+}
+
+static inline void Heatmap_Write(int region, u32 offset)
+{
+    if (offset < heatmap_size[region])
+        heatmap_buckets[region][offset >> HEATMAP_BUCKET_SHIFT].writes++;
+}
+
+// Clears the counters. Returns 0 on success, 1 on error.
+int Heatmap_Start(const _heatmap_region_t *regions, int count);
+// Frees the counters
+void Heatmap_End(void);
+
+int Heatmap_GetRegionCount(void);
+const _heatmap_region_t *Heatmap_GetRegion(int region);
+const _heatmap_bucket_t *Heatmap_GetBuckets(int region);
+
+// Returns the address of an offset of a region in the memory map, and the bank
+// it belongs to.
+u32 Heatmap_GetAddress(int region, u32 offset, u32 *bank);
+
+// The regions are split in lines of up to "buckets" buckets to be displayed.
+// Lines never cross the end of a bank.
+int Heatmap_GetLineCount(int buckets);
+// Returns 0 on success, 1 if the line doesn't exist. "count" is the number of
+// buckets of the line.
+int Heatmap_GetLine(int line, int buckets, int *region, u32 *offset,
+                    int *count);
+
+// Highest number of accesses to a single bucket
+u64 Heatmap_GetMax(void);
+
+// Intensity of the accesses to a bucket relative to "max", in a logarithmic
+// scale from 0 (no accesses) to HEATMAP_LEVELS - 1.
+#define HEATMAP_LEVELS          (9)
+int Heatmap_GetLevel(const _heatmap_bucket_t *bucket, u64 max);
+
+// Character and color (0xAARRGGBB) to display a bucket. The color goes from
+// green for reads to red for writes.
+char Heatmap_GetCharacter(int level);
+u32 Heatmap_GetColor(const _heatmap_bucket_t *bucket, int level);
+
+// Prints a count using at most 4 characters ("999", "12K", "1.2M"...)
+void Heatmap_FormatCount(char *buffer, size_t size, u64 count);
+
+#endif // HEATMAP_UTILS__
@@ -11,6 +11,7 @@
 
 #include "debug_utils.h"
 #include "input_utils.h"
+#include "stream_utils.h"
 
 #include "gb_core/gb_main.h"
 #include "gb_core/sgb.h"
@@ -258,7 +259,28 @@ void Input_GetJoystickElementName(char *name, int namelen, int btncode)
 
 //------------------------------------------------------------------------------
 
-void Input_Update_GB(void)
+void Input_GetState(_input_state_t *state)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        for (int k = 0; k < P_NUM_KEYS; k++)
+            state->keys[i][k] = Input_IsGameBoyKeyPressed(i, k);
+    }
+
+    const Uint8 *keys = SDL_GetKeyboardState(NULL);
+
+    state->mbc7_right = keys[SDL_SCANCODE_KP_6];
+    state->mbc7_left = keys[SDL_SCANCODE_KP_4];
+    state->mbc7_up = keys[SDL_SCANCODE_KP_8];
+    state->mbc7_down = keys[SDL_SCANCODE_KP_2];
+
+    state->speedup = Input_Speedup_Enabled();
+    state->rewind = Input_Rewind_Enabled();
+
+    Stream_InputMerge(state);
+}
+
+void Input_SetState_GB(const _input_state_t *state)
 {
     int players = 1;
 
@@ -267,44 +289,40 @@ void Input_Update_GB(void)
 
     for (int i = 0; i < players; i++)
     {
-        int a = Input_IsGameBoyKeyPressed(i, P_KEY_A);
-        int b = Input_IsGameBoyKeyPressed(i, P_KEY_B);
-        int st = Input_IsGameBoyKeyPressed(i, P_KEY_START);
-        int se = Input_IsGameBoyKeyPressed(i, P_KEY_SELECT);
-        int dr = Input_IsGameBoyKeyPressed(i, P_KEY_RIGHT);
-        int dl = Input_IsGameBoyKeyPressed(i, P_KEY_LEFT);
-        int du = Input_IsGameBoyKeyPressed(i, P_KEY_UP);
-        int dd = Input_IsGameBoyKeyPressed(i, P_KEY_DOWN);
-
-        GB_InputSet(i, a, b, st, se, dr, dl, du, dd);
-    }
-
-    const Uint8 *state = SDL_GetKeyboardState(NULL);
+        const u8 *k = state->keys[i];
 
-    int accr = state[SDL_SCANCODE_KP_6];
-    int accl = state[SDL_SCANCODE_KP_4];
-    int accu = state[SDL_SCANCODE_KP_8];
-    int accd = state[SDL_SCANCODE_KP_2];
+        GB_InputSet(i, k[P_KEY_A], k[P_KEY_B], k[P_KEY_START],
+                    k[P_KEY_SELECT], k[P_KEY_RIGHT], k[P_KEY_LEFT],
+                    k[P_KEY_UP], k[P_KEY_DOWN]);
+    }
 
-    GB_InputSetMBC7Buttons(accu, accd, accr, accl);
+    GB_InputSetMBC7Buttons(state->mbc7_up, state->mbc7_down,
+                           state->mbc7_right, state->mbc7_left);
     //void GB_InputSetMBC7Joystick(int x, int y); // -200 to 200
     //void GB_InputSetMBC7Buttons(int up, int down, int right, int left);
 }
 
+void Input_SetState_GBA(const _input_state_t *state)
+{
+    const u8 *k = state->keys[0];
+
+    GBA_HandleInput(k[P_KEY_A], k[P_KEY_B], k[P_KEY_L], k[P_KEY_R],
+                    k[P_KEY_START], k[P_KEY_SELECT], k[P_KEY_RIGHT],
+                    k[P_KEY_LEFT], k[P_KEY_UP], k[P_KEY_DOWN]);
+}
+
+void Input_Update_GB(void)
+{
+    _input_state_t state;
+    Input_GetState(&state);
+    Input_SetState_GB(&state);
+}
+
 void Input_Update_GBA(void)
 {
-    int a = Input_IsGameBoyKeyPressed(0, P_KEY_A);
-    int b = Input_IsGameBoyKeyPressed(0, P_KEY_B);
-    int l = Input_IsGameBoyKeyPressed(0, P_KEY_L);
-    int r = Input_IsGameBoyKeyPressed(0, P_KEY_R);
-    int st = Input_IsGameBoyKeyPressed(0, P_KEY_START);
-    int se = Input_IsGameBoyKeyPressed(0, P_KEY_SELECT);
-    int dr = Input_IsGameBoyKeyPressed(0, P_KEY_RIGHT);
-    int dl = Input_IsGameBoyKeyPressed(0, P_KEY_LEFT);
-    int du = Input_IsGameBoyKeyPressed(0, P_KEY_UP);
-    int dd = Input_IsGameBoyKeyPressed(0, P_KEY_DOWN);
-
-    GBA_HandleInput(a, b, l, r, st, se, dr, dl, du, dd);
+    _input_state_t state;
+    Input_GetState(&state);
+    Input_SetState_GBA(&state);
 }
 
 int Input_Speedup_Enabled(void)
@@ -314,6 +332,13 @@ int Input_Speedup_Enabled(void)
     return state[SDL_SCANCODE_SPACE];
 }
 
+int Input_Rewind_Enabled(void)
+{
+    const Uint8 *state = SDL_GetKeyboardState(NULL);
+
+    return state[SDL_SCANCODE_BACKSPACE];
+}
+
 //------------------------------------------------------------------------------
 
 SDL_Joystick *Input_GetJoystick(int index)
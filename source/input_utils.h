@@ -9,6 +9,8 @@
 
 #include <SDL.h>
 
+#include "general_utils.h"
+
 typedef enum
 {
     P_KEY_A,
@@ -48,10 +50,26 @@ int Input_PlayerGetEnabled(int player);
 
 //------------------------------------------------------------------------------
 
+// State of the keys of all players and of the emulator. It's read from the
+// devices by Input_GetState(), and it's applied to the emulated console when
+// it's passed to Input_SetState_GB() or Input_SetState_GBA().
+typedef struct
+{
+    u8 keys[4][P_NUM_KEYS];
+    u8 mbc7_up, mbc7_down, mbc7_right, mbc7_left;
+    u8 speedup;
+    u8 rewind;
+} _input_state_t;
+
+void Input_GetState(_input_state_t *state);
+void Input_SetState_GB(const _input_state_t *state);
+void Input_SetState_GBA(const _input_state_t *state);
+
 void Input_Update_GB(void);
 void Input_Update_GBA(void);
 
 int Input_Speedup_Enabled(void);
+int Input_Rewind_Enabled(void);
 
 //-----------------------------------------------------------------------------
 
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <string.h>
+
+#include <SDL.h>
+
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "input_utils.h"
+#include "latency_utils.h"
+
+// Number of presses that are averaged in each report
+#define LATENCY_REPORT_SAMPLES  (10)
+
+// Events older than this are ignored, the press wasn't a key of the game
+#define LATENCY_MAX_SECONDS     (1)
+
+// Each state is left by the thread that handles it. The times that are set
+// before changing the state are only read after seeing the new state.
+typedef enum
+{
+    LATENCY_DISABLED,
+    LATENCY_WAIT_EVENT,   // Main thread: Waiting for a press
+    LATENCY_WAIT_INPUT,   // Emulation thread: Waiting for the console to see it
+    LATENCY_WAIT_FRAME,   // Emulation thread: Waiting for the end of the frame
+    LATENCY_WAIT_PRESENT, // Main thread: Waiting for the frame to be presented
+} _latency_state_e;
+
+static int latency_state = LATENCY_DISABLED;
+
+static u64 latency_event_time;
+static u64 latency_input_time;
+
+// Only used by the emulation thread
+static u8 latency_keys[4][P_NUM_KEYS];
+
+// Only used by the main thread
+static u32 latency_samples;
+static double latency_input_ms;
+static double latency_present_ms;
+static double latency_present_min_ms;
+static double latency_present_max_ms;
+
+static int latency_state_get(void)
+{
+    return __atomic_load_n(&latency_state, __ATOMIC_ACQUIRE);
+}
+
+static void latency_state_set(int state)
+{
+    __atomic_store_n(&latency_state, state, __ATOMIC_RELEASE);
+}
+
+static double latency_ms(u64 start, u64 end)
+{
+    return ((double)(end - start) * 1000.0)
+           / (double)SDL_GetPerformanceFrequency();
+}
+
+void Latency_SetEnabled(int enabled)
+{
+    latency_samples = 0;
+    latency_input_ms = 0.0;
+    latency_present_ms = 0.0;
+
+    latency_state_set(enabled ? LATENCY_WAIT_EVENT : LATENCY_DISABLED);
+}
+
+void Latency_InputEvent(const SDL_Event *e)
+{
+    int state = latency_state_get();
+    if ((state != LATENCY_WAIT_EVENT) && (state != LATENCY_WAIT_INPUT))
+        return;
+
+    switch (e->type)
+    {
+        case SDL_KEYDOWN:
+            if (e->key.repeat)
+                return;
+            break;
+        case SDL_JOYBUTTONDOWN:
+            break;
+        case SDL_JOYHATMOTION:
+            if (e->jhat.value == SDL_HAT_CENTERED)
+                return;
+            break;
+        case SDL_JOYAXISMOTION:
+            if ((e->jaxis.value > (-16 * 1024))
+                && (e->jaxis.value < (16 * 1024)))
+            {
+                return;
+            }
+            break;
+        default:
+            return;
+    }
+
+    // The events are stamped by SDL in milliseconds when they are received,
+    // which may be a bit earlier than now.
+    u64 now = SDL_GetPerformanceCounter();
+    u64 age = (u64)(SDL_GetTicks() - e->common.timestamp)
+              * SDL_GetPerformanceFrequency() / 1000;
+    if (age > now)
+        age = 0;
+
+    // The newest press is the one that is measured. The emulation thread is
+    // paused while the events are handled, so it can't be using the time.
+    latency_event_time = now - age;
+    latency_state_set(LATENCY_WAIT_INPUT);
+}
+
+void Latency_InputApplied(const _input_state_t *state)
+{
+    int pressed = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int k = 0; k < P_NUM_KEYS; k++)
+        {
+            if (state->keys[i][k] && (latency_keys[i][k] == 0))
+                pressed = 1;
+        }
+    }
+
+    memcpy(latency_keys, state->keys, sizeof(latency_keys));
+
+    if ((pressed == 0) || (latency_state_get() != LATENCY_WAIT_INPUT))
+        return;
+
+    u64 now = SDL_GetPerformanceCounter();
+
+    if ((now - latency_event_time)
+        > (LATENCY_MAX_SECONDS * SDL_GetPerformanceFrequency()))
+    {
+        latency_state_set(LATENCY_WAIT_EVENT);
+        return;
+    }
+
+    latency_input_time = now;
+    latency_state_set(LATENCY_WAIT_FRAME);
+}
+
+void Latency_FrameEmulated(void)
+{
+    if (latency_state_get() == LATENCY_WAIT_FRAME)
+        latency_state_set(LATENCY_WAIT_PRESENT);
+}
+
+void Latency_FramePresented(void)
+{
+    if (latency_state_get() != LATENCY_WAIT_PRESENT)
+        return;
+
+    u64 now = SDL_GetPerformanceCounter();
+
+    double input_ms = latency_ms(latency_event_time, latency_input_time);
+    double present_ms = latency_ms(latency_event_time, now);
+
+    latency_state_set(LATENCY_WAIT_EVENT);
+
+    if ((latency_samples == 0) || (present_ms < latency_present_min_ms))
+        latency_present_min_ms = present_ms;
+    if ((latency_samples == 0) || (present_ms > latency_present_max_ms))
+        latency_present_max_ms = present_ms;
+
+    latency_input_ms += input_ms;
+    latency_present_ms += present_ms;
+    latency_samples++;
+
+    if (latency_samples < LATENCY_REPORT_SAMPLES)
+        return;
+
+    Debug_LogMsgArg("Input latency (%u presses): To the console %.2f ms, "
+                    "to the screen %.2f ms (min %.2f ms, max %.2f ms)",
+                    latency_samples, latency_input_ms / latency_samples,
+                    latency_present_ms / latency_samples,
+                    latency_present_min_ms, latency_present_max_ms);
+
+    latency_samples = 0;
+    latency_input_ms = 0.0;
+    latency_present_ms = 0.0;
+}
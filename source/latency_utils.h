@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef LATENCY_UTILS__
+#define LATENCY_UTILS__
+
+#include <SDL.h>
+
+#include "input_utils.h"
+
+// Measurement of the input latency of the frontend. When a key of the game is
+// pressed, the time at which SDL received the event is compared with the time
+// at which the emulated console sees the key and with the time at which the
+// first frame emulated with it is presented. The latency of the display and
+// the time the game takes to react to the key aren't included. The averages
+// are written to the log every few presses.
+//
+// Only one press is measured at a time. The functions can be called from the
+// thread that is mentioned in each one of them, it doesn't need to be the same.
+
+void Latency_SetEnabled(int enabled);
+
+// Main thread: Called for every event received from SDL
+void Latency_InputEvent(const SDL_Event *e);
+// Emulation thread: Called when a state of the input reaches the console
+void Latency_InputApplied(const _input_state_t *state);
+// Emulation thread: Called at the end of each frame
+void Latency_FrameEmulated(void);
+// Main thread: Called after presenting a new frame of the game
+void Latency_FramePresented(void);
+
+#endif // LATENCY_UTILS__
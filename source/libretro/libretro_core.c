@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+// libretro frontend of the core library. It only uses the interface in
+// core_api.h. The battery saves are written next to the ROM by the cores, like
+// in the standalone emulator, so the ROM has to be loaded from a path to have
+// them. The GBA BIOS is loaded from the system directory of the frontend, the
+// core uses its own implementation of the BIOS if it isn't there.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libretro.h>
+
+#include "../build_options.h"
+#include "../core_api.h"
+#include "../file_utils.h"
+#include "../general_utils.h"
+
+// Both systems run at the same refresh rate (clocks per second / per frame)
+#define LIBRETRO_FPS    (16777216.0 / 280896.0)
+
+static retro_environment_t environ_cb;
+static retro_video_refresh_t video_cb;
+static retro_audio_sample_batch_t audio_batch_cb;
+static retro_input_poll_t input_poll_cb;
+static retro_input_state_t input_state_cb;
+
+static u32 libretro_screen[CORE_SCREEN_MAX_WIDTH * CORE_SCREEN_MAX_HEIGHT];
+
+unsigned retro_api_version(void)
+{
+    return RETRO_API_VERSION;
+}
+
+void retro_set_environment(retro_environment_t cb)
+{
+    environ_cb = cb;
+}
+
+void retro_set_video_refresh(retro_video_refresh_t cb)
+{
+    video_cb = cb;
+}
+
+void retro_set_audio_sample(unused__ retro_audio_sample_t cb)
+{
+}
+
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb)
+{
+    audio_batch_cb = cb;
+}
+
+void retro_set_input_poll(retro_input_poll_t cb)
+{
+    input_poll_cb = cb;
+}
+
+void retro_set_input_state(retro_input_state_t cb)
+{
+    input_state_cb = cb;
+}
+
+void retro_init(void)
+{
+}
+
+void retro_deinit(void)
+{
+    Core_Unload(1);
+}
+
+void retro_get_system_info(struct retro_system_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->library_name = "GiiBiiAdvance";
+    info->library_version = GIIBIIADVANCE_VERSION_STRING;
+    info->valid_extensions = "gba|agb|bin|gb|gbc|cgb|sgb";
+    info->need_fullpath = false;
+    info->block_extract = false;
+}
+
+void retro_get_system_av_info(struct retro_system_av_info *info)
+{
+    int width, height;
+    Core_GetScreenSize(&width, &height);
+
+    memset(info, 0, sizeof(*info));
+    info->geometry.base_width = width;
+    info->geometry.base_height = height;
+    info->geometry.max_width = CORE_SCREEN_MAX_WIDTH;
+    info->geometry.max_height = CORE_SCREEN_MAX_HEIGHT;
+    info->geometry.aspect_ratio = (float)width / (float)height;
+    info->timing.fps = LIBRETRO_FPS;
+    info->timing.sample_rate = Core_GetAudioRate();
+}
+
+void retro_set_controller_port_device(unused__ unsigned port,
+                                      unused__ unsigned device)
+{
+}
+
+void retro_reset(void)
+{
+    Core_Reset();
+}
+
+static const struct {
+    unsigned id;
+    u32 key;
+} libretro_keys[] = {
+    { RETRO_DEVICE_ID_JOYPAD_A, CORE_KEY_A },
+    { RETRO_DEVICE_ID_JOYPAD_B, CORE_KEY_B },
+    { RETRO_DEVICE_ID_JOYPAD_SELECT, CORE_KEY_SELECT },
+    { RETRO_DEVICE_ID_JOYPAD_START, CORE_KEY_START },
+    { RETRO_DEVICE_ID_JOYPAD_RIGHT, CORE_KEY_RIGHT },
+    { RETRO_DEVICE_ID_JOYPAD_LEFT, CORE_KEY_LEFT },
+    { RETRO_DEVICE_ID_JOYPAD_UP, CORE_KEY_UP },
+    { RETRO_DEVICE_ID_JOYPAD_DOWN, CORE_KEY_DOWN },
+    { RETRO_DEVICE_ID_JOYPAD_R, CORE_KEY_R },
+    { RETRO_DEVICE_ID_JOYPAD_L, CORE_KEY_L },
+};
+
+void retro_run(void)
+{
+    input_poll_cb();
+
+    u32 keys = 0;
+    for (size_t i = 0; i < ARRAY_NUM_ELEMENTS(libretro_keys); i++)
+    {
+        if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, libretro_keys[i].id))
+            keys |= libretro_keys[i].key;
+    }
+    Core_SetInput(keys);
+
+    Core_RunFrame();
+
+    int width, height;
+    Core_GetScreenSize(&width, &height);
+    Core_GetScreen(libretro_screen);
+    video_cb(libretro_screen, width, height, width * sizeof(u32));
+
+    u32 frames;
+    const s16 *samples = Core_GetAudio(&frames);
+    if (frames > 0)
+        audio_batch_cb(samples, frames);
+}
+
+size_t retro_serialize_size(void)
+{
+    return Core_StateSize();
+}
+
+bool retro_serialize(void *data, size_t size)
+{
+    return Core_StateSave(data, size) == 0;
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+    return Core_StateLoad(data, size) == 0;
+}
+
+void retro_cheat_reset(void)
+{
+    Core_CheatsReset();
+}
+
+void retro_cheat_set(unused__ unsigned index, bool enabled, const char *code)
+{
+    if ((enabled == false) || (code == NULL))
+        return;
+
+    // Codes that need more than one line are joined with '+'
+    while (*code != '\0')
+    {
+        const char *end = strchr(code, '+');
+        size_t len = (end != NULL) ? (size_t)(end - code) : strlen(code);
+
+        char line[64];
+        if (len < sizeof(line))
+        {
+            memcpy(line, code, len);
+            line[len] = '\0';
+            Core_CheatAdd(line);
+        }
+
+        code += len;
+        if (*code == '+')
+            code++;
+    }
+}
+
+bool retro_load_game(const struct retro_game_info *game)
+{
+    if ((game == NULL) || (game->data == NULL))
+        return false;
+
+    enum retro_pixel_format format = RETRO_PIXEL_FORMAT_XRGB8888;
+    if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format))
+        return false;
+
+    // Without a path the save files are created in the working directory
+    const char *path = game->path ? game->path : "game";
+
+    _core_system_e system = Core_SystemFromPath(path);
+    if (system == CORE_SYSTEM_NONE)
+        return false;
+
+    void *bios = NULL;
+    unsigned int bios_size = 0;
+
+    const char *dir = NULL;
+    if ((system == CORE_SYSTEM_GBA)
+        && environ_cb(RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY, &dir) && dir)
+    {
+        char bios_path[MAX_PATHLEN];
+        snprintf(bios_path, sizeof(bios_path), "%s/" GBA_BIOS_FILENAME, dir);
+        FileLoad_NoError(bios_path, &bios, &bios_size);
+    }
+
+    int ret = Core_Load(system, path, game->data, game->size,
+                        bios, bios_size);
+
+    free(bios);
+
+    return ret == 0;
+}
+
+bool retro_load_game_special(unused__ unsigned type,
+                             unused__ const struct retro_game_info *info,
+                             unused__ size_t num)
+{
+    return false;
+}
+
+void retro_unload_game(void)
+{
+    Core_Unload(1);
+}
+
+unsigned retro_get_region(void)
+{
+    return RETRO_REGION_NTSC;
+}
+
+void *retro_get_memory_data(unused__ unsigned id)
+{
+    return NULL;
+}
+
+size_t retro_get_memory_size(unused__ unsigned id)
+{
+    return 0;
+}
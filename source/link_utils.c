@@ -0,0 +1,465 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+# include <winsock2.h>
+# include <ws2tcpip.h>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/select.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#include <SDL.h>
+
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "link_utils.h"
+
+#ifdef _WIN32
+typedef SOCKET link_socket_t;
+# define LINK_INVALID_SOCKET    INVALID_SOCKET
+# define link_close             closesocket
+#else
+typedef int link_socket_t;
+# define LINK_INVALID_SOCKET    (-1)
+# define link_close             close
+#endif
+
+#ifdef MSG_NOSIGNAL
+# define LINK_SEND_FLAGS        MSG_NOSIGNAL
+#else
+# define LINK_SEND_FLAGS        0
+#endif
+
+// Time between attempts to connect to the other emulator (in ms)
+#define LINK_RETRY_PERIOD       (1000)
+
+#define LINK_BUFFER_SIZE        (256)
+
+typedef enum
+{
+    LINK_STATE_STOPPED,
+    LINK_STATE_LISTENING,   // Waiting for the other emulator to connect
+    LINK_STATE_CONNECTING,  // Connecting to the other emulator
+    LINK_STATE_WAITING,     // Waiting to try to connect again
+    LINK_STATE_CONNECTED,
+} _link_state_e;
+
+static _link_state_e link_state = LINK_STATE_STOPPED;
+
+static char link_address[256];
+static int link_port;
+
+static link_socket_t link_listen_socket = LINK_INVALID_SOCKET;
+static link_socket_t link_socket = LINK_INVALID_SOCKET;
+static Uint32 link_retry_time;
+
+// Bytes received that don't form a whole message yet are kept here
+static u8 link_buffer[LINK_BUFFER_SIZE];
+static int link_buffer_start;
+static int link_buffer_end;
+
+//------------------------------------------------------------------------------
+
+static int link_set_nonblocking(link_socket_t s)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) != 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    if (flags == -1)
+        return 1;
+    return fcntl(s, F_SETFL, flags | O_NONBLOCK) != 0;
+#endif
+}
+
+static int link_error_is_would_block(void)
+{
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return (error == WSAEWOULDBLOCK) || (error == WSAEINPROGRESS);
+#else
+    return (errno == EAGAIN) || (errno == EWOULDBLOCK)
+           || (errno == EINPROGRESS) || (errno == EINTR);
+#endif
+}
+
+// Returns 1 if the socket can be written (if write is 1) or read (if not)
+// before the timeout ends.
+static int link_wait(link_socket_t s, int write, int timeout_ms)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(s, &set);
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int ret;
+    if (write)
+        ret = select((int)s + 1, NULL, &set, NULL, &tv);
+    else
+        ret = select((int)s + 1, &set, NULL, NULL, &tv);
+
+    return ret > 0;
+}
+
+static void link_connected(link_socket_t s)
+{
+    // The messages are tiny and are sent one by one, don't delay them
+    int nodelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&nodelay,
+               sizeof(nodelay));
+
+    link_socket = s;
+    link_state = LINK_STATE_CONNECTED;
+    link_buffer_start = 0;
+    link_buffer_end = 0;
+
+    Debug_LogMsgArg("Link cable: Connected.");
+}
+
+static int link_listen(void)
+{
+    char port[16];
+    snprintf(port, sizeof(port), "%d", link_port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo *info;
+    if (getaddrinfo(NULL, port, &hints, &info) != 0)
+        return 1;
+
+    link_socket_t s = socket(info->ai_family, info->ai_socktype,
+                             info->ai_protocol);
+    if (s == LINK_INVALID_SOCKET)
+    {
+        freeaddrinfo(info);
+        return 1;
+    }
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse,
+               sizeof(reuse));
+
+    if ((bind(s, info->ai_addr, info->ai_addrlen) != 0)
+        || (listen(s, 1) != 0) || link_set_nonblocking(s))
+    {
+        freeaddrinfo(info);
+        link_close(s);
+        return 1;
+    }
+
+    freeaddrinfo(info);
+
+    link_listen_socket = s;
+    link_state = LINK_STATE_LISTENING;
+
+    Debug_LogMsgArg("Link cable: Waiting for connection in port %d.",
+                    link_port);
+
+    return 0;
+}
+
+static void link_connect(void)
+{
+    char port[16];
+    snprintf(port, sizeof(port), "%d", link_port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    // Try again later if anything fails
+    link_state = LINK_STATE_WAITING;
+    link_retry_time = SDL_GetTicks() + LINK_RETRY_PERIOD;
+
+    struct addrinfo *info;
+    if (getaddrinfo(link_address, port, &hints, &info) != 0)
+        return;
+
+    link_socket_t s = socket(info->ai_family, info->ai_socktype,
+                             info->ai_protocol);
+    if (s == LINK_INVALID_SOCKET)
+    {
+        freeaddrinfo(info);
+        return;
+    }
+
+    if (link_set_nonblocking(s))
+    {
+        freeaddrinfo(info);
+        link_close(s);
+        return;
+    }
+
+    int ret = connect(s, info->ai_addr, info->ai_addrlen);
+
+    freeaddrinfo(info);
+
+    if (ret == 0)
+    {
+        link_connected(s);
+    }
+    else if (link_error_is_would_block())
+    {
+        link_socket = s;
+        link_state = LINK_STATE_CONNECTING;
+    }
+    else
+    {
+        link_close(s);
+    }
+}
+
+static void link_disconnected(void)
+{
+    link_close(link_socket);
+    link_socket = LINK_INVALID_SOCKET;
+
+    Debug_LogMsgArg("Link cable: Disconnected.");
+
+    if (link_listen_socket != LINK_INVALID_SOCKET)
+        link_state = LINK_STATE_LISTENING;
+    else
+        link_connect();
+}
+
+// Advances the connection if it isn't established yet
+static void link_update(void)
+{
+    switch (link_state)
+    {
+        case LINK_STATE_LISTENING:
+        {
+            link_socket_t s = accept(link_listen_socket, NULL, NULL);
+            if (s == LINK_INVALID_SOCKET)
+                break;
+
+            // Only one emulator can be connected. The accepted socket doesn't
+            // always inherit the mode of the listening one.
+            if (link_set_nonblocking(s))
+            {
+                link_close(s);
+                break;
+            }
+
+            link_connected(s);
+            break;
+        }
+        case LINK_STATE_CONNECTING:
+        {
+            if (link_wait(link_socket, 1, 0) == 0)
+                break;
+
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(link_socket, SOL_SOCKET, SO_ERROR, (char *)&error,
+                       &len);
+
+            if (error == 0)
+            {
+                link_connected(link_socket);
+                break;
+            }
+
+            link_close(link_socket);
+            link_socket = LINK_INVALID_SOCKET;
+            link_state = LINK_STATE_WAITING;
+            link_retry_time = SDL_GetTicks() + LINK_RETRY_PERIOD;
+            break;
+        }
+        case LINK_STATE_WAITING:
+        {
+            if ((Sint32)(SDL_GetTicks() - link_retry_time) >= 0)
+                link_connect();
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int Link_Start(const char *address, int port)
+{
+    if ((link_state != LINK_STATE_STOPPED) && (port == link_port)
+        && (strcmp(address, link_address) == 0))
+    {
+        return 0;
+    }
+
+    Link_Stop();
+
+#ifdef _WIN32
+    // It's initialized once, and it's cleaned up when the process ends
+    static int wsa_started = 0;
+    if (wsa_started == 0)
+    {
+        WSADATA wsa_data;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+        {
+            Debug_ErrorMsgArg("Link cable: Couldn't initialize Winsock.");
+            return 1;
+        }
+        wsa_started = 1;
+    }
+#endif
+
+    snprintf(link_address, sizeof(link_address), "%s", address);
+    link_port = port;
+
+    if (strlen(link_address) == 0)
+    {
+        if (link_listen() != 0)
+        {
+            Debug_ErrorMsgArg("Link cable: Couldn't listen in port %d.",
+                              port);
+            Link_Stop();
+            return 1;
+        }
+    }
+    else
+    {
+        Debug_LogMsgArg("Link cable: Connecting to %s:%d.", link_address,
+                        port);
+        link_connect();
+    }
+
+    return 0;
+}
+
+void Link_Stop(void)
+{
+    if (link_state == LINK_STATE_STOPPED)
+        return;
+
+    if (link_socket != LINK_INVALID_SOCKET)
+    {
+        link_close(link_socket);
+        link_socket = LINK_INVALID_SOCKET;
+    }
+
+    if (link_listen_socket != LINK_INVALID_SOCKET)
+    {
+        link_close(link_listen_socket);
+        link_listen_socket = LINK_INVALID_SOCKET;
+    }
+
+    link_state = LINK_STATE_STOPPED;
+}
+
+int Link_IsConnected(void)
+{
+    return link_state == LINK_STATE_CONNECTED;
+}
+
+int Link_Send(u8 type, u8 value)
+{
+    if (link_state != LINK_STATE_CONNECTED)
+        return 0;
+
+    const u8 message[2] = { type, value };
+    int sent = 0;
+
+    while (sent < (int)sizeof(message))
+    {
+        int ret = send(link_socket, (const char *)&message[sent],
+                       sizeof(message) - sent, LINK_SEND_FLAGS);
+        if (ret > 0)
+        {
+            sent += ret;
+            continue;
+        }
+
+        // The buffer of the socket is full, wait until there is space
+        if ((ret < 0) && link_error_is_would_block())
+        {
+            link_wait(link_socket, 1, LINK_RETRY_PERIOD);
+            continue;
+        }
+
+        link_disconnected();
+        return 1;
+    }
+
+    return 0;
+}
+
+int Link_Receive(u8 *type, u8 *value, int timeout_ms)
+{
+    Uint32 start = SDL_GetTicks();
+
+    while (1)
+    {
+        if ((link_buffer_end - link_buffer_start) >= 2)
+        {
+            *type = link_buffer[link_buffer_start];
+            *value = link_buffer[link_buffer_start + 1];
+            link_buffer_start += 2;
+            return 1;
+        }
+
+        link_update();
+
+        int elapsed = SDL_GetTicks() - start;
+        int remaining = timeout_ms - elapsed;
+
+        if (link_state != LINK_STATE_CONNECTED)
+        {
+            if (remaining <= 0)
+                return 0;
+
+            SDL_Delay(1);
+            continue;
+        }
+
+        // Move the incomplete message to the start of the buffer
+        int pending = link_buffer_end - link_buffer_start;
+        memmove(link_buffer, &link_buffer[link_buffer_start], pending);
+        link_buffer_start = 0;
+        link_buffer_end = pending;
+
+        int ret = recv(link_socket, (char *)&link_buffer[link_buffer_end],
+                       LINK_BUFFER_SIZE - link_buffer_end, 0);
+        if (ret > 0)
+        {
+            link_buffer_end += ret;
+            continue;
+        }
+
+        if ((ret < 0) && link_error_is_would_block())
+        {
+            if (remaining <= 0)
+                return 0;
+
+            link_wait(link_socket, 0, remaining);
+            continue;
+        }
+
+        // The connection has been closed or it has failed
+        link_disconnected();
+    }
+}
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef LINK_UTILS__
+#define LINK_UTILS__
+
+#include "general_utils.h"
+
+// TCP connection with another instance of the emulator, used to emulate a link
+// cable. One of them waits for the connection and the other one connects to
+// it. Messages are pairs of bytes: a type and a value. The protocol is
+// implemented by the emulated systems, this only transports the messages.
+//
+// Nothing here blocks unless a timeout is requested. The connection is set up
+// while messages are received, and if it's lost it's set up again.
+
+// If the address is empty, it waits for a connection in the specified port.
+// If not, it connects to that address. If it's already started with the same
+// settings, it keeps the current connection. Returns 1 on error, 0 if OK.
+int Link_Start(const char *address, int port);
+void Link_Stop(void);
+
+int Link_IsConnected(void);
+
+// Returns 1 on error, 0 if OK. Nothing is sent if it isn't connected.
+int Link_Send(u8 type, u8 value);
+
+// Returns 1 if a message has been received, 0 if there were no messages for
+// timeout_ms milliseconds.
+int Link_Receive(u8 *type, u8 *value, int timeout_ms);
+
+#endif // LINK_UTILS__
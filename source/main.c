@@ -5,21 +5,36 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <SDL.h>
 
+#include "autosave_utils.h"
+#include "checkpoint_utils.h"
 #include "config.h"
 #include "debug_utils.h"
+#include "dump_utils.h"
+#include "emuthread_utils.h"
 #include "file_utils.h"
 #include "font_utils.h"
+#include "framepace_utils.h"
+#include "headless.h"
 #include "input_utils.h"
+#include "png_utils.h"
+#include "profile_utils.h"
 #include "sound_utils.h"
 #include "window_handler.h"
 
 #include "gui/win_main.h"
 
+// Maximum time that the main loop sleeps while it's idle
+#define MAIN_IDLE_TIMEOUT_MS    (250)
+
 static int Init(void)
 {
+    // Messages are shown in the main window from now on
+    Debug_SetMessageHandler(Win_MainShowMessage);
+
     WH_Init();
 
     // Initialize SDL
@@ -64,6 +79,18 @@ static int Init(void)
 
     Sound_Init();
 
+    Autosave_Init();
+    atexit(Autosave_End);
+
+    Checkpoint_Init();
+    atexit(Checkpoint_End);
+
+    PNG_WriterInit();
+    atexit(PNG_WriterEnd);
+
+    Dump_Init();
+    atexit(Dump_End);
+
     if (DirCheckExistence(DirGetScreenshotFolderPath()) == 0)
         DirCreate(DirGetScreenshotFolderPath());
 
@@ -73,8 +100,6 @@ static int Init(void)
     return 0;
 }
 
-#define FLOAT_MS_PER_FRAME ((double)1000.0 / (double)60.0)
-
 int main(int argc, char *argv[])
 {
     // Try to get the path where the binary is running from. Try with SDL's
@@ -98,6 +123,15 @@ int main(int argc, char *argv[])
     Debug_Init();
     atexit(Debug_End);
 
+    if ((argc > 1) && (strcmp(argv[1], "--headless") == 0))
+        return Headless_Run(argc - 2, &argv[2]);
+    if ((argc > 1) && (strcmp(argv[1], "--bench") == 0))
+        return Headless_Bench(argc - 2, &argv[2]);
+    if ((argc > 1) && (strcmp(argv[1], "--test") == 0))
+        return Headless_Test(argc - 2, &argv[2]);
+    if ((argc > 1) && (strcmp(argv[1], "--decode-trace") == 0))
+        return Headless_DecodeTrace(argc - 2, &argv[2]);
+
     if (Init() != 0)
         return 1;
 
@@ -114,35 +148,51 @@ int main(int argc, char *argv[])
     //if (argc > 1)
     //    LOAD_GAME(argv[1]);
 
-    double waitforticks = 0;
-
     while (!WH_AreAllWindowsClosed())
     {
+        // The emulation thread is paused while events are handled, they may
+        // access the emulated console.
+        EmuThread_Pause();
+
         // Handle events for all windows
+        u64 events_start = Profile_TimerBegin();
         WH_HandleEvents();
+        Profile_TimerEnd(PROFILE_EVENTS, events_start);
 
         Win_MainLoopHandle();
 
+        EmuThread_Resume();
+
         // Render main window every frame
         Win_MainRender();
 
+        Sound_Update();
+
         // Synchronise video
-        if (Input_Speedup_Enabled())
+        if (Win_MainIsIdle())
+        {
+            // Nothing is drawn until an event changes something, so there is
+            // no need to wake up every frame. The timeout is only a safety net.
+            WH_WaitEvents(MAIN_IDLE_TIMEOUT_MS);
+        }
+        else if (EmuThread_IsEnabled())
+        {
+            // The emulation thread paces itself
+            EmuThread_WaitFrame();
+        }
+        else if (Input_Speedup_Enabled() && (EmulatorConfig.speedup_speed == 0))
         {
             SDL_Delay(0);
         }
-        else
+        else if (Sound_IsSyncEnabled())
         {
-            while (waitforticks >= SDL_GetTicks())
-                SDL_Delay(1);
-
-            int ticksnow = SDL_GetTicks();
+            Sound_WaitFrame();
 
-            // If the emulator missed a frame or more, adjust next frame
-            if (waitforticks < (ticksnow - FLOAT_MS_PER_FRAME))
-                waitforticks = ticksnow + FLOAT_MS_PER_FRAME;
-            else
-                waitforticks += FLOAT_MS_PER_FRAME;
+            FramePace_Reset();
+        }
+        else
+        {
+            FramePace_Wait();
         }
     }
 
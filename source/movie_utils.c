@@ -0,0 +1,409 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <zlib.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "input_utils.h"
+#include "movie_utils.h"
+#include "savestate_utils.h"
+
+#include "gb_core/gb_main.h"
+#include "gb_core/general.h"
+#include "gba_core/gba.h"
+
+#define MOVIE_VERSION   (1)
+
+// Bits of the packed input of a frame
+#define MOVIE_KEY_BIT(player, key)  (((player) * P_NUM_KEYS) + (key))
+#define MOVIE_MBC7_BIT              (4 * P_NUM_KEYS) // Up, down, right, left
+
+typedef struct
+{
+    u32 version;
+    u32 seed;
+    u32 power_on;
+    u32 frames;
+    u32 state_size; // Size of the state before compressing it
+} _movie_header_t;
+
+typedef struct
+{
+    u64 input;
+    u32 frames;
+} _movie_run_t;
+
+typedef enum
+{
+    MOVIE_NONE,
+    MOVIE_RECORDING,
+    MOVIE_PLAYING,
+} _movie_mode_e;
+
+static _movie_mode_e movie_mode = MOVIE_NONE;
+
+static char movie_path[MAX_PATHLEN];
+static _savestate_system_e movie_system;
+static _movie_header_t movie_header;
+
+static _movie_run_t *movie_runs;
+static u32 movie_runs_count;
+static u32 movie_runs_capacity;
+
+// Playback position
+static u32 movie_run_index;
+static u32 movie_run_frame;
+static u32 movie_frame;
+
+// State at the start of the movie, compressed
+static u8 *movie_state;
+static uLongf movie_state_size;
+
+static void Movie_Free(void)
+{
+    free(movie_runs);
+    movie_runs = NULL;
+    movie_runs_count = 0;
+    movie_runs_capacity = 0;
+
+    free(movie_state);
+    movie_state = NULL;
+    movie_state_size = 0;
+
+    movie_mode = MOVIE_NONE;
+}
+
+static int Movie_StateSave(_savestate_t *st)
+{
+    if (movie_system == SAVESTATE_SYSTEM_GBA)
+        return GBA_StateSave(st);
+    else
+        return GB_StateSave(st);
+}
+
+static int Movie_StateLoad(_savestate_t *st)
+{
+    if (movie_system == SAVESTATE_SYSTEM_GBA)
+        return GBA_StateLoad(st);
+    else
+        return GB_StateLoad(st);
+}
+
+// Returns 0 on success
+static int Movie_Save(void)
+{
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    SaveState_Begin(&st, movie_system, 0);
+    SaveState_WriteChunk(&st, "MOVH", &movie_header, sizeof(movie_header));
+    SaveState_WriteChunk(&st, "MOVS", movie_state, movie_state_size);
+    SaveState_WriteChunk(&st, "MOVI", movie_runs,
+                         movie_runs_count * sizeof(_movie_run_t));
+
+    int ret = st.error ? 1 : SaveState_FileSave(&st, movie_path);
+
+    SaveState_Free(&st);
+
+    return ret;
+}
+
+int Movie_RecordStart(const char *path, _savestate_system_e system,
+                      int power_on)
+{
+    Movie_Stop();
+
+    s_strncpy(movie_path, path, sizeof(movie_path));
+    movie_system = system;
+
+    memset(&movie_header, 0, sizeof(movie_header));
+    movie_header.version = MOVIE_VERSION;
+    movie_header.seed = (u32)time(NULL);
+    movie_header.power_on = power_on;
+
+    // The random values used when the console is reset depend on the seed
+    core_srand(movie_header.seed);
+
+    if (power_on)
+    {
+        if (system == SAVESTATE_SYSTEM_GBA)
+            GBA_Reset();
+        else
+            GB_HardReset();
+    }
+
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    if (Movie_StateSave(&st) != 0)
+    {
+        SaveState_Free(&st);
+        return 1;
+    }
+
+    movie_header.state_size = st.size;
+
+    movie_state_size = compressBound(st.size);
+    movie_state = malloc(movie_state_size);
+    int ret = (movie_state == NULL)
+              || (compress(movie_state, &movie_state_size, st.data, st.size)
+                  != Z_OK);
+
+    SaveState_Free(&st);
+
+    if (ret)
+    {
+        Debug_ErrorMsgArg("%s: Can't compress the state.", __func__);
+        Movie_Free();
+        return 1;
+    }
+
+    movie_mode = MOVIE_RECORDING;
+
+    return 0;
+}
+
+int Movie_PlayStart(const char *path, _savestate_system_e system)
+{
+    Movie_Stop();
+
+    movie_system = system;
+
+    _savestate_t st;
+    SaveState_Init(&st);
+
+    if (SaveState_FileLoad(&st, path) != 0)
+    {
+        SaveState_Free(&st);
+        return 1;
+    }
+
+    if (SaveState_Open(&st, system, 0) != 0)
+    {
+        Debug_ErrorMsgArg("%s isn't a movie of this system.", path);
+        SaveState_Free(&st);
+        return 1;
+    }
+
+    SaveState_ReadChunk(&st, "MOVH", &movie_header, sizeof(movie_header));
+
+    if (st.error || (movie_header.version != MOVIE_VERSION))
+    {
+        Debug_ErrorMsgArg("%s: Invalid movie.", path);
+        SaveState_Free(&st);
+        return 1;
+    }
+
+    SaveState_ChunkOpen(&st, "MOVS");
+    movie_state_size = st.read_end - st.read_offset;
+    movie_state = malloc(movie_state_size);
+    if (movie_state != NULL)
+        SaveState_Read(&st, movie_state, movie_state_size);
+    SaveState_ChunkClose(&st);
+
+    SaveState_ChunkOpen(&st, "MOVI");
+    movie_runs_count = (st.read_end - st.read_offset) / sizeof(_movie_run_t);
+    movie_runs_capacity = movie_runs_count;
+    size_t runs_size = movie_runs_count * sizeof(_movie_run_t);
+    movie_runs = malloc(runs_size + 1); // An empty movie is valid
+    if (movie_runs != NULL)
+        SaveState_Read(&st, movie_runs, runs_size);
+    SaveState_ChunkClose(&st);
+
+    int error = st.error || (movie_state == NULL) || (movie_runs == NULL);
+
+    SaveState_Free(&st);
+
+    // State at the start
+
+    _savestate_t start;
+    SaveState_Init(&start);
+
+    if (error == 0)
+    {
+        uLongf size = movie_header.state_size;
+        u8 *data = malloc(size);
+
+        error = (data == NULL)
+                || (uncompress(data, &size, movie_state, movie_state_size)
+                    != Z_OK)
+                || (size != movie_header.state_size);
+
+        if (error == 0)
+            SaveState_SetData(&start, data, size);
+
+        free(data);
+    }
+
+    if (error)
+    {
+        Debug_ErrorMsgArg("%s: Invalid movie.", path);
+        SaveState_Free(&start);
+        Movie_Free();
+        return 1;
+    }
+
+    // The state is checked against the loaded ROM, and the emulation isn't
+    // modified if it can't be loaded.
+    if (Movie_StateLoad(&start) != 0)
+    {
+        SaveState_Free(&start);
+        Movie_Free();
+        return 1;
+    }
+
+    SaveState_Free(&start);
+
+    core_srand(movie_header.seed);
+
+    s_strncpy(movie_path, path, sizeof(movie_path));
+
+    movie_run_index = 0;
+    movie_run_frame = 0;
+    movie_frame = 0;
+
+    movie_mode = MOVIE_PLAYING;
+
+    return 0;
+}
+
+void Movie_Stop(void)
+{
+    if (movie_mode == MOVIE_RECORDING)
+    {
+        if (Movie_Save() == 0)
+        {
+            Debug_LogMsgArg("Movie: %u frames saved to %s",
+                            movie_header.frames, movie_path);
+        }
+    }
+
+    Movie_Free();
+}
+
+int Movie_IsRecording(void)
+{
+    return movie_mode == MOVIE_RECORDING;
+}
+
+int Movie_IsPlaying(void)
+{
+    return movie_mode == MOVIE_PLAYING;
+}
+
+u32 Movie_GetLength(void)
+{
+    return movie_header.frames;
+}
+
+static u64 Movie_InputPack(const _input_state_t *state)
+{
+    u64 input = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int k = 0; k < P_NUM_KEYS; k++)
+        {
+            if (state->keys[i][k])
+                input |= 1ULL << MOVIE_KEY_BIT(i, k);
+        }
+    }
+
+    if (state->mbc7_up)
+        input |= 1ULL << (MOVIE_MBC7_BIT + 0);
+    if (state->mbc7_down)
+        input |= 1ULL << (MOVIE_MBC7_BIT + 1);
+    if (state->mbc7_right)
+        input |= 1ULL << (MOVIE_MBC7_BIT + 2);
+    if (state->mbc7_left)
+        input |= 1ULL << (MOVIE_MBC7_BIT + 3);
+
+    return input;
+}
+
+static void Movie_InputUnpack(u64 input, _input_state_t *state)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        for (int k = 0; k < P_NUM_KEYS; k++)
+            state->keys[i][k] = (input >> MOVIE_KEY_BIT(i, k)) & 1;
+    }
+
+    state->mbc7_up = (input >> (MOVIE_MBC7_BIT + 0)) & 1;
+    state->mbc7_down = (input >> (MOVIE_MBC7_BIT + 1)) & 1;
+    state->mbc7_right = (input >> (MOVIE_MBC7_BIT + 2)) & 1;
+    state->mbc7_left = (input >> (MOVIE_MBC7_BIT + 3)) & 1;
+}
+
+static void Movie_FrameRecord(const _input_state_t *state)
+{
+    u64 input = Movie_InputPack(state);
+
+    if ((movie_runs_count > 0)
+        && (movie_runs[movie_runs_count - 1].input == input))
+    {
+        movie_runs[movie_runs_count - 1].frames++;
+        movie_header.frames++;
+        return;
+    }
+
+    if (movie_runs_count == movie_runs_capacity)
+    {
+        u32 capacity = movie_runs_capacity ? movie_runs_capacity * 2 : 1024;
+        _movie_run_t *runs = realloc(movie_runs,
+                                     capacity * sizeof(_movie_run_t));
+        if (runs == NULL)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+            Movie_Stop(); // Save what has been recorded so far
+            return;
+        }
+
+        movie_runs = runs;
+        movie_runs_capacity = capacity;
+    }
+
+    movie_runs[movie_runs_count].input = input;
+    movie_runs[movie_runs_count].frames = 1;
+    movie_runs_count++;
+    movie_header.frames++;
+}
+
+static void Movie_FramePlay(_input_state_t *state)
+{
+    while ((movie_run_index < movie_runs_count)
+           && (movie_run_frame >= movie_runs[movie_run_index].frames))
+    {
+        movie_run_index++;
+        movie_run_frame = 0;
+    }
+
+    if (movie_run_index >= movie_runs_count)
+    {
+        Debug_LogMsgArg("Movie: Finished after %u frames", movie_frame);
+        Movie_Stop();
+        return;
+    }
+
+    Movie_InputUnpack(movie_runs[movie_run_index].input, state);
+
+    movie_run_frame++;
+    movie_frame++;
+}
+
+void Movie_Frame(_input_state_t *state)
+{
+    if (movie_mode == MOVIE_RECORDING)
+        Movie_FrameRecord(state);
+    else if (movie_mode == MOVIE_PLAYING)
+        Movie_FramePlay(state);
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef MOVIE_UTILS__
+#define MOVIE_UTILS__
+
+#include "general_utils.h"
+#include "input_utils.h"
+#include "savestate_utils.h"
+
+// Movies of the input of the emulated console, used to replay the same session
+// exactly. A movie starts with a save state of the console, taken right after
+// a reset when it starts from power-on, and has the keys pressed in each frame
+// after it. The seed of core_rand() is saved too, so the random values seen by
+// the emulation are the same (the output of the webcam if it isn't enabled).
+//
+// The file uses the same format as save states, so a movie can only be played
+// by a build that can load the states saved by the build that recorded it. The
+// input is stored as runs of frames with the same keys pressed, and the state
+// is compressed.
+
+#define MOVIE_EXTENSION     "gbm"
+
+// They return 0 on success. Only one movie can be active at a time, starting a
+// movie stops the previous one.
+int Movie_RecordStart(const char *path, _savestate_system_e system,
+                      int power_on);
+// The movie must have been recorded with the ROM that is loaded
+int Movie_PlayStart(const char *path, _savestate_system_e system);
+
+// Saves the movie if it's being recorded
+void Movie_Stop(void);
+
+int Movie_IsRecording(void);
+int Movie_IsPlaying(void);
+
+// Number of frames recorded, or length of the movie being played
+u32 Movie_GetLength(void);
+
+// Called before emulating each frame with the input of the user. When a movie
+// is being recorded the input is added to it. When it is being played, the keys
+// of the console are replaced by the ones of the movie, and the movie stops
+// after the last frame.
+void Movie_Frame(_input_state_t *state);
+
+#endif // MOVIE_UTILS__
@@ -0,0 +1,501 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifdef ENABLE_OPCODE_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "opprofile_utils.h"
+
+core_local__ int opprofile_enabled = 0;
+
+core_local__ _opprofile_counter_t *opprofile_counters = NULL;
+
+// The counters of the frames are added to the session when the frame ends, and
+// the arrays of the current frame and the last one are swapped.
+static core_local__ _opprofile_counter_t *opprofile_last_frame = NULL;
+static core_local__ _opprofile_counter_t *opprofile_session = NULL;
+
+static void opprofile_free(void)
+{
+    free(opprofile_counters);
+    free(opprofile_last_frame);
+    free(opprofile_session);
+    opprofile_counters = NULL;
+    opprofile_last_frame = NULL;
+    opprofile_session = NULL;
+}
+
+void OPProfile_Start(void)
+{
+    opprofile_enabled = 0;
+    opprofile_free();
+
+    opprofile_counters = calloc(OPPROFILE_COUNTERS,
+                                sizeof(_opprofile_counter_t));
+    opprofile_last_frame = calloc(OPPROFILE_COUNTERS,
+                                  sizeof(_opprofile_counter_t));
+    opprofile_session = calloc(OPPROFILE_COUNTERS,
+                               sizeof(_opprofile_counter_t));
+
+    if ((opprofile_counters == NULL) || (opprofile_last_frame == NULL)
+        || (opprofile_session == NULL))
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+        opprofile_free();
+        return;
+    }
+
+    opprofile_enabled = 1;
+}
+
+static void opprofile_session_add(void)
+{
+    for (int i = 0; i < OPPROFILE_COUNTERS; i++)
+    {
+        opprofile_session[i].executed += opprofile_counters[i].executed;
+        opprofile_session[i].cycles += opprofile_counters[i].cycles;
+    }
+}
+
+void OPProfile_Stop(void)
+{
+    if (opprofile_enabled == 0)
+        return;
+
+    opprofile_enabled = 0;
+
+    // The counters of the frame that hasn't finished are kept in the session
+    opprofile_session_add();
+    memset(opprofile_counters, 0,
+           OPPROFILE_COUNTERS * sizeof(_opprofile_counter_t));
+}
+
+void OPProfile_End(void)
+{
+    opprofile_enabled = 0;
+    opprofile_free();
+}
+
+void OPProfile_FrameEnd(void)
+{
+    if (opprofile_enabled == 0)
+        return;
+
+    opprofile_session_add();
+
+    _opprofile_counter_t *frame = opprofile_last_frame;
+    opprofile_last_frame = opprofile_counters;
+    opprofile_counters = frame;
+
+    memset(opprofile_counters, 0,
+           OPPROFILE_COUNTERS * sizeof(_opprofile_counter_t));
+}
+
+//------------------------------------------------------------------------------
+
+typedef enum
+{
+    OPPROFILE_SET_ARM,
+    OPPROFILE_SET_THUMB,
+    OPPROFILE_SET_GB,
+} _opprofile_set_e;
+
+static _opprofile_set_e opprofile_set(u32 index, u32 *key)
+{
+    if (index < OPPROFILE_THUMB(0))
+    {
+        *key = index;
+        return OPPROFILE_SET_ARM;
+    }
+
+    if (index < OPPROFILE_GB(0))
+    {
+        *key = index - OPPROFILE_THUMB(0);
+        return OPPROFILE_SET_THUMB;
+    }
+
+    *key = index - OPPROFILE_GB(0);
+    return OPPROFILE_SET_GB;
+}
+
+const char *OPProfile_GetSetName(u32 index)
+{
+    static const char *names[] = { "ARM", "THUMB", "GB" };
+
+    u32 key;
+    return names[opprofile_set(index, &key)];
+}
+
+// Same groups as the code cache, the key is the index of its decode table
+static const char *opprofile_arm_class(u32 key)
+{
+    switch ((key >> 9) & 7)
+    {
+        case 0:
+            if (key & BIT(0))
+            {
+                if (key & BIT(3))
+                    return "Multiply, SWP, LDRH/STRH/LDRSB/LDRSH";
+
+                return "Data processing (shift by register), BX";
+            }
+            return "Data processing (shift by immediate), MRS, MSR";
+        case 1:
+            return "Data processing (immediate), MSR";
+        case 2:
+            return "LDR/STR (immediate offset)";
+        case 3:
+            return "LDR/STR (register offset)";
+        case 4:
+            return "LDM/STM";
+        case 5:
+            return "B, BL";
+        case 6:
+            return "LDC/STC";
+        case 7:
+        default:
+            return "CDP, MRC, MCR, SWI";
+    }
+}
+
+// The key has bits 15-6 of the opcode
+static const char *opprofile_thumb_class(u32 key)
+{
+    u32 opcode = key << 6;
+
+    if ((opcode & 0xF800) == 0x1800)
+        return "ADD/SUB";
+    if ((opcode & 0xE000) == 0x0000)
+        return "Shift by immediate";
+    if ((opcode & 0xE000) == 0x2000)
+        return "MOV/CMP/ADD/SUB (immediate)";
+    if ((opcode & 0xFC00) == 0x4000)
+        return "ALU operations";
+    if ((opcode & 0xFC00) == 0x4400)
+        return "High register operations, BX";
+    if ((opcode & 0xF800) == 0x4800)
+        return "LDR (PC relative)";
+    if ((opcode & 0xF000) == 0x5000)
+        return "LDR/STR (register offset)";
+    if ((opcode & 0xE000) == 0x6000)
+        return "LDR/STR (immediate offset)";
+    if ((opcode & 0xF000) == 0x8000)
+        return "LDRH/STRH (immediate offset)";
+    if ((opcode & 0xF000) == 0x9000)
+        return "LDR/STR (SP relative)";
+    if ((opcode & 0xF000) == 0xA000)
+        return "ADD (PC/SP relative)";
+    if ((opcode & 0xFF00) == 0xB000)
+        return "ADD SP";
+    if ((opcode & 0xF600) == 0xB400)
+        return "PUSH/POP";
+    if ((opcode & 0xF000) == 0xC000)
+        return "LDMIA/STMIA";
+    if ((opcode & 0xFF00) == 0xDF00)
+        return "SWI";
+    if (((opcode & 0xF000) == 0xD000) && ((opcode & 0xFF00) != 0xDE00))
+        return "B (conditional)";
+    if ((opcode & 0xF800) == 0xE000)
+        return "B";
+    if ((opcode & 0xF000) == 0xF000)
+        return "BL";
+
+    return "Undefined";
+}
+
+// The key is the opcode, or 0x100 + the second byte of CB opcodes
+static const char *opprofile_gb_class(u32 key)
+{
+    if (key >= 0x100)
+    {
+        switch ((key >> 6) & 3)
+        {
+            case 0:
+                return "CB rotations and shifts";
+            case 1:
+                return "CB BIT";
+            case 2:
+                return "CB RES";
+            case 3:
+            default:
+                return "CB SET";
+        }
+    }
+
+    if (key == 0x76)
+        return "HALT";
+    if ((key & 0xC0) == 0x40)
+        return "LD r8,r8";
+    if ((key & 0xC0) == 0x80)
+        return "ALU A,r8";
+
+    if (key < 0x40)
+    {
+        switch (key & 7)
+        {
+            case 0:
+                return "NOP, STOP, JR, LD [nnnn],SP";
+            case 1:
+                return "LD r16,nnnn, ADD HL,r16";
+            case 2:
+                return "LD [r16],A, LD A,[r16]";
+            case 3:
+                return "INC/DEC r16";
+            case 4:
+            case 5:
+                return "INC/DEC r8";
+            case 6:
+                return "LD r8,nn";
+            case 7:
+            default:
+                return "Rotations of A, DAA, CPL, SCF, CCF";
+        }
+    }
+
+    if ((key & 7) == 6)
+        return "ALU A,nn";
+    if ((key & 7) == 7)
+        return "RST";
+    if ((key & 0xCB) == 0xC1)
+        return "PUSH/POP";
+    if ((key < 0xE0) || (key == 0xE9))
+        return "JP, JR, CALL, RET";
+
+    return "LDH, ADD SP, LD HL,SP, DI, EI";
+}
+
+const char *OPProfile_GetClassName(u32 index)
+{
+    u32 key;
+
+    switch (opprofile_set(index, &key))
+    {
+        case OPPROFILE_SET_ARM:
+            return opprofile_arm_class(key);
+        case OPPROFILE_SET_THUMB:
+            return opprofile_thumb_class(key);
+        case OPPROFILE_SET_GB:
+        default:
+            return opprofile_gb_class(key);
+    }
+}
+
+void OPProfile_GetPattern(u32 index, char *buffer, size_t size)
+{
+    u32 key;
+
+    switch (opprofile_set(index, &key))
+    {
+        case OPPROFILE_SET_ARM:
+            snprintf(buffer, size, "x%02Xxxx%Xx", key >> 4, key & 0xF);
+            break;
+        case OPPROFILE_SET_THUMB:
+        {
+            char bits[17];
+            for (int i = 0; i < 10; i++)
+                bits[i] = (key & BIT(9 - i)) ? '1' : '0';
+            memcpy(&bits[10], "xxxxxx", 7);
+            snprintf(buffer, size, "%s", bits);
+            break;
+        }
+        case OPPROFILE_SET_GB:
+        default:
+            if (key >= 0x100)
+                snprintf(buffer, size, "CB %02X", key & 0xFF);
+            else
+                snprintf(buffer, size, "%02X", key);
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static int opprofile_entry_compare(const void *a, const void *b)
+{
+    const _opprofile_entry_t *entry_a = a;
+    const _opprofile_entry_t *entry_b = b;
+
+    if (entry_a->cycles > entry_b->cycles)
+        return -1;
+    if (entry_a->cycles < entry_b->cycles)
+        return 1;
+    if (entry_a->executed > entry_b->executed)
+        return -1;
+    if (entry_a->executed < entry_b->executed)
+        return 1;
+    if (entry_a->index < entry_b->index)
+        return -1;
+    if (entry_a->index > entry_b->index)
+        return 1;
+    return 0;
+}
+
+// Returns an allocated array with the opcodes that have been executed, sorted
+// by number of cycles.
+static _opprofile_entry_t *opprofile_sorted(const _opprofile_counter_t *c,
+                                            int *num)
+{
+    _opprofile_entry_t *list = malloc(OPPROFILE_COUNTERS
+                                      * sizeof(_opprofile_entry_t));
+    if (list == NULL)
+        return NULL;
+
+    int n = 0;
+    for (int i = 0; i < OPPROFILE_COUNTERS; i++)
+    {
+        if (c[i].executed == 0)
+            continue;
+
+        list[n].index = i;
+        list[n].executed = c[i].executed;
+        list[n].cycles = c[i].cycles;
+        n++;
+    }
+
+    qsort(list, n, sizeof(_opprofile_entry_t), opprofile_entry_compare);
+
+    *num = n;
+    return list;
+}
+
+int OPProfile_GetTop(_opprofile_range_e range, _opprofile_entry_t *entries,
+                     int max)
+{
+    const _opprofile_counter_t *c = (range == OPPROFILE_SESSION) ?
+                                    opprofile_session : opprofile_last_frame;
+    if (c == NULL)
+        return 0;
+
+    int num;
+    _opprofile_entry_t *list = opprofile_sorted(c, &num);
+    if (list == NULL)
+        return 0;
+
+    if (num > max)
+        num = max;
+
+    memcpy(entries, list, num * sizeof(_opprofile_entry_t));
+
+    free(list);
+
+    return num;
+}
+
+//------------------------------------------------------------------------------
+
+static void opprofile_export_write(FILE *f, const _opprofile_entry_t *list,
+                                   int num)
+{
+    u64 total_cycles = 0;
+    for (int i = 0; i < num; i++)
+        total_cycles += list[i].cycles;
+
+    fprintf(f, "set,class,pattern,executed,cycles,cycles_per_instruction,"
+               "percent_cycles,last_frame_executed,last_frame_cycles\n");
+
+    // The totals of each class are written first, with "*" as pattern. The
+    // class names of each set are different, so they are used as keys.
+    const char *classes[128];
+    u64 class_executed[128] = { 0 };
+    u64 class_cycles[128] = { 0 };
+    u64 class_frame_executed[128] = { 0 };
+    u64 class_frame_cycles[128] = { 0 };
+    u32 class_index[128];
+    int num_classes = 0;
+
+    for (int i = 0; i < num; i++)
+    {
+        const char *name = OPProfile_GetClassName(list[i].index);
+
+        int c = 0;
+        while ((c < num_classes) && (classes[c] != name))
+            c++;
+
+        if (c == num_classes)
+        {
+            if (num_classes == ARRAY_NUM_ELEMENTS(classes))
+                continue;
+
+            classes[c] = name;
+            class_index[c] = list[i].index;
+            num_classes++;
+        }
+
+        class_executed[c] += list[i].executed;
+        class_cycles[c] += list[i].cycles;
+        class_frame_executed[c] += opprofile_last_frame[list[i].index].executed;
+        class_frame_cycles[c] += opprofile_last_frame[list[i].index].cycles;
+    }
+
+    for (int c = 0; c < num_classes; c++)
+    {
+        fprintf(f, "%s,\"%s\",*,%llu,%llu,%.3f,%.3f,%llu,%llu\n",
+                OPProfile_GetSetName(class_index[c]), classes[c],
+                (unsigned long long)class_executed[c],
+                (unsigned long long)class_cycles[c],
+                (double)class_cycles[c] / class_executed[c],
+                total_cycles ? (100.0 * class_cycles[c]) / total_cycles : 0.0,
+                (unsigned long long)class_frame_executed[c],
+                (unsigned long long)class_frame_cycles[c]);
+    }
+
+    for (int i = 0; i < num; i++)
+    {
+        const _opprofile_entry_t *e = &list[i];
+        const _opprofile_counter_t *frame = &opprofile_last_frame[e->index];
+
+        char pattern[32];
+        OPProfile_GetPattern(e->index, pattern, sizeof(pattern));
+
+        fprintf(f, "%s,\"%s\",%s,%llu,%llu,%.3f,%.3f,%llu,%llu\n",
+                OPProfile_GetSetName(e->index),
+                OPProfile_GetClassName(e->index), pattern,
+                (unsigned long long)e->executed,
+                (unsigned long long)e->cycles,
+                (double)e->cycles / e->executed,
+                total_cycles ? (100.0 * e->cycles) / total_cycles : 0.0,
+                (unsigned long long)frame->executed,
+                (unsigned long long)frame->cycles);
+    }
+}
+
+const char *OPProfile_ExportCSV(void)
+{
+    if (opprofile_session == NULL)
+        return NULL;
+
+    int num;
+    _opprofile_entry_t *list = opprofile_sorted(opprofile_session, &num);
+    if (list == NULL)
+        return NULL;
+
+    char *path = FU_GetNewTimestampFilenameExt("opprofile", "csv");
+
+    FILE *f = fopen(path, "w");
+    if (f != NULL)
+    {
+        opprofile_export_write(f, list, num);
+        fclose(f);
+    }
+    else
+    {
+        Debug_ErrorMsgArg("Couldn't create file: %s", path);
+        path = NULL;
+    }
+
+    free(list);
+
+    return path;
+}
+
+#endif // ENABLE_OPCODE_PROFILE
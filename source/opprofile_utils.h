@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef OPPROFILE_UTILS__
+#define OPPROFILE_UTILS__
+
+// Counts the number of times each opcode is executed and the cycles it takes,
+// to know which handlers of the interpreters are worth optimizing. The opcodes
+// are grouped by the bits that the interpreters use to select their handler:
+//
+// - ARM: Bits 27-20 and 7-4, the index of the decode table of the code cache.
+// - THUMB: Bits 15-6.
+// - GB: The opcode, or 0x100 + the second byte for opcodes with a CB prefix.
+//
+// It is only built with ENABLE_OPCODE_PROFILE, otherwise the interpreters
+// don't have any code of the profiler at all. When it's built but it isn't
+// running, the cost is checking a local variable per instruction.
+//
+// The instructions that leave the interpreter loop directly (SWI, BX to THUMB,
+// undefined instructions...) are counted as executed, but their cycles aren't.
+// The counters of the whole session and the ones of the last frame are kept.
+
+#ifdef ENABLE_OPCODE_PROFILE
+
+#include <stddef.h>
+
+#include "general_utils.h"
+
+#define OPPROFILE_ARM_KEYS      (4096)
+#define OPPROFILE_THUMB_KEYS    (1024)
+#define OPPROFILE_GB_KEYS       (512)
+
+// Index of the counter of an opcode in the arrays of counters
+#define OPPROFILE_ARM(key)      (key)
+#define OPPROFILE_THUMB(key)    (OPPROFILE_ARM_KEYS + (key))
+#define OPPROFILE_GB(key)       (OPPROFILE_ARM_KEYS + OPPROFILE_THUMB_KEYS \
+                                 + (key))
+
+#define OPPROFILE_COUNTERS      (OPPROFILE_ARM_KEYS + OPPROFILE_THUMB_KEYS \
+                                 + OPPROFILE_GB_KEYS)
+
+typedef struct
+{
+    u64 executed;
+    u64 cycles;
+} _opprofile_counter_t;
+
+extern core_local__ int opprofile_enabled;
+
+// Counters of the frame that is being emulated
+extern core_local__ _opprofile_counter_t *opprofile_counters;
+
+// The interpreters only call them while opprofile_enabled is set
+static inline void OPProfile_Executed(u32 index)
+{
+    opprofile_counters[index].executed++;
+}
+
+static inline void OPProfile_Cycles(u32 index, u32 cycles)
+{
+    opprofile_counters[index].cycles += cycles;
+}
+
+// Clears the counters of the previous session
+void OPProfile_Start(void);
+void OPProfile_Stop(void);
+// Stops it and frees the counters
+void OPProfile_End(void);
+
+// Called by the cores at the end of every frame
+void OPProfile_FrameEnd(void);
+
+typedef enum
+{
+    OPPROFILE_SESSION,
+    OPPROFILE_LAST_FRAME,
+} _opprofile_range_e;
+
+typedef struct
+{
+    u32 index;
+    u64 executed;
+    u64 cycles;
+} _opprofile_entry_t;
+
+// Fills the array with the opcodes with the highest number of cycles, sorted.
+// Returns the number of entries written.
+int OPProfile_GetTop(_opprofile_range_e range, _opprofile_entry_t *entries,
+                     int max);
+
+// Name of the instruction set and the class of the opcode (the top level case
+// of the interpreter that handles it), and the bits of the opcode that select
+// the handler (for example "x1Axxx0x" for ARM).
+const char *OPProfile_GetSetName(u32 index);
+const char *OPProfile_GetClassName(u32 index);
+void OPProfile_GetPattern(u32 index, char *buffer, size_t size);
+
+// Saves the counters of the session, the ones of the last frame and the totals
+// of each class as a CSV file in the screenshots folder. Returns the path of
+// the file, or NULL on error.
+const char *OPProfile_ExportCSV(void);
+
+#endif // ENABLE_OPCODE_PROFILE
+
+#endif // OPPROFILE_UTILS__
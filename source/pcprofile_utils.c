@@ -0,0 +1,578 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "pcprofile_utils.h"
+
+core_local__ int pcprofile_enabled = 0;
+
+static core_local__ _pcprofile_system_e pcprofile_system;
+
+// Number of addresses with the highest number of samples in the report
+#define PCPROFILE_EXPORT_ADDRESSES  (100)
+
+//------------------------------------------------------------------------------
+
+// Hash table of addresses with open addressing. Empty buckets have 0 samples.
+
+typedef struct
+{
+    u32 address;
+    u32 samples;
+} _pcprofile_bucket_t;
+
+typedef struct
+{
+    _pcprofile_bucket_t *buckets;
+    int bits; // The size is (1 << bits)
+    u32 used;
+} _pcprofile_table_t;
+
+#define PCPROFILE_TABLE_MIN_BITS    (12)
+
+static core_local__ _pcprofile_table_t pcprofile_samples;
+static core_local__ u64 pcprofile_total;
+
+static u32 pcprofile_hash(u32 address, int bits)
+{
+    return (address * 2654435761u) >> (32 - bits);
+}
+
+static int pcprofile_table_init(_pcprofile_table_t *t, int bits)
+{
+    t->buckets = calloc((size_t)1 << bits, sizeof(_pcprofile_bucket_t));
+    t->bits = bits;
+    t->used = 0;
+
+    return t->buckets == NULL;
+}
+
+static void pcprofile_table_free(_pcprofile_table_t *t)
+{
+    free(t->buckets);
+    t->buckets = NULL;
+    t->used = 0;
+}
+
+static void pcprofile_table_insert(_pcprofile_table_t *t, u32 address,
+                                   u32 count)
+{
+    u32 mask = (1u << t->bits) - 1;
+    u32 i = pcprofile_hash(address, t->bits);
+
+    while (t->buckets[i].samples != 0)
+    {
+        if (t->buckets[i].address == address)
+        {
+            t->buckets[i].samples += count;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    t->buckets[i].address = address;
+    t->buckets[i].samples = count;
+    t->used++;
+}
+
+// Returns 1 if there is no memory to grow the table
+static int pcprofile_table_add(_pcprofile_table_t *t, u32 address, u32 count)
+{
+    if (t->buckets == NULL)
+        return 1;
+
+    // Keep it at most 3/4 full so that the searches stay short
+    if ((t->used * 4) >= ((1u << t->bits) * 3))
+    {
+        _pcprofile_table_t bigger;
+        if (pcprofile_table_init(&bigger, t->bits + 1) != 0)
+            return 1;
+
+        for (u32 i = 0; i < (1u << t->bits); i++)
+        {
+            _pcprofile_bucket_t *b = &t->buckets[i];
+            if (b->samples != 0)
+                pcprofile_table_insert(&bigger, b->address, b->samples);
+        }
+
+        pcprofile_table_free(t);
+        *t = bigger;
+    }
+
+    pcprofile_table_insert(t, address, count);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+    u32 address;
+    char name[PCPROFILE_NAME_LENGTH];
+} _pcprofile_symbol_t;
+
+static core_local__ _pcprofile_symbol_t *pcprofile_symbols;
+static core_local__ int pcprofile_symbols_num;
+
+static int pcprofile_symbol_compare(const void *a, const void *b)
+{
+    u32 address_a = ((const _pcprofile_symbol_t *)a)->address;
+    u32 address_b = ((const _pcprofile_symbol_t *)b)->address;
+
+    if (address_a < address_b)
+        return -1;
+    if (address_a > address_b)
+        return 1;
+    return 0;
+}
+
+static void pcprofile_symbols_free(void)
+{
+    free(pcprofile_symbols);
+    pcprofile_symbols = NULL;
+    pcprofile_symbols_num = 0;
+}
+
+// Returns 1 if the line has a symbol
+static int pcprofile_symbol_parse(const char *line, _pcprofile_symbol_t *sym)
+{
+    while (isspace((unsigned char)*line))
+        line++;
+
+    char *end;
+    unsigned long value = strtoul(line, &end, 16);
+    if (end == line)
+        return 0; // Comments, sections, empty lines...
+
+    if (*end == ':') // rgbds: Bank and address
+    {
+        const char *address = end + 1;
+        unsigned long offset = strtoul(address, &end, 16);
+        if (end == address)
+            return 0;
+
+        sym->address = ((u32)value << 16) | (offset & 0xFFFF);
+    }
+    else
+    {
+        // THUMB functions have bit 0 set in the output of nm
+        sym->address = (u32)value & ~1u;
+    }
+
+    if (!isspace((unsigned char)*end))
+        return 0;
+
+    line = end;
+    while (isspace((unsigned char)*line))
+        line++;
+
+    // Skip the type of the symbol in the output of nm
+    if ((line[0] != '\0') && (line[1] == ' ' || line[1] == '\t'))
+    {
+        line++;
+        while (isspace((unsigned char)*line))
+            line++;
+    }
+
+    size_t len = 0;
+    while ((line[len] != '\0') && !isspace((unsigned char)line[len]))
+        len++;
+
+    if (len == 0)
+        return 0;
+
+    if (len >= sizeof(sym->name))
+        len = sizeof(sym->name) - 1;
+
+    memcpy(sym->name, line, len);
+    sym->name[len] = '\0';
+
+    return 1;
+}
+
+int PCProfile_SymbolsLoad(const char *rom_path)
+{
+    pcprofile_symbols_free();
+
+    // Replace the extension of the ROM (or of the archive it's in)
+    char path[MAX_PATHLEN];
+    s_strncpy(path, rom_path, sizeof(path));
+
+    char *dot = strrchr(path, '.');
+    char *slash = strrchr(path, '/');
+    char *backslash = strrchr(path, '\\');
+    if (backslash > slash)
+        slash = backslash;
+    if ((dot != NULL) && ((slash == NULL) || (dot > slash)))
+        *dot = '\0';
+
+    if ((strlen(path) + strlen(".sym")) >= sizeof(path))
+        return 1;
+    strcat(path, ".sym");
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return 1;
+
+    int capacity = 0;
+    char line[512];
+
+    while (fgets(line, sizeof(line), f))
+    {
+        _pcprofile_symbol_t sym;
+        if (pcprofile_symbol_parse(line, &sym) == 0)
+            continue;
+
+        if (pcprofile_symbols_num == capacity)
+        {
+            int new_capacity = (capacity == 0) ? 256 : (capacity * 2);
+            _pcprofile_symbol_t *new_symbols =
+                    realloc(pcprofile_symbols,
+                            new_capacity * sizeof(_pcprofile_symbol_t));
+            if (new_symbols == NULL)
+            {
+                Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+                break;
+            }
+            pcprofile_symbols = new_symbols;
+            capacity = new_capacity;
+        }
+
+        pcprofile_symbols[pcprofile_symbols_num++] = sym;
+    }
+
+    fclose(f);
+
+    if (pcprofile_symbols_num == 0)
+    {
+        pcprofile_symbols_free();
+        return 1;
+    }
+
+    qsort(pcprofile_symbols, pcprofile_symbols_num,
+          sizeof(_pcprofile_symbol_t), pcprofile_symbol_compare);
+
+    // Only keep one name for each address
+    int num = 1;
+    for (int i = 1; i < pcprofile_symbols_num; i++)
+    {
+        if (pcprofile_symbols[i].address != pcprofile_symbols[num - 1].address)
+            pcprofile_symbols[num++] = pcprofile_symbols[i];
+    }
+    pcprofile_symbols_num = num;
+
+    Debug_LogMsgArg("PC profiler: Loaded %d symbols from %s", num, path);
+
+    return 0;
+}
+
+// Functions can't continue from one memory region to the next one. In the GB,
+// the regions are the ROM banks and each area of the memory map.
+static u32 pcprofile_region(u32 address)
+{
+    if (pcprofile_system == PCPROFILE_GBA)
+        return address >> 24;
+
+    u32 bank = address >> 16;
+    u32 offset = address & 0xFFFF;
+
+    // 16 KB for the ROM, 8 KB for the rest
+    u32 area = (offset < 0x8000) ? (offset >> 14) : (offset >> 13);
+
+    return (bank << 8) | area;
+}
+
+// Returns the symbol that the address belongs to, or NULL. It's the closest
+// one before it in the same memory region.
+static const _pcprofile_symbol_t *pcprofile_symbol_find(u32 address)
+{
+    int low = 0;
+    int high = pcprofile_symbols_num - 1;
+    const _pcprofile_symbol_t *found = NULL;
+
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        if (pcprofile_symbols[mid].address <= address)
+        {
+            found = &pcprofile_symbols[mid];
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+
+    if (found == NULL)
+        return NULL;
+
+    if (pcprofile_region(found->address) != pcprofile_region(address))
+        return NULL;
+
+    return found;
+}
+
+// Start of the function or block that the address belongs to
+static u32 pcprofile_group_address(u32 address)
+{
+    const _pcprofile_symbol_t *sym = pcprofile_symbol_find(address);
+    if (sym != NULL)
+        return sym->address;
+
+    return address & ~(PCPROFILE_BLOCK_SIZE - 1);
+}
+
+//------------------------------------------------------------------------------
+
+void PCProfile_Start(_pcprofile_system_e system)
+{
+    pcprofile_table_free(&pcprofile_samples);
+    if (pcprofile_table_init(&pcprofile_samples, PCPROFILE_TABLE_MIN_BITS))
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+        return;
+    }
+
+    pcprofile_system = system;
+    pcprofile_total = 0;
+    pcprofile_enabled = 1;
+}
+
+void PCProfile_Stop(void)
+{
+    pcprofile_enabled = 0;
+}
+
+void PCProfile_End(void)
+{
+    PCProfile_Stop();
+    pcprofile_table_free(&pcprofile_samples);
+    pcprofile_total = 0;
+    pcprofile_symbols_free();
+}
+
+void PCProfile_Sample(u32 address, u32 count)
+{
+    if (pcprofile_table_add(&pcprofile_samples, address, count) != 0)
+        return;
+
+    pcprofile_total += count;
+}
+
+u64 PCProfile_GetTotalSamples(void)
+{
+    return pcprofile_total;
+}
+
+static int pcprofile_bucket_compare(const void *a, const void *b)
+{
+    const _pcprofile_bucket_t *bucket_a = a;
+    const _pcprofile_bucket_t *bucket_b = b;
+
+    if (bucket_a->samples > bucket_b->samples)
+        return -1;
+    if (bucket_a->samples < bucket_b->samples)
+        return 1;
+    if (bucket_a->address < bucket_b->address)
+        return -1;
+    if (bucket_a->address > bucket_b->address)
+        return 1;
+    return 0;
+}
+
+// Returns an allocated array with the used buckets, sorted by number of samples
+static _pcprofile_bucket_t *pcprofile_table_sorted(_pcprofile_table_t *t)
+{
+    _pcprofile_bucket_t *list = malloc((t->used + 1)
+                                       * sizeof(_pcprofile_bucket_t));
+    if (list == NULL)
+        return NULL;
+
+    u32 num = 0;
+    for (u32 i = 0; i < (1u << t->bits); i++)
+    {
+        if (t->buckets[i].samples != 0)
+            list[num++] = t->buckets[i];
+    }
+
+    qsort(list, num, sizeof(_pcprofile_bucket_t), pcprofile_bucket_compare);
+
+    return list;
+}
+
+// Adds the samples of all the addresses of each function. Returns 1 on error.
+static int pcprofile_groups_get(_pcprofile_table_t *groups)
+{
+    if (pcprofile_samples.buckets == NULL)
+        return 1;
+
+    if (pcprofile_table_init(groups, PCPROFILE_TABLE_MIN_BITS) != 0)
+        return 1;
+
+    for (u32 i = 0; i < (1u << pcprofile_samples.bits); i++)
+    {
+        _pcprofile_bucket_t *b = &pcprofile_samples.buckets[i];
+        if (b->samples == 0)
+            continue;
+
+        u32 group = pcprofile_group_address(b->address);
+        if (pcprofile_table_add(groups, group, b->samples) != 0)
+        {
+            pcprofile_table_free(groups);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void pcprofile_entry_fill(_pcprofile_entry_t *entry,
+                                 const _pcprofile_bucket_t *b)
+{
+    entry->address = b->address;
+    entry->samples = b->samples;
+
+    const _pcprofile_symbol_t *sym = pcprofile_symbol_find(b->address);
+    if ((sym != NULL) && (sym->address == b->address))
+        s_strncpy(entry->name, sym->name, sizeof(entry->name));
+    else
+        entry->name[0] = '\0';
+}
+
+int PCProfile_GetTop(_pcprofile_entry_t *entries, int max)
+{
+    _pcprofile_table_t groups;
+    if (pcprofile_groups_get(&groups) != 0)
+        return 0;
+
+    _pcprofile_bucket_t *list = pcprofile_table_sorted(&groups);
+    if (list == NULL)
+    {
+        pcprofile_table_free(&groups);
+        return 0;
+    }
+
+    int num = 0;
+    while ((num < max) && ((u32)num < groups.used))
+    {
+        pcprofile_entry_fill(&entries[num], &list[num]);
+        num++;
+    }
+
+    free(list);
+    pcprofile_table_free(&groups);
+
+    return num;
+}
+
+void PCProfile_AddressToString(u32 address, char *buffer, size_t size)
+{
+    if (pcprofile_system == PCPROFILE_GB)
+        snprintf(buffer, size, "%02X:%04X", address >> 16, address & 0xFFFF);
+    else
+        snprintf(buffer, size, "%08X", address);
+}
+
+static double pcprofile_percent(u32 samples)
+{
+    if (pcprofile_total == 0)
+        return 0.0;
+
+    return (100.0 * samples) / pcprofile_total;
+}
+
+static void pcprofile_export_write(FILE *f, _pcprofile_bucket_t *group_list,
+                                   u32 groups, _pcprofile_bucket_t *address_list)
+{
+    char address[16];
+    _pcprofile_entry_t entry;
+
+    fprintf(f, "Samples: %llu\n", pcprofile_total);
+    fprintf(f, "Symbols: %d\n", pcprofile_symbols_num);
+    fprintf(f, "\n");
+
+    fprintf(f, "Functions (blocks of %d bytes without symbols):\n\n",
+            PCPROFILE_BLOCK_SIZE);
+    for (u32 i = 0; i < groups; i++)
+    {
+        pcprofile_entry_fill(&entry, &group_list[i]);
+        PCProfile_AddressToString(entry.address, address, sizeof(address));
+
+        fprintf(f, "%10u %6.2f%%  %s  %s\n", entry.samples,
+                pcprofile_percent(entry.samples), address, entry.name);
+    }
+
+    fprintf(f, "\n");
+    fprintf(f, "Addresses:\n\n");
+    for (u32 i = 0; i < pcprofile_samples.used; i++)
+    {
+        if (i == PCPROFILE_EXPORT_ADDRESSES)
+            break;
+
+        _pcprofile_bucket_t *b = &address_list[i];
+        PCProfile_AddressToString(b->address, address, sizeof(address));
+
+        const _pcprofile_symbol_t *sym = pcprofile_symbol_find(b->address);
+
+        if (sym != NULL)
+        {
+            fprintf(f, "%10u %6.2f%%  %s  %s+0x%X\n", b->samples,
+                    pcprofile_percent(b->samples), address, sym->name,
+                    b->address - sym->address);
+        }
+        else
+        {
+            fprintf(f, "%10u %6.2f%%  %s\n", b->samples,
+                    pcprofile_percent(b->samples), address);
+        }
+    }
+}
+
+const char *PCProfile_Export(void)
+{
+    _pcprofile_table_t groups;
+    if (pcprofile_groups_get(&groups) != 0)
+        return NULL;
+
+    _pcprofile_bucket_t *group_list = pcprofile_table_sorted(&groups);
+    _pcprofile_bucket_t *address_list =
+            pcprofile_table_sorted(&pcprofile_samples);
+
+    char *path = NULL;
+
+    if ((group_list != NULL) && (address_list != NULL))
+    {
+        path = FU_GetNewTimestampFilenameExt("profile", "txt");
+
+        FILE *f = fopen(path, "w");
+        if (f != NULL)
+        {
+            pcprofile_export_write(f, group_list, groups.used, address_list);
+            fclose(f);
+        }
+        else
+        {
+            Debug_ErrorMsgArg("Couldn't create file: %s", path);
+            path = NULL;
+        }
+    }
+
+    free(group_list);
+    free(address_list);
+    pcprofile_table_free(&groups);
+
+    return path;
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef PCPROFILE_UTILS__
+#define PCPROFILE_UTILS__
+
+#include <stddef.h>
+
+#include "general_utils.h"
+
+// Sampling profiler of the emulated CPU. While it's active, the cores add a
+// sample with the address of the instruction being executed every few clocks.
+// The samples are grouped by the function they belong to, taken from a symbol
+// file with the same name as the ROM and the extension "sym". Each line of the
+// file has an address and a name, in any of these formats:
+//
+//     08000200 main       no$gba
+//     08000200 T main     nm
+//     01:4000 Main        rgbds (bank:address)
+//
+// Samples without a symbol are grouped in blocks of PCPROFILE_BLOCK_SIZE bytes.
+// While it's disabled, the GB core never schedules its event and the GBA core
+// only checks pcprofile_enabled after each slice of CPU execution.
+
+#define PCPROFILE_BLOCK_SIZE    (0x100)
+
+#define PCPROFILE_NAME_LENGTH   (64)
+
+typedef enum
+{
+    PCPROFILE_GBA,
+    PCPROFILE_GB, // Addresses are (bank << 16) | address
+} _pcprofile_system_e;
+
+extern core_local__ int pcprofile_enabled;
+
+// Clears the samples of the previous session
+void PCProfile_Start(_pcprofile_system_e system);
+void PCProfile_Stop(void);
+// Stops it and frees the samples and the symbols
+void PCProfile_End(void);
+
+// Adds count samples to the address. It's more than one if the CPU has run for
+// several periods since the last sample (while it is halted, for example).
+void PCProfile_Sample(u32 address, u32 count);
+
+// Loads the symbol file of the ROM, if there is one. Returns 0 if it has been
+// loaded, 1 if not.
+int PCProfile_SymbolsLoad(const char *rom_path);
+
+typedef struct
+{
+    u32 address;    // Start of the function or block
+    u32 samples;
+    char name[PCPROFILE_NAME_LENGTH]; // Empty for blocks without symbol
+} _pcprofile_entry_t;
+
+u64 PCProfile_GetTotalSamples(void);
+
+// Fills the array with the functions with the highest number of samples,
+// sorted. Returns the number of entries written.
+int PCProfile_GetTop(_pcprofile_entry_t *entries, int max);
+
+// Prints the address in the format of the system that has been profiled
+void PCProfile_AddressToString(u32 address, char *buffer, size_t size);
+
+// Saves a report with all the functions and the addresses with the highest
+// number of samples in the screenshots folder. Returns the path of the file,
+// or NULL on error.
+const char *PCProfile_Export(void);
+
+#endif // PCPROFILE_UTILS__
@@ -5,11 +5,40 @@
 // GiiBiiAdvance - GBA/GB emulator
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <png.h>
+#include <SDL.h>
 
+#include "build_options.h"
+#include "config.h"
 #include "debug_utils.h"
 #include "general_utils.h"
+#include "png_utils.h"
+
+// Number of images that can be waiting to be written
+#define PNG_QUEUE_SIZE  (4)
+
+typedef struct
+{
+    char path[MAX_PATHLEN];
+    int width;
+    int height;
+    int save_alpha;
+    u32 *data;
+    size_t capacity; // In pixels
+} _png_job_t;
+
+// All of this is protected by png_mutex, and png_cond is signaled when any of
+// it changes. The positions are free running.
+static _png_job_t png_queue[PNG_QUEUE_SIZE];
+static unsigned int png_queue_read;
+static unsigned int png_queue_write;
+static int png_exit;
+
+static SDL_mutex *png_mutex;
+static SDL_cond *png_cond;
+static SDL_Thread *png_thread;
 
 static void png_warn_fn_(unused__ png_structp sp, png_const_charp cp)
 {
@@ -61,6 +90,8 @@ int Save_PNG(const char *file_name, int width, int height, void *buffer,
 
     png_init_io(png_ptr, fp);
 
+    png_set_compression_level(png_ptr, EmulatorConfig.png_compression);
+
     png_bytep row_pointers[height];
 
     if (save_alpha)
@@ -71,20 +102,11 @@ int Save_PNG(const char *file_name, int width, int height, void *buffer,
 
         png_write_info(png_ptr, info_ptr);
 
+        // The buffer already has the layout of the rows of the image
         for (int k = 0; k < height; k++)
-            row_pointers[k] = malloc(width * 4); // TODO: Error checking
+            row_pointers[k] = (png_bytep)buffer + (k * width * 4);
 
-        unsigned char *buf = (unsigned char *)buffer;
-        for (int k = 0; k < height; k++)
-        {
-            for (int i = 0; i < width; i++)
-            {
-                row_pointers[k][(i * 4) + 0] = *buf++;
-                row_pointers[k][(i * 4) + 1] = *buf++;
-                row_pointers[k][(i * 4) + 2] = *buf++;
-                row_pointers[k][(i * 4) + 3] = *buf++;
-            }
-        }
+        png_write_image(png_ptr, row_pointers);
     }
     else
     {
@@ -94,31 +116,19 @@ int Save_PNG(const char *file_name, int width, int height, void *buffer,
 
         png_write_info(png_ptr, info_ptr);
 
-        for (int k = 0; k < height; k++)
-            row_pointers[k] = malloc(width * 3); // TODO: Error checking
+        // Let libpng drop the alpha channel
+        png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
 
-        unsigned char *buf = (unsigned char *)buffer;
         for (int k = 0; k < height; k++)
-        {
-            for (int i = 0; i < width; i++)
-            {
-                row_pointers[k][(i * 3) + 0] = *buf++;
-                row_pointers[k][(i * 3) + 1] = *buf++;
-                row_pointers[k][(i * 3) + 2] = *buf++;
-                buf++; // Ignore alpha
-            }
-        }
-    }
+            row_pointers[k] = (png_bytep)buffer + (k * width * 4);
 
-    png_write_image(png_ptr, row_pointers);
+        png_write_image(png_ptr, row_pointers);
+    }
 
     png_write_end(png_ptr, info_ptr);
 
     png_destroy_write_struct(&png_ptr, &info_ptr);
 
-    for (int k = 0; k < height; k++)
-        free(row_pointers[k]);
-
     fclose(fp);
 
     return 0;
@@ -281,3 +291,164 @@ int Read_PNG(const char *file_name, char **_buffer, int *_width, int *_height)
 
     return 0;
 }
+
+//------------------------------------------------------------------------------
+
+static int png_thread_fn(unused__ void *data)
+{
+    SDL_LockMutex(png_mutex);
+
+    while (1)
+    {
+        while ((png_queue_read == png_queue_write) && (png_exit == 0))
+            SDL_CondWait(png_cond, png_mutex);
+
+        if (png_queue_read == png_queue_write)
+            break; // Exit requested and nothing left to write
+
+        _png_job_t *job = &png_queue[png_queue_read % PNG_QUEUE_SIZE];
+
+        SDL_UnlockMutex(png_mutex);
+
+        Save_PNG(job->path, job->width, job->height, job->data,
+                 job->save_alpha);
+
+        SDL_LockMutex(png_mutex);
+
+        png_queue_read++;
+        SDL_CondBroadcast(png_cond);
+    }
+
+    SDL_UnlockMutex(png_mutex);
+
+    return 0;
+}
+
+void PNG_WriterInit(void)
+{
+    if (png_thread != NULL)
+        return;
+
+    png_mutex = SDL_CreateMutex();
+    png_cond = SDL_CreateCond();
+    if ((png_mutex == NULL) || (png_cond == NULL))
+    {
+        Debug_ErrorMsgArg("%s: %s", __func__, SDL_GetError());
+        return;
+    }
+
+    png_queue_read = 0;
+    png_queue_write = 0;
+    png_exit = 0;
+
+    png_thread = SDL_CreateThread(png_thread_fn, "PNG writer", NULL);
+    if (png_thread == NULL)
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+}
+
+void PNG_WriterEnd(void)
+{
+    if (png_thread != NULL)
+    {
+        SDL_LockMutex(png_mutex);
+        png_exit = 1;
+        SDL_CondBroadcast(png_cond);
+        SDL_UnlockMutex(png_mutex);
+
+        SDL_WaitThread(png_thread, NULL);
+        png_thread = NULL;
+    }
+
+    if (png_cond != NULL)
+    {
+        SDL_DestroyCond(png_cond);
+        png_cond = NULL;
+    }
+    if (png_mutex != NULL)
+    {
+        SDL_DestroyMutex(png_mutex);
+        png_mutex = NULL;
+    }
+
+    for (int i = 0; i < PNG_QUEUE_SIZE; i++)
+    {
+        free(png_queue[i].data);
+        memset(&png_queue[i], 0, sizeof(png_queue[i]));
+    }
+}
+
+void *PNG_SaveBegin(const char *path, int width, int height, int save_alpha)
+{
+    if ((width <= 0) || (height <= 0) || (strlen(path) >= MAX_PATHLEN))
+    {
+        Debug_ErrorMsgArg("%s: Invalid arguments.", __func__);
+        return NULL;
+    }
+
+    if (png_thread != NULL)
+    {
+        SDL_LockMutex(png_mutex);
+
+        // Only wait if the writer thread is too far behind
+        while ((png_queue_write - png_queue_read) >= PNG_QUEUE_SIZE)
+            SDL_CondWait(png_cond, png_mutex);
+
+        // The mutex stays locked until PNG_SaveCommit()
+    }
+
+    _png_job_t *job = &png_queue[png_queue_write % PNG_QUEUE_SIZE];
+
+    size_t pixels = (size_t)width * height;
+    if (pixels > job->capacity)
+    {
+        u32 *data = realloc(job->data, pixels * sizeof(u32));
+        if (data == NULL)
+        {
+            Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+            if (png_thread != NULL)
+                SDL_UnlockMutex(png_mutex);
+            return NULL;
+        }
+
+        job->data = data;
+        job->capacity = pixels;
+    }
+
+    s_strncpy(job->path, path, sizeof(job->path));
+    job->width = width;
+    job->height = height;
+    job->save_alpha = save_alpha;
+
+    return job->data;
+}
+
+void PNG_SaveCommit(void)
+{
+    if (png_thread == NULL)
+    {
+        _png_job_t *job = &png_queue[png_queue_write % PNG_QUEUE_SIZE];
+
+        Save_PNG(job->path, job->width, job->height, job->data,
+                 job->save_alpha);
+        return;
+    }
+
+    png_queue_write++;
+    SDL_CondBroadcast(png_cond);
+
+    SDL_UnlockMutex(png_mutex);
+}
+
+int Save_PNG_Async(const char *file_name, int width, int height,
+                   const void *buffer, int save_alpha)
+{
+    void *data = PNG_SaveBegin(file_name, width, height, save_alpha);
+    if (data == NULL)
+        return 1;
+
+    memcpy(data, buffer, (size_t)width * height * 4);
+
+    PNG_SaveCommit();
+
+    return 0;
+}
@@ -7,11 +7,31 @@
 #ifndef PNG_UTILS__
 #define PNG_UTILS__
 
-// Buffer is 32 bit, returns 1 if error, 0 if OK
+// Buffer is 32 bit, returns 1 if error, 0 if OK. The zlib compression level
+// is taken from the configuration.
 int Save_PNG(const char *file_name, int width, int height, void *buffer,
              int save_alpha);
 
 // Buffer is 32 bit
 int Read_PNG(const char *file_name, char **_buffer, int *_width, int *_height);
 
+// Images can also be encoded and written by a background thread, so that
+// taking screenshots doesn't make the emulation stutter. They are written in
+// the order they are queued. If the thread isn't running, they are written
+// right away.
+
+void PNG_WriterInit(void);
+void PNG_WriterEnd(void); // Writes the queued images and stops the thread
+
+// Returns a 32 bit buffer of width * height pixels that has to be filled with
+// the image, or NULL on error. PNG_SaveCommit() has to be called after filling
+// it to queue it. Nothing else can be queued in between. If the queue is full,
+// it waits until there is space.
+void *PNG_SaveBegin(const char *path, int width, int height, int save_alpha);
+void PNG_SaveCommit(void);
+
+// Copies the buffer and queues it. Returns 1 if error, 0 if OK.
+int Save_PNG_Async(const char *file_name, int width, int height,
+                   const void *buffer, int save_alpha);
+
 #endif // PNG_UTILS__
@@ -0,0 +1,611 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "debug_utils.h"
+#include "file_utils.h"
+#include "font_utils.h"
+#include "general_utils.h"
+#include "profile_utils.h"
+
+core_local__ int profile_enabled = 0;
+
+static core_local__ u64 profile_ticks[PROFILE_NUMBER];
+static core_local__ _profile_section_e profile_current;
+static core_local__ u64 profile_last_switch;
+
+static const char *profile_names[PROFILE_NUMBER] = {
+    [PROFILE_CPU] = "cpu",
+    [PROFILE_PPU] = "ppu",
+    [PROFILE_APU] = "apu",
+    [PROFILE_DMA] = "dma",
+    [PROFILE_TIMERS] = "timers",
+    [PROFILE_OTHER] = "other",
+    [PROFILE_CONVERT] = "convert",
+    [PROFILE_MIXING] = "mixing",
+    [PROFILE_PRESENT] = "present",
+    [PROFILE_EVENTS] = "events",
+};
+
+static const char *profile_slice_names[PROFILE_SLICE_NUMBER] = {
+    [PROFILE_SLICE_PPU] = "ppu",
+    [PROFILE_SLICE_TIMERS] = "tmr",
+    [PROFILE_SLICE_DMA] = "dma",
+    [PROFILE_SLICE_APU] = "apu",
+    [PROFILE_SLICE_SERIAL] = "sio",
+    [PROFILE_SLICE_IO] = "io",
+    [PROFILE_SLICE_IRQ] = "irq",
+    [PROFILE_SLICE_OTHER] = "oth",
+};
+
+// Slices of the current frame
+static core_local__ u32 profile_slices[PROFILE_SLICE_NUMBER];
+static core_local__ u32 profile_slice_clocks;
+
+// Value of the counters when the current frame started
+static core_local__ u64 profile_frame_start[PROFILE_NUMBER];
+
+// Time measured by the timers since the last frame ended
+static u64 profile_timer_ticks[PROFILE_NUMBER];
+static SDL_SpinLock profile_timer_lock;
+
+static core_local__ _profile_frame_t profile_history[PROFILE_HISTORY_FRAMES];
+static core_local__ int profile_history_next;
+static core_local__ int profile_history_count;
+
+_profile_section_e Profile_Switch(_profile_section_e section)
+{
+    u64 now = SDL_GetPerformanceCounter();
+
+    profile_ticks[profile_current] += now - profile_last_switch;
+    profile_last_switch = now;
+
+    _profile_section_e previous = profile_current;
+    profile_current = section;
+
+    return previous;
+}
+
+void Profile_SliceCount(_profile_slice_e reason, s32 clocks)
+{
+    profile_slices[reason]++;
+    profile_slice_clocks += clocks;
+}
+
+void Profile_Start(void)
+{
+    memset(profile_ticks, 0, sizeof(profile_ticks));
+    memset(profile_frame_start, 0, sizeof(profile_frame_start));
+    memset(profile_slices, 0, sizeof(profile_slices));
+    profile_slice_clocks = 0;
+
+    SDL_AtomicLock(&profile_timer_lock);
+    memset(profile_timer_ticks, 0, sizeof(profile_timer_ticks));
+    SDL_AtomicUnlock(&profile_timer_lock);
+
+    profile_history_next = 0;
+    profile_history_count = 0;
+
+    profile_current = PROFILE_CPU;
+    profile_last_switch = SDL_GetPerformanceCounter();
+    profile_enabled = 1;
+}
+
+void Profile_Stop(void)
+{
+    if (profile_enabled == 0)
+        return;
+
+    Profile_Switch(PROFILE_CPU);
+    profile_enabled = 0;
+}
+
+double Profile_GetSeconds(_profile_section_e section)
+{
+    return (double)profile_ticks[section]
+           / (double)SDL_GetPerformanceFrequency();
+}
+
+const char *Profile_GetName(_profile_section_e section)
+{
+    return profile_names[section];
+}
+
+u64 Profile_TimerBegin(void)
+{
+    if (profile_enabled == 0)
+        return 0;
+
+    return SDL_GetPerformanceCounter();
+}
+
+void Profile_TimerEnd(_profile_section_e section, u64 start)
+{
+    if (start == 0)
+        return;
+
+    u64 ticks = SDL_GetPerformanceCounter() - start;
+
+    SDL_AtomicLock(&profile_timer_lock);
+    profile_timer_ticks[section] += ticks;
+    SDL_AtomicUnlock(&profile_timer_lock);
+}
+
+void Profile_FrameBegin(void)
+{
+    if (profile_enabled == 0)
+        return;
+
+    // Whatever has happened since the previous frame isn't part of this one
+    profile_current = PROFILE_CPU;
+    profile_last_switch = SDL_GetPerformanceCounter();
+
+    memcpy(profile_frame_start, profile_ticks, sizeof(profile_ticks));
+
+    memset(profile_slices, 0, sizeof(profile_slices));
+    profile_slice_clocks = 0;
+}
+
+void Profile_FrameEnd(void)
+{
+    if (profile_enabled == 0)
+        return;
+
+    Profile_Switch(PROFILE_CPU);
+
+    u64 timer_ticks[PROFILE_NUMBER];
+
+    SDL_AtomicLock(&profile_timer_lock);
+    memcpy(timer_ticks, profile_timer_ticks, sizeof(timer_ticks));
+    memset(profile_timer_ticks, 0, sizeof(profile_timer_ticks));
+    SDL_AtomicUnlock(&profile_timer_lock);
+
+    double ms_per_tick = 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+    _profile_frame_t *frame = &profile_history[profile_history_next];
+
+    for (int i = 0; i < PROFILE_NUMBER; i++)
+    {
+        profile_ticks[i] += timer_ticks[i];
+
+        u64 ticks = profile_ticks[i] - profile_frame_start[i];
+        frame->ms[i] = (float)(ticks * ms_per_tick);
+    }
+
+    memcpy(frame->slices, profile_slices, sizeof(profile_slices));
+    frame->slice_clocks = profile_slice_clocks;
+
+    profile_history_next = (profile_history_next + 1) % PROFILE_HISTORY_FRAMES;
+    if (profile_history_count < PROFILE_HISTORY_FRAMES)
+        profile_history_count++;
+}
+
+int Profile_GetFrameCount(void)
+{
+    return profile_history_count;
+}
+
+const _profile_frame_t *Profile_GetFrame(int age)
+{
+    int index = profile_history_next - 1 - age;
+    if (index < 0)
+        index += PROFILE_HISTORY_FRAMES;
+
+    return &profile_history[index];
+}
+
+u32 Profile_FrameSlices(const _profile_frame_t *frame)
+{
+    u32 slices = 0;
+    for (int i = 0; i < PROFILE_SLICE_NUMBER; i++)
+        slices += frame->slices[i];
+    return slices;
+}
+
+//------------------------------------------------------------------------------
+
+// The numbers are the average of the last frames
+#define PROFILE_OVERLAY_AVERAGE_FRAMES  (30)
+
+// The graph is as tall as a frame at 60 FPS
+#define PROFILE_GRAPH_HEIGHT    (32)
+#define PROFILE_GRAPH_MS        (1000.0f / 60.0f)
+
+// Characters of each entry of the list, two entries per line
+#define PROFILE_ENTRY_CHARS     (11)
+
+// Characters of each entry of the list of slices, three entries per line
+#define PROFILE_SLICE_ENTRY_CHARS   (7)
+#define PROFILE_SLICE_ENTRIES       (3)
+
+static const u32 profile_colors[PROFILE_NUMBER + 1] = { // 0xRRGGBB
+    [PROFILE_CPU] = 0xFF8080,
+    [PROFILE_PPU] = 0x80FF80,
+    [PROFILE_APU] = 0x8080FF,
+    [PROFILE_DMA] = 0xFFFF80,
+    [PROFILE_TIMERS] = 0xFF80FF,
+    [PROFILE_OTHER] = 0x80FFFF,
+    [PROFILE_CONVERT] = 0xFFC080,
+    [PROFILE_MIXING] = 0xC0A0FF,
+    [PROFILE_PRESENT] = 0xC0C0C0,
+    [PROFILE_EVENTS] = 0xA0FFC0,
+    [PROFILE_NUMBER] = 0xFFFFFF, // Total
+};
+
+// Color of the slices that end because of each reason
+static const u32 profile_slice_colors[PROFILE_SLICE_NUMBER + 1] = {
+    [PROFILE_SLICE_PPU] = 0x80FF80,
+    [PROFILE_SLICE_TIMERS] = 0xFF80FF,
+    [PROFILE_SLICE_DMA] = 0xFFFF80,
+    [PROFILE_SLICE_APU] = 0x8080FF,
+    [PROFILE_SLICE_SERIAL] = 0xFFFFFF,
+    [PROFILE_SLICE_IO] = 0xFFFFFF,
+    [PROFILE_SLICE_IRQ] = 0xFFFFFF,
+    [PROFILE_SLICE_OTHER] = 0xFFFFFF,
+    [PROFILE_SLICE_NUMBER] = 0xFFFFFF, // Average length of the slices
+};
+
+// One line of text of the overlay, it's printed here and copied to the frame
+static char profile_overlay_line[256 * FONT_HEIGHT * 3];
+
+static int profile_overlay_line_width(int width)
+{
+    if (width > 256)
+        return 256;
+    return width;
+}
+
+static void profile_overlay_print(int line_width, int column, u32 c,
+                                  const char *text)
+{
+    // The font is black on white, it's tinted with the color of the section.
+    // FU_PrintColor() takes the color as 0xBBGGRR.
+    int color = ((c & 0xFF) << 16) | (c & 0xFF00) | ((c >> 16) & 0xFF);
+
+    FU_PrintColor(profile_overlay_line, line_width, FONT_HEIGHT,
+                  column * FONT_WIDTH, 0, color, "%s", text);
+}
+
+static void profile_overlay_copy_line(u32 *buffer, int width, int y, int chars)
+{
+    int line_width = profile_overlay_line_width(width);
+
+    int w = chars * FONT_WIDTH;
+    if (w > line_width)
+        w = line_width;
+
+    for (int j = 0; j < FONT_HEIGHT; j++)
+    {
+        const u8 *src = (const u8 *)&profile_overlay_line[j * line_width * 3];
+        u32 *dst = &buffer[(y + j) * width];
+
+        for (int i = 0; i < w; i++)
+        {
+            dst[i] = 0xFF000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+            src += 3;
+        }
+    }
+}
+
+static void profile_overlay_print_line(u32 *buffer, int width, int y,
+                                       const float *ms, int first, int num,
+                                       u32 slices)
+{
+    int line_width = profile_overlay_line_width(width);
+    char text[32];
+
+    for (int i = 0; i < num; i++)
+    {
+        int entry = first + i;
+        const char *name = (entry == PROFILE_NUMBER) ?
+                           "total" : profile_names[entry];
+
+        snprintf(text, sizeof(text), "%-7s%4.1f", name, ms[entry]);
+        profile_overlay_print(line_width, i * PROFILE_ENTRY_CHARS,
+                              profile_colors[entry], text);
+    }
+
+    // If the line of the total has room, it shows the number of slices
+    if (num < 2)
+    {
+        snprintf(text, sizeof(text), "%-7s%4u", "slices", (unsigned int)slices);
+        profile_overlay_print(line_width, PROFILE_ENTRY_CHARS, 0xFFFFFF, text);
+        num++;
+    }
+
+    profile_overlay_copy_line(buffer, width, y, num * PROFILE_ENTRY_CHARS);
+}
+
+// The last entry is the average length of the slices in clocks
+static void profile_overlay_print_slices(u32 *buffer, int width, int y,
+                                         const u32 *slices, int first)
+{
+    int line_width = profile_overlay_line_width(width);
+    char text[32];
+
+    int num = PROFILE_SLICE_ENTRIES;
+    if ((first + num) > (PROFILE_SLICE_NUMBER + 1))
+        num = PROFILE_SLICE_NUMBER + 1 - first;
+
+    for (int i = 0; i < num; i++)
+    {
+        int entry = first + i;
+        const char *name = (entry == PROFILE_SLICE_NUMBER) ?
+                           "clk" : profile_slice_names[entry];
+
+        snprintf(text, sizeof(text), "%-3s%4u", name,
+                 (unsigned int)slices[entry]);
+        profile_overlay_print(line_width, i * PROFILE_SLICE_ENTRY_CHARS,
+                              profile_slice_colors[entry], text);
+    }
+
+    profile_overlay_copy_line(buffer, width, y,
+                              num * PROFILE_SLICE_ENTRY_CHARS);
+}
+
+static void profile_overlay_draw_graph(u32 *buffer, int width, int height)
+{
+    int top = height - PROFILE_GRAPH_HEIGHT;
+    if (top < 0)
+        return;
+
+    float scale = PROFILE_GRAPH_HEIGHT / PROFILE_GRAPH_MS;
+
+    for (int x = 0; x < width; x++)
+    {
+        // Darken the background so that the graph can be seen
+        for (int y = top; y < height; y++)
+        {
+            u32 *p = &buffer[y * width + x];
+            *p = 0xFF000000 | ((*p >> 1) & 0x7F7F7F);
+        }
+
+        int age = width - 1 - x;
+        if (age >= profile_history_count)
+            continue;
+
+        const _profile_frame_t *frame = Profile_GetFrame(age);
+
+        float sum = 0.0f;
+        for (int i = 0; i < PROFILE_NUMBER; i++)
+        {
+            int start = (int)(sum * scale);
+            sum += frame->ms[i];
+            int end = (int)(sum * scale);
+
+            if (end > PROFILE_GRAPH_HEIGHT)
+                end = PROFILE_GRAPH_HEIGHT;
+
+            for (int y = start; y < end; y++)
+            {
+                buffer[(height - 1 - y) * width + x] =
+                        0xFF000000 | profile_colors[i];
+            }
+        }
+    }
+}
+
+void Profile_OverlayDraw(void *buffer, int width, int height)
+{
+    u32 *frame_buffer = buffer;
+
+    // The last entry is the total of the frame
+    float ms[PROFILE_NUMBER + 1] = { 0 };
+
+    int frames = profile_history_count;
+    if (frames > PROFILE_OVERLAY_AVERAGE_FRAMES)
+        frames = PROFILE_OVERLAY_AVERAGE_FRAMES;
+
+    for (int j = 0; j < frames; j++)
+    {
+        const _profile_frame_t *frame = Profile_GetFrame(j);
+        for (int i = 0; i < PROFILE_NUMBER; i++)
+        {
+            ms[i] += frame->ms[i] / frames;
+            ms[PROFILE_NUMBER] += frame->ms[i] / frames;
+        }
+    }
+
+    // Slices per frame for each reason. The last entry is the average length
+    // of the slices.
+    u64 slice_sum[PROFILE_SLICE_NUMBER + 1] = { 0 };
+    u64 slice_total = 0;
+
+    for (int j = 0; j < frames; j++)
+    {
+        const _profile_frame_t *frame = Profile_GetFrame(j);
+        for (int i = 0; i < PROFILE_SLICE_NUMBER; i++)
+            slice_sum[i] += frame->slices[i];
+        slice_sum[PROFILE_SLICE_NUMBER] += frame->slice_clocks;
+        slice_total += Profile_FrameSlices(frame);
+    }
+
+    u32 slices[PROFILE_SLICE_NUMBER + 1] = { 0 };
+    u32 slices_per_frame = 0;
+
+    if (frames > 0)
+    {
+        for (int i = 0; i < PROFILE_SLICE_NUMBER; i++)
+            slices[i] = (slice_sum[i] + (frames / 2)) / frames;
+        slices_per_frame = (slice_total + (frames / 2)) / frames;
+    }
+    if (slice_total > 0)
+        slices[PROFILE_SLICE_NUMBER] = slice_sum[PROFILE_SLICE_NUMBER]
+                                       / slice_total;
+
+    int y = 0;
+    for (int i = 0; i < PROFILE_NUMBER + 1; i += 2)
+    {
+        if ((y + FONT_HEIGHT) > (height - PROFILE_GRAPH_HEIGHT))
+            break;
+
+        int num = (i == PROFILE_NUMBER) ? 1 : 2;
+        profile_overlay_print_line(frame_buffer, width, y, ms, i, num,
+                                   slices_per_frame);
+        y += FONT_HEIGHT;
+    }
+
+    for (int i = 0; i < PROFILE_SLICE_NUMBER + 1; i += PROFILE_SLICE_ENTRIES)
+    {
+        if ((y + FONT_HEIGHT) > (height - PROFILE_GRAPH_HEIGHT))
+            break;
+
+        profile_overlay_print_slices(frame_buffer, width, y, slices, i);
+        y += FONT_HEIGHT;
+    }
+
+    profile_overlay_draw_graph(frame_buffer, width, height);
+}
+
+// Draws the histogram of the fill level of the audio buffer in the space of the
+// graph of the frames.
+static void profile_overlay_draw_fill(u32 *buffer, int width, int height,
+                                      const _resample_stats_t *stats)
+{
+    int top = height - PROFILE_GRAPH_HEIGHT;
+    if (top < 0)
+        return;
+
+    u32 max = 0;
+    for (int i = 0; i < RESAMPLE_FILL_BUCKETS; i++)
+    {
+        if (stats->fill[i] > max)
+            max = stats->fill[i];
+    }
+
+    // Bucket that the ring is filled up to right now
+    u32 current = (stats->fill_frames * RESAMPLE_FILL_BUCKETS)
+                  / RESAMPLE_BUFFER_FRAMES;
+
+    for (int x = 0; x < width; x++)
+    {
+        for (int y = top; y < height; y++)
+        {
+            u32 *p = &buffer[y * width + x];
+            *p = 0xFF000000 | ((*p >> 1) & 0x7F7F7F);
+        }
+
+        u32 bucket = (x * RESAMPLE_FILL_BUCKETS) / width;
+        if (max == 0)
+            continue;
+
+        int h = ((u64)stats->fill[bucket] * PROFILE_GRAPH_HEIGHT) / max;
+        u32 color = (bucket == current) ? 0xFFFF80 : 0x80FF80;
+
+        for (int y = 0; y < h; y++)
+            buffer[(height - 1 - y) * width + x] = 0xFF000000 | color;
+    }
+}
+
+void Profile_OverlayDrawAudio(void *buffer, int width, int height,
+                              const _resample_stats_t *stats)
+{
+    u32 *frame_buffer = buffer;
+    int line_width = profile_overlay_line_width(width);
+
+    const struct
+    {
+        const char *name;
+        s64 value;
+        int is_signed;
+        int is_error;
+    } entries[] = {
+        { "under", stats->underruns, 0, 1 },
+        { "over", stats->overruns, 0, 1 },
+        { "repeat", stats->underrun_frames, 0, 1 },
+        { "drop", stats->overrun_frames, 0, 1 },
+        { "ratio", stats->ratio_ppm, 1, 0 },
+        { "fill", stats->fill_frames, 0, 0 },
+        { "min", stats->ratio_ppm_min, 1, 0 },
+        { "max", stats->ratio_ppm_max, 1, 0 },
+    };
+
+    int num = sizeof(entries) / sizeof(entries[0]);
+
+    int y = 0;
+    for (int i = 0; i < num; i += 2)
+    {
+        if ((y + FONT_HEIGHT) > (height - PROFILE_GRAPH_HEIGHT))
+            break;
+
+        for (int j = 0; j < 2; j++)
+        {
+            char text[32];
+            const char *fmt = entries[i + j].is_signed ? "%-6s%+5d" : "%-6s%5d";
+            snprintf(text, sizeof(text), fmt, entries[i + j].name,
+                     (int)entries[i + j].value);
+
+            // Underruns and overruns are highlighted once they happen
+            u32 color = 0xFFFFFF;
+            if (entries[i + j].is_error && (entries[i + j].value > 0))
+                color = 0xFF8080;
+
+            profile_overlay_print(line_width, j * PROFILE_ENTRY_CHARS, color,
+                                  text);
+        }
+
+        profile_overlay_copy_line(frame_buffer, width, y,
+                                  2 * PROFILE_ENTRY_CHARS);
+        y += FONT_HEIGHT;
+    }
+
+    profile_overlay_draw_fill(frame_buffer, width, height, stats);
+}
+
+const char *Profile_ExportCSV(void)
+{
+    if (profile_history_count == 0)
+        return NULL;
+
+    char *path = FU_GetNewTimestampFilenameExt("profile", "csv");
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create file: %s", path);
+        return NULL;
+    }
+
+    fprintf(f, "frame");
+    for (int i = 0; i < PROFILE_NUMBER; i++)
+        fprintf(f, ",%s", profile_names[i]);
+    fprintf(f, ",total,slices,slice_clocks");
+    for (int i = 0; i < PROFILE_SLICE_NUMBER; i++)
+        fprintf(f, ",slices_%s", profile_slice_names[i]);
+    fprintf(f, "\n");
+
+    // From the oldest frame to the newest one, times in milliseconds. The
+    // slices are counted per frame.
+    for (int j = 0; j < profile_history_count; j++)
+    {
+        const _profile_frame_t *frame =
+                Profile_GetFrame(profile_history_count - 1 - j);
+
+        float total = 0.0f;
+
+        fprintf(f, "%d", j);
+        for (int i = 0; i < PROFILE_NUMBER; i++)
+        {
+            fprintf(f, ",%.3f", frame->ms[i]);
+            total += frame->ms[i];
+        }
+        fprintf(f, ",%.3f", total);
+
+        fprintf(f, ",%u,%u", (unsigned int)Profile_FrameSlices(frame),
+                (unsigned int)frame->slice_clocks);
+        for (int i = 0; i < PROFILE_SLICE_NUMBER; i++)
+            fprintf(f, ",%u", (unsigned int)frame->slices[i]);
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+
+    return path;
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef PROFILE_UTILS__
+#define PROFILE_UTILS__
+
+#include "general_utils.h"
+#include "resample_utils.h"
+
+// Measures how much time the emulation spends in each subsystem. The cores
+// mark the places where they start updating a subsystem, and everything that
+// isn't marked counts as CPU time. It is only active while benchmarking, the
+// rest of the time each mark is just a check of a global variable.
+//
+// The frontend can also enable it to display an overlay with the time spent in
+// each section in the last frames. Only the time between Profile_FrameBegin()
+// and Profile_FrameEnd() is taken into account for the emulation sections.
+// The sections of the frontend that can run in other threads (sound mixing,
+// presenting the frame and handling events) are measured with timers instead,
+// which are added to the next frame that ends.
+//
+// The cores also count the slices of CPU execution of each frame, and the
+// reason why each one of them ended: the next event of a subsystem was reached,
+// or the CPU loop was stopped early to let a subsystem handle a write to one of
+// its registers. Games that run in very short slices are slow to emulate.
+
+typedef enum
+{
+    PROFILE_CPU,
+    PROFILE_PPU,
+    PROFILE_APU,
+    PROFILE_DMA,
+    PROFILE_TIMERS,
+    PROFILE_OTHER,
+
+    PROFILE_CONVERT, // Conversion of the emulated screen to the texture
+    PROFILE_MIXING, // Timers
+    PROFILE_PRESENT, // Timers
+    PROFILE_EVENTS, // Timers
+
+    PROFILE_NUMBER
+} _profile_section_e;
+
+// Reason of the end of a slice of CPU execution
+typedef enum
+{
+    PROFILE_SLICE_PPU,
+    PROFILE_SLICE_TIMERS,
+    PROFILE_SLICE_DMA,
+    PROFILE_SLICE_APU,
+    PROFILE_SLICE_SERIAL,
+    PROFILE_SLICE_IO, // Writes to registers not handled by other subsystems
+    PROFILE_SLICE_IRQ,
+    PROFILE_SLICE_OTHER, // End of the frame, debugger, BIOS, errors...
+
+    PROFILE_SLICE_NUMBER
+} _profile_slice_e;
+
+extern core_local__ int profile_enabled;
+
+_profile_section_e Profile_Switch(_profile_section_e section);
+
+// Returns the section that was active before, it must be passed to
+// Profile_End() to return to it.
+static inline _profile_section_e Profile_Begin(_profile_section_e section)
+{
+    if (profile_enabled == 0)
+        return section;
+
+    return Profile_Switch(section);
+}
+
+static inline void Profile_End(_profile_section_e previous)
+{
+    if (profile_enabled)
+        Profile_Switch(previous);
+}
+
+void Profile_SliceCount(_profile_slice_e reason, s32 clocks);
+
+// Called by the cores after each slice of CPU execution
+static inline void Profile_SliceEnd(_profile_slice_e reason, s32 clocks)
+{
+    if (profile_enabled)
+        Profile_SliceCount(reason, clocks);
+}
+
+// Clears the counters and starts measuring in the CPU section
+void Profile_Start(void);
+void Profile_Stop(void);
+
+double Profile_GetSeconds(_profile_section_e section);
+const char *Profile_GetName(_profile_section_e section);
+
+// Timers can be used from any thread. Profile_TimerBegin() returns the start
+// time, that has to be passed to Profile_TimerEnd().
+u64 Profile_TimerBegin(void);
+void Profile_TimerEnd(_profile_section_e section, u64 start);
+
+// They have to be called by the thread that runs the emulation
+void Profile_FrameBegin(void);
+void Profile_FrameEnd(void);
+
+// Number of frames kept in the history
+#define PROFILE_HISTORY_FRAMES  (256)
+
+typedef struct
+{
+    float ms[PROFILE_NUMBER];
+    u32 slices[PROFILE_SLICE_NUMBER]; // Slices that ended for each reason
+    u32 slice_clocks; // Clocks executed in all the slices
+} _profile_frame_t;
+
+// Returns the number of frames in the history. Frame 0 is the newest one.
+int Profile_GetFrameCount(void);
+const _profile_frame_t *Profile_GetFrame(int age);
+
+// Total number of slices of a frame
+u32 Profile_FrameSlices(const _profile_frame_t *frame);
+
+// Draws the time spent in each section, the slices of CPU execution and a graph
+// of the last frames on top of a ARGB8888 frame.
+void Profile_OverlayDraw(void *buffer, int width, int height);
+
+// Draws the health of the audio buffer instead: underruns, overruns, correction
+// of the resampling ratio (in parts per million) and a histogram of the fill
+// level of the buffer. It doesn't need the profiler to be enabled.
+void Profile_OverlayDrawAudio(void *buffer, int width, int height,
+                              const _resample_stats_t *stats);
+
+// Saves the history as a CSV file in the screenshots folder. Returns the path
+// of the file, or NULL on error.
+const char *Profile_ExportCSV(void);
+
+#endif // PROFILE_UTILS__
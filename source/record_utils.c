@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "debug_utils.h"
+#include "flac_utils.h"
+#include "general_utils.h"
+#include "record_utils.h"
+
+// About 5 seconds at 48 kHz. Must be a power of two.
+#define RECORD_BUFFER_FRAMES    (256 * 1024)
+
+// The writer thread wakes up at least this often (in ms)
+#define RECORD_WAKEUP_PERIOD    (100)
+
+static s16 record_buffer[RECORD_BUFFER_FRAMES * 2];
+static SDL_atomic_t record_write_pos; // Frames, free running
+static SDL_atomic_t record_read_pos;
+static SDL_atomic_t record_dropped_frames;
+
+static SDL_atomic_t record_active;
+static SDL_atomic_t record_exit;
+static SDL_sem *record_sem;
+static SDL_Thread *record_thread;
+
+static FILE *record_file;
+static _record_format_e record_format;
+static u32 record_sample_rate;
+static u64 record_frames_saved;
+
+static _flac_encoder_t record_flac;
+
+//------------------------------------------------------------------------------
+
+static void record_put_u16(u8 *p, u32 value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static void record_put_u32(u8 *p, u32 value)
+{
+    record_put_u16(p, value & 0xFFFF);
+    record_put_u16(p + 2, value >> 16);
+}
+
+// https://ccrma.stanford.edu/courses/422/projects/WaveFormat/
+int Record_WavHeaderWrite(FILE *f, u32 sample_rate, u64 frames)
+{
+    u32 data_size = frames * 4;
+
+    u8 header[44];
+    memcpy(&header[0], "RIFF", 4);
+    record_put_u32(&header[4], 36 + data_size); // File size - 8
+    memcpy(&header[8], "WAVE", 4);
+
+    memcpy(&header[12], "fmt ", 4);
+    record_put_u32(&header[16], 16); // 16 = PCM
+    record_put_u16(&header[20], 1); // 1 = PCM
+    record_put_u16(&header[22], 2); // Channels
+    record_put_u32(&header[24], sample_rate);
+    record_put_u32(&header[28], sample_rate * 4); // Byte rate
+    record_put_u16(&header[32], 4); // Block align = channels * bytes
+    record_put_u16(&header[34], 16); // Bits per sample
+
+    memcpy(&header[36], "data", 4);
+    record_put_u32(&header[40], data_size);
+
+    if (fseek(f, 0, SEEK_SET) != 0)
+        return 1;
+
+    if (fwrite(header, sizeof(header), 1, f) != 1)
+        return 1;
+
+    fseek(f, 0, SEEK_END);
+
+    return 0;
+}
+
+static int record_wav_header_write(void)
+{
+    return Record_WavHeaderWrite(record_file, record_sample_rate,
+                                 record_frames_saved);
+}
+
+static void record_save(const s16 *samples, u32 frames)
+{
+    if (record_format == RECORD_FORMAT_FLAC)
+    {
+        FLAC_EncoderWrite(&record_flac, samples, frames);
+    }
+    else
+    {
+        // Samples are little endian in all supported platforms
+        if (fwrite(samples, 4, frames, record_file) != frames)
+            Debug_LogMsgArg("%s: Couldn't write to file", __func__);
+    }
+
+    record_frames_saved += frames;
+}
+
+// Saves everything that is in the ring buffer
+static void record_flush(void)
+{
+    u32 read = SDL_AtomicGet(&record_read_pos);
+    u32 write = SDL_AtomicGet(&record_write_pos);
+
+    while (read != write)
+    {
+        u32 start = read & (RECORD_BUFFER_FRAMES - 1);
+        u32 frames = write - read;
+        if (frames > RECORD_BUFFER_FRAMES - start)
+            frames = RECORD_BUFFER_FRAMES - start;
+
+        record_save(&record_buffer[start * 2], frames);
+
+        read += frames;
+        SDL_AtomicSet(&record_read_pos, read);
+    }
+}
+
+static int record_thread_fn(unused__ void *data)
+{
+    while (1)
+    {
+        SDL_SemWaitTimeout(record_sem, RECORD_WAKEUP_PERIOD);
+
+        int exit = SDL_AtomicGet(&record_exit);
+
+        record_flush();
+
+        if (exit)
+            break;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+int Record_Start(const char *path, _record_format_e format, u32 sample_rate)
+{
+    if (Record_IsActive())
+        Record_Stop();
+
+    record_file = fopen(path, "wb");
+    if (record_file == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't open file for writing: %s", path);
+        return 1;
+    }
+
+    record_format = format;
+    record_sample_rate = sample_rate;
+    record_frames_saved = 0;
+
+    int ret;
+    if (format == RECORD_FORMAT_FLAC)
+        ret = FLAC_EncoderStart(&record_flac, record_file, sample_rate);
+    else
+        ret = record_wav_header_write(); // Rewritten at the end
+
+    if (ret != 0)
+    {
+        Debug_ErrorMsgArg("Couldn't write to file: %s", path);
+        fclose(record_file);
+        record_file = NULL;
+        return 1;
+    }
+
+    SDL_AtomicSet(&record_write_pos, 0);
+    SDL_AtomicSet(&record_read_pos, 0);
+    SDL_AtomicSet(&record_dropped_frames, 0);
+    SDL_AtomicSet(&record_exit, 0);
+
+    if (record_sem == NULL)
+        record_sem = SDL_CreateSemaphore(0);
+
+    record_thread = SDL_CreateThread(record_thread_fn, "Audio recording",
+                                     NULL);
+    if (record_thread == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        fclose(record_file);
+        record_file = NULL;
+        return 1;
+    }
+
+    // Make sure that the audio callback is not running while this changes
+    SDL_LockAudio();
+    SDL_AtomicSet(&record_active, 1);
+    SDL_UnlockAudio();
+
+    return 0;
+}
+
+void Record_Stop(void)
+{
+    if (!Record_IsActive())
+        return;
+
+    SDL_LockAudio();
+    SDL_AtomicSet(&record_active, 0);
+    SDL_UnlockAudio();
+
+    SDL_AtomicSet(&record_exit, 1);
+    SDL_SemPost(record_sem);
+    SDL_WaitThread(record_thread, NULL);
+    record_thread = NULL;
+
+    int ret;
+    if (record_format == RECORD_FORMAT_FLAC)
+        ret = FLAC_EncoderEnd(&record_flac);
+    else
+        ret = record_wav_header_write();
+
+    if (ret != 0)
+        Debug_ErrorMsg("Couldn't finish writing the audio recording.");
+
+    fclose(record_file);
+    record_file = NULL;
+
+    u32 dropped = SDL_AtomicGet(&record_dropped_frames);
+    if (dropped > 0)
+    {
+        Debug_LogMsgArg("Audio recording: %u samples were dropped.",
+                        dropped);
+    }
+}
+
+int Record_IsActive(void)
+{
+    return SDL_AtomicGet(&record_active);
+}
+
+void Record_Write(const s16 *samples, u32 frames)
+{
+    if (!Record_IsActive())
+        return;
+
+    u32 write = SDL_AtomicGet(&record_write_pos);
+    u32 read = SDL_AtomicGet(&record_read_pos);
+
+    u32 space = RECORD_BUFFER_FRAMES - (write - read);
+    if (frames > space)
+    {
+        SDL_AtomicAdd(&record_dropped_frames, frames - space);
+        frames = space;
+    }
+
+    while (frames > 0)
+    {
+        u32 start = write & (RECORD_BUFFER_FRAMES - 1);
+        u32 count = RECORD_BUFFER_FRAMES - start;
+        if (count > frames)
+            count = frames;
+
+        memcpy(&record_buffer[start * 2], samples, count * 4);
+
+        samples += count * 2;
+        frames -= count;
+        write += count;
+    }
+
+    SDL_AtomicSet(&record_write_pos, write);
+
+    // Wake up the writer when there is a good amount of data
+    if ((write - read) >= (RECORD_BUFFER_FRAMES / 8))
+        SDL_SemPost(record_sem);
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef RECORD_UTILS__
+#define RECORD_UTILS__
+
+#include <stdio.h>
+
+#include "general_utils.h"
+
+// Recording of the 16 bit stereo audio sent to the output device. The audio
+// thread only copies the samples to a big ring buffer, a dedicated thread
+// takes them from there and writes them to the file.
+
+typedef enum
+{
+    RECORD_FORMAT_WAV,
+    RECORD_FORMAT_FLAC,
+} _record_format_e;
+
+// Returns 1 on error, 0 if OK
+int Record_Start(const char *path, _record_format_e format, u32 sample_rate);
+void Record_Stop(void);
+
+int Record_IsActive(void);
+
+// Called from the audio thread. It never blocks: if the writer thread can't
+// keep up, the samples that don't fit in the buffer are dropped.
+void Record_Write(const s16 *samples, u32 frames);
+
+// Writes the header of a 16 bit stereo WAV file at the start of the file, then
+// it moves to the end. The data follows the header. Returns 1 on error.
+int Record_WavHeaderWrite(FILE *f, u32 sample_rate, u64 frames);
+
+#endif // RECORD_UTILS__
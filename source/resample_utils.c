@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <string.h>
+
+#include "general_utils.h"
+#include "hash_utils.h"
+#include "resample_utils.h"
+
+// Dynamic rate control: the ratio can be changed up to 0.5% to move the amount
+// of buffered input towards the target. That is small enough that the change
+// of pitch can't be heard.
+#define RESAMPLE_MAX_RATIO_DELTA    (0.005)
+
+// Buffered input targeted on top of the input needed by each callback, in
+// 1/n of a second. The emulator generates the samples of a whole frame at
+// once, so there must be enough data to cover one frame.
+#define RESAMPLE_TARGET_DIVIDER     (60)
+
+static u32 resample_output_rate = 48000;
+
+static Resample_TapPointer *resample_tap;
+
+void Resample_SetTap(Resample_TapPointer *fn)
+{
+    resample_tap = fn;
+}
+
+void Resample_SetOutputRate(u32 rate)
+{
+    if (rate > 0)
+        resample_output_rate = rate;
+}
+
+u32 Resample_GetOutputRate(void)
+{
+    return resample_output_rate;
+}
+
+void Resample_Reset(_resample_stream_t *stream, u32 input_rate)
+{
+    memset(stream->buffer, 0, sizeof(stream->buffer));
+    atomic_init(&stream->write_pos, 0);
+    stream->batch_frames = 0;
+    stream->hash = 0;
+    stream->batch_hashed = 0;
+    atomic_init(&stream->read_pos, 0);
+    stream->read_frac = 0;
+    stream->input_rate = input_rate;
+    stream->last_left = 0;
+    stream->last_right = 0;
+
+    atomic_init(&stream->overruns, 0);
+    atomic_init(&stream->overrun_frames, 0);
+    atomic_init(&stream->reads, 0);
+    atomic_init(&stream->fill_frames, 0);
+    atomic_init(&stream->underruns, 0);
+    atomic_init(&stream->underrun_frames, 0);
+    atomic_init(&stream->ratio_ppm, 0);
+    atomic_init(&stream->ratio_ppm_min, 0);
+    atomic_init(&stream->ratio_ppm_max, 0);
+    for (int i = 0; i < RESAMPLE_FILL_BUCKETS; i++)
+        atomic_init(&stream->fill[i], 0);
+}
+
+// Only the owner of a counter modifies it, so it doesn't need a read-modify-
+// write operation.
+static inline void Resample_CounterAdd(atomic_uint *counter, u32 value)
+{
+    u32 old = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, old + value, memory_order_relaxed);
+}
+
+void Resample_Flush(_resample_stream_t *stream)
+{
+    u32 frames = stream->batch_frames;
+    if (frames == 0)
+        return;
+
+    stream->batch_frames = 0;
+
+    if (resample_tap)
+        resample_tap(stream->batch, frames, stream->input_rate);
+
+    u32 hashed = stream->batch_hashed;
+    stream->hash = Hash_CRC32C(stream->hash, &stream->batch[hashed * 2],
+                               (frames - hashed) * 2 * sizeof(s16));
+    stream->batch_hashed = 0;
+
+    u32 pos = atomic_load_explicit(&stream->write_pos, memory_order_relaxed);
+    u32 read = atomic_load_explicit(&stream->read_pos, memory_order_acquire);
+
+    // The frame before the read position is still used by the interpolation
+    u32 space = (RESAMPLE_BUFFER_FRAMES - 2) - (pos - read);
+    if (frames > space)
+    {
+        Resample_CounterAdd(&stream->overruns, 1);
+        Resample_CounterAdd(&stream->overrun_frames, frames - space);
+        frames = space;
+    }
+    if (frames == 0)
+        return;
+
+    u32 start = pos & (RESAMPLE_BUFFER_FRAMES - 1);
+    u32 first = RESAMPLE_BUFFER_FRAMES - start;
+    if (first > frames)
+        first = frames;
+
+    memcpy(&stream->buffer[start * 2], stream->batch,
+           first * 2 * sizeof(s16));
+    memcpy(&stream->buffer[0], &stream->batch[first * 2],
+           (frames - first) * 2 * sizeof(s16));
+
+    atomic_store_explicit(&stream->write_pos, pos + frames,
+                          memory_order_release);
+}
+
+u32 Resample_TakeHash(_resample_stream_t *stream)
+{
+    u32 hashed = stream->batch_hashed;
+    u32 frames = stream->batch_frames;
+    u32 hash = Hash_CRC32C(stream->hash, &stream->batch[hashed * 2],
+                           (frames - hashed) * 2 * sizeof(s16));
+    stream->batch_hashed = frames;
+
+    stream->hash = 0;
+    return hash;
+}
+
+void Resample_Write(_resample_stream_t *stream, s16 left, s16 right)
+{
+    s16 *batch = &stream->batch[stream->batch_frames * 2];
+    batch[0] = left;
+    batch[1] = right;
+
+    if (++stream->batch_frames == RESAMPLE_BATCH_FRAMES)
+        Resample_Flush(stream);
+}
+
+void Resample_WriteFrames(_resample_stream_t *stream, const s16 *frames,
+                          u32 count)
+{
+    while (count > 0)
+    {
+        u32 n = RESAMPLE_BATCH_FRAMES - stream->batch_frames;
+        if (n > count)
+            n = count;
+
+        memcpy(&stream->batch[stream->batch_frames * 2], frames,
+               n * 2 * sizeof(s16));
+
+        stream->batch_frames += n;
+        frames += n * 2;
+        count -= n;
+
+        if (stream->batch_frames == RESAMPLE_BATCH_FRAMES)
+            Resample_Flush(stream);
+    }
+}
+
+static void Resample_ReadStats(_resample_stream_t *stream, u32 available,
+                               s32 ratio_ppm)
+{
+    u32 bucket = (available * RESAMPLE_FILL_BUCKETS) / RESAMPLE_BUFFER_FRAMES;
+    if (bucket >= RESAMPLE_FILL_BUCKETS)
+        bucket = RESAMPLE_FILL_BUCKETS - 1;
+    Resample_CounterAdd(&stream->fill[bucket], 1);
+    atomic_store_explicit(&stream->fill_frames, available,
+                          memory_order_relaxed);
+
+    u32 reads = atomic_load_explicit(&stream->reads, memory_order_relaxed);
+    s32 min = atomic_load_explicit(&stream->ratio_ppm_min,
+                                   memory_order_relaxed);
+    s32 max = atomic_load_explicit(&stream->ratio_ppm_max,
+                                   memory_order_relaxed);
+
+    if ((reads == 0) || (ratio_ppm < min))
+        atomic_store_explicit(&stream->ratio_ppm_min, ratio_ppm,
+                              memory_order_relaxed);
+    if ((reads == 0) || (ratio_ppm > max))
+        atomic_store_explicit(&stream->ratio_ppm_max, ratio_ppm,
+                              memory_order_relaxed);
+
+    atomic_store_explicit(&stream->ratio_ppm, ratio_ppm, memory_order_relaxed);
+    atomic_store_explicit(&stream->reads, reads + 1, memory_order_relaxed);
+}
+
+// Catmull-Rom spline between y1 and y2
+static inline float Resample_Cubic(float y0, float y1, float y2, float y3,
+                                   float t)
+{
+    return y1 + 0.5f * t * (y2 - y0 + t * (2.0f * y0 - 5.0f * y1 + 4.0f * y2
+                            - y3 + t * (3.0f * (y1 - y2) + y3 - y0)));
+}
+
+static inline s16 Resample_Clamp(float value)
+{
+    if (value > 32767.0f)
+        return 32767;
+    if (value < -32768.0f)
+        return -32768;
+    return (s16)value;
+}
+
+void Resample_Read(_resample_stream_t *stream, s16 *out, u32 frames)
+{
+    u32 pos = atomic_load_explicit(&stream->read_pos, memory_order_relaxed);
+    u32 write = atomic_load_explicit(&stream->write_pos, memory_order_acquire);
+    u32 frac = stream->read_frac;
+
+    double ratio = (double)stream->input_rate / (double)resample_output_rate;
+
+    // Adjust the ratio depending on how far the buffer is from the target
+    double needed = frames * ratio;
+    double target = needed + (stream->input_rate / RESAMPLE_TARGET_DIVIDER);
+    double available = (double)(u32)(write - pos);
+
+    double delta = (available - target) / target;
+    if (delta > 1.0)
+        delta = 1.0;
+    else if (delta < -1.0)
+        delta = -1.0;
+
+    ratio *= 1.0 + (delta * RESAMPLE_MAX_RATIO_DELTA);
+
+    Resample_ReadStats(stream, (u32)(write - pos),
+                       (s32)(delta * RESAMPLE_MAX_RATIO_DELTA * 1000000.0));
+
+    u64 step = (u64)(ratio * 4294967296.0);
+
+    u32 repeated = 0;
+
+    for (u32 i = 0; i < frames; i++)
+    {
+        // Frames pos - 1 to pos + 2 are needed
+        if ((u32)(write - pos) < 3)
+        {
+            // Not enough data. Repeat the last frame instead of cutting the
+            // sound abruptly.
+            *out++ = stream->last_left;
+            *out++ = stream->last_right;
+            repeated++;
+            continue;
+        }
+
+        float t = (float)frac / 4294967296.0f;
+
+        const s16 *b = stream->buffer;
+        u32 mask = RESAMPLE_BUFFER_FRAMES - 1;
+        u32 i0 = ((pos - 1) & mask) * 2;
+        u32 i1 = (pos & mask) * 2;
+        u32 i2 = ((pos + 1) & mask) * 2;
+        u32 i3 = ((pos + 2) & mask) * 2;
+
+        stream->last_left = Resample_Clamp(Resample_Cubic(b[i0], b[i1],
+                                                          b[i2], b[i3], t));
+        stream->last_right = Resample_Clamp(Resample_Cubic(b[i0 + 1],
+                                                           b[i1 + 1],
+                                                           b[i2 + 1],
+                                                           b[i3 + 1], t));
+        *out++ = stream->last_left;
+        *out++ = stream->last_right;
+
+        u64 next = (u64)frac + step;
+        frac = (u32)next;
+        pos += (u32)(next >> 32);
+    }
+
+    stream->read_frac = frac;
+    atomic_store_explicit(&stream->read_pos, pos, memory_order_release);
+
+    if (repeated > 0)
+    {
+        Resample_CounterAdd(&stream->underruns, 1);
+        Resample_CounterAdd(&stream->underrun_frames, repeated);
+    }
+}
+
+void Resample_GetStats(_resample_stream_t *stream, _resample_stats_t *stats)
+{
+    stats->reads = atomic_load_explicit(&stream->reads, memory_order_relaxed);
+    stats->fill_frames = atomic_load_explicit(&stream->fill_frames,
+                                              memory_order_relaxed);
+    stats->underruns = atomic_load_explicit(&stream->underruns,
+                                            memory_order_relaxed);
+    stats->underrun_frames = atomic_load_explicit(&stream->underrun_frames,
+                                                  memory_order_relaxed);
+    stats->overruns = atomic_load_explicit(&stream->overruns,
+                                           memory_order_relaxed);
+    stats->overrun_frames = atomic_load_explicit(&stream->overrun_frames,
+                                                 memory_order_relaxed);
+    stats->ratio_ppm = atomic_load_explicit(&stream->ratio_ppm,
+                                            memory_order_relaxed);
+    stats->ratio_ppm_min = atomic_load_explicit(&stream->ratio_ppm_min,
+                                                memory_order_relaxed);
+    stats->ratio_ppm_max = atomic_load_explicit(&stream->ratio_ppm_max,
+                                                memory_order_relaxed);
+    for (int i = 0; i < RESAMPLE_FILL_BUCKETS; i++)
+    {
+        stats->fill[i] = atomic_load_explicit(&stream->fill[i],
+                                              memory_order_relaxed);
+    }
+}
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef RESAMPLE_UTILS__
+#define RESAMPLE_UTILS__
+
+#include "general_utils.h"
+
+// Stream of stereo samples generated by an emulated system at a fixed rate and
+// played by the audio callback at the rate of the output device. The emulator
+// and the output device never run at exactly the same speed, so the resampling
+// ratio is adjusted slightly so that the amount of buffered samples stays close
+// to a target instead of overflowing or running out.
+//
+// The buffer is a single-producer, single-consumer ring: only the emulation
+// thread writes and only the audio callback reads. The positions are free
+// running counters that only their owner modifies, and each one is in its own
+// cache line so that the two threads don't keep stealing it from each other.
+// The writer collects frames in a small batch that is copied to the ring all
+// at once.
+//
+// Each side also counts how often the ring runs out of data or overflows, how
+// much the ratio is being corrected and how full the ring is when it is read.
+// The counters are atomic so that they can be read from any thread.
+
+#include <stdalign.h>
+#include <stdatomic.h>
+
+#define RESAMPLE_BUFFER_FRAMES  (4096) // Must be a power of two
+#define RESAMPLE_BATCH_FRAMES   (64)
+
+#define RESAMPLE_CACHE_LINE     (64)
+
+// The fill level of the ring is counted in this many buckets
+#define RESAMPLE_FILL_BUCKETS   (16)
+
+typedef struct
+{
+    s16 buffer[RESAMPLE_BUFFER_FRAMES * 2]; // Left and right, interleaved
+
+    // Owned by the writer
+    alignas(RESAMPLE_CACHE_LINE) atomic_uint write_pos; // Frames written
+    u32 batch_frames;
+    s16 batch[RESAMPLE_BATCH_FRAMES * 2];
+    atomic_uint overruns;
+    atomic_uint overrun_frames;
+    u32 hash;           // CRC32C of the frames since Resample_TakeHash()
+    u32 batch_hashed;   // Frames of the batch that are already in the hash
+
+    // Owned by the reader
+    alignas(RESAMPLE_CACHE_LINE) atomic_uint read_pos; // Integer part
+    u32 read_frac;      // Fractional part of the read position (32 bit)
+    u32 input_rate;     // Sample rate of the emulated system in Hz
+    s16 last_left;      // Last output frame, played if there is no data
+    s16 last_right;
+    atomic_uint reads;
+    atomic_uint fill_frames;
+    atomic_uint underruns;
+    atomic_uint underrun_frames;
+    atomic_int ratio_ppm;
+    atomic_int ratio_ppm_min;
+    atomic_int ratio_ppm_max;
+    atomic_uint fill[RESAMPLE_FILL_BUCKETS];
+} _resample_stream_t;
+
+// Counters since the last Resample_Reset()
+typedef struct
+{
+    u32 reads;              // Calls to Resample_Read()
+    u32 fill_frames;        // Frames in the ring in the last read
+    u32 underruns;          // Reads that ran out of data
+    u32 underrun_frames;    // Frames repeated because there was no data
+    u32 overruns;           // Flushes that didn't fit in the ring
+    u32 overrun_frames;     // Frames dropped because the ring was full
+    // Correction applied to the resampling ratio in parts per million: in the
+    // last read, and the lowest and highest ones.
+    s32 ratio_ppm;
+    s32 ratio_ppm_min;
+    s32 ratio_ppm_max;
+    // Reads for each fill level. Bucket i counts the reads that found the ring
+    // filled between i and i + 1 parts out of RESAMPLE_FILL_BUCKETS.
+    u32 fill[RESAMPLE_FILL_BUCKETS];
+} _resample_stats_t;
+
+// The tap is called by the writer with every batch of frames before they are
+// copied to the ring, at the rate of the emulated system. It's used to record
+// the audio as it's generated. It can only be changed while no stream is being
+// written to.
+typedef void Resample_TapPointer(const s16 *samples, u32 frames, u32 rate);
+void Resample_SetTap(Resample_TapPointer *fn);
+
+// The rate must be set by the audio code once the output device is open.
+void Resample_SetOutputRate(u32 rate);
+u32 Resample_GetOutputRate(void);
+
+void Resample_Reset(_resample_stream_t *stream, u32 input_rate);
+
+// Frames are added to the batch, which is copied to the ring when it is full
+// or when Resample_Flush() is called. If the ring is full the frames that
+// don't fit are dropped.
+void Resample_Write(_resample_stream_t *stream, s16 left, s16 right);
+// Same as calling Resample_Write() for each one of the interleaved frames
+void Resample_WriteFrames(_resample_stream_t *stream, const s16 *frames,
+                          u32 count);
+void Resample_Flush(_resample_stream_t *stream);
+
+// Returns the CRC32C of all the frames written since the last call (including
+// the ones dropped because the ring was full), then starts a new hash. The
+// batch isn't flushed, so the frames reach the reader at the same time as
+// without hashing them. It can only be called by the writer.
+u32 Resample_TakeHash(_resample_stream_t *stream);
+
+// Writes "frames" stereo frames at the output rate to "out".
+void Resample_Read(_resample_stream_t *stream, s16 *out, u32 frames);
+
+void Resample_GetStats(_resample_stream_t *stream, _resample_stats_t *stats);
+
+#endif // RESAMPLE_UTILS__
@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "rewind_utils.h"
+#include "savestate_utils.h"
+
+// The deltas are calculated 8 bytes at a time. The buffers of the complete
+// states are padded with zeroes to a multiple of that size.
+//
+// An entry is the size of the state it restores followed by a list of runs.
+// Each run is the number of words to skip, the number of words to XOR, and the
+// words to XOR.
+
+typedef struct
+{
+    u8 *data;
+    size_t size;
+} _rewind_entry_t;
+
+static _rewind_entry_t *rewind_entries;
+static u32 rewind_max_entries;
+static u32 rewind_first; // Oldest entry
+static u32 rewind_count;
+static size_t rewind_memory; // Size of all entries
+
+// Newest state, and buffer used to prepare the next one
+static u64 *rewind_current;
+static size_t rewind_current_size;
+static u64 *rewind_next;
+static size_t rewind_words; // Capacity of the buffers above
+
+// Buffer where the deltas are prepared before being stored in an entry
+static u32 *rewind_delta;
+
+//------------------------------------------------------------------------------
+
+static size_t Rewind_SizeToWords(size_t size)
+{
+    return (size + sizeof(u64) - 1) / sizeof(u64);
+}
+
+// Makes sure that the buffers of the states can hold the specified number of
+// words. The words after the end of the newest state are always zero.
+static int Rewind_BuffersResize(size_t words)
+{
+    if (words <= rewind_words)
+        return 0;
+
+    u64 *current = realloc(rewind_current, words * sizeof(u64));
+    if (current == NULL)
+        return 1;
+    rewind_current = current;
+
+    u64 *next = realloc(rewind_next, words * sizeof(u64));
+    if (next == NULL)
+        return 1;
+    rewind_next = next;
+
+    size_t added = (words - rewind_words) * sizeof(u64);
+    memset(&rewind_current[rewind_words], 0, added);
+    memset(&rewind_next[rewind_words], 0, added);
+
+    // Worst case: One run for every other word
+    u32 *delta = realloc(rewind_delta, (4 + (words * 3)) * sizeof(u32));
+    if (delta == NULL)
+        return 1;
+    rewind_delta = delta;
+
+    rewind_words = words;
+
+    return 0;
+}
+
+static void Rewind_DropOldest(void)
+{
+    _rewind_entry_t *e = &rewind_entries[rewind_first];
+
+    rewind_memory -= e->size;
+    free(e->data);
+    e->data = NULL;
+    e->size = 0;
+
+    rewind_first = (rewind_first + 1) % rewind_max_entries;
+    rewind_count--;
+}
+
+//------------------------------------------------------------------------------
+
+void Rewind_End(void)
+{
+    while (rewind_count > 0)
+        Rewind_DropOldest();
+
+    free(rewind_entries);
+    rewind_entries = NULL;
+    rewind_max_entries = 0;
+    rewind_first = 0;
+    rewind_memory = 0;
+
+    free(rewind_current);
+    rewind_current = NULL;
+    rewind_current_size = 0;
+    free(rewind_next);
+    rewind_next = NULL;
+    rewind_words = 0;
+
+    free(rewind_delta);
+    rewind_delta = NULL;
+}
+
+void Rewind_Reset(u32 max_states)
+{
+    Rewind_End();
+
+    if (max_states == 0)
+        return;
+
+    // The newest state isn't stored in an entry
+    rewind_entries = calloc(max_states, sizeof(_rewind_entry_t));
+    if (rewind_entries == NULL)
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory.", __func__);
+        return;
+    }
+
+    rewind_max_entries = max_states;
+}
+
+void Rewind_Push(const _savestate_t *st)
+{
+    if ((rewind_max_entries == 0) || st->error)
+        return;
+
+    size_t words = Rewind_SizeToWords(st->size);
+
+    if (rewind_current_size == 0)
+    {
+        // First state, there's nothing to compare it with
+        if (Rewind_BuffersResize(words) != 0)
+            return;
+
+        memcpy(rewind_current, st->data, st->size);
+        rewind_current_size = st->size;
+        return;
+    }
+
+    size_t total_words = words;
+    size_t current_words = Rewind_SizeToWords(rewind_current_size);
+    if (current_words > total_words)
+        total_words = current_words;
+
+    if (Rewind_BuffersResize(total_words) != 0)
+        return;
+
+    // Copy the new state and clear anything left after it by bigger states
+    memcpy(rewind_next, st->data, st->size);
+    memset((u8 *)rewind_next + st->size, 0,
+           (rewind_words * sizeof(u64)) - st->size);
+
+    // Encode the delta. The first u32 is the size of the state that it
+    // restores, the size of the delta itself is stored in the entry.
+
+    u32 *out = rewind_delta;
+    *out++ = rewind_current_size;
+
+    size_t i = 0;
+    while (i < total_words)
+    {
+        size_t skip = i;
+        while ((i < total_words) && (rewind_current[i] == rewind_next[i]))
+            i++;
+        if (i == total_words)
+            break;
+
+        u32 *run = out;
+        out += 2;
+
+        size_t start = i;
+        while ((i < total_words) && (rewind_current[i] != rewind_next[i]))
+        {
+            u64 delta = rewind_current[i] ^ rewind_next[i];
+            memcpy(out, &delta, sizeof(delta));
+            out += 2;
+            i++;
+        }
+
+        run[0] = start - skip;
+        run[1] = i - start;
+    }
+
+    size_t delta_size = (u8 *)out - (u8 *)rewind_delta;
+
+    // Get a free entry, dropping old ones if needed
+
+    if (rewind_count == rewind_max_entries)
+        Rewind_DropOldest();
+
+    while ((rewind_count > 0)
+           && ((rewind_memory + delta_size) > REWIND_MAX_MEMORY))
+    {
+        Rewind_DropOldest();
+    }
+
+    u32 index = (rewind_first + rewind_count) % rewind_max_entries;
+    _rewind_entry_t *e = &rewind_entries[index];
+
+    e->data = malloc(delta_size);
+    if (e->data == NULL)
+        return;
+
+    memcpy(e->data, rewind_delta, delta_size);
+    e->size = delta_size;
+    rewind_memory += delta_size;
+    rewind_count++;
+
+    // The new state is now the newest one
+
+    u64 *temp = rewind_current;
+    rewind_current = rewind_next;
+    rewind_next = temp;
+    rewind_current_size = st->size;
+}
+
+int Rewind_Pop(_savestate_t *st)
+{
+    if (rewind_count == 0)
+        return 1;
+
+    u32 index = (rewind_first + rewind_count - 1) % rewind_max_entries;
+    _rewind_entry_t *e = &rewind_entries[index];
+
+    const u32 *in = (const u32 *)e->data;
+    const u32 *end = (const u32 *)(e->data + e->size);
+
+    size_t size = *in++;
+
+    size_t i = 0;
+    while (in < end)
+    {
+        i += in[0];
+        u32 count = in[1];
+        in += 2;
+
+        for (u32 j = 0; j < count; j++)
+        {
+            u64 delta;
+            memcpy(&delta, in, sizeof(delta));
+            rewind_current[i++] ^= delta;
+            in += 2;
+        }
+    }
+
+    rewind_current_size = size;
+
+    rewind_memory -= e->size;
+    free(e->data);
+    e->data = NULL;
+    e->size = 0;
+    rewind_count--;
+
+    SaveState_SetData(st, rewind_current, rewind_current_size);
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef REWIND_UTILS__
+#define REWIND_UTILS__
+
+#include "general_utils.h"
+#include "savestate_utils.h"
+
+// Ring of the last save states of the emulation, used to rewind it. Only the
+// newest state is stored as it is. Each one of the others is stored as the XOR
+// of that state with the one after it, and the runs of zeroes of the result are
+// skipped. Most of the memory of the machine doesn't change from one frame to
+// the next, so each entry is usually a tiny fraction of a state.
+
+// Maximum memory used by the entries. The oldest ones are dropped if needed.
+#define REWIND_MAX_MEMORY   (128 * 1024 * 1024)
+
+// Removes all states and sets the maximum number of states that are kept. If
+// it is 0, Rewind_Push() does nothing.
+void Rewind_Reset(u32 max_states);
+// Frees all the memory
+void Rewind_End(void);
+
+void Rewind_Push(const _savestate_t *st);
+// Copies the state before the newest one to st and removes the newest one.
+// Returns 1 if there are no more states to go back to, 0 otherwise.
+int Rewind_Pop(_savestate_t *st);
+
+#endif // REWIND_UTILS__
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+#include "build_options.h"
+#include "file_utils.h"
+#include "general_utils.h"
+#include "romcache_utils.h"
+
+// Only this many ROMs are remembered, the oldest entries are forgotten first
+#define ROMCACHE_MAX_ENTRIES    (256)
+
+// Size of the start of the ROM that is used to identify it. It includes the
+// header of both GB and GBA ROMs.
+#define ROMCACHE_HASH_SIZE      (0x200)
+
+typedef struct
+{
+    u32 size;
+    long long mtime;
+    u32 hash;
+    int save_type;
+} _romcache_entry_t;
+
+// Sorted from the oldest to the newest one
+static _romcache_entry_t romcache_entries[ROMCACHE_MAX_ENTRIES];
+static int romcache_count;
+static int romcache_loaded;
+
+//------------------------------------------------------------------------------
+
+static void RomCache_GetPath(char *path, size_t size)
+{
+    if (DirGetRunningPath())
+        snprintf(path, size, "%sGiiBiiAdvance.romcache", DirGetRunningPath());
+    else
+        s_strncpy(path, "GiiBiiAdvance.romcache", size);
+}
+
+static void RomCache_Load(void)
+{
+    if (romcache_loaded)
+        return;
+
+    romcache_loaded = 1;
+    romcache_count = 0;
+
+    char path[MAX_PATHLEN];
+    RomCache_GetPath(path, sizeof(path));
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) // Maybe file didn't exist
+        return;
+
+    // Lines that can't be parsed are skipped, the file is only a cache
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (romcache_count == ROMCACHE_MAX_ENTRIES)
+            break;
+
+        _romcache_entry_t *e = &romcache_entries[romcache_count];
+        if (sscanf(line, "%u %lld %x %d", &e->size, &e->mtime, &e->hash,
+                   &e->save_type) == 4)
+        {
+            romcache_count++;
+        }
+    }
+
+    fclose(f);
+}
+
+static void RomCache_Save(void)
+{
+    char path[MAX_PATHLEN];
+    RomCache_GetPath(path, sizeof(path));
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return;
+
+    for (int i = 0; i < romcache_count; i++)
+    {
+        _romcache_entry_t *e = &romcache_entries[i];
+        fprintf(f, "%u %lld %08X %d\n", e->size, e->mtime, e->hash,
+                e->save_type);
+    }
+
+    fclose(f);
+}
+
+// Fills the fields of the entry used to identify the ROM. Returns 0 on success.
+static int RomCache_EntryFill(_romcache_entry_t *e, const char *path,
+                              const void *rom, size_t rom_size)
+{
+    struct stat s;
+    if (stat(path, &s) != 0)
+        return 1;
+
+    size_t hash_size = rom_size;
+    if (hash_size > ROMCACHE_HASH_SIZE)
+        hash_size = ROMCACHE_HASH_SIZE;
+
+    e->size = rom_size;
+    e->mtime = s.st_mtime;
+    e->hash = crc32(0, rom, hash_size);
+
+    return 0;
+}
+
+static int RomCache_Find(const _romcache_entry_t *key)
+{
+    for (int i = 0; i < romcache_count; i++)
+    {
+        _romcache_entry_t *e = &romcache_entries[i];
+
+        if ((e->size == key->size) && (e->mtime == key->mtime)
+            && (e->hash == key->hash))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int RomCache_GetSaveType(const char *path, const void *rom, size_t rom_size,
+                         int *save_type)
+{
+    _romcache_entry_t key;
+    if (RomCache_EntryFill(&key, path, rom, rom_size) != 0)
+        return 1;
+
+    RomCache_Load();
+
+    int index = RomCache_Find(&key);
+    if (index < 0)
+        return 1;
+
+    *save_type = romcache_entries[index].save_type;
+    return 0;
+}
+
+void RomCache_SetSaveType(const char *path, const void *rom, size_t rom_size,
+                          int save_type)
+{
+    _romcache_entry_t key;
+    if (RomCache_EntryFill(&key, path, rom, rom_size) != 0)
+        return;
+
+    key.save_type = save_type;
+
+    RomCache_Load();
+
+    // Remove the old entry of this ROM, or the oldest one if it's full
+    int index = RomCache_Find(&key);
+    if ((index < 0) && (romcache_count == ROMCACHE_MAX_ENTRIES))
+        index = 0;
+
+    if (index >= 0)
+    {
+        memmove(&romcache_entries[index], &romcache_entries[index + 1],
+                (romcache_count - index - 1) * sizeof(_romcache_entry_t));
+        romcache_count--;
+    }
+
+    romcache_entries[romcache_count++] = key;
+
+    RomCache_Save();
+}
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef ROMCACHE_UTILS__
+#define ROMCACHE_UTILS__
+
+#include <stddef.h>
+
+// Information detected from ROMs is stored in a file next to the configuration
+// file so that it doesn't have to be detected again the next time the ROM is
+// loaded. ROMs are identified by the size and modification time of the file
+// and a hash of their header, so the whole ROM doesn't have to be read.
+
+// Returns 0 and the save type stored for this ROM if it's in the cache
+int RomCache_GetSaveType(const char *path, const void *rom, size_t rom_size,
+                         int *save_type);
+
+void RomCache_SetSaveType(const char *path, const void *rom, size_t rom_size,
+                          int save_type);
+
+#endif // ROMCACHE_UTILS__
@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "file_utils.h"
+#include "general_utils.h"
+#include "savestate_utils.h"
+
+#define SAVESTATE_MAGIC             "GiiBiiST"
+#define SAVESTATE_MAGIC_SIZE        (8)
+
+// Magic, version, system and ROM ID
+#define SAVESTATE_HEADER_SIZE       (SAVESTATE_MAGIC_SIZE + (3 * sizeof(u32)))
+// ID and size
+#define SAVESTATE_CHUNK_HEADER_SIZE (4 + sizeof(u32))
+
+#define SAVESTATE_INITIAL_CAPACITY  (1024 * 1024)
+
+void SaveState_Init(_savestate_t *st)
+{
+    memset(st, 0, sizeof(_savestate_t));
+}
+
+void SaveState_Free(_savestate_t *st)
+{
+    free(st->data);
+    SaveState_Init(st);
+}
+
+static void SaveState_Append(_savestate_t *st, const void *data, size_t size)
+{
+    if (st->error)
+        return;
+
+    if ((st->size + size) > st->capacity)
+    {
+        size_t capacity = st->capacity ?
+                          st->capacity : SAVESTATE_INITIAL_CAPACITY;
+        while ((st->size + size) > capacity)
+            capacity *= 2;
+
+        u8 *new_data = realloc(st->data, capacity);
+        if (new_data == NULL)
+        {
+            st->error = 1;
+            return;
+        }
+
+        st->data = new_data;
+        st->capacity = capacity;
+    }
+
+    memcpy(&st->data[st->size], data, size);
+    st->size += size;
+}
+
+void SaveState_Begin(_savestate_t *st, _savestate_system_e system, u32 rom_id)
+{
+    st->size = 0;
+    st->error = 0;
+
+    u32 version = SAVESTATE_VERSION;
+    u32 sys = system;
+
+    SaveState_Append(st, SAVESTATE_MAGIC, SAVESTATE_MAGIC_SIZE);
+    SaveState_Append(st, &version, sizeof(version));
+    SaveState_Append(st, &sys, sizeof(sys));
+    SaveState_Append(st, &rom_id, sizeof(rom_id));
+}
+
+void SaveState_ChunkBegin(_savestate_t *st, const char *id)
+{
+    u32 size = 0;
+
+    st->chunk_start = st->size;
+    SaveState_Append(st, id, 4);
+    SaveState_Append(st, &size, sizeof(size));
+}
+
+void SaveState_Write(_savestate_t *st, const void *data, size_t size)
+{
+    SaveState_Append(st, data, size);
+}
+
+void SaveState_ChunkEnd(_savestate_t *st)
+{
+    if (st->error)
+        return;
+
+    u32 size = st->size - st->chunk_start - SAVESTATE_CHUNK_HEADER_SIZE;
+    memcpy(&st->data[st->chunk_start + 4], &size, sizeof(size));
+}
+
+void SaveState_WriteChunk(_savestate_t *st, const char *id,
+                          const void *data, size_t size)
+{
+    SaveState_ChunkBegin(st, id);
+    SaveState_Write(st, data, size);
+    SaveState_ChunkEnd(st);
+}
+
+void SaveState_SetData(_savestate_t *st, const void *data, size_t size)
+{
+    st->size = 0;
+    st->error = 0;
+
+    SaveState_Append(st, data, size);
+}
+
+//------------------------------------------------------------------------------
+
+int SaveState_Open(_savestate_t *st, _savestate_system_e system, u32 rom_id)
+{
+    st->error = 0;
+    st->read_offset = 0;
+    st->read_end = 0;
+
+    if (st->size < SAVESTATE_HEADER_SIZE)
+        return 1;
+
+    if (memcmp(st->data, SAVESTATE_MAGIC, SAVESTATE_MAGIC_SIZE) != 0)
+        return 1;
+
+    u32 header[3];
+    memcpy(header, &st->data[SAVESTATE_MAGIC_SIZE], sizeof(header));
+
+    if ((header[0] != SAVESTATE_VERSION) || (header[1] != (u32)system)
+        || (header[2] != rom_id))
+    {
+        return 1;
+    }
+
+    // Check that the list of chunks isn't truncated
+
+    size_t offset = SAVESTATE_HEADER_SIZE;
+
+    while (offset < st->size)
+    {
+        if ((st->size - offset) < SAVESTATE_CHUNK_HEADER_SIZE)
+            return 1;
+
+        u32 size;
+        memcpy(&size, &st->data[offset + 4], sizeof(size));
+        offset += SAVESTATE_CHUNK_HEADER_SIZE;
+
+        if ((st->size - offset) < size)
+            return 1;
+
+        offset += size;
+    }
+
+    return 0;
+}
+
+int SaveState_ChunkFind(_savestate_t *st, const char *id)
+{
+    size_t offset = SAVESTATE_HEADER_SIZE;
+
+    while (offset < st->size)
+    {
+        u32 size;
+        memcpy(&size, &st->data[offset + 4], sizeof(size));
+
+        if (memcmp(&st->data[offset], id, 4) == 0)
+        {
+            st->read_offset = offset + SAVESTATE_CHUNK_HEADER_SIZE;
+            st->read_end = st->read_offset + size;
+            return 0;
+        }
+
+        offset += SAVESTATE_CHUNK_HEADER_SIZE + size;
+    }
+
+    st->read_offset = 0;
+    st->read_end = 0;
+
+    return 1;
+}
+
+void SaveState_ChunkOpen(_savestate_t *st, const char *id)
+{
+    if (st->error)
+        return;
+
+    if (SaveState_ChunkFind(st, id) != 0)
+        st->error = 1;
+}
+
+void SaveState_Read(_savestate_t *st, void *data, size_t size)
+{
+    if (st->error)
+        return;
+
+    if ((st->read_end - st->read_offset) < size)
+    {
+        st->error = 1;
+        return;
+    }
+
+    memcpy(data, &st->data[st->read_offset], size);
+    st->read_offset += size;
+}
+
+void SaveState_ChunkClose(_savestate_t *st)
+{
+    if (st->read_offset != st->read_end)
+        st->error = 1;
+}
+
+void SaveState_ReadChunk(_savestate_t *st, const char *id,
+                         void *data, size_t size)
+{
+    SaveState_ChunkOpen(st, id);
+    SaveState_Read(st, data, size);
+    SaveState_ChunkClose(st);
+}
+
+//------------------------------------------------------------------------------
+
+// FNV-1a
+u32 SaveState_Hash(const void *data, size_t size)
+{
+    const u8 *p = data;
+    u32 hash = 0x811C9DC5;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+int SaveState_FileSave(const _savestate_t *st, const char *path)
+{
+    if (st->error)
+        return 1;
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return 1;
+
+    int ret = 0;
+
+    if (fwrite(st->data, 1, st->size, f) != st->size)
+        ret = 1;
+
+    if (fclose(f) != 0)
+        ret = 1;
+
+    return ret;
+}
+
+int SaveState_FileLoad(_savestate_t *st, const char *path)
+{
+    void *buffer;
+    unsigned int size;
+
+    FileLoad_NoError(path, &buffer, &size);
+    if (buffer == NULL)
+        return 1;
+
+    free(st->data);
+    st->data = buffer;
+    st->size = size;
+    st->capacity = size;
+    st->error = 0;
+
+    return 0;
+}
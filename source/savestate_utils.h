@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef SAVESTATE_UTILS__
+#define SAVESTATE_UTILS__
+
+#include <stddef.h>
+
+#include "general_utils.h"
+
+// A save state is a header followed by a list of chunks. Each chunk has an
+// identifier of 4 characters, the size of its data and the data itself. Most
+// chunks are raw copies of the structures of the emulator, so that saving and
+// loading a state is just a few memcpy() calls. That means that a state can
+// only be loaded by a build in which those structures have the same layout.
+// SAVESTATE_VERSION has to be increased every time that the layout of any of
+// them changes. The byte order is the one of the host.
+
+#define SAVESTATE_VERSION   (5)
+
+typedef enum
+{
+    SAVESTATE_SYSTEM_GB = 1,
+    SAVESTATE_SYSTEM_GBA = 2,
+} _savestate_system_e;
+
+typedef struct
+{
+    u8 *data;
+    size_t size;
+    size_t capacity;
+
+    size_t chunk_start; // Writing: Offset of the header of the open chunk
+    size_t read_offset; // Reading: Next byte to read of the current chunk
+    size_t read_end;    // Reading: End of the current chunk
+
+    int error; // Set if anything fails, checked at the end
+} _savestate_t;
+
+void SaveState_Init(_savestate_t *st);
+void SaveState_Free(_savestate_t *st);
+
+// Writing. Empties the state and writes the header.
+void SaveState_Begin(_savestate_t *st, _savestate_system_e system, u32 rom_id);
+void SaveState_ChunkBegin(_savestate_t *st, const char *id);
+void SaveState_Write(_savestate_t *st, const void *data, size_t size);
+void SaveState_ChunkEnd(_savestate_t *st);
+void SaveState_WriteChunk(_savestate_t *st, const char *id,
+                          const void *data, size_t size);
+
+// Replaces the contents of the state by a copy of a state saved previously
+void SaveState_SetData(_savestate_t *st, const void *data, size_t size);
+
+// Reading. SaveState_Open() returns 0 if the header is valid for the specified
+// system and ROM. SaveState_ChunkFind() returns 0 if the chunk exists, and
+// makes it the one read by SaveState_Read(). SaveState_ChunkOpen() does the
+// same, but it is an error if the chunk doesn't exist, and
+// SaveState_ChunkClose() checks that all of its data has been read.
+// SaveState_ReadChunk() does all of that for chunks read with a single call.
+int SaveState_Open(_savestate_t *st, _savestate_system_e system, u32 rom_id);
+int SaveState_ChunkFind(_savestate_t *st, const char *id);
+void SaveState_ChunkOpen(_savestate_t *st, const char *id);
+void SaveState_Read(_savestate_t *st, void *data, size_t size);
+void SaveState_ChunkClose(_savestate_t *st);
+void SaveState_ReadChunk(_savestate_t *st, const char *id,
+                         void *data, size_t size);
+
+// Hash used to identify the ROM a state belongs to
+u32 SaveState_Hash(const void *data, size_t size);
+
+// They return 0 on success
+int SaveState_FileSave(const _savestate_t *st, const char *path);
+int SaveState_FileLoad(_savestate_t *st, const char *path);
+
+#endif // SAVESTATE_UTILS__
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#ifdef __linux__
+# include <limits.h>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "resample_utils.h"
+#include "sharedout_utils.h"
+
+#define SHAREDOUT_VERSION       (1)
+
+// Enough for the consumer to read a frame while the next ones are written
+#define SHAREDOUT_SLOTS         (4)
+
+#define SHAREDOUT_MAX_WIDTH     (256)
+#define SHAREDOUT_MAX_HEIGHT    (224)
+
+// A frame generates around 370 stereo samples in both systems
+#define SHAREDOUT_AUDIO_FRAMES  (2048)
+
+typedef struct
+{
+    u8 magic[8];
+    u32 version;
+    u32 slots;
+    u32 slot_size;
+    u32 sequence;
+    u8 reserved[40];
+} _sharedout_header_t;
+
+typedef struct
+{
+    u32 sequence;
+    u16 width;
+    u16 height;
+    u32 audio_rate;
+    u32 audio_frames;
+    u32 pixels[SHAREDOUT_MAX_WIDTH * SHAREDOUT_MAX_HEIGHT];
+    s16 audio[SHAREDOUT_AUDIO_FRAMES * 2];
+} _sharedout_slot_t;
+
+static _sharedout_header_t *sharedout_header;
+static _sharedout_slot_t *sharedout_slots;
+static size_t sharedout_size;
+
+static u32 sharedout_sequence;
+static _sharedout_slot_t *sharedout_slot; // Slot being written
+
+// The audio is generated during the frame, and it's added to the slot of the
+// frame when it's published.
+static s16 sharedout_audio[SHAREDOUT_AUDIO_FRAMES * 2];
+static u32 sharedout_audio_frames;
+static u32 sharedout_audio_rate;
+
+int SharedOutput_IsActive(void)
+{
+    return sharedout_header != NULL;
+}
+
+// Called by the emulation thread with the audio as it's generated
+static void sharedout_audio_tap(const s16 *samples, u32 frames, u32 rate)
+{
+    u32 space = SHAREDOUT_AUDIO_FRAMES - sharedout_audio_frames;
+    if (frames > space)
+        frames = space;
+
+    memcpy(&sharedout_audio[sharedout_audio_frames * 2], samples,
+           frames * 2 * sizeof(s16));
+    sharedout_audio_frames += frames;
+    sharedout_audio_rate = rate;
+}
+
+#ifndef _WIN32
+
+int SharedOutput_Start(const char *path)
+{
+    if (SharedOutput_IsActive())
+        SharedOutput_Stop();
+
+    size_t size = sizeof(_sharedout_header_t)
+                  + (SHAREDOUT_SLOTS * sizeof(_sharedout_slot_t));
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        Debug_ErrorMsgArg("Couldn't open file for writing: %s", path);
+        return 1;
+    }
+
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd); // The mapping is kept after closing the file
+
+    if (base == MAP_FAILED)
+    {
+        Debug_ErrorMsgArg("Couldn't map %s in memory", path);
+        return 1;
+    }
+
+    sharedout_header = base;
+    sharedout_slots = (_sharedout_slot_t *)&sharedout_header[1];
+    sharedout_size = size;
+
+    // The file is filled with zeroes by ftruncate()
+    memcpy(sharedout_header->magic, "GBSHMOUT", 8);
+    sharedout_header->version = SHAREDOUT_VERSION;
+    sharedout_header->slots = SHAREDOUT_SLOTS;
+    sharedout_header->slot_size = sizeof(_sharedout_slot_t);
+
+    sharedout_sequence = 0;
+    sharedout_slot = NULL;
+    sharedout_audio_frames = 0;
+    sharedout_audio_rate = 0;
+
+    Resample_SetTap(sharedout_audio_tap);
+
+    return 0;
+}
+
+void SharedOutput_Stop(void)
+{
+    if (!SharedOutput_IsActive())
+        return;
+
+    Resample_SetTap(NULL);
+
+    munmap(sharedout_header, sharedout_size);
+    sharedout_header = NULL;
+    sharedout_slots = NULL;
+}
+
+#else // _WIN32
+
+int SharedOutput_Start(unused__ const char *path)
+{
+    Debug_ErrorMsgArg("The shared output isn't supported in this platform");
+    return 1;
+}
+
+void SharedOutput_Stop(void)
+{
+}
+
+#endif // _WIN32
+
+void *SharedOutput_FrameBegin(int width, int height)
+{
+    if ((width > SHAREDOUT_MAX_WIDTH) || (height > SHAREDOUT_MAX_HEIGHT))
+        return NULL;
+
+    u32 sequence = sharedout_sequence + 1;
+    sharedout_slot = &sharedout_slots[(sequence - 1) % SHAREDOUT_SLOTS];
+
+    // Readers that are still using this slot can see that it has changed
+    __atomic_store_n(&sharedout_slot->sequence, 0, __ATOMIC_RELEASE);
+
+    sharedout_slot->width = width;
+    sharedout_slot->height = height;
+
+    return sharedout_slot->pixels;
+}
+
+void SharedOutput_FrameEnd(void)
+{
+    _sharedout_slot_t *slot = sharedout_slot;
+
+    memcpy(slot->audio, sharedout_audio,
+           sharedout_audio_frames * 2 * sizeof(s16));
+    slot->audio_frames = sharedout_audio_frames;
+    slot->audio_rate = sharedout_audio_rate;
+    sharedout_audio_frames = 0;
+
+    sharedout_sequence++;
+
+    __atomic_store_n(&slot->sequence, sharedout_sequence, __ATOMIC_RELEASE);
+    __atomic_store_n(&sharedout_header->sequence, sharedout_sequence,
+                     __ATOMIC_RELEASE);
+
+#ifdef __linux__
+    syscall(SYS_futex, &sharedout_header->sequence, FUTEX_WAKE, INT_MAX,
+            NULL, NULL, 0);
+#endif
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef SHAREDOUT_UTILS__
+#define SHAREDOUT_UTILS__
+
+#include "general_utils.h"
+
+// Output of the frames of the emulated screen and of the audio generated by the
+// emulated system to a file mapped in memory, so that other processes (video
+// encoders, monitoring tools...) can read them in place. In Linux the file
+// should be in /dev/shm so that it never touches the disk. The frames are the
+// same ones that are sent to video recordings, and the audio is the one before
+// it's resampled. It uses the same audio tap as the video recording, so they
+// can't be active at the same time.
+//
+// The file has a header followed by a ring of slots with the last frames. All
+// values are in the native endianness of the emulator:
+//
+//     Header (64 bytes):
+//         u8  magic[8]     "GBSHMOUT"
+//         u32 version      1
+//         u32 slots        Number of slots
+//         u32 slot_size    Size of each slot in bytes
+//         u32 sequence     Number of frames published so far
+//         u8  reserved[40]
+//
+//     Slot:
+//         u32 sequence     Number of the frame in the slot, 0 while written
+//         u16 width
+//         u16 height
+//         u32 audio_rate   Samples per second
+//         u32 audio_frames Number of stereo samples of the frame
+//         u32 pixels[256 * 224]        ARGB8888, rows of "width" pixels
+//         s16 audio[2048 * 2]          Left and right samples interleaved
+//
+// Frame N (starting at 1) is in slot (N - 1) % slots. A reader has to check
+// that the sequence of the slot is still N after reading it, or the emulator
+// may have started to write a newer frame to it. In Linux the sequence of the
+// header is a futex that is woken after each frame is published, so a reader
+// can sleep with FUTEX_WAIT instead of polling it.
+
+// They can't be called while a frame is being emulated. Start returns 1 on
+// error, 0 if OK.
+int SharedOutput_Start(const char *path);
+void SharedOutput_Stop(void);
+
+int SharedOutput_IsActive(void);
+
+// Called from the emulation thread after each frame. It returns the buffer of
+// the next slot to write the frame to, in ARGB8888 format, then
+// SharedOutput_FrameEnd() has to be called to publish it. The size is the one
+// of this frame, up to 256x224. It returns NULL if it's bigger.
+void *SharedOutput_FrameBegin(int width, int height);
+void SharedOutput_FrameEnd(void);
+
+#endif // SHAREDOUT_UTILS__
@@ -4,40 +4,68 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <SDL.h>
 
 #include "config.h"
 #include "debug_utils.h"
+#include "file_utils.h"
 #include "general_utils.h"
 #include "input_utils.h"
+#include "profile_utils.h"
+#include "record_utils.h"
+#include "resample_utils.h"
 #include "sound_utils.h"
 
-#define SDL_BUFFER_SAMPLES (1 * 1024)
+// In queue mode the device is kept this many buffers ahead
+#define SOUND_QUEUE_BUFFERS     (2)
+
+// Largest amount of data pushed at once in queue mode
+#define SOUND_QUEUE_MAX_BYTES   (8192 * 4 * SOUND_QUEUE_BUFFERS)
+
+// The main loop runs at 60 frames per second
+#define SOUND_FRAMES_PER_SECOND (60)
 
 static Sound_CallbackPointer *_sound_callback;
 static int _sound_enabled = 0;
+static int _sound_device_open = 0;
+static int _sound_queue_mode = 0;
 static SDL_AudioSpec obtained_spec;
 
-static void __sound_callback(unused__ void *userdata, Uint8 *buffer, int len)
+// Pull mode: samples played so far, and a semaphore signaled every time the
+// device asks for more, used to pace the emulation.
+static SDL_atomic_t _sound_samples_played;
+static SDL_sem *_sound_played_sem;
+static u32 _sound_samples_waited;
+
+static void Sound_Fill(void *buffer, int len)
 {
-    // Don't play audio during speedup or if it is disabled in the configuration
+    u64 start = Profile_TimerBegin();
+
+    // Don't play audio if it is disabled in the configuration
     if ((_sound_enabled == 0) || EmulatorConfig.snd_mute
-        || Input_Speedup_Enabled())
+        || (_sound_callback == NULL))
     {
-        // Nothing
+        memset(buffer, 0, len);
     }
     else
     {
-        if (_sound_callback)
-        {
-            _sound_callback(buffer, len);
-            return;
-        }
+        _sound_callback(buffer, len);
     }
 
-    memset(buffer, 0, len);
+    Record_Write(buffer, len / 4);
+
+    Profile_TimerEnd(PROFILE_MIXING, start);
+}
+
+static void __sound_callback(unused__ void *userdata, Uint8 *buffer, int len)
+{
+    Sound_Fill(buffer, len);
+
+    SDL_AtomicAdd(&_sound_samples_played, len / 4);
+    SDL_SemPost(_sound_played_sem);
 }
 
 void Sound_Init(void)
@@ -46,13 +74,23 @@ void Sound_Init(void)
 
     SDL_AudioSpec desired_spec;
 
-    desired_spec.freq = 22050;
+    desired_spec.freq = EmulatorConfig.snd_sample_rate;
     desired_spec.format = AUDIO_S16SYS;
     desired_spec.channels = 2;
-    desired_spec.samples = SDL_BUFFER_SAMPLES;
+    desired_spec.samples = EmulatorConfig.snd_buffer_samples;
     desired_spec.callback = __sound_callback;
     desired_spec.userdata = NULL;
 
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+    _sound_queue_mode = EmulatorConfig.snd_queue_mode;
+    if (_sound_queue_mode)
+        desired_spec.callback = NULL;
+#endif
+
+    SDL_AtomicSet(&_sound_samples_played, 0);
+    _sound_samples_waited = 0;
+    _sound_played_sem = SDL_CreateSemaphore(0);
+
     if (SDL_OpenAudio(&desired_spec, &obtained_spec) < 0)
     {
         Debug_ErrorMsgArg("Couldn't open audio: %s\n", SDL_GetError());
@@ -60,15 +98,135 @@ void Sound_Init(void)
         return;
     }
 
+    _sound_device_open = 1;
+
+    atexit(Record_Stop);
+
+    // The emulated sound is resampled to whatever rate the device has
+    Resample_SetOutputRate(obtained_spec.freq);
+
     //Debug_DebugMsgArg("Freq: %d\nChannels: %d\nSamples: %d",
     //                  obtained_spec.freq, obtained_spec.channels,
     //                  obtained_spec.samples);
 
-    // Prepare memory...
-
     SDL_PauseAudio(0);
 }
 
+void Sound_Update(void)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+    if ((_sound_device_open == 0) || (_sound_queue_mode == 0))
+        return;
+
+    // The legacy audio device always has ID 1
+    u32 queued = SDL_GetQueuedAudioSize(1);
+    u32 target = obtained_spec.samples * 4 * SOUND_QUEUE_BUFFERS;
+
+    if (queued >= target)
+        return;
+
+    static s16 buffer[SOUND_QUEUE_MAX_BYTES / 2];
+
+    u32 len = target - queued;
+    if (len > sizeof(buffer))
+        len = sizeof(buffer);
+
+    Sound_Fill(buffer, len);
+    SDL_QueueAudio(1, buffer, len);
+#endif
+}
+
+int Sound_IsSyncEnabled(void)
+{
+    if ((_sound_device_open == 0) || (EmulatorConfig.snd_sync == 0))
+        return 0;
+
+    if (Input_Speedup_Enabled())
+        return 0;
+
+    return 1;
+}
+
+void Sound_WaitFrame(void)
+{
+    u32 frame_samples = obtained_spec.freq / SOUND_FRAMES_PER_SECOND;
+
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+    if (_sound_queue_mode)
+    {
+        // Sleep until the device has played one frame of the queued samples
+        u32 queued = SDL_GetQueuedAudioSize(1) / 4;
+        u32 target = obtained_spec.samples * SOUND_QUEUE_BUFFERS;
+
+        if (target > frame_samples)
+            target -= frame_samples;
+        else
+            target = 0;
+
+        if (queued > target)
+            SDL_Delay(((queued - target) * 1000) / obtained_spec.freq);
+
+        return;
+    }
+#endif
+
+    // Wait until the device has played as many samples as the emulation has
+    // produced frames. If the device is far behind (for example, if it has
+    // been paused), resynchronize instead of trying to catch up.
+    _sound_samples_waited += frame_samples;
+
+    while (1)
+    {
+        u32 played = SDL_AtomicGet(&_sound_samples_played);
+        s32 ahead = (s32)(_sound_samples_waited - played);
+
+        if (ahead <= 0)
+        {
+            // Don't let the emulation run too fast after a slowdown
+            if (ahead < -(s32)(frame_samples * 4))
+                _sound_samples_waited = played;
+            break;
+        }
+
+        if (ahead > (s32)(frame_samples * 4))
+        {
+            _sound_samples_waited = played;
+            break;
+        }
+
+        if (SDL_SemWaitTimeout(_sound_played_sem, 100) == SDL_MUTEX_TIMEDOUT)
+        {
+            _sound_samples_waited = SDL_AtomicGet(&_sound_samples_played);
+            break;
+        }
+    }
+}
+
+int Sound_RecordToggle(void)
+{
+    if (Record_IsActive())
+    {
+        Record_Stop();
+        return 0;
+    }
+
+    if (_sound_device_open == 0)
+        return 1;
+
+    _record_format_e format = RECORD_FORMAT_WAV;
+    const char *extension = "wav";
+
+    if (EmulatorConfig.snd_record_format == 1)
+    {
+        format = RECORD_FORMAT_FLAC;
+        extension = "flac";
+    }
+
+    char *path = FU_GetNewTimestampFilenameExt("audio", extension);
+
+    return Record_Start(path, format, obtained_spec.freq);
+}
+
 void Sound_SetCallback(Sound_CallbackPointer *fn)
 {
     _sound_callback = fn;
@@ -103,64 +261,3 @@ void Sound_SetEnabledChannels(int flags)
 {
     EmulatorConfig.chn_flags = flags & 0x3F;
 }
-
-#if 0
-FILE *f = NULL;
-void closewavfile(void)
-{
-    fseek(f, 0, SEEK_END);
-    u32 size = ftell(f);
-
-    //https://ccrma.stanford.edu/courses/422/projects/WaveFormat/
-
-    struct PACKED {
-        u32 riff_;
-        u32 size;
-        u32 wave_;
-
-        u32 fmt__;
-        u32 format;
-        u16 format2;
-        u16 channels;
-        u32 samplerate;
-        u32 byterate;
-        u16 blckalign;
-        u16 bitspersample;
-
-        u32 data_;
-        u32 numsamples;
-        //u32 data[..];
-    } wavfile = {
-        (*(u32 *)"RIFF"),
-        size - 8, // filesize - 8
-        (*(u32 *)"WAVE"),
-
-        (*(u32 *)"fmt "),
-        16,    // 16 = PCM
-        1,     // 1 = PCM...
-        2,     // 2 channels
-        22050, // Sample rate
-        22050 * 2 * (16 / 8), // Byte rate = samplerate * channels * bytes per sample
-        2 * (16/8), // Block align = channels * bytes per sample
-        16,         // Bits per sample
-
-        (*(u32 *)"data"),
-        size - 44 // Size of the following data...
-     };
-
-    fseek(f, 0, SEEK_SET);
-    fwrite(&wavfile, sizeof(wavfile), 1, f);
-
-    fclose(f);
-}
-
-void createwavheader(void)
-{
-    atexit(closewavfile);
-
-    f = fopen("music.wav", "wb");
-
-    char dummy_header[44];
-    fwrite(dummy_header, sizeof(dummy_header), 1, f);
-}
-#endif
@@ -11,6 +11,20 @@ typedef void(Sound_CallbackPointer)(void *, long);
 
 void Sound_Init(void);
 
+// Pushes the samples needed by the device if it is in queue mode. It must be
+// called once per frame.
+void Sound_Update(void);
+
+// If audio sync is enabled, the main loop calls Sound_WaitFrame() instead of
+// sleeping until the next frame. It blocks until the device has played one
+// frame worth of samples.
+int Sound_IsSyncEnabled(void);
+void Sound_WaitFrame(void);
+
+// Starts or stops recording the output to a file in the screenshots folder.
+// Returns 1 on error, 0 if OK.
+int Sound_RecordToggle(void);
+
 void Sound_SetCallback(Sound_CallbackPointer *fn);
 
 void Sound_Enable(void);
@@ -0,0 +1,647 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+# include <winsock2.h>
+# include <ws2tcpip.h>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/select.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#include <SDL.h>
+#include <zlib.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "input_utils.h"
+#include "resample_utils.h"
+#include "stream_utils.h"
+
+#ifdef _WIN32
+typedef SOCKET stream_socket_t;
+# define STREAM_INVALID_SOCKET  INVALID_SOCKET
+# define stream_close           closesocket
+#else
+typedef int stream_socket_t;
+# define STREAM_INVALID_SOCKET  (-1)
+# define stream_close           close
+#endif
+
+#ifdef MSG_NOSIGNAL
+# define STREAM_SEND_FLAGS      MSG_NOSIGNAL
+#else
+# define STREAM_SEND_FLAGS      0
+#endif
+
+// Frames waiting to be sent. It's short so that the remote player never sees
+// old frames: if the connection can't keep up, frames are dropped instead.
+// Must be a power of two.
+#define STREAM_QUEUE_SIZE       (4)
+
+#define STREAM_MAX_PIXELS       (256 * 224)
+
+// Enough audio for a few frames, in case some of them are dropped
+#define STREAM_AUDIO_FRAMES     (4096)
+
+// Longest time the thread waits for new frames before checking if there is
+// new input from the client (in ms). It's the latency added to the input.
+#define STREAM_POLL_PERIOD      (2)
+
+// If the client doesn't accept data for this long, it's disconnected (in ms)
+#define STREAM_SEND_TIMEOUT     (1000)
+
+#define STREAM_PACKET_HEADER    (8)
+
+// Fastest level, consecutive frames usually only differ in a few pixels
+#define STREAM_ZLIB_LEVEL       (1)
+
+typedef struct
+{
+    u32 pixels[STREAM_MAX_PIXELS];
+    s16 audio[STREAM_AUDIO_FRAMES * 2];
+    u32 audio_frames;
+    u32 audio_rate;
+    u16 width;
+    u16 height;
+} _stream_slot_t;
+
+static _stream_slot_t *stream_queue;
+static SDL_atomic_t stream_write_pos; // Slots, free running
+static SDL_atomic_t stream_read_pos;
+
+static SDL_atomic_t stream_active;
+static SDL_atomic_t stream_connected;
+static SDL_atomic_t stream_exit;
+static SDL_sem *stream_sem;
+static SDL_Thread *stream_thread;
+
+// Keys pressed by the remote player, one bit per key
+static SDL_atomic_t stream_keys[4];
+
+// Only used by the emulation thread
+static s16 stream_audio[STREAM_AUDIO_FRAMES * 2];
+static u32 stream_audio_frames;
+static u32 stream_audio_rate;
+static _stream_slot_t *stream_slot; // Slot being written
+
+// Only used by the stream thread while it's running
+static int stream_port;
+static stream_socket_t stream_listen_socket = STREAM_INVALID_SOCKET;
+static stream_socket_t stream_socket = STREAM_INVALID_SOCKET;
+static u32 *stream_previous;
+static u32 *stream_delta;
+static u8 *stream_packet;
+static uLong stream_packet_size;
+static int stream_width;
+static int stream_height;
+static u8 stream_input[64];
+static int stream_input_size;
+static u32 stream_dropped_frames;
+
+//------------------------------------------------------------------------------
+
+static int stream_set_nonblocking(stream_socket_t s)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) != 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    if (flags == -1)
+        return 1;
+    return fcntl(s, F_SETFL, flags | O_NONBLOCK) != 0;
+#endif
+}
+
+static int stream_error_is_would_block(void)
+{
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return (error == WSAEWOULDBLOCK) || (error == WSAEINPROGRESS);
+#else
+    return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+#endif
+}
+
+// Returns 1 if the socket can be written (if write is 1) or read (if not)
+// before the timeout ends.
+static int stream_wait(stream_socket_t s, int write, int timeout_ms)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(s, &set);
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int ret;
+    if (write)
+        ret = select((int)s + 1, NULL, &set, NULL, &tv);
+    else
+        ret = select((int)s + 1, &set, NULL, NULL, &tv);
+
+    return ret > 0;
+}
+
+static void stream_put_u16(u8 *p, u32 value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static void stream_put_u32(u8 *p, u32 value)
+{
+    stream_put_u16(p, value & 0xFFFF);
+    stream_put_u16(p + 2, value >> 16);
+}
+
+//------------------------------------------------------------------------------
+
+static void stream_connected_set(int connected)
+{
+    if (connected == 0)
+    {
+        // Release all the keys of the remote player
+        for (int i = 0; i < 4; i++)
+            SDL_AtomicSet(&stream_keys[i], 0);
+    }
+    else
+    {
+        // Frames queued before the connection are old, skip them
+        SDL_AtomicSet(&stream_read_pos, SDL_AtomicGet(&stream_write_pos));
+
+        stream_width = 0;
+        stream_height = 0;
+        stream_input_size = 0;
+    }
+
+    SDL_AtomicSet(&stream_connected, connected);
+}
+
+static void stream_disconnect(void)
+{
+    stream_connected_set(0);
+
+    stream_close(stream_socket);
+    stream_socket = STREAM_INVALID_SOCKET;
+
+    Debug_LogMsgArg("Stream: Disconnected.");
+}
+
+static void stream_accept(void)
+{
+    if (stream_wait(stream_listen_socket, 0, STREAM_POLL_PERIOD) == 0)
+        return;
+
+    stream_socket_t s = accept(stream_listen_socket, NULL, NULL);
+    if (s == STREAM_INVALID_SOCKET)
+        return;
+
+    // The accepted socket doesn't always inherit the mode of the listening one
+    if (stream_set_nonblocking(s))
+    {
+        stream_close(s);
+        return;
+    }
+
+    // Send each packet as soon as it's ready
+    int nodelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *)&nodelay,
+               sizeof(nodelay));
+
+    stream_socket = s;
+    stream_connected_set(1);
+
+    Debug_LogMsgArg("Stream: Client connected.");
+}
+
+// Returns 1 on error, 0 if OK. It disconnects the client on error.
+static int stream_send(const u8 *data, size_t size)
+{
+    size_t sent = 0;
+
+    while (sent < size)
+    {
+        int ret = send(stream_socket, (const char *)&data[sent], size - sent,
+                       STREAM_SEND_FLAGS);
+        if (ret > 0)
+        {
+            sent += ret;
+            continue;
+        }
+
+        if ((ret < 0) && stream_error_is_would_block())
+        {
+            if (stream_wait(stream_socket, 1, STREAM_SEND_TIMEOUT))
+                continue;
+        }
+
+        stream_disconnect();
+        return 1;
+    }
+
+    return 0;
+}
+
+// The data of the packet must have been written after the header
+static int stream_packet_send(u8 type, u32 size)
+{
+    u8 *header = stream_packet;
+    header[0] = type;
+    header[1] = 0;
+    header[2] = 0;
+    header[3] = 0;
+    stream_put_u32(&header[4], size);
+
+    return stream_send(stream_packet, STREAM_PACKET_HEADER + size);
+}
+
+static int stream_send_frame(const _stream_slot_t *slot)
+{
+    u8 *data = &stream_packet[STREAM_PACKET_HEADER];
+
+    if ((slot->width != stream_width) || (slot->height != stream_height))
+    {
+        stream_width = slot->width;
+        stream_height = slot->height;
+
+        memset(stream_previous, 0, STREAM_MAX_PIXELS * 4);
+
+        stream_put_u16(&data[0], stream_width);
+        stream_put_u16(&data[2], stream_height);
+        if (stream_packet_send('S', 4) != 0)
+            return 1;
+    }
+
+    size_t count = stream_width * stream_height;
+
+    u32 changed = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        u32 delta = slot->pixels[i] ^ stream_previous[i];
+        stream_delta[i] = delta;
+        changed |= delta;
+    }
+
+    if (changed == 0)
+        return stream_packet_send('V', 0);
+
+    uLongf size = stream_packet_size - STREAM_PACKET_HEADER;
+    if (compress2(data, &size, (const Bytef *)stream_delta, count * 4,
+                  STREAM_ZLIB_LEVEL) != Z_OK)
+    {
+        return 1;
+    }
+
+    memcpy(stream_previous, slot->pixels, count * 4);
+
+    return stream_packet_send('V', size);
+}
+
+static int stream_send_audio(const _stream_slot_t *slot)
+{
+    if (slot->audio_frames == 0)
+        return 0;
+
+    u8 *data = &stream_packet[STREAM_PACKET_HEADER];
+
+    // Samples are little endian in all supported platforms
+    stream_put_u32(data, slot->audio_rate);
+    memcpy(&data[4], slot->audio, slot->audio_frames * 4);
+
+    return stream_packet_send('A', 4 + (slot->audio_frames * 4));
+}
+
+// Sends all the frames that are in the queue
+static void stream_flush(void)
+{
+    u32 read = SDL_AtomicGet(&stream_read_pos);
+    u32 write = SDL_AtomicGet(&stream_write_pos);
+
+    while (read != write)
+    {
+        const _stream_slot_t *slot =
+                &stream_queue[read & (STREAM_QUEUE_SIZE - 1)];
+
+        if (stream_send_frame(slot) || stream_send_audio(slot))
+            return;
+
+        read++;
+        SDL_AtomicSet(&stream_read_pos, read);
+    }
+}
+
+static void stream_receive(void)
+{
+    while (1)
+    {
+        int ret = recv(stream_socket, (char *)&stream_input[stream_input_size],
+                       sizeof(stream_input) - stream_input_size, 0);
+        if (ret <= 0)
+        {
+            if ((ret < 0) && stream_error_is_would_block())
+                return;
+
+            // The connection has been closed or it has failed
+            stream_disconnect();
+            return;
+        }
+
+        stream_input_size += ret;
+
+        int offset = 0;
+        while ((stream_input_size - offset) >= 4)
+        {
+            const u8 *message = &stream_input[offset];
+            offset += 4;
+
+            if ((message[0] != 'K') || (message[1] >= 4))
+                continue;
+
+            u32 keys = message[2] | (message[3] << 8);
+            SDL_AtomicSet(&stream_keys[message[1]], keys);
+        }
+
+        // Move the incomplete message to the start of the buffer
+        stream_input_size -= offset;
+        memmove(stream_input, &stream_input[offset], stream_input_size);
+    }
+}
+
+static int stream_thread_fn(unused__ void *data)
+{
+    while (SDL_AtomicGet(&stream_exit) == 0)
+    {
+        if (stream_socket == STREAM_INVALID_SOCKET)
+        {
+            stream_accept();
+            continue;
+        }
+
+        SDL_SemWaitTimeout(stream_sem, STREAM_POLL_PERIOD);
+
+        stream_receive();
+
+        if (stream_socket != STREAM_INVALID_SOCKET)
+            stream_flush();
+    }
+
+    if (stream_socket != STREAM_INVALID_SOCKET)
+        stream_disconnect();
+
+    return 0;
+}
+
+// Called by the emulation thread with the audio as it's generated
+static void stream_audio_tap(const s16 *samples, u32 frames, u32 rate)
+{
+    u32 space = STREAM_AUDIO_FRAMES - stream_audio_frames;
+    if (frames > space)
+        frames = space;
+
+    memcpy(&stream_audio[stream_audio_frames * 2], samples, frames * 4);
+
+    stream_audio_frames += frames;
+    stream_audio_rate = rate;
+}
+
+//------------------------------------------------------------------------------
+
+static void stream_free(void)
+{
+    free(stream_queue);
+    free(stream_previous);
+    free(stream_delta);
+    free(stream_packet);
+
+    stream_queue = NULL;
+    stream_previous = NULL;
+    stream_delta = NULL;
+    stream_packet = NULL;
+}
+
+static int stream_listen(void)
+{
+    char port[16];
+    snprintf(port, sizeof(port), "%d", stream_port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo *info;
+    if (getaddrinfo(NULL, port, &hints, &info) != 0)
+        return 1;
+
+    stream_socket_t s = socket(info->ai_family, info->ai_socktype,
+                               info->ai_protocol);
+    if (s == STREAM_INVALID_SOCKET)
+    {
+        freeaddrinfo(info);
+        return 1;
+    }
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse,
+               sizeof(reuse));
+
+    if ((bind(s, info->ai_addr, info->ai_addrlen) != 0)
+        || (listen(s, 1) != 0) || stream_set_nonblocking(s))
+    {
+        freeaddrinfo(info);
+        stream_close(s);
+        return 1;
+    }
+
+    freeaddrinfo(info);
+
+    stream_listen_socket = s;
+
+    return 0;
+}
+
+int Stream_Start(int port)
+{
+    if (Stream_IsActive())
+        Stream_Stop();
+
+#ifdef _WIN32
+    // It's initialized once, and it's cleaned up when the process ends
+    static int wsa_started = 0;
+    if (wsa_started == 0)
+    {
+        WSADATA wsa_data;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+        {
+            Debug_ErrorMsgArg("Stream: Couldn't initialize Winsock.");
+            return 1;
+        }
+        wsa_started = 1;
+    }
+#endif
+
+    // The largest packet is a frame that zlib can't compress
+    stream_packet_size = STREAM_PACKET_HEADER
+                         + compressBound(STREAM_MAX_PIXELS * 4);
+
+    stream_queue = malloc(STREAM_QUEUE_SIZE * sizeof(_stream_slot_t));
+    stream_previous = malloc(STREAM_MAX_PIXELS * 4);
+    stream_delta = malloc(STREAM_MAX_PIXELS * 4);
+    stream_packet = malloc(stream_packet_size);
+    if ((stream_queue == NULL) || (stream_previous == NULL)
+        || (stream_delta == NULL) || (stream_packet == NULL))
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+        stream_free();
+        return 1;
+    }
+
+    stream_port = port;
+
+    if (stream_listen() != 0)
+    {
+        Debug_ErrorMsgArg("Stream: Couldn't listen in port %d.", port);
+        stream_free();
+        return 1;
+    }
+
+    stream_audio_frames = 0;
+    stream_audio_rate = 0;
+    stream_dropped_frames = 0;
+
+    SDL_AtomicSet(&stream_write_pos, 0);
+    SDL_AtomicSet(&stream_read_pos, 0);
+    SDL_AtomicSet(&stream_connected, 0);
+    SDL_AtomicSet(&stream_exit, 0);
+
+    if (stream_sem == NULL)
+        stream_sem = SDL_CreateSemaphore(0);
+
+    stream_thread = SDL_CreateThread(stream_thread_fn, "Stream", NULL);
+    if (stream_thread == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        stream_close(stream_listen_socket);
+        stream_listen_socket = STREAM_INVALID_SOCKET;
+        stream_free();
+        return 1;
+    }
+
+    Resample_SetTap(stream_audio_tap);
+
+    SDL_AtomicSet(&stream_active, 1);
+
+    Debug_LogMsgArg("Stream: Waiting for connection in port %d.", port);
+
+    return 0;
+}
+
+void Stream_Stop(void)
+{
+    if (!Stream_IsActive())
+        return;
+
+    SDL_AtomicSet(&stream_active, 0);
+
+    Resample_SetTap(NULL);
+
+    SDL_AtomicSet(&stream_exit, 1);
+    SDL_SemPost(stream_sem);
+    SDL_WaitThread(stream_thread, NULL);
+    stream_thread = NULL;
+
+    stream_close(stream_listen_socket);
+    stream_listen_socket = STREAM_INVALID_SOCKET;
+
+    stream_free();
+
+    if (stream_dropped_frames > 0)
+    {
+        Debug_LogMsgArg("Stream: %u frames were dropped.",
+                        stream_dropped_frames);
+    }
+}
+
+int Stream_IsActive(void)
+{
+    return SDL_AtomicGet(&stream_active);
+}
+
+void *Stream_FrameBegin(int width, int height)
+{
+    if ((SDL_AtomicGet(&stream_connected) == 0)
+        || ((width * height) > STREAM_MAX_PIXELS))
+    {
+        // Nobody is going to play the audio of this frame
+        stream_audio_frames = 0;
+        return NULL;
+    }
+
+    u32 write = SDL_AtomicGet(&stream_write_pos);
+    u32 read = SDL_AtomicGet(&stream_read_pos);
+
+    if ((write - read) >= STREAM_QUEUE_SIZE)
+    {
+        // The audio of this frame is sent with the next one
+        stream_dropped_frames++;
+        SDL_SemPost(stream_sem);
+        return NULL;
+    }
+
+    stream_slot = &stream_queue[write & (STREAM_QUEUE_SIZE - 1)];
+    stream_slot->width = width;
+    stream_slot->height = height;
+
+    return stream_slot->pixels;
+}
+
+void Stream_FrameEnd(void)
+{
+    _stream_slot_t *slot = stream_slot;
+
+    memcpy(slot->audio, stream_audio, stream_audio_frames * 4);
+    slot->audio_frames = stream_audio_frames;
+    slot->audio_rate = stream_audio_rate;
+
+    stream_audio_frames = 0;
+
+    SDL_AtomicSet(&stream_write_pos, SDL_AtomicGet(&stream_write_pos) + 1);
+
+    // Send it right away
+    SDL_SemPost(stream_sem);
+}
+
+void Stream_InputMerge(_input_state_t *state)
+{
+    if (!Stream_IsActive())
+        return;
+
+    for (int i = 0; i < 4; i++)
+    {
+        u32 keys = SDL_AtomicGet(&stream_keys[i]);
+
+        for (int k = 0; k < P_NUM_KEYS; k++)
+        {
+            if (keys & BIT(k))
+                state->keys[i][k] = 1;
+        }
+    }
+}
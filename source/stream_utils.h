@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef STREAM_UTILS__
+#define STREAM_UTILS__
+
+#include "input_utils.h"
+
+// Streaming of the emulated screen and audio to a remote player through TCP,
+// and reception of the input of that player. The emulator waits for the
+// connection in a port, and only one client can be connected at a time.
+//
+// The emulation thread copies each frame and its audio to a short queue and a
+// dedicated thread encodes them and sends them, so that a slow connection
+// never delays the emulation. If the queue is full, the image of the frame is
+// dropped and its audio is sent with the next one. It uses the same audio tap
+// as the video recording and the shared output, so only one of them can be
+// active at a time.
+//
+// All values are little endian. The server sends packets with the same header
+// as the ones of GBV videos (see videorecord_utils.h):
+//
+//     u8  type         'S' (size), 'V' (video) or 'A' (audio)
+//     u8  reserved[3]
+//     u32 size         Size of the data that follows
+//
+//     Size packets are sent before the first frame and when the size of the
+//     screen changes. They hold a u16 width and a u16 height. The next frame is
+//     encoded as the difference with a black frame.
+//
+//     Video packets hold the zlib compressed XOR of the pixels of the frame
+//     (width * height u32 values, ARGB8888) and the ones of the previous frame
+//     that was sent. If the size is 0, the frame is the same as the previous
+//     one.
+//     Audio packets have 16 bit stereo samples and the sample rate as a u32 at
+//     the start. They hold the audio generated during the previous video frame.
+//
+// The client sends messages of 4 bytes:
+//
+//     u8  type         'K' (keys)
+//     u8  player       0 to 3
+//     u16 keys         Bit N set if key N of _key_config_enum_ is pressed
+//
+// The keys are pressed until another message changes them, or until the client
+// disconnects.
+
+// They can't be called while a frame is being emulated. Start returns 1 on
+// error, 0 if OK.
+int Stream_Start(int port);
+void Stream_Stop(void);
+
+int Stream_IsActive(void);
+
+// Called from the emulation thread after each frame. It returns a buffer to
+// write the frame to in ARGB8888 format, then Stream_FrameEnd() has to be
+// called. It never blocks. It returns NULL if there is no client, if the queue
+// is full, or if the frame is bigger than 256x224.
+void *Stream_FrameBegin(int width, int height);
+void Stream_FrameEnd(void);
+
+// Adds the keys pressed by the remote player to the state. A key is pressed if
+// it's pressed locally or remotely.
+void Stream_InputMerge(_input_state_t *state);
+
+#endif // STREAM_UTILS__
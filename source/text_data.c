@@ -70,6 +70,7 @@ const char *readme_text = {
 "  SHIFT -- SELECT\n"
 "\n"
 "     SPACE: TURBO\n"
+"     BACKSPACE: Rewind (hold it).\n"
 "     NUMPAD 8,2,4,6: GBC accelerometers (Kirby Tilt 'n' Tumble).\n"
 "\n"
 "  Menu accelerators\n"
@@ -81,9 +82,13 @@ const char *readme_text = {
 "     CTRL+E: Exit.\n"
 "     CTRL+M: Mute/unmute sound.\n"
 "     F1: Show help.\n"
+"     F2: Save state.\n"
+"     F3: Load state.\n"
 "     F5: Show disassembler.\n"
 "     F6: Show memory viewer.\n"
 "     F7: Show I/O viewer.\n"
+"     F10: Start/stop recording the video.\n"
+"     F11: Start/stop recording the sound.\n"
 "     F12: Screenshot.\n"
 "\n"
 "\n"
@@ -0,0 +1,497 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "debug_utils.h"
+#include "font_utils.h"
+#include "general_utils.h"
+#include "trace_utils.h"
+
+#include "gb_core/debug.h"
+#include "gba_core/disassembler.h"
+
+// Each record starts with a byte with these fields. The rest of fields follow
+// it in this order, only if they are needed.
+//
+//   Bits 0-1: Size of the opcode - 1. The opcode is at the end of the record.
+//   Bit 2:    The address isn't the expected one. The difference follows as a
+//             signed varint.
+//   Bit 3:    The mode has changed. The new one follows (1 byte).
+//   Bits 4-7: Clocks since the previous instruction. If they are 15 or more,
+//             this is 15 and the clocks follow as an unsigned varint.
+//
+// Varints have 7 bits per byte, the lowest ones first. Bit 7 is set in all
+// bytes but the last one.
+
+#define TRACE_FLAG_ADDRESS      BIT(2)
+#define TRACE_FLAG_MODE         BIT(3)
+#define TRACE_CLOCKS_SHIFT      (4)
+#define TRACE_CLOCKS_EXTENDED   (15)
+
+// Header, address (5 bytes), mode, clocks (10 bytes) and opcode (4 bytes)
+#define TRACE_RECORD_MAX_SIZE   (24)
+
+static const char trace_magic[8] = { 'G', 'B', 'A', 'G', 'B', 'T', 'R', 'C' };
+#define TRACE_VERSION           (1)
+
+// Must be a power of two
+#define TRACE_BUFFER_SIZE       (4 * 1024 * 1024)
+
+// The emulation thread only tells the writer thread about new data every time
+// it writes this many bytes, atomic accesses are slow.
+#define TRACE_PUBLISH_SIZE      (TRACE_BUFFER_SIZE / 16)
+
+// The writer thread wakes up at least this often (in ms)
+#define TRACE_WAKEUP_PERIOD     (100)
+
+core_local__ int trace_enabled = 0;
+
+static u8 trace_buffer[TRACE_BUFFER_SIZE];
+static SDL_atomic_t trace_write_pos; // Bytes, free running
+static SDL_atomic_t trace_read_pos;
+
+static SDL_atomic_t trace_exit;
+static SDL_sem *trace_sem;
+static SDL_Thread *trace_thread;
+
+static FILE *trace_file;
+static int trace_write_error;
+
+// State of the emulation thread
+static u32 trace_write;           // Local copy of trace_write_pos
+static u32 trace_write_published; // Last value written to trace_write_pos
+static u32 trace_read;            // Last value read from trace_read_pos
+static u32 trace_next_address;
+static u32 trace_last_mode;
+static u64 trace_last_clocks;
+static u64 trace_instructions;
+static u32 trace_stalls;
+
+//------------------------------------------------------------------------------
+
+// Saves everything that is in the ring buffer
+static void trace_flush(void)
+{
+    u32 read = SDL_AtomicGet(&trace_read_pos);
+    u32 write = SDL_AtomicGet(&trace_write_pos);
+
+    while (read != write)
+    {
+        u32 start = read & (TRACE_BUFFER_SIZE - 1);
+        u32 size = write - read;
+        if (size > TRACE_BUFFER_SIZE - start)
+            size = TRACE_BUFFER_SIZE - start;
+
+        if (fwrite(&trace_buffer[start], 1, size, trace_file) != size)
+            trace_write_error = 1;
+
+        read += size;
+        SDL_AtomicSet(&trace_read_pos, read);
+    }
+}
+
+static int trace_thread_fn(unused__ void *data)
+{
+    while (1)
+    {
+        SDL_SemWaitTimeout(trace_sem, TRACE_WAKEUP_PERIOD);
+
+        int exit = SDL_AtomicGet(&trace_exit);
+
+        trace_flush();
+
+        if (exit)
+            break;
+    }
+
+    return 0;
+}
+
+static void trace_publish(void)
+{
+    SDL_AtomicSet(&trace_write_pos, trace_write);
+    trace_write_published = trace_write;
+    SDL_SemPost(trace_sem);
+}
+
+//------------------------------------------------------------------------------
+
+int Trace_Start(const char *path, _trace_system_e system)
+{
+    if (trace_enabled)
+        Trace_Stop();
+
+    trace_file = fopen(path, "wb");
+    if (trace_file == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't open file for writing: %s", path);
+        return 1;
+    }
+
+    u8 header[12] = { 0 };
+    memcpy(header, trace_magic, sizeof(trace_magic));
+    header[8] = TRACE_VERSION;
+    header[9] = system;
+
+    if (fwrite(header, sizeof(header), 1, trace_file) != 1)
+    {
+        Debug_ErrorMsgArg("Couldn't write to file: %s", path);
+        fclose(trace_file);
+        trace_file = NULL;
+        return 1;
+    }
+
+    SDL_AtomicSet(&trace_write_pos, 0);
+    SDL_AtomicSet(&trace_read_pos, 0);
+    SDL_AtomicSet(&trace_exit, 0);
+    trace_write_error = 0;
+
+    trace_write = 0;
+    trace_write_published = 0;
+    trace_read = 0;
+    trace_next_address = 0;
+    trace_last_mode = 0xFFFFFFFF; // Force the first record to save it
+    trace_last_clocks = 0;
+    trace_instructions = 0;
+    trace_stalls = 0;
+
+    if (trace_sem == NULL)
+        trace_sem = SDL_CreateSemaphore(0);
+
+    trace_thread = SDL_CreateThread(trace_thread_fn, "Execution trace", NULL);
+    if (trace_thread == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        fclose(trace_file);
+        trace_file = NULL;
+        return 1;
+    }
+
+    trace_enabled = 1;
+
+    return 0;
+}
+
+void Trace_Stop(void)
+{
+    if (trace_enabled == 0)
+        return;
+
+    trace_enabled = 0;
+
+    trace_publish();
+
+    SDL_AtomicSet(&trace_exit, 1);
+    SDL_SemPost(trace_sem);
+    SDL_WaitThread(trace_thread, NULL);
+    trace_thread = NULL;
+
+    if (trace_write_error)
+        Debug_ErrorMsg("Couldn't write the whole execution trace.");
+
+    fclose(trace_file);
+    trace_file = NULL;
+
+    Debug_LogMsgArg("Execution trace: %llu instructions, %llu bytes.",
+                    (unsigned long long)trace_instructions,
+                    (unsigned long long)trace_write + 12);
+
+    if (trace_stalls > 0)
+    {
+        Debug_LogMsgArg("Execution trace: The emulation waited for the disk "
+                        "%u times.", trace_stalls);
+    }
+}
+
+static inline u8 *trace_put_varint(u8 *p, u64 value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *p++ = value;
+
+    return p;
+}
+
+// Waits until the writer thread makes space in the ring buffer
+static void trace_wait_for_space(void)
+{
+    trace_stalls++;
+
+    while (1)
+    {
+        trace_publish();
+
+        SDL_Delay(1);
+
+        trace_read = SDL_AtomicGet(&trace_read_pos);
+        if ((TRACE_BUFFER_SIZE - (trace_write - trace_read))
+            >= TRACE_RECORD_MAX_SIZE)
+            return;
+    }
+}
+
+void Trace_Add(u32 address, u32 opcode, u32 size, u32 mode, u64 clocks)
+{
+    if ((TRACE_BUFFER_SIZE - (trace_write - trace_read))
+        < TRACE_RECORD_MAX_SIZE)
+    {
+        trace_read = SDL_AtomicGet(&trace_read_pos);
+        if ((TRACE_BUFFER_SIZE - (trace_write - trace_read))
+            < TRACE_RECORD_MAX_SIZE)
+            trace_wait_for_space();
+    }
+
+    u8 record[TRACE_RECORD_MAX_SIZE];
+    u8 *p = &record[1];
+    u32 flags = size - 1;
+
+    if (address != trace_next_address)
+    {
+        // Signed difference, with the sign in bit 0
+        s32 diff = address - trace_next_address;
+        u32 zigzag = ((u32)diff << 1) ^ (u32)(diff >> 31);
+        p = trace_put_varint(p, zigzag);
+        flags |= TRACE_FLAG_ADDRESS;
+    }
+    trace_next_address = address + size;
+
+    if (mode != trace_last_mode)
+    {
+        *p++ = mode;
+        trace_last_mode = mode;
+        flags |= TRACE_FLAG_MODE;
+    }
+
+    u64 delta = clocks - trace_last_clocks;
+    trace_last_clocks = clocks;
+    if (delta < TRACE_CLOCKS_EXTENDED)
+    {
+        flags |= delta << TRACE_CLOCKS_SHIFT;
+    }
+    else
+    {
+        flags |= TRACE_CLOCKS_EXTENDED << TRACE_CLOCKS_SHIFT;
+        p = trace_put_varint(p, delta);
+    }
+
+    for (u32 i = 0; i < size; i++)
+    {
+        *p++ = opcode & 0xFF;
+        opcode >>= 8;
+    }
+
+    record[0] = flags;
+
+    u32 length = p - record;
+    for (u32 i = 0; i < length; i++)
+        trace_buffer[(trace_write + i) & (TRACE_BUFFER_SIZE - 1)] = record[i];
+    trace_write += length;
+
+    trace_instructions++;
+
+    if ((trace_write - trace_write_published) >= TRACE_PUBLISH_SIZE)
+        trace_publish();
+}
+
+//------------------------------------------------------------------------------
+
+// Returns 1 if the end of the file has been reached
+static int trace_get_varint(FILE *f, u64 *value)
+{
+    u64 result = 0;
+    int shift = 0;
+
+    while (1)
+    {
+        int c = fgetc(f);
+        if (c == EOF)
+            return 1;
+
+        result |= (u64)(c & 0x7F) << shift;
+        shift += 7;
+
+        if ((c & 0x80) == 0)
+            break;
+
+        if (shift >= 64)
+            return 1;
+    }
+
+    *value = result;
+    return 0;
+}
+
+static const char *trace_gba_mode_name(u32 mode)
+{
+    switch (mode & 0x1F)
+    {
+        case 0x10:
+            return "usr";
+        case 0x11:
+            return "fiq";
+        case 0x12:
+            return "irq";
+        case 0x13:
+            return "svc";
+        case 0x17:
+            return "abt";
+        case 0x1B:
+            return "und";
+        case 0x1F:
+            return "sys";
+        default:
+            return "???";
+    }
+}
+
+// The disassemblers use characters of the font of the GUI for the arrows of
+// the jumps, replace them by ASCII characters.
+static void trace_text_to_ascii(char *text)
+{
+    for ( ; *text != '\0'; text++)
+    {
+        if (*text == STR_SLIM_ARROW_UP[0])
+            *text = '^';
+        else if (*text == STR_SLIM_ARROW_DOWN[0])
+            *text = 'v';
+    }
+}
+
+int Trace_Decode(const char *path, FILE *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't open file: %s", path);
+        return 1;
+    }
+
+    u8 header[12];
+    if ((fread(header, sizeof(header), 1, f) != 1)
+        || (memcmp(header, trace_magic, sizeof(trace_magic)) != 0)
+        || (header[8] != TRACE_VERSION))
+    {
+        Debug_ErrorMsgArg("Not a valid execution trace: %s", path);
+        fclose(f);
+        return 1;
+    }
+
+    _trace_system_e system = header[9];
+
+    u32 next_address = 0;
+    u32 mode = 0;
+    u64 clocks = 0;
+    int ret = 0;
+
+    // The memory of the console isn't available, don't read it
+    GBA_DisassemblerSetOffline(1);
+
+    while (1)
+    {
+        int flags = fgetc(f);
+        if (flags == EOF)
+            break;
+
+        u32 size = (flags & 3) + 1;
+        u32 address = next_address;
+        u64 value;
+
+        if (flags & TRACE_FLAG_ADDRESS)
+        {
+            if (trace_get_varint(f, &value))
+            {
+                ret = 1;
+                break;
+            }
+            u32 zigzag = value;
+            s32 diff = (zigzag >> 1) ^ -(s32)(zigzag & 1);
+            address += diff;
+        }
+        next_address = address + size;
+
+        if (flags & TRACE_FLAG_MODE)
+        {
+            int c = fgetc(f);
+            if (c == EOF)
+            {
+                ret = 1;
+                break;
+            }
+            mode = c;
+        }
+
+        u32 delta = (flags >> TRACE_CLOCKS_SHIFT) & 0xF;
+        if (delta == TRACE_CLOCKS_EXTENDED)
+        {
+            if (trace_get_varint(f, &value))
+            {
+                ret = 1;
+                break;
+            }
+            clocks += value;
+        }
+        else
+        {
+            clocks += delta;
+        }
+
+        u8 bytes[4];
+        if (fread(bytes, size, 1, f) != 1)
+        {
+            ret = 1;
+            break;
+        }
+
+        char text[128];
+
+        if (system == TRACE_GBA)
+        {
+            if (size == 4)
+            {
+                u32 opcode = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16)
+                             | ((u32)bytes[3] << 24);
+                GBA_DisassembleARM(opcode, address, text, sizeof(text));
+                trace_text_to_ascii(text);
+                fprintf(out, "%12llu %s %08X:%08X %s\n",
+                        (unsigned long long)clocks, trace_gba_mode_name(mode),
+                        address, opcode, text);
+            }
+            else
+            {
+                u16 opcode = bytes[0] | (bytes[1] << 8);
+                GBA_DisassembleTHUMB(opcode, address, text, sizeof(text));
+                trace_text_to_ascii(text);
+                fprintf(out, "%12llu %s %08X:%04X %s\n",
+                        (unsigned long long)clocks, trace_gba_mode_name(mode),
+                        address, opcode, text);
+            }
+        }
+        else
+        {
+            GB_DisassembleBytes(address, bytes, text, sizeof(text));
+            trace_text_to_ascii(text);
+            fprintf(out, "%12llu %s%s %04X:%s\n", (unsigned long long)clocks,
+                    (mode & TRACE_GB_MODE_DOUBLE_SPEED) ? "2x" : "1x",
+                    (mode & TRACE_GB_MODE_IME) ? "I" : "-", address, text);
+        }
+    }
+
+    GBA_DisassemblerSetOffline(0);
+
+    if (ret != 0)
+        Debug_ErrorMsgArg("The execution trace is truncated: %s", path);
+
+    fclose(f);
+
+    return ret;
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef TRACE_UTILS__
+#define TRACE_UTILS__
+
+#include <stdio.h>
+
+#include "general_utils.h"
+
+// Execution trace. While it's active, the cores add a record for each
+// instruction executed by the CPU with its address, opcode, CPU mode and clock.
+// The records are delta-encoded to a ring buffer in the emulation thread, and a
+// dedicated thread writes them to the file. If it can't keep up, the emulation
+// waits for it, so no record is lost. The file can be converted to text later
+// with Trace_Decode().
+//
+// Modes are CPSR & 0x3F in GBA (mode and THUMB bit), and the flags below in GB.
+
+#define TRACE_GB_MODE_DOUBLE_SPEED  BIT(0)
+#define TRACE_GB_MODE_IME           BIT(1)
+
+typedef enum
+{
+    TRACE_GBA,
+    TRACE_GB,
+} _trace_system_e;
+
+extern core_local__ int trace_enabled;
+
+// Returns 1 on error, 0 if OK
+int Trace_Start(const char *path, _trace_system_e system);
+void Trace_Stop(void);
+
+// Only called from the emulation thread while trace_enabled is set. The size of
+// the opcode is 1 to 4 bytes, the first one is in the lowest bits. The address
+// of the next instruction is expected to be address + size.
+void Trace_Add(u32 address, u32 opcode, u32 size, u32 mode, u64 clocks);
+
+// Writes a trace file as text, one instruction per line. It can be called when
+// no ROM is loaded, instructions are disassembled without reading memory.
+// Returns 1 on error, 0 if OK.
+int Trace_Decode(const char *path, FILE *out);
+
+#endif // TRACE_UTILS__
@@ -0,0 +1,539 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include <SDL.h>
+#include <zlib.h>
+
+#include "build_options.h"
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "record_utils.h"
+#include "resample_utils.h"
+#include "videorecord_utils.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+// About half a second of frames. Must be a power of two.
+#define VIDEORECORD_QUEUE_SIZE      (32)
+
+#define VIDEORECORD_MAX_PIXELS      (256 * 224)
+
+// Audio generated while the queue is full is kept until there is space for
+// the next frame, this is enough for a few frames.
+#define VIDEORECORD_AUDIO_FRAMES    (4096)
+
+// The writer thread wakes up at least this often (in ms)
+#define VIDEORECORD_WAKEUP_PERIOD   (100)
+
+#define VIDEORECORD_HEADER_SIZE     (40)
+
+// Fastest level, most frames only differ in a few pixels from the previous one
+#define VIDEORECORD_ZLIB_LEVEL      (1)
+
+typedef struct
+{
+    u32 pixels[VIDEORECORD_MAX_PIXELS];
+    s16 audio[VIDEORECORD_AUDIO_FRAMES * 2];
+    u32 audio_frames;
+    u32 repeat; // Frames dropped before this one
+} _videorecord_slot_t;
+
+static _videorecord_slot_t *videorecord_queue;
+static SDL_atomic_t videorecord_write_pos; // Slots, free running
+static SDL_atomic_t videorecord_read_pos;
+
+static SDL_atomic_t videorecord_active;
+static SDL_atomic_t videorecord_exit;
+static SDL_sem *videorecord_sem;
+static SDL_Thread *videorecord_thread;
+
+// Only used by the emulation thread
+static s16 videorecord_audio[VIDEORECORD_AUDIO_FRAMES * 2];
+static u32 videorecord_audio_frames;
+static u32 videorecord_repeat;
+static u32 videorecord_audio_rate;
+static u32 videorecord_dropped_frames;
+static u32 videorecord_dropped_audio;
+
+// Only used by the writer thread while it's running
+static _videorecord_format_e videorecord_format;
+static FILE *videorecord_file;
+static FILE *videorecord_wav_file;
+static int videorecord_width;
+static int videorecord_height;
+static u32 *videorecord_previous;
+static u32 *videorecord_delta;
+static u8 *videorecord_compressed;
+static uLong videorecord_compressed_size;
+static u32 videorecord_frames_saved;
+static u64 videorecord_audio_saved;
+static int videorecord_write_error;
+
+//------------------------------------------------------------------------------
+
+static void videorecord_put_u16(u8 *p, u32 value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static void videorecord_put_u32(u8 *p, u32 value)
+{
+    videorecord_put_u16(p, value & 0xFFFF);
+    videorecord_put_u16(p + 2, value >> 16);
+}
+
+static int videorecord_header_write(void)
+{
+    u8 header[VIDEORECORD_HEADER_SIZE];
+    memcpy(&header[0], "GBVIDEO", 8);
+    videorecord_put_u32(&header[8], 1); // Version
+    videorecord_put_u16(&header[12], videorecord_width);
+    videorecord_put_u16(&header[14], videorecord_height);
+    videorecord_put_u32(&header[16], 4194304); // Clocks per second
+    videorecord_put_u32(&header[20], 70224); // Clocks per frame
+    videorecord_put_u32(&header[24], videorecord_audio_rate);
+    videorecord_put_u32(&header[28], videorecord_frames_saved);
+    videorecord_put_u32(&header[32], videorecord_audio_saved & 0xFFFFFFFF);
+    videorecord_put_u32(&header[36], videorecord_audio_saved >> 32);
+
+    if (fseek(videorecord_file, 0, SEEK_SET) != 0)
+        return 1;
+
+    if (fwrite(header, sizeof(header), 1, videorecord_file) != 1)
+        return 1;
+
+    fseek(videorecord_file, 0, SEEK_END);
+
+    return 0;
+}
+
+static void videorecord_write(FILE *f, const void *data, size_t size)
+{
+    if (size == 0)
+        return;
+
+    if (fwrite(data, size, 1, f) != 1)
+        videorecord_write_error = 1;
+}
+
+static void videorecord_packet_write(u8 type, const void *data, u32 size)
+{
+    u8 header[8] = { type, 0, 0, 0 };
+    videorecord_put_u32(&header[4], size);
+
+    videorecord_write(videorecord_file, header, sizeof(header));
+    videorecord_write(videorecord_file, data, size);
+}
+
+static void videorecord_save_frame_gbv(const u32 *pixels)
+{
+    size_t count = videorecord_width * videorecord_height;
+
+    u32 changed = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        u32 delta = pixels[i] ^ videorecord_previous[i];
+        videorecord_delta[i] = delta;
+        changed |= delta;
+    }
+
+    if (changed == 0)
+    {
+        videorecord_packet_write('V', NULL, 0);
+        return;
+    }
+
+    uLongf size = videorecord_compressed_size;
+    if (compress2(videorecord_compressed, &size,
+                  (const Bytef *)videorecord_delta, count * 4,
+                  VIDEORECORD_ZLIB_LEVEL) != Z_OK)
+    {
+        videorecord_write_error = 1;
+        return;
+    }
+
+    videorecord_packet_write('V', videorecord_compressed, size);
+
+    memcpy(videorecord_previous, pixels, count * 4);
+}
+
+// The dropped frames are replaced by the last one that was saved
+static void videorecord_save_repeat(u32 repeat)
+{
+    size_t frame_size = videorecord_width * videorecord_height * 4;
+
+    for (u32 i = 0; i < repeat; i++)
+    {
+        if (videorecord_format == VIDEORECORD_FORMAT_GBV)
+            videorecord_packet_write('V', NULL, 0);
+        else
+            videorecord_write(videorecord_file, videorecord_previous,
+                              frame_size);
+    }
+
+    videorecord_frames_saved += repeat;
+}
+
+static void videorecord_save_audio(const s16 *samples, u32 frames)
+{
+    if (videorecord_format == VIDEORECORD_FORMAT_GBV)
+    {
+        videorecord_packet_write('A', samples, frames * 4);
+    }
+    else
+    {
+        // Samples are little endian in all supported platforms
+        videorecord_write(videorecord_wav_file, samples, frames * 4);
+    }
+
+    videorecord_audio_saved += frames;
+}
+
+static void videorecord_save(const _videorecord_slot_t *slot)
+{
+    size_t frame_size = videorecord_width * videorecord_height * 4;
+
+    videorecord_save_repeat(slot->repeat);
+
+    if (videorecord_format == VIDEORECORD_FORMAT_GBV)
+    {
+        videorecord_save_frame_gbv(slot->pixels);
+    }
+    else
+    {
+        memcpy(videorecord_previous, slot->pixels, frame_size);
+        videorecord_write(videorecord_file, slot->pixels, frame_size);
+    }
+
+    videorecord_frames_saved++;
+
+    videorecord_save_audio(slot->audio, slot->audio_frames);
+}
+
+// Saves all the frames that are in the queue
+static void videorecord_flush(void)
+{
+    u32 read = SDL_AtomicGet(&videorecord_read_pos);
+    u32 write = SDL_AtomicGet(&videorecord_write_pos);
+
+    while (read != write)
+    {
+        videorecord_save(&videorecord_queue[read
+                                            & (VIDEORECORD_QUEUE_SIZE - 1)]);
+
+        read++;
+        SDL_AtomicSet(&videorecord_read_pos, read);
+    }
+}
+
+static int videorecord_thread_fn(unused__ void *data)
+{
+    while (1)
+    {
+        SDL_SemWaitTimeout(videorecord_sem, VIDEORECORD_WAKEUP_PERIOD);
+
+        int exit = SDL_AtomicGet(&videorecord_exit);
+
+        videorecord_flush();
+
+        if (exit)
+            break;
+    }
+
+    return 0;
+}
+
+// Called by the emulation thread with the audio as it's generated
+static void videorecord_audio_tap(const s16 *samples, u32 frames, u32 rate)
+{
+    // All the audio of a recording is generated by the same system
+    if (videorecord_audio_rate == 0)
+        videorecord_audio_rate = rate;
+
+    u32 space = VIDEORECORD_AUDIO_FRAMES - videorecord_audio_frames;
+    if (frames > space)
+    {
+        videorecord_dropped_audio += frames - space;
+        frames = space;
+    }
+
+    memcpy(&videorecord_audio[videorecord_audio_frames * 2], samples,
+           frames * 4);
+
+    videorecord_audio_frames += frames;
+}
+
+//------------------------------------------------------------------------------
+
+static void videorecord_free(void)
+{
+    free(videorecord_queue);
+    free(videorecord_previous);
+    free(videorecord_delta);
+    free(videorecord_compressed);
+
+    videorecord_queue = NULL;
+    videorecord_previous = NULL;
+    videorecord_delta = NULL;
+    videorecord_compressed = NULL;
+}
+
+// Opens an ffmpeg process that encodes the frames written to its input
+static FILE *videorecord_ffmpeg_open(const char *path)
+{
+    char command[MAX_PATHLEN + 300];
+    snprintf(command, sizeof(command),
+             "ffmpeg -y -loglevel error -f rawvideo -pixel_format bgr0 "
+             "-video_size %dx%d -framerate 4194304/70224 -i - -c:v ffv1 "
+             "\"%s\"", videorecord_width, videorecord_height, path);
+
+#ifdef _WIN32
+    return popen(command, "wb");
+#else
+    // If ffmpeg exits, writing to the pipe mustn't kill the emulator
+    signal(SIGPIPE, SIG_IGN);
+
+    return popen(command, "w");
+#endif
+}
+
+// The audio goes to a WAV file with the same name as the video
+static FILE *videorecord_wav_open(const char *path)
+{
+    char wav_path[MAX_PATHLEN];
+    snprintf(wav_path, sizeof(wav_path), "%s", path);
+
+    char *dot = strrchr(wav_path, '.');
+    if (dot != NULL)
+        *dot = '\0';
+
+    size_t len = strlen(wav_path);
+    snprintf(&wav_path[len], sizeof(wav_path) - len, ".wav");
+
+    FILE *f = fopen(wav_path, "wb");
+    if (f == NULL)
+        Debug_ErrorMsgArg("Couldn't open file for writing: %s", wav_path);
+
+    return f;
+}
+
+static void videorecord_files_close(void)
+{
+    if (videorecord_file != NULL)
+    {
+        if (videorecord_format == VIDEORECORD_FORMAT_GBV)
+            fclose(videorecord_file);
+        else
+            pclose(videorecord_file);
+
+        videorecord_file = NULL;
+    }
+
+    if (videorecord_wav_file != NULL)
+    {
+        fclose(videorecord_wav_file);
+        videorecord_wav_file = NULL;
+    }
+}
+
+int VideoRecord_Start(const char *path, _videorecord_format_e format,
+                      int width, int height)
+{
+    if (VideoRecord_IsActive())
+        VideoRecord_Stop();
+
+    if ((width * height) > VIDEORECORD_MAX_PIXELS)
+        return 1;
+
+    videorecord_format = format;
+    videorecord_width = width;
+    videorecord_height = height;
+
+    size_t frame_size = width * height * 4;
+
+    videorecord_compressed_size = compressBound(frame_size);
+
+    videorecord_queue = malloc(VIDEORECORD_QUEUE_SIZE
+                               * sizeof(_videorecord_slot_t));
+    videorecord_previous = calloc(1, frame_size); // Starts black
+    videorecord_delta = malloc(frame_size);
+    videorecord_compressed = malloc(videorecord_compressed_size);
+    if ((videorecord_queue == NULL) || (videorecord_previous == NULL)
+        || (videorecord_delta == NULL) || (videorecord_compressed == NULL))
+    {
+        Debug_ErrorMsgArg("%s: Not enough memory", __func__);
+        videorecord_free();
+        return 1;
+    }
+
+    videorecord_frames_saved = 0;
+    videorecord_audio_saved = 0;
+    videorecord_write_error = 0;
+
+    videorecord_audio_frames = 0;
+    videorecord_repeat = 0;
+    videorecord_audio_rate = 0;
+    videorecord_dropped_frames = 0;
+    videorecord_dropped_audio = 0;
+
+    int ret;
+    if (format == VIDEORECORD_FORMAT_GBV)
+    {
+        videorecord_file = fopen(path, "wb");
+        ret = (videorecord_file == NULL);
+        if (ret == 0)
+            ret = videorecord_header_write(); // Rewritten at the end
+    }
+    else
+    {
+        videorecord_file = videorecord_ffmpeg_open(path);
+        videorecord_wav_file = videorecord_wav_open(path);
+        ret = (videorecord_file == NULL) || (videorecord_wav_file == NULL);
+        if (ret == 0)
+        {
+            // The rate isn't known until the first audio is generated
+            ret = Record_WavHeaderWrite(videorecord_wav_file, 0, 0);
+        }
+    }
+
+    if (ret != 0)
+    {
+        Debug_ErrorMsgArg("Couldn't start recording the video: %s", path);
+        videorecord_files_close();
+        videorecord_free();
+        return 1;
+    }
+
+    SDL_AtomicSet(&videorecord_write_pos, 0);
+    SDL_AtomicSet(&videorecord_read_pos, 0);
+    SDL_AtomicSet(&videorecord_exit, 0);
+
+    if (videorecord_sem == NULL)
+        videorecord_sem = SDL_CreateSemaphore(0);
+
+    videorecord_thread = SDL_CreateThread(videorecord_thread_fn,
+                                          "Video recording", NULL);
+    if (videorecord_thread == NULL)
+    {
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        videorecord_files_close();
+        videorecord_free();
+        return 1;
+    }
+
+    Resample_SetTap(videorecord_audio_tap);
+
+    SDL_AtomicSet(&videorecord_active, 1);
+
+    return 0;
+}
+
+void VideoRecord_Stop(void)
+{
+    if (!VideoRecord_IsActive())
+        return;
+
+    SDL_AtomicSet(&videorecord_active, 0);
+
+    Resample_SetTap(NULL);
+
+    SDL_AtomicSet(&videorecord_exit, 1);
+    SDL_SemPost(videorecord_sem);
+    SDL_WaitThread(videorecord_thread, NULL);
+    videorecord_thread = NULL;
+
+    // Save the frames dropped at the end and the audio generated after the
+    // last frame, the emulation isn't running now.
+    videorecord_save_repeat(videorecord_repeat);
+    videorecord_save_audio(videorecord_audio, videorecord_audio_frames);
+
+    int ret = videorecord_write_error;
+    if (videorecord_format == VIDEORECORD_FORMAT_GBV)
+    {
+        ret |= videorecord_header_write();
+    }
+    else
+    {
+        ret |= Record_WavHeaderWrite(videorecord_wav_file,
+                                     videorecord_audio_rate,
+                                     videorecord_audio_saved);
+    }
+
+    if (ret != 0)
+        Debug_ErrorMsg("Couldn't finish writing the video recording.");
+
+    videorecord_files_close();
+    videorecord_free();
+
+    if (videorecord_dropped_frames > 0)
+    {
+        Debug_LogMsgArg("Video recording: %u frames were dropped.",
+                        videorecord_dropped_frames);
+    }
+    if (videorecord_dropped_audio > 0)
+    {
+        Debug_LogMsgArg("Video recording: %u samples were dropped.",
+                        videorecord_dropped_audio);
+    }
+}
+
+int VideoRecord_IsActive(void)
+{
+    return SDL_AtomicGet(&videorecord_active);
+}
+
+void *VideoRecord_FrameBegin(void)
+{
+    u32 write = SDL_AtomicGet(&videorecord_write_pos);
+    u32 read = SDL_AtomicGet(&videorecord_read_pos);
+
+    if ((write - read) >= VIDEORECORD_QUEUE_SIZE)
+    {
+        // The audio of this frame is saved with the next one
+        videorecord_dropped_frames++;
+        videorecord_repeat++;
+        SDL_SemPost(videorecord_sem);
+        return NULL;
+    }
+
+    return videorecord_queue[write & (VIDEORECORD_QUEUE_SIZE - 1)].pixels;
+}
+
+void VideoRecord_FrameEnd(void)
+{
+    u32 write = SDL_AtomicGet(&videorecord_write_pos);
+
+    _videorecord_slot_t *slot =
+            &videorecord_queue[write & (VIDEORECORD_QUEUE_SIZE - 1)];
+
+    memcpy(slot->audio, videorecord_audio, videorecord_audio_frames * 4);
+    slot->audio_frames = videorecord_audio_frames;
+    slot->repeat = videorecord_repeat;
+
+    videorecord_audio_frames = 0;
+    videorecord_repeat = 0;
+
+    SDL_AtomicSet(&videorecord_write_pos, write + 1);
+
+    // Wake up the writer when there is a good amount of frames
+    if ((write + 1 - SDL_AtomicGet(&videorecord_read_pos))
+        >= (VIDEORECORD_QUEUE_SIZE / 8))
+    {
+        SDL_SemPost(videorecord_sem);
+    }
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef VIDEORECORD_UTILS__
+#define VIDEORECORD_UTILS__
+
+#include "general_utils.h"
+
+// Lossless recording of the frames of the emulated screen at their native size
+// and of the audio generated by the emulated system, before it's resampled to
+// the rate of the output device.
+//
+// The emulation thread copies each frame and its audio to a queue and a
+// dedicated thread encodes them and writes them to the file. If the queue is
+// full, the image of the frame is dropped, but its audio is kept and the frame
+// is still counted, so the recording stays in sync.
+//
+// Formats:
+//
+// - GBV: Container of this emulator. Each frame is stored as the difference
+//   with the previous one, compressed with zlib. Identical frames take a few
+//   bytes. It can be decoded with tools/gbv2raw.
+//
+// - FFmpeg: The frames are sent to the standard input of an "ffmpeg" process,
+//   which encodes them with the lossless FFV1 codec in an MKV file. The audio
+//   is saved in a WAV file with the same name. Both start at the same time.
+//
+// GBV format, all values are little endian:
+//
+//     Header (40 bytes):
+//         u8  magic[8]     "GBVIDEO" and a NUL character
+//         u32 version      1
+//         u16 width
+//         u16 height
+//         u32 fps_num      Frames per second as a fraction, 4194304 / 70224
+//         u32 fps_den
+//         u32 audio_rate   Samples per second (0 if there is no audio)
+//         u32 frames       Number of video packets
+//         u64 audio_frames Number of stereo samples in all audio packets
+//
+//     Packets until the end of the file:
+//         u8  type         'V' (video) or 'A' (audio)
+//         u8  reserved[3]
+//         u32 size         Size of the data that follows
+//
+//     Video packets hold the zlib compressed XOR of the pixels of the frame
+//     (width * height u32 values, ARGB8888) and the ones of the previous frame,
+//     which is black for the first one. If the size is 0, the frame is the same
+//     as the previous one. Audio packets have 16 bit stereo samples, and they
+//     hold the audio generated during the previous video frame.
+
+typedef enum
+{
+    VIDEORECORD_FORMAT_GBV,
+    VIDEORECORD_FORMAT_FFMPEG,
+} _videorecord_format_e;
+
+// They can't be called while a frame is being emulated. Start returns 1 on
+// error, 0 if OK. The size is the one of all frames, up to 256x224.
+int VideoRecord_Start(const char *path, _videorecord_format_e format,
+                      int width, int height);
+void VideoRecord_Stop(void);
+
+int VideoRecord_IsActive(void);
+
+// Called from the emulation thread after each frame. It returns a buffer to
+// write the frame to in ARGB8888 format, then VideoRecord_FrameEnd() has to be
+// called. It never blocks. If the queue is full it returns NULL, and the frame
+// is counted as dropped.
+void *VideoRecord_FrameBegin(void);
+void VideoRecord_FrameEnd(void);
+
+#endif // VIDEORECORD_UTILS__
@@ -7,9 +7,11 @@
 extern "C"
 {
 #include <stdlib.h>
+#include <string.h>
 
 #include "config.h"
 #include "debug_utils.h"
+#include "general_utils.h"
 #include "webcam_utils.h"
 
 #include "gb_core/camera.h"
@@ -31,7 +33,7 @@ extern "C" int Webcam_GetFrame(void)
     for (int j = 0; j < GBCAM_SENSOR_H; j++)
     {
         for (int i = 0; i < GBCAM_SENSOR_W; i++)
-            gb_camera_webcam_output[i][j] = rand() & 0xFF;
+            gb_camera_webcam_output[i][j] = core_rand() & 0xFF;
     }
 
     return 0;
@@ -46,10 +48,115 @@ extern "C" void Webcam_End(void)
 
 #include "opencv2/opencv.hpp"
 
+#include <SDL.h>
+
+// The frames are captured by a thread of their own. Reading a frame from the
+// device blocks until the next one is ready, and that mustn't stall the
+// emulation. The thread keeps the latest one converted to greyscale at the size
+// of the sensor, and the emulation copies it when it takes a picture.
+
 static cv::VideoCapture cap;
 
 static int camera_enabled = 0;
-static int camera_zoomfactor = 1;
+
+typedef enum
+{
+    WEBCAM_ERROR_NONE,
+    WEBCAM_ERROR_NO_FRAME,
+    WEBCAM_ERROR_CHANNELS,
+} _webcam_error_e;
+
+static SDL_Thread *webcam_thread;
+static SDL_mutex *webcam_mutex;
+static SDL_atomic_t webcam_exit;
+static SDL_atomic_t webcam_error; // Set when the thread stops by an error
+static int webcam_error_channels;
+
+static int webcam_latest[GBCAM_SENSOR_W][GBCAM_SENSOR_H]; // webcam_mutex
+static int webcam_capture[GBCAM_SENSOR_W][GBCAM_SENSOR_H]; // Capture thread
+
+// Intermediate images of the conversion. They are kept so that they aren't
+// allocated again for every frame. Only used by the capture thread (or by
+// Webcam_Init() before it starts).
+static cv::Mat webcam_frame_8bit;
+static cv::Mat webcam_frame_grey;
+static cv::Mat webcam_frame_sensor;
+
+// Converts a frame to greyscale at the size of the sensor. Returns 0 on
+// success, or the error found.
+static int webcam_frame_convert(cv::Mat &frame,
+                                int out[GBCAM_SENSOR_W][GBCAM_SENSOR_H])
+{
+    int channels = frame.channels();
+    if (channels != 3)
+    {
+        webcam_error_channels = channels;
+        return WEBCAM_ERROR_CHANNELS;
+    }
+
+    // Only the biggest centered area with the aspect ratio of the sensor is
+    // used, the rest of the frame is cropped.
+    int w = frame.cols;
+    int h = (w * GBCAM_SENSOR_H) / GBCAM_SENSOR_W;
+    if (h > frame.rows)
+    {
+        h = frame.rows;
+        w = (h * GBCAM_SENSOR_W) / GBCAM_SENSOR_H;
+    }
+
+    cv::Mat roi = frame(cv::Rect((frame.cols - w) / 2, (frame.rows - h) / 2,
+                                 w, h));
+
+    if (roi.depth() != CV_8U)
+    {
+        roi.convertTo(webcam_frame_8bit, CV_8U);
+        roi = webcam_frame_8bit;
+    }
+
+    // OpenCV frames are BGR. Each pixel of the sensor is the average of the
+    // area of the frame that it covers.
+    cv::cvtColor(roi, webcam_frame_grey, cv::COLOR_BGR2GRAY);
+    cv::resize(webcam_frame_grey, webcam_frame_sensor,
+               cv::Size(GBCAM_SENSOR_W, GBCAM_SENSOR_H), 0, 0,
+               cv::INTER_AREA);
+
+    for (int j = 0; j < GBCAM_SENSOR_H; j++)
+    {
+        const unsigned char *row = webcam_frame_sensor.ptr<unsigned char>(j);
+
+        for (int i = 0; i < GBCAM_SENSOR_W; i++)
+            out[i][j] = row[i];
+    }
+
+    return WEBCAM_ERROR_NONE;
+}
+
+static int webcam_thread_fn(unused__ void *data)
+{
+    cv::Mat frame;
+
+    while (SDL_AtomicGet(&webcam_exit) == 0)
+    {
+        cap >> frame;
+
+        int error = WEBCAM_ERROR_NO_FRAME;
+        if (!frame.empty())
+            error = webcam_frame_convert(frame, webcam_capture);
+
+        if (error != WEBCAM_ERROR_NONE)
+        {
+            // The error is reported by the next call to Webcam_GetFrame()
+            SDL_AtomicSet(&webcam_error, error);
+            break;
+        }
+
+        SDL_LockMutex(webcam_mutex);
+        memcpy(webcam_latest, webcam_capture, sizeof(webcam_latest));
+        SDL_UnlockMutex(webcam_mutex);
+    }
+
+    return 0;
+}
 
 // Returns 1 on success
 extern "C" int Webcam_Init(void)
@@ -118,14 +225,39 @@ extern "C" int Webcam_Init(void)
         return 0;
     }
 
-    int xfactor = w / GBCAM_SENSOR_W;
-    int yfactor = h / GBCAM_SENSOR_H;
+    // The first frame is available before the thread captures any other one
+    if (webcam_frame_convert(frame, webcam_latest) != WEBCAM_ERROR_NONE)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("Invalid camera output.\n"
+                          "Channels = %d",
+                          webcam_error_channels);
+        return -1;
+    }
+
+    SDL_AtomicSet(&webcam_exit, 0);
+    SDL_AtomicSet(&webcam_error, WEBCAM_ERROR_NONE);
 
-    camera_zoomfactor = (xfactor > yfactor) ? yfactor : xfactor; // Min
+    webcam_mutex = SDL_CreateMutex();
+    if (webcam_mutex == NULL)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("%s: %s", __func__, SDL_GetError());
+        return 0;
+    }
+
+    webcam_thread = SDL_CreateThread(webcam_thread_fn, "Webcam", NULL);
+    if (webcam_thread == NULL)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("Couldn't create thread: %s", SDL_GetError());
+        return 0;
+    }
 
     return 1;
 }
 
+// It never waits for the device, it returns the latest frame captured
 extern "C" int Webcam_GetFrame(void)
 {
     if (camera_enabled == 0)
@@ -134,56 +266,33 @@ extern "C" int Webcam_GetFrame(void)
         for (int j = 0; j < GBCAM_SENSOR_H; j++)
         {
             for (int i = 0; i < GBCAM_SENSOR_W; i++)
-                gb_camera_webcam_output[i][j] = rand() & 0xFF;
-        }
-    }
-    else
-    {
-        // Get image
-        cv::Mat frame, convertedframe;
-        cap >> frame;
-        if (frame.empty())
-        {
-            Webcam_End();
-            Debug_ErrorMsgArg("OpenCV error: Couldn't get frame");
-            return -1;
+                gb_camera_webcam_output[i][j] = core_rand() & 0xFF;
         }
 
-        frame.convertTo(convertedframe, CV_8U);
-        unsigned char *p = convertedframe.data;
-
-        cv::Size size = convertedframe.size();
-        int w = size.width;
-        //int h = size.height;
-
-        int channels = convertedframe.channels();
-        if (channels != 3)
-        {
-            Debug_ErrorMsgArg("Invalid camera output.\n"
-                              "Channels = %d",
-                              channels);
-            return -1;
-        }
-
-        // How much to jump from one element of a row to the next one
-        int step = convertedframe.elemSize();
-
-        for (int j = 0; j < GBCAM_SENSOR_H; j++)
-        {
-            for (int i = 0; i < GBCAM_SENSOR_W; i++)
-            {
-                int index = ((j * camera_zoomfactor) * w * step)
-                            + ((i * camera_zoomfactor) * 3);
-
-                int r = p[index + 0];
-                int g = p[index + 1];
-                int b = p[index + 2];
+        return 0;
+    }
 
-                gb_camera_webcam_output[i][j] = (2 * r + 5 * g + 1 * b) >> 3;
-            }
-        }
+    int error = SDL_AtomicGet(&webcam_error);
+    if (error == WEBCAM_ERROR_NO_FRAME)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("OpenCV error: Couldn't get frame");
+        return -1;
+    }
+    else if (error == WEBCAM_ERROR_CHANNELS)
+    {
+        Webcam_End();
+        Debug_ErrorMsgArg("Invalid camera output.\n"
+                          "Channels = %d",
+                          webcam_error_channels);
+        return -1;
     }
 
+    SDL_LockMutex(webcam_mutex);
+    memcpy(gb_camera_webcam_output, webcam_latest,
+           sizeof(gb_camera_webcam_output));
+    SDL_UnlockMutex(webcam_mutex);
+
     return 0;
 }
 
@@ -192,6 +301,20 @@ extern "C" void Webcam_End(void)
     if (camera_enabled == 0)
         return;
 
+    // It waits until the frame that is being captured is ready
+    if (webcam_thread != NULL)
+    {
+        SDL_AtomicSet(&webcam_exit, 1);
+        SDL_WaitThread(webcam_thread, NULL);
+        webcam_thread = NULL;
+    }
+
+    if (webcam_mutex != NULL)
+    {
+        SDL_DestroyMutex(webcam_mutex);
+        webcam_mutex = NULL;
+    }
+
     cap.release();
 
     camera_enabled = 0;
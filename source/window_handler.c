@@ -4,9 +4,15 @@
 //
 // GiiBiiAdvance - GBA/GB emulator
 
+// If defined, the windows are drawn with OpenGL 3.3 instead of SDL renderers
 //#define OPENGL_BLIT
 
+#if defined(OPENGL_BLIT) && !defined(ENABLE_OPENGL)
+# error "OPENGL_BLIT requires ENABLE_OPENGL"
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <SDL.h>
@@ -15,6 +21,8 @@
 #endif
 
 #include "debug_utils.h"
+#include "general_utils.h"
+#include "latency_utils.h"
 #include "window_handler.h"
 
 #define MAX_WINDOWS 20
@@ -24,8 +32,17 @@ typedef struct
     // Window data
     SDL_Window *mWindow;
     SDL_Renderer *mRenderer;
-    SDL_GLContext GLContext;
     SDL_Texture *mTexture;
+    SDL_Texture *mTexturePrev; // Previous frame, only used with ghosting
+#ifdef OPENGL_BLIT
+    int mGLContextUser; // 1 if it's counted in gl_context_users
+    int mGLSwapInterval;
+    GLuint mGLTexture;
+    GLuint mGLTexturePrev;
+    // Pixel buffer object used to upload the texture. The copy to the texture
+    // is done by the driver asynchronously after it's unlocked.
+    GLuint mGLPixelBuffer;
+#endif
     int mWindowID;
 
     WH_CallbackFn mEventCallback;
@@ -37,6 +54,18 @@ typedef struct
     int mTexHeight;
     int mTexScale; // If 0, the texture will be scaled to window size. If not,
                    // it will be centered and scaled to this factor.
+    _wh_texture_format_e mTexFormat;
+    // Used by WH_TextureLock() when the pitch of the locked texture isn't the
+    // width of the texture, NULL if not needed.
+    void *mTexBuffer;
+    // Weight of the previous frame when presenting, from 0 (disabled) to 255.
+    // It only affects ARGB8888 textures.
+    int mGhosting;
+    int mTexFrames; // Frames written since the texture was created, up to 2
+    // Copy of the last buffer passed to WH_Render(), so that the windows whose
+    // contents haven't changed aren't uploaded and presented again.
+    void *mRenderCopy;
+    int mRenderCopyValid;
 
     // Window focus
     int mMouseFocus;
@@ -94,6 +123,664 @@ static void _wh_set_window_icon(SDL_Window *window)
 
 //------------------------------------------------------------------------------
 
+// Returns the area of the window where the texture has to be drawn. Returns 1
+// if the scale factor of the window can't be used.
+static int _wh_texture_get_dest_rect(WindowHandle *w, SDL_Rect *dst)
+{
+    if (w->mTexScale == 0)
+    {
+        dst->x = 0;
+        dst->y = 0;
+        dst->w = w->mWidth;
+        dst->h = w->mHeight;
+        return 0;
+    }
+
+    int x_size = w->mTexWidth * w->mTexScale;
+    int y_size = w->mTexHeight * w->mTexScale;
+    int x_offset = (w->mWidth - x_size) / 2;
+    int y_offset = (w->mHeight - y_size) / 2;
+
+    if ((x_offset < 0) || (y_offset < 0))
+    {
+        Debug_LogMsgArg("%s(): Invalid scaling. Using default.", __func__);
+        w->mTexScale = 0;
+        return 1;
+    }
+
+    dst->x = x_offset;
+    dst->y = y_offset;
+    dst->w = x_size;
+    dst->h = y_size;
+
+    return 0;
+}
+
+#ifdef OPENGL_BLIT
+
+// Functions that aren't part of OpenGL 1.1 have to be loaded at runtime
+#define WH_GL_FUNCTIONS(FN) \
+    FN(PFNGLACTIVETEXTUREPROC, ActiveTexture) \
+    FN(PFNGLATTACHSHADERPROC, AttachShader) \
+    FN(PFNGLBINDBUFFERPROC, BindBuffer) \
+    FN(PFNGLBINDVERTEXARRAYPROC, BindVertexArray) \
+    FN(PFNGLBUFFERDATAPROC, BufferData) \
+    FN(PFNGLCOMPILESHADERPROC, CompileShader) \
+    FN(PFNGLCREATEPROGRAMPROC, CreateProgram) \
+    FN(PFNGLCREATESHADERPROC, CreateShader) \
+    FN(PFNGLDELETEBUFFERSPROC, DeleteBuffers) \
+    FN(PFNGLDELETEPROGRAMPROC, DeleteProgram) \
+    FN(PFNGLDELETESHADERPROC, DeleteShader) \
+    FN(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays) \
+    FN(PFNGLGENBUFFERSPROC, GenBuffers) \
+    FN(PFNGLGENVERTEXARRAYSPROC, GenVertexArrays) \
+    FN(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog) \
+    FN(PFNGLGETPROGRAMIVPROC, GetProgramiv) \
+    FN(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog) \
+    FN(PFNGLGETSHADERIVPROC, GetShaderiv) \
+    FN(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation) \
+    FN(PFNGLLINKPROGRAMPROC, LinkProgram) \
+    FN(PFNGLMAPBUFFERRANGEPROC, MapBufferRange) \
+    FN(PFNGLSHADERSOURCEPROC, ShaderSource) \
+    FN(PFNGLUNIFORM1FPROC, Uniform1f) \
+    FN(PFNGLUNIFORM1IPROC, Uniform1i) \
+    FN(PFNGLUNMAPBUFFERPROC, UnmapBuffer) \
+    FN(PFNGLUSEPROGRAMPROC, UseProgram)
+
+#define WH_GL_DECLARE(type, name) type name;
+
+static struct
+{
+    WH_GL_FUNCTIONS(WH_GL_DECLARE)
+} gl;
+
+#undef WH_GL_DECLARE
+
+static int gl_functions_loaded = 0;
+
+// All windows share the same context, program and vertex array. Drawing to
+// another window only changes the surface that the context is bound to, the
+// driver doesn't have to switch contexts. They are created with the first
+// window and deleted with the last one.
+static SDL_GLContext gl_context = NULL;
+static int gl_context_users = 0;
+static GLuint gl_program = 0;
+static GLint gl_ghosting_location;
+static GLuint gl_vertex_array = 0;
+
+// Window that the context is bound to, NULL if it's unknown
+static WindowHandle *gl_current_window = NULL;
+
+// Returns 0 on success
+static int _wh_gl_load_functions(void)
+{
+    if (gl_functions_loaded)
+        return 0;
+
+#define WH_GL_LOAD(type, name)                                          \
+    gl.name = (type)SDL_GL_GetProcAddress("gl" #name);                  \
+    if (gl.name == NULL)                                                \
+    {                                                                   \
+        Debug_LogMsgArg("Couldn't load OpenGL function: gl" #name);     \
+        return 1;                                                       \
+    }
+
+    WH_GL_FUNCTIONS(WH_GL_LOAD)
+
+#undef WH_GL_LOAD
+
+    gl_functions_loaded = 1;
+    return 0;
+}
+
+// The quad is generated from the vertex index, so no vertex buffer is needed.
+// The texture is scaled with nearest filtering by the sampler. With ghosting,
+// the previous frame is blended with the current one.
+static const char *gl_vertex_shader_source =
+    "#version 330 core\n"
+    "out vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pos = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "    uv = vec2(pos.x, 1.0 - pos.y);\n"
+    "    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *gl_fragment_shader_source =
+    "#version 330 core\n"
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    "uniform sampler2D screen;\n"
+    "uniform sampler2D previous;\n"
+    "uniform float ghosting;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 rgb = mix(texture(screen, uv).rgb, texture(previous, uv).rgb,\n"
+    "                   ghosting);\n"
+    "    color = vec4(rgb, 1.0);\n"
+    "}\n";
+
+// Returns 0 on error
+static GLuint _wh_gl_shader_compile(GLenum type, const char *source)
+{
+    GLuint shader = gl.CreateShader(type);
+    if (shader == 0)
+        return 0;
+
+    gl.ShaderSource(shader, 1, &source, NULL);
+    gl.CompileShader(shader);
+
+    GLint status;
+    gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+        char log[512];
+        gl.GetShaderInfoLog(shader, sizeof(log), NULL, log);
+        Debug_LogMsgArg("Couldn't compile shader: %s", log);
+        gl.DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+// Returns 0 on error
+static GLuint _wh_gl_program_create(void)
+{
+    GLuint vertex = _wh_gl_shader_compile(GL_VERTEX_SHADER,
+                                          gl_vertex_shader_source);
+    GLuint fragment = _wh_gl_shader_compile(GL_FRAGMENT_SHADER,
+                                            gl_fragment_shader_source);
+
+    GLuint program = 0;
+
+    if ((vertex != 0) && (fragment != 0))
+        program = gl.CreateProgram();
+
+    if (program != 0)
+    {
+        gl.AttachShader(program, vertex);
+        gl.AttachShader(program, fragment);
+        gl.LinkProgram(program);
+
+        GLint status;
+        gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE)
+        {
+            char log[512];
+            gl.GetProgramInfoLog(program, sizeof(log), NULL, log);
+            Debug_LogMsgArg("Couldn't link shaders: %s", log);
+            gl.DeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    // The shaders are freed when the program is deleted
+    if (vertex != 0)
+        gl.DeleteShader(vertex);
+    if (fragment != 0)
+        gl.DeleteShader(fragment);
+
+    if (program != 0)
+    {
+        gl.UseProgram(program);
+        gl.Uniform1i(gl.GetUniformLocation(program, "screen"), 0);
+        gl.Uniform1i(gl.GetUniformLocation(program, "previous"), 1);
+    }
+
+    return program;
+}
+
+static void _wh_gl_make_current(WindowHandle *w)
+{
+    if (gl_current_window == w)
+        return;
+
+    SDL_GL_MakeCurrent(w->mWindow, gl_context);
+    gl_current_window = w;
+
+    // In some systems the swap interval belongs to the context, not to the
+    // window, so it has to be set again for each window.
+    SDL_GL_SetSwapInterval(w->mGLSwapInterval);
+}
+
+static GLenum _wh_gl_texture_format(WindowHandle *w)
+{
+    if (w->mTexFormat == WH_TEXTURE_ARGB8888)
+        return GL_BGRA;
+
+    return GL_RGB;
+}
+
+static GLenum _wh_gl_texture_type(WindowHandle *w)
+{
+    if (w->mTexFormat == WH_TEXTURE_ARGB8888)
+        return GL_UNSIGNED_INT_8_8_8_8_REV;
+
+    return GL_UNSIGNED_BYTE;
+}
+
+// Returns 0 on error
+static GLuint _wh_gl_texture_new(WindowHandle *w)
+{
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w->mTexWidth, w->mTexHeight, 0,
+                 _wh_gl_texture_format(w), _wh_gl_texture_type(w), NULL);
+
+    return texture;
+}
+
+#endif // OPENGL_BLIT
+
+static int _wh_texture_get_size(WindowHandle *w)
+{
+    if (w->mTexFormat == WH_TEXTURE_ARGB8888)
+        return w->mTexWidth * w->mTexHeight * 4;
+
+    return w->mTexWidth * w->mTexHeight * 3;
+}
+
+// The previous frame is kept in a second texture. Each new frame is written to
+// the texture that holds the oldest one, so nothing is copied.
+static int _wh_texture_has_ghosting(WindowHandle *w)
+{
+    return (w->mGhosting != 0) && (w->mTexFormat == WH_TEXTURE_ARGB8888);
+}
+
+static void _wh_texture_swap(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    GLuint texture = w->mGLTexture;
+    w->mGLTexture = w->mGLTexturePrev;
+    w->mGLTexturePrev = texture;
+#else
+    SDL_Texture *texture = w->mTexture;
+    w->mTexture = w->mTexturePrev;
+    w->mTexturePrev = texture;
+#endif
+}
+
+// Returns the weight of the previous frame to use when presenting the texture
+static int _wh_texture_get_ghosting(WindowHandle *w)
+{
+    if (!_wh_texture_has_ghosting(w) || (w->mTexFrames < 2))
+        return 0;
+
+    return w->mGhosting;
+}
+
+// Returns 0 on success
+static int _wh_renderer_create(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    if (gl_context == NULL)
+    {
+        gl_context = SDL_GL_CreateContext(w->mWindow);
+        if (gl_context == NULL)
+        {
+            Debug_LogMsgArg("OpenGL context could not be created! "
+                            "SDL Error: %s\n", SDL_GetError());
+            return 1;
+        }
+        gl_current_window = NULL;
+    }
+
+    w->mGLContextUser = 1;
+    w->mGLSwapInterval = 0;
+    gl_context_users++;
+
+    _wh_gl_make_current(w);
+
+    if (gl_program != 0)
+        return 0;
+
+    if (_wh_gl_load_functions() != 0)
+        return 1;
+
+    gl_program = _wh_gl_program_create();
+    if (gl_program == 0)
+        return 1;
+
+    gl_ghosting_location = gl.GetUniformLocation(gl_program, "ghosting");
+
+    // Core profiles can't draw without a vertex array, even an empty one
+    gl.GenVertexArrays(1, &gl_vertex_array);
+
+    return 0;
+#else
+    int oglIdx = -1;
+    int nRD = SDL_GetNumRenderDrivers();
+
+    for (int i = 0; i < nRD; i++)
+    {
+        SDL_RendererInfo info;
+        if (!SDL_GetRenderDriverInfo(i, &info))
+        {
+            if (!strcmp(info.name, "opengl"))
+            {
+                oglIdx = i;
+                break;
+            }
+        }
+    }
+
+    // Create renderer for window
+    w->mRenderer = SDL_CreateRenderer(w->mWindow, oglIdx,
+                                   // SDL_RENDERER_PRESENTVSYNC |
+                                      SDL_RENDERER_ACCELERATED);
+    //SDL_SetWindowFullscreen(w->mWindow, SDL_WINDOW_FULLSCREEN);
+    if (w->mRenderer == NULL)
+    {
+        Debug_LogMsgArg("Renderer could not be created! SDL Error: %s\n",
+                        SDL_GetError());
+        return 1;
+    }
+
+    // SDL_RenderSetLogicalSize(w->mRenderer, w->mWidth, w->mHeight);
+
+    return 0;
+#endif
+}
+
+static void _wh_renderer_destroy(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    if (w->mGLContextUser == 0)
+        return;
+
+    w->mGLContextUser = 0;
+    gl_context_users--;
+
+    if (gl_context_users > 0)
+    {
+        // SDL unbinds the context when the window is destroyed
+        if (gl_current_window == w)
+            gl_current_window = NULL;
+        return;
+    }
+
+    _wh_gl_make_current(w);
+
+    if (gl_vertex_array != 0)
+        gl.DeleteVertexArrays(1, &gl_vertex_array);
+    gl_vertex_array = 0;
+
+    if (gl_program != 0)
+        gl.DeleteProgram(gl_program);
+    gl_program = 0;
+
+    SDL_GL_DeleteContext(gl_context);
+    gl_context = NULL;
+    gl_current_window = NULL;
+#else
+    // The renderer is destroyed with the window
+    w->mRenderer = NULL;
+#endif
+}
+
+// Returns 0 on success
+static int _wh_texture_create(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    _wh_gl_make_current(w);
+
+    w->mTexFrames = 0;
+
+    w->mGLTexture = _wh_gl_texture_new(w);
+    if (_wh_texture_has_ghosting(w))
+    {
+        w->mGLTexturePrev = _wh_gl_texture_new(w);
+        if (w->mGLTexturePrev == 0)
+        {
+            Debug_LogMsgArg("Couldn't create texture!");
+            return 1;
+        }
+    }
+
+    gl.GenBuffers(1, &w->mGLPixelBuffer);
+    gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, w->mGLPixelBuffer);
+    gl.BufferData(GL_PIXEL_UNPACK_BUFFER, _wh_texture_get_size(w), NULL,
+                  GL_STREAM_DRAW);
+    gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if ((w->mGLTexture == 0) || (w->mGLPixelBuffer == 0))
+    {
+        Debug_LogMsgArg("Couldn't create texture!");
+        return 1;
+    }
+
+    return 0;
+#else
+    Uint32 format = SDL_PIXELFORMAT_RGB24;
+    if (w->mTexFormat == WH_TEXTURE_ARGB8888)
+        format = SDL_PIXELFORMAT_ARGB8888;
+
+    w->mTexture = SDL_CreateTexture(w->mRenderer, format,
+                                    SDL_TEXTUREACCESS_STREAMING,
+                                    w->mTexWidth, w->mTexHeight);
+    if (w->mTexture == NULL)
+    {
+        Debug_LogMsgArg("Couldn't create texture! SDL Error: %s\n",
+                        SDL_GetError());
+        return 1;
+    }
+
+    w->mTexFrames = 0;
+
+    if (_wh_texture_has_ghosting(w))
+    {
+        w->mTexturePrev = SDL_CreateTexture(w->mRenderer, format,
+                                            SDL_TEXTUREACCESS_STREAMING,
+                                            w->mTexWidth, w->mTexHeight);
+        if (w->mTexturePrev == NULL)
+        {
+            Debug_LogMsgArg("Couldn't create texture! SDL Error: %s\n",
+                            SDL_GetError());
+            return 1;
+        }
+
+        // Both textures are drawn with blending, they are swapped every frame
+        SDL_SetTextureBlendMode(w->mTexture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureBlendMode(w->mTexturePrev, SDL_BLENDMODE_BLEND);
+    }
+
+    return 0;
+#endif
+}
+
+static void _wh_texture_destroy(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    _wh_gl_make_current(w);
+
+    if (w->mGLTexture != 0)
+        glDeleteTextures(1, &w->mGLTexture);
+    w->mGLTexture = 0;
+
+    if (w->mGLTexturePrev != 0)
+        glDeleteTextures(1, &w->mGLTexturePrev);
+    w->mGLTexturePrev = 0;
+
+    if (w->mGLPixelBuffer != 0)
+        gl.DeleteBuffers(1, &w->mGLPixelBuffer);
+    w->mGLPixelBuffer = 0;
+#else
+    if (w->mTexture != NULL)
+        SDL_DestroyTexture(w->mTexture);
+    w->mTexture = NULL;
+
+    if (w->mTexturePrev != NULL)
+        SDL_DestroyTexture(w->mTexturePrev);
+    w->mTexturePrev = NULL;
+#endif
+
+    free(w->mTexBuffer);
+    w->mTexBuffer = NULL;
+
+    free(w->mRenderCopy);
+    w->mRenderCopy = NULL;
+    w->mRenderCopyValid = 0;
+}
+
+static int _wh_texture_exists(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    return w->mGLTexture != 0;
+#else
+    return w->mTexture != NULL;
+#endif
+}
+
+// Returns a buffer with the size returned by _wh_texture_get_size(), or NULL
+static void *_wh_texture_lock(WindowHandle *w)
+{
+    if (_wh_texture_has_ghosting(w))
+        _wh_texture_swap(w);
+
+#ifdef OPENGL_BLIT
+    _wh_gl_make_current(w);
+
+    // Orphan the old contents of the buffer so that the driver doesn't have to
+    // wait until the previous upload is finished before mapping it.
+    int size = _wh_texture_get_size(w);
+    gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, w->mGLPixelBuffer);
+    gl.BufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *pixels = gl.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                     GL_MAP_WRITE_BIT
+                                     | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (pixels == NULL)
+    {
+        gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (_wh_texture_has_ghosting(w))
+            _wh_texture_swap(w);
+    }
+
+    return pixels;
+#else
+    if (w->mTexBuffer != NULL)
+        return w->mTexBuffer;
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(w->mTexture, NULL, &pixels, &pitch) != 0)
+    {
+        if (_wh_texture_has_ghosting(w))
+            _wh_texture_swap(w);
+        return NULL;
+    }
+
+    if ((pitch * w->mTexHeight) == _wh_texture_get_size(w))
+        return pixels;
+
+    // The rows of the texture are padded, so it can't be written directly.
+    // Use an intermediate buffer from now on.
+    SDL_UnlockTexture(w->mTexture);
+
+    w->mTexBuffer = malloc(_wh_texture_get_size(w));
+    return w->mTexBuffer;
+#endif
+}
+
+static void _wh_texture_unlock(WindowHandle *w)
+{
+    if (w->mTexFrames < 2)
+        w->mTexFrames++;
+
+#ifdef OPENGL_BLIT
+    _wh_gl_make_current(w);
+
+    // The buffer is still bound from _wh_texture_lock(). The copy from the
+    // buffer to the texture doesn't block, it's done by the GPU later.
+    gl.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, w->mGLTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w->mTexWidth, w->mTexHeight,
+                    _wh_gl_texture_format(w), _wh_gl_texture_type(w), NULL);
+
+    gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#else
+    if (w->mTexBuffer != NULL)
+    {
+        int pitch = _wh_texture_get_size(w) / w->mTexHeight;
+        SDL_UpdateTexture(w->mTexture, NULL, w->mTexBuffer, pitch);
+        return;
+    }
+
+    SDL_UnlockTexture(w->mTexture);
+#endif
+}
+
+static void _wh_present(WindowHandle *w)
+{
+    SDL_Rect dst;
+
+#ifdef OPENGL_BLIT
+    _wh_gl_make_current(w);
+
+    glViewport(0, 0, w->mWidth, w->mHeight);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (_wh_texture_get_dest_rect(w, &dst) != 0)
+        return;
+
+    // The origin of the viewport is the bottom left corner of the window
+    glViewport(dst.x, w->mHeight - dst.y - dst.h, dst.w, dst.h);
+
+    gl.UseProgram(gl_program);
+    gl.Uniform1f(gl_ghosting_location, _wh_texture_get_ghosting(w) / 255.0f);
+    gl.BindVertexArray(gl_vertex_array);
+    gl.ActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, w->mGLTexturePrev);
+    gl.ActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, w->mGLTexture);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    SDL_GL_SwapWindow(w->mWindow);
+#else
+    SDL_RenderClear(w->mRenderer);
+
+    if (_wh_texture_get_dest_rect(w, &dst) != 0)
+        return;
+
+    if (w->mTexturePrev != NULL)
+        SDL_SetTextureAlphaMod(w->mTexture, 255);
+
+    SDL_RenderCopy(w->mRenderer, w->mTexture, NULL, &dst);
+
+    int ghosting = _wh_texture_get_ghosting(w);
+    if (ghosting != 0)
+    {
+        SDL_SetTextureAlphaMod(w->mTexturePrev, ghosting);
+        SDL_RenderCopy(w->mRenderer, w->mTexturePrev, NULL, &dst);
+    }
+
+    SDL_RenderPresent(w->mRenderer);
+#endif
+}
+
+// Shows the last frame again, for example after the window has been covered
+static void _wh_repaint(WindowHandle *w)
+{
+#ifdef OPENGL_BLIT
+    _wh_present(w);
+#else
+    SDL_RenderPresent(w->mRenderer);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
 // Returns -1 on error
 int WH_Create(int width, int height, int texw, int texh, int scale)
 {
@@ -126,9 +813,22 @@ int WH_Create(int width, int height, int texw, int texh, int scale)
     w->mShown = 0;
     w->mWindowID = -1;
     w->mTexScale = scale;
+    w->mTexFormat = WH_TEXTURE_RGB24;
+    w->mTexture = NULL;
+    w->mTexturePrev = NULL;
+    w->mTexBuffer = NULL;
+    w->mGhosting = 0;
+    w->mRenderCopy = NULL;
+    w->mRenderCopyValid = 0;
 
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 0);
+#ifdef OPENGL_BLIT
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                        SDL_GL_CONTEXT_PROFILE_CORE);
+#endif
 
     // Create window
     w->mWindow = SDL_CreateWindow("Window", SDL_WINDOWPOS_UNDEFINED,
@@ -149,54 +849,26 @@ int WH_Create(int width, int height, int texw, int texh, int scale)
     w->mHeight = height;
     w->mTexWidth = texw;
     w->mTexHeight = texh;
-    w->GLContext = SDL_GL_CreateContext(w->mWindow);
-
-    int oglIdx = -1;
-    int nRD = SDL_GetNumRenderDrivers();
 
-    for (int i = 0; i < nRD; i++)
-    {
-        SDL_RendererInfo info;
-        if (!SDL_GetRenderDriverInfo(i, &info))
-        {
-            if (!strcmp(info.name, "opengl"))
-            {
-                oglIdx = i;
-                break;
-            }
-        }
-    }
-
-    // Create renderer for window
-    w->mRenderer = SDL_CreateRenderer(w->mWindow, oglIdx,
-                                   // SDL_RENDERER_PRESENTVSYNC |
-                                      SDL_RENDERER_ACCELERATED);
-    //SDL_SetWindowFullscreen(w->mWindow, SDL_WINDOW_FULLSCREEN);
-    if (w->mRenderer == NULL)
+    if (_wh_renderer_create(w) != 0)
     {
-        Debug_LogMsgArg("Renderer could not be created! SDL Error: %s\n",
-                        SDL_GetError());
+        _wh_renderer_destroy(w);
         SDL_DestroyWindow(w->mWindow);
         w->mWindow = NULL;
 
         return -1;
     }
 
-    // SDL_RenderSetLogicalSize(w->mRenderer, w->mWidth, w->mHeight);
-
     // Grab window identifier
     w->mWindowID = SDL_GetWindowID(w->mWindow);
     w->mShown = 1; // Flag as opened
 
-    w->mTexture = SDL_CreateTexture(w->mRenderer, SDL_PIXELFORMAT_RGB24,
-                                    SDL_TEXTUREACCESS_STREAMING, texw, texh);
-    if (w->mTexture == NULL)
+    // TODO: The error message shows even if everything is correct...
+    if (_wh_texture_create(w) != 0)
     {
-        // TODO: This message shows even if everything is correct...
-        Debug_LogMsgArg("Couldn't create texture! SDL Error: %s\n",
-                        SDL_GetError());
+        _wh_texture_destroy(w);
+        _wh_renderer_destroy(w);
         SDL_DestroyWindow(w->mWindow);
-        SDL_GL_DeleteContext(w->GLContext);
         w->mWindow = NULL;
 
         return -1;
@@ -215,6 +887,7 @@ void WH_SetSize(int index, int width, int height, int texw, int texh, int scale)
         texh = height;
 
     w->mTexScale = scale;
+    w->mRenderCopyValid = 0;
 
     if (!((w->mWidth == width) && (w->mHeight == height)))
     {
@@ -227,18 +900,76 @@ void WH_SetSize(int index, int width, int height, int texw, int texh, int scale)
     {
         w->mTexWidth = texw;
         w->mTexHeight = texh;
-        SDL_DestroyTexture(w->mTexture);
-        w->mTexture = SDL_CreateTexture(w->mRenderer, SDL_PIXELFORMAT_RGB24,
-                                        SDL_TEXTUREACCESS_STREAMING,
-                                        texw, texh);
-        if (w->mTexture == NULL)
-        {
-            Debug_LogMsgArg("Couldn't create texture! SDL Error: %s\n",
-                            SDL_GetError());
-        }
+        _wh_texture_destroy(w);
+        _wh_texture_create(w);
     }
 }
 
+void WH_SetTextureFormat(int index, _wh_texture_format_e format)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if ((w == NULL) || (w->mWindow == NULL))
+        return;
+
+    if (w->mTexFormat == format)
+        return;
+
+    w->mTexFormat = format;
+    _wh_texture_destroy(w);
+    _wh_texture_create(w);
+}
+
+void WH_SetTextureGhosting(int index, int strength)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if ((w == NULL) || (w->mWindow == NULL))
+        return;
+
+    if (strength < 0)
+        strength = 0;
+    else if (strength > 255)
+        strength = 255;
+
+    int had_ghosting = (w->mGhosting != 0);
+
+    w->mGhosting = strength;
+
+    // The texture of the previous frame is only created when it's needed
+    if (had_ghosting != (strength != 0))
+    {
+        _wh_texture_destroy(w);
+        _wh_texture_create(w);
+    }
+}
+
+void *WH_TextureLock(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if ((w == NULL) || (w->mWindow == NULL) || (!_wh_texture_exists(w)))
+        return NULL;
+
+    if (w->mTexFormat != WH_TEXTURE_ARGB8888)
+        return NULL;
+
+    // The texture won't match the copy of the last rendered buffer
+    w->mRenderCopyValid = 0;
+
+    return _wh_texture_lock(w);
+}
+
+void WH_TextureUnlock(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
+
+    if ((w == NULL) || (w->mWindow == NULL) || (!_wh_texture_exists(w)))
+        return;
+
+    _wh_texture_unlock(w);
+}
+
 static void _wh_free_from_handle(WindowHandle *w)
 {
     if (w == gMainWindow)
@@ -246,8 +977,8 @@ static void _wh_free_from_handle(WindowHandle *w)
 
     if (w->mWindow != NULL)
     {
-        SDL_DestroyTexture(w->mTexture);
-        SDL_GL_DeleteContext(w->GLContext);
+        _wh_texture_destroy(w);
+        _wh_renderer_destroy(w);
         SDL_DestroyWindow(w->mWindow);
     }
 
@@ -327,7 +1058,7 @@ static int _wh_handle_event(SDL_Event *e)
 
             // Repaint on expose
             case SDL_WINDOWEVENT_EXPOSED:
-                SDL_RenderPresent(w->mRenderer);
+                _wh_repaint(w);
                 break;
 
             // Mouse enter
@@ -418,6 +1149,8 @@ void WH_HandleEvents(void)
 
     while (SDL_PollEvent(&e))
     {
+        Latency_InputEvent(&e);
+
         // Handle window events
         if (_wh_handle_event(&e) == 0)
         {
@@ -430,6 +1163,11 @@ void WH_HandleEvents(void)
     }
 }
 
+void WH_WaitEvents(int timeout_ms)
+{
+    SDL_WaitEventTimeout(NULL, timeout_ms);
+}
+
 void WH_SetCaption(int index, const char *caption)
 {
     WindowHandle *w = _wh_get_from_index(index);
@@ -449,90 +1187,121 @@ void WH_Render(int index, const char *buffer)
     if (w->mWindow == NULL)
         return;
 
-    SDL_UpdateTexture(w->mTexture, NULL, (void *)buffer, w->mTexWidth * 3);
+    // The debugger windows are redrawn every frame even if nothing changes. If
+    // the buffer is the same as the last one, the texture and the window still
+    // show it. The main window is always presented, it may be synchronised
+    // with the display.
+    size_t size = w->mTexWidth * w->mTexHeight * 3;
+    int copy = (w != gMainWindow) && !_wh_texture_has_ghosting(w);
 
-#ifdef OPENGL_BLIT
-    glEnable(GL_TEXTURE_2D);
-    glDisable(GL_DEPTH_TEST);
+    if (copy && w->mRenderCopyValid
+        && (memcmp(w->mRenderCopy, buffer, size) == 0))
+    {
+        return;
+    }
 
-    glClearColor(0, 0, 0, 0);
-    glViewport(0, 0, w->mWidth, w->mHeight);
+    if (w->mTexFormat == WH_TEXTURE_ARGB8888)
+    {
+        u32 *dst = WH_TextureLock(index);
+        if (dst != NULL)
+        {
+            const u8 *src = (const u8 *)buffer;
+            int pixels = w->mTexWidth * w->mTexHeight;
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+            for (int i = 0; i < pixels; i++, src += 3)
+                dst[i] = 0xFF000000 | (src[0] << 16) | (src[1] << 8) | src[2];
 
-    glOrtho(0.0, w->mWidth, w->mHeight, 0.0, -1.0, 1.0);
+            WH_TextureUnlock(index);
+        }
+    }
+    else if (_wh_texture_exists(w))
+    {
+#ifdef OPENGL_BLIT
+        void *dst = _wh_texture_lock(w);
+        if (dst != NULL)
+        {
+            memcpy(dst, buffer, _wh_texture_get_size(w));
+            _wh_texture_unlock(w);
+        }
+#else
+        SDL_UpdateTexture(w->mTexture, NULL, (void *)buffer, w->mTexWidth * 3);
+#endif
+    }
 
-    glMatrixMode(GL_MODELVIEW);
+    if (copy)
+    {
+        if (w->mRenderCopy == NULL)
+            w->mRenderCopy = malloc(size);
 
-    glClear(GL_COLOR_BUFFER_BIT); // Clear screen
+        if (w->mRenderCopy != NULL)
+        {
+            memcpy(w->mRenderCopy, buffer, size);
+            w->mRenderCopyValid = 1;
+        }
+    }
 
-    SDL_GL_BindTexture(w->mTexture, NULL, NULL); // Returns 0 if OK
+    _wh_present(w);
+}
 
-    if (w->mTexScale)
-    {
-        glColor3f(1.0, 1.0, 1.0);
-        glBegin(GL_QUADS);
+void WH_RenderTexture(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
 
-        glTexCoord2i(0, 0); // Top-left vertex
-        glVertex3f(0, 0, 0);
+    if (w == NULL)
+        return;
+    if (w->mWindow == NULL)
+        return;
 
-        glTexCoord2i(w->mTexWidth, 0); // Bottom-left vertex
-        glVertex3f(w->mWidth, 0, 0);
+    _wh_present(w);
+}
 
-        glTexCoord2i(w->mTexWidth, w->mTexHeight); // Bottom-right vertex
-        glVertex3f(w->mWidth, w->mHeight, 0);
+int WH_SetVSync(int index, int enable)
+{
+    WindowHandle *w = _wh_get_from_index(index);
 
-        glTexCoord2i(0, w->mTexHeight); // Top-right vertex
-        glVertex3f(0, w->mHeight, 0);
+    if ((w == NULL) || (w->mWindow == NULL))
+        return 1;
 
-        glEnd();
-    }
-    else
+#ifdef OPENGL_BLIT
+    _wh_gl_make_current(w);
+
+    if (SDL_GL_SetSwapInterval(enable ? 1 : 0) != 0)
     {
-        // TODO: Render window with autoscale
+        SDL_GL_SetSwapInterval(w->mGLSwapInterval);
+        return 1;
     }
 
-#else
-
-    SDL_RenderClear(w->mRenderer);
+    w->mGLSwapInterval = enable ? 1 : 0;
 
-    if (w->mTexScale == 0)
-    {
-        SDL_RenderCopy(w->mRenderer, w->mTexture, NULL, NULL);
-    }
-    else
-    {
-        int x_size = w->mTexWidth * w->mTexScale;
-        int y_size = w->mTexHeight * w->mTexScale;
-        int x_offset = (w->mWidth - x_size) / 2;
-        int y_offset = (w->mHeight - y_size) / 2;
+    return 0;
+#elif SDL_VERSION_ATLEAST(2, 0, 18)
+    if (SDL_RenderSetVSync(w->mRenderer, enable ? 1 : 0) != 0)
+        return 1;
 
-        if ((x_offset < 0) || (y_offset < 0))
-        {
-            Debug_LogMsgArg("%s(): Invalid scaling. Using default.", __func__);
-            w->mTexScale = 0;
-            return;
-        }
+    return 0;
+#else
+    // It can only be set when creating the renderer
+    (void)enable;
+    return 1;
+#endif
+}
 
-        SDL_Rect src;
-        src.x = 0;
-        src.y = 0;
-        src.w = w->mTexWidth;
-        src.h = w->mTexHeight;
+int WH_GetRefreshRate(int index)
+{
+    WindowHandle *w = _wh_get_from_index(index);
 
-        SDL_Rect dst;
-        dst.x = x_offset;
-        dst.y = y_offset;
-        dst.w = x_size;
-        dst.h = y_size;
+    if ((w == NULL) || (w->mWindow == NULL))
+        return 0;
 
-        SDL_RenderCopy(w->mRenderer, w->mTexture, &src, &dst);
-    }
+    int display = SDL_GetWindowDisplayIndex(w->mWindow);
+    if (display < 0)
+        return 0;
 
-#endif // OPENGL_BLIT
+    SDL_DisplayMode mode;
+    if (SDL_GetCurrentDisplayMode(display, &mode) != 0)
+        return 0;
 
-    SDL_RenderPresent(w->mRenderer);
+    return mode.refresh_rate;
 }
 
 int WH_AreAllWindowsClosed(void)
@@ -9,6 +9,12 @@
 
 typedef int (*WH_CallbackFn)(SDL_Event *);
 
+typedef enum
+{
+    WH_TEXTURE_RGB24, // Default
+    WH_TEXTURE_ARGB8888 // 0xAARRGGBB in native endianness
+} _wh_texture_format_e;
+
 void WH_Init(void);
 
 // if scale = 0 texture will be scaled to window size. If not, centered and
@@ -25,11 +31,38 @@ int WH_SetEventCallback(int index, WH_CallbackFn fn);
 int WH_SetEventMainWindow(int index);
 
 void WH_HandleEvents(void);
+// Sleeps until there is an event to handle or until the timeout ends. The event
+// is left in the queue for WH_HandleEvents().
+void WH_WaitEvents(int timeout_ms);
 
 void WH_SetCaption(int index, const char *caption);
 
+// The buffer is always 24-bit RGB, it's converted if the texture isn't
 void WH_Render(int index, const char *buffer);
 
+// ARGB8888 textures are the native format of most renderers, so they can be
+// written directly with WH_TextureLock() instead of converting a buffer. The
+// texture is recreated when the format changes, and its contents are undefined
+// until all of it is written.
+void WH_SetTextureFormat(int index, _wh_texture_format_e format);
+// Blends the previous frame of ARGB8888 textures with the current one when
+// they are presented, with a weight from 0 (disabled) to 255. It's done by the
+// GPU, the frames are only uploaded once. The texture is recreated when
+// ghosting is enabled or disabled.
+void WH_SetTextureGhosting(int index, int strength);
+// Returns a buffer of texw * texh 32-bit pixels, without padding, where the
+// next contents of the texture have to be written. Returns NULL on error or if
+// the texture isn't ARGB8888. WH_TextureUnlock() has to be called after it.
+void *WH_TextureLock(int index);
+void WH_TextureUnlock(int index);
+// Shows the current contents of the texture
+void WH_RenderTexture(int index);
+
+// Returns 0 on success, 1 if presentation can't be synchronised with VSync
+int WH_SetVSync(int index, int enable);
+// Returns the refresh rate of the display of the window in Hz, 0 if unknown
+int WH_GetRefreshRate(int index);
+
 void WH_Close(int index);
 void WH_CloseAllBut(int index);
 void WH_CloseAllButMain(void);
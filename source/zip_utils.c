@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "debug_utils.h"
+#include "general_utils.h"
+#include "zip_utils.h"
+
+#define ZIP_END_SIGNATURE           (0x06054B50)
+#define ZIP_END_SIZE                (22)
+#define ZIP_COMMENT_MAX_SIZE        (0xFFFF)
+
+#define ZIP_CENTRAL_SIGNATURE       (0x02014B50)
+#define ZIP_CENTRAL_SIZE            (46)
+
+#define ZIP_LOCAL_SIGNATURE         (0x04034B50)
+#define ZIP_LOCAL_SIZE              (30)
+
+#define ZIP_FLAG_ENCRYPTED          (1 << 0)
+
+#define ZIP_METHOD_STORED           (0)
+#define ZIP_METHOD_DEFLATED         (8)
+
+// Size of the blocks of compressed data read from the archive
+#define ZIP_READ_BLOCK_SIZE         (64 * 1024)
+
+//------------------------------------------------------------------------------
+
+static u32 Zip_Read16(const u8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static u32 Zip_Read32(const u8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+//------------------------------------------------------------------------------
+
+int Zip_IsArchive(const char *path)
+{
+    size_t len = strlen(path);
+    if (len < 4)
+        return 0;
+
+    const char *ext = &path[len - 4];
+
+    if ((ext[0] == '.') && (toupper(ext[1]) == 'Z')
+        && (toupper(ext[2]) == 'I') && (toupper(ext[3]) == 'P'))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+// Reads the central directory of the archive to a new buffer. Returns NULL on
+// error, and the size of the directory and number of entries otherwise.
+static u8 *Zip_CentralDirectoryRead(FILE *f, const char *path, u32 *size,
+                                    u32 *entries)
+{
+    if (fseek(f, 0, SEEK_END) != 0)
+        return NULL;
+
+    long file_size = ftell(f);
+    if (file_size < ZIP_END_SIZE)
+    {
+        Debug_ErrorMsgArg("%s isn't a valid ZIP archive!", path);
+        return NULL;
+    }
+
+    // The end record is at the end of the archive before an optional comment
+    long tail_size = ZIP_END_SIZE + ZIP_COMMENT_MAX_SIZE;
+    if (tail_size > file_size)
+        tail_size = file_size;
+
+    u8 *tail = malloc(tail_size);
+    if (tail == NULL)
+        return NULL;
+
+    if ((fseek(f, file_size - tail_size, SEEK_SET) != 0)
+        || (fread(tail, tail_size, 1, f) != 1))
+    {
+        Debug_ErrorMsgArg("Error while reading: %s", path);
+        free(tail);
+        return NULL;
+    }
+
+    const u8 *end = NULL;
+    for (long i = tail_size - ZIP_END_SIZE; i >= 0; i--)
+    {
+        if (Zip_Read32(&tail[i]) == ZIP_END_SIGNATURE)
+        {
+            end = &tail[i];
+            break;
+        }
+    }
+
+    if (end == NULL)
+    {
+        Debug_ErrorMsgArg("%s isn't a valid ZIP archive!", path);
+        free(tail);
+        return NULL;
+    }
+
+    *entries = Zip_Read16(&end[10]);
+    *size = Zip_Read32(&end[12]);
+    u32 offset = Zip_Read32(&end[16]);
+
+    free(tail);
+
+    if (((long)offset + (long)*size) > file_size)
+    {
+        Debug_ErrorMsgArg("%s isn't a valid ZIP archive!", path);
+        return NULL;
+    }
+
+    u8 *directory = malloc(*size + 1);
+    if (directory == NULL)
+        return NULL;
+
+    if ((fseek(f, offset, SEEK_SET) != 0)
+        || ((*size > 0) && (fread(directory, *size, 1, f) != 1)))
+    {
+        Debug_ErrorMsgArg("Error while reading: %s", path);
+        free(directory);
+        return NULL;
+    }
+
+    return directory;
+}
+
+int Zip_FindFile(const char *path, int (*is_valid)(const char *name),
+                 _zip_entry_t *entry)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", path);
+        return 1;
+    }
+
+    u32 size, entries;
+    u8 *directory = Zip_CentralDirectoryRead(f, path, &size, &entries);
+    fclose(f);
+
+    if (directory == NULL)
+        return 1;
+
+    int found = 0;
+    u32 offset = 0;
+
+    for (u32 i = 0; i < entries; i++)
+    {
+        if ((offset + ZIP_CENTRAL_SIZE) > size)
+            break;
+
+        const u8 *header = &directory[offset];
+        if (Zip_Read32(header) != ZIP_CENTRAL_SIGNATURE)
+            break;
+
+        u32 flags = Zip_Read16(&header[8]);
+        u32 method = Zip_Read16(&header[10]);
+        u32 name_len = Zip_Read16(&header[28]);
+        u32 extra_len = Zip_Read16(&header[30]);
+        u32 comment_len = Zip_Read16(&header[32]);
+
+        if ((offset + ZIP_CENTRAL_SIZE + name_len) > size)
+            break;
+
+        const char *name = (const char *)&header[ZIP_CENTRAL_SIZE];
+
+        offset += ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len;
+
+        // Skip folders and files that can't be extracted
+        if ((name_len == 0) || (name_len >= sizeof(entry->name))
+            || (name[name_len - 1] == '/'))
+        {
+            continue;
+        }
+
+        if (flags & ZIP_FLAG_ENCRYPTED)
+            continue;
+
+        if ((method != ZIP_METHOD_STORED) && (method != ZIP_METHOD_DEFLATED))
+            continue;
+
+        char entry_name[MAX_PATHLEN];
+        memcpy(entry_name, name, name_len);
+        entry_name[name_len] = '\0';
+
+        // If nothing is accepted, keep the first file
+        int valid = is_valid(entry_name);
+        if ((valid == 0) && found)
+            continue;
+
+        memcpy(entry->name, entry_name, name_len + 1);
+        entry->method = method;
+        entry->crc = Zip_Read32(&header[16]);
+        entry->compressed_size = Zip_Read32(&header[20]);
+        entry->size = Zip_Read32(&header[24]);
+        entry->local_header_offset = Zip_Read32(&header[42]);
+        found = 1;
+
+        if (valid)
+            break;
+    }
+
+    free(directory);
+
+    if (found == 0)
+    {
+        Debug_ErrorMsgArg("No file can be loaded from %s!", path);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int Zip_Inflate(FILE *f, const _zip_entry_t *entry, void *buffer)
+{
+    u8 *block = malloc(ZIP_READ_BLOCK_SIZE);
+    if (block == NULL)
+        return 1;
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // The data of the files is a raw deflate stream, without zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        free(block);
+        return 1;
+    }
+
+    stream.next_out = buffer;
+    stream.avail_out = entry->size;
+
+    u32 remaining = entry->compressed_size;
+    int ret = Z_OK;
+
+    while (ret != Z_STREAM_END)
+    {
+        if (stream.avail_in == 0)
+        {
+            if (remaining == 0)
+                break;
+
+            u32 read_size = remaining;
+            if (read_size > ZIP_READ_BLOCK_SIZE)
+                read_size = ZIP_READ_BLOCK_SIZE;
+
+            if (fread(block, read_size, 1, f) != 1)
+                break;
+
+            remaining -= read_size;
+            stream.next_in = block;
+            stream.avail_in = read_size;
+        }
+
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if ((ret != Z_OK) && (ret != Z_STREAM_END))
+            break;
+    }
+
+    inflateEnd(&stream);
+    free(block);
+
+    if ((ret != Z_STREAM_END) || (stream.avail_out != 0))
+        return 1;
+
+    return 0;
+}
+
+int Zip_Extract(const char *path, const _zip_entry_t *entry, void *buffer)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        Debug_ErrorMsgArg("%s couldn't be opened!", path);
+        return 1;
+    }
+
+    // The size of the name and extra field of the local header may be
+    // different from the ones in the central directory.
+    u8 header[ZIP_LOCAL_SIZE];
+    if ((fseek(f, entry->local_header_offset, SEEK_SET) != 0)
+        || (fread(header, sizeof(header), 1, f) != 1)
+        || (Zip_Read32(header) != ZIP_LOCAL_SIGNATURE))
+    {
+        Debug_ErrorMsgArg("%s isn't a valid ZIP archive!", path);
+        fclose(f);
+        return 1;
+    }
+
+    long data_offset = Zip_Read16(&header[26]) + Zip_Read16(&header[28]);
+    if (fseek(f, data_offset, SEEK_CUR) != 0)
+    {
+        Debug_ErrorMsgArg("Error while reading: %s", path);
+        fclose(f);
+        return 1;
+    }
+
+    int ret;
+    if (entry->method == ZIP_METHOD_STORED)
+    {
+        ret = (entry->size > 0) && (fread(buffer, entry->size, 1, f) != 1);
+    }
+    else
+    {
+        ret = Zip_Inflate(f, entry, buffer);
+    }
+
+    fclose(f);
+
+    if ((ret == 0) && (crc32(0, buffer, entry->size) != entry->crc))
+        ret = 1;
+
+    if (ret != 0)
+    {
+        Debug_ErrorMsgArg("Error while extracting %s from: %s", entry->name,
+                          path);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Copyright (c) 2011-2015, 2019, Antonio Niño Díaz
+//
+// GiiBiiAdvance - GBA/GB emulator
+
+#ifndef ZIP_UTILS__
+#define ZIP_UTILS__
+
+#include "build_options.h"
+#include "general_utils.h"
+
+// Only stored and deflated files are supported, which is what almost every
+// archiver uses. ZIP64 archives and encrypted files aren't supported.
+
+typedef struct
+{
+    char name[MAX_PATHLEN];
+    u32 method;
+    u32 crc;
+    u32 compressed_size;
+    u32 size; // Uncompressed size
+    u32 local_header_offset;
+} _zip_entry_t;
+
+// Returns 1 if the file name has the extension of a ZIP archive
+int Zip_IsArchive(const char *path);
+
+// Returns the first file of the archive that "is_valid" accepts, or the first
+// file of the archive if it doesn't accept any of them. Returns 0 on success.
+int Zip_FindFile(const char *path, int (*is_valid)(const char *name),
+                 _zip_entry_t *entry);
+
+// Decompresses a file of an archive into a buffer that is, at least,
+// entry->size bytes long. The data is decompressed straight into the buffer
+// while it's read, in one pass. Returns 0 on success.
+int Zip_Extract(const char *path, const _zip_entry_t *entry, void *buffer);
+
+#endif // ZIP_UTILS__
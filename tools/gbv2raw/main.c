@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: MIT
+//
+// Copyright (c) 2019, Antonio Niño Díaz
+
+// Decodes the videos recorded by the emulator in GBV format. The frames are
+// saved as raw BGRA pixels, and the audio is saved as a WAV file. The frames can
+// be sent to the standard output to encode them with ffmpeg directly.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#define HEADER_SIZE	40
+
+uint32_t get_u16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+uint32_t get_u32(const uint8_t *p)
+{
+	return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+void put_u16(uint8_t *p, uint32_t value)
+{
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+}
+
+void put_u32(uint8_t *p, uint32_t value)
+{
+	put_u16(p, value & 0xFFFF);
+	put_u16(p + 2, value >> 16);
+}
+
+int wav_header_write(FILE *f, uint32_t rate, uint32_t frames)
+{
+	uint32_t data_size = frames * 4;
+	uint8_t header[44];
+
+	memcpy(&header[0], "RIFF", 4);
+	put_u32(&header[4], 36 + data_size);
+	memcpy(&header[8], "WAVE", 4);
+	memcpy(&header[12], "fmt ", 4);
+	put_u32(&header[16], 16);
+	put_u16(&header[20], 1); // PCM
+	put_u16(&header[22], 2); // Channels
+	put_u32(&header[24], rate);
+	put_u32(&header[28], rate * 4);
+	put_u16(&header[32], 4);
+	put_u16(&header[34], 16);
+	memcpy(&header[36], "data", 4);
+	put_u32(&header[40], data_size);
+
+	return fwrite(header, sizeof(header), 1, f) != 1;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		fprintf(stderr,
+			"Usage: %s input.gbv output.raw [output.wav]\n"
+			"Use \"-\" as output.raw to write to stdout.\n",
+			argv[0]);
+		return 1;
+	}
+
+	FILE *fin = fopen(argv[1], "rb");
+	if (fin == NULL) {
+		fprintf(stderr, "Can't open %s\n", argv[1]);
+		return 1;
+	}
+
+	uint8_t header[HEADER_SIZE];
+	if ((fread(header, sizeof(header), 1, fin) != 1)
+	    || (memcmp(header, "GBVIDEO", 8) != 0)
+	    || (get_u32(&header[8]) != 1)) {
+		fprintf(stderr, "%s isn't a valid GBV file\n", argv[1]);
+		return 1;
+	}
+
+	uint32_t width = get_u16(&header[12]);
+	uint32_t height = get_u16(&header[14]);
+	uint32_t fps_num = get_u32(&header[16]);
+	uint32_t fps_den = get_u32(&header[20]);
+	uint32_t rate = get_u32(&header[24]);
+	uint32_t frames = get_u32(&header[28]);
+
+	FILE *fout;
+	if (strcmp(argv[2], "-") == 0)
+		fout = stdout;
+	else
+		fout = fopen(argv[2], "wb");
+	if (fout == NULL) {
+		fprintf(stderr, "Can't open %s\n", argv[2]);
+		return 1;
+	}
+
+	FILE *fwav = NULL;
+	if (argc > 3) {
+		fwav = fopen(argv[3], "wb");
+		if ((fwav == NULL) || wav_header_write(fwav, rate, 0)) {
+			fprintf(stderr, "Can't open %s\n", argv[3]);
+			return 1;
+		}
+	}
+
+	fprintf(stderr, "%ux%u, %u frames, %u Hz audio\n"
+		"Encode with:\n"
+		"    ffmpeg -f rawvideo -pixel_format bgr0 -video_size %ux%u "
+		"-framerate %u/%u -i %s -i %s -c:v ffv1 video.mkv\n",
+		width, height, frames, rate, width, height, fps_num, fps_den,
+		argv[2], (argc > 3) ? argv[3] : "audio.wav");
+
+	size_t frame_size = width * height * 4;
+	uint8_t *frame = calloc(1, frame_size);
+	uint8_t *delta = malloc(frame_size);
+	uint8_t *data = NULL;
+	uint32_t data_capacity = 0;
+	uint32_t audio_frames = 0;
+	uint32_t video_frames = 0;
+
+	if ((frame == NULL) || (delta == NULL)) {
+		fprintf(stderr, "Not enough memory\n");
+		return 1;
+	}
+
+	uint8_t packet[8];
+	while (fread(packet, sizeof(packet), 1, fin) == 1) {
+		uint32_t size = get_u32(&packet[4]);
+
+		if (size > data_capacity) {
+			free(data);
+			data = malloc(size);
+			data_capacity = size;
+			if (data == NULL) {
+				fprintf(stderr, "Not enough memory\n");
+				return 1;
+			}
+		}
+
+		if ((size > 0) && (fread(data, size, 1, fin) != 1)) {
+			fprintf(stderr, "Unexpected end of file\n");
+			break;
+		}
+
+		if (packet[0] == 'V') {
+			// An empty packet means that the frame hasn't changed
+			if (size > 0) {
+				uLongf len = frame_size;
+				if ((uncompress(delta, &len, data, size) != Z_OK)
+				    || (len != frame_size)) {
+					fprintf(stderr, "Invalid frame %u\n",
+						video_frames);
+					return 1;
+				}
+				for (size_t i = 0; i < frame_size; i++)
+					frame[i] ^= delta[i];
+			}
+
+			if (fwrite(frame, frame_size, 1, fout) != 1) {
+				fprintf(stderr, "Can't write frame\n");
+				return 1;
+			}
+			video_frames++;
+		} else if (packet[0] == 'A') {
+			if (fwav != NULL)
+				fwrite(data, size, 1, fwav);
+			audio_frames += size / 4;
+		}
+	}
+
+	if (fwav != NULL) {
+		fseek(fwav, 0, SEEK_SET);
+		wav_header_write(fwav, rate, audio_frames);
+		fclose(fwav);
+	}
+
+	if (fout != stdout)
+		fclose(fout);
+	fclose(fin);
+
+	free(frame);
+	free(delta);
+	free(data);
+
+	fprintf(stderr, "%u frames, %u audio samples\n", video_frames,
+		audio_frames);
+
+	return 0;
+}